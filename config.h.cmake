@@ -2,3 +2,12 @@
 #define PACKAGE_VERSION   "${qwwad_VERSION}"
 #define PACKAGE_URL       "${QWWAD_URL}"
 #define PACKAGE_BUGREPORT "${QWWAD_BUGREPORT}"
+
+#cmakedefine HAVE_SYS_MMAN_H 1
+#cmakedefine HAVE_TARGET_CLONES 1
+#cmakedefine HAVE_ZLIB 1
+#cmakedefine HAVE_ZSTD 1
+#cmakedefine HAVE_MPI 1
+#cmakedefine QWWAD_COUNTERS 1
+#cmakedefine HAVE_CUSOLVER 1
+#cmakedefine HAVE_CUDA 1
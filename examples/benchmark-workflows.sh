@@ -0,0 +1,252 @@
+#!/bin/sh
+set -e
+
+# Times a set of representative example calculations at fixed problem sizes
+#
+# Each workflow is a cut-down version of one of the example scripts, with
+# the grid sizes fixed so that timings can be compared between builds.  The
+# wall time and peak memory use of every program in each workflow are
+# recorded, so that it is clear which step dominates.
+#
+# The problem sizes may be changed by setting the following environment
+# variables before running the script:
+#
+#   BENCH_NZ      Number of spatial points in each wavefunction  (default 1000)
+#   BENCH_NKI     Number of initial wave-vector samples          (default 101)
+#   BENCH_NQ      Number of scattering-vector samples            (default 101)
+#   BENCH_GMAX    Largest reciprocal lattice vector for the
+#                 pseudopotential basis [2pi/A0]                 (default 4)
+#   BENCH_THREADS Number of threads for each program (0 = all)   (default 0)
+#
+# A subset of workflows may be run by listing their names as arguments:
+#
+#   benchmark-workflows.sh [lo-phonon] [carrier-carrier] [double-barrier-iv]
+#                          [exciton] [donor] [pseudopotential]
+#
+# This script is part of the QWWAD software suite. Any use of this code
+# or its derivatives in published work must be accompanied by a citation
+# of:
+#   P. Harrison and A. Valavanis, Quantum Wells, Wires and Dots, 4th ed.
+#    Chichester, U.K.: J. Wiley, 2016
+#
+# (c) Copyright 1996-2016
+#     Paul Harrison  <p.harrison@shu.ac.uk>
+#     Alex Valavanis <a.valavanis@leeds.ac.uk>
+#
+# QWWAD is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# QWWAD is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with QWWAD.  If not, see <http://www.gnu.org/licenses/>.
+
+# Fixed problem sizes
+BENCH_NZ=${BENCH_NZ:-1000}
+BENCH_NKI=${BENCH_NKI:-101}
+BENCH_NQ=${BENCH_NQ:-101}
+BENCH_GMAX=${BENCH_GMAX:-4}
+BENCH_THREADS=${BENCH_THREADS:-0}
+
+if [ ! -x /usr/bin/time ]; then
+    echo "This script needs the GNU time program (/usr/bin/time)" >&2
+    exit 1
+fi
+
+# Initialise files
+outfile=benchmark-workflows.dat
+summaryfile=benchmark-workflows-summary.dat
+rm -f $outfile $summaryfile
+
+startdir=`pwd`
+workdir=`mktemp -d`
+trap 'rm -rf $workdir' EXIT
+
+# Run a single program within a workflow and record its wall time [s] and
+# peak resident memory [kB]
+run_prog()
+{
+    prog=$1
+    /usr/bin/time -f "%e %M" -o $workdir/time.log "$@" > /dev/null
+    read wall rss < $workdir/time.log
+    printf "%s\t%s\t%s\t%s\n" $workflow $prog $wall $rss >> $startdir/$outfile
+}
+
+# Start a workflow in an empty directory
+start_workflow()
+{
+    workflow=$1
+    rm -rf $workdir/$workflow
+    mkdir $workdir/$workflow
+    cd $workdir/$workflow
+    echo "Running $workflow..."
+}
+
+# LO-phonon scattering rates between the states of an infinite well
+# (carrier-scattering/LO-phonon.sh)
+bench_lo_phonon()
+{
+    start_workflow lo-phonon
+
+    run_prog qwwad_ef_infinite_well --wellwidth 250 --nz $BENCH_NZ --nst 3
+    run_prog qwwad_fermi_distribution --fd --Te 77
+
+    cat > rrp.r << EOF
+2 1
+3 1
+3 2
+EOF
+
+    run_prog qwwad_sr_lo_phonon --Te 77 --Tl 77 --nki $BENCH_NKI --nKz $BENCH_NQ \
+                                --threads $BENCH_THREADS
+}
+
+# Carrier-carrier scattering rates within the ground state of an infinite well
+# (carrier-scattering/cc-intra-N.sh)
+bench_carrier_carrier()
+{
+    start_workflow carrier-carrier
+
+    run_prog qwwad_ef_infinite_well --wellwidth 250 --nz $BENCH_NZ --nst 2
+    echo 1e14 >  N.r
+    echo 1e14 >> N.r
+    run_prog qwwad_fermi_distribution --fd --Te 77
+
+    cat > rr.r << EOF
+1 1 1 1
+2 2 1 1
+2 1 1 1
+EOF
+
+    run_prog qwwad_sr_carrier_carrier --temperature 77 --nki $BENCH_NKI --nkj $BENCH_NKI \
+                                      --nq $BENCH_NQ
+}
+
+# Current-voltage curve for a double-barrier structure
+# (electron-transport)
+bench_double_barrier_iv()
+{
+    start_workflow double-barrier-iv
+
+    run_prog qwwad_tx_double_barrier_iv --leftbarrierwidth 100 --wellwidth 50 \
+                                        --rightbarrierwidth 100 --nF 50 \
+                                        --threads $BENCH_THREADS
+}
+
+# Exciton binding energy in an infinite well
+# (excitons/infinite-well.sh)
+bench_exciton()
+{
+    start_workflow exciton
+
+    run_prog qwwad_ef_infinite_well --wellwidth 100 --mass 0.096 --particle e --nz $BENCH_NZ
+    run_prog qwwad_ef_infinite_well --wellwidth 100 --mass 0.6   --particle h --nz $BENCH_NZ
+    run_prog qwwad_ef_exciton --dcpermittivity 10.6 --electronmass 0.096 --holemass 0.6 \
+                              --lambdastart 30 --threads $BENCH_THREADS
+}
+
+# Donor binding energy in a CdTe-CdMnTe quantum well
+# (impurities/E-donor-2D.sh)
+bench_donor()
+{
+    start_workflow donor
+
+    cat > s.r << EOF
+200 0.1 0.0
+60  0.0 0.0
+200 0.1 0.0
+EOF
+
+    export QWWAD_MASS=0.096
+    run_prog qwwad_mesh --dzmax `echo $BENCH_NZ | awk '{print 460/$1}'`
+    run_prog qwwad_ef_band_edge --material cdmnte --bandedgepotentialfile v.r
+    run_prog qwwad_ef_generic
+    run_prog qwwad_ef_donor_specific --dcpermittivity 10.6 --lambdastart 25 --lambdastop 300 \
+                                     --donorposition 230 --threads $BENCH_THREADS
+    unset QWWAD_MASS
+}
+
+# Bulk GaAs band structure using a large plane-wave basis
+# (empirical-pseudopotential/large-basis)
+bench_pseudopotential()
+{
+    start_workflow pseudopotential
+
+    cat > atoms.xyz << EOF
+2
+
+GAAScb -0.706 -0.706 -0.706
+ASGAcb  0.706  0.706  0.706
+EOF
+
+    # Path from L to Gamma to X
+    for k in 0.5 0.4 0.3 0.2 0.1 0.0; do
+        echo $k $k $k
+    done > k.r
+
+    for k in 0.1 0.2 0.3 0.4 0.5 0.6 0.7 0.8 0.9 1.0; do
+        echo 0.0 0.0 $k
+    done >> k.r
+
+    run_prog qwwad_reciprocal_fcc -A 5.65 -g $BENCH_GMAX
+    run_prog qwwad_pp_lattice_vector_table
+    run_prog qwwad_pp_large_basis --latticeconst 5.65 --threads $BENCH_THREADS
+}
+
+if [ $# -eq 0 ]; then
+    set -- lo-phonon carrier-carrier double-barrier-iv exciton donor pseudopotential
+fi
+
+for name in "$@"; do
+    case $name in
+        lo-phonon)         bench_lo_phonon ;;
+        carrier-carrier)   bench_carrier_carrier ;;
+        double-barrier-iv) bench_double_barrier_iv ;;
+        exciton)           bench_exciton ;;
+        donor)             bench_donor ;;
+        pseudopotential)   bench_pseudopotential ;;
+        *)
+            echo "Unknown workflow: $name" >&2
+            exit 1 ;;
+    esac
+done
+
+cd $startdir
+
+# Total wall time and largest memory use for each workflow
+awk -F'\t' '{t[$1] += $3; if($4 > m[$1]) m[$1] = $4; if(!($1 in o)) o[$1] = n++}
+            END {for(w in o) l[o[w]] = w;
+                 for(i = 0; i < n; i++) printf "%s\t%.2f\t%d\n", l[i], t[l[i]], m[l[i]]}' \
+    $outfile > $summaryfile
+
+cat << EOF
+Results have been written to $outfile and $summaryfile.
+
+Problem sizes: nz = $BENCH_NZ, nki = $BENCH_NKI, nq = $BENCH_NQ, G_max = $BENCH_GMAX
+
+$outfile is in the format:
+
+  COLUMN 1 - Workflow name
+  COLUMN 2 - Program
+  COLUMN 3 - Wall time [s]
+  COLUMN 4 - Peak resident memory [kB]
+
+$summaryfile is in the format:
+
+  COLUMN 1 - Workflow name
+  COLUMN 2 - Total wall time [s]
+  COLUMN 3 - Largest peak resident memory of any program [kB]
+
+This script is part of the QWWAD software suite.
+
+(c) Copyright 1996-2016
+    Alex Valavanis <a.valavanis@leeds.ac.uk>
+    Paul Harrison  <p.harrison@leeds.ac.uk>
+
+Report bugs to https://bugs.launchpad.net/qwwad
+EOF
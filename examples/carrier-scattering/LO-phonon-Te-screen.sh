@@ -55,6 +55,10 @@ efxv
 # Solve well
 efss --nst 2
 
+# The form factors only depend on the wavefunctions, so save them once
+# and reuse them at every temperature
+mkdir -p ff-cache
+
 for Te in `seq 15 5 300`; do 
 
 # Generate array of doping [1e11 cm^{-2} in each]
@@ -67,10 +71,10 @@ EOF
 sbp --Te $Te
 
 # Find scattering with screening
-srelo --Te $Te --Tl $Tl
+srelo --Te $Te --Tl $Tl --ffcachedir ff-cache
 rate21_11_screened=`awk '/^2\t1/{print $3}' LOe-if.r`
 
-srelo --Te $Te --Tl $Tl --noscreening
+srelo --Te $Te --Tl $Tl --noscreening --ffcachedir ff-cache
 rate21_11_unscreened=`awk '/^2\t1/{print $3}' LOe-if.r`
 
 # Generate array of doping [1e12 cm^{-2} in each]
@@ -83,10 +87,10 @@ EOF
 sbp --Te $Te
 
 # Find scattering with screening
-srelo --Te $Te --Tl $Tl
+srelo --Te $Te --Tl $Tl --ffcachedir ff-cache
 rate21_12_screened=`awk '/^2\t1/{print $3}' LOe-if.r`
 
-srelo --Te $Te --Tl $Tl --noscreening
+srelo --Te $Te --Tl $Tl --noscreening --ffcachedir ff-cache
 rate21_12_unscreened=`awk '/^2\t1/{print $3}' LOe-if.r`
 
 printf "%d %e %e %e %e\n" $Te $rate21_11_screened $rate21_11_unscreened $rate21_12_screened $rate21_12_unscreened >> $outfile
@@ -110,3 +114,4 @@ EOF
 
 # Clean up workspace
 # rm -f *.r
+rm -rf ff-cache
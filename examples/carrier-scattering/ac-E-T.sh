@@ -42,6 +42,10 @@ cat > N.r << EOF
 1e14
 EOF
 
+# The form factors only depend on the wavefunctions, so save them and
+# reuse them at every temperature
+mkdir -p ff-cache
+
 # Loop over carrier density per subband
 for LW in `seq 100 10 600`; do
 
@@ -59,7 +63,7 @@ efiw --width $LW --nz $nz --nst 2
      # Calculate distribution function
      sbp --Te $T
 
-     sradp --Te $T --Tl $T
+     sradp --Te $T --Tl $T --ffcachedir ff-cache
      rate=`awk '{print $3}' imp-avg.dat`
 
      awk '{printf("%e ",$3)}' ACe-if.r >> $outfile
@@ -94,3 +98,4 @@ EOF
 
 # Clean up workspace
 # rm -f *.r
+rm -rf ff-cache
@@ -54,21 +54,15 @@ qwwad_ef_band_edge
 qwwad_ef_zeeman --spinup --totalpotentialfile v_up.r
 qwwad_ef_zeeman --totalpotentialfile v_down.r
 
-export QWWAD_DONORPOSITION
-for QWWAD_DONORPOSITION in `seq 0 5 230`; do
-
-	# Find impurity states for spin-up and spin-down cases
-	qwwad_ef_donor_specific --symmetry 3D --lambdastart 10 --lambdastop 1000 --totalpotentialfile v_up.r
-
-	# Save all data for the spin-up state
-	Eplus=`awk '{print $2}' Ee.r`
-
-	# Now repeat for the spin-down state
-	qwwad_ef_donor_specific --symmetry 3D  --lambdastart 10 --lambdastop 1000 --totalpotentialfile v_down.r
-	Eminus=`awk '{print $2}' Ee.r`
-
-	printf "%d\t%e\t%e\n" $QWWAD_DONORPOSITION $Eplus $Eminus >> E_pm.tmp
-done
+# Find impurity states for spin-up and spin-down cases at each donor position
+export QWWAD_DONORPOSITIONSTART=0
+export QWWAD_DONORPOSITIONSTEP=5
+export QWWAD_DONORPOSITIONSTOP=230
+qwwad_ef_donor_specific --symmetry 3D --lambdastart 10 --lambdastop 1000 --totalpotentialfile v_up.r   --sweepfile E_up.tmp
+qwwad_ef_donor_specific --symmetry 3D --lambdastart 10 --lambdastop 1000 --totalpotentialfile v_down.r --sweepfile E_down.tmp
+
+# Tabulate the donor position with the energy of each state
+paste E_up.tmp E_down.tmp | awk '{print $1, $2, $6}' > E_pm.tmp
 
 # Now store the spin-flip energy between the states
 # as a function of the donor position
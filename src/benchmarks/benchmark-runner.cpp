@@ -0,0 +1,129 @@
+/**
+ * \file   benchmark-runner.cpp
+ * \brief  A simple timer for microbenchmarks
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "benchmark-runner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace QWWAD
+{
+/// Accumulator for results that would otherwise be unused
+static volatile double benchmark_sink = 0.0;
+
+void do_not_optimise(const double value)
+{
+    benchmark_sink = benchmark_sink + value;
+}
+
+/**
+ * \brief Set up a runner
+ *
+ * \param[in] filter    Only run benchmarks whose name contains this string
+ * \param[in] min_time  Smallest duration of each sample [s]
+ * \param[in] n_samples Number of samples for each benchmark
+ */
+BenchmarkRunner::BenchmarkRunner(const std::string  &filter,
+                                 const double        min_time,
+                                 const unsigned int  n_samples) :
+    _filter(filter),
+    _min_time(min_time),
+    _n_samples(n_samples)
+{
+    if(_min_time <= 0.0 || _n_samples == 0)
+    {
+        std::ostringstream oss;
+        oss << "Cannot take " << _n_samples << " samples of " << _min_time << " s each.";
+        throw std::domain_error(oss.str());
+    }
+}
+
+/**
+ * \brief Time a piece of code
+ *
+ * \param[in] name Name of the benchmark
+ * \param[in] size Problem size, for reporting
+ * \param[in] body The code to time
+ */
+void BenchmarkRunner::run(const std::string            &name,
+                          const size_t                  size,
+                          const std::function<void ()> &body)
+{
+    if(name.find(_filter) == std::string::npos)
+        return;
+
+    typedef std::chrono::steady_clock clock;
+
+    auto time_calls = [&](const size_t n_calls) {
+        const auto start = clock::now();
+
+        for(size_t icall = 0; icall < n_calls; ++icall)
+            body();
+
+        return std::chrono::duration<double>(clock::now() - start).count();
+    };
+
+    // Warm up, then find the number of calls needed for each sample
+    time_calls(1);
+    size_t n_calls = 1;
+
+    while(time_calls(n_calls) < _min_time)
+        n_calls *= 2;
+
+    std::vector<double> t(_n_samples); // Time per call in each sample [s]
+
+    for(auto &t_sample : t)
+        t_sample = time_calls(n_calls)/n_calls;
+
+    std::sort(t.begin(), t.end());
+
+    Result result;
+    result.name     = name;
+    result.size     = size;
+    result.n_calls  = n_calls;
+    result.t_min    = t.front();
+    result.t_median = t[t.size()/2];
+    _results.push_back(result);
+
+    std::cerr << name << " [" << size << "]: " << result.t_median << " s" << std::endl;
+}
+
+/**
+ * \brief Write the results as comma-separated values, with a header line
+ */
+void BenchmarkRunner::write_csv(std::ostream &stream) const
+{
+    stream << "name,size,calls,t_min,t_median\n" << std::setprecision(6);
+
+    for(auto const &r : _results)
+        stream << r.name << ',' << r.size << ',' << r.n_calls << ','
+               << r.t_min << ',' << r.t_median << '\n';
+}
+
+/**
+ * \brief Write the results as a JSON document
+ */
+void BenchmarkRunner::write_json(std::ostream &stream) const
+{
+    stream << "{\n  \"benchmarks\": [" << std::setprecision(6);
+
+    for(size_t i = 0; i < _results.size(); ++i)
+    {
+        auto const &r = _results[i];
+        stream << (i ? ",\n" : "\n")
+               << "    {\"name\": \"" << r.name << "\", \"size\": " << r.size
+               << ", \"calls\": " << r.n_calls << ", \"t_min\": " << r.t_min
+               << ", \"t_median\": " << r.t_median << "}";
+    }
+
+    stream << "\n  ]\n}\n";
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
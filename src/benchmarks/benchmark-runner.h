@@ -0,0 +1,66 @@
+/**
+ * \file   benchmark-runner.h
+ * \brief  A simple timer for microbenchmarks
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_BENCHMARK_RUNNER_H
+#define QWWAD_BENCHMARK_RUNNER_H
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace QWWAD
+{
+/**
+ * \brief Times a set of small pieces of code and reports the results
+ *
+ * \details Each benchmark is run once to warm up caches and workspaces.  The
+ *          number of calls per sample is then doubled until a sample takes at
+ *          least the minimum time, and several samples are taken.  The fastest
+ *          and median times per call are reported, since the fastest time is
+ *          the least affected by other load on the machine.
+ */
+class BenchmarkRunner
+{
+public:
+    /// Timing results for a single benchmark
+    struct Result
+    {
+        std::string name;      ///< Name of the benchmark
+        size_t      size;      ///< Problem size
+        size_t      n_calls;   ///< Number of calls per sample
+        double      t_min;     ///< Fastest time per call [s]
+        double      t_median;  ///< Median time per call [s]
+    };
+
+    BenchmarkRunner(const std::string  &filter,
+                    const double        min_time,
+                    const unsigned int  n_samples);
+
+    void run(const std::string           &name,
+             const size_t                 size,
+             const std::function<void ()> &body);
+
+    void write_csv (std::ostream &stream) const;
+    void write_json(std::ostream &stream) const;
+
+    /// Return the results of all benchmarks that have been run
+    const std::vector<Result> & get_results() const {return _results;}
+
+private:
+    std::string         _filter;    ///< Only run benchmarks whose name contains this
+    double              _min_time;  ///< Smallest duration of each sample [s]
+    unsigned int        _n_samples; ///< Number of samples for each benchmark
+    std::vector<Result> _results;   ///< Results of each benchmark
+};
+
+/**
+ * \brief Stop the compiler from removing a calculation whose result is unused
+ */
+void do_not_optimise(const double value);
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,436 @@
+/**
+ * \file   qwwad-benchmarks.cpp
+ * \brief  Microbenchmarks for the core library kernels
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ *
+ * \details Each kernel is timed over a range of problem sizes.  The results are
+ *          written as CSV or JSON, so that they can be compared between releases.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include "benchmark-runner.h"
+#include "qwwad/constants.h"
+#include "qwwad/fermi.h"
+#include "qwwad/file-io.h"
+#include "qwwad/linear-algebra.h"
+#include "qwwad/maths-helpers.h"
+#include "qwwad/options.h"
+#include "qwwad/parallel.h"
+#include "qwwad/poisson-solver.h"
+#include "qwwad/scattering-calculator-LO.h"
+#include "qwwad/schroedinger-solver-full.h"
+#include "qwwad/schroedinger-solver-infinite-well.h"
+#include "qwwad/schroedinger-solver-iterative.h"
+#include "qwwad/schroedinger-solver-shooting.h"
+#include "qwwad/schroedinger-solver-tridiagonal.h"
+#include "qwwad/subband.h"
+
+using namespace QWWAD;
+using namespace constants;
+
+/**
+ * Configure command-line options for the program
+ */
+Options configure_options(int argc, char* argv[])
+{
+    Options opt;
+
+    std::string summary("Time the core library kernels over a range of problem sizes.");
+
+    opt.add_option<std::string> ("format",   "csv", "Output format: csv or json");
+    opt.add_option<std::string> ("output",      "", "File to which results are written. If unspecified, "
+                                                     "results are written to the standard output.");
+    opt.add_option<std::string> ("filter",      "", "Only run benchmarks whose names contain this string");
+    opt.add_option<double>      ("min-time",   0.1, "Smallest duration of each timing sample [s]");
+    opt.add_option<unsigned int>("samples",      5, "Number of timing samples for each benchmark");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, summary);
+
+    return opt;
+}
+
+/**
+ * \brief Set up the finite-difference Hamiltonian for a harmonic potential
+ *
+ * \param[in]  nz Number of points
+ * \param[out] D  Diagonal [J]
+ * \param[out] E  Subdiagonal [J]
+ */
+static void make_harmonic_hamiltonian(const size_t  nz,
+                                      arma::vec    &D,
+                                      arma::vec    &E)
+{
+    const double L  = 100e-10;    // Width of structure [m]
+    const double dz = L/(nz - 1); // Spatial step [m]
+    const double m  = 0.067*me;   // Effective mass [kg]
+    const double t  = hBar*hBar/(2*m*dz*dz);
+
+    D.set_size(nz);
+    E.set_size(nz - 1);
+
+    for(size_t iz = 0; iz < nz; ++iz)
+    {
+        const double z = iz*dz - L/2;
+        D(iz) = 2*t + 0.5*e*1e16*z*z; // Harmonic potential, about 25 meV at the edges
+    }
+
+    for(size_t iz = 0; iz + 1 < nz; ++iz)
+        E(iz) = -t;
+}
+
+static void benchmark_eigen_solvers(BenchmarkRunner &runner)
+{
+    const double VL = -1*e;
+    const double VU =  1*e;
+
+    for(const size_t nz : {100, 1000, 10000})
+    {
+        arma::vec D0;
+        arma::vec E0;
+        make_harmonic_hamiltonian(nz, D0, E0);
+
+        runner.run("eigen_tridiag", nz, [&]() {
+            arma::vec D = D0;
+            arma::vec E = E0;
+            do_not_optimise(eigen_tridiag(D, E, VL, VU, 10).front().get_E());
+        });
+    }
+
+    for(const size_t nz : {1000, 10000})
+    {
+        arma::vec D0;
+        arma::vec E0;
+        make_harmonic_hamiltonian(nz, D0, E0);
+
+        // Upper triangles of A and B in LAPACK band storage
+        std::vector<double> AB0(2*nz, 0.0);
+        std::vector<double> BB0(2*nz, 0.0);
+
+        for(size_t iz = 0; iz < nz; ++iz)
+        {
+            if(iz > 0)
+                AB0[2*iz] = E0(iz-1);
+
+            AB0[2*iz+1] = D0(iz);
+            BB0[2*iz+1] = 1.0;
+        }
+
+        runner.run("eigen_banded", nz, [&]() {
+            std::vector<double> AB = AB0;
+            std::vector<double> BB = BB0;
+            do_not_optimise(eigen_banded(AB.data(), BB.data(), VL, VU, nz, 10).front().get_E());
+        });
+    }
+
+    for(const size_t nz : {100, 400})
+    {
+        arma::vec D0;
+        arma::vec E0;
+        make_harmonic_hamiltonian(nz, D0, E0);
+
+        arma::mat A0 = arma::zeros(nz, nz);
+
+        for(size_t iz = 0; iz < nz; ++iz)
+        {
+            A0(iz, iz) = D0(iz);
+
+            if(iz + 1 < nz)
+            {
+                A0(iz, iz+1) = E0(iz);
+                A0(iz+1, iz) = E0(iz);
+            }
+        }
+
+        runner.run("eigen_general", nz, [&]() {
+            arma::mat A = A0;
+            do_not_optimise(eigen_general(A, VL, VU, 10).front().get_E());
+        });
+    }
+}
+
+static void benchmark_linear_solvers(BenchmarkRunner &runner)
+{
+    for(const size_t nz : {1000, 100000})
+    {
+        const arma::vec sub   = -arma::ones(nz-1);
+        const arma::vec diag  = 2.5*arma::ones(nz);
+        const arma::vec super = -arma::ones(nz-1);
+        const arma::vec b     = arma::linspace(0, 1, nz);
+
+        runner.run("solve_tridiag", nz, [&]() {
+            do_not_optimise(solve_tridiag(sub, diag, super, b)(nz/2));
+        });
+
+        arma::vec            x(nz);
+        TridiagFactorisation work;
+
+        runner.run("solve_tridiag (in place)", nz, [&]() {
+            x = b;
+            solve_tridiag(sub, diag, super, x, work);
+            do_not_optimise(x(nz/2));
+        });
+    }
+
+    for(const size_t nz : {1000, 100000})
+    {
+        const double    dx  = 1e-10;
+        const arma::vec eps = 13.18*eps0*arma::ones(nz);
+        const arma::vec rho = e*1e22*arma::linspace(-1, 1, nz);
+        const PoissonSolver poisson(eps, dx);
+
+        runner.run("PoissonSolver::solve", nz, [&]() {
+            do_not_optimise(poisson.solve(rho)(nz/2));
+        });
+    }
+}
+
+static void benchmark_integration(BenchmarkRunner &runner)
+{
+    for(const size_t nz : {1001, 100001})
+    {
+        const arma::vec x  = arma::linspace(0, pi, nz);
+        const arma::vec y  = arma::sin(x);
+        const double    dx = x(1) - x(0);
+
+        runner.run("simps", nz, [&]() {
+            do_not_optimise(simps(y, dx));
+        });
+
+        runner.run("integral", nz, [&]() {
+            do_not_optimise(integral(y, dx));
+        });
+    }
+}
+
+/**
+ * \brief Time the reproducible parallel reductions against a plain serial sum
+ *
+ * \details The reductions give the same result for any number of threads, so the
+ *          difference from the serial loop is the cost of that guarantee.
+ */
+static void benchmark_reductions(BenchmarkRunner &runner)
+{
+    for(const size_t n : {1000, 1000000})
+    {
+        const arma::vec x = arma::linspace(0, pi, n);
+        const arma::vec y = arma::sin(x);
+
+        runner.run("serial sum", n, [&]() {
+            double sum = 0.0;
+
+            for(size_t i = 0; i < n; ++i)
+                sum += y(i);
+
+            do_not_optimise(sum);
+        });
+
+        runner.run("parallel_reduce", n, [&]() {
+            do_not_optimise(parallel_reduce(n, 0, 0.0,
+                                            [&](const size_t i) {return y(i);},
+                                            std::plus<double>()));
+        });
+
+        runner.run("parallel_sum", n, [&]() {
+            do_not_optimise(parallel_sum(n, 0, [&](const size_t i) {return y(i);}));
+        });
+    }
+}
+
+/**
+ * \brief Time each of the Schroedinger solvers that qwwad_ef_generic can choose automatically
+ *
+ * \details A 60 nm GaAs well between 10 nm barriers is used, so that there are
+ *          plenty of bound states, and the lowest one, three or ten are found.  The
+ *          shooting solver is timed with and without nonparabolicity, and the matrix
+ *          solvers are also timed with Bloch-periodic boundaries.  These are the cases
+ *          from which the cost model in qwwad_ef_generic was fitted, so run them with
+ *          --num_threads 1 to check it.
+ */
+static void benchmark_schroedinger_solvers(BenchmarkRunner &runner)
+{
+    for(const size_t nz : {100, 1000})
+    {
+        const arma::vec z = arma::linspace(0, 80e-9, nz);
+        arma::vec V(nz);
+
+        for(size_t iz = 0; iz < nz; ++iz)
+            V(iz) = (z(iz) < 10e-9 || z(iz) > 70e-9) ? 0.3*e : 0;
+
+        const arma::vec m     = 0.067*me*arma::ones(nz);
+        const arma::vec alpha = 0.7/e*arma::ones(nz);
+        const arma::vec zero  = arma::zeros(nz);
+
+        for(const size_t nst : {1, 3, 10})
+        {
+            const std::string states = " (" + std::to_string(nst) + " states)";
+
+            runner.run("SchroedingerSolverTridiag" + states, nz, [&]() {
+                SchroedingerSolverTridiag se(m, V, z, nst);
+                do_not_optimise(se.get_solutions().front().get_energy());
+            });
+
+            runner.run("SchroedingerSolverIterative" + states, nz, [&]() {
+                SchroedingerSolverIterative se(m, alpha, V, z, nst);
+                do_not_optimise(se.get_solutions().front().get_energy());
+            });
+
+            runner.run("SchroedingerSolverShooting parabolic" + states, nz, [&]() {
+                SchroedingerSolverShooting se(m, zero, V, z, 1e-3*e/1000, nst);
+                do_not_optimise(se.get_solutions().front().get_energy());
+            });
+
+            runner.run("SchroedingerSolverShooting" + states, nz, [&]() {
+                SchroedingerSolverShooting se(m, alpha, V, z, 1e-3*e/1000, nst);
+                do_not_optimise(se.get_solutions().front().get_energy());
+            });
+
+            runner.run("SchroedingerSolverFull sparse" + states, nz, [&]() {
+                SchroedingerSolverFull se(m, alpha, V, z, nst, true);
+                do_not_optimise(se.get_solutions().front().get_energy());
+            });
+        }
+
+        runner.run("SchroedingerSolverTridiag Bloch", nz, [&]() {
+            SchroedingerSolverTridiag se(m, V, z, 3);
+            se.set_bloch_wavevector(0.5*pi/se.get_bloch_period());
+            do_not_optimise(se.get_solutions().front().get_energy());
+        });
+
+        // The dense solvers don't depend on the number of states, and are far too
+        // slow for the larger mesh
+        if(nz <= 100)
+        {
+            runner.run("SchroedingerSolverFull", nz, [&]() {
+                SchroedingerSolverFull se(m, alpha, V, z, 3);
+                do_not_optimise(se.get_solutions().front().get_energy());
+            });
+
+            runner.run("SchroedingerSolverFull Bloch", nz, [&]() {
+                SchroedingerSolverFull se(m, alpha, V, z, 3);
+                se.set_bloch_wavevector(0.5*pi/se.get_bloch_period());
+                do_not_optimise(se.get_solutions().front().get_energy());
+            });
+        }
+    }
+}
+
+static void benchmark_scattering(BenchmarkRunner &runner)
+{
+    const double m  = 0.067*me;
+    const double Te = 300;
+
+    for(const size_t nz : {100, 1000})
+    {
+        SchroedingerSolverInfWell se(m, 200e-10, nz, 0, 0, 2);
+        std::vector<Subband> subbands;
+
+        for(auto const &state : se.get_solutions())
+            subbands.push_back(Subband(state, m));
+
+        const double Ef = find_fermi_global(se.get_solutions(), m, 1e15, Te);
+
+        for(auto &sb : subbands)
+            sb.set_distribution_from_Ef_Te(Ef, Te);
+
+        ScatteringCalculatorLO calculator(subbands, 5.65e-10, 0.036*e, 13.18*eps0, 10.89*eps0,
+                                          m, Te, Te, true);
+
+        runner.run("ScatteringCalculatorLO::make_ff_table", nz, [&]() {
+            calculator.make_ff_table(1, 0);
+        });
+
+        runner.run("ScatteringCalculatorLO::get_rate_ki", nz, [&]() {
+            do_not_optimise(calculator.get_rate_ki(1, 0, 1e8));
+        });
+    }
+}
+
+static void benchmark_fermi(BenchmarkRunner &runner)
+{
+    for(const size_t nst : {2, 20})
+    {
+        const arma::vec Esb = arma::linspace(0, 0.2*e, nst);
+
+        runner.run("find_fermi_global", nst, [&]() {
+            do_not_optimise(find_fermi_global(Esb, 0.067*me, 1e15, 300));
+        });
+    }
+}
+
+static void benchmark_file_io(BenchmarkRunner &runner)
+{
+    const std::string fname = "qwwad-benchmark-table.r";
+
+    for(const size_t n : {1000, 100000})
+    {
+        const arma::vec x = arma::linspace(0, 1, n);
+        const arma::vec y = arma::exp(x);
+
+        runner.run("write_table", n, [&]() {
+            write_table(fname, x, y);
+        });
+
+        runner.run("read_table", n, [&]() {
+            arma::vec x_in;
+            arma::vec y_in;
+            read_table(fname, x_in, y_in);
+            do_not_optimise(y_in(n/2));
+        });
+    }
+
+    std::remove(fname.c_str());
+}
+
+int main(int argc, char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    const auto format = opt.get_option<std::string>("format");
+    const auto output = opt.get_option<std::string>("output");
+
+    if(format != "csv" && format != "json")
+    {
+        std::cerr << "Output format: " << format << " not recognised" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    BenchmarkRunner runner(opt.get_option<std::string>("filter"),
+                           opt.get_option<double>("min-time"),
+                           opt.get_option<unsigned int>("samples"));
+
+    benchmark_eigen_solvers(runner);
+    benchmark_linear_solvers(runner);
+    benchmark_integration(runner);
+    benchmark_reductions(runner);
+    benchmark_schroedinger_solvers(runner);
+    benchmark_scattering(runner);
+    benchmark_fermi(runner);
+    benchmark_file_io(runner);
+
+    std::ofstream file;
+
+    if(!output.empty())
+    {
+        file.open(output.c_str());
+
+        if(!file.is_open())
+        {
+            std::cerr << "Could not open " << output << " for writing." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    std::ostream &stream = output.empty() ? std::cout : file;
+
+    if(format == "json")
+        runner.write_json(stream);
+    else
+        runner.write_csv(stream);
+
+    return EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,165 @@
+/**
+ * \file   anderson-mixer.cpp
+ * \brief  Anderson acceleration for fixed-point iterations
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include <sstream>
+#include <stdexcept>
+#include "anderson-mixer.h"
+#include "checkpoint.h"
+
+namespace QWWAD
+{
+/**
+ * \brief Create a mixer
+ *
+ * \param[in] depth Number of previous iterations to use
+ * \param[in] beta  Mixing factor for the residual (0 < beta <= 1)
+ */
+AndersonMixer::AndersonMixer(const decltype(_depth) depth,
+                             const decltype(_beta)  beta) :
+    _depth(depth),
+    _beta(beta),
+    _started(false)
+{
+    if(_beta <= 0.0 || _beta > 1.0)
+    {
+        std::ostringstream oss;
+        oss << "Mixing factor must lie in the range (0,1].  Got " << _beta;
+        throw std::domain_error(oss.str());
+    }
+}
+
+/**
+ * \brief Find the next estimate in the iteration
+ *
+ * \param[in] x The current estimate
+ * \param[in] g The result of applying the fixed-point map to the current estimate
+ *
+ * \returns The next estimate
+ */
+arma::vec AndersonMixer::mix(const arma::vec &x,
+                             const arma::vec &g)
+{
+    const arma::vec f = g - x; // Residual
+
+    if(_started)
+    {
+        if(x.size() != _x_prev.size())
+        {
+            std::ostringstream oss;
+            oss << "Got a vector of size " << x.size() << " but previous iterations used size "
+                << _x_prev.size();
+            throw std::length_error(oss.str());
+        }
+
+        _dx.push_back(x - _x_prev);
+        _df.push_back(f - _f_prev);
+
+        if(_dx.size() > _depth)
+        {
+            _dx.pop_front();
+            _df.pop_front();
+        }
+    }
+
+    _started = true;
+    _x_prev  = x;
+    _f_prev  = f;
+
+    if(_dx.empty())
+        return x + _beta*f;
+
+    // Find the combination of previous residual changes that best cancels
+    // the current residual
+    const auto m = _dx.size();
+    arma::mat dX(x.size(), m);
+    arma::mat dF(x.size(), m);
+
+    for(unsigned int j = 0; j < m; ++j)
+    {
+        dX.col(j) = _dx[j];
+        dF.col(j) = _df[j];
+    }
+
+    arma::vec gamma;
+
+    // Fall back to linear mixing if the history is degenerate
+    if(!arma::solve(gamma, dF, f))
+    {
+        reset();
+        return x + _beta*f;
+    }
+
+    return x - dX*gamma + _beta*(f - dF*gamma);
+}
+
+/**
+ * \brief Forget all previous iterations
+ */
+void AndersonMixer::reset()
+{
+    _started = false;
+    _dx.clear();
+    _df.clear();
+}
+
+/**
+ * \brief Append the iteration history to a checkpoint buffer
+ *
+ * \param[in,out] buffer The buffer
+ *
+ * \details The history depth and mixing factor are not stored, since they are
+ *          set when the mixer is created.
+ */
+void AndersonMixer::append_state(std::string &buffer) const
+{
+    append_checkpoint_value<uint8_t>(buffer, _started);
+    append_checkpoint_table(buffer, _x_prev.memptr(), _x_prev.size());
+    append_checkpoint_table(buffer, _f_prev.memptr(), _f_prev.size());
+    append_checkpoint_value<uint64_t>(buffer, _dx.size());
+
+    for(size_t j = 0; j < _dx.size(); ++j)
+    {
+        append_checkpoint_table(buffer, _dx[j].memptr(), _dx[j].size());
+        append_checkpoint_table(buffer, _df[j].memptr(), _df[j].size());
+    }
+}
+
+/**
+ * \brief Restore the iteration history from a checkpoint
+ *
+ * \param[in,out] stream The checkpoint, positioned at the data written by
+ *                       append_state()
+ *
+ * \details If the checkpoint holds more previous iterations than the depth of
+ *          this mixer, only the most recent are kept.
+ */
+void AndersonMixer::read_state(std::istream &stream)
+{
+    reset();
+
+    _started = read_checkpoint_value<uint8_t>(stream) != 0;
+    _x_prev  = arma::vec(read_checkpoint_table(stream));
+    _f_prev  = arma::vec(read_checkpoint_table(stream));
+
+    const auto m = read_checkpoint_value<uint64_t>(stream);
+
+    for(uint64_t j = 0; j < m and stream; ++j)
+    {
+        _dx.push_back(arma::vec(read_checkpoint_table(stream)));
+        _df.push_back(arma::vec(read_checkpoint_table(stream)));
+
+        if(_dx.size() > _depth)
+        {
+            _dx.pop_front();
+            _df.pop_front();
+        }
+    }
+
+    if(!stream)
+        throw std::runtime_error("Mixing history in checkpoint is incomplete.");
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,54 @@
+/**
+ * \file   anderson-mixer.h
+ * \brief  Anderson acceleration for fixed-point iterations
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_ANDERSON_MIXER_H
+#define QWWAD_ANDERSON_MIXER_H
+
+#include <deque>
+#include <istream>
+#include <string>
+#include <armadillo>
+
+namespace QWWAD
+{
+/**
+ * \brief Anderson acceleration of a fixed-point iteration \f$x = g(x)\f$
+ *
+ * \details Each new estimate is a combination of the last few outputs of
+ *          \f$g\f$, chosen to minimise the residual \f$g(x) - x\f$ in the
+ *          least-squares sense.  With a history depth of zero, this is simple
+ *          linear mixing,
+ *          \f[
+ *            x_{k+1} = x_k + \beta\left[g(x_k) - x_k\right].
+ *          \f]
+ */
+class AndersonMixer {
+private:
+    size_t _depth; ///< Number of previous iterations to keep
+    double _beta;  ///< Mixing factor for the residual
+
+    bool      _started; ///< True once the first iteration has been seen
+    arma::vec _x_prev;  ///< Input to the previous iteration
+    arma::vec _f_prev;  ///< Residual at the previous iteration
+
+    std::deque<arma::vec> _dx; ///< Change in input between iterations
+    std::deque<arma::vec> _df; ///< Change in residual between iterations
+
+public:
+    AndersonMixer(const decltype(_depth) depth = 5,
+                  const decltype(_beta)  beta  = 1.0);
+
+    arma::vec mix(const arma::vec &x,
+                  const arma::vec &g);
+
+    void reset();
+
+    void append_state(std::string &buffer) const;
+    void read_state(std::istream &stream);
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,314 @@
+/**
+ * \file   anticrossing-sweep.cpp
+ * \brief  Adaptive sweep of a parameter, refined around anticrossings between states
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "anticrossing-sweep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+#include "constants.h"
+#include "parallel.h"
+#include "profiler.h"
+#include "schroedinger-solver-tridiagonal.h"
+
+namespace QWWAD
+{
+using namespace constants;
+
+/**
+ * \brief Set up a sweep
+ *
+ * \param[in] solve Function that finds the states at a parameter value
+ * \param[in] nst   Number of states to track.  The solver must find at least
+ *                  this many states at every parameter value.
+ */
+AnticrossingSweep::AnticrossingSweep(const solver_type &solve,
+                                     const size_t       nst) :
+    _solve(solve),
+    _nst(nst),
+    _overlap_tol(0.95),
+    _E_tol(0.01*e/1000),
+    _dparam_min(0),
+    _n_max(1000),
+    _h(),
+    _points()
+{
+    if(nst < 2)
+    {
+        std::ostringstream oss;
+        oss << "At least two states are needed to find anticrossings, but " << nst << " were requested.";
+        throw std::invalid_argument(oss.str());
+    }
+}
+
+/**
+ * \brief Copy the lowest states at a parameter value into a sweep point
+ *
+ * \param[in] param  The parameter value
+ * \param[in] states The states at the parameter value, in ascending order of energy
+ * \param[in] nst    Number of states to copy
+ */
+static SweepPoint make_sweep_point(const double                   param,
+                                   const std::vector<Eigenstate> &states,
+                                   const size_t                   nst)
+{
+    if(states.size() < nst)
+    {
+        std::ostringstream oss;
+        oss << "Only " << states.size() << " states were found at parameter value " << param
+            << ", but " << nst << " are being tracked.";
+        throw std::runtime_error(oss.str());
+    }
+
+    const size_t nz = states[0].get_position_samples().size();
+
+    SweepPoint point;
+    point.param = param;
+    point.E.set_size(nst);
+    point.psi.set_size(nz, nst);
+
+    for(unsigned int ist = 0; ist < nst; ++ist)
+    {
+        point.E[ist]       = states[ist].get_energy();
+        point.psi.col(ist) = states[ist].get_wavefunction_samples();
+    }
+
+    return point;
+}
+
+/**
+ * \brief Find the states at a single parameter value
+ *
+ * \param[in] param The parameter value
+ */
+SweepPoint AnticrossingSweep::solve_point(const double param) const
+{
+    return make_sweep_point(param, _solve(param), _nst);
+}
+
+/**
+ * \brief Find the states at a set of new parameter values, and add them to the sweep
+ *
+ * \param[in] params    The parameter values
+ * \param[in] n_threads Number of threads to use (0 = one per CPU core)
+ */
+void AnticrossingSweep::solve_points(const std::vector<double> &params,
+                                     const unsigned int         n_threads)
+{
+    std::vector<SweepPoint> new_points(params.size());
+
+    run_in_parallel(params.size(), n_threads, [&](const size_t ipoint) {
+        ScopedTraceEvent event("sweep point");
+        new_points[ipoint] = solve_point(params[ipoint]);
+    });
+
+    _points.insert(_points.end(), new_points.begin(), new_points.end());
+
+    std::sort(_points.begin(), _points.end(),
+              [](const SweepPoint &a, const SweepPoint &b) {return a.param < b.param;});
+}
+
+/**
+ * \brief Match the states at one parameter value to those at the next
+ *
+ * \param[in]  ipoint      Index of the lower parameter value in the sweep
+ * \param[out] overlap_min The smallest overlap between any pair of matched states
+ *
+ * \returns The index of the state at the next parameter value that matches each
+ *          state at this one
+ *
+ * \details Pairs of states are matched greedily, in descending order of the
+ *          magnitude of their overlap.
+ */
+arma::uvec AnticrossingSweep::match_states(const size_t  ipoint,
+                                           double       &overlap_min) const
+{
+    const arma::mat &psi_a = _points[ipoint].psi;
+    const arma::mat &psi_b = _points[ipoint+1].psi;
+    arma::mat        O     = arma::abs(psi_a.t() * arma::diagmat(_h) * psi_b);
+
+    arma::uvec match(_nst);
+    overlap_min = 1.0;
+
+    for(unsigned int ipair = 0; ipair < _nst; ++ipair)
+    {
+        arma::uword ia = 0;
+        arma::uword ib = 0;
+        const double overlap = O.max(ia, ib);
+
+        match[ia]   = ib;
+        overlap_min = std::min(overlap_min, overlap);
+
+        // Remove the matched states from the search
+        O.row(ia).fill(-1.0);
+        O.col(ib).fill(-1.0);
+    }
+
+    return match;
+}
+
+/**
+ * \brief Find the anticrossings in the current sweep
+ *
+ * \param[in,out] refine Flag for each interval between parameter values, which
+ *                       is set if the interval needs to be split to resolve
+ *                       an anticrossing
+ *
+ * \returns The anticrossings, in ascending order of parameter value
+ */
+std::vector<Anticrossing> AnticrossingSweep::find_anticrossings(std::vector<bool> &refine) const
+{
+    std::vector<Anticrossing> anticrossings;
+    const size_t              n_points = _points.size();
+
+    if(n_points < 3)
+        return anticrossings;
+
+    std::vector<arma::uvec> match(n_points-1);
+
+    for(unsigned int ipoint = 0; ipoint+1 < n_points; ++ipoint)
+    {
+        double overlap_min = 0;
+        match[ipoint] = match_states(ipoint, overlap_min);
+    }
+
+    for(unsigned int ipoint = 1; ipoint+1 < n_points; ++ipoint)
+    {
+        for(unsigned int ist = 0; ist+1 < _nst; ++ist)
+        {
+            const double g0 = _points[ipoint-1].E[ist+1] - _points[ipoint-1].E[ist];
+            const double g1 = _points[ipoint  ].E[ist+1] - _points[ipoint  ].E[ist];
+            const double g2 = _points[ipoint+1].E[ist+1] - _points[ipoint+1].E[ist];
+
+            if(!(g1 < g0 && g1 <= g2))
+                continue;
+
+            // The states at a true crossing swap their order in energy, so their
+            // identities do not match across the minimum
+            const bool swapped = match[ipoint-1][ist]   != ist || match[ipoint-1][ist+1] != ist+1 ||
+                                 match[ipoint  ][ist]   != ist || match[ipoint  ][ist+1] != ist+1;
+
+            if(swapped)
+                continue;
+
+            // Fit a parabola to the square of the splitting, which is quadratic
+            // in the parameter close to an anticrossing
+            const double u0 = _points[ipoint-1].param - _points[ipoint].param;
+            const double u2 = _points[ipoint+1].param - _points[ipoint].param;
+            const double y0 = g0*g0;
+            const double y1 = g1*g1;
+            const double y2 = g2*g2;
+            const double a  = ((y2-y1)/u2 - (y0-y1)/u0)/(u2-u0);
+            const double b  = (y2-y1)/u2 - a*u2;
+
+            double u_min = 0;
+            double y_min = y1;
+
+            if(a > 0)
+            {
+                u_min = -b/(2*a);
+                y_min = std::max(y1 - b*b/(4*a), 0.0);
+            }
+
+            Anticrossing anticrossing;
+            anticrossing.lower  = ist;
+            anticrossing.upper  = ist+1;
+            anticrossing.param  = _points[ipoint].param + u_min;
+            anticrossing.dE_min = std::sqrt(y_min);
+            anticrossings.push_back(anticrossing);
+
+            if(g1 - anticrossing.dE_min > _E_tol)
+            {
+                if(-u0 > 2*_dparam_min)
+                    refine[ipoint-1] = true;
+
+                if(u2 > 2*_dparam_min)
+                    refine[ipoint] = true;
+            }
+        }
+    }
+
+    return anticrossings;
+}
+
+/**
+ * \brief Sweep the parameter, and find the anticrossings
+ *
+ * \param[in] param_start The first parameter value
+ * \param[in] param_stop  The last parameter value
+ * \param[in] n_initial   Number of evenly-spaced parameter values in the initial sweep
+ * \param[in] n_threads   Number of threads to use (0 = one per CPU core)
+ *
+ * \returns The anticrossings, in ascending order of parameter value
+ *
+ * \details Each pass splits every interval in which the states could not be
+ *          matched, or which neighbours an unresolved anticrossing.  The sweep
+ *          stops when no interval needs to be split, or when the largest number
+ *          of parameter values is reached.
+ */
+std::vector<Anticrossing> AnticrossingSweep::run(const double       param_start,
+                                                 const double       param_stop,
+                                                 const size_t       n_initial,
+                                                 const unsigned int n_threads)
+{
+    if(n_initial < 3 || param_stop <= param_start)
+    {
+        std::ostringstream oss;
+        oss << "Cannot sweep from " << param_start << " to " << param_stop << " using "
+            << n_initial << " initial points.  At least three points are needed, in ascending order.";
+        throw std::invalid_argument(oss.str());
+    }
+
+    _points.clear();
+
+    // Find the cell widths from the mesh at the first point
+    const auto states = _solve(param_start);
+    const auto point  = make_sweep_point(param_start, states, _nst);
+    _h = SchroedingerSolverTridiag::get_cell_widths(states[0].get_position_samples());
+
+    _points.push_back(point);
+
+    const arma::vec params_initial = arma::linspace(param_start, param_stop, n_initial);
+    solve_points(std::vector<double>(params_initial.begin()+1, params_initial.end()), n_threads);
+
+    while(_points.size() < _n_max)
+    {
+        std::vector<bool> refine(_points.size()-1, false);
+
+        for(unsigned int ipoint = 0; ipoint+1 < _points.size(); ++ipoint)
+        {
+            double overlap_min = 0;
+            match_states(ipoint, overlap_min);
+
+            const double dparam = _points[ipoint+1].param - _points[ipoint].param;
+
+            if(overlap_min < _overlap_tol && dparam > 2*_dparam_min)
+                refine[ipoint] = true;
+        }
+
+        find_anticrossings(refine);
+
+        std::vector<double> params_new;
+
+        for(unsigned int ipoint = 0; ipoint+1 < _points.size(); ++ipoint)
+        {
+            if(refine[ipoint] && _points.size() + params_new.size() < _n_max)
+                params_new.push_back(0.5*(_points[ipoint].param + _points[ipoint+1].param));
+        }
+
+        if(params_new.empty())
+            break;
+
+        solve_points(params_new, n_threads);
+    }
+
+    std::vector<bool> refine(_points.size()-1, false);
+    return find_anticrossings(refine);
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,108 @@
+/**
+ * \file   anticrossing-sweep.h
+ * \brief  Adaptive sweep of a parameter, refined around anticrossings between states
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_ANTICROSSING_SWEEP_H
+#define QWWAD_ANTICROSSING_SWEEP_H
+
+#include <functional>
+#include <vector>
+#include <armadillo>
+#include "eigenstate.h"
+
+namespace QWWAD
+{
+/**
+ * \brief An avoided crossing between a pair of states
+ */
+struct Anticrossing
+{
+    unsigned int lower;  ///< Index of the lower state (from 0, in order of energy)
+    unsigned int upper;  ///< Index of the upper state
+    double       param;  ///< Parameter value at the minimum splitting
+    double       dE_min; ///< Minimum energy splitting [J]
+};
+
+/**
+ * \brief The states at a single value of the swept parameter
+ */
+struct SweepPoint
+{
+    double    param; ///< Parameter value
+    arma::vec E;     ///< Energy of each state, in ascending order [J]
+    arma::mat psi;   ///< Wavefunction samples, with one column for each state [1/sqrt(m)]
+};
+
+/**
+ * \brief Sweeps a parameter (usually the applied field), refining the grid
+ *        only where the states change rapidly
+ *
+ * \details The states at neighbouring parameter values are matched by their
+ *          overlap.  Where the best overlap for any state drops below a
+ *          threshold, the identity of the states cannot be tracked reliably, so
+ *          the interval is split.  This happens automatically near an
+ *          anticrossing, where two states exchange character over a range of
+ *          parameter values that is set by their coupling.
+ *
+ *          At each local minimum of the splitting between neighbouring states
+ *          that keep their order (i.e., an avoided, rather than a true, crossing),
+ *          the square of the splitting is fitted by a parabola through the three
+ *          nearest points.  The neighbouring intervals are split until the
+ *          sampled minimum agrees with the fitted one to within a tolerance.
+ *          True crossings keep a large overlap, so they are not refined.
+ */
+class AnticrossingSweep
+{
+public:
+    /// Function that finds the states, in ascending order of energy, at a parameter value
+    typedef std::function<std::vector<Eigenstate> (const double param)> solver_type;
+
+private:
+    solver_type             _solve;       ///< Finds the states at a parameter value
+    size_t                  _nst;         ///< Number of states to track
+    double                  _overlap_tol; ///< Smallest acceptable overlap between neighbouring points
+    double                  _E_tol;       ///< Tolerance in each minimum splitting [J]
+    double                  _dparam_min;  ///< Smallest interval between parameter values
+    size_t                  _n_max;       ///< Largest number of parameter values
+    arma::vec               _h;           ///< Width of the cell around each spatial sample [m]
+    std::vector<SweepPoint> _points;      ///< States at each parameter value, in ascending order
+
+    SweepPoint solve_point(const double param) const;
+
+    void solve_points(const std::vector<double> &params,
+                      const unsigned int         n_threads);
+
+    arma::uvec match_states(const size_t  ipoint,
+                            double       &overlap_min) const;
+
+    std::vector<Anticrossing> find_anticrossings(std::vector<bool> &refine) const;
+
+public:
+    AnticrossingSweep(const solver_type &solve,
+                      const size_t       nst);
+
+    /// Set the smallest acceptable overlap between the same state at neighbouring points
+    inline void set_overlap_tolerance(const double tol) {_overlap_tol = tol;}
+
+    /// Set the tolerance in each minimum splitting [J]
+    inline void set_energy_tolerance(const double tol) {_E_tol = tol;}
+
+    /// Set the smallest interval between parameter values
+    inline void set_min_step(const double dparam) {_dparam_min = dparam;}
+
+    /// Set the largest number of parameter values at which to find the states
+    inline void set_max_points(const size_t n) {_n_max = n;}
+
+    std::vector<Anticrossing> run(const double       param_start,
+                                  const double       param_stop,
+                                  const size_t       n_initial,
+                                  const unsigned int n_threads = 1);
+
+    /// Return the states at every parameter value, in ascending order of parameter
+    inline const std::vector<SweepPoint> & get_points() const {return _points;}
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
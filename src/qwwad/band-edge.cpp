@@ -0,0 +1,226 @@
+/**
+ * \file   band-edge.cpp
+ * \brief  Band-edge parameters for a heterostructure, found from its alloy profile
+ * \author Paul Harrison  <p.harrison@shu.ac.uk>
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "band-edge.h"
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "constants.h"
+
+namespace QWWAD
+{
+using namespace constants;
+
+namespace
+{
+/**
+ * \brief dc relative permittivity values
+ *
+ * \todo Read from material library
+ */
+const double eps_dc_GaAs = 12.9;
+const double eps_dc_AlAs = 10.06;
+const double eps_dc_InAs = 15.15;
+
+/**
+ * \brief Heavy-hole effective masses
+ *
+ * \todo Read from material library
+ */
+const double m_hh_GaAs = 0.51;
+const double m_hh_AlAs = 0.76;
+const double m_hh_InAs = 0.41;
+
+/**
+ * \brief Light-hole effective masses
+ *
+ * \todo Read from material library
+ */
+const double m_lh_GaAs = 0.082;
+const double m_lh_AlAs = 0.15;
+const double m_lh_InAs = 0.026;
+
+/**
+ * \brief Find the parameters for Ga(1-x)Al(x)As
+ */
+void set_gaalas(BandEdgeProfile &p,
+                const char       particle,
+                const arma::vec &x)
+{
+    const arma::vec dV = (1.247*x)*e; // Total band discontinuity
+
+    switch(particle)
+    {
+        case 'e':
+            p.V = 0.67*dV;
+
+            // Mass data: S. Adachi, `GaAs and related materials'
+            p.m      = (0.067+0.083*x)*me;
+            p.m_perp = (0.067+0.083*x)*me;
+            break;
+        case 'h':
+            p.V = 0.33*dV;
+
+            p.m      = (0.62+0.14*x)*me;
+            p.m_perp = (0.62+0.14*x)*me;
+            break;
+        case 'l':
+            throw std::runtime_error("Data not defined for Ga(1-x)Al(x)As light-hole");
+    }
+
+    p.Eg     = 1.426*e + dV;
+    p.eps_dc = ((1.0-x)*eps_dc_GaAs + x*eps_dc_AlAs)*eps0;
+}
+
+/**
+ * \brief Find the parameters for Cd(1-x)Mn(x)Te
+ */
+void set_cdmnte(BandEdgeProfile &p,
+                const char       particle,
+                const arma::vec &x)
+{
+    const arma::vec dV = (1.587*x)*e;
+
+    switch(particle)
+    {
+        case 'e':
+            p.V = 0.70*dV;
+
+            // Mass data: Long, 23rd Phys. Semicond. p1819
+            p.m      = (0.11+0.067*x)*me;
+            p.m_perp = (0.11+0.067*x)*me;
+            break;
+        case 'h':
+            p.V = 0.30*dV;
+
+            p.m      = (0.60+0.21*x+0.15*x%x)*me;
+            p.m_perp = (0.60+0.21*x+0.15*x%x)*me;
+            break;
+        case 'l':
+            p.m      = (0.18+0.14*x)*me;
+            p.m_perp = (0.18+0.14*x)*me;
+            std::cerr << "Warning: Potential data not defined for Cd(1-x)Mn(x)Te light-hole" << std::endl;
+            break;
+    }
+
+    p.Eg     = 1.606*e + dV;
+    p.eps_dc = 10.2*eps0*arma::ones(x.size()); // Just use CdTe value - can't immediately find MnTe in literature (AV)
+}
+
+/**
+ * \brief Find the parameters for In(1-x-y)Al(x)Ga(y)As
+ *
+ * \details Data from Landolt & Bornstein, III/22a, p156
+ */
+void set_inalgaas(BandEdgeProfile &p,
+                  const char       particle,
+                  const arma::vec &x,
+                  const arma::vec &y)
+{
+    const arma::vec dV = (2.093*x + 0.629*y + 0.577*x%x + 0.436*y%y + 1.013*x%y
+                          + 2.0*x%x%(x+y-1))*e;
+
+    switch(particle)
+    {
+        // 53% gives an offset with AlAs of 1.2 eV---close to that
+        // of Hirayama which takes account of strain
+        case 'e':
+            p.V      = 0.53*dV;
+            p.m      = (0.0427+0.0685*x)*me;
+            p.m_perp = (0.0427+0.0685*x)*me;
+            break;
+        case 'h':
+            p.V = 0.47*dV;
+
+            // Linearly interpolate between InAs, AlAs and GaAs for now
+            // TODO: Find a more accurate interpolation
+            p.m = (m_hh_InAs*(1.0-x-y) + m_hh_GaAs*y + m_hh_AlAs*x)*me;
+            break;
+        case 'l':
+            std::cerr << "Warning: Potential data not defined for In(1-x-y)Al(x)Ga(y)As light-hole" << std::endl;
+
+            // Linearly interpolate between InAs, AlAs and GaAs for now
+            // TODO: Find a more accurate interpolation
+            p.m = (m_lh_InAs*(1.0-x-y) + m_lh_GaAs*y + m_lh_AlAs*x)*me;
+            break;
+    }
+
+    p.Eg = 0.36*e + dV;
+
+    // Linearly interpolate between InAs, AlAs and GaAs for now
+    // TODO: Find a more accurate interpolation
+    p.eps_dc = (eps_dc_InAs*(1.0-x-y) + eps_dc_GaAs*y + eps_dc_AlAs*x)*eps0;
+}
+} // namespace
+
+/**
+ * \brief Check whether band-edge parameters are defined for a material
+ *
+ * \param[in] material Material ID: "gaalas", "cdmnte" or "inalgaas"
+ */
+bool band_edge_material_known(const std::string &material)
+{
+    return material == "gaalas" || material == "cdmnte" || material == "inalgaas";
+}
+
+/**
+ * \brief Find the band-edge parameters at each point in a heterostructure
+ *
+ * \param[in] material Material ID: "gaalas" for Ga(1-x)Al(x)As, "cdmnte" for
+ *                     Cd(1-x)Mn(x)Te, or "inalgaas" for In(1-x-y)Al(x)Ga(y)As
+ * \param[in] particle Particle ID: 'e', 'h' or 'l'
+ * \param[in] x        First alloy fraction at each point
+ * \param[in] y        Second alloy fraction at each point (only used for "inalgaas")
+ *
+ * \returns The band-edge parameters.  Any parameter that is not defined for the
+ *          material and particle is zero.  The nonparabolicity parameter is
+ *          taken as the reciprocal of the bandgap.
+ */
+BandEdgeProfile get_band_edge_profile(const std::string &material,
+                                      const char         particle,
+                                      const arma::vec   &x,
+                                      const arma::vec   &y)
+{
+    if(particle != 'e' && particle != 'h' && particle != 'l')
+    {
+        std::ostringstream oss;
+        oss << "Unknown particle ID: " << particle << ".  Use 'e', 'h' or 'l'.";
+        throw std::runtime_error(oss.str());
+    }
+
+    const auto nz = x.size();
+
+    BandEdgeProfile p;
+    p.V      = arma::zeros(nz);
+    p.Eg     = arma::zeros(nz);
+    p.m      = arma::zeros(nz);
+    p.m_perp = arma::zeros(nz);
+    p.eps_dc = arma::zeros(nz);
+
+    if(material == "gaalas")
+        set_gaalas(p, particle, x);
+    else if(material == "cdmnte")
+        set_cdmnte(p, particle, x);
+    else if(material == "inalgaas")
+    {
+        if(y.size() != nz)
+            throw std::runtime_error("In(1-x-y)Al(x)Ga(y)As needs two alloy fractions at each point");
+
+        set_inalgaas(p, particle, x, y);
+    }
+    else
+        throw std::runtime_error("The only materials defined in the database are "
+                                 "Ga(1-x)Al(x)As, Cd(1-x)Mn(x)Te and In(1-x-y)Al(x)Ga(y)As");
+
+    p.alpha = 1.0/p.Eg;
+
+    return p;
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,37 @@
+/**
+ * \file   band-edge.h
+ * \brief  Band-edge parameters for a heterostructure, found from its alloy profile
+ * \author Paul Harrison  <p.harrison@shu.ac.uk>
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_BAND_EDGE_H
+#define QWWAD_BAND_EDGE_H
+
+#include <string>
+#include <armadillo>
+
+namespace QWWAD
+{
+/**
+ * \brief Band-edge parameters at each point in a heterostructure
+ */
+struct BandEdgeProfile
+{
+    arma::vec V;      ///< Band-edge potential [J]
+    arma::vec Eg;     ///< Bandgap [J]
+    arma::vec m;      ///< Effective mass [kg]
+    arma::vec m_perp; ///< Effective mass perpendicular to growth [kg]
+    arma::vec eps_dc; ///< Low-frequency permittivity [F/m]
+    arma::vec alpha;  ///< Nonparabolicity parameter [1/J]
+};
+
+bool band_edge_material_known(const std::string &material);
+
+BandEdgeProfile get_band_edge_profile(const std::string &material,
+                                      const char         particle,
+                                      const arma::vec   &x,
+                                      const arma::vec   &y = arma::vec());
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
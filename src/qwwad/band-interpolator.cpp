@@ -0,0 +1,404 @@
+/**
+ * \file   band-interpolator.cpp
+ * \brief  Fourier interpolation of band energies from a uniform grid of wave vectors
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "band-interpolator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <sstream>
+#include <stdexcept>
+
+#include "constants.h"
+#include "kpoint-grid.h"
+#include "parallel.h"
+#include "profiler.h"
+
+namespace QWWAD
+{
+using namespace constants;
+
+/// Primitive direct lattice vectors of an FCC crystal [A0]
+static const double a[3][3] = {{0.0, 0.5, 0.5},
+                               {0.5, 0.0, 0.5},
+                               {0.5, 0.5, 0.0}};
+
+/**
+ * \brief Find the discrete Fourier transform of a function on the grid, along one axis
+ *
+ * \param[in,out] f      Samples of the function, which are replaced by the transform
+ * \param[in]     n      Number of samples along each axis
+ * \param[in]     stride Distance between neighbouring samples along the axis
+ * \param[in]     w      Twiddle factors, \f$e^{-2\pi i p/n}\f$ for each p in [0,n)
+ */
+static void transform_axis(std::vector<std::complex<double>>       &f,
+                           const size_t                             n,
+                           const size_t                             stride,
+                           const std::vector<std::complex<double>> &w)
+{
+    std::vector<std::complex<double>> line(n);
+
+    for(size_t base = 0; base < f.size(); ++base)
+    {
+        // Only visit the first sample on each line
+        if((base/stride) % n != 0)
+            continue;
+
+        for(size_t m = 0; m < n; ++m)
+        {
+            line[m] = 0.0;
+
+            for(size_t j = 0; j < n; ++j)
+                line[m] += f[base + j*stride] * w[(j*m) % n];
+        }
+
+        for(size_t m = 0; m < n; ++m)
+            f[base + m*stride] = line[m];
+    }
+}
+
+/**
+ * \brief Find the roots of a monic polynomial whose roots are known to be real
+ *
+ * \param[in] c Coefficients \f$c_1 \ldots c_m\f$ of \f$x^m + c_1 x^{m-1} + \ldots + c_m\f$
+ *
+ * \returns The real parts of the roots, in ascending order
+ *
+ * \details The Durand-Kerner iteration is used, which finds all of the roots
+ *          together.  Small imaginary parts, which come from errors in the
+ *          interpolated coefficients near a degeneracy, are discarded.
+ */
+static arma::vec find_real_roots(const std::vector<double> &c)
+{
+    const size_t m = c.size();
+    arma::vec    x(m, arma::fill::zeros);
+
+    // Bound on the size of the roots
+    double r0 = 0.0;
+
+    for(unsigned int j = 0; j < m; ++j)
+        r0 = std::max(r0, std::pow(std::abs(c[j]), 1.0/(j+1)));
+
+    if(r0 == 0.0)
+        return x;
+
+    auto p = [&c, m](const std::complex<double> z) {
+        std::complex<double> result = 1.0;
+
+        for(unsigned int j = 0; j < m; ++j)
+            result = result*z + c[j];
+
+        return result;
+    };
+
+    std::vector<std::complex<double>> z(m);
+
+    for(unsigned int i = 0; i < m; ++i)
+        z[i] = r0*std::polar(1.0, 2*pi*i/m + 0.4);
+
+    for(unsigned int iter = 0; iter < 500; ++iter)
+    {
+        double dz_max = 0.0;
+
+        for(unsigned int i = 0; i < m; ++i)
+        {
+            std::complex<double> denom = 1.0;
+
+            for(unsigned int j = 0; j < m; ++j)
+            {
+                if(j != i)
+                    denom *= z[i] - z[j];
+            }
+
+            if(std::abs(denom) == 0.0)
+                denom = 1e-14*r0;
+
+            const std::complex<double> dz = p(z[i])/denom;
+            z[i]  -= dz;
+            dz_max = std::max(dz_max, std::abs(dz));
+        }
+
+        if(dz_max < 1e-14*r0)
+            break;
+    }
+
+    for(unsigned int i = 0; i < m; ++i)
+        x[i] = z[i].real();
+
+    return arma::sort(x);
+}
+
+/**
+ * \brief Find the Fourier coefficients of the bands
+ *
+ * \param[in] grid   The grid of wave vectors
+ * \param[in] E_full Energy of each band at every point in the grid, with one row
+ *                   for each point (e.g., from FCCKPointGrid::unfold)
+ * \param[in] E_tol  Neighbouring bands that come closer than this anywhere in
+ *                   the grid are interpolated as a group (in the units of the
+ *                   band energies)
+ */
+BandInterpolator::BandInterpolator(const FCCKPointGrid &grid,
+                                   const arma::mat     &E_full,
+                                   const double         E_tol) :
+    _nbands(E_full.n_cols),
+    _R(),
+    _C(),
+    _first(),
+    _size()
+{
+    const size_t n  = grid.get_n_divisions();
+    const size_t nk = n*n*n;
+
+    if(E_full.n_rows != nk)
+    {
+        std::ostringstream oss;
+        oss << "Got energies at " << E_full.n_rows << " wave vectors, but the grid has "
+            << nk << " points.";
+        throw std::length_error(oss.str());
+    }
+
+    if(_nbands == 0)
+        throw std::invalid_argument("No bands were given for interpolation.");
+
+    // Sort the energies at each wave vector
+    arma::mat E_sorted(nk, _nbands);
+
+    for(unsigned int ik = 0; ik < nk; ++ik)
+    {
+        std::vector<double> E_k(_nbands);
+
+        for(unsigned int ib = 0; ib < _nbands; ++ib)
+            E_k[ib] = E_full(ik, ib);
+
+        std::sort(E_k.begin(), E_k.end());
+
+        for(unsigned int ib = 0; ib < _nbands; ++ib)
+            E_sorted(ik, ib) = E_k[ib];
+    }
+
+    // Group together the bands that come close to each other
+    _first.push_back(0);
+    _size.push_back(1);
+
+    for(unsigned int ib = 0; ib+1 < _nbands; ++ib)
+    {
+        double gap_min = E_sorted(0, ib+1) - E_sorted(0, ib);
+
+        for(unsigned int ik = 1; ik < nk; ++ik)
+            gap_min = std::min(gap_min, E_sorted(ik, ib+1) - E_sorted(ik, ib));
+
+        if(gap_min < E_tol)
+            ++_size.back();
+        else
+        {
+            _first.push_back(ib+1);
+            _size.push_back(1);
+        }
+    }
+
+    // Find the functions to interpolate for each group: the mean energy, followed
+    // by the coefficients of the polynomial whose roots are the energies relative
+    // to the mean.  The first coefficient is zero, so it is not stored.
+    arma::mat F(nk, _nbands);
+
+    for(unsigned int ik = 0; ik < nk; ++ik)
+    {
+        for(unsigned int igroup = 0; igroup < _first.size(); ++igroup)
+        {
+            const size_t b0 = _first[igroup];
+            const size_t m  = _size[igroup];
+
+            double mean = 0.0;
+
+            for(unsigned int ib = b0; ib < b0+m; ++ib)
+                mean += E_sorted(ik, ib);
+
+            mean /= m;
+
+            std::vector<double> coeff(m+1, 0.0);
+            coeff[0] = 1.0;
+
+            for(unsigned int ib = b0; ib < b0+m; ++ib)
+            {
+                const double root = E_sorted(ik, ib) - mean;
+
+                for(size_t j = m; j > 0; --j)
+                    coeff[j] -= root*coeff[j-1];
+            }
+
+            F(ik, b0) = mean;
+
+            for(unsigned int j = 2; j <= m; ++j)
+                F(ik, b0+j-1) = coeff[j];
+        }
+    }
+
+    // Transform every function onto the direct lattice
+    std::vector<std::complex<double>> w(n);
+
+    for(unsigned int p = 0; p < n; ++p)
+        w[p] = std::polar(1.0, -2*pi*p/n);
+
+    std::vector<std::vector<std::complex<double>>> c(_nbands);
+
+    for(unsigned int ich = 0; ich < _nbands; ++ich)
+    {
+        c[ich].resize(nk);
+
+        for(unsigned int ik = 0; ik < nk; ++ik)
+            c[ich][ik] = F(ik, ich)/static_cast<double>(nk);
+
+        transform_axis(c[ich], n, 1,   w);
+        transform_axis(c[ich], n, n,   w);
+        transform_axis(c[ich], n, n*n, w);
+    }
+
+    // Move each lattice vector into the Wigner-Seitz supercell, sharing its
+    // coefficient between any equivalent vectors on the boundary
+    const long nl = n;
+    auto centre = [nl](const long m) {return (2*m > nl) ? m - nl : m;};
+
+    std::vector<size_t> source; // Index of the coefficient for each lattice vector
+    std::vector<double> weight; // Share of the coefficient for each lattice vector
+
+    for(unsigned int im = 0; im < nk; ++im)
+    {
+        const long m[3] = {centre(im/(n*n)), centre((im/n) % n), centre(im % n)};
+
+        std::vector<std::array<double, 3>> images;
+        double                             Rsq_min = 0.0;
+
+        for(long s1 = -2; s1 <= 2; ++s1)
+        {
+            for(long s2 = -2; s2 <= 2; ++s2)
+            {
+                for(long s3 = -2; s3 <= 2; ++s3)
+                {
+                    const long m_image[3] = {m[0] + nl*s1, m[1] + nl*s2, m[2] + nl*s3};
+
+                    std::array<double, 3> R;
+                    double                Rsq = 0.0;
+
+                    for(unsigned int i = 0; i < 3; ++i)
+                    {
+                        R[i] = m_image[0]*a[0][i] + m_image[1]*a[1][i] + m_image[2]*a[2][i];
+                        Rsq += R[i]*R[i];
+                    }
+
+                    if(images.empty() || Rsq < Rsq_min - 1e-8)
+                    {
+                        images.assign(1, R);
+                        Rsq_min = Rsq;
+                    }
+                    else if(Rsq < Rsq_min + 1e-8)
+                        images.push_back(R);
+                }
+            }
+        }
+
+        for(const auto &R : images)
+        {
+            _R.push_back(R);
+            source.push_back(im);
+            weight.push_back(1.0/images.size());
+        }
+    }
+
+    _C.set_size(_R.size(), _nbands);
+
+    for(unsigned int iR = 0; iR < _R.size(); ++iR)
+    {
+        for(unsigned int ich = 0; ich < _nbands; ++ich)
+            _C(iR, ich) = weight[iR]*c[ich][source[iR]];
+    }
+}
+
+/**
+ * \brief Evaluate the interpolated functions at a wave vector
+ *
+ * \param[in] k Wave vector [2pi/A0]
+ */
+arma::vec BandInterpolator::get_functions(const arma::vec &k) const
+{
+    arma::vec f(_nbands, arma::fill::zeros);
+
+    for(unsigned int iR = 0; iR < _R.size(); ++iR)
+    {
+        const auto                &R     = _R[iR];
+        const double               kR    = k[0]*R[0] + k[1]*R[1] + k[2]*R[2];
+        const std::complex<double> phase = std::polar(1.0, 2*pi*kR);
+
+        for(unsigned int ich = 0; ich < _nbands; ++ich)
+            f[ich] += std::real(_C(iR, ich)*phase);
+    }
+
+    return f;
+}
+
+/**
+ * \brief Find the band energies at a wave vector
+ *
+ * \param[in] k Wave vector [2pi/A0]
+ *
+ * \returns The energy of each band, in ascending order
+ */
+arma::vec BandInterpolator::get_energies(const arma::vec &k) const
+{
+    const arma::vec f = get_functions(k);
+    arma::vec       E(_nbands);
+
+    for(unsigned int igroup = 0; igroup < _first.size(); ++igroup)
+    {
+        const size_t b0   = _first[igroup];
+        const size_t m    = _size[igroup];
+        const double mean = f[b0];
+
+        if(m == 1)
+        {
+            E[b0] = mean;
+            continue;
+        }
+
+        std::vector<double> coeff(m, 0.0);
+
+        for(unsigned int j = 2; j <= m; ++j)
+            coeff[j-1] = f[b0+j-1];
+
+        const arma::vec x = find_real_roots(coeff);
+
+        for(unsigned int ib = 0; ib < m; ++ib)
+            E[b0+ib] = mean + x[ib];
+    }
+
+    return E;
+}
+
+/**
+ * \brief Find the band energies at a set of wave vectors
+ *
+ * \param[in] k         Wave vectors [2pi/A0]
+ * \param[in] n_threads Number of threads to use (0 = one per CPU core)
+ *
+ * \returns The energy of each band, with one row for each wave vector
+ */
+arma::mat BandInterpolator::get_energies(const std::vector<arma::vec> &k,
+                                         const unsigned int            n_threads) const
+{
+    arma::mat E(k.size(), _nbands);
+
+    run_in_parallel(k.size(), n_threads, [&](const size_t ik) {
+        ScopedTraceEvent event("k-point");
+        const arma::vec E_k = get_energies(k[ik]);
+
+        for(unsigned int ib = 0; ib < _nbands; ++ib)
+            E(ik, ib) = E_k[ib];
+    });
+
+    return E;
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
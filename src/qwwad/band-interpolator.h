@@ -0,0 +1,69 @@
+/**
+ * \file   band-interpolator.h
+ * \brief  Fourier interpolation of band energies from a uniform grid of wave vectors
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_BAND_INTERPOLATOR_H
+#define QWWAD_BAND_INTERPOLATOR_H
+
+#include <array>
+#include <vector>
+#include <armadillo>
+
+namespace QWWAD
+{
+class FCCKPointGrid;
+
+/**
+ * \brief Interpolates band energies to any wave vector, from their values on a
+ *        uniform grid over the Brillouin zone of an FCC crystal
+ *
+ * \details Each band is written as a Fourier series over the direct lattice
+ *          vectors in the Wigner-Seitz supercell of the grid,
+ *          \f$E(\mathbf{k}) = \sum_R c_R e^{i\mathbf{k}\cdot\mathbf{R}}\f$,
+ *          which passes exactly through the energy at every point in the grid.
+ *          Where a lattice vector lies on the boundary of the supercell, its
+ *          coefficient is shared equally between the equivalent vectors, so that
+ *          the interpolant keeps the symmetry of the crystal.
+ *
+ *          The energies at each wave vector are sorted into ascending order, so
+ *          two bands that cross have a kink at the crossing, and the
+ *          Fourier series of each would converge slowly.  Neighbouring bands
+ *          that come within a tolerance of each other anywhere in the grid are
+ *          therefore treated as a group.  Instead of the energies themselves,
+ *          the mean energy of the group and the coefficients of the polynomial
+ *          \f$\prod_i (E - E_i)\f$ are interpolated.  These do not depend on the
+ *          order of the bands, and so are smooth through a crossing.  The
+ *          energies are then found as the roots of the interpolated polynomial.
+ */
+class BandInterpolator
+{
+private:
+    size_t                             _nbands; ///< Number of bands
+    std::vector<std::array<double, 3>> _R;      ///< Direct lattice vectors in the series [A0]
+    arma::cx_mat                       _C;      ///< Coefficient of each lattice vector, for each function
+    std::vector<size_t>                _first;  ///< Index of the first band in each group
+    std::vector<size_t>                _size;   ///< Number of bands in each group
+
+    arma::vec get_functions(const arma::vec &k) const;
+
+public:
+    BandInterpolator(const FCCKPointGrid &grid,
+                     const arma::mat     &E_full,
+                     const double         E_tol);
+
+    /// Return the number of bands
+    inline size_t get_n_bands() const {return _nbands;}
+
+    /// Return the number of lattice vectors in the Fourier series
+    inline size_t get_n_lattice_vectors() const {return _R.size();}
+
+    arma::vec get_energies(const arma::vec &k) const;
+
+    arma::mat get_energies(const std::vector<arma::vec> &k,
+                           const unsigned int            n_threads = 0) const;
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
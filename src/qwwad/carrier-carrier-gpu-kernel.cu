@@ -0,0 +1,218 @@
+/**
+ * \file   carrier-carrier-gpu-kernel.cu
+ * \brief  CUDA kernel for the carrier-carrier scattering integrals
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ *
+ * \details This is only compiled in builds with CUDA support.  The host code in
+ *          carrier-carrier-gpu.cpp calls launch_carrier_carrier_kernel.
+ */
+
+#include <string>
+#include <cuda_runtime.h>
+
+/**
+ * \brief Evaluate a natural cubic spline
+ *
+ * \param[in] q  Knots, in ascending order
+ * \param[in] y  Value at each knot
+ * \param[in] d2 Second derivative at each knot
+ * \param[in] n  Number of knots
+ * \param[in] x  Position at which to evaluate the spline
+ *
+ * \details Positions outside the knots are clamped to the nearest end, since the
+ *          table of form factors covers every scattering vector that is needed.
+ */
+__device__ static double eval_spline(const double *q,
+                                     const double *y,
+                                     const double *d2,
+                                     const int     n,
+                                     const double  x)
+{
+    if(x <= q[0])
+        return y[0];
+
+    if(x >= q[n-1])
+        return y[n-1];
+
+    // Find the interval by bisection
+    int lo = 0;
+    int hi = n-1;
+
+    while(hi - lo > 1)
+    {
+        const int mid = (lo + hi)/2;
+
+        if(q[mid] > x)
+            hi = mid;
+        else
+            lo = mid;
+    }
+
+    const double h = q[hi] - q[lo];
+    const double a = (q[hi] - x)/h;
+    const double b = (x - q[lo])/h;
+
+    return a*y[lo] + b*y[hi] + ((a*a*a - a)*d2[lo] + (b*b*b - b)*d2[hi])*h*h/6.0;
+}
+
+/**
+ * \brief Find the integrand over |kj| for one (ki, kj) pair in each thread
+ */
+__global__ static void carrier_carrier_kernel(const double *q,
+                                              const double *FF,
+                                              const double *FF_d2,
+                                              const int     nq,
+                                              const double  Deltak0sqr,
+                                              const double *ki,
+                                              const int     nki,
+                                              const double *kj,
+                                              const double *P,
+                                              const int     nkj,
+                                              const double *cos_alpha,
+                                              const double *w_alpha,
+                                              const int     nalpha,
+                                              const double *cos_theta,
+                                              const double *w_theta,
+                                              const int     ntheta,
+                                              double       *result)
+{
+    const int item = blockIdx.x*blockDim.x + threadIdx.x;
+
+    if(item >= nki*nkj)
+        return;
+
+    // The result is stored with one column for each ki
+    const int    iki  = item / nkj;
+    const int    ikj  = item % nkj;
+    const double ki_  = ki[iki];
+    const double kj_  = kj[ikj];
+
+    double integral_alpha = 0.0;
+
+    for(int ialpha = 0; ialpha < nalpha; ++ialpha)
+    {
+        // Compute (vector)kj-(vector)(ki) [QWWAD3, 10.221]
+        const double kij_sqr = ki_*ki_ + kj_*kj_ - 2*ki_*kj_*cos_alpha[ialpha];
+        const double kfg_sqr = kij_sqr + Deltak0sqr;
+        const double kij_sqr_plus_kfg_sqr = kij_sqr + kfg_sqr;
+        const double two_kij_kfg = 2*sqrt(kij_sqr)*sqrt(kfg_sqr);
+
+        double integral_theta = 0.0;
+
+        for(int itheta = 0; itheta < ntheta; ++itheta)
+        {
+            // Argument of sqrt function=4*q_perp*q_perp [QWWAD3, 10.231]
+            const double q_perpsqr4 = kij_sqr_plus_kfg_sqr - two_kij_kfg*cos_theta[itheta];
+
+            if(q_perpsqr4 >= 0)
+                integral_theta += w_theta[itheta] * eval_spline(q, FF, FF_d2, nq, sqrt(q_perpsqr4)/2);
+        }
+
+        integral_alpha += w_alpha[ialpha] * integral_theta;
+    }
+
+    result[item] = integral_alpha * P[ikj] * kj_;
+}
+
+/**
+ * \brief A block of GPU memory, which is released when it goes out of scope
+ */
+class DeviceArray
+{
+private:
+    double     *_ptr;   ///< Start of the block
+    cudaError_t _error; ///< Result of the allocation or copy
+
+public:
+    DeviceArray(const double *host,
+                const size_t  n) :
+        _ptr(nullptr),
+        _error(cudaMalloc(reinterpret_cast<void **>(&_ptr), n*sizeof(double)))
+    {
+        if(_error == cudaSuccess && host)
+            _error = cudaMemcpy(_ptr, host, n*sizeof(double), cudaMemcpyHostToDevice);
+    }
+
+    ~DeviceArray() {cudaFree(_ptr);}
+
+    DeviceArray(const DeviceArray &) = delete;
+    DeviceArray & operator=(const DeviceArray &) = delete;
+
+    double      * get()   const {return _ptr;}
+    cudaError_t   error() const {return _error;}
+};
+
+/**
+ * \brief Check whether a CUDA device is present
+ */
+bool cuda_device_present()
+{
+    int n_devices = 0;
+    return cudaGetDeviceCount(&n_devices) == cudaSuccess && n_devices > 0;
+}
+
+/**
+ * \brief Evaluate the form-factor integrals for every (ki, kj) pair on the GPU
+ *
+ * \returns An empty string on success, or a description of the error
+ */
+std::string launch_carrier_carrier_kernel(const double *q,
+                                          const double *FF,
+                                          const double *FF_d2,
+                                          const int     nq,
+                                          const double  Deltak0sqr,
+                                          const double *ki,
+                                          const int     nki,
+                                          const double *kj,
+                                          const double *P,
+                                          const int     nkj,
+                                          const double *cos_alpha,
+                                          const double *w_alpha,
+                                          const int     nalpha,
+                                          const double *cos_theta,
+                                          const double *w_theta,
+                                          const int     ntheta,
+                                          double       *result)
+{
+    const int n_items = nki*nkj;
+
+    DeviceArray d_q(q, nq);
+    DeviceArray d_FF(FF, nq);
+    DeviceArray d_FF_d2(FF_d2, nq);
+    DeviceArray d_ki(ki, nki);
+    DeviceArray d_kj(kj, nkj);
+    DeviceArray d_P(P, nkj);
+    DeviceArray d_cos_alpha(cos_alpha, nalpha);
+    DeviceArray d_w_alpha(w_alpha, nalpha);
+    DeviceArray d_cos_theta(cos_theta, ntheta);
+    DeviceArray d_w_theta(w_theta, ntheta);
+    DeviceArray d_result(nullptr, n_items);
+
+    for(const DeviceArray *array : {&d_q, &d_FF, &d_FF_d2, &d_ki, &d_kj, &d_P, &d_cos_alpha,
+                                    &d_w_alpha, &d_cos_theta, &d_w_theta, &d_result})
+    {
+        if(array->error() != cudaSuccess)
+            return cudaGetErrorString(array->error());
+    }
+
+    const int block_size = 128;
+    const int n_blocks   = (n_items + block_size - 1)/block_size;
+
+    carrier_carrier_kernel<<<n_blocks, block_size>>>(d_q.get(), d_FF.get(), d_FF_d2.get(), nq,
+                                                     Deltak0sqr,
+                                                     d_ki.get(), nki, d_kj.get(), d_P.get(), nkj,
+                                                     d_cos_alpha.get(), d_w_alpha.get(), nalpha,
+                                                     d_cos_theta.get(), d_w_theta.get(), ntheta,
+                                                     d_result.get());
+
+    cudaError_t status = cudaGetLastError();
+
+    if(status == cudaSuccess)
+        status = cudaMemcpy(result, d_result.get(), n_items*sizeof(double), cudaMemcpyDeviceToHost);
+
+    if(status != cudaSuccess)
+        return cudaGetErrorString(status);
+
+    return std::string();
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,177 @@
+/**
+ * \file   carrier-carrier-gpu.cpp
+ * \brief  Carrier-carrier scattering integrals on a GPU, for builds with CUDA support
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "carrier-carrier-gpu.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "profiler.h"
+
+#if HAVE_CUDA
+/**
+ * \brief Evaluate the form-factor integrals for every (ki, kj) pair on the GPU
+ *
+ * \details This is defined in carrier-carrier-gpu-kernel.cu.  It returns an empty
+ *          string on success, or a description of the error.
+ */
+std::string launch_carrier_carrier_kernel(const double *q,
+                                          const double *FF,
+                                          const double *FF_d2,
+                                          const int     nq,
+                                          const double  Deltak0sqr,
+                                          const double *ki,
+                                          const int     nki,
+                                          const double *kj,
+                                          const double *P,
+                                          const int     nkj,
+                                          const double *cos_alpha,
+                                          const double *w_alpha,
+                                          const int     nalpha,
+                                          const double *cos_theta,
+                                          const double *w_theta,
+                                          const int     ntheta,
+                                          double       *result);
+
+bool cuda_device_present();
+#endif
+
+namespace QWWAD
+{
+/**
+ * \brief Check whether the carrier-carrier integrals can be found on a GPU
+ *
+ * \returns True if QWWAD was built with CUDA support and a GPU is present
+ */
+bool carrier_carrier_gpu_available()
+{
+#if HAVE_CUDA
+    static const bool available = cuda_device_present();
+    return available;
+#else
+    return false;
+#endif
+}
+
+/**
+ * \brief Find the second derivative of a natural cubic spline at each knot
+ *
+ * \param[in] x Knots
+ * \param[in] y Value at each knot
+ *
+ * \details These are the same coefficients as a GSL cspline, so the spline can
+ *          be evaluated on the GPU without GSL.
+ */
+static std::vector<double> get_spline_second_derivatives(const std::vector<double> &x,
+                                                         const std::vector<double> &y)
+{
+    const size_t n = x.size();
+    std::vector<double> d2(n, 0.0);
+
+    if(n < 3)
+        return d2;
+
+    // Solve the tridiagonal system for the interior knots, using the Thomas
+    // algorithm.  The second derivative is zero at each end.
+    std::vector<double> c(n, 0.0); // Modified superdiagonal
+    std::vector<double> r(n, 0.0); // Modified right-hand side
+
+    for(size_t i = 1; i < n-1; ++i)
+    {
+        const double h_lo = x[i]   - x[i-1];
+        const double h_hi = x[i+1] - x[i];
+        const double rhs  = 6*((y[i+1] - y[i])/h_hi - (y[i] - y[i-1])/h_lo);
+        const double diag = 2*(h_lo + h_hi) - h_lo*c[i-1];
+
+        c[i] = h_hi/diag;
+        r[i] = (rhs - h_lo*r[i-1])/diag;
+    }
+
+    for(size_t i = n-2; i > 0; --i)
+        d2[i] = r[i] - c[i]*d2[i+1];
+
+    return d2;
+}
+
+/**
+ * \brief Find the integrand over |kj| for each pair of initial wave vectors, on the GPU
+ *
+ * \param[in] FF         Form factor as a function of in-plane scattering vector
+ * \param[in] Deltak0sqr Twice the change in kinetic energy, in wave-vector units [1/m^2]
+ * \param[in] ki         Magnitude of each initial wave vector in the first subband [1/m]
+ * \param[in] kj         Magnitude of each initial wave vector in the second subband [1/m]
+ * \param[in] P          Occupation of the second subband at each kj
+ * \param[in] cos_alpha  Cosine of each angle between ki and kj
+ * \param[in] w_alpha    Quadrature weight for each alpha
+ * \param[in] cos_theta  Cosine of each angle between kij and kfg
+ * \param[in] w_theta    Quadrature weight for each theta
+ *
+ * \returns The integrand, with one row for each kj and one column for each ki.
+ *          This is the same as the CPU calculation in qwwad_sr_carrier_carrier,
+ *          apart from the order of rounding.
+ *
+ * \details The (alpha, theta) integral for each (ki, kj) pair runs in its own
+ *          GPU thread.  The form factor is uploaded as the knots and second
+ *          derivatives of the cubic spline, so the table lookup is the same as
+ *          on the CPU.
+ */
+arma::mat
+integrate_carrier_carrier_gpu(const gsl_spline *FF,
+                              const double      Deltak0sqr,
+                              const arma::vec  &ki,
+                              const arma::vec  &kj,
+                              const arma::vec  &P,
+                              const arma::vec  &cos_alpha,
+                              const arma::vec  &w_alpha,
+                              const arma::vec  &cos_theta,
+                              const arma::vec  &w_theta)
+{
+    if(P.size() != kj.size() || w_alpha.size() != cos_alpha.size()
+       || w_theta.size() != cos_theta.size())
+        throw std::length_error("Mismatched sizes of quadrature arrays for carrier-carrier integrals.");
+
+#if HAVE_CUDA
+    const std::vector<double> q(FF->x, FF->x + FF->size);
+    const std::vector<double> y(FF->y, FF->y + FF->size);
+    const std::vector<double> d2 = get_spline_second_derivatives(q, y);
+
+    arma::mat result(kj.size(), ki.size());
+
+    QWWAD_COUNT  ("GPU carrier-carrier integrals");
+    QWWAD_COUNT_N("GPU carrier-carrier integrand samples",
+                  ki.size()*kj.size()*cos_alpha.size()*cos_theta.size());
+
+    const auto error = launch_carrier_carrier_kernel(q.data(), y.data(), d2.data(), q.size(),
+                                                     Deltak0sqr,
+                                                     ki.memptr(), ki.size(),
+                                                     kj.memptr(), P.memptr(), kj.size(),
+                                                     cos_alpha.memptr(), w_alpha.memptr(),
+                                                     cos_alpha.size(),
+                                                     cos_theta.memptr(), w_theta.memptr(),
+                                                     cos_theta.size(),
+                                                     result.memptr());
+
+    if(!error.empty())
+    {
+        std::ostringstream oss;
+        oss << "Could not find carrier-carrier integrals on the GPU: " << error;
+        throw std::runtime_error(oss.str());
+    }
+
+    return result;
+#else
+    (void)FF;
+    (void)Deltak0sqr;
+    throw std::runtime_error("QWWAD was built without CUDA support.");
+#endif
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
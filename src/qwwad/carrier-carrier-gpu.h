@@ -0,0 +1,29 @@
+/**
+ * \file   carrier-carrier-gpu.h
+ * \brief  Carrier-carrier scattering integrals on a GPU, for builds with CUDA support
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_CARRIER_CARRIER_GPU_H
+#define QWWAD_CARRIER_CARRIER_GPU_H
+
+#include <armadillo>
+#include <gsl/gsl_spline.h>
+
+namespace QWWAD
+{
+bool carrier_carrier_gpu_available();
+
+arma::mat
+integrate_carrier_carrier_gpu(const gsl_spline *FF,
+                              const double      Deltak0sqr,
+                              const arma::vec  &ki,
+                              const arma::vec  &kj,
+                              const arma::vec  &P,
+                              const arma::vec  &cos_alpha,
+                              const arma::vec  &w_alpha,
+                              const arma::vec  &cos_theta,
+                              const arma::vec  &w_theta);
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
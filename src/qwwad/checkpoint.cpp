@@ -0,0 +1,182 @@
+/**
+ * \file   checkpoint.cpp
+ * \brief  Helpers for compact binary checkpoint files
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "checkpoint.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace QWWAD
+{
+/**
+ * \brief Append a table of values to a buffer in binary form
+ *
+ * \details The table is stored as a 64-bit length, followed by its entries as
+ *          doubles.
+ */
+void append_checkpoint_table(std::string  &buffer,
+                             const double *data,
+                             const size_t  n)
+{
+    append_checkpoint_value<uint64_t>(buffer, n);
+    buffer.append(reinterpret_cast<const char *>(data), n*sizeof(double));
+}
+
+/**
+ * \brief Append a string to a buffer in binary form
+ *
+ * \details The string is stored as a 64-bit length, followed by its characters.
+ */
+void append_checkpoint_string(std::string       &buffer,
+                              const std::string &str)
+{
+    append_checkpoint_value<uint64_t>(buffer, str.size());
+    buffer.append(str);
+}
+
+/**
+ * \brief Read a block of items from a binary stream into a container
+ *
+ * \details The container is only extended a block at a time, so a corrupt length
+ *          cannot cause a huge allocation.  If the stream ends first, its fail
+ *          flag is set and the container is emptied.
+ */
+template <typename Tcontainer>
+static void read_checkpoint_items(std::istream   &stream,
+                                  const uint64_t  n,
+                                  Tcontainer     &dest)
+{
+    typedef typename Tcontainer::value_type T;
+    const uint64_t n_block = (1 << 20)/sizeof(T);
+
+    while(dest.size() < n)
+    {
+        const size_t n_old  = dest.size();
+        const size_t n_read = std::min<uint64_t>(n_block, n - n_old);
+        dest.resize(n_old + n_read);
+
+        if(!stream.read(reinterpret_cast<char *>(&dest[n_old]), n_read*sizeof(T)))
+        {
+            dest.clear();
+            return;
+        }
+    }
+}
+
+/**
+ * \brief Read a table of values from a binary stream
+ */
+std::vector<double> read_checkpoint_table(std::istream &stream)
+{
+    const auto n = read_checkpoint_value<uint64_t>(stream);
+
+    std::vector<double> data;
+
+    if(stream)
+        read_checkpoint_items(stream, n, data);
+
+    return data;
+}
+
+/**
+ * \brief Read a string from a binary stream
+ */
+std::string read_checkpoint_string(std::istream &stream)
+{
+    const auto n = read_checkpoint_value<uint64_t>(stream);
+
+    std::string str;
+
+    if(stream)
+        read_checkpoint_items(stream, n, str);
+
+    return str;
+}
+
+/**
+ * \brief Start a new checkpoint buffer
+ *
+ * \param[in] magic   8-byte identifier for the type of checkpoint
+ * \param[in] version Format version
+ *
+ * \returns A buffer that holds the identifier and version
+ */
+std::string start_checkpoint(const char     magic[8],
+                             const uint32_t version)
+{
+    std::string buffer(magic, 8);
+    append_checkpoint_value(buffer, version);
+    return buffer;
+}
+
+/**
+ * \brief Check the identifier and version at the start of a checkpoint file
+ *
+ * \param[in,out] stream      The open file, which is moved past the header
+ * \param[in]     filename    Name of the file, used in error messages
+ * \param[in]     magic       8-byte identifier for the type of checkpoint
+ * \param[in]     version     Format version
+ * \param[in]     description Name of the type of checkpoint, used in error messages
+ */
+void check_checkpoint_header(std::istream      &stream,
+                             const std::string &filename,
+                             const char         magic[8],
+                             const uint32_t     version,
+                             const std::string &description)
+{
+    if(!stream)
+    {
+        std::ostringstream oss;
+        oss << "Could not open checkpoint file " << filename;
+        throw std::runtime_error(oss.str());
+    }
+
+    char magic_file[8];
+    stream.read(magic_file, sizeof(magic_file));
+    const auto version_file = read_checkpoint_value<uint32_t>(stream);
+
+    if(!stream or !std::equal(magic_file, magic_file + sizeof(magic_file), magic)
+       or version_file != version)
+    {
+        std::ostringstream oss;
+        oss << filename << " is not " << description << " checkpoint file (version " << version << ")";
+        throw std::runtime_error(oss.str());
+    }
+}
+
+/**
+ * \brief Write a checkpoint buffer to a file, via a temporary file
+ *
+ * \param[in] filename Name of the checkpoint file
+ * \param[in] buffer   Contents of the checkpoint
+ *
+ * \returns True if the file was written
+ *
+ * \details The data are written to a temporary file, which is then renamed, so
+ *          the file always holds a complete checkpoint even if the job is killed
+ *          while it is being written.
+ */
+bool write_checkpoint_file(const std::string &filename,
+                           const std::string &buffer)
+{
+    const std::string fname_tmp = filename + ".tmp";
+    std::ofstream stream(fname_tmp.c_str(), std::ios::binary);
+    stream.write(buffer.data(), buffer.size());
+    stream.close();
+
+    if(!stream or std::rename(fname_tmp.c_str(), filename.c_str()) != 0)
+    {
+        std::remove(fname_tmp.c_str());
+        return false;
+    }
+
+    return true;
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,65 @@
+/**
+ * \file   checkpoint.h
+ * \brief  Helpers for compact binary checkpoint files
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_CHECKPOINT_H
+#define QWWAD_CHECKPOINT_H
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace QWWAD
+{
+/**
+ * \brief Append a scalar value to a buffer in binary form
+ *
+ * \details Values are stored in the native byte order, so a checkpoint can only
+ *          be read on the same kind of machine that wrote it.
+ */
+template <typename T>
+void append_checkpoint_value(std::string &buffer,
+                             const T      value)
+{
+    buffer.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+/**
+ * \brief Read a scalar value from a binary stream
+ */
+template <typename T>
+T read_checkpoint_value(std::istream &stream)
+{
+    T value = T();
+    stream.read(reinterpret_cast<char *>(&value), sizeof(value));
+    return value;
+}
+
+void append_checkpoint_table(std::string  &buffer,
+                             const double *data,
+                             const size_t  n);
+
+void append_checkpoint_string(std::string       &buffer,
+                              const std::string &str);
+
+std::vector<double> read_checkpoint_table(std::istream &stream);
+
+std::string read_checkpoint_string(std::istream &stream);
+
+std::string start_checkpoint(const char     magic[8],
+                             const uint32_t version);
+
+void check_checkpoint_header(std::istream      &stream,
+                             const std::string &filename,
+                             const char         magic[8],
+                             const uint32_t     version,
+                             const std::string &description);
+
+bool write_checkpoint_file(const std::string &filename,
+                           const std::string &buffer);
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
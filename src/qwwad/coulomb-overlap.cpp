@@ -0,0 +1,66 @@
+/**
+ * \file   coulomb-overlap.cpp
+ * \brief  Overlap integrals for screened Coulomb interactions in a 2D system
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "coulomb-overlap.h"
+#include <cmath>
+
+namespace QWWAD
+{
+/**
+ * \brief Find the overlap integral between a pair of states and a Coulomb potential
+ *
+ * \param[in]  psi_if ψ_i(z) ψ_f(z)
+ * \param[in]  q      Scattering vector [1/m]
+ * \param[in]  dz     Spatial step [m]
+ * \param[out] Iif    I_if(q,z') at each position.  This is resized if needed, so the
+ *                    same array can be reused for every wave-vector.
+ *
+ * \details The matrix element is defined as
+ *           I_if(q,z') = ∫dz ψ_i(z) ψ_f(z) exp(-q|z-z'|),
+ *          where z is the carrier location.  The numerical solution can be
+ *          speeded up by replacing the modulus function with the sum of two
+ *          integrals, so that
+ *           I_if(q,z') = C_if⁻(q,z') + C_if⁺(q,z'),
+ *          where
+ *           C_if⁻(q,z') = ∫_{-∞}^{z'} dz ψ_i(z) ψ_f(z) exp(-q(z'-z))
+ *           C_if⁺(q,z') = ∫_{z'}^∞ dz ψ_i(z) ψ_f(z) exp(-q(z-z')).
+ *          Note that the upper limit of C_if⁻ is the point just BEFORE each z'
+ *          so that we don't double count.
+ *
+ *          On a uniform mesh, moving z' by one point multiplies every term in each
+ *          sum by exp(-q dz), so both sums are found by a recurrence that needs only
+ *          one exponential per wave-vector.  Every factor is at most one, so the
+ *          sums can't overflow, however large q|z| becomes.  The two recurrences
+ *          are independent, so they are run together in a single pass, with C_if⁺
+ *          running backward from the end of the array.
+ */
+void find_Iif(const arma::vec &psi_if,
+              const double     q,
+              const double     dz,
+              arma::vec       &Iif)
+{
+    const size_t nz    = psi_if.size();
+    const double decay = exp(-q*dz); // Decay of the potential over one spatial step
+
+    Iif.zeros(nz);
+
+    double Cif_minus = 0;
+    double Cif_plus  = 0;
+
+    for(size_t iz = 0; iz < nz; iz++)
+    {
+        // Backward sum, including the point itself
+        const size_t iz_back = nz - 1 - iz;
+        Cif_plus      = psi_if[iz_back]*dz + decay*Cif_plus;
+        Iif[iz_back] += Cif_plus;
+
+        // Forward sum, over the points before this one
+        Iif[iz]  += Cif_minus;
+        Cif_minus = decay*(Cif_minus + psi_if[iz]*dz);
+    }
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
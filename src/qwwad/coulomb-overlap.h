@@ -0,0 +1,20 @@
+/**
+ * \file   coulomb-overlap.h
+ * \brief  Overlap integrals for screened Coulomb interactions in a 2D system
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_COULOMB_OVERLAP_H
+#define QWWAD_COULOMB_OVERLAP_H
+
+#include <armadillo>
+
+namespace QWWAD
+{
+void find_Iif(const arma::vec &psi_if,
+              const double     q,
+              const double     dz,
+              arma::vec       &Iif);
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,34 @@
+/**
+ * \file   cpu-features.cpp
+ * \brief  Selection of vector kernels for the processor at run time
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "cpu-features.h"
+
+namespace QWWAD
+{
+/**
+ * \brief Find the vector extension used by the multiversioned kernels
+ *
+ * \returns The name of the extension, or "default" if the baseline kernels are used
+ *
+ * \details This follows the same order of preference as QWWAD_MULTIVERSION, so it
+ *          shows which kernels have been selected on this machine.
+ */
+std::string get_vector_extension()
+{
+#if HAVE_TARGET_CLONES
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx512f"))
+        return "avx512f";
+
+    if(__builtin_cpu_supports("avx2"))
+        return "avx2";
+#endif
+
+    return "default";
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,33 @@
+/**
+ * \file   cpu-features.h
+ * \brief  Selection of vector kernels for the processor at run time
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ *
+ * \details Distribution packages are built for the baseline instruction set, so
+ *          that they run on any machine.  Kernels marked with QWWAD_MULTIVERSION
+ *          are compiled several times, for the baseline and for newer vector
+ *          extensions, and the dynamic loader picks the best version for the
+ *          processor when the library is loaded.
+ */
+
+#ifndef QWWAD_CPU_FEATURES_H
+#define QWWAD_CPU_FEATURES_H
+
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string>
+
+#if HAVE_TARGET_CLONES
+# define QWWAD_MULTIVERSION __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+# define QWWAD_MULTIVERSION
+#endif
+
+namespace QWWAD
+{
+std::string get_vector_extension();
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,307 @@
+/**
+ * \file   crank-nicolson-propagator.cpp
+ * \brief  Time-dependent Schroedinger equation solver using the Crank-Nicolson method
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "crank-nicolson-propagator.h"
+
+#include <cmath>
+#include <complex>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "constants.h"
+#include "schroedinger-solver-tridiagonal.h"
+
+namespace QWWAD
+{
+using namespace constants;
+
+/**
+ * \brief Set up the propagator for a structure
+ *
+ * \param[in] z                 Spatial location of each sample [m]
+ * \param[in] V                 Potential at each sample [J]
+ * \param[in] m                 Effective mass at each sample [kg]
+ * \param[in] dt                Time step [s]
+ * \param[in] absorber_width    Width of the absorbing region at each end [m]
+ * \param[in] absorber_strength Largest value of the absorbing potential, which is
+ *                              reached at each end of the structure [J]
+ *
+ * \details The absorbing potential rises quadratically from zero at the inner
+ *          edge of each absorbing region.  A smooth rise keeps the reflection
+ *          from the absorber itself small.
+ */
+CrankNicolsonPropagator::CrankNicolsonPropagator(const arma::vec &z,
+                                                 const arma::vec &V,
+                                                 const arma::vec &m,
+                                                 const double     dt,
+                                                 const double     absorber_width,
+                                                 const double     absorber_strength) :
+    _z(z),
+    _h(),
+    _W(arma::zeros(z.size())),
+    _dt(dt),
+    _B_diag(z.size()),
+    _B_off(z.size() > 0 ? z.size()-1 : 0),
+    _A(),
+    _phi(arma::zeros<arma::cx_vec>(z.size())),
+    _work(z.size()),
+    _t(0.0),
+    _P_left(0.0),
+    _P_right(0.0),
+    _i_mid(z.size()/2)
+{
+    const size_t nz = z.size();
+
+    if(V.size() != nz || m.size() != nz || nz < 3)
+    {
+        std::ostringstream oss;
+        oss << "Cannot make a structure from " << nz << " positions, " << V.size()
+            << " potentials and " << m.size() << " masses.";
+        throw std::length_error(oss.str());
+    }
+
+    if(dt <= 0.0)
+        throw std::domain_error("The time step must be positive.");
+
+    if(absorber_width < 0.0 || 2*absorber_width > z[nz-1] - z[0])
+    {
+        std::ostringstream oss;
+        oss << "An absorbing region of width " << absorber_width << " m cannot fit at "
+            << "both ends of a structure of length " << z[nz-1] - z[0] << " m.";
+        throw std::domain_error(oss.str());
+    }
+
+    const SchroedingerSolverTridiag se(m, V, z);
+    const arma::vec &H_diag = se.get_diagonal();
+    const arma::vec &H_sub  = se.get_subdiagonal();
+    _h = se.get_cell_widths();
+
+    if(absorber_width > 0.0)
+    {
+        for(unsigned int iz = 0; iz < nz; ++iz)
+        {
+            const double d_left  = (z[0] + absorber_width) - z[iz];
+            const double d_right = z[iz] - (z[nz-1] - absorber_width);
+
+            if(d_left > 0.0)
+                _W[iz] = absorber_strength*(d_left/absorber_width)*(d_left/absorber_width);
+            else if(d_right > 0.0)
+                _W[iz] = absorber_strength*(d_right/absorber_width)*(d_right/absorber_width);
+        }
+    }
+
+    // Both halves of the propagator use the effective Hamiltonian H - iW
+    const double               alpha = dt/(2.0*hBar);
+    const std::complex<double> I(0.0, 1.0);
+    arma::cx_vec               A_diag(nz);
+    arma::cx_vec               A_off(nz-1);
+
+    for(unsigned int iz = 0; iz < nz; ++iz)
+    {
+        A_diag[iz]  = 1.0 + alpha*_W[iz] + I*alpha*H_diag[iz];
+        _B_diag[iz] = 1.0 - alpha*_W[iz] - I*alpha*H_diag[iz];
+    }
+
+    for(unsigned int iz = 0; iz+1 < nz; ++iz)
+    {
+        A_off[iz]  =  I*alpha*H_sub[iz];
+        _B_off[iz] = -I*alpha*H_sub[iz];
+    }
+
+    _A.factorise(A_off, A_diag, A_off);
+}
+
+/**
+ * \brief Set the wavefunction, and reset the clock
+ *
+ * \param[in] psi Wavefunction at each sample [1/sqrt(m)]
+ */
+void CrankNicolsonPropagator::set_wavefunction(const arma::cx_vec &psi)
+{
+    if(psi.size() != _z.size())
+    {
+        std::ostringstream oss;
+        oss << "Wavefunction has " << psi.size() << " samples, but the structure has "
+            << _z.size() << ".";
+        throw std::length_error(oss.str());
+    }
+
+    for(unsigned int iz = 0; iz < _z.size(); ++iz)
+        _phi[iz] = psi[iz]*sqrt(_h[iz]);
+
+    _t       = 0.0;
+    _P_left  = 0.0;
+    _P_right = 0.0;
+}
+
+/**
+ * \brief Set the wavefunction to a normalised Gaussian wavepacket, and reset the clock
+ *
+ * \param[in] z0    Centre of the wavepacket [m]
+ * \param[in] sigma Standard deviation of the probability density [m]
+ * \param[in] k0    Mean wave vector [1/m]
+ */
+void CrankNicolsonPropagator::set_gaussian_wavepacket(const double z0,
+                                                      const double sigma,
+                                                      const double k0)
+{
+    if(sigma <= 0.0)
+        throw std::domain_error("The width of a wavepacket must be positive.");
+
+    arma::cx_vec psi(_z.size());
+
+    for(unsigned int iz = 0; iz < _z.size(); ++iz)
+    {
+        const double dz = _z[iz] - z0;
+        psi[iz] = std::polar(exp(-dz*dz/(4.0*sigma*sigma)), k0*_z[iz]);
+    }
+
+    set_wavefunction(psi);
+
+    // Normalise on the mesh, rather than analytically, so that the wavepacket
+    // starts with unit probability even if it is truncated at the ends
+    _phi /= sqrt(get_norm());
+}
+
+/**
+ * \brief Find the rate at which probability is absorbed at each end of the structure
+ *
+ * \param[out] rate_left  Rate of absorption at the left-hand end [1/s]
+ * \param[out] rate_right Rate of absorption at the right-hand end [1/s]
+ */
+void CrankNicolsonPropagator::find_absorption_rates(double &rate_left,
+                                                    double &rate_right) const
+{
+    rate_left  = 0.0;
+    rate_right = 0.0;
+
+    for(unsigned int iz = 0; iz < _z.size(); ++iz)
+    {
+        const double rate = 2.0*_W[iz]*std::norm(_phi[iz])/hBar;
+
+        if(iz < _i_mid)
+            rate_left  += rate;
+        else
+            rate_right += rate;
+    }
+}
+
+/**
+ * \brief Propagate the wavefunction forward in time
+ *
+ * \param[in] n_steps Number of time steps to take
+ *
+ * \details The absorbed probability is found using the trapezium rule, from the
+ *          absorption rates at the start and end of each step.
+ */
+void CrankNicolsonPropagator::step(const size_t n_steps)
+{
+    const size_t nz = _z.size();
+    const bool   absorbing = _W.max() > 0.0;
+
+    double rate_left  = 0.0;
+    double rate_right = 0.0;
+
+    if(absorbing)
+        find_absorption_rates(rate_left, rate_right);
+
+    for(size_t istep = 0; istep < n_steps; ++istep)
+    {
+        // Apply the explicit half of the propagator
+        _work[0] = _B_diag[0]*_phi[0] + _B_off[0]*_phi[1];
+
+        for(size_t iz = 1; iz+1 < nz; ++iz)
+            _work[iz] = _B_off[iz-1]*_phi[iz-1] + _B_diag[iz]*_phi[iz] + _B_off[iz]*_phi[iz+1];
+
+        _work[nz-1] = _B_off[nz-2]*_phi[nz-2] + _B_diag[nz-1]*_phi[nz-1];
+
+        // ...then the implicit half
+        _A.solve_in_place(_work);
+        std::swap(_phi, _work);
+        _t += _dt;
+
+        if(absorbing)
+        {
+            const double rate_left_old  = rate_left;
+            const double rate_right_old = rate_right;
+            find_absorption_rates(rate_left, rate_right);
+
+            _P_left  += 0.5*_dt*(rate_left_old  + rate_left);
+            _P_right += 0.5*_dt*(rate_right_old + rate_right);
+        }
+    }
+}
+
+/**
+ * \brief Return the wavefunction at each sample [1/sqrt(m)]
+ */
+arma::cx_vec CrankNicolsonPropagator::get_wavefunction() const
+{
+    arma::cx_vec psi(_z.size());
+
+    for(unsigned int iz = 0; iz < _z.size(); ++iz)
+        psi[iz] = _phi[iz]/sqrt(_h[iz]);
+
+    return psi;
+}
+
+/**
+ * \brief Return the probability that is still inside the structure
+ */
+double CrankNicolsonPropagator::get_norm() const
+{
+    double P = 0.0;
+
+    for(unsigned int iz = 0; iz < _z.size(); ++iz)
+        P += std::norm(_phi[iz]);
+
+    return P;
+}
+
+/**
+ * \brief Return the expectation value of position, for the part of the wavefunction
+ *        that is still inside the structure [m]
+ */
+double CrankNicolsonPropagator::get_mean_position() const
+{
+    double P  = 0.0;
+    double Pz = 0.0;
+
+    for(unsigned int iz = 0; iz < _z.size(); ++iz)
+    {
+        const double P_iz = std::norm(_phi[iz]);
+        P  += P_iz;
+        Pz += P_iz*_z[iz];
+    }
+
+    return (P > 0.0) ? Pz/P : 0.0;
+}
+
+/**
+ * \brief Return the probability of finding the particle beyond a given position
+ *
+ * \param[in] z0 Position [m]
+ *
+ * \details This includes the probability that has already been absorbed at the
+ *          right-hand end of the structure, as long as z0 lies to the left of the
+ *          absorbing region.  With z0 placed beyond a barrier, this gives the
+ *          transmitted probability.
+ */
+double CrankNicolsonPropagator::get_probability_beyond(const double z0) const
+{
+    double P = _P_right;
+
+    for(unsigned int iz = 0; iz < _z.size(); ++iz)
+    {
+        if(_z[iz] > z0)
+            P += std::norm(_phi[iz]);
+    }
+
+    return P;
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
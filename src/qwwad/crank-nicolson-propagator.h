@@ -0,0 +1,91 @@
+/**
+ * \file   crank-nicolson-propagator.h
+ * \brief  Time-dependent Schroedinger equation solver using the Crank-Nicolson method
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_CRANK_NICOLSON_PROPAGATOR_H
+#define QWWAD_CRANK_NICOLSON_PROPAGATOR_H
+
+#include <armadillo>
+#include "linear-algebra.h"
+
+namespace QWWAD
+{
+/**
+ * \brief Propagates a wavefunction through time in a one-dimensional potential
+ *
+ * \details The Hamiltonian is the same finite-volume, tridiagonal matrix as that
+ *          used by SchroedingerSolverTridiag.  Each time step uses the Cayley form
+ *          of the propagator,
+ *          \f[
+ *            \left(1 + \frac{i\delta t}{2\hbar}H\right)\psi(t+\delta t) =
+ *            \left(1 - \frac{i\delta t}{2\hbar}H\right)\psi(t),
+ *          \f]
+ *          which is unitary and unconditionally stable.  The matrix on the left is
+ *          factorised once, so each step only costs a tridiagonal multiplication and
+ *          a pair of triangular solves.
+ *
+ *          An imaginary absorbing potential can be added at each end of the
+ *          structure, so that the parts of a wavepacket that leave the region of
+ *          interest are not reflected back.  The probability that is absorbed at
+ *          each end is recorded, so that the transmitted and reflected probabilities
+ *          can still be found once the wavepacket has left the structure.
+ */
+class CrankNicolsonPropagator
+{
+private:
+    arma::vec              _z;        ///< Spatial location of each sample [m]
+    arma::vec              _h;        ///< Width of the cell around each sample [m]
+    arma::vec              _W;        ///< Strength of absorbing potential at each sample [J]
+    double                 _dt;       ///< Time step [s]
+    arma::cx_vec           _B_diag;   ///< Diagonal of the explicit half of the propagator
+    arma::cx_vec           _B_off;    ///< Off-diagonal of the explicit half of the propagator
+    CxTridiagFactorisation _A;        ///< Factorised implicit half of the propagator
+    arma::cx_vec           _phi;      ///< Wavefunction, scaled by the square root of the cell width
+    arma::cx_vec           _work;     ///< Workspace for each time step
+    double                 _t;        ///< Time since the wavefunction was set [s]
+    double                 _P_left;   ///< Probability absorbed at the left-hand end
+    double                 _P_right;  ///< Probability absorbed at the right-hand end
+    size_t                 _i_mid;    ///< Index of the sample that divides the two absorbers
+
+    void find_absorption_rates(double &rate_left,
+                               double &rate_right) const;
+
+public:
+    CrankNicolsonPropagator(const arma::vec &z,
+                            const arma::vec &V,
+                            const arma::vec &m,
+                            const double     dt,
+                            const double     absorber_width    = 0.0,
+                            const double     absorber_strength = 0.0);
+
+    void set_wavefunction(const arma::cx_vec &psi);
+
+    void set_gaussian_wavepacket(const double z0,
+                                 const double sigma,
+                                 const double k0);
+
+    void step(const size_t n_steps = 1);
+
+    arma::cx_vec get_wavefunction() const;
+
+    double get_norm() const;
+    double get_mean_position() const;
+    double get_probability_beyond(const double z0) const;
+
+    /// Return the time since the wavefunction was set [s]
+    inline double get_time() const {return _t;}
+
+    /// Return the time step [s]
+    inline double get_time_step() const {return _dt;}
+
+    /// Return the probability that has been absorbed at the left-hand end
+    inline double get_absorbed_left() const {return _P_left;}
+
+    /// Return the probability that has been absorbed at the right-hand end
+    inline double get_absorbed_right() const {return _P_right;}
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -8,9 +8,11 @@
 
 #include "debye.h"
 
+#include <algorithm>
 #include <cmath>
 #include <sstream>
 #include <stdexcept>
+#include <vector>
 
 #include <gsl/gsl_deriv.h>
 #include <gsl/gsl_sf_debye.h>
@@ -121,6 +123,128 @@ double DebyeModel::get_cp_approx(const double T) const
     return cp;
 }
 
+/**
+ * \brief Get specific heat, using a precomputed table
+ *
+ * \param[in] T Temperature [K]
+ */
+double DebyeModel::get_cp_tabulated(const double T) const
+{
+    if(T <= 0)
+    {
+        std::ostringstream oss;
+        oss << "Cannot find specific heat capacity for T = " << T << " K." << std::endl;
+        throw std::runtime_error(oss.str());
+    }
+
+    return get_cp_high_T() * get_reduced_cp(T/_T_D);
+}
+
+/// Lowest value of T/T_D in the table of the Debye heat-capacity function
+static const double table_u_min = 0.02;
+
+/// Highest value of T/T_D in the table of the Debye heat-capacity function
+static const double table_u_max = 10.0;
+
+/// Number of points in the table of the Debye heat-capacity function
+static const size_t table_size = 2048;
+
+/**
+ * \brief Find the Debye heat-capacity function and its derivative exactly
+ *
+ * \param[in]  x    Ratio T_D/T
+ * \param[out] dcdx Derivative of the function with respect to x
+ *
+ * \return Heat capacity, relative to its high-temperature limit
+ *
+ * \details The heat capacity is written in terms of the third Debye function as
+ *          \f[
+ *            \frac{c}{3R} = 4D_3(x) - \frac{3x}{e^x - 1},
+ *          \f]
+ *          and the derivative follows from
+ *          \f$D_3'(x) = 3/(e^x - 1) - 3D_3(x)/x\f$.
+ */
+static double find_reduced_cp_exact(const double  x,
+                                    double       &dcdx)
+{
+    const double D_3    = gsl_sf_debye_3(x);
+    const double n_B    = 1.0/expm1(x); // Bose-Einstein occupation
+    const double e_term = x*n_B*(1.0 + n_B); // x e^x/(e^x - 1)^2
+
+    dcdx = -12.0*D_3/x + 9.0*n_B + 3.0*e_term;
+    return 4.0*D_3 - 3.0*x*n_B;
+}
+
+/**
+ * \brief Table of the Debye heat-capacity function, and its derivative, on a
+ *        uniform grid in ln(T/T_D)
+ */
+struct ReducedCpTable
+{
+    std::vector<double> c;    ///< Heat capacity, relative to high-temperature limit
+    std::vector<double> dcdy; ///< Derivative with respect to y = ln(T/T_D)
+    double              y_min;
+    double              dy;
+
+    ReducedCpTable() :
+        c(table_size),
+        dcdy(table_size),
+        y_min(log(table_u_min)),
+        dy((log(table_u_max) - log(table_u_min))/(table_size - 1))
+    {
+        for(size_t i = 0; i < table_size; ++i)
+        {
+            const double x = exp(-(y_min + i*dy));
+            double dcdx = 0.0;
+            c[i]    = find_reduced_cp_exact(x, dcdx);
+            dcdy[i] = -x*dcdx;
+        }
+    }
+};
+
+/**
+ * \brief Find the specific heat capacity, relative to its high-temperature limit
+ *
+ * \param[in] T_ratio Ratio of temperature to Debye temperature
+ *
+ * \details Within the table, cubic Hermite interpolation in \f$\ln(T/T_D)\f$ is
+ *          used, which gives a relative error below \f$10^{-9}\f$.  Outside it,
+ *          the low-temperature \f$T^3\f$ law and the high-temperature series
+ *          \f$1 - x^2/20 + x^4/560\f$ are accurate to the same level.  The table is
+ *          built once, on first use, and is safe to use from several threads.
+ */
+double DebyeModel::get_reduced_cp(const double T_ratio)
+{
+    if(T_ratio < table_u_min)
+    {
+        const double pi_sq = pi*pi;
+        return 4.0*pi_sq*pi_sq*T_ratio*T_ratio*T_ratio/5.0;
+    }
+
+    if(T_ratio >= table_u_max)
+    {
+        const double x_sq = 1.0/(T_ratio*T_ratio);
+        return 1.0 - x_sq/20.0 + x_sq*x_sq/560.0;
+    }
+
+    static const ReducedCpTable table;
+
+    const double s  = (log(T_ratio) - table.y_min)/table.dy;
+    const size_t i  = std::min(static_cast<size_t>(s), table_size - 2);
+    const double t  = s - i; // Fractional position in interval
+    const double t2 = t*t;
+    const double t3 = t2*t;
+
+    // Hermite basis functions
+    const double h00 = 2*t3 - 3*t2 + 1;
+    const double h10 = t3 - 2*t2 + t;
+    const double h01 = -2*t3 + 3*t2;
+    const double h11 = t3 - t2;
+
+    return h00*table.c[i] + h10*table.dy*table.dcdy[i]
+         + h01*table.c[i+1] + h11*table.dy*table.dcdy[i+1];
+}
+
 /**
  * \brief A wrapper for compatibility with GSL
  */
@@ -13,6 +13,15 @@
 
 namespace QWWAD
 {
+/**
+ * \brief Specific heat capacity of a material in the Debye model
+ *
+ * \details get_cp() differentiates the internal energy numerically, which is
+ *          accurate but slow.  get_cp_tabulated() uses a precomputed table of the
+ *          exact Debye heat-capacity function, which is shared by all materials,
+ *          and costs O(1) at any temperature.  This is intended for use in the
+ *          inner loops of thermal solvers.
+ */
 class DebyeModel
 {
 public:
@@ -25,6 +34,9 @@ public:
     double get_cp_approx(const double T) const;
     double get_cp_low_T(const double T) const;
     double get_cp_high_T() const;
+    double get_cp_tabulated(const double T) const;
+
+    static double get_reduced_cp(const double T_ratio);
 
 private:
     double _T_D;    ///< Debye temperature [K]
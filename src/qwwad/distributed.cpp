@@ -0,0 +1,131 @@
+/**
+ * \file   distributed.cpp
+ * \brief  Helpers for sharing work between MPI processes
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "distributed.h"
+
+#include <sstream>
+#include <stdexcept>
+
+#if HAVE_MPI
+# include <mpi.h>
+#endif
+
+namespace QWWAD
+{
+/**
+ * \brief Start a session
+ *
+ * \param[in,out] argc Number of command-line arguments
+ * \param[in,out] argv Command-line arguments.  MPI may remove its own arguments.
+ */
+DistributedSession::DistributedSession(int    &argc,
+                                       char **&argv) :
+    _rank(0),
+    _n_ranks(1)
+{
+#if HAVE_MPI
+    MPI_Init(&argc, &argv);
+
+    int rank    = 0;
+    int n_ranks = 1;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &n_ranks);
+
+    _rank    = rank;
+    _n_ranks = n_ranks;
+#else
+    (void)argc;
+    (void)argv;
+#endif
+}
+
+DistributedSession::~DistributedSession()
+{
+#if HAVE_MPI
+    MPI_Finalize();
+#endif
+}
+
+/**
+ * \brief Find the work items that are handled by this process
+ *
+ * \param[in] n_items Total number of work items
+ *
+ * \details Items are dealt out to the processes in turn, so that neighbouring
+ *          items, which often take similar amounts of time, are spread evenly.
+ */
+std::vector<size_t> DistributedSession::get_local_items(const size_t n_items) const
+{
+    std::vector<size_t> items;
+
+    for(size_t item = _rank; item < n_items; item += _n_ranks)
+        items.push_back(item);
+
+    return items;
+}
+
+/**
+ * \brief Collect a set of results on the root process
+ *
+ * \param[in,out] E   Eigenvalues for each work item.  On input, each process only
+ *                    needs to fill the items that it handles.  On output, the root
+ *                    process holds the values for every item.
+ * \param[in,out] psi Eigenvectors for each work item, which are collected in the
+ *                    same way.
+ *
+ * \details The other processes' results are not changed.  There is nothing to
+ *          do if there is only one process.
+ */
+void DistributedSession::gather(std::vector<arma::vec>    &E,
+                                std::vector<arma::cx_mat> &psi) const
+{
+    if(E.size() != psi.size())
+    {
+        std::ostringstream oss;
+        oss << "Cannot gather " << E.size() << " sets of eigenvalues with "
+            << psi.size() << " sets of eigenvectors.";
+        throw std::length_error(oss.str());
+    }
+
+#if HAVE_MPI
+    for(size_t item = 0; item < E.size(); ++item)
+    {
+        const int owner = get_owner(item);
+
+        if(owner == 0)
+            continue;
+
+        const int tag = item % 32768; // The MPI standard only guarantees tags up to 32767
+
+        if(_rank == static_cast<unsigned int>(owner))
+        {
+            unsigned long long size[3] = {E[item].size(), psi[item].n_rows, psi[item].n_cols};
+            MPI_Send(size, 3, MPI_UNSIGNED_LONG_LONG, 0, tag, MPI_COMM_WORLD);
+            MPI_Send(E[item].memptr(), E[item].size(), MPI_DOUBLE, 0, tag, MPI_COMM_WORLD);
+            MPI_Send(psi[item].memptr(), 2*psi[item].n_elem, MPI_DOUBLE, 0, tag, MPI_COMM_WORLD);
+        }
+        else if(is_root())
+        {
+            unsigned long long size[3] = {0, 0, 0};
+            MPI_Recv(size, 3, MPI_UNSIGNED_LONG_LONG, owner, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+            E[item].set_size(size[0]);
+            psi[item].set_size(size[1], size[2]);
+
+            MPI_Recv(E[item].memptr(), E[item].size(), MPI_DOUBLE, owner, tag,
+                     MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            MPI_Recv(psi[item].memptr(), 2*psi[item].n_elem, MPI_DOUBLE, owner, tag,
+                     MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        }
+    }
+#endif
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,61 @@
+/**
+ * \file   distributed.h
+ * \brief  Helpers for sharing work between MPI processes
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_DISTRIBUTED_H
+#define QWWAD_DISTRIBUTED_H
+
+#include <cstddef>
+#include <vector>
+
+#include <armadillo>
+
+namespace QWWAD
+{
+/**
+ * \brief A set of processes that share a list of independent work items
+ *
+ * \details When QWWAD is built with MPI support (ENABLE_MPI), this starts MPI
+ *          and each process (rank) takes every n-th work item in turn.
+ *          Otherwise, there is only a single process, which takes every item,
+ *          so programs behave exactly as before.
+ *
+ *          Only one session may exist at once, and it should be created at the
+ *          start of the program, before any other processing.
+ */
+class DistributedSession
+{
+public:
+    DistributedSession(int    &argc,
+                       char **&argv);
+    ~DistributedSession();
+
+    /** Return the index of this process */
+    unsigned int get_rank() const {return _rank;}
+
+    /** Return the number of processes */
+    unsigned int get_n_ranks() const {return _n_ranks;}
+
+    /** Return true if this is the process that collects the results */
+    bool is_root() const {return _rank == 0;}
+
+    /** Return the rank of the process that handles a given work item */
+    unsigned int get_owner(const size_t item) const {return item % _n_ranks;}
+
+    std::vector<size_t> get_local_items(const size_t n_items) const;
+
+    void gather(std::vector<arma::vec>    &E,
+                std::vector<arma::cx_mat> &psi) const;
+
+private:
+    DistributedSession(const DistributedSession &);
+    DistributedSession & operator=(const DistributedSession &);
+
+    unsigned int _rank;    ///< Index of this process
+    unsigned int _n_ranks; ///< Number of processes
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
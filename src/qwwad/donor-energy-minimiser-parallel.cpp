@@ -0,0 +1,174 @@
+/**
+ * \file   donor-energy-minimiser-parallel.cpp
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Multi-start minimisation of donor state energy using several threads
+ */
+
+#include "donor-energy-minimiser-parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_min.h>
+#include <gsl/gsl_multimin.h>
+
+#include "parallel.h"
+#include "schroedinger-solver-donor-variable.h"
+
+namespace QWWAD
+{
+/**
+ * \brief Refine a minimum of the energy with respect to the Bohr radius
+ *
+ * \param[in] ws        Workspace to use for this search
+ * \param[in] lambda_lo Lower bound of Bohr radius [m]
+ * \param[in] lambda    Bohr radius with lower energy than either bound [m]
+ * \param[in] lambda_hi Upper bound of Bohr radius [m]
+ */
+void DonorEnergyMinimiserParallel::refine_lambda(SchroedingerSolverDonor::Workspace &ws,
+                                                 const double                        lambda_lo,
+                                                 const double                        lambda,
+                                                 const double                        lambda_hi)
+{
+    const size_t max_iter = 100; // Maximum number of iterations before giving up
+    int status = 0;              // Error flag for GSL
+    unsigned int iter = 0;       // The number of iterations attempted so far
+    SearchContext ctx = {this, &ws};
+
+    gsl_function f;
+    f.function = &find_E_at_lambda;
+    f.params   = &ctx;
+
+    gsl_min_fminimizer *s = gsl_min_fminimizer_alloc(gsl_min_fminimizer_brent);
+    gsl_min_fminimizer_set(s, &f, lambda, lambda_lo, lambda_hi);
+
+    do
+    {
+        ++iter;
+        status = gsl_min_fminimizer_iterate(s);
+        status = gsl_min_test_interval(gsl_min_fminimizer_x_lower(s),
+                                       gsl_min_fminimizer_x_upper(s),
+                                       0.1e-10, 0.0);
+    }while((status == GSL_CONTINUE) && (iter < max_iter));
+
+    gsl_min_fminimizer_free(s);
+}
+
+/**
+ * \brief Refine a minimum of the energy with respect to Bohr radius and symmetry
+ *
+ * \param[in] ws     Workspace to use for this search
+ * \param[in] lambda Initial Bohr radius [m]
+ * \param[in] zeta   Initial symmetry parameter
+ */
+void DonorEnergyMinimiserParallel::refine_lambda_zeta(SchroedingerSolverDonor::Workspace &ws,
+                                                      const double                        lambda,
+                                                      const double                        zeta)
+{
+    const size_t max_iter = 100; // Maximum number of iterations before giving up
+    int status = 0;              // Error flag for GSL
+    unsigned int iter = 0;       // The number of iterations attempted so far
+    SearchContext ctx = {this, &ws};
+
+    gsl_multimin_function f;
+    f.f      = &find_E_at_lambda_zeta;
+    f.n      = 2;
+    f.params = &ctx;
+
+    gsl_vector *lambda_zeta = gsl_vector_alloc(2);
+    gsl_vector *step_size   = gsl_vector_alloc(2);
+    gsl_vector_set(lambda_zeta, 0, lambda);
+    gsl_vector_set(lambda_zeta, 1, zeta);
+    gsl_vector_set(step_size,   0, _lambda_step/2);
+    gsl_vector_set(step_size,   1, _zeta_step/2);
+
+    gsl_multimin_fminimizer *s = gsl_multimin_fminimizer_alloc(gsl_multimin_fminimizer_nmsimplex2, 2);
+    gsl_multimin_fminimizer_set(s, &f, lambda_zeta, step_size);
+
+    do
+    {
+        ++iter;
+        status = gsl_multimin_fminimizer_iterate(s);
+        status = gsl_multimin_test_size(s->size, 1e-5);
+    }while((status == GSL_CONTINUE) && (iter < max_iter));
+
+    gsl_multimin_fminimizer_free(s);
+    gsl_vector_free(lambda_zeta);
+    gsl_vector_free(step_size);
+}
+
+/**
+ * \brief Find the minimum carrier energy, and corresponding variational parameters
+ */
+void DonorEnergyMinimiserParallel::minimise()
+{
+    if(_lambda_stop <= _lambda_start)
+        throw std::domain_error("Upper limit on Bohr radius must be set above the lower limit using --lambdastop");
+
+    auto se_variable = dynamic_cast<SchroedingerSolverDonorVariable *>(_se);
+
+    if(se_variable != NULL && _zeta_stop <= _zeta_start)
+        throw std::domain_error("Upper limit on symmetry parameter must be set above the lower limit using --zetastop");
+
+    // Set up the coarse search grid
+    const size_t n_lambda = floor((_lambda_stop - _lambda_start)/_lambda_step + 1e-6) + 1;
+    const size_t n_zeta   = (se_variable != NULL) ? floor((_zeta_stop - _zeta_start)/_zeta_step + 1e-6) + 1 : 1;
+
+    if(n_lambda < 3 || (se_variable != NULL && n_zeta < 3))
+        throw std::domain_error("The search grid needs at least three points in each parameter");
+
+    auto lambda_at = [&](const size_t ilambda) {return _lambda_start + ilambda*_lambda_step;};
+    auto zeta_at   = [&](const size_t izeta)   {return (se_variable != NULL) ? _zeta_start + izeta*_zeta_step : 0.0;};
+
+    std::vector<double> E_grid(n_lambda*n_zeta);
+
+    run_in_parallel(E_grid.size(), _n_threads, [&](const size_t i) {
+        SchroedingerSolverDonor::Workspace ws;
+        E_grid[i] = find_E(ws, lambda_at(i/n_zeta), zeta_at(i%n_zeta));
+    });
+
+    // Pick out the grid points that are lower than all of their neighbours
+    std::vector<size_t> starts;
+
+    for(size_t ilambda = 1; ilambda < n_lambda-1; ++ilambda)
+    {
+        for(size_t izeta = (n_zeta > 1) ? 1 : 0; izeta < ((n_zeta > 1) ? n_zeta-1 : 1); ++izeta)
+        {
+            const size_t i = ilambda*n_zeta + izeta;
+            bool is_minimum = E_grid[i] < E_grid[i-n_zeta] && E_grid[i] < E_grid[i+n_zeta];
+
+            if(n_zeta > 1)
+                is_minimum = is_minimum && E_grid[i] < E_grid[i-1] && E_grid[i] < E_grid[i+1];
+
+            if(is_minimum)
+                starts.push_back(i);
+        }
+    }
+
+    if(starts.empty())
+        throw std::domain_error("Can't find a minimum in this range of variational parameters");
+
+    std::sort(starts.begin(), starts.end(),
+              [&](const size_t a, const size_t b) {return E_grid[a] < E_grid[b];});
+
+    if(starts.size() > _n_starts)
+        starts.resize(_n_starts);
+
+    // Refine each of the best candidates at the same time
+    run_in_parallel(starts.size(), _n_threads, [&](const size_t istart) {
+        SchroedingerSolverDonor::Workspace ws;
+        const size_t ilambda = starts[istart]/n_zeta;
+        const size_t izeta   = starts[istart]%n_zeta;
+
+        if(se_variable != NULL)
+            refine_lambda_zeta(ws, lambda_at(ilambda), zeta_at(izeta));
+        else
+            refine_lambda(ws, lambda_at(ilambda-1), lambda_at(ilambda), lambda_at(ilambda+1));
+    });
+
+    recall_minimum();
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,54 @@
+/**
+ * \file   donor-energy-minimiser-parallel.h
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Multi-start minimisation of donor state energy using several threads
+ */
+
+#ifndef QWWAD_DONOR_ENERGY_MINIMISER_PARALLEL_H
+#define QWWAD_DONOR_ENERGY_MINIMISER_PARALLEL_H
+
+#include "donor-energy-minimiser.h"
+
+namespace QWWAD
+{
+/**
+ * \brief Multi-start minimiser for the energy of a donor state
+ *
+ * \details The energy is first found on a coarse grid of Bohr radii (and
+ *          symmetry parameters, if needed) using several threads, which share
+ *          the solver but each have their own workspace.  The lowest local minima on the
+ *          grid are then refined in parallel, using a Brent search for a fixed
+ *          symmetry or a Nelder-Mead simplex search for a variable symmetry.
+ */
+class DonorEnergyMinimiserParallel : public DonorEnergyMinimiser
+{
+public:
+    DonorEnergyMinimiserParallel(SchroedingerSolverDonor *se,
+                                 const double             lambda_start,
+                                 const double             lambda_step,
+                                 const double             lambda_stop,
+                                 const unsigned int       n_threads = 0,
+                                 const size_t             n_starts  = 3) :
+        DonorEnergyMinimiser(se, lambda_start, lambda_step, lambda_stop),
+        _n_threads(n_threads),
+        _n_starts(n_starts)
+    {};
+
+private:
+    unsigned int _n_threads; ///< Number of threads to use (0 = one per CPU core)
+    size_t       _n_starts;  ///< Maximum number of grid minima to refine
+
+    void refine_lambda(SchroedingerSolverDonor::Workspace &ws,
+                       const double                        lambda_lo,
+                       const double                        lambda,
+                       const double                        lambda_hi);
+
+    void refine_lambda_zeta(SchroedingerSolverDonor::Workspace &ws,
+                            const double                        lambda,
+                            const double                        zeta);
+
+    void minimise();
+};
+} // namespace
+#endif // QWWAD_DONOR_ENERGY_MINIMISER_PARALLEL_H
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
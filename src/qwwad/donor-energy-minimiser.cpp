@@ -30,36 +30,110 @@ DonorEnergyMinimiser::DonorEnergyMinimiser(SchroedingerSolverDonor *se,
     _zeta_stop(0.0),
     _lambda_history(std::vector<double>(0)),
     _zeta_history(std::vector<double>(0)),
-    _E_history(std::vector<double>(0))
+    _E_history(std::vector<double>(0)),
+    _E_cache(),
+    _E_cache_mutex(),
+    _E_min(0.0)
 {}
 
+/**
+ * \brief Find the energy of a carrier using a given Bohr radius and symmetry
+ *
+ * \param[in] ws     Workspace to use for the calculation
+ * \param[in] lambda Bohr radius [m]
+ * \param[in] zeta   Symmetry parameter (ignored unless the solver has variable symmetry)
+ *
+ * \returns The ground-state energy [J]
+ *
+ * \details Each energy is only calculated once.  Subsequent requests for the same
+ *          parameters are read from the cache, and only new calculations are
+ *          added to the search history.  The solver is not changed, so this is safe
+ *          to call from several threads at once, as long as each thread has its
+ *          own workspace.
+ */
+double DonorEnergyMinimiser::find_E(SchroedingerSolverDonor::Workspace &ws,
+                                    const double                        lambda,
+                                    const double                        zeta)
+{
+    auto se_variable = dynamic_cast<SchroedingerSolverDonorVariable *>(_se);
+    const auto key = std::make_pair(lambda, (se_variable != NULL) ? zeta : 0.0);
+
+    {
+        std::lock_guard<std::mutex> lock(_E_cache_mutex);
+        const auto cached = _E_cache.find(key);
+
+        if(cached != _E_cache.end())
+            return cached->second;
+    }
+
+    const double E = _se->find_energy(key.first, key.second, ws);
+
+    std::lock_guard<std::mutex> lock(_E_cache_mutex);
+
+    if(_E_cache.insert(std::make_pair(key, E)).second)
+    {
+        _lambda_history.push_back(key.first);
+        _zeta_history.push_back(key.second);
+        _E_history.push_back(E);
+    }
+
+    return E;
+}
+
+/**
+ * \brief Set the solver to the parameters with the lowest energy found so far
+ */
+void DonorEnergyMinimiser::recall_minimum()
+{
+    if(_E_cache.empty())
+        return;
+
+    auto best = _E_cache.begin();
+
+    for(auto it = _E_cache.begin(); it != _E_cache.end(); ++it)
+    {
+        if(it->second < best->second)
+            best = it;
+    }
+
+    _E_min = best->second;
+
+    // The search never changes the solver, so it still has its initial parameters
+    auto se_variable = dynamic_cast<SchroedingerSolverDonorVariable *>(_se);
+
+    if(se_variable != NULL)
+        se_variable->set_lambda_zeta(best->first.first, best->first.second);
+    else
+        _se->set_lambda(best->first.first);
+}
+
 /**
  * \brief Find the energy of a carrier using a given Bohr radius
+ *
+ * \param[in] lambda Bohr radius [m]
+ * \param[in] params Pointer to a SearchContext
  */
 double DonorEnergyMinimiser::find_E_at_lambda(double  lambda,
                                               void   *params)
 {
-    auto se = reinterpret_cast<SchroedingerSolverDonor *>(params);
-    se->set_lambda(lambda); // Recalculate at given Bohr radius
-    const auto solutions = se->get_solutions();
-
-    return solutions[0].get_energy();
+    auto ctx = reinterpret_cast<SearchContext *>(params);
+    return ctx->minimiser->find_E(*ctx->ws, lambda);
 }
 
 /**
  * \brief Find the energy of a carrier using a given Bohr radius and symmetry
+ *
+ * \param[in] lambda_zeta Bohr radius [m] and symmetry parameter
+ * \param[in] params      Pointer to a SearchContext
  */
 double DonorEnergyMinimiser::find_E_at_lambda_zeta(const gsl_vector *lambda_zeta,
                                                    void             *params)
 {
-    auto se = reinterpret_cast<SchroedingerSolverDonorVariable *>(params);
+    auto ctx = reinterpret_cast<SearchContext *>(params);
     const double lambda = gsl_vector_get(lambda_zeta, 0);
     const double zeta   = gsl_vector_get(lambda_zeta, 1);
 
-    se->set_lambda_zeta(lambda, zeta); // Set form-factor
-    const auto solutions = se->get_solutions();
-
-    return solutions[0].get_energy();
+    return ctx->minimiser->find_E(*ctx->ws, lambda, zeta);
 }
 } // namespace
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -10,13 +10,16 @@
 #ifndef QWWAD_DONOR_ENERGY_MINIMISER_H
 #define QWWAD_DONOR_ENERGY_MINIMISER_H
 
+#include <map>
+#include <mutex>
+#include <utility>
 #include <vector>
 #include <gsl/gsl_vector.h>
 
+#include "schroedinger-solver-donor.h"
+
 namespace QWWAD
 {
-class SchroedingerSolverDonor;
-
 /**
  * \brief A tool for minimising the energy of a donor state
  */
@@ -56,6 +59,30 @@ protected:
     std::vector<double> _zeta_history;
     std::vector<double> _E_history;
 
+    /// Energy found at each (lambda, zeta) pair [J]
+    std::map<std::pair<double, double>, double> _E_cache;
+    std::mutex _E_cache_mutex; ///< Guards the cache and search history
+
+    double _E_min; ///< Lowest energy found by the latest search [J]
+
+    /**
+     * \brief The minimiser and workspace to use in a GSL callback
+     *
+     * \details Each thread in a parallel search needs its own workspace, but all share
+     *          the solver and the minimiser's cache of energies.
+     */
+    struct SearchContext
+    {
+        DonorEnergyMinimiser               *minimiser;
+        SchroedingerSolverDonor::Workspace *ws;
+    };
+
+    double find_E(SchroedingerSolverDonor::Workspace &ws,
+                  const double                        lambda,
+                  const double                        zeta = 0.0);
+
+    void recall_minimum();
+
     static double find_E_at_lambda(double lambda, void *params);
     static double find_E_at_lambda_zeta(const gsl_vector *lambda_zeta,
                                         void             *params);
@@ -63,6 +90,14 @@ public:
     decltype(_lambda_history) get_lambda_history() const {return _lambda_history;}
     decltype(_zeta_history)   get_zeta_history()   const {return _zeta_history;}
     decltype(_E_history)      get_E_history()      const {return _E_history;}
+
+    /**
+     * \brief Lowest energy found by the latest search [J]
+     *
+     * \details This is the energy that the solver gives for its final parameters, but
+     *          reading it here avoids recalculating the wavefunction.
+     */
+    double get_E_min() const {return _E_min;}
 };
 } // namespace
 #endif // QWWAD_DONOR_ENERGY_MINIMISER_H
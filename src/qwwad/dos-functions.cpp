@@ -118,5 +118,127 @@ double calculate_dos_1D(const double                 mass,
 
     return dos_total;
 }
+
+/**
+ * Calculate bulk density of states at a set of energies
+ *
+ * \param[in] mass   The effective mass of the carrier at the band edge [kg]
+ * \param[in] energy The energies of the carrier [J]
+ * \param[in] V      Band edge potential [J]
+ * \param[in] alpha  The nonparabolicity factor [1/J]
+ *
+ * \returns The density of states at each energy [J^{-1}m^{-3}]
+ *
+ * \details This gives the same result as the single-energy version, but the
+ *          loop has no branches or function calls, so it can be vectorised.
+ */
+std::valarray<double> calculate_dos_3D(const double                 mass,
+                                       const std::valarray<double> &energy,
+                                       const double                 V,
+                                       const double                 alpha)
+{
+    const size_t          ne = energy.size();
+    std::valarray<double> rho(ne);
+
+    // Prefactor for parabolic bands [QWWAD3, Eq. 2.40]
+    const double prefactor = 1/(2.0*gsl_pow_2(pi)) * gsl_pow_3(sqrt(2.0*mass/gsl_pow_2(hBar)));
+
+    const double *E_in = &energy[0];
+    double       *out  = &rho[0];
+
+    for(size_t ie = 0; ie < ne; ++ie)
+    {
+        const double E     = E_in[ie] - V; // Express energy relative to band edge
+        const bool   above = E > std::abs(E_in[ie])*1e-12;
+        const double E_pos = above ? E : 0.0;
+
+        // Density-of-states mass for an excited state in bulk, relative to band-edge mass
+        const double np = 1.0 + 2*alpha*E_pos;
+        const double m_ratio_3_2 = sqrt((1.0+alpha*E_pos) * np * np);
+
+        out[ie] = above ? prefactor * m_ratio_3_2 * sqrt(E_pos) : 0.0;
+    }
+
+    return rho;
+}
+
+/**
+ * Calculate 2D density of states for a quantum well at a set of energies
+ *
+ * \param[in] mass       The effective mass of the carrier [kg]
+ * \param[in] E_carrier  The energies of the carrier [J]
+ * \param[in] E_subbands The energies of the minima of each subband in the well [J]
+ * \param[in] V          Band edge potential [J]
+ * \param[in] alpha      The nonparabolicity factor [1/J]
+ *
+ * \returns The density of states at each energy [J^{-1}m^{-2}]
+ *
+ * \details The number of occupied subbands is counted at all energies at once,
+ *          one subband at a time, and then scaled by the single-subband density
+ *          of states.
+ */
+std::valarray<double> calculate_dos_2D(const double                 mass,
+                                       const std::valarray<double> &E_carrier,
+                                       const std::valarray<double> &E_subbands,
+                                       const double                 V,
+                                       const double                 alpha)
+{
+    const size_t          ne = E_carrier.size();
+    std::valarray<double> n_sb(0.0, ne); // Number of subbands below each energy
+
+    const double *E_in = &E_carrier[0];
+    double       *n    = &n_sb[0];
+
+    for(auto const E_sb : E_subbands)
+    {
+        for(size_t ie = 0; ie < ne; ++ie)
+            n[ie] += (E_in[ie] > E_sb) ? 1.0 : 0.0;
+    }
+
+    // Density of states in a single subband [QWWAD3, Eq. 2.46]
+    const double dos_1sb_0 = mass/(pi*gsl_pow_2(hBar));
+
+    for(size_t ie = 0; ie < ne; ++ie)
+        n[ie] *= dos_1sb_0 * (1 + 2*alpha*(E_in[ie]-V));
+
+    return n_sb;
+}
+
+/**
+ * Calculate 1D density of states for a quantum wire at a set of energies
+ *
+ * \param[in] mass       The effective mass of the carrier [kg]
+ * \param[in] E_carrier  The energies of the carrier [J]
+ * \param[in] E_subbands The energies of the minima of each subband in the well [J]
+ *
+ * \returns The density of states at each energy [J^{-1}m^{-1}]
+ *
+ * \details It is assumed that carriers have a parabolic dispersion
+ */
+std::valarray<double> calculate_dos_1D(const double                 mass,
+                                       const std::valarray<double> &E_carrier,
+                                       const std::valarray<double> &E_subbands)
+{
+    const size_t          ne = E_carrier.size();
+    std::valarray<double> dos(0.0, ne);
+
+    const double  prefactor = sqrt(2*mass)/hBar/pi;
+    const double *E_in      = &E_carrier[0];
+    double       *out       = &dos[0];
+
+    for(auto const E_sb : E_subbands)
+    {
+        for(size_t ie = 0; ie < ne; ++ie)
+        {
+            const double dE    = E_in[ie] - E_sb;
+            const bool   above = dE > 0;
+
+            // Use a dummy energy below the subband minimum to avoid dividing by zero
+            out[ie] += above ? prefactor/sqrt(above ? dE : 1.0) : 0.0;
+        }
+    }
+
+    return dos;
+}
 }
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
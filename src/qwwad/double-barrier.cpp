@@ -5,15 +5,28 @@
  * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
  */
 
+#include "double-barrier.h"
+
+#include <algorithm>
 #include <cmath>
-#include <armadillo>
-#include "constants.h"
+#include <sstream>
+#include <stdexcept>
 
-using namespace arma;
+#include "constants.h"
+#include "transfer-matrix.h"
 
 namespace QWWAD {
-using namespace constants;
-
+/**
+ * \brief Find the transmission coefficient through a double barrier
+ *
+ * \param[in] E   Energy of incident particle [J]
+ * \param[in] m_w Effective mass in the well and leads [kg]
+ * \param[in] m_b Effective mass in the barriers [kg]
+ * \param[in] V   Barrier potential [J]
+ * \param[in] L1  Width of left barrier [m]
+ * \param[in] L2  Width of well [m]
+ * \param[in] L3  Width of right barrier [m]
+ */
 double get_transmission_coefficient(const double E,
                                     const double m_w,
                                     const double m_b,
@@ -22,74 +35,99 @@ double get_transmission_coefficient(const double E,
                                     const double L2,
                                     const double L3)
 {
-    // Calculate interfaces
-    const double I2=L1;
-    const double I3=L1+L2;
-    const double I4=L1+L2+L3;
-
-    double Tx = 0; // Transmission coefficient
-
-    // Find wave vector in well and decay constant in barrier
-    const double k=sqrt(2*m_w*E)/hBar;
-    const double K=sqrt(2*m_b*(V-E))/hBar;
-
-    // Define transfer matrices
-    cx_mat M1(2,2);
-    M1(0,0) = 1;
-    M1(0,1) = 1;
-    M1(1,0) = cx_double(0.0,  k/m_w);
-    M1(1,1) = cx_double(0.0, -k/m_w);
-
-    cx_mat M2(2,2);
-    M2(0,0) = 1;
-    M2(0,1) = 1;
-    M2(1,0) = +K/m_b;
-    M2(1,1) = -K/m_b;
-
-    cx_mat M3(2,2);
-    M3(0,0) = exp(+K*I2);
-    M3(0,1) = exp(-K*I2);
-    M3(1,0) =  K*exp(+K*I2)/m_b;
-    M3(1,1) = -K*exp(-K*I2)/m_b;
+    return make_double_barrier(m_w, m_b, V, L1, L2, L3).get_transmission(E);
+}
 
-    cx_mat M4(2,2);
-    M4(0,0) = cx_double(cos(k*I2),         +sin(k*I2));
-    M4(0,1) = cx_double(cos(k*I2),         -sin(k*I2));
-    M4(1,0) = cx_double(-k*sin(+k*I2)/m_w, +k*cos(k*I2)/m_w);
-    M4(1,1) = cx_double(+k*sin(-k*I2)/m_w, -k*cos(k*I2)/m_w);
+/**
+ * \brief Set up the transfer-matrix model of a double barrier
+ *
+ * \param[in] m_w Effective mass in the well and leads [kg]
+ * \param[in] m_b Effective mass in the barriers [kg]
+ * \param[in] V   Barrier potential [J]
+ * \param[in] L1  Width of left barrier [m]
+ * \param[in] L2  Width of well [m]
+ * \param[in] L3  Width of right barrier [m]
+ */
+TransferMatrix make_double_barrier(const double m_w,
+                                   const double m_b,
+                                   const double V,
+                                   const double L1,
+                                   const double L2,
+                                   const double L3)
+{
+    return TransferMatrix({0.0, L1,  L2,  L3,  0.0},
+                          {0.0, V,   0.0, V,   0.0},
+                          {m_w, m_b, m_w, m_b, m_w});
+}
 
-    cx_mat M5(2,2);
-    M5(0,0) = cx_double(cos(k*I3),         +sin(k*I3));
-    M5(0,1) = cx_double(cos(k*I3),         -sin(k*I3));
-    M5(1,0) = cx_double(-k*sin(+k*I3)/m_w, +k*cos(k*I3)/m_w);
-    M5(1,1) = cx_double(+k*sin(-k*I3)/m_w, -k*cos(k*I3)/m_w);
+/**
+ * \brief Set up the transfer-matrix model of a double barrier under an electric field
+ *
+ * \param[in] m_w Effective mass in the well and leads [kg]
+ * \param[in] m_b Effective mass in the barriers [kg]
+ * \param[in] V   Barrier potential [J]
+ * \param[in] L1  Width of left barrier [m]
+ * \param[in] L2  Width of well [m]
+ * \param[in] L3  Width of right barrier [m]
+ * \param[in] F   Electric field [V/m]
+ * \param[in] dz  Largest width of a constant-potential slice [m]
+ *
+ * \details The linear drop in potential across the barriers and well is
+ *          approximated by a staircase of thin slices, each taking the potential
+ *          at its centre.  The potential is measured from the centre of the well,
+ *          so the left lead lies at \f$eF(L_1 + L_2/2)\f$ and the right lead
+ *          lies at \f$-eF(L_2/2 + L_3)\f$.
+ */
+TransferMatrix make_biased_double_barrier(const double m_w,
+                                          const double m_b,
+                                          const double V,
+                                          const double L1,
+                                          const double L2,
+                                          const double L3,
+                                          const double F,
+                                          const double dz)
+{
+    if(dz <= 0.0)
+    {
+        std::ostringstream oss;
+        oss << "Slice width must be positive.  Got " << dz << " m.";
+        throw std::domain_error(oss.str());
+    }
 
-    cx_mat M6(2,2);
-    M6(0,0) = exp(+K*I3);
-    M6(0,1) = exp(-K*I3);
-    M6(1,0) =  K*exp(+K*I3)/m_b;
-    M6(1,1) = -K*exp(-K*I3)/m_b;
+    const double z_centre = L1 + L2/2; // Location of centre of well [m]
 
-    cx_mat M7(2,2);
-    M7(0,0) = exp(+K*I4);
-    M7(0,1) = exp(-K*I4);
-    M7(1,0) =  K*exp(+K*I4)/m_b;
-    M7(1,1) = -K*exp(-K*I4)/m_b;
+    std::vector<double> d(1, 0.0);
+    std::vector<double> V_layer(1, constants::e*F*z_centre);
+    std::vector<double> m_layer(1, m_w);
 
-    cx_mat M8(2,2);
-    M8(0,0) = cx_double(cos(k*I4),         +sin(k*I4));
-    M8(0,1) = cx_double(cos(k*I4),         -sin(k*I4));
-    M8(1,0) = cx_double(-k*sin(+k*I4)/m_w, +k*cos(k*I4)/m_w);
-    M8(1,1) = cx_double(+k*sin(-k*I4)/m_w, -k*cos(k*I4)/m_w);
+    const double z_start[3] = {0.0, L1, L1+L2}; // Start of each region [m]
+    const double L[3]       = {L1,  L2, L3};    // Width of each region [m]
+    const double V_band[3]  = {V,   0.0, V};    // Band edge in each region [J]
+    const double m[3]       = {m_b, m_w, m_b};  // Mass in each region [kg]
 
-    // Little hack to stop nonsense output when E = 0
-    if (gsl_fcmp(E, 0, 1e-9*e) == 1)
+    for(unsigned int iregion = 0; iregion < 3; ++iregion)
     {
-        cx_mat M = inv(M1) * M2 * inv(M3) * M4 * inv(M5) * M6 * inv(M7) * M8;
-        Tx = 1/(norm(M(1,1))); // Transmission coeff
+        if(L[iregion] <= 0.0)
+            continue;
+
+        // Use zero field as a special case, so that each region is a single layer
+        const size_t n_slices = (F == 0.0) ? 1 : std::max<size_t>(1, ceil(L[iregion]/dz));
+        const double d_slice  = L[iregion]/n_slices;
+
+        for(size_t islice = 0; islice < n_slices; ++islice)
+        {
+            const double z = z_start[iregion] + (islice + 0.5)*d_slice;
+            d.push_back(d_slice);
+            V_layer.push_back(V_band[iregion] - constants::e*F*(z - z_centre));
+            m_layer.push_back(m[iregion]);
+        }
     }
 
-    return Tx;
+    d.push_back(0.0);
+    V_layer.push_back(-constants::e*F*(L1 + L2 + L3 - z_centre));
+    m_layer.push_back(m_w);
+
+    return TransferMatrix(d, V_layer, m_layer);
 }
 }// namespace
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
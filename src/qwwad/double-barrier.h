@@ -7,6 +7,9 @@
 
 #ifndef QWWAD_DOUBLE_BARRIER_H
 #define QWWAD_DOUBLE_BARRIER_H
+
+#include "transfer-matrix.h"
+
 namespace QWWAD {
 double get_transmission_coefficient(const double E,
                                     const double m_w,
@@ -15,6 +18,22 @@ double get_transmission_coefficient(const double E,
                                     const double L1,
                                     const double L2,
                                     const double L3);
+
+TransferMatrix make_double_barrier(const double m_w,
+                                   const double m_b,
+                                   const double V,
+                                   const double L1,
+                                   const double L2,
+                                   const double L3);
+
+TransferMatrix make_biased_double_barrier(const double m_w,
+                                          const double m_b,
+                                          const double V,
+                                          const double L1,
+                                          const double L2,
+                                          const double L3,
+                                          const double F,
+                                          const double dz);
 } // namespace
 #endif
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
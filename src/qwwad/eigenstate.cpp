@@ -1,29 +1,174 @@
 #include "eigenstate.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
 #include <sstream>
+#include <stdexcept>
 #include "maths-helpers.h"
+#include "quadrature.h"
 #include "file-io.h"
+#include "parallel.h"
+#include "state-set.h"
 
 namespace QWWAD {
-Eigenstate::Eigenstate(decltype(_E)   E,
-                       decltype(_z)   z,
-                       decltype(_psi) psi) :
+/**
+ * \brief Create an eigenstate with its own copy of the spatial grid
+ *
+ * \param[in] E   Energy of the state [J]
+ * \param[in] z   Spatial sampling positions [m]
+ * \param[in] psi Wave function at each position (need not be normalised)
+ */
+Eigenstate::Eigenstate(decltype(_E)      E,
+                       const arma::vec  &z,
+                       decltype(_psi)    psi) :
+    Eigenstate(E, std::make_shared<const arma::vec>(z), psi)
+{}
+
+/**
+ * \brief Create an eigenstate on an existing spatial grid
+ *
+ * \param[in] E   Energy of the state [J]
+ * \param[in] z   Spatial sampling positions [m].  This is shared rather than copied,
+ *                so a set of states on the same grid only stores it once.
+ * \param[in] psi Wave function at each position (need not be normalised)
+ */
+Eigenstate::Eigenstate(decltype(_E)      E,
+                       decltype(_z)      z,
+                       decltype(_psi)    psi) :
     _E(E),
     _z(z),
-    _psi(psi)
+    _quadrature(),
+    _psi(psi),
+    _PD(),
+    _analytic(),
+    _samples()
 {
+    if(!_z)
+        throw std::invalid_argument("Eigenstate created without a spatial grid");
+
+    _quadrature = get_shared_quadrature(_z);
     normalise();
 }
 
+/**
+ * \brief Create an eigenstate whose wave function has a closed form
+ *
+ * \param[in] E   Energy of the state [J]
+ * \param[in] z   Spatial sampling positions [m], shared with other states
+ * \param[in] psi Closed form of the wave function
+ *
+ * \details The wave function is only sampled onto the grid (and normalised) the
+ *          first time that the samples are requested, so a state whose energy alone
+ *          is needed costs nothing per spatial point.  Copies of the state share
+ *          the samples, so they are only ever found once.
+ */
+Eigenstate::Eigenstate(decltype(_E)        E,
+                       decltype(_z)        z,
+                       decltype(_analytic) psi) :
+    _E(E),
+    _z(z),
+    _quadrature(),
+    _psi(),
+    _PD(),
+    _analytic(psi),
+    _samples(std::make_shared<LazySamples>())
+{
+    if(!_z)
+        throw std::invalid_argument("Eigenstate created without a spatial grid");
+
+    if(!_analytic)
+        throw std::invalid_argument("Eigenstate created without a wave function");
+}
+
+/**
+ * \brief Create an eigenstate whose wave function is found on first use
+ *
+ * \param[in] E    Energy of the state [J]
+ * \param[in] z    Spatial sampling positions [m], shared with other states
+ * \param[in] load Function that returns the wave function at each position
+ *                 (need not be normalised), e.g., by reading it from a file
+ *
+ * \details As for an analytic state, the samples are shared between copies and
+ *          the function is only called once, when the samples are first requested.
+ */
+Eigenstate::Eigenstate(decltype(_E)                       E,
+                       decltype(_z)                       z,
+                       const std::function<arma::vec ()> &load) :
+    _E(E),
+    _z(z),
+    _quadrature(),
+    _psi(),
+    _PD(),
+    _analytic(),
+    _samples(std::make_shared<LazySamples>())
+{
+    if(!_z)
+        throw std::invalid_argument("Eigenstate created without a spatial grid");
+
+    if(!load)
+        throw std::invalid_argument("Eigenstate created without a wave function");
+
+    _samples->load = load;
+}
+
+/**
+ * \brief Copy the state, with a different energy
+ *
+ * \param[in] E New energy of the state (e.g., after converting units)
+ *
+ * \details The wave function is shared with this state rather than resampled
+ */
+Eigenstate Eigenstate::with_energy(const double E) const
+{
+    Eigenstate st(*this);
+    st._E = E;
+    return st;
+}
+
+/**
+ * \brief Find the samples of a wave function that is not stored directly
+ *
+ * \details The samples are either evaluated from the closed form, or found using
+ *          the loading function.  This is safe to call from several threads at once.
+ */
+const Eigenstate::LazySamples & Eigenstate::sample() const
+{
+    std::call_once(_samples->sampled, [this]() {
+        const auto &z = *_z;
+        arma::vec psi(z.size());
+
+        if(_analytic)
+        {
+            for(arma::uword iz = 0; iz < z.size(); ++iz)
+                psi(iz) = (*_analytic)(z(iz));
+        }
+        else
+        {
+            psi = _samples->load();
+
+            if(psi.size() != z.size())
+            {
+                std::ostringstream oss;
+                oss << "Wave function has " << psi.size() << " samples, but the spatial grid has "
+                    << z.size() << " points.";
+                throw std::length_error(oss.str());
+            }
+        }
+
+        _samples->quadrature = get_shared_quadrature(_z);
+        _samples->psi = psi / sqrt(_samples->quadrature->integrate(psi, psi));
+        _samples->PD  = square(_samples->psi);
+    });
+
+    return *_samples;
+}
+
 /**
  * \brief Find the total probability of the state over all space
  */
 double Eigenstate::get_total_probability() const
 {
-    const auto PD = get_PD();
-    const auto dz = _z[1] - _z[0];
-    const auto probability = integral(PD, dz);
-
-    return probability;
+    return get_quadrature().integrate(get_wavefunction_samples(), get_wavefunction_samples());
 }
 
 /**
@@ -40,6 +185,21 @@ void Eigenstate::normalise()
     const auto A = sqrt(P);
 
     _psi *= 1.0/A;
+    _PD   = square(_psi);
+}
+
+/**
+ * \brief Check whether a table can be read, either from memory or from a file
+ *
+ * \param[in] fname Name of the table
+ */
+static bool table_exists(const std::string &fname)
+{
+    if(find_piped_table(fname))
+        return true;
+
+    wait_for_async_file(fname);
+    return std::ifstream(fname.c_str()).good();
 }
 
 /** 
@@ -52,18 +212,34 @@ void Eigenstate::normalise()
  *                                  read
  * \param[in]   ignore_first_column True if first column of eigenvalue file should be
  *                                  ignored
+ * \param[in]   on_demand           True if each eigenvector file (other than the
+ *                                  first) should only be read when its wave function
+ *                                  is first needed
  * 
  * \returns  A vector containing the eigenstates
  *
- * \details Reads in eigenstates from files into a vector
+ * \details Reads in eigenstates from files into a vector.  If the eigenvalue
+ *          file is a binary container (see write_to_binary_file), all the states
+ *          are read from it and the eigenvector files are not needed.
+ *
+ *          Otherwise, the eigenvector files are all read at once, in parallel,
+ *          unless they are read on demand.  When reading on demand, the first file is read immediately to find the
+ *          spatial grid, and every other file must use the same grid.  The other
+ *          files must exist, but are only parsed when first needed, so a program
+ *          that only needs a few of the states skips the rest.  Use load_all to
+ *          read many of the files at once, in parallel.
  */
 std::vector<Eigenstate>
 Eigenstate::read_from_file(const std::string &Eigenval_name,
                            const std::string &Eigenvect_prefix,
                            const std::string &Eigenvect_ext,
                            const double       eigenvalue_scale,
-                           const bool         ignore_first_column)
+                           const bool         ignore_first_column,
+                           const bool         on_demand)
 {
+    if(is_binary_file(Eigenval_name))
+        return read_from_binary_file(Eigenval_name, eigenvalue_scale);
+
     std::vector<Eigenstate> states;
 
     // Read eigenvalues into tempory memory
@@ -103,20 +279,94 @@ Eigenstate::read_from_file(const std::string &Eigenval_name,
 
     // Resize permanent store of eigen-solutions to correct size and copy in first eigen-solution
     const auto psi_size = z_temp.size();
-    states.push_back(Eigenstate(E_temp[0], z_temp, psi_temp));
+    const auto z_grid   = std::make_shared<const arma::vec>(z_temp);
+    states.push_back(Eigenstate(E_temp[0], z_grid, psi_temp));
+
+    std::vector<std::string> Eigenvect_names(nst);
 
-    // Read in remaining eigenvectors and copy into permanent store
     for(unsigned int ist=1; ist<nst; ist++){
         std::stringstream Eigenvect_name_sstream;
         Eigenvect_name_sstream << Eigenvect_prefix << ist+1 << Eigenvect_ext;
-        Eigenvect_name = Eigenvect_name_sstream.str();
-        read_table(Eigenvect_name.c_str(), z_temp, psi_temp, psi_size);
-        states.push_back(Eigenstate(E_temp[ist], z_temp, psi_temp));
+        Eigenvect_names[ist] = Eigenvect_name_sstream.str();
+    }
+
+    if(on_demand)
+    {
+        // Check that every file exists now, rather than failing part-way through
+        // a calculation when the state is first used
+        for(unsigned int ist=1; ist<nst; ist++)
+        {
+            if(!table_exists(Eigenvect_names[ist]))
+            {
+                std::ostringstream oss;
+                oss << "Could not find " << Eigenvect_names[ist] << " for state " << ist+1 << ".";
+                throw std::runtime_error(oss.str());
+            }
+        }
+
+        for(unsigned int ist=1; ist<nst; ist++){
+            const auto &name = Eigenvect_names[ist];
+
+            states.push_back(Eigenstate(E_temp[ist], z_grid, [name, z_grid]() {
+                arma::vec z_file;
+                arma::vec psi_file;
+                read_table(name.c_str(), z_file, psi_file, z_grid->size());
+
+                if(!std::equal(z_file.begin(), z_file.end(), z_grid->begin()))
+                {
+                    std::ostringstream oss;
+                    oss << name << " uses a different spatial grid from the other states. "
+                        << "States on different grids can only be read all at once.";
+                    throw std::runtime_error(oss.str());
+                }
+
+                return psi_file;
+            }));
+        }
+
+        return states;
+    }
+
+    // Read in remaining eigenvectors, in parallel
+    std::vector<arma::vec> z_files(nst);
+    std::vector<arma::vec> psi_files(nst);
+
+    run_in_parallel(nst-1, 0, [&](const size_t i) {
+        const auto ist = i + 1;
+        read_table(Eigenvect_names[ist].c_str(), z_files[ist], psi_files[ist], psi_size);
+    });
+
+    // Copy into permanent store, sharing the grid with the first state unless a
+    // file uses a different one
+    for(unsigned int ist=1; ist<nst; ist++){
+        if(std::equal(z_files[ist].begin(), z_files[ist].end(), z_grid->begin()))
+            states.push_back(Eigenstate(E_temp[ist], z_grid, psi_files[ist]));
+        else
+            states.push_back(Eigenstate(E_temp[ist], z_files[ist], psi_files[ist]));
     }
 
     return states;
 }
         
+/**
+ * \brief Find the wave function samples for a set of states, in parallel
+ *
+ * \param[in] states    The states
+ * \param[in] n_threads Number of threads to use (0 = default)
+ *
+ * \details This only does any work for states whose samples are found on first
+ *          use, i.e., analytic states or those read on demand.  It is useful when
+ *          many states are about to be used, since the files are then read, or the
+ *          closed forms evaluated, at the same time rather than one by one.
+ */
+void Eigenstate::load_all(const std::vector<Eigenstate> &states,
+                          const unsigned int             n_threads)
+{
+    run_in_parallel(states.size(), n_threads, [&](const size_t ist) {
+        states[ist].get_wavefunction_samples();
+    });
+}
+
 /** 
  * \brief Write a set of eigenstates to file
  *
@@ -148,12 +398,164 @@ void Eigenstate::write_to_file(const std::string             &Eigenval_name,
         std::stringstream Eigenvect_name_sstream;
         Eigenvect_name_sstream << Eigenvect_prefix << ist+1 << Eigenvect_ext;
         std::string Eigenvect_name = Eigenvect_name_sstream.str();
-        const auto z   = states[ist].get_position_samples();
-        const auto psi = states[ist].get_wavefunction_samples();
+        const auto &z   = states[ist].get_position_samples();
+        const auto  psi = states[ist].get_wavefunction_samples();
         write_table(Eigenvect_name.c_str(), z, psi, false, 17);
     }
 }
 
+/// Identifier at the start of a binary eigenstate file
+static const char binary_magic[8] = {'Q','W','W','A','D','E','I','G'};
+
+/// Version number of the binary eigenstate file format
+static const uint32_t binary_version = 1;
+
+/**
+ * \brief Check whether a file is a binary eigenstate container
+ *
+ * \param[in] filename The name of the file to check
+ */
+bool Eigenstate::is_binary_file(const std::string &filename)
+{
+    std::ifstream stream(filename.c_str(), std::ios::binary);
+    char magic[sizeof(binary_magic)];
+
+    if(!stream.read(magic, sizeof(magic)))
+        return false;
+
+    return std::equal(magic, magic + sizeof(magic), binary_magic);
+}
+
+/**
+ * \brief Read a set of eigenstates from a binary container
+ *
+ * \param[in] filename         The name of the file
+ * \param[in] eigenvalue_scale Value by which all eigenvalues will be divided upon read
+ *
+ * \returns A vector containing the eigenstates
+ *
+ * \details All the states share a single copy of the spatial grid.  The data are
+ *          read directly into memory, so this is much faster than parsing the
+ *          ASCII files for a large mesh.
+ */
+std::vector<Eigenstate>
+Eigenstate::read_from_binary_file(const std::string &filename,
+                                  const double       eigenvalue_scale)
+{
+    std::ifstream stream(filename.c_str(), std::ios::binary);
+
+    char     magic[sizeof(binary_magic)];
+    uint32_t version = 0;
+    uint64_t nst     = 0;
+    uint64_t nz      = 0;
+
+    stream.read(magic, sizeof(magic));
+    stream.read(reinterpret_cast<char *>(&version), sizeof(version));
+    stream.read(reinterpret_cast<char *>(&nst),     sizeof(nst));
+    stream.read(reinterpret_cast<char *>(&nz),      sizeof(nz));
+
+    if(!stream || !std::equal(magic, magic + sizeof(magic), binary_magic))
+    {
+        std::ostringstream oss;
+        oss << filename << " is not a binary eigenstate file.";
+        throw std::runtime_error(oss.str());
+    }
+
+    if(version != binary_version)
+    {
+        std::ostringstream oss;
+        oss << filename << " uses version " << version << " of the binary eigenstate format, "
+            << "but only version " << binary_version << " is supported.";
+        throw std::runtime_error(oss.str());
+    }
+
+    if(nst == 0 || nz == 0)
+    {
+        std::ostringstream oss;
+        oss << filename << " appears to be empty. Is this the correct eigenstate file?";
+        throw std::runtime_error(oss.str());
+    }
+
+    arma::vec z(nz);
+    stream.read(reinterpret_cast<char *>(z.memptr()), nz*sizeof(double));
+    const auto z_grid = std::make_shared<const arma::vec>(z);
+
+    std::vector<Eigenstate> states;
+    states.reserve(nst);
+
+    arma::vec psi(nz);
+
+    for(unsigned int ist = 0; ist < nst; ++ist)
+    {
+        double E = 0.0;
+        stream.read(reinterpret_cast<char *>(&E), sizeof(E));
+        stream.read(reinterpret_cast<char *>(psi.memptr()), nz*sizeof(double));
+
+        if(!stream)
+        {
+            std::ostringstream oss;
+            oss << filename << " ended after " << ist << " of " << nst << " states.";
+            throw std::runtime_error(oss.str());
+        }
+
+        states.push_back(Eigenstate(E/eigenvalue_scale, z_grid, psi));
+    }
+
+    return states;
+}
+
+/**
+ * \brief Write a set of eigenstates to a single binary container
+ *
+ * \param[in] filename The name of the file
+ * \param[in] states   Set of eigenstates.  These must all use the same spatial grid.
+ *
+ * \details The file contains an 8-byte identifier, the format version, the number of
+ *          states and the number of spatial points, followed by the spatial grid and
+ *          then the energy and wave function of each state in turn.  All values are
+ *          stored in the native byte order of the machine.
+ */
+void Eigenstate::write_to_binary_file(const std::string             &filename,
+                                      const std::vector<Eigenstate> &states)
+{
+    if(states.empty())
+        throw std::runtime_error("No states to write to binary file");
+
+    const auto &z = states[0].get_position_samples();
+
+    for(auto const &st : states)
+    {
+        if(st.get_position_samples().size() != z.size())
+            throw std::runtime_error("All states in a binary file must use the same spatial grid");
+    }
+
+    std::ofstream stream(filename.c_str(), std::ios::binary);
+
+    const uint64_t nst = states.size();
+    const uint64_t nz  = z.size();
+
+    stream.write(binary_magic, sizeof(binary_magic));
+    stream.write(reinterpret_cast<const char *>(&binary_version), sizeof(binary_version));
+    stream.write(reinterpret_cast<const char *>(&nst), sizeof(nst));
+    stream.write(reinterpret_cast<const char *>(&nz),  sizeof(nz));
+    stream.write(reinterpret_cast<const char *>(z.memptr()), nz*sizeof(double));
+
+    for(auto const &st : states)
+    {
+        const double E = st.get_energy();
+        stream.write(reinterpret_cast<const char *>(&E), sizeof(E));
+        stream.write(reinterpret_cast<const char *>(st.get_wavefunction_samples().memptr()),
+                     nz*sizeof(double));
+    }
+
+    if(!stream)
+    {
+        std::ostringstream oss;
+        oss << "Could not write eigenstates to " << filename;
+        throw std::runtime_error(oss.str());
+    }
+}
+
 /**
  * \brief Find the expectation position for a given state
  *
@@ -164,10 +566,12 @@ void Eigenstate::write_to_file(const std::string             &Eigenval_name,
  */
 double Eigenstate::get_expectation_position() const
 {
-    const auto dz = _z[1] - _z[0];
-    const decltype(_psi) dz_av = _psi * _psi * _z;
+    double z_exp = 0.0;
+
+    if(_analytic && _analytic->get_position_matrix_element(*_analytic, z_exp))
+        return z_exp;
 
-    return integral(dz_av, dz);
+    return get_quadrature().integrate(get_wavefunction_samples(), get_wavefunction_samples(), *_z);
 }
 
 /** 
@@ -178,17 +582,21 @@ double Eigenstate::get_expectation_position() const
  *
  * \return Dipole matrix element [m]
  *
- * \todo FIXME: When |i> == |j>, this should just return the expectation
- *       position.  At the moment, we have no way of figuring this out
- *       and the "pivoting" code below generates the wrong value.  It's
- *       not too important however, because the matrix element for an
- *       intrasubband transition is never really used!
+ * \details When |i> == |j>, this is just the expectation position.
+ *          To find the matrix elements between many states, get_position_matrix
+ *          is much faster.  If both states have a closed form for the matrix
+ *          element, it is used directly.
  */
-double mij(const Eigenstate &i, const Eigenstate &j)
+double Eigenstate::get_position_matrix_element(const Eigenstate &i,
+                                               const Eigenstate &j)
 {
+    double z_ij = 0.0;
+
+    if(i._analytic && j._analytic && i._analytic->get_position_matrix_element(*j._analytic, z_ij))
+        return z_ij;
+
     // FIXME: Currently it is assumed that both states use same spatial grid
     const auto z = i.get_position_samples();
-    const double dz = z[1] - z[0];
 
     /* Because we have a nonparabolic effective mass, the Schroedinger solutions
      * are NOT part of an orthonormal set. As such, we need to do something to
@@ -203,9 +611,145 @@ double mij(const Eigenstate &i, const Eigenstate &j)
     const auto psi_i = i.get_wavefunction_samples();
     const auto psi_j = j.get_wavefunction_samples();
 
-    const arma::vec dmij = psi_i * (z - z0) * psi_j;
+    const arma::vec z_shift = z - z0;
+
+    return i.get_quadrature().integrate(psi_i, z_shift, psi_j);
+}
+
+/**
+ * \brief Find the overlap integral between a pair of eigenstates
+ *
+ * \param[in] i First state
+ * \param[in] j Second state, which must use the same spatial grid
+ *
+ * \returns The overlap integral, <i|j>
+ *
+ * \details If both states have a closed form for the overlap, it is used directly.
+ */
+double Eigenstate::get_overlap(const Eigenstate &i,
+                               const Eigenstate &j)
+{
+    double S = 0.0;
+
+    if(i._analytic && j._analytic && i._analytic->get_overlap(*j._analytic, S))
+        return S;
+
+    return i.get_quadrature().integrate(i.get_wavefunction_samples(), j.get_wavefunction_samples());
+}
+
+/**
+ * \brief Gather the wavefunctions for a set of states into a matrix
+ *
+ * \param[in] states The states, which must all use the same spatial grid
+ *
+ * \returns A matrix with one column per state [m^{-0.5}]
+ */
+arma::mat Eigenstate::get_wavefunction_matrix(const std::vector<Eigenstate> &states)
+{
+    if(states.empty())
+        return arma::mat();
+
+    const auto nz = states[0].get_position_samples().size();
+    arma::mat Psi(nz, states.size());
+
+    for(unsigned int ist = 0; ist < states.size(); ++ist)
+    {
+        if(states[ist].get_wavefunction_samples().size() != nz)
+        {
+            std::ostringstream oss;
+            oss << "State " << ist << " has " << states[ist].get_wavefunction_samples().size()
+                << " samples, but state 0 has " << nz;
+            throw std::length_error(oss.str());
+        }
+
+        Psi.col(ist) = states[ist].get_wavefunction_samples();
+    }
+
+    return Psi;
+}
+
+/**
+ * \brief Find the dipole matrix elements between every pair in a set of states
+ *
+ * \param[in] states The states, which must all use the same spatial grid
+ *
+ * \returns A matrix whose (i,j) element is the dipole matrix element between
+ *          states i and j [m].  The diagonal holds the expectation positions.
+ *
+ * \details The overlap matrix \f$S = \Psi^T W \Psi\f$ and the moment matrix
+ *          \f$Z = \Psi^T W z \Psi\f$ are each found using a single matrix product,
+ *          where \f$W\f$ holds the quadrature weights.  Each off-diagonal element
+ *          then uses the same pivot position as get_position_matrix_element,
+ *          \f$z_{ij} = Z_{ij} - z_0 S_{ij}\f$.
+ *
+ *          If every pair of states has a closed form for the matrix element, the
+ *          wavefunctions are not sampled at all.
+ */
+arma::mat Eigenstate::get_position_matrix(const std::vector<Eigenstate> &states)
+{
+    const auto nst = states.size();
+
+    if(nst == 0)
+        return arma::mat();
+
+    arma::mat Z_analytic(nst, nst);
+    bool      all_analytic = true;
+
+    for(unsigned int i = 0; i < nst && all_analytic; ++i)
+    {
+        for(unsigned int j = 0; j < nst && all_analytic; ++j)
+        {
+            all_analytic = states[i]._analytic && states[j]._analytic &&
+                           states[i]._analytic->get_position_matrix_element(*states[j]._analytic,
+                                                                            Z_analytic(i,j));
+        }
+    }
+
+    if(all_analytic)
+        return Z_analytic;
 
-    return integral(dmij, dz);
+    return StateSet(states).get_position_matrix();
+}
+
+/**
+ * \brief Find the momentum matrix elements between every pair in a set of states
+ *
+ * \param[in] states The states, which must all use the same spatial grid
+ *
+ * \returns A matrix whose (i,j) element is \f$\langle i|\frac{d}{dz}|j\rangle\f$ [1/m].
+ *          The momentum matrix element is \f$-i\hbar\f$ times this.
+ *
+ * \details The derivative of every wavefunction is found by central differences,
+ *          and all the integrals are then found using a single matrix product.
+ */
+arma::mat Eigenstate::get_momentum_matrix(const std::vector<Eigenstate> &states)
+{
+    if(states.empty())
+        return arma::mat();
+
+    return StateSet(states).get_momentum_matrix();
+}
+
+/**
+ * \brief Find the position and momentum moments of every state in a set
+ *
+ * \param[in] states The states, which must all use the same spatial grid
+ *
+ * \returns A matrix with one row per state.  The columns hold \f$\langle z\rangle\f$ [m],
+ *          \f$\langle z^2\rangle\f$ [m^2], \f$\langle p\rangle/i\hbar\f$ [1/m] and
+ *          \f$\langle p^2\rangle/\hbar^2\f$ [1/m^2] respectively.
+ *
+ * \details The derivatives are found by three-point differences, and all four
+ *          integrals are accumulated together in a single pass over each
+ *          wavefunction.  The wavefunctions vanish at the edges of the system, so
+ *          the end points do not contribute to the momentum moments.
+ */
+arma::mat Eigenstate::get_moments(const std::vector<Eigenstate> &states)
+{
+    if(states.empty())
+        return arma::mat();
+
+    return StateSet(states).get_moments();
 }
 
 /**
@@ -226,5 +770,41 @@ double Eigenstate::psi_squared_max(const std::vector<Eigenstate> &states)
     return PDmax;
 }
 
+/**
+ * \brief Find the carrier density due to a set of populated states
+ *
+ * \param[in] states The states, which must all use the same spatial grid
+ * \param[in] N      Sheet density of carriers in each state [m^{-2}]
+ * \param[in] nper   Number of periods crossed by the wavefunctions
+ *
+ * \returns The carrier density at each point in a single period [m^{-3}]
+ *
+ * \details The density over the whole structure is found as the single product
+ *          \f$|\Psi|^2 N\f$, where each column of \f$|\Psi|^2\f$ is the probability
+ *          density of a state [QWWAD4, 3.108].  For a periodic structure, the
+ *          "tails" of the wavefunctions in each period are then summed into the
+ *          first period.  This is done by viewing the density as a matrix with one
+ *          column per period, so nothing is copied or recomputed.
+ */
+arma::vec Eigenstate::get_carrier_density(const std::vector<Eigenstate> &states,
+                                          const arma::vec               &N,
+                                          const size_t                   nper)
+{
+    if(N.size() != states.size())
+    {
+        std::ostringstream oss;
+        oss << "Got " << N.size() << " populations for " << states.size() << " states.";
+        throw std::length_error(oss.str());
+    }
+
+    if(nper < 1)
+        throw std::domain_error("Number of periods must be one or more.");
+
+    if(states.empty())
+        return arma::vec();
+
+    return StateSet(states).get_carrier_density(N, nper);
+}
+
 } //namespace
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -7,11 +7,61 @@
 #ifndef QWWAD_EIGENSTATE
 #define QWWAD_EIGENSTATE
 
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <armadillo>
+#include "quadrature.h"
 
 namespace QWWAD {
 
+/**
+ * \brief A wavefunction with a closed form, which can be evaluated at any position
+ *
+ * \details Solvers for potentials with analytic solutions supply one of these for
+ *          each state, so that the wavefunction is only sampled onto the spatial
+ *          grid if it is actually needed.  Where the matrix elements between two
+ *          wavefunctions also have a closed form, the derived class may override
+ *          get_overlap and get_position_matrix_element to return them directly.
+ */
+class AnalyticWavefunction {
+public:
+    virtual ~AnalyticWavefunction() {}
+
+    /**
+     * \brief Find the wavefunction at a given position
+     *
+     * \param[in] z Position [m]
+     *
+     * \returns The wavefunction.  This need not be normalised.
+     */
+    virtual double operator()(const double z) const = 0;
+
+    /**
+     * \brief Find the overlap integral with another wavefunction, if it has a closed form
+     *
+     * \param[in]  other Other wavefunction
+     * \param[out] S     Overlap integral
+     *
+     * \returns True if the overlap was found, or false if it must be found numerically
+     */
+    virtual bool get_overlap(const AnalyticWavefunction & /* other */,
+                             double                     & /* S */) const {return false;}
+
+    /**
+     * \brief Find the position matrix element with another wavefunction, if it has a closed form
+     *
+     * \param[in]  other Other wavefunction
+     * \param[out] z_ij  Position matrix element [m]
+     *
+     * \returns True if the matrix element was found, or false if it must be found numerically
+     */
+    virtual bool get_position_matrix_element(const AnalyticWavefunction & /* other */,
+                                             double                     & /* z_ij */) const {return false;}
+};
+
 /**
  * A pure 1D eigenstate of a Hamiltonian
  */
@@ -19,22 +69,60 @@ class Eigenstate {
 private:
     double _E; ///< The energy of the state [J]
 
-    arma::vec _z;   ///< Spatial sampling positions [m]
+    std::shared_ptr<const arma::vec> _z; ///< Spatial sampling positions [m], shared between states
+    std::shared_ptr<const Quadrature> _quadrature; ///< Quadrature rule for the grid, shared between states
     arma::vec _psi; ///< Wave function [m^{-0.5}]
+    arma::vec _PD;  ///< Probability density [m^{-1}]
+
+    /// Samples of the wavefunction that are found on first use, from a closed form or a file
+    struct LazySamples {
+        std::once_flag               sampled; ///< Set once the samples have been found
+        std::function<arma::vec ()>  load;    ///< Finds the (unnormalised) samples, if there is no closed form
+        std::shared_ptr<const Quadrature> quadrature; ///< Quadrature rule for the grid
+        arma::vec                    psi;     ///< Wave function [m^{-0.5}]
+        arma::vec                    PD;      ///< Probability density [m^{-1}]
+    };
+
+    std::shared_ptr<const AnalyticWavefunction> _analytic; ///< Closed form of the wave function (if known)
+    std::shared_ptr<LazySamples>                _samples;  ///< Samples that are found on first use (if any)
 
     double get_total_probability() const;
     void normalise();
+    const LazySamples & sample() const;
 
 public:
-    Eigenstate(decltype(_E)   E,
-               decltype(_z)   z,
-               decltype(_psi) psi);
+    Eigenstate(decltype(_E)      E,
+               const arma::vec  &z,
+               decltype(_psi)    psi);
+
+    Eigenstate(decltype(_E)      E,
+               decltype(_z)      z,
+               decltype(_psi)    psi);
+
+    Eigenstate(decltype(_E)        E,
+               decltype(_z)        z,
+               decltype(_analytic) psi);
+
+    Eigenstate(decltype(_E)                       E,
+               decltype(_z)                       z,
+               const std::function<arma::vec ()> &load);
+
+    Eigenstate with_energy(const double E) const;
 
     inline decltype(_E)   get_energy() const {return _E;}
-    inline double get_wavefunction_at_index(const unsigned int iz) const {return _psi[iz];}
-    inline decltype(_psi) get_wavefunction_samples() const {return _psi;}
-    inline decltype(_psi) get_PD() const {return square(_psi);}
-    inline decltype(_z)   get_position_samples() const {return _z;}
+    inline double get_wavefunction_at_index(const unsigned int iz) const {return get_wavefunction_samples()[iz];}
+    inline const decltype(_psi) & get_wavefunction_samples() const {return _samples ? sample().psi : _psi;}
+    inline const decltype(_PD)  & get_PD() const {return _samples ? sample().PD : _PD;}
+    inline const arma::vec & get_position_samples() const {return *_z;}
+
+    /** Return the quadrature rule for the spatial grid */
+    inline const Quadrature & get_quadrature() const {return _samples ? *sample().quadrature : *_quadrature;}
+
+    /** Return the spatial grid, so that it can be shared with other states */
+    inline decltype(_z)   get_position_grid() const {return _z;}
+
+    /** Return the closed form of the wave function, or null if it is only known at the samples */
+    inline decltype(_analytic) get_analytic_wavefunction() const {return _analytic;}
 
     static double psi_squared_max(const std::vector<Eigenstate> &EVP);
 
@@ -42,7 +130,11 @@ public:
                                                   const std::string &Eigenvect_prefix,
                                                   const std::string &Eigenvect_ext,
                                                   const double       eigenvalue_scale    = 1.0,
-                                                  const bool         ignore_first_column = false);
+                                                  const bool         ignore_first_column = false,
+                                                  const bool         on_demand           = false);
+
+    static void load_all(const std::vector<Eigenstate> &states,
+                         const unsigned int             n_threads = 0);
 
     static void write_to_file(const std::string             &Eigenval_name,
                               const std::string             &Eigenvect_prefix,
@@ -50,12 +142,35 @@ public:
                               const std::vector<Eigenstate> &states,
                               const bool                     with_num=false);
 
+    static bool is_binary_file(const std::string &filename);
+
+    static std::vector<Eigenstate> read_from_binary_file(const std::string &filename,
+                                                         const double       eigenvalue_scale = 1.0);
+
+    static void write_to_binary_file(const std::string             &filename,
+                                     const std::vector<Eigenstate> &states);
+
     // TODO: Should probably be part of an Operator class
     double get_expectation_position() const;
 
     // TODO: Should probably be part of an Operator class
     static double get_position_matrix_element(const Eigenstate &i,
                                               const Eigenstate &j);
+
+    static double get_overlap(const Eigenstate &i,
+                              const Eigenstate &j);
+
+    static arma::mat get_wavefunction_matrix(const std::vector<Eigenstate> &states);
+
+    static arma::mat get_position_matrix(const std::vector<Eigenstate> &states);
+
+    static arma::mat get_momentum_matrix(const std::vector<Eigenstate> &states);
+
+    static arma::mat get_moments(const std::vector<Eigenstate> &states);
+
+    static arma::vec get_carrier_density(const std::vector<Eigenstate> &states,
+                                         const arma::vec               &N,
+                                         const size_t                   nper = 1);
 };
 } // namespace
 #endif
@@ -0,0 +1,319 @@
+/**
+ * \file   ensemble-monte-carlo.cpp
+ * \brief  Ensemble Monte Carlo model of carrier transport between subbands
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "ensemble-monte-carlo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#include "constants.h"
+#include "parallel.h"
+
+namespace QWWAD
+{
+using namespace constants;
+
+/// Number of carriers in each block, which share a random-number stream
+static const size_t carriers_per_block = 4096;
+
+/**
+ * \brief Create a simulation for a set of subbands
+ *
+ * \param[in] subbands   All the subbands in the structure
+ * \param[in] nsb_period Number of subbands in each period.  If zero, the structure
+ *                       is not periodic and no current flows.
+ * \param[in] Ek_max     Largest in-plane kinetic energy in the rate tables [J].
+ *                       Rates at higher energies are taken from the last sample.
+ * \param[in] nE         Number of samples in the rate tables
+ */
+EnsembleMonteCarlo::EnsembleMonteCarlo(const std::vector<Subband> &subbands,
+                                       const size_t                nsb_period,
+                                       const double                Ek_max,
+                                       const size_t                nE) :
+    _subbands(subbands),
+    _nsb_period(nsb_period == 0 ? subbands.size() : nsb_period),
+    _Ek_max(Ek_max),
+    _nE(nE),
+    _dE(Ek_max/(nE - 1)),
+    _channels(_nsb_period),
+    _W(_nsb_period),
+    _W_table(),
+    _Gamma()
+{
+    if(subbands.empty() || subbands.size() % _nsb_period != 0)
+    {
+        std::ostringstream oss;
+        oss << "Cannot split " << subbands.size() << " subbands into periods of "
+            << _nsb_period << " subbands.";
+        throw std::invalid_argument(oss.str());
+    }
+
+    if(Ek_max <= 0 || nE < 2)
+        throw std::invalid_argument("The rate tables need a positive energy range and at least two samples.");
+}
+
+/**
+ * \brief Find a rate from a table, by linear interpolation
+ *
+ * \param[in] Ek Table of kinetic energies, in ascending order [J]
+ * \param[in] W  Rate at each energy [1/s]
+ * \param[in] E  Energy at which to find the rate [J]
+ *
+ * \details The rate is zero below the table, and equal to the last value above it
+ */
+static double interpolate_rate(const arma::vec &Ek,
+                               const arma::vec &W,
+                               const double     E)
+{
+    const size_t n = Ek.size();
+
+    if(n == 0 || E < Ek[0])
+        return 0.0;
+
+    if(E >= Ek[n-1])
+        return W[n-1];
+
+    const size_t i  = std::upper_bound(Ek.begin(), Ek.end(), E) - Ek.begin() - 1;
+    const double dE = Ek[i+1] - Ek[i];
+
+    return (dE > 0) ? W[i] + (W[i+1] - W[i])*(E - Ek[i])/dE : W[i];
+}
+
+/**
+ * \brief Tabulate the rates for a transition
+ *
+ * \param[in] i      Index of initial subband in the structure
+ * \param[in] f      Index of final subband in the structure
+ * \param[in] tx     Table of rates against the initial wave-vector
+ * \param[in] E_loss Energy given up by the carrier, besides the change in subband
+ *                   energy, e.g., the phonon energy for emission [J]
+ *
+ * \details The transition is added to the equivalent subband in the period that
+ *          contains the initial subband, so a transition between two periods is
+ *          only needed once.  The rate is set to zero wherever the final kinetic
+ *          energy would be negative.
+ */
+void EnsembleMonteCarlo::add_transition(const unsigned int            i,
+                                        const unsigned int            f,
+                                        const IntersubbandTransition &tx,
+                                        const double                  E_loss)
+{
+    if(i >= _subbands.size() || f >= _subbands.size())
+    {
+        std::ostringstream oss;
+        oss << "Cannot add transition " << i+1 << "->" << f+1 << ".  Only "
+            << _subbands.size() << " subbands exist.";
+        throw std::invalid_argument(oss.str());
+    }
+
+    Channel channel;
+    channel.f       = f % _nsb_period;
+    channel.dperiod = static_cast<int>(f / _nsb_period) - static_cast<int>(i / _nsb_period);
+    channel.dE      = _subbands[i].get_E_min() - _subbands[f].get_E_min() - E_loss;
+
+    const auto Eki = tx.get_Eki_table();
+    const auto Wif = tx.get_rate_table();
+    arma::vec  W(_nE);
+
+    for(unsigned int iE = 0; iE < _nE; ++iE)
+    {
+        const double Ek = iE*_dE;
+        W[iE] = (Ek + channel.dE < 0) ? 0.0 : std::max(interpolate_rate(Eki, Wif, Ek), 0.0);
+    }
+
+    _channels[i % _nsb_period].push_back(channel);
+    _W[i % _nsb_period].push_back(W);
+    _W_table.clear();
+}
+
+/**
+ * \brief Combine the rate tables for each subband, and find the total rates
+ *
+ * \details Linear interpolation never exceeds the largest sample, so the largest
+ *          total rate on the grid bounds the total rate at any energy.
+ */
+void EnsembleMonteCarlo::prepare()
+{
+    _W_table.resize(_nsb_period);
+    _Gamma.zeros(_nsb_period);
+
+    for(unsigned int isb = 0; isb < _nsb_period; ++isb)
+    {
+        const size_t nch = _channels[isb].size();
+        _W_table[isb].zeros(_nE, nch);
+
+        for(unsigned int ich = 0; ich < nch; ++ich)
+            _W_table[isb].col(ich) = _W[isb][ich];
+
+        for(unsigned int iE = 0; iE < _nE; ++iE)
+            _Gamma[isb] = std::max(_Gamma[isb], arma::accu(_W_table[isb].row(iE)));
+    }
+}
+
+/**
+ * \brief Run the simulation
+ *
+ * \param[in] N0         Initial population of each subband in one period [m^{-2}]
+ * \param[in] Te0        Temperature of the initial carrier distribution [K]
+ * \param[in] n_carriers Number of carriers to simulate
+ * \param[in] t_total    Length of the simulation [s]
+ * \param[in] t_warmup   Time allowed for the carriers to reach a steady state,
+ *                       before the results are collected [s]
+ * \param[in] n_threads  Number of threads to use (0 = default)
+ * \param[in] seed       Seed for the random-number streams
+ *
+ * \returns The steady-state results
+ *
+ * \details Each carrier starts in a subband chosen in proportion to N0, with a
+ *          kinetic energy drawn from a Boltzmann distribution.  The populations
+ *          and temperatures are averaged over time, after the warm-up period.
+ */
+EnsembleMonteCarlo::Results
+EnsembleMonteCarlo::run(const arma::vec    &N0,
+                        const double        Te0,
+                        const size_t        n_carriers,
+                        const double        t_total,
+                        const double        t_warmup,
+                        const unsigned int  n_threads,
+                        const uint64_t      seed)
+{
+    if(N0.size() != _nsb_period)
+    {
+        std::ostringstream oss;
+        oss << "Expected " << _nsb_period << " initial populations, but " << N0.size() << " were given.";
+        throw std::length_error(oss.str());
+    }
+
+    if(n_carriers == 0 || t_warmup < 0 || t_total <= t_warmup)
+        throw std::invalid_argument("The simulation needs carriers, and must run for longer than its warm-up time.");
+
+    const double N_total = arma::accu(N0);
+
+    if(N_total <= 0 || N0.min() < 0)
+        throw std::invalid_argument("The initial populations must be positive.");
+
+    if(_W_table.size() != _nsb_period)
+        prepare();
+
+    const arma::vec P0 = arma::cumsum(N0/N_total); // Cumulative probability of each initial subband
+
+    // Totals for each block of carriers, which are combined in order afterwards
+    struct Tally
+    {
+        arma::vec time;      ///< Time spent in each subband [s]
+        arma::vec Ek_time;   ///< Time integral of kinetic energy in each subband [J s]
+        long long crossings; ///< Net number of forward moves between periods
+        size_t    n_events;  ///< Number of real scattering events
+    };
+
+    const size_t n_blocks = (n_carriers + carriers_per_block - 1)/carriers_per_block;
+    std::vector<Tally> tally(n_blocks);
+
+    run_in_parallel(n_blocks, n_threads, [&](const size_t iblock) {
+        std::seed_seq seq{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32),
+                          static_cast<uint32_t>(iblock), static_cast<uint32_t>(iblock >> 32)};
+        std::mt19937_64 rng(seq);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+        auto &t_block = tally[iblock];
+        t_block.time.zeros(_nsb_period);
+        t_block.Ek_time.zeros(_nsb_period);
+        t_block.crossings = 0;
+        t_block.n_events  = 0;
+
+        const size_t first = iblock*carriers_per_block;
+        const size_t last  = std::min(first + carriers_per_block, n_carriers);
+
+        for(size_t icarrier = first; icarrier < last; ++icarrier)
+        {
+            unsigned int isb = std::lower_bound(P0.begin(), P0.end(), uniform(rng)) - P0.begin();
+            isb = std::min<unsigned int>(isb, _nsb_period - 1);
+
+            double Ek = -kB*Te0*log(1.0 - uniform(rng)); // Kinetic energy [J]
+            double t  = 0.0;
+
+            while(t < t_total)
+            {
+                const double Gamma = _Gamma[isb];
+                const double dt    = (Gamma > 0) ? -log(1.0 - uniform(rng))/Gamma
+                                                 : std::numeric_limits<double>::infinity();
+
+                // Record the part of the free flight that lies in the sampling window
+                const double overlap = std::min(t + dt, t_total) - std::max(t, t_warmup);
+
+                if(overlap > 0)
+                {
+                    t_block.time[isb]    += overlap;
+                    t_block.Ek_time[isb] += Ek*overlap;
+                }
+
+                t += dt;
+
+                if(t >= t_total)
+                    break;
+
+                // Choose a transition, or self-scattering, from the rates at this energy
+                const auto  &W_table = _W_table[isb];
+                const size_t iE      = std::min<size_t>(static_cast<size_t>(Ek/_dE), _nE - 2);
+                const double frac    = std::min(Ek/_dE - iE, 1.0);
+                const double r       = uniform(rng)*Gamma;
+                double       W_sum   = 0.0;
+
+                for(unsigned int ich = 0; ich < W_table.n_cols; ++ich)
+                {
+                    W_sum += W_table(iE, ich) + frac*(W_table(iE+1, ich) - W_table(iE, ich));
+
+                    if(r < W_sum)
+                    {
+                        const auto &channel = _channels[isb][ich];
+                        isb = channel.f;
+                        Ek  = std::max(Ek + channel.dE, 0.0);
+
+                        if(t >= t_warmup)
+                            t_block.crossings += channel.dperiod;
+
+                        ++t_block.n_events;
+                        break;
+                    }
+                }
+            }
+        }
+    });
+
+    arma::vec time    = arma::zeros(_nsb_period);
+    arma::vec Ek_time = arma::zeros(_nsb_period);
+    long long crossings = 0;
+
+    Results results;
+    results.n_events = 0;
+
+    for(auto const &t_block : tally)
+    {
+        time    += t_block.time;
+        Ek_time += t_block.Ek_time;
+        crossings        += t_block.crossings;
+        results.n_events += t_block.n_events;
+    }
+
+    results.N  = N_total * time/arma::accu(time);
+    results.Te = arma::zeros(_nsb_period);
+
+    for(unsigned int isb = 0; isb < _nsb_period; ++isb)
+    {
+        if(time[isb] > 0)
+            results.Te[isb] = Ek_time[isb]/(time[isb]*kB);
+    }
+
+    results.J = e*N_total*crossings/(n_carriers*(t_total - t_warmup));
+
+    return results;
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,119 @@
+/**
+ * \file   ensemble-monte-carlo.h
+ * \brief  Ensemble Monte Carlo model of carrier transport between subbands
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_ENSEMBLE_MONTE_CARLO_H
+#define QWWAD_ENSEMBLE_MONTE_CARLO_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <armadillo>
+#include "intersubband-transition.h"
+#include "subband.h"
+
+namespace QWWAD
+{
+/**
+ * \brief Ensemble Monte Carlo simulation of carriers scattering between subbands
+ *
+ * \details Each carrier occupies a subband with a given in-plane kinetic energy.
+ *          It drifts freely until it scatters, then moves to a new subband and
+ *          kinetic energy, chosen from the tabulated rates.  The "self-scattering"
+ *          method is used, so that the time between events is drawn from a
+ *          constant total rate for each subband.
+ *
+ *          The rates for each transition are tabulated once, on an evenly spaced
+ *          grid of initial kinetic energy, so each event only needs a table lookup
+ *          for each transition that leaves the current subband.  The rates do not
+ *          depend on the carrier distribution during the simulation, so carriers
+ *          are independent and are simulated one at a time.  The carriers are
+ *          split into fixed blocks, each with its own random-number stream, so the
+ *          results are identical for any number of threads.
+ *
+ *          For a periodic structure, such as a quantum cascade laser, the subbands
+ *          are listed for one or more consecutive periods, with the same number of
+ *          subbands in each.  Subband i in one period is equivalent to subband
+ *          i + nsb_period in the next, so carriers move between periods and the
+ *          net rate at which they do so gives the current density.
+ */
+class EnsembleMonteCarlo
+{
+public:
+    typedef std::pair<unsigned int, unsigned int> map_key;
+
+    /// Results of a simulation
+    struct Results
+    {
+        arma::vec N;        ///< Time-averaged population of each subband in one period [m^{-2}]
+        arma::vec Te;       ///< Effective carrier temperature in each subband, from the mean kinetic energy [K]
+        double    J;        ///< Current density, counted in the direction of increasing period [A/m^2]
+        size_t    n_events; ///< Number of real scattering events
+    };
+
+private:
+    /// A tabulated transition out of a subband
+    struct Channel
+    {
+        unsigned int f;       ///< Final subband (in the same period)
+        int          dperiod; ///< Change in period index
+        double       dE;      ///< Gain in kinetic energy [J]
+    };
+
+    std::vector<Subband> _subbands;   ///< All subbands in the structure
+    size_t               _nsb_period; ///< Number of subbands in each period
+    double               _Ek_max;     ///< Largest tabulated kinetic energy [J]
+    size_t               _nE;         ///< Number of kinetic-energy samples
+    double               _dE;         ///< Spacing of kinetic-energy samples [J]
+
+    std::vector< std::vector<Channel> >   _channels; ///< Transitions out of each subband in one period
+    std::vector< std::vector<arma::vec> > _W;        ///< Rate table for each channel [1/s]
+    std::vector<arma::mat>                _W_table;  ///< Rates out of each subband (one row per energy, one column per channel) [1/s]
+    arma::vec                             _Gamma;    ///< Constant total rate, including self-scattering, for each subband [1/s]
+
+    void prepare();
+
+public:
+    EnsembleMonteCarlo(const std::vector<Subband> &subbands,
+                       const size_t                nsb_period,
+                       const double                Ek_max,
+                       const size_t                nE = 1000);
+
+    void add_transition(const unsigned int            i,
+                        const unsigned int            f,
+                        const IntersubbandTransition &tx,
+                        const double                  E_loss = 0.0);
+
+    /**
+     * \brief Tabulate the rates for a set of transitions from a scattering calculator
+     *
+     * \param[in] calculator  A calculator for the same set of subbands
+     * \param[in] transitions Initial and final subbands for each transition
+     * \param[in] E_loss      Energy given up by the carrier, besides the change in
+     *                        subband energy, e.g., the phonon energy for emission [J]
+     */
+    template <class Calculator>
+    void add_calculator(Calculator                 &calculator,
+                        const std::vector<map_key> &transitions,
+                        const double                E_loss = 0.0)
+    {
+        for(auto const &tx : transitions)
+            add_transition(tx.first, tx.second, calculator.get_transition(tx.first, tx.second), E_loss);
+    }
+
+    /// Return the number of subbands in each period
+    inline size_t get_nsb_period() const {return _nsb_period;}
+
+    Results run(const arma::vec    &N0,
+                const double        Te0,
+                const size_t        n_carriers,
+                const double        t_total,
+                const double        t_warmup,
+                const unsigned int  n_threads = 0,
+                const uint64_t      seed      = 1);
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
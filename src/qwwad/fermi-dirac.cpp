@@ -0,0 +1,307 @@
+/**
+ * \file   fermi-dirac.cpp
+ * \brief  Complete Fermi-Dirac integrals
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "fermi-dirac.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <gsl/gsl_sf_dilog.h>
+#include "constants.h"
+
+namespace QWWAD
+{
+using namespace constants;
+
+/// Lowest argument in the table of half-integer integrals
+static const double fd_x_min = -5.0;
+
+/// Highest argument in the table of half-integer integrals
+static const double fd_x_max = 40.0;
+
+/// Number of points in the table of half-integer integrals
+static const size_t fd_table_size = 4096;
+
+/**
+ * \brief Find the half-integer integrals of order 1/2, -1/2 and -3/2 by quadrature
+ *
+ * \param[in]  x      Argument
+ * \param[out] F_half  Integral of order 1/2
+ * \param[out] F_mhalf Integral of order -1/2
+ * \param[out] F_m3half Integral of order -3/2
+ *
+ * \details With \f$t = u^2\f$, each integrand is a smooth, even function of u, so
+ *          the trapezium rule converges exponentially.  The step is set by the
+ *          distance of the nearest pole of the occupation from the real axis, which
+ *          shrinks as \f$\pi/(2\sqrt{x})\f$ in the degenerate limit.  The order -3/2
+ *          integral is found as the derivative of the order -1/2 integral, to avoid
+ *          the singularity at t = 0.
+ */
+static void find_fermi_dirac_half_quadrature(const double  x,
+                                             double       &F_half,
+                                             double       &F_mhalf,
+                                             double       &F_m3half)
+{
+    const double u_max = sqrt(std::max(x, 0.0) + 50.0);
+    const double h     = std::min(0.05, 0.2/sqrt(std::max(x, 1.0)));
+    const size_t nu    = ceil(u_max/h);
+
+    double sum_half  = 0.0;
+    double sum_mhalf = 0.0;
+    double sum_m3half = 0.0;
+
+    for(size_t iu = 0; iu <= nu; ++iu)
+    {
+        const double u      = iu*h;
+        const double weight = (iu == 0) ? 0.5 : 1.0;
+        const double f      = 1.0/(1.0 + exp(u*u - x)); // Occupation
+
+        sum_half   += weight*u*u*f;
+        sum_mhalf  += weight*f;
+        sum_m3half += weight*f*(1.0 - f);
+    }
+
+    const double sqrt_pi = sqrt(pi);
+    F_half   = 2.0*h*sum_half/(0.5*sqrt_pi);
+    F_mhalf  = 2.0*h*sum_mhalf/sqrt_pi;
+    F_m3half = 2.0*h*sum_m3half/sqrt_pi;
+}
+
+/**
+ * \brief Table of the half-integer integrals, and their derivatives, on a uniform grid
+ */
+struct FermiDiracHalfTable
+{
+    std::vector<double> F_half;   ///< Integral of order 1/2
+    std::vector<double> F_mhalf;  ///< Integral of order -1/2
+    std::vector<double> F_m3half; ///< Integral of order -3/2
+    double              dx;       ///< Grid spacing
+
+    FermiDiracHalfTable() :
+        F_half(fd_table_size),
+        F_mhalf(fd_table_size),
+        F_m3half(fd_table_size),
+        dx((fd_x_max - fd_x_min)/(fd_table_size - 1))
+    {
+        for(size_t i = 0; i < fd_table_size; ++i)
+            find_fermi_dirac_half_quadrature(fd_x_min + i*dx, F_half[i], F_mhalf[i], F_m3half[i]);
+    }
+};
+
+/// Return the shared table, building it on first use
+static const FermiDiracHalfTable & get_half_table()
+{
+    static const FermiDiracHalfTable table;
+    return table;
+}
+
+/**
+ * \brief Interpolate a tabulated function, using its tabulated derivative
+ *
+ * \param[in] F    Function values
+ * \param[in] dFdx Derivative values
+ * \param[in] x    Argument, within the table
+ * \param[in] dx   Grid spacing
+ */
+static double interp_hermite(const std::vector<double> &F,
+                             const std::vector<double> &dFdx,
+                             const double               x,
+                             const double               dx)
+{
+    const double s  = (x - fd_x_min)/dx;
+    const size_t i  = std::min(static_cast<size_t>(s), fd_table_size - 2);
+    const double t  = s - i; // Fractional position in interval
+    const double t2 = t*t;
+    const double t3 = t2*t;
+
+    return (2*t3 - 3*t2 + 1)*F[i] + (t3 - 2*t2 + t)*dx*dFdx[i]
+         + (-2*t3 + 3*t2)*F[i+1] + (t3 - t2)*dx*dFdx[i+1];
+}
+
+/**
+ * \brief Find a half-integer integral in the nondegenerate limit
+ *
+ * \param[in] x Argument, well below zero
+ * \param[in] j Order
+ *
+ * \details This uses the series \f$F_j(x) = \sum_k (-1)^{k+1}\mbox{e}^{kx}/k^{j+1}\f$,
+ *          which converges quickly for \f$x < -5\f$.
+ */
+static double fermi_dirac_series(const double x,
+                                 const double j)
+{
+    const double ex = exp(x);
+    double term_exp = ex;
+    double sum      = 0.0;
+
+    for(unsigned int k = 1; k <= 12; ++k)
+    {
+        const double sign = (k % 2) ? 1.0 : -1.0;
+        sum      += sign*term_exp/pow(k, j+1);
+        term_exp *= ex;
+    }
+
+    return sum;
+}
+
+/**
+ * \brief Find a half-integer integral in the degenerate limit
+ *
+ * \param[in] x Argument, well above zero
+ * \param[in] j Order
+ *
+ * \details This uses the Sommerfeld expansion
+ *          \f[
+ *            F_j(x) = \frac{x^{j+1}}{\Gamma(j+2)}\left[1 + \sum_{k=1}
+ *                     2\eta(2k)\frac{\Gamma(j+2)}{\Gamma(j+2-2k)}x^{-2k}\right],
+ *          \f]
+ *          where \f$\eta\f$ is the Dirichlet eta function.  The exponentially small
+ *          correction vanishes for half-integer orders.
+ */
+static double fermi_dirac_sommerfeld(const double x,
+                                     const double j)
+{
+    // Dirichlet eta function at even integers, 2k = 2 to 12
+    const double pi2 = pi*pi;
+    const double pi4 = pi2*pi2;
+    const double pi6 = pi4*pi2;
+    const double zeta[6] = {pi2/6.0, pi4/90.0, pi6/945.0, pi4*pi4/9450.0, pi4*pi6/93555.0,
+                            691.0*pi6*pi6/638512875.0};
+
+    const double inv_x_sq = 1.0/(x*x);
+    double ratio  = 1.0; // Gamma(j+2)/Gamma(j+2-2k)
+    double x_pow  = 1.0; // x^{-2k}
+    double sum    = 1.0;
+
+    for(unsigned int k = 1; k <= 6; ++k)
+    {
+        ratio *= (j + 3 - 2*k)*(j + 2 - 2*k);
+        x_pow *= inv_x_sq;
+        const double eta = (1.0 - pow(2.0, 1.0 - 2*k))*zeta[k-1];
+        sum += 2.0*eta*ratio*x_pow;
+    }
+
+    return pow(x, j+1)/tgamma(j+2)*sum;
+}
+
+/**
+ * \brief Complete Fermi-Dirac integral of order -1
+ *
+ * \details \f$F_{-1}(x) = 1/(1+\mbox{e}^{-x})\f$
+ */
+double fermi_dirac_m1(const double x)
+{
+    return 1.0/(1.0 + exp(-x));
+}
+
+/**
+ * \brief Complete Fermi-Dirac integral of order -1/2
+ */
+double fermi_dirac_mhalf(const double x)
+{
+    if(x < fd_x_min)
+        return fermi_dirac_series(x, -0.5);
+
+    if(x > fd_x_max)
+        return fermi_dirac_sommerfeld(x, -0.5);
+
+    const auto &table = get_half_table();
+    return interp_hermite(table.F_mhalf, table.F_m3half, x, table.dx);
+}
+
+/**
+ * \brief Complete Fermi-Dirac integral of order 0
+ *
+ * \details \f$F_0(x) = \ln(1+\mbox{e}^x)\f$, which is rearranged to avoid
+ *          overflow for large x.
+ */
+double fermi_dirac_0(const double x)
+{
+    return (x > 0) ? x + log1p(exp(-x)) : log1p(exp(x));
+}
+
+/**
+ * \brief Complete Fermi-Dirac integral of order 1/2
+ */
+double fermi_dirac_half(const double x)
+{
+    if(x < fd_x_min)
+        return fermi_dirac_series(x, 0.5);
+
+    if(x > fd_x_max)
+        return fermi_dirac_sommerfeld(x, 0.5);
+
+    const auto &table = get_half_table();
+    return interp_hermite(table.F_half, table.F_mhalf, x, table.dx);
+}
+
+/**
+ * \brief Complete Fermi-Dirac integral of order 1
+ *
+ * \details \f$F_1(x) = -\mbox{Li}_2(-\mbox{e}^x)\f$.  For positive x, the
+ *          reflection formula \f$F_1(x) = x^2/2 + \pi^2/6 - F_1(-x)\f$ is used, so
+ *          that the dilogarithm is only needed for small arguments.
+ */
+double fermi_dirac_1(const double x)
+{
+    if(x > 0)
+        return 0.5*x*x + pi*pi/6.0 + gsl_sf_dilog(-exp(-x));
+
+    return -gsl_sf_dilog(-exp(x));
+}
+
+/**
+ * \brief Apply a scalar function to every element of an array
+ */
+template <class F>
+static arma::vec apply_fermi_dirac(const arma::vec &x,
+                                   const F         &func)
+{
+    const size_t  n     = x.size();
+    arma::vec     F_out(n);
+    const double *x_in  = x.memptr();
+    double       *out   = F_out.memptr();
+
+    for(size_t i = 0; i < n; ++i)
+        out[i] = func(x_in[i]);
+
+    return F_out;
+}
+
+/// Complete Fermi-Dirac integral of order -1 for an array of arguments
+arma::vec fermi_dirac_m1(const arma::vec &x)
+{
+    return apply_fermi_dirac(x, [](const double xi) {return 1.0/(1.0 + exp(-xi));});
+}
+
+/// Complete Fermi-Dirac integral of order -1/2 for an array of arguments
+arma::vec fermi_dirac_mhalf(const arma::vec &x)
+{
+    return apply_fermi_dirac(x, [](const double xi) {return fermi_dirac_mhalf(xi);});
+}
+
+/// Complete Fermi-Dirac integral of order 0 for an array of arguments
+arma::vec fermi_dirac_0(const arma::vec &x)
+{
+    return apply_fermi_dirac(x, [](const double xi) {
+        return (xi > 0) ? xi + log1p(exp(-xi)) : log1p(exp(xi));
+    });
+}
+
+/// Complete Fermi-Dirac integral of order 1/2 for an array of arguments
+arma::vec fermi_dirac_half(const arma::vec &x)
+{
+    return apply_fermi_dirac(x, [](const double xi) {return fermi_dirac_half(xi);});
+}
+
+/// Complete Fermi-Dirac integral of order 1 for an array of arguments
+arma::vec fermi_dirac_1(const arma::vec &x)
+{
+    return apply_fermi_dirac(x, [](const double xi) {return fermi_dirac_1(xi);});
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
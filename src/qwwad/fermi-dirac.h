@@ -0,0 +1,40 @@
+/**
+ * \file   fermi-dirac.h
+ * \brief  Complete Fermi-Dirac integrals
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_FERMI_DIRAC_H
+#define QWWAD_FERMI_DIRAC_H
+
+#include <armadillo>
+
+namespace QWWAD
+{
+/**
+ * \brief Complete Fermi-Dirac integrals
+ *
+ * \details All integrals use the normalised form
+ *          \f[
+ *            F_j(x) = \frac{1}{\Gamma(j+1)}\int_0^\infty \frac{t^j}{1 + \mbox{e}^{t-x}}\,\mbox{d}t,
+ *          \f]
+ *          which matches the GSL special functions, so that \f$F_j'(x) = F_{j-1}(x)\f$.
+ *          The integer orders have closed forms.  The half-integer orders use a
+ *          table that is built once on first use, with series in the
+ *          nondegenerate and degenerate limits.  Each function costs O(1), and the
+ *          array versions loop over contiguous memory.
+ */
+double fermi_dirac_m1   (const double x);
+double fermi_dirac_mhalf(const double x);
+double fermi_dirac_0    (const double x);
+double fermi_dirac_half (const double x);
+double fermi_dirac_1    (const double x);
+
+arma::vec fermi_dirac_m1   (const arma::vec &x);
+arma::vec fermi_dirac_mhalf(const arma::vec &x);
+arma::vec fermi_dirac_0    (const arma::vec &x);
+arma::vec fermi_dirac_half (const arma::vec &x);
+arma::vec fermi_dirac_1    (const arma::vec &x);
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -7,11 +7,13 @@
 #include "fermi.h"
 
 #include "constants.h"
+#include "fermi-dirac.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
 #include <stdexcept>
-#include <gsl/gsl_errno.h>
-#include <gsl/gsl_roots.h>
+#include <gsl/gsl_math.h>
 #include <gsl/gsl_sf_dilog.h>
-#include <gsl/gsl_sf_fermi_dirac.h>
 
 namespace QWWAD
 {
@@ -31,6 +33,32 @@ double f_FD(const double E_F, const double E, const double Te)
     return 1.0/(exp((E-E_F)/(kB*Te)) + 1.0);
 }
 
+/**
+ * \brief Fermi occupation probability at a set of kinetic energies
+ *
+ * \param E_F Fermi energy, relative to subband minimum [J]
+ * \param Ek  Kinetic energies of electron [J]
+ * \param T   temperature [K]
+ *
+ * \returns Fermi occupation number at each energy
+ *
+ * \details The loop runs over contiguous memory without function calls other
+ *          than exp, so it can be vectorised by the compiler.
+ */
+arma::vec f_FD(const double E_F, const arma::vec &Ek, const double Te)
+{
+    const size_t  nE    = Ek.size();
+    arma::vec     f(nE);
+    const double  beta  = 1.0/(kB*Te);
+    const double *E_in  = Ek.memptr();
+    double       *f_out = f.memptr();
+
+    for(size_t iE = 0; iE < nE; ++iE)
+        f_out[iE] = 1.0/(exp((E_in[iE]-E_F)*beta) + 1.0);
+
+    return f;
+}
+
 /**
  * \brief Fermi ionisation probability with degeneracy of 2
  *
@@ -78,14 +106,14 @@ double find_pop(const double Esb,
     if(gsl_fcmp(alpha,0,1e-6) == 0)
     {
         // Solve Fermi integral (eq 2.66, QWWAD4)
-        N = rho_p*kB*Te*gsl_sf_fermi_dirac_0(x);
+        N = rho_p*kB*Te*fermi_dirac_0(x);
     }
     else
     {
         // Full non-parabolic solution (eq 2.69, QWWAD4)
         N = rho_p * kB*Te *(
-                (1.0 + 2.0 * alpha * (Esb-V)) * gsl_sf_fermi_dirac_0(x)
-                + 2*alpha*kB*Te * gsl_sf_fermi_dirac_1(x)
+                (1.0 + 2.0 * alpha * (Esb-V)) * fermi_dirac_0(x)
+                + 2*alpha*kB*Te * fermi_dirac_1(x)
                 );
     }
 
@@ -93,56 +121,291 @@ double find_pop(const double Esb,
 }
 
 /**
- * \brief Parameters used for checking the population
+ * \brief Find the rate of change of subband population with Fermi energy
+ *
+ * \param Esb   Energy of the subband minimum [J]
+ * \param E_F   Quasi-Fermi energy on the same absolute scale as the subband minimum [J]
+ * \param m0    Band-edge effective mass [kg]
+ * \param Te    Temperature of electron distribution [K]
+ * \param alpha Nonparabolicity parameter [1/J]
+ * \param V     Energy of the band edge [J]
+ *
+ * \returns The derivative of find_pop() with respect to E_F [m^{-2}J^{-1}]
+ *
+ * \details The derivative of the complete Fermi-Dirac integral of order j is the
+ *          integral of order j-1, and \f$F_{-1}(x) = 1/(1+\mbox{e}^{-x})\f$.
  */
-struct pop_params {
-    double Esb;     ///< Subband minimum [J]
-    double m0;      ///< Band-edge effective mass [kg]
-    double Te;      ///< Temperature of carrier distribution [K]
-    double alpha;   ///< Nonparabolicity [1/J]
-    double V;       ///< Band-edge [J]
-    double N;       ///< Population we expect to find [m^{-3}]
-};
+double find_pop_derivative(const double Esb,
+                           const double E_F,
+                           const double m0,
+                           const double Te,
+                           const double alpha,
+                           const double V)
+{
+    // Density of states in 2D system with parabolic dispersion
+    const double rho_p = m0/(pi*hBar*hBar);
+
+    const double x = (E_F - Esb)/(kB*Te); // Substitution to simplify the expression
+
+    if(gsl_fcmp(x,-700,1e-6) == -1)
+        return 0;
+
+    const double F_m1 = f_FD(E_F, Esb, Te);
+
+    if(gsl_fcmp(alpha,0,1e-6) == 0)
+        return rho_p*F_m1;
+
+    return rho_p * ((1.0 + 2.0 * alpha * (Esb-V)) * F_m1
+                    + 2*alpha*kB*Te * fermi_dirac_0(x));
+}
+
+/**
+ * \brief Find the population of a set of subbands with a common Fermi energy
+ *
+ * \param Esb   Energy of each subband minimum [J]
+ * \param E_F   Quasi-Fermi energy on the same absolute scale as the subband minima [J]
+ * \param m0    Band-edge effective mass [kg]
+ * \param Te    Temperature of electron distribution [K]
+ * \param alpha Nonparabolicity parameter [1/J]
+ * \param V     Energy of the band edge [J]
+ *
+ * \returns Population of each subband [m^{-2}]
+ *
+ * \details This gives the same result as find_pop() for each subband, but the
+ *          Fermi-Dirac integrals are found for all subbands at once.
+ */
+arma::vec find_pop(const arma::vec &Esb,
+                   const double     E_F,
+                   const double     m0,
+                   const double     Te,
+                   const double     alpha,
+                   const double     V)
+{
+    const size_t nst   = Esb.size();
+    const double rho_p = m0/(pi*hBar*hBar); // Parabolic 2D density of states
+    const double kT    = kB*Te;
+
+    arma::vec x(nst);
+
+    for(size_t ist = 0; ist < nst; ++ist)
+        x[ist] = (E_F - Esb[ist])/kT;
+
+    const arma::vec F_0 = fermi_dirac_0(x);
+    arma::vec       N(nst);
+
+    if(gsl_fcmp(alpha,0,1e-6) == 0)
+    {
+        for(size_t ist = 0; ist < nst; ++ist)
+            N[ist] = rho_p*kT*F_0[ist];
+    }
+    else
+    {
+        const arma::vec F_1 = fermi_dirac_1(x);
+
+        for(size_t ist = 0; ist < nst; ++ist)
+            N[ist] = rho_p*kT*((1.0 + 2.0*alpha*(Esb[ist]-V))*F_0[ist] + 2*alpha*kT*F_1[ist]);
+    }
+
+    // In case of underflow, use a tiny value, as in the single-subband version
+    for(size_t ist = 0; ist < nst; ++ist)
+    {
+        if(gsl_fcmp(x[ist],-700,1e-6) == -1)
+            N[ist] = 1;
+    }
+
+    return N;
+}
 
 /**
- * \brief Find the error in population for a given Fermi energy
+ * \brief Find the carrier density in a bulk band with a known Fermi energy
+ *
+ * \param Ec  Energy of the band edge [J]
+ * \param E_F Fermi energy on the same absolute scale as the band edge [J]
+ * \param m   Density-of-states effective mass [kg]
+ * \param Te  Temperature of carrier distribution [K]
+ *
+ * \returns Carrier density [m^{-3}]
+ *
+ * \details For a parabolic band, \f$n = N_c F_{1/2}((E_F - E_c)/kT)\f$, where
+ *          \f$N_c = 2(mkT/2\pi\hbar^2)^{3/2}\f$ is the effective density of states.
  */
-double find_pop_error(double E_F, void *params)
+double find_pop_3D(const double Ec,
+                   const double E_F,
+                   const double m,
+                   const double Te)
 {
-    const pop_params *p = reinterpret_cast<pop_params *>(params);
-    return find_pop(p->Esb, E_F, p->m0, p->Te, p->alpha, p->V) - p->N;
+    const double N_c = 2.0*pow(m*kB*Te/(2.0*pi*hBar*hBar), 1.5);
+    return N_c*fermi_dirac_half((E_F - Ec)/(kB*Te));
 }
 
 /**
- * \brief Parameters used for checking the population of multiple subbands
+ * \brief Find a Fermi energy using Newton's method, safeguarded by bisection
+ *
+ * \param[in] pop_error Function returning the error in population for a given Fermi
+ *                      energy, and setting its derivative
+ * \param[in] E_min     Lower limit of the search [J]
+ * \param[in] E_max     Upper limit of the search [J]
+ * \param[in] E_guess   Starting point for the search [J]
+ *
+ * \details The bracket is narrowed at each step.  Whenever a Newton step would
+ *          leave the bracket, a bisection step is taken instead, so the search
+ *          always converges, but it is usually quadratic.
  */
-struct total_pop_params {
-    arma::vec Esb;   ///< Subband minimum [J]
-    double    m0;    ///< Band-edge effective mass [kg]
-    double    Te;    ///< Temperature of carrier distribution [K]
-    double    alpha; ///< Nonparabolicity [1/J]
-    double    V;     ///< Band-edge [J]
-    double    N;     ///< Population we expect to find [m^{-3}]
-};
+template <class F>
+static double find_fermi_newton(const F &pop_error,
+                                double   E_min,
+                                double   E_max,
+                                double   E_guess)
+{
+    const double tol      = 1e-8*e; // Tolerance for Fermi energy [J]
+    const size_t max_iter = 200;
+
+    double dN_dE = 0.0; // Derivative of population error [m^{-2}J^{-1}]
+
+    // Find the signs of ∫f(E_min) - N at the endpoints and make sure that
+    // E_min is always on the negative side
+    const int sign_min = GSL_SIGN(pop_error(E_min, dN_dE));
+    const int sign_max = GSL_SIGN(pop_error(E_max, dN_dE));
+
+    // We can solve the Fermi integral only if there is a sign-change
+    // between the limits
+    if(sign_min == sign_max)
+        throw std::runtime_error("No quasi-Fermi energy in range.");
+
+    if(sign_min > 0)
+        std::swap(E_min, E_max);
+
+    double E_F = E_guess;
+
+    if(!(E_F > std::min(E_min, E_max) && E_F < std::max(E_min, E_max)))
+        E_F = 0.5*(E_min + E_max);
+
+    for(unsigned int iter = 0; iter < max_iter; ++iter)
+    {
+        const double dN = pop_error(E_F, dN_dE);
+
+        if(dN == 0.0)
+            return E_F;
+
+        if(dN < 0.0)
+            E_min = E_F;
+        else
+            E_max = E_F;
+
+        double E_next = E_F - dN/dN_dE;
+
+        if(!(dN_dE > 0.0) ||
+           !(E_next > std::min(E_min, E_max) && E_next < std::max(E_min, E_max)))
+            E_next = 0.5*(E_min + E_max);
+
+        if(fabs(E_next - E_F) < tol || fabs(E_max - E_min) < tol)
+            return E_next;
+
+        E_F = E_next;
+    }
+
+    throw std::runtime_error("Quasi-Fermi energy search did not converge.");
+}
 
 /**
- * \brief Find the error in the total population for multiple subbands
+ * \brief Find the density-of-states weight for each subband
+ *
+ * \param[in] Esb   Energy of each subband minimum [J]
+ * \param[in] rho_p Parabolic 2D density of states [J^{-1}m^{-2}]
+ * \param[in] alpha Nonparabolicity parameter [1/J]
+ * \param[in] V     Energy of the band edge [J]
+ *
+ * \returns The coefficient of the zeroth-order Fermi-Dirac integral in the
+ *          population of each subband [J^{-1}m^{-2}]
+ *
+ * \details These do not depend on the Fermi energy or temperature, so they are
+ *          found once and shared between every step of every search.
  */
-double find_total_pop_error(double E_F, void *params)
+static arma::vec find_dos_weights(const arma::vec &Esb,
+                                  const double     rho_p,
+                                  const double     alpha,
+                                  const double     V)
 {
-    const total_pop_params *p = reinterpret_cast<total_pop_params *>(params);
+    arma::vec w(Esb.size());
+
+    for(unsigned int ist = 0; ist < Esb.size(); ++ist)
+        w[ist] = (gsl_fcmp(alpha,0,1e-6) == 0) ? rho_p : rho_p*(1.0 + 2.0*alpha*(Esb[ist]-V));
+
+    return w;
+}
+
+/**
+ * \brief Find the Fermi energy for a set of subbands using Newton's method
+ *
+ * \param[in] Esb        Energy of each subband minimum [J]
+ * \param[in] dos_weight Density-of-states weight for each subband, from find_dos_weights
+ * \param[in] rho_p      Parabolic 2D density of states [J^{-1}m^{-2}]
+ * \param[in] alpha      Nonparabolicity parameter [1/J]
+ * \param[in] N          Total population [m^{-2}]
+ * \param[in] Te         Temperature of carrier distribution [K]
+ * \param[in] E_guess    Initial guess for the Fermi energy [J]
+ *
+ * \details The search range is wide enough for any sensible population.  The
+ *          initial guess is used if it lies within the range.  The total
+ *          population and its derivative are found together, in the same way as
+ *          find_pop() and find_pop_derivative().
+ */
+static double find_fermi_global_newton(const arma::vec &Esb,
+                                       const arma::vec &dos_weight,
+                                       const double     rho_p,
+                                       const double     alpha,
+                                       const double     N,
+                                       const double     Te,
+                                       const double     E_guess)
+{
+    const size_t nst = Esb.size();
+
+    if(nst == 0)
+        throw std::length_error("Cannot find Fermi energy without any subbands.");
+
+    const double kT           = kB*Te;
+    const bool   parabolic    = (gsl_fcmp(alpha,0,1e-6) == 0);
+    const double rho_alpha_kT = 2*alpha*kT*rho_p; // Coefficient of first-order integral
 
     // Find total population in each subband, using the same global Fermi
     // energy
-    double N_total = 0.0;
-    const size_t nst = p->Esb.size();
+    auto pop_error = [&](const double E_F, double &dN_dE) {
+        double N_total = 0.0;
+        dN_dE = 0.0;
 
-    for(unsigned int ist = 0; ist < nst; ist++)
-        N_total += find_pop(p->Esb[ist], E_F, p->m0, p->Te, p->alpha, p->V);
+        for(unsigned int ist = 0; ist < nst; ist++)
+        {
+            const double x = (E_F - Esb[ist])/kT;
 
-    return N_total - p->N;
-}
+            // In case of underflow, use a tiny population
+            if(gsl_fcmp(x,-700,1e-6) == -1)
+            {
+                N_total += 1;
+                continue;
+            }
+
+            const double F_0  = fermi_dirac_0(x);
+            const double F_m1 = 1.0/(1.0 + exp(-x));
+
+            N_total += kT*dos_weight[ist]*F_0;
+            dN_dE   += dos_weight[ist]*F_m1;
 
+            if(!parabolic)
+            {
+                N_total += kT*rho_alpha_kT*fermi_dirac_1(x);
+                dN_dE   += rho_alpha_kT*F_0;
+            }
+        }
+
+        return N_total - N;
+    };
+
+    // Set limits for search [J]
+    const double E_min=Esb[0]-100.0*kB*Te;
+    const double E_max=Esb[nst-1]+500.0*kB*Te;
+
+    return find_fermi_newton(pop_error, E_min, E_max, E_guess);
+}
 
 /** 
  * \brief Find quasi-Fermi energy for a single subband with known population and temperature
@@ -187,42 +450,15 @@ double find_fermi(const double Esb,
     else
     {
         // Set limits for search [J]
-        double E_min=Esb-100.0*kB*Te;
-        double E_max=Esb+100.0*kB*Te;
-
-        // Set parameters for search
-        pop_params params = {Esb, m, Te, alpha, V, N};
+        const double E_min=Esb-100.0*kB*Te;
+        const double E_max=Esb+100.0*kB*Te;
 
-        // Find the signs of ∫f(E_min) - N at the endpoints
-        const int sign_min=GSL_SIGN(find_pop_error(E_min, &params));
-        const int sign_max=GSL_SIGN(find_pop_error(E_max, &params));
+        auto pop_error = [&](const double E, double &dN_dE) {
+            dN_dE = find_pop_derivative(Esb, E, m, Te, alpha, V);
+            return find_pop(Esb, E, m, Te, alpha, V) - N;
+        };
 
-        // We can solve the Fermi integral only if there is a sign-change 
-        // between the limits
-        const bool solvable=!(sign_min==sign_max);
-
-        if(solvable)
-        {
-            gsl_function F;
-            F.function = &find_pop_error;
-            F.params   = &params;
-            gsl_root_fsolver *solver = gsl_root_fsolver_alloc(gsl_root_fsolver_brent);
-            gsl_root_fsolver_set(solver, &F, E_min, E_max);
-
-            int status;
-            // Solve iteratively
-            do
-            {
-                status = gsl_root_fsolver_iterate(solver);
-                E_F   = gsl_root_fsolver_root(solver);
-                E_min = gsl_root_fsolver_x_lower(solver);
-                E_max = gsl_root_fsolver_x_upper(solver);
-                status = gsl_root_test_interval(E_min, E_max, 1e-8*e, 0);
-            }while(status == GSL_CONTINUE);
-
-            gsl_root_fsolver_free(solver);
-        }
-        else throw std::runtime_error("No quasi-Fermi energy in range.");
+        E_F = find_fermi_newton(pop_error, E_min, E_max, Esb);
     }
 
     return E_F;
@@ -276,48 +512,151 @@ double find_fermi_global(const arma::vec &Esb,
 {
     const size_t nst = Esb.size();
 
-    // Set limits for search [J]
-    double E_min=Esb[0]-100.0*kB*Te;
-    double E_max=Esb[nst-1]+500.0*kB*Te;
+    if(nst == 0)
+        throw std::length_error("Cannot find Fermi energy without any subbands.");
 
-    // Find bisector of the limits [J]
-    double E_F=(E_min+E_max)/2.0;
+    const double    rho_p = m0/(pi*hBar*hBar); // Parabolic 2D density of states
+    const arma::vec w     = find_dos_weights(Esb, rho_p, alpha, V);
 
-    // Set parameters for search
-    total_pop_params params = {Esb, m0, Te, alpha, V, N};
+    return find_fermi_global_newton(Esb, w, rho_p, alpha, N, Te, 0.5*(Esb[0] + Esb[nst-1]));
+}
 
-    // Find the signs of ∫f(E_min) - N at the endpoints
-    const int sign_min=GSL_SIGN(find_total_pop_error(E_min, &params));
-    const int sign_max=GSL_SIGN(find_total_pop_error(E_max, &params));
+/**
+ * \brief Find the quasi-Fermi energy of a subband for a set of populations and temperatures
+ *
+ * \param[in] Esb   Energy of the subband minimum [J]
+ * \param[in] m     Mass of carriers [kg]
+ * \param[in] N     Population density for each case [m^{-2}]
+ * \param[in] Te    Temperature of carrier distribution for each case [K]
+ * \param[in] alpha Nonparabolicity parameter [1/J]
+ * \param[in] V     Band-edge [J]
+ *
+ * \returns The Fermi energy for each case [J]
+ *
+ * \details For parabolic bands, the analytical form is evaluated over the whole
+ *          array at once.  Otherwise, each search starts from the previous result,
+ *          so a smooth sweep needs only a few Newton steps per point.
+ */
+arma::vec find_fermi_batch(const double     Esb,
+                           const double     m,
+                           const arma::vec &N,
+                           const arma::vec &Te,
+                           const double     alpha,
+                           const double     V)
+{
+    if(N.size() != Te.size())
+    {
+        std::ostringstream oss;
+        oss << "Got " << N.size() << " populations and " << Te.size() << " temperatures.";
+        throw std::length_error(oss.str());
+    }
 
-    // We can solve the Fermi integral only if there is a sign-change 
-    // between the limits
-    const bool solvable=!(sign_min==sign_max);
+    const size_t n = N.size();
+    arma::vec E_F(n);
 
-    if(solvable)
+    if(gsl_fcmp(alpha, 0.0, 1.0e-6) == 0)
+    {
+        // Eq. 2.85, QWWAD4
+        for(unsigned int i = 0; i < n; ++i)
+            E_F[i] = Esb + kB*Te[i] * log(std::expm1((N[i]*pi*hBar*hBar)/(m*kB*Te[i])));
+    }
+    else
     {
-        gsl_function F;
-        F.function = &find_total_pop_error;
-        F.params   = &params;
-        gsl_root_fsolver *solver = gsl_root_fsolver_alloc(gsl_root_fsolver_brent);
-        gsl_root_fsolver_set(solver, &F, E_min, E_max);
-
-        int status;
-        // Solve iteratively
-        do
+        double E_guess = Esb;
+
+        for(unsigned int i = 0; i < n; ++i)
         {
-            status = gsl_root_fsolver_iterate(solver);
-            E_F   = gsl_root_fsolver_root(solver);
-            E_min = gsl_root_fsolver_x_lower(solver);
-            E_max = gsl_root_fsolver_x_upper(solver);
-            status = gsl_root_test_interval(E_min, E_max, 1e-8*e, 0);
-        }while(status == GSL_CONTINUE);
-
-        gsl_root_fsolver_free(solver);
+            auto pop_error = [&](const double E, double &dN_dE) {
+                dN_dE = find_pop_derivative(Esb, E, m, Te[i], alpha, V);
+                return find_pop(Esb, E, m, Te[i], alpha, V) - N[i];
+            };
+
+            E_F[i]  = find_fermi_newton(pop_error, Esb-100.0*kB*Te[i], Esb+100.0*kB*Te[i], E_guess);
+            E_guess = E_F[i];
+        }
+    }
+
+    return E_F;
+}
+
+/**
+ * \brief Find the Fermi energy of a 2D system for a set of total populations and temperatures
+ *
+ * \param[in] Esb   Array of subband minima [J]
+ * \param[in] m0    Mass of carriers at band edge [kg]
+ * \param[in] N     Population density of system for each case [m^{-2}]
+ * \param[in] Te    Temperature of carrier distribution for each case [K]
+ * \param[in] alpha Nonparabolicity parameter [1/J]
+ * \param[in] V     Band-edge [J]
+ *
+ * \returns The Fermi energy for each case [J]
+ *
+ * \details The same subband minima and density-of-states weights are used for
+ *          every case, and each search starts from the previous result.
+ */
+arma::vec find_fermi_global_batch(const arma::vec &Esb,
+                                  const double     m0,
+                                  const arma::vec &N,
+                                  const arma::vec &Te,
+                                  const double     alpha,
+                                  const double     V)
+{
+    if(N.size() != Te.size())
+    {
+        std::ostringstream oss;
+        oss << "Got " << N.size() << " populations and " << Te.size() << " temperatures.";
+        throw std::length_error(oss.str());
+    }
+
+    if(Esb.size() == 0)
+        throw std::length_error("Cannot find Fermi energy without any subbands.");
+
+    const double    rho_p = m0/(pi*hBar*hBar); // Parabolic 2D density of states
+    const arma::vec w     = find_dos_weights(Esb, rho_p, alpha, V);
+
+    arma::vec E_F(N.size());
+    double E_guess = 0.5*(Esb[0] + Esb[Esb.size()-1]);
+
+    for(unsigned int i = 0; i < N.size(); ++i)
+    {
+        E_F[i]  = find_fermi_global_newton(Esb, w, rho_p, alpha, N[i], Te[i], E_guess);
+        E_guess = E_F[i];
     }
-    else throw std::runtime_error("No quasi-Fermi energy in range.");
 
     return E_F;
 }
+
+/**
+ * \brief Find the Fermi energy and subband populations for a set of total populations
+ *        and temperatures
+ *
+ * \param[in]  Esb   Array of subband minima [J]
+ * \param[in]  m0    Mass of carriers at band edge [kg]
+ * \param[in]  N     Population density of system for each case [m^{-2}]
+ * \param[in]  Te    Temperature of carrier distribution for each case [K]
+ * \param[out] E_F   The Fermi energy for each case [J]
+ * \param[in]  alpha Nonparabolicity parameter [1/J]
+ * \param[in]  V     Band-edge [J]
+ *
+ * \returns The population of each subband (one column per subband) for each case
+ *          (one row per case) [m^{-2}]
+ */
+arma::mat find_pop_global_batch(const arma::vec &Esb,
+                                const double     m0,
+                                const arma::vec &N,
+                                const arma::vec &Te,
+                                arma::vec       &E_F,
+                                const double     alpha,
+                                const double     V)
+{
+    E_F = find_fermi_global_batch(Esb, m0, N, Te, alpha, V);
+
+    arma::mat pop(N.size(), Esb.size());
+
+    for(unsigned int i = 0; i < N.size(); ++i)
+        pop.row(i) = find_pop(Esb, E_F[i], m0, Te[i], alpha, V).t();
+
+    return pop;
+}
 } // namespace
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
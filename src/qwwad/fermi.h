@@ -14,6 +14,8 @@ namespace QWWAD
 {
 double f_FD(const double E_F, const double Ek, const double Te);
 
+arma::vec f_FD(const double E_F, const arma::vec &Ek, const double Te);
+
 double f_FD_ionised(const double E_F, const double Ed, const double Te);
 
 double find_pop(const double Esb,
@@ -23,6 +25,25 @@ double find_pop(const double Esb,
                 const double alpha=0,
                 const double V=0);
 
+double find_pop_derivative(const double Esb,
+                           const double E_F,
+                           const double md,
+                           const double Te,
+                           const double alpha=0,
+                           const double V=0);
+
+arma::vec find_pop(const arma::vec &Esb,
+                   const double     E_F,
+                   const double     m0,
+                   const double     Te,
+                   const double     alpha=0,
+                   const double     V=0);
+
+double find_pop_3D(const double Ec,
+                   const double E_F,
+                   const double m,
+                   const double Te);
+
 double find_fermi(const double Esb,
                   const double m0,
                   const double N,
@@ -43,6 +64,28 @@ double find_fermi_global(const std::vector<Eigenstate> &states,
                          const double                   Te,
                          const double                   alpha=0,
                          const double                   V=0);
+
+arma::vec find_fermi_batch(const double     Esb,
+                           const double     m0,
+                           const arma::vec &N,
+                           const arma::vec &Te,
+                           const double     alpha=0,
+                           const double     V=0);
+
+arma::vec find_fermi_global_batch(const arma::vec &Esb,
+                                  const double     m0,
+                                  const arma::vec &N,
+                                  const arma::vec &Te,
+                                  const double     alpha=0,
+                                  const double     V=0);
+
+arma::mat find_pop_global_batch(const arma::vec &Esb,
+                                const double     m0,
+                                const arma::vec &N,
+                                const arma::vec &Te,
+                                arma::vec       &E_F,
+                                const double     alpha=0,
+                                const double     V=0);
 } // namespace
 #endif
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
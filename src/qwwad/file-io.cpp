@@ -6,6 +6,36 @@
  */
 
 #include "file-io.h"
+#include "checkpoint.h"
+#include "parallel.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#if HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
+#if HAVE_ZLIB
+# include <zlib.h>
+#endif
+
+#if HAVE_ZSTD
+# include <zstd.h>
+#endif
 
 namespace QWWAD
 {
@@ -39,6 +69,1720 @@ const char * FileLinesNotAsExpected::what() const throw()
 
 }
 
+namespace
+{
+/**
+ * \brief Check whether a buffer starts with a given sequence of bytes
+ */
+bool has_magic(const char          *data,
+               const size_t         size,
+               const unsigned char *magic,
+               const size_t         n)
+{
+    return size >= n && std::equal(magic, magic + n, reinterpret_cast<const unsigned char *>(data));
+}
+
+const unsigned char gzip_magic[] = {0x1f, 0x8b};
+const unsigned char zstd_magic[] = {0x28, 0xb5, 0x2f, 0xfd};
+
+#if HAVE_ZLIB
+/**
+ * \brief Decompress the contents of a gzip file
+ *
+ * \param[in] data  Contents of the file
+ * \param[in] size  Number of bytes in the file
+ * \param[in] fname Name of the file, used in error messages
+ * \param[in] emit  Function that receives each piece of decompressed data
+ *
+ * \details Files made by concatenating several gzip files are read in full.
+ */
+void inflate_gzip(const char                                      *data,
+                  const size_t                                     size,
+                  const std::string                               &fname,
+                  const std::function<void (const char *, size_t)> &emit)
+{
+    std::vector<char> chunk(1 << 18);
+
+    z_stream strm = z_stream();
+
+    // Accept either a zlib or gzip header
+    if(inflateInit2(&strm, 15 + 32) != Z_OK)
+        throw std::runtime_error("Could not initialise zlib decompression");
+
+    const char *next = data;
+    size_t      left = size;
+
+    for(;;)
+    {
+        // zlib counts input in unsigned ints, so very large files are fed in pieces
+        if(strm.avail_in == 0)
+        {
+            const size_t n_in = std::min(left, static_cast<size_t>(1) << 30);
+            strm.next_in  = reinterpret_cast<Bytef *>(const_cast<char *>(next));
+            strm.avail_in = n_in;
+            next += n_in;
+            left -= n_in;
+        }
+
+        strm.next_out  = reinterpret_cast<Bytef *>(&chunk[0]);
+        strm.avail_out = chunk.size();
+
+        const int status = inflate(&strm, Z_NO_FLUSH);
+        emit(&chunk[0], chunk.size() - strm.avail_out);
+
+        if(status == Z_STREAM_END)
+        {
+            // Carry on with the next member of the file, if there is one
+            if(strm.avail_in == 0 && left == 0)
+                break;
+
+            inflateReset(&strm);
+        }
+        else if(status != Z_OK)
+        {
+            inflateEnd(&strm);
+            std::ostringstream oss;
+            oss << "Could not decompress " << fname << ": the file is corrupt or incomplete";
+            throw std::runtime_error(oss.str());
+        }
+    }
+
+    inflateEnd(&strm);
+}
+#endif
+
+#if HAVE_ZSTD
+/**
+ * \brief Decompress the contents of a zstd file
+ *
+ * \param[in] data  Contents of the file
+ * \param[in] size  Number of bytes in the file
+ * \param[in] fname Name of the file, used in error messages
+ * \param[in] emit  Function that receives each piece of decompressed data
+ */
+void decompress_zstd(const char                                      *data,
+                     const size_t                                     size,
+                     const std::string                               &fname,
+                     const std::function<void (const char *, size_t)> &emit)
+{
+    std::vector<char> chunk(ZSTD_DStreamOutSize());
+
+    ZSTD_DStream *strm = ZSTD_createDStream();
+
+    if(strm == NULL)
+        throw std::runtime_error("Could not initialise zstd decompression");
+
+    ZSTD_inBuffer in = {data, size, 0};
+    size_t status = 0;
+
+    while(in.pos < in.size)
+    {
+        ZSTD_outBuffer buf = {&chunk[0], chunk.size(), 0};
+        status = ZSTD_decompressStream(strm, &buf, &in);
+
+        if(ZSTD_isError(status))
+            break;
+
+        emit(&chunk[0], buf.pos);
+    }
+
+    ZSTD_freeDStream(strm);
+
+    // A non-zero status means that the last frame was cut short
+    if(ZSTD_isError(status) || status != 0)
+    {
+        std::ostringstream oss;
+        oss << "Could not decompress " << fname << ": the file is corrupt or incomplete";
+        throw std::runtime_error(oss.str());
+    }
+}
+#endif
+
+/**
+ * \brief Decompress the contents of a file, if they are compressed
+ *
+ * \param[in] data  Contents of the file
+ * \param[in] size  Number of bytes in the file
+ * \param[in] fname Name of the file, used in error messages
+ * \param[in] emit  Function that receives each piece of decompressed data
+ *
+ * \returns True if the file was compressed
+ */
+bool decompress_file(const char                                      *data,
+                     const size_t                                     size,
+                     const std::string                               &fname,
+                     const std::function<void (const char *, size_t)> &emit)
+{
+    const char *format = NULL;
+
+    if(has_magic(data, size, gzip_magic, sizeof(gzip_magic)))
+    {
+#if HAVE_ZLIB
+        inflate_gzip(data, size, fname, emit);
+        return true;
+#else
+        format = "gzip";
+#endif
+    }
+    else if(has_magic(data, size, zstd_magic, sizeof(zstd_magic)))
+    {
+#if HAVE_ZSTD
+        decompress_zstd(data, size, fname, emit);
+        return true;
+#else
+        format = "zstd";
+#endif
+    }
+    else
+        return false;
+
+    std::ostringstream oss;
+    oss << fname << " is compressed with " << format
+        << ", but QWWAD was built without " << format << " support";
+    throw std::runtime_error(oss.str());
+}
+
+/// Smallest block of decompressed text that is passed to a parser [bytes]
+const size_t text_block_size = 1 << 22;
+
+/**
+ * \brief Collects decompressed text into blocks of whole lines
+ */
+class TextBlocker
+{
+public:
+    explicit TextBlocker(const text_block_parser &parse) :
+        _parse(parse)
+    {}
+
+    /**
+     * \brief Add a piece of decompressed text, and parse any complete block of lines
+     */
+    void append(const char   *data,
+                const size_t  n)
+    {
+        _block.append(data, n);
+
+        if(_block.size() < text_block_size)
+            return;
+
+        const auto last_newline = _block.rfind('\n');
+
+        if(last_newline == std::string::npos)
+            return;
+
+        // Keep the start of any unfinished line for the next block
+        std::string rest(_block, last_newline + 1);
+        _block.resize(last_newline + 1);
+        _parse(_block.c_str(), _block.c_str() + _block.size());
+        _block.swap(rest);
+    }
+
+    /**
+     * \brief Parse the last block of text
+     */
+    void finish()
+    {
+        if(!_block.empty())
+            _parse(_block.c_str(), _block.c_str() + _block.size());
+
+        _block.clear();
+    }
+
+private:
+    const text_block_parser &_parse; ///< Parser for each block
+    std::string              _block; ///< Text that has not yet been parsed
+};
+} // namespace
+
+/**
+ * \brief Load the contents of a text file
+ *
+ * \param[in] fname The name of the file
+ */
+TextFileBuffer::TextFileBuffer(const std::string &fname) :
+    _data(NULL),
+    _size(0),
+    _mapped(false),
+    _contents()
+{
+    // Make sure the file isn't still waiting to be written in the background
+    wait_for_async_file(fname);
+
+#if HAVE_SYS_MMAN_H
+    const int fd = open(fname.c_str(), O_RDONLY);
+
+    if(fd >= 0)
+    {
+        struct stat st;
+        const long page_size = sysconf(_SC_PAGESIZE);
+
+        // The mapping is only null-terminated if the file doesn't fill its last page,
+        // so fall back to copying the file otherwise
+        if(fstat(fd, &st) == 0 && st.st_size > 0 && page_size > 0 && st.st_size % page_size != 0)
+        {
+            void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if(addr != MAP_FAILED)
+            {
+                _data   = static_cast<const char *>(addr);
+                _size   = st.st_size;
+                _mapped = true;
+            }
+        }
+
+        close(fd);
+    }
+#endif
+
+    if(!_mapped)
+    {
+        std::ifstream stream(fname.c_str(), std::ios::binary);
+
+        if(!stream.is_open())
+        {
+            std::ostringstream oss;
+            oss << "Could not open " << fname;
+            throw std::runtime_error(oss.str());
+        }
+
+        stream.seekg(0, std::ios::end);
+        _contents.resize(stream.tellg());
+        stream.seekg(0, std::ios::beg);
+
+        if(!_contents.empty())
+            stream.read(&_contents[0], _contents.size());
+
+        _data = _contents.c_str();
+        _size = _contents.size();
+    }
+}
+
+TextFileBuffer::~TextFileBuffer()
+{
+#if HAVE_SYS_MMAN_H
+    if(_mapped)
+        munmap(const_cast<char *>(_data), _size);
+#endif
+}
+
+/**
+ * \brief Pass the contents of a text file to a parser, in blocks of whole lines
+ *
+ * \param[in] fname The name of the file
+ * \param[in] parse Function that parses the text between two pointers.  The text
+ *                  is always followed by a null character.
+ *
+ * \details An uncompressed file is passed to the parser as a single block,
+ *          straight from its TextFileBuffer.  A file that was compressed with gzip
+ *          or zstd is recognised from its first few bytes, whatever its name, and
+ *          is decompressed a few megabytes at a time.  Each block ends at a line
+ *          break, so the whole of the decompressed text is never held in memory.
+ */
+void read_text_blocks(const std::string       &fname,
+                      const text_block_parser &parse)
+{
+    const TextFileBuffer buffer(fname);
+    TextBlocker          blocker(parse);
+
+    const auto compressed = decompress_file(buffer.begin(), buffer.end() - buffer.begin(), fname,
+                                            [&blocker](const char *data, const size_t n) {
+                                                blocker.append(data, n);
+                                            });
+
+    if(compressed)
+        blocker.finish();
+    else
+        parse(buffer.begin(), buffer.end());
+}
+
+namespace
+{
+/// Identifier at the start of every table in a pipe
+const char pipe_magic[8] = {'Q','W','W','A','D','P','I','P'};
+
+/// All the tables that have been received from, or will be sent to, a pipe
+struct PipeData
+{
+    PipeData() :
+        input(false),
+        loaded(false),
+        input_fd(STDIN_FILENO),
+        output_fd(-1),
+        project(),
+        modified(false)
+    {}
+
+    std::mutex                        mutex;     ///< Lock for all the data
+    bool                              input;     ///< True if tables are read from standard input
+    bool                              loaded;    ///< True if standard input has been read
+    int                               input_fd;  ///< File from which tables are read
+    int                               output_fd; ///< File to which tables are sent (-1 = none)
+    std::string                       project;   ///< Project file that holds all tables (if any)
+    bool                              modified;  ///< True if any table has changed since it was read
+    std::map<std::string, PipedTable> tables;    ///< Tables, indexed by filename
+};
+
+PipeData & get_pipe_data()
+{
+    static PipeData data;
+    return data;
+}
+
+/**
+ * \brief Read a block of data from a file descriptor
+ *
+ * \param[in]  fd     File descriptor
+ * \param[out] dest   Destination for the data
+ * \param[in]  n      Number of bytes to read
+ * \param[in]  source Description of the input, for error messages
+ *
+ * \returns False if the end of the file was reached before any data were read
+ */
+bool read_bytes(const int          fd,
+                void              *dest,
+                const size_t       n,
+                const std::string &source)
+{
+    auto p = static_cast<char *>(dest);
+    size_t nread = 0;
+
+    while(nread < n)
+    {
+        const auto result = read(fd, p + nread, n - nread);
+
+        if(result < 0 && errno == EINTR)
+            continue;
+
+        if(result <= 0)
+        {
+            if(nread == 0)
+                return false;
+
+            std::ostringstream oss;
+            oss << source << " ends part-way through a table.";
+            throw std::runtime_error(oss.str());
+        }
+
+        nread += result;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Write a block of data to a file descriptor
+ */
+void write_bytes(const int fd, const void *src, const size_t n)
+{
+    auto p = static_cast<const char *>(src);
+    size_t nwritten = 0;
+
+    while(nwritten < n)
+    {
+        const auto result = write(fd, p + nwritten, n - nwritten);
+
+        if(result < 0 && errno == EINTR)
+            continue;
+
+        if(result <= 0)
+            throw std::runtime_error("Could not send table through pipe.");
+
+        nwritten += result;
+    }
+}
+
+/**
+ * \brief Read all the tables from the standard input (or project file), if this hasn't been done yet
+ *
+ * \details Each table starts with an identifier, a type ('N' for numbers or
+ *          'T' for text) and the filename (with its length as a 32-bit integer).
+ *          A numeric table then has the number of rows and values (as 64-bit
+ *          integers), the number of values on each row (32-bit) and the values
+ *          themselves (64-bit floating point).  A text table has the number of
+ *          characters (64-bit), followed by the text.  All data are in the
+ *          native byte order, since pipes only connect programs on one computer.
+ *          A project file uses the same format.
+ */
+void load_pipe_input(PipeData &data)
+{
+    if(!data.input || data.loaded)
+        return;
+
+    data.loaded = true;
+
+    const std::string source = data.project.empty() ? std::string("Standard input")
+                                                    : "Project file " + data.project;
+
+    // Any read after the start of a table must succeed
+    auto read_rest = [&](void *dest, const size_t n) {
+        if(n > 0 && !read_bytes(data.input_fd, dest, n, source))
+        {
+            std::ostringstream oss;
+            oss << source << " ends part-way through a table.";
+            throw std::runtime_error(oss.str());
+        }
+    };
+
+    char magic[sizeof(pipe_magic)];
+
+    while(read_bytes(data.input_fd, magic, sizeof(magic), source))
+    {
+        char     type = 0;
+        uint32_t name_length = 0;
+
+        if(!std::equal(magic, magic + sizeof(magic), pipe_magic))
+        {
+            std::ostringstream oss;
+
+            if(data.project.empty())
+                oss << "Standard input does not contain QWWAD tables.";
+            else
+                oss << data.project << " is not a QWWAD project file.";
+
+            throw std::runtime_error(oss.str());
+        }
+
+        read_rest(&type, 1);
+        read_rest(&name_length, sizeof(name_length));
+
+        std::string name(name_length, '\0');
+        PipedTable  table;
+        read_rest(&name[0], name_length);
+
+        if(type == 'N')
+        {
+            uint64_t sizes[2] = {0, 0};
+            read_rest(sizes, sizeof(sizes));
+
+            table.row_lengths.resize(sizes[0]);
+            table.values.resize(sizes[1]);
+            read_rest(table.row_lengths.data(), sizes[0]*sizeof(uint32_t));
+            read_rest(table.values.data(), sizes[1]*sizeof(double));
+        }
+        else if(type == 'T')
+        {
+            uint64_t size = 0;
+            read_rest(&size, sizeof(size));
+
+            table.numeric = false;
+            table.text.resize(size);
+            read_rest(&table.text[0], size);
+        }
+        else
+        {
+            std::ostringstream oss;
+            oss << source << " contains an unknown type of table, " << name << ".";
+            throw std::runtime_error(oss.str());
+        }
+
+        data.tables[name].numeric = table.numeric;
+        data.tables[name].row_lengths.swap(table.row_lengths);
+        data.tables[name].values.swap(table.values);
+        data.tables[name].text.swap(table.text);
+    }
+
+    if(data.input_fd != STDIN_FILENO)
+        close(data.input_fd);
+}
+
+/**
+ * \brief Send a set of tables to an output, in the pipe format
+ *
+ * \param[in] write  Function that writes a block of bytes to the output
+ * \param[in] tables The tables
+ */
+template <class Twriter>
+void write_tables(const Twriter                            &write,
+                  const std::map<std::string, PipedTable> &tables)
+{
+    for(auto const &entry : tables)
+    {
+        auto const &name  = entry.first;
+        auto const &table = entry.second;
+        const char     type        = table.numeric ? 'N' : 'T';
+        const uint32_t name_length = name.size();
+
+        write(pipe_magic, sizeof(pipe_magic));
+        write(&type, 1);
+        write(&name_length, sizeof(name_length));
+        write(name.data(), name_length);
+
+        if(table.numeric)
+        {
+            const uint64_t sizes[2] = {table.row_lengths.size(), table.values.size()};
+            write(sizes, sizeof(sizes));
+            write(table.row_lengths.data(), sizes[0]*sizeof(uint32_t));
+            write(table.values.data(), sizes[1]*sizeof(double));
+        }
+        else
+        {
+            const uint64_t size = table.text.size();
+            write(&size, sizeof(size));
+            write(table.text.data(), size);
+        }
+    }
+}
+
+/**
+ * \brief Save every table in the project file
+ *
+ * \details The project is saved with write_checkpoint_file, so it is never left
+ *          half-written.
+ */
+void write_project_file(PipeData &data)
+{
+    load_pipe_input(data);
+
+    std::string buffer;
+
+    write_tables([&buffer](const void *src, const size_t n) {
+        buffer.append(static_cast<const char *>(src), n);
+    }, data.tables);
+
+    if(!write_checkpoint_file(data.project, buffer))
+    {
+        std::ostringstream oss;
+        oss << "Could not write project file " << data.project;
+        throw std::runtime_error(oss.str());
+    }
+
+    data.modified = false;
+}
+
+/**
+ * \brief Send every table to the pipe
+ *
+ * \details This is called when the program exits.  The tables include any that
+ *          were received from the standard input, so that programs further
+ *          along the pipe can also read them.
+ */
+void write_pipe_output()
+{
+    auto &data = get_pipe_data();
+    std::lock_guard<std::mutex> lock(data.mutex);
+
+    if(data.output_fd < 0)
+        return;
+
+    try
+    {
+        load_pipe_input(data);
+        const int fd = data.output_fd;
+
+        write_tables([fd](const void *src, const size_t n) {
+            write_bytes(fd, src, n);
+        }, data.tables);
+    }
+    catch(std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+
+    close(data.output_fd);
+    data.output_fd = -1;
+}
+
+/**
+ * \brief Save the project file when the program exits, if any table has changed
+ */
+void write_project_output()
+{
+    auto &data = get_pipe_data();
+    std::lock_guard<std::mutex> lock(data.mutex);
+
+    if(data.project.empty() || !data.modified)
+        return;
+
+    try
+    {
+        write_project_file(data);
+    }
+    catch(std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        std::cerr.flush();
+        _exit(EXIT_FAILURE);
+    }
+}
+} // namespace
+
+/**
+ * \brief Read tables from the standard input instead of files
+ *
+ * \param[in] enable True if tables should be read from the standard input
+ *
+ * \details The standard input must contain the tables sent by another QWWAD
+ *          program with pipe output switched on.  Any table that is not found
+ *          in the standard input is read from its file as usual.
+ */
+void set_pipe_input(const bool enable)
+{
+    auto &data = get_pipe_data();
+    std::lock_guard<std::mutex> lock(data.mutex);
+    data.input = enable;
+}
+
+/**
+ * \brief Send tables to the standard output instead of writing files
+ *
+ * \param[in] enable True if tables should be sent to the standard output
+ *
+ * \details All tables written through TableWriter (and hence write_table) are
+ *          held in memory, and are sent to the standard output when the
+ *          program exits.  Text that the program would normally print to the
+ *          standard output is sent to the standard error stream instead, so
+ *          that it doesn't get mixed up with the tables.
+ */
+void set_pipe_output(const bool enable)
+{
+    auto &data = get_pipe_data();
+    std::lock_guard<std::mutex> lock(data.mutex);
+
+    if(!enable || data.output_fd >= 0)
+        return;
+
+    std::cout.flush();
+    fflush(stdout);
+
+    data.output_fd = dup(STDOUT_FILENO);
+
+    if(data.output_fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+        throw std::runtime_error("Could not redirect standard output to pipe.");
+
+    std::atexit(write_pipe_output);
+}
+
+/**
+ * \brief Keep all tables in a single project file instead of separate files
+ *
+ * \param[in] fname The name of the project file
+ *
+ * \details Every table that is read through read_table is first looked up in
+ *          the project file, and every table written through TableWriter (and
+ *          hence write_table) is stored in it instead of in its own file.  The
+ *          tables are identified by their usual filenames.  A table that is not
+ *          in the project is read from its file as usual, so a project can be
+ *          started in a directory of existing files.  Files that a program
+ *          writes directly, without TableWriter, are not held in the project.
+ *
+ *          The project file is only rewritten when the program exits, and only
+ *          if a table has changed.  It cannot be combined with pipe input or
+ *          output.  Use qwwad_project_export to recover the individual files.
+ */
+void set_project_file(const std::string &fname)
+{
+    auto &data = get_pipe_data();
+    std::lock_guard<std::mutex> lock(data.mutex);
+
+    if(data.input || data.output_fd >= 0)
+        throw std::runtime_error("A project file cannot be used with pipe input or output.");
+
+    if(!data.project.empty())
+        return;
+
+    data.project = fname;
+    data.input_fd = open(fname.c_str(), O_RDONLY);
+
+    // A new project starts out empty
+    if(data.input_fd >= 0)
+        data.input = true;
+    else
+        data.input_fd = STDIN_FILENO;
+
+    std::atexit(write_project_output);
+}
+
+/**
+ * \brief Find the names of all the tables held in a pipe or project file
+ */
+std::vector<std::string> list_piped_tables()
+{
+    auto &data = get_pipe_data();
+    std::lock_guard<std::mutex> lock(data.mutex);
+
+    load_pipe_input(data);
+
+    std::vector<std::string> names;
+
+    for(auto const &entry : data.tables)
+        names.push_back(entry.first);
+
+    return names;
+}
+
+/**
+ * \brief Check whether tables are sent to the standard output or a project file
+ */
+bool pipe_output_enabled()
+{
+    auto &data = get_pipe_data();
+    std::lock_guard<std::mutex> lock(data.mutex);
+    return data.output_fd >= 0 || !data.project.empty();
+}
+
+/**
+ * \brief Find a table that was received from, or will be sent to, a pipe
+ *
+ * \param[in] fname The name of the file that holds the table
+ *
+ * \returns The table, or null if it is not available.  The table remains valid
+ *          until the same file is written again.
+ */
+const PipedTable * find_piped_table(const std::string &fname)
+{
+    auto &data = get_pipe_data();
+    std::lock_guard<std::mutex> lock(data.mutex);
+
+    load_pipe_input(data);
+
+    auto const it = data.tables.find(fname);
+    return (it == data.tables.end()) ? nullptr : &it->second;
+}
+
+/**
+ * \brief Store a table so that it is sent to the pipe when the program exits
+ *
+ * \param[in]     fname The name of the file that would normally hold the table
+ * \param[in,out] table The table.  Its contents are moved into the store.
+ */
+void store_piped_table(const std::string &fname,
+                       PipedTable        &table)
+{
+    auto &data = get_pipe_data();
+    std::lock_guard<std::mutex> lock(data.mutex);
+
+    // Make sure that an older copy of the table from the input doesn't
+    // replace this one later
+    load_pipe_input(data);
+
+    auto &dest = data.tables[fname];
+    data.modified = true;
+    dest.numeric = table.numeric;
+    dest.row_lengths.swap(table.row_lengths);
+    dest.values.swap(table.values);
+    dest.text.swap(table.text);
+}
+
+/**
+ * \brief Forget a table that was received from a pipe
+ *
+ * \param[in] fname The name of the file that holds the table
+ *
+ * \details This is needed when the file is written again by this program, so
+ *          that the new file is read instead of the old table.
+ */
+void remove_piped_table(const std::string &fname)
+{
+    auto &data = get_pipe_data();
+    std::lock_guard<std::mutex> lock(data.mutex);
+
+    load_pipe_input(data);
+
+    if(data.tables.erase(fname) > 0)
+        data.modified = true;
+}
+
+/**
+ * \brief Read a table that has any number of columns
+ *
+ * \param[in]  fname Name of the file
+ * \param[out] table The values, with one row for each line of the file
+ *
+ * \details Every line must have the same number of columns.  As in read_columns,
+ *          blank lines are skipped, and a table that was received through a pipe
+ *          is read from memory.
+ */
+void read_table(const std::string &fname,
+                arma::mat         &table)
+{
+    std::vector<double> values; // All the values, row by row
+    size_t              ncols = 0;
+    size_t              nrow  = 0;
+
+    auto add_row = [&](const double *row, const size_t n) {
+        if(n == 0)
+            return;
+
+        if(nrow == 0)
+            ncols = n;
+        else if(n != ncols)
+        {
+            std::ostringstream oss;
+            oss << "Row " << nrow + 1 << " of " << fname << " has " << n
+                << " columns, but the first row has " << ncols << ".";
+            throw std::runtime_error(oss.str());
+        }
+
+        values.insert(values.end(), row, row + n);
+        ++nrow;
+    };
+
+    // Read every number on each line of a block of text
+    auto parse_text = [&](const char *begin, const char *end) {
+        std::vector<double> row;
+        const char         *p = begin;
+
+        while(p < end)
+        {
+            const char *line_end = static_cast<const char *>(memchr(p, '\n', end - p));
+
+            if(line_end == NULL)
+                line_end = end;
+
+            row.clear();
+            double value = 0.0;
+
+            while(parse_number(p, value))
+                row.push_back(value);
+
+            add_row(row.data(), row.size());
+            p = line_end + 1;
+        }
+    };
+
+    const auto piped = find_piped_table(fname);
+
+    if(piped && piped->numeric)
+    {
+        const double *row = piped->values.data();
+
+        for(const auto n : piped->row_lengths)
+        {
+            add_row(row, n);
+            row += n;
+        }
+    }
+    else if(piped)
+        parse_text(piped->text.c_str(), piped->text.c_str() + piped->text.size());
+    else
+        read_text_blocks(fname, parse_text);
+
+    // The values are stored row by row, so they fill the transpose of the table
+    table = arma::mat(values.data(), ncols, nrow).t();
+}
+
+namespace
+{
+/// A finished table that is waiting to be written to its file
+struct AsyncFile
+{
+    std::string       fname; ///< Name of the file
+    std::vector<char> data;  ///< Contents of the file
+};
+
+/// Queue of files that are written by a background thread
+struct AsyncOutput
+{
+    AsyncOutput() :
+        max_bytes(0),
+        queued_bytes(0),
+        stop(false)
+    {}
+
+    std::mutex                 mutex;        ///< Lock for all the data
+    std::condition_variable    changed;      ///< Signalled when the queue changes
+    std::thread                writer;       ///< Thread that writes the files
+    size_t                     max_bytes;    ///< Largest amount of data to hold in the queue
+    size_t                     queued_bytes; ///< Amount of data in the queue
+    std::deque<AsyncFile>      queue;        ///< Files waiting to be written
+    std::multiset<std::string> pending;      ///< Names of files that are not yet written
+    bool                       stop;         ///< True if the thread should stop once the queue is empty
+    std::string                error;        ///< Description of the first failure (if any)
+};
+
+AsyncOutput & get_async_output()
+{
+    static AsyncOutput output;
+    return output;
+}
+
+/**
+ * \brief Write each file in the queue, until told to stop
+ */
+void run_async_writer()
+{
+    auto &output = get_async_output();
+    std::unique_lock<std::mutex> lock(output.mutex);
+
+    while(true)
+    {
+        output.changed.wait(lock, [&output]() {return output.stop || !output.queue.empty();});
+
+        if(output.queue.empty())
+            return;
+
+        AsyncFile file;
+        file.fname.swap(output.queue.front().fname);
+        file.data.swap(output.queue.front().data);
+        output.queue.pop_front();
+
+        // Write without holding the lock, so that the compute threads can
+        // continue to add files
+        lock.unlock();
+
+        ScopedTraceEvent event("async file write");
+        std::ofstream stream(file.fname.c_str(), std::ios::binary);
+
+        if(stream.is_open())
+            stream.write(file.data.data(), file.data.size());
+
+        stream.close();
+        const bool failed = !stream;
+
+        lock.lock();
+
+        if(failed && output.error.empty())
+            output.error = "Could not write to " + file.fname;
+
+        output.queued_bytes -= file.data.size();
+        output.pending.erase(output.pending.find(file.fname));
+        output.changed.notify_all();
+    }
+}
+
+/**
+ * \brief Finish writing the queued files when the program exits
+ *
+ * \details If any file could not be written, the program exits with a failure
+ *          status, so that the error is not lost.
+ */
+void finish_async_output_at_exit()
+{
+    try
+    {
+        finish_async_output();
+    }
+    catch(std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        std::cerr.flush();
+        _exit(EXIT_FAILURE);
+    }
+}
+} // namespace
+
+/**
+ * \brief Write tables to their files in the background
+ *
+ * \param[in] max_bytes The largest amount of finished data to hold in memory while
+ *                      it waits to be written [bytes].  If zero, tables are written
+ *                      directly by the thread that creates them.
+ *
+ * \details Each table written through TableWriter (and hence write_table) is held
+ *          in memory until it is complete, and is then passed to a single thread
+ *          that opens, writes and closes the file.  A program that writes many
+ *          files therefore doesn't wait for the file system after each one.  If
+ *          the queue is full, the next table waits until there is space for it.
+ *
+ *          Errors are only found when the file is written, so they are reported
+ *          by finish_async_output, which is called automatically on exit.
+ */
+void set_async_output(const size_t max_bytes)
+{
+    auto &output = get_async_output();
+    std::lock_guard<std::mutex> lock(output.mutex);
+
+    if(max_bytes == 0 || output.max_bytes > 0)
+        return;
+
+    output.max_bytes = max_bytes;
+    output.writer    = std::thread(run_async_writer);
+
+    std::atexit(finish_async_output_at_exit);
+}
+
+/**
+ * \brief Check whether tables are written in the background
+ */
+bool async_output_enabled()
+{
+    auto &output = get_async_output();
+    std::lock_guard<std::mutex> lock(output.mutex);
+    return output.max_bytes > 0 && !output.stop;
+}
+
+/**
+ * \brief Add a finished table to the queue of files to write
+ *
+ * \param[in]     fname The name of the file
+ * \param[in,out] data  The contents of the file.  These are moved into the queue.
+ */
+void queue_async_file(const std::string &fname,
+                      std::vector<char> &data)
+{
+    auto &output = get_async_output();
+    std::unique_lock<std::mutex> lock(output.mutex);
+
+    // Wait for space in the queue.  A file that is bigger than the whole queue
+    // is accepted once the queue is empty.
+    output.changed.wait(lock, [&output, &data]() {
+        return output.stop || output.queue.empty() || output.queued_bytes + data.size() <= output.max_bytes;
+    });
+
+    // Write the file directly if the background writer has already finished
+    if(output.stop)
+    {
+        lock.unlock();
+
+        std::ofstream stream(fname.c_str(), std::ios::binary);
+        stream.write(data.data(), data.size());
+        stream.close();
+
+        if(!stream)
+        {
+            std::ostringstream oss;
+            oss << "Could not write to " << fname;
+            throw std::runtime_error(oss.str());
+        }
+
+        return;
+    }
+
+    output.queue.push_back(AsyncFile());
+    output.queue.back().fname = fname;
+    output.queue.back().data.swap(data);
+    output.queued_bytes += output.queue.back().data.size();
+    output.pending.insert(fname);
+    output.changed.notify_all();
+}
+
+/**
+ * \brief Wait until a file has been written, if it is in the queue
+ *
+ * \param[in] fname The name of the file
+ */
+void wait_for_async_file(const std::string &fname)
+{
+    auto &output = get_async_output();
+    std::unique_lock<std::mutex> lock(output.mutex);
+
+    output.changed.wait(lock, [&output, &fname]() {return output.pending.count(fname) == 0;});
+}
+
+/**
+ * \brief Write every queued file and stop the background writer
+ *
+ * \details Any tables written afterwards are written directly.
+ *
+ * \throws std::runtime_error if any file could not be written
+ */
+void finish_async_output()
+{
+    auto &output = get_async_output();
+
+    {
+        std::lock_guard<std::mutex> lock(output.mutex);
+        output.stop = true;
+        output.changed.notify_all();
+    }
+
+    if(output.writer.joinable())
+        output.writer.join();
+
+    std::lock_guard<std::mutex> lock(output.mutex);
+
+    if(!output.error.empty())
+    {
+        std::string error;
+        error.swap(output.error);
+        throw std::runtime_error(error);
+    }
+}
+
+/**
+ * \brief Compresses a table as it is written
+ */
+class TableCompressor
+{
+public:
+    virtual ~TableCompressor() {}
+
+    /**
+     * \brief Compress a block of data
+     *
+     * \param[in]     data  The data
+     * \param[in]     n     Number of bytes of data
+     * \param[in]     flush Make sure everything so far can be decompressed
+     * \param[in,out] out   Buffer to which the compressed data are appended
+     */
+    virtual void compress(const char        *data,
+                          const size_t       n,
+                          const bool         flush,
+                          std::vector<char> &out) = 0;
+
+    /**
+     * \brief Append the end of the compressed stream to a buffer
+     */
+    virtual void finish(std::vector<char> &out) = 0;
+};
+
+namespace
+{
+#if HAVE_ZLIB
+/**
+ * \brief Compresses a table in gzip format
+ */
+class GzipCompressor : public TableCompressor
+{
+public:
+    GzipCompressor() :
+        _strm(z_stream())
+    {
+        // Write a gzip rather than a zlib header
+        if(deflateInit2(&_strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                        Z_DEFAULT_STRATEGY) != Z_OK)
+            throw std::runtime_error("Could not initialise zlib compression");
+    }
+
+    ~GzipCompressor()
+    {
+        deflateEnd(&_strm);
+    }
+
+    void compress(const char        *data,
+                  const size_t       n,
+                  const bool         flush,
+                  std::vector<char> &out)
+    {
+        size_t done = 0;
+
+        // zlib counts input in unsigned ints, so very large blocks are fed in pieces
+        do
+        {
+            const size_t n_in = std::min(n - done, static_cast<size_t>(1) << 30);
+            done += n_in;
+            run(data + done - n_in, n_in, (done == n && flush) ? Z_SYNC_FLUSH : Z_NO_FLUSH, out);
+        } while(done < n);
+    }
+
+    void finish(std::vector<char> &out)
+    {
+        run(NULL, 0, Z_FINISH, out);
+    }
+
+private:
+    z_stream _strm; ///< Compression state
+
+    void run(const char        *data,
+             const size_t       n,
+             const int          mode,
+             std::vector<char> &out)
+    {
+        _strm.next_in  = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+        _strm.avail_in = n;
+
+        // Keep going until the output stops filling the space available
+        do
+        {
+            const size_t used = out.size();
+            const size_t space = deflateBound(&_strm, _strm.avail_in) + 64;
+            out.resize(used + space);
+            _strm.next_out  = reinterpret_cast<Bytef *>(&out[used]);
+            _strm.avail_out = space;
+
+            const int status = deflate(&_strm, mode);
+            out.resize(used + space - _strm.avail_out);
+
+            if(status == Z_STREAM_ERROR)
+                throw std::runtime_error("zlib compression failed");
+        } while(_strm.avail_out == 0);
+    }
+};
+#endif
+
+#if HAVE_ZSTD
+/**
+ * \brief Compresses a table in zstd format
+ *
+ * \details zstd can share the work of compressing large tables between several
+ *          threads.
+ */
+class ZstdCompressor : public TableCompressor
+{
+public:
+    ZstdCompressor() :
+        _cctx(ZSTD_createCCtx()),
+        _started(false)
+    {
+        if(_cctx == NULL)
+            throw std::runtime_error("Could not initialise zstd compression");
+    }
+
+    ~ZstdCompressor()
+    {
+        ZSTD_freeCCtx(_cctx);
+    }
+
+    void compress(const char        *data,
+                  const size_t       n,
+                  const bool         flush,
+                  std::vector<char> &out)
+    {
+        // Threads are only worth starting if the table fills more than one buffer.
+        // The library might have been built without thread support, in which case
+        // the data are simply compressed in this thread
+        if(!_started)
+        {
+            if(n >= (static_cast<size_t>(1) << 15) && get_thread_count() > 1)
+                ZSTD_CCtx_setParameter(_cctx, ZSTD_c_nbWorkers, get_thread_count());
+
+            _started = true;
+        }
+
+        run(data, n, flush ? ZSTD_e_flush : ZSTD_e_continue, out);
+    }
+
+    void finish(std::vector<char> &out)
+    {
+        run(NULL, 0, ZSTD_e_end, out);
+    }
+
+private:
+    ZSTD_CCtx *_cctx;    ///< Compression state
+    bool       _started; ///< True once the first block has been compressed
+
+    void run(const char              *data,
+             const size_t             n,
+             const ZSTD_EndDirective  mode,
+             std::vector<char>       &out)
+    {
+        ZSTD_inBuffer in = {data, n, 0};
+        size_t remaining = 0;
+
+        // Keep going until the input is used up, and anything that has to be
+        // flushed has been written
+        do
+        {
+            const size_t used = out.size();
+            out.resize(used + ZSTD_CStreamOutSize());
+            ZSTD_outBuffer buf = {&out[used], ZSTD_CStreamOutSize(), 0};
+
+            remaining = ZSTD_compressStream2(_cctx, &buf, &in, mode);
+            out.resize(used + buf.pos);
+
+            if(ZSTD_isError(remaining))
+            {
+                std::ostringstream oss;
+                oss << "zstd compression failed: " << ZSTD_getErrorName(remaining);
+                throw std::runtime_error(oss.str());
+            }
+        } while(in.pos < in.size || (mode != ZSTD_e_continue && remaining != 0));
+    }
+};
+#endif
+
+/**
+ * \brief Check whether a string ends with a given suffix
+ */
+bool has_suffix(const std::string &str,
+                const std::string &suffix)
+{
+    return str.size() > suffix.size()
+           && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+/**
+ * \brief Create a compressor for a file, depending on its name
+ *
+ * \returns The compressor, or null if the file is not to be compressed
+ */
+std::unique_ptr<TableCompressor> create_table_compressor(const std::string &fname)
+{
+    const char *format = NULL;
+
+    if(has_suffix(fname, ".gz"))
+    {
+#if HAVE_ZLIB
+        return std::unique_ptr<TableCompressor>(new GzipCompressor());
+#else
+        format = "gzip";
+#endif
+    }
+    else if(has_suffix(fname, ".zst"))
+    {
+#if HAVE_ZSTD
+        return std::unique_ptr<TableCompressor>(new ZstdCompressor());
+#else
+        format = "zstd";
+#endif
+    }
+    else
+        return std::unique_ptr<TableCompressor>();
+
+    std::ostringstream oss;
+    oss << "Cannot write " << fname << ": QWWAD was built without " << format << " support";
+    throw std::runtime_error(oss.str());
+}
+} // namespace
+
+/**
+ * \brief Open a file for buffered output
+ *
+ * \param[in] fname      The name of the file
+ * \param[in] precision  Precision for floating-point values.  If negative, the
+ *                       default stream format is used.
+ * \param[in] scientific Use scientific format for floating-point values
+ */
+TableWriter::TableWriter(const std::string &fname,
+                         const int          precision,
+                         const bool         scientific) :
+    _fname(fname),
+    _stream(),
+    _buffer(1 << 16),
+    _used(0),
+    _precision(precision),
+    _scientific(scientific),
+    _piped(pipe_output_enabled()),
+    _async(!_piped && async_output_enabled()),
+    _table(),
+    _row_length(0),
+    _compressor(),
+    _compressed()
+{
+    if(_piped)
+        return;
+
+    remove_piped_table(fname);
+    _compressor = create_table_compressor(fname);
+
+    // The file is opened by the background writer once the table is complete
+    if(_async)
+        return;
+
+    _stream.open(fname.c_str(), std::ios::binary);
+
+    if(!_stream.is_open())
+    {
+        std::ostringstream oss;
+        oss << "Could not open " << fname;
+        throw std::runtime_error(oss.str());
+    }
+}
+
+TableWriter::~TableWriter()
+{
+    try
+    {
+        if(_piped)
+        {
+            if(_row_length > 0)
+                _table.row_lengths.push_back(_row_length);
+
+            if(!_table.numeric)
+                _table.text.assign(_buffer.begin(), _buffer.begin() + _used);
+
+            store_piped_table(_fname, _table);
+        }
+        else if(_async)
+        {
+            if(_compressor)
+            {
+                _compressor->compress(&_buffer[0], _used, false, _compressed);
+                _compressor->finish(_compressed);
+                queue_async_file(_fname, _compressed);
+            }
+            else
+            {
+                _buffer.resize(_used);
+                queue_async_file(_fname, _buffer);
+            }
+        }
+        else
+        {
+            flush();
+            finish_compression();
+        }
+    }
+    catch(std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+/**
+ * \brief Write the contents of the buffer to the file
+ */
+void TableWriter::flush()
+{
+    // Piped tables are only sent when the program exits, and background
+    // tables are only sent once they are complete
+    if(_piped || _async)
+        return;
+
+    write_block(true);
+    _stream.flush();
+
+    if(!_stream)
+    {
+        std::ostringstream oss;
+        oss << "Could not write to " << _fname;
+        throw std::runtime_error(oss.str());
+    }
+}
+
+/**
+ * \brief Make sure there is space for a given number of characters in the buffer
+ */
+void TableWriter::reserve(const size_t n)
+{
+    if(_piped || _async)
+    {
+        // Keep the whole table in memory
+        if(_used + n > _buffer.size())
+            _buffer.resize(std::max(2*_buffer.size(), _used + n));
+    }
+    else if(_used + n > _buffer.size())
+    {
+        write_block(false);
+
+        if(n > _buffer.size())
+            _buffer.resize(n);
+    }
+}
+
+/**
+ * \brief Write the contents of the buffer to the file, compressing them if needed
+ *
+ * \param[in] flush_compressor Make sure that everything written so far can be
+ *                             decompressed
+ */
+void TableWriter::write_block(const bool flush_compressor)
+{
+    ScopedTraceEvent event("table write");
+
+    if(_compressor)
+    {
+        if(_used > 0 || flush_compressor)
+        {
+            _compressor->compress(&_buffer[0], _used, flush_compressor, _compressed);
+            _stream.write(_compressed.data(), _compressed.size());
+            _compressed.clear();
+        }
+    }
+    else if(_used > 0)
+        _stream.write(&_buffer[0], _used);
+
+    _used = 0;
+}
+
+/**
+ * \brief Write the end of the compressed stream to the file
+ */
+void TableWriter::finish_compression()
+{
+    if(!_compressor)
+        return;
+
+    _compressor->finish(_compressed);
+    _stream.write(_compressed.data(), _compressed.size());
+    _compressed.clear();
+    _compressor.reset();
+    _stream.flush();
+
+    if(!_stream)
+    {
+        std::ostringstream oss;
+        oss << "Could not write to " << _fname;
+        throw std::runtime_error(oss.str());
+    }
+}
+
+/**
+ * \brief Add a value to the current row of a piped table
+ *
+ * \returns True if the value was stored in binary form.  If false, the value
+ *          must be formatted as text.
+ */
+bool TableWriter::pipe_value(const double value)
+{
+    if(!_piped || !_table.numeric)
+        return false;
+
+    _table.values.push_back(value);
+    ++_row_length;
+
+    return true;
+}
+
+/**
+ * \brief Add some text to a piped table
+ *
+ * \returns True if the text was handled.  If false, the text must be copied
+ *          into the buffer.
+ *
+ * \details Whitespace only separates values in a numeric table, so it is not
+ *          stored.  Any other text means that the whole table must be
+ *          stored as text.
+ */
+bool TableWriter::pipe_text(const char *value)
+{
+    if(!_piped || !_table.numeric)
+        return false;
+
+    for(const char *p = value; *p != '\0'; ++p)
+    {
+        if(*p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+        {
+            switch_to_text();
+            return false;
+        }
+    }
+
+    for(const char *p = value; *p != '\0'; ++p)
+    {
+        if(*p == '\n')
+        {
+            _table.row_lengths.push_back(_row_length);
+            _row_length = 0;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * \brief Convert the binary values stored so far in a piped table into text
+ */
+void TableWriter::switch_to_text()
+{
+    PipedTable numeric;
+    numeric.row_lengths.swap(_table.row_lengths);
+    numeric.values.swap(_table.values);
+    numeric.row_lengths.push_back(_row_length);
+
+    _table.numeric = false;
+    _row_length    = 0;
+
+    const double *value = numeric.values.data();
+
+    for(size_t irow = 0; irow < numeric.row_lengths.size(); ++irow)
+    {
+        const bool last_row = (irow == numeric.row_lengths.size() - 1);
+
+        for(uint32_t ival = 0; ival < numeric.row_lengths[irow]; ++ival)
+        {
+            if(ival > 0)
+                *this << '\t';
+
+            *this << *value++;
+        }
+
+        // The current row is still incomplete, so the next text must be
+        // kept separate from its last value
+        if(!last_row)
+            *this << '\n';
+        else if(numeric.row_lengths[irow] > 0)
+            *this << '\t';
+    }
+}
+
+TableWriter & TableWriter::operator<<(const double value)
+{
+    if(pipe_value(value))
+        return *this;
+
+    // Enough space for any double at the largest sensible precision
+    const size_t nmax = 32 + (_precision > 0 ? _precision : 0);
+    reserve(nmax);
+
+    int n = 0;
+
+    if(_precision < 0)
+        n = snprintf(&_buffer[_used], nmax, "%g", value);
+    else if(_scientific)
+        n = snprintf(&_buffer[_used], nmax, "%.*e", _precision, value);
+    else
+        n = snprintf(&_buffer[_used], nmax, "%.*g", _precision, value);
+
+    _used += n;
+    return *this;
+}
+
+TableWriter & TableWriter::operator<<(const int value)
+{
+    if(pipe_value(value))
+        return *this;
+
+    reserve(24);
+    _used += snprintf(&_buffer[_used], 24, "%d", value);
+    return *this;
+}
+
+TableWriter & TableWriter::operator<<(const unsigned int value)
+{
+    if(pipe_value(value))
+        return *this;
+
+    reserve(24);
+    _used += snprintf(&_buffer[_used], 24, "%u", value);
+    return *this;
+}
+
+TableWriter & TableWriter::operator<<(const long value)
+{
+    if(pipe_value(value))
+        return *this;
+
+    reserve(24);
+    _used += snprintf(&_buffer[_used], 24, "%ld", value);
+    return *this;
+}
+
+TableWriter & TableWriter::operator<<(const unsigned long value)
+{
+    if(pipe_value(value))
+        return *this;
+
+    reserve(24);
+    _used += snprintf(&_buffer[_used], 24, "%lu", value);
+    return *this;
+}
+
+TableWriter & TableWriter::operator<<(const long long value)
+{
+    if(pipe_value(value))
+        return *this;
+
+    reserve(24);
+    _used += snprintf(&_buffer[_used], 24, "%lld", value);
+    return *this;
+}
+
+TableWriter & TableWriter::operator<<(const unsigned long long value)
+{
+    if(pipe_value(value))
+        return *this;
+
+    reserve(24);
+    _used += snprintf(&_buffer[_used], 24, "%llu", value);
+    return *this;
+}
+
+TableWriter & TableWriter::operator<<(const char value)
+{
+    const char str[2] = {value, '\0'};
+
+    if(pipe_text(str))
+        return *this;
+
+    reserve(1);
+    _buffer[_used++] = value;
+    return *this;
+}
+
+TableWriter & TableWriter::operator<<(const char *value)
+{
+    if(pipe_text(value))
+        return *this;
+
+    const size_t n = strlen(value);
+    reserve(n);
+    memcpy(&_buffer[_used], value, n);
+    _used += n;
+    return *this;
+}
+
 void parse_items(std::istream &stream)
 {
     stream.clear();
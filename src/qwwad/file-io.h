@@ -14,14 +14,20 @@
 # include "config.h"
 #endif
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <cstdlib>
+#include <functional>
+#include <memory>
 #include <vector>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <stdexcept>
 #include <iostream>
+#include <armadillo>
 
 namespace QWWAD
 {
@@ -211,38 +217,449 @@ int read_line(std::istream &stream,
 }
 
 /**
- * Read numerical data from a file containing data in a single column
+ * \brief The complete contents of a file, held in memory
+ *
+ * \details Where possible, the file is memory-mapped rather than copied.  The
+ *          contents are always followed by a null character, so they can be
+ *          parsed safely with the C string-conversion functions.
+ *
+ *          The contents are held exactly as they are stored.  Use read_text_blocks
+ *          to read a text file that may be compressed.
+ *
+ *          If the file is still waiting to be written by the background writer
+ *          (see set_async_output), it is only loaded once it has been written.
+ */
+class TextFileBuffer
+{
+public:
+    TextFileBuffer(const std::string &fname);
+    ~TextFileBuffer();
+
+    /** Return a pointer to the start of the file contents */
+    const char * begin() const {return _data;}
+
+    /** Return a pointer to one past the end of the file contents */
+    const char * end() const {return _data + _size;}
+
+private:
+    TextFileBuffer(const TextFileBuffer &);
+    TextFileBuffer & operator=(const TextFileBuffer &);
+
+    const char  *_data;     ///< Start of the file contents
+    size_t       _size;     ///< Number of bytes in the file
+    bool         _mapped;   ///< True if the file is memory-mapped
+    std::string  _contents; ///< Copy of the file, used if it is not mapped
+};
+
+/// Function that parses the text between two pointers
+typedef std::function<void (const char *begin, const char *end)> text_block_parser;
+
+void read_text_blocks(const std::string       &fname,
+                      const text_block_parser &parse);
+
+/**
+ * \brief Read a single number from a line of text
+ *
+ * \param[in,out] p    Position in the text.  This is moved past the number.
+ * \param[out]    dest Destination for the number
+ *
+ * \return True if a number was found before the end of the line
+ */
+template <class T>
+bool parse_number(const char *&p, T &dest)
+{
+    while(*p == ' ' || *p == '\t' || *p == '\r')
+        ++p;
+
+    if(*p == '\n' || *p == '\0')
+        return false;
+
+    char *p_end = NULL;
+    const double value = strtod(p, &p_end);
+
+    if(p_end == p)
+        return false;
+
+    dest = static_cast<T>(value);
+    p    = p_end;
+
+    return true;
+}
+
+/**
+ * \brief Read a single whitespace-delimited word from a line of text
+ *
+ * \param[in,out] p    Position in the text.  This is moved past the word.
+ * \param[out]    dest Destination for the word
+ *
+ * \return True if a word was found before the end of the line
+ */
+inline bool parse_number(const char *&p, std::string &dest)
+{
+    while(*p == ' ' || *p == '\t' || *p == '\r')
+        ++p;
+
+    const char *word_start = p;
+
+    while(*p != ' ' && *p != '\t' && *p != '\r' && *p != '\n' && *p != '\0')
+        ++p;
+
+    dest.assign(word_start, p);
+
+    return p != word_start;
+}
+
+inline bool parse_columns(const char *&)
+{
+    return true;
+}
+
+/**
+ * \brief Recursively read numbers from a line of text into a set of columns
+ *
+ * \param[in,out] p         Position in the text
+ * \param[out]    col       The column into which the next number is appended
+ * \param[out]    remainder The columns for all remaining numbers
+ *
+ * \return True if all the numbers were found before the end of the line
+ */
+template <class Tnext, class... Tremainder>
+bool parse_columns(const char                  *&p,
+                   std::vector<Tnext>           &col,
+                   std::vector<Tremainder>      &...remainder)
+{
+    Tnext value = Tnext();
+
+    if(!parse_number(p, value))
+        return false;
+
+    col.push_back(value);
+
+    return parse_columns(p, remainder...);
+}
+
+/**
+ * \brief Read columns of numerical data from a block of text
+ *
+ * \param[in]  begin  Start of the text, which must be followed by a null character
+ * \param[in]  end    One past the end of the text
+ * \param[out] cols   Vectors into which each column of data is appended
+ */
+template <class... T>
+void parse_text_columns(const char         *begin,
+                        const char         *end,
+                        std::vector<T>     &...cols)
+{
+    const char *p = begin;
+
+    while(p < end)
+    {
+        const char *line_start = p;
+        const char *line_end   = static_cast<const char *>(memchr(p, '\n', end - p));
+
+        if(line_end == NULL)
+            line_end = end;
+
+        // Skip blank lines
+        if(line_end != line_start)
+        {
+            if(!parse_columns(p, cols...))
+            {
+                std::ostringstream err_ss;
+                err_ss << "Data missing on line: '" << std::string(line_start, line_end) << "'";
+                throw std::runtime_error(err_ss.str());
+            }
+        }
+
+        p = line_end + 1;
+    }
+}
+
+/**
+ * \brief A table of data that is passed between programs through a pipe
+ *
+ * \details Tables that only contain numbers are held as binary values, so they
+ *          are never converted to text.  Any other table is held as text.
+ */
+struct PipedTable
+{
+    PipedTable() :
+        numeric(true)
+    {}
+
+    bool                  numeric;     ///< True if the table is held as binary values
+    std::vector<uint32_t> row_lengths; ///< Number of values on each row (numeric tables)
+    std::vector<double>   values;      ///< All the values, row by row (numeric tables)
+    std::string           text;        ///< Contents of the file (text tables)
+};
+
+void set_pipe_input(const bool enable);
+void set_pipe_output(const bool enable);
+void set_project_file(const std::string &fname);
+bool pipe_output_enabled();
+std::vector<std::string> list_piped_tables();
+const PipedTable * find_piped_table(const std::string &fname);
+void store_piped_table(const std::string &fname,
+                       PipedTable        &table);
+void remove_piped_table(const std::string &fname);
+
+void set_async_output(const size_t max_bytes);
+bool async_output_enabled();
+void queue_async_file(const std::string &fname,
+                      std::vector<char> &data);
+void wait_for_async_file(const std::string &fname);
+void finish_async_output();
+
+/// Convert a value from a piped table to the type of a column
+template <class T>
+inline void convert_piped_value(const double value, T &dest)
+{
+    dest = static_cast<T>(value);
+}
+
+inline void convert_piped_value(const double value, std::string &dest)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.17g", value);
+    dest = buffer;
+}
+
+inline void append_piped_values(const double *)
+{}
+
+/**
+ * \brief Recursively append one row of a piped table to a set of columns
+ */
+template <class Tnext, class... Tremainder>
+void append_piped_values(const double                 *values,
+                         std::vector<Tnext>           &col,
+                         std::vector<Tremainder>      &...remainder)
+{
+    Tnext value = Tnext();
+    convert_piped_value(*values, value);
+    col.push_back(value);
+
+    append_piped_values(values + 1, remainder...);
+}
+
+/**
+ * \brief Read columns of data from a numeric piped table
+ *
+ * \param[in]  table The table
+ * \param[in]  fname The name of the table, used in error messages
+ * \param[out] cols  Vectors into which each column of data is appended
+ */
+template <class... T>
+void read_piped_columns(const PipedTable   &table,
+                        const std::string  &fname,
+                        std::vector<T>     &...cols)
+{
+    const double *values = table.values.data();
+
+    for(size_t irow = 0; irow < table.row_lengths.size(); ++irow)
+    {
+        const auto n = table.row_lengths[irow];
+
+        // Skip blank lines
+        if(n == 0)
+            continue;
+
+        if(n < sizeof...(T))
+        {
+            std::ostringstream err_ss;
+            err_ss << "Data missing on row " << irow + 1 << " of " << fname;
+            throw std::runtime_error(err_ss.str());
+        }
+
+        append_piped_values(values, cols...);
+        values += n;
+    }
+}
+
+/**
+ * \brief Read columns of numerical data from a file into temporary vectors
  *
  * \param[in]  fname Filename from which to read data
- * \param[out] x     Value array into which data will be written
+ * \param[out] cols  Vectors into which each column of data is written
+ *
+ * \details The file is parsed in large blocks of lines (see read_text_blocks), and
+ *          the capacity of each column is reserved from a count of the lines in
+ *          the first block, so this is much faster than reading line-by-line
+ *          through a stream.  Blank lines are skipped and
+ *          any extra items at the end of a line are ignored, as in read_line.
+ *
+ *          If the table was received through a pipe (see set_pipe_input), or
+ *          was written to a pipe earlier by this program, it is read from memory
+ *          instead of the file.
  */
-template <class Tstring,
-          template<typename, typename...> class Tcontainer,
-          class T>
-void read_table(const Tstring fname, Tcontainer<T>& x)
+template <class... T>
+void read_columns(const std::string  &fname,
+                  std::vector<T>     &...cols)
 {
-    std::ifstream stream(fname);
+    const auto table = find_piped_table(fname);
 
-    if(!stream.is_open())
+    if(table && table->numeric)
     {
-        std::ostringstream oss;
-        oss << "Could not open " << fname;
-        throw std::runtime_error(oss.str());
+        const int reserved[] = {(cols.reserve(table->row_lengths.size()), 0)...};
+        (void)reserved;
+
+        read_piped_columns(*table, fname, cols...);
     }
+    else if(table)
+    {
+        const size_t nlines = std::count(table->text.begin(), table->text.end(), '\n') + 1;
+        const int reserved[] = {(cols.reserve(nlines), 0)...};
+        (void)reserved;
 
-    std::vector<T> x_temp;
+        parse_text_columns(table->text.c_str(), table->text.c_str() + table->text.size(), cols...);
+    }
+    else
+    {
+        bool first_block = true;
+
+        read_text_blocks(fname, [&](const char *begin, const char *end) {
+            // Reserve space in every column from the number of lines in the first
+            // block.  This is the whole file, unless it is compressed.
+            if(first_block)
+            {
+                const size_t nlines = std::count(begin, end, '\n') + 1;
+                const int reserved[] = {(cols.reserve(nlines), 0)...};
+                (void)reserved;
+                first_block = false;
+            }
+
+            parse_text_columns(begin, end, cols...);
+        });
+    }
+}
+
+void read_table(const std::string &fname,
+                arma::mat         &table);
+
+/**
+ * \brief Read a table that has any number of columns
+ *
+ * \details This overload is needed so that a string literal filename selects the
+ *          matrix version, rather than the single-column template below.
+ */
+inline void read_table(const char *fname,
+                       arma::mat  &table)
+{
+    read_table(std::string(fname), table);
+}
+
+class TableCompressor;
 
-    while(!stream.eof())
+/**
+ * \brief A buffered writer for tables of numerical data
+ *
+ * \details Values are formatted straight into a large block buffer, which is only
+ *          flushed to the file when it is full, or when the writer is destroyed.
+ *          This is much faster than formatting each value through an output stream,
+ *          but gives exactly the same text.
+ *
+ *          The precision policy mirrors the stream manipulators: by default, floating
+ *          point values are written in the default stream format (6 significant
+ *          figures).  Otherwise, they are written with the given precision, in
+ *          either scientific or general format.
+ *
+ *          If pipe output is switched on (see set_pipe_output), no file is
+ *          written.  Instead, the table is stored in memory and sent to the
+ *          standard output when the program exits.  Numbers are then stored as
+ *          binary values rather than being formatted, unless the table also
+ *          contains text.
+ *
+ *          If background output is switched on (see set_async_output), the table
+ *          is also stored in memory, and is passed to the background writer when
+ *          the TableWriter is destroyed.
+ *
+ *          Files whose names end in ".gz" or ".zst" are compressed with gzip or
+ *          zstd as they are written.  Large zstd files are compressed using
+ *          several threads.
+ */
+class TableWriter
+{
+public:
+    TableWriter(const std::string &fname,
+                const int          precision  = -1,
+                const bool         scientific = false);
+    ~TableWriter();
+
+    TableWriter & operator<<(const double              value);
+    TableWriter & operator<<(const float               value) {return *this << static_cast<double>(value);}
+    TableWriter & operator<<(const int                 value);
+    TableWriter & operator<<(const unsigned int        value);
+    TableWriter & operator<<(const long                value);
+    TableWriter & operator<<(const unsigned long       value);
+    TableWriter & operator<<(const long long           value);
+    TableWriter & operator<<(const unsigned long long  value);
+    TableWriter & operator<<(const char                value);
+    TableWriter & operator<<(const char               *value);
+    TableWriter & operator<<(const std::string        &value) {return *this << value.c_str();}
+
+    /**
+     * \brief Write any other type of value, using the same format as a stream
+     */
+    template <class T>
+    TableWriter & operator<<(const T &value)
     {
-        T buffer = 0; // Buffer for input data
+        std::ostringstream oss;
+
+        if(_precision >= 0)
+        {
+            oss << std::setprecision(_precision);
+
+            if(_scientific)
+                oss << std::scientific;
+        }
+
+        oss << value;
 
-        // If data is valid, stick it into temp vector
-        if(!read_line(stream, buffer))
-            x_temp.push_back(buffer);
+        return *this << oss.str();
     }
-    
-    stream.close();	
-    
+
+    void flush();
+
+private:
+    TableWriter(const TableWriter &);
+    TableWriter & operator=(const TableWriter &);
+
+    void reserve(const size_t n);
+    void write_block(const bool flush_compressor);
+    void finish_compression();
+    bool pipe_value(const double value);
+    bool pipe_text(const char *value);
+    void switch_to_text();
+
+    std::string       _fname;      ///< Name of the output file
+    std::ofstream     _stream;     ///< Output file
+    std::vector<char> _buffer;     ///< Block buffer for formatted output
+    size_t            _used;       ///< Number of characters in buffer
+    int               _precision;  ///< Precision for floating-point values (-1 = stream default)
+    bool              _scientific; ///< Use scientific format for floating-point values
+    bool              _piped;      ///< True if the table is sent to a pipe instead of a file
+    bool              _async;      ///< True if the file is written by the background writer
+    PipedTable        _table;      ///< Table that is sent to the pipe
+    uint32_t          _row_length; ///< Number of values so far on the current row of the table
+
+    std::unique_ptr<TableCompressor> _compressor; ///< Compressor for the file (null if uncompressed)
+    std::vector<char>                _compressed; ///< Compressed data waiting to be written
+};
+
+/**
+ * Read numerical data from a file containing data in a single column
+ *
+ * \param[in]  fname Filename from which to read data
+ * \param[out] x     Value array into which data will be written
+ */
+template <class Tstring,
+          template<typename, typename...> class Tcontainer,
+          class T>
+void read_table(const Tstring fname, Tcontainer<T>& x)
+{
+    std::vector<T> x_temp;
+    read_columns(fname, x_temp);
+
     // Copy data into output array
     x.resize(x_temp.size());
     std::copy(x_temp.begin(), x_temp.end(), &x[0]);
@@ -265,26 +682,16 @@ void write_table(const Tstring        fname,
                  const bool           with_num = false,
                  const int            precision = 12)
 {
-    std::ofstream stream(fname);
+    TableWriter stream(fname, precision, true);
     const size_t nx = x.size();
 
-    if(!stream.is_open())
-    {
-        std::ostringstream oss;
-        oss << "Could not open " << fname;
-        throw std::runtime_error(oss.str());
-    }
-
-    stream << std::setprecision(precision) << std::scientific;
     for(unsigned int i=0; i<nx; i++)
     {
         if(with_num)
-            stream << i+1 << std::setprecision(precision) << std::scientific << "\t" << x[i] << std::endl;
+            stream << i+1 << "\t" << x[i] << '\n';
         else
-            stream << std::setprecision(precision) << std::scientific << x[i] << std::endl;
+            stream << x[i] << '\n';
     }
-
-    stream.close();	
 }
 
 
@@ -314,38 +721,19 @@ void read_table(const Tstring    fname,
                 Tcontainery<Ty> &y,
                 const size_t     n_expected = 0)
 {
-    std::ifstream stream(fname);
-
-    if(!stream.is_open())
-    {
-        std::ostringstream oss;
-        oss << "Could not open " << fname;
-        throw std::runtime_error(oss.str());
-    }
-
     std::vector<Tx> x_temp;
     std::vector<Ty> y_temp;
 
-    while(!stream.eof()){
-        Tx buffer_x = 0; // Buffer for x input data
-        Ty buffer_y = 0; // Buffer for y input data
-
-        // If data is valid, stick it into temp vector
-        try
-        {
-            if(!read_line(stream, buffer_x, buffer_y))
-            {
-                x_temp.push_back(buffer_x);
-                y_temp.push_back(buffer_y);
-            }
-        }
-        catch (std::runtime_error &e)
-        {
-            std::ostringstream err_st;
-            err_st << "Error reading " << fname << std::endl
-                   << e.what();
-            throw std::runtime_error(err_st.str());
-        }
+    try
+    {
+        read_columns(fname, x_temp, y_temp);
+    }
+    catch (std::runtime_error &e)
+    {
+        std::ostringstream err_st;
+        err_st << "Error reading " << fname << std::endl
+               << e.what();
+        throw std::runtime_error(err_st.str());
     }
 
     const size_t nx = x_temp.size();
@@ -366,8 +754,6 @@ void read_table(const Tstring    fname,
     // Copy data into output array
     std::copy(x_temp.begin(), x_temp.end(), &x[0]);
     std::copy(y_temp.begin(), y_temp.end(), &y[0]);
-
-    stream.close();	
 }
 
 
@@ -394,17 +780,9 @@ void write_table(const Tstring                       fname,
                  const bool                          with_num = false,
                  const size_t                        precision = 12)
 {
-    std::ofstream stream(fname);
     const size_t nx = x.size();
     const size_t ny = y.size();
 
-    if(!stream.is_open())
-    {
-        std::ostringstream oss;
-        oss << "Could not open " << fname;
-        throw std::runtime_error(oss.str());
-    }
-
     if(nx != ny)
     {
         std::ostringstream oss;
@@ -412,6 +790,8 @@ void write_table(const Tstring                       fname,
         throw std::runtime_error(oss.str());
     }
 
+    TableWriter stream(fname, precision, true);
+
     for(unsigned int i=0; i<nx; i++)
     {
         if(with_num)
@@ -419,12 +799,8 @@ void write_table(const Tstring                       fname,
             stream << i+1 << "\t";
         }
 
-        stream << std::setprecision(precision)
-               << std::scientific
-               << x[i] << "\t" << y[i] << std::endl;
+        stream << x[i] << "\t" << y[i] << '\n';
     }
-
-    stream.close();
 }
 
 
@@ -448,32 +824,10 @@ void read_table(const char      *fname,
                 Tcontainery<Ty> &y,
                 Tcontainerz<Tz> &z)
 {
-    std::ifstream stream(fname);
-
-    if(!stream.is_open())
-    {
-        std::ostringstream oss;
-        oss << "Could not open " << fname;
-        throw std::runtime_error(oss.str());
-    }
-
     std::vector<Tx> x_temp;
     std::vector<Ty> y_temp;
     std::vector<Tz> z_temp;
-
-    while(!stream.eof()){
-        Tx buffer_x = 0; // Buffer for x input data
-        Ty buffer_y = 0; // Buffer for y input data
-        Tz buffer_z = 0; // Buffer for z input data
-
-        // If data is valid, stick it into temp vector
-        if(!read_line(stream, buffer_x, buffer_y, buffer_z))
-        {
-            x_temp.push_back(buffer_x);
-            y_temp.push_back(buffer_y);
-            z_temp.push_back(buffer_z);
-        }
-    }
+    read_columns(fname, x_temp, y_temp, z_temp);
 
     const size_t nx = x_temp.size();
     const size_t ny = y_temp.size();
@@ -494,8 +848,6 @@ void read_table(const char      *fname,
     std::copy(x_temp.begin(), x_temp.end(), &x[0]);
     std::copy(y_temp.begin(), y_temp.end(), &y[0]);
     std::copy(z_temp.begin(), z_temp.end(), &z[0]);
-
-    stream.close();	
 }
 
 /**
@@ -527,35 +879,11 @@ void read_table(const Tstring                 fname,
                 Tcontainerz<Tz, TzParams...> &z,
                 Tcontaineru<Tu, TuParams...> &u)
 {
-    std::ifstream stream(fname);
-
-    if(!stream.is_open())
-    {
-        std::ostringstream oss;
-        oss << "Could not open " << fname;
-        throw std::runtime_error(oss.str());
-    }
-
     std::vector<Tx> x_temp;
     std::vector<Ty> y_temp;
     std::vector<Tz> z_temp;
     std::vector<Tu> u_temp;
-
-    while(!stream.eof()){
-        Tx buffer_x; // Buffer for x input data
-        Ty buffer_y; // Buffer for y input data
-        Tz buffer_z; // Buffer for z input data
-        Tu buffer_u; // Buffer for u input data
-
-        // If data is valid, stick it into temp vector
-        if(!read_line(stream, buffer_x, buffer_y, buffer_z, buffer_u))
-        {
-            x_temp.push_back(buffer_x);
-            y_temp.push_back(buffer_y);
-            z_temp.push_back(buffer_z);
-            u_temp.push_back(buffer_u);
-        }
-    }
+    read_columns(fname, x_temp, y_temp, z_temp, u_temp);
 
     const size_t nx = x_temp.size();
     const size_t ny = y_temp.size();
@@ -579,8 +907,6 @@ void read_table(const Tstring                 fname,
     std::copy(y_temp.begin(), y_temp.end(), &y[0]);
     std::copy(z_temp.begin(), z_temp.end(), &z[0]);
     std::copy(u_temp.begin(), u_temp.end(), &u[0]);
-
-    stream.close();
 }
 
 /**
@@ -591,6 +917,8 @@ void read_table(const Tstring                 fname,
  * \param[in] y         Value array containing y data
  * \param[in] z         Value array containing z data
  * \param[in] with_num  Add an initial column containing the line number
+ * \param[in] precision Number of decimal places to use in scientific format.
+ *                      If negative, the default stream format is used
  */
 template <class Tstring,
           template<typename, typename...> class Tcontainerx,
@@ -607,20 +935,13 @@ void write_table(const Tstring                       fname,
                  const Tcontainerx<Tx, TxParams...> &x,
                  const Tcontainery<Ty, TyParams...> &y,
                  const Tcontainerz<Tz, TzParams...> &z,
-                 const bool                          with_num = false)
+                 const bool                          with_num  = false,
+                 const int                           precision = -1)
 {
-    std::ofstream stream(fname);
     const size_t nx = x.size();
     const size_t ny = y.size();
     const size_t nz = z.size();
 
-    if(!stream.is_open())
-    {
-        std::ostringstream oss;
-        oss << "Could not open " << fname;
-        throw std::runtime_error(oss.str());
-    }
-
     if(nx != ny or nx != nz or ny != nz)
     {
         std::ostringstream oss;
@@ -628,15 +949,15 @@ void write_table(const Tstring                       fname,
         throw std::runtime_error(oss.str());
     }
 
+    TableWriter stream(fname, precision, precision >= 0);
+
     for(unsigned int i=0; i<nx; i++)
     {
         if(with_num)
-            stream << i+1 << "\t" << x[i] << "\t" << y[i] << "\t" << z[i] << std::endl;
+            stream << i+1 << "\t" << x[i] << "\t" << y[i] << "\t" << z[i] << '\n';
         else
-            stream << x[i] << "\t" << y[i] << "\t" << z[i] << std::endl;
+            stream << x[i] << "\t" << y[i] << "\t" << z[i] << '\n';
     }
-
-    stream.close();	
 }
 
 /**
@@ -648,6 +969,8 @@ void write_table(const Tstring                       fname,
  * \param[in] z         Value array containing z data
  * \param[in] u         Value array containing u data
  * \param[in] with_num  Add an initial column containing the line number
+ * \param[in] precision Number of decimal places to use in scientific format.
+ *                      If negative, the default stream format is used
  */
 template<class Tstring,
          template<typename, typename...> class Tcontainerx,
@@ -663,21 +986,14 @@ void write_table(const Tstring          fname,
                  const Tcontainery<Ty> &y,
                  const Tcontainerz<Tz> &z,
                  const Tcontaineru<Tu> &u,
-                 const bool             with_num = false)
+                 const bool             with_num  = false,
+                 const int              precision = -1)
 {
-    std::ofstream stream(fname);
     const size_t nx = x.size();
     const size_t ny = y.size();
     const size_t nz = z.size();
     const size_t nu = u.size();
 
-    if(!stream.is_open())
-    {
-        std::ostringstream oss;
-        oss << "Could not open " << fname;
-        throw std::runtime_error(oss.str());
-    }
-
     if(nx != ny || nx != nz || ny != nz || nu != nz)
     {
         std::ostringstream oss;
@@ -685,15 +1001,15 @@ void write_table(const Tstring          fname,
         throw std::runtime_error(oss.str());
     }
 
+    TableWriter stream(fname, precision, precision >= 0);
+
     for(unsigned int i=0; i<nx; i++)
     {
         if(with_num)
-            stream << i+1 << "\t" << x[i] << "\t" << y[i] << "\t" << z[i] << "\t" << u[i] << std::endl;
+            stream << i+1 << "\t" << x[i] << "\t" << y[i] << "\t" << z[i] << "\t" << u[i] << '\n';
         else
-            stream << x[i] << "\t" << y[i] << "\t" << z[i] << "\t" << u[i] << std::endl;
+            stream << x[i] << "\t" << y[i] << "\t" << z[i] << "\t" << u[i] << '\n';
     }
-
-    stream.close();	
 }
 } // namespace
 #endif
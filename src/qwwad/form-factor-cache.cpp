@@ -0,0 +1,142 @@
+/**
+ * \file   form-factor-cache.cpp
+ * \brief  Persistent storage for intersubband form-factor tables
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "form-factor-cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "checkpoint.h"
+#include "hash.h"
+
+namespace QWWAD
+{
+/// Identifier at the start of a form-factor cache file
+static const char ff_magic[8] = {'Q','W','W','A','D','G','I','F'};
+
+/// Version number of the form-factor cache file format
+static const uint32_t ff_version = 1;
+
+/**
+ * \brief Open a cache in a given directory
+ *
+ * \param[in] dir Directory in which the tables are stored.  This must already exist.
+ */
+FormFactorCache::FormFactorCache(decltype(_dir) dir) :
+    _dir(dir)
+{}
+
+/**
+ * \brief Find the name of the file that holds a form-factor table
+ *
+ * \param[in] isb Initial subband
+ * \param[in] fsb Final subband
+ * \param[in] Kz  Phonon wave-vector samples [1/m]
+ */
+std::string FormFactorCache::get_filename(const Subband   &isb,
+                                          const Subband   &fsb,
+                                          const arma::vec &Kz) const
+{
+    uint64_t hash = hash_offset_basis;
+
+    for(auto data : {&isb.z_array(), &isb.psi_array(), &fsb.psi_array(), &Kz})
+        hash_bytes(data->memptr(), data->n_elem*sizeof(double), hash);
+
+    std::ostringstream fname;
+    fname << _dir << "/" << format_hash(hash) << "-G.bin";
+
+    return fname.str();
+}
+
+/**
+ * \brief Read a form-factor table from the cache
+ *
+ * \param[in]  isb    Initial subband
+ * \param[in]  fsb    Final subband
+ * \param[in]  Kz     Phonon wave-vector samples [1/m]
+ * \param[out] Gifsqr Squared form factor at each wave-vector
+ *
+ * \returns True if the table was found.  If not, Gifsqr is left unchanged.
+ *
+ * \details The wave-vector samples stored in the file must match Kz exactly,
+ *          which guards against hash collisions and partly-written files.
+ */
+bool FormFactorCache::read(const Subband   &isb,
+                           const Subband   &fsb,
+                           const arma::vec &Kz,
+                           arma::vec       &Gifsqr) const
+{
+    std::ifstream stream(get_filename(isb, fsb, Kz).c_str(), std::ios::binary);
+
+    if(!stream)
+        return false;
+
+    char     magic[sizeof(ff_magic)];
+    uint32_t version = 0;
+    uint64_t nKz     = 0;
+
+    stream.read(magic, sizeof(magic));
+    stream.read(reinterpret_cast<char *>(&version), sizeof(version));
+    stream.read(reinterpret_cast<char *>(&nKz),     sizeof(nKz));
+
+    if(!stream || !std::equal(magic, magic + sizeof(magic), ff_magic)
+       || version != ff_version || nKz != Kz.size())
+        return false;
+
+    arma::vec Kz_file(nKz);
+    arma::vec G_file(nKz);
+    stream.read(reinterpret_cast<char *>(Kz_file.memptr()), nKz*sizeof(double));
+    stream.read(reinterpret_cast<char *>(G_file.memptr()),  nKz*sizeof(double));
+
+    if(!stream || !std::equal(Kz.begin(), Kz.end(), Kz_file.begin()))
+        return false;
+
+    Gifsqr = G_file;
+    return true;
+}
+
+/**
+ * \brief Save a form-factor table to the cache
+ *
+ * \param[in] isb    Initial subband
+ * \param[in] fsb    Final subband
+ * \param[in] Kz     Phonon wave-vector samples [1/m]
+ * \param[in] Gifsqr Squared form factor at each wave-vector
+ *
+ * \details Another run may be reading the cache at the same time, so the table is
+ *          saved with write_checkpoint_file and is never seen half-written.
+ */
+void FormFactorCache::write(const Subband   &isb,
+                            const Subband   &fsb,
+                            const arma::vec &Kz,
+                            const arma::vec &Gifsqr) const
+{
+    if(Gifsqr.size() != Kz.size())
+    {
+        std::ostringstream oss;
+        oss << "Form-factor table has " << Gifsqr.size() << " samples, but there are "
+            << Kz.size() << " wave-vector samples.";
+        throw std::length_error(oss.str());
+    }
+
+    const auto fname = get_filename(isb, fsb, Kz);
+
+    std::string buffer = start_checkpoint(ff_magic, ff_version);
+    append_checkpoint_table(buffer, Kz.memptr(), Kz.size());
+    buffer.append(reinterpret_cast<const char *>(Gifsqr.memptr()), Gifsqr.size()*sizeof(double));
+
+    if(!write_checkpoint_file(fname, buffer))
+    {
+        std::ostringstream oss;
+        oss << "Could not write form factors to " << fname;
+        throw std::runtime_error(oss.str());
+    }
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,53 @@
+/**
+ * \file   form-factor-cache.h
+ * \brief  Persistent storage for intersubband form-factor tables
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_FORM_FACTOR_CACHE_H
+#define QWWAD_FORM_FACTOR_CACHE_H
+
+#include <string>
+#include <armadillo>
+#include "subband.h"
+
+namespace QWWAD
+{
+/**
+ * \brief A directory of saved form-factor tables
+ *
+ * \details The squared form factor
+ *          \f[
+ *            G_{if}^2(K_z) = \left|\int\psi_i\psi_f\mathrm{e}^{\mathrm{i}K_z z}\,\mathrm{d}z\right|^2
+ *          \f]
+ *          depends only on the pair of wavefunctions and the set of phonon
+ *          wave-vectors.  Each table is stored in its own binary file, named by a
+ *          hash of the spatial grid, both wavefunctions and the \f$K_z\f$ samples,
+ *          so that sweeps over temperature, phonon energy or screening can reuse
+ *          the tables from a previous run.
+ */
+class FormFactorCache
+{
+private:
+    std::string _dir; ///< Directory in which the tables are stored
+
+public:
+    FormFactorCache(decltype(_dir) dir);
+
+    std::string get_filename(const Subband   &isb,
+                             const Subband   &fsb,
+                             const arma::vec &Kz) const;
+
+    bool read(const Subband   &isb,
+              const Subband   &fsb,
+              const arma::vec &Kz,
+              arma::vec       &Gifsqr) const;
+
+    void write(const Subband   &isb,
+               const Subband   &fsb,
+               const arma::vec &Kz,
+               const arma::vec &Gifsqr) const;
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
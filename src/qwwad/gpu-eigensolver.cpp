@@ -0,0 +1,236 @@
+/**
+ * \file   gpu-eigensolver.cpp
+ * \brief  Dense Hermitian eigensolver on a GPU, for builds with cuSOLVER support
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "gpu-eigensolver.h"
+
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+#if HAVE_CUSOLVER
+# include <cuda_runtime.h>
+# include <cusolverDn.h>
+#endif
+
+#include "profiler.h"
+
+namespace QWWAD
+{
+/// Smallest order of matrix that is diagonalised on the GPU (0 = never use the GPU)
+static std::atomic<size_t> gpu_threshold(2000);
+
+/**
+ * \brief Set the smallest order of matrix that is diagonalised on the GPU
+ *
+ * \param[in] N The order of the matrix.  If zero, the GPU is never used.
+ *
+ * \details This is normally set by the \c --gputhreshold option, which is
+ *          common to all programs.  Below a few thousand, the cost of copying
+ *          the matrix to the GPU outweighs the faster solution.
+ */
+void set_gpu_threshold(const size_t N)
+{
+    gpu_threshold = N;
+}
+
+/**
+ * \brief Get the smallest order of matrix that is diagonalised on the GPU
+ */
+size_t get_gpu_threshold()
+{
+    return gpu_threshold;
+}
+
+/**
+ * \brief Check whether a GPU eigensolver can be used
+ *
+ * \returns True if QWWAD was built with cuSOLVER support and a GPU is present
+ */
+bool gpu_eigensolver_available()
+{
+#if HAVE_CUSOLVER
+    static const bool available = [] {
+        int n_devices = 0;
+        return cudaGetDeviceCount(&n_devices) == cudaSuccess && n_devices > 0;
+    }();
+
+    return available;
+#else
+    return false;
+#endif
+}
+
+/**
+ * \brief Check whether a matrix should be diagonalised on the GPU
+ *
+ * \param[in] N Order of the matrix
+ */
+bool use_gpu_eigensolver(const size_t N)
+{
+    const size_t threshold = gpu_threshold;
+    return threshold > 0 && N >= threshold && gpu_eigensolver_available();
+}
+
+#if HAVE_CUSOLVER
+/**
+ * \brief Throw an exception if a CUDA or cuSOLVER call failed
+ *
+ * \param[in] ok   True if the call succeeded
+ * \param[in] what Name of the call
+ */
+static void check_gpu_call(const bool  ok,
+                           const char *what)
+{
+    if(!ok)
+    {
+        std::ostringstream oss;
+        oss << "GPU eigensolver failed in " << what << ".";
+        throw std::runtime_error(oss.str());
+    }
+}
+
+/**
+ * \brief A block of GPU memory, which is released when it goes out of scope
+ */
+class DeviceBuffer
+{
+private:
+    void *_ptr; ///< Start of the block
+
+public:
+    explicit DeviceBuffer(const size_t bytes) :
+        _ptr(nullptr)
+    {
+        check_gpu_call(cudaMalloc(&_ptr, bytes) == cudaSuccess, "cudaMalloc");
+    }
+
+    ~DeviceBuffer() {cudaFree(_ptr);}
+
+    DeviceBuffer(const DeviceBuffer &) = delete;
+    DeviceBuffer & operator=(const DeviceBuffer &) = delete;
+
+    /// Return the start of the block, as an array of the given type
+    template <class T>
+    T * get() const {return static_cast<T *>(_ptr);}
+};
+#endif
+
+/**
+ * \brief Find a range of eigenpairs of a Hermitian matrix on the GPU
+ *
+ * \param[in,out] A    The matrix.  Only the lower triangle is used.
+ * \param[in]     i_lo Index (from 0) of the lowest eigenvalue to find
+ * \param[in]     i_hi Index (from 0) of the highest eigenvalue to find
+ * \param[out]    Z    The eigenvectors, one per column.  Ignored if null.
+ *
+ * \returns The eigenvalues, in ascending order
+ *
+ * \details This uses cuSOLVER zheevdx, which is the GPU counterpart of the
+ *          LAPACK zheevr call in eigen_hermitian_range.  Only one solution runs on
+ *          the GPU at a time, so threads that share a GPU wait for each other
+ *          rather than competing for its memory.
+ */
+arma::vec
+eigen_hermitian_gpu(arma::cx_mat       &A,
+                    const unsigned int  i_lo,
+                    const unsigned int  i_hi,
+                    arma::cx_mat       *Z)
+{
+#if HAVE_CUSOLVER
+    const int N = A.n_rows;
+
+    if(A.n_cols != A.n_rows || i_lo > i_hi || i_hi >= A.n_rows)
+    {
+        std::ostringstream oss;
+        oss << "Cannot find eigenvalues " << i_lo << " to " << i_hi << " of a "
+            << A.n_rows << "x" << A.n_cols << " matrix.";
+        throw std::domain_error(oss.str());
+    }
+
+    static std::mutex gpu_mutex;
+    std::lock_guard<std::mutex> lock(gpu_mutex);
+
+    QWWAD_COUNT  ("cuSOLVER zheevdx calls");
+    QWWAD_COUNT_N("cuSOLVER zheevdx total size", N);
+
+    static cusolverDnHandle_t handle = nullptr;
+
+    if(!handle)
+        check_gpu_call(cusolverDnCreate(&handle) == CUSOLVER_STATUS_SUCCESS, "cusolverDnCreate");
+
+    const cusolverEigMode_t  jobz  = Z ? CUSOLVER_EIG_MODE_VECTOR : CUSOLVER_EIG_MODE_NOVECTOR;
+    const cusolverEigRange_t range = CUSOLVER_EIG_RANGE_I;
+    const cublasFillMode_t   uplo  = CUBLAS_FILL_MODE_LOWER;
+    const int                IL    = i_lo + 1; // cuSOLVER counts from 1, as LAPACK does
+    const int                IU    = i_hi + 1;
+
+    const size_t A_bytes = static_cast<size_t>(N)*N*sizeof(cuDoubleComplex);
+
+    DeviceBuffer A_buffer(A_bytes);
+    DeviceBuffer W_buffer(N*sizeof(double));
+    DeviceBuffer info_buffer(sizeof(int));
+
+    auto *d_A    = A_buffer.get<cuDoubleComplex>();
+    auto *d_W    = W_buffer.get<double>();
+    auto *d_info = info_buffer.get<int>();
+
+    check_gpu_call(cudaMemcpy(d_A, A.memptr(), A_bytes, cudaMemcpyHostToDevice) == cudaSuccess,
+                   "cudaMemcpy");
+
+    int M     = 0; // Number of solutions found
+    int lwork = 0;
+
+    check_gpu_call(cusolverDnZheevdx_bufferSize(handle, jobz, range, uplo, N, d_A, N, 0.0, 0.0,
+                                                IL, IU, &M, d_W, &lwork) == CUSOLVER_STATUS_SUCCESS,
+                   "cusolverDnZheevdx_bufferSize");
+
+    DeviceBuffer work_buffer(static_cast<size_t>(lwork)*sizeof(cuDoubleComplex));
+    auto *d_work = work_buffer.get<cuDoubleComplex>();
+
+    check_gpu_call(cusolverDnZheevdx(handle, jobz, range, uplo, N, d_A, N, 0.0, 0.0, IL, IU, &M,
+                                     d_W, d_work, lwork, d_info) == CUSOLVER_STATUS_SUCCESS,
+                   "cusolverDnZheevdx");
+
+    int info = 0;
+    check_gpu_call(cudaMemcpy(&info, d_info, sizeof(int), cudaMemcpyDeviceToHost) == cudaSuccess,
+                   "cudaMemcpy");
+
+    if(info != 0)
+    {
+        std::ostringstream oss;
+        oss << "Could not solve eigenvalue problem on the GPU. cuSOLVER error code: " << info;
+        throw std::runtime_error(oss.str());
+    }
+
+    arma::vec W(M);
+    check_gpu_call(cudaMemcpy(W.memptr(), d_W, M*sizeof(double), cudaMemcpyDeviceToHost) == cudaSuccess,
+                   "cudaMemcpy");
+
+    // The eigenvectors overwrite the first M columns of the matrix
+    if(Z)
+    {
+        Z->set_size(N, M);
+        const size_t Z_bytes = static_cast<size_t>(N)*M*sizeof(cuDoubleComplex);
+        check_gpu_call(cudaMemcpy(Z->memptr(), d_A, Z_bytes, cudaMemcpyDeviceToHost) == cudaSuccess,
+                       "cudaMemcpy");
+    }
+
+    return W;
+#else
+    (void)A;
+    (void)i_lo;
+    (void)i_hi;
+    (void)Z;
+    throw std::runtime_error("QWWAD was built without GPU support.");
+#endif
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,28 @@
+/**
+ * \file   gpu-eigensolver.h
+ * \brief  Dense Hermitian eigensolver on a GPU, for builds with cuSOLVER support
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_GPU_EIGENSOLVER_H
+#define QWWAD_GPU_EIGENSOLVER_H
+
+#include <cstddef>
+#include <armadillo>
+
+namespace QWWAD
+{
+void   set_gpu_threshold(const size_t N);
+size_t get_gpu_threshold();
+
+bool gpu_eigensolver_available();
+bool use_gpu_eigensolver(const size_t N);
+
+arma::vec
+eigen_hermitian_gpu(arma::cx_mat       &A,
+                    const unsigned int  i_lo,
+                    const unsigned int  i_hi,
+                    arma::cx_mat       *Z);
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
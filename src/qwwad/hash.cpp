@@ -0,0 +1,44 @@
+/**
+ * \file   hash.cpp
+ * \brief  64-bit FNV-1a hashes, used to name cache files
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "hash.h"
+#include <iomanip>
+#include <sstream>
+
+namespace QWWAD
+{
+/**
+ * \brief Add a block of data to a 64-bit FNV-1a hash
+ *
+ * \param[in]     data  The data to add
+ * \param[in]     n     The number of bytes of data
+ * \param[in,out] hash  The hash value to update.  This should start at
+ *                      hash_offset_basis.
+ */
+void hash_bytes(const void *data,
+                size_t      n,
+                uint64_t   &hash)
+{
+    const auto bytes = reinterpret_cast<const unsigned char *>(data);
+
+    for(size_t i = 0; i < n; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+}
+
+/**
+ * \brief Write a hash as 16 hexadecimal digits
+ */
+std::string format_hash(const uint64_t hash)
+{
+    std::ostringstream oss;
+    oss << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return oss.str();
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
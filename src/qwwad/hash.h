@@ -0,0 +1,26 @@
+/**
+ * \file   hash.h
+ * \brief  64-bit FNV-1a hashes, used to name cache files
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_HASH_H
+#define QWWAD_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace QWWAD
+{
+/// Starting value for a 64-bit FNV-1a hash
+const uint64_t hash_offset_basis = 14695981039346656037ULL;
+
+void hash_bytes(const void *data,
+                size_t      n,
+                uint64_t   &hash);
+
+std::string format_hash(const uint64_t hash);
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
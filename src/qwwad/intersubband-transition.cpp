@@ -1,3 +1,9 @@
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_integration.h>
 #include "intersubband-transition.h"
 #include "constants.h"
 #include "maths-helpers.h"
@@ -8,15 +14,18 @@ using namespace constants;
 /**
  * \brief Initialise an intersubband transition
  *
- * \param[in] isb Initial subband
- * \param[in] fsb Final subband
- * \param[in] ki  Initial wave-vector samples [1/m]
- * \param[in] Wif Scattering rate at each wave-vector [1/s]
+ * \param[in] isb    Initial subband
+ * \param[in] fsb    Final subband
+ * \param[in] ki     Initial wave-vector samples [1/m]
+ * \param[in] Wif    Scattering rate at each wave-vector [1/s]
+ * \param[in] E_loss Energy given to the lattice in each scattering event, e.g.,
+ *                   the phonon energy for an emission process [J]
  */
 IntersubbandTransition::IntersubbandTransition(const decltype(_isb) isb,
                                                const decltype(_fsb) fsb,
                                                const decltype(_ki)  ki,
-                                               const decltype(_Wif) Wif) :
+                                               const decltype(_Wif) Wif,
+                                               const double         E_loss) :
     _isb(isb),
     _fsb(fsb),
     _ki(ki),
@@ -29,12 +38,31 @@ IntersubbandTransition::IntersubbandTransition(const decltype(_isb) isb,
 
     for(unsigned int iki = 0; iki < nki; ++iki)
         _Eki[iki] = isb.get_Ek_at_k(_ki[iki]);
+
+    // ...and the energy-conserving final wave-vector.  States below the threshold
+    // for scattering are given the band-edge state in the final subband, but are
+    // flagged so that they are not blocked
+    _kf.resize(nki);
+    _kf_allowed.set_size(nki);
+
+    for(unsigned int iki = 0; iki < nki; ++iki)
+    {
+        const auto Ekf = _Eki[iki] + isb.get_E_min() - fsb.get_E_min() - E_loss;
+        _kf_allowed[iki] = (Ekf >= 0.0);
+        _kf[iki] = (Ekf > 0.0) ? fsb.get_k_at_Ek(Ekf) : 0.0;
+    }
 }
 
 /**
- * \brief Return the average scattering rate
+ * \brief Find an average of a table of scattering rates over an initial distribution
+ *
+ * \param[in] Wif       Scattering rate at each initial wave-vector [1/s]
+ * \param[in] f_initial Occupation of the initial subband as a function of wave-vector
+ * \param[in] N         Sheet density of carriers in the initial subband [m^{-2}]
  */
-double IntersubbandTransition::get_average_rate() const
+double IntersubbandTransition::average_rate(const arma::vec           &Wif,
+                                            const occupation_function &f_initial,
+                                            const double               N) const
 {
     const auto nki = _ki.size();
     const auto dki = _ki[1] - _ki[0];
@@ -43,14 +71,254 @@ double IntersubbandTransition::get_average_rate() const
 
     for(unsigned int iki=0; iki<nki; ++iki)
     {
-        const auto ki   = _ki[iki];
-        const auto f_FD = _isb.get_occupation_at_k(ki);
-        Wbar_integrand_ki[iki] = _Wif[iki]*ki*f_FD;
+        const auto ki = _ki[iki];
+        Wbar_integrand_ki[iki] = Wif[iki]*ki*f_initial(ki);
     } // End loop over ki
 
-    const auto N = _isb.get_total_population();
     const auto Wif_avg = integral(Wbar_integrand_ki, dki)/(pi*N);
     return Wif_avg;
 }
+
+/**
+ * \brief Return the scattering rate at each wave-vector, blocked by a final distribution
+ *
+ * \param[in] f_final Occupation of the final subband as a function of wave-vector
+ *
+ * \details The table should have been made without blocking, so that the
+ *          blocking is not counted twice.  Initial states below the threshold
+ *          for scattering have no final state, so they are not blocked.
+ */
+arma::vec IntersubbandTransition::get_rate_table(const occupation_function &f_final) const
+{
+    arma::vec Wif = _Wif;
+
+    for(unsigned int iki = 0; iki < _ki.size(); ++iki)
+    {
+        if(_kf_allowed[iki])
+            Wif[iki] *= (1 - f_final(_kf[iki]));
+    }
+
+    return Wif;
+}
+
+/**
+ * \brief Return the average scattering rate
+ *
+ * \details The rates are weighted by the Fermi--Dirac distribution of the
+ *          initial subband.
+ */
+double IntersubbandTransition::get_average_rate() const
+{
+    return average_rate(_Wif,
+                        [this](const double k) {return _isb.get_occupation_at_k(k);},
+                        _isb.get_total_population());
+}
+
+/**
+ * \brief Return the average scattering rate over an arbitrary initial distribution
+ *
+ * \param[in] f_initial Occupation of the initial subband as a function of wave-vector
+ * \param[in] N         Sheet density of carriers in the initial subband, i.e.,
+ *                      \f$\frac{1}{\pi}\int f(k) k\,\mathrm{d}k\f$ [m^{-2}]
+ */
+double IntersubbandTransition::get_average_rate(const occupation_function &f_initial,
+                                                const double               N) const
+{
+    return average_rate(_Wif, f_initial, N);
+}
+
+/**
+ * \brief Return the average scattering rate over arbitrary initial and final distributions
+ *
+ * \param[in] f_initial Occupation of the initial subband as a function of wave-vector
+ * \param[in] N         Sheet density of carriers in the initial subband [m^{-2}]
+ * \param[in] f_final   Occupation of the final subband as a function of wave-vector
+ *
+ * \details The final distribution is used for final-state blocking, so the table
+ *          should have been made without blocking.
+ */
+double IntersubbandTransition::get_average_rate(const occupation_function &f_initial,
+                                                const double               N,
+                                                const occupation_function &f_final) const
+{
+    return average_rate(get_rate_table(f_final), f_initial, N);
+}
+
+/// Parameters for the integrand in find_average_rate_adaptive
+struct AverageRateParams {
+    const Subband                        *isb;    ///< Initial subband
+    const std::function<double (double)> *Wif;    ///< Scattering rate as a function of ki [1/s]
+};
+
+/**
+ * \brief Integrand for the average scattering rate
+ */
+static double average_rate_integrand(double ki, void *params)
+{
+    auto p = reinterpret_cast<AverageRateParams *>(params);
+    return (*p->Wif)(ki) * ki * p->isb->get_occupation_at_k(ki);
+}
+
+/**
+ * \brief Find the average scattering rate using adaptive quadrature
+ *
+ * \param[in]  isb     The initial subband
+ * \param[in]  ki_min  Minimum initial wave-vector that allows scattering [1/m]
+ * \param[in]  ki_max  Cut-off initial wave-vector [1/m]
+ * \param[in]  Wif     Total scattering rate as a function of initial wave-vector [1/s]
+ * \param[in]  rel_tol Relative tolerance of the integral
+ *
+ * \details This gives the same average as IntersubbandTransition::get_average_rate,
+ *          but uses a Gauss--Kronrod rule with automatic subdivision rather than a
+ *          fixed table of samples.  The samples then cluster near the subband
+ *          edge, where the occupation is largest, and near any threshold in the
+ *          rate.
+ */
+double find_average_rate_adaptive(const Subband                         &isb,
+                                  const double                           ki_min,
+                                  const double                           ki_max,
+                                  const std::function<double (double)> &Wif,
+                                  const double                           rel_tol)
+{
+    const size_t max_intervals = 1000;
+
+    AverageRateParams params = {&isb, &Wif};
+
+    gsl_function F;
+    F.function = &average_rate_integrand;
+    F.params   = &params;
+
+    double result = 0.0;
+    double error  = 0.0;
+
+    if(ki_max > ki_min)
+    {
+        gsl_integration_workspace *w = gsl_integration_workspace_alloc(max_intervals);
+
+        // Report failure by exception rather than letting GSL abort
+        gsl_error_handler_t *old_handler = gsl_set_error_handler_off();
+        const int status = gsl_integration_qags(&F, ki_min, ki_max, 0, rel_tol, max_intervals,
+                                                w, &result, &error);
+        gsl_set_error_handler(old_handler);
+        gsl_integration_workspace_free(w);
+
+        if(status != GSL_SUCCESS)
+        {
+            std::ostringstream oss;
+            oss << "Could not find average scattering rate to relative tolerance " << rel_tol
+                << ": " << gsl_strerror(status);
+            throw std::runtime_error(oss.str());
+        }
+    }
+
+    return result/(pi*isb.get_total_population());
+}
+
+/**
+ * \brief Find the maximum initial kinetic energy for an elastic scattering calculation
+ *
+ * \param[in] isb         Initial subband
+ * \param[in] fsb         Final subband
+ * \param[in] m           Effective mass [kg]
+ * \param[in] T           Temperature of carrier distribution [K]
+ * \param[in] Ecutoff_set True if the user has set a cut-off energy
+ * \param[in] Ecutoff     User-specified cut-off kinetic energy [J]
+ *
+ * \details If no cut-off has been set, a range of 5kT above the subband minimum
+ *          (or the Fermi energy) is used.  In either case, the range is extended
+ *          if it would not allow any scattering to the final subband.
+ */
+double find_elastic_Eki_cutoff(const Subband &isb,
+                               const Subband &fsb,
+                               const double   m,
+                               const double   T,
+                               const bool     Ecutoff_set,
+                               const double   Ecutoff)
+{
+    // Subband minima
+    const double Ei = isb.get_E_min();
+    const double Ef = fsb.get_E_min();
+
+    double Eki_cutoff = 0.0; // Maximum kinetic energy in initial subband
+
+    if(Ecutoff_set)
+        Eki_cutoff = Ecutoff;
+    else
+    {
+        const double kimax = isb.get_k_max(T);
+        Eki_cutoff = hBar*hBar*kimax*kimax/(2*m);
+    }
+
+    if(Eki_cutoff+Ei < Ef)
+        Eki_cutoff += Ef;
+
+    return Eki_cutoff;
+}
+
+/**
+ * \brief Find the minimum initial wave-vector that allows elastic scattering
+ *
+ * \param[in] isb Initial subband
+ * \param[in] fsb Final subband
+ * \param[in] m   Effective mass [kg]
+ */
+double find_elastic_ki_min(const Subband &isb,
+                           const Subband &fsb,
+                           const double   m)
+{
+    const double Efi = fsb.get_E_min() - isb.get_E_min();
+    double kimin = 0.0;
+
+    if(Efi > 0)
+        kimin = sqrt(2*m*Efi)/hBar;
+
+    return kimin;
+}
+
+/**
+ * \brief Warn the user if a cut-off energy does not allow a transition
+ *
+ * \param[in] subbands The subbands
+ * \param[in] i        Initial subband index (from 0)
+ * \param[in] f        Final subband index (from 0)
+ * \param[in] Ecutoff  User-specified cut-off kinetic energy [J]
+ *
+ * \details The calculators extend the range automatically in this case (see
+ *          find_elastic_Eki_cutoff).
+ */
+void warn_Ecutoff_extended(const std::vector<Subband> &subbands,
+                           const unsigned int          i,
+                           const unsigned int          f,
+                           const double                Ecutoff)
+{
+    if(Ecutoff + subbands[i].get_E_min() < subbands[f].get_E_min())
+    {
+        std::cerr << "No scattering permitted from state " << i+1 << "->" << f+1
+                  << " within the specified cut-off energy." << std::endl;
+        std::cerr << "Extending range automatically" << std::endl;
+    }
+}
+
+/**
+ * \brief Change the population of each subband
+ *
+ * \param[in,out] subbands The subbands
+ * \param[in]     N        Sheet density of carriers in each subband [m^{-2}]
+ * \param[in]     Te       Temperature of the carrier distributions [K]
+ */
+void set_subband_populations(std::vector<Subband> &subbands,
+                             const arma::vec      &N,
+                             const double          Te)
+{
+    if(N.size() != subbands.size())
+    {
+        std::ostringstream oss;
+        oss << "Got " << N.size() << " populations for " << subbands.size() << " subbands.";
+        throw std::length_error(oss.str());
+    }
+
+    for(unsigned int isb = 0; isb < subbands.size(); ++isb)
+        subbands[isb].set_distribution_from_N_Te(N[isb], Te);
+}
 } // namespace
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -7,19 +7,31 @@
 #ifndef QWWAD_INTERSUBBAND_TRANSITION
 #define QWWAD_INTERSUBBAND_TRANSITION
 
+#include <functional>
+#include <vector>
 #include "subband.h"
 
 namespace QWWAD {
+/// Occupation of a state as a function of its in-plane wave-vector [1/m]
+typedef std::function<double (double)> occupation_function;
+
 /**
  * \brief A generalised table of scattering rates between a pair of subbands
+ *
+ * \details If the table was made without final-state blocking (see the get_kernel
+ *          function of each scattering calculator), the rates do not depend on the
+ *          carrier distributions.  Averages and blocking for any pair of
+ *          distributions can then be found from the same table as cheap weighted
+ *          sums, without repeating the integrals in the calculator.
  */
 class IntersubbandTransition {
 private:
     Subband _isb; ///< The initial subband
     Subband _fsb; ///< The final subband
 
-    arma::vec _ki;  ///< Array of initial wave-vectors     [1/m]
-    //arma::vec _kf;     ///< Array of corresponding energy-conserving final wave-vectors [1/m]
+    arma::vec  _ki;         ///< Array of initial wave-vectors     [1/m]
+    arma::vec  _kf;         ///< Array of corresponding energy-conserving final wave-vectors [1/m]
+    arma::uvec _kf_allowed; ///< Nonzero if the final wave-vector is a real final state
 
     /**
      * \brief Array of scattering rates [1/s]
@@ -32,21 +44,62 @@ private:
     // Derived properties
     arma::vec _Eki; ///< Array of initial kinetic energies [1/m]
 
+    double average_rate(const arma::vec           &Wif,
+                        const occupation_function &f_initial,
+                        const double               N) const;
+
 public:
     IntersubbandTransition(const decltype(_isb)    isb,
                            const decltype(_fsb)    fsb,
                            const decltype(_ki)     ki,
-                           const decltype(_Wif) Wif_ki);
+                           const decltype(_Wif) Wif_ki,
+                           const double         E_loss = 0.0);
 
     inline decltype(_ki)  get_ki_table        () const {return _ki;}
+    inline decltype(_kf)  get_kf_table        () const {return _kf;}
     inline decltype(_Eki) get_Eki_table       () const {return _Eki;}
     inline decltype(_Eki) get_Ei_total_table  () const {return _Eki + _isb.get_E_min();}
     inline decltype(_Wif) get_rate_table () const {return _Wif;}
     inline double get_ki_by_index        (unsigned int ik) const {return _ki[ik];}
     inline double get_rate_at_ki_by_index(unsigned int ik) const {return _Wif[ik];}
 
+    arma::vec get_rate_table(const occupation_function &f_final) const;
+
     double get_average_rate() const;
+
+    double get_average_rate(const occupation_function &f_initial,
+                            const double               N) const;
+
+    double get_average_rate(const occupation_function &f_initial,
+                            const double               N,
+                            const occupation_function &f_final) const;
 };
+
+double find_average_rate_adaptive(const Subband                         &isb,
+                                  const double                           ki_min,
+                                  const double                           ki_max,
+                                  const std::function<double (double)> &Wif,
+                                  const double                           rel_tol);
+
+double find_elastic_Eki_cutoff(const Subband &isb,
+                               const Subband &fsb,
+                               const double   m,
+                               const double   T,
+                               const bool     Ecutoff_set,
+                               const double   Ecutoff);
+
+double find_elastic_ki_min(const Subband &isb,
+                           const Subband &fsb,
+                           const double   m);
+
+void warn_Ecutoff_extended(const std::vector<Subband> &subbands,
+                           const unsigned int          i,
+                           const unsigned int          f,
+                           const double                Ecutoff);
+
+void set_subband_populations(std::vector<Subband> &subbands,
+                             const arma::vec      &N,
+                             const double          Te);
 } // namespace
 #endif
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
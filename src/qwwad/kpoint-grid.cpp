@@ -0,0 +1,242 @@
+/**
+ * \file   kpoint-grid.cpp
+ * \brief  Uniform grids of wave vectors in the Brillouin zone, reduced by symmetry
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "kpoint-grid.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+namespace QWWAD
+{
+/// A wave vector on the grid, in units of 2pi/(n A0)
+typedef std::array<long, 3> grid_vector;
+
+/// Primitive reciprocal lattice vectors of an FCC crystal [2pi/A0]
+static const long b[3][3] = {{-1,  1,  1},
+                             { 1, -1,  1},
+                             { 1,  1, -1}};
+
+/**
+ * \brief Find the index of a wave vector in the grid
+ *
+ * \param[in] K Wave vector [2pi/(n A0)]
+ * \param[in] n Number of divisions along each reciprocal lattice vector
+ *
+ * \details The components of K are all odd or all even, so the coefficients of
+ *          the reciprocal lattice vectors are integers.  Equivalent wave vectors
+ *          in different zones have the same index.
+ */
+static size_t get_grid_index(const grid_vector &K,
+                             const long         n)
+{
+    // Coefficient of each reciprocal lattice vector, wrapped into the range [0,n)
+    auto wrap = [n](const long c) {return ((c % n) + n) % n;};
+
+    const long c1 = wrap((K[1] + K[2])/2);
+    const long c2 = wrap((K[0] + K[2])/2);
+    const long c3 = wrap((K[0] + K[1])/2);
+
+    return (c1*n + c2)*n + c3;
+}
+
+/**
+ * \brief Find the shortest wave vector that is equivalent to a given one
+ *
+ * \param[in] K Wave vector [2pi/(n A0)]
+ * \param[in] n Number of divisions along each reciprocal lattice vector
+ *
+ * \returns The equivalent wave vector in the first Brillouin zone
+ */
+static grid_vector get_shortest_image(const grid_vector &K,
+                                      const long         n)
+{
+    grid_vector K_min   = K;
+    long        Ksq_min = K[0]*K[0] + K[1]*K[1] + K[2]*K[2];
+
+    for(long s1 = -2; s1 <= 2; ++s1)
+    {
+        for(long s2 = -2; s2 <= 2; ++s2)
+        {
+            for(long s3 = -2; s3 <= 2; ++s3)
+            {
+                grid_vector K_image;
+                long        Ksq = 0;
+
+                for(unsigned int c = 0; c < 3; ++c)
+                {
+                    K_image[c] = K[c] + n*(s1*b[0][c] + s2*b[1][c] + s3*b[2][c]);
+                    Ksq       += K_image[c]*K_image[c];
+                }
+
+                if(Ksq < Ksq_min)
+                {
+                    K_min   = K_image;
+                    Ksq_min = Ksq;
+                }
+            }
+        }
+    }
+
+    return K_min;
+}
+
+/**
+ * \brief Convert a wave vector on the grid into units of 2pi/A0
+ */
+static arma::vec to_reciprocal_units(const grid_vector &K,
+                                     const long         n)
+{
+    arma::vec k(3);
+
+    for(unsigned int c = 0; c < 3; ++c)
+        k[c] = static_cast<double>(K[c])/n;
+
+    return k;
+}
+
+/**
+ * \brief Create a grid, and reduce it to its irreducible points
+ *
+ * \param[in] n Number of divisions along each reciprocal lattice vector
+ */
+FCCKPointGrid::FCCKPointGrid(const unsigned int n) :
+    _n(n),
+    _k_full(),
+    _k_irr(),
+    _w(),
+    _i_irr()
+{
+    if(n < 1)
+        throw std::invalid_argument("A wave-vector grid needs at least one division.");
+
+    const long   nl     = n;
+    const size_t n_full = n*n*n;
+
+    _k_full.resize(n_full);
+    _i_irr.set_size(n_full);
+
+    std::vector<bool>   found(n_full, false);
+    std::vector<size_t> count; // Number of grid points represented by each irreducible point
+
+    // Centre the coefficients of the reciprocal lattice vectors around zero
+    auto centre = [nl](const long c) {return (2*c > nl) ? c - nl : c;};
+
+    for(long c1 = 0; c1 < nl; ++c1)
+    {
+        for(long c2 = 0; c2 < nl; ++c2)
+        {
+            for(long c3 = 0; c3 < nl; ++c3)
+            {
+                grid_vector K;
+
+                for(unsigned int c = 0; c < 3; ++c)
+                    K[c] = centre(c1)*b[0][c] + centre(c2)*b[1][c] + centre(c3)*b[2][c];
+
+                K = get_shortest_image(K, nl);
+
+                const size_t index = get_grid_index(K, nl);
+                _k_full[index] = to_reciprocal_units(K, nl);
+
+                if(found[index])
+                    continue;
+
+                // Find every image of the point under the 48 operations of the
+                // cubic group: all permutations of the components, with any signs
+                const size_t i_irr = _k_irr.size();
+                size_t       n_images = 0;
+                std::array<unsigned int, 3> perm = {{0, 1, 2}};
+
+                do
+                {
+                    for(unsigned int signs = 0; signs < 8; ++signs)
+                    {
+                        grid_vector K_image;
+
+                        for(unsigned int c = 0; c < 3; ++c)
+                            K_image[c] = ((signs >> c) & 1) ? -K[perm[c]] : K[perm[c]];
+
+                        const size_t index_image = get_grid_index(K_image, nl);
+
+                        if(!found[index_image])
+                        {
+                            found[index_image]  = true;
+                            _i_irr[index_image] = i_irr;
+                            ++n_images;
+                        }
+                    }
+                } while(std::next_permutation(perm.begin(), perm.end()));
+
+                // Use the image in the wedge kx >= ky >= kz >= 0
+                grid_vector K_wedge = {{std::abs(K[0]), std::abs(K[1]), std::abs(K[2])}};
+                std::sort(K_wedge.begin(), K_wedge.end(), [](const long x, const long y) {return x > y;});
+
+                _k_irr.push_back(to_reciprocal_units(K_wedge, nl));
+                count.push_back(n_images);
+            }
+        }
+    }
+
+    _w.set_size(_k_irr.size());
+
+    for(unsigned int ik = 0; ik < _k_irr.size(); ++ik)
+        _w[ik] = static_cast<double>(count[ik])/n_full;
+}
+
+/**
+ * \brief Find the index of a point in the full grid
+ *
+ * \param[in] c1 Coefficient of the first reciprocal lattice vector, in units of 1/n
+ * \param[in] c2 Coefficient of the second reciprocal lattice vector, in units of 1/n
+ * \param[in] c3 Coefficient of the third reciprocal lattice vector, in units of 1/n
+ *
+ * \details The coefficients may lie outside the range [0,n), and the index of the
+ *          equivalent point in the grid is returned.
+ */
+size_t FCCKPointGrid::get_full_index(const long c1,
+                                     const long c2,
+                                     const long c3) const
+{
+    grid_vector K;
+
+    for(unsigned int c = 0; c < 3; ++c)
+        K[c] = c1*b[0][c] + c2*b[1][c] + c3*b[2][c];
+
+    return get_grid_index(K, _n);
+}
+
+/**
+ * \brief Copy values at the irreducible points to every point in the grid
+ *
+ * \param[in] E_irr Values at each irreducible point (e.g., band energies), with
+ *                  one row for each point
+ *
+ * \returns The values at every point in the grid, with one row for each point
+ */
+arma::mat FCCKPointGrid::unfold(const arma::mat &E_irr) const
+{
+    if(E_irr.n_rows != _k_irr.size())
+    {
+        std::ostringstream oss;
+        oss << "Got values at " << E_irr.n_rows << " wave vectors, but the grid has "
+            << _k_irr.size() << " irreducible points.";
+        throw std::length_error(oss.str());
+    }
+
+    arma::mat E_full(_k_full.size(), E_irr.n_cols);
+
+    for(unsigned int ik = 0; ik < _k_full.size(); ++ik)
+    {
+        for(unsigned int iE = 0; iE < E_irr.n_cols; ++iE)
+            E_full(ik, iE) = E_irr(_i_irr[ik], iE);
+    }
+
+    return E_full;
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
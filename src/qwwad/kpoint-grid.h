@@ -0,0 +1,66 @@
+/**
+ * \file   kpoint-grid.h
+ * \brief  Uniform grids of wave vectors in the Brillouin zone, reduced by symmetry
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_KPOINT_GRID_H
+#define QWWAD_KPOINT_GRID_H
+
+#include <vector>
+#include <armadillo>
+
+namespace QWWAD
+{
+/**
+ * \brief A uniform, Gamma-centred grid of wave vectors in the Brillouin zone of
+ *        a face-centred cubic crystal
+ *
+ * \details The grid has n divisions along each primitive reciprocal lattice
+ *          vector, giving \f$n^3\f$ points in the zone.  Energies in a
+ *          zinc-blende or diamond crystal are unchanged by any of the 48
+ *          operations of the cubic group \f$O_h\f$ (the 24 of \f$T_d\f$,
+ *          together with time-reversal symmetry), so only one point in each set
+ *          of equivalent points is kept.  Each irreducible point is given a
+ *          weight equal to the fraction of the grid that it represents.
+ *
+ *          Every wave vector is given in units of \f$2\pi/A_0\f$, and is moved
+ *          into the first Brillouin zone.  The irreducible points lie in the wedge
+ *          \f$k_x \ge k_y \ge k_z \ge 0\f$.
+ */
+class FCCKPointGrid
+{
+private:
+    unsigned int           _n;      ///< Number of divisions along each reciprocal lattice vector
+    std::vector<arma::vec> _k_full; ///< Every point in the grid [2pi/A0]
+    std::vector<arma::vec> _k_irr;  ///< Irreducible points [2pi/A0]
+    arma::vec              _w;      ///< Weight of each irreducible point
+    arma::uvec             _i_irr;  ///< Index of the irreducible point that matches each point in the grid
+
+public:
+    FCCKPointGrid(const unsigned int n);
+
+    /// Return the number of divisions along each reciprocal lattice vector
+    inline unsigned int get_n_divisions() const {return _n;}
+
+    /// Return every point in the grid [2pi/A0]
+    inline const std::vector<arma::vec> & get_full_points() const {return _k_full;}
+
+    /// Return the irreducible points [2pi/A0]
+    inline const std::vector<arma::vec> & get_irreducible_points() const {return _k_irr;}
+
+    /// Return the fraction of the grid that is represented by each irreducible point
+    inline const arma::vec & get_weights() const {return _w;}
+
+    /// Return the index of the irreducible point that matches each point in the grid
+    inline const arma::uvec & get_irreducible_indices() const {return _i_irr;}
+
+    size_t get_full_index(const long c1,
+                          const long c2,
+                          const long c3) const;
+
+    arma::mat unfold(const arma::mat &E_irr) const;
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -51,6 +51,58 @@ void dgtsv_(const int    *N,
             const int    *LDB,
             int          *INFO);
 
+/**
+ * Factorise a general tridiagonal matrix using LU decomposition
+ */
+void dgttrf_(const int *N,
+             double     DL[],
+             double     D[],
+             double     DU[],
+             double     DU2[],
+             int        IPIV[],
+             int       *INFO);
+
+/**
+ * Solve a general tridiagonal matrix using its LU factorisation
+ */
+void dgttrs_(const char   *TRANS,
+             const int    *N,
+             const int    *NRHS,
+             const double *DL,
+             const double *D,
+             const double *DU,
+             const double *DU2,
+             const int    *IPIV,
+             double       *B,
+             const int    *LDB,
+             int          *INFO);
+
+/**
+ * Factorise a general complex tridiagonal matrix using LU decomposition
+ */
+void zgttrf_(const int            *N,
+             std::complex<double>  DL[],
+             std::complex<double>  D[],
+             std::complex<double>  DU[],
+             std::complex<double>  DU2[],
+             int                   IPIV[],
+             int                  *INFO);
+
+/**
+ * Solve a general complex tridiagonal matrix using its LU factorisation
+ */
+void zgttrs_(const char                 *TRANS,
+             const int                  *N,
+             const int                  *NRHS,
+             const std::complex<double> *DL,
+             const std::complex<double> *D,
+             const std::complex<double> *DU,
+             const std::complex<double> *DU2,
+             const int                  *IPIV,
+             std::complex<double>       *B,
+             const int                  *LDB,
+             int                        *INFO);
+
 /**
  * Tridiagonal matrix multiplication: \f$B := \alpha A X + \beta B\f$
  */
@@ -70,6 +122,9 @@ void dlagtm_(const char   *TRANS,
 /** Determine double-precision machine parameters */
 double dlamch_(const char* returnValue);
 
+/** Determine single-precision machine parameters */
+float slamch_(const char* returnValue);
+
 /**
  * Factorise real symmetric positive definate tridagonal matrix
  */
@@ -97,6 +152,54 @@ void dsbgvx_(const char* JOBZ,
              double W[], double Z[], const int* LDZ, double WORK[], int IWORK[],
              int IFAIL[], int* INFO);
 
+/** Find selected eigenvalues (and, optionally, eigenvectors) of a Hermitian band matrix */
+void zhbevx_(const char           *JOBZ,
+             const char           *RANGE,
+             const char           *UPLO,
+             const int            *N,
+             const int            *KD,
+             std::complex<double>  AB[],
+             const int            *LDAB,
+             std::complex<double>  Q[],
+             const int            *LDQ,
+             const double         *VL,
+             const double         *VU,
+             const int            *IL,
+             const int            *IU,
+             const double         *ABSTOL,
+             int                  *M,
+             double                W[],
+             std::complex<double>  Z[],
+             const int            *LDZ,
+             std::complex<double>  WORK[],
+             double                RWORK[],
+             int                   IWORK[],
+             int                   IFAIL[],
+             int                  *INFO);
+
+/** Factorise a general complex band matrix using LU decomposition */
+void zgbtrf_(const int            *M,
+             const int            *N,
+             const int            *KL,
+             const int            *KU,
+             std::complex<double>  AB[],
+             const int            *LDAB,
+             int                   IPIV[],
+             int                  *INFO);
+
+/** Solve a general complex band matrix using its LU factorisation */
+void zgbtrs_(const char                 *TRANS,
+             const int                  *N,
+             const int                  *KL,
+             const int                  *KU,
+             const int                  *NRHS,
+             const std::complex<double> *AB,
+             const int                  *LDAB,
+             const int                  *IPIV,
+             std::complex<double>       *B,
+             const int                  *LDB,
+             int                        *INFO);
+
 /** Solve real symmetric tridiagonal eigenproblem */
 void dstevx_(const char* JOBZ, const char* RANGE, const int* N, double D[],
              double E[], const double* VL, const double* VU,
@@ -110,6 +213,61 @@ void dstevx_(const char* JOBZ, const char* RANGE, const int* N, double D[],
 void zheev_(const char *JOBZ, const char *UPLO, const int* N, std::complex<double> ank[],
             const int *LDA, double E[], std::complex<double> WORK[], int *LWORK, double RWORK[], int *INFO);
 
+/**
+ * \brief Find selected eigenvalues (and, optionally, eigenvectors) of a Hermitian matrix
+ *        using the relatively robust representation algorithm
+ */
+void zheevr_(const char           *JOBZ,
+             const char           *RANGE,
+             const char           *UPLO,
+             const int            *N,
+             std::complex<double>  A[],
+             const int            *LDA,
+             const double         *VL,
+             const double         *VU,
+             const int            *IL,
+             const int            *IU,
+             const double         *ABSTOL,
+             int                  *M,
+             double                W[],
+             std::complex<double>  Z[],
+             const int            *LDZ,
+             int                   ISUPPZ[],
+             std::complex<double>  WORK[],
+             const int            *LWORK,
+             double                RWORK[],
+             const int            *LRWORK,
+             int                   IWORK[],
+             const int            *LIWORK,
+             int                  *INFO);
+
+/**
+ * \brief Single-precision version of zheevr
+ */
+void cheevr_(const char          *JOBZ,
+             const char          *RANGE,
+             const char          *UPLO,
+             const int           *N,
+             std::complex<float>  A[],
+             const int           *LDA,
+             const float         *VL,
+             const float         *VU,
+             const int           *IL,
+             const int           *IU,
+             const float         *ABSTOL,
+             int                 *M,
+             float                W[],
+             std::complex<float>  Z[],
+             const int           *LDZ,
+             int                  ISUPPZ[],
+             std::complex<float>  WORK[],
+             const int           *LWORK,
+             float                RWORK[],
+             const int           *LRWORK,
+             int                  IWORK[],
+             const int           *LIWORK,
+             int                 *INFO);
+
 } // extern
 #endif //QWWAD_LAPACK_DECLARATIONS_H
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
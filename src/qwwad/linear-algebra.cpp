@@ -12,9 +12,15 @@
 #endif //HAVE_CONFIG_H
 
 #include "linear-algebra.h"
+#include "cpu-features.h"
+#include "gpu-eigensolver.h"
 #include "lapack-declarations.h"
+#include "parallel.h"
+#include "profiler.h"
 
+#include <algorithm>
 #include <cstdlib>
+#include <limits>
 
 #include "maths-helpers.h"
 #include <gsl/gsl_math.h>
@@ -22,6 +28,44 @@
 
 namespace QWWAD
 {
+/**
+ * \brief Get a reusable workspace buffer for LAPACK
+ *
+ * \param[in] slot Index of the buffer, so that a function can use several buffers at once
+ * \param[in] n    Minimum number of elements needed
+ *
+ * \returns A pointer to the start of the buffer
+ *
+ * \details The buffers are thread-local and persist between calls, so functions that are
+ *          called many times (e.g., by the donor energy minimisers) don't have to allocate
+ *          their workspace from the heap every time.  Sizes are rounded up to the next
+ *          power of two so that small changes in the problem size don't cause a
+ *          reallocation.  The contents of the buffer are not initialised.
+ */
+template <class T>
+static T * lapack_workspace(const size_t slot,
+                            const size_t n)
+{
+    thread_local std::vector< std::vector<T> > pool;
+
+    if(pool.size() <= slot)
+        pool.resize(slot + 1);
+
+    auto &buffer = pool[slot];
+
+    if(buffer.size() < n)
+    {
+        size_t bucket_size = 64;
+
+        while(bucket_size < n)
+            bucket_size *= 2;
+
+        std::vector<T>(bucket_size).swap(buffer);
+    }
+
+    return buffer.data();
+}
+
 /**
  * \brief Find real solutions to eigenvalue problem from LAPACK
  *
@@ -44,22 +88,27 @@ eigen_general(arma::mat    &A,
     const int N = sqrt(A.size());
 
     // Real and imaginary parts of the computed eigenvalues
-    arma::vec WR(N);
-    arma::vec WI(N);
+    double *WR = lapack_workspace<double>(0, N);
+    double *WI = lapack_workspace<double>(1, N);
 
-    // Computed left and right eigenvectors
-    arma::mat V_left(N,N);
-    arma::mat V_right(N,N);
+    // Computed right eigenvectors.  The left eigenvectors aren't computed, so a
+    // single element is enough for their (unused) storage
+    double *V_right = lapack_workspace<double>(2, (size_t)N*N);
+    double  V_left  = 0.0;
+    int     ldvl    = 1;
 
     // Run LAPACK function to solve eigenproblem
     int  info  = 0;   // Output code from LAPACK
     char jobvl = 'N'; // Specify range of solutions by value
     char jobvr = 'V';
     int  lwork = 4*N;
-    arma::vec work(4*N); // LAPACK workspace
+    double *work = lapack_workspace<double>(3, lwork); // LAPACK workspace
 
-    dgeev_(&jobvl, &jobvr, &N, &A(0), &N, &WR[0], &WI[0], &V_left[0], &N, &V_right[0], &N,
-            &work[0], &lwork, &info);
+    QWWAD_COUNT  ("LAPACK dgeev calls");
+    QWWAD_COUNT_N("LAPACK dgeev total size", N);
+
+    dgeev_(&jobvl, &jobvr, &N, &A(0), &N, WR, WI, &V_left, &ldvl, V_right, &N,
+            work, &lwork, &info);
 
     if(info!=0)
         throw std::runtime_error("Could not solve "
@@ -81,7 +130,7 @@ eigen_general(arma::mat    &A,
             // If we specify a range of eigenvalues, filter the
             // solutions by that range, otherwise keep all of them
             if((n_max > 0) or (WR[i] < VU)){
-                arma::vec const psi = V_right.col(i);
+                arma::vec const psi(V_right + (size_t)N*i, N);
                 solutions[nst] = EVP_solution<double>(WR[i], psi);
 
                 nst++; // Register solution found
@@ -119,6 +168,426 @@ eigen_general(arma::mat    &A,
     return solutions_sorted;
 }
 
+/**
+ * \brief Create sparse storage for a linearised cubic eigenvalue problem
+ *
+ * \param[in] A31_sub   Subdiagonal of block A31
+ * \param[in] A31_diag  Diagonal of block A31
+ * \param[in] A31_super Superdiagonal of block A31
+ * \param[in] A32_off   Sub- and super-diagonal of (symmetric) block A32
+ * \param[in] A32_diag  Diagonal of block A32
+ * \param[in] A33_diag  Diagonal of block A33
+ */
+CubicEVPMatrix::CubicEVPMatrix(const decltype(_A31_sub)   &A31_sub,
+                               const decltype(_A31_diag)  &A31_diag,
+                               const decltype(_A31_super) &A31_super,
+                               const decltype(_A32_off)   &A32_off,
+                               const decltype(_A32_diag)  &A32_diag,
+                               const decltype(_A33_diag)  &A33_diag) :
+    _A31_sub(A31_sub),
+    _A31_diag(A31_diag),
+    _A31_super(A31_super),
+    _A32_off(A32_off),
+    _A32_diag(A32_diag),
+    _A33_diag(A33_diag)
+{
+    const size_t nz = _A31_diag.size();
+
+    if(_A31_sub.size()  != nz-1 || _A31_super.size() != nz-1 || _A32_off.size()  != nz-1 ||
+       _A32_diag.size() != nz   || _A33_diag.size()  != nz)
+    {
+        std::ostringstream oss;
+        oss << "Size mismatch for blocks in cubic eigenvalue problem with block size: " << nz;
+        throw std::runtime_error(oss.str());
+    }
+}
+
+/**
+ * \brief Expand the sparse storage into a dense matrix
+ *
+ * \details This is only really useful for small problems or for passing
+ *          the matrix to eigen_general
+ */
+arma::mat CubicEVPMatrix::get_dense() const
+{
+    const size_t nz = get_block_size();
+
+    arma::mat A31(nz,nz, arma::fill::zeros);
+    A31.diag(-1) = _A31_sub;
+    A31.diag()   = _A31_diag;
+    A31.diag(1)  = _A31_super;
+
+    arma::mat A32(nz,nz, arma::fill::zeros);
+    A32.diag(-1) = _A32_off;
+    A32.diag(0)  = _A32_diag;
+    A32.diag(1)  = _A32_off;
+
+    arma::mat A33(nz,nz, arma::fill::zeros);
+    A33.diag() = _A33_diag;
+
+    arma::mat A(3*nz, 3*nz, arma::fill::zeros);
+    A.submat(0,    nz,     nz-1,   2*nz-1).eye(); // A12
+    A.submat(nz,   2*nz,   2*nz-1, 3*nz-1).eye(); // A23
+    A.submat(2*nz, 0,      3*nz-1, nz-1)   = A31;
+    A.submat(2*nz, nz,     3*nz-1, 2*nz-1) = A32;
+    A.submat(2*nz, 2*nz,   3*nz-1, 3*nz-1) = A33;
+
+    return A;
+}
+
+/**
+ * \brief LU-factorise the tridiagonal matrix that arises in a shifted cubic EVP
+ *
+ * \param[in]  A     The cubic EVP matrix
+ * \param[in]  sigma The spectral shift
+ * \param[out] DL    Factorised subdiagonal
+ * \param[out] D     Factorised diagonal
+ * \param[out] DU    Factorised superdiagonal
+ * \param[out] DU2   Second superdiagonal of the factorisation
+ * \param[out] ipiv  Pivot indices
+ *
+ * \details Eliminating the second and third blocks of (A - sigma I) x = y
+ *          leaves a system of order nz for the first block, with the matrix
+ *          P(sigma) = A31 + sigma A32 + sigma^2 A33 - sigma^3 I.  This is
+ *          tridiagonal, so it can be factorised in O(nz) operations.
+ *
+ * \returns The LAPACK error code.  A positive value means P(sigma) is singular.
+ */
+static int factorise_shifted_cubic(const CubicEVPMatrix &A,
+                                   const double          sigma,
+                                   arma::vec            &DL,
+                                   arma::vec            &D,
+                                   arma::vec            &DU,
+                                   arma::vec            &DU2,
+                                   arma::Col<int>       &ipiv)
+{
+    const int nz = A.get_block_size();
+
+    DL  = A.get_A31_sub()   + sigma*A.get_A32_off();
+    DU  = A.get_A31_super() + sigma*A.get_A32_off();
+    D   = A.get_A31_diag()  + sigma*A.get_A32_diag() + sigma*sigma*A.get_A33_diag()
+          - sigma*sigma*sigma;
+    DU2 = arma::zeros(nz);
+    ipiv = arma::zeros<arma::Col<int>>(nz);
+
+    int info = 0;
+    dgttrf_(&nz, DL.memptr(), D.memptr(), DU.memptr(), DU2.memptr(), ipiv.memptr(), &info);
+
+    return info;
+}
+
+/**
+ * \brief Apply the shift-inverted cubic EVP operator to a vector: x = (A - sigma I)^{-1} y
+ *
+ * \details The factorisation of P(sigma) must already have been computed using
+ *          factorise_shifted_cubic
+ */
+static arma::vec apply_shift_invert_cubic(const CubicEVPMatrix &A,
+                                          const double          sigma,
+                                          const arma::vec      &DL,
+                                          const arma::vec      &D,
+                                          const arma::vec      &DU,
+                                          const arma::vec      &DU2,
+                                          const arma::Col<int> &ipiv,
+                                          const arma::vec      &y)
+{
+    const int nz = A.get_block_size();
+    const arma::vec y1 = y.subvec(0,    nz-1);
+    const arma::vec y2 = y.subvec(nz,   2*nz-1);
+    const arma::vec y3 = y.subvec(2*nz, 3*nz-1);
+
+    const auto &A32_off  = A.get_A32_off();
+    const auto &A32_diag = A.get_A32_diag();
+
+    // Right-hand side for the reduced system P(sigma) x1 = r
+    arma::vec r = y3 - (A.get_A33_diag() - sigma) % (y2 + sigma*y1);
+
+    for(int i = 0; i < nz; ++i)
+    {
+        double A32_y1 = A32_diag(i) * y1(i);
+
+        if(i > 0)    A32_y1 += A32_off(i-1) * y1(i-1);
+        if(i < nz-1) A32_y1 += A32_off(i)   * y1(i+1);
+
+        r(i) -= A32_y1;
+    }
+
+    char trans = 'N';
+    int  nrhs  = 1;
+    int  info  = 0;
+    dgttrs_(&trans, &nz, &nrhs, DL.memptr(), D.memptr(), DU.memptr(), DU2.memptr(),
+            ipiv.memptr(), r.memptr(), &nz, &info);
+
+    if(info != 0)
+    {
+        std::ostringstream oss;
+        oss << "Cannot solve shifted cubic eigenvalue problem. (LAPACK error code: " << info << ")";
+        throw std::runtime_error(oss.str());
+    }
+
+    // Back-substitute to find the remaining blocks of the solution
+    arma::vec x(3*nz);
+    x.subvec(0,    nz-1)   = r;
+    x.subvec(nz,   2*nz-1) = y1 + sigma*r;
+    x.subvec(2*nz, 3*nz-1) = y2 + sigma*(y1 + sigma*r);
+
+    return x;
+}
+
+/**
+ * \brief Find real eigenvalues of a linearised cubic EVP using shift-invert Arnoldi iteration
+ *
+ * \param[in]  A     The cubic EVP matrix in sparse storage
+ * \param[in]  VL    Lower limit for eigenvalue search
+ * \param[in]  VU    Upper limit for eigenvalue search
+ * \param[in]  n_max Max number of eigenvalues to find
+ *
+ * \details The eigenvalues are found by sweeping a spectral shift, sigma,
+ *          upward from VL.  At each shift, an Arnoldi iteration is applied to
+ *          (A - sigma I)^{-1}, whose dominant eigenvalues correspond to the
+ *          eigenvalues of A nearest to sigma.  Each application of the operator
+ *          only needs one O(nz) tridiagonal solve.
+ *
+ *          All converged real eigenvalues closer to sigma than the nearest
+ *          unconverged Ritz value are accepted, and the shift is then moved up
+ *          by slightly less than that distance, so that no part of the search
+ *          range is skipped.  The unconverged Ritz value is usually close to an
+ *          eigenvalue, and a shift that lands on it makes the shifted operator
+ *          nearly singular, so that the Arnoldi iteration breaks down early.
+ *
+ *          The problem is solved in units of the largest energy in the range,
+ *          so the matrix may be given in joules.
+ *
+ *          The returned eigenvectors have the full length (3 nz) of the
+ *          linearised problem, exactly as for eigen_general.  If n_max=0,
+ *          then all eigenvalues in the range (VL,VU) will be found, otherwise
+ *          the lowest n_max eigenvalues in that range are returned.
+ */
+std::vector< EVP_solution<double> >
+eigen_cubic_shift_invert(const CubicEVPMatrix &A,
+                         const double          VL,
+                         const double          VU,
+                         unsigned int          n_max)
+{
+    if(gsl_fcmp(VL, VU, fabs(VL)*1e-6) != -1)
+    {
+        std::ostringstream oss;
+        oss << "Range of eigenvalue search is invalid. Lower limit: " << VL << " is greater than upper limit: " << VU;
+        throw std::domain_error(oss.str());
+    }
+
+    const int nz = A.get_block_size();
+
+    // The Krylov vectors hold x, lambda x and lambda^2 x, which differ by many orders
+    // of magnitude unless the eigenvalues are of order one (not the case in joules).
+    // Solve the problem in units of the largest energy in the range, and scale back
+    const double scale = GSL_MAX_DBL(fabs(VL), fabs(VU));
+
+    if(scale != 1.0)
+    {
+        const double s2 = scale*scale;
+        const double s3 = s2*scale;
+
+        const CubicEVPMatrix A_scaled(A.get_A31_sub()/s3,  A.get_A31_diag()/s3, A.get_A31_super()/s3,
+                                      A.get_A32_off()/s2,  A.get_A32_diag()/s2, A.get_A33_diag()/scale);
+
+        auto solutions = eigen_cubic_shift_invert(A_scaled, VL/scale, VU/scale, n_max);
+
+        for(auto &sol : solutions)
+        {
+            arma::vec psi = sol.psi_array();
+            psi.subvec(nz,   2*nz-1) *= scale;
+            psi.subvec(2*nz, 3*nz-1) *= s2;
+            sol = EVP_solution<double>(sol.get_E()*scale, psi);
+        }
+
+        return solutions;
+    }
+
+    const int    N            = A.get_size();
+    const double tol          = 1e-10;          // Relative tolerance for Ritz-pair residuals
+    const double dE_min       = (VU - VL)*1e-9; // Separation below which eigenvalues are duplicates
+    const double shift_margin = 0.01;           // Fraction of the converged radius left before the next shift
+
+    std::vector< EVP_solution<double> > solutions;
+
+    int    m     = GSL_MIN_INT(N, 40); // Dimension of Krylov subspace
+    double sigma = VL;                 // Spectral shift
+
+    while(sigma < VU)
+    {
+        // Factorise the shifted matrix, nudging the shift if it happens to
+        // land exactly on an eigenvalue
+        arma::vec DL, D, DU, DU2;
+        arma::Col<int> ipiv;
+
+        while(factorise_shifted_cubic(A, sigma, DL, D, DU, DU2, ipiv) > 0)
+            sigma += dE_min;
+
+        // Build an orthonormal Krylov basis using Arnoldi iteration with full
+        // reorthogonalisation. A fixed, non-uniform starting vector keeps the
+        // results reproducible.
+        arma::mat Q = arma::zeros(N, m+1);
+        arma::mat H = arma::zeros(m+1, m);
+
+        arma::vec q0(N);
+        for(int i = 0; i < N; ++i)
+            q0(i) = 1.0 + 0.5*sin(i + 1.0);
+
+        Q.col(0) = q0/norm(q0);
+
+        int  m_eff     = m;     // Dimension of the basis actually built
+        bool breakdown = false; // True if an invariant subspace was found
+
+        for(int j = 0; j < m; ++j)
+        {
+            arma::vec w = apply_shift_invert_cubic(A, sigma, DL, D, DU, DU2, ipiv, Q.col(j));
+
+            for(unsigned int pass = 0; pass < 2; ++pass)
+            {
+                for(int i = 0; i <= j; ++i)
+                {
+                    const double h = dot(Q.col(i), w);
+                    H(i,j) += h;
+                    w      -= h*Q.col(i);
+                }
+            }
+
+            H(j+1,j) = norm(w);
+
+            if(H(j+1,j) <= tol*norm(H.col(j)))
+            {
+                m_eff     = j+1;
+                breakdown = true;
+                break;
+            }
+
+            Q.col(j+1) = w/H(j+1,j);
+        }
+
+        // Find Ritz pairs from the (small) Hessenberg matrix
+        arma::mat Hm = H.submat(0, 0, m_eff-1, m_eff-1);
+        arma::vec WR(m_eff);
+        arma::vec WI(m_eff);
+        arma::mat Y_left(m_eff, m_eff);
+        arma::mat Y(m_eff, m_eff);
+        char jobvl = 'N';
+        char jobvr = 'V';
+        int  lwork = 4*m_eff;
+        arma::vec work(lwork);
+        int  info  = 0;
+
+        QWWAD_COUNT  ("LAPACK dgeev calls");
+        QWWAD_COUNT_N("LAPACK dgeev total size", m_eff);
+
+        dgeev_(&jobvl, &jobvr, &m_eff, Hm.memptr(), &m_eff, WR.memptr(), WI.memptr(),
+               Y_left.memptr(), &m_eff, Y.memptr(), &m_eff, work.memptr(), &lwork, &info);
+
+        if(info != 0)
+        {
+            std::ostringstream oss;
+            oss << "Could not find Ritz values in Arnoldi iteration. LAPACK error code: " << info;
+            throw std::runtime_error(oss.str());
+        }
+
+        const double h_next = breakdown ? 0.0 : H(m_eff, m_eff-1);
+
+        // Find the radius around the shift within which all Ritz values have converged
+        double       rho      = GSL_POSINF;
+        double       dist_max = 0.0;
+        arma::uvec   converged(m_eff);
+
+        for(int i = 0; i < m_eff; ++i)
+        {
+            const double theta_abs = gsl_hypot(WR(i), WI(i));
+            const double dist      = 1.0/theta_abs; // Distance from shift to eigenvalue
+            converged(i) = (fabs(h_next*Y(m_eff-1,i)) <= tol*theta_abs) ? 1 : 0;
+
+            dist_max = GSL_MAX_DBL(dist_max, dist);
+
+            if(!converged(i))
+                rho = GSL_MIN_DBL(rho, dist);
+        }
+
+        // Unless the Krylov space spans the whole problem, we can't be sure
+        // that nothing is missing beyond the furthest Ritz value.  This also
+        // applies if every Ritz value has converged without a breakdown
+        if(m_eff < N)
+            rho = GSL_MIN_DBL(rho, dist_max);
+
+        // If nothing has converged near the shift, try again with a bigger subspace
+        if(rho < dE_min*1e3 && m < N)
+        {
+            m = GSL_MIN_INT(N, 2*m);
+            continue;
+        }
+
+        for(int i = 0; i < m_eff; ++i)
+        {
+            // Real eigenvalues of A give real Ritz values
+            if(!converged(i) || WI(i) != 0 || WR(i) == 0)
+                continue;
+
+            const double E = sigma + 1.0/WR(i);
+
+            if(fabs(E - sigma) >= rho || E <= VL || E >= VU)
+                continue;
+
+            bool duplicate = false;
+
+            for(const auto &sol : solutions)
+            {
+                if(fabs(sol.get_E() - E) < dE_min)
+                    duplicate = true;
+            }
+
+            if(!duplicate)
+            {
+                const arma::vec psi = Q.cols(0, m_eff-1) * Y.col(i);
+                solutions.push_back(EVP_solution<double>(E, psi));
+            }
+        }
+
+        // Everything within the converged radius has now been found
+        sigma += (1.0 - shift_margin)*rho;
+
+        // Stop if we already have enough solutions below the new shift
+        if(n_max > 0)
+        {
+            unsigned int n_below = 0;
+
+            for(const auto &sol : solutions)
+            {
+                if(sol.get_E() < sigma)
+                    ++n_below;
+            }
+
+            if(n_below >= n_max)
+                break;
+        }
+    }
+
+    // Sort the solutions in ascending order of energy
+    arma::vec E_tmp(solutions.size());
+
+    for(unsigned int ist = 0; ist < solutions.size(); ++ist)
+        E_tmp[ist] = solutions[ist].get_E();
+
+    const arma::uvec sorted_E_indices = sort_index(E_tmp);
+
+    std::vector<EVP_solution<double>> solutions_sorted;
+
+    for(auto idx : sorted_E_indices)
+    {
+        solutions_sorted.push_back(solutions[idx]);
+
+        if(n_max > 0 and solutions_sorted.size() == n_max)
+            break;
+    }
+
+    return solutions_sorted;
+}
+
 /**
  * \brief Find solution to symmetric-definite banded eigenvalue problem A*x=lambda*B*x
  *
@@ -142,13 +611,13 @@ eigen_banded(double       AB[],
              unsigned int n_max)
 {
     // Workspace to normalise eigenproblem
-    arma::vec Q(n*n);
+    double *Q = lapack_workspace<double>(0, (size_t)n*n);
 
     // LAPACK workspace
-    arma::Col<int> ifail(n); // Failure bits for LAPACK
-    arma::vec  W(n);    // Temporary storage for eigenvalues
-    arma::vec  Z(n*n);  // Temp. storage for eigenvectors
-    int                   M;       // Number of solutions found
+    int    *ifail = lapack_workspace<int>(0, n); // Failure bits for LAPACK
+    double *W     = lapack_workspace<double>(1, n);          // Temporary storage for eigenvalues
+    double *Z     = lapack_workspace<double>(2, (size_t)n*n); // Temp. storage for eigenvectors
+    int     M;       // Number of solutions found
 
     // Specify range of solutions by value, unless n_max is given
     char range = (n_max==0) ? 'V' : 'I';
@@ -158,8 +627,8 @@ eigen_banded(double       AB[],
     double abstol = 2.0 * dlamch_(&retval); // Error tolerance
 
     // LAPACK workspace
-    arma::vec  work(7*(size_t)n);
-    arma::Col<int> iwork(5*(size_t)n);
+    double *work  = lapack_workspace<double>(3, 7*(size_t)n);
+    int    *iwork = lapack_workspace<int>(1, 5*(size_t)n);
 
     // Run LAPACK function to solve eigenproblem
     char jobz  = 'V';   // Task descriptor for LAPACK
@@ -171,8 +640,11 @@ eigen_banded(double       AB[],
     int  IU    = n_max; // Index of last solution to find
     int  info  = 0;     // Output code from LAPACK
 
-    dsbgvx_(&jobz, &range, &uplo, &n, &KA, &KB, AB, &LD, BB, &LD, &Q[0], &n, &VL,
-            &VU, &IL, &IU, &abstol, &M, &W[0], &Z[0], &n, &work[0], &iwork(0), &ifail[0], &info);
+    QWWAD_COUNT  ("LAPACK dsbgvx calls");
+    QWWAD_COUNT_N("LAPACK dsbgvx total size", n);
+
+    dsbgvx_(&jobz, &range, &uplo, &n, &KA, &KB, AB, &LD, BB, &LD, Q, &n, &VL,
+            &VU, &IL, &IU, &abstol, &M, W, Z, &n, work, iwork, ifail, &info);
 
     if(info!=0)
         throw std::runtime_error("Could not solve "
@@ -182,8 +654,7 @@ eigen_banded(double       AB[],
     std::vector< EVP_solution<double> > solutions(M, EVP_solution<double>(n) );
 
     for(int i = 0; i < M; i++){
-        const std::vector<double> psi(Z.begin() + n*i,
-                                      Z.begin() + n*(i+1));
+        const arma::vec psi(Z + (size_t)n*i, n);
         solutions[i] = EVP_solution<double>(W[i], psi);
     }
 
@@ -191,67 +662,88 @@ eigen_banded(double       AB[],
 }
 
 /**
- * \brief Find solution to eigenvalue problem from LAPACK
+ * \brief Count the eigenvalues of a symmetric tridiagonal matrix that lie below a given value
  *
- * \param[in]  diag    Array holding all diagonal elements of matrix
- * \param[in]  subdiag Array holding all sub-diag. elements of matrix
- * \param[in]  VL      Lowest value for eigenvalue search
- * \param[in]  VU      Highest value for eigenvalue search
- * \param[in]  n_max   Max number of eigenvalues to find
+ * \param[in] diag    Diagonal elements of the matrix
+ * \param[in] subdiag Subdiagonal elements of the matrix
+ * \param[in] x       Value at which to evaluate the count
  *
- * \details    Creates standard inputs for dstevx func. before
- *             executing to return results.  If n_max=0, then all
- *             eigenvalues in the range [VL,VU] will be found.
+ * \details Uses the Sturm sequence property: the number of negative pivots in the
+ *          LDL^T factorisation of (A - xI) equals the number of eigenvalues below x.
+ *          Zero pivots are perturbed slightly, as in the LAPACK bisection routines.
  */
-std::vector< EVP_solution<double> >
-eigen_tridiag(arma::vec    &diag,
-              arma::vec    &subdiag,
-              double        VL,
-              double        VU,
-              unsigned int  n_max)
+unsigned int
+count_eigen_tridiag(const arma::vec &diag,
+                    const arma::vec &subdiag,
+                    const double     x)
 {
-    const int N    = diag.size();
-    const int Nsub = subdiag.size();
+    const int    N      = diag.size();
+    const double e_max  = arma::max(arma::abs(subdiag));
+    const double pivmin = std::numeric_limits<double>::min() * GSL_MAX_DBL(1.0, e_max*e_max);
 
-    if (Nsub != N-1)
+    unsigned int count = 0;
+    double       q     = diag(0) - x;
+
+    for(int i = 0; i < N; ++i)
     {
-        std::ostringstream oss;
-        oss << "Size mismatch for tridiagonal elements: "
-            << "(subdiagonal = " << Nsub << "; "
-            << "diagonal = " << N << ")";
+        if(i > 0)
+            q = diag(i) - x - subdiag(i-1)*subdiag(i-1)/q;
 
-        throw std::runtime_error(oss.str());
+        if(std::abs(q) < pivmin)
+            q = -pivmin;
+
+        if(q < 0)
+            ++count;
     }
 
-    arma::Col<int> ifail = arma::zeros<arma::Col<int>>(N); // Failure bits for LAPACK
-    arma::vec W = arma::zeros(N);     // Temporary storage for eigenvalues
-    arma::mat Z = arma::zeros(N,N);   // Temp. storage for eigenvectors
-    int M = 0; // Number of solutions found
+    return count;
+}
 
-    // Specify range of solutions by value, unless n_max is given
-    char range = (n_max==0) ? 'V' : 'I';
+/**
+ * \brief Run the LAPACK tridiagonal eigensolver over a single range of the spectrum
+ *
+ * \param[in,out] diag    Diagonal elements of the matrix (may be scaled by LAPACK)
+ * \param[in,out] subdiag Subdiagonal elements of the matrix (may be scaled by LAPACK)
+ * \param[in]     range   'V' to search by value in (VL,VU]; 'I' to search by index in [IL,IU]
+ * \param[in]     VL      Lower limit of search by value
+ * \param[in]     VU      Upper limit of search by value
+ * \param[in]     IL      Index (from 1) of lowest eigenvalue in search by index
+ * \param[in]     IU      Index (from 1) of highest eigenvalue in search by index
+ *
+ * \returns The eigenpairs in ascending order of eigenvalue
+ */
+static std::vector< EVP_solution<double> >
+eigen_tridiag_range(arma::vec    &diag,
+                    arma::vec    &subdiag,
+                    char          range,
+                    double        VL,
+                    double        VU,
+                    int           IL,
+                    int           IU)
+{
+    const int N = diag.size();
 
-    // If we're checking by range by value, make sure that the upper and lower
-    // bounds make sense
-    if(n_max == 0 && gsl_fcmp(VL, VU, VL*1e-6) != -1)
-    {
-        std::ostringstream oss;
-        oss << "Range of eigenvalue search is invalid. Lower limit: " << VL << " is greater than upper limit: " << VU;
-        throw std::domain_error(oss.str());
-    }
+    // Only allocate eigenvector storage for the number of solutions we could possibly find
+    const int M_max = (range == 'I') ? IU - IL + 1 : N;
+
+    int    *ifail = lapack_workspace<int>(0, N);                 // Failure bits for LAPACK
+    double *W     = lapack_workspace<double>(0, N);              // Temporary storage for eigenvalues
+    double *Z     = lapack_workspace<double>(1, (size_t)N*M_max); // Temp. storage for eigenvectors
+    int M = 0; // Number of solutions found
 
     int  info = 0; // Output code from LAPACK
     char jobz='V'; // Task descriptor for LAPACK
-    int  IL=1;
-    int  IU=n_max;
-    arma::vec  work = arma::zeros(5*N); // LAPACK workspace
-    arma::Col<int> iwork = arma::zeros<arma::Col<int>>(5*N);
+    double *work  = lapack_workspace<double>(2, 5*(size_t)N); // LAPACK workspace
+    int    *iwork = lapack_workspace<int>(1, 5*(size_t)N);
 
     // Find error tolerance
     char retval='S'; // Return value for LAPACK
     double abstol = 2.0 * dlamch_(&retval); // Error tolerance
 
     // Run LAPACK function to solve eigenproblem
+    QWWAD_COUNT  ("LAPACK dstevx calls");
+    QWWAD_COUNT_N("LAPACK dstevx total size", N);
+
     dstevx_(&jobz,
             &range,
             &N,
@@ -261,12 +753,12 @@ eigen_tridiag(arma::vec    &diag,
             &IL, &IU,
             &abstol,
             &M,
-            W.memptr(),
-            Z.memptr(),
+            W,
+            Z,
             &N,
-            work.memptr(),
-            iwork.memptr(),
-            ifail.memptr(),
+            work,
+            iwork,
+            ifail,
             &info);
 
     if(info!=0)
@@ -281,64 +773,1444 @@ eigen_tridiag(arma::vec    &diag,
     std::vector<EVP_solution<double>> solutions(M, EVP_solution<double>(N));
 
     for(int i = 0; i < M; i++){
-        solutions[i] = EVP_solution<double>(W(i), Z.col(i));
+        solutions[i] = EVP_solution<double>(W[i], arma::vec(Z + (size_t)N*i, N));
     }
 
     return solutions;
 }
 
 /**
- * \brief Solves a matrix of the cyclic form, generated from the cyclic form of the Poisson solver
+ * \brief Find solution to eigenvalue problem from LAPACK
  *
- * \param[in]  A_sub  Array holding all sub-diagonal elements of matrix.
- * \param[in]  A_diag Array holding all diagonal elements of matrix
- * \param[in]  cyclic Value of the matrix in the bottom corner which is non-zero due to
- *                    cyclic boundaries.
- * \param[in]  b      Array holding the RHS of the equation to solve (A*X = b)
+ * \param[in]  diag    Array holding all diagonal elements of matrix
+ * \param[in]  subdiag Array holding all sub-diag. elements of matrix
+ * \param[in]  VL      Lowest value for eigenvalue search
+ * \param[in]  VU      Highest value for eigenvalue search
+ * \param[in]  n_max   Max number of eigenvalues to find
  *
- * \details    An optimised algorithm for solving the matrix resulting from applying cyclic
- *             boundaries to a discretised PDE problem. For more details of this optimised
- *             algorithm (probably) see Jonathan Cooper's thesis.
+ * \details    Creates standard inputs for dstevx func. before
+ *             executing to return results.  If n_max=0, then all
+ *             eigenvalues in the range [VL,VU] will be found.
+ *
+ *             When many eigenvalues are requested, the spectrum is split into
+ *             slices holding roughly equal numbers of eigenvalues (found using
+ *             Sturm-sequence counts) and the slices are solved concurrently,
+ *             one per hardware thread.  The merged set of solutions is returned
+ *             in ascending order, exactly as for a single call to dstevx.
  */
-arma::vec solve_cyclic_matrix(arma::vec A_sub,
-                              arma::vec A_diag,
-                              double cyclic,
-                              arma::vec b)
+std::vector< EVP_solution<double> >
+eigen_tridiag(arma::vec    &diag,
+              arma::vec    &subdiag,
+              double        VL,
+              double        VU,
+              unsigned int  n_max)
 {
-    unsigned int ni = A_diag.size();
-    arma::vec z(ni);
-    arma::vec A_super(A_sub);
-    //A_sub = A_super;
-    //Forward sweep
-    // Initial elements (don't need to set A_diag and b!)
-    //A_diag[0] = A_diag[0];
-    //b_new[0] = b[0];
-    z[0] = 1;
-    for(unsigned int i=1; i<ni-1; i++){
-        A_diag[i] = A_diag[i] - (A_sub[i-1]*A_super[i-1])/A_diag[i-1];
-        b[i] = b[i]-(A_sub[i-1]*b[i-1])/A_diag[i-1];
+    const int N    = diag.size();
+    const int Nsub = subdiag.size();
 
-        // This can probably go in A_sub
-        z[i] = -z[i-1]*A_super[i-1]/A_diag[i-1];
-    }
+    if (Nsub != N-1)
+    {
+        std::ostringstream oss;
+        oss << "Size mismatch for tridiagonal elements: "
+            << "(subdiagonal = " << Nsub << "; "
+            << "diagonal = " << N << ")";
 
-    // Last F_dash element
-    A_diag[ni-1] = A_diag[ni-1] - (A_sub[ni-2] + cyclic*z[ni-2])*A_super[ni-2]/A_diag[ni-2];
+        throw std::runtime_error(oss.str());
+    }
 
-    // Last L_dash element
-    double sum = 0.0;
+    // If we're checking by range by value, make sure that the upper and lower
+    // bounds make sense
+    if(n_max == 0 && gsl_fcmp(VL, VU, VL*1e-6) != -1)
+    {
+        std::ostringstream oss;
+        oss << "Range of eigenvalue search is invalid. Lower limit: " << VL << " is greater than upper limit: " << VU;
+        throw std::domain_error(oss.str());
+    }
+
+    // Specify range of solutions by value, unless n_max is given
+    const char range = (n_max==0) ? 'V' : 'I';
+
+    // Find the indices of the lowest and highest eigenvalues that we need
+    int IL = 1;
+    int IU = n_max;
+
+    if(N > 1 && range == 'V')
+    {
+        IL = count_eigen_tridiag(diag, subdiag, VL) + 1;
+        IU = count_eigen_tridiag(diag, subdiag, VU);
+    }
+
+    // Decide how many slices to use.  Each slice must contain enough eigenvalues to
+    // justify the cost of a separate LAPACK call
+    const int n_slice_min = 32; // Minimum number of eigenvalues per slice
+    const int n_ev        = IU - IL + 1;
+    int       n_slices    = get_thread_count();
+
+    if(n_ev / n_slice_min < n_slices)
+        n_slices = n_ev / n_slice_min;
+
+    // Just use a single call if there's no benefit to slicing
+    if(n_slices < 2 || IU > N)
+        return eigen_tridiag_range(diag, subdiag, range, VL, VU, IL, IU);
+
+    std::vector< std::vector<EVP_solution<double>> > slice_solutions(n_slices);
+
+    run_in_parallel(n_slices, n_slices, [&](const size_t islice) {
+        // Split the indices as evenly as possible between slices
+        const int IL_slice = IL + (n_ev * islice)       / n_slices;
+        const int IU_slice = IL + (n_ev * (islice + 1)) / n_slices - 1;
+
+        // LAPACK may scale the matrix, so each slice needs its own copy
+        arma::vec diag_slice(diag);
+        arma::vec subdiag_slice(subdiag);
+        slice_solutions[islice] = eigen_tridiag_range(diag_slice, subdiag_slice,
+                                                      'I', VL, VU,
+                                                      IL_slice, IU_slice);
+    });
+
+    std::vector<EVP_solution<double>> solutions;
+    solutions.reserve(n_ev);
+
+    for(int islice = 0; islice < n_slices; ++islice)
+    {
+        solutions.insert(solutions.end(), slice_solutions[islice].begin(), slice_solutions[islice].end());
+    }
+
+    return solutions;
+}
+
+/**
+ * \brief Find a single eigenpair of a symmetric tridiagonal matrix
+ *
+ * \param[in] diag    Diagonal elements of the matrix
+ * \param[in] subdiag Subdiagonal elements of the matrix
+ * \param[in] i       Index of the eigenvalue, counting upwards from zero
+ *
+ * \details Only the requested eigenpair is computed, so this is much cheaper than
+ *          finding all of the eigenvalues below it.
+ *
+ * \returns The eigenpair
+ */
+EVP_solution<double>
+eigen_tridiag_single(arma::vec          &diag,
+                     arma::vec          &subdiag,
+                     const unsigned int  i)
+{
+    const unsigned int N = diag.size();
+
+    if (subdiag.size() + 1 != N || i >= N)
+    {
+        std::ostringstream oss;
+        oss << "Cannot find eigenvalue " << i << " of a " << N << "x" << N << " matrix";
+        throw std::runtime_error(oss.str());
+    }
+
+    const auto solutions = eigen_tridiag_range(diag, subdiag, 'I', 0, 0, i+1, i+1);
+    return solutions.at(0);
+}
+
+/**
+ * \brief Solves a matrix of the cyclic form, generated from the cyclic form of the Poisson solver
+ *
+ * \param[in]  A_sub  Array holding all sub-diagonal elements of matrix.
+ * \param[in]  A_diag Array holding all diagonal elements of matrix
+ * \param[in]  cyclic Value of the matrix in the bottom corner which is non-zero due to
+ *                    cyclic boundaries.
+ * \param[in]  b      Array holding the RHS of the equation to solve (A*X = b)
+ *
+ * \details    An optimised algorithm for solving the matrix resulting from applying cyclic
+ *             boundaries to a discretised PDE problem. For more details of this optimised
+ *             algorithm (probably) see Jonathan Cooper's thesis.
+ */
+arma::vec solve_cyclic_matrix(const arma::vec &A_sub,
+                              const arma::vec &A_diag,
+                              const double     cyclic,
+                              const arma::vec &b)
+{
+    arma::vec x(b);
+    arma::vec F;
+    arma::vec z;
+    solve_cyclic_matrix(A_sub, A_diag, cyclic, x, F, z);
+    return x;
+}
+
+/**
+ * \brief Solves a matrix of the cyclic form in place, using caller-provided workspace
+ *
+ * \param[in]     A_sub  Array holding all sub-diagonal elements of matrix.
+ * \param[in]     A_diag Array holding all diagonal elements of matrix
+ * \param[in]     cyclic Value of the matrix in the bottom corner which is non-zero due to
+ *                       cyclic boundaries.
+ * \param[in,out] b      Right-hand side of the equation.  Overwritten by the solution.
+ * \param[out]    F      Workspace for the modified diagonal
+ * \param[out]    z      Workspace for the fill-in from the corner element
+ *
+ * \details The workspace arrays are only resized if they have the wrong size, so a
+ *          time-stepping loop that keeps them between calls does not allocate any
+ *          memory.
+ */
+void solve_cyclic_matrix(const arma::vec &A_sub,
+                         const arma::vec &A_diag,
+                         const double     cyclic,
+                         arma::vec       &b,
+                         arma::vec       &F,
+                         arma::vec       &z)
+{
+    const size_t ni = A_diag.size();
+
+    if(b.size() != ni || A_sub.size() + 1 != ni)
+    {
+        std::ostringstream oss;
+        oss << "Size mismatch in cyclic matrix equation: "
+            << "(subdiagonal = " << A_sub.size() << "; "
+            << "diagonal = " << ni << "; "
+            << "right-hand side = " << b.size() << ")";
+        throw std::runtime_error(oss.str());
+    }
+
+    // The matrix is symmetric apart from the corner element
+    const arma::vec &A_super = A_sub;
+
+    F.set_size(ni);
+    z.set_size(ni);
+
+    //Forward sweep
+    // Initial elements (don't need to set b!)
+    F[0] = A_diag[0];
+    z[0] = 1;
+    for(unsigned int i=1; i<ni-1; i++){
+        F[i] = A_diag[i] - (A_sub[i-1]*A_super[i-1])/F[i-1];
+        b[i] = b[i]-(A_sub[i-1]*b[i-1])/F[i-1];
+
+        // This can probably go in A_sub
+        z[i] = -z[i-1]*A_super[i-1]/F[i-1];
+    }
+
+    // Last F_dash element
+    F[ni-1] = A_diag[ni-1] - (A_sub[ni-2] + cyclic*z[ni-2])*A_super[ni-2]/F[ni-2];
+
+    // Last L_dash element
+    double sum = 0.0;
     for(unsigned int i=0; i<ni-2; i++){
-        sum += -cyclic*z[i]*b[i]/A_diag[i];
+        sum += -cyclic*z[i]*b[i]/F[i];
+    }
+
+    b[ni-1] = b[ni-1] + sum - (A_sub[ni-2] + cyclic*z[ni-2])*b[ni-2]/F[ni-2];
+
+    // Again no need to initialise first element of 
+    // b[ni-1] = b[ni-1]
+    for(int i=ni-2; i>-1; i--)
+        b[i] = b[i]-(A_super[i]*b[i+1])/F[i+1];
+
+    b /= F;
+}
+
+/**
+ * \brief Solves a batch of matrix equations of the cyclic form used by the Poisson solver
+ *
+ * \param[in]     A_sub  Array holding all sub-diagonal elements of matrix.
+ * \param[in]     A_diag Array holding all diagonal elements of matrix
+ * \param[in]     cyclic Value of the matrix in the bottom corner which is non-zero due to
+ *                       cyclic boundaries.
+ * \param[in,out] B      Right-hand sides, in interleaved storage.  Overwritten by the solutions.
+ *
+ * \details This uses the same algorithm as solve_cyclic_matrix, but solves many
+ *          right-hand sides in a single pass through the matrix.  The storage
+ *          is interleaved, i.e., B(j,i) holds element i of right-hand side j, so that
+ *          B.col(i) is contiguous and the inner loops vectorise across right-hand sides.
+ */
+QWWAD_MULTIVERSION
+void solve_cyclic_matrix_batch(const arma::vec &A_sub,
+                               const arma::vec &A_diag,
+                               const double     cyclic,
+                               arma::mat       &B)
+{
+    const size_t ni   = A_diag.size();
+    const size_t nrhs = B.n_rows;
+
+    if(B.n_cols != ni || A_sub.size() + 1 != ni)
+    {
+        std::ostringstream oss;
+        oss << "Size mismatch in cyclic matrix equation: "
+            << "(subdiagonal = " << A_sub.size() << "; "
+            << "diagonal = " << ni << "; "
+            << "right-hand sides = " << B.n_cols << ")";
+        throw std::runtime_error(oss.str());
+    }
+
+    // The matrix is symmetric apart from the corner element
+    const arma::vec &A_super = A_sub;
+    arma::vec F(A_diag); // Modified diagonal elements
+    arma::vec z(ni);
+
+    // Forward sweep for the matrix.  This only needs doing once for all right-hand sides
+    z[0] = 1;
+    for(size_t i=1; i<ni-1; i++){
+        F[i] = F[i] - (A_sub[i-1]*A_super[i-1])/F[i-1];
+        z[i] = -z[i-1]*A_super[i-1]/F[i-1];
+    }
+
+    F[ni-1] = F[ni-1] - (A_sub[ni-2] + cyclic*z[ni-2])*A_super[ni-2]/F[ni-2];
+
+    // Forward sweep for the right-hand sides
+    for(size_t i=1; i<ni-1; i++){
+        const double  l     = A_sub[i-1]/F[i-1];
+        const double *b_prev = B.colptr(i-1);
+        double       *b      = B.colptr(i);
+
+        for(size_t j=0; j<nrhs; j++)
+            b[j] -= l*b_prev[j];
+    }
+
+    // Last L_dash element
+    double *b_last = B.colptr(ni-1);
+
+    for(size_t i=0; i<ni-2; i++){
+        const double  w = -cyclic*z[i]/F[i];
+        const double *b = B.colptr(i);
+
+        for(size_t j=0; j<nrhs; j++)
+            b_last[j] += w*b[j];
+    }
+
+    {
+        const double  l      = (A_sub[ni-2] + cyclic*z[ni-2])/F[ni-2];
+        const double *b_prev = B.colptr(ni-2);
+
+        for(size_t j=0; j<nrhs; j++)
+            b_last[j] -= l*b_prev[j];
+    }
+
+    // Backward sweep
+    for(int i=ni-2; i>-1; i--){
+        const double  u      = A_super[i]/F[i+1];
+        const double *b_next = B.colptr(i+1);
+        double       *b      = B.colptr(i);
+
+        for(size_t j=0; j<nrhs; j++)
+            b[j] -= u*b_next[j];
+    }
+
+    for(size_t i=0; i<ni; i++){
+        const double  inv_F = 1.0/F[i];
+        double       *b     = B.colptr(i);
+
+        for(size_t j=0; j<nrhs; j++)
+            b[j] *= inv_F;
+    }
+}
+
+/**
+ * \brief Refine an approximate eigenpair of a symmetric tridiagonal matrix
+ *
+ * \param[in]     diag    Diagonal elements of matrix
+ * \param[in]     subdiag Subdiagonal elements of matrix
+ * \param[in,out] E       Approximate eigenvalue (overwritten by refined value)
+ * \param[in,out] psi     Approximate eigenvector (overwritten by refined vector)
+ *
+ * \returns The norm of the residual vector for the refined eigenpair
+ *
+ * \details Uses Rayleigh-quotient iteration, starting from the input eigenvector.
+ *          The initial value of E is not used, since the Rayleigh quotient of the
+ *          input vector is a more accurate starting shift.
+ */
+static double refine_eigenpair_tridiag(const arma::vec &diag,
+                                       const arma::vec &subdiag,
+                                       double          &E,
+                                       arma::vec       &psi)
+{
+    const int    N       = diag.size();
+    const int    n_iter  = 8;   // Maximum number of iterations
+    const double eps     = std::numeric_limits<double>::epsilon();
+    const double A_scale = arma::max(arma::abs(diag)) + 2.0*arma::max(arma::abs(subdiag));
+
+    psi /= arma::norm(psi);
+
+    // Find the Rayleigh quotient and residual vector for the current eigenvector
+    auto rayleigh_quotient = [&](double &residual) {
+        arma::vec Apsi = diag % psi;
+        Apsi.head(N-1) += subdiag % psi.tail(N-1);
+        Apsi.tail(N-1) += subdiag % psi.head(N-1);
+
+        const double sigma = arma::dot(psi, Apsi);
+        residual = arma::norm(Apsi - sigma*psi);
+        return sigma;
+    };
+
+    double residual = 0.0;
+    E = rayleigh_quotient(residual);
+
+    for(int iter = 0; iter < n_iter && residual > 10*N*eps*A_scale; ++iter)
+    {
+        // Solve (A - E I) y = psi.  LAPACK overwrites the matrix, so work on copies
+        arma::vec DL = subdiag;
+        arma::vec D  = diag - E;
+        arma::vec DU = subdiag;
+        arma::vec y  = psi;
+        int NRHS = 1;
+        int INFO = 0;
+
+        dgtsv_(&N, &NRHS, DL.memptr(), D.memptr(), DU.memptr(), y.memptr(), &N, &INFO);
+
+        // An exactly singular matrix means that the shift is already an eigenvalue
+        if(INFO > 0)
+            break;
+
+        if(INFO < 0)
+        {
+            std::ostringstream oss;
+            oss << "Cannot solve matrix equation. (LAPACK error code: " << INFO << ")";
+            throw std::runtime_error(oss.str());
+        }
+
+        psi = y / arma::norm(y);
+        E   = rayleigh_quotient(residual);
+    }
+
+    return residual;
+}
+
+/**
+ * \brief Find solutions to a tridiagonal eigenvalue problem, starting from a guess
+ *
+ * \param[in]  diag    Array holding all diagonal elements of matrix
+ * \param[in]  subdiag Array holding all sub-diag. elements of matrix
+ * \param[in]  guess   Approximate solutions, e.g., those of a slightly different matrix
+ * \param[in]  VL      Lowest value for eigenvalue search
+ * \param[in]  VU      Highest value for eigenvalue search
+ * \param[in]  n_max   Max number of eigenvalues to find
+ *
+ * \details Each guessed eigenpair is refined using Rayleigh-quotient iteration, which
+ *          needs only a few tridiagonal solves per state.  Sturm-sequence counts are
+ *          then used to check that the refined set contains exactly one copy of every
+ *          eigenvalue in the search range.  If any state has gone missing, crossed
+ *          another or converged onto the same eigenvalue as another, the full
+ *          eigenvalue problem is solved using eigen_tridiag instead.
+ *
+ *          The search range has the same meaning as for eigen_tridiag, and the
+ *          solutions are returned in ascending order.
+ */
+std::vector< EVP_solution<double> >
+eigen_tridiag_refine(arma::vec                                 &diag,
+                     arma::vec                                 &subdiag,
+                     const std::vector< EVP_solution<double> > &guess,
+                     double                                     VL,
+                     double                                     VU,
+                     unsigned int                               n_max)
+{
+    const size_t N = diag.size();
+
+    bool guess_ok = (N > 1 && subdiag.size() == N-1 && !guess.empty());
+
+    for(const auto &st : guess)
+    {
+        if(st.size() != N)
+            guess_ok = false;
+    }
+
+    if(!guess_ok)
+        return eigen_tridiag(diag, subdiag, VL, VU, n_max);
+
+    // Refine each state, and find an interval that must contain its eigenvalue
+    const double eps     = std::numeric_limits<double>::epsilon();
+    const double A_scale = arma::max(arma::abs(diag)) + 2.0*arma::max(arma::abs(subdiag));
+
+    std::vector< EVP_solution<double> > refined;
+    std::vector<double>                 tolerance;
+
+    for(const auto &st : guess)
+    {
+        double    E   = st.get_E();
+        arma::vec psi = st.psi_array();
+        const double residual = refine_eigenpair_tridiag(diag, subdiag, E, psi);
+
+        // Keep the same sign convention as the guess, so that sweeps give smooth results
+        if(arma::dot(psi, st.psi_array()) < 0)
+            psi *= -1;
+
+        refined.push_back(EVP_solution<double>(E, psi));
+
+        // For a symmetric matrix, an eigenvalue lies within the residual norm of the
+        // Rayleigh quotient
+        tolerance.push_back(10*GSL_MAX_DBL(residual, N*eps*A_scale));
+    }
+
+    // Sort the refined states by energy
+    std::vector<size_t> order(refined.size());
+
+    for(size_t ist = 0; ist < order.size(); ++ist)
+        order[ist] = ist;
+
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return refined[a].get_E() < refined[b].get_E();
+    });
+
+    std::vector< EVP_solution<double> > solutions;
+    std::vector<double>                 tol_sorted;
+
+    for(auto ist : order)
+    {
+        const double E = refined[ist].get_E();
+
+        // Discard anything that has moved out of the search range by value
+        if(n_max == 0 && (E + tolerance[ist] <= VL || E - tolerance[ist] > VU))
+            continue;
+
+        solutions.push_back(refined[ist]);
+        tol_sorted.push_back(tolerance[ist]);
+    }
+
+    if(n_max != 0 && solutions.size() > n_max)
+    {
+        solutions.erase(solutions.begin() + n_max, solutions.end());
+        tol_sorted.erase(tol_sorted.begin() + n_max, tol_sorted.end());
+    }
+
+    // Now check that there is exactly one eigenvalue inside each state's interval,
+    // and none in the gaps between them
+    const size_t nst   = solutions.size();
+    bool         valid = (nst > 0) && (n_max == 0 || nst == n_max);
+
+    unsigned int count_prev = 0;
+
+    if(valid)
+    {
+        const double E_lo = solutions[0].get_E() - tol_sorted[0];
+
+        if(n_max == 0)
+        {
+            count_prev = count_eigen_tridiag(diag, subdiag, VL);
+            valid = (E_lo > VL) && (count_eigen_tridiag(diag, subdiag, E_lo) == count_prev);
+        }
+        else
+            valid = (count_eigen_tridiag(diag, subdiag, E_lo) == 0);
+    }
+
+    for(size_t ist = 0; valid && ist < nst; ++ist)
+    {
+        const double E_lo = solutions[ist].get_E() - tol_sorted[ist];
+        const double E_hi = solutions[ist].get_E() + tol_sorted[ist];
+
+        // Intervals for neighbouring states must not overlap
+        if(ist > 0 && E_lo <= solutions[ist-1].get_E() + tol_sorted[ist-1])
+            valid = false;
+        else
+        {
+            const auto count_lo = count_eigen_tridiag(diag, subdiag, E_lo);
+            const auto count_hi = count_eigen_tridiag(diag, subdiag, E_hi);
+
+            valid = (count_lo == count_prev) && (count_hi == count_prev + 1);
+            count_prev = count_hi;
+        }
+    }
+
+    if(valid && n_max == 0)
+    {
+        const double E_hi = solutions[nst-1].get_E() + tol_sorted[nst-1];
+        valid = (E_hi <= VU) && (count_eigen_tridiag(diag, subdiag, VU) == count_prev);
+    }
+
+    if(!valid)
+        return eigen_tridiag(diag, subdiag, VL, VU, n_max);
+
+    return solutions;
+}
+
+/**
+ * \brief Count the eigenvalues of a symmetric-definite tridiagonal pencil that lie below a given value
+ *
+ * \param[in] A_diag Diagonal of the matrix A
+ * \param[in] A_sub  Subdiagonal of the matrix A
+ * \param[in] B_diag Diagonal of the positive-definite matrix B
+ * \param[in] B_sub  Subdiagonal of the positive-definite matrix B
+ * \param[in] x      Value at which to evaluate the count
+ *
+ * \details By Sylvester's law of inertia, the number of eigenvalues of Ax = lambda Bx
+ *          below x equals the number of negative pivots in the LDL^T factorisation of
+ *          the tridiagonal matrix A - xB.
+ */
+static int sturm_count_generalised(const arma::vec &A_diag,
+                                   const arma::vec &A_sub,
+                                   const arma::vec &B_diag,
+                                   const arma::vec &B_sub,
+                                   const double     x)
+{
+    const size_t N      = A_diag.size();
+    const double pivmin = std::numeric_limits<double>::min();
+
+    int    count = 0;
+    double q     = A_diag(0) - x*B_diag(0);
+
+    for(size_t i = 0; i < N; ++i)
+    {
+        if(i > 0)
+        {
+            const double off = A_sub(i-1) - x*B_sub(i-1);
+            q = A_diag(i) - x*B_diag(i) - off*off/q;
+        }
+
+        if(std::abs(q) < pivmin)
+            q = -pivmin;
+
+        if(q < 0)
+            ++count;
+    }
+
+    return count;
+}
+
+/**
+ * \brief Find solutions to a symmetric-definite generalised tridiagonal eigenvalue problem
+ *
+ * \param[in] A_diag Diagonal of the symmetric matrix A
+ * \param[in] A_sub  Subdiagonal of the symmetric matrix A
+ * \param[in] B_diag Diagonal of the symmetric positive-definite matrix B
+ * \param[in] B_sub  Subdiagonal of the symmetric positive-definite matrix B
+ * \param[in] VL     Lowest value for eigenvalue search
+ * \param[in] VU     Highest value for eigenvalue search
+ * \param[in] n_max  Max number of eigenvalues to find
+ *
+ * \details Solves Ax = lambda Bx for the eigenvalues within a window, using the same
+ *          conventions as eigen_banded: if n_max=0, all eigenvalues in the range
+ *          (VL,VU] are found, otherwise the lowest n_max eigenvalues are found.
+ *
+ *          Each eigenvalue is located by bisection, using Sturm counts of A - xB,
+ *          and its eigenvector is then found by inverse iteration.  Eigenvectors of
+ *          closely spaced eigenvalues are B-orthogonalised against each other.  Unlike
+ *          the LAPACK banded solver, no dense n x n workspace is needed, so the memory
+ *          used is proportional to the matrix order multiplied by the number of
+ *          solutions.  The eigenvectors are normalised such that x^T B x = 1.
+ */
+std::vector< EVP_solution<double> >
+eigen_tridiag_generalised(const arma::vec &A_diag,
+                          const arma::vec &A_sub,
+                          const arma::vec &B_diag,
+                          const arma::vec &B_sub,
+                          const double     VL,
+                          const double     VU,
+                          unsigned int     n_max)
+{
+    const size_t N = A_diag.size();
+
+    if(A_sub.size() + 1 != N || B_diag.size() != N || B_sub.size() + 1 != N)
+    {
+        std::ostringstream oss;
+        oss << "Size mismatch for tridiagonal elements: "
+            << "(A diagonal = "    << N            << "; "
+            << "A subdiagonal = "  << A_sub.size() << "; "
+            << "B diagonal = "     << B_diag.size() << "; "
+            << "B subdiagonal = "  << B_sub.size() << ")";
+        throw std::runtime_error(oss.str());
+    }
+
+    if(n_max == 0 && gsl_fcmp(VL, VU, VL*1e-6) != -1)
+    {
+        std::ostringstream oss;
+        oss << "Range of eigenvalue search is invalid. Lower limit: " << VL << " is greater than upper limit: " << VU;
+        throw std::domain_error(oss.str());
+    }
+
+    auto count = [&](const double x) {
+        return sturm_count_generalised(A_diag, A_sub, B_diag, B_sub, x);
+    };
+
+    // Find the indices (from 1) of the eigenvalues that we need, and an interval
+    // that contains all of them
+    double lo = VL;
+    double hi = VU;
+    int    IL = 1;
+    int    IU = 0;
+
+    if(n_max == 0)
+    {
+        IL = count(VL) + 1;
+        IU = count(VU);
+    }
+    else
+    {
+        IU = GSL_MIN_INT((int)n_max, (int)N);
+
+        // Expand the search interval until it contains the lowest n_max eigenvalues
+        double width = GSL_MAX_DBL(hi - lo, std::abs(hi) + std::abs(lo));
+
+        if(width == 0.0)
+            width = 1.0;
+
+        for(int iter = 0; count(lo) > 0 && iter < 100; ++iter)
+        {
+            lo    -= width;
+            width *= 2;
+        }
+
+        for(int iter = 0; count(hi) < IU && iter < 100; ++iter)
+        {
+            hi    += width;
+            width *= 2;
+        }
+    }
+
+    const double eps = std::numeric_limits<double>::epsilon();
+
+    std::vector< EVP_solution<double> > solutions;
+    std::vector<arma::vec>              B_psi_cluster; // B*psi for states in current cluster
+    std::vector<size_t>                 cluster;      // Indices of states in current cluster
+
+    for(int k = IL; k <= IU; ++k)
+    {
+        // Bisect to find the k-th eigenvalue
+        double E_lo = lo;
+        double E_hi = hi;
+
+        if(!solutions.empty())
+            E_lo = GSL_MAX_DBL(E_lo, solutions.back().get_E());
+
+        for(int iter = 0; iter < 200; ++iter)
+        {
+            const double E_mid = 0.5*(E_lo + E_hi);
+
+            if(E_hi - E_lo <= 2*eps*GSL_MAX_DBL(std::abs(E_lo), std::abs(E_hi)) ||
+               E_mid == E_lo || E_mid == E_hi)
+                break;
+
+            if(count(E_mid) >= k)
+                E_hi = E_mid;
+            else
+                E_lo = E_mid;
+        }
+
+        const double E = 0.5*(E_lo + E_hi);
+
+        // Start a new cluster if this eigenvalue is well separated from the previous one
+        const double gap_tol = 1e-3*GSL_MAX_DBL(std::abs(E), eps);
+
+        if(!solutions.empty() && std::abs(E - solutions.back().get_E()) > gap_tol)
+        {
+            cluster.clear();
+            B_psi_cluster.clear();
+        }
+
+        // Find the eigenvector by inverse iteration.  Perturb the shift slightly so
+        // that the factorisation isn't exactly singular
+        const double shift = E + 4*eps*GSL_MAX_DBL(std::abs(E), 1e-300);
+        const arma::vec M_sub  = A_sub  - shift*B_sub;
+        const arma::vec M_diag = A_diag - shift*B_diag;
+        const TridiagFactorisation M(M_sub, M_diag, M_sub);
+
+        arma::vec psi(N);
+
+        for(size_t i = 0; i < N; ++i)
+            psi(i) = 1.0 + 0.5*sin(i + k);
+
+        arma::vec B_psi(N);
+
+        for(int iter = 0; iter < 3; ++iter)
+        {
+            B_psi = B_diag % psi;
+            B_psi.head(N-1) += B_sub % psi.tail(N-1);
+            B_psi.tail(N-1) += B_sub % psi.head(N-1);
+
+            M.solve_in_place(B_psi);
+            psi = B_psi;
+
+            // B-orthogonalise against the other states in the cluster
+            for(size_t ic = 0; ic < cluster.size(); ++ic)
+                psi -= arma::dot(B_psi_cluster[ic], psi) * solutions[cluster[ic]].psi_array();
+
+            psi /= arma::norm(psi);
+        }
+
+        // Normalise such that psi^T B psi = 1
+        B_psi = B_diag % psi;
+        B_psi.head(N-1) += B_sub % psi.tail(N-1);
+        B_psi.tail(N-1) += B_sub % psi.head(N-1);
+
+        const double norm = sqrt(arma::dot(psi, B_psi));
+        psi   /= norm;
+        B_psi /= norm;
+
+        cluster.push_back(solutions.size());
+        B_psi_cluster.push_back(B_psi);
+        solutions.push_back(EVP_solution<double>(E, psi));
+    }
+
+    return solutions;
+}
+
+/**
+ * \brief Find a range of eigenvalues of a Hermitian matrix from LAPACK
+ *
+ * \param[in,out] A    The matrix.  Only the lower triangle is used, and it is
+ *                     destroyed by LAPACK.
+ * \param[in]     i_lo Index (from 0) of the lowest eigenvalue to find
+ * \param[in]     i_hi Index (from 0) of the highest eigenvalue to find
+ * \param[out]    Z    The eigenvectors, one per column.  Ignored if null.
+ *
+ * \returns The eigenvalues, in ascending order
+ *
+ * \details zheevr only works on the requested part of the spectrum once it has
+ *          reduced the matrix to tridiagonal form, so this is much faster than
+ *          a full diagonalisation when only a few bands are needed.
+ */
+static arma::vec
+eigen_hermitian_lapack(arma::cx_mat       &A,
+                       const unsigned int  i_lo,
+                       const unsigned int  i_hi,
+                       arma::cx_mat       *Z)
+{
+    const int N = A.n_rows;
+
+    if(A.n_cols != A.n_rows)
+    {
+        std::ostringstream oss;
+        oss << "Cannot find eigenvalues of a " << A.n_rows << "x" << A.n_cols << " matrix.";
+        throw std::length_error(oss.str());
+    }
+
+    if(i_lo > i_hi || i_hi >= A.n_rows)
+    {
+        std::ostringstream oss;
+        oss << "Cannot find eigenvalues " << i_lo << " to " << i_hi << " of a matrix of order " << N << ".";
+        throw std::domain_error(oss.str());
+    }
+
+    const char jobz  = Z ? 'V' : 'N'; // Only find eigenvectors if they're wanted
+    const char range = 'I';
+    const char uplo  = 'L';
+    const int  IL    = i_lo + 1; // LAPACK counts from 1
+    const int  IU    = i_hi + 1;
+    const int  M_max = IU - IL + 1;
+    const double VL  = 0.0; // Not used in search by index
+    const double VU  = 0.0;
+
+    // Find error tolerance
+    char retval='S'; // Return value for LAPACK
+    const double abstol = 2.0 * dlamch_(&retval);
+
+    arma::vec W(N); // Eigenvalues
+    int M    = 0;   // Number of solutions found
+    int info = 0;   // Output code from LAPACK
+
+    std::complex<double> *z = Z ? lapack_workspace<std::complex<double>>(0, (size_t)N*M_max) : nullptr;
+    int *isuppz = lapack_workspace<int>(0, 2*(size_t)M_max);
+
+    // Query the optimal workspace sizes
+    std::complex<double> work_query;
+    double rwork_query = 0.0;
+    int    iwork_query = 0;
+    int lwork  = -1;
+    int lrwork = -1;
+    int liwork = -1;
+
+    zheevr_(&jobz, &range, &uplo, &N, A.memptr(), &N, &VL, &VU, &IL, &IU, &abstol, &M,
+            W.memptr(), z, &N, isuppz, &work_query, &lwork, &rwork_query, &lrwork,
+            &iwork_query, &liwork, &info);
+
+    lwork  = static_cast<int>(work_query.real());
+    lrwork = static_cast<int>(rwork_query);
+    liwork = iwork_query;
+
+    auto *work  = lapack_workspace<std::complex<double>>(1, lwork);
+    auto *rwork = lapack_workspace<double>(0, lrwork);
+    auto *iwork = lapack_workspace<int>(1, liwork);
+
+    QWWAD_COUNT  ("LAPACK zheevr calls");
+    QWWAD_COUNT_N("LAPACK zheevr total size", N);
+
+    zheevr_(&jobz, &range, &uplo, &N, A.memptr(), &N, &VL, &VU, &IL, &IU, &abstol, &M,
+            W.memptr(), z, &N, isuppz, work, &lwork, rwork, &lrwork,
+            iwork, &liwork, &info);
+
+    if(info!=0)
+    {
+        std::ostringstream oss;
+        oss << "Could not solve eigenvalue problem. LAPACK error code: "
+            << info;
+        throw std::runtime_error(oss.str());
+    }
+
+    if(Z)
+        *Z = arma::cx_mat(z, N, M);
+
+    return W.head(M);
+}
+
+/**
+ * \brief Find eigenvalues of a Hermitian band matrix, using LAPACK zhbevx
+ *
+ * \param[in,out] AB    The upper triangle of the matrix in LAPACK band storage.
+ *                      This is destroyed.
+ * \param[in]     range 'V' to search by value, or 'I' to search by index
+ * \param[in]     VL    Lower limit of the range of values
+ * \param[in]     VU    Upper limit of the range of values
+ * \param[in]     IL    Index of the lowest eigenvalue to find (from 1)
+ * \param[in]     IU    Index of the highest eigenvalue to find
+ */
+static arma::vec
+eigen_hermitian_banded_lapack(arma::cx_mat &AB,
+                              const char    range,
+                              const double  VL,
+                              const double  VU,
+                              const int     IL,
+                              const int     IU)
+{
+    const int N    = AB.n_cols; // Order of the matrix
+    const int LDAB = AB.n_rows;
+    const int KD   = LDAB - 1;  // Number of superdiagonals
+
+    if(N == 0 || LDAB == 0)
+        throw std::runtime_error("Cannot find eigenvalues of an empty band matrix.");
+
+    const char jobz = 'N';
+    const char uplo = 'U';
+    const int  LDQ  = 1; // Q and Z are not referenced when no eigenvectors are needed
+    const int  LDZ  = 1;
+    int        M    = 0; // Number of solutions found
+    int        info = 0; // Output code from LAPACK
+
+    // Find error tolerance
+    char   retval = 'S';
+    double abstol = 2.0 * dlamch_(&retval);
+
+    std::complex<double>  Q_dummy;
+    std::complex<double>  Z_dummy;
+    arma::vec             W(N);
+    std::complex<double> *work  = lapack_workspace<std::complex<double>>(0, N);
+    double               *rwork = lapack_workspace<double>(0, 7*(size_t)N);
+    int                  *iwork = lapack_workspace<int>(0, 5*(size_t)N);
+    int                  *ifail = lapack_workspace<int>(1, N);
+
+    QWWAD_COUNT  ("LAPACK zhbevx calls");
+    QWWAD_COUNT_N("LAPACK zhbevx total size", N);
+
+    zhbevx_(&jobz, &range, &uplo, &N, &KD, AB.memptr(), &LDAB, &Q_dummy, &LDQ, &VL, &VU, &IL, &IU,
+            &abstol, &M, W.memptr(), &Z_dummy, &LDZ, work, rwork, iwork, ifail, &info);
+
+    if(info != 0)
+    {
+        std::ostringstream oss;
+        oss << "Could not solve eigenvalue problem. LAPACK error code: " << info;
+        throw std::runtime_error(oss.str());
     }
 
-    b[ni-1] = b[ni-1] + sum - (A_sub[ni-2] + cyclic*z[ni-2])*b[ni-2]/A_diag[ni-2];
+    return W.head(M);
+}
 
-    // Again no need to initialise first element of 
-    // b[ni-1] = b[ni-1]
-    for(int i=ni-2; i>-1; i--)
-        b[i] = b[i]-(A_super[i]*b[i+1])/A_diag[i+1];
+/**
+ * \brief Find the eigenvalues of a Hermitian band matrix within a range of values
+ *
+ * \param[in,out] AB The upper triangle of the matrix in LAPACK band storage, with
+ *                   one row for each diagonal.  This is destroyed.
+ * \param[in]     VL Lower limit of the range
+ * \param[in]     VU Upper limit of the range
+ *
+ * \returns The eigenvalues in (VL,VU], in ascending order
+ *
+ * \details No eigenvectors are found, so no dense workspace is needed, and the cost
+ *          is proportional to the order of the matrix multiplied by the square of
+ *          its bandwidth.  The eigenvectors can be found afterwards by inverse
+ *          iteration, using CxBandFactorisation.
+ */
+arma::vec
+eigen_hermitian_banded_values(arma::cx_mat &AB,
+                              const double  VL,
+                              const double  VU)
+{
+    return eigen_hermitian_banded_lapack(AB, 'V', VL, VU, 0, 0);
+}
+
+/**
+ * \brief Find a range of eigenvalues of a Hermitian band matrix
+ *
+ * \param[in,out] AB   The upper triangle of the matrix in LAPACK band storage, with
+ *                     one row for each diagonal.  This is destroyed.
+ * \param[in]     i_lo Index of lowest eigenvalue to find (counting from zero)
+ * \param[in]     i_hi Index of highest eigenvalue to find
+ *
+ * \returns The eigenvalues, in ascending order
+ */
+arma::vec
+eigen_hermitian_banded_range(arma::cx_mat       &AB,
+                             const unsigned int  i_lo,
+                             const unsigned int  i_hi)
+{
+    if(i_hi < i_lo || i_hi >= AB.n_cols)
+    {
+        std::ostringstream oss;
+        oss << "Cannot find eigenvalues " << i_lo << " to " << i_hi
+            << " of a matrix of order " << AB.n_cols;
+        throw std::length_error(oss.str());
+    }
+
+    return eigen_hermitian_banded_lapack(AB, 'I', 0.0, 0.0, i_lo+1, i_hi+1);
+}
+
+/**
+ * \brief Find a range of eigenvalues of a Hermitian matrix
+ *
+ * \param[in,out] A    The matrix.  Only the lower triangle is used, and it is
+ *                     destroyed.
+ * \param[in]     i_lo Index (from 0) of the lowest eigenvalue to find
+ * \param[in]     i_hi Index (from 0) of the highest eigenvalue to find
+ *
+ * \returns The eigenvalues, in ascending order
+ *
+ * \details Large matrices are diagonalised on the GPU, in builds with cuSOLVER
+ *          support (see use_gpu_eigensolver).
+ */
+arma::vec
+eigen_hermitian_range(arma::cx_mat       &A,
+                      const unsigned int  i_lo,
+                      const unsigned int  i_hi)
+{
+    if(use_gpu_eigensolver(A.n_rows))
+        return eigen_hermitian_gpu(A, i_lo, i_hi, nullptr);
+
+    return eigen_hermitian_lapack(A, i_lo, i_hi, nullptr);
+}
+
+/**
+ * \brief Find a range of eigenpairs of a Hermitian matrix
+ *
+ * \param[in,out] A    The matrix.  Only the lower triangle is used, and it is
+ *                     destroyed.
+ * \param[in]     i_lo Index (from 0) of the lowest eigenvalue to find
+ * \param[in]     i_hi Index (from 0) of the highest eigenvalue to find
+ * \param[out]    Z    The eigenvectors, one per column
+ *
+ * \returns The eigenvalues, in ascending order
+ *
+ * \details Large matrices are diagonalised on the GPU, in builds with cuSOLVER
+ *          support (see use_gpu_eigensolver).
+ */
+arma::vec
+eigen_hermitian_range(arma::cx_mat       &A,
+                      const unsigned int  i_lo,
+                      const unsigned int  i_hi,
+                      arma::cx_mat       &Z)
+{
+    if(use_gpu_eigensolver(A.n_rows))
+        return eigen_hermitian_gpu(A, i_lo, i_hi, &Z);
+
+    return eigen_hermitian_lapack(A, i_lo, i_hi, &Z);
+}
+
+/**
+ * \brief Find a transformation that orthonormalises a set of vectors
+ *
+ * \param[in] S The vectors, one per column
+ *
+ * \returns A matrix T, such that the columns of S*T are orthonormal and span the
+ *          same space as S.  Directions in which S is (numerically) linearly
+ *          dependent are dropped, so T may have fewer columns than S.
+ */
+static arma::cx_mat orthonormalising_transform(const arma::cx_mat &S)
+{
+    arma::cx_mat overlap = S.t()*S;
+    overlap = 0.5*(overlap + overlap.t()); // Remove rounding errors in Hermiticity
+
+    arma::vec    mu; // Eigenvalues of overlap matrix
+    arma::cx_mat U;  // Eigenvectors of overlap matrix
+    arma::eig_sym(mu, U, overlap);
+
+    const double mu_min = 1e-10 * mu.max();
+    std::vector<arma::uword> keep;
+
+    for(arma::uword i = 0; i < mu.size(); ++i)
+    {
+        if(mu(i) > mu_min)
+            keep.push_back(i);
+    }
+
+    arma::cx_mat T(S.n_cols, keep.size());
+
+    for(arma::uword i = 0; i < keep.size(); ++i)
+        T.col(i) = U.col(keep[i]) / sqrt(mu(keep[i]));
+
+    return T;
+}
+
+/**
+ * \brief Scale each column of a matrix to unit norm, along with its image under A
+ *
+ * \param[in,out] X  The vectors, one per column
+ * \param[in,out] AX The image of each vector under the operator
+ */
+static void normalise_columns(arma::cx_mat &X,
+                              arma::cx_mat &AX)
+{
+    for(arma::uword i = 0; i < X.n_cols; ++i)
+    {
+        const double x_norm = arma::norm(X.col(i));
+
+        if(x_norm > 0)
+        {
+            X.col(i)  /= x_norm;
+            AX.col(i) /= x_norm;
+        }
+    }
+}
+
+/**
+ * \brief Find the lowest eigenpairs of a Hermitian operator without storing it
+ *
+ * \param[in]     apply_A Function that returns the product of the operator with each
+ *                        column of a matrix
+ * \param[in]     A_diag  Diagonal of the operator, used as a preconditioner
+ * \param[in,out] X       On input, an initial guess for the eigenvectors, with at
+ *                        least n columns.  Any extra columns act as guard vectors,
+ *                        which speed up convergence of the highest wanted states.
+ *                        On output, the n lowest eigenvectors.
+ * \param[in]     n       Number of eigenpairs wanted
+ * \param[in]     tol     Convergence threshold for the norm of the residual of each
+ *                        eigenpair (in the same units as the eigenvalues)
+ * \param[in]     max_iter Maximum number of iterations
+ *
+ * \returns The n lowest eigenvalues in ascending order
+ *
+ * \details This uses the locally-optimal block preconditioned conjugate gradient
+ *          (LOBPCG) method.  At each iteration, the Rayleigh-Ritz method is applied
+ *          to the space spanned by the current eigenvectors, their preconditioned
+ *          residuals and the previous search directions.  The operator is only ever
+ *          applied to one block of vectors per iteration, so the cost is dominated
+ *          by apply_A rather than by the dense algebra on the small subspace.
+ */
+arma::vec
+eigen_hermitian_lobpcg(const std::function<arma::cx_mat (const arma::cx_mat &)> &apply_A,
+                       const arma::vec                                          &A_diag,
+                       arma::cx_mat                                             &X,
+                       const unsigned int                                        n,
+                       const double                                              tol,
+                       const unsigned int                                        max_iter)
+{
+    const arma::uword N = X.n_rows;
+
+    if(A_diag.size() != N)
+    {
+        std::ostringstream oss;
+        oss << "Operator of order " << A_diag.size() << " cannot act on vectors of length " << N << ".";
+        throw std::length_error(oss.str());
+    }
+
+    // Precondition the residuals using the diagonal of (A - lambda I).  The
+    // denominator is bounded away from zero by the spread of the Ritz values.
+    const auto apply_T = [&](const arma::cx_mat &R, const arma::vec &lambda) {
+        const double sigma = GSL_MAX_DBL(lambda.max() - lambda.min(), tol);
+        arma::cx_mat W(R.n_rows, R.n_cols);
+
+        for(arma::uword i = 0; i < R.n_cols; ++i)
+        {
+            for(arma::uword j = 0; j < R.n_rows; ++j)
+                W(j,i) = R(j,i) / GSL_MAX_DBL(std::abs(A_diag(j) - lambda(i)), sigma);
+        }
+
+        return W;
+    };
+
+    return eigen_hermitian_lobpcg(apply_A, apply_T, X, n, tol, max_iter);
+}
+
+/**
+ * \brief Find the lowest eigenpairs of a Hermitian operator, using a given preconditioner
+ *
+ * \param[in]     apply_A  Function that returns the product of the operator with each
+ *                         column of a matrix
+ * \param[in]     apply_T  Preconditioner.  This takes the residuals of the current
+ *                         Ritz pairs (one per column) and the Ritz values, and returns
+ *                         an approximation to (A - lambda I)^{-1} applied to each
+ *                         residual.  Any symmetric positive-definite approximation to
+ *                         the inverse of A (shifted to be positive-definite) will do.
+ * \param[in,out] X        On input, an initial guess for the eigenvectors.  On output,
+ *                         the n lowest eigenvectors.
+ * \param[in]     n        Number of eigenpairs wanted
+ * \param[in]     tol      Convergence threshold for the norm of the residual of each
+ *                         eigenpair (in the same units as the eigenvalues)
+ * \param[in]     max_iter Maximum number of iterations
+ *
+ * \returns The n lowest eigenvalues in ascending order
+ *
+ * \details This is the same method as the diagonally-preconditioned version, which
+ *          is usually enough for plane-wave bases.  A better preconditioner is
+ *          needed for finite-difference operators, whose diagonal is nearly uniform.
+ */
+arma::vec
+eigen_hermitian_lobpcg(const std::function<arma::cx_mat (const arma::cx_mat &)>                    &apply_A,
+                       const std::function<arma::cx_mat (const arma::cx_mat &, const arma::vec &)> &apply_T,
+                       arma::cx_mat                                                                &X,
+                       const unsigned int                                                           n,
+                       const double                                                                 tol,
+                       const unsigned int                                                           max_iter)
+{
+    const arma::uword N = X.n_rows;
+
+    if(n == 0 || X.n_cols < n || X.n_cols > N)
+    {
+        std::ostringstream oss;
+        oss << "Cannot find " << n << " eigenpairs using a block of " << X.n_cols
+            << " vectors of length " << N << ".";
+        throw std::domain_error(oss.str());
+    }
+
+    const arma::uword m = X.n_cols; // Block size, including guard vectors
+
+    // Start from an orthonormal set of Ritz vectors in the space of the guess
+    X = X * orthonormalising_transform(X);
+
+    if(X.n_cols < m)
+        throw std::domain_error("Initial guess for eigenvectors is linearly dependent.");
+
+    arma::cx_mat AX = apply_A(X);
+    arma::vec    lambda; // Ritz values
+    arma::cx_mat C;      // Ritz vectors in subspace
+
+    arma::cx_mat X_t_AX = X.t()*AX;
+    arma::eig_sym(lambda, C, arma::cx_mat(0.5*(X_t_AX + X_t_AX.t())));
+    X  = X*C;
+    AX = AX*C;
+
+    arma::cx_mat P;  // Previous search directions
+    arma::cx_mat AP; // Image of search directions
+
+    for(unsigned int iter = 0; iter < max_iter; ++iter)
+    {
+        // Residuals of current Ritz pairs
+        const arma::cx_mat R = AX - X*arma::diagmat(lambda);
+
+        bool converged = true;
+
+        for(unsigned int i = 0; i < n; ++i)
+        {
+            if(arma::norm(R.col(i)) > tol)
+                converged = false;
+        }
+
+        if(converged)
+        {
+            X = X.cols(0, n-1);
+            return lambda.head(n);
+        }
+
+        arma::cx_mat W  = apply_T(R, lambda);
+        arma::cx_mat AW = apply_A(W);
+        normalise_columns(W, AW);
+
+        // Rayleigh-Ritz in the combined subspace of [X W P]
+        const arma::cx_mat S  = P.is_empty() ? arma::cx_mat(arma::join_rows(X, W))
+                                             : arma::cx_mat(arma::join_rows(arma::join_rows(X, W), P));
+        const arma::cx_mat AS = P.is_empty() ? arma::cx_mat(arma::join_rows(AX, AW))
+                                             : arma::cx_mat(arma::join_rows(arma::join_rows(AX, AW), AP));
+
+        const arma::cx_mat T  = orthonormalising_transform(S);
+        const arma::cx_mat Q  = S*T;
+        const arma::cx_mat AQ = AS*T;
+
+        if(Q.n_cols < m)
+            throw std::runtime_error("Search space collapsed in LOBPCG eigensolver.");
+
+        arma::cx_mat Q_t_AQ = Q.t()*AQ;
+        arma::vec    mu;
+        arma::eig_sym(mu, C, arma::cx_mat(0.5*(Q_t_AQ + Q_t_AQ.t())));
+
+        C = C.cols(0, m-1);
+        const arma::cx_mat X_new  = Q*C;
+        const arma::cx_mat AX_new = AQ*C;
+        lambda = mu.head(m);
+
+        // The new search direction is the part of the update that is orthogonal to
+        // the previous Ritz vectors
+        const arma::cx_mat X_t_X_new = X.t()*X_new;
+        P  = X_new  - X*X_t_X_new;
+        AP = AX_new - AX*X_t_X_new;
+        normalise_columns(P, AP);
+
+        X  = X_new;
+        AX = AX_new;
+
+        // Refresh the image of the Ritz vectors now and then, so that rounding
+        // errors in the implicit updates don't build up
+        if((iter+1) % 20 == 0)
+        {
+            AX = apply_A(X);
+            P.reset();
+            AP.reset();
+        }
+    }
+
+    std::ostringstream oss;
+    oss << "LOBPCG eigensolver did not converge in " << max_iter << " iterations.";
+    throw std::runtime_error(oss.str());
+}
+
+/**
+ * \brief Find the lowest eigenpairs of a Hermitian matrix in single precision
+ *
+ * \param[in]  A Hermitian matrix.  Only the lower triangle is used.
+ * \param[in]  n Number of eigenpairs to find
+ * \param[out] Z The eigenvectors, one per column, converted to double precision
+ *
+ * \returns The eigenvalues, in ascending order
+ */
+static arma::vec
+eigen_hermitian_lapack_single(const arma::cx_mat &A,
+                              const unsigned int  n,
+                              arma::cx_mat       &Z)
+{
+    const int N = A.n_rows;
+
+    // Single-precision copy of the lower triangle
+    std::vector<std::complex<float>> A_s((size_t)N*N);
+
+    for(int j = 0; j < N; ++j)
+    {
+        for(int i = j; i < N; ++i)
+            A_s[(size_t)j*N + i] = std::complex<float>(A(i,j));
+    }
+
+    const char  jobz  = 'V';
+    const char  range = 'I';
+    const char  uplo  = 'L';
+    const int   IL    = 1;
+    const int   IU    = n;
+    const float VL    = 0.0f; // Not used in search by index
+    const float VU    = 0.0f;
+
+    char retval = 'S';
+    const float abstol = 2.0f * slamch_(&retval);
+
+    std::vector<float>               W(N);
+    std::vector<std::complex<float>> z((size_t)N*n);
+    std::vector<int>                 isuppz(2*(size_t)n);
+    int M    = 0;
+    int info = 0;
+
+    // Query the optimal workspace sizes
+    std::complex<float> work_query;
+    float rwork_query = 0.0f;
+    int   iwork_query = 0;
+    int   lwork  = -1;
+    int   lrwork = -1;
+    int   liwork = -1;
+
+    cheevr_(&jobz, &range, &uplo, &N, A_s.data(), &N, &VL, &VU, &IL, &IU, &abstol, &M,
+            W.data(), z.data(), &N, isuppz.data(), &work_query, &lwork, &rwork_query, &lrwork,
+            &iwork_query, &liwork, &info);
+
+    lwork  = static_cast<int>(work_query.real());
+    lrwork = static_cast<int>(rwork_query);
+    liwork = iwork_query;
+
+    std::vector<std::complex<float>> work(lwork);
+    std::vector<float>               rwork(lrwork);
+    std::vector<int>                 iwork(liwork);
+
+    QWWAD_COUNT  ("LAPACK cheevr calls");
+    QWWAD_COUNT_N("LAPACK cheevr total size", N);
+
+    cheevr_(&jobz, &range, &uplo, &N, A_s.data(), &N, &VL, &VU, &IL, &IU, &abstol, &M,
+            W.data(), z.data(), &N, isuppz.data(), work.data(), &lwork, rwork.data(), &lrwork,
+            iwork.data(), &liwork, &info);
+
+    if(info != 0)
+    {
+        std::ostringstream oss;
+        oss << "Could not solve single-precision eigenvalue problem. LAPACK error code: " << info;
+        throw std::runtime_error(oss.str());
+    }
+
+    Z.set_size(N, M);
+    arma::vec E(M);
+
+    for(int j = 0; j < M; ++j)
+    {
+        E(j) = W[j];
+
+        for(int i = 0; i < N; ++i)
+            Z(i,j) = std::complex<double>(z[(size_t)j*N + i]);
+    }
+
+    return E;
+}
+
+/**
+ * \brief Find a range of eigenpairs of a Hermitian matrix, using a single-precision
+ *        solution that is refined to double precision
+ *
+ * \param[in,out] A        The matrix.  Only the lower triangle is used.  On output,
+ *                          the upper triangle is filled in.
+ * \param[in]     i_lo     Index (from 0) of the lowest eigenvalue to find
+ * \param[in]     i_hi     Index (from 0) of the highest eigenvalue to find
+ * \param[in]     tol      Convergence threshold for the norm of the residual of each
+ *                          eigenpair (in the same units as the eigenvalues)
+ * \param[out]    Z        The eigenvectors, one per column
+ * \param[out]    residual The largest norm of the residual of any of the eigenpairs.
+ *                          This bounds the error in each eigenvalue.
+ *
+ * \returns The eigenvalues, in ascending order
+ *
+ * \details The reduction to tridiagonal form dominates the cost of zheevr, and
+ *          takes about half as long in single precision.  The single-precision
+ *          eigenvectors are accurate to about 1e-7 of the spread of the spectrum,
+ *          so a few LOBPCG iterations with the double-precision matrix are enough
+ *          to refine them.  All of the eigenpairs below i_hi are refined, since
+ *          LOBPCG finds the lowest part of the spectrum, along with a few guard
+ *          vectors.  If the refinement fails, a double-precision solution is used
+ *          instead.
+ */
+arma::vec
+eigen_hermitian_range_mixed(arma::cx_mat       &A,
+                            const unsigned int  i_lo,
+                            const unsigned int  i_hi,
+                            const double        tol,
+                            arma::cx_mat       &Z,
+                            double             &residual)
+{
+    const arma::uword N = A.n_rows;
+
+    if(A.n_cols != N || i_lo > i_hi || i_hi >= N)
+    {
+        std::ostringstream oss;
+        oss << "Cannot find eigenvalues " << i_lo << " to " << i_hi << " of a "
+            << A.n_rows << "x" << A.n_cols << " matrix.";
+        throw std::domain_error(oss.str());
+    }
+
+    // Fill in the upper triangle, so that the matrix can be applied directly
+    for(arma::uword j = 0; j < N; ++j)
+    {
+        for(arma::uword i = 0; i < j; ++i)
+            A(i,j) = std::conj(A(j,i));
+    }
+
+    const unsigned int n = i_hi + 1;
+    const unsigned int m = std::min<arma::uword>(N, n + std::max<unsigned int>(4, n/4)); // Block size
+
+    arma::cx_mat X;
+    eigen_hermitian_lapack_single(A, m, X);
+
+    arma::vec E;
+
+    try
+    {
+        const auto apply_A = [&A](const arma::cx_mat &Y) {return arma::cx_mat(A*Y);};
+        const arma::vec A_diag = arma::real(A.diag());
+
+        E = eigen_hermitian_lobpcg(apply_A, A_diag, X, n, tol);
+    }
+    catch(std::exception &)
+    {
+        // Fall back to a double-precision solution, using a copy since LAPACK
+        // destroys the matrix
+        arma::cx_mat A_copy = A;
+        E = eigen_hermitian_lapack(A_copy, 0, i_hi, &X);
+    }
+
+    const arma::cx_mat R = A*X - X*arma::diagmat(E);
+    residual = 0.0;
 
-    return b/A_diag;
+    for(arma::uword i = i_lo; i <= i_hi; ++i)
+        residual = GSL_MAX_DBL(residual, arma::norm(R.col(i)));
+
+    Z = X.cols(i_lo, i_hi);
+    return E.subvec(i_lo, i_hi);
 }
 
 /**
@@ -361,77 +2233,249 @@ multiply_vec_tridiag(arma::vec const &M_sub,
                      arma::vec const &x,
                      arma::vec const &c)
 {
-    int N = M_diag.size(); // Order of matrix
+    arma::vec y(M_diag.size());
+    multiply_vec_tridiag(M_sub, M_diag, M_super, x, c, y);
+    return y;
+}
+
+/**
+ * \brief Perform matrix multiplication into an existing vector: y = Mx + c
+ *
+ * \param[in]  M_sub   Subdiagonal of matrix M
+ * \param[in]  M_diag  Diagonal of matrix M
+ * \param[in]  M_super Superdiagonal of matrix M
+ * \param[in]  x       Vector x
+ * \param[in]  c       Vector c
+ * \param[out] y       Vector y.  This is only resized if it has the wrong size.
+ *
+ * \details y may be the same vector as c, but not as x.
+ */
+void
+multiply_vec_tridiag(arma::vec const &M_sub,
+                     arma::vec const &M_diag,
+                     arma::vec const &M_super,
+                     arma::vec const &x,
+                     arma::vec const &c,
+                     arma::vec       &y)
+{
+    const size_t N = M_diag.size(); // Order of matrix
+
+    if(M_sub.size() + 1 != N || M_super.size() + 1 != N || x.size() != N || c.size() != N)
+    {
+        std::ostringstream oss;
+        oss << "Size mismatch in tridiagonal matrix multiplication.";
+        throw std::runtime_error(oss.str());
+    }
+
+    if(&y == &x)
+        throw std::invalid_argument("Output of tridiagonal matrix multiplication must not overwrite its input.");
+
+    y.set_size(N);
+
+    for(size_t i = 0; i < N; ++i)
+    {
+        double yi = c[i] + M_diag[i]*x[i];
+
+        if(i > 0)
+            yi += M_sub[i-1]*x[i-1];
+
+        if(i < N-1)
+            yi += M_super[i]*x[i+1];
+
+        y[i] = yi;
+    }
+}
+
+/**
+ * \brief Solve a linear equation Ax = b
+ *
+ * \param[in] A_sub   The subdiagonal of matrix A
+ * \param[in] A_diag  The diagonal of matrix A
+ * \param[in] A_super The superdiagonal of matrix A
+ * \param[in] b       The right-hand-side vector b
+ *
+ * \details where b is a vector and A is a tridiagonal matrix
+ *
+ * \return The vector x
+ */
+arma::vec
+solve_tridiag(arma::vec const &A_sub,
+              arma::vec const &A_diag,
+              arma::vec const &A_super,
+              arma::vec const &b)
+{
+    arma::vec            x(b);
+    TridiagFactorisation work;
+    solve_tridiag(A_sub, A_diag, A_super, x, work);
+    return x;
+}
+
+/**
+ * \brief Solve a linear equation Ax = b in place, using a caller-provided factorisation
+ *
+ * \param[in]     A_sub   The subdiagonal of matrix A
+ * \param[in]     A_diag  The diagonal of matrix A
+ * \param[in]     A_super The superdiagonal of matrix A
+ * \param[in,out] b       The right-hand-side vector b.  Overwritten by the solution.
+ * \param[out]    work    Storage for the LU factorisation of A
+ *
+ * \details The matrix is left unchanged.  The factorisation reuses its storage when the
+ *          matrix has the same size as on the previous call, so a loop that keeps
+ *          the same workspace does not allocate any memory.
+ */
+void
+solve_tridiag(arma::vec const      &A_sub,
+              arma::vec const      &A_diag,
+              arma::vec const      &A_super,
+              arma::vec            &b,
+              TridiagFactorisation &work)
+{
+    work.factorise(A_sub, A_diag, A_super);
+    work.solve_in_place(b);
+}
+
+/**
+ * \brief Perform a batch of matrix multiplications: Y = MX + C
+ *
+ * \param[in] M_sub   The subdiagonal of M
+ * \param[in] M_diag  The diagonal of M
+ * \param[in] M_super The superdiagonal of M
+ * \param[in] X       Vectors to multiply, in interleaved storage
+ * \param[in] C       Vectors to add, in interleaved storage
+ *
+ * \returns The resulting vectors, Y, in interleaved storage
+ *
+ * \details The storage is interleaved, i.e., X(j,i) holds element i of vector j, so
+ *          that X.col(i) is contiguous and the inner loops vectorise across vectors.
+ */
+QWWAD_MULTIVERSION
+arma::mat
+multiply_vec_tridiag_batch(arma::vec const &M_sub,
+                           arma::vec const &M_diag,
+                           arma::vec const &M_super,
+                           arma::mat const &X,
+                           arma::mat const &C)
+{
+    const size_t N    = M_diag.size();
+    const size_t nvec = X.n_rows;
+
+    if(M_sub.size() + 1 != N || M_super.size() + 1 != N ||
+       X.n_cols != N || C.n_cols != N || C.n_rows != nvec)
+    {
+        std::ostringstream oss;
+        oss << "Size mismatch in tridiagonal matrix multiplication.";
+        throw std::runtime_error(oss.str());
+    }
 
-    double scale = 1;   // Don't scale the c or x vectors
-    char   TRANS = 'N'; // Don't transpose the M matrix
-    int    NRHS  = 1;   // Only solve for one column-vector
+    arma::mat Y = C;
 
-    // Temp copy of x that will be overwritten by LAPACK
-    arma::vec x_tmp = x;
+    for(size_t i = 0; i < N; ++i)
+    {
+        const double *x = X.colptr(i);
+        double       *y = Y.colptr(i);
 
-    // Perform matrix multiplication using LAPACK
-    // result:-> result + RHS*Told
-    dlagtm_(&TRANS,
-            &N,
-            &NRHS,
-            &scale,
-            M_sub.memptr(),
-            M_diag.memptr(),
-            M_super.memptr(),
-            x_tmp.memptr(),
-            &N,
-            &scale,
-            c.memptr(),
-            &N);
+        for(size_t j = 0; j < nvec; ++j)
+            y[j] += M_diag[i]*x[j];
+
+        if(i > 0)
+        {
+            const double *x_prev = X.colptr(i-1);
+
+            for(size_t j = 0; j < nvec; ++j)
+                y[j] += M_sub[i-1]*x_prev[j];
+        }
+
+        if(i < N-1)
+        {
+            const double *x_next = X.colptr(i+1);
+
+            for(size_t j = 0; j < nvec; ++j)
+                y[j] += M_super[i]*x_next[j];
+        }
+    }
 
-    // The x vector has now been overwritten by the resulting
-    // y vector, so we can return this
-    arma::vec y = x_tmp;
-    return y;
+    return Y;
 }
 
 /**
- * \brief Solve a linear equation Ax = b
- *
- * \param[in] A_sub   The subdiagonal of matrix A
- * \param[in] A_diag  The diagonal of matrix A
- * \param[in] A_super The superdiagonal of matrix A
- * \param[in] b       The right-hand-side vector b
+ * \brief Solve a batch of linear equations AX = B
  *
- * \details where b is a vector and A is a tridiagonal matrix
+ * \param[in]     A_sub   Subdiagonal of A
+ * \param[in]     A_diag  Diagonal of A
+ * \param[in]     A_super Superdiagonal of A
+ * \param[in,out] B       Right-hand sides, in interleaved storage.  Overwritten by the solutions.
  *
- * \return The vector x
+ * \details Uses the Thomas algorithm without pivoting, so A must be diagonally dominant
+ *          (as for the discretised Poisson and heat equations).  The elimination
+ *          factors are computed once and then applied to all right-hand sides in
+ *          a single pass.  The storage is interleaved, i.e., B(j,i) holds element i
+ *          of right-hand side j, so that B.col(i) is contiguous and the inner loops
+ *          vectorise across right-hand sides.
  */
-arma::vec
-solve_tridiag(arma::vec const &A_sub,
-              arma::vec const &A_diag,
-              arma::vec const &A_super,
-              arma::vec const &b)
+QWWAD_MULTIVERSION
+void
+solve_tridiag_batch(arma::vec const &A_sub,
+                    arma::vec const &A_diag,
+                    arma::vec const &A_super,
+                    arma::mat       &B)
 {
-    int N    = A_diag.size();
-    int NRHS = 1; // Solve for 1 RHS vector only
-
-    arma::vec x_tmp = b;
+    const size_t N    = A_diag.size();
+    const size_t nrhs = B.n_rows;
 
-    int INFO=0;
-    dgtsv_(&N,
-           &NRHS,
-           A_sub.memptr(),
-           A_diag.memptr(),
-           A_super.memptr(),
-           x_tmp.memptr(),
-           &N,
-           &INFO);
-
-    if(INFO != 0)
+    if(A_sub.size() + 1 != N || A_super.size() + 1 != N || B.n_cols != N)
     {
         std::ostringstream oss;
-        oss << "Cannot solve matrix equation. (LAPACK error code: " << INFO << ")";
+        oss << "Size mismatch in tridiagonal matrix equation.";
         throw std::runtime_error(oss.str());
     }
 
-    return x_tmp;
+    // Find the elimination factors for the matrix
+    arma::vec inv_denom(N); // Reciprocal of modified diagonal
+    arma::vec c_dash(N);    // Modified superdiagonal
+
+    for(size_t i = 0; i < N; ++i)
+    {
+        const double denom = (i == 0) ? A_diag[0] : A_diag[i] - A_sub[i-1]*c_dash[i-1];
+
+        if(denom == 0.0)
+        {
+            std::ostringstream oss;
+            oss << "Cannot solve matrix equation. Zero pivot at row " << i;
+            throw std::runtime_error(oss.str());
+        }
+
+        inv_denom[i] = 1.0/denom;
+        c_dash[i]    = (i < N-1) ? A_super[i]*inv_denom[i] : 0.0;
+    }
+
+    // Forward sweep
+    for(size_t i = 0; i < N; ++i)
+    {
+        double *b = B.colptr(i);
+
+        if(i > 0)
+        {
+            const double  l      = A_sub[i-1];
+            const double *b_prev = B.colptr(i-1);
+
+            for(size_t j = 0; j < nrhs; ++j)
+                b[j] -= l*b_prev[j];
+        }
+
+        for(size_t j = 0; j < nrhs; ++j)
+            b[j] *= inv_denom[i];
+    }
+
+    // Back substitution
+    for(int i = N-2; i >= 0; --i)
+    {
+        const double  c      = c_dash[i];
+        const double *b_next = B.colptr(i+1);
+        double       *b      = B.colptr(i);
+
+        for(size_t j = 0; j < nrhs; ++j)
+            b[j] -= c*b_next[j];
+    }
 }
 
 /**
@@ -505,5 +2549,411 @@ factorise_tridiag_LDL_T(arma::vec const &A_diag,
         throw std::runtime_error(oss.str());
     }
 }
+/**
+ * \brief Create an empty factorisation
+ *
+ * \details One of the factorise() functions must be called before solving
+ */
+TridiagFactorisation::TridiagFactorisation() :
+    _symmetric(true),
+    _DL(),
+    _D(),
+    _DU(),
+    _DU2(),
+    _ipiv()
+{}
+
+/**
+ * \brief Factorise a symmetric positive-definite tridiagonal matrix
+ *
+ * \param[in] A_diag Diagonal of the matrix
+ * \param[in] A_sub  Subdiagonal of the matrix
+ */
+TridiagFactorisation::TridiagFactorisation(const arma::vec &A_diag,
+                                           const arma::vec &A_sub) :
+    TridiagFactorisation()
+{
+    factorise(A_diag, A_sub);
+}
+
+/**
+ * \brief Factorise a general tridiagonal matrix
+ *
+ * \param[in] A_sub   Subdiagonal of the matrix
+ * \param[in] A_diag  Diagonal of the matrix
+ * \param[in] A_super Superdiagonal of the matrix
+ */
+TridiagFactorisation::TridiagFactorisation(const arma::vec &A_sub,
+                                           const arma::vec &A_diag,
+                                           const arma::vec &A_super) :
+    TridiagFactorisation()
+{
+    factorise(A_sub, A_diag, A_super);
+}
+
+/**
+ * \brief Replace the stored factorisation with that of a symmetric positive-definite matrix
+ *
+ * \param[in] A_diag Diagonal of the matrix
+ * \param[in] A_sub  Subdiagonal of the matrix
+ *
+ * \details Uses the LAPACK L*D*L**T factorisation (dpttrf)
+ */
+void TridiagFactorisation::factorise(const arma::vec &A_diag,
+                                     const arma::vec &A_sub)
+{
+    const int N = A_diag.size(); // Order of the matrix
+
+    if(A_sub.size() + 1 != A_diag.size())
+    {
+        std::ostringstream oss;
+        oss << "Size mismatch for tridiagonal elements: "
+            << "(subdiagonal = " << A_sub.size() << "; "
+            << "diagonal = " << N << ")";
+        throw std::runtime_error(oss.str());
+    }
+
+    _symmetric = true;
+
+    // LAPACK overwrites the input, so copy it into our own storage.
+    // This doesn't reallocate if the size is unchanged
+    _D  = A_diag;
+    _DL = A_sub;
+
+    int info = 0; // Return value for LAPACK
+    dpttrf_(&N, _D.memptr(), _DL.memptr(), &info);
+
+    if(info != 0)
+    {
+        std::ostringstream oss;
+        oss << "Cannot factorise matrix. (LAPACK error code: " << info << ")";
+        throw std::runtime_error(oss.str());
+    }
+}
+
+/**
+ * \brief Replace the stored factorisation with that of a general tridiagonal matrix
+ *
+ * \param[in] A_sub   Subdiagonal of the matrix
+ * \param[in] A_diag  Diagonal of the matrix
+ * \param[in] A_super Superdiagonal of the matrix
+ *
+ * \details Uses the LAPACK LU factorisation with partial pivoting (dgttrf)
+ */
+void TridiagFactorisation::factorise(const arma::vec &A_sub,
+                                     const arma::vec &A_diag,
+                                     const arma::vec &A_super)
+{
+    const int N = A_diag.size(); // Order of the matrix
+
+    if(A_sub.size() + 1 != A_diag.size() || A_super.size() + 1 != A_diag.size())
+    {
+        std::ostringstream oss;
+        oss << "Size mismatch for tridiagonal elements: "
+            << "(subdiagonal = "   << A_sub.size()   << "; "
+            << "diagonal = "       << N              << "; "
+            << "superdiagonal = "  << A_super.size() << ")";
+        throw std::runtime_error(oss.str());
+    }
+
+    _symmetric = false;
+
+    _DL = A_sub;
+    _D  = A_diag;
+    _DU = A_super;
+
+    if(_DU2.size() + 2 != A_diag.size())
+        _DU2.set_size(N > 1 ? N-2 : 0);
+
+    if(_ipiv.size() != A_diag.size())
+        _ipiv.set_size(N);
+
+    int info = 0; // Return value for LAPACK
+    dgttrf_(&N, _DL.memptr(), _D.memptr(), _DU.memptr(), _DU2.memptr(), _ipiv.memptr(), &info);
+
+    if(info != 0)
+    {
+        std::ostringstream oss;
+        oss << "Cannot factorise matrix. (LAPACK error code: " << info << ")";
+        throw std::runtime_error(oss.str());
+    }
+}
+
+/**
+ * \brief Solve a set of right-hand sides stored contiguously in column-major order
+ *
+ * \param[in,out] B    Right-hand sides, overwritten by the solutions
+ * \param[in]     NRHS Number of right-hand sides
+ */
+void TridiagFactorisation::solve_in_place(double    *B,
+                                          const int  NRHS) const
+{
+    const int N = _D.size();
+
+    if(N == 0)
+        throw std::runtime_error("Cannot solve matrix equation: matrix has not been factorised");
+
+    int info = 0;
+
+    if(_symmetric)
+        dpttrs_(&N, &NRHS, _D.memptr(), _DL.memptr(), B, &N, &info);
+    else
+    {
+        const char trans = 'N';
+        dgttrs_(&trans, &N, &NRHS, _DL.memptr(), _D.memptr(), _DU.memptr(), _DU2.memptr(),
+                _ipiv.memptr(), B, &N, &info);
+    }
+
+    if(info != 0)
+    {
+        std::ostringstream oss;
+        oss << "Cannot solve matrix equation. (LAPACK error code: " << info << ")";
+        throw std::runtime_error(oss.str());
+    }
+}
+
+/**
+ * \brief Solve Ax = b, overwriting b with the solution
+ *
+ * \param[in,out] b The right-hand side (overwritten by the solution, x)
+ */
+void TridiagFactorisation::solve_in_place(arma::vec &b) const
+{
+    if(b.size() != _D.size())
+    {
+        std::ostringstream oss;
+        oss << "Right-hand side has " << b.size() << " elements, but matrix has order " << _D.size();
+        throw std::runtime_error(oss.str());
+    }
+
+    solve_in_place(b.memptr(), 1);
+}
+
+/**
+ * \brief Solve AX = B for many right-hand sides at once, overwriting B with the solutions
+ *
+ * \param[in,out] B Matrix whose columns are the right-hand sides (overwritten by the solutions)
+ */
+void TridiagFactorisation::solve_in_place(arma::mat &B) const
+{
+    if(B.n_rows != _D.size())
+    {
+        std::ostringstream oss;
+        oss << "Right-hand sides have " << B.n_rows << " rows, but matrix has order " << _D.size();
+        throw std::runtime_error(oss.str());
+    }
+
+    if(B.n_cols > 0)
+        solve_in_place(B.memptr(), B.n_cols);
+}
+
+/**
+ * \brief Solve Ax = b
+ *
+ * \param[in] b The right-hand side
+ *
+ * \returns The solution, x
+ */
+arma::vec TridiagFactorisation::solve(const arma::vec &b) const
+{
+    arma::vec x = b;
+    solve_in_place(x);
+    return x;
+}
+
+/**
+ * \brief Create an empty factorisation
+ */
+CxTridiagFactorisation::CxTridiagFactorisation() :
+    _DL(),
+    _D(),
+    _DU(),
+    _DU2(),
+    _ipiv()
+{}
+
+/**
+ * \brief Factorise a general complex tridiagonal matrix
+ *
+ * \param[in] A_sub   Subdiagonal of the matrix
+ * \param[in] A_diag  Diagonal of the matrix
+ * \param[in] A_super Superdiagonal of the matrix
+ */
+CxTridiagFactorisation::CxTridiagFactorisation(const arma::cx_vec &A_sub,
+                                               const arma::cx_vec &A_diag,
+                                               const arma::cx_vec &A_super) :
+    CxTridiagFactorisation()
+{
+    factorise(A_sub, A_diag, A_super);
+}
+
+/**
+ * \brief Replace the stored factorisation with that of a general complex tridiagonal matrix
+ *
+ * \param[in] A_sub   Subdiagonal of the matrix
+ * \param[in] A_diag  Diagonal of the matrix
+ * \param[in] A_super Superdiagonal of the matrix
+ *
+ * \details Uses the LAPACK LU factorisation with partial pivoting (zgttrf)
+ */
+void CxTridiagFactorisation::factorise(const arma::cx_vec &A_sub,
+                                       const arma::cx_vec &A_diag,
+                                       const arma::cx_vec &A_super)
+{
+    const int N = A_diag.size(); // Order of the matrix
+
+    if(A_sub.size() + 1 != A_diag.size() || A_super.size() + 1 != A_diag.size())
+    {
+        std::ostringstream oss;
+        oss << "Size mismatch for tridiagonal elements: "
+            << "(subdiagonal = "   << A_sub.size()   << "; "
+            << "diagonal = "       << N              << "; "
+            << "superdiagonal = "  << A_super.size() << ")";
+        throw std::runtime_error(oss.str());
+    }
+
+    _DL = A_sub;
+    _D  = A_diag;
+    _DU = A_super;
+
+    if(_DU2.size() + 2 != A_diag.size())
+        _DU2.set_size(N > 1 ? N-2 : 0);
+
+    if(_ipiv.size() != A_diag.size())
+        _ipiv.set_size(N);
+
+    int info = 0; // Return value for LAPACK
+    zgttrf_(&N, _DL.memptr(), _D.memptr(), _DU.memptr(), _DU2.memptr(), _ipiv.memptr(), &info);
+
+    if(info != 0)
+    {
+        std::ostringstream oss;
+        oss << "Cannot factorise matrix. (LAPACK error code: " << info << ")";
+        throw std::runtime_error(oss.str());
+    }
+}
+
+/**
+ * \brief Solve Ax = b, overwriting b with the solution
+ *
+ * \param[in,out] b The right-hand side (overwritten by the solution, x)
+ */
+void CxTridiagFactorisation::solve_in_place(arma::cx_vec &b) const
+{
+    const int N = _D.size();
+
+    if(N == 0)
+        throw std::runtime_error("Cannot solve matrix equation: matrix has not been factorised");
+
+    if(b.size() != _D.size())
+    {
+        std::ostringstream oss;
+        oss << "Right-hand side has " << b.size() << " elements, but matrix has order " << _D.size();
+        throw std::runtime_error(oss.str());
+    }
+
+    const char trans = 'N';
+    const int  NRHS  = 1;
+    int        info  = 0;
+    zgttrs_(&trans, &N, &NRHS, _DL.memptr(), _D.memptr(), _DU.memptr(), _DU2.memptr(),
+            _ipiv.memptr(), b.memptr(), &N, &info);
+
+    if(info != 0)
+    {
+        std::ostringstream oss;
+        oss << "Cannot solve matrix equation. (LAPACK error code: " << info << ")";
+        throw std::runtime_error(oss.str());
+    }
+}
+
+/**
+ * \brief Create an empty factorisation
+ */
+CxBandFactorisation::CxBandFactorisation() :
+    _AB(),
+    _ipiv(),
+    _kl(0),
+    _ku(0)
+{}
+
+/**
+ * \brief Replace the stored factorisation with that of a general complex band matrix
+ *
+ * \param[in] AB The matrix in LAPACK band storage, with 2*kl + ku + 1 rows.  The
+ *               first kl rows are used as workspace, and the matrix itself is
+ *               stored in the remaining rows, one row for each diagonal.
+ * \param[in] kl Number of subdiagonals
+ * \param[in] ku Number of superdiagonals
+ *
+ * \details Uses the LAPACK LU factorisation with partial pivoting (zgbtrf)
+ */
+void CxBandFactorisation::factorise(const arma::cx_mat &AB,
+                                    const int           kl,
+                                    const int           ku)
+{
+    const int N    = AB.n_cols; // Order of the matrix
+    const int LDAB = AB.n_rows;
+
+    if(kl < 0 || ku < 0 || LDAB != 2*kl + ku + 1)
+    {
+        std::ostringstream oss;
+        oss << "Band storage has " << LDAB << " rows, but " << 2*kl + ku + 1
+            << " are needed for " << kl << " subdiagonals and " << ku << " superdiagonals.";
+        throw std::runtime_error(oss.str());
+    }
+
+    _AB = AB;
+    _kl = kl;
+    _ku = ku;
+
+    if(_ipiv.size() != AB.n_cols)
+        _ipiv.set_size(N);
+
+    int info = 0; // Return value for LAPACK
+    zgbtrf_(&N, &N, &_kl, &_ku, _AB.memptr(), &LDAB, _ipiv.memptr(), &info);
+
+    // A positive code means that U is exactly singular.  The factorisation is
+    // still complete, and this is expected when it is used for inverse iteration
+    // at an eigenvalue, so only an invalid argument is an error.
+    if(info < 0)
+    {
+        std::ostringstream oss;
+        oss << "Cannot factorise matrix. (LAPACK error code: " << info << ")";
+        throw std::runtime_error(oss.str());
+    }
+}
+
+/**
+ * \brief Solve Ax = b, overwriting b with the solution
+ *
+ * \param[in,out] b The right-hand side (overwritten by the solution, x)
+ */
+void CxBandFactorisation::solve_in_place(arma::cx_vec &b) const
+{
+    const int N = _AB.n_cols;
+
+    if(N == 0)
+        throw std::runtime_error("Cannot solve matrix equation: matrix has not been factorised");
+
+    if(b.size() != _AB.n_cols)
+    {
+        std::ostringstream oss;
+        oss << "Right-hand side has " << b.size() << " elements, but matrix has order " << N;
+        throw std::runtime_error(oss.str());
+    }
+
+    const char trans = 'N';
+    const int  NRHS  = 1;
+    const int  LDAB  = _AB.n_rows;
+    int        info  = 0;
+    zgbtrs_(&trans, &N, &_kl, &_ku, &NRHS, _AB.memptr(), &LDAB, _ipiv.memptr(), b.memptr(), &N, &info);
+
+    if(info != 0)
+    {
+        std::ostringstream oss;
+        oss << "Cannot solve matrix equation. (LAPACK error code: " << info << ")";
+        throw std::runtime_error(oss.str());
+    }
+}
 } // namespace
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
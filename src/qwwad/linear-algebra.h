@@ -12,6 +12,7 @@
 #endif //HAVE_CONFIG_H
 
 #include <complex>
+#include <functional>
 #include <vector>
 #include <sstream>
 #include <stdexcept>
@@ -133,12 +134,178 @@ public:
     }
 };
 
+/**
+ * \brief Sparse storage for the matrix in a linearised cubic eigenvalue problem
+ *
+ * \details The matrix has the block structure
+ *          \f[
+ *            A = \begin{pmatrix} 0 & I & 0 \\ 0 & 0 & I \\ A_{31} & A_{32} & A_{33} \end{pmatrix}
+ *          \f]
+ *          where \f$A_{31}\f$ is tridiagonal, \f$A_{32}\f$ is symmetric tridiagonal
+ *          and \f$A_{33}\f$ is diagonal.  Only the nonzero diagonals of the
+ *          bottom row of blocks are stored, so the memory needed is O(nz) rather
+ *          than O(9 nz^2) for the dense matrix.
+ */
+class CubicEVPMatrix {
+private:
+    arma::vec _A31_sub;   ///< Subdiagonal of A31
+    arma::vec _A31_diag;  ///< Diagonal of A31
+    arma::vec _A31_super; ///< Superdiagonal of A31
+    arma::vec _A32_off;   ///< Sub- and super-diagonal of A32
+    arma::vec _A32_diag;  ///< Diagonal of A32
+    arma::vec _A33_diag;  ///< Diagonal of A33
+
+public:
+    CubicEVPMatrix(const decltype(_A31_sub)   &A31_sub,
+                   const decltype(_A31_diag)  &A31_diag,
+                   const decltype(_A31_super) &A31_super,
+                   const decltype(_A32_off)   &A32_off,
+                   const decltype(_A32_diag)  &A32_diag,
+                   const decltype(_A33_diag)  &A33_diag);
+
+    /** Return the order of each block in the matrix */
+    size_t get_block_size() const {return _A31_diag.size();}
+
+    /** Return the order of the entire matrix */
+    size_t get_size() const {return 3*_A31_diag.size();}
+
+    arma::mat get_dense() const;
+
+    inline decltype(_A31_sub)   const & get_A31_sub()   const {return _A31_sub;}
+    inline decltype(_A31_diag)  const & get_A31_diag()  const {return _A31_diag;}
+    inline decltype(_A31_super) const & get_A31_super() const {return _A31_super;}
+    inline decltype(_A32_off)   const & get_A32_off()   const {return _A32_off;}
+    inline decltype(_A32_diag)  const & get_A32_diag()  const {return _A32_diag;}
+    inline decltype(_A33_diag)  const & get_A33_diag()  const {return _A33_diag;}
+};
+
+/**
+ * \brief A stored factorisation of a tridiagonal matrix
+ *
+ * \details The matrix is factorised once, and the decomposition can then be reused
+ *          to solve any number of right-hand sides without repeating the
+ *          factorisation.  Symmetric positive-definite matrices are stored as an
+ *          LDL^T decomposition and general matrices as an LU decomposition with
+ *          partial pivoting.
+ *
+ *          The in-place solvers do not allocate any memory, and refactorising a
+ *          matrix of the same size reuses the existing storage, so the object can be
+ *          kept alive across the iterations of a self-consistent or time-stepping
+ *          calculation.
+ */
+class TridiagFactorisation {
+private:
+    bool           _symmetric; ///< True if the matrix is symmetric positive-definite
+    arma::vec      _DL;        ///< Subdiagonal of L (or of the LU factorisation)
+    arma::vec      _D;         ///< Diagonal of D (or of U)
+    arma::vec      _DU;        ///< First superdiagonal of U (general matrix only)
+    arma::vec      _DU2;       ///< Second superdiagonal of U (general matrix only)
+    arma::Col<int> _ipiv;      ///< Pivot indices (general matrix only)
+
+public:
+    TridiagFactorisation();
+
+    TridiagFactorisation(const arma::vec &A_diag,
+                         const arma::vec &A_sub);
+
+    TridiagFactorisation(const arma::vec &A_sub,
+                         const arma::vec &A_diag,
+                         const arma::vec &A_super);
+
+    void factorise(const arma::vec &A_diag,
+                   const arma::vec &A_sub);
+
+    void factorise(const arma::vec &A_sub,
+                   const arma::vec &A_diag,
+                   const arma::vec &A_super);
+
+    /** Return the order of the factorised matrix */
+    size_t size() const {return _D.size();}
+
+    void solve_in_place(arma::vec &b) const;
+    void solve_in_place(arma::mat &B) const;
+
+    arma::vec solve(const arma::vec &b) const;
+
+private:
+    void solve_in_place(double    *B,
+                        const int  NRHS) const;
+};
+
+/**
+ * \brief A stored factorisation of a complex tridiagonal matrix
+ *
+ * \details This is the complex counterpart of TridiagFactorisation, for general
+ *          matrices such as the Crank-Nicolson propagator of the time-dependent
+ *          Schroedinger equation.  The matrix is stored as an LU decomposition with
+ *          partial pivoting, and refactorising a matrix of the same size reuses the
+ *          existing storage.
+ */
+class CxTridiagFactorisation {
+private:
+    arma::cx_vec   _DL;   ///< Subdiagonal of the LU factorisation
+    arma::cx_vec   _D;    ///< Diagonal of U
+    arma::cx_vec   _DU;   ///< First superdiagonal of U
+    arma::cx_vec   _DU2;  ///< Second superdiagonal of U
+    arma::Col<int> _ipiv; ///< Pivot indices
+
+public:
+    CxTridiagFactorisation();
+
+    CxTridiagFactorisation(const arma::cx_vec &A_sub,
+                           const arma::cx_vec &A_diag,
+                           const arma::cx_vec &A_super);
+
+    void factorise(const arma::cx_vec &A_sub,
+                   const arma::cx_vec &A_diag,
+                   const arma::cx_vec &A_super);
+
+    /** Return the order of the factorised matrix */
+    size_t size() const {return _D.size();}
+
+    void solve_in_place(arma::cx_vec &b) const;
+};
+
+/**
+ * \brief A stored factorisation of a complex band matrix
+ *
+ * \details The matrix is given in LAPACK band storage, with kl extra rows at the top
+ *          for the fill-in from pivoting, and is stored as an LU decomposition with
+ *          partial pivoting.  The memory needed is proportional to the order of the
+ *          matrix multiplied by its bandwidth.
+ */
+class CxBandFactorisation {
+private:
+    arma::cx_mat   _AB;   ///< LU factorisation, in LAPACK band storage
+    arma::Col<int> _ipiv; ///< Pivot indices
+    int            _kl;   ///< Number of subdiagonals
+    int            _ku;   ///< Number of superdiagonals
+
+public:
+    CxBandFactorisation();
+
+    void factorise(const arma::cx_mat &AB,
+                   const int           kl,
+                   const int           ku);
+
+    /** Return the order of the factorised matrix */
+    size_t size() const {return _AB.n_cols;}
+
+    void solve_in_place(arma::cx_vec &b) const;
+};
+
 std::vector< EVP_solution<double> >
 eigen_general(arma::mat    &A,
               const double VL,
               const double VU,
               unsigned int n_max=0);
 
+std::vector< EVP_solution<double> >
+eigen_cubic_shift_invert(const CubicEVPMatrix &A,
+                         const double          VL,
+                         const double          VU,
+                         unsigned int          n_max = 0);
+
 std::vector< EVP_solution<double> >
 eigen_banded(double       AB[],
              double       BB[],
@@ -147,6 +314,15 @@ eigen_banded(double       AB[],
              int          n,
              unsigned int n_max = 0);
 
+std::vector< EVP_solution<double> >
+eigen_tridiag_generalised(const arma::vec &A_diag,
+                          const arma::vec &A_sub,
+                          const arma::vec &B_diag,
+                          const arma::vec &B_sub,
+                          const double     VL,
+                          const double     VU,
+                          unsigned int     n_max = 0);
+
 std::vector< EVP_solution<double> >
 eigen_tridiag(arma::vec   &D,
               arma::vec   &E,
@@ -154,6 +330,69 @@ eigen_tridiag(arma::vec   &D,
               const double VU,
               unsigned int n_max = 0);
 
+EVP_solution<double>
+eigen_tridiag_single(arma::vec          &D,
+                     arma::vec          &E,
+                     const unsigned int  i);
+
+unsigned int
+count_eigen_tridiag(const arma::vec &D,
+                    const arma::vec &E,
+                    const double     x);
+
+std::vector< EVP_solution<double> >
+eigen_tridiag_refine(arma::vec                                 &D,
+                     arma::vec                                 &E,
+                     const std::vector< EVP_solution<double> > &guess,
+                     const double                               VL,
+                     const double                               VU,
+                     unsigned int                               n_max = 0);
+
+arma::vec
+eigen_hermitian_banded_values(arma::cx_mat &AB,
+                              const double  VL,
+                              const double  VU);
+
+arma::vec
+eigen_hermitian_banded_range(arma::cx_mat       &AB,
+                             const unsigned int  i_lo,
+                             const unsigned int  i_hi);
+
+arma::vec
+eigen_hermitian_range(arma::cx_mat       &A,
+                      const unsigned int  i_lo,
+                      const unsigned int  i_hi);
+
+arma::vec
+eigen_hermitian_range(arma::cx_mat       &A,
+                      const unsigned int  i_lo,
+                      const unsigned int  i_hi,
+                      arma::cx_mat       &Z);
+
+arma::vec
+eigen_hermitian_range_mixed(arma::cx_mat       &A,
+                            const unsigned int  i_lo,
+                            const unsigned int  i_hi,
+                            const double        tol,
+                            arma::cx_mat       &Z,
+                            double             &residual);
+
+arma::vec
+eigen_hermitian_lobpcg(const std::function<arma::cx_mat (const arma::cx_mat &)> &apply_A,
+                       const arma::vec                                          &A_diag,
+                       arma::cx_mat                                             &X,
+                       const unsigned int                                        n,
+                       const double                                              tol,
+                       const unsigned int                                        max_iter = 500);
+
+arma::vec
+eigen_hermitian_lobpcg(const std::function<arma::cx_mat (const arma::cx_mat &)>                    &apply_A,
+                       const std::function<arma::cx_mat (const arma::cx_mat &, const arma::vec &)> &apply_T,
+                       arma::cx_mat                                                                &X,
+                       const unsigned int                                                           n,
+                       const double                                                                 tol,
+                       const unsigned int                                                           max_iter = 500);
+
 arma::vec
 multiply_vec_tridiag(arma::vec const &M_sub,
                      arma::vec const &M_diag,
@@ -161,12 +400,40 @@ multiply_vec_tridiag(arma::vec const &M_sub,
                      arma::vec const &x,
                      arma::vec const &c);
 
+void
+multiply_vec_tridiag(arma::vec const &M_sub,
+                     arma::vec const &M_diag,
+                     arma::vec const &M_super,
+                     arma::vec const &x,
+                     arma::vec const &c,
+                     arma::vec       &y);
+
+arma::mat
+multiply_vec_tridiag_batch(arma::vec const &M_sub,
+                           arma::vec const &M_diag,
+                           arma::vec const &M_super,
+                           arma::mat const &X,
+                           arma::mat const &C);
+
 arma::vec
 solve_tridiag(arma::vec const &A_sub,
               arma::vec const &A_diag,
               arma::vec const &A_super,
               arma::vec const &x);
 
+void
+solve_tridiag(arma::vec const      &A_sub,
+              arma::vec const      &A_diag,
+              arma::vec const      &A_super,
+              arma::vec            &b,
+              TridiagFactorisation &work);
+
+void
+solve_tridiag_batch(arma::vec const &A_sub,
+                    arma::vec const &A_diag,
+                    arma::vec const &A_super,
+                    arma::mat       &B);
+
 arma::vec
 solve_tridiag_LDL_T(arma::vec const &D,
                     arma::vec const &L,
@@ -179,10 +446,24 @@ factorise_tridiag_LDL_T(arma::vec const &A_diag,
                         arma::vec       &L);
 
 arma::vec
-solve_cyclic_matrix(arma::vec A_sub,
-                    arma::vec A_diag,
-                    double    cyclic,
-                    arma::vec  b);
+solve_cyclic_matrix(const arma::vec &A_sub,
+                    const arma::vec &A_diag,
+                    const double     cyclic,
+                    const arma::vec &b);
+
+void
+solve_cyclic_matrix(const arma::vec &A_sub,
+                    const arma::vec &A_diag,
+                    const double     cyclic,
+                    arma::vec       &b,
+                    arma::vec       &F,
+                    arma::vec       &z);
+
+void
+solve_cyclic_matrix_batch(const arma::vec &A_sub,
+                          const arma::vec &A_diag,
+                          const double     cyclic,
+                          arma::mat       &B);
 
 void matrixProduct(double*      pB,
                    double*      pA,
@@ -33,23 +33,36 @@ const Glib::ustring & MaterialLibrary::get_property_unit(Glib::ustring &mat_name
     return property->get_unit();
 }
 
+/**
+ * \brief Find the name of the data file that is installed with QWWAD
+ */
+std::string MaterialLibrary::default_filename()
+{
+    std::string fname;
+    std::stringstream fname_str;
+    fname_str << QWWAD_PKGDATADIR << "/material-library.xml";
+    fname_str >> fname;
+
+    return fname;
+}
+
 /**
  * Constructor loads material data from XML file
  *
  * param[in] filename Name of input file
+ *
+ * \details Only the names of the materials are read here.  The properties of
+ *          each material are read when it is first requested.
  */
 MaterialLibrary::MaterialLibrary(const Glib::ustring &filename)
 {
     std::string fname(filename);
     // If no filename was specified, read from default data file
     if(fname == "")
-    {
-        std::stringstream fname_str;
-        fname_str << QWWAD_PKGDATADIR << "/material-library.xml";
-        fname_str >> fname;
-    }
+        fname = default_filename();
 
-    xmlpp::DomParser parser(fname, true);
+    parser.set_validate(true);
+    parser.parse_file(fname);
 
     auto doc          = parser.get_document();
     auto root_element = doc->get_root_node();
@@ -57,19 +70,26 @@ MaterialLibrary::MaterialLibrary(const Glib::ustring &filename)
     if(root_element)
     {
         // Get a list of all known materials from the XML file
-        auto material_nodes = root_element->get_children("material");
+        auto nodes = root_element->get_children("material");
 
-        // Iterate through all material nodes and add materials to the list
-        for(auto node : material_nodes)
+        // Iterate through all material nodes and index them by name
+        for(auto node : nodes)
         {
             // Check that the node is really an element
             auto elem = dynamic_cast<xmlpp::Element *>(node);
 
             if(elem)
             {
-                // Add the material to the list
+                // Add the material to the index.  If a name appears more
+                // than once, the first definition is used
                 auto name = elem->get_attribute_value("name");
-                materials.insert(name, new Material(elem));
+
+                if(materials.find(name) == materials.end())
+                {
+                    std::unique_ptr<Entry> entry(new Entry);
+                    entry->node = elem;
+                    materials.insert(std::make_pair(name, std::move(entry)));
+                }
             }
         }
     }
@@ -86,24 +106,31 @@ MaterialLibrary::MaterialLibrary(const Glib::ustring &filename)
  *
  * \return The material from the library
  *
- * \throws boost::bad_ptr_container_operation if the material could not be found
+ * \details The material is read from the XML tree the first time it is requested.
+ *          This is safe to call from several threads at once.  If two threads
+ *          request a new material together, one reads it while the other waits.
+ *
+ * \throws std::runtime_error if the material could not be found
  */
 Material const * MaterialLibrary::get_material(const Glib::ustring &mat_name) const
 {
-    Material const * mat;
+    auto it = materials.find(mat_name);
 
-    try
-    {
-        mat = &materials.at(mat_name);
-    }
-    catch(std::exception &e)
+    if(it == materials.end())
     {
         std::ostringstream oss;
         oss << "Could not find material: " << mat_name << " in the material library" << std::endl;
         throw std::runtime_error(oss.str());
     }
 
-    return mat;
+    auto &entry = *it->second;
+
+    std::call_once(entry.loaded, [&]() {
+        std::lock_guard<std::mutex> lock(xml_mutex);
+        entry.material.reset(new Material(entry.node));
+    });
+
+    return entry.material.get();
 }
 
 /**
@@ -117,13 +144,13 @@ Material const * MaterialLibrary::get_material(const Glib::ustring &mat_name) co
 MaterialProperty const * MaterialLibrary::get_property(Glib::ustring &mat_name,
                                                        Glib::ustring &property_name) const
 {
-    return materials.at(mat_name).get_property(property_name);
+    return get_material(mat_name)->get_property(property_name);
 }
 
 double MaterialLibrary::get_val(Glib::ustring &mat_name,
                                 Glib::ustring &property_name)
 {
-    const auto property = materials.at(mat_name).get_property(property_name);
+    const auto property = get_material(mat_name)->get_property(property_name);
     const auto numeric_property = dynamic_cast<MaterialPropertyNumeric const *>(property);
 
     return numeric_property->get_val();
@@ -136,8 +163,8 @@ double MaterialLibrary::get_val(Glib::ustring &mat_name,
  */
 Material const * MaterialLibrary::get_material(const char  *mat_name) const
 {
-    std::string str(mat_name);
-    return &materials.at(str);
+    Glib::ustring str(mat_name);
+    return get_material(str);
 }
 }
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
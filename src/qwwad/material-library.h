@@ -14,7 +14,9 @@
 #ifndef MATERIAL_LIBRARY_H
 #define MATERIAL_LIBRARY_H
 
-#include <boost/ptr_container/ptr_map.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <libxml++/libxml++.h>
 
 namespace Glib {
@@ -25,7 +27,20 @@ namespace QWWAD {
 class Material;
 class MaterialProperty;
 
-/** Library of material data */
+/**
+ * \brief Library of material data
+ *
+ * \details The XML file is parsed once when the library is created, but each
+ *          material's properties are only read from the XML tree the first time
+ *          it is requested.  Most programs only use a few of the materials, so
+ *          this avoids building objects for the whole library at startup.
+ *
+ *          A library may be shared between threads.  The index of materials
+ *          is fixed once the library has been created, and each material is
+ *          read exactly once, so lookups need no locking once a material has
+ *          been loaded.  Materials and their properties are never changed after
+ *          they are read, so the returned objects may also be used from any thread.
+ */
 class MaterialLibrary {
 public:
     MaterialLibrary(const Glib::ustring &filename);
@@ -42,7 +57,23 @@ public:
     const Glib::ustring & get_property_unit(Glib::ustring &mat_name,
                                             Glib::ustring &property_name);
 private:
-    boost::ptr_map<Glib::ustring, Material>  materials;
+    static std::string default_filename();
+
+    xmlpp::DomParser parser; ///< Parser that owns the XML tree
+
+    /// A material in the library, which is read from the XML tree on first use
+    struct Entry
+    {
+        xmlpp::Element            *node;     ///< XML element for the material
+        std::once_flag             loaded;   ///< Marks that the material has been read
+        std::unique_ptr<Material>  material; ///< The material, once it has been read
+    };
+
+    /// Every material in the library.  This is not changed after the library is created.
+    std::map<Glib::ustring, std::unique_ptr<Entry> > materials;
+
+    /// Serialises reading from the XML tree, which is not safe for concurrent use
+    mutable std::mutex xml_mutex;
 };
 } // end namespace
 #endif //MATERIAL_LIBRARY_H
@@ -77,5 +77,15 @@ MaterialPropertyConstant::get_val(const double /* x */) const
 {
     return _constant;
 }
+
+/**
+ * \return The constant value at every point in the input array
+ */
+arma::vec MaterialPropertyConstant::get_val(const arma::vec &x) const
+{
+    arma::vec y(x.size());
+    y.fill(_constant);
+    return y;
+}
 } // end namespace
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -20,6 +20,7 @@ public:
     virtual MaterialPropertyConstant * clone() const;
 
     decltype(_constant) get_val(const double x = 0) const;
+    arma::vec get_val(const arma::vec &x) const;
 };
 } // end namespace
 #endif
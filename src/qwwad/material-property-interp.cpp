@@ -123,6 +123,33 @@ MaterialPropertyInterp::get_val(const double x) const
     return lin_interp(_y0, _y1, x, _b);
 }
 
+/**
+ * Find the value of the property for a set of input values
+ *
+ * \param[in] x The input variable at each point
+ *
+ * \details The range of the whole array is checked once, and the interpolation
+ *          is then found in a single pass.
+ */
+arma::vec MaterialPropertyInterp::get_val(const arma::vec &x) const
+{
+    if(x.empty())
+        return arma::vec();
+
+    const double x_lo = x.min();
+    const double x_hi = x.max();
+
+    if (x_lo < _xmin or x_hi > _xmax or x_lo < 0 or x_hi > 1)
+    {
+        const double x_bad = (x_lo < _xmin or x_lo < 0) ? x_lo : x_hi;
+        std::ostringstream oss;
+        oss << "x-value " << x_bad << " is outside the permitted range (" << _xmin << "," << _xmax << ") for property " << _name << std::endl;
+        throw std::domain_error(oss.str());
+    }
+
+    return _y0*(1.0-x) + _y1*x + _b*x%(1.0-x);
+}
+
 /**
  * Set the validity limits for the interpolation
  *
@@ -48,6 +48,7 @@ public:
     inline decltype(_y1) get_interp_y1() const {return _y1;}
     inline decltype(_b)  get_interp_b()  const {return _b;}
     decltype(_y0) get_val(const double x = 0) const;
+    arma::vec get_val(const arma::vec &x) const;
 };
 } // end namespace
 #endif
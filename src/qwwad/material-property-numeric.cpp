@@ -40,6 +40,26 @@ MaterialPropertyNumeric::MaterialPropertyNumeric(decltype(_name)        name,
     _unit(unit)
 {}
 
+/**
+ * Find the value of the property for a set of input values
+ *
+ * \param[in] x The input variable (e.g., alloy fraction) at each point
+ *
+ * \return The value of the property at each point
+ *
+ * \details This evaluates each point in turn.  Derived classes override it
+ *          with a single pass over the whole array.
+ */
+arma::vec MaterialPropertyNumeric::get_val(const arma::vec &x) const
+{
+    arma::vec y(x.size());
+
+    for(unsigned int i = 0; i < x.size(); ++i)
+        y[i] = get_val(x[i]);
+
+    return y;
+}
+
 /// Return the unit for the property
 const decltype(MaterialPropertyNumeric::_unit) &
 MaterialPropertyNumeric::get_unit() const
@@ -1,6 +1,7 @@
 #ifndef QWWAD_MATERIAL_PROPERTY_NUMERIC_H
 #define QWWAD_MATERIAL_PROPERTY_NUMERIC_H
 
+#include <armadillo>
 #include "material-property.h"
 
 namespace QWWAD {
@@ -9,6 +10,8 @@ namespace QWWAD {
  *
  * \details The numerical value may be obtained using the get_val() function.
  *          The relevant unit for the property may be obtained using get_unit().
+ *          An entire profile, e.g., of alloy fraction at every point in a
+ *          structure, may be evaluated at once by passing an array to get_val().
  */
 class MaterialPropertyNumeric : public MaterialProperty {
 protected:
@@ -25,6 +28,8 @@ public:
     const decltype(_unit) & get_unit() const;
 
     virtual double get_val(const double x = 0) const = 0;
+
+    virtual arma::vec get_val(const arma::vec &x) const;
 };
 } // end namespace
 #endif
@@ -100,5 +100,40 @@ double MaterialPropertyPoly::get_val(const double x) const
 
     return val;
 }
+
+/**
+ * Find the value of the property for a set of input values
+ *
+ * \param[in] x The input variable at each point
+ *
+ * \details Each term of the polynomial is added for the whole array at once.
+ *          Successive powers of x are found by repeated multiplication.
+ */
+arma::vec MaterialPropertyPoly::get_val(const arma::vec &x) const
+{
+    arma::vec val  = arma::zeros(x.size()); // Output value
+    arma::vec x_pow = arma::ones(x.size()); // Power of x for the current term
+    int       i_pow = 0;
+
+    for(auto term : _poly_coeffs)
+    {
+        const auto  i = term.first;
+        const auto ai = term.second;
+
+        if(i < 0)
+        {
+            val += ai * pow(x, i);
+            continue;
+        }
+
+        // The map is sorted, so powers only ever need raising
+        for(; i_pow < i; ++i_pow)
+            x_pow %= x;
+
+        val += ai * x_pow;
+    }
+
+    return val;
+}
 } // end namespace
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -19,6 +19,7 @@ public:
     virtual MaterialPropertyPoly * clone() const;
 
     double get_val(const double x = 0) const;
+    arma::vec get_val(const arma::vec &x) const;
 };
 } // end namespace
 #endif
@@ -3,6 +3,7 @@
  * \brief  Class to describe a material
  * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
  */
+#include <sstream>
 #include <stdexcept>
 #include "material.h"
 #include "material-property-interp.h"
@@ -79,6 +80,22 @@ Material::Material(xmlpp::Element *elem)
         throw std::runtime_error("Invalid XML element");
 }
 
+bool Material::has_property(const char *name) const
+{
+    Glib::ustring prop_name(name);
+    return has_property(prop_name);
+}
+
+/**
+ * Check whether the material has a given property
+ *
+ * \param[in] property_name Name of the property
+ */
+bool Material::has_property(const Glib::ustring &property_name) const
+{
+    return properties.find(property_name) != properties.end();
+}
+
 MaterialProperty const * Material::get_property(const char *name) const
 {
     Glib::ustring prop_name(name);
@@ -116,9 +133,28 @@ MaterialPropertyNumeric const * Material::get_numeric_property(const char *name)
     return get_numeric_property(prop_name);
 }
 
+/**
+ * Get a numerical property
+ *
+ * \param[in] name Name of the property
+ *
+ * \return The property object
+ *
+ * \details The returned object stays valid for the lifetime of the material, so it
+ *          can be looked up once and then evaluated repeatedly using get_val()
+ *          without searching for the property by name each time.
+ */
 MaterialPropertyNumeric const * Material::get_numeric_property(Glib::ustring &name) const
 {
     auto prop = dynamic_cast<MaterialPropertyNumeric const *>(get_property(name));
+
+    if(!prop)
+    {
+        std::ostringstream oss;
+        oss << "Property " << name << " in material " << this->name << " is not numeric" << std::endl;
+        throw std::runtime_error(oss.str());
+    }
+
     return prop;
 }
 
@@ -138,5 +174,23 @@ double Material::get_property_value(Glib::ustring &name,
     auto prop = get_numeric_property(name);
     return prop->get_val(x);
 }
+arma::vec Material::get_property_value(const char      *name,
+                                       const arma::vec &x) const
+{
+    Glib::ustring prop_name(name);
+    return get_property_value(prop_name, x);
+}
+
+/**
+ * Get the value of a numerical property for a set of input values
+ *
+ * \details The property is looked up once and evaluated for the whole array
+ */
+arma::vec Material::get_property_value(Glib::ustring   &name,
+                                       const arma::vec &x) const
+{
+    auto prop = get_numeric_property(name);
+    return prop->get_val(x);
+}
 } // end namespace
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
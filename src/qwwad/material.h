@@ -1,6 +1,7 @@
 #ifndef QWWAD_MATERIAL
 #define QWWAD_MATERIAL
 
+#include <armadillo>
 #include <boost/ptr_container/ptr_map.hpp>
 #include <libxml++/libxml++.h>
 
@@ -25,6 +26,9 @@ public:
     const Glib::ustring & get_name() const;
     const Glib::ustring & get_description() const;
 
+    bool has_property(const char          *property_name) const;
+    bool has_property(const Glib::ustring &property_name) const;
+
     MaterialProperty const * get_property(const char          *property_name) const;
     MaterialProperty const * get_property(const Glib::ustring &property_name) const;
 
@@ -37,6 +41,12 @@ public:
     double get_property_value(Glib::ustring &property_name,
                               const double   x = 0) const;
 
+    arma::vec get_property_value(const char      *property_name,
+                                 const arma::vec &x) const;
+
+    arma::vec get_property_value(Glib::ustring   &property_name,
+                                 const arma::vec &x) const;
+
 private:
     /// Cached set of material properties
     boost::ptr_map<Glib::ustring, MaterialProperty> properties;
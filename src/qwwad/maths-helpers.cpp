@@ -6,6 +6,13 @@
 
 #include "maths-helpers.h"
 
+#include <algorithm>
+#include <complex>
+#include <queue>
+#include <vector>
+
+#include <gsl/gsl_fft_complex.h>
+
 namespace QWWAD
 {
 /**
@@ -121,5 +128,391 @@ double sf_brillouin(const double J,
     const auto y = tJp1_tJ * coth(tJp1_tJ * x) - 1.0/tJ*coth(x/tJ);
     return y;
 }
+
+/**
+ * \brief      Find the quadrature weights used by integral(y, dx)
+ *
+ * \param[in]  n  Number of samples
+ * \param[in]  dx Spatial step between samples
+ *
+ * \details    The integral of any set of samples y is then approximately
+ *              dot(w, y).  This is useful when many integrals are needed with the
+ *              same sampling, as the weights can be folded into one of the factors
+ *              in the integrand in advance.
+ *
+ * \returns    Simpson's rule weights if n is odd, and >= 3.  Trapezium rule weights
+ *              otherwise.
+ */
+arma::vec integral_weights(const size_t n,
+                           const double dx)
+{
+    if(n < 2)
+        throw std::runtime_error("Need at least two points for integration");
+
+    arma::vec w(n);
+
+    if(n >= 3 and GSL_IS_ODD(n))
+    {
+        for(unsigned int j = 0; j < n; ++j)
+            w[j] = (j == 0 or j == n-1) ? 1.0 : (GSL_IS_ODD(j) ? 4.0 : 2.0);
+
+        w *= dx/3.0;
+    }
+    else
+    {
+        w.fill(dx);
+        w[0]   *= 0.5;
+        w[n-1] *= 0.5;
+    }
+
+    return w;
+}
+
+/**
+ * \brief      Stop a calculation that needs evenly spaced samples
+ *
+ * \param[in]  x    Locations of the samples
+ * \param[in]  user Name of the calculation, used in the error message
+ *
+ * \details    Some calculations use the spacing of the first two samples
+ *              throughout, so they would give wrong results on a graded mesh,
+ *              rather than failing.
+ */
+void check_uniform_mesh(const arma::vec   &x,
+                        const std::string &user)
+{
+    if(!is_uniform_mesh(x))
+    {
+        std::ostringstream oss;
+        oss << user << " only works with a uniform spatial mesh, but the samples are not "
+            << "evenly spaced.  Generate the mesh without --dzmaxbulk or --adaptive.";
+        throw std::runtime_error(oss.str());
+    }
+}
+
+/**
+ * \brief      Find the quadrature weights used by integral(y, x)
+ *
+ * \param[in]  x Locations of the samples
+ *
+ * \returns    The weights for integral(y, dx) if the samples are evenly spaced.
+ *              Trapezium rule weights for each interval otherwise.
+ */
+arma::vec integral_weights(const arma::vec &x)
+{
+    const size_t n = x.size();
+
+    if(n < 2)
+        throw std::runtime_error("Need at least two points for integration");
+
+    if(is_uniform_mesh(x))
+        return integral_weights(n, x[1] - x[0]);
+
+    arma::vec w(n, arma::fill::zeros);
+
+    for(unsigned int j = 0; j < n-1; ++j)
+    {
+        const double half_dx = 0.5*(x[j+1] - x[j]);
+        w[j]   += half_dx;
+        w[j+1] += half_dx;
+    }
+
+    return w;
+}
+
+/**
+ * \brief      Find the smallest power of two that is not less than n
+ */
+size_t next_pow2(const size_t n)
+{
+    size_t L = 1;
+
+    while(L < n)
+        L <<= 1;
+
+    return L;
+}
+
+/**
+ * \brief      Extrapolate a sequence of results to zero step size
+ *
+ * \param[in]  f_h   Result with step size h
+ * \param[in]  f_h2  Result with step size h/2
+ * \param[in]  f_h4  Result with step size h/4
+ * \param[out] error Estimated error in the extrapolated result
+ * \param[out] order Observed order of convergence
+ *
+ * \details    The error is assumed to scale as \f$h^p\f$.  The order p is found from
+ *              the ratio of successive differences,
+ *              \f[
+ *                p = \log_2\frac{f_h - f_{h/2}}{f_{h/2} - f_{h/4}},
+ *              \f]
+ *              and the result is extrapolated as
+ *              \f$f_{h/4} + (f_{h/4} - f_{h/2})/(2^p - 1)\f$.  If the differences do
+ *              not shrink monotonically (e.g., when the results have already
+ *              converged to rounding error), second-order convergence is assumed.
+ *
+ * \returns    The extrapolated result
+ */
+double richardson_extrapolate(const double  f_h,
+                              const double  f_h2,
+                              const double  f_h4,
+                              double       &error,
+                              double       &order)
+{
+    const double d1 = f_h  - f_h2;
+    const double d2 = f_h2 - f_h4;
+
+    order = 2.0;
+
+    if(d1 != 0.0 && d2 != 0.0 && d1/d2 > 1.0)
+        order = log2(d1/d2);
+
+    const double f = f_h4 + (f_h4 - f_h2)/(pow(2.0, order) - 1.0);
+    error = fabs(f - f_h4);
+
+    return f;
+}
+
+/**
+ * \brief      Find the discrete linear convolution of two sequences
+ *
+ * \param[in]  a First sequence
+ * \param[in]  b Second sequence
+ *
+ * \details    The result,
+ *              \f[
+ *                c_m = \sum_j a_j b_{m-j},
+ *              \f]
+ *              is found for every \f$m = 0 \ldots n_a+n_b-2\f$ using zero-padded
+ *              radix-2 FFTs, giving a cost of O[(n_a+n_b) log(n_a+n_b)] rather than
+ *              O(n_a n_b) for direct evaluation.
+ *
+ * \returns    The convolution, with \f$n_a+n_b-1\f$ samples
+ */
+arma::vec convolve_fft(const arma::vec &a,
+                       const arma::vec &b)
+{
+    if(a.size() == 0 || b.size() == 0)
+        return arma::vec();
+
+    const size_t n = a.size() + b.size() - 1;
+    const size_t L = next_pow2(n);
+
+    std::vector<std::complex<double>> u(L, 0.0);
+    std::vector<std::complex<double>> v(L, 0.0);
+
+    for(size_t j = 0; j < a.size(); ++j)
+        u[j] = a[j];
+
+    for(size_t j = 0; j < b.size(); ++j)
+        v[j] = b[j];
+
+    // std::complex<double> is layout-compatible with GSL's packed complex arrays
+    auto u_packed = reinterpret_cast<double *>(u.data());
+    auto v_packed = reinterpret_cast<double *>(v.data());
+
+    gsl_fft_complex_radix2_forward(u_packed, 1, L);
+    gsl_fft_complex_radix2_forward(v_packed, 1, L);
+
+    for(size_t i = 0; i < L; ++i)
+        u[i] *= v[i];
+
+    gsl_fft_complex_radix2_inverse(u_packed, 1, L);
+
+    arma::vec c(n);
+
+    for(size_t m = 0; m < n; ++m)
+        c[m] = u[m].real();
+
+    return c;
+}
+
+/**
+ * \brief      Compute a Fourier integral of uniformly-sampled data on a grid of wavevectors
+ *
+ * \param[in]  y  Samples of the function to be transformed
+ * \param[in]  x0 Position of the first sample
+ * \param[in]  dx Spatial step between samples
+ * \param[in]  dk Spacing between wavevectors
+ * \param[in]  nk Number of wavevectors
+ *
+ * \details    The integral
+ *              \f[
+ *                F(k_m) = \int y(x) \mathrm{e}^{\mathrm{i}k_m x}\,\mathrm{d}x
+ *              \f]
+ *              is found for every \f$k_m = m\,\delta k\f$, \f$m = 0 \ldots n_k-1\f$,
+ *              using the same quadrature rule as integral(y, dx).  The wavevector
+ *              spacing is not tied to the FFT bin width \f$2\pi/(n\,\delta x)\f$, so the
+ *              sum is evaluated as a chirp-z transform (Bluestein's algorithm) using
+ *              \f$m j = [m^2 + j^2 - (m-j)^2]/2\f$.  This turns the sum into a
+ *              convolution that is computed by zero-padded radix-2 FFTs, giving a cost of
+ *              O[(n+n_k) log(n+n_k)] rather than O(n n_k) for direct evaluation.
+ *
+ * \returns    The integral at each wavevector
+ */
+arma::cx_vec fourier_integral(const arma::vec &y,
+                              const double     x0,
+                              const double     dx,
+                              const double     dk,
+                              const size_t     nk)
+{
+    const size_t n = y.size();
+
+    if(n < 2)
+        throw std::runtime_error("Need at least two points for Fourier integral");
+
+    // Quadrature weights matching integral(y, dx)
+    const auto w = integral_weights(n, dx);
+
+    arma::cx_vec F(nk);
+
+    if(nk == 0)
+        return F;
+
+    const double theta = dk*dx; // Phase step between samples per wavevector step
+    const size_t L     = next_pow2(n + nk - 1);
+
+    // Chirp exp(-i theta k^2/2) for every lag in the convolution
+    auto chirp = [theta](const size_t k) -> std::complex<double> {
+        const double phase = -0.5*theta*static_cast<double>(k)*static_cast<double>(k);
+        return std::complex<double>(cos(phase), sin(phase));
+    };
+
+    std::vector<std::complex<double>> u(L, 0.0);
+    std::vector<std::complex<double>> v(L, 0.0);
+
+    for(size_t j = 0; j < n; ++j)
+        u[j] = w[j]*y[j]*std::conj(chirp(j));
+
+    for(size_t k = 0; k < nk; ++k)
+        v[k] = chirp(k);
+
+    for(size_t k = 1; k < n; ++k)
+        v[L-k] = chirp(k);
+
+    // std::complex<double> is layout-compatible with GSL's packed complex arrays
+    auto u_packed = reinterpret_cast<double *>(u.data());
+    auto v_packed = reinterpret_cast<double *>(v.data());
+
+    gsl_fft_complex_radix2_forward(u_packed, 1, L);
+    gsl_fft_complex_radix2_forward(v_packed, 1, L);
+
+    for(size_t i = 0; i < L; ++i)
+        u[i] *= v[i];
+
+    gsl_fft_complex_radix2_inverse(u_packed, 1, L);
+
+    for(size_t m = 0; m < nk; ++m)
+    {
+        const double km = m*dk;
+        F[m] = u[m] * std::conj(chirp(m)) * std::polar(1.0, km*x0);
+    }
+
+    return F;
+}
+/**
+ * \brief Find a subset of the points on a curve that represents it to within a tolerance
+ *
+ * \param[in] x          Sample locations
+ * \param[in] y          Value at each sample
+ * \param[in] tol        Largest permitted error in y, between the curve and the
+ *                       straight lines joining the points that are kept
+ * \param[in] max_points Largest number of points to keep (0 means no limit).
+ *                       At least the two end points are kept.
+ *
+ * \returns The indices of the points to keep, in ascending order
+ *
+ * \details This uses the Douglas-Peucker method, with the error measured in y
+ *          rather than perpendicular to the line, so that x and y may have
+ *          different units.  Each segment is split at its worst point, and the
+ *          worst segment in the whole curve is always split first.  Stopping at
+ *          the point budget therefore keeps the most prominent features, such as
+ *          the maxima and minima of the curve, and gives the smallest error
+ *          possible for that budget using this method.
+ */
+arma::uvec decimate_curve(const arma::vec &x,
+                          const arma::vec &y,
+                          const double     tol,
+                          const size_t     max_points)
+{
+    const size_t n = x.size();
+
+    if(y.size() != n)
+    {
+        std::ostringstream oss;
+        oss << "Cannot decimate a curve with " << n << " locations and " << y.size() << " values.";
+        throw std::length_error(oss.str());
+    }
+
+    if(n <= 2)
+        return arma::linspace<arma::uvec>(0, n-1, n);
+
+    // A segment between two kept points, with its worst interior point
+    struct Segment
+    {
+        size_t first;
+        size_t last;
+        size_t worst;
+        double error;
+
+        bool operator<(const Segment &other) const {return error < other.error;}
+    };
+
+    auto make_segment = [&](const size_t first, const size_t last) {
+        Segment seg = {first, last, first, 0.0};
+        const double slope = (y[last] - y[first])/(x[last] - x[first]);
+
+        for(size_t i = first + 1; i < last; ++i)
+        {
+            const double err = std::abs(y[i] - (y[first] + slope*(x[i] - x[first])));
+
+            if(err > seg.error)
+            {
+                seg.error = err;
+                seg.worst = i;
+            }
+        }
+
+        return seg;
+    };
+
+    std::vector<char>           keep(n, 0);
+    std::priority_queue<Segment> segments;
+    size_t                      n_kept = 2;
+
+    keep[0]   = 1;
+    keep[n-1] = 1;
+    segments.push(make_segment(0, n-1));
+
+    while(!segments.empty() && (max_points == 0 || n_kept < max_points))
+    {
+        const Segment seg = segments.top();
+
+        if(seg.error <= tol)
+            break;
+
+        segments.pop();
+        keep[seg.worst] = 1;
+        ++n_kept;
+
+        if(seg.worst - seg.first > 1)
+            segments.push(make_segment(seg.first, seg.worst));
+
+        if(seg.last - seg.worst > 1)
+            segments.push(make_segment(seg.worst, seg.last));
+    }
+
+    arma::uvec indices(n_kept);
+    size_t     ikept = 0;
+
+    for(size_t i = 0; i < n; ++i)
+    {
+        if(keep[i])
+            indices[ikept++] = i;
+    }
+
+    return indices;
+}
 } // namespace
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -7,9 +7,11 @@
 #ifndef QWWAD_MATHS_HELPERS_H
 #define QWWAD_MATHS_HELPERS_H
 
+#include <cmath>
 #include <cstddef>
 #include <stdexcept>
 #include <sstream>
+#include <string>
 
 #include <gsl/gsl_math.h>
 
@@ -17,6 +19,32 @@
 
 namespace QWWAD
 {
+/**
+ * \brief Check whether a set of samples is evenly spaced
+ *
+ * \param[in] x   Locations of the samples
+ * \param[in] tol Maximum relative deviation of any spacing from the first one
+ */
+template <class real_type>
+bool is_uniform_mesh(const arma::Col<real_type>& x, const double tol = 1e-6)
+{
+    if(x.size() < 3)
+        return true;
+
+    const real_type dx = x[1] - x[0];
+
+    for(unsigned int i=2; i<x.size(); i++)
+    {
+        if(fabs((x[i] - x[i-1]) - dx) > tol*fabs(dx))
+            return false;
+    }
+
+    return true;
+}
+
+void check_uniform_mesh(const arma::vec   &x,
+                        const std::string &user);
+
 /**
  * \brief Integrate using Simpson's rule
  *
@@ -109,6 +137,44 @@ complex_type integral(const arma::Col<complex_type>& y, const real_type dx)
         return trapz(y, dx);
 }
 
+/**
+ * \brief Compute a numerical integral over a (possibly) nonuniform set of samples
+ *
+ * \param[in] y Samples of the function to be integrated
+ * \param[in] x Locations of the samples
+ *
+ * \details If the samples are evenly spaced, this is identical to calling
+ *          integral(y, dx).  Otherwise, the trapezium rule is applied to each
+ *          interval between samples separately.
+ */
+template <class complex_type, class real_type>
+complex_type integral(const arma::Col<complex_type>& y, const arma::Col<real_type>& x)
+{
+    const size_t n = y.size();
+
+    if(n < 2)
+        throw std::runtime_error("Need at least two points for numerical integration.");
+
+    if(x.size() != n)
+    {
+        std::ostringstream oss;
+        oss << "Cannot integrate " << n << " samples over a grid of " << x.size() << " points.";
+        throw std::length_error(oss.str());
+    }
+
+    const real_type dx = x[1] - x[0];
+
+    if(is_uniform_mesh(x))
+        return integral(y, dx);
+
+    complex_type ans=0;
+
+    for(unsigned int i=0; i<n-1; i++)
+        ans += (y[i] + y[i+1])*((x[i+1] - x[i])/2.0);
+
+    return ans;
+}
+
 double lookup_y_from_x(const arma::vec &x_values,
                        const arma::vec &y_values,
                        const double     x0);
@@ -126,6 +192,33 @@ unsigned int Theta(const double x);
 
 double sf_brillouin(const double J,
                     const double x);
+
+arma::vec integral_weights(const size_t n,
+                           const double dx);
+
+arma::vec integral_weights(const arma::vec &x);
+
+size_t next_pow2(const size_t n);
+
+arma::vec convolve_fft(const arma::vec &a,
+                       const arma::vec &b);
+
+double richardson_extrapolate(const double  f_h,
+                              const double  f_h2,
+                              const double  f_h4,
+                              double       &error,
+                              double       &order);
+
+arma::cx_vec fourier_integral(const arma::vec &y,
+                              const double     x0,
+                              const double     dx,
+                              const double     dk,
+                              const size_t     nk);
+
+arma::uvec decimate_curve(const arma::vec &x,
+                          const arma::vec &y,
+                          const double     tol,
+                          const size_t     max_points = 0);
 } // namespace
 #endif
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
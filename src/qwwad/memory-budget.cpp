@@ -0,0 +1,87 @@
+/**
+ * \file   memory-budget.cpp
+ * \brief  Estimates of memory use, and a limit on the memory used by large calculations
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "memory-budget.h"
+
+#include <atomic>
+#include <sstream>
+#include <stdexcept>
+
+#include "profiler.h"
+
+namespace QWWAD
+{
+/// Largest amount of memory that a single calculation may use [bytes] (0 = no limit)
+static std::atomic<size_t> memory_limit(0);
+
+/**
+ * \brief Set the largest amount of memory that a single calculation may use
+ *
+ * \param[in] bytes The limit [bytes].  If zero, there is no limit.
+ *
+ * \details This is normally set by the \c --maxmemory option, which is common
+ *          to all programs.
+ */
+void set_memory_limit(const size_t bytes)
+{
+    memory_limit = bytes;
+}
+
+/**
+ * \brief Get the largest amount of memory that a single calculation may use
+ *
+ * \returns The limit [bytes], or zero if there is no limit
+ */
+size_t get_memory_limit()
+{
+    return memory_limit;
+}
+
+/**
+ * \brief Check whether a calculation fits within the memory limit
+ *
+ * \param[in] what  A short description of the calculation, e.g., "dense Hamiltonian"
+ * \param[in] bytes The estimated peak memory use of the calculation [bytes]
+ *
+ * \returns True if the calculation fits within the limit.  If not, the caller
+ *          should switch to a leaner algorithm if there is one.
+ *
+ * \details Each estimate is included in the profiling summary, so that it can
+ *          be compared with the real memory use.
+ */
+bool fits_in_memory(const char   *what,
+                    const size_t  bytes)
+{
+    if(Profiler::is_enabled())
+        Profiler::add_memory(what, bytes);
+
+    const size_t limit = memory_limit;
+    return limit == 0 || bytes <= limit;
+}
+
+/**
+ * \brief Stop if a calculation doesn't fit within the memory limit
+ *
+ * \param[in] what  A short description of the calculation, e.g., "dense Hamiltonian"
+ * \param[in] bytes The estimated peak memory use of the calculation [bytes]
+ *
+ * \details This should be called before any of the memory is allocated, so that
+ *          the program fails straight away rather than after a long calculation.
+ */
+void check_memory(const char   *what,
+                  const size_t  bytes)
+{
+    if(!fits_in_memory(what, bytes))
+    {
+        std::ostringstream oss;
+        oss << "The " << what << " needs an estimated " << bytes/(1024*1024)
+            << " MiB of memory, which is more than the limit of "
+            << memory_limit/(1024*1024) << " MiB.";
+        throw std::runtime_error(oss.str());
+    }
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,24 @@
+/**
+ * \file   memory-budget.h
+ * \brief  Estimates of memory use, and a limit on the memory used by large calculations
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_MEMORY_BUDGET_H
+#define QWWAD_MEMORY_BUDGET_H
+
+#include <cstddef>
+
+namespace QWWAD
+{
+void   set_memory_limit(const size_t bytes);
+size_t get_memory_limit();
+
+bool fits_in_memory(const char   *what,
+                    const size_t  bytes);
+
+void check_memory(const char   *what,
+                  const size_t  bytes);
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -7,14 +7,19 @@
 
 #include "mesh.h"
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 
+#include <gsl/gsl_math.h>
+
 #ifdef DEBUG
 # include <iostream>
 #endif
 
 #include "data-checker.h"
 #include "file-io.h"
+#include "profiler.h"
 
 namespace QWWAD
 {
@@ -36,18 +41,20 @@ Mesh::Mesh(const decltype(_x_layer)    &x_layer,
     _x_layer(x_layer),
     _W_layer(W_layer),
     _n3D_layer(n3D_layer),
+    _layer_top_1per(arma::cumsum(_W_layer)),
     _n_periods(n_periods),
     _ncell_1per(ncell_1per),
-    _layer_top_index(_x_layer.size() * n_periods),
-    _z(_ncell_1per*_n_periods),
-    _x(_z.size(), std::valarray<double>(_n_alloy)),
-    _n3D(_z.size()),
+    _layer_top_index_1per(_x_layer.size()),
+    _layer_index_1per(_ncell_1per),
+    _z_1per(_ncell_1per),
+    _x_1per(_ncell_1per, std::valarray<double>(_n_alloy)),
+    _n3D_1per(_ncell_1per),
     _Lp(sum(_W_layer)),
-    _dz(_Lp/_ncell_1per)
+    _dz(_Lp/_ncell_1per),
+    _uniform(true),
+    _dz_1per(_dz*arma::ones(_ncell_1per)),
+    _cell_top_1per(arma::cumsum(_dz_1per))
 {
-    const auto n_layer_1per = _W_layer.size(); // Number of layers in one period
-    const auto n_layer      = n_layer_1per * _n_periods; // Total number of layers in system
-
     // Check that no layer is thinner than dz and throw an error if it is
     if (_W_layer.min() < _dz)
     {
@@ -56,30 +63,283 @@ Mesh::Mesh(const decltype(_x_layer)    &x_layer,
         throw std::runtime_error(oss.str());
     }
 
+    fill_cells();
+}
+
+/**
+ * \brief Create a Mesh with a specified width for each cell
+ *
+ * \param[in] x_layer    Alloy fractions in each layer
+ * \param[in] W_layer    Thickness of each layer [m]
+ * \param[in] n3D_layer  Volume doping in each layer [m^{-3}]
+ * \param[in] dz_1per    Width of each cell in one period [m]
+ * \param[in] n_periods  Number of periods of the structure to generate
+ *
+ * \details This allows a graded mesh to be used, with fine cells close to interfaces and
+ *          coarse cells in the middle of thick layers.  The cell boundaries must coincide
+ *          with the layer boundaries.
+ */
+Mesh::Mesh(const decltype(_x_layer)    &x_layer,
+           const decltype(_W_layer)    &W_layer,
+           const decltype(_n3D_layer)  &n3D_layer,
+           const decltype(_dz_1per)    &dz_1per,
+           const decltype(_n_periods)   n_periods) :
+    _n_alloy(x_layer.at(0).size()),
+    _x_layer(x_layer),
+    _W_layer(W_layer),
+    _n3D_layer(n3D_layer),
+    _layer_top_1per(arma::cumsum(_W_layer)),
+    _n_periods(n_periods),
+    _ncell_1per(dz_1per.size()),
+    _layer_top_index_1per(_x_layer.size()),
+    _layer_index_1per(_ncell_1per),
+    _z_1per(_ncell_1per),
+    _x_1per(_ncell_1per, std::valarray<double>(_n_alloy)),
+    _n3D_1per(_ncell_1per),
+    _Lp(sum(_W_layer)),
+    _dz(dz_1per.min()),
+    _uniform(false),
+    _dz_1per(dz_1per),
+    _cell_top_1per(arma::cumsum(dz_1per))
+{
+    if(gsl_fcmp(sum(_dz_1per), _Lp, 1e-9) != 0)
+    {
+        std::ostringstream oss;
+        oss << "Total width of cells (" << sum(_dz_1per)*1e10 << " angstrom) does not match period length ("
+            << _Lp*1e10 << " angstrom).";
+        throw std::runtime_error(oss.str());
+    }
+
+    fill_cells();
+
+    // Check that every layer boundary lies on a cell boundary
+    for(unsigned int iL = 0; iL < _W_layer.size(); ++iL)
+    {
+        const auto iz_top = get_layer_top_index(iL);
+        const auto z_top  = (iz_top > 0) ? _cell_top_1per(iz_top-1) : 0.0;
+
+        if(gsl_fcmp(z_top, get_height_at_top_of_layer(iL), 1e-9) != 0)
+        {
+            std::ostringstream oss;
+            oss << "Top of layer " << iL << " does not coincide with a cell boundary.";
+            throw std::runtime_error(oss.str());
+        }
+    }
+}
+
+/**
+ * \brief Set the position, doping and alloy fractions in every cell of one period
+ */
+void Mesh::fill_cells()
+{
+    ScopedTimer timer("mesh construction");
+
+    const auto n_layer_1per = _W_layer.size(); // Number of layers in one period
+
     // Find the index at the top of each layer
-    for(unsigned int iL = 0; iL < n_layer; ++iL)
+    for(unsigned int iL = 0; iL < n_layer_1per; ++iL)
     {
-        _layer_top_index[iL] = get_layer_top_index(iL);
+        _layer_top_index_1per[iL] = get_layer_top_index(iL);
 
         unsigned int _previous_layer_top_index = 0;
 
-        if (iL > 0) _previous_layer_top_index = _layer_top_index[iL-1];
+        if (iL > 0) _previous_layer_top_index = _layer_top_index_1per[iL-1];
 
         // Now fill in the properties for each cell within the layer
         for (unsigned int icell = _previous_layer_top_index;
-                          icell < _layer_top_index[iL];
+                          icell < _layer_top_index_1per[iL];
                           ++icell)
         {
-            _z[icell]   = (icell+0.5) * _dz; // Set location to middle of cell
-            _n3D[icell] = get_n3D_in_layer(iL);
+            _z_1per[icell]           = z_in_cell(icell);
+            _n3D_1per[icell]         = get_n3D_in_layer(iL);
+            _layer_index_1per[icell] = iL;
 
             // Copy all the alloy fractions for this layer
             for(unsigned int ialloy = 0; ialloy < _n_alloy; ++ialloy)
-                _x.at(icell)[ialloy] = _x_layer.at(iL%n_layer_1per)[ialloy];
+                _x_1per.at(icell)[ialloy] = _x_layer.at(iL)[ialloy];
         }
     }
 }
 
+/**
+ * \brief Find the position at the middle of a cell anywhere in the structure [m]
+ *
+ * \param[in] icell Index of the cell
+ */
+double Mesh::z_in_cell(const unsigned int icell) const
+{
+    if(_uniform)
+        return (icell+0.5) * _dz;
+
+    const auto icell_1per = icell % _ncell_1per;
+    const auto iper       = icell / _ncell_1per;
+
+    return iper*_Lp + _cell_top_1per(icell_1per) - 0.5*_dz_1per(icell_1per);
+}
+
+/**
+ * \brief Check that a cell index lies within the structure
+ */
+void Mesh::check_cell_index(const unsigned int icell) const
+{
+    if(icell >= get_ncell())
+    {
+        std::ostringstream oss;
+        oss << "Tried to access cell " << icell << " in a mesh with " << get_ncell() << " cells.";
+        throw std::domain_error(oss.str());
+    }
+}
+
+/**
+ * \brief Return the position at the middle of every cell in the mesh [m]
+ */
+std::valarray<double> Mesh::get_z() const
+{
+    std::valarray<double> z(get_ncell());
+
+    for(unsigned int icell = 0; icell < z.size(); ++icell)
+        z[icell] = z_in_cell(icell);
+
+    return z;
+}
+
+/**
+ * \brief Return the position at the middle of a cell [m]
+ *
+ * \param[in] iz Index of the cell
+ */
+double Mesh::get_z(const unsigned int iz) const
+{
+    check_cell_index(iz);
+    return z_in_cell(iz);
+}
+
+/**
+ * \brief Return the alloy fractions in every cell of the mesh
+ */
+alloy_vector Mesh::get_x_array() const
+{
+    alloy_vector x;
+    x.reserve(get_ncell());
+
+    for(unsigned int iper = 0; iper < _n_periods; ++iper)
+        x.insert(x.end(), _x_1per.begin(), _x_1per.end());
+
+    return x;
+}
+
+/**
+ * \brief Return the alloy fractions in a cell
+ *
+ * \param[in] iz Index of the cell
+ */
+const std::valarray<double> & Mesh::get_x_at_point(const unsigned int iz) const
+{
+    check_cell_index(iz);
+    return _x_1per[iz % _ncell_1per];
+}
+
+/**
+ * \brief Return the doping in every cell of the mesh [m^{-3}]
+ */
+std::valarray<double> Mesh::get_n3D_array() const
+{
+    std::valarray<double> n3D(get_ncell());
+
+    for(unsigned int iper = 0; iper < _n_periods; ++iper)
+        n3D[std::slice(iper*_ncell_1per, _ncell_1per, 1)] = _n3D_1per;
+
+    return n3D;
+}
+
+/**
+ * \brief Return the index of the cell at the top of every layer in the structure
+ */
+std::valarray<unsigned int> Mesh::get_layer_top_indices() const
+{
+    const auto n_layer_1per = _W_layer.size();
+    std::valarray<unsigned int> index(n_layer_1per * _n_periods);
+
+    for(unsigned int iL = 0; iL < index.size(); ++iL)
+        index[iL] = _layer_top_index_1per[iL % n_layer_1per] + (iL / n_layer_1per) * _ncell_1per;
+
+    return index;
+}
+
+/**
+ * \brief Return the width of every cell in the mesh [m]
+ */
+std::valarray<double> Mesh::get_dz_array() const
+{
+    std::valarray<double> dz(get_ncell());
+
+    for(unsigned int icell = 0; icell < dz.size(); ++icell)
+        dz[icell] = _dz_1per(icell % _ncell_1per);
+
+    return dz;
+}
+
+/**
+ * \brief Find the widths of cells in a graded mesh for one period of a structure
+ *
+ * \param[in] W_layer Thickness of each layer [m]
+ * \param[in] dz_max  Maximum width of cells next to an interface [m]
+ * \param[in] dz_bulk Maximum width of cells far from an interface [m]
+ * \param[in] growth  Ratio between the widths of neighbouring cells
+ *
+ * \returns The width of each cell [m]
+ *
+ * \details Within each layer, the cells start with a width of about dz_max at
+ *          each interface and grow geometrically towards the middle of the layer,
+ *          up to a width of dz_bulk.  The widths are then scaled slightly so that
+ *          they exactly fill the layer.  Thin layers (e.g., quantum wells) therefore
+ *          get a near-uniform fine mesh, while thick barriers get far fewer points.
+ */
+arma::vec Mesh::graded_cell_widths(const arma::vec &W_layer,
+                                   const double     dz_max,
+                                   const double     dz_bulk,
+                                   const double     growth)
+{
+    std::vector<double> dz_all;
+
+    for(auto W : W_layer)
+    {
+        // Build up the cells from both sides of the layer until they meet in the middle
+        std::vector<double> half;
+        double total = 0.0;
+        double dz    = dz_max;
+
+        while(2*(total + dz) <= W)
+        {
+            half.push_back(dz);
+            total += dz;
+            dz     = GSL_MIN_DBL(dz*growth, dz_bulk);
+        }
+
+        // Fill the gap in the middle with whole cells no wider than the largest so far
+        const double gap   = W - 2*total;
+        const double dz_mid = half.empty() ? dz_max : half.back();
+        const size_t n_mid = (gap > 0) ? ceil(gap/dz_mid) : 0;
+
+        std::vector<double> layer(half.begin(), half.end());
+
+        for(size_t i = 0; i < n_mid; ++i)
+            layer.push_back(gap/n_mid);
+
+        layer.insert(layer.end(), half.rbegin(), half.rend());
+
+        // Make sure the cells exactly fill the layer
+        double sum_layer = 0.0;
+
+        for(auto w : layer)
+            sum_layer += w;
+
+        for(auto w : layer)
+            dz_all.push_back(w*W/sum_layer);
+    }
+
+    return arma::vec(dz_all);
+}
 
 void Mesh::read_layers_from_file(const std::string &filename,
                                  alloy_vector      &x_layer,
@@ -165,12 +425,15 @@ void Mesh::read_layers_from_file(const std::string &filename,
  * \param[in] layer_filename Name of input file
  * \param[in] n_periods      Number of periods to generate
  * \param[in] dz_max         The maximum allowable width of each cell [m]
+ * \param[in] dz_bulk        If greater than dz_max, a graded mesh is created, in which
+ *                           cells grow up to this width away from interfaces [m]
  *
  * \return A new Mesh object for the system.  Remember to delete it after use!
  */
 Mesh* Mesh::create_from_file_auto_nz(const std::string &layer_filename,
                                      const size_t       n_periods,
-                                     const double       dz_max)
+                                     const double       dz_max,
+                                     const double       dz_bulk)
 {
     alloy_vector x_layer;   // Alloy fraction for each layer
     arma::vec    W_layer;   // Thickness of each layer
@@ -178,6 +441,12 @@ Mesh* Mesh::create_from_file_auto_nz(const std::string &layer_filename,
 
     read_layers_from_file(layer_filename, x_layer, W_layer, n3D_layer);
 
+    if(dz_bulk > dz_max)
+    {
+        const auto dz_1per = graded_cell_widths(W_layer, dz_max, dz_bulk);
+        return new Mesh(x_layer, W_layer, n3D_layer, dz_1per, n_periods);
+    }
+
     const double period_length = sum(W_layer);
 
     // Round up to get the required number of cells per period
@@ -210,6 +479,29 @@ Mesh* Mesh::create_from_file(const std::string &layer_filename,
     return new Mesh(x_layer, W_layer, n3D_layer, ncell_1per, n_periods);
 }
 
+/**
+ * Create a Mesh using data from an input file, with a specified width for each cell
+ *
+ * \param[in] layer_filename Name of input file
+ * \param[in] dz_1per        Width of each cell in one period [m]
+ * \param[in] n_periods      Number of periods to generate
+ *
+ * \return A new Mesh object for the system.  Remember to delete it after use!
+ */
+Mesh* Mesh::create_from_file(const std::string &layer_filename,
+                             const arma::vec   &dz_1per,
+                             const size_t       n_periods)
+{
+    alloy_vector x_layer;   // Alloy fraction for each layer
+    arma::vec    W_layer;   // Thickness of each layer
+    arma::vec    n3D_layer; // Doping density of each layer
+
+    read_layers_from_file(layer_filename, x_layer, W_layer, n3D_layer);
+
+    // Pack input data into a Mesh object
+    return new Mesh(x_layer, W_layer, n3D_layer, dz_1per, n_periods);
+}
+
 /**
  * \brief Return the doping concentration in a given layer
  *
@@ -228,10 +520,10 @@ double Mesh::get_n3D_in_layer(const unsigned int iL) const
 /** Get the doping concentration at a given point in the structure */
 double Mesh::get_n3D_at_point(const unsigned int iz) const
 {
-    if(iz > _n3D.size())
+    if(iz >= get_ncell())
         throw std::domain_error("Tried to access the doping concentration at a point outside the heterostructure.");
 
-    return _n3D[iz];
+    return _n3D_1per[iz % _ncell_1per];
 }
 
 /**
@@ -258,7 +550,26 @@ unsigned int Mesh::get_layer_top_index(const unsigned int iL) const
     // Now work within this (incomplete) period
     const auto iL_per = iL % _W_layer.size(); // Index of layer WITHIN period
     const auto z_at_top  = get_height_at_top_of_layer(iL_per);
-    unsigned int iz_at_top = round(z_at_top / _dz); // Round to nearest layer
+    unsigned int iz_at_top = 0;
+
+    if(_uniform)
+        iz_at_top = round(z_at_top / _dz); // Round to nearest layer
+    else
+    {
+        // Find the nearest cell boundary.  The boundaries are in ascending order,
+        // so only the two on either side of the layer top need to be compared
+        const auto icell = std::lower_bound(_cell_top_1per.begin(), _cell_top_1per.end(), z_at_top)
+                           - _cell_top_1per.begin();
+        iz_at_top = icell;
+
+        if(static_cast<size_t>(icell) < _ncell_1per)
+        {
+            const double z_below = (icell > 0) ? _cell_top_1per(icell-1) : 0.0;
+
+            if(_cell_top_1per(icell) - z_at_top < z_at_top - z_below)
+                iz_at_top = icell + 1;
+        }
+    }
 
     // Fix possible rounding error at top of period
     if(iz_at_top > _ncell_1per)
@@ -279,16 +590,14 @@ unsigned int Mesh::get_layer_top_index(const unsigned int iL) const
  */
 double Mesh::get_height_at_top_of_layer(const unsigned int iL) const
 {
-    const arma::vec layer_tops = cumsum(_W_layer);
-
     // Find the height of the highest **incomplete** period
-    double height = layer_tops(iL%_W_layer.size());
+    double height = _layer_top_1per(iL%_W_layer.size());
 
     // Add on the height of all the **complete** periods below this layer
     if(_n_periods > 1)
     {
         const auto n_previous_periods = iL / _W_layer.size(); // Integer division
-        height += sum(_W_layer) * n_previous_periods;
+        height += _Lp * n_previous_periods;
     }
 
     return height;
@@ -336,24 +645,66 @@ bool Mesh::point_is_in_layer(const double       z,
  *
  * \returns The index of the layer containing point z
  *
- * \details A point lies within layer i if z_(i-1) <= z < z_i. 
+ * \details A point lies within layer i if z_(i-1) <= z < z_i.  The heights of
+ *          the layer tops are in ascending order, so the layer is found by a
+ *          binary search.  A point at the very top of the structure, or above the
+ *          top of the last layer by rounding error, is taken to be in the last layer.
  */
 unsigned int Mesh::get_layer_from_height(const double z) const
 {
-    if (z > get_period_length()*_n_periods)
+    const double length = get_period_length()*_n_periods; // Total length of structure [m]
+
+    if (z < 0 || z > length)
     {
         std::ostringstream oss;
         oss << "Tried to find layer index at a height of " << z*1e9 << " nm, but total structure length is "
-            << get_period_length()*_n_periods << " nm.";
+            << length*1e9 << " nm.";
         throw std::domain_error(oss.str());
     }
 
-    unsigned int iL = 0; // index of layer
+    // Find the first layer whose top is above the point
+    unsigned int iL_min = 0;
+    unsigned int iL_max = get_n_layers_total();
+
+    while(iL_min < iL_max)
+    {
+        const unsigned int iL = iL_min + (iL_max - iL_min)/2;
+
+        if(z < get_height_at_top_of_layer(iL))
+            iL_max = iL;
+        else
+            iL_min = iL + 1;
+    }
+
+    return std::min<size_t>(iL_min, get_n_layers_total() - 1);
+}
+
+/**
+ * \brief Find the index of the layer that contains a given cell
+ *
+ * \param[in] iz Index of the cell
+ */
+unsigned int Mesh::get_layer_at_point(const unsigned int iz) const
+{
+    check_cell_index(iz);
+    return _layer_index_1per[iz % _ncell_1per] + (iz / _ncell_1per) * _W_layer.size();
+}
 
-    while(!point_is_in_layer(z,iL))
-        iL++;
+/**
+ * \brief Return the index of the layer that contains every cell in the structure
+ */
+std::valarray<unsigned int> Mesh::get_layer_indices() const
+{
+    const auto n_layer_1per = _W_layer.size();
+    std::valarray<unsigned int> index(get_ncell());
+
+    for(unsigned int iper = 0; iper < _n_periods; ++iper)
+    {
+        for(unsigned int icell = 0; icell < _ncell_1per; ++icell)
+            index[iper*_ncell_1per + icell] = _layer_index_1per[icell] + iper*n_layer_1per;
+    }
 
-    return iL;
+    return index;
 }
 } // namespace
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -23,6 +23,13 @@ typedef std::vector< std::valarray<double> > alloy_vector;
 
 /**
  * \brief A stack of layers making up a quantum heterostructure
+ *
+ * \details Only a single period of the per-cell data is stored.  The properties
+ *          at any point in the multi-period structure are found by mapping its
+ *          index onto the first period, so the memory needed does not grow
+ *          with the number of periods.  The *_1per functions return the stored
+ *          data directly, and the functions that return whole-structure arrays
+ *          expand them on demand.
  */
 class Mesh
 {
@@ -32,6 +39,7 @@ private:
     alloy_vector _x_layer;    ///< Alloy fractions in each layer
     arma::vec    _W_layer;    ///< Width of each layer [m]
     arma::vec    _n3D_layer;  ///< Donor density in each layer [m^{-3}]
+    arma::vec    _layer_top_1per; ///< Height at the top of each layer in one period [m]
 
     static void read_layers_from_file(const std::string    &filename,
                                       decltype(_x_layer)   &x_layer,
@@ -42,14 +50,24 @@ private:
     size_t                _n_periods;  ///< Number of periods in the structure
     size_t                _ncell_1per; ///< Number of cells in each period of the mesh
 
-    std::valarray<unsigned int> _layer_top_index; ///< Index of the last cell in each layer
+    std::valarray<unsigned int> _layer_top_index_1per; ///< Index of the last cell in each layer of one period
+    std::valarray<unsigned int> _layer_index_1per;     ///< Index of the layer containing each cell of one period
 
-    // Parameters for each point in the entire, expanded structure
-    std::valarray<double> _z;   ///< Spatial position at the middle of each cell [m]
-    alloy_vector          _x;   ///< Alloy fractions at the middle of each cell
-    std::valarray<double> _n3D; ///< Volume doping at the middle of each cell [m^{-3}]
+    // Parameters for each point in a single period
+    std::valarray<double> _z_1per;   ///< Spatial position at the middle of each cell [m]
+    alloy_vector          _x_1per;   ///< Alloy fractions at the middle of each cell
+    std::valarray<double> _n3D_1per; ///< Volume doping at the middle of each cell [m^{-3}]
     double                _Lp;  ///< Length of one period [m]
-    double                _dz;  ///< Width of each cell [m]
+    double                _dz;  ///< Width of each cell [m]. For a graded mesh, the smallest width
+
+    bool      _uniform;          ///< True if all cells have the same width
+    arma::vec _dz_1per;          ///< Width of each cell in one period [m]
+    arma::vec _cell_top_1per;    ///< Height at the top of each cell in one period [m]
+
+    void fill_cells();
+
+    double z_in_cell(const unsigned int icell) const;
+    void   check_cell_index(const unsigned int icell) const;
 
 public:
     Mesh(const decltype(_x_layer)    &x_layer,
@@ -58,38 +76,72 @@ public:
          const decltype(_ncell_1per)  ncell_1per,
          const decltype(_n_periods)   n_periods = 1);
 
+    Mesh(const decltype(_x_layer)    &x_layer,
+         const decltype(_W_layer)    &W_layer,
+         const decltype(_n3D_layer)  &n3D_layer,
+         const decltype(_dz_1per)    &dz_1per,
+         const decltype(_n_periods)   n_periods = 1);
+
     static Mesh* create_from_file_auto_nz(const std::string &layer_filename,
                                           const size_t       n_periods,
-                                          const double       dz_max = 1e-10);
+                                          const double       dz_max  = 1e-10,
+                                          const double       dz_bulk = 0.0);
+
+    static arma::vec graded_cell_widths(const arma::vec &W_layer,
+                                        const double     dz_max,
+                                        const double     dz_bulk,
+                                        const double     growth = 1.2);
 
     static Mesh* create_from_file(const std::string &layer_filename,
                                   const size_t       nz_1per,
                                   const size_t       n_periods);
 
+    static Mesh* create_from_file(const std::string &layer_filename,
+                                  const arma::vec   &dz_1per,
+                                  const size_t       n_periods);
+
     /** Return the number of cells in one period of the mesh */
     size_t get_ncell_1per() const {return _ncell_1per;}
 
     /** Return the total number of sampling points in the entire structure */
-    size_t get_ncell() const {return _z.size();}
+    size_t get_ncell() const {return _ncell_1per*_n_periods;}
+
+    /** Return the number of periods in the structure */
+    size_t get_n_periods() const {return _n_periods;}
 
-    std::valarray<double> get_z() const {return _z;}
-    double                get_z(unsigned int iz) const {return _z[iz];}
+    std::valarray<double> get_z() const;
+    double                get_z(unsigned int iz) const;
     double                get_dz() const {return _dz;}
 
+    /** Return the position of each cell in the first period [m] */
+    const std::valarray<double> & get_z_1per() const {return _z_1per;}
+    std::valarray<double> get_dz_array() const;
+
+    /** Return the width of each cell in the first period [m] */
+    const arma::vec &     get_dz_array_1per() const {return _dz_1per;}
+
+    /** Return true if all cells in the mesh have the same width */
+    bool                  is_uniform() const {return _uniform;}
+
     /** Return the number of alloy components in the structure */
     decltype(_n_alloy)    get_n_alloy() const {return _n_alloy;}
 
     decltype(_W_layer)    get_layer_widths() const {return _W_layer;}
 
-    alloy_vector get_x_array() const {return _x;}
+    alloy_vector get_x_array() const;
+
+    /** Return the alloy fractions in each cell of the first period */
+    const alloy_vector & get_x_array_1per() const {return _x_1per;}
+
+    const std::valarray<double> & get_x_at_point(const unsigned int iz) const;
 
     double get_n3D_in_layer(const unsigned int iL) const;
     double get_n3D_at_point(const unsigned int iz) const;
 
-    /**
-     * Return the entire array of doping at each point
-     */
-    std::valarray<double> get_n3D_array() const {return _n3D;}
+    std::valarray<double> get_n3D_array() const;
+
+    /** Return the doping in each cell of the first period [m^{-3}] */
+    const std::valarray<double> & get_n3D_array_1per() const {return _n3D_1per;}
 
     /**
      * \brief Return the number of layers in a single period
@@ -102,6 +154,11 @@ public:
     size_t       get_n_layers_total() const {return _W_layer.size()*_n_periods;}
 
     unsigned int get_layer_from_height(const double z) const;
+    unsigned int get_layer_at_point(const unsigned int iz) const;
+
+    /** Return the index of the layer containing each cell of the first period */
+    const std::valarray<unsigned int> & get_layer_indices_1per() const {return _layer_index_1per;}
+    std::valarray<unsigned int> get_layer_indices() const;
 
     bool         point_is_in_layer(const double z,
                                    const unsigned int iL) const;
@@ -109,7 +166,7 @@ public:
     double       get_height_at_top_of_layer(const unsigned int iL) const;
 
     unsigned int get_layer_top_index(const unsigned int iL) const;
-    std::valarray<unsigned int> get_layer_top_indices() const {return _layer_top_index;}
+    std::valarray<unsigned int> get_layer_top_indices() const;
 
     /// Return the length of a single period of the structure
     double       get_period_length() const {return sum(_W_layer);}
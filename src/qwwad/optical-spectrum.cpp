@@ -0,0 +1,184 @@
+/**
+ * \file   optical-spectrum.cpp
+ * \brief  Intersubband gain and absorption spectra for a set of states
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "optical-spectrum.h"
+
+#include <sstream>
+#include <stdexcept>
+
+#include "constants.h"
+#include "parallel.h"
+#include "profiler.h"
+
+namespace QWWAD
+{
+using namespace constants;
+
+/**
+ * \brief Constructor
+ *
+ * \param[in] E   Photon energy at each point in the spectrum [J]
+ * \param[in] n_r Refractive index of the material
+ * \param[in] L_p Length of one period of the structure [m]
+ */
+OpticalSpectrum::OpticalSpectrum(const arma::vec &E,
+                                 const double     n_r,
+                                 const double     L_p) :
+    _E(E),
+    _n_r(n_r),
+    _L_p(L_p)
+{
+    if(n_r <= 0)
+    {
+        std::ostringstream oss;
+        oss << "Refractive index must be positive. Got " << n_r;
+        throw std::domain_error(oss.str());
+    }
+
+    if(L_p <= 0)
+    {
+        std::ostringstream oss;
+        oss << "Period length must be positive. Got " << L_p;
+        throw std::domain_error(oss.str());
+    }
+}
+
+/**
+ * \brief Find the linewidth of every transition from the lifetimes of the states
+ *
+ * \param[in] W Total scattering rate out of each state [1/s]
+ *
+ * \returns A matrix whose (i,f) element is the half-width at half-maximum of the
+ *          transition between states i and f, \f$\Gamma_{if} = \hbar(W_i + W_f)/2\f$ [J]
+ */
+arma::mat OpticalSpectrum::get_lifetime_linewidths(const arma::vec &W)
+{
+    const arma::vec ones_W = arma::ones(W.size());
+    return 0.5*hBar*(W*ones_W.t() + ones_W*W.t());
+}
+
+/**
+ * \brief Find the gain spectrum for a set of states
+ *
+ * \param[in] states The states
+ * \param[in] N      Sheet density of carriers in each state, in each period [m^{-2}]
+ * \param[in] Gamma  Matrix of half-widths at half-maximum for each transition [J]
+ *
+ * \returns The gain at each photon energy [1/m]
+ */
+arma::vec OpticalSpectrum::get_gain(const StateSet  &states,
+                                    const arma::vec &N,
+                                    const arma::mat &Gamma) const
+{
+    const auto nst = states.size();
+
+    if(N.size() != nst)
+    {
+        std::ostringstream oss;
+        oss << "Got " << N.size() << " populations for " << nst << " states";
+        throw std::length_error(oss.str());
+    }
+
+    if(Gamma.n_rows != nst || Gamma.n_cols != nst)
+    {
+        std::ostringstream oss;
+        oss << "Linewidth matrix is " << Gamma.n_rows << "x" << Gamma.n_cols
+            << " but there are " << nst << " states";
+        throw std::length_error(oss.str());
+    }
+
+    const arma::mat  z     = states.get_position_matrix();
+    const arma::vec &E_st  = states.get_energies();
+    arma::vec        total = arma::zeros(_E.size());
+
+    for(unsigned int i = 0; i < nst; ++i)
+    {
+        for(unsigned int f = 0; f < nst; ++f)
+        {
+            // Count each pair once, as an upward transition from i to f
+            if(E_st(f) <= E_st(i))
+                continue;
+
+            const double strength = z(i,f)*z(i,f)*(N(f) - N(i));
+
+            if(strength == 0.0)
+                continue;
+
+            const double G = Gamma(i,f);
+
+            if(G <= 0)
+            {
+                std::ostringstream oss;
+                oss << "Linewidth for transition " << i+1 << "->" << f+1
+                    << " must be positive. Got " << G/e*1000 << " meV";
+                throw std::domain_error(oss.str());
+            }
+
+            const arma::vec dE = _E - (E_st(f) - E_st(i));
+            total += strength*G/pi / (arma::square(dE) + G*G);
+        }
+    }
+
+    return pi*e*e/(hBar*_n_r*c*eps0*_L_p) * (_E % total);
+}
+
+/**
+ * \brief Find the gain spectrum for a set of states, using the same linewidth
+ *        for every transition
+ *
+ * \param[in] states The states
+ * \param[in] N      Sheet density of carriers in each state, in each period [m^{-2}]
+ * \param[in] Gamma  Half-width at half-maximum for every transition [J]
+ *
+ * \returns The gain at each photon energy [1/m]
+ */
+arma::vec OpticalSpectrum::get_gain(const StateSet  &states,
+                                    const arma::vec &N,
+                                    const double     Gamma) const
+{
+    const arma::mat Gamma_all(states.size(), states.size(), arma::fill::ones);
+    return get_gain(states, N, Gamma*Gamma_all);
+}
+
+/**
+ * \brief Find the gain spectrum at each of a list of bias points
+ *
+ * \param[in] states    The states at each bias
+ * \param[in] N         Sheet density of carriers in each state, in each period, at each bias [m^{-2}]
+ * \param[in] Gamma     Matrix of half-widths at half-maximum for each transition at each bias [J]
+ * \param[in] n_threads Number of threads to use (0 = one per CPU core)
+ *
+ * \returns A matrix whose columns hold the gain at each photon energy [1/m] for
+ *          each bias point
+ *
+ * \details The bias points are independent, so they are shared between threads.
+ */
+arma::mat OpticalSpectrum::get_gain(const std::vector<StateSet>  &states,
+                                    const std::vector<arma::vec> &N,
+                                    const std::vector<arma::mat> &Gamma,
+                                    const unsigned int            n_threads) const
+{
+    const auto nbias = states.size();
+
+    if(N.size() != nbias || Gamma.size() != nbias)
+    {
+        std::ostringstream oss;
+        oss << "Got " << nbias << " sets of states, " << N.size()
+            << " sets of populations and " << Gamma.size() << " sets of linewidths";
+        throw std::length_error(oss.str());
+    }
+
+    arma::mat g(_E.size(), nbias);
+
+    run_in_parallel(nbias, n_threads, [&](const size_t ibias) {
+        ScopedTraceEvent event("bias point");
+        g.col(ibias) = get_gain(states[ibias], N[ibias], Gamma[ibias]);
+    });
+
+    return g;
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
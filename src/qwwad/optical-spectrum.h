@@ -0,0 +1,70 @@
+/**
+ * \file   optical-spectrum.h
+ * \brief  Intersubband gain and absorption spectra for a set of states
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_OPTICAL_SPECTRUM_H
+#define QWWAD_OPTICAL_SPECTRUM_H
+
+#include <vector>
+#include <armadillo>
+#include "state-set.h"
+
+namespace QWWAD
+{
+/**
+ * \brief Finds the intersubband gain spectrum on a grid of photon energies
+ *
+ * \details The gain at photon energy \f$E = \hbar\omega\f$ is
+ *          \f[
+ *            g(E) = \frac{\pi e^2 \omega}{n_r c \epsilon_0 L_p}
+ *                   \sum_{E_f > E_i} |z_{if}|^2 (N_f - N_i)\,
+ *                   \mathcal{L}(E - E_{fi}; \Gamma_{if}),
+ *          \f]
+ *          where \f$N_i\f$ is the sheet density of carriers in state \f$i\f$ in
+ *          each period of length \f$L_p\f$, \f$z_{if}\f$ is the dipole matrix
+ *          element, \f$n_r\f$ is the refractive index and
+ *          \f[
+ *            \mathcal{L}(E; \Gamma) = \frac{\Gamma/\pi}{E^2 + \Gamma^2}
+ *          \f]
+ *          is a normalised Lorentzian with half-width at half-maximum \f$\Gamma\f$.
+ *          The absorption coefficient is \f$-g(E)\f$.
+ *
+ *          The dipole matrix elements for every pair of states are taken from a
+ *          single StateSet::get_position_matrix call, and each transition is
+ *          added to the whole energy grid at once.
+ */
+class OpticalSpectrum
+{
+private:
+    arma::vec _E;   ///< Photon energy at each point in the spectrum [J]
+    double    _n_r; ///< Refractive index of the material
+    double    _L_p; ///< Length of one period of the structure [m]
+
+public:
+    OpticalSpectrum(const arma::vec &E,
+                    const double     n_r,
+                    const double     L_p);
+
+    /// Return the photon energy at each point in the spectrum [J]
+    inline const arma::vec & get_energies() const {return _E;}
+
+    static arma::mat get_lifetime_linewidths(const arma::vec &W);
+
+    arma::vec get_gain(const StateSet  &states,
+                       const arma::vec &N,
+                       const arma::mat &Gamma) const;
+
+    arma::vec get_gain(const StateSet  &states,
+                       const arma::vec &N,
+                       const double     Gamma) const;
+
+    arma::mat get_gain(const std::vector<StateSet>  &states,
+                       const std::vector<arma::vec> &N,
+                       const std::vector<arma::mat> &Gamma,
+                       const unsigned int            n_threads = 0) const;
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -8,8 +8,19 @@
 #endif
 
 #include "options.h"
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "cpu-features.h"
+#include "file-io.h"
+#include "gpu-eigensolver.h"
+#include "memory-budget.h"
+#include "parallel.h"
+#include "profiler.h"
+#include "shard.h"
 
 namespace QWWAD {
 Options::Options() :
@@ -26,11 +37,53 @@ Options::Options() :
         ("config,c", 
          po::value(&config_filename)->default_value("qwwad.cfg"),
          "name of the configuration file to be used")
+
+        ("pipein", po::bool_switch(),
+         "read data tables from the standard input, as sent by another program with --pipeout")
+
+        ("pipeout", po::bool_switch(),
+         "send data tables to the standard output in binary form, instead of writing files")
+
+        ("project", po::value<std::string>(),
+         "read and write data tables in a single project file, instead of separate files "
+         "(see qwwad_project_export for the programs that still write their own files)")
         ;
 
     generic_options_any->add_options()
         ("verbose,V", po::bool_switch(),
          "display lots of information about calculation")
+
+        ("num_threads", po::value<unsigned int>()->default_value(0),
+         "number of threads used by any calculation whose own thread count is zero "
+         "(0 = one per CPU core)")
+
+        ("maxmemory", po::value<double>()->default_value(0),
+         "largest amount of memory that a single large calculation may use [MiB].  Where "
+         "possible, a leaner algorithm is used if the fastest one would need more than this "
+         "(0 = no limit)")
+
+        ("gputhreshold", po::value<size_t>()->default_value(2000),
+         "smallest order of dense Hermitian eigenvalue problem that is solved on the GPU, in "
+         "builds with GPU support.  Smaller problems are solved faster on the CPU "
+         "(0 = never use the GPU)")
+
+        ("asyncoutput", po::value<double>()->default_value(0),
+         "largest amount of finished output that may wait in memory while files are written "
+         "by a background thread [MiB].  This stops the calculation from waiting for a slow "
+         "file system after each file (0 = write each file directly)")
+
+        ("profile", po::bool_switch(),
+         "write the time spent in each phase of the calculation when the program exits")
+
+        ("profileformat", po::value<std::string>()->default_value("csv"),
+         "format of the profiling summary: \"csv\" or \"json\"")
+
+        ("profilefile", po::value<std::string>(),
+         "file to which the profiling summary is appended (default = standard error)")
+
+        ("tracefile", po::value<std::string>(),
+         "file to which a timeline of the tasks in each thread is written when the program "
+         "exits, in Chrome trace (JSON) format for viewing in Perfetto or chrome://tracing")
         ;
 }
 
@@ -77,6 +130,7 @@ Options::~Options()
 void Options::print_version_then_exit(char* prog_name) const
 {
     std::cout << prog_name << " (" << PACKAGE_NAME << ") " << PACKAGE_VERSION << std::endl
+              << "Vector kernels: " << get_vector_extension() << std::endl
               << "Copyright (c) 2016 Paul Harrison and Alex Valavanis." << std::endl
               << "License GPLv3+: GNU GPL version 3 or later <http://gnu.org/licenses/gpl.html>." << std::endl
               << "This is free software: you are free to change and redistribute it." << std::endl
@@ -142,6 +196,8 @@ void Options::add_prog_specific_options_and_parse(const int     argc,
                                                   char ** const argv,
                                                   std::string   summary)
 {
+    const auto start = Profiler::Clock::now();
+
     try {
         // Allow all options to be given on the command-line
         po::options_description command_line_options;
@@ -153,6 +209,13 @@ void Options::add_prog_specific_options_and_parse(const int     argc,
         po::store(po::parse_command_line(argc, argv, command_line_options), vm);
         po::notify(vm);
 
+        // Redirect the standard output before anything is printed to it
+        set_pipe_input(vm["pipein"].as<bool>());
+        set_pipe_output(vm["pipeout"].as<bool>());
+
+        if(vm.count("project"))
+            set_project_file(vm["project"].as<std::string>());
+
         // Now, read from config file (if available)
         std::ifstream config_filestream(config_filename.c_str(), std::ifstream::in);
 
@@ -201,6 +264,17 @@ void Options::add_prog_specific_options_and_parse(const int     argc,
         // Display the version number and copyright notice
         if (vm.count ("version")) 
             print_version_then_exit(argv[0]);
+
+        set_default_thread_count(vm["num_threads"].as<unsigned int>());
+        set_memory_limit(vm["maxmemory"].as<double>() * 1024 * 1024);
+        set_gpu_threshold(vm["gputhreshold"].as<size_t>());
+        set_async_output(static_cast<size_t>(vm["asyncoutput"].as<double>() * 1024 * 1024));
+
+        if (vm["profile"].as<bool>())
+            enable_profiling(argv[0], start);
+
+        if (vm.count("tracefile"))
+            Profiler::enable_trace(argv[0], vm["tracefile"].as<std::string>(), start);
     }
     catch(std::exception& e)
     {
@@ -209,6 +283,37 @@ void Options::add_prog_specific_options_and_parse(const int     argc,
     }
 }
 
+/**
+ * \brief Switch on the timing of each phase of the calculation
+ *
+ * \param[in] prog_name The name of the program
+ * \param[in] start     The time at which option parsing started
+ *
+ * \details The time taken to parse the options is counted as "input parsing".
+ */
+void Options::enable_profiling(char                              *prog_name,
+                               const Profiler::Clock::time_point &start) const
+{
+    const auto format_arg = vm["profileformat"].as<std::string>();
+    Profiler::Format format = Profiler::CSV;
+
+    if(format_arg == "json")
+        format = Profiler::JSON;
+    else if(format_arg != "csv")
+    {
+        std::ostringstream oss;
+        oss << "Unknown profiling format: " << format_arg;
+        throw std::runtime_error(oss.str());
+    }
+
+    const auto filename = vm.count("profilefile") ? vm["profilefile"].as<std::string>() : "";
+
+    Profiler::enable(prog_name, format, filename, start);
+
+    const std::chrono::duration<double> dt = Profiler::Clock::now() - start;
+    Profiler::add_time("input parsing", dt.count());
+}
+
 /**
  * \brief Map an environment variable name to an option name
  *
@@ -261,5 +366,130 @@ bool Options::get_argument_known(const std::string &name) const
 
     return seen;
 }
+
+/**
+ * \brief Get the items in a list-valued option
+ *
+ * \param[in] name The long name of the option
+ *
+ * \returns The items in the comma-separated list, or an empty list if the
+ *          option was not given.  See split_list.
+ */
+std::vector<std::string> Options::get_list(const std::string &name) const
+{
+    if(!get_argument_known(name))
+        return std::vector<std::string>();
+
+    return split_list(vm[name].as<std::string>());
+}
+
+/**
+ * \brief Add the --shard option, for splitting a list of transitions between jobs
+ *
+ * \details Use get_shard to find this job's part of the list.
+ */
+void Options::add_shard_option()
+{
+    add_option<std::string>("shard", "1/1", "Only find rates for part of the list of transitions, given as i/n for "
+                                            "job i of n.  Summary files are then labelled with the job number.");
+}
+
+/**
+ * \brief Get the part of the work that was given to this job with --shard
+ *
+ * \details The program stops with an error message if the specification is invalid.
+ */
+Shard Options::get_shard() const
+{
+    try
+    {
+        return Shard(get_option<std::string>("shard"));
+    }
+    catch(const std::invalid_argument &err)
+    {
+        std::cerr << err.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * \brief Get the values in a list of numbers
+ *
+ * \param[in] name  The long name of the option
+ * \param[in] scale Factor by which to multiply each value
+ *
+ * \returns The values in the comma-separated list, or an empty list if the
+ *          option was not given
+ *
+ * \details The program stops with an error message if any item in the list is
+ *          not a number.
+ */
+std::vector<double> Options::get_numeric_list(const std::string &name,
+                                              const double       scale) const
+{
+    std::vector<double> values;
+
+    for(const auto &item : get_list(name))
+    {
+        size_t nchar = 0;
+        double value = 0.0;
+
+        try
+        {
+            value = std::stod(item, &nchar);
+        }
+        catch(std::exception &e)
+        {
+            nchar = 0;
+        }
+
+        if(nchar != item.size())
+        {
+            std::cerr << "Invalid value in --" << name << ": " << item << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        values.push_back(value*scale);
+    }
+
+    return values;
+}
+
+/**
+ * \brief Split a list into its items
+ *
+ * \param[in] list       The list
+ * \param[in] separators The characters that separate items
+ *
+ * \returns The items in the list.  Whitespace around each item is removed, and
+ *          empty items are skipped.
+ */
+std::vector<std::string> split_list(const std::string &list,
+                                    const std::string &separators)
+{
+    std::vector<std::string> items;
+    const std::string        whitespace(" \t\r\n");
+    size_t                   start = 0;
+
+    while(start <= list.size())
+    {
+        auto end = list.find_first_of(separators, start);
+
+        if(end == std::string::npos)
+            end = list.size();
+
+        const auto first = list.find_first_not_of(whitespace, start);
+
+        if(first != std::string::npos && first < end)
+        {
+            const auto last = list.find_last_not_of(whitespace, end - 1);
+            items.push_back(list.substr(first, last - first + 1));
+        }
+
+        start = end + 1;
+    }
+
+    return items;
+}
 } // end namespace
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
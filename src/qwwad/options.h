@@ -6,11 +6,17 @@
 #ifndef QWWAD_OPTIONS_H
 #define QWWAD_OPTIONS_H
 
+#include <string>
+#include <vector>
 #include <boost/program_options.hpp>
 
+#include "profiler.h"
+
 namespace po = boost::program_options;
 
 namespace QWWAD {
+class Shard;
+
 /**
  * \brief Common options for all QCLsim programs
  *
@@ -44,6 +50,9 @@ class Options
         
         void print_version_then_exit(char* prog_name) const;
 
+        void enable_profiling(char                              *prog_name,
+                              const Profiler::Clock::time_point &start) const;
+
         std::string name_mapper(std::string in) const;
 
     protected:
@@ -55,6 +64,15 @@ class Options
     public:
         bool get_argument_known(const std::string &name) const;
 
+        std::vector<std::string> get_list(const std::string &name) const;
+
+        std::vector<double> get_numeric_list(const std::string &name,
+                                             const double       scale = 1.0) const;
+
+        void add_shard_option();
+
+        Shard get_shard() const;
+
         /**
          * \brief Adds an option to the program, with a default argument specified
          *
@@ -219,6 +237,9 @@ inline double Options::get_option<double>(const std::string &name) const
     else
         return val;
 }
+
+std::vector<std::string> split_list(const std::string &list,
+                                    const std::string &separators = ",");
 } // end namespace
 #endif // QWWAD_OPTIONS_H
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,197 @@
+/**
+ * \file   parallel.cpp
+ * \brief  Helpers for sharing work between threads
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "parallel.h"
+#include "profiler.h"
+
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// Thread-control functions from multithreaded BLAS libraries.  These are weak
+// references, so they are null unless the library that is linked provides them.
+#if defined(__GNUC__) && !defined(__APPLE__)
+extern "C"
+{
+    void openblas_set_num_threads(int)  __attribute__((weak));
+    int  openblas_get_num_threads()     __attribute__((weak));
+    int  MKL_Set_Num_Threads_Local(int) __attribute__((weak));
+}
+# define QWWAD_HAVE_WEAK_BLAS_CONTROL 1
+#endif
+
+namespace QWWAD
+{
+/// Number of threads to use when none is specified (0 = one per CPU core)
+static std::atomic<unsigned int> default_thread_count(0);
+
+/// True in the worker threads of run_in_parallel
+static thread_local bool in_parallel_region = false;
+
+/**
+ * \brief Set the number of threads that is used when a function is given zero threads
+ *
+ * \param[in] n_threads The number of threads (0 = one per CPU core)
+ *
+ * \details This is normally set from the --num_threads option, or the
+ *          QWWAD_NUM_THREADS environment variable, which are common to all
+ *          programs.
+ */
+void set_default_thread_count(const unsigned int n_threads)
+{
+    default_thread_count = n_threads;
+}
+
+/**
+ * \brief Find the number of threads to use
+ *
+ * \param[in] n_threads The number of threads that was asked for (0 = default)
+ *
+ * \returns n_threads, if nonzero.  Otherwise, the default set by
+ *          set_default_thread_count or, if that is zero, the number of CPU cores.
+ */
+unsigned int get_thread_count(const unsigned int n_threads)
+{
+    if(n_threads > 0)
+        return n_threads;
+
+    const unsigned int n_default = default_thread_count;
+
+    if(n_default > 0)
+        return n_default;
+
+    const unsigned int n_cores = std::thread::hardware_concurrency();
+
+    return (n_cores > 0) ? n_cores : 1;
+}
+
+namespace
+{
+/**
+ * \brief Limits OpenBLAS (if linked) to one thread, until destroyed
+ *
+ * \details This stops each worker thread from starting its own set of BLAS
+ *          threads, which would oversubscribe the CPU.  The OpenBLAS setting is
+ *          global, so it is changed once by the calling thread.
+ */
+class SerialBLAS
+{
+public:
+    SerialBLAS() :
+        _n_openblas(0)
+    {
+#if QWWAD_HAVE_WEAK_BLAS_CONTROL
+        if(openblas_set_num_threads && openblas_get_num_threads)
+        {
+            _n_openblas = openblas_get_num_threads();
+            openblas_set_num_threads(1);
+        }
+#endif
+    }
+
+    ~SerialBLAS()
+    {
+#if QWWAD_HAVE_WEAK_BLAS_CONTROL
+        if(_n_openblas > 0)
+            openblas_set_num_threads(_n_openblas);
+#endif
+    }
+
+private:
+    int _n_openblas; ///< Number of OpenBLAS threads to restore
+};
+
+/**
+ * \brief Limit MKL (if linked) to one thread in the calling thread
+ *
+ * \details The MKL setting only applies to the thread that makes it, so this is
+ *          called by each worker thread.  The workers end with the loop, so the
+ *          setting does not need to be restored.
+ */
+void use_serial_mkl()
+{
+#if QWWAD_HAVE_WEAK_BLAS_CONTROL
+    if(MKL_Set_Num_Threads_Local)
+        MKL_Set_Num_Threads_Local(1);
+#endif
+}
+} // namespace
+
+/**
+ * \brief Run a set of independent work items on a pool of threads
+ *
+ * \param[in] n_items   Number of work items
+ * \param[in] n_threads Number of threads to use (0 = default, see get_thread_count)
+ * \param[in] work      Function to call for each work item index
+ *
+ * \details Items are handed out to the threads in order as each thread becomes
+ *          free.  Any exception thrown by a work item is rethrown in the calling
+ *          thread once all threads have finished.
+ *
+ *          Calls from within a work item run serially in the calling thread, so
+ *          nested loops never start more threads than the outer loop.  While the
+ *          threads are running, OpenBLAS and MKL (if linked) are limited to a
+ *          single thread in every worker.
+ */
+void run_in_parallel(const size_t                        n_items,
+                     unsigned int                        n_threads,
+                     const std::function<void (size_t)> &work)
+{
+    n_threads = in_parallel_region ? 1 : get_thread_count(n_threads);
+
+    if(n_threads > n_items)
+        n_threads = n_items;
+
+    // Avoid the cost of starting a thread when there is nothing to share.  This
+    // also keeps nested calls cheap.
+    if(n_threads <= 1)
+    {
+        for(size_t item = 0; item < n_items; ++item)
+            work(item);
+
+        return;
+    }
+
+    SerialBLAS serial_blas;
+
+    std::atomic<size_t>             next_item(0);
+    std::vector<std::exception_ptr> errors(n_threads);
+    std::vector<std::thread>        workers;
+
+    for(unsigned int ithread = 0; ithread < n_threads; ++ithread)
+    {
+        workers.push_back(std::thread([&, ithread]() {
+            in_parallel_region = true;
+            use_serial_mkl();
+
+            // The whole time that this thread takes part in the loop, so that
+            // uneven shares of the work show up in a timeline
+            ScopedTraceEvent event("parallel worker");
+
+            try
+            {
+                for(size_t item = next_item++; item < n_items; item = next_item++)
+                    work(item);
+            }
+            catch(...)
+            {
+                errors[ithread] = std::current_exception();
+            }
+        }));
+    }
+
+    for(auto &worker : workers)
+        worker.join();
+
+    for(auto const &error : errors)
+    {
+        if(error)
+            std::rethrow_exception(error);
+    }
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,161 @@
+/**
+ * \file   parallel.h
+ * \brief  Helpers for sharing work between threads
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_PARALLEL_H
+#define QWWAD_PARALLEL_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace QWWAD
+{
+void set_default_thread_count(const unsigned int n_threads);
+
+unsigned int get_thread_count(const unsigned int n_threads = 0);
+
+void run_in_parallel(const size_t                        n_items,
+                     unsigned int                        n_threads,
+                     const std::function<void (size_t)> &work);
+
+/// Number of consecutive items that are combined in each block of parallel_reduce
+const size_t parallel_reduce_block_size = 64;
+
+/**
+ * \brief Combine the results of a set of independent work items, using several threads
+ *
+ * \param[in] n_items   Number of work items
+ * \param[in] n_threads Number of threads to use (0 = default)
+ * \param[in] init      The identity value for the combination, e.g., zero for a sum
+ * \param[in] work      Function that returns the result for a given work item index
+ * \param[in] combine   Function that combines two results, e.g., std::plus<T>()
+ *
+ * \returns The combination of init and every result, in item order
+ *
+ * \details The items are split into fixed blocks of consecutive items.  Each block
+ *          is combined in order by a single thread, and then the block results are
+ *          combined in order.  The blocks do not depend on the number of threads,
+ *          so the result is identical, to the last bit, for any number of threads.
+ */
+template <typename T, typename Work, typename Combine>
+T parallel_reduce(const size_t        n_items,
+                  const unsigned int  n_threads,
+                  const T            &init,
+                  const Work         &work,
+                  const Combine      &combine)
+{
+    const size_t n_blocks = (n_items + parallel_reduce_block_size - 1) / parallel_reduce_block_size;
+    std::vector<T> block_result(n_blocks, init);
+
+    run_in_parallel(n_blocks, n_threads, [&](const size_t iblock) {
+        const size_t first = iblock * parallel_reduce_block_size;
+        const size_t last  = std::min(first + parallel_reduce_block_size, n_items);
+
+        T result = init;
+
+        for(size_t item = first; item < last; ++item)
+            result = combine(result, work(item));
+
+        block_result[iblock] = result;
+    });
+
+    T result = init;
+
+    for(auto const &r : block_result)
+        result = combine(result, r);
+
+    return result;
+}
+
+/**
+ * \brief A running sum with compensation for rounding error
+ *
+ * \details This uses Neumaier's variant of Kahan summation, so the error in the
+ *          sum does not grow with the number of terms.  The result still depends
+ *          on the order in which the terms are added, so reproducible totals also
+ *          need a fixed order, as in parallel_sum.
+ */
+class CompensatedSum
+{
+    double _sum;          ///< Uncompensated running sum
+    double _compensation; ///< Accumulated rounding error
+
+public:
+    CompensatedSum() :
+        _sum(0.0),
+        _compensation(0.0)
+    {}
+
+    /// Add a term to the sum
+    void add(const double x)
+    {
+        const double t = _sum + x;
+
+        if(std::abs(_sum) >= std::abs(x))
+            _compensation += (_sum - t) + x;
+        else
+            _compensation += (x - t) + _sum;
+
+        _sum = t;
+    }
+
+    /// Add another sum to this one
+    void add(const CompensatedSum &other)
+    {
+        add(other._sum);
+        _compensation += other._compensation;
+    }
+
+    /// Return the compensated value of the sum
+    double value() const {return _sum + _compensation;}
+};
+
+/**
+ * \brief Sum the results of a set of independent work items, using several threads
+ *
+ * \param[in] n_items   Number of work items
+ * \param[in] n_threads Number of threads to use (0 = default)
+ * \param[in] work      Function that returns the term for a given work item index
+ *
+ * \returns The sum of all terms
+ *
+ * \details The items are split into the same fixed blocks as in parallel_reduce,
+ *          and each block is summed with compensation.  The block sums are then
+ *          combined pairwise, in a fixed tree.  Neither the blocks nor the tree
+ *          depend on the number of threads, so the result is identical, to the
+ *          last bit, for any number of threads, and its rounding error does not
+ *          grow with the number of items.
+ */
+template <typename Work>
+double parallel_sum(const size_t        n_items,
+                    const unsigned int  n_threads,
+                    const Work         &work)
+{
+    const size_t n_blocks = (n_items + parallel_reduce_block_size - 1) / parallel_reduce_block_size;
+    std::vector<CompensatedSum> block_sum(n_blocks);
+
+    run_in_parallel(n_blocks, n_threads, [&](const size_t iblock) {
+        const size_t first = iblock * parallel_reduce_block_size;
+        const size_t last  = std::min(first + parallel_reduce_block_size, n_items);
+
+        for(size_t item = first; item < last; ++item)
+            block_sum[iblock].add(work(item));
+    });
+
+    // Combine neighbouring pairs of blocks until one remains
+    for(size_t stride = 1; stride < n_blocks; stride *= 2)
+    {
+        for(size_t iblock = 0; iblock + stride < n_blocks; iblock += 2*stride)
+            block_sum[iblock].add(block_sum[iblock + stride]);
+    }
+
+    return n_blocks > 0 ? block_sum[0].value() : 0.0;
+}
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
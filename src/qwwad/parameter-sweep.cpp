@@ -0,0 +1,97 @@
+/**
+ * \file   parameter-sweep.cpp
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Command-line options and output for sweeps through a model parameter
+ */
+
+#include "parameter-sweep.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include "constants.h"
+#include "file-io.h"
+
+namespace QWWAD
+{
+using namespace constants;
+
+/**
+ * \brief Add the options that control a parameter sweep
+ *
+ * \param[in,out] opt        The options for the program
+ * \param[in]     parameters Description of the parameters that may be swept,
+ *                           e.g., "'wellwidth' or 'barrierpotential'"
+ * \param[in]     step       Default step between values of the swept parameter
+ */
+void add_sweep_options(Options           &opt,
+                       const std::string &parameters,
+                       const double       step)
+{
+    opt.add_option<std::string>("sweep",                   "Sweep through a range of values of a parameter, rather than "
+                                                           "solving for a single system.  Only the energies are found, and "
+                                                           "the result is written to the sweep file.  The parameter may be "
+                                                           + parameters + ".");
+    opt.add_option<double>     ("sweepstart",              "Initial value of the swept parameter, in the same units as the "
+                                                           "parameter itself.");
+    opt.add_option<double>     ("sweepstep",         step, "Step between values of the swept parameter.");
+    opt.add_option<double>     ("sweepstop",               "Final value of the swept parameter.");
+    opt.add_option<std::string>("sweepfile",  "E-sweep.r", "Filename to which the energies from a parameter sweep are "
+                                                           "written.");
+}
+
+/**
+ * \brief Find the values of the swept parameter
+ *
+ * \param[in] opt Command-line options, including those from add_sweep_options
+ *
+ * \returns The parameter at each point in the sweep, in the units used on the command line
+ */
+arma::vec get_sweep_values(const Options &opt)
+{
+    if(!opt.get_argument_known("sweepstart") || !opt.get_argument_known("sweepstop"))
+    {
+        std::cerr << "A sweep needs both --sweepstart and --sweepstop to be set." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    const auto x_start = opt.get_option<double>("sweepstart");
+    const auto x_step  = opt.get_option<double>("sweepstep");
+    const auto x_stop  = opt.get_option<double>("sweepstop");
+
+    if(x_step <= 0 || x_stop < x_start)
+    {
+        std::cerr << "Parameter sweep must have a positive step, and must stop above its start." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    const size_t nx = floor((x_stop - x_start)/x_step + 1e-6) + 1;
+    return arma::linspace(x_start, x_start + (nx-1)*x_step, nx);
+}
+
+/**
+ * \brief Write a table of energies from a parameter sweep
+ *
+ * \param[in] fname Name of output file
+ * \param[in] x     Value of swept parameter at each point
+ * \param[in] E     Energy of each state at each point [J]
+ */
+void write_sweep(const std::string &fname,
+                 const arma::vec   &x,
+                 const arma::mat   &E)
+{
+    TableWriter stream(fname);
+
+    for(unsigned int ix = 0; ix < x.size(); ++ix)
+    {
+        stream << x(ix);
+
+        for(unsigned int ist = 0; ist < E.n_cols; ++ist)
+            stream << '\t' << E(ix, ist)*1000/e;
+
+        stream << '\n';
+    }
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
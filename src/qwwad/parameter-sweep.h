@@ -0,0 +1,27 @@
+/**
+ * \file   parameter-sweep.h
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Command-line options and output for sweeps through a model parameter
+ */
+
+#ifndef QWWAD_PARAMETER_SWEEP_H
+#define QWWAD_PARAMETER_SWEEP_H
+
+#include <string>
+#include <armadillo>
+#include "options.h"
+
+namespace QWWAD
+{
+void add_sweep_options(Options           &opt,
+                       const std::string &parameters,
+                       const double       step);
+
+arma::vec get_sweep_values(const Options &opt);
+
+void write_sweep(const std::string &fname,
+                 const arma::vec   &x,
+                 const arma::mat   &E);
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,387 @@
+/**
+ * \file   plane-wave-hamiltonian.cpp
+ * \brief  Matrix-free plane-wave Hamiltonian for pseudopotential calculations
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "plane-wave-hamiltonian.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#include <gsl/gsl_fft_complex.h>
+
+#include "constants.h"
+#include "linear-algebra.h"
+#include "maths-helpers.h"
+
+namespace QWWAD
+{
+using namespace constants;
+
+/**
+ * \brief Map a (possibly negative) grid coordinate onto a periodic grid
+ */
+static size_t wrap(const long n,
+                   const size_t L)
+{
+    const long L_l = static_cast<long>(L);
+    return static_cast<size_t>(((n % L_l) + L_l) % L_l);
+}
+
+/**
+ * \brief Find the largest spacing such that every value is an integer multiple of it
+ *
+ * \param[in] x   Set of values
+ * \param[in] tol Relative tolerance for treating a value as an integer multiple
+ *
+ * \returns The spacing, or zero if all values are zero
+ */
+static double find_grid_spacing(const std::vector<double> &x,
+                                const double               tol)
+{
+    double x_max = 0.0;
+
+    for(auto const xi : x)
+        x_max = std::max(x_max, std::abs(xi));
+
+    double delta = 0.0;
+
+    // Euclid's algorithm, run over the magnitudes of all the values
+    for(auto const xi : x)
+    {
+        double a = std::abs(xi);
+
+        if(a <= tol*x_max)
+            continue;
+
+        double b = delta;
+
+        while(b > tol*x_max)
+        {
+            const double r = std::fmod(a, b);
+            a = b;
+            b = (r > b - tol*x_max) ? 0.0 : r;
+        }
+
+        delta = a;
+    }
+
+    return delta;
+}
+
+/**
+ * \brief Set up a plane-wave Hamiltonian
+ *
+ * \param[in] G   Basis of reciprocal lattice vectors [1/m]
+ * \param[in] V_q Fourier component of the crystal potential at a given wave vector [J]
+ *
+ * \details The potential is evaluated once at every point in the FFT grid and
+ *          transformed to real space, so the same object can be used for any
+ *          number of wave vectors.
+ */
+PlaneWaveHamiltonian::PlaneWaveHamiltonian(const std::vector<arma::vec>                                &G,
+                                           const std::function<std::complex<double> (const arma::vec &)> &V_q) :
+    _G(G),
+    _L(),
+    _iG(G.size()),
+    _V_r(),
+    _V0(0.0)
+{
+    const size_t N = _G.size();
+
+    if(N == 0)
+        throw std::length_error("Plane-wave basis is empty.");
+
+    const double tol = 1e-6;
+    double delta[3]; // Spacing of basis along each axis [1/m]
+    long   R[3];     // Largest grid coordinate of any basis vector along each axis
+    std::vector< std::vector<long> > n(3, std::vector<long>(N)); // Grid coordinates of basis
+
+    for(unsigned int c = 0; c < 3; ++c)
+    {
+        std::vector<double> Gc(N);
+
+        for(unsigned int iG = 0; iG < N; ++iG)
+            Gc[iG] = _G[iG](c);
+
+        delta[c] = find_grid_spacing(Gc, tol);
+        R[c]     = 0;
+
+        for(unsigned int iG = 0; iG < N; ++iG)
+        {
+            if(delta[c] > 0)
+            {
+                const double n_real = Gc[iG]/delta[c];
+                n[c][iG] = std::lround(n_real);
+
+                if(std::abs(n_real - n[c][iG]) > 1e-4)
+                {
+                    std::ostringstream oss;
+                    oss << "Reciprocal lattice vector " << iG+1 << " does not lie on a regular grid, "
+                        << "so the matrix-free Hamiltonian cannot be used.";
+                    throw std::runtime_error(oss.str());
+                }
+            }
+            else
+                n[c][iG] = 0;
+
+            R[c] = std::max(R[c], std::abs(n[c][iG]));
+        }
+
+        // The grid must hold every difference between a pair of basis vectors
+        // (i.e., coordinates from -2R to 2R) without them wrapping onto each other
+        _L[c] = next_pow2(4*R[c] + 1);
+    }
+
+    for(unsigned int iG = 0; iG < N; ++iG)
+        _iG[iG] = wrap(n[0][iG], _L[0]) + _L[0]*(wrap(n[1][iG], _L[1]) + _L[1]*wrap(n[2][iG], _L[2]));
+
+    // Tabulate the potential at every difference vector, and transform it
+    _V_r.assign(get_grid_size(), 0.0);
+    arma::vec q(3);
+
+    for(long nz = -2*R[2]; nz <= 2*R[2]; ++nz)
+    {
+        for(long ny = -2*R[1]; ny <= 2*R[1]; ++ny)
+        {
+            for(long nx = -2*R[0]; nx <= 2*R[0]; ++nx)
+            {
+                q(0) = nx*delta[0];
+                q(1) = ny*delta[1];
+                q(2) = nz*delta[2];
+
+                const size_t i = wrap(nx, _L[0]) + _L[0]*(wrap(ny, _L[1]) + _L[1]*wrap(nz, _L[2]));
+                _V_r[i] = V_q(q);
+            }
+        }
+    }
+
+    _V0 = _V_r[0].real();
+    fft(_V_r, false);
+}
+
+/**
+ * \brief Perform a 3D FFT in place on the grid
+ *
+ * \param[in,out] data    Data on the FFT grid
+ * \param[in]     inverse True for an inverse (normalised) transform
+ *
+ * \details The transform is built from 1D radix-2 transforms along each axis in turn.
+ */
+void PlaneWaveHamiltonian::fft(std::vector<std::complex<double>> &data,
+                               const bool                          inverse) const
+{
+    // std::complex<double> is layout-compatible with GSL's packed complex arrays
+    auto packed = reinterpret_cast<double *>(data.data());
+
+    const size_t stride[3] = {1, _L[0], _L[0]*_L[1]};
+
+    for(unsigned int c = 0; c < 3; ++c)
+    {
+        if(_L[c] == 1)
+            continue;
+
+        // Indices of the other two axes
+        const unsigned int a = (c+1)%3;
+        const unsigned int b = (c+2)%3;
+
+        for(size_t ib = 0; ib < _L[b]; ++ib)
+        {
+            for(size_t ia = 0; ia < _L[a]; ++ia)
+            {
+                double *start = packed + 2*(ia*stride[a] + ib*stride[b]);
+
+                if(inverse)
+                    gsl_fft_complex_radix2_inverse(start, stride[c], _L[c]);
+                else
+                    gsl_fft_complex_radix2_forward(start, stride[c], _L[c]);
+            }
+        }
+    }
+}
+
+/**
+ * \brief Find the kinetic energy of each plane wave at a given wave vector
+ *
+ * \param[in] k Wave vector [1/m]
+ *
+ * \returns The diagonal kinetic energy term for each basis vector [J]
+ */
+arma::vec PlaneWaveHamiltonian::get_kinetic_energy(const arma::vec &k) const
+{
+    const size_t N = _G.size();
+    arma::vec T(N);
+
+    for(unsigned int iG = 0; iG < N; ++iG)
+    {
+        // kinetic energy component of H_GG [QWWAD3, 15.77]
+        const arma::vec G_plus_k = _G[iG] + k;
+        T(iG) = hBar*hBar/(2*me) * dot(G_plus_k, G_plus_k);
+    }
+
+    return T;
+}
+
+/**
+ * \brief Apply the Hamiltonian to a set of vectors
+ *
+ * \param[in] X Coefficients of each vector in the plane-wave basis (one per column)
+ * \param[in] T Kinetic energy of each plane wave [J]
+ *
+ * \returns The product HX
+ */
+arma::cx_mat PlaneWaveHamiltonian::apply(const arma::cx_mat &X,
+                                         const arma::vec    &T) const
+{
+    const size_t N = _G.size();
+
+    if(X.n_rows != N || T.size() != N)
+    {
+        std::ostringstream oss;
+        oss << "Cannot apply Hamiltonian with " << N << " basis vectors to vectors of length "
+            << X.n_rows << " using " << T.size() << " kinetic energies.";
+        throw std::length_error(oss.str());
+    }
+
+    arma::cx_mat Y = arma::diagmat(T) * X;
+    std::vector<std::complex<double>> psi_r(get_grid_size());
+
+    for(arma::uword icol = 0; icol < X.n_cols; ++icol)
+    {
+        std::fill(psi_r.begin(), psi_r.end(), 0.0);
+
+        for(unsigned int iG = 0; iG < N; ++iG)
+            psi_r[_iG[iG]] = X(iG, icol);
+
+        // Multiply by the potential in real space
+        fft(psi_r, false);
+
+        for(size_t i = 0; i < psi_r.size(); ++i)
+            psi_r[i] *= _V_r[i];
+
+        fft(psi_r, true);
+
+        for(unsigned int iG = 0; iG < N; ++iG)
+            Y(iG, icol) += psi_r[_iG[iG]];
+    }
+
+    return Y;
+}
+
+/**
+ * \brief Make a set of guess vectors from the plane waves with the lowest diagonal energies
+ *
+ * \param[in] H_diag Diagonal of the Hamiltonian
+ * \param[in] first  Index (in order of diagonal energy) of the first plane wave to use
+ * \param[in] m      Number of vectors to make
+ *
+ * \details A small, reproducible perturbation is added, to break the symmetry
+ *          between degenerate plane waves.
+ */
+static arma::cx_mat get_plane_wave_guess(const arma::vec &H_diag,
+                                         const size_t     first,
+                                         const size_t     m)
+{
+    const size_t     N     = H_diag.size();
+    const arma::uvec order = arma::sort_index(H_diag);
+    arma::cx_mat     psi(N, m, arma::fill::zeros);
+
+    std::mt19937 rng(1 + first);
+    std::uniform_real_distribution<double> dist(-1e-3, 1e-3);
+
+    for(size_t i = 0; i < m; ++i)
+    {
+        for(size_t iG = 0; iG < N; ++iG)
+            psi(iG, i) = std::complex<double>(dist(rng), dist(rng));
+
+        psi(order(first + i), i) += 1.0;
+    }
+
+    return psi;
+}
+
+/**
+ * \brief Find the lowest eigenstates at a given wave vector
+ *
+ * \param[in]  k   Wave vector [1/m]
+ * \param[in]  n   Number of states to find
+ * \param[in]  tol Convergence threshold for the residual of each state [J]
+ * \param[out] psi Coefficients of each eigenvector in the plane-wave basis
+ *
+ * \returns The energy of each state [J]
+ *
+ * \details The initial guess is the set of plane waves with the lowest
+ *          kinetic energies, with a small, reproducible perturbation to break
+ *          the symmetry between degenerate plane waves.  A few extra guard vectors
+ *          are carried through the calculation to speed up convergence.
+ */
+arma::vec PlaneWaveHamiltonian::get_lowest_states(const arma::vec    &k,
+                                                  const unsigned int  n,
+                                                  const double        tol,
+                                                  arma::cx_mat       &psi) const
+{
+    const size_t N = _G.size();
+    const arma::vec T = get_kinetic_energy(k);
+    const arma::vec H_diag = T + _V0;
+
+    const size_t m = std::min<size_t>(N, n + std::max<unsigned int>(4, n/4)); // Block size
+
+    psi = get_plane_wave_guess(H_diag, 0, m);
+
+    const auto apply_H = [&](const arma::cx_mat &X) {return apply(X, T);};
+
+    return eigen_hermitian_lobpcg(apply_H, H_diag, psi, n, tol);
+}
+
+/**
+ * \brief Find the lowest eigenstates at a wave vector, starting from those at a nearby one
+ *
+ * \param[in]     k   Wave vector [1/m]
+ * \param[in]     n   Number of states to find
+ * \param[in]     tol Convergence threshold for the residual of each state [J]
+ * \param[in,out] psi On input, the lowest n eigenvectors at a nearby wave vector
+ *                    (e.g., the previous point on a path).  On output, the
+ *                    eigenvectors at k.
+ *
+ * \returns The energy of each state [J]
+ *
+ * \details The eigenvectors change little between neighbouring wave vectors, so
+ *          this usually converges in a few iterations, rather than the many that
+ *          are needed from plane waves.  The guard vectors are made from plane
+ *          waves, as in get_lowest_states.
+ */
+arma::vec PlaneWaveHamiltonian::refine_lowest_states(const arma::vec    &k,
+                                                     const unsigned int  n,
+                                                     const double        tol,
+                                                     arma::cx_mat       &psi) const
+{
+    const size_t N = _G.size();
+
+    if(psi.n_rows != N || psi.n_cols < n || n == 0)
+    {
+        std::ostringstream oss;
+        oss << "Cannot start from " << psi.n_cols << " vectors of length " << psi.n_rows
+            << " to find " << n << " states in a basis of " << N << " plane waves.";
+        throw std::length_error(oss.str());
+    }
+
+    const arma::vec T = get_kinetic_energy(k);
+    const arma::vec H_diag = T + _V0;
+
+    const size_t m = std::min<size_t>(N, n + std::max<unsigned int>(4, n/4)); // Block size
+
+    if(m > n)
+        psi = arma::join_rows(psi.cols(0, n-1), get_plane_wave_guess(H_diag, n, m-n));
+    else
+        psi = psi.cols(0, n-1);
+
+    const auto apply_H = [&](const arma::cx_mat &X) {return apply(X, T);};
+
+    return eigen_hermitian_lobpcg(apply_H, H_diag, psi, n, tol);
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
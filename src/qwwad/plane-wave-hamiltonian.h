@@ -0,0 +1,81 @@
+/**
+ * \file   plane-wave-hamiltonian.h
+ * \brief  Matrix-free plane-wave Hamiltonian for pseudopotential calculations
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_PLANE_WAVE_HAMILTONIAN_H
+#define QWWAD_PLANE_WAVE_HAMILTONIAN_H
+
+#include <complex>
+#include <functional>
+#include <vector>
+
+#include <armadillo>
+
+namespace QWWAD
+{
+/**
+ * \brief A plane-wave Hamiltonian that is applied using FFTs rather than stored
+ *
+ * \details The Hamiltonian for a wave vector \f$\mathbf{k}\f$ in a basis of
+ *          reciprocal lattice vectors \f$\mathbf{G}\f$ is
+ *          \f[
+ *            H_{\mathbf{G}\mathbf{G}'} = \frac{\hbar^2|\mathbf{G}+\mathbf{k}|^2}{2m_0}\delta_{\mathbf{G}\mathbf{G}'}
+ *                                      + V(\mathbf{G}-\mathbf{G}').
+ *          \f]
+ *          The kinetic term is diagonal in reciprocal space.  The potential term is a
+ *          convolution in reciprocal space, which is found by transforming the
+ *          wavefunction onto a real-space grid, multiplying by the local potential
+ *          and transforming back.  The cost of applying H is therefore
+ *          O(n log n) for an FFT grid of n points, and the memory needed is O(n),
+ *          rather than O(N^2) for the dense matrix in an N-vector basis.
+ *
+ *          The basis vectors must lie on a regular Cartesian grid, which is the case
+ *          for cubic and orthorhombic (super)cells.  The FFT grid is large enough
+ *          to hold every difference between basis vectors without aliasing, so the
+ *          result is identical to multiplying by the dense matrix.
+ */
+class PlaneWaveHamiltonian
+{
+private:
+    std::vector<arma::vec> _G;    ///< Basis of reciprocal lattice vectors [1/m]
+    size_t                 _L[3]; ///< Size of the FFT grid along each axis
+    std::vector<size_t>    _iG;   ///< Index of each basis vector within the FFT grid
+
+    /// Transform of the potential onto the real-space grid
+    std::vector<std::complex<double>> _V_r;
+
+    double _V0; ///< Average potential, V(G=0) [J]
+
+    void fft(std::vector<std::complex<double>> &data,
+             const bool                          inverse) const;
+
+public:
+    PlaneWaveHamiltonian(const std::vector<arma::vec>                                &G,
+                         const std::function<std::complex<double> (const arma::vec &)> &V_q);
+
+    /** Return the number of basis vectors */
+    size_t size() const {return _G.size();}
+
+    /** Return the number of points in the FFT grid */
+    size_t get_grid_size() const {return _L[0]*_L[1]*_L[2];}
+
+    arma::vec get_kinetic_energy(const arma::vec &k) const;
+
+    arma::cx_mat apply(const arma::cx_mat &X,
+                       const arma::vec    &T) const;
+
+    arma::vec get_lowest_states(const arma::vec    &k,
+                                const unsigned int  n,
+                                const double        tol,
+                                arma::cx_mat       &psi) const;
+
+    arma::vec refine_lowest_states(const arma::vec    &k,
+                                   const unsigned int  n,
+                                   const double        tol,
+                                   arma::cx_mat       &psi) const;
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,414 @@
+/**
+ * \file   poisson-solver-2D.cpp
+ * \brief  Poisson solver over a two-dimensional cross-section
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "poisson-solver-2D.h"
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace QWWAD
+{
+/**
+ * Scaling of the coarse-grid correction in the V-cycle.  Merging points
+ * into blocks gives a piecewise-constant correction, which underestimates
+ * smooth errors, so it is over-corrected.  This roughly halves the number
+ * of iterations on large meshes.
+ */
+static const double coarse_scale = 1.8;
+
+/// Largest number of conjugate-gradient iterations before giving up
+static const unsigned int max_iterations = 1000;
+
+/**
+ * \brief Find the spacing between samples along one axis
+ *
+ * \param[in]  x        Sample locations [m]
+ * \param[in]  name     Name of the axis, for error messages
+ * \param[out] dx_minus Distance to the previous point [m]
+ * \param[out] dx_plus  Distance to the next point [m]
+ * \param[out] h        Width of the cell around each point [m]
+ *
+ * \details The mesh is mirrored at each end, as in PoissonSolver
+ */
+static void get_spacing(const arma::vec   &x,
+                        const std::string &name,
+                        arma::vec         &dx_minus,
+                        arma::vec         &dx_plus,
+                        arma::vec         &h)
+{
+    const size_t n = x.size();
+
+    if(n < 2)
+    {
+        std::ostringstream oss;
+        oss << "At least two samples are needed in " << name << ".";
+        throw std::length_error(oss.str());
+    }
+
+    dx_minus.set_size(n);
+    dx_plus.set_size(n);
+    h.set_size(n);
+
+    for(unsigned int i = 0; i < n; ++i)
+    {
+        dx_minus(i) = (i == 0)   ? x(1)   - x(0)   : x(i)   - x(i-1);
+        dx_plus(i)  = (i == n-1) ? x(n-1) - x(n-2) : x(i+1) - x(i);
+        h(i)        = 0.5 * (dx_minus(i) + dx_plus(i));
+
+        if(dx_minus(i) <= 0 || dx_plus(i) <= 0)
+        {
+            std::ostringstream oss;
+            oss << "Samples in " << name << " must be increasing.";
+            throw std::invalid_argument(oss.str());
+        }
+    }
+}
+
+/**
+ * \brief Check that a boundary condition can be used on an edge
+ *
+ * \returns True if the edge is Dirichlet
+ */
+static bool is_dirichlet(const PoissonBoundaryType bt)
+{
+    if(bt == MIXED)
+        throw std::invalid_argument("Mixed boundaries cannot be used in the 2D Poisson solver.");
+
+    return (bt == DIRICHLET);
+}
+
+/**
+ * \brief Set up the Poisson equation over a cross-section
+ *
+ * \param[in] eps Permittivity at each point (ny x nz) [F/m]
+ * \param[in] y   Sample locations in y [m]
+ * \param[in] z   Sample locations in z [m]
+ * \param[in] bc  Boundary condition on each edge
+ * \param[in] tol Convergence threshold for the residual, relative to the charge
+ */
+PoissonSolver2D::PoissonSolver2D(const arma::mat           &eps,
+                                 const arma::vec           &y,
+                                 const arma::vec           &z,
+                                 const PoissonBoundaries2D &bc,
+                                 const double               tol) :
+    _ny(y.size()),
+    _nz(z.size()),
+    _area(),
+    _levels(),
+    _tol(tol)
+{
+    if(eps.n_rows != _ny || eps.n_cols != _nz)
+    {
+        std::ostringstream oss;
+        oss << "Permittivity array has " << eps.n_rows << "x" << eps.n_cols
+            << " points but spatial arrays have " << _ny << "x" << _nz << ".";
+        throw std::length_error(oss.str());
+    }
+
+    const bool dirichlet_y_start = is_dirichlet(bc.y_start);
+    const bool dirichlet_y_end   = is_dirichlet(bc.y_end);
+    const bool dirichlet_z_start = is_dirichlet(bc.z_start);
+    const bool dirichlet_z_end   = is_dirichlet(bc.z_end);
+
+    if(!dirichlet_y_start && !dirichlet_y_end && !dirichlet_z_start && !dirichlet_z_end)
+        throw std::invalid_argument("At least one edge must have a Dirichlet boundary.");
+
+    arma::vec dy_minus, dy_plus, h_y;
+    arma::vec dz_minus, dz_plus, h_z;
+    get_spacing(y, "y", dy_minus, dy_plus, h_y);
+    get_spacing(z, "z", dz_minus, dz_plus, h_z);
+
+    const size_t n = _ny*_nz;
+
+    Level fine;
+    fine.ny   = _ny;
+    fine.nz   = _nz;
+    fine.diag = arma::zeros(n);
+    fine.c_y  = arma::zeros(n);
+    fine.c_z  = arma::zeros(n);
+    _area.set_size(n);
+
+    // Each coupling is the flux through the face between two cells, per unit
+    // of potential difference [QWWAD4, 3.80]
+    for(unsigned int iy = 0; iy < _ny; ++iy)
+    {
+        for(unsigned int iz = 0; iz < _nz; ++iz)
+        {
+            const size_t p = iy*_nz + iz;
+            _area(p) = h_y(iy)*h_z(iz);
+
+            if(iz+1 < _nz)
+            {
+                const double c = 0.5*(eps(iy, iz) + eps(iy, iz+1)) * h_y(iy)/dz_plus(iz);
+                fine.c_z(p)    = c;
+                fine.diag(p)   += c;
+                fine.diag(p+1) += c;
+            }
+
+            if(iy+1 < _ny)
+            {
+                const double c = 0.5*(eps(iy, iz) + eps(iy+1, iz)) * h_z(iz)/dy_plus(iy);
+                fine.c_y(p)      = c;
+                fine.diag(p)     += c;
+                fine.diag(p+_nz) += c;
+            }
+
+            // Flux into the zero potential at each Dirichlet edge
+            if(iz == 0     && dirichlet_z_start) fine.diag(p) += eps(iy, iz) * h_y(iy)/dz_minus(iz);
+            if(iz == _nz-1 && dirichlet_z_end)   fine.diag(p) += eps(iy, iz) * h_y(iy)/dz_plus(iz);
+            if(iy == 0     && dirichlet_y_start) fine.diag(p) += eps(iy, iz) * h_z(iz)/dy_minus(iy);
+            if(iy == _ny-1 && dirichlet_y_end)   fine.diag(p) += eps(iy, iz) * h_z(iz)/dy_plus(iy);
+        }
+    }
+
+    _levels.push_back(fine);
+
+    // Merge blocks of 2x2 points until a single point is left.  The coarse
+    // matrix is P^T A P, where P copies each coarse value onto its block.
+    while(_levels.back().ny * _levels.back().nz > 1)
+    {
+        const Level &f = _levels.back();
+
+        Level c;
+        c.ny = (f.ny + 1)/2;
+        c.nz = (f.nz + 1)/2;
+
+        const size_t nc = c.ny*c.nz;
+        c.diag = arma::zeros(nc);
+        c.c_y  = arma::zeros(nc);
+        c.c_z  = arma::zeros(nc);
+
+        for(unsigned int iy = 0; iy < f.ny; ++iy)
+        {
+            for(unsigned int iz = 0; iz < f.nz; ++iz)
+            {
+                const size_t p = iy*f.nz + iz;
+                const size_t P = (iy/2)*c.nz + iz/2;
+
+                c.diag(P) += f.diag(p);
+
+                // Couplings inside a block cancel part of the diagonal, and the
+                // rest join neighbouring blocks
+                if(iz+1 < f.nz)
+                {
+                    if(iz % 2 == 0) c.diag(P) -= 2*f.c_z(p);
+                    else            c.c_z(P)  += f.c_z(p);
+                }
+
+                if(iy+1 < f.ny)
+                {
+                    if(iy % 2 == 0) c.diag(P) -= 2*f.c_y(p);
+                    else            c.c_y(P)  += f.c_y(p);
+                }
+            }
+        }
+
+        _levels.push_back(c);
+    }
+}
+
+/**
+ * \brief Multiply a vector by the matrix for one level
+ */
+arma::vec PoissonSolver2D::apply(const Level &level, const arma::vec &x) const
+{
+    const size_t nz = level.nz;
+    arma::vec    Ax = level.diag % x;
+
+    for(size_t p = 0; p < x.size(); ++p)
+    {
+        if((p+1) % nz != 0)
+        {
+            Ax(p)   -= level.c_z(p)*x(p+1);
+            Ax(p+1) -= level.c_z(p)*x(p);
+        }
+
+        if(p+nz < x.size())
+        {
+            Ax(p)    -= level.c_y(p)*x(p+nz);
+            Ax(p+nz) -= level.c_y(p)*x(p);
+        }
+    }
+
+    return Ax;
+}
+
+/**
+ * \brief Perform one Gauss-Seidel sweep through the points
+ *
+ * \param[in]     level   Matrix to solve
+ * \param[in,out] x       Estimate of the solution
+ * \param[in]     b       Right-hand side
+ * \param[in]     forward True to sweep from the first point to the last
+ */
+void PoissonSolver2D::smooth(const Level     &level,
+                             arma::vec       &x,
+                             const arma::vec &b,
+                             const bool       forward) const
+{
+    const size_t n  = x.size();
+    const size_t nz = level.nz;
+
+    for(size_t k = 0; k < n; ++k)
+    {
+        const size_t p  = forward ? k : n-1-k;
+        const size_t iz = p % nz;
+        double       s  = b(p);
+
+        if(iz > 0)    s += level.c_z(p-1)*x(p-1);
+        if(iz+1 < nz) s += level.c_z(p)*x(p+1);
+        if(p >= nz)   s += level.c_y(p-nz)*x(p-nz);
+        if(p+nz < n)  s += level.c_y(p)*x(p+nz);
+
+        x(p) = s/level.diag(p);
+    }
+}
+
+/**
+ * \brief Improve a solution using one multigrid V-cycle
+ *
+ * \param[in]     ilevel Index of the level to solve
+ * \param[in,out] x      Estimate of the solution
+ * \param[in]     b      Right-hand side
+ */
+void PoissonSolver2D::v_cycle(const size_t     ilevel,
+                              arma::vec       &x,
+                              const arma::vec &b) const
+{
+    const Level &level = _levels[ilevel];
+
+    // The coarsest level has a single point
+    if(ilevel+1 == _levels.size())
+    {
+        x = b/level.diag;
+        return;
+    }
+
+    smooth(level, x, b, true);
+
+    const arma::vec r = b - apply(level, x);
+
+    // Restrict the residual onto the blocks of the coarse level
+    const Level &coarse = _levels[ilevel+1];
+    arma::vec    r_c    = arma::zeros(coarse.ny*coarse.nz);
+
+    for(unsigned int iy = 0; iy < level.ny; ++iy)
+    {
+        for(unsigned int iz = 0; iz < level.nz; ++iz)
+            r_c((iy/2)*coarse.nz + iz/2) += r(iy*level.nz + iz);
+    }
+
+    arma::vec x_c = arma::zeros(r_c.size());
+    v_cycle(ilevel+1, x_c, r_c);
+
+    for(unsigned int iy = 0; iy < level.ny; ++iy)
+    {
+        for(unsigned int iz = 0; iz < level.nz; ++iz)
+            x(iy*level.nz + iz) += coarse_scale * x_c((iy/2)*coarse.nz + iz/2);
+    }
+
+    smooth(level, x, b, false);
+}
+
+/**
+ * \brief Solve the Poisson equation for a given charge density
+ *
+ * \param[in] rho Charge density at each point (ny x nz) [C m^{-3}]
+ *
+ * \return The potential at each point (ny x nz)
+ */
+arma::mat PoissonSolver2D::solve(const arma::mat &rho) const
+{
+    return solve(rho, arma::zeros(_ny, _nz));
+}
+
+/**
+ * \brief Solve the Poisson equation, starting from an estimate of the potential
+ *
+ * \param[in] rho       Charge density at each point (ny x nz) [C m^{-3}]
+ * \param[in] phi_guess Initial estimate of the potential (ny x nz), e.g., from
+ *                      the previous step of a self-consistent calculation
+ *
+ * \return The potential at each point (ny x nz)
+ */
+arma::mat PoissonSolver2D::solve(const arma::mat &rho,
+                                 const arma::mat &phi_guess) const
+{
+    if(rho.n_rows != _ny || rho.n_cols != _nz || phi_guess.n_rows != _ny || phi_guess.n_cols != _nz)
+        throw std::length_error("Permittivity and charge density arrays have different sizes");
+
+    const Level &fine = _levels.front();
+    const size_t n    = _ny*_nz;
+
+    // Flatten, with z running fastest, and find the charge in each cell
+    arma::vec b(n);
+    arma::vec x(n);
+
+    for(unsigned int iy = 0; iy < _ny; ++iy)
+    {
+        for(unsigned int iz = 0; iz < _nz; ++iz)
+        {
+            const size_t p = iy*_nz + iz;
+            b(p) = rho(iy, iz) * _area(p);
+            x(p) = phi_guess(iy, iz);
+        }
+    }
+
+    const double b_norm = arma::norm(b);
+    arma::vec    r      = b - apply(fine, x);
+
+    if(b_norm == 0.0)
+        return arma::zeros(_ny, _nz);
+
+    arma::vec z = arma::zeros(n);
+    v_cycle(0, z, r);
+
+    arma::vec d   = z;
+    double    r_z = arma::dot(r, z);
+    bool      converged = (arma::norm(r) <= _tol*b_norm);
+
+    for(unsigned int iter = 0; iter < max_iterations && !converged; ++iter)
+    {
+        const arma::vec Ad    = apply(fine, d);
+        const double    alpha = r_z/arma::dot(d, Ad);
+
+        x += alpha*d;
+        r -= alpha*Ad;
+
+        converged = (arma::norm(r) <= _tol*b_norm);
+
+        if(!converged)
+        {
+            z.zeros();
+            v_cycle(0, z, r);
+
+            const double r_z_new = arma::dot(r, z);
+            d   = z + (r_z_new/r_z)*d;
+            r_z = r_z_new;
+        }
+    }
+
+    if(!converged)
+    {
+        std::ostringstream oss;
+        oss << "2D Poisson solver did not converge in " << max_iterations << " iterations.";
+        throw std::runtime_error(oss.str());
+    }
+
+    arma::mat phi(_ny, _nz);
+
+    for(unsigned int iy = 0; iy < _ny; ++iy)
+    {
+        for(unsigned int iz = 0; iz < _nz; ++iz)
+            phi(iy, iz) = x(iy*_nz + iz);
+    }
+
+    return phi;
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,115 @@
+/**
+ * \file   poisson-solver-2D.h
+ * \brief  Poisson solver over a two-dimensional cross-section
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_POISSON_SOLVER_2D_H
+#define QWWAD_POISSON_SOLVER_2D_H
+
+#include <vector>
+#include <armadillo>
+
+#include "poisson-solver.h"
+
+namespace QWWAD
+{
+/**
+ * \brief Boundary condition on each edge of a two-dimensional Poisson problem
+ *
+ * \details Each edge may be DIRICHLET (zero potential just outside the mesh) or
+ *          ZERO_FIELD (zero normal component of the field).
+ */
+struct PoissonBoundaries2D
+{
+    PoissonBoundaryType y_start; ///< Edge at the first sample in y
+    PoissonBoundaryType y_end;   ///< Edge at the last sample in y
+    PoissonBoundaryType z_start; ///< Edge at the first sample in z
+    PoissonBoundaryType z_end;   ///< Edge at the last sample in z
+
+    /// Use the same condition on every edge
+    PoissonBoundaries2D(const PoissonBoundaryType bt = DIRICHLET) :
+        y_start(bt), y_end(bt), z_start(bt), z_end(bt)
+    {}
+
+    /// Use one condition on both edges in y, and another on both edges in z
+    PoissonBoundaries2D(const PoissonBoundaryType bt_y,
+                        const PoissonBoundaryType bt_z) :
+        y_start(bt_y), y_end(bt_y), z_start(bt_z), z_end(bt_z)
+    {}
+
+    PoissonBoundaries2D(const PoissonBoundaryType bt_y_start,
+                        const PoissonBoundaryType bt_y_end,
+                        const PoissonBoundaryType bt_z_start,
+                        const PoissonBoundaryType bt_z_end) :
+        y_start(bt_y_start), y_end(bt_y_end), z_start(bt_z_start), z_end(bt_z_end)
+    {}
+};
+
+/**
+ * \brief Solver for the Poisson equation over the (y,z) cross-section of a wire
+ *
+ * \details The finite-difference matrix follows the same conventions as
+ *          PoissonSolver along each axis: the samples are at the centres of
+ *          cells, the permittivity between neighbouring points is their
+ *          mean, and each row is multiplied by the area of the cell around
+ *          the point so that the matrix stays symmetric on a nonuniform mesh.
+ *          At a Dirichlet edge, the potential is zero one mesh spacing outside
+ *          the structure.  At least one edge must be Dirichlet, so that the
+ *          potential is defined uniquely.
+ *
+ *          The equations are solved using the conjugate-gradient method,
+ *          preconditioned by one multigrid V-cycle.  Each coarse level merges
+ *          blocks of 2x2 points, and its matrix is found from the level above
+ *          by Galerkin projection, so it stays a 5-point stencil and handles
+ *          jumps in permittivity without any geometric input.  The smoother is
+ *          a forward Gauss-Seidel sweep on the way down and a backward sweep
+ *          on the way up, which keeps the preconditioner symmetric.  Only the
+ *          stencil is stored, so the memory and the work for each iteration
+ *          are proportional to the number of points, and the number of
+ *          iterations grows only slowly with the size of the mesh.
+ *
+ *          Points are indexed with z running fastest, as in
+ *          SchroedingerSolverWire.  The permittivity, charge density and
+ *          potential are (ny x nz) matrices.
+ */
+class PoissonSolver2D
+{
+private:
+    /// Matrix for one level of the multigrid hierarchy
+    struct Level
+    {
+        size_t    ny;   ///< Number of points in y
+        size_t    nz;   ///< Number of points in z
+        arma::vec diag; ///< Diagonal of the matrix
+        arma::vec c_y;  ///< Coupling between points p and p+nz
+        arma::vec c_z;  ///< Coupling between points p and p+1 (zero at the end of each line)
+    };
+
+    size_t             _ny;     ///< Number of points in y
+    size_t             _nz;     ///< Number of points in z
+    arma::vec          _area;   ///< Area of the cell around each point [m^2]
+    std::vector<Level> _levels; ///< Multigrid hierarchy, finest first
+    double             _tol;    ///< Convergence threshold for the relative residual
+
+    arma::vec apply(const Level &level, const arma::vec &x) const;
+    void smooth(const Level &level, arma::vec &x, const arma::vec &b, const bool forward) const;
+    void v_cycle(const size_t ilevel, arma::vec &x, const arma::vec &b) const;
+
+public:
+    PoissonSolver2D(const arma::mat           &eps,
+                    const arma::vec           &y,
+                    const arma::vec           &z,
+                    const PoissonBoundaries2D &bc  = PoissonBoundaries2D(),
+                    const double               tol = 1e-10);
+
+    arma::mat solve(const arma::mat &rho) const;
+    arma::mat solve(const arma::mat &rho,
+                    const arma::mat &phi_guess) const;
+
+    /// Return the number of levels in the multigrid hierarchy
+    size_t get_n_levels() const {return _levels.size();}
+};
+} // namespace
+#endif //QWWAD_POISSON_SOLVER_2D_H
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -10,12 +10,13 @@
 #include "linear-algebra.h"
 #include "poisson-solver.h"
 
+#include <sstream>
 #include <stdexcept>
 
 namespace QWWAD
 {
 /**
- * Create a Poisson solver
+ * Create a Poisson solver on a uniform mesh
  *
  * \param[in] eps Permittivity at each point
  * \param[in] dx  Spatial step [m]
@@ -24,26 +25,73 @@ namespace QWWAD
 PoissonSolver::PoissonSolver(const decltype(_eps) &eps,
                              const double          dx,
                              PoissonBoundaryType   bt) :
+    PoissonSolver(eps, uniform_positions(eps.size(), dx), bt)
+{}
+
+/**
+ * Create a Poisson solver
+ *
+ * \param[in] eps Permittivity at each point
+ * \param[in] z   Spatial position of each point [m]
+ * \param[in] bt  Poisson boundary condition type
+ *
+ * \details The points need not be evenly spaced.  Each row of the matrix is
+ *          multiplied by the width of the cell around the point, which keeps
+ *          the matrix symmetric on a nonuniform mesh.  The charge density is
+ *          scaled by the same cell width when solving.
+ */
+PoissonSolver::PoissonSolver(const decltype(_eps) &eps,
+                             const arma::vec      &z,
+                             PoissonBoundaryType   bt) :
     _eps(eps),
     _eps_minus(eps), // Set the half-index permittivities
     _eps_plus(eps),  // to a default for now
-    _dx(dx), // Size of cells in mesh
-    _L(_eps.size() * _dx), // Samples are at CENTRE of each cell so total length of structure is nx dx
+    _dz_minus(arma::zeros(_eps.size())),
+    _dz_plus(arma::zeros(_eps.size())),
+    _h(arma::zeros(_eps.size())),
+    _L(0.0),
     _diag(arma::zeros(_eps.size())),
     _sub_diag(arma::zeros(_eps.size()-1)),
     _corner_point(0.0),
-    _D_diag(arma::zeros(_eps.size())),
-    _L_sub(arma::zeros(_eps.size()-1)),
+    _factorisation(),
+    _cyclic_diag(),
+    _cyclic_fill(),
+    _laplace_unit(),
+    _linear_diag(),
+    _linear_factorisation(),
+    _linear_cyclic_diag(),
+    _linear_cyclic_fill(),
     _boundary_type(bt)
 {
-    compute_half_index_permittivity();
-
     const size_t ni = _eps.size();
 
+    if (z.size() != ni)
+    {
+        std::ostringstream oss;
+        oss << "Permittivity array has " << ni << " points but spatial array has " << z.size() << ".";
+        throw std::length_error(oss.str());
+    }
+
+    if (ni < 2)
+        throw std::length_error("Need at least two points to solve the Poisson equation");
+
+    // Find separation between points. The mesh is mirrored at each end
+    for(unsigned int i=0; i < ni; ++i)
+    {
+        _dz_minus(i) = (i == 0)    ? z(1)    - z(0)    : z(i)   - z(i-1);
+        _dz_plus(i)  = (i == ni-1) ? z(ni-1) - z(ni-2) : z(i+1) - z(i);
+        _h(i)        = 0.5 * (_dz_minus(i) + _dz_plus(i));
+    }
+
+    // Samples are at CENTRE of each cell so total length of structure is the sum of cell widths
+    _L = sum(_h);
+
+    compute_half_index_permittivity();
+
     // Sub-diagonal elements a_(i+1), c_i [QWWAD4, 3.80]
     for(unsigned int i=0; i < ni-1; ++i)
     {
-        _sub_diag(i) = -_eps_plus(i) / (_dx * _dx);
+        _sub_diag(i) = -_eps_plus(i) / _dz_plus(i);
     }
 
     switch(_boundary_type)
@@ -58,6 +106,25 @@ PoissonSolver::PoissonSolver(const decltype(_eps) &eps,
             factorise_zerofield();
             break;
    }
+
+    compute_laplace_solution();
+}
+
+/**
+ * \brief Generate the positions of the centres of evenly spaced cells
+ *
+ * \param[in] n  Number of cells
+ * \param[in] dx Width of each cell [m]
+ */
+arma::vec PoissonSolver::uniform_positions(const size_t n,
+                                           const double dx)
+{
+    arma::vec z(n);
+
+    for(unsigned int i=0; i < n; ++i)
+        z(i) = (i + 0.5) * dx;
+
+    return z;
 }
 
 /**
@@ -95,19 +162,30 @@ void PoissonSolver::compute_half_index_permittivity()
     }
 }
 
-void PoissonSolver::factorise_dirichlet()
+/**
+ * \brief Find the diagonal of the Poisson matrix with Dirichlet boundaries
+ */
+arma::vec PoissonSolver::dirichlet_diagonal() const
 {
-    // Fill matrix to solve
     const size_t ni = _eps.size();
+    arma::vec diag(ni);
 
     // Diagonal elements b_i [QWWAD4, 3.80]
     for(unsigned int i=0; i < ni; i++)
     {
-        _diag(i) = (_eps_plus(i) + _eps_minus(i)) / (_dx * _dx);
+        diag(i) = _eps_plus(i)/_dz_plus(i) + _eps_minus(i)/_dz_minus(i);
     }
 
+    return diag;
+}
+
+void PoissonSolver::factorise_dirichlet()
+{
+    // Fill matrix to solve
+    _diag = dirichlet_diagonal();
+
     // Factorise matrix
-    factorise_tridiag_LDL_T(_diag, _sub_diag, _D_diag, _L_sub);
+    _factorisation.factorise(_diag, _sub_diag);
 }
 
 void PoissonSolver::factorise_mixed()
@@ -119,14 +197,16 @@ void PoissonSolver::factorise_mixed()
         // Diagonal elements
         if(i<ni-1)
         {
-            _diag(i) = (_eps_plus(i) + _eps_minus(i)) / (_dx * _dx);
+            _diag(i) = _eps_plus(i)/_dz_plus(i) + _eps_minus(i)/_dz_minus(i);
         }
         else
         {
-            _diag(i) = _eps_minus(i) / (_dx * _dx);
-            _corner_point = _eps_plus(i) / (_dx * _dx);
+            _diag(i) = _eps_minus(i) / _dz_minus(i);
+            _corner_point = _eps_plus(i) / _dz_plus(i);
         }
     }
+
+    factorise_cyclic();
 }
 
 void PoissonSolver::factorise_zerofield()
@@ -138,20 +218,94 @@ void PoissonSolver::factorise_zerofield()
         // Diagonal elements
         if(i==0)
         {
-            _diag(i) = _eps_plus(i) / (_dx * _dx);
+            _diag(i) = _eps_plus(i) / _dz_plus(i);
         }
         else if(i==ni-1)
         {
-            _diag(i) = _eps_minus(i) / (_dx * _dx);
+            _diag(i) = _eps_minus(i) / _dz_minus(i);
         }
         else
         {
-            _diag(i) = (_eps_plus(i) + _eps_minus(i)) / (_dx * _dx);
+            _diag(i) = _eps_plus(i)/_dz_plus(i) + _eps_minus(i)/_dz_minus(i);
         }
     }
 
     // Factorise matrix
-    factorise_tridiag_LDL_T(_diag, _sub_diag, _D_diag, _L_sub);
+    _factorisation.factorise(_diag, _sub_diag);
+    factorise_cyclic();
+}
+
+/**
+ * \brief Perform the forward sweep through the cyclic Poisson matrix
+ *
+ * \details This is the part of the elimination in solve_cyclic_matrix that depends
+ *          only on the matrix, so it is done once and stored.
+ */
+void PoissonSolver::factorise_cyclic()
+{
+    const size_t ni = _diag.size();
+
+    _cyclic_diag = _diag;
+    _cyclic_fill.set_size(ni);
+    _cyclic_fill[0] = 1;
+
+    for(unsigned int i=1; i<ni-1; i++)
+    {
+        _cyclic_diag[i] -= _sub_diag[i-1]*_sub_diag[i-1]/_cyclic_diag[i-1];
+        _cyclic_fill[i]  = -_cyclic_fill[i-1]*_sub_diag[i-1]/_cyclic_diag[i-1];
+    }
+
+    _cyclic_diag[ni-1] -= (_sub_diag[ni-2] + _corner_point*_cyclic_fill[ni-2])*_sub_diag[ni-2]
+                          /_cyclic_diag[ni-2];
+}
+
+/**
+ * \brief Solve the cyclic Poisson matrix equation using the stored forward sweep
+ *
+ * \param[in,out] b Right-hand side.  Overwritten by the solution.
+ */
+void PoissonSolver::solve_cyclic_in_place(arma::vec &b) const
+{
+    const size_t ni = _cyclic_diag.size();
+
+    for(unsigned int i=1; i<ni-1; i++)
+        b[i] -= _sub_diag[i-1]*b[i-1]/_cyclic_diag[i-1];
+
+    // Last row picks up the fill-in from the corner point
+    double sum = 0.0;
+    for(unsigned int i=0; i<ni-2; i++)
+        sum += -_corner_point*_cyclic_fill[i]*b[i]/_cyclic_diag[i];
+
+    b[ni-1] += sum - (_sub_diag[ni-2] + _corner_point*_cyclic_fill[ni-2])*b[ni-2]/_cyclic_diag[ni-2];
+
+    for(int i=ni-2; i>-1; i--)
+        b[i] -= _sub_diag[i]*b[i+1]/_cyclic_diag[i+1];
+
+    b /= _cyclic_diag;
+}
+
+/**
+ * \brief Find the solution of the Laplace equation for a unit potential drop
+ *
+ * \details With mixed boundaries, a bias cannot be applied directly, so the
+ *          Laplace equation is solved with Dirichlet boundaries instead.  This is
+ *          the solution that needs adding to the cyclic solution of the Poisson
+ *          equation to give the required potential drop.
+ */
+void PoissonSolver::compute_laplace_solution()
+{
+    if(_boundary_type == MIXED)
+    {
+        const size_t n    = _eps.size();
+        const auto   diag = dirichlet_diagonal();
+
+        _laplace_unit = arma::zeros(n);
+        _laplace_unit(n-1) = diag(n-1) * _L / (_L + _dz_plus(n-1));
+        TridiagFactorisation(diag, _sub_diag).solve_in_place(_laplace_unit);
+        _laplace_unit -= _laplace_unit(0);
+    }
+    else
+        _laplace_unit = solve(arma::zeros(_eps.size()), 1.0);
 }
 
 /**
@@ -170,18 +324,16 @@ arma::vec PoissonSolver::solve(const arma::vec &rho) const
         throw std::runtime_error("Permittivity and charge density arrays have different sizes");
     }
 
-    auto rhs = rho; // Set right-hand-side to the charge-density
-    auto phi = rhs; // Array in which to output the potential [J]
+    arma::vec phi = rho % _h; // Array in which to output the potential [J]. Initially set to the charge in each cell
 
     switch(_boundary_type)
     {
         case DIRICHLET:
-            phi = solve_tridiag_LDL_T(_D_diag, _L_sub, rhs);
+            _factorisation.solve_in_place(phi);
             break;
         case MIXED:
         case ZERO_FIELD:
-            phi = solve_cyclic_matrix(_sub_diag,
-                                      _diag, _corner_point, rho);
+            solve_cyclic_in_place(phi);
             break;
     }
 
@@ -206,7 +358,7 @@ arma::vec PoissonSolver::solve(const arma::vec &rho,
         throw std::runtime_error("Permittivity and charge density arrays have different sizes");
     }
 
-    auto rhs = rho; // Set right-hand-side to the charge-density
+    arma::vec rhs = rho % _h; // Set right-hand-side to the charge in each cell
 
     // We want to fix the potential just BEFORE the structure to 0
     //   i.e., phi[-1] = 0
@@ -214,8 +366,8 @@ arma::vec PoissonSolver::solve(const arma::vec &rho,
     // point in the system takes this value
     //   i.e., phi[n-1] = V_drop = F * length
     // so the first point AFTER the structure has the potential
-    //   phi[n] = F * (length + dz) = V_drop + F dz = V_drop (nz + 1) / nz
-    const auto V_next = V_drop * n / (n+1);
+    //   phi[n] = F * (length + dz) = V_drop + F dz = V_drop (L + dz) / L
+    const auto V_next = V_drop * _L / (_L + _dz_plus(n-1));
 
     // The boundary condition is then set according to QWWAD4, 3.110.
     rhs(n-1) += _diag(n-1) * V_next;
@@ -227,7 +379,8 @@ arma::vec PoissonSolver::solve(const arma::vec &rho,
                                  "equation and sum the result.");
     }
 
-    auto phi = solve_tridiag_LDL_T(_D_diag, _L_sub, rhs);
+    auto phi = rhs;
+    _factorisation.solve_in_place(phi);
 
     // TODO: This is a horrible hack... for some reason, there's an unwanted factor of 2 in the
     // calculation
@@ -237,22 +390,118 @@ arma::vec PoissonSolver::solve(const arma::vec &rho,
     return phi;
 }
 
+/**
+ * \brief Solves the Poisson equation for a set of charge densities with no potential drop
+ *
+ * \param[in] rho Matrix whose columns are the charge density profiles [C m^{-3}]
+ *
+ * \return Matrix whose columns are the corresponding potential profiles [J]
+ *
+ * \details This gives the same results as calling solve() for each column in turn, but
+ *          all the profiles are solved in a single pass through the matrix.
+ */
+arma::mat PoissonSolver::solve_batch(const arma::mat &rho) const
+{
+    if (rho.n_rows != _eps.size())
+    {
+        throw std::runtime_error("Permittivity and charge density arrays have different sizes");
+    }
+
+    // Use interleaved storage for the batched solvers
+    arma::mat phi = rho.t();
+
+    for(unsigned int i=0; i < phi.n_cols; ++i)
+        phi.col(i) *= _h(i);
+
+    switch(_boundary_type)
+    {
+        case DIRICHLET:
+            solve_tridiag_batch(_sub_diag, _diag, _sub_diag, phi);
+            break;
+        case MIXED:
+        case ZERO_FIELD:
+            solve_cyclic_matrix_batch(_sub_diag, _diag, _corner_point, phi);
+            break;
+    }
+
+    return phi.t();
+}
+
+/**
+ * \brief Solves the Poisson equation for a charge density that depends linearly on the potential
+ *
+ * \param[in] rho       The part of the charge density that is independent of potential [C m^{-3}]
+ * \param[in] drho_dphi The derivative of the charge density with respect to potential [C m^{-3}/J]
+ * \param[in] V_drop    The total potential drop across the structure [J]
+ *
+ * \return The potential profile [J]
+ *
+ * \details The charge density is \f$\rho + (\partial\rho/\partial\phi)\phi\f$.  This is the
+ *          linear problem solved at each step of a Newton iteration for a nonlinear
+ *          Poisson equation.  The derivative term only changes the diagonal of the
+ *          matrix, so a new factorisation is needed for each call.  This is stored
+ *          in workspace that is kept by the solver, so no memory is allocated
+ *          apart from the returned potential.  Unlike solve(), the potential is not
+ *          shifted to zero at the first point, since the charge depends on its
+ *          absolute value.
+ */
+arma::vec PoissonSolver::solve_linearised(const arma::vec &rho,
+                                          const arma::vec &drho_dphi,
+                                          const double     V_drop) const
+{
+    const auto n = _eps.size();
+
+    if (rho.size() != n || drho_dphi.size() != n)
+    {
+        throw std::runtime_error("Permittivity and charge density arrays have different sizes");
+    }
+
+    _linear_diag = _diag - drho_dphi % _h;
+    arma::vec phi = rho % _h;
+
+    if(V_drop != 0.0)
+    {
+        if(_boundary_type == MIXED)
+        {
+            throw std::runtime_error("Cannot apply bias directly when solving the Poisson equation with "
+                                     "mixed boundaries.");
+        }
+
+        // Boundary condition as in solve(rho, V_drop)
+        const auto V_next = V_drop * _L / (_L + _dz_plus(n-1));
+        phi(n-1) += _diag(n-1) * V_next;
+    }
+
+    switch(_boundary_type)
+    {
+        case DIRICHLET:
+        case ZERO_FIELD:
+            _linear_factorisation.factorise(_linear_diag, _sub_diag);
+            _linear_factorisation.solve_in_place(phi);
+            break;
+        case MIXED:
+            solve_cyclic_matrix(_sub_diag, _linear_diag, _corner_point, phi,
+                                _linear_cyclic_diag, _linear_cyclic_fill);
+            break;
+    }
+
+    return phi;
+}
+
 /**
  * \brief Solve the Laplace equation (i.e., the Poisson equation with no charge)
  *
  * \param[in] V_drop the total potential drop across the system [J]
  *
  * \return The potential profile [J]
+ *
+ * \details The solution is linear in the potential drop, so this just rescales the
+ *          solution found when the solver was created.  With mixed boundaries, the
+ *          potential is pinned at each end (see compute_laplace_solution()).
  */
 arma::vec PoissonSolver::solve_laplace(const double V_drop) const
 {
-    const size_t n = _eps.size();
-
-    // Create an empty charge profile and solve the Poisson equation
-    auto rho = arma::zeros<arma::vec>(n);
-    const auto phi = solve(rho, V_drop);
-
-    return phi; 
+    return V_drop * _laplace_unit;
 }
 } // namespace
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -15,6 +15,8 @@
 
 #include <armadillo>
 
+#include "linear-algebra.h"
+
 namespace QWWAD
 {
 /**
@@ -33,6 +35,16 @@ enum PoissonBoundaryType
     ZERO_FIELD
 };
 
+/**
+ * \brief Solver for the Poisson equation in one dimension
+ *
+ * \details The matrix depends only on the permittivity profile and boundary
+ *          conditions, so it is factorised once when the solver is created.
+ *          Each call to solve() then needs only an O(n) back-substitution, which
+ *          makes it cheap to keep a solver alive through a self-consistent
+ *          calculation.  The solution of the Laplace equation is linear in the
+ *          potential drop, so it is found once for a unit drop and rescaled.
+ */
 class PoissonSolver
 {
 private:
@@ -42,22 +54,41 @@ public:
     PoissonSolver(const decltype(_eps) &eps,
                   const double          dx,
                   PoissonBoundaryType   bt=DIRICHLET);
+
+    PoissonSolver(const decltype(_eps) &eps,
+                  const arma::vec      &z,
+                  PoissonBoundaryType   bt=DIRICHLET);
     
     arma::vec solve(const arma::vec &rho) const;
     arma::vec solve(const arma::vec &rho,
                     const double     V_drop) const;
     arma::vec solve_laplace(const double V_drop) const;
+    arma::vec solve_linearised(const arma::vec &rho,
+                               const arma::vec &drho_dphi,
+                               const double     V_drop = 0.0) const;
+    arma::mat solve_batch(const arma::mat &rho) const;
 
 private:
     void factorise_dirichlet();
     void factorise_mixed();
     void factorise_zerofield();
+    void factorise_cyclic();
     void compute_half_index_permittivity();
+    void compute_laplace_solution();
+
+    arma::vec dirichlet_diagonal() const;
+    void solve_cyclic_in_place(arma::vec &b) const;
+
+    static arma::vec uniform_positions(const size_t n,
+                                       const double dx);
 
     arma::vec _eps_minus; ///< Permittivity half a point to left [F/m]
     arma::vec _eps_plus;  ///< Permittivity half a point to right [F/m]
 
-    double _dx;    ///< Spatial step size [m]
+    arma::vec _dz_minus; ///< Distance to the previous point [m]
+    arma::vec _dz_plus;  ///< Distance to the next point [m]
+    arma::vec _h;        ///< Width of the cell around each point [m]
+
     double _L;     ///< Total length of structure [m]
         
     arma::vec _diag;     ///< Diagonal of Poisson matrix
@@ -65,8 +96,20 @@ private:
 
     double _corner_point; ///< Corner point in matrix resulting from mixed boundary conditions
 
-    arma::vec _D_diag; ///< Diagonal of factorisation matrix, D
-    arma::vec _L_sub;  ///< Subdiagonal of factorisation matrix, L
+    TridiagFactorisation _factorisation; ///< L*D*L**T factorisation of Poisson matrix
+
+    arma::vec _cyclic_diag; ///< Modified diagonal from forward sweep of cyclic matrix
+    arma::vec _cyclic_fill; ///< Fill-in column from forward sweep of cyclic matrix
+
+    arma::vec _laplace_unit; ///< Solution of Laplace equation for unit potential drop
+
+    // Workspace for solve_linearised, which is kept between calls so that a
+    // self-consistent loop does not allocate it on every iteration.  A solver
+    // must therefore not be used for linearised solutions in several threads at once.
+    mutable arma::vec            _linear_diag;          ///< Diagonal of linearised matrix
+    mutable TridiagFactorisation _linear_factorisation; ///< Factorisation of linearised matrix
+    mutable arma::vec            _linear_cyclic_diag;   ///< Modified diagonal for cyclic solver
+    mutable arma::vec            _linear_cyclic_fill;   ///< Fill-in column for cyclic solver
 
     PoissonBoundaryType _boundary_type; ///< Boundary condition type for Poisson solver
 };
@@ -1,12 +1,21 @@
 #include "ppff.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <complex>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
 #include <armadillo>
 #include <gsl/gsl_math.h>
+#include "checkpoint.h"
 #include "constants.h"
 #include "file-io.h"
+#include "hash.h"
 #include "maths-helpers.h"
+#include "xyz-writer.h"
 
 using namespace QWWAD;
 using namespace constants;
@@ -447,11 +456,118 @@ double Vf(const double  A0,
 
 }
  
+/**
+ * \brief Create an empty table of atomic form factors
+ *
+ * \param[in] A0       Lattice constant [m]
+ * \param[in] m_per_au Number of metres per a.u. of length
+ */
+FormFactorTable::FormFactorTable(const double A0,
+                                 const double m_per_au) :
+    _A0(A0),
+    _m_per_au(m_per_au),
+    _q_sqr_res(1e-9*gsl_pow_2(2*pi/A0)),
+    _types(),
+    _values()
+{}
+
+/**
+ * \brief Find the atomic form factor, evaluating it only if it is not in the table
+ *
+ * \param[in] q_sqr Modulus squared of q [1/m^2]
+ * \param[in] type  Atomic species
+ *
+ * \returns The form factor [J]
+ */
+double FormFactorTable::get(const double  q_sqr,
+                            const char   *type)
+{
+    // There are only a few species, so a linear search is quicker than hashing the name
+    size_t itype = 0;
+
+    while(itype < _types.size() && _types[itype] != type)
+        ++itype;
+
+    if(itype == _types.size())
+    {
+        _types.push_back(type);
+        _values.push_back(std::unordered_map<long long,double>());
+    }
+
+    auto &values = _values[itype];
+    const long long key = llround(q_sqr/_q_sqr_res);
+    const auto it = values.find(key);
+
+    if(it != values.end())
+        return it->second;
+
+    const double v = Vf(_A0, _m_per_au, q_sqr, type);
+    values[key] = v;
+
+    return v;
+}
+
+/**
+ * \brief Reads the atomic species from a binary XYZ file
+ *
+ * \details See XYZWriter for a description of the format
+ */
+static std::vector<atom> read_atoms_binary(const char * filename)
+{
+    std::ifstream stream(filename, std::ios::binary);
+
+    char     magic[8];
+    uint32_t version  = 0;
+    uint32_t reserved = 0;
+    uint64_t n_atoms  = 0;
+
+    stream.read(magic, sizeof(magic));
+    stream.read(reinterpret_cast<char *>(&version),  sizeof(version));
+    stream.read(reinterpret_cast<char *>(&reserved), sizeof(reserved));
+    stream.read(reinterpret_cast<char *>(&n_atoms),  sizeof(n_atoms));
+
+    if(!stream || version != 1)
+    {
+        std::ostringstream oss;
+        oss << "Cannot read binary XYZ file " << filename << " (format version " << version << ")";
+        throw std::runtime_error(oss.str());
+    }
+
+    static_assert(XYZWriter::type_size <= sizeof(atom::type),
+                  "Species names in binary XYZ files must fit in an atom");
+
+    std::vector<atom> atoms(n_atoms);
+
+    for(auto &atom : atoms)
+    {
+        double r[3];
+        std::fill(atom.type, atom.type + sizeof(atom.type), '\0');
+        stream.read(atom.type, XYZWriter::type_size);
+        stream.read(reinterpret_cast<char *>(r), sizeof(r));
+        atom.type[sizeof(atom.type)-1] = '\0';
+
+        /* Convert atomic positions from Angstrom into S.I. units	*/
+        atom.r = arma::vec(r, 3) * 1e-10;
+    }
+
+    if(!stream)
+    {
+        std::ostringstream oss;
+        oss << filename << " ended before all " << n_atoms << " atoms were read.";
+        throw std::runtime_error(oss.str());
+    }
+
+    return atoms;
+}
+
 /**
  * \brief Reads the atomic species into memory
  */
 std::vector<atom> read_atoms(const char * filename)
 {
+ if(XYZWriter::is_binary_file(filename))
+     return read_atoms_binary(filename);
+
  FILE 	*Fatoms;        /* file pointer to wavefunction file       */
 
  if((Fatoms=fopen(filename,"r"))==0)
@@ -497,28 +613,167 @@ std::vector<atom> read_atoms(const char * filename)
  return atoms;
 }   
 
-/* This function reads the reciprocal lattice vectors (defined in
-   the file G.r) into the array G[] and then converts into SI units */
+/// Identifier at the start of a binary reciprocal lattice vector table
+static const char rlv_magic[8] = {'Q','W','W','A','D','R','L','V'};
+
+/// Version number of the binary reciprocal lattice vector table format
+static const uint32_t rlv_version = 1;
+
+/// Name of the binary copy of G.r
+static const char rlv_cache_name[] = "G.r.bin";
+
+/**
+ * \brief Find the 64-bit FNV-1a hash of a block of text
+ */
+static uint64_t hash_text(const std::string &text)
+{
+    uint64_t hash = hash_offset_basis;
+    hash_bytes(text.data(), text.size(), hash);
+    return hash;
+}
+
+/**
+ * \brief Write a binary copy of the reciprocal lattice vectors
+ *
+ * \param[in] hash Hash of the text file that the table was read from
+ * \param[in] g    Reciprocal lattice vectors in units of 2pi/A0
+ *
+ * \details The cache is optional, so any failure to write it is ignored.
+ */
+static void write_rlv_cache(const uint64_t                hash,
+                            const std::vector<arma::vec> &g)
+{
+    std::string buffer = start_checkpoint(rlv_magic, rlv_version);
+    append_checkpoint_value(buffer, hash);
+    append_checkpoint_value<uint64_t>(buffer, g.size());
+
+    for(auto const &gi : g)
+        buffer.append(reinterpret_cast<const char *>(gi.memptr()), 3*sizeof(double));
+
+    write_checkpoint_file(rlv_cache_name, buffer);
+}
+
+/**
+ * \brief Read the binary copy of the reciprocal lattice vectors
+ *
+ * \param[in]  hash Hash of the current contents of G.r
+ * \param[out] g    Reciprocal lattice vectors in units of 2pi/A0
+ *
+ * \returns False if there is no up-to-date binary copy
+ */
+static bool read_rlv_cache(const uint64_t          hash,
+                           std::vector<arma::vec> &g)
+{
+    std::ifstream stream(rlv_cache_name, std::ios::binary);
+
+    char     magic[sizeof(rlv_magic)];
+    uint32_t version     = 0;
+    uint64_t stored_hash = 0;
+    uint64_t N           = 0;
+
+    stream.read(magic, sizeof(magic));
+    stream.read(reinterpret_cast<char *>(&version),     sizeof(version));
+    stream.read(reinterpret_cast<char *>(&stored_hash), sizeof(stored_hash));
+    stream.read(reinterpret_cast<char *>(&N),           sizeof(N));
+
+    if(!stream
+       || !std::equal(magic, magic + sizeof(magic), rlv_magic)
+       || version != rlv_version
+       || stored_hash != hash)
+        return false;
+
+    arma::mat table(3, N);
+    stream.read(reinterpret_cast<char *>(table.memptr()), 3*N*sizeof(double));
+
+    if(!stream)
+        return false;
+
+    g.assign(N, arma::vec(3));
+
+    for(unsigned int iG = 0; iG < N; ++iG)
+        g[iG] = table.col(iG);
+
+    return true;
+}
+
+/**
+ * \brief Write a set of reciprocal lattice vectors to G.r
+ *
+ * \param[in] g      Reciprocal lattice vectors in units of 2pi/A0
+ * \param[in] format printf-style format for the three components of each vector
+ *
+ * \details A binary copy of the table is written at the same time, so that the
+ *          next call to read_rlv does not have to parse the text.
+ */
+void write_rlv(const std::vector<arma::vec> &g,
+               const char                   *format)
+{
+    std::string text;
+    char line[256];
+
+    for(auto const &gi : g)
+    {
+        snprintf(line, sizeof(line), format, gi(0), gi(1), gi(2));
+        text += line;
+        text += '\n';
+    }
+
+    std::ofstream stream("G.r");
+    stream << text;
+    stream.close();
+
+    if(!stream)
+        throw std::runtime_error("Could not write reciprocal lattice vectors to G.r");
+
+    write_rlv_cache(hash_text(text), g);
+}
+
+/**
+ * \brief Read the reciprocal lattice vectors from G.r and convert into SI units
+ *
+ * \param[in] A0 Lattice constant [m]
+ *
+ * \details The file is only parsed if its binary copy (G.r.bin) is missing, or
+ *          was made from a different version of G.r.  In that case, a new
+ *          binary copy is written for next time.
+ */
 std::vector<arma::vec>
 read_rlv(double A0)
 {
-    arma::vec Gx;
-    arma::vec Gy;
-    arma::vec Gz;
-    read_table("G.r", Gx, Gy, Gz);
+    std::ifstream text_stream("G.r", std::ios::binary);
+
+    if(!text_stream.is_open())
+        throw std::runtime_error("Could not open G.r");
+
+    std::ostringstream text;
+    text << text_stream.rdbuf();
+    const uint64_t hash = hash_text(text.str());
 
     std::vector<arma::vec> G;
-    size_t N = Gx.size();
-    for(unsigned int iG = 0; iG < N; ++iG)
+
+    if(!read_rlv_cache(hash, G))
     {
-        arma::vec _G(3);
-        _G(0) = Gx[iG];
-        _G(1) = Gy[iG];
-        _G(2) = Gz[iG];
-        _G *= 2.0*pi/A0;
-        G.push_back(_G);
+        arma::vec Gx;
+        arma::vec Gy;
+        arma::vec Gz;
+        read_table("G.r", Gx, Gy, Gz);
+
+        size_t N = Gx.size();
+        for(unsigned int iG = 0; iG < N; ++iG)
+        {
+            arma::vec _G(3);
+            _G(0) = Gx[iG];
+            _G(1) = Gy[iG];
+            _G(2) = Gz[iG];
+            G.push_back(_G);
+        }
+
+        write_rlv_cache(hash, G);
     }
 
+    for(auto &_G : G)
+        _G *= 2.0*pi/A0;
+
     return G;
 }
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -11,6 +11,8 @@
 #define PPFF_H
 
 #include <armadillo>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 typedef struct
@@ -24,8 +26,41 @@ double Vf(const double  A0,
           double        q_sqr,
           const char   *type);
 
+/**
+ * \brief A table of atomic form factors for a fixed lattice constant
+ *
+ * \details In a plane-wave basis, the form factors are needed at only a few
+ *          discrete values of |q|^2 (one for each shell of G-G' vectors), but
+ *          they are requested many times for each pair of basis vectors and
+ *          each atom.  This table evaluates Vf once for each species and
+ *          value of |q|^2, and then looks it up.  Values of |q|^2 are treated
+ *          as equal if they are within 1e-9 (2pi/A0)^2.
+ *
+ *          The table is not thread-safe, so each thread needs its own copy.
+ */
+class FormFactorTable
+{
+public:
+    FormFactorTable(const double A0,
+                    const double m_per_au);
+
+    double get(const double  q_sqr,
+               const char   *type);
+
+private:
+    double _A0;        ///< Lattice constant [m]
+    double _m_per_au;  ///< Number of metres per a.u. of length
+    double _q_sqr_res; ///< Resolution of the |q|^2 lookup [1/m^2]
+
+    std::vector<std::string>                          _types;  ///< Atomic species in the table
+    std::vector<std::unordered_map<long long,double>> _values; ///< Form factors for each species [J]
+};
+
 std::vector<atom> read_atoms(const char * filename);
 
 std::vector<arma::vec> read_rlv(double A0);
+
+void write_rlv(const std::vector<arma::vec> &g,
+               const char                   *format);
 #endif
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
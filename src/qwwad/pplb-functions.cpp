@@ -1,5 +1,25 @@
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
 #include "pplb-functions.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "file-io.h"
+
+#if HAVE_SYS_MMAN_H
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
 /** Writes the eigenvectors (a_nk(G)) to the files ank.r
  * \param[in] ank    Eigenvector coefficients
  * \param[in] ik     k point identifier
@@ -16,7 +36,7 @@ write_ank(arma::cx_mat &ank,
 {
     int	iG;		/* index over G vectors				*/
     int	in;		/* index over bands				*/
-    char	filename[9];	/* eigenfunction output filename		*/
+    char	filename[24];	/* eigenfunction output filename		*/
     FILE 	*Fank;		/* file pointer to eigenvectors file		*/
 
     sprintf(filename,"ank%i.r",ik);
@@ -32,6 +52,247 @@ write_ank(arma::cx_mat &ank,
     fclose(Fank);
 }
 
+/**
+ * \brief Read the band energies at each wave vector from the files Ek?.r
+ *
+ * \param[in] nk Number of wave vectors
+ *
+ * \returns The energy of each band [eV], with one row for each wave vector
+ */
+arma::mat read_band_energies(const size_t nk)
+{
+    arma::mat E_k;
+
+    for(unsigned int ik = 0; ik < nk; ++ik)
+    {
+        std::ostringstream filename;
+        filename << "Ek" << ik << ".r";
+
+        std::vector<double> E;
+        QWWAD::read_table(filename.str(), E);
+
+        if(ik == 0)
+            E_k.set_size(nk, E.size());
+        else if(E.size() != E_k.n_cols)
+        {
+            std::ostringstream oss;
+            oss << filename.str() << " has " << E.size() << " energies, but Ek0.r has "
+                << E_k.n_cols << ".";
+            throw std::length_error(oss.str());
+        }
+
+        for(unsigned int iE = 0; iE < E.size(); ++iE)
+            E_k(ik, iE) = E[iE];
+    }
+
+    return E_k;
+}
+
+/// Identifier at the start of a binary bulk-states file
+static const char bulk_states_magic[8] = {'Q','W','W','A','D','A','N','K'};
+
+/// Version number of the binary bulk-states file format
+static const uint32_t bulk_states_version = 1;
+
+/**
+ * \brief Header of a binary bulk-states file
+ *
+ * \details The header is a multiple of 8 bytes long, so the data that follow it
+ *          are correctly aligned for use in place.
+ */
+struct BulkStatesHeader
+{
+    char     magic[8]; ///< File identifier
+    uint32_t version;  ///< File format version
+    uint32_t reserved; ///< Padding, always zero
+    uint64_t nk;       ///< Number of wave vectors
+    uint64_t nG;       ///< Number of terms in each eigenvector
+    uint64_t nbands;   ///< Number of bands at each wave vector
+};
+
+/**
+ * \brief Open a binary file of bulk eigenstates
+ *
+ * \param[in] filename The name of the file
+ */
+BulkStatesFile::BulkStatesFile(const std::string &filename) :
+    _nk(0),
+    _nG(0),
+    _nbands(0),
+    _E(NULL),
+    _ank(NULL),
+    _map(NULL),
+    _map_size(0),
+    _contents()
+{
+    const char *data = NULL;
+    size_t      size = 0;
+
+#if HAVE_SYS_MMAN_H
+    const int fd = open(filename.c_str(), O_RDONLY);
+
+    if(fd >= 0)
+    {
+        struct stat st;
+
+        if(fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if(addr != MAP_FAILED)
+            {
+                _map      = addr;
+                _map_size = st.st_size;
+                data      = static_cast<const char *>(addr);
+                size      = _map_size;
+            }
+        }
+
+        close(fd);
+    }
+#endif
+
+    if(!_map)
+    {
+        std::ifstream stream(filename.c_str(), std::ios::binary);
+
+        if(!stream.is_open())
+        {
+            std::ostringstream oss;
+            oss << "Could not open " << filename;
+            throw std::runtime_error(oss.str());
+        }
+
+        stream.seekg(0, std::ios::end);
+        _contents.resize(stream.tellg());
+        stream.seekg(0, std::ios::beg);
+
+        if(!_contents.empty())
+            stream.read(&_contents[0], _contents.size());
+
+        data = _contents.data();
+        size = _contents.size();
+    }
+
+    BulkStatesHeader header;
+
+    if(size < sizeof(header))
+    {
+        std::ostringstream oss;
+        oss << filename << " is too short to be a bulk-states file.";
+        throw std::runtime_error(oss.str());
+    }
+
+    std::memcpy(&header, data, sizeof(header));
+
+    if(!std::equal(header.magic, header.magic + sizeof(header.magic), bulk_states_magic))
+    {
+        std::ostringstream oss;
+        oss << filename << " is not a bulk-states file.";
+        throw std::runtime_error(oss.str());
+    }
+
+    if(header.version != bulk_states_version)
+    {
+        std::ostringstream oss;
+        oss << filename << " uses version " << header.version << " of the bulk-states format, "
+            << "but only version " << bulk_states_version << " is supported.";
+        throw std::runtime_error(oss.str());
+    }
+
+    _nk     = header.nk;
+    _nG     = header.nG;
+    _nbands = header.nbands;
+
+    const size_t nE   = _nk*_nbands;
+    const size_t nank = _nk*_nG*_nbands;
+
+    if(size != sizeof(header) + nE*sizeof(double) + nank*sizeof(std::complex<double>))
+    {
+        std::ostringstream oss;
+        oss << filename << " should hold " << _nbands << " bands with " << _nG
+            << " coefficients at " << _nk << " wave vectors, but its size is " << size << " bytes.";
+        throw std::runtime_error(oss.str());
+    }
+
+    _E   = reinterpret_cast<const double *>(data + sizeof(header));
+    _ank = reinterpret_cast<const std::complex<double> *>(data + sizeof(header) + nE*sizeof(double));
+}
+
+BulkStatesFile::~BulkStatesFile()
+{
+#if HAVE_SYS_MMAN_H
+    if(_map)
+        munmap(_map, _map_size);
+#endif
+}
+
+/**
+ * \brief Write a set of bulk eigenstates to a binary file
+ *
+ * \param[in] filename The name of the file
+ * \param[in] E        Energies of the bands at each wave vector [J]
+ * \param[in] ank      Eigenvector coefficients at each wave vector, with one row per
+ *                     reciprocal lattice vector and one column per band
+ *
+ * \details The file contains a header, followed by all the energies and then all
+ *          the eigenvector coefficients, in the order described in BulkStatesFile.
+ *          All values are stored in the native byte order of the machine.
+ */
+void BulkStatesFile::write(const std::string               &filename,
+                           const std::vector<arma::vec>    &E,
+                           const std::vector<arma::cx_mat> &ank)
+{
+    if(E.empty() || E.size() != ank.size())
+    {
+        std::ostringstream oss;
+        oss << "Cannot write energies at " << E.size() << " wave vectors and eigenvectors at "
+            << ank.size() << " wave vectors to " << filename;
+        throw std::length_error(oss.str());
+    }
+
+    BulkStatesHeader header;
+    std::copy(bulk_states_magic, bulk_states_magic + sizeof(bulk_states_magic), header.magic);
+    header.version  = bulk_states_version;
+    header.reserved = 0;
+    header.nk       = E.size();
+    header.nG       = ank[0].n_rows;
+    header.nbands   = E[0].size();
+
+    for(size_t ik = 0; ik < E.size(); ++ik)
+    {
+        if(E[ik].size() != header.nbands || ank[ik].n_rows != header.nG || ank[ik].n_cols != header.nbands)
+        {
+            std::ostringstream oss;
+            oss << "All wave vectors in " << filename
+                << " must have the same number of bands and coefficients.";
+            throw std::length_error(oss.str());
+        }
+    }
+
+    std::ofstream stream(filename.c_str(), std::ios::binary);
+    stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    for(auto const &E_k : E)
+        stream.write(reinterpret_cast<const char *>(E_k.memptr()), E_k.size()*sizeof(double));
+
+    // Armadillo stores matrices by column, so transpose each one to put the bands
+    // for each reciprocal lattice vector next to each other
+    for(auto const &ank_k : ank)
+    {
+        const arma::cx_mat ank_t = ank_k.st();
+        stream.write(reinterpret_cast<const char *>(ank_t.memptr()),
+                     ank_t.n_elem*sizeof(std::complex<double>));
+    }
+
+    if(!stream)
+    {
+        std::ostringstream oss;
+        oss << "Could not write bulk states to " << filename;
+        throw std::runtime_error(oss.str());
+    }
+}
+
 /**
  * \brief Get potential component of H_GG
  *
@@ -60,3 +321,30 @@ std::complex<double> V(double                   A0,
 
     return v;
 }
+
+/**
+ * \brief Get potential component of H_GG, using a table of form factors
+ *
+ * \param[in,out] ff    Table of form factors.  Any new values are added to it.
+ * \param[in]     atoms atomic definitions
+ * \param[in]     q     a reciprocal lattice vector, G'-G
+ */
+std::complex<double> V(FormFactorTable         &ff,
+                       std::vector<atom> const &atoms,
+                       arma::vec const         &q)
+{
+    std::complex<double> v = 0.0; // potential
+    const double q_dot_q = dot(q,q);
+
+    // Loop over all atoms in the set and add contribution from each
+    for(auto const &atom : atoms)
+    {
+        const double q_dot_t = dot(q, atom.r);
+        const double vf = ff.get(q_dot_q, atom.type);
+        v += exp(std::complex<double>(0.0,-q_dot_t)) * vf; // [QWWAD3, 15.76]
+    }
+
+    v *= 2.0/atoms.size();
+
+    return v;
+}
@@ -6,6 +6,7 @@
 #define QWWAD_PPLB_FUNCTIONS_H
 
 #include <complex>
+#include <string>
 #include <vector>
 
 #include <armadillo>
@@ -19,9 +20,73 @@ write_ank(arma::cx_mat &ank,
           int           n_min,
           int           n_max);
 
+arma::mat read_band_energies(const size_t nk);
+
+/**
+ * \brief Read-only view of a binary file of bulk eigenstates
+ *
+ * \details The file holds the energies E_nk and eigenvector coefficients a_nk(G)
+ *          for every wave vector k and band n from a large-basis calculation.
+ *          Where possible, the file is memory-mapped, so the data are used
+ *          directly without being parsed or copied.
+ */
+class BulkStatesFile
+{
+public:
+    BulkStatesFile(const std::string &filename);
+    ~BulkStatesFile();
+
+    /** Return the number of wave vectors */
+    size_t get_nk() const {return _nk;}
+
+    /** Return the number of terms in each eigenvector */
+    size_t get_nG() const {return _nG;}
+
+    /** Return the number of bands at each wave vector */
+    size_t get_nbands() const {return _nbands;}
+
+    /**
+     * \brief Return the energies of all bands [J]
+     *
+     * \details The energy of band n at wave vector k is at index [k*nbands + n]
+     */
+    const double * get_energies() const {return _E;}
+
+    /**
+     * \brief Return the eigenvector coefficients of all bands
+     *
+     * \details The coefficient for reciprocal lattice vector G in band n at wave
+     *          vector k is at index [(k*nG + G)*nbands + n]
+     */
+    const std::complex<double> * get_ank() const {return _ank;}
+
+    static void write(const std::string               &filename,
+                      const std::vector<arma::vec>    &E,
+                      const std::vector<arma::cx_mat> &ank);
+
+private:
+    BulkStatesFile(const BulkStatesFile &);
+    BulkStatesFile & operator=(const BulkStatesFile &);
+
+    size_t _nk;     ///< Number of wave vectors
+    size_t _nG;     ///< Number of terms in each eigenvector
+    size_t _nbands; ///< Number of bands at each wave vector
+
+    const double               *_E;   ///< Start of the energy data [J]
+    const std::complex<double> *_ank; ///< Start of the eigenvector data
+
+    void              *_map;      ///< Start of the memory-mapped file
+    size_t             _map_size; ///< Number of bytes in the memory-mapped file
+    std::vector<char>  _contents; ///< Copy of the file, used if it is not mapped
+};
+
 std::complex<double> V(double                   A0,
                        double                   m_per_au,
                        std::vector<atom> const &atoms,
                        arma::vec const         &q);
+
+std::complex<double> V(FormFactorTable         &ff,
+                       std::vector<atom> const &atoms,
+                       arma::vec const         &q);
 #endif
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
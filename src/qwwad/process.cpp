@@ -0,0 +1,153 @@
+/**
+ * \file   process.cpp
+ * \brief  Running other programs as child processes
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "process.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+namespace QWWAD
+{
+/**
+ * \brief Run a program and wait for it to finish
+ *
+ * \param[in] args    The program name, followed by its arguments.  The program is
+ *                    found using the PATH environment variable.
+ * \param[in] workdir The directory in which to run the program (empty = current)
+ * \param[in] logfile File to which the standard output and error streams are
+ *                    written (empty = same as this program).  A relative name is
+ *                    taken from the working directory of the child.
+ * \param[in] environment Extra environment variables for the child, each as
+ *                    "NAME=value".  These replace any variables of the same name.
+ *
+ * \returns The exit code of the program, or -1 if it was killed by a signal
+ *
+ * \details This is safe to call from several threads at once.  All the memory
+ *          that the child needs is allocated before it is started, so that the
+ *          child only makes system calls.
+ */
+int run_process(const std::vector<std::string> &args,
+                const std::string              &workdir,
+                const std::string              &logfile,
+                const std::vector<std::string> &environment)
+{
+    if(args.empty())
+        throw std::invalid_argument("No program was given.");
+
+    std::vector<char *> argv;
+
+    for(auto const &arg : args)
+        argv.push_back(const_cast<char *>(arg.c_str()));
+
+    argv.push_back(nullptr);
+
+    // The child's environment is this program's, with the extra variables
+    // replacing any of the same name
+    std::vector<char *> envp;
+
+    if(!environment.empty())
+    {
+        for(char **var = environ; *var != nullptr; ++var)
+        {
+            const std::string entry(*var);
+            const auto        name = entry.substr(0, entry.find('=') + 1);
+            bool              replaced = false;
+
+            for(auto const &extra : environment)
+            {
+                if(extra.compare(0, name.size(), name) == 0)
+                    replaced = true;
+            }
+
+            if(!replaced)
+                envp.push_back(*var);
+        }
+
+        for(auto const &extra : environment)
+            envp.push_back(const_cast<char *>(extra.c_str()));
+
+        envp.push_back(nullptr);
+    }
+
+    const pid_t pid = fork();
+
+    if(pid < 0)
+    {
+        std::ostringstream oss;
+        oss << "Could not start " << args[0];
+        throw std::runtime_error(oss.str());
+    }
+
+    if(pid == 0)
+    {
+        if(!workdir.empty() && chdir(workdir.c_str()) != 0)
+            _exit(127);
+
+        if(!logfile.empty())
+        {
+            const int fd = open(logfile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+            if(fd < 0)
+                _exit(127);
+
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+
+        if(!envp.empty())
+            environ = envp.data();
+
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+
+    int status = 0;
+
+    while(waitpid(pid, &status, 0) < 0)
+    {
+        if(errno != EINTR)
+        {
+            std::ostringstream oss;
+            oss << "Could not wait for " << args[0] << " to finish.";
+            throw std::runtime_error(oss.str());
+        }
+    }
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/**
+ * \brief Find the environment that shares the CPU cores between child programs
+ *
+ * \param[in] n_children Number of child programs that are run at once
+ *
+ * \returns A setting of QWWAD_NUM_THREADS for run_process, which gives each
+ *          child an equal share of the threads from get_thread_count (at least one)
+ *
+ * \details Without this, each child would use one thread per CPU core, and the
+ *          CPU would be oversubscribed by a factor of n_children.
+ */
+std::vector<std::string> get_child_thread_environment(const unsigned int n_children)
+{
+    const unsigned int n_share = std::max(1U, get_thread_count() / std::max(1U, n_children));
+
+    std::ostringstream oss;
+    oss << "QWWAD_NUM_THREADS=" << n_share;
+    return std::vector<std::string>(1, oss.str());
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
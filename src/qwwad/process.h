@@ -0,0 +1,23 @@
+/**
+ * \file   process.h
+ * \brief  Running other programs as child processes
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_PROCESS_H
+#define QWWAD_PROCESS_H
+
+#include <string>
+#include <vector>
+
+namespace QWWAD
+{
+int run_process(const std::vector<std::string> &args,
+                const std::string              &workdir     = "",
+                const std::string              &logfile     = "",
+                const std::vector<std::string> &environment = std::vector<std::string>());
+
+std::vector<std::string> get_child_thread_environment(const unsigned int n_children);
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
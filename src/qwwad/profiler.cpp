@@ -0,0 +1,561 @@
+/**
+ * \file   profiler.cpp
+ * \brief  Lightweight timing of the main phases of a calculation
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace QWWAD
+{
+std::atomic<bool> Profiler::_enabled(false);
+std::atomic<bool> Profiler::_tracing(false);
+
+namespace
+{
+/// Total time spent in one phase
+struct PhaseTime
+{
+    std::string name;    ///< Name of the phase
+    size_t      calls;   ///< Number of times the phase was timed
+    double      seconds; ///< Total time in the phase [s]
+};
+
+/// Number of times an event has happened
+struct EventCount
+{
+    explicit EventCount(const char *name_) :
+        name(name_),
+        count(0)
+    {}
+
+    std::string           name;  ///< Name of the counter
+    std::atomic<uint64_t> count; ///< Number of events
+};
+
+/// Estimated memory use of a calculation
+struct MemoryEstimate
+{
+    std::string name;  ///< Description of the calculation
+    size_t      bytes; ///< Largest estimated memory use [bytes]
+};
+
+/// Everything recorded by the profiler
+struct ProfileData
+{
+    std::mutex                            mutex;    ///< Lock for all the data
+    std::string                           program;  ///< Name of the program
+    Profiler::Format                      format;   ///< Format of the summary
+    std::string                           filename; ///< Output file (empty = stderr)
+    Profiler::Clock::time_point           start;    ///< Time at which profiling started
+    std::vector<PhaseTime>                phases;   ///< Phases, in the order first seen
+    std::deque<EventCount>                counters; ///< Counters, in the order first used
+    std::vector<MemoryEstimate>           memory;   ///< Memory estimates, in the order first seen
+    bool                                  written;  ///< True if the summary has been written
+};
+
+ProfileData & get_data()
+{
+    static ProfileData data;
+    return data;
+}
+
+/// A task in the timeline
+struct TraceEvent
+{
+    const char                  *name;  ///< Name of the task
+    Profiler::Clock::time_point  start; ///< Time at which the task started
+    Profiler::Clock::time_point  end;   ///< Time at which the task finished
+};
+
+/// The tasks recorded by one thread
+struct ThreadTrace
+{
+    ThreadTrace() :
+        in_use(false)
+    {}
+
+    std::mutex              mutex;  ///< Lock for the events
+    std::vector<TraceEvent> events; ///< Tasks, in the order they finished
+    bool                    in_use; ///< True while a running thread owns this timeline
+};
+
+/// The timeline of every thread
+struct TraceData
+{
+    std::mutex                  mutex;    ///< Lock for the list of threads
+    std::string                 program;  ///< Name of the program
+    std::string                 filename; ///< Output file
+    Profiler::Clock::time_point start;    ///< Time at which recording started
+    std::deque<ThreadTrace>     threads;  ///< Timeline of each thread, in the order first seen
+    bool                        written;  ///< True if the timeline has been written
+};
+
+TraceData & get_trace_data()
+{
+    static TraceData data;
+    return data;
+}
+
+/**
+ * \brief Gives a timeline back to the pool when its thread finishes
+ */
+struct ThreadTraceOwner
+{
+    ThreadTraceOwner() :
+        trace(nullptr)
+    {}
+
+    ~ThreadTraceOwner()
+    {
+        if(trace)
+        {
+            auto &data = get_trace_data();
+            std::lock_guard<std::mutex> lock(data.mutex);
+            trace->in_use = false;
+        }
+    }
+
+    ThreadTrace *trace; ///< The timeline of this thread
+};
+
+/**
+ * \brief Find the timeline of the calling thread, creating it if needed
+ *
+ * \details Each thread only looks up its timeline once, and then only takes its
+ *          own lock, so threads don't wait for each other to record events.
+ *          run_in_parallel starts new threads for each loop, so a timeline is
+ *          handed on to a new thread once its previous owner has finished.  Each
+ *          row of the timeline is then one slot in the thread pool, rather than
+ *          one short-lived thread.
+ */
+ThreadTrace & get_thread_trace()
+{
+    static thread_local ThreadTraceOwner owner;
+
+    if(!owner.trace)
+    {
+        auto &data = get_trace_data();
+        std::lock_guard<std::mutex> lock(data.mutex);
+
+        for(auto &trace : data.threads)
+        {
+            if(!trace.in_use)
+            {
+                owner.trace = &trace;
+                break;
+            }
+        }
+
+        if(!owner.trace)
+        {
+            data.threads.emplace_back();
+            owner.trace = &data.threads.back();
+        }
+
+        owner.trace->in_use = true;
+    }
+
+    return *owner.trace;
+}
+
+/**
+ * \brief Write a string to a stream as a quoted JSON string
+ */
+void write_json_string(std::ostream      &stream,
+                       const std::string &str)
+{
+    stream << '"';
+
+    for(auto const c : str)
+    {
+        if(c == '"' || c == '\\')
+            stream << '\\';
+
+        stream << c;
+    }
+
+    stream << '"';
+}
+
+/**
+ * \brief Find the peak resident memory of the program so far [bytes]
+ */
+size_t get_peak_memory()
+{
+    struct rusage usage;
+
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+    // Linux gives the size in kilobytes
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+}
+
+/**
+ * \brief Write the summary to a stream
+ */
+void write_summary_to_stream(const ProfileData &data,
+                             const double       total,
+                             std::ostream      &stream)
+{
+    const auto peak_memory = get_peak_memory();
+
+    if(data.format == Profiler::JSON)
+    {
+        stream << "{\"program\": ";
+        write_json_string(stream, data.program);
+        stream << ", \"total\": " << total << ", \"phases\": [";
+
+        for(size_t i = 0; i < data.phases.size(); ++i)
+        {
+            auto const &phase = data.phases[i];
+
+            stream << (i > 0 ? ", " : "") << "{\"name\": ";
+            write_json_string(stream, phase.name);
+            stream << ", \"calls\": " << phase.calls
+                   << ", \"seconds\": " << phase.seconds << "}";
+        }
+
+        stream << "]";
+
+        if(!data.counters.empty())
+        {
+            stream << ", \"counters\": [";
+
+            for(size_t i = 0; i < data.counters.size(); ++i)
+            {
+                auto const &counter = data.counters[i];
+
+                stream << (i > 0 ? ", " : "") << "{\"name\": ";
+                write_json_string(stream, counter.name);
+                stream << ", \"count\": " << counter.count.load() << "}";
+            }
+
+            stream << "]";
+        }
+
+        stream << ", \"memory\": [";
+
+        for(auto const &estimate : data.memory)
+        {
+            stream << "{\"name\": ";
+            write_json_string(stream, estimate.name);
+            stream << ", \"bytes\": " << estimate.bytes << "}, ";
+        }
+
+        stream << "{\"name\": \"peak resident\", \"bytes\": " << peak_memory << "}]";
+
+        stream << "}" << std::endl;
+    }
+    else
+    {
+        for(auto const &phase : data.phases)
+        {
+            stream << data.program << ",phase," << phase.name << ","
+                   << phase.calls << "," << phase.seconds << std::endl;
+        }
+
+        stream << data.program << ",phase,total,1," << total << std::endl;
+
+        for(auto const &counter : data.counters)
+        {
+            stream << data.program << ",counter," << counter.name << ","
+                   << counter.count.load() << "," << std::endl;
+        }
+
+        for(auto const &estimate : data.memory)
+        {
+            stream << data.program << ",memory," << estimate.name << ","
+                   << estimate.bytes << "," << std::endl;
+        }
+
+        stream << data.program << ",memory,peak resident," << peak_memory << "," << std::endl;
+    }
+}
+} // namespace
+
+/**
+ * \brief Switch on profiling
+ *
+ * \param[in] program_name The name of the program, which is given in the summary
+ * \param[in] format       The format of the summary
+ * \param[in] filename     The file to which the summary is appended.  If empty,
+ *                         the summary is written to the standard error stream.
+ * \param[in] start        The time at which the program started
+ *
+ * \details The summary is written automatically when the program exits.
+ *          Summaries are appended to the file, so that a single file can
+ *          collect the results from every program in a script.  Each line of
+ *          a CSV summary gives the program name, the type of entry ("phase",
+ *          "counter" or "memory"), its name, the number of calls, events or
+ *          bytes and the total time [s].  The time is left blank for counters
+ *          and memory.
+ */
+void Profiler::enable(const std::string       &program_name,
+                      const Format             format,
+                      const std::string       &filename,
+                      const Clock::time_point &start)
+{
+    auto &data = get_data();
+
+    {
+        std::lock_guard<std::mutex> lock(data.mutex);
+
+        const auto slash = program_name.find_last_of('/');
+        data.program  = (slash == std::string::npos) ? program_name : program_name.substr(slash + 1);
+        data.format   = format;
+        data.filename = filename;
+        data.start    = start;
+        data.written  = false;
+    }
+
+    if(!_enabled.exchange(true))
+        std::atexit(write_summary);
+}
+
+/**
+ * \brief Add some time to a phase
+ *
+ * \param[in] phase   The name of the phase
+ * \param[in] seconds The time spent in the phase [s]
+ */
+void Profiler::add_time(const char   *phase,
+                        const double  seconds)
+{
+    auto &data = get_data();
+    std::lock_guard<std::mutex> lock(data.mutex);
+
+    for(auto &p : data.phases)
+    {
+        if(p.name == phase)
+        {
+            ++p.calls;
+            p.seconds += seconds;
+            return;
+        }
+    }
+
+    data.phases.push_back(PhaseTime{phase, 1, seconds});
+}
+
+/**
+ * \brief Find the event counter with a given name, creating it if needed
+ *
+ * \param[in] name The name of the counter
+ *
+ * \returns The counter, which remains valid until the program exits
+ *
+ * \details This is normally only used through the QWWAD_COUNT macros.
+ */
+std::atomic<uint64_t> & Profiler::get_counter(const char *name)
+{
+    auto &data = get_data();
+    std::lock_guard<std::mutex> lock(data.mutex);
+
+    for(auto &counter : data.counters)
+    {
+        if(counter.name == name)
+            return counter.count;
+    }
+
+    data.counters.emplace_back(name);
+    return data.counters.back().count;
+}
+
+/**
+ * \brief Record the estimated memory use of a calculation
+ *
+ * \param[in] name  A description of the calculation
+ * \param[in] bytes The estimated memory use [bytes]
+ *
+ * \details If the same calculation is recorded more than once, the largest
+ *          estimate is kept.  This is normally only used through fits_in_memory.
+ */
+void Profiler::add_memory(const char   *name,
+                          const size_t  bytes)
+{
+    auto &data = get_data();
+    std::lock_guard<std::mutex> lock(data.mutex);
+
+    for(auto &estimate : data.memory)
+    {
+        if(estimate.name == name)
+        {
+            estimate.bytes = std::max(estimate.bytes, bytes);
+            return;
+        }
+    }
+
+    data.memory.push_back(MemoryEstimate{name, bytes});
+}
+
+/**
+ * \brief Switch on recording of a timeline of the tasks in each thread
+ *
+ * \param[in] program_name The name of the program, which is given in the timeline
+ * \param[in] filename     The file to which the timeline is written
+ * \param[in] start        The time at which the program started
+ *
+ * \details The timeline is written automatically when the program exits, in
+ *          the Chrome trace-event (JSON) format.  The calling thread is shown as
+ *          the main thread.
+ */
+void Profiler::enable_trace(const std::string       &program_name,
+                            const std::string       &filename,
+                            const Clock::time_point &start)
+{
+    auto &data = get_trace_data();
+
+    {
+        std::lock_guard<std::mutex> lock(data.mutex);
+
+        const auto slash = program_name.find_last_of('/');
+        data.program  = (slash == std::string::npos) ? program_name : program_name.substr(slash + 1);
+        data.filename = filename;
+        data.start    = start;
+        data.written  = false;
+    }
+
+    // Make sure that the main thread is listed first
+    get_thread_trace();
+
+    if(!_tracing.exchange(true))
+        std::atexit(write_trace);
+}
+
+/**
+ * \brief Add a task to the timeline of the calling thread
+ *
+ * \param[in] name  The name of the task.  This must remain valid until the
+ *                  program exits.
+ * \param[in] start The time at which the task started
+ * \param[in] end   The time at which the task finished
+ */
+void Profiler::add_trace_event(const char              *name,
+                               const Clock::time_point &start,
+                               const Clock::time_point &end)
+{
+    auto &trace = get_thread_trace();
+    std::lock_guard<std::mutex> lock(trace.mutex);
+    trace.events.push_back(TraceEvent{name, start, end});
+}
+
+/**
+ * \brief Write the timeline of every thread
+ *
+ * \details This is called automatically when the program exits.  Each task is
+ *          written as a complete ("X") event, with times in microseconds from
+ *          the start of the program.  The timeline is only written once.
+ */
+void Profiler::write_trace()
+{
+    if(!is_tracing())
+        return;
+
+    auto &data = get_trace_data();
+    std::lock_guard<std::mutex> lock(data.mutex);
+
+    if(data.written)
+        return;
+
+    data.written = true;
+
+    std::ofstream stream(data.filename.c_str());
+
+    if(!stream)
+    {
+        std::cerr << "Could not open " << data.filename << " for timeline output" << std::endl;
+        return;
+    }
+
+    stream << std::fixed << std::setprecision(3)
+           << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << std::endl
+           << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": ";
+    write_json_string(stream, data.program);
+    stream << "}}";
+
+    unsigned int tid = 0;
+
+    for(auto &trace : data.threads)
+    {
+        std::lock_guard<std::mutex> thread_lock(trace.mutex);
+
+        stream << "," << std::endl
+               << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << tid
+               << ", \"args\": {\"name\": \"";
+
+        if(tid == 0)
+            stream << "main";
+        else
+            stream << "thread " << tid;
+
+        stream << "\"}}";
+
+        for(auto const &event : trace.events)
+        {
+            const std::chrono::duration<double, std::micro> ts  = event.start - data.start;
+            const std::chrono::duration<double, std::micro> dur = event.end   - event.start;
+
+            stream << "," << std::endl << "{\"name\": ";
+            write_json_string(stream, event.name);
+            stream << ", \"cat\": \"qwwad\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << tid
+                   << ", \"ts\": " << ts.count() << ", \"dur\": " << dur.count() << "}";
+        }
+
+        ++tid;
+    }
+
+    stream << std::endl << "]}" << std::endl;
+
+    if(!stream)
+        std::cerr << "Could not write timeline to " << data.filename << std::endl;
+}
+
+/**
+ * \brief Write the summary of all the phases
+ *
+ * \details This is called automatically when the program exits, so it only
+ *          needs to be called directly if the summary is wanted earlier.  The
+ *          summary is only written once.
+ */
+void Profiler::write_summary()
+{
+    if(!is_enabled())
+        return;
+
+    auto &data = get_data();
+    std::lock_guard<std::mutex> lock(data.mutex);
+
+    if(data.written)
+        return;
+
+    data.written = true;
+
+    const std::chrono::duration<double> total = Clock::now() - data.start;
+
+    if(data.filename.empty())
+        write_summary_to_stream(data, total.count(), std::cerr);
+    else
+    {
+        std::ofstream stream(data.filename.c_str(), std::ios::app);
+
+        if(!stream)
+            std::cerr << "Could not open " << data.filename << " for profiling output" << std::endl;
+        else
+            write_summary_to_stream(data, total.count(), stream);
+    }
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,208 @@
+/**
+ * \file   profiler.h
+ * \brief  Lightweight timing of the main phases of a calculation
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_PROFILER_H
+#define QWWAD_PROFILER_H
+
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace QWWAD
+{
+/**
+ * \brief Collects the time spent in each phase of a calculation
+ *
+ * \details Profiling is switched on by the \c --profile option, which is
+ *          common to all programs.  Time is then accumulated for each named
+ *          phase (e.g., "eigen-solve") by ScopedTimer objects, and a summary
+ *          is written when the program exits.  When profiling is switched
+ *          off, each timer costs a single flag check.
+ *
+ *          Timers may be used from several threads at once.  The time for a
+ *          phase is the sum over all the timers that used its name, so a
+ *          phase that runs in several threads may add up to more than the
+ *          total wall time.
+ *
+ *          If QWWAD is configured with ENABLE_COUNTERS, the summary also gives
+ *          the values of all the event counters (see QWWAD_COUNT).
+ *
+ *          The summary also gives the estimated memory use of any large
+ *          calculation that checked its size against the memory limit (see
+ *          fits_in_memory), and the peak memory use of the whole program.
+ *
+ *          Separately, a timeline of the work in each thread can be recorded by
+ *          the \c --tracefile option.  Every ScopedTimer and ScopedTraceEvent then
+ *          adds a begin/end event for its thread, and the timeline is written
+ *          in the Chrome trace format when the program exits.  This can be
+ *          viewed in Perfetto or chrome://tracing to see where threads sit idle.
+ */
+class Profiler
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /// Format of the summary
+    enum Format
+    {
+        CSV,
+        JSON
+    };
+
+    static void enable(const std::string       &program_name,
+                       const Format             format,
+                       const std::string       &filename,
+                       const Clock::time_point &start = Clock::now());
+
+    /// Return true if profiling is switched on
+    static bool is_enabled() {return _enabled.load(std::memory_order_relaxed);}
+
+    static void add_time(const char   *phase,
+                         const double  seconds);
+
+    static void write_summary();
+
+    static std::atomic<uint64_t> & get_counter(const char *name);
+
+    static void add_memory(const char   *name,
+                           const size_t  bytes);
+
+    static void enable_trace(const std::string       &program_name,
+                             const std::string       &filename,
+                             const Clock::time_point &start = Clock::now());
+
+    /// Return true if a timeline is being recorded
+    static bool is_tracing() {return _tracing.load(std::memory_order_relaxed);}
+
+    static void add_trace_event(const char              *name,
+                                const Clock::time_point &start,
+                                const Clock::time_point &end);
+
+    static void write_trace();
+
+private:
+    static std::atomic<bool> _enabled; ///< True if profiling is switched on
+    static std::atomic<bool> _tracing; ///< True if a timeline is being recorded
+};
+
+/**
+ * \brief Measures the time until the end of the scope, and adds it to a phase
+ *
+ * \details For example,
+ *          \code
+ *            {
+ *                ScopedTimer timer("eigen-solve");
+ *                calculate();
+ *            }
+ *          \endcode
+ */
+class ScopedTimer
+{
+public:
+    /**
+     * \brief Start timing a phase
+     *
+     * \param[in] phase The name of the phase.  This must remain valid until the
+     *                  timer is destroyed, or until the program exits if a
+     *                  timeline is being recorded.
+     */
+    explicit ScopedTimer(const char *phase) :
+        _phase((Profiler::is_enabled() || Profiler::is_tracing()) ? phase : nullptr),
+        _start(_phase ? Profiler::Clock::now() : Profiler::Clock::time_point())
+    {}
+
+    ~ScopedTimer()
+    {
+        if(_phase)
+        {
+            const auto end = Profiler::Clock::now();
+
+            if(Profiler::is_enabled())
+            {
+                const std::chrono::duration<double> dt = end - _start;
+                Profiler::add_time(_phase, dt.count());
+            }
+
+            if(Profiler::is_tracing())
+                Profiler::add_trace_event(_phase, _start, end);
+        }
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer & operator=(const ScopedTimer &) = delete;
+
+private:
+    const char                                  *_phase; ///< Name of phase (null if not profiling)
+    const Profiler::Clock::time_point            _start; ///< Time at which the timer was started
+};
+
+/**
+ * \brief Records a single task in the timeline, until the end of the scope
+ *
+ * \details Unlike ScopedTimer, the task is not added to the profiling summary, so
+ *          this can mark each item of a parallel loop (e.g., one k-point or one
+ *          sweep point) without filling the summary with tiny phases.  When no
+ *          timeline is being recorded, each event costs a single flag check.
+ */
+class ScopedTraceEvent
+{
+public:
+    /**
+     * \brief Start a task
+     *
+     * \param[in] name The name of the task.  This must remain valid until the
+     *                 program exits, so it should normally be a string literal.
+     */
+    explicit ScopedTraceEvent(const char *name) :
+        _name(Profiler::is_tracing() ? name : nullptr),
+        _start(_name ? Profiler::Clock::now() : Profiler::Clock::time_point())
+    {}
+
+    ~ScopedTraceEvent()
+    {
+        if(_name)
+            Profiler::add_trace_event(_name, _start, Profiler::Clock::now());
+    }
+
+    ScopedTraceEvent(const ScopedTraceEvent &) = delete;
+    ScopedTraceEvent & operator=(const ScopedTraceEvent &) = delete;
+
+private:
+    const char                      *_name;  ///< Name of task (null if not tracing)
+    const Profiler::Clock::time_point _start; ///< Time at which the task started
+};
+} // namespace
+
+/**
+ * \def QWWAD_COUNT_N(name, n)
+ * \brief Add n to the event counter with the given name
+ *
+ * \details Counters are only compiled in if QWWAD is configured with
+ *          ENABLE_COUNTERS, and otherwise cost nothing.  The counter for each
+ *          call site is looked up once, and is then updated atomically, so
+ *          counters may be used in hot loops and from several threads.
+ *          Call sites that use the same name share a counter.
+ */
+#if QWWAD_COUNTERS
+# define QWWAD_COUNT_N(name, n)                                                 \
+    do {                                                                     \
+        static std::atomic<uint64_t> &qwwad_counter_                         \
+            = QWWAD::Profiler::get_counter(name);                            \
+        qwwad_counter_.fetch_add((n), std::memory_order_relaxed);            \
+    } while(0)
+#else
+# define QWWAD_COUNT_N(name, n) do {} while(0)
+#endif
+
+/// Add one to the event counter with the given name
+#define QWWAD_COUNT(name) QWWAD_COUNT_N(name, 1)
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
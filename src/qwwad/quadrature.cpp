@@ -0,0 +1,123 @@
+/**
+ * \file   quadrature.cpp
+ * \brief  Precomputed quadrature weights for repeated integrals over a fixed grid
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "quadrature.h"
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "maths-helpers.h"
+
+namespace QWWAD
+{
+/**
+ * \brief Create a quadrature rule for evenly spaced samples
+ *
+ * \param[in] n  Number of samples
+ * \param[in] dx Spacing between samples
+ *
+ * \details Simpson's rule is used if n is odd, and >= 3.  The trapezium
+ *          rule is used otherwise.
+ */
+Quadrature::Quadrature(const size_t n,
+                       const double dx) :
+    _w(integral_weights(n, dx))
+{}
+
+/**
+ * \brief Create a quadrature rule for a (possibly) nonuniform set of samples
+ *
+ * \param[in] x Locations of the samples
+ *
+ * \details This gives the same results as integral(y, x)
+ */
+Quadrature::Quadrature(const arma::vec &x) :
+    _w(integral_weights(x))
+{}
+
+/**
+ * \brief Create a quadrature rule for samples that are evenly spaced in a mapped variable
+ *
+ * \param[in] du    Spacing between samples of the mapped variable, u
+ * \param[in] dx_du Derivative of the sample location with respect to u, at each sample
+ *
+ * \details The locations are x(u_i), where u_i is evenly spaced.  The integral
+ *          over x is found as an integral over u, using the same rule as for
+ *          evenly spaced samples, with each weight scaled by dx/du.  A mapping
+ *          that puts more samples where the integrand varies quickly can then
+ *          give the same accuracy with far fewer samples.
+ */
+Quadrature::Quadrature(const double     du,
+                       const arma::vec &dx_du) :
+    _w(integral_weights(dx_du.size(), du) % dx_du)
+{}
+
+/**
+ * \brief Check that a set of samples matches the quadrature rule
+ *
+ * \param[in] n Number of samples
+ */
+void Quadrature::check_size(const size_t n) const
+{
+    if(n != _w.size())
+    {
+        std::ostringstream oss;
+        oss << "Cannot integrate " << n << " samples using a quadrature rule for "
+            << _w.size() << " points.";
+        throw std::length_error(oss.str());
+    }
+}
+/**
+ * \brief Get the quadrature rule for a shared spatial grid
+ *
+ * \param[in] x Locations of the samples, shared between the objects that use them
+ *
+ * \returns The rule for the grid
+ *
+ * \details The rule is only found once for each grid, however many states or
+ *          calculators use it.  A rule is kept for as long as its grid exists,
+ *          and is forgotten once the grid has been deleted.
+ */
+std::shared_ptr<const Quadrature> get_shared_quadrature(const std::shared_ptr<const arma::vec> &x)
+{
+    // Each entry holds a weak reference to its grid, so that a new grid that
+    // happens to reuse the address of a deleted one isn't given the old rule
+    typedef std::pair<std::weak_ptr<const arma::vec>, std::shared_ptr<const Quadrature>> CacheEntry;
+
+    static std::map<const arma::vec *, CacheEntry> cache;
+    static std::mutex                              cache_mutex;
+
+    if(!x)
+        throw std::invalid_argument("Cannot find a quadrature rule without a spatial grid.");
+
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        const auto it = cache.find(x.get());
+
+        if(it != cache.end() && it->second.first.lock() == x)
+            return it->second.second;
+    }
+
+    // Find the weights without holding the lock
+    const auto quadrature = std::make_shared<const Quadrature>(*x);
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+
+    // Forget the rules for any grids that have been deleted
+    for(auto it = cache.begin(); it != cache.end();)
+    {
+        if(it->second.first.expired())
+            it = cache.erase(it);
+        else
+            ++it;
+    }
+
+    return cache.insert(std::make_pair(x.get(), CacheEntry(x, quadrature))).first->second.second;
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,179 @@
+/**
+ * \file   quadrature.h
+ * \brief  Precomputed quadrature weights for repeated integrals over a fixed grid
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_QUADRATURE_H
+#define QWWAD_QUADRATURE_H
+
+#include <cstddef>
+#include <memory>
+#include <armadillo>
+
+namespace QWWAD
+{
+/**
+ * \brief Quadrature rule for a fixed set of sample locations
+ *
+ * \details The weights are found once, using the same rule as integral(), so that
+ *          each integral is just a weighted sum of the samples.  Integrals of a
+ *          product of two or three sampled functions are found in a single pass,
+ *          without storing the integrand.
+ *
+ *          The sums are split between several independent accumulators, so that
+ *          the compiler can evaluate them using vector instructions.
+ */
+class Quadrature
+{
+private:
+    arma::vec _w; ///< Weight for each sample [units of x]
+
+    void check_size(const size_t n) const;
+
+public:
+    /// Create an empty rule, to be replaced before use
+    Quadrature() {}
+
+    Quadrature(const size_t n,
+               const double dx);
+
+    explicit Quadrature(const arma::vec &x);
+
+    Quadrature(const double     du,
+               const arma::vec &dx_du);
+
+    /// Get the weight for each sample
+    const arma::vec & get_weights() const {return _w;}
+
+    /// Get the number of samples
+    size_t size() const {return _w.size();}
+
+    template <class T>
+    T integrate(const arma::Col<T> &y) const;
+
+    template <class T>
+    T integrate(const arma::Col<T> &a,
+                const arma::vec    &b) const;
+
+    template <class T>
+    T integrate(const arma::Col<T> &a,
+                const arma::vec    &b,
+                const arma::vec    &c) const;
+};
+
+std::shared_ptr<const Quadrature> get_shared_quadrature(const std::shared_ptr<const arma::vec> &x);
+
+/**
+ * \brief Integrate a sampled function
+ *
+ * \param[in] y Samples of the function
+ *
+ * \returns The integral
+ */
+template <class T>
+T Quadrature::integrate(const arma::Col<T> &y) const
+{
+    check_size(y.size());
+
+    const size_t  n  = _w.size();
+    const double *w  = _w.memptr();
+    const T      *py = y.memptr();
+
+    T sum[4] = {T(0), T(0), T(0), T(0)};
+    size_t i = 0;
+
+    for(; i + 4 <= n; i += 4)
+    {
+        sum[0] += w[i]   * py[i];
+        sum[1] += w[i+1] * py[i+1];
+        sum[2] += w[i+2] * py[i+2];
+        sum[3] += w[i+3] * py[i+3];
+    }
+
+    for(; i < n; ++i)
+        sum[0] += w[i] * py[i];
+
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+/**
+ * \brief Integrate the product of two sampled functions
+ *
+ * \param[in] a Samples of the first function
+ * \param[in] b Samples of the second function
+ *
+ * \returns The integral of a*b
+ */
+template <class T>
+T Quadrature::integrate(const arma::Col<T> &a,
+                        const arma::vec    &b) const
+{
+    check_size(a.size());
+    check_size(b.size());
+
+    const size_t  n  = _w.size();
+    const double *w  = _w.memptr();
+    const T      *pa = a.memptr();
+    const double *pb = b.memptr();
+
+    T sum[4] = {T(0), T(0), T(0), T(0)};
+    size_t i = 0;
+
+    for(; i + 4 <= n; i += 4)
+    {
+        sum[0] += w[i]   * pb[i]   * pa[i];
+        sum[1] += w[i+1] * pb[i+1] * pa[i+1];
+        sum[2] += w[i+2] * pb[i+2] * pa[i+2];
+        sum[3] += w[i+3] * pb[i+3] * pa[i+3];
+    }
+
+    for(; i < n; ++i)
+        sum[0] += w[i] * pb[i] * pa[i];
+
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+/**
+ * \brief Integrate the product of three sampled functions
+ *
+ * \param[in] a Samples of the first function
+ * \param[in] b Samples of the second function
+ * \param[in] c Samples of the third function
+ *
+ * \returns The integral of a*b*c
+ */
+template <class T>
+T Quadrature::integrate(const arma::Col<T> &a,
+                        const arma::vec    &b,
+                        const arma::vec    &c) const
+{
+    check_size(a.size());
+    check_size(b.size());
+    check_size(c.size());
+
+    const size_t  n  = _w.size();
+    const double *w  = _w.memptr();
+    const T      *pa = a.memptr();
+    const double *pb = b.memptr();
+    const double *pc = c.memptr();
+
+    T sum[4] = {T(0), T(0), T(0), T(0)};
+    size_t i = 0;
+
+    for(; i + 4 <= n; i += 4)
+    {
+        sum[0] += w[i]   * pb[i]   * pc[i]   * pa[i];
+        sum[1] += w[i+1] * pb[i+1] * pc[i+1] * pa[i+1];
+        sum[2] += w[i+2] * pb[i+2] * pc[i+2] * pa[i+2];
+        sum[3] += w[i+3] * pb[i+3] * pc[i+3] * pa[i+3];
+    }
+
+    for(; i < n; ++i)
+        sum[0] += w[i] * pb[i] * pc[i] * pa[i];
+
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,261 @@
+/**
+ * \file   radial-program.cpp
+ * \author Paul Harrison  <p.harrison@shu.ac.uk>
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Shared front end for the spherical-dot and cylindrical-wire programs
+ */
+
+#include "radial-program.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "constants.h"
+#include "file-io.h"
+#include "parallel.h"
+#include "schroedinger-solver-radial.h"
+
+namespace QWWAD
+{
+using namespace constants;
+
+namespace
+{
+/// Name of the structure, for use in help messages
+std::string get_structure_name(const RadialGeometry geometry)
+{
+    return (geometry == RadialGeometry::SPHERICAL_DOT) ? "dot" : "wire";
+}
+
+/**
+ * \brief Find the states in a given radial potential
+ *
+ * \param[in] opt      User options
+ * \param[in] geometry Geometry of the structure
+ * \param[in] me       Band-edge effective mass [kg]
+ * \param[in] alpha    Nonparabolicity parameter [1/J]
+ * \param[in] V        Confining potential [J]
+ * \param[in] r        Radial locations [m]
+ * \param[in] guess    Approximate states, e.g., from the previous radius in a sweep
+ *
+ * \returns The states
+ */
+std::vector<Eigenstate> solve(const Options                 &opt,
+                              const RadialGeometry           geometry,
+                              const arma::vec               &me,
+                              const arma::vec               &alpha,
+                              const arma::vec               &V,
+                              const arma::vec               &r,
+                              const std::vector<Eigenstate> &guess)
+{
+    const auto dE     = opt.get_option<double>("dE")*e/1000;
+    const auto lambda = opt.get_option<unsigned int>("angularmomentum");
+    const auto nst    = opt.get_option<size_t>("nst");
+
+    std::unique_ptr<SchroedingerSolverRadial> se;
+
+    if(geometry == RadialGeometry::SPHERICAL_DOT)
+        se.reset(new SchroedingerSolverSphericalDot(me, alpha, V, r, dE, lambda, nst));
+    else
+        se.reset(new SchroedingerSolverCylindricalWire(me, alpha, V, r, dE, lambda, nst));
+
+    if(opt.get_argument_known("Estart"))
+        se->set_E_min(opt.get_option<double>("Estart")*e/1000);
+
+    se->set_initial_guess(guess);
+    return se->get_solutions();
+}
+
+/**
+ * \brief Find the energies for each radius in a list
+ *
+ * \param[in] opt      User options
+ * \param[in] geometry Geometry of the structure
+ *
+ * \details The radii are split into contiguous blocks, which are solved in
+ *          parallel.  Within each block, the states at each radius are used as
+ *          the starting point for the next radius.
+ */
+void sweep_radii(const Options        &opt,
+                 const RadialGeometry  geometry)
+{
+    const auto radii = opt.get_numeric_list("radii", 1e-10);
+    const auto Lb    = opt.get_option<double>("barrierwidth")*1e-10; // Barrier width [m]
+    const auto V0    = opt.get_option<double>("Vbarrier")*e/1000;    // Barrier potential [J]
+    const auto m     = opt.get_option<double>("mass")*me;            // Effective mass [kg]
+    const auto dr    = opt.get_option<double>("dr")*1e-10;           // Radial spacing [m]
+    const auto nR    = radii.size();
+
+    std::vector<arma::vec> E(nR); // Energies at each radius [meV]
+
+    const size_t n_blocks = std::min<size_t>(get_thread_count(opt.get_option<unsigned int>("threads")), nR);
+
+    run_in_parallel(n_blocks, n_blocks, [&](const size_t iblock) {
+        const size_t first = iblock*nR/n_blocks;
+        const size_t last  = (iblock+1)*nR/n_blocks;
+
+        std::vector<Eigenstate> guess;
+
+        for(size_t iR = first; iR < last; ++iR)
+        {
+            const size_t    nr = static_cast<size_t>((radii[iR] + Lb)/dr + 0.5) + 1;
+            const arma::vec r  = arma::linspace(0, (nr-1)*dr, nr);
+            arma::vec V(nr);
+
+            for(unsigned int ir = 0; ir < nr; ++ir)
+                V[ir] = (r[ir] > radii[iR]) ? V0 : 0;
+
+            guess = solve(opt, geometry, m*arma::ones(nr), arma::zeros(nr), V, r, guess);
+
+            E[iR].set_size(guess.size());
+
+            for(unsigned int ist = 0; ist < guess.size(); ++ist)
+                E[iR][ist] = guess[ist].get_energy()*1000/e;
+        }
+    });
+
+    std::string sweepfile;
+
+    if(opt.get_argument_known("sweepfile"))
+        sweepfile = opt.get_option<std::string>("sweepfile");
+    else
+    {
+        std::ostringstream oss;
+        oss << "E" << opt.get_option<char>("particle") << "-R.r";
+        sweepfile = oss.str();
+    }
+
+    TableWriter stream(sweepfile, 17, true);
+
+    for(unsigned int iR = 0; iR < nR; ++iR)
+    {
+        stream << radii[iR]*1e10;
+
+        for(auto const E_st : E[iR])
+            stream << ' ' << E_st;
+
+        stream << '\n';
+    }
+}
+} // namespace
+
+/**
+ * \brief Configure command-line options for the spherical-dot or cylindrical-wire program
+ *
+ * \param[in] argc     Number of command-line arguments
+ * \param[in] argv     Command-line arguments
+ * \param[in] geometry Geometry of the structure
+ */
+Options configure_radial_options(int             argc,
+                                 char           *argv[],
+                                 RadialGeometry  geometry)
+{
+    Options opt;
+
+    const auto is_dot = (geometry == RadialGeometry::SPHERICAL_DOT);
+    const auto name   = get_structure_name(geometry);
+
+    const std::string doc(is_dot ? "Find the eigenstates of a spherical quantum dot."
+                                 : "Find the eigenstates of a cylindrical quantum wire.");
+
+    const std::string angular_doc(is_dot ? "Orbital angular momentum quantum number, l."
+                                         : "Angular momentum quantum number, m.");
+
+    opt.add_option<bool>        ("nonparabolic,a",       "Include nonparabolicity, using the profile in alpha.r [1/J].");
+    opt.add_option<double>      ("dE,d",              1, "Initial energy step when searching for states [meV].");
+    opt.add_option<double>      ("Estart,e",             "Energy at which to start searching for states [meV].  Any "
+                                                         "states below it are skipped.  By default, the search starts "
+                                                         "at the bottom of the potential.");
+    opt.add_option<size_t>      ("nst,s",             1, "Number of states to find.");
+    opt.add_option<char>        ("particle,p",      'e', "ID of particle to be used: 'e', 'h' or 'l', for "
+                                                         "electrons, heavy holes or light holes respectively.  This "
+                                                         "only sets the names of the output files; the mass and "
+                                                         "potential are taken from the input files or options.");
+    opt.add_option<unsigned int>("angularmomentum",   0, angular_doc);
+    opt.add_option<std::string> ("radii",                "Comma-separated list of " + name + " radii [angstrom].  If "
+                                                         "given, the energies are found for a " + name + " in a "
+                                                         "barrier at each radius, rather than for the potential in v.r.");
+    opt.add_option<double>      ("barrierwidth",    200, "Thickness of barrier around the " + name + ", for --radii "
+                                                         "[angstrom].");
+    opt.add_option<double>      ("Vbarrier",          0, "Barrier potential, for --radii [meV].");
+    opt.add_option<double>      ("mass",          0.067, "Effective mass, for --radii (relative to free electron).");
+    opt.add_option<double>      ("dr",                1, "Radial spacing of samples, for --radii [angstrom].");
+    opt.add_option<std::string> ("sweepfile",            "Filename to which the energies at each radius are written.  "
+                                                         "The default is E*-R.r, where * is the particle ID.");
+    opt.add_option<unsigned int>("threads",           0, "Number of radii to solve at once (0 = one per CPU core).");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, doc);
+
+    const auto p = opt.get_option<char>("particle");
+
+    if(p != 'e' && p != 'h' && p != 'l')
+    {
+        std::cerr << "Unknown particle ID: " << p << ".  Use 'e', 'h' or 'l'." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return opt;
+}
+
+/**
+ * \brief Run the spherical-dot or cylindrical-wire program
+ *
+ * \param[in] opt      User options, from configure_radial_options
+ * \param[in] geometry Geometry of the structure
+ *
+ * \returns The exit status of the program
+ *
+ * \details If a list of radii is given, the energies at each radius are written to
+ *          the sweep file.  Otherwise, the potential, mass and (optionally)
+ *          nonparabolicity are read from v.r, m.r and alpha.r, and the energies are
+ *          written to E*.r.
+ */
+int run_radial_program(const Options  &opt,
+                       RadialGeometry  geometry)
+{
+    if(opt.get_argument_known("radii"))
+    {
+        sweep_radii(opt, geometry);
+        return EXIT_SUCCESS;
+    }
+
+    const auto p = opt.get_option<char>("particle"); // Particle ID
+
+    arma::vec r;  // Radial locations [m]
+    arma::vec V;  // Confining potential [J]
+    arma::vec m;  // Band-edge effective mass [kg]
+    arma::vec r_tmp;
+    read_table("v.r", r, V);
+    read_table("m.r", r_tmp, m);
+
+    arma::vec alpha = arma::zeros(r.size()); // Nonparabolicity [1/J]
+
+    if(opt.get_option<bool>("nonparabolic"))
+        read_table("alpha.r", r_tmp, alpha);
+
+    if(m.size() != r.size() || alpha.size() != r.size())
+    {
+        std::cerr << "The potential, mass and nonparabolicity files must have the same length." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto solutions = solve(opt, geometry, m, alpha, V, r, std::vector<Eigenstate>());
+
+    arma::vec E(solutions.size()); // Energy of each state [meV]
+
+    for(unsigned int ist = 0; ist < solutions.size(); ++ist)
+        E[ist] = solutions[ist].get_energy()*1000/e;
+
+    std::ostringstream E_filename;
+    E_filename << "E" << p << ".r";
+    write_table(E_filename.str(), E, true, 17);
+
+    return EXIT_SUCCESS;
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,31 @@
+/**
+ * \file   radial-program.h
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Shared front end for the spherical-dot and cylindrical-wire programs
+ */
+
+#ifndef QWWAD_RADIAL_PROGRAM_H
+#define QWWAD_RADIAL_PROGRAM_H
+
+#include "options.h"
+
+namespace QWWAD
+{
+/**
+ * \brief Geometry of a radially-symmetric structure
+ */
+enum class RadialGeometry
+{
+    SPHERICAL_DOT,   ///< Potential depends on distance from a point
+    CYLINDRICAL_WIRE ///< Potential depends on distance from an axis
+};
+
+Options configure_radial_options(int             argc,
+                                 char           *argv[],
+                                 RadialGeometry  geometry);
+
+int run_radial_program(const Options  &opt,
+                       RadialGeometry  geometry);
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
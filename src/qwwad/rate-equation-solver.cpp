@@ -0,0 +1,219 @@
+/**
+ * \file   rate-equation-solver.cpp
+ * \brief  Self-consistent solver for subband populations in a rate-equation model
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include "rate-equation-solver.h"
+#include "anderson-mixer.h"
+
+namespace QWWAD
+{
+/**
+ * \brief Create a solver for a set of subbands
+ *
+ * \param[in] nsb Number of subbands
+ */
+RateEquationSolver::RateEquationSolver(const decltype(_nsb) nsb) :
+    _nsb(nsb),
+    _tol(1e-6),
+    _max_iter(100),
+    _mixing_depth(5),
+    _mixing_factor(1.0),
+    _n_iter(0),
+    _W(nsb, nsb, arma::fill::zeros)
+{
+    if(_nsb < 2)
+    {
+        std::ostringstream oss;
+        oss << "A rate-equation model needs at least 2 subbands.  Got " << _nsb;
+        throw std::domain_error(oss.str());
+    }
+}
+
+/**
+ * \brief Add a scattering mechanism
+ *
+ * \param[in] rates A function that returns the matrix of average rates for a set
+ *                  of populations
+ */
+void RateEquationSolver::add_mechanism(const RateFunction &rates)
+{
+    _mechanisms.push_back(rates);
+}
+
+/**
+ * \brief Add an LO-phonon scattering calculator as a mechanism
+ *
+ * \details Both emission and absorption are included.  The calculator is left in
+ *          whichever mode it was in beforehand.
+ */
+void RateEquationSolver::add_calculator(ScatteringCalculatorLO &calculator)
+{
+    const auto nsb = _nsb;
+
+    add_mechanism([&calculator, nsb](const arma::vec &N) {
+        const bool is_emission = calculator.is_emission();
+        calculator.set_subband_populations(N);
+
+        calculator.set_emission(true);
+        arma::mat W = get_rates(calculator, nsb);
+        calculator.set_emission(false);
+        W += get_rates(calculator, nsb);
+
+        calculator.set_emission(is_emission);
+        return W;
+    });
+}
+
+/**
+ * \brief Set the parameters for Anderson mixing
+ *
+ * \param[in] depth  Number of previous iterations to use (0 = linear mixing)
+ * \param[in] factor Mixing factor for the residual (0 < factor <= 1)
+ */
+void RateEquationSolver::set_mixing(const decltype(_mixing_depth)  depth,
+                                    const decltype(_mixing_factor) factor)
+{
+    if(factor <= 0.0 || factor > 1.0)
+    {
+        std::ostringstream oss;
+        oss << "Mixing factor must lie in the range (0,1].  Got " << factor;
+        throw std::domain_error(oss.str());
+    }
+
+    _mixing_depth  = depth;
+    _mixing_factor = factor;
+}
+
+/**
+ * \brief Find the total rate matrix from all mechanisms for a set of populations
+ */
+arma::mat RateEquationSolver::find_rate_matrix(const arma::vec &N) const
+{
+    arma::mat W(_nsb, _nsb, arma::fill::zeros);
+
+    for(auto const &mechanism : _mechanisms)
+    {
+        const arma::mat W_mech = mechanism(N);
+
+        if(W_mech.n_rows != _nsb || W_mech.n_cols != _nsb)
+        {
+            std::ostringstream oss;
+            oss << "Scattering mechanism returned a " << W_mech.n_rows << "x" << W_mech.n_cols
+                << " rate matrix for " << _nsb << " subbands.";
+            throw std::length_error(oss.str());
+        }
+
+        W += W_mech;
+    }
+
+    return W;
+}
+
+/**
+ * \brief Find the steady-state populations for a fixed rate matrix
+ *
+ * \param[in] W       Average rate from each subband (row) to each other subband (column) [1/s]
+ * \param[in] N_total Total population [m^{-2}]
+ *
+ * \details The rate equations are linearly dependent, so the last one is replaced
+ *          by the condition that the total population is fixed.
+ */
+arma::vec RateEquationSolver::find_steady_state(const arma::mat &W,
+                                                const double     N_total) const
+{
+    arma::mat A(_nsb, _nsb, arma::fill::zeros);
+    arma::vec b(_nsb, arma::fill::zeros);
+
+    for(unsigned int i = 0; i < _nsb; ++i)
+    {
+        for(unsigned int j = 0; j < _nsb; ++j)
+        {
+            if(i != j)
+            {
+                A(i,j)  = W(j,i); // Scattering into subband i
+                A(i,i) -= W(i,j); // Scattering out of subband i
+            }
+        }
+    }
+
+    for(unsigned int j = 0; j < _nsb; ++j)
+        A(_nsb-1, j) = 1.0;
+
+    b[_nsb-1] = N_total;
+
+    arma::vec N;
+
+    if(!arma::solve(N, A, b))
+        throw std::runtime_error("Could not solve rate equations.  Check that every subband is connected by a nonzero rate.");
+
+    return N;
+}
+
+/**
+ * \brief Find the self-consistent steady-state populations
+ *
+ * \param[in] N_guess Initial estimate of the population of each subband [m^{-2}].
+ *                    The total population is kept fixed at the sum of these values.
+ *
+ * \returns The population of each subband [m^{-2}]
+ */
+arma::vec RateEquationSolver::solve(const arma::vec &N_guess)
+{
+    if(N_guess.size() != _nsb)
+    {
+        std::ostringstream oss;
+        oss << "Got " << N_guess.size() << " populations for " << _nsb << " subbands.";
+        throw std::length_error(oss.str());
+    }
+
+    if(_mechanisms.empty())
+        throw std::runtime_error("No scattering mechanisms have been added to the rate-equation solver.");
+
+    double N_total = 0.0;
+
+    for(unsigned int isb = 0; isb < _nsb; ++isb)
+        N_total += N_guess[isb];
+
+    if(N_total <= 0.0)
+        throw std::domain_error("Total population must be positive.");
+
+    // Keep every population slightly above zero, so that a Fermi energy can be found
+    const double N_floor = 1e-12*N_total;
+
+    AndersonMixer mixer(_mixing_depth, _mixing_factor);
+    arma::vec N = N_guess;
+
+    for(_n_iter = 1; _n_iter <= _max_iter; ++_n_iter)
+    {
+        _W = find_rate_matrix(N);
+        const arma::vec N_new = find_steady_state(_W, N_total);
+
+        double dN_max = 0.0;
+
+        for(unsigned int isb = 0; isb < _nsb; ++isb)
+            dN_max = std::max(dN_max, fabs(N_new[isb] - N[isb]));
+
+        if(dN_max <= _tol*N_total)
+            return N_new;
+
+        N = mixer.mix(N, N_new);
+
+        for(unsigned int isb = 0; isb < _nsb; ++isb)
+        {
+            if(N[isb] < N_floor)
+                N[isb] = N_floor;
+        }
+    }
+
+    std::ostringstream oss;
+    oss << "Subband populations did not converge within " << _max_iter << " iterations.";
+    throw std::runtime_error(oss.str());
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
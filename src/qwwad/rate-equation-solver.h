@@ -0,0 +1,123 @@
+/**
+ * \file   rate-equation-solver.h
+ * \brief  Self-consistent solver for subband populations in a rate-equation model
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_RATE_EQUATION_SOLVER_H
+#define QWWAD_RATE_EQUATION_SOLVER_H
+
+#include <functional>
+#include <vector>
+#include <armadillo>
+#include "scattering-calculator-LO.h"
+
+namespace QWWAD
+{
+/**
+ * \brief Solver for the steady-state populations of a set of subbands
+ *
+ * \details The population of each subband satisfies
+ *          \f[
+ *            \frac{\mathrm{d}N_i}{\mathrm{d}t} = \sum_{j\neq i} N_j\overline{W}_{ji}
+ *                                              - N_i\sum_{j\neq i}\overline{W}_{ij} = 0,
+ *          \f]
+ *          where \f$\overline{W}_{ij}\f$ is the average scattering rate from subband
+ *          \f$i\f$ to \f$j\f$, and the total population is fixed.  The rates depend on
+ *          the populations through final-state blocking and screening, so the
+ *          equations are solved repeatedly, using Anderson acceleration, until the
+ *          populations stop changing.
+ *
+ *          Each scattering mechanism is a function that returns the matrix of
+ *          average rates for a given set of populations.  Scattering calculators
+ *          can be added directly.  They keep their form-factor tables between
+ *          iterations, so only the population-dependent parts of the rates are
+ *          found again.
+ */
+class RateEquationSolver {
+public:
+    /// A function that finds the matrix of average rates \f$\overline{W}_{ij}\f$ [1/s] for a set of populations [m^{-2}]
+    typedef std::function<arma::mat (const arma::vec &N)> RateFunction;
+
+private:
+    size_t _nsb; ///< Number of subbands
+
+    std::vector<RateFunction> _mechanisms; ///< Scattering mechanisms
+
+    double _tol;           ///< Convergence tolerance, relative to total population
+    size_t _max_iter;      ///< Maximum number of iterations
+    size_t _mixing_depth;  ///< Number of previous iterations used in Anderson mixing
+    double _mixing_factor; ///< Mixing factor for Anderson mixing
+
+    size_t    _n_iter; ///< Number of iterations used in the last solution
+    arma::mat _W;      ///< Total rate matrix at the last solution [1/s]
+
+    arma::mat find_rate_matrix(const arma::vec &N) const;
+
+    arma::vec find_steady_state(const arma::mat &W,
+                                const double     N_total) const;
+
+    /**
+     * \brief Find the matrix of average rates from a scattering calculator
+     */
+    template <class Calculator>
+    static arma::mat get_rates(Calculator   &calculator,
+                               const size_t  nsb)
+    {
+        arma::mat W(nsb, nsb, arma::fill::zeros);
+
+        for(unsigned int i = 0; i < nsb; ++i)
+        {
+            for(unsigned int f = 0; f < nsb; ++f)
+            {
+                if(i != f)
+                    W(i,f) = calculator.get_transition(i,f).get_average_rate();
+            }
+        }
+
+        return W;
+    }
+
+public:
+    RateEquationSolver(const decltype(_nsb) nsb);
+
+    void add_mechanism(const RateFunction &rates);
+
+    /**
+     * \brief Add a scattering calculator as a mechanism
+     *
+     * \param[in] calculator A calculator for the same subbands.  It must stay alive
+     *                       until the solver has finished with it.
+     *
+     * \details The subband populations in the calculator are updated at each iteration.
+     */
+    template <class Calculator>
+    void add_calculator(Calculator &calculator)
+    {
+        const auto nsb = _nsb;
+
+        add_mechanism([&calculator, nsb](const arma::vec &N) {
+            calculator.set_subband_populations(N);
+            return get_rates(calculator, nsb);
+        });
+    }
+
+    void add_calculator(ScatteringCalculatorLO &calculator);
+
+    inline void set_tolerance     (const decltype(_tol)      tol)      {_tol      = tol;}
+    inline void set_max_iterations(const decltype(_max_iter) max_iter) {_max_iter = max_iter;}
+
+    void set_mixing(const decltype(_mixing_depth)  depth,
+                    const decltype(_mixing_factor) factor);
+
+    arma::vec solve(const arma::vec &N_guess);
+
+    /// Return the number of iterations used in the last solution
+    inline decltype(_n_iter) get_iterations() const {return _n_iter;}
+
+    /// Return the total rate matrix at the last solution [1/s]
+    inline decltype(_W) const & get_rate_matrix() const {return _W;}
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
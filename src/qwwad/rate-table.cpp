@@ -0,0 +1,263 @@
+/**
+ * \file   rate-table.cpp
+ * \brief  Table of average scattering rates as a function of carrier temperature
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "rate-table.h"
+#include "file-io.h"
+
+namespace QWWAD
+{
+/**
+ * \brief Create a table of rates
+ *
+ * \param[in] T           Temperature samples, which must be uniformly spaced [K]
+ * \param[in] transitions Initial and final subband indices (counting from 0)
+ * \param[in] W           Rate for each transition (row) at each temperature (column) [1/s]
+ */
+RateTable::RateTable(const decltype(_T)           &T,
+                     const decltype(_transitions) &transitions,
+                     const decltype(_W)           &W) :
+    _T(T),
+    _transitions(transitions),
+    _W(W),
+    _dT(0.0)
+{
+    if(_T.size() < 2)
+    {
+        std::ostringstream oss;
+        oss << "A rate table needs at least 2 temperature samples, but " << _T.size() << " were given.";
+        throw std::length_error(oss.str());
+    }
+
+    if(_W.n_rows != _transitions.size() || _W.n_cols != _T.size())
+    {
+        std::ostringstream oss;
+        oss << "Rate table has " << _W.n_rows << "x" << _W.n_cols << " entries, but "
+            << _transitions.size() << " transitions and " << _T.size() << " temperatures were given.";
+        throw std::length_error(oss.str());
+    }
+
+    _dT = (_T[_T.size()-1] - _T[0])/(_T.size()-1);
+
+    for(unsigned int iT = 1; iT < _T.size(); ++iT)
+    {
+        if(_dT <= 0.0 || fabs(_T[iT] - _T[iT-1] - _dT) > 1e-6*_dT)
+        {
+            std::ostringstream oss;
+            oss << "Temperature samples in a rate table must be uniformly spaced and increasing. "
+                << "Sample " << iT << " is " << _T[iT] << " K, but "
+                << _T[0] + iT*_dT << " K was expected.";
+            throw std::domain_error(oss.str());
+        }
+    }
+
+    for(unsigned int itx = 0; itx < _transitions.size(); ++itx)
+        _index[_transitions[itx]] = itx;
+}
+
+/**
+ * \brief Read the lines of a rate table as lists of numbers
+ *
+ * \param[in] stream The contents of the table
+ *
+ * \returns The numbers on each non-blank line
+ */
+static std::vector<std::vector<double>> read_rate_lines(std::istream &stream)
+{
+    std::vector<std::vector<double>> lines;
+    std::string line;
+
+    while(std::getline(stream, line))
+    {
+        std::istringstream line_stream(line);
+        std::vector<double> values;
+        double value = 0.0;
+
+        while(line_stream >> value)
+            values.push_back(value);
+
+        if(!values.empty())
+            lines.push_back(values);
+    }
+
+    return lines;
+}
+
+/**
+ * \brief Read a table of rates from file
+ *
+ * \param[in] filename The name of the file
+ *
+ * \details If the table was received through a pipe or is held in a project
+ *          file, it is read from memory instead.
+ */
+RateTable RateTable::read_from_file(const std::string &filename)
+{
+    std::vector<std::vector<double>> lines;
+    const auto table = find_piped_table(filename);
+
+    if(table && table->numeric)
+    {
+        const double *values = table->values.data();
+
+        for(auto const n : table->row_lengths)
+        {
+            if(n > 0)
+                lines.push_back(std::vector<double>(values, values + n));
+
+            values += n;
+        }
+    }
+    else if(table)
+    {
+        std::istringstream stream(table->text);
+        lines = read_rate_lines(stream);
+    }
+    else
+    {
+        wait_for_async_file(filename);
+        std::ifstream stream(filename.c_str());
+
+        if(!stream)
+        {
+            std::ostringstream oss;
+            oss << "Could not open rate table " << filename;
+            throw std::runtime_error(oss.str());
+        }
+
+        lines = read_rate_lines(stream);
+    }
+
+    std::vector<map_key> transitions;
+    std::vector<std::vector<double>> rows;
+
+    for(auto const &values : lines)
+    {
+        if(values.size() < 2)
+            continue;
+
+        const auto i = static_cast<unsigned int>(values[0]);
+        const auto f = static_cast<unsigned int>(values[1]);
+        const std::vector<double> row(values.begin() + 2, values.end());
+
+        // Subband indices are stored counting from 1.  The first line (0 0) holds temperatures
+        if(!rows.empty())
+            transitions.push_back(std::make_pair(i-1, f-1));
+        else if(i != 0 || f != 0)
+        {
+            std::ostringstream oss;
+            oss << "The first line of rate table " << filename << " should begin with 0 0.";
+            throw std::runtime_error(oss.str());
+        }
+
+        if(!rows.empty() && row.size() != rows[0].size())
+        {
+            std::ostringstream oss;
+            oss << "Rate table " << filename << " has " << rows[0].size() << " temperatures, but "
+                << row.size() << " rates were given for transition " << i << "-" << f;
+            throw std::runtime_error(oss.str());
+        }
+
+        rows.push_back(row);
+    }
+
+    if(rows.empty())
+    {
+        std::ostringstream oss;
+        oss << "Rate table " << filename << " is empty.";
+        throw std::runtime_error(oss.str());
+    }
+
+    const size_t nT = rows[0].size();
+    arma::vec T(nT);
+    arma::mat W(transitions.size(), nT);
+
+    for(unsigned int iT = 0; iT < nT; ++iT)
+    {
+        T[iT] = rows[0][iT];
+
+        for(unsigned int itx = 0; itx < transitions.size(); ++itx)
+            W(itx, iT) = rows[itx+1][iT];
+    }
+
+    return RateTable(T, transitions, W);
+}
+
+/**
+ * \brief Write the table of rates to file
+ *
+ * \param[in] filename The name of the file
+ */
+void RateTable::write_to_file(const std::string &filename) const
+{
+    TableWriter stream(filename, 17, true);
+
+    stream << 0 << ' ' << 0;
+
+    for(unsigned int iT = 0; iT < _T.size(); ++iT)
+        stream << ' ' << _T[iT];
+
+    stream << '\n';
+
+    for(unsigned int itx = 0; itx < _transitions.size(); ++itx)
+    {
+        stream << _transitions[itx].first+1 << ' ' << _transitions[itx].second+1;
+
+        for(unsigned int iT = 0; iT < _T.size(); ++iT)
+            stream << ' ' << _W(itx, iT);
+
+        stream << '\n';
+    }
+}
+
+/**
+ * \brief Find the rate for a transition at a given temperature
+ *
+ * \param[in] i Initial subband index (counting from 0)
+ * \param[in] f Final subband index (counting from 0)
+ * \param[in] T Carrier temperature [K]
+ *
+ * \returns The rate, interpolated linearly between the neighbouring samples [1/s]
+ */
+double RateTable::get_rate(const unsigned int i,
+                           const unsigned int f,
+                           const double       T) const
+{
+    const auto it = _index.find(std::make_pair(i,f));
+
+    if(it == _index.end())
+    {
+        std::ostringstream oss;
+        oss << "Transition " << i+1 << "-" << f+1 << " is not in the rate table.";
+        throw std::domain_error(oss.str());
+    }
+
+    const size_t nT = _T.size();
+
+    if(T < _T[0] || T > _T[nT-1])
+    {
+        std::ostringstream oss;
+        oss << "Temperature " << T << " K is outside the range of the rate table ("
+            << _T[0] << "-" << _T[nT-1] << " K).";
+        throw std::domain_error(oss.str());
+    }
+
+    // Find the sample just below the wanted temperature, directly from the grid spacing
+    unsigned int iT = static_cast<unsigned int>((T - _T[0])/_dT);
+
+    if(iT > nT-2)
+        iT = nT-2;
+
+    const double x = (T - _T[iT])/_dT;
+    const auto   row = it->second;
+
+    return (1.0 - x)*_W(row, iT) + x*_W(row, iT+1);
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,68 @@
+/**
+ * \file   rate-table.h
+ * \brief  Table of average scattering rates as a function of carrier temperature
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_RATE_TABLE_H
+#define QWWAD_RATE_TABLE_H
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <armadillo>
+
+namespace QWWAD
+{
+/**
+ * \brief A table of average scattering rates for a set of transitions, as a function
+ *        of carrier temperature
+ *
+ * \details The rates are held on a uniform grid of temperatures, so a rate at any
+ *          temperature within the grid is found by linear interpolation between
+ *          the two neighbouring samples, without searching the grid.
+ *
+ *          The table is stored in a file with one line per transition.  The
+ *          first line holds two zeros followed by the temperature samples.  Each
+ *          subsequent line holds the initial and final subband indices
+ *          (counting from 1) followed by the rate at each temperature:
+ *          \verbatim
+ *          0 0 T_0      T_1      ... T_n
+ *          i f W_if(T0) W_if(T1) ... W_if(Tn)
+ *          \endverbatim
+ */
+class RateTable {
+public:
+    /// Initial and final subband indices for a transition
+    typedef std::pair<unsigned int, unsigned int> map_key;
+
+private:
+    arma::vec            _T;           ///< Temperature samples [K]
+    std::vector<map_key> _transitions; ///< Subband indices for each transition (from 0)
+    arma::mat            _W;           ///< Rate for each transition (row) at each temperature (column) [1/s]
+
+    double _dT; ///< Spacing between temperature samples [K]
+
+    std::map<map_key, unsigned int> _index; ///< Row of the table for each transition
+
+public:
+    RateTable(const decltype(_T)           &T,
+              const decltype(_transitions) &transitions,
+              const decltype(_W)           &W);
+
+    static RateTable read_from_file(const std::string &filename);
+
+    void write_to_file(const std::string &filename) const;
+
+    double get_rate(const unsigned int i,
+                    const unsigned int f,
+                    const double       T) const;
+
+    inline decltype(_T)           const & get_T_table()     const {return _T;}
+    inline decltype(_transitions) const & get_transitions() const {return _transitions;}
+    inline decltype(_W)           const & get_rate_table()  const {return _W;}
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,269 @@
+/**
+ * \file   recursive-greens-function.cpp
+ * \brief  Transmission and local density of states using recursive Green's functions
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "recursive-greens-function.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "constants.h"
+#include "parallel.h"
+#include "schroedinger-solver-tridiagonal.h"
+
+namespace QWWAD
+{
+using namespace constants;
+
+typedef std::complex<double> cx;
+
+/// Number of energies handled together by one thread
+static const size_t block_size = 64;
+
+/**
+ * \brief Find the self-energy of a semi-infinite lead
+ *
+ * \param[in] E   Energy, including any broadening [J]
+ * \param[in] eps On-site energy in the lead [J]
+ * \param[in] t   Coupling between neighbouring sites in the lead [J]
+ *
+ * \returns The retarded self-energy [J]
+ *
+ * \details The self-energy is \f$\Sigma = t\mathrm{e}^{ika}\f$, where
+ *          \f$E = \epsilon + 2t\cos(ka)\f$.  Of the two roots, the one that decays
+ *          into the lead is used.  Inside the band of the lead, both roots have unit
+ *          magnitude and the one with \f$\mathrm{Im}\,\Sigma \le 0\f$ is used.
+ */
+static cx find_lead_self_energy(const cx     E,
+                                const double eps,
+                                const double t)
+{
+    const cx x  = (E - eps)/(2.0*t);
+    const cx s  = std::sqrt(x*x - 1.0);
+    const cx r1 = x + s;
+    const cx r2 = x - s; // Note that r1*r2 = 1
+
+    cx r = (std::abs(r1) < std::abs(r2)) ? r1 : r2;
+
+    if(std::abs(std::abs(r1) - 1.0) < 1e-12)
+        r = (std::imag(t*r1) <= 0.0) ? r1 : r2;
+
+    return t*r;
+}
+
+/**
+ * \brief Set up a structure from a sampled profile
+ *
+ * \param[in] z Spatial location of each sample [m]
+ * \param[in] V Potential at each sample [J]
+ * \param[in] m Effective mass at each sample [kg]
+ *
+ * \details The samples need not be evenly spaced.  The leads continue the first
+ *          and last samples, with the same spacing as the first and last pairs of
+ *          samples.
+ */
+RecursiveGreensFunction::RecursiveGreensFunction(const arma::vec &z,
+                                                 const arma::vec &V,
+                                                 const arma::vec &m) :
+    _diag(),
+    _sub(),
+    _h(),
+    _t_left(0.0),
+    _t_right(0.0),
+    _eps_left(0.0),
+    _eps_right(0.0),
+    _eta(0.0)
+{
+    const size_t nz = z.size();
+
+    if(V.size() != nz || m.size() != nz || nz < 2)
+    {
+        std::ostringstream oss;
+        oss << "Cannot make a structure from " << nz << " positions, " << V.size()
+            << " potentials and " << m.size() << " masses.";
+        throw std::length_error(oss.str());
+    }
+
+    if(m.min() <= 0.0)
+        throw std::domain_error("The effective mass must be positive everywhere.");
+
+    const SchroedingerSolverTridiag se(m, V, z);
+    _diag = se.get_diagonal();
+    _sub  = se.get_subdiagonal();
+    _h    = se.get_cell_widths();
+
+    const double dz_left  = z[1] - z[0];
+    const double dz_right = z[nz-1] - z[nz-2];
+
+    _t_left    = -hBar*hBar/(2.0*m[0]*dz_left*dz_left);
+    _t_right   = -hBar*hBar/(2.0*m[nz-1]*dz_right*dz_right);
+    _eps_left  = V[0]    - 2.0*_t_left;
+    _eps_right = V[nz-1] - 2.0*_t_right;
+}
+
+/**
+ * \brief Find the transmission coefficients for a block of energies
+ *
+ * \param[in]  E        Energies [J]
+ * \param[out] T        Transmission coefficients
+ * \param[out] ldos     Local density of states for every energy [1/(J m)].  The
+ *                      columns for this block are filled in, unless a null
+ *                      pointer is given.
+ * \param[in]  iE_first Index of the first energy of the block in the whole set
+ * \param[in]  nE       Number of energies in the block
+ *
+ * \details The left-connected Green's functions \f$g^L_i\f$ are found by adding one
+ *          site at a time to the left lead.  The transmission coefficient is then
+ *          \f$T = \Gamma_L\Gamma_R|G_{N1}|^2\f$, where \f$\Gamma = -2\,\mathrm{Im}\,\Sigma\f$
+ *          for each lead, and \f$G_{N1}\f$ is built up as a product of the
+ *          \f$g^L_i\f$.  The product is rescaled whenever it becomes small, so that it
+ *          does not underflow in a thick barrier.
+ *
+ *          The local density of states needs the diagonal of the full Green's
+ *          function, which is found from a second, right-connected, sweep.
+ */
+void RecursiveGreensFunction::find_block(const double *E,
+                                         double       *T,
+                                         arma::mat    *ldos,
+                                         const size_t  iE_first,
+                                         const size_t  nE) const
+{
+    const size_t nz    = _diag.size();
+    const double small = 1e-100; // Size of propagator at which to rescale
+
+    std::vector<cx> gL(nz); // Left-connected Green's function at each site
+    std::vector<cx> gR(nz); // Right-connected Green's function at each site
+
+    for(size_t iE = 0; iE < nE; ++iE)
+    {
+        const cx E_cx(E[iE], _eta);
+        const cx sigma_left  = find_lead_self_energy(E_cx, _eps_left,  _t_left);
+        const cx sigma_right = find_lead_self_energy(E_cx, _eps_right, _t_right);
+
+        // Sweep from left to right, keeping track of the propagator G_{i1}
+        gL[0] = 1.0/(E_cx - _diag[0] - sigma_left);
+        cx     G_i1      = gL[0];
+        double log_scale = 0.0;
+
+        for(size_t iz = 1; iz < nz; ++iz)
+        {
+            const double t = _sub[iz-1];
+            cx denominator = E_cx - _diag[iz] - t*t*gL[iz-1];
+
+            if(iz == nz-1)
+                denominator -= sigma_right;
+
+            gL[iz] = 1.0/denominator;
+            G_i1  *= gL[iz]*t;
+
+            if(std::abs(G_i1) < small)
+            {
+                G_i1      /= small;
+                log_scale += log(small);
+            }
+        }
+
+        const double Gamma_left  = -2.0*std::imag(sigma_left);
+        const double Gamma_right = -2.0*std::imag(sigma_right);
+
+        T[iE] = Gamma_left*Gamma_right*std::norm(G_i1)*exp(2.0*log_scale);
+
+        if(ldos)
+        {
+            // Sweep from right to left, then combine both halves at each site
+            gR[nz-1] = 1.0/(E_cx - _diag[nz-1] - sigma_right);
+
+            for(size_t iz = nz-1; iz > 0; --iz)
+            {
+                const double t = _sub[iz-1];
+                gR[iz-1] = 1.0/(E_cx - _diag[iz-1] - t*t*gR[iz]);
+            }
+
+            double *ldos_E = ldos->colptr(iE_first + iE);
+
+            for(size_t iz = 0; iz < nz; ++iz)
+            {
+                const cx sigma_l = (iz == 0)    ? sigma_left  : _sub[iz-1]*_sub[iz-1]*gL[iz-1];
+                const cx sigma_r = (iz == nz-1) ? sigma_right : _sub[iz]*_sub[iz]*gR[iz+1];
+                const cx G_ii    = 1.0/(E_cx - _diag[iz] - sigma_l - sigma_r);
+
+                ldos_E[iz] = -std::imag(G_ii)/(pi*_h[iz]);
+            }
+        }
+    }
+}
+
+/**
+ * \brief Find the transmission coefficient at a single energy
+ *
+ * \param[in] E Energy of the carrier [J]
+ *
+ * \returns The transmission coefficient for a carrier incident from the left
+ */
+double RecursiveGreensFunction::get_transmission(const double E) const
+{
+    double T = 0.0;
+    find_block(&E, &T, nullptr, 0, 1);
+    return T;
+}
+
+/**
+ * \brief Find the transmission coefficient at a set of energies
+ *
+ * \param[in] E         Energies of the carrier [J]
+ * \param[in] n_threads Number of threads to use
+ *
+ * \returns The transmission coefficient at each energy
+ */
+arma::vec RecursiveGreensFunction::get_transmission(const arma::vec    &E,
+                                                    const unsigned int  n_threads) const
+{
+    const size_t nE       = E.size();
+    const size_t n_blocks = (nE + block_size - 1)/block_size;
+    arma::vec    T(nE);
+
+    run_in_parallel(n_blocks, n_threads, [&](const size_t iblock) {
+        const size_t first = iblock*block_size;
+        const size_t n     = std::min(block_size, nE - first);
+        find_block(E.memptr() + first, T.memptr() + first, nullptr, first, n);
+    });
+
+    return T;
+}
+
+/**
+ * \brief Find the transmission coefficient and local density of states at a set of energies
+ *
+ * \param[in]  E         Energies of the carrier [J]
+ * \param[in]  n_threads Number of threads to use
+ * \param[out] ldos      Local density of states [1/(J m)], with one row for each
+ *                       spatial sample and one column for each energy
+ *
+ * \returns The transmission coefficient at each energy
+ */
+arma::vec RecursiveGreensFunction::get_transmission(const arma::vec    &E,
+                                                    const unsigned int  n_threads,
+                                                    arma::mat          &ldos) const
+{
+    const size_t nE       = E.size();
+    const size_t n_blocks = (nE + block_size - 1)/block_size;
+    arma::vec    T(nE);
+
+    ldos.set_size(_diag.size(), nE);
+
+    run_in_parallel(n_blocks, n_threads, [&](const size_t iblock) {
+        const size_t first = iblock*block_size;
+        const size_t n     = std::min(block_size, nE - first);
+        find_block(E.memptr() + first, T.memptr() + first, &ldos, first, n);
+    });
+
+    return T;
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
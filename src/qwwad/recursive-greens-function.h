@@ -0,0 +1,78 @@
+/**
+ * \file   recursive-greens-function.h
+ * \brief  Transmission and local density of states using recursive Green's functions
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_RECURSIVE_GREENS_FUNCTION_H
+#define QWWAD_RECURSIVE_GREENS_FUNCTION_H
+
+#include <armadillo>
+
+namespace QWWAD
+{
+/**
+ * \brief An open one-dimensional structure, solved using recursive Green's functions
+ *
+ * \details The Hamiltonian is the same finite-volume, tridiagonal matrix as that
+ *          used by SchroedingerSolverTridiag.  The structure is connected to
+ *          semi-infinite leads, which continue the first and last samples of the
+ *          profile.  The leads are included exactly, through their self-energies.
+ *
+ *          The Green's function is never inverted densely.  A single sweep through
+ *          the structure gives the transmission coefficient, and a second sweep in
+ *          the opposite direction gives the local density of states, so the cost
+ *          is proportional to the number of samples for each energy.  Unlike the
+ *          transfer-matrix method, each step only combines bounded quantities, so
+ *          thick barriers remain stable.  Blocks of energies are shared between
+ *          threads.
+ */
+class RecursiveGreensFunction
+{
+private:
+    arma::vec _diag; ///< Diagonal of the symmetrised Hamiltonian [J]
+    arma::vec _sub;  ///< Sub-diagonal of the symmetrised Hamiltonian [J]
+    arma::vec _h;    ///< Width of the cell around each spatial point [m]
+
+    double _t_left;    ///< Coupling between sites in the left lead [J]
+    double _t_right;   ///< Coupling between sites in the right lead [J]
+    double _eps_left;  ///< On-site energy in the left lead [J]
+    double _eps_right; ///< On-site energy in the right lead [J]
+    double _eta;       ///< Broadening added to the energy [J]
+
+    void find_block(const double *E,
+                    double       *T,
+                    arma::mat    *ldos,
+                    const size_t  iE_first,
+                    const size_t  nE) const;
+
+public:
+    RecursiveGreensFunction(const arma::vec &z,
+                            const arma::vec &V,
+                            const arma::vec &m);
+
+    /**
+     * \brief Set the broadening of the energy levels
+     *
+     * \param[in] eta Imaginary part added to each energy [J]
+     *
+     * \details This is only needed to show the bound states, below both leads, in
+     *          the local density of states.
+     */
+    inline void set_broadening(const double eta) {_eta = eta;}
+
+    double get_transmission(const double E) const;
+
+    arma::vec get_transmission(const arma::vec    &E,
+                               const unsigned int  n_threads = 0) const;
+
+    arma::vec get_transmission(const arma::vec    &E,
+                               const unsigned int  n_threads,
+                               arma::mat          &ldos) const;
+
+    /// Return the number of spatial samples
+    size_t get_n_points() const {return _diag.size();}
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,306 @@
+/**
+ * \file   scattering-calculator-IFR.cpp
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Calculator for interface-roughness scattering rates
+ */
+
+#include <sstream>
+#include <stdexcept>
+#include <gsl/gsl_sf_bessel.h>
+#include "scattering-calculator-IFR.h"
+#include "constants.h"
+#include "maths-helpers.h"
+
+namespace QWWAD {
+using namespace constants;
+
+/**
+ * \brief Initialise an interface-roughness scattering calculation for a 2D system
+ *
+ * \param[in] subbands The energy subbands in the system
+ * \param[in] V        Potential profile [J]
+ * \param[in] iz_I     Index of the mesh point at each interface
+ * \param[in] m        Band-edge effective mass [kg]
+ * \param[in] T        Temperature of carrier distribution [K]
+ */
+ScatteringCalculatorIFR::ScatteringCalculatorIFR(decltype(_subbands) subbands,
+                                                 decltype(_V)        V,
+                                                 decltype(_iz_I)     iz_I,
+                                                 decltype(_m)        m,
+                                                 decltype(_T)        T) :
+    _subbands(subbands),
+    _V(V),
+    _iz_I(iz_I),
+    _m(m),
+    _T(T),
+    _Delta(3e-10),
+    _Lambda(50e-10),
+    _enable_blocking(true),
+    _Ecutoff_set(false),
+    _Ecutoff(0.0),
+    _nki(101)
+{
+    const auto &z  = _subbands[0].z_array();
+    const auto  nz = z.size();
+
+    if(_V.size() != nz)
+    {
+        std::ostringstream oss;
+        oss << "Potential profile has " << _V.size() << " points, but the wavefunctions have "
+            << nz << " points.";
+        throw std::length_error(oss.str());
+    }
+
+    check_uniform_mesh(z, "Interface-roughness scattering");
+
+    const double dz = z[1] - z[0];
+    _dV_dz.set_size(nz);
+
+    for (unsigned int iz = 1; iz < nz-1; ++iz)
+        _dV_dz[iz] = (_V[iz+1] - _V[iz-1])/dz;
+
+    // Assume periodic boundary conditions
+    _dV_dz[0]    = (_V[1] - _V[nz-1])/dz;
+    _dV_dz[nz-1] = (_V[0] - _V[nz-2])/dz;
+
+    // The region nearest to each interface runs from halfway to the previous
+    // interface up to halfway to the next one.  The same regions are used for
+    // every transition, so the quadrature rule for each one is only found once.
+    // The last interface is not included, since this is the edge of the
+    // system, where psi = 0.
+    const size_t nI = (_iz_I.size() > 1) ? _iz_I.size() - 1 : 0;
+    _iz_L.zeros(nI);
+    _I_quadrature.resize(nI);
+
+    for (unsigned int I=0; I < nI; ++I)
+    {
+        if(I != 0)
+            _iz_L[I] = (_iz_I[I] + _iz_I[I-1])/2;
+        else
+            _iz_L[I] = _iz_I[0]/2;
+
+        const unsigned int iz_U = (_iz_I[I] + _iz_I[I+1])/2; // Upper bound of interface
+
+        if(iz_U > _iz_L[I])
+            _I_quadrature[I] = Quadrature(iz_U - _iz_L[I], dz);
+    }
+}
+
+/**
+ * \brief Set a cut-off kinetic energy for the initial carrier distribution
+ *
+ * \param[in] Ecutoff Cut-off energy [J]
+ *
+ * \details By default, the cut-off is found automatically for each subband.
+ */
+void ScatteringCalculatorIFR::set_Ecutoff(const decltype(_Ecutoff) Ecutoff)
+{
+    _Ecutoff_set = true;
+    _Ecutoff     = Ecutoff;
+}
+
+/**
+ * \brief Change the population of each subband
+ *
+ * \param[in] N Sheet density of carriers in each subband [m^{-2}]
+ *
+ * \details The matrix elements do not depend on the populations, so they are kept.
+ */
+void ScatteringCalculatorIFR::set_subband_populations(const arma::vec &N)
+{
+    QWWAD::set_subband_populations(_subbands, N, _T);
+}
+
+/**
+ * \brief Find the minimum initial wave-vector that allows scattering
+ */
+double ScatteringCalculatorIFR::get_ki_min(const unsigned int i,
+                                           const unsigned int f) const
+{
+    return find_elastic_ki_min(_subbands[i], _subbands[f], _m);
+}
+
+/**
+ * \brief Find the cut-off value for the initial wave vector
+ */
+double ScatteringCalculatorIFR::get_ki_cutoff(const unsigned int i,
+                                              const unsigned int f) const
+{
+    return _subbands[i].get_k_at_Ek(find_elastic_Eki_cutoff(_subbands[i], _subbands[f], _m, _T,
+                                                            _Ecutoff_set, _Ecutoff));
+}
+
+/**
+ * \brief Tabulate the matrix element at each interface for a transition
+ *
+ * \details The integral runs over the region nearest to each interface, as set
+ *          up in the constructor.
+ */
+void ScatteringCalculatorIFR::make_Fif_table(const unsigned int i,
+                                             const unsigned int f)
+{
+    const arma::vec F_integrand_dz = _subbands[i].psi_array() % _subbands[f].psi_array() % _dV_dz;
+
+    const size_t nI = _I_quadrature.size();
+    arma::vec Fif(nI, arma::fill::zeros);
+
+    for (unsigned int I=0; I < nI; ++I)
+    {
+        const auto &quadrature = _I_quadrature[I];
+
+        if(quadrature.size() > 0)
+        {
+            const arma::vec F_integrand_I = F_integrand_dz.subvec(_iz_L[I], _iz_L[I] + quadrature.size() - 1);
+            Fif[I] = quadrature.integrate(F_integrand_I);
+        }
+    }
+
+    _Fif_table[std::make_pair(i,f)] = Fif;
+}
+
+/**
+ * \brief Find the scattering rate at a set of initial wave-vectors
+ *
+ * \param[in] i               Initial subband index
+ * \param[in] f               Final subband index
+ * \param[in] ki              Initial wave-vectors [1/m]
+ * \param[in] enable_blocking Include final-state blocking
+ *
+ * \details The matrix elements for the transition must already be tabulated.
+ *          The product \f$e^{-(k_i^2+k_f^2)\Lambda^2/4}I_0(k_ik_f\Lambda^2/2)\f$
+ *          is found using the scaled Bessel function so that it does not overflow
+ *          at large wave-vectors.
+ */
+arma::vec ScatteringCalculatorIFR::calculate_rates(const unsigned int  i,
+                                                   const unsigned int  f,
+                                                   const arma::vec    &ki,
+                                                   const bool          enable_blocking) const
+{
+    const auto &isb = _subbands[i];
+    const auto &fsb = _subbands[f];
+    const auto &Fif = _Fif_table.at(std::make_pair(i,f));
+
+    const double Lambda_sqr = _Lambda*_Lambda;
+    const double prefactor  = pi*_m*_Delta*_Delta*Lambda_sqr/(hBar*hBar*hBar) * dot(Fif, Fif);
+    const double dk_sqr     = 2*_m*(isb.get_E_min() - fsb.get_E_min())/(hBar*hBar);
+
+    // Find energy-conserving final wave-vectors
+    // These should be positive if the kimin value is correct
+    arma::vec kf = square(ki) + dk_sqr;
+
+    for(unsigned int iki = 0; iki < ki.size(); ++iki)
+        kf[iki] = (kf[iki] > 0.0) ? sqrt(kf[iki]) : 0.0;
+
+    arma::vec Wif = prefactor * exp(-square(ki - kf)*Lambda_sqr/4);
+
+    for(unsigned int iki = 0; iki < ki.size(); ++iki)
+    {
+        Wif[iki] *= gsl_sf_bessel_I0_scaled(ki[iki]*kf[iki]*Lambda_sqr/2);
+
+        // Include final-state blocking factor
+        if (enable_blocking && ki[iki]*ki[iki] + dk_sqr >= 0.0)
+            Wif[iki] *= (1 - fsb.get_occupation_at_k(kf[iki]));
+    }
+
+    return Wif;
+}
+
+/**
+ * \brief Returns the entire scattering table for an intersubband transition
+ *
+ * \param[in] i Initial subband index
+ * \param[in] f Final subband index
+ */
+IntersubbandTransition ScatteringCalculatorIFR::get_transition(const unsigned int i,
+                                                               const unsigned int f)
+{
+    return get_transitions(std::vector<map_key>(1, std::make_pair(i,f)))[0];
+}
+
+/**
+ * \brief Returns the scattering table for a transition, without final-state blocking
+ *
+ * \param[in] i Initial subband index
+ * \param[in] f Final subband index
+ *
+ * \details The rates in the table do not depend on the carrier distributions, so
+ *          averages and blocking for any distribution can be found from it
+ *          afterwards, through the IntersubbandTransition functions.
+ */
+IntersubbandTransition ScatteringCalculatorIFR::get_kernel(const unsigned int i,
+                                                           const unsigned int f)
+{
+    return make_transitions(std::vector<map_key>(1, std::make_pair(i,f)), false)[0];
+}
+
+/**
+ * \brief Find the average scattering rate for a transition using adaptive quadrature
+ *
+ * \param[in] i       Initial subband index
+ * \param[in] f       Final subband index
+ * \param[in] rel_tol Relative tolerance of the average
+ *
+ * \details The rate is found at whichever wave-vectors the integrator needs,
+ *          rather than at the fixed table of get_transition.
+ */
+double ScatteringCalculatorIFR::get_average_rate(const unsigned int i,
+                                                 const unsigned int f,
+                                                 const double       rel_tol)
+{
+    if(_Fif_table.count(std::make_pair(i,f)) == 0)
+        make_Fif_table(i,f);
+
+    arma::vec ki_sample(1);
+
+    return find_average_rate_adaptive(_subbands[i], get_ki_min(i,f), get_ki_cutoff(i,f),
+                                      [&](const double ki) {
+                                          ki_sample[0] = ki;
+                                          return calculate_rates(i, f, ki_sample, _enable_blocking)[0];
+                                      },
+                                      rel_tol);
+}
+
+/**
+ * \brief Returns the scattering tables for a set of intersubband transitions
+ *
+ * \param[in] transitions Initial and final subband indices for each transition
+ *
+ * \details The matrix elements are found once for each pair of subbands, and the
+ *          rates at all initial wave-vectors are then found in a single pass.
+ */
+std::vector<IntersubbandTransition>
+ScatteringCalculatorIFR::get_transitions(const std::vector<map_key> &transitions)
+{
+    return make_transitions(transitions, _enable_blocking);
+}
+
+/**
+ * \brief Make the scattering tables for a set of intersubband transitions
+ *
+ * \param[in] transitions     Initial and final subband indices for each transition
+ * \param[in] enable_blocking Include final-state blocking
+ */
+std::vector<IntersubbandTransition>
+ScatteringCalculatorIFR::make_transitions(const std::vector<map_key> &transitions,
+                                          const bool                  enable_blocking)
+{
+    std::vector<IntersubbandTransition> tx;
+    tx.reserve(transitions.size());
+
+    for(const auto &idx : transitions)
+    {
+        const auto i = idx.first;
+        const auto f = idx.second;
+
+        if(_Fif_table.count(idx) == 0)
+            make_Fif_table(i,f);
+
+        const arma::vec ki = arma::linspace(get_ki_min(i,f), get_ki_cutoff(i,f), _nki);
+        tx.push_back(IntersubbandTransition(_subbands[i], _subbands[f], ki,
+                                            calculate_rates(i,f,ki,enable_blocking)));
+    }
+
+    return tx;
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,112 @@
+/**
+ * \file   scattering-calculator-IFR.h
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Calculator for interface-roughness scattering rates
+ */
+
+#ifndef QWWAD_SCATTERING_CALCULATOR_IFR
+#define QWWAD_SCATTERING_CALCULATOR_IFR
+
+#include <map>
+#include <utility>
+#include <vector>
+#include "subband.h"
+#include "intersubband-transition.h"
+#include "quadrature.h"
+
+namespace QWWAD {
+/**
+ * \brief A calculator for interface-roughness scattering rates
+ *
+ * \details The matrix element for each interface is
+ *          \f[
+ *            F_{if}^{I} = \int_{I} \psi_i(z)\psi_f(z) \frac{\mathrm{d}V}{\mathrm{d}z}\,\mathrm{d}z,
+ *          \f]
+ *          where the integral runs over the region nearest to interface \f$I\f$.
+ *          These depend only on the wavefunctions and potential profile, so they are
+ *          found once for each transition and kept.  The roughness height and
+ *          correlation length only enter the final rate, so they can be changed
+ *          without finding the matrix elements again.
+ */
+class ScatteringCalculatorIFR {
+public:
+    /// Initial and final subband indices for a transition
+    typedef std::pair<unsigned int, unsigned int> map_key;
+
+private:
+    std::vector<Subband> _subbands; ///< The energy subbands in the system
+
+    // Physical properties
+    arma::vec  _V;    ///< Potential profile [J]
+    arma::uvec _iz_I; ///< Index of the mesh point at each interface
+    double     _m;    ///< Effective mass [kg]
+    double     _T;    ///< Temperature of carrier distribution [K]
+
+    double _Delta;  ///< Roughness height [m]
+    double _Lambda; ///< Roughness correlation length [m]
+
+    bool   _enable_blocking; ///< Allow final-state blocking
+    bool   _Ecutoff_set;     ///< True if the user has set a cut-off energy
+    double _Ecutoff;         ///< User-specified cut-off kinetic energy [J]
+
+    // Precision parameters
+    size_t _nki; ///< Number of initial wave-vector samples
+
+    // Derived properties
+    arma::vec _dV_dz; ///< Derivative of potential profile [J/m]
+
+    arma::uvec              _iz_L;         ///< First mesh point in the region nearest to each interface
+    std::vector<Quadrature> _I_quadrature; ///< Quadrature rule for the region nearest to each interface
+
+    /// Matrix element at each interface for each transition [J]
+    std::map<map_key, arma::vec> _Fif_table;
+
+    void make_Fif_table(const unsigned int i,
+                        const unsigned int f);
+
+    arma::vec calculate_rates(const unsigned int  i,
+                              const unsigned int  f,
+                              const arma::vec    &ki,
+                              const bool          enable_blocking) const;
+
+    std::vector<IntersubbandTransition>
+    make_transitions(const std::vector<map_key> &transitions,
+                     const bool                  enable_blocking);
+
+public:
+    ScatteringCalculatorIFR(decltype(_subbands) subbands,
+                            decltype(_V)        V,
+                            decltype(_iz_I)     iz_I,
+                            decltype(_m)        m,
+                            decltype(_T)        T);
+
+    inline void set_roughness_height   (const decltype(_Delta)  Delta)  {_Delta  = Delta;}
+    inline void set_correlation_length (const decltype(_Lambda) Lambda) {_Lambda = Lambda;}
+    inline void enable_blocking        (const bool enabled) {_enable_blocking = enabled;}
+    inline void set_ki_samples         (const decltype(_nki) nki) {_nki = nki;}
+
+    void set_Ecutoff(const decltype(_Ecutoff) Ecutoff);
+    void set_subband_populations(const arma::vec &N);
+
+    double get_ki_min(const unsigned int isb,
+                      const unsigned int fsb) const;
+
+    double get_ki_cutoff(const unsigned int isb,
+                         const unsigned int fsb) const;
+
+    IntersubbandTransition get_transition(const unsigned int isb,
+                                          const unsigned int fsb);
+
+    IntersubbandTransition get_kernel(const unsigned int isb,
+                                      const unsigned int fsb);
+
+    double get_average_rate(const unsigned int isb,
+                            const unsigned int fsb,
+                            const double       rel_tol);
+
+    std::vector<IntersubbandTransition>
+    get_transitions(const std::vector<map_key> &transitions);
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
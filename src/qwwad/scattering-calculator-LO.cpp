@@ -1,7 +1,13 @@
 #include <complex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
 #include "scattering-calculator-LO.h"
 #include "constants.h"
+#include "form-factor-cache.h"
 #include "maths-helpers.h"
+#include "parallel.h"
+#include "profiler.h"
 
 namespace QWWAD {
 using namespace constants;
@@ -40,13 +46,75 @@ ScatteringCalculatorLO::ScatteringCalculatorLO(decltype(_subbands)    subbands,
     _enable_screening(true),
     _enable_blocking(true),
     _nki(101),
+    _Kz_scale(0.0),
     _omega_0(_Ephonon/hBar),
-    _N0(1.0/(exp(_Ephonon/(kB*_Tl))-1.0)),
-    _prefactor(pi*e*e*_omega_0/_epss*(_epss/_epsinf-1)*
-                (_N0 + (_is_emission?1:0))*
-                2.0 * _m/(hBar*hBar)*2/(8*pi*pi*pi))
+    _lambda_s_sq(0.0)
 {
     set_phonon_samples(1001);
+    calculate_prefactor();
+    calculate_screening_length();
+}
+
+/**
+ * \brief Find the Bose-Einstein factor and the pre-factor for rates
+ */
+void ScatteringCalculatorLO::calculate_prefactor()
+{
+    _N0        = 1.0/(exp(_Ephonon/(kB*_Tl))-1.0);
+    _prefactor = pi*e*e*_omega_0/_epss*(_epss/_epsinf-1)*
+                 (_N0 + (_is_emission?1:0))*
+                 2.0 * _m/(hBar*hBar)*2/(8*pi*pi*pi);
+}
+
+/**
+ * \brief Choose between phonon emission and absorption
+ *
+ * \details The form-factor tables do not depend on the process, so they are
+ *          kept and a single calculator can be used for both.
+ */
+void ScatteringCalculatorLO::set_emission(const decltype(_is_emission) is_emission)
+{
+    _is_emission = is_emission;
+    calculate_prefactor();
+}
+
+/**
+ * \brief Change the carrier and lattice temperatures
+ *
+ * \param[in] Te Electron temperature [K]
+ * \param[in] Tl Lattice temperature [K]
+ *
+ * \details The carrier distribution in each subband is reset to the new
+ *          electron temperature, keeping its total population.  The Bose
+ *          factor and screening length are then recalculated.  The form-factor
+ *          tables do not depend on temperature, so they are kept.
+ */
+void ScatteringCalculatorLO::set_temperature(const decltype(_Te) Te,
+                                             const decltype(_Tl) Tl)
+{
+    _Te = Te;
+    _Tl = Tl;
+
+    for(auto &sb : _subbands)
+        sb.set_distribution_from_N_Te(sb.get_total_population(), _Te);
+
+    calculate_prefactor();
+    calculate_screening_length();
+}
+
+/**
+ * \brief Change the population of each subband
+ *
+ * \param[in] N Sheet density of carriers in each subband [m^{-2}]
+ *
+ * \details The carrier distributions are reset at the current electron
+ *          temperature and the screening length is recalculated.  The
+ *          form-factor tables do not depend on the populations, so they are kept.
+ */
+void ScatteringCalculatorLO::set_subband_populations(const arma::vec &N)
+{
+    QWWAD::set_subband_populations(_subbands, N, _Te);
+
     calculate_screening_length();
 }
 
@@ -117,25 +185,78 @@ double ScatteringCalculatorLO::get_ki_cutoff(const unsigned int i,
 /**
  * \brief Sets the number of samples of the phonon wave vector to use
  *
- * \param[in] nKz Number of samples
+ * \param[in] nKz      Number of samples
+ * \param[in] Kz_scale Scale of a mapped grid [1/m].  If zero, the samples are
+ *                     evenly spaced.
  *
- * \details If the number is different from the currently-used value,
- *          the array of samples is recalculated accordingly.
- *          The map of form-factors will also be cleared and will be
+ * \details The samples run from zero up to 2/A0.  If the samples are different
+ *          from the currently-used values, the array of samples is recalculated
+ *          accordingly.  The map of form-factors will also be cleared and will be
  *          automatically regenerated the next time a scattering rate
  *          is needed.
+ *
+ *          The integrand for the rate is sharply peaked at small Kz, and decays
+ *          quickly as the form factor falls away.  A mapped grid,
+ *          \f$K_z = K_s\sinh u\f$, with u evenly spaced, has a spacing of about
+ *          \f$K_s\,\delta u\f$ below the scale, \f$K_s\f$, that grows in proportion
+ *          to Kz above it.  This needs far fewer samples for the same accuracy, if
+ *          \f$K_s\f$ is comparable with the inverse width of the wavefunctions.
  */
-void ScatteringCalculatorLO::set_phonon_samples(const size_t nKz)
+void ScatteringCalculatorLO::set_phonon_samples(const size_t nKz,
+                                                const double Kz_scale)
 {
-    if(nKz != _Kz.size())
+    if(nKz != _Kz.size() || Kz_scale != _Kz_scale)
     {
+        if(nKz < 2)
+            throw std::invalid_argument("At least two phonon wave-vector samples are needed.");
+
+        if(Kz_scale < 0)
+            throw std::invalid_argument("The scale of the phonon wave-vector grid cannot be negative.");
+
         _Kz.resize(nKz);
-        _dKz = 2.0/(_A0*nKz);
+        _Kz_scale = Kz_scale;
+
+        if(_Kz_scale > 0)
+        {
+            const double u_max = asinh(2.0/(_A0*_Kz_scale));
+            const double du    = u_max/(nKz - 1);
+            arma::vec    dKz_du(nKz);
+
+            for(unsigned int iKz = 0; iKz < nKz; ++iKz)
+            {
+                _Kz[iKz]    = _Kz_scale*sinh(iKz*du);
+                dKz_du[iKz] = _Kz_scale*cosh(iKz*du);
+            }
+
+            _dKz = 0.0;
+            _Kz_quadrature = Quadrature(du, dKz_du);
+        }
+        else
+        {
+            _dKz = 2.0/(_A0*nKz);
+
+            for(unsigned int iKz = 0; iKz < nKz; ++iKz)
+                _Kz[iKz] = iKz * _dKz;
 
-        for(unsigned int iKz = 0; iKz < nKz; ++iKz)
-            _Kz[iKz] = iKz * _dKz;
+            _Kz_quadrature = Quadrature(nKz, _dKz);
+        }
 
         ff_table.clear();
+        calculate_screened_Kz();
+    }
+}
+
+/**
+ * \brief Enable or disable screening of the phonon interaction
+ *
+ * \details The form-factor tables do not depend on screening, so they are kept.
+ */
+void ScatteringCalculatorLO::enable_screening(const bool enabled)
+{
+    if(enabled != _enable_screening)
+    {
+        _enable_screening = enabled;
+        calculate_screening_length();
     }
 }
 
@@ -152,20 +273,52 @@ void ScatteringCalculatorLO::set_phonon_samples(const size_t nKz)
 double ScatteringCalculatorLO::get_rate_ki(const unsigned int i,
                                            const unsigned int f,
                                            const double       ki)
+{
+    if(ff_table.count(ff_key(i,f)) == 0)
+    {
+        QWWAD_COUNT("LO form-factor table misses");
+        make_ff_table(i,f);
+    }
+    else
+        QWWAD_COUNT("LO form-factor table hits");
+
+    return calculate_rate_ki(i, f, ki, _enable_blocking);
+}
+
+/**
+ * \brief Find the total scattering rate at a given initial wave-vector
+ *
+ * \param[in] i               Initial subband index
+ * \param[in] f               Final subband index
+ * \param[in] ki              Initial wave-vector [1/m]
+ * \param[in] enable_blocking Include final-state blocking
+ *
+ * \details This is the work function for get_rate_ki.  The form-factor table for
+ *          the transition must already exist, so that this can safely be called
+ *          from several threads at once.
+ */
+double ScatteringCalculatorLO::calculate_rate_ki(const unsigned int i,
+                                                 const unsigned int f,
+                                                 const double       ki,
+                                                 const bool         enable_blocking) const
 {
     const auto ki_min = get_ki_min(i,f);
 
     double Wif_ki = 0.0;
 
+    QWWAD_COUNT("LO rate evaluations");
+
     if(ki >= ki_min)
     {
         const auto nKz = _Kz.size();
-        arma::vec Wif_integrand_dKz(nKz); // Integrand for scattering rate
+        QWWAD_COUNT_N("LO rate integrand evaluations", nKz);
+        const auto &w_Kz = _Kz_quadrature.get_weights();
+        double      Wif_sum = 0.0; // Weighted sum of the integrand for the scattering rate
 
-        const auto isb = _subbands[i];
-        const auto fsb = _subbands[f];
-        const auto Ei  = isb.get_E_min();
-        const auto Ef  = fsb.get_E_min();
+        const auto &isb = _subbands[i];
+        const auto &fsb = _subbands[f];
+        const auto  Ei  = isb.get_E_min();
+        const auto  Ef  = fsb.get_E_min();
 
         auto Delta = Ef - Ei;
 
@@ -174,32 +327,23 @@ double ScatteringCalculatorLO::get_rate_ki(const unsigned int i,
         else
             Delta -= _Ephonon;
 
-        auto idx = std::make_pair(i,f);
+        const auto &Gifsqr = ff_table.at(ff_key(i,f));
 
-        if(ff_table.count(idx) == 0)
-            make_ff_table(i,f);
-
-        auto Gifsqr = ff_table[idx];
+        // Terms in the denominator that don't depend on the phonon wavevector
+        const auto b = 2.0*(2.0*ki*ki - 2.0*_m*Delta/(hBar*hBar));
+        const auto c = 4.0*_m*_m*Delta*Delta/(hBar*hBar*hBar*hBar);
 
         // Integral over phonon wavevector Kz
         for(unsigned int iKz=0; iKz < nKz; ++iKz)
         {
-            auto Kz_2 = _Kz[iKz] * _Kz[iKz];
-
-            // Apply screening if wanted
-            if(_enable_screening && iKz != 0)
-                Kz_2 *= (1.0 + 2*_lambda_s_sq/Kz_2 + _lambda_s_sq*_lambda_s_sq/(Kz_2*Kz_2));
+            const auto Kz_2 = _Kz_sq_eff[iKz];
 
-            const auto Kz_4 = Kz_2 * Kz_2;
-
-            Wif_integrand_dKz[iKz] = Gifsqr[iKz] /
-                                     sqrt(Kz_4 + 2.0*Kz_2 * (2.0*ki*ki - 2.0*_m*Delta/(hBar*hBar))+
-                                          4.0*_m*_m*Delta*Delta/(hBar*hBar*hBar*hBar));
+            Wif_sum += w_Kz[iKz] * Gifsqr[iKz] / sqrt(Kz_2*(Kz_2 + b) + c);
         } // end integral over Kz
 
-        Wif_ki = _prefactor*pi*integral(Wif_integrand_dKz,_dKz);
+        Wif_ki = _prefactor*pi*Wif_sum;
 
-        if(_enable_blocking)
+        if(enable_blocking)
         {
             // Initial and final kinetic energy
             const auto Eki = isb.get_Ek_at_k(ki);
@@ -226,6 +370,28 @@ double ScatteringCalculatorLO::get_rate_ki(const unsigned int i,
 IntersubbandTransition ScatteringCalculatorLO::get_transition(const unsigned int i,
                                                               const unsigned int f)
 {
+    return make_transition(i, f, _enable_blocking);
+}
+
+/**
+ * \brief Make the entire scattering table for an intersubband transition
+ *
+ * \param[in] i               Initial subband index
+ * \param[in] f               Final subband index
+ * \param[in] enable_blocking Include final-state blocking
+ */
+IntersubbandTransition ScatteringCalculatorLO::make_transition(const unsigned int i,
+                                                               const unsigned int f,
+                                                               const bool         enable_blocking)
+{
+    if(ff_table.count(ff_key(i,f)) == 0)
+    {
+        QWWAD_COUNT("LO form-factor table misses");
+        make_ff_table(i,f);
+    }
+    else
+        QWWAD_COUNT("LO form-factor table hits");
+
     // Get the minimum and cut-off initial wave-vectors for the transition
     const auto kimin  = get_ki_min(i, f);
     const auto kimax  = get_ki_cutoff(i, f);
@@ -237,17 +403,168 @@ IntersubbandTransition ScatteringCalculatorLO::get_transition(const unsigned int
     for (unsigned int iki = 0; iki < _nki; ++iki)
     {
         ki[iki]  = kimin + dki * iki;
-        Wif[iki] = get_rate_ki(i, f, ki[iki]);
+        Wif[iki] = calculate_rate_ki(i, f, ki[iki], enable_blocking);
     }
 
     const auto isb = _subbands[i];
     const auto fsb = _subbands[f];
 
-    IntersubbandTransition tx(isb, fsb, ki, Wif);
+    IntersubbandTransition tx(isb, fsb, ki, Wif, get_E_loss());
+
+    return tx;
+}
+
+/**
+ * \brief Returns the scattering table for a transition, without final-state blocking
+ *
+ * \param[in] i Initial subband index
+ * \param[in] f Final subband index
+ *
+ * \details Without blocking, the rates depend only on the lattice temperature and
+ *          the screening length, and not on the distribution of carriers in the
+ *          initial or final subband.  The IntersubbandTransition functions then
+ *          give averages and blocking for any distribution, so trial distributions
+ *          need not repeat the integral over phonon wave vectors, as long as the
+ *          screening is held fixed.
+ */
+IntersubbandTransition ScatteringCalculatorLO::get_kernel(const unsigned int i,
+                                                          const unsigned int f)
+{
+    return make_transition(i, f, false);
+}
+
+/**
+ * \brief Returns the scattering tables for a set of intersubband transitions
+ *
+ * \param[in] transitions Initial and final subband indices for each transition
+ * \param[in] n_threads   Number of threads to use (0 = one per CPU core)
+ *
+ * \details All the form-factor tables that are needed are built first, and the
+ *          scattering rate at each initial wave-vector in every transition is then
+ *          computed as a separate work item.  Each rate is found by exactly the same
+ *          sequence of operations as in get_transition, so the results are identical
+ *          to computing the transitions one at a time.
+ */
+std::vector<IntersubbandTransition>
+ScatteringCalculatorLO::get_transitions(const std::vector<map_key> &transitions,
+                                        unsigned int                n_threads)
+{
+    make_ff_tables(transitions, n_threads);
+
+    const auto ntx = transitions.size();
+
+    std::vector<arma::vec> ki(ntx);  // Initial wave vectors for each transition [1/m]
+    std::vector<arma::vec> Wif(ntx); // Scattering rates for each transition [1/s]
+
+    for(unsigned int itx = 0; itx < ntx; ++itx)
+    {
+        const auto i = transitions[itx].first;
+        const auto f = transitions[itx].second;
+
+        const auto kimin = get_ki_min(i, f);
+        const auto kimax = get_ki_cutoff(i, f);
+        const auto dki   = (kimax - kimin)/((_nki-1));
+
+        ki[itx].set_size(_nki);
+        Wif[itx].set_size(_nki);
+
+        for(unsigned int iki = 0; iki < _nki; ++iki)
+            ki[itx][iki] = kimin + dki * iki;
+    }
+
+    {
+        ScopedTimer timer("rate integration");
+
+        run_in_parallel(ntx*_nki, n_threads, [&](const size_t item) {
+            const auto itx = item / _nki;
+            const auto iki = item % _nki;
+
+            Wif[itx][iki] = calculate_rate_ki(transitions[itx].first,
+                                              transitions[itx].second,
+                                              ki[itx][iki],
+                                              _enable_blocking);
+        });
+    }
+
+    std::vector<IntersubbandTransition> tx;
+    tx.reserve(ntx);
+
+    for(unsigned int itx = 0; itx < ntx; ++itx)
+    {
+        const auto &isb = _subbands[transitions[itx].first];
+        const auto &fsb = _subbands[transitions[itx].second];
+        tx.push_back(IntersubbandTransition(isb, fsb, ki[itx], Wif[itx], get_E_loss()));
+    }
 
     return tx;
 }
 
+/**
+ * \brief Returns the scattering tables for a set of transitions at a range of temperatures
+ *
+ * \param[in] transitions Initial and final subband indices for each transition
+ * \param[in] Te          Electron temperature for each calculation [K]
+ * \param[in] Tl          Lattice temperature for each calculation [K]
+ * \param[in] n_threads   Number of threads to use (0 = one per CPU core)
+ *
+ * \returns A set of scattering tables for each pair of temperatures, in the same
+ *          order as the transitions
+ *
+ * \details The form-factor tables are only found once.  The calculator is left
+ *          set to the last pair of temperatures.
+ */
+std::vector< std::vector<IntersubbandTransition> >
+ScatteringCalculatorLO::get_transitions_vs_temperature(const std::vector<map_key> &transitions,
+                                                       const arma::vec            &Te,
+                                                       const arma::vec            &Tl,
+                                                       unsigned int                n_threads)
+{
+    if(Te.size() != Tl.size())
+    {
+        std::ostringstream oss;
+        oss << "Got " << Te.size() << " electron temperatures but " << Tl.size()
+            << " lattice temperatures.";
+        throw std::length_error(oss.str());
+    }
+
+    make_ff_tables(transitions, n_threads);
+
+    std::vector< std::vector<IntersubbandTransition> > tx;
+    tx.reserve(Te.size());
+
+    for(unsigned int iT = 0; iT < Te.size(); ++iT)
+    {
+        set_temperature(Te[iT], Tl[iT]);
+        tx.push_back(get_transitions(transitions, n_threads));
+    }
+
+    return tx;
+}
+
+/**
+ * \brief Find the average scattering rate for a transition using adaptive quadrature
+ *
+ * \param[in] i       Initial subband index
+ * \param[in] f       Final subband index
+ * \param[in] rel_tol Relative tolerance of the average
+ *
+ * \details The rate is found at whichever wave-vectors the integrator needs,
+ *          rather than at the fixed table of get_transition.
+ */
+double ScatteringCalculatorLO::get_average_rate(const unsigned int i,
+                                                const unsigned int f,
+                                                const double       rel_tol)
+{
+    if(ff_table.count(ff_key(i,f)) == 0)
+        make_ff_table(i,f);
+
+    return find_average_rate_adaptive(_subbands[i], get_ki_min(i,f), get_ki_cutoff(i,f),
+                                      [&](const double ki) {
+                                          return calculate_rate_ki(i, f, ki, _enable_blocking);
+                                      },
+                                      rel_tol);
+}
+
 /**
  * \brief Compute the squared screening length [QWWAD 3, 10.157]
  *
@@ -260,7 +577,7 @@ void ScatteringCalculatorLO::calculate_screening_length()
     if(_enable_screening)
     {
         // Sum over all subbands
-        for(const auto jsb : _subbands)
+        for(const auto &jsb : _subbands)
         {
             const auto Ej   = jsb.get_E_min();
             const auto f_FD = jsb.get_occupation_at_E_total(Ej);
@@ -269,6 +586,30 @@ void ScatteringCalculatorLO::calculate_screening_length()
 
         _lambda_s_sq *= e*e/(pi*pi*hBar*hBar*hBar*_epss);
     }
+
+    calculate_screened_Kz();
+}
+
+/**
+ * \brief Find the squared phonon wave vector at each sample, including screening
+ *
+ * \details The screened value, \f$K_z^2(1 + \lambda_s^2/K_z^2)^2\f$, doesn't depend
+ *          on the transition or the initial wave vector, so it is found once here
+ *          rather than in every rate integral.  The unscreened value is used at
+ *          \f$K_z = 0\f$.
+ */
+void ScatteringCalculatorLO::calculate_screened_Kz()
+{
+    _Kz_sq_eff = square(_Kz);
+
+    if(_enable_screening)
+    {
+        for(unsigned int iKz = 1; iKz < _Kz.size(); ++iKz)
+        {
+            const auto Kz_2 = _Kz_sq_eff[iKz];
+            _Kz_sq_eff[iKz] *= (1.0 + 2*_lambda_s_sq/Kz_2 + _lambda_s_sq*_lambda_s_sq/(Kz_2*Kz_2));
+        }
+    }
 }
 
 /**
@@ -277,17 +618,120 @@ void ScatteringCalculatorLO::calculate_screening_length()
 void ScatteringCalculatorLO::make_ff_table(const unsigned int i,
                                            const unsigned int f)
 {
-    const auto isb = _subbands[i];
-    const auto fsb = _subbands[f];
+    ScopedTimer timer("form-factor tabulation");
+    ff_table[ff_key(i,f)] = load_ff_table(i,f);
+}
+
+/**
+ * \brief Computes the formfactors for a set of transitions
+ *
+ * \param[in] transitions Initial and final subband indices for each transition
+ * \param[in] n_threads   Number of threads to use (0 = one per CPU core)
+ *
+ * \details A transition and its reverse share a table, so each pair of subbands
+ *          is only tabulated once.  Tables that already exist are left untouched.
+ *          The entries for the missing tables are created before any threads are
+ *          started, so each thread only writes into its own table and the map
+ *          itself is never modified concurrently.
+ */
+void ScatteringCalculatorLO::make_ff_tables(const std::vector<map_key> &transitions,
+                                            unsigned int                n_threads)
+{
+    ScopedTimer timer("form-factor tabulation");
+
+    std::set<map_key>        wanted;
+    std::vector<map_key>     missing;
+    std::vector<arma::vec *> tables;
+
+    // A transition and its reverse share the same table
+    for(auto const &idx : transitions)
+        wanted.insert(ff_key(idx.first, idx.second));
+
+    for(auto const &idx : wanted)
+    {
+        if(ff_table.count(idx) == 0)
+        {
+            missing.push_back(idx);
+            tables.push_back(&ff_table[idx]);
+        }
+    }
+
+    QWWAD_COUNT_N("LO form-factor table misses", missing.size());
+    QWWAD_COUNT_N("LO form-factor table hits",   wanted.size() - missing.size());
+
+    run_in_parallel(missing.size(), n_threads, [&](const size_t item) {
+        ScopedTraceEvent event("LO form factor");
+        *tables[item] = load_ff_table(missing[item].first, missing[item].second);
+    });
+}
+
+/**
+ * \brief Finds the formfactor table for a transition, using the cache if one is set
+ *
+ * \details If a cache directory has been set, a previously-saved table for the same
+ *          pair of wavefunctions and phonon wave-vector samples is read back.
+ *          Otherwise, the table is calculated and saved for later runs.
+ */
+arma::vec ScatteringCalculatorLO::load_ff_table(const unsigned int i,
+                                                const unsigned int f) const
+{
+    if(_ff_cache_dir.empty())
+        return calculate_ff_table(i,f);
+
+    const FormFactorCache cache(_ff_cache_dir);
+    const auto &isb = _subbands[i];
+    const auto &fsb = _subbands[f];
+
+    arma::vec Gifsqr;
+
+    if(!cache.read(isb, fsb, _Kz, Gifsqr))
+    {
+        QWWAD_COUNT("LO form-factor disk cache misses");
+        Gifsqr = calculate_ff_table(i,f);
+        cache.write(isb, fsb, _Kz, Gifsqr);
+    }
+    else
+        QWWAD_COUNT("LO form-factor disk cache hits");
+
+    return Gifsqr;
+}
+
+/**
+ * \brief Calculates the formfactor table for a transition without storing it
+ */
+arma::vec ScatteringCalculatorLO::calculate_ff_table(const unsigned int i,
+                                                     const unsigned int f) const
+{
+    const auto &isb = _subbands[i];
+    const auto &fsb = _subbands[f];
 
     const auto _nKz = _Kz.size();
-    const auto idx = std::make_pair(i,f);
-    ff_table[idx].resize(_nKz);
+    arma::vec Gifsqr(_nKz);
+
+    QWWAD_COUNT_N("LO form-factor evaluations", _nKz);
+
+    const auto &z = isb.z_array();
+
+    // If the Kz samples are uniformly spaced from zero, then on a uniform spatial
+    // mesh the whole table is a single Fourier integral of the product of the
+    // wavefunctions.  Otherwise, fall back to one integral per Kz value.
+    if(_Kz_scale == 0 and z.size() >= 2 and is_uniform_mesh(z))
+    {
+        const arma::vec PD_if = isb.psi_array() % fsb.psi_array();
+        const auto      G     = fourier_integral(PD_if, z[0], z[1] - z[0], _dKz, _nKz);
 
-    for(unsigned int iKz=0;iKz < _nKz;iKz++)
+        for(unsigned int iKz=0;iKz < _nKz;iKz++)
+            Gifsqr[iKz] = norm(G[iKz]); // Squared form-factor
+    }
+    else
     {
-        ff_table[idx][iKz] = Gsqr(_Kz[iKz], isb, fsb); // Squared form-factor
+        for(unsigned int iKz=0;iKz < _nKz;iKz++)
+        {
+            Gifsqr[iKz] = Gsqr(_Kz[iKz], isb, fsb); // Squared form-factor
+        }
     }
+
+    return Gifsqr;
 }
 
 /**
@@ -295,23 +739,21 @@ void ScatteringCalculatorLO::make_ff_table(const unsigned int i,
  */
 double ScatteringCalculatorLO::Gsqr(const double   Kz,
                                     const Subband &isb,
-                                    const Subband &fsb)
+                                    const Subband &fsb) const
 {
-    const auto     z = isb.z_array();
-    const auto    dz = z[1] - z[0];
-    const auto    nz = z.size();
-    const auto psi_i = isb.psi_array();
-    const auto psi_f = fsb.psi_array();
+    const auto     &z = isb.z_array();
+    const auto     nz = z.size();
+    const auto &psi_i = isb.psi_array();
+    const auto &psi_f = fsb.psi_array();
 
     std::complex<double> I(0,1); // Imaginary unit
 
-    // Find form-factor integral
-    arma::cx_vec G_integrand_dz(nz);
+    // Find form-factor integral, without storing the integrand
+    const auto &w = isb.get_quadrature().get_weights();
+    std::complex<double> G = 0;
 
     for(unsigned int iz=0; iz<nz; ++iz)
-        G_integrand_dz[iz] = exp(Kz*z[iz]*I) * psi_i[iz] * psi_f[iz];
-
-    auto G = integral(G_integrand_dz, dz);
+        G += exp(Kz*z[iz]*I) * (w[iz] * psi_i[iz] * psi_f[iz]);
 
     return norm(G);
 }
@@ -319,8 +761,7 @@ double ScatteringCalculatorLO::Gsqr(const double   Kz,
 arma::vec ScatteringCalculatorLO::get_ff_table(const unsigned int i,
                                                const unsigned int f) const
 {
-    const auto idx = std::make_pair(i,f);
-    const auto G = ff_table.at(idx);
+    const auto G = ff_table.at(ff_key(i,f));
     return G;
 }
 } // namespace
@@ -8,15 +8,22 @@
 #define QWWAD_SCATTERING_CALCULATOR_LO
 
 #include <map>
+#include <string>
 #include <utility>
+#include <vector>
 #include "subband.h"
 #include "intersubband-transition.h"
+#include "quadrature.h"
 
 namespace QWWAD {
 /**
  * \brief A calculator for electron-phonon scattering rates
  */
 class ScatteringCalculatorLO {
+public:
+    /// Initial and final subband indices for a transition
+    typedef std::pair<unsigned int, unsigned int> map_key;
+
 private:
     std::vector<Subband> _subbands; ///< The energy subbands in the system
 
@@ -35,26 +42,59 @@ private:
 
     // Precision parameters
     size_t _nki;     ///< Number of initial wave-vector samples
+    double _Kz_scale; ///< Scale of the mapped phonon wave-vector grid [1/m] (0 = uniform grid)
+
+    std::string _ff_cache_dir; ///< Directory for saved form-factor tables (empty = no cache)
 
     // Derived properties
-    decltype(_A0)      _dKz;         ///< Step size in phonon wave vector [1/m]
+    decltype(_A0)      _dKz;         ///< Step size in phonon wave vector (zero for a mapped grid) [1/m]
     decltype(_Ephonon) _omega_0;     ///< Phonon angular frequency [rad/s]
     decltype(_Ephonon) _N0;          ///< Bose-Einstein factor
     decltype(_Ephonon) _prefactor;   ///< Pre-factor for rates
     decltype(_A0)      _lambda_s_sq; ///< Squared screening length [m^2]
 
-    typedef std::pair<unsigned int, unsigned int> map_key;
-    arma::vec _Kz; ///< Wave vector samples [1/m]
+    arma::vec  _Kz;            ///< Wave vector samples [1/m]
+    Quadrature _Kz_quadrature; ///< Quadrature rule for integrals over the wave vector samples
+    arma::vec  _Kz_sq_eff;     ///< Squared wave vector at each sample, including screening [1/m^2]
 
     /**
      * \brief Table of form factors
      *
-     * \details The key refers to the initial and final subband indices
-     *          The map contains a table of \f$G_{if}^2(Kz)\f$
+     * \details The key refers to the initial and final subband indices, as
+     *          given by ff_key.  The map contains a table of \f$G_{if}^2(Kz)\f$
      */
     std::map<map_key, arma::vec> ff_table;
 
+    /**
+     * \brief Find the key of the form-factor table for a transition
+     *
+     * \details \f$G_{if}^2\f$ is symmetric in i and f, so a transition and its
+     *          reverse use the same table, with the lower index first.
+     */
+    static map_key ff_key(const unsigned int i,
+                          const unsigned int f)
+    {
+        return i < f ? std::make_pair(i,f) : std::make_pair(f,i);
+    }
+
     void calculate_screening_length();
+    void calculate_screened_Kz();
+    void calculate_prefactor();
+
+    arma::vec calculate_ff_table(const unsigned int i,
+                                 const unsigned int f) const;
+
+    arma::vec load_ff_table(const unsigned int i,
+                            const unsigned int f) const;
+
+    double calculate_rate_ki(const unsigned int i,
+                             const unsigned int f,
+                             const double       ki,
+                             const bool         enable_blocking) const;
+
+    IntersubbandTransition make_transition(const unsigned int i,
+                                           const unsigned int f,
+                                           const bool         enable_blocking);
 
 public:
     ScatteringCalculatorLO(decltype(_subbands)    subbands,
@@ -83,24 +123,62 @@ public:
    IntersubbandTransition get_transition(const unsigned int isb,
                                          const unsigned int fsb);
 
+   IntersubbandTransition get_kernel(const unsigned int isb,
+                                     const unsigned int fsb);
+
+   double get_average_rate(const unsigned int isb,
+                           const unsigned int fsb,
+                           const double       rel_tol);
+
+   std::vector<IntersubbandTransition>
+   get_transitions(const std::vector<map_key> &transitions,
+                   unsigned int                n_threads = 0);
+
+   std::vector< std::vector<IntersubbandTransition> >
+   get_transitions_vs_temperature(const std::vector<map_key> &transitions,
+                                  const arma::vec            &Te,
+                                  const arma::vec            &Tl,
+                                  unsigned int                n_threads = 0);
+
+   void set_emission(const decltype(_is_emission) is_emission);
+   void set_temperature(const decltype(_Te) Te,
+                        const decltype(_Tl) Tl);
+   void set_subband_populations(const arma::vec &N);
+
    inline decltype(_lambda_s_sq) get_screening_length() const {return _lambda_s_sq;}
 
    inline void set_ki_samples(const decltype(_nki) nki) {_nki = nki;}
-   void set_phonon_samples(const size_t nKz);
+   void set_phonon_samples(const size_t nKz,
+                           const double Kz_scale = 0.0);
 
    inline decltype(_dKz) get_dKz() {return _dKz;}
 
-   inline void enable_screening(const bool enabled) {_enable_screening = enabled;}
+   inline bool is_emission() const {return _is_emission;}
+
+   /// Return the energy given to the lattice in each scattering event [J]
+   inline double get_E_loss() const {return _is_emission ? _Ephonon : -_Ephonon;}
+
+   void enable_screening(const bool enabled);
    inline void enable_blocking (const bool enabled) {_enable_blocking  = enabled;}
 
+   /**
+    * \brief Save form-factor tables in a directory and reuse them in later runs
+    *
+    * \param[in] dir The cache directory, which must exist.  An empty string disables the cache.
+    */
+   inline void set_ff_cache_dir(const decltype(_ff_cache_dir) &dir) {_ff_cache_dir = dir;}
+
    inline decltype(_prefactor) get_prefactor() const {return _prefactor;}
 
    void make_ff_table(const unsigned int i,
                       const unsigned int f);
 
+   void make_ff_tables(const std::vector<map_key> &transitions,
+                       unsigned int                n_threads = 0);
+
    double Gsqr(const double   Kz,
                const Subband &isb,
-               const Subband &fsb);
+               const Subband &fsb) const;
 
    arma::vec get_ff_table(const unsigned int i, const unsigned int f) const;
    inline decltype(_Kz)  get_Kz_table() const {return _Kz;}
@@ -0,0 +1,339 @@
+/**
+ * \file   scattering-calculator-acoustic.cpp
+ * \author Paul Harrison  <p.harrison@shu.ac.uk>
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Calculator for acoustic-phonon deformation-potential scattering rates
+ */
+
+#include "scattering-calculator-acoustic.h"
+
+#include <cmath>
+#include <complex>
+#include <gsl/gsl_math.h>
+#include <gsl/gsl_spline.h>
+
+#include "constants.h"
+#include "form-factor-cache.h"
+#include "maths-helpers.h"
+#include "parallel.h"
+#include "quadrature.h"
+
+namespace QWWAD {
+using namespace constants;
+
+namespace
+{
+/**
+ * \brief Find the overlap integral squared between two states
+ *
+ * \param[in] Kz  Phonon wave-vector [1/m]
+ * \param[in] isb Initial subband
+ * \param[in] fsb Final subband
+ */
+double Gsqr(const double   Kz,
+            const Subband &isb,
+            const Subband &fsb)
+{
+    const auto &z = isb.z_array();
+    const double nz = z.size();
+    const auto &psi_i = isb.psi_array();
+    const auto &psi_f = fsb.psi_array();
+
+    std::complex<double> I(0,1); // Imaginary unit
+
+    // Find form-factor integral
+    arma::cx_vec exp_iKz(nz);
+
+    for(unsigned int iz=0; iz<nz; ++iz)
+        exp_iKz[iz] = exp(Kz*z[iz]*I);
+
+    const auto G = isb.get_quadrature().integrate(exp_iKz, psi_i, psi_f);
+
+    return norm(G);
+}
+} // namespace
+
+/**
+ * \brief Initialise an acoustic-phonon scattering calculation for a 2D system
+ *
+ * \param[in] subbands The energy subbands in the system
+ * \param[in] A0       Lattice constant [m]
+ * \param[in] Ephonon  Acoustic phonon energy [J]
+ * \param[in] Da       Acoustic deformation potential [J]
+ * \param[in] rho      Mass density [kg/m^3]
+ * \param[in] Vs       Speed of sound [m/s]
+ * \param[in] m        Band-edge effective mass [kg]
+ * \param[in] Te       Carrier temperature [K]
+ * \param[in] Tl       Lattice temperature [K]
+ */
+ScatteringCalculatorAcoustic::ScatteringCalculatorAcoustic(decltype(_subbands) subbands,
+                                                           decltype(_A0)       A0,
+                                                           decltype(_Ephonon)  Ephonon,
+                                                           decltype(_Da)       Da,
+                                                           decltype(_rho)      rho,
+                                                           decltype(_Vs)       Vs,
+                                                           decltype(_m)        m,
+                                                           decltype(_Te)       Te,
+                                                           decltype(_Tl)       Tl) :
+    _subbands(subbands),
+    _A0(A0),
+    _Ephonon(Ephonon),
+    _Da(Da),
+    _rho(rho),
+    _Vs(Vs),
+    _m(m),
+    _Te(Te),
+    _Tl(Tl),
+    _enable_blocking(true),
+    _Ecutoff_set(false),
+    _Ecutoff(0.0),
+    _nki(301),
+    _nKz(301),
+    _ntheta(101),
+    _nalpha(1001),
+    _ff_cache_dir()
+{}
+
+/**
+ * \brief Set a cut-off kinetic energy for the initial carrier distribution
+ *
+ * \param[in] Ecutoff Cut-off energy [J]
+ *
+ * \details By default, the cut-off is 5kT above the subband minimum.
+ */
+void ScatteringCalculatorAcoustic::set_Ecutoff(const decltype(_Ecutoff) Ecutoff)
+{
+    _Ecutoff_set = true;
+    _Ecutoff     = Ecutoff;
+}
+
+/**
+ * \brief Compute the form factor at a range of phonon wave-vectors
+ *
+ * \param[in]  isb    Initial subband
+ * \param[in]  fsb    Final subband
+ * \param[out] Kz     Phonon wave-vector samples [1/m]
+ * \param[out] Gifsqr Squared form factor at each sample
+ *
+ * \details The phonon wave-vector runs up to 2/A0.  If a cache directory has been
+ *          set, a table saved by a previous run is reused where possible.
+ */
+void ScatteringCalculatorAcoustic::make_ff_table(const Subband &isb,
+                                                 const Subband &fsb,
+                                                 arma::vec     &Kz,
+                                                 arma::vec     &Gifsqr) const
+{
+    const double dKz = 2/(_A0*_nKz); // Taken range of phonon integration as 2/A0
+
+    Kz.set_size(_nKz);
+    Gifsqr.set_size(_nKz);
+
+    for(unsigned int iKz=0;iKz<_nKz;iKz++)
+        Kz[iKz] = iKz*dKz; // Magnitude of phonon wave vector
+
+    if(!_ff_cache_dir.empty())
+    {
+        const FormFactorCache cache(_ff_cache_dir);
+
+        if(cache.read(isb, fsb, Kz, Gifsqr))
+            return;
+    }
+
+    for(unsigned int iKz=0;iKz<_nKz;iKz++)
+        Gifsqr[iKz] = Gsqr(Kz[iKz], isb, fsb); // Squared form-factor
+
+    if(!_ff_cache_dir.empty())
+        FormFactorCache(_ff_cache_dir).write(isb, fsb, Kz, Gifsqr);
+}
+
+/**
+ * \brief Find the emission and absorption rates for a transition
+ *
+ * \param[in] i         Index of initial subband (from 0)
+ * \param[in] f         Index of final subband (from 0)
+ * \param[in] n_threads Number of threads to use (0 = one per CPU core)
+ *
+ * \returns The rates at each initial wave-vector, and their means over the
+ *          initial subband
+ */
+ScatteringCalculatorAcoustic::Rates
+ScatteringCalculatorAcoustic::get_rates(const unsigned int i,
+                                        const unsigned int f,
+                                        const unsigned int n_threads) const
+{
+    // Convenience labels for each subband
+    const Subband &isb = _subbands[i];
+    const Subband &fsb = _subbands[f];
+
+    // Subband minima
+    const double Ei = isb.get_E_min();
+    const double Ef = fsb.get_E_min();
+
+    const double dtheta=pi/static_cast<double>(_ntheta-1); // theta integration from 0 to pi
+
+    // Can save a bit of time by calculating cosines in advance
+    arma::vec cos_theta(_ntheta);
+
+    for(unsigned int itheta = 0; itheta < _ntheta; ++itheta)
+        cos_theta[itheta] = cos(itheta*dtheta);
+
+    // calculate often used constants
+    const double N0=1/(exp(_Ephonon/(kB*_Tl))-1); // Bose-Einstein factor
+
+    // Find pre-factors for scattering rates
+    const double Upsilon_a = _Da*_Da*_m*N0/(_rho*_Vs*4*pi*pi*hBar*hBar);
+    const double Upsilon_e = _Da*_Da*_m*(N0+1)/(_rho*_Vs*4*pi*pi*hBar*hBar);
+
+    Rates rates;
+    make_ff_table(isb, fsb, rates.Kz, rates.Gifsqr);
+    const arma::vec Kz_sqr = square(rates.Kz);
+
+    // As a zero energy phonon is assumed, no need to
+    // consider emission and absorption processes as in e-LO scattering
+    double kimax = 0;
+    double Ecutoff = 0.0; // Maximum kinetic energy in initial subband
+    const double DeltaE = Ef - Ei;
+
+    // Use user-specified value if given, extending it if it does not allow the
+    // transition (see warn_Ecutoff_extended)
+    if(_Ecutoff_set)
+    {
+        Ecutoff = _Ecutoff;
+
+        if(Ecutoff+Ei < Ef)
+            Ecutoff += Ef;
+    }
+    // Otherwise, use a fixed, 5kT range
+    else
+    {
+        kimax   = isb.get_k_max(_Te);
+        Ecutoff = hBar*hBar*kimax*kimax/(2*_m);
+
+        if(Ecutoff+Ei < Ef)
+            Ecutoff += Ef;
+    }
+
+    kimax = isb.get_k_at_Ek(Ecutoff);
+
+    const double dki=kimax/((float)_nki);
+    const double tmp = 2*_m*DeltaE/(hBar*hBar);
+
+    // The integral over Kz depends only on the in-plane phonon wave-vector,
+    // alpha, so tabulate
+    //   H(alpha) = \int G^2(Kz) sqrt(alpha^2 + Kz^2) dKz
+    // once for the transition.  The largest alpha is found when
+    // ki cos(theta) = -kimax.
+    const Quadrature Kz_quadrature(_nKz, 2/(_A0*_nKz));
+    const arma::vec wG        = Kz_quadrature.get_weights() % rates.Gifsqr;
+    const double    alpha_max = kimax + sqrt(kimax*kimax + GSL_MAX_DBL(-tmp, 0.0));
+    const double    dalpha    = alpha_max/(_nalpha - 1);
+    arma::vec alpha_table(_nalpha);
+    arma::vec H_table(_nalpha);
+
+    for(unsigned int ialpha = 0; ialpha < _nalpha; ++ialpha)
+    {
+        alpha_table[ialpha] = ialpha*dalpha;
+        H_table[ialpha]     = dot(wG, sqrt(alpha_table[ialpha]*alpha_table[ialpha] + Kz_sqr));
+    }
+
+    gsl_spline *H = gsl_spline_alloc(gsl_interp_cspline, _nalpha);
+    gsl_spline_init(H, alpha_table.memptr(), H_table.memptr(), _nalpha);
+
+    arma::vec ki_table(_nki);
+    rates.Wa.set_size(_nki); // Absorption scattering rate at this wave-vector [1/s]
+    rates.We.set_size(_nki); // Emission scattering rate at this wave-vector [1/s]
+    arma::vec Wabar_integrand_ki(_nki); // Average scattering rate [1/s]
+    arma::vec Webar_integrand_ki(_nki); // Average scattering rate [1/s]
+
+    auto &Waif = rates.Wa;
+    auto &Weif = rates.We;
+
+    // calculate e-AC rate for all ki
+    run_in_parallel(_nki, n_threads, [&](const size_t iki) {
+        const double ki=dki*(float)iki+dki/100;	/* second term avoids ki=0 pole	*/
+        ki_table[iki] = ki;
+
+        // Each thread needs its own accelerator for interpolation of H
+        gsl_interp_accel *acc = gsl_interp_accel_alloc();
+
+        arma::vec Wif_integrand_dtheta(_ntheta, arma::fill::zeros);
+
+        /* Integral around angle theta	*/
+        for(unsigned int itheta=0;itheta<_ntheta;itheta++)
+        {
+            const double ki_cos_theta = ki*cos_theta[itheta];
+            const double arg = ki_cos_theta * ki_cos_theta - tmp;	// sqrt argument
+
+            if(arg>0)
+            {
+                const double sqrt_arg = sqrt(arg);
+
+                // solutions for phonon wavevector Kz
+                const double alpha1 =  sqrt_arg - ki_cos_theta;
+                const double alpha2 = -sqrt_arg - ki_cos_theta;
+
+                /* alpha1 and alpha2 represent solutions for the in-plane polar
+                   coordinate Kxy of the carrier momentum---they must be positive, hence
+                   use Heaviside unit step function to ignore other contributions	*/
+                double Wif_alpha = 0.0;
+
+                if(alpha1 > 0)
+                    Wif_alpha += alpha1*gsl_spline_eval(H, alpha1, acc);
+
+                if(alpha2 > 0)
+                    Wif_alpha += alpha2*gsl_spline_eval(H, alpha2, acc);
+
+                Wif_integrand_dtheta[itheta] = Wif_alpha/(alpha1-alpha2);
+            }
+        } /* end integral over theta	*/
+
+        gsl_interp_accel_free(acc);
+
+        const double Wif = integral(Wif_integrand_dtheta, dtheta);
+        Waif[iki]=2*Upsilon_a*Wif;
+        Weif[iki]=2*Upsilon_e*Wif;
+
+        /* Now check for energy conservation!, would be faster with a nasty `if'
+           statement just after the beginning of the ki loop!                 */
+        const double Eki = isb.get_Ek_at_k(ki);
+        const double Ef_em = Eki - DeltaE - _Ephonon;
+        const double Ef_ab = Eki - DeltaE + _Ephonon;
+        Weif[iki] *= Theta(Ef_em);
+        Waif[iki] *= Theta(Ef_ab);
+
+        // Include final-state blocking factor
+        if (_enable_blocking)
+        {
+            // Final wave-vector
+            if(Ef_em >= 0)
+            {
+                const double kf_em = sqrt(Ef_em*2*_m)/hBar;
+                Weif[iki] *= (1.0 - fsb.get_occupation_at_k(kf_em));
+            }
+
+            if(Ef_ab >= 0)
+            {
+                const double kf_ab = sqrt(Ef_ab*2*_m)/hBar;
+                Waif[iki] *= (1.0 - fsb.get_occupation_at_k(kf_ab));
+            }
+        }
+
+        Wabar_integrand_ki[iki] = Waif[iki]*ki*isb.get_occupation_at_k(ki);
+        Webar_integrand_ki[iki] = Weif[iki]*ki*isb.get_occupation_at_k(ki);
+    });
+
+    gsl_spline_free(H);
+
+    // Total energy of initial state = subband minimum + in-plane kinetic energy
+    rates.Ei_total.set_size(_nki);
+
+    for(unsigned int iki=0;iki<_nki;iki++)
+        rates.Ei_total[iki] = Ei + gsl_pow_2(hBar*ki_table[iki])/(2*_m);
+
+    rates.Wabar = integral(Wabar_integrand_ki, dki)/(pi*isb.get_total_population());
+    rates.Webar = integral(Webar_integrand_ki, dki)/(pi*isb.get_total_population());
+
+    return rates;
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
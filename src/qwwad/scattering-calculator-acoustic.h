@@ -0,0 +1,97 @@
+/**
+ * \file   scattering-calculator-acoustic.h
+ * \author Paul Harrison  <p.harrison@shu.ac.uk>
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Calculator for acoustic-phonon deformation-potential scattering rates
+ */
+
+#ifndef QWWAD_SCATTERING_CALCULATOR_ACOUSTIC
+#define QWWAD_SCATTERING_CALCULATOR_ACOUSTIC
+
+#include <string>
+#include <vector>
+#include "subband.h"
+
+namespace QWWAD {
+/**
+ * \brief A calculator for acoustic-phonon deformation-potential scattering rates
+ *
+ * \details The rates are found for intra- and intersubband transitions between
+ *          parallel parabolic subbands.  The integral of the form factor over
+ *          the phonon wave-vector is tabulated against the in-plane phonon
+ *          wave-vector once for each transition, and then interpolated in the
+ *          integral over the scattering angle.
+ */
+class ScatteringCalculatorAcoustic {
+public:
+    /**
+     * \brief Scattering rates for a single transition
+     */
+    struct Rates
+    {
+        arma::vec Kz;       ///< Phonon wave-vector samples [1/m]
+        arma::vec Gifsqr;   ///< Squared form factor at each phonon wave-vector
+        arma::vec Ei_total; ///< Total energy of initial state at each sample [J]
+        arma::vec Wa;       ///< Absorption rate at each initial wave-vector [1/s]
+        arma::vec We;       ///< Emission rate at each initial wave-vector [1/s]
+        double    Wabar;    ///< Mean absorption rate over the initial subband [1/s]
+        double    Webar;    ///< Mean emission rate over the initial subband [1/s]
+    };
+
+private:
+    std::vector<Subband> _subbands; ///< The energy subbands in the system
+
+    // Physical properties
+    double _A0;      ///< Lattice constant [m]
+    double _Ephonon; ///< Acoustic phonon energy [J]
+    double _Da;      ///< Acoustic deformation potential [J]
+    double _rho;     ///< Mass density [kg/m^3]
+    double _Vs;      ///< Speed of sound [m/s]
+    double _m;       ///< Band-edge effective mass [kg]
+    double _Te;      ///< Carrier temperature [K]
+    double _Tl;      ///< Lattice temperature [K]
+
+    bool   _enable_blocking; ///< Allow final-state blocking
+    bool   _Ecutoff_set;     ///< True if the user has set a cut-off energy
+    double _Ecutoff;         ///< User-specified cut-off kinetic energy [J]
+
+    // Precision parameters
+    size_t _nki;    ///< Number of initial wave-vector samples
+    size_t _nKz;    ///< Number of phonon wave-vector samples
+    size_t _ntheta; ///< Number of samples of scattering angle
+    size_t _nalpha; ///< Number of in-plane phonon wave-vectors in lookup table
+
+    std::string _ff_cache_dir; ///< Directory for saved form-factor tables (empty if none)
+
+    void make_ff_table(const Subband &isb,
+                       const Subband &fsb,
+                       arma::vec     &Kz,
+                       arma::vec     &Gifsqr) const;
+
+public:
+    ScatteringCalculatorAcoustic(decltype(_subbands) subbands,
+                                 decltype(_A0)       A0,
+                                 decltype(_Ephonon)  Ephonon,
+                                 decltype(_Da)       Da,
+                                 decltype(_rho)      rho,
+                                 decltype(_Vs)       Vs,
+                                 decltype(_m)        m,
+                                 decltype(_Te)       Te,
+                                 decltype(_Tl)       Tl);
+
+    inline void enable_blocking   (const bool enabled) {_enable_blocking = enabled;}
+    inline void set_ki_samples    (const decltype(_nki)    nki)    {_nki    = nki;}
+    inline void set_phonon_samples(const decltype(_nKz)    nKz)    {_nKz    = nKz;}
+    inline void set_theta_samples (const decltype(_ntheta) ntheta) {_ntheta = ntheta;}
+    inline void set_alpha_samples (const decltype(_nalpha) nalpha) {_nalpha = nalpha;}
+    inline void set_ff_cache_dir  (const decltype(_ff_cache_dir) &dir) {_ff_cache_dir = dir;}
+
+    void set_Ecutoff(const decltype(_Ecutoff) Ecutoff);
+
+    Rates get_rates(const unsigned int isb,
+                    const unsigned int fsb,
+                    const unsigned int n_threads) const;
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
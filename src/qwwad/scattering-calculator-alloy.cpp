@@ -0,0 +1,252 @@
+/**
+ * \file   scattering-calculator-alloy.cpp
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Calculator for alloy-disorder scattering rates
+ */
+
+#include <sstream>
+#include <stdexcept>
+#include "scattering-calculator-alloy.h"
+#include "constants.h"
+#include "maths-helpers.h"
+
+namespace QWWAD {
+using namespace constants;
+
+/**
+ * \brief Initialise an alloy-disorder scattering calculation for a 2D system
+ *
+ * \param[in] subbands The energy subbands in the system
+ * \param[in] x        Alloy fraction at each point in the mesh
+ * \param[in] m        Band-edge effective mass [kg]
+ * \param[in] T        Temperature of carrier distribution [K]
+ */
+ScatteringCalculatorAlloy::ScatteringCalculatorAlloy(decltype(_subbands) subbands,
+                                                     decltype(_x)        x,
+                                                     decltype(_m)        m,
+                                                     decltype(_T)        T) :
+    _subbands(subbands),
+    _x(x),
+    _m(m),
+    _T(T),
+    _Vad(600e-3*e),
+    _Omega(5.65e-10*5.65e-10*5.65e-10/4),
+    _enable_blocking(true),
+    _Ecutoff_set(false),
+    _Ecutoff(0.0),
+    _nki(101)
+{
+    const auto &z = _subbands[0].z_array();
+
+    if(_x.size() != z.size())
+    {
+        std::ostringstream oss;
+        oss << "Alloy profile has " << _x.size() << " points, but the wavefunctions have "
+            << z.size() << " points.";
+        throw std::length_error(oss.str());
+    }
+
+    _x_weighted = _subbands[0].get_quadrature().get_weights() % _x % (1.0 - _x);
+}
+
+/**
+ * \brief Set a cut-off kinetic energy for the initial carrier distribution
+ *
+ * \param[in] Ecutoff Cut-off energy [J]
+ *
+ * \details By default, the cut-off is found automatically for each subband.
+ */
+void ScatteringCalculatorAlloy::set_Ecutoff(const decltype(_Ecutoff) Ecutoff)
+{
+    _Ecutoff_set = true;
+    _Ecutoff     = Ecutoff;
+}
+
+/**
+ * \brief Change the population of each subband
+ *
+ * \param[in] N Sheet density of carriers in each subband [m^{-2}]
+ *
+ * \details The overlap integrals do not depend on the populations, so they are kept.
+ */
+void ScatteringCalculatorAlloy::set_subband_populations(const arma::vec &N)
+{
+    QWWAD::set_subband_populations(_subbands, N, _T);
+}
+
+/**
+ * \brief Find the minimum initial wave-vector that allows scattering
+ */
+double ScatteringCalculatorAlloy::get_ki_min(const unsigned int i,
+                                             const unsigned int f) const
+{
+    return find_elastic_ki_min(_subbands[i], _subbands[f], _m);
+}
+
+/**
+ * \brief Find the cut-off value for the initial wave vector
+ */
+double ScatteringCalculatorAlloy::get_ki_cutoff(const unsigned int i,
+                                                const unsigned int f) const
+{
+    return _subbands[i].get_k_at_Ek(find_elastic_Eki_cutoff(_subbands[i], _subbands[f], _m, _T,
+                                                            _Ecutoff_set, _Ecutoff));
+}
+
+/**
+ * \brief Find the overlap integral for a transition [1/m]
+ */
+double ScatteringCalculatorAlloy::get_Iif(const unsigned int i,
+                                          const unsigned int f)
+{
+    const auto idx = std::make_pair(i,f);
+
+    if(_Iif_table.count(idx) == 0)
+    {
+        const arma::vec psi_if = _subbands[i].psi_array() % _subbands[f].psi_array();
+        _Iif_table[idx] = dot(square(psi_if), _x_weighted);
+    }
+
+    return _Iif_table.at(idx);
+}
+
+/**
+ * \brief Find the scattering rate at a set of initial wave-vectors
+ *
+ * \param[in] i               Initial subband index
+ * \param[in] f               Final subband index
+ * \param[in] ki              Initial wave-vectors [1/m]
+ * \param[in] enable_blocking Include final-state blocking
+ *
+ * \details The overlap integral for the transition must already be known.
+ *          The rate is the same at all wave-vectors, apart from final-state blocking.
+ */
+arma::vec ScatteringCalculatorAlloy::calculate_rates(const unsigned int  i,
+                                                     const unsigned int  f,
+                                                     const arma::vec    &ki,
+                                                     const bool          enable_blocking) const
+{
+    const auto &isb = _subbands[i];
+    const auto &fsb = _subbands[f];
+
+    const double W0     = _m*_Omega*_Vad*_Vad/(hBar*hBar*hBar) * _Iif_table.at(std::make_pair(i,f));
+    const double dk_sqr = 2*_m*(isb.get_E_min() - fsb.get_E_min())/(hBar*hBar);
+
+    arma::vec Wif(ki.size());
+    Wif.fill(W0);
+
+    // Include final-state blocking factor
+    if (enable_blocking)
+    {
+        for(unsigned int iki = 0; iki < ki.size(); ++iki)
+        {
+            // Find energy-conserving final wave-vector
+            // This should be positive if the kimin value is correct.  If not,
+            // there is no final state to block.
+            const double kf_sqr = ki[iki]*ki[iki] + dk_sqr;
+
+            if(kf_sqr >= 0.0)
+                Wif[iki] *= (1 - fsb.get_occupation_at_k(sqrt(kf_sqr)));
+        }
+    }
+
+    return Wif;
+}
+
+/**
+ * \brief Returns the entire scattering table for an intersubband transition
+ *
+ * \param[in] i Initial subband index
+ * \param[in] f Final subband index
+ */
+IntersubbandTransition ScatteringCalculatorAlloy::get_transition(const unsigned int i,
+                                                                 const unsigned int f)
+{
+    return get_transitions(std::vector<map_key>(1, std::make_pair(i,f)))[0];
+}
+
+/**
+ * \brief Returns the scattering table for a transition, without final-state blocking
+ *
+ * \param[in] i Initial subband index
+ * \param[in] f Final subband index
+ *
+ * \details Alloy scattering is elastic, and without blocking the rate is the same
+ *          at every wave-vector.  Averages and blocking for any distribution can
+ *          be found from the table with the IntersubbandTransition functions.
+ */
+IntersubbandTransition ScatteringCalculatorAlloy::get_kernel(const unsigned int i,
+                                                             const unsigned int f)
+{
+    return make_transitions(std::vector<map_key>(1, std::make_pair(i,f)), false)[0];
+}
+
+/**
+ * \brief Find the average scattering rate for a transition using adaptive quadrature
+ *
+ * \param[in] i       Initial subband index
+ * \param[in] f       Final subband index
+ * \param[in] rel_tol Relative tolerance of the average
+ *
+ * \details The rate is found at whichever wave-vectors the integrator needs,
+ *          rather than at the fixed table of get_transition.
+ */
+double ScatteringCalculatorAlloy::get_average_rate(const unsigned int i,
+                                                   const unsigned int f,
+                                                   const double       rel_tol)
+{
+    get_Iif(i,f);
+
+    arma::vec ki_sample(1);
+
+    return find_average_rate_adaptive(_subbands[i], get_ki_min(i,f), get_ki_cutoff(i,f),
+                                      [&](const double ki) {
+                                          ki_sample[0] = ki;
+                                          return calculate_rates(i, f, ki_sample, _enable_blocking)[0];
+                                      },
+                                      rel_tol);
+}
+
+/**
+ * \brief Returns the scattering tables for a set of intersubband transitions
+ *
+ * \param[in] transitions Initial and final subband indices for each transition
+ *
+ * \details The overlap integral is found once for each pair of subbands, and the
+ *          rates at all initial wave-vectors are then found in a single pass.
+ */
+std::vector<IntersubbandTransition>
+ScatteringCalculatorAlloy::get_transitions(const std::vector<map_key> &transitions)
+{
+    return make_transitions(transitions, _enable_blocking);
+}
+
+/**
+ * \brief Make the scattering tables for a set of intersubband transitions
+ *
+ * \param[in] transitions     Initial and final subband indices for each transition
+ * \param[in] enable_blocking Include final-state blocking
+ */
+std::vector<IntersubbandTransition>
+ScatteringCalculatorAlloy::make_transitions(const std::vector<map_key> &transitions,
+                                            const bool                  enable_blocking)
+{
+    std::vector<IntersubbandTransition> tx;
+    tx.reserve(transitions.size());
+
+    for(const auto &idx : transitions)
+    {
+        const auto i = idx.first;
+        const auto f = idx.second;
+
+        get_Iif(i,f);
+
+        const arma::vec ki = arma::linspace(get_ki_min(i,f), get_ki_cutoff(i,f), _nki);
+        tx.push_back(IntersubbandTransition(_subbands[i], _subbands[f], ki,
+                                            calculate_rates(i,f,ki,enable_blocking)));
+    }
+
+    return tx;
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,104 @@
+/**
+ * \file   scattering-calculator-alloy.h
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Calculator for alloy-disorder scattering rates
+ */
+
+#ifndef QWWAD_SCATTERING_CALCULATOR_ALLOY
+#define QWWAD_SCATTERING_CALCULATOR_ALLOY
+
+#include <map>
+#include <utility>
+#include <vector>
+#include "subband.h"
+#include "intersubband-transition.h"
+
+namespace QWWAD {
+/**
+ * \brief A calculator for alloy-disorder scattering rates
+ *
+ * \details The rate depends on the overlap integral
+ *          \f[
+ *            I_{if} = \int \psi_i^2(z)\psi_f^2(z) x(z)[1-x(z)]\,\mathrm{d}z,
+ *          \f]
+ *          where \f$x(z)\f$ is the alloy fraction.  This is found once for each
+ *          transition and kept, so the disorder potential and scatterer volume
+ *          can be changed without finding it again.
+ */
+class ScatteringCalculatorAlloy {
+public:
+    /// Initial and final subband indices for a transition
+    typedef std::pair<unsigned int, unsigned int> map_key;
+
+private:
+    std::vector<Subband> _subbands; ///< The energy subbands in the system
+
+    // Physical properties
+    arma::vec _x; ///< Alloy fraction at each point in the mesh
+    double    _m; ///< Effective mass [kg]
+    double    _T; ///< Temperature of carrier distribution [K]
+
+    double _Vad;   ///< Alloy disorder potential [J]
+    double _Omega; ///< Volume of each scatterer [m^3]
+
+    bool   _enable_blocking; ///< Allow final-state blocking
+    bool   _Ecutoff_set;     ///< True if the user has set a cut-off energy
+    double _Ecutoff;         ///< User-specified cut-off kinetic energy [J]
+
+    // Precision parameters
+    size_t _nki; ///< Number of initial wave-vector samples
+
+    // Derived properties
+    arma::vec _x_weighted; ///< x(1-x) multiplied by quadrature weights [m]
+
+    /// Overlap integral for each transition [1/m]
+    std::map<map_key, double> _Iif_table;
+
+    arma::vec calculate_rates(const unsigned int  i,
+                              const unsigned int  f,
+                              const arma::vec    &ki,
+                              const bool          enable_blocking) const;
+
+    std::vector<IntersubbandTransition>
+    make_transitions(const std::vector<map_key> &transitions,
+                     const bool                  enable_blocking);
+
+public:
+    ScatteringCalculatorAlloy(decltype(_subbands) subbands,
+                              decltype(_x)        x,
+                              decltype(_m)        m,
+                              decltype(_T)        T);
+
+    inline void set_alloy_potential (const decltype(_Vad)   Vad)   {_Vad   = Vad;}
+    inline void set_scatterer_volume(const decltype(_Omega) Omega) {_Omega = Omega;}
+    inline void enable_blocking     (const bool enabled) {_enable_blocking = enabled;}
+    inline void set_ki_samples      (const decltype(_nki) nki) {_nki = nki;}
+
+    void set_Ecutoff(const decltype(_Ecutoff) Ecutoff);
+    void set_subband_populations(const arma::vec &N);
+
+    double get_ki_min(const unsigned int isb,
+                      const unsigned int fsb) const;
+
+    double get_ki_cutoff(const unsigned int isb,
+                         const unsigned int fsb) const;
+
+    double get_Iif(const unsigned int isb,
+                   const unsigned int fsb);
+
+    IntersubbandTransition get_transition(const unsigned int isb,
+                                          const unsigned int fsb);
+
+    IntersubbandTransition get_kernel(const unsigned int isb,
+                                      const unsigned int fsb);
+
+    double get_average_rate(const unsigned int isb,
+                            const unsigned int fsb,
+                            const double       rel_tol);
+
+    std::vector<IntersubbandTransition>
+    get_transitions(const std::vector<map_key> &transitions);
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,804 @@
+/**
+ * \file   scattering-calculator-carrier-carrier.cpp
+ * \author Paul Harrison  <p.harrison@shu.ac.uk>
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Calculator for carrier-carrier scattering rates
+ */
+
+#include "scattering-calculator-carrier-carrier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <gsl/gsl_math.h>
+#include <gsl/gsl_interp.h>
+#include <gsl/gsl_qrng.h>
+#include <gsl/gsl_rng.h>
+
+#include "carrier-carrier-gpu.h"
+#include "constants.h"
+#include "coulomb-overlap.h"
+#include "maths-helpers.h"
+#include "parallel.h"
+#include "quadrature.h"
+
+namespace QWWAD {
+using namespace constants;
+
+namespace
+{
+typedef ScatteringCalculatorCarrierCarrier::FormFactorKey FormFactorKey;
+
+/**
+ * \brief Integrate a function over the unit cube using randomised quasi-Monte Carlo
+ *
+ * \param[in]  f          Function to integrate.  This takes a pointer to the 3
+ *                        coordinates of the sample, each in the range [0,1)
+ * \param[in]  tolerance  Target error, relative to the magnitude of the integral
+ * \param[in]  max_points Maximum number of samples
+ * \param[out] error      Estimated (one standard deviation) error in the integral
+ *
+ * \details The samples are taken from a Sobol sequence, which fills the cube much
+ *          more evenly than random samples.  The sequence is repeated with several
+ *          random shifts (modulo 1), and the spread of the estimates from each
+ *          shifted sequence gives the error estimate.  The number of samples is
+ *          doubled until the error falls below the tolerance or the maximum
+ *          number of samples is reached.  The shifts use a fixed seed, so the
+ *          result is reproducible.
+ *
+ * \returns The integral
+ */
+double integrate_qmc(const std::function<double (const double *)> &f,
+                            const double                                  tolerance,
+                            const size_t                                  max_points,
+                            double                                       &error)
+{
+    const unsigned int ndim       = 3;   // Number of dimensions
+    const unsigned int nshift     = 8;   // Number of randomly shifted sequences
+    const size_t       min_points = 256; // Number of samples before first convergence check
+
+    // Random shifts for each sequence
+    gsl_rng *rng = gsl_rng_alloc(gsl_rng_mt19937);
+    double shift[nshift][ndim];
+
+    for(unsigned int ishift = 0; ishift < nshift; ++ishift)
+    {
+        for(unsigned int idim = 0; idim < ndim; ++idim)
+            shift[ishift][idim] = gsl_rng_uniform(rng);
+    }
+
+    gsl_rng_free(rng);
+
+    gsl_qrng *qrng = gsl_qrng_alloc(gsl_qrng_sobol, ndim);
+
+    std::vector<double> sum(nshift, 0.0); // Running sum of samples in each sequence
+    double mean = 0.0;
+    error = 0.0;
+
+    size_t npoints    = 0;
+    size_t next_check = min_points;
+
+    while(npoints < max_points)
+    {
+        double x[ndim];
+        gsl_qrng_get(qrng, x);
+
+        for(unsigned int ishift = 0; ishift < nshift; ++ishift)
+        {
+            double x_shifted[ndim];
+
+            for(unsigned int idim = 0; idim < ndim; ++idim)
+            {
+                x_shifted[idim] = x[idim] + shift[ishift][idim];
+
+                if(x_shifted[idim] >= 1.0)
+                    x_shifted[idim] -= 1.0;
+            }
+
+            sum[ishift] += f(x_shifted);
+        }
+
+        ++npoints;
+
+        // Check convergence each time the number of samples doubles (so that
+        // the Sobol sequence is balanced), and at the end
+        if(npoints == next_check || npoints == max_points)
+        {
+            mean = 0.0;
+
+            for(auto const s : sum)
+                mean += s/npoints;
+
+            mean /= nshift;
+
+            double variance = 0.0;
+
+            for(auto const s : sum)
+                variance += gsl_pow_2(s/npoints - mean);
+
+            variance /= (nshift - 1);
+            error = sqrt(variance/nshift);
+
+            if(error <= tolerance*fabs(mean))
+                break;
+
+            next_check *= 2;
+        }
+    }
+
+    gsl_qrng_free(qrng);
+
+    return mean;
+}
+
+/**
+ * \brief Find the label for the form-factor table of a transition
+ *
+ * \param[in] i      Initial subband for first carrier
+ * \param[in] j      Initial subband for second carrier
+ * \param[in] f      Final subband for first carrier
+ * \param[in] g      Final subband for second carrier
+ * \param[in] S_flag True if screening is included
+ *
+ * \details The matrix element A_ijfg only depends on the products ψ_i ψ_f and ψ_j ψ_g,
+ *          and is unchanged if the two products are exchanged.  The cut-off scattering
+ *          vector depends only on the sum of the maximum wave-vectors in the initial
+ *          subbands.  Deltak0sqr depends only on the total energy of the initial
+ *          subbands and of all four subbands, so it is also fixed by the label.  The
+ *          transitions ijfg and jigf therefore have the same table, unless screening
+ *          is included, since the polarizability is that of the first initial subband.
+ *
+ * \returns A label that is shared by all transitions with the same table
+ */
+FormFactorKey ff_key(const unsigned int i,
+                            const unsigned int j,
+                            const unsigned int f,
+                            const unsigned int g,
+                            const bool         S_flag)
+{
+    auto if_pair = std::make_pair(std::min(i,f), std::max(i,f));
+    auto jg_pair = std::make_pair(std::min(j,g), std::max(j,g));
+
+    if(jg_pair < if_pair)
+        std::swap(if_pair, jg_pair);
+
+    return std::make_tuple(if_pair, jg_pair,
+                           std::make_pair(std::min(i,j), std::max(i,j)),
+                           S_flag ? i : 0);
+}
+
+/**
+ * \brief Find the Coulomb matrix element for a pair of wavefunction products
+ *
+ * \param[in]  psi_if     ψ_i(z) ψ_f(z) for the first carrier
+ * \param[in]  psi_jg     ψ_j(z) ψ_g(z) for the second carrier
+ * \param[in]  q          Scattering vector [1/m]
+ * \param[in]  dz         Spatial step [m]
+ * \param[in]  quadrature Quadrature rule for the spatial grid
+ * \param[out] work       Workspace.  This is resized if needed, so the same array
+ *                        can be reused for every call.
+ *
+ * \details The matrix element is defined as
+ *           A_ijfg(q) = ∫dz ψ_i(z) ψ_f(z) I_jg(q,z),
+ *          where I_jg is found using find_Iif.
+ */
+double A(const arma::vec  &psi_if,
+                const arma::vec  &psi_jg,
+                const double      q,
+                const double      dz,
+                const Quadrature &quadrature,
+                arma::vec        &work)
+{
+    find_Iif(psi_jg, q, dz, work);
+    return quadrature.integrate(work, psi_if);
+}
+
+/* This function calculates the overlap integral over all four carrier
+   states		*/
+double A(const double   q_perp,
+         const Subband &isb,
+         const Subband &jsb,
+         const Subband &fsb,
+         const Subband &gsb)
+{
+    const auto &z = isb.z_array();
+    check_uniform_mesh(z, "Carrier-carrier scattering");
+
+    // Products of wavefunctions can be computed in advance
+    const arma::vec psi_if = isb.psi_array() % fsb.psi_array();
+    const arma::vec psi_jg = jsb.psi_array() % gsb.psi_array();
+
+    arma::vec work;
+    return A(psi_if, psi_jg, q_perp, z[1] - z[0], isb.get_quadrature(), work);
+}
+
+/**
+ * \brief Find the largest scattering vector needed for a transition [1/m]
+ *
+ * \param[in] Deltak0sqr Twice the change in kinetic energy, as a wave-vector [1/m^2]
+ * \param[in] isb        Initial subband for first carrier
+ * \param[in] jsb        Initial subband for second carrier
+ * \param[in] T          Temperature [K]
+ * \param[in] E_cutoff   Cut-off kinetic energy for the carrier distribution [J]
+ */
+double find_q_perp_max(const double   Deltak0sqr,
+                              const Subband &isb,
+                              const Subband &jsb,
+                              const double   T,
+                              const double   E_cutoff)
+{
+    // Find maximum wave-vectors for calculation if not specified
+    double kimax = 0.0; // Max value of ki [1/m]
+    double kjmax = 0.0; // Max value of kj [1/m]
+
+    if(E_cutoff > 0)
+    {
+        kimax = isb.get_k_at_Ek(E_cutoff*1.1);
+        kjmax = jsb.get_k_at_Ek(E_cutoff*1.1);
+    }
+    else
+    {
+        kimax = isb.get_k_max(T*1.1);
+        kjmax = jsb.get_k_max(T*1.1);
+    }
+
+    // maximum in-plane wave vector
+    return sqrt(2*gsl_pow_2(kimax+kjmax)+Deltak0sqr+2*(kimax+kjmax)*
+                sqrt(gsl_pow_2(kimax+kjmax)+Deltak0sqr))/2;
+}
+
+/**
+ *  \brief Compute the form factor [Aijfg/(esc q)]^2
+ *
+ * \param[in] Deltak0sqr Twice the change in kinetic energy, as a wave-vector [1/m^2]
+ * \param[in] epsilon    Low-frequency permittivity [F/m]
+ * \param[in] isb        Initial subband for first carrier
+ * \param[in] jsb        Initial subband for second carrier
+ * \param[in] psi_if     ψ_i(z) ψ_f(z)
+ * \param[in] psi_jg     ψ_j(z) ψ_g(z)
+ * \param[in] psi_ii     ψ_i(z) ψ_i(z) (needed for screening only)
+ * \param[in] PI_table   Polarizability of the initial subband (needed for screening only)
+ * \param[in] T          Temperature [K]
+ * \param[in] nq         Number of samples of the scattering vector
+ * \param[in] S_flag     True if screening is included
+ * \param[in] q_tol      Tolerance for an adaptive grid of scattering vectors, relative
+ *                       to the largest form factor.  If this is not positive, nq
+ *                       uniformly-spaced samples are used.
+ * \param[in] E_cutoff   Cut-off kinetic energy for the carrier distribution [J]
+ *
+ * \details On an adaptive grid, the table starts with a coarse set of uniform
+ *          samples.  Each interval is then bisected, and the new sample is kept.
+ *          The halves are only bisected again if the form factor at the new
+ *          sample differs from a linear interpolation between its neighbours by
+ *          more than the tolerance.  This stops when every interval is resolved
+ *          or nq samples have been found.
+ */
+gsl_spline * FF_table(const double                 Deltak0sqr,
+                      const double                 epsilon,
+                      const Subband               &isb,
+                      const Subband               &jsb,
+                      const arma::vec             &psi_if,
+                      const arma::vec             &psi_jg,
+                      const arma::vec             &psi_ii,
+                      const ScreeningTable        *PI_table,
+                      const double                 T,
+                      const size_t                 nq,
+                      const bool                   S_flag,
+                      const double                 q_tol,
+                      const double                 E_cutoff)
+{
+    // maximum in-plane wave vector
+    const double q_perp_max = find_q_perp_max(Deltak0sqr, isb, jsb, T, E_cutoff);
+
+    const auto  &z          = isb.z_array();
+    const double dz         = z[1] - z[0];
+    const auto  &quadrature = isb.get_quadrature();
+    arma::vec    work; // Workspace for matrix elements
+
+    // The matrix elements are found by a recurrence with a fixed step
+    check_uniform_mesh(z, "Carrier-carrier scattering");
+
+    // Form factor at a given scattering vector
+    auto find_FF = [&](const double q) -> double {
+        // Scattering matrix element (all 4 states)
+        const double _Aijfg = A(psi_if, psi_jg, q, dz, quadrature, work);
+
+        double _PI    = 0.0; // Polarizability
+        double _Aiiii = 0.0; // Matrix element for lowest subband
+
+        // Allow screening to be turned off
+        if(S_flag)
+        {
+            _PI    = PI_table->get_PI(q);
+            _Aiiii = A(psi_ii, psi_ii, q, dz, quadrature, work);
+        }
+
+        // Screening permittivity * wave vector
+        // Note that the pole at q_perp=0 is avoided as long as screening is included
+        const double esc_q = q + 2*pi*e*e/(4*pi*epsilon) * _PI * _Aiiii;
+        return _Aijfg*_Aijfg / (esc_q * esc_q);
+    };
+
+    // Start with a uniform grid.  If the grid is adaptive, this is just a
+    // coarse starting point
+    const size_t nq_start = (q_tol > 0) ? std::min<size_t>(nq, 17) : nq;
+    const double dq=q_perp_max/((float)(nq_start-1));	// interval in q_perp
+
+    std::vector<double> q_perp(nq_start);
+    std::vector<double> FF(nq_start);
+    std::vector<bool>   resolved(nq_start, false); // True if interval above each sample is resolved
+
+    for(unsigned int iq=0;iq<nq_start;iq++)
+    {
+        q_perp[iq] = iq*dq;
+        FF[iq]     = find_FF(q_perp[iq]);
+    }
+
+    // The singularity at q_perp=0 is clipped off below, so don't refine it
+    if(!S_flag)
+        resolved[0] = true;
+
+    if(q_tol > 0)
+    {
+        double FF_max = 0.0;
+
+        for(unsigned int iq = (S_flag ? 0 : 1); iq < nq_start; ++iq)
+            FF_max = std::max(FF_max, FF[iq]);
+
+        bool refined = true;
+
+        while(refined && q_perp.size() < nq)
+        {
+            refined = false;
+
+            std::vector<double> q_next;
+            std::vector<double> FF_next;
+            std::vector<bool>   resolved_next;
+
+            for(unsigned int iq = 0; iq < q_perp.size(); ++iq)
+            {
+                q_next.push_back(q_perp[iq]);
+                FF_next.push_back(FF[iq]);
+                resolved_next.push_back(resolved[iq]);
+
+                if(iq+1 < q_perp.size() && !resolved[iq] &&
+                   q_perp.size() + q_next.size() - (iq+1) < nq)
+                {
+                    const double q_mid  = 0.5*(q_perp[iq] + q_perp[iq+1]);
+                    const double FF_mid = find_FF(q_mid);
+                    const double error  = fabs(FF_mid - 0.5*(FF[iq] + FF[iq+1]));
+                    const bool   ok     = (error <= q_tol*FF_max);
+
+                    resolved_next.back() = ok;
+                    q_next.push_back(q_mid);
+                    FF_next.push_back(FF_mid);
+                    resolved_next.push_back(ok);
+                    refined = true;
+                }
+            }
+
+            q_perp   = q_next;
+            FF       = FF_next;
+            resolved = resolved_next;
+        }
+    }
+
+    // Fix singularity by "clipping" the top off it:
+    if(!S_flag)
+        FF[0] = FF[1];
+
+    // Pack the table of FF vs q into a cubic spline
+    gsl_spline *q_FF = gsl_spline_alloc(gsl_interp_cspline, q_perp.size());
+    gsl_spline_init(q_FF, &(q_perp[0]), &(FF[0]), q_perp.size());
+
+    return q_FF;
+}
+} // namespace
+
+/**
+ * \brief Initialise a carrier-carrier scattering calculation for a 2D system
+ *
+ * \param[in] subbands The energy subbands in the system
+ * \param[in] epsilon  Low-frequency permittivity [F/m]
+ * \param[in] m        Band-edge effective mass [kg]
+ * \param[in] T        Temperature of carrier distribution [K]
+ */
+ScatteringCalculatorCarrierCarrier::ScatteringCalculatorCarrierCarrier(decltype(_subbands) subbands,
+                                                                       decltype(_epsilon)  epsilon,
+                                                                       decltype(_m)        m,
+                                                                       decltype(_T)        T) :
+    _subbands(subbands),
+    _epsilon(epsilon),
+    _m(m),
+    _T(T),
+    _enable_screening(true),
+    _Ecutoff_set(false),
+    _Ecutoff(0.0),
+    _nki(101),
+    _nkj(101),
+    _nq(101),
+    _q_tol(-1.0),
+    _ntheta(101),
+    _nalpha(101),
+    _use_qmc(false),
+    _qmc_tolerance(1e-3),
+    _qmc_max_points(1048576),
+    _use_gpu(false)
+{}
+
+/**
+ * \brief Set a cut-off kinetic energy for the initial carrier distributions
+ *
+ * \param[in] Ecutoff Cut-off energy [J]
+ *
+ * \details By default, the cut-off is 5kT above the subband minimum.
+ */
+void ScatteringCalculatorCarrierCarrier::set_Ecutoff(const decltype(_Ecutoff) Ecutoff)
+{
+    _Ecutoff_set = true;
+    _Ecutoff     = Ecutoff;
+}
+
+/**
+ * \brief Integrate over kj, alpha and theta by randomised quasi-Monte Carlo sampling
+ *
+ * \param[in] tolerance  Target error, relative to the magnitude of each integral
+ * \param[in] max_points Maximum number of samples for each initial wave-vector
+ *
+ * \details The numbers of samples of kj, alpha and theta are then ignored, and the
+ *          GPU is not used.
+ */
+void ScatteringCalculatorCarrierCarrier::enable_qmc(const decltype(_qmc_tolerance)  tolerance,
+                                                    const decltype(_qmc_max_points) max_points)
+{
+    _use_qmc        = true;
+    _qmc_tolerance  = tolerance;
+    _qmc_max_points = max_points;
+}
+
+/**
+ * \brief Find the product of a pair of wavefunctions, reusing it if already known
+ *
+ * \param[in] a Index of the first subband (from 0)
+ * \param[in] b Index of the second subband (from 0)
+ */
+const arma::vec & ScatteringCalculatorCarrierCarrier::get_pair_product(const unsigned int a,
+                                                                       const unsigned int b)
+{
+    const auto key = std::make_pair(std::min(a,b), std::max(a,b));
+    auto it = _pair_products.find(key);
+
+    if(it == _pair_products.end())
+        it = _pair_products.insert(std::make_pair(key, arma::vec(_subbands[a].psi_array() % _subbands[b].psi_array()))).first;
+
+    return it->second;
+}
+
+/**
+ * \brief Find the screening table for a subband
+ *
+ * \param[in] i     Index of the subband
+ * \param[in] q_max Largest scattering vector that is needed [1/m]
+ *
+ * \details The table is only regenerated if a larger range of scattering vectors
+ *          is needed than in any previous transition
+ */
+const ScreeningTable & ScatteringCalculatorCarrierCarrier::get_screening_table(const unsigned int i,
+                                                                               const double       q_max)
+{
+    auto it = _screening_tables.find(i);
+
+    if(it == _screening_tables.end() || it->second.get_q_max() < q_max)
+    {
+        _screening_tables.erase(i);
+        it = _screening_tables.insert(std::make_pair(i, ScreeningTable(_subbands[i], _T, q_max))).first;
+    }
+
+    return it->second;
+}
+
+/**
+ * \brief Find the Coulomb matrix element for a transition
+ *
+ * \param[in] q_perp In-plane scattering vector [1/m]
+ * \param[in] i      Initial subband for first carrier (from 0)
+ * \param[in] j      Initial subband for second carrier (from 0)
+ * \param[in] f      Final subband for first carrier (from 0)
+ * \param[in] g      Final subband for second carrier (from 0)
+ */
+double ScatteringCalculatorCarrierCarrier::get_matrix_element(const double       q_perp,
+                                                              const unsigned int i,
+                                                              const unsigned int j,
+                                                              const unsigned int f,
+                                                              const unsigned int g) const
+{
+    return A(q_perp, _subbands[i], _subbands[j], _subbands[f], _subbands[g]);
+}
+
+/**
+ * \brief Find the scattering rate for a transition
+ *
+ * \param[in] i         Initial subband for first carrier (from 0)
+ * \param[in] j         Initial subband for second carrier (from 0)
+ * \param[in] f         Final subband for first carrier (from 0)
+ * \param[in] g         Final subband for second carrier (from 0)
+ * \param[in] n_threads Number of threads to use (0 = one per CPU core)
+ *
+ * \details If the GPU fails, the CPU is used instead for this and all later
+ *          transitions.
+ *
+ * \returns The rate at each initial wave-vector of the first carrier, and its
+ *          mean over the first initial subband
+ */
+ScatteringCalculatorCarrierCarrier::Rates
+ScatteringCalculatorCarrierCarrier::get_rates(const unsigned int i,
+                                              const unsigned int j,
+                                              const unsigned int f,
+                                              const unsigned int g,
+                                              const unsigned int n_threads)
+{
+    const bool qmc_flag = _use_qmc;
+    const bool S_flag   = _enable_screening;
+
+    /* calculate step lengths	*/
+    const double dalpha=2*pi/((float)_nalpha - 1); // step length for alpha integration
+    const double dtheta=2*pi/((float)_ntheta - 1); // step length for theta integration
+
+    // Can save a bit of time by calculating cosines in advance
+    arma::vec cos_theta(_ntheta);
+    arma::vec cos_alpha(_nalpha);
+
+    for(unsigned int itheta = 0; itheta < _ntheta; ++itheta)
+        cos_theta[itheta] = cos(itheta*dtheta);
+
+    for(unsigned int ialpha = 0; ialpha < _nalpha; ++ialpha)
+        cos_alpha[ialpha] = cos(dalpha*(float)ialpha);
+
+    // Convenience labels for each subband
+    const Subband &isb = _subbands[i];
+    const Subband &jsb = _subbands[j];
+    const Subband &fsb = _subbands[f];
+    const Subband &gsb = _subbands[g];
+
+    // Subband minima
+    const double Ei = isb.get_E_min();
+    const double Ej = jsb.get_E_min();
+    const double Ef = fsb.get_E_min();
+    const double Eg = gsb.get_E_min();
+
+    // Calculate Delta k0^2 [QWWAD3, Eq. 10.228]
+    //   twice the change in KE, see Smet (55)
+    double Deltak0sqr = 0;
+    if(i+j != f+g)
+        Deltak0sqr=4*_m*(Ei + Ej - Ef - Eg)/(hBar*hBar);
+
+    const auto &psi_if = get_pair_product(i, f);
+    const auto &psi_jg = get_pair_product(j, g);
+    const auto &psi_ii = get_pair_product(i, i);
+
+    double kimax = 0;
+    double kjmax = 0;
+    const double Ecutoff = _Ecutoff_set ? _Ecutoff : -1;
+
+    // Form factors are shared between transitions that give the same table.  The
+    // key uses subband indices from 1, so that screening by subband 0 is distinct
+    // from no screening.
+    const auto key = ff_key(i+1, j+1, f+1, g+1, S_flag);
+    auto ff_it = _ff_tables.find(key);
+
+    if(ff_it == _ff_tables.end())
+    {
+        const ScreeningTable *PI_table = nullptr;
+
+        if(S_flag)
+            PI_table = &get_screening_table(i, find_q_perp_max(Deltak0sqr, isb, jsb, _T, Ecutoff));
+
+        std::shared_ptr<gsl_spline> table(FF_table(Deltak0sqr, _epsilon, isb, jsb, psi_if, psi_jg, psi_ii,
+                                                   PI_table, _T, _nq, S_flag, _q_tol, Ecutoff),
+                                          gsl_spline_free);
+        ff_it = _ff_tables.insert(std::make_pair(key, table)).first;
+    }
+
+    const gsl_spline *FF = ff_it->second.get(); // Form factor table
+
+    if(Ecutoff > 0)
+    {
+        kimax = isb.get_k_at_Ek(Ecutoff);
+        kjmax = jsb.get_k_at_Ek(Ecutoff);
+    }
+    else
+    {
+        kimax=isb.get_k_max(_T);
+        kjmax=jsb.get_k_max(_T);
+    }
+
+    const auto nki    = _nki;
+    const auto nkj    = _nkj;
+    const auto nalpha = _nalpha;
+    const auto ntheta = _ntheta;
+
+    /* calculate maximum value of ki & kj and hence kj step length	*/
+    const double dki=kimax/((float)nki - 1); // step length for loop over ki
+    const double dkj=kjmax/((float)nkj - 1); // step length for kj integration
+
+    arma::vec Wbar_integrand_ki(nki); // initialise integral for average scattering rate
+    arma::vec Wijfg(nki);             // Scattering rate for a given initial wave vector
+    arma::vec Ei_t(nki);              // Total energy of initial state [J]
+
+    // Find Fermi-Dirac occupation at each kj
+    arma::vec P(nkj);
+
+    for(unsigned int ikj=0;ikj<nkj;ikj++)
+        P[ikj] = jsb.get_occupation_at_k(dkj*(float)ikj);
+
+    // Integrand over |kj| for each ki.  Each (ki, kj) pair is independent,
+    // so they are shared between threads.
+    arma::mat Wijfg_integrand_kj(nkj, nki);
+    arma::vec Wijfg_error(nki, arma::fill::zeros); // Error estimate for QMC integration
+
+    if(qmc_flag)
+    {
+        // Each initial wave-vector is integrated independently over the unit cube in
+        // (kj, alpha, theta), so they are shared between threads
+        const double volume = kjmax * 2*pi * 2*pi;
+
+        run_in_parallel(nki, n_threads, [&](const size_t iki) {
+            const double ki=dki*(float)iki; // carrier momentum
+
+            // Each thread needs its own accelerator for interpolation of FF
+            gsl_interp_accel *acc = gsl_interp_accel_alloc();
+
+            auto integrand = [&](const double *x) -> double {
+                const double kj    = kjmax * x[0];
+                const double alpha = 2*pi  * x[1];
+                const double theta = 2*pi  * x[2];
+
+                // Compute (vector)kj-(vector)(ki) [QWWAD3, 10.221]
+                const double kij_sqr = ki*ki+kj*kj-2*ki*kj*cos(alpha);
+                const double kfg_sqr = kij_sqr + Deltak0sqr;
+
+                // Argument of sqrt function=4*q_perp*q_perp [QWWAD3, 10.231]
+                const double q_perpsqr4 = kij_sqr + kfg_sqr - 2*sqrt(kij_sqr*kfg_sqr)*cos(theta);
+
+                if(!(q_perpsqr4 >= 0))
+                    return 0.0;
+
+                const double q_perp = sqrt(q_perpsqr4)/2; // in-plane momentum, |ki-kf|
+
+                return gsl_spline_eval(FF, q_perp, acc) * jsb.get_occupation_at_k(kj) * kj;
+            };
+
+            double error = 0.0;
+            Wijfg[iki]       = volume * integrate_qmc(integrand, _qmc_tolerance, _qmc_max_points, error);
+            Wijfg_error[iki] = volume * error;
+
+            gsl_interp_accel_free(acc);
+        });
+    }
+    else
+    {
+        // Use the GPU if there is one.  If it fails, the CPU is used instead
+        // for this and all later transitions.
+        if(_use_gpu)
+        {
+            // Quadrature weights for the angular integrals on the GPU
+            const arma::vec w_theta = integral_weights(ntheta, dtheta);
+            const arma::vec w_alpha = integral_weights(nalpha, dalpha);
+
+            arma::vec ki(nki);
+            arma::vec kj(nkj);
+
+            for(unsigned int iki = 0; iki < nki; ++iki)
+                ki[iki] = dki*(float)iki;
+
+            for(unsigned int ikj = 0; ikj < nkj; ++ikj)
+                kj[ikj] = dkj*(float)ikj;
+
+            try
+            {
+                Wijfg_integrand_kj = integrate_carrier_carrier_gpu(FF, Deltak0sqr, ki, kj, P,
+                                                                   cos_alpha, w_alpha,
+                                                                   cos_theta, w_theta);
+            }
+            catch(std::exception &ex)
+            {
+                std::cerr << ex.what() << "  Using the CPU instead." << std::endl;
+                _use_gpu = false;
+            }
+        }
+
+        if(!_use_gpu)
+        {
+            run_in_parallel(nki*nkj, n_threads, [&](const size_t item) {
+                const unsigned int iki = item / nkj;
+                const unsigned int ikj = item % nkj;
+                const double ki=dki*(float)iki; // carrier momentum
+                const double kj=dkj*(float)ikj; // carrier momentum
+
+                // Each thread needs its own accelerator for interpolation of FF
+                gsl_interp_accel *acc = gsl_interp_accel_alloc();
+
+                // Integral over alpha
+                arma::vec Wijfg_integrand_alpha(nalpha);
+                arma::vec q_perpsqr4(ntheta);
+                arma::vec Wijfg_integrand_theta(ntheta);
+
+                for(unsigned int ialpha=0;ialpha<nalpha;ialpha++)
+                {
+                    // Compute (vector)kj-(vector)(ki) [QWWAD3, 10.221]
+                    const double kij_sqr = ki*ki+kj*kj-2*ki*kj*cos_alpha[ialpha];
+                    const double kij = sqrt(kij_sqr);
+
+                    // Can also pre-calculate a few of the terms needed inside the following loop
+                    // to save time
+                    const double kfg_sqr = kij_sqr + Deltak0sqr;
+                    const double kfg     = sqrt(kfg_sqr);
+                    const double kij_sqr_plus_kfg_sqr = kij_sqr + kfg_sqr;
+                    const double two_kij_kfg = 2 * kij * kfg;
+
+                    /* calculate argument of sqrt function=4*q_perp*q_perp,
+                     * see [QWWAD3, 10.231], for every theta at once.  This is a
+                     * simple vector expression, so it is evaluated with SIMD instructions */
+                    q_perpsqr4 = kij_sqr_plus_kfg_sqr - two_kij_kfg * cos_theta;
+
+                    // Now perform innermost integral (over theta)
+                    for(unsigned int itheta=0;itheta<ntheta;itheta++)
+                    {
+                        // If argument is positive, q_perp is real and hence calculate
+                        // scattering rate, otherwise ignore and move onto next q_perp
+                        if(q_perpsqr4[itheta]>=0)
+                        {
+                            const double q_perp=sqrt(q_perpsqr4[itheta])/2; // in-plane momentum, |ki-kf|
+
+                            // Find the form-factor at this wave-vector by looking it up in the
+                            // spline we created earlier
+                            Wijfg_integrand_theta[itheta] = gsl_spline_eval(FF, q_perp, acc);
+                        }
+                        else
+                            Wijfg_integrand_theta[itheta] = 0.0;
+                    } /* end theta */
+
+                    Wijfg_integrand_alpha[ialpha] = integral(Wijfg_integrand_theta, dtheta);
+                } /* end alpha */
+
+                Wijfg_integrand_kj(ikj, iki) = integral(Wijfg_integrand_alpha, dalpha) * P[ikj] * kj;
+
+                gsl_interp_accel_free(acc);
+            });
+        }
+    }
+
+    // calculate c-c rate for all ki
+    for(unsigned int iki=0;iki<nki;iki++)
+    {
+        const double ki=dki*(float)iki; // carrier momentum
+
+        if(!qmc_flag)
+        {
+            const arma::vec Wijfg_integrand_kj_ki = Wijfg_integrand_kj.col(iki);
+            Wijfg[iki] = integral(Wijfg_integrand_kj_ki,dkj);
+        }
+
+        // Multiply by pre-factor [QWWAD3, 10.233]
+        const double prefactor = _m*e*e*e*e / (4*pi*hBar*hBar*hBar*(4*4*pi*pi*_epsilon*_epsilon));
+        Wijfg[iki]       *= prefactor;
+        Wijfg_error[iki] *= prefactor;
+        Ei_t[iki] = isb.get_E_total_at_k(ki);
+
+        /* calculate Fermi-Dirac weighted mean of scattering rates over the
+           initial carrier states, note that the integral step length
+           dE=2*sqr(hBar)*ki*dki/(2m)					*/
+        Wbar_integrand_ki[iki] = Wijfg[iki]*ki*isb.get_occupation_at_k(ki);
+    } /* end ki	*/
+
+    Rates rates;
+    rates.Ei_total = Ei_t;
+    rates.W        = Wijfg;
+    rates.W_error  = Wijfg_error;
+    rates.Wbar     = integral(Wbar_integrand_ki, dki)/(pi*isb.get_total_population());
+
+    return rates;
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
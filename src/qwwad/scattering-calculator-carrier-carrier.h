@@ -0,0 +1,128 @@
+/**
+ * \file   scattering-calculator-carrier-carrier.h
+ * \author Paul Harrison  <p.harrison@shu.ac.uk>
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Calculator for carrier-carrier scattering rates
+ */
+
+#ifndef QWWAD_SCATTERING_CALCULATOR_CARRIER_CARRIER
+#define QWWAD_SCATTERING_CALCULATOR_CARRIER_CARRIER
+
+#include <map>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <gsl/gsl_spline.h>
+#include "screening-table.h"
+#include "subband.h"
+
+namespace QWWAD {
+/**
+ * \brief A calculator for carrier-carrier scattering rates
+ *
+ * \details A transition ijfg takes one carrier from subband i to f, and a second
+ *          from subband j to g.  The form factor is found once as a function of
+ *          the in-plane scattering vector, and interpolated in the integrals
+ *          over the wave-vector of the second carrier and the two scattering
+ *          angles.
+ *
+ *          Wavefunction products, screening tables and form-factor tables are
+ *          kept, so that they are shared between all the transitions that are
+ *          found with the same calculator.
+ */
+class ScatteringCalculatorCarrierCarrier {
+public:
+    /**
+     * \brief Scattering rates for a single transition
+     */
+    struct Rates
+    {
+        arma::vec Ei_total; ///< Total energy of first initial state at each sample [J]
+        arma::vec W;        ///< Scattering rate at each initial wave-vector [1/s]
+        arma::vec W_error;  ///< Estimated error in W (zero unless QMC is used) [1/s]
+        double    Wbar;     ///< Mean rate over the first initial subband [1/s]
+    };
+
+    /// Label for a form-factor table: the two wavefunction products, the two initial
+    /// subbands and the screening subband
+    typedef std::tuple<std::pair<unsigned int, unsigned int>,
+                       std::pair<unsigned int, unsigned int>,
+                       std::pair<unsigned int, unsigned int>,
+                       unsigned int> FormFactorKey;
+
+private:
+    std::vector<Subband> _subbands; ///< The energy subbands in the system
+
+    // Physical properties
+    double _epsilon; ///< Low-frequency permittivity [F/m]
+    double _m;       ///< Band-edge effective mass [kg]
+    double _T;       ///< Temperature of carrier distribution [K]
+
+    bool   _enable_screening; ///< Include screening of the Coulomb interaction
+    bool   _Ecutoff_set;      ///< True if the user has set a cut-off energy
+    double _Ecutoff;          ///< User-specified cut-off kinetic energy [J]
+
+    // Precision parameters
+    size_t _nki;    ///< Number of initial wave-vector samples for first carrier
+    size_t _nkj;    ///< Number of initial wave-vector samples for second carrier
+    size_t _nq;     ///< Number of scattering-vector samples in form-factor table
+    double _q_tol;  ///< Tolerance for adaptive scattering-vector grid (uniform if not positive)
+    size_t _ntheta; ///< Number of samples of theta angle
+    size_t _nalpha; ///< Number of samples of alpha angle
+
+    bool   _use_qmc;        ///< Use quasi-Monte Carlo integration
+    double _qmc_tolerance;  ///< Target relative error for quasi-Monte Carlo integration
+    size_t _qmc_max_points; ///< Maximum number of quasi-Monte Carlo samples
+    bool   _use_gpu;        ///< Find the integrals on the GPU
+
+    /// Products of pairs of wavefunctions, indexed by the (ascending) pair of subband indices
+    std::map<std::pair<unsigned int, unsigned int>, arma::vec> _pair_products;
+
+    /// Screening table for each initial subband
+    std::map<unsigned int, ScreeningTable> _screening_tables;
+
+    /// Form-factor tables, shared between transitions that are related by symmetry
+    std::map<FormFactorKey, std::shared_ptr<gsl_spline>> _ff_tables;
+
+    const arma::vec & get_pair_product(const unsigned int a,
+                                       const unsigned int b);
+
+    const ScreeningTable & get_screening_table(const unsigned int i,
+                                               const double       q_max);
+
+public:
+    ScatteringCalculatorCarrierCarrier(decltype(_subbands) subbands,
+                                       decltype(_epsilon)  epsilon,
+                                       decltype(_m)        m,
+                                       decltype(_T)        T);
+
+    inline void enable_screening (const bool enabled)              {_enable_screening = enabled;}
+    inline void set_ki_samples   (const decltype(_nki)    nki)     {_nki    = nki;}
+    inline void set_kj_samples   (const decltype(_nkj)    nkj)     {_nkj    = nkj;}
+    inline void set_q_samples    (const decltype(_nq)     nq)      {_nq     = nq;}
+    inline void set_q_tolerance  (const decltype(_q_tol)  q_tol)   {_q_tol  = q_tol;}
+    inline void set_theta_samples(const decltype(_ntheta) ntheta)  {_ntheta = ntheta;}
+    inline void set_alpha_samples(const decltype(_nalpha) nalpha)  {_nalpha = nalpha;}
+    inline void enable_gpu       (const bool enabled)              {_use_gpu = enabled;}
+
+    void set_Ecutoff(const decltype(_Ecutoff) Ecutoff);
+
+    void enable_qmc(const decltype(_qmc_tolerance)  tolerance,
+                    const decltype(_qmc_max_points) max_points);
+
+    double get_matrix_element(const double       q_perp,
+                              const unsigned int i,
+                              const unsigned int j,
+                              const unsigned int f,
+                              const unsigned int g) const;
+
+    Rates get_rates(const unsigned int i,
+                    const unsigned int j,
+                    const unsigned int f,
+                    const unsigned int g,
+                    const unsigned int n_threads);
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,499 @@
+/**
+ * \file   scattering-calculator-impurity.cpp
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Calculator for scattering rates for carrier-ionised impurity interactions
+ */
+
+#include <sstream>
+#include <stdexcept>
+#include "scattering-calculator-impurity.h"
+#include "constants.h"
+#include "coulomb-overlap.h"
+#include "maths-helpers.h"
+#include "parallel.h"
+
+namespace QWWAD {
+using namespace constants;
+
+/**
+ * \brief Initialise an impurity scattering calculation for a 2D system
+ *
+ * \param[in] subbands The energy subbands in the system
+ * \param[in] d        Volume doping at each point in the mesh [m^{-3}]
+ * \param[in] epsilon  Low-frequency dielectric constant [F/m]
+ * \param[in] m        Band-edge effective mass [kg]
+ * \param[in] T        Temperature of carrier distribution [K]
+ */
+ScatteringCalculatorImpurity::ScatteringCalculatorImpurity(decltype(_subbands) subbands,
+                                                           decltype(_d)        d,
+                                                           decltype(_epsilon)  epsilon,
+                                                           decltype(_m)        m,
+                                                           decltype(_T)        T) :
+    _subbands(subbands),
+    _epsilon(epsilon),
+    _m(m),
+    _T(T),
+    _enable_screening(true),
+    _enable_blocking(true),
+    _Ecutoff_set(false),
+    _Ecutoff(0.0),
+    _nki(101),
+    _nq(101),
+    _ntheta(101)
+{
+    set_doping(d);
+    set_cos_theta();
+}
+
+/**
+ * \brief Set the doping profile
+ *
+ * \param[in] d Volume doping at each point in the mesh [m^{-3}]
+ *
+ * \details The form factors are linear in the doping, so only the final
+ *          integral over the doping profile needs to be repeated.  The tables
+ *          of overlap integrals are kept.
+ */
+void ScatteringCalculatorImpurity::set_doping(const decltype(_d) &d)
+{
+    const auto &z = _subbands[0].z_array();
+
+    if(d.size() != z.size())
+    {
+        std::ostringstream oss;
+        oss << "Doping profile has " << d.size() << " points, but the wavefunctions have "
+            << z.size() << " points.";
+        throw std::length_error(oss.str());
+    }
+
+    // The overlap integrals are found by a recurrence with a fixed step
+    check_uniform_mesh(z, "Impurity scattering");
+
+    _d          = d;
+    _d_weighted = _subbands[0].get_quadrature().get_weights() % d;
+    ff_table.clear();
+}
+
+/**
+ * \brief Enable or disable screening of the impurity potential
+ *
+ * \details The form-factor tables are regenerated if the setting changes, but the
+ *          tables of overlap integrals are kept.
+ */
+void ScatteringCalculatorImpurity::enable_screening(const bool enabled)
+{
+    if(enabled != _enable_screening)
+    {
+        _enable_screening = enabled;
+        ff_table.clear();
+    }
+}
+
+/**
+ * \brief Set a cut-off kinetic energy for the initial carrier distribution
+ *
+ * \param[in] Ecutoff Cut-off energy [J]
+ *
+ * \details By default, the cut-off is found automatically for each subband.
+ *          The range of scattering vectors depends on the cut-off, so all
+ *          tables are regenerated the next time a scattering rate is needed.
+ */
+void ScatteringCalculatorImpurity::set_Ecutoff(const decltype(_Ecutoff) Ecutoff)
+{
+    _Ecutoff_set = true;
+    _Ecutoff     = Ecutoff;
+
+    _q_table.clear();
+    _Iif_sqr_table.clear();
+    ff_table.clear();
+}
+
+/**
+ * \brief Sets the number of scattering-vector samples in form-factor tables
+ *
+ * \details If the number is different from the currently-used value, all
+ *          tables are regenerated the next time a scattering rate is needed.
+ */
+void ScatteringCalculatorImpurity::set_q_samples(const decltype(_nq) nq)
+{
+    if(nq != _nq)
+    {
+        _nq = nq;
+        _q_table.clear();
+        _Iif_sqr_table.clear();
+        ff_table.clear();
+    }
+}
+
+/**
+ * \brief Sets the number of samples in the scattering angle integration
+ */
+void ScatteringCalculatorImpurity::set_theta_samples(const decltype(_ntheta) ntheta)
+{
+    _ntheta = ntheta;
+    set_cos_theta();
+}
+
+/**
+ * \brief Tabulate the cosine of each scattering angle sample
+ */
+void ScatteringCalculatorImpurity::set_cos_theta()
+{
+    const double dtheta = 2*pi/((float)_ntheta - 1); // step length for theta integration
+
+    _cos_theta.set_size(_ntheta);
+
+    for(unsigned int itheta = 0; itheta < _ntheta; ++itheta)
+        _cos_theta[itheta] = cos(itheta*dtheta);
+}
+
+/**
+ * \brief Find the minimum initial wave-vector that allows scattering
+ */
+double ScatteringCalculatorImpurity::get_ki_min(const unsigned int i,
+                                                const unsigned int f) const
+{
+    return find_elastic_ki_min(_subbands[i], _subbands[f], _m);
+}
+
+/**
+ * \brief Find the cut-off value for the initial wave vector
+ */
+double ScatteringCalculatorImpurity::get_ki_cutoff(const unsigned int i,
+                                                   const unsigned int f) const
+{
+    return _subbands[i].get_k_at_Ek(find_elastic_Eki_cutoff(_subbands[i], _subbands[f], _m, _T,
+                                                            _Ecutoff_set, _Ecutoff));
+}
+
+/**
+ * \brief Tabulate the squared overlap integrals for a transition
+ *
+ * \details The table holds \f$I_{if}^2(q,z')\f$ at each point in the mesh and
+ *          at each scattering vector needed for the form-factor table.  Each
+ *          column is a convolution of \f$\psi_i\psi_f\f$ with
+ *          \f$\exp(-q|z|)\f$, which find_Iif evaluates in a single O(nz) pass, so
+ *          the whole table costs O(nq nz).  The columns are independent, so they
+ *          are shared between threads and written in place.
+ */
+void ScatteringCalculatorImpurity::make_Iif_sqr_table(const unsigned int i,
+                                                      const unsigned int f)
+{
+    const auto &isb = _subbands[i];
+    const auto &fsb = _subbands[f];
+
+    const double Eki_cutoff = find_elastic_Eki_cutoff(isb, fsb, _m, _T, _Ecutoff_set, _Ecutoff);
+    const double kimax      = isb.get_k_at_Ek(Eki_cutoff*1.1); // Max value of ki [1/m]
+    const double Ei         = isb.get_E_min();
+    const double Ef         = fsb.get_E_min();
+    const double kfmax      = sqrt(kimax*kimax + 2*_m*(Ei - Ef)/(hBar*hBar));
+
+    // maximum in-plane wave vector
+    const double q_max = sqrt(kimax*kimax + kfmax*kfmax + 2*kimax*kfmax);
+
+    const double dq=q_max/((float)(_nq-1));	// interval in q_perp
+
+    const auto   &z  = isb.z_array();
+    const auto    nz = z.size();
+    const double  dz = z[1] - z[0];
+    const arma::vec psi_if = isb.psi_array() % fsb.psi_array();
+
+    const auto idx = std::make_pair(i,f);
+    auto &q       = _q_table[idx];
+    auto &Iif_sqr = _Iif_sqr_table[idx];
+    q.set_size(_nq);
+    Iif_sqr.set_size(nz, _nq);
+
+    for(unsigned int iq=0;iq<_nq;iq++)
+        q[iq] = iq*dq;
+
+    run_in_parallel(_nq, 0, [&](const size_t iq) {
+        // Work directly on this column of the table
+        arma::vec Iif(Iif_sqr.colptr(iq), nz, false, true);
+        find_Iif(psi_if, q[iq], dz, Iif);
+        Iif %= Iif;
+    });
+}
+
+/**
+ *  \brief Compute the form factor Jif/q^2 for a transition
+ *
+ *  \details The overlap integrals are only found if they are not already known,
+ *           so this is cheap after the doping or screening has changed.
+ */
+void ScatteringCalculatorImpurity::make_ff_table(const unsigned int i,
+                                                 const unsigned int f)
+{
+    const auto idx = std::make_pair(i,f);
+
+    if(_Iif_sqr_table.count(idx) == 0)
+        make_Iif_sqr_table(i,f);
+
+    const auto &q       = _q_table.at(idx);
+    const auto &Iif_sqr = _Iif_sqr_table.at(idx);
+
+    // Thomas--Fermi screening wave-vector
+    double q_TF = 0.0;
+
+    // Allow screening to be turned off
+    if(_enable_screening)
+        q_TF = _m*e*e/(2*pi*_epsilon*hBar*hBar);
+
+    // Scattering matrix element at every wave vector, found as a single
+    // matrix-vector product
+    arma::vec FF = Iif_sqr.t() * _d_weighted;
+
+    for(unsigned int iq=0;iq<_nq;iq++)
+    {
+        // Screening permittivity * wave vector
+        // Note that the pole at q_perp=0 is avoided as long as screening is included
+        FF[iq] /= q[iq]*q[iq] + q_TF*q_TF + 2*q[iq]*q_TF;
+    }
+
+    // Fix singularity by "clipping" the top off it:
+    if(!_enable_screening)
+        FF[0] = FF[1];
+
+    ff_table[idx] = FF;
+}
+
+/**
+ * \brief Pack the form-factor table for a transition into a cubic spline
+ */
+gsl_spline * ScatteringCalculatorImpurity::make_ff_spline(const unsigned int i,
+                                                          const unsigned int f)
+{
+    const auto idx = std::make_pair(i,f);
+
+    if(ff_table.count(idx) == 0)
+        make_ff_table(i,f);
+
+    const auto &q  = _q_table.at(idx);
+    const auto &FF = ff_table.at(idx);
+
+    gsl_spline *q_FF = gsl_spline_alloc(gsl_interp_cspline, _nq);
+    gsl_spline_init(q_FF, q.memptr(), FF.memptr(), _nq);
+
+    return q_FF;
+}
+
+/**
+ * \brief Find the overlap integral J_if at an arbitrary scattering vector
+ *
+ * \param[in] q Scattering vector [1/m]
+ * \param[in] i Initial subband index
+ * \param[in] f Final subband index
+ */
+double ScatteringCalculatorImpurity::Jif(const double       q,
+                                         const unsigned int i,
+                                         const unsigned int f) const
+{
+    const auto &z = _subbands[i].z_array();
+    const arma::vec psi_if = _subbands[i].psi_array() % _subbands[f].psi_array();
+
+    arma::vec Iif;
+    find_Iif(psi_if, q, z[1] - z[0], Iif);
+
+    return dot(square(Iif), _d_weighted);
+}
+
+/**
+ * \brief Find the scattering rate at a given initial wave-vector, using a form-factor spline
+ *
+ * \param[in] i               The initial subband index
+ * \param[in] f               The final subband index
+ * \param[in] ki              The initial wave vector
+ * \param[in] FF              Spline of the form factor against scattering vector
+ * \param[in] acc             Accelerator for the spline
+ * \param[in] enable_blocking Include final-state blocking
+ */
+double ScatteringCalculatorImpurity::calculate_rate_ki(const unsigned int  i,
+                                                       const unsigned int  f,
+                                                       const double        ki,
+                                                       gsl_spline         *FF,
+                                                       gsl_interp_accel   *acc,
+                                                       const bool          enable_blocking) const
+{
+    const auto &isb = _subbands[i];
+    const auto &fsb = _subbands[f];
+
+    const double dtheta = 2*pi/((float)_ntheta - 1); // step length for theta integration
+    const double ki_sqr = ki*ki;
+
+    // Find energy-conserving final wave-vector
+    // This should be positive if the kimin value is correct
+    const double kf_sqr = ki_sqr + 2*_m*(isb.get_E_min() - fsb.get_E_min())/(hBar*hBar);
+
+    if(kf_sqr < 0.0)
+        return 0.0;
+
+    const double kf = sqrt(kf_sqr);
+    const double two_kif = 2*ki*kf;
+    const double ki_sqr_plus_kf_sqr = ki_sqr + kf_sqr;
+
+    // Now perform innermost integral (over theta)
+    arma::vec Wif_integrand_theta(_ntheta);
+
+    for(unsigned int itheta=0;itheta<_ntheta;itheta++)
+    {
+        // Calculate scattering vector
+        // Note that most of the terms here are computed before the loop, so we
+        // only need to look up the cos(theta)
+        const double q_sqr = ki_sqr_plus_kf_sqr + two_kif * _cos_theta[itheta];
+        const double q = sqrt(q_sqr);
+
+        // Find the form-factor at this wave-vector by looking it up in the
+        // spline we created earlier
+        Wif_integrand_theta[itheta] = gsl_spline_eval(FF, q, acc);
+    } /* end theta */
+
+    double Wif = integral(Wif_integrand_theta, dtheta);
+
+    // Multiply by pre-factor
+    Wif *= _m*e*e*e*e / (4*pi*hBar*hBar*hBar*_epsilon*_epsilon);
+
+    // Include final-state blocking factor
+    if (enable_blocking)
+        Wif *= (1 - fsb.get_occupation_at_k(kf));
+
+    return Wif;
+}
+
+/**
+ * \brief Find the total scattering rate at a given initial wave-vector
+ *
+ * \param[in] i  The initial subband index
+ * \param[in] f  The final subband index
+ * \param[in] ki The initial wave vector
+ */
+double ScatteringCalculatorImpurity::get_rate_ki(const unsigned int i,
+                                                 const unsigned int f,
+                                                 const double       ki)
+{
+    gsl_spline       *FF  = make_ff_spline(i,f);
+    gsl_interp_accel *acc = gsl_interp_accel_alloc();
+
+    const auto Wif = calculate_rate_ki(i, f, ki, FF, acc, _enable_blocking);
+
+    gsl_spline_free(FF);
+    gsl_interp_accel_free(acc);
+
+    return Wif;
+}
+
+/**
+ * \brief Returns the entire scattering table for an intersubband transition
+ *
+ * \param[in] i Initial subband index
+ * \param[in] f Final subband index
+ */
+IntersubbandTransition ScatteringCalculatorImpurity::get_transition(const unsigned int i,
+                                                                    const unsigned int f)
+{
+    return make_transition(i, f, _enable_blocking);
+}
+
+/**
+ * \brief Make the entire scattering table for an intersubband transition
+ *
+ * \param[in] i               Initial subband index
+ * \param[in] f               Final subband index
+ * \param[in] enable_blocking Include final-state blocking
+ */
+IntersubbandTransition ScatteringCalculatorImpurity::make_transition(const unsigned int i,
+                                                                     const unsigned int f,
+                                                                     const bool         enable_blocking)
+{
+    // Get the minimum and cut-off initial wave-vectors for the transition
+    const auto kimin = get_ki_min(i, f);
+    const auto kimax = get_ki_cutoff(i, f);
+    const auto dki   = (kimax-kimin)/((float)_nki - 1); // step length for loop over ki
+
+    gsl_spline       *FF  = make_ff_spline(i,f);
+    gsl_interp_accel *acc = gsl_interp_accel_alloc(); // Creates accelerator for interpolation of FF
+
+    arma::vec ki(_nki);  // Initial wave vectors [1/m]
+    arma::vec Wif(_nki); // Scattering rate at each wave-vector [1/s]
+
+    for(unsigned int iki = 0; iki < _nki; ++iki)
+    {
+        ki[iki]  = kimin + dki * iki;
+        Wif[iki] = calculate_rate_ki(i, f, ki[iki], FF, acc, enable_blocking);
+    }
+
+    gsl_spline_free(FF);
+    gsl_interp_accel_free(acc);
+
+    return IntersubbandTransition(_subbands[i], _subbands[f], ki, Wif);
+}
+
+/**
+ * \brief Returns the scattering table for a transition, without final-state blocking
+ *
+ * \param[in] i Initial subband index
+ * \param[in] f Final subband index
+ *
+ * \details The rates in the table do not depend on the carrier distributions, so
+ *          averages and blocking for any distribution can be found from it
+ *          afterwards, through the IntersubbandTransition functions.
+ */
+IntersubbandTransition ScatteringCalculatorImpurity::get_kernel(const unsigned int i,
+                                                                const unsigned int f)
+{
+    return make_transition(i, f, false);
+}
+
+/**
+ * \brief Find the average scattering rate for a transition using adaptive quadrature
+ *
+ * \param[in] i       Initial subband index
+ * \param[in] f       Final subband index
+ * \param[in] rel_tol Relative tolerance of the average
+ *
+ * \details The rate is found at whichever wave-vectors the integrator needs,
+ *          rather than at the fixed table of get_transition.
+ */
+double ScatteringCalculatorImpurity::get_average_rate(const unsigned int i,
+                                                      const unsigned int f,
+                                                      const double       rel_tol)
+{
+    gsl_spline       *FF  = make_ff_spline(i,f);
+    gsl_interp_accel *acc = gsl_interp_accel_alloc();
+
+    double Wbar = 0.0;
+
+    try
+    {
+        Wbar = find_average_rate_adaptive(_subbands[i], get_ki_min(i,f), get_ki_cutoff(i,f),
+                                          [&](const double ki) {
+                                              return calculate_rate_ki(i, f, ki, FF, acc,
+                                                                       _enable_blocking);
+                                          },
+                                          rel_tol);
+    }
+    catch(...)
+    {
+        gsl_spline_free(FF);
+        gsl_interp_accel_free(acc);
+        throw;
+    }
+
+    gsl_spline_free(FF);
+    gsl_interp_accel_free(acc);
+
+    return Wbar;
+}
+
+arma::vec ScatteringCalculatorImpurity::get_ff_table(const unsigned int i,
+                                                     const unsigned int f) const
+{
+    return ff_table.at(std::make_pair(i,f));
+}
+
+arma::vec ScatteringCalculatorImpurity::get_q_table(const unsigned int i,
+                                                    const unsigned int f) const
+{
+    return _q_table.at(std::make_pair(i,f));
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,141 @@
+/**
+ * \file   scattering-calculator-impurity.h
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Calculator for scattering rates for carrier-ionised impurity interactions
+ */
+
+#ifndef QWWAD_SCATTERING_CALCULATOR_IMPURITY
+#define QWWAD_SCATTERING_CALCULATOR_IMPURITY
+
+#include <map>
+#include <utility>
+#include <vector>
+#include <gsl/gsl_spline.h>
+#include "subband.h"
+#include "intersubband-transition.h"
+
+namespace QWWAD {
+/**
+ * \brief A calculator for ionised-impurity scattering rates
+ *
+ * \details The form factor for a transition is
+ *          \f[
+ *            J_{if}(q) = \int I_{if}^2(q,z') d(z')\,\mathrm{d}z',
+ *          \f]
+ *          where \f$d(z')\f$ is the doping profile.  The costly part of this is the
+ *          table of \f$I_{if}^2(q,z')\f$, which does not depend on the doping.  It is
+ *          computed the first time that a transition is needed and kept, so that the
+ *          doping profile or screening can be changed without finding it again.
+ */
+class ScatteringCalculatorImpurity {
+public:
+    /// Initial and final subband indices for a transition
+    typedef std::pair<unsigned int, unsigned int> map_key;
+
+private:
+    std::vector<Subband> _subbands; ///< The energy subbands in the system
+
+    // Physical properties
+    arma::vec _d;       ///< Volume doping at each point in the mesh [m^{-3}]
+    double    _epsilon; ///< Low-frequency dielectric constant [F/m]
+    double    _m;       ///< Effective mass [kg]
+    double    _T;       ///< Temperature of carrier distribution [K]
+
+    bool   _enable_screening; ///< Allow screening
+    bool   _enable_blocking;  ///< Allow final-state blocking
+    bool   _Ecutoff_set;      ///< True if the user has set a cut-off energy
+    double _Ecutoff;          ///< User-specified cut-off kinetic energy [J]
+
+    // Precision parameters
+    size_t _nki;    ///< Number of initial wave-vector samples
+    size_t _nq;     ///< Number of scattering-vector samples in form-factor tables
+    size_t _ntheta; ///< Number of samples in scattering angle integration
+
+    // Derived properties
+    arma::vec _d_weighted; ///< Doping multiplied by quadrature weights [m^{-2}]
+    arma::vec _cos_theta;  ///< Cosine of each scattering angle sample
+
+    /// Scattering-vector samples for each transition [1/m]
+    std::map<map_key, arma::vec> _q_table;
+
+    /// Table of \f$I_{if}^2(q,z')\f$ for each transition.  Each column is one q sample.
+    std::map<map_key, arma::mat> _Iif_sqr_table;
+
+    /**
+     * \brief Table of form factors
+     *
+     * \details The key refers to the initial and final subband indices
+     *          The map contains a table of \f$J_{if}(q)/\epsilon^2(q)\f$
+     */
+    std::map<map_key, arma::vec> ff_table;
+
+    void make_Iif_sqr_table(const unsigned int i,
+                            const unsigned int f);
+
+    void set_cos_theta();
+
+    double calculate_rate_ki(const unsigned int  i,
+                             const unsigned int  f,
+                             const double        ki,
+                             gsl_spline         *FF,
+                             gsl_interp_accel   *acc,
+                             const bool          enable_blocking) const;
+
+    IntersubbandTransition make_transition(const unsigned int i,
+                                           const unsigned int f,
+                                           const bool         enable_blocking);
+
+    gsl_spline * make_ff_spline(const unsigned int i,
+                                const unsigned int f);
+
+public:
+    ScatteringCalculatorImpurity(decltype(_subbands) subbands,
+                                 decltype(_d)        d,
+                                 decltype(_epsilon)  epsilon,
+                                 decltype(_m)        m,
+                                 decltype(_T)        T);
+
+    void set_doping(const decltype(_d) &d);
+
+    void enable_screening(const bool enabled);
+    inline void enable_blocking (const bool enabled) {_enable_blocking  = enabled;}
+
+    void set_Ecutoff(const decltype(_Ecutoff) Ecutoff);
+
+    inline void set_ki_samples(const decltype(_nki) nki) {_nki = nki;}
+    void set_q_samples    (const decltype(_nq)     nq);
+    void set_theta_samples(const decltype(_ntheta) ntheta);
+
+    double get_ki_min(const unsigned int isb,
+                      const unsigned int fsb) const;
+
+    double get_ki_cutoff(const unsigned int isb,
+                         const unsigned int fsb) const;
+
+    double get_rate_ki(const unsigned int isb,
+                       const unsigned int fsb,
+                       const double       ki);
+
+    IntersubbandTransition get_transition(const unsigned int isb,
+                                          const unsigned int fsb);
+
+    IntersubbandTransition get_kernel(const unsigned int isb,
+                                      const unsigned int fsb);
+
+    double get_average_rate(const unsigned int isb,
+                            const unsigned int fsb,
+                            const double       rel_tol);
+
+    void make_ff_table(const unsigned int i,
+                       const unsigned int f);
+
+    double Jif(const double       q,
+               const unsigned int i,
+               const unsigned int f) const;
+
+    arma::vec get_ff_table(const unsigned int i, const unsigned int f) const;
+    arma::vec get_q_table (const unsigned int i, const unsigned int f) const;
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,464 @@
+/**
+ * \file   schroedinger-poisson-solver.cpp
+ * \brief  Self-consistent solver for the Schroedinger and Poisson equations
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include "schroedinger-poisson-solver.h"
+#include "checkpoint.h"
+#include "constants.h"
+#include "fermi.h"
+#include "maths-helpers.h"
+#include "schroedinger-solver-tridiagonal.h"
+
+namespace QWWAD
+{
+using namespace constants;
+
+/**
+ * \brief Initialise a self-consistent calculation
+ *
+ * \param[in] z       Spatial locations [m]
+ * \param[in] m       Band-edge effective mass profile [kg]
+ * \param[in] V_base  Band-edge potential profile, without space charge [J]
+ * \param[in] eps     Low-frequency permittivity profile [F/m]
+ * \param[in] d       Volume doping profile [m^{-3}]
+ * \param[in] nst_max Maximum number of states to find (0 = all states in the potential)
+ *
+ * \details The system is unbiased, with zero field at each end, until set_field()
+ *          is called.
+ */
+SchroedingerPoissonSolver::SchroedingerPoissonSolver(const decltype(_z)      &z,
+                                                     const decltype(_m)      &m,
+                                                     const decltype(_V_base) &V_base,
+                                                     const decltype(_eps)    &eps,
+                                                     const decltype(_d)      &d,
+                                                     const decltype(_nst_max) nst_max) :
+    _z(z),
+    _m(m),
+    _V_base(V_base),
+    _eps(eps),
+    _d(d),
+    _poisson(eps, z, ZERO_FIELD),
+    _biased(false),
+    _V_drop(0.0),
+    _nst_max(nst_max),
+    _Te(100.0),
+    _m_d(0.067*me),
+    _pop_fixed(false),
+    _predictor_corrector(false),
+    _max_newton_iter(50),
+    _tol(1e-6*e),
+    _max_iter(100),
+    _mixing_depth(5),
+    _mixing_factor(0.3),
+    _n_iter(0),
+    _resume(false),
+    _dV_best(0.0),
+    _V_in(V_base),
+    _V(V_base),
+    _phi(arma::zeros(z.size())),
+    _checkpoint_interval(0)
+{
+    const auto nz = _z.size();
+
+    if(_m.size() != nz || _V_base.size() != nz || _eps.size() != nz || _d.size() != nz)
+    {
+        std::ostringstream oss;
+        oss << "Profiles have different lengths.  Got " << nz << " spatial points, "
+            << _m.size() << " masses, " << _V_base.size() << " potentials, "
+            << _eps.size() << " permittivities and " << _d.size() << " doping samples.";
+        throw std::length_error(oss.str());
+    }
+}
+
+/**
+ * \brief Apply an electric field across the structure
+ *
+ * \param[in] field Electric field [V/m]
+ *
+ * \details The potential is pinned at each end of the structure, so that the
+ *          total potential drop is fixed.  The Poisson matrix for these boundary
+ *          conditions does not depend on the field, so it is only factorised the
+ *          first time, and a bias sweep can change the field at no extra cost.
+ */
+void SchroedingerPoissonSolver::set_field(const double field)
+{
+    const auto nz = _z.size();
+    const auto dz = _z[1] - _z[0];
+    const auto length = (_z[nz-1] - _z[0]) + 0.5*(dz + _z[nz-1] - _z[nz-2]); // Total length of structure [m]
+
+    _V_drop = field * e * length;
+
+    if(!_biased)
+    {
+        _poisson = PoissonSolver(_eps, _z, DIRICHLET);
+        _biased  = true;
+    }
+}
+
+/**
+ * \brief Set the potential from which the next solution starts
+ *
+ * \param[in] V Total potential profile [J]
+ *
+ * \details By default, each solution starts from the last one.  The states from
+ *          the last solution are still used as the starting point for the
+ *          eigenvalue search, so a good estimate of the potential (e.g., one
+ *          extrapolated from neighbouring bias points) leaves only a few
+ *          iterations to do.
+ */
+void SchroedingerPoissonSolver::set_initial_potential(const arma::vec &V)
+{
+    if(V.size() != _z.size())
+    {
+        std::ostringstream oss;
+        oss << "Initial potential has " << V.size() << " points, but the structure has " << _z.size() << ".";
+        throw std::length_error(oss.str());
+    }
+
+    _V = V;
+}
+
+/**
+ * \brief Fix the population of each subband, instead of using a thermal distribution
+ *
+ * \param[in] pop Population of each subband [m^{-2}].  The number of states found
+ *                is limited to the number of populations.
+ */
+void SchroedingerPoissonSolver::set_populations(const decltype(_pop) &pop)
+{
+    if(pop.empty())
+        throw std::length_error("At least one subband population is needed.");
+
+    _pop       = pop;
+    _pop_fixed = true;
+    _nst_max   = pop.size();
+}
+
+/**
+ * \brief Use a single thermal distribution of carriers across all subbands
+ *
+ * \param[in] Te  Carrier temperature [K]
+ * \param[in] m_d In-plane density-of-states effective mass [kg]
+ */
+void SchroedingerPoissonSolver::set_thermal_distribution(const decltype(_Te)  Te,
+                                                         const decltype(_m_d) m_d)
+{
+    _Te        = Te;
+    _m_d       = m_d;
+    _pop_fixed = false;
+}
+
+/**
+ * \brief Set the parameters for Anderson mixing of the potential
+ *
+ * \param[in] depth  Number of previous iterations to use (0 = linear mixing)
+ * \param[in] factor Mixing factor for the residual (0 < factor <= 1)
+ */
+void SchroedingerPoissonSolver::set_mixing(const decltype(_mixing_depth)  depth,
+                                           const decltype(_mixing_factor) factor)
+{
+    if(factor <= 0.0 || factor > 1.0)
+    {
+        std::ostringstream oss;
+        oss << "Mixing factor must lie in the range (0,1].  Got " << factor;
+        throw std::domain_error(oss.str());
+    }
+
+    _mixing_depth  = depth;
+    _mixing_factor = factor;
+}
+
+/**
+ * \brief Find the population and quasi-Fermi energy of each subband for the current states
+ *
+ * \details For a thermal distribution, the total sheet density equals the sheet
+ *          doping, so the structure is neutral overall.
+ */
+void SchroedingerPoissonSolver::find_populations()
+{
+    const auto nst = _states.size();
+
+    if(_pop_fixed)
+    {
+        if(nst != _pop.size())
+        {
+            std::ostringstream oss;
+            oss << "Found " << nst << " states, but " << _pop.size() << " populations were given.";
+            throw std::runtime_error(oss.str());
+        }
+
+        _Ef.set_size(nst);
+
+        for(unsigned int ist = 0; ist < nst; ++ist)
+            _Ef[ist] = find_fermi(_states[ist].get_energy(), _m_d, _pop[ist], _Te);
+
+        return;
+    }
+
+    const double n2D = integral(_d, _z); // Sheet doping [m^{-2}]
+
+    arma::vec E(nst);
+
+    for(unsigned int ist = 0; ist < nst; ++ist)
+        E[ist] = _states[ist].get_energy();
+
+    const double Ef = find_fermi_global(E, _m_d, n2D, _Te);
+
+    _pop.set_size(nst);
+    _Ef.set_size(nst);
+
+    for(unsigned int ist = 0; ist < nst; ++ist)
+    {
+        _pop[ist] = find_pop(E[ist], Ef, _m_d, _Te);
+        _Ef[ist]  = Ef;
+    }
+}
+
+/**
+ * \brief Find the carrier density profile for the current states [m^{-3}]
+ */
+arma::vec SchroedingerPoissonSolver::get_carrier_density() const
+{
+    return Eigenstate::get_carrier_density(_states, _pop);
+}
+
+/**
+ * \brief Carry out a single Schroedinger-Poisson iteration
+ *
+ * \param[in] V_in Input potential profile [J]
+ *
+ * \returns The potential profile due to the charge in the input potential [J]
+ */
+arma::vec SchroedingerPoissonSolver::find_potential(const arma::vec &V_in)
+{
+    SchroedingerSolverTridiag se(_m, V_in, _z, _nst_max);
+
+    // The states barely change between iterations, so it is much quicker
+    // to refine the previous set than to search from scratch
+    if(!_states.empty())
+        se.set_initial_guess(_states);
+
+    _states = se.get_solutions();
+
+    if(_states.empty())
+        throw std::runtime_error("No states found in Schroedinger-Poisson iteration.");
+
+    find_populations();
+
+    if(_predictor_corrector)
+        return predict_potential(V_in);
+
+    // Charge density [QWWAD4, 3.108], rescaled to give potential in J
+    const arma::vec rho = e*e*(_d - get_carrier_density());
+
+    if(_V_drop != 0.0)
+        _phi = -_poisson.solve(rho, _V_drop);
+    else
+        _phi = -_poisson.solve(rho);
+
+    return _V_base + _phi;
+}
+
+/**
+ * \brief Find the potential from the nonlinear Poisson equation for the current states
+ *
+ * \param[in] V_in Potential profile in which the current states were found [J]
+ *
+ * \returns The predicted self-consistent potential profile [J]
+ *
+ * \details The energy of each state is shifted at each point by the change in
+ *          potential, \f$\delta V(z) = V(z) - V_{in}(z)\f$, so the carrier density is
+ *          \f[
+ *            n(z) = \sum_i |\psi_i(z)|^2 N_i\left[E_i + \delta V(z)\right],
+ *          \f]
+ *          where \f$N_i(E)\f$ is the population of a subband with minimum \f$E\f$ and
+ *          the quasi-Fermi energy of subband i.  Each Newton step solves the Poisson
+ *          equation with this density linearised about the current potential.
+ */
+arma::vec SchroedingerPoissonSolver::predict_potential(const arma::vec &V_in)
+{
+    const auto   nz    = _z.size();
+    const double rho_p = _m_d/(pi*hBar*hBar); // 2D density of states [J^{-1}m^{-2}]
+
+    // Space-charge potential, with the sign used by PoissonSolver [J]
+    arma::vec u = _V_base - V_in;
+
+    for(unsigned int iter = 0; iter < _max_newton_iter; ++iter)
+    {
+        const arma::vec dV = _V_base - u - V_in;
+
+        arma::vec n     = arma::zeros(nz); // Carrier density [m^{-3}]
+        arma::vec dn_du = arma::zeros(nz); // Derivative of carrier density [m^{-3}/J]
+
+        for(unsigned int ist = 0; ist < _states.size(); ++ist)
+        {
+            const auto  &PD = _states[ist].get_PD();
+            const double E  = _states[ist].get_energy();
+
+            for(unsigned int iz = 0; iz < nz; ++iz)
+            {
+                n[iz]     += PD[iz] * find_pop(E + dV[iz], _Ef[ist], _m_d, _Te);
+                dn_du[iz] += PD[iz] * rho_p * f_FD(_Ef[ist], E + dV[iz], _Te);
+            }
+        }
+
+        // Charge density and its derivative, rescaled to give potential in J
+        const arma::vec rho      =  e*e*(_d - n);
+        const arma::vec drho_du  = -e*e*dn_du;
+
+        const arma::vec u_new = _poisson.solve_linearised(rho - drho_du % u, drho_du, _V_drop);
+        const double    du    = arma::abs(u_new - u).max();
+        u = u_new;
+
+        if(du <= 0.1*_tol)
+            break;
+    }
+
+    _phi = -u;
+
+    return _V_base + _phi;
+}
+
+/**
+ * \brief Save the state of the iteration at regular intervals
+ *
+ * \param[in] interval Number of iterations between checkpoints (0 = none)
+ * \param[in] callback Function that writes a checkpoint, e.g., using append_state()
+ */
+void SchroedingerPoissonSolver::set_checkpoint_callback(const size_t                 interval,
+                                                        const std::function<void()> &callback)
+{
+    _checkpoint_interval = interval;
+    _checkpoint_callback = callback;
+}
+
+/**
+ * \brief Append the state of the current iteration to a checkpoint buffer
+ *
+ * \param[in,out] buffer The buffer
+ *
+ * \details The number of iterations so far, the best iterate, the input
+ *          potential for the next iteration, the space-charge potential, the
+ *          populations and quasi-Fermi energies, and the mixing history are
+ *          stored.  The next input potential and the mixing history always
+ *          belong to the same iteration.  The eigenstates are not stored,
+ *          since they can be found again from the potential.
+ */
+void SchroedingerPoissonSolver::append_state(std::string &buffer) const
+{
+    append_checkpoint_value<uint64_t>(buffer, _n_iter);
+    append_checkpoint_value<double>(buffer, _dV_best);
+    append_checkpoint_table(buffer, _V_best.memptr(), _V_best.size());
+    append_checkpoint_table(buffer, _V_in.memptr(),   _V_in.size());
+    append_checkpoint_table(buffer, _phi.memptr(),    _phi.size());
+    append_checkpoint_table(buffer, _pop.memptr(),    _pop.size());
+    append_checkpoint_table(buffer, _Ef.memptr(),     _Ef.size());
+    _mixer.append_state(buffer);
+}
+
+/**
+ * \brief Restore the state of an iteration from a checkpoint
+ *
+ * \param[in,out] stream The checkpoint, positioned at the data written by
+ *                       append_state()
+ *
+ * \details The next call to solve() carries on from the next input potential
+ *          in the checkpoint, rather than starting a new iteration.  The structure and
+ *          the solver settings must be the same as when the checkpoint was
+ *          written.
+ */
+void SchroedingerPoissonSolver::read_state(std::istream &stream)
+{
+    const auto n_iter  = read_checkpoint_value<uint64_t>(stream);
+    const auto dV_best = read_checkpoint_value<double>(stream);
+    const arma::vec V_best(read_checkpoint_table(stream));
+    const arma::vec V_in(read_checkpoint_table(stream));
+    const arma::vec phi(read_checkpoint_table(stream));
+    const arma::vec pop(read_checkpoint_table(stream));
+    const arma::vec Ef(read_checkpoint_table(stream));
+
+    if(!stream or V_best.size() != _z.size() or V_in.size() != _z.size()
+       or phi.size() != _z.size())
+    {
+        std::ostringstream oss;
+        oss << "Checkpoint does not hold a Schroedinger-Poisson iteration for a structure with "
+            << _z.size() << " points.";
+        throw std::runtime_error(oss.str());
+    }
+
+    _mixer = AndersonMixer(_mixing_depth, _mixing_factor);
+    _mixer.read_state(stream);
+
+    _n_iter  = n_iter;
+    _dV_best = dV_best;
+    _V_best  = V_best;
+    _V_in    = V_in;
+    _V       = V_in;
+    _phi     = phi;
+    _Ef      = Ef;
+    _resume  = true;
+
+    if(!_pop_fixed)
+        _pop = pop;
+}
+
+/**
+ * \brief Iterate the potential to self-consistency
+ *
+ * \details After convergence, the potential and states are consistent to within
+ *          the tolerance.
+ */
+void SchroedingerPoissonSolver::solve()
+{
+    // Start a new iteration, unless carrying on from a checkpoint
+    if(!_resume)
+    {
+        _mixer   = AndersonMixer(_mixing_depth, _mixing_factor);
+        _n_iter  = 0;
+        _dV_best = std::numeric_limits<double>::infinity();
+        _V_best  = _V;
+        _V_in    = _V;
+    }
+
+    _resume = false;
+
+    for(++_n_iter; _n_iter <= _max_iter; ++_n_iter)
+    {
+        const arma::vec V_out = find_potential(_V_in);
+        const double    dV    = arma::abs(V_out - _V_in).max();
+
+        if(dV <= _tol)
+        {
+            _V = V_out;
+            return;
+        }
+
+        if(dV < _dV_best)
+        {
+            _dV_best = dV;
+            _V_best  = _V_in;
+        }
+
+        // The predictor step already damps the charge response, so its output
+        // is used directly
+        if(_predictor_corrector)
+            _V_in = V_out;
+        else
+            _V_in = _mixer.mix(_V_in, V_out);
+
+        if(_checkpoint_interval > 0 and _n_iter % _checkpoint_interval == 0 and _checkpoint_callback)
+            _checkpoint_callback();
+    }
+
+    std::ostringstream oss;
+    oss << "Schroedinger-Poisson iteration did not converge within " << _max_iter << " iterations.";
+    throw std::runtime_error(oss.str());
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
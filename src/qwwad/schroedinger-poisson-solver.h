@@ -0,0 +1,148 @@
+/**
+ * \file   schroedinger-poisson-solver.h
+ * \brief  Self-consistent solver for the Schroedinger and Poisson equations
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_SCHROEDINGER_POISSON_SOLVER_H
+#define QWWAD_SCHROEDINGER_POISSON_SOLVER_H
+
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+#include <armadillo>
+#include "anderson-mixer.h"
+#include "eigenstate.h"
+#include "poisson-solver.h"
+
+namespace QWWAD
+{
+/**
+ * \brief Self-consistent solution of the Schroedinger and Poisson equations
+ *        for electrons in a doped heterostructure
+ *
+ * \details At each iteration, the states in the current potential are found using
+ *          the tridiagonal (parabolic) Schroedinger solver, starting from the states
+ *          at the previous iteration.  The carrier density and space-charge potential
+ *          follow from these [QWWAD4, 3.108], and the next input potential is found
+ *          by Anderson mixing of the input and output potentials.  The Poisson matrix
+ *          is factorised once, and kept for every iteration.
+ *
+ *          By default, the subband populations follow a single Fermi-Dirac
+ *          distribution that contains all the carriers from the doping.  The
+ *          populations can be fixed instead, using set_populations().
+ *
+ *          Alternatively, the predictor-corrector scheme of Trellakis et al.,
+ *          J. Appl. Phys. 81, 7880 (1997) can be used.  The wavefunctions are
+ *          held fixed, and the energy of each state is shifted locally by the
+ *          change in potential, so that the carrier density responds to the
+ *          potential through the Fermi factors.  The resulting nonlinear Poisson
+ *          equation is solved by Newton iteration, and its solution is used
+ *          directly as the next input potential.  This damps the charge
+ *          oscillations of plain mixing and needs far fewer iterations.
+ *
+ *          Each call to solve() starts from the potential and states of the last
+ *          solution, so a sequence of closely-related problems, such as the points
+ *          of a bias sweep, needs only a few iterations at each point.
+ *
+ *          The state of the iteration can be saved at regular intervals, using
+ *          set_checkpoint_callback() and append_state().  After read_state(), the
+ *          next call to solve() carries on from the input potential that the
+ *          checkpointed iteration would have used next, with the mixing history
+ *          that produced it.
+ */
+class SchroedingerPoissonSolver
+{
+private:
+    arma::vec _z;      ///< Spatial locations [m]
+    arma::vec _m;      ///< Band-edge effective mass profile [kg]
+    arma::vec _V_base; ///< Band-edge potential profile [J]
+    arma::vec _eps;    ///< Low-frequency permittivity profile [F/m]
+    arma::vec _d;      ///< Volume doping profile [m^{-3}]
+
+    PoissonSolver _poisson; ///< Poisson solver, with its factorised matrix
+    bool          _biased;  ///< True if the potential is pinned at each end
+    double        _V_drop;  ///< Potential drop across the structure [J]
+
+    unsigned int _nst_max; ///< Maximum number of states to find (0 = all)
+    double       _Te;      ///< Carrier temperature [K]
+    double       _m_d;     ///< In-plane density-of-states effective mass [kg]
+
+    bool      _pop_fixed; ///< True if the subband populations are fixed
+    arma::vec _pop;       ///< Population of each subband [m^{-2}]
+    arma::vec _Ef;        ///< Quasi-Fermi energy of each subband [J]
+
+    bool   _predictor_corrector; ///< True if the predictor-corrector scheme is used
+    size_t _max_newton_iter;     ///< Maximum number of Newton iterations in each predictor step
+
+    double _tol;           ///< Convergence tolerance for the potential [J]
+    size_t _max_iter;      ///< Maximum number of iterations
+    size_t _mixing_depth;  ///< Number of previous iterations used in Anderson mixing
+    double _mixing_factor; ///< Mixing factor for Anderson mixing
+
+    size_t                  _n_iter;  ///< Number of iterations used in the last solution
+    AndersonMixer           _mixer;   ///< Mixer for the input potential
+    bool                    _resume;  ///< True if the next solution carries on from a checkpoint
+    arma::vec               _V_best;  ///< Input potential with the smallest residual so far [J]
+    double                  _dV_best; ///< Smallest residual so far [J]
+    arma::vec               _V_in;    ///< Input potential for the next iteration [J]
+    arma::vec               _V;       ///< Total potential profile [J]
+    arma::vec               _phi;     ///< Space-charge potential profile [J]
+    std::vector<Eigenstate> _states;  ///< Eigenstates in the total potential
+
+    size_t                _checkpoint_interval; ///< Number of iterations between checkpoints
+    std::function<void()> _checkpoint_callback; ///< Function that writes a checkpoint
+
+    void find_populations();
+
+    arma::vec find_potential(const arma::vec &V_in);
+
+    arma::vec predict_potential(const arma::vec &V_in);
+
+public:
+    SchroedingerPoissonSolver(const decltype(_z)      &z,
+                              const decltype(_m)      &m,
+                              const decltype(_V_base) &V_base,
+                              const decltype(_eps)    &eps,
+                              const decltype(_d)      &d,
+                              const decltype(_nst_max) nst_max = 0);
+
+    void set_field(const double field);
+
+    void set_initial_potential(const arma::vec &V);
+
+    void set_populations(const decltype(_pop) &pop);
+
+    void set_thermal_distribution(const decltype(_Te)  Te,
+                                  const decltype(_m_d) m_d);
+
+    inline void set_tolerance     (const decltype(_tol)      tol)      {_tol      = tol;}
+    inline void set_max_iterations(const decltype(_max_iter) max_iter) {_max_iter = max_iter;}
+
+    void set_mixing(const decltype(_mixing_depth)  depth,
+                    const decltype(_mixing_factor) factor);
+
+    /// Use the predictor-corrector scheme instead of potential mixing
+    inline void enable_predictor_corrector(const bool enabled) {_predictor_corrector = enabled;}
+
+    void set_checkpoint_callback(const size_t                 interval,
+                                 const std::function<void()> &callback);
+
+    void append_state(std::string &buffer) const;
+    void read_state(std::istream &stream);
+
+    void solve();
+
+    arma::vec get_carrier_density() const;
+
+    inline decltype(_n_iter) get_iterations()     const {return _n_iter;}
+    inline decltype(_V)      get_V()              const {return _V;}
+    inline decltype(_phi)    get_phi()            const {return _phi;}
+    inline decltype(_pop)    get_populations()    const {return _pop;}
+    inline decltype(_Ef)     get_fermi_energies() const {return _Ef;}
+    inline decltype(_states) get_states()         const {return _states;}
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
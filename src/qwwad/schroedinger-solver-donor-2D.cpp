@@ -39,9 +39,11 @@ SchroedingerSolverDonor2D::SchroedingerSolverDonor2D(const double        m,
  *            I_1 = 2\pi\frac{\lambda^2}{4}
  *          \f]
  */
-double SchroedingerSolverDonor2D::I_1(const double /* z_dash */) const
+double SchroedingerSolverDonor2D::I_1(const double /* z_dash */,
+                                      const double lambda,
+                                      const double /* zeta */) const
 {
-    return 2*pi*gsl_pow_2(_lambda)/4;
+    return 2*pi*gsl_pow_2(lambda)/4;
 }
 
 /**
@@ -51,7 +53,9 @@ double SchroedingerSolverDonor2D::I_1(const double /* z_dash */) const
  *
  * \details See Eq. 5.42, QWWAD3. The integral evaluates to zero
  */
-double SchroedingerSolverDonor2D::I_2(const double /* z_dash */) const
+double SchroedingerSolverDonor2D::I_2(const double /* z_dash */,
+                                      const double /* lambda */,
+                                      const double /* zeta */) const
 {
     return 0;
 }
@@ -66,7 +70,9 @@ double SchroedingerSolverDonor2D::I_2(const double /* z_dash */) const
  *            I_3 = 2\pi \left(-\frac{1}{4}\right)
  *          \f]
  */
-double SchroedingerSolverDonor2D::I_3(const double /* z_dash */) const
+double SchroedingerSolverDonor2D::I_3(const double /* z_dash */,
+                                      const double /* lambda */,
+                                      const double /* zeta */) const
 {
     return 2*pi*(-0.25);
 }
@@ -94,6 +100,7 @@ double I_4_integrand(double w, void *params)
  * \brief Computes the binding energy integral \f$I_4\f$ for a 2D trial wavefunction
  *
  * \param[in] z_dash displacement between electron and donor in z-direction [m]
+ * \param[in] lambda Bohr radius [m]
  *
  * \returns Binding energy integral [m]
  *
@@ -102,14 +109,16 @@ double I_4_integrand(double w, void *params)
  *              I_4=2\pi\int_0^1 \exp{\left[-\frac{\vert z^\prime\vert\left(\frac{1}{w}-w\right) }{\lambda}\right]}\;\;\vert z^\prime\vert \frac{1-w^2}{2w^2}\;\;\text{d}w
  *          \f]
  */
-double SchroedingerSolverDonor2D::I_4(const double z_dash) const
+double SchroedingerSolverDonor2D::I_4(const double z_dash,
+                                      const double lambda,
+                                      const double /* zeta */) const
 {
     const double z_dash_abs = fabs(z_dash); // Magnitude of displacement [m]
 
     // Set up function to be integrated [QWWAD3, 5.59]
     gsl_function f;
     f.function = &I_4_integrand;
-    I_4_integrand_params p = {z_dash_abs, _lambda};
+    I_4_integrand_params p = {z_dash_abs, lambda};
     f.params   = &p;
 
     // Configure integration algorithm
@@ -25,6 +25,7 @@ public:
                               const double        dE);
 
     std::string get_name() {return "donor-2D";}
+    SchroedingerSolverDonor * clone() const {return new SchroedingerSolverDonor2D(*this);}
 
 private:
     void calculate_psi_from_chi(){
@@ -33,10 +34,10 @@ private:
         for (unsigned int ist = 0; ist < _solutions_chi.size(); ++ist)
             _solutions.push_back(_solutions_chi[ist]);
     }
-    double I_1(const double z_dash) const;
-    double I_2(const double z_dash) const;
-    double I_3(const double z_dash) const;
-    double I_4(const double z_dash) const;
+    double I_1(const double z_dash, const double lambda, const double zeta) const;
+    double I_2(const double z_dash, const double lambda, const double zeta) const;
+    double I_3(const double z_dash, const double lambda, const double zeta) const;
+    double I_4(const double z_dash, const double lambda, const double zeta) const;
 };
 } // namespace QWWAD
 #endif
@@ -47,9 +47,11 @@ SchroedingerSolverDonor3D::SchroedingerSolverDonor3D(const double        m,
  *             e^{-\frac{2\vert z^{\prime}\vert}{\lambda}}\label{I13D2}
  *          \f]
  */
-double SchroedingerSolverDonor3D::I_1(const double z_dash) const
+double SchroedingerSolverDonor3D::I_1(const double z_dash,
+                                      const double lambda,
+                                      const double /* zeta */) const
 {
-    return 2*pi*(fabs(z_dash)*_lambda/2 + _lambda*_lambda/4) * exp(-2*fabs(z_dash)/_lambda);
+    return 2*pi*(fabs(z_dash)*lambda/2 + lambda*lambda/4) * exp(-2*fabs(z_dash)/lambda);
 }
 
 /**
@@ -63,9 +65,11 @@ double SchroedingerSolverDonor3D::I_1(const double z_dash) const
  *             {\lambda}}\right)
  *          \f]
  */
-double SchroedingerSolverDonor3D::I_2(const double z_dash) const
+double SchroedingerSolverDonor3D::I_2(const double z_dash,
+                                      const double lambda,
+                                      const double /* zeta */) const
 {
-    return 2*pi*(-z_dash/2)*exp(-2*fabs(z_dash)/_lambda);
+    return 2*pi*(-z_dash/2)*exp(-2*fabs(z_dash)/lambda);
 }
 
 /**
@@ -79,15 +83,18 @@ double SchroedingerSolverDonor3D::I_2(const double z_dash) const
  *            \mbox{e}^{-\frac{2\vert z^\prime\vert}{\lambda}}\label{I33D3}
  *          \f]
  */
-double SchroedingerSolverDonor3D::I_3(const double z_dash) const
+double SchroedingerSolverDonor3D::I_3(const double z_dash,
+                                      const double lambda,
+                                      const double /* zeta */) const
 {
-    return 2*pi*(fabs(z_dash)/(2*_lambda)-0.75)*exp(-2*fabs(z_dash)/_lambda);
+    return 2*pi*(fabs(z_dash)/(2*lambda)-0.75)*exp(-2*fabs(z_dash)/lambda);
 }
 
 /**
  * \brief Computes the binding energy integral \f$I_4\f$ for a 3D trial wavefunction
  *
  * \param[in] z_dash displacement between electron and donor in z-direction [m]
+ * \param[in] lambda Bohr radius [m]
  *
  * \returns Binding energy integral [m]
  *
@@ -96,9 +103,11 @@ double SchroedingerSolverDonor3D::I_3(const double z_dash) const
  *             I_4=2\pi\left(\frac{\lambda}{2}\mbox{e}^{-\frac{2\vert z^\prime\vert}{\lambda}}
  *          \f]
  */
-double SchroedingerSolverDonor3D::I_4(const double z_dash) const
+double SchroedingerSolverDonor3D::I_4(const double z_dash,
+                                      const double lambda,
+                                      const double /* zeta */) const
 {
-    return 2*pi*(_lambda/2)*exp(-2*fabs(z_dash)/_lambda);
+    return 2*pi*(lambda/2)*exp(-2*fabs(z_dash)/lambda);
 }
 } // namespace
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -9,6 +9,7 @@
 #define QWWAD_SCHROEDINGER_SOLVER_DONOR_3D_H
 
 #include "schroedinger-solver-donor.h"
+#include <cmath>
 #include <iostream>
 namespace QWWAD
 {
@@ -27,28 +28,32 @@ public:
                               const double        dE);
 
     std::string get_name() {return "donor-3D";}
+    SchroedingerSolverDonor * clone() const {return new SchroedingerSolverDonor3D(*this);}
 
 private:
     void calculate_psi_from_chi()
     {
         _solutions.clear();
 
-        for (auto ist : _solutions_chi)
-        {
-            const auto E   = ist.get_energy();
-            const auto chi = ist.get_wavefunction_samples();
-            const auto psi = exp(-abs(_z - _r_d)/_lambda) * chi;
+        // The envelope for the latest solution is still in the workspace, so the
+        // complete wavefunction is built in place rather than via temporaries
+        const auto &chi = _workspace.chi;
+        auto       &psi = _workspace.psi;
+        psi.set_size(chi.size());
 
-            const auto psi_state = Eigenstate(E,_z,psi);
+        for (const auto &ist : _solutions_chi)
+        {
+            for (unsigned int iz = 0; iz < chi.size(); ++iz)
+                psi[iz] = exp(-fabs(_z[iz] - _r_d)/_lambda) * chi[iz];
 
-            _solutions.push_back(psi_state);
+            _solutions.push_back(Eigenstate(ist.get_energy(),_z_grid,psi));
         }
     }
 
-    double I_1(const double z_dash) const;
-    double I_2(const double z_dash) const;
-    double I_3(const double z_dash) const;
-    double I_4(const double z_dash) const;
+    double I_1(const double z_dash, const double lambda, const double zeta) const;
+    double I_2(const double z_dash, const double lambda, const double zeta) const;
+    double I_3(const double z_dash, const double lambda, const double zeta) const;
+    double I_4(const double z_dash, const double lambda, const double zeta) const;
 };
 } // namespace
 #endif
@@ -38,10 +38,12 @@ SchroedingerSolverDonorVariable::SchroedingerSolverDonorVariable(const double
  *             \mbox{e}^{-\frac{2\zeta\vert z^\prime\vert}{\lambda}}
  *          \f]
  */
-double SchroedingerSolverDonorVariable::I_1(const double z_dash) const
+double SchroedingerSolverDonorVariable::I_1(const double z_dash,
+                                            const double lambda,
+                                            const double zeta) const
 {
-    return 2*pi*(_zeta*fabs(z_dash)*_lambda/2+ _lambda*_lambda/4)*
-           exp(-2*_zeta*fabs(z_dash)/_lambda);
+    return 2*pi*(zeta*fabs(z_dash)*lambda/2+ lambda*lambda/4)*
+           exp(-2*zeta*fabs(z_dash)/lambda);
 }
 
 /**
@@ -55,9 +57,11 @@ double SchroedingerSolverDonorVariable::I_1(const double z_dash) const
  *             \mbox{e}^{-\frac{2\zeta\vert z^\prime\vert}{\lambda}}
  *          \f]
  */
-double SchroedingerSolverDonorVariable::I_2(const double z_dash) const
+double SchroedingerSolverDonorVariable::I_2(const double z_dash,
+                                            const double lambda,
+                                            const double zeta) const
 {
-    return 2*pi*(-_zeta*_zeta*z_dash/2)*exp(-2*_zeta*fabs(z_dash)/_lambda);
+    return 2*pi*(-zeta*zeta*z_dash/2)*exp(-2*zeta*fabs(z_dash)/lambda);
 }
 
 struct integral_params
@@ -90,15 +94,17 @@ double I_34_integrand(double w, void *params)
  *
  * \details See Eq. 5.112, QWWAD3.
  */
-double SchroedingerSolverDonorVariable::I_3(const double z_dash) const
+double SchroedingerSolverDonorVariable::I_3(const double z_dash,
+                                            const double lambda,
+                                            const double zeta) const
 {
     const double z_dash_abs = fabs(z_dash);
 
     /* Eq. 5.113, QWWAD3 */
-    const double I_31=(-1-_zeta*_zeta)/2*exp(-2*_zeta*fabs(z_dash)/_lambda);
-    const double I_32=(_zeta*fabs(z_dash)/(2*_lambda)+0.25)*exp(-2*_zeta*fabs(z_dash)/_lambda);
+    const double I_31=(-1-zeta*zeta)/2*exp(-2*zeta*fabs(z_dash)/lambda);
+    const double I_32=(zeta*fabs(z_dash)/(2*lambda)+0.25)*exp(-2*zeta*fabs(z_dash)/lambda);
 
-    integral_params p = {_lambda, _zeta, z_dash_abs};
+    integral_params p = {lambda, zeta, z_dash_abs};
 
     gsl_function f_33, f_34;
     f_33.function = &I_33_integrand;
@@ -120,8 +126,8 @@ double SchroedingerSolverDonorVariable::I_3(const double z_dash) const
     gsl_integration_qng(&f_33, limit_lo, limit_hi, abserr_max, relerr_max, &I_33, &abserr, &neval);
     gsl_integration_qng(&f_34, limit_lo, limit_hi, abserr_max, relerr_max, &I_34, &abserr, &neval);
 
-    I_33*=2*(gsl_pow_3(_zeta)-_zeta)*fabs(z_dash)/_lambda;
-    I_34*=(gsl_pow_4(_zeta)-gsl_pow_2(_zeta))*gsl_pow_2(z_dash/_lambda);
+    I_33*=2*(gsl_pow_3(zeta)-zeta)*fabs(z_dash)/lambda;
+    I_34*=(gsl_pow_4(zeta)-gsl_pow_2(zeta))*gsl_pow_2(z_dash/lambda);
 
     return 2*pi*(I_31+I_32+I_33+I_34);
 }
@@ -139,6 +145,8 @@ static double I_4_integrand(double w, void *params)
  * \brief Computes the binding energy integral \f$I_4\f$ for a 3D trial wavefunction
  *
  * \param[in] z_dash displacement between electron and donor in z-direction [m]
+ * \param[in] lambda Bohr radius [m]
+ * \param[in] zeta   Symmetry parameter
  *
  * \returns Binding energy integral [m]
  *
@@ -150,10 +158,12 @@ static double I_4_integrand(double w, void *params)
  *             \vert z^\prime\vert \frac{1-w^2}{2w^2}\;\;\text{d}w
  *          \f]
  */
-double SchroedingerSolverDonorVariable::I_4(const double z_dash) const
+double SchroedingerSolverDonorVariable::I_4(const double z_dash,
+                                            const double lambda,
+                                            const double zeta) const
 {
     const double z_dash_abs = fabs(z_dash);
-    integral_params p = {_lambda, _zeta, z_dash_abs};
+    integral_params p = {lambda, zeta, z_dash_abs};
 
     gsl_function f;
     f.function = &I_4_integrand;
@@ -12,6 +12,7 @@
 # include "config.h"
 #endif
 
+#include <cmath>
 #include "schroedinger-solver-donor.h"
 
 namespace QWWAD
@@ -32,8 +33,9 @@ public:
                                     const double        dE);
 
     std::string get_name() {return "donor-variable";}
-    void   set_zeta       (const double zeta) {_zeta = zeta; _solutions.clear(); calculate();}
-    void   set_lambda_zeta(const double lambda, const double zeta) {_lambda = lambda; _zeta = zeta; _solutions.clear(); calculate();}
+    SchroedingerSolverDonor * clone() const {return new SchroedingerSolverDonorVariable(*this);}
+    void   set_zeta       (const double zeta) {if(zeta != _zeta) {_zeta = zeta; _dirty = true;}}
+    void   set_lambda_zeta(const double lambda, const double zeta) {set_lambda(lambda); set_zeta(zeta);}
     double get_zeta() const {return _zeta;}
 
 private:
@@ -41,20 +43,27 @@ private:
     {
         _solutions.clear();
 
+        // The envelope for the latest solution is still in the workspace, so the
+        // complete wavefunction is built in place rather than via temporaries
+        const auto &chi = _workspace.chi;
+        auto       &psi = _workspace.psi;
+        psi.set_size(chi.size());
+
         for (unsigned int ist = 0; ist < _solutions_chi.size(); ++ist)
         {
-            const auto chi = _solutions_chi[0].get_wavefunction_samples();
-            const double E = _solutions_chi[0].get_energy();
+            const double E = _solutions_chi[ist].get_energy();
+
+            for (unsigned int iz = 0; iz < chi.size(); ++iz)
+                psi[iz] = chi[iz]*exp(-_zeta*fabs(_z[iz] - _r_d)/_lambda);
 
-            auto const psi = chi*exp(-_zeta*abs(_z - _r_d)/_lambda);
-            _solutions.push_back(Eigenstate(E,_z,psi));
+            _solutions.push_back(Eigenstate(E,_z_grid,psi));
         }
     }
 
-    double I_1(const double z_dash) const;
-    double I_2(const double z_dash) const;
-    double I_3(const double z_dash) const;
-    double I_4(const double z_dash) const;
+    double I_1(const double z_dash, const double lambda, const double zeta) const;
+    double I_2(const double z_dash, const double lambda, const double zeta) const;
+    double I_3(const double z_dash, const double lambda, const double zeta) const;
+    double I_4(const double z_dash, const double lambda, const double zeta) const;
 
     double _zeta; ///< Symmetry parameter
 };
@@ -7,6 +7,7 @@
 #include "schroedinger-solver-donor.h"
 
 #include <cmath>
+#include <stdexcept>
 #include <gsl/gsl_errno.h>
 #include <gsl/gsl_integration.h>
 #include <gsl/gsl_math.h>
@@ -31,9 +32,64 @@ SchroedingerSolverDonor::SchroedingerSolverDonor(const double        m,
     _r_d(r_d),
     _lambda(lambda),
     _dE(dE),
+    _workspace(),
     _solutions_chi()
 {}
 
+/**
+ * \brief Tabulate the binding energy integrals at each point in the structure
+ *
+ * \param[in]  lambda Bohr radius of the trial wavefunction [m]
+ * \param[in]  zeta   Symmetry parameter of the trial wavefunction
+ * \param[out] ws     Workspace in which to store the tables
+ *
+ * \details The integrals \f$I_1 \ldots I_4\f$ depend on the displacement from the
+ *          donor and on the trial wavefunction, but not on the energy.  They are
+ *          therefore found once here, and every subsequent shot through the
+ *          structure uses the tabulated coefficients.  This matters most for the
+ *          trial wavefunctions whose integrals need numerical quadrature at each point.
+ */
+void SchroedingerSolverDonor::tabulate_integrals(const double  lambda,
+                                                 const double  zeta,
+                                                 Workspace    &ws) const
+{
+    const size_t nz = _z.size();
+
+    ws.alpha.set_size(nz);
+    ws.beta.set_size(nz);
+    ws.gamma.set_size(nz);
+
+    // The quadrature weights only depend on the grid, so they are kept between trials
+    if(ws.weights.size() != nz)
+        ws.weights = integral_weights(nz, _z[1] - _z[0]);
+
+    for(unsigned int iz = 0; iz < nz; ++iz)
+    {
+        const double z_dash = _z[iz] - _r_d;
+
+        ws.alpha[iz] = I_1(z_dash, lambda, zeta);
+        ws.beta[iz]  = 2*I_2(z_dash, lambda, zeta);
+        ws.gamma[iz] = I_3(z_dash, lambda, zeta)
+                       + _me*e*e*I_4(z_dash, lambda, zeta)/(2.0*pi*_eps*hBar*hBar);
+    }
+}
+
+/**
+ * \brief Calculates a wavefunction for the current trial wavefunction
+ *
+ * \param[in]  E       Energy at which to compute wavefunction
+ * \param[out] chi     Array to which wavefunction envelope will be written [m^{-1/2}]
+ *
+ * \returns The wavefunction amplitude at the point immediately to the right of the structure
+ *
+ * \details The binding energy integrals are those from the latest calculation.
+ */
+double SchroedingerSolverDonor::shoot_wavefunction(const double  E,
+                                                   arma::vec    &chi) const
+{
+    return shoot_wavefunction(E, _workspace, chi);
+}
+
 /**
  * \brief Calculates a wavefunction iteratively from left to right of structure
  *
@@ -42,16 +98,22 @@ SchroedingerSolverDonor::SchroedingerSolverDonor(const double        m,
  *          values are computed using QWWAD3, Eq. 5.28.
  *
  * \param[in]  E       Energy at which to compute wavefunction
+ * \param[in]  ws      Workspace holding the binding energy integrals for the trial
+ *                     wavefunction
  * \param[out] chi     Array to which wavefunction envelope will be written [m^{-1/2}]
  *
  * \returns The wavefunction amplitude at the point immediately to the right of the structure
  */
-double SchroedingerSolverDonor::shoot_wavefunction(const double  E,
-                                                   arma::vec    &chi) const
+double SchroedingerSolverDonor::shoot_wavefunction(const double     E,
+                                                   const Workspace &ws,
+                                                   arma::vec       &chi) const
 {
     const size_t nz = _z.size();
     const double dz = _z[1] - _z[0];
 
+    if(ws.alpha.size() != nz)
+        throw std::runtime_error("Binding energy integrals have not been tabulated.");
+
     chi.resize(nz);
 
     // boundary conditions
@@ -68,19 +130,11 @@ double SchroedingerSolverDonor::shoot_wavefunction(const double  E,
         if(iz != 0)
             chi_prev = chi[iz-1];
 
-        const double z_dash = _z[iz] - _r_d;
-
-        const double I1=I_1(z_dash);
-        const double I2=I_2(z_dash);
-        const double I3=I_3(z_dash);
-        const double I4=I_4(z_dash);
-
-        const double alpha = I1;   // Coefficient of second derivative, see notes
-        const double beta  = 2*I2; // Coefficient of first derivative
+        const double alpha = ws.alpha[iz]; // Coefficient of second derivative, see notes
+        const double beta  = ws.beta[iz];  // Coefficient of first derivative
 
         // Coefficient of function
-        const double gamma = I3 + _me*e*e*I4/(2.0*pi*_eps*hBar*hBar)
-                             - 2.0*_me*(_V[iz]-E)*I1/(hBar*hBar);
+        const double gamma = ws.gamma[iz] - 2.0*_me*(_V[iz]-E)*alpha/(hBar*hBar);
 
         chi_next = ((-1.0+beta*dz/(2.0*alpha))*chi_prev
                     +(2.0-dz*dz*gamma/alpha)*chi[iz]
@@ -90,9 +144,12 @@ double SchroedingerSolverDonor::shoot_wavefunction(const double  E,
             chi[iz+1] = chi_next;
     }
 
-    // calculate normalisation integral
-    const arma::vec chi_sqr = square(chi);
-    double Nchi=integral(chi_sqr,dz); // normalisation integral for chi
+    // calculate normalisation integral, without forming a temporary array
+    // for the square of the wavefunction
+    double Nchi = 0.0; // normalisation integral for chi
+
+    for(unsigned int iz = 0; iz < nz; ++iz)
+        Nchi += ws.weights[iz]*chi[iz]*chi[iz];
 
     /* divide unnormalised wavefunction by square root
        of normalisation integral                       */
@@ -104,29 +161,50 @@ double SchroedingerSolverDonor::shoot_wavefunction(const double  E,
 /**
  * \brief Finds the value of the wavefunction at +infinity for a given energy.
  *
- * \details The solution to the energy occurs for chi(+infinity)=0.
+ * \param[in] E      Energy [J]
+ * \param[in] params Pointer to a ShotContext
+ *
+ * \details The solution to the energy occurs for chi(+infinity)=0.  The
+ *          wavefunction is written to the workspace, so nothing is allocated
+ *          for each shot and the solver itself is left untouched.
  *
  * \returns The wavefunction at \f$\chi(\infty)\f$
  */
 double SchroedingerSolverDonor::chi_at_inf (double  E,
                                             void   *params)
 {
-    const SchroedingerSolverDonor *se = reinterpret_cast<SchroedingerSolverDonor *>(params);
-    arma::vec chi(se->get_z().size()); // Wavefunction envelope amplitude
-    return se->shoot_wavefunction(E, chi);
+    const auto ctx = reinterpret_cast<ShotContext *>(params);
+    return ctx->se->shoot_wavefunction(E, *ctx->ws, ctx->ws->chi);
 }
 
-void SchroedingerSolverDonor::calculate()
+/**
+ * \brief Find the ground-state energy for a trial wavefunction
+ *
+ * \param[in]     lambda Bohr radius of the trial wavefunction [m]
+ * \param[in]     zeta   Symmetry parameter of the trial wavefunction
+ * \param[in,out] ws     Workspace to use for the calculation
+ *
+ * \returns The energy of the ground state [J]
+ *
+ * \details This does not change the solver, so several trial wavefunctions may be
+ *          evaluated at once from different threads, provided that each has its own
+ *          workspace.  On return, the workspace holds the tables for the trial
+ *          wavefunction.
+ */
+double SchroedingerSolverDonor::find_energy(const double  lambda,
+                                            const double  zeta,
+                                            Workspace    &ws) const
 {
-    _solutions_chi.clear();
+    tabulate_integrals(lambda, zeta, ws);
+
+    ShotContext ctx = {this, &ws};
     gsl_function f;
     f.function = &chi_at_inf;
-    f.params   = this;
-    gsl_root_fsolver *solver = gsl_root_fsolver_alloc(gsl_root_fsolver_brent);
+    f.params   = &ctx;
 
     /* initial energy estimate=minimum potential-binding energy
        of particle to free ionised dopant */
-    double Elo = _V.min() - e*e/(4*pi*_eps*_lambda);
+    double Elo = _V.min() - e*e/(4*pi*_eps*lambda);
 
     // Value for y=f(x) at bottom of search range
     const double y1 = GSL_FN_EVAL(&f,Elo);
@@ -149,6 +227,7 @@ void SchroedingerSolverDonor::calculate()
         y2=GSL_FN_EVAL(&f, Ehi);
     }while(y1*y2>0);
 
+    gsl_root_fsolver *solver = gsl_root_fsolver_alloc(gsl_root_fsolver_brent);
     double E = (Elo + Ehi)/2;
     gsl_root_fsolver_set(solver, &f, Elo, Ehi);
     int status = 0;
@@ -164,13 +243,31 @@ void SchroedingerSolverDonor::calculate()
         status = gsl_root_test_interval(Elo, Ehi, 1e-12*e, 0);
     }while(status == GSL_CONTINUE);
 
+    gsl_root_fsolver_free(solver);
+
     // Stop if we've exceeded the cut-off energy
     if(gsl_fcmp(E, _V.max()+e, e*1e-12) == 1)
         throw std::runtime_error("Energy exceeded Vmax");
 
-    arma::vec chi(_z.size());
-    const auto chi_inf = shoot_wavefunction(E, chi);
-    _solutions_chi.push_back(Eigenstate(E, _z, chi));
+    return E;
+}
+
+/**
+ * \brief Find the solution for the current trial wavefunction
+ *
+ * \details The wavefunction is shot into the solver's own workspace, so the only
+ *          new storage is for the Eigenstate objects themselves.  Minimisers should
+ *          evaluate trial wavefunctions using find_energy() and only request the
+ *          solutions once the best trial wavefunction has been found.
+ */
+void SchroedingerSolverDonor::calculate()
+{
+    _solutions_chi.clear();
+
+    const double E = find_energy(_lambda, get_zeta(), _workspace);
+
+    const auto chi_inf = shoot_wavefunction(E, _workspace, _workspace.chi);
+    _solutions_chi.push_back(Eigenstate(E, _z_grid, _workspace.chi));
 
     calculate_psi_from_chi(); // Finally, compute the complete solution
 
@@ -188,43 +285,24 @@ void SchroedingerSolverDonor::calculate()
  */
 std::vector<Eigenstate> SchroedingerSolverDonor::get_solutions_chi(const bool convert_to_meV)
 {
-    // Only calculate if we haven't done so yet
-    if(_solutions_chi.empty())
-    {
-        calculate();
-
-        // Delete any states that are out of the desired energy range
-        // Ideally, sub-classes should never compute anything outside this
-        // range!
-        for(auto it = _solutions_chi.begin(); it != _solutions_chi.end(); ++it)
-        {
-            if (_E_max_set && gsl_fcmp(it->get_energy(), _E_max, e*1e-12) == 1)
-            {
-                _solutions_chi.erase(it);
-            }
-            else if (_E_min_set && gsl_fcmp(it->get_energy(), _E_min, e*1e-12) == -1)
-            {
-                _solutions_chi.erase(it);
-            }
-        }
-    }
+    update_solutions();
+    return filter_solutions(_solutions_chi, convert_to_meV);
+}
 
-    if(convert_to_meV)
+/**
+ * \brief Set the Bohr radius
+ *
+ * \param[in] lambda The new Bohr radius [m]
+ *
+ * \details The solutions are recalculated on the next request
+ */
+void SchroedingerSolverDonor::set_lambda(const double lambda)
+{
+    if(lambda != _lambda)
     {
-        std::vector<Eigenstate> sol_meV;
-
-        for(auto sol_J : _solutions_chi)
-        {
-            const auto E   = sol_J.get_energy();
-            const auto z   = sol_J.get_position_samples();
-            const auto psi = sol_J.get_wavefunction_samples();
-            sol_meV.push_back(Eigenstate(E, z, psi));
-        }
-
-        return sol_meV;
+        _lambda = lambda;
+        _dirty  = true;
     }
-    else
-        return _solutions_chi;
 }
 } // namespace
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -26,18 +26,59 @@ public:
 
     virtual std::string get_name() = 0;
 
+    /// Create an independent copy of the solver, e.g., for use in another thread
+    virtual SchroedingerSolverDonor * clone() const = 0;
+
     std::vector<Eigenstate> get_solutions_chi(const bool convert_to_meV=false);
 
+    /**
+     * \brief Working storage for finding the energy of a trial wavefunction
+     *
+     * \details The solver is only read while a trial is evaluated, so several
+     *          threads may share one solver, provided that each has its own workspace.
+     */
+    struct Workspace
+    {
+        // Coefficients in the shooting equation, tabulated at each point for a
+        // trial wavefunction.  These depend only on the form of the trial
+        // wavefunction, so they are found once per trial rather than once per shot
+        arma::vec alpha; ///< Coefficient of second derivative [m^2]
+        arma::vec beta;  ///< Coefficient of first derivative [m]
+        arma::vec gamma; ///< Energy-independent part of coefficient of function [dimensionless]
+
+        // Buffers that are reused by every shot, so that a minimiser can evaluate
+        // many trial wavefunctions without allocating any new storage
+        arma::vec weights; ///< Quadrature weights for the normalisation integral [m]
+        arma::vec chi;     ///< Wavefunction envelope at the latest trial energy [m^{-1/2}]
+        arma::vec psi;     ///< Complete wavefunction, including hydrogenic factor [m^{-1/2}]
+    };
+
     static double chi_at_inf(double  E,
                              void   *params);
 
     double shoot_wavefunction(const double  E,
                               arma::vec    &chi) const;
 
-    void   set_lambda(const double lambda) {_lambda = lambda; _solutions.clear(); calculate();}
+    double shoot_wavefunction(const double     E,
+                              const Workspace &ws,
+                              arma::vec       &chi) const;
+
+    void tabulate_integrals(const double  lambda,
+                            const double  zeta,
+                            Workspace    &ws) const;
+
+    double find_energy(const double  lambda,
+                       const double  zeta,
+                       Workspace    &ws) const;
+
+    void   set_lambda(const double lambda);
+    void   set_r_d   (const double r_d) {if(r_d != _r_d) {_r_d = r_d; _dirty = true;}}
     double get_lambda() const {return _lambda;}
     double get_r_d   () const {return _r_d;}
 
+    /// Symmetry parameter of the trial wavefunction (only used if the symmetry is variable)
+    virtual double get_zeta() const {return 0.0;}
+
 private:
     double _me;     ///< Effective mass at band-edge [kg]
     double _eps;    ///< Permittivity [F/m]
@@ -49,16 +90,25 @@ protected:
 private:
     double _dE;     ///< Minimum energy separation between states [J]
 
+    /// Solver and workspace to use in a GSL callback
+    struct ShotContext
+    {
+        const SchroedingerSolverDonor *se;
+        Workspace                     *ws;
+    };
+
 protected:
+    Workspace _workspace; ///< Tables for the current trial wavefunction
+
     ///< Set of solutions to the Schroedinger equation excluding hydrogenic component
     std::vector<Eigenstate> _solutions_chi;
 
     void calculate();
     virtual void   calculate_psi_from_chi() = 0;
-    virtual double I_1(const double z_dash) const = 0;
-    virtual double I_2(const double z_dash) const = 0;
-    virtual double I_3(const double z_dash) const = 0;
-    virtual double I_4(const double z_dash) const = 0;
+    virtual double I_1(const double z_dash, const double lambda, const double zeta) const = 0;
+    virtual double I_2(const double z_dash, const double lambda, const double zeta) const = 0;
+    virtual double I_3(const double z_dash, const double lambda, const double zeta) const = 0;
+    virtual double I_4(const double z_dash, const double lambda, const double zeta) const = 0;
 };
 } // namespace QWWAD
 #endif
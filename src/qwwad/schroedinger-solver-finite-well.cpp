@@ -7,11 +7,14 @@
 #include "schroedinger-solver-finite-well.h"
 
 #include <cmath>
+#include <sstream>
+#include <stdexcept>
 #include <gsl/gsl_errno.h>
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_roots.h>
 #include "constants.h"
 #include "maths-helpers.h"
+#include "profiler.h"
 
 namespace QWWAD
 {
@@ -197,47 +200,174 @@ size_t SchroedingerSolverFiniteWell::get_n_bound() const
     return nst;
 }
 
-void SchroedingerSolverFiniteWell::calculate()
+/**
+ * \brief Find the normalised wave-vector for a bound state
+ *
+ * \param[in] ist     Index of the state
+ * \param[in] v_guess Approximate normalised wave-vector, e.g., from a nearby point in a
+ *                    parameter sweep.  A value of zero means that no estimate is available.
+ *
+ * \details The Brent search is first started from a narrow bracket around the estimate.
+ *          If the root does not lie within it, the whole pi/2 cell for the state is
+ *          searched instead.
+ */
+double SchroedingerSolverFiniteWell::find_v(const unsigned int ist,
+                                            const double       v_guess) const
 {
     const double u_0_max = get_u0_max();
     const size_t nst = get_n_bound();
 
+    gsl_function F;
+    F.function = &test_matching;
+    F.params   = const_cast<SchroedingerSolverFiniteWell *>(this);
+
+    // Normally, the root needs to lie within each pi/2 cell so we
+    // set the limits for the root accordingly. Note the tiny increments
+    // here so that we avoid the asymptote.
+    double vlo = (ist+0.000000001) * pi/2.0;
+    double vhi = (ist+0.999999999) * pi/2.0;
+
+    // If this is the highest state in the well, then we need to
+    // reduce the range so that the energy doesn't go over the
+    // top of the well.
+    if (ist == nst - 1)
+       vhi = u_0_max;
+
+    // Narrow the range down to the neighbourhood of the estimate if
+    // it is known to contain the root
+    if (v_guess > vlo && v_guess < vhi)
+    {
+        const double dv = 0.01 * pi/2.0;
+        const double vlo_guess = GSL_MAX_DBL(vlo, v_guess - dv);
+        const double vhi_guess = GSL_MIN_DBL(vhi, v_guess + dv);
+
+        if (GSL_FN_EVAL(&F, vlo_guess) * GSL_FN_EVAL(&F, vhi_guess) < 0)
+        {
+            vlo = vlo_guess;
+            vhi = vhi_guess;
+        }
+    }
+
+    gsl_root_fsolver *solver = gsl_root_fsolver_alloc(gsl_root_fsolver_brent);
+    double v = 0.5 * (vlo+vhi); // Initial estimate of solution
+    gsl_root_fsolver_set(solver, &F, vlo, vhi);
+    int status = 0;
+
+    // Improve the estimate of solution using the Brent algorithm
+    // until we hit a desired level of precision
+    do
+    {
+        QWWAD_COUNT("finite-well Brent iterations");
+
+        status = gsl_root_fsolver_iterate(solver);
+        v = gsl_root_fsolver_root(solver);
+        vlo = gsl_root_fsolver_x_lower(solver);
+        vhi = gsl_root_fsolver_x_upper(solver);
+        status = gsl_root_test_interval(vlo, vhi, 0.001, 0);
+    }while(status == GSL_CONTINUE);
+
+    gsl_root_fsolver_free(solver);
+
+    return v;
+}
+
+/**
+ * \brief Convert an energy to the normalised wave-vector in the well
+ *
+ * \param[in] E Energy [J]
+ */
+double SchroedingerSolverFiniteWell::get_v(const double E) const
+{
+    return (E > 0) ? 0.5*_l_w*sqrt(2.0*_m_w*E)/hBar : 0.0;
+}
+
+/**
+ * \brief Find the energies of the bound states without computing wavefunctions
+ *
+ * \param[in] E_guess Approximate energy of each state [J], e.g., from a nearby point
+ *                    in a parameter sweep.  This may be shorter than the number of
+ *                    states, or empty.
+ *
+ * \returns The energy of each bound state, up to the maximum number of states [J]
+ */
+arma::vec SchroedingerSolverFiniteWell::get_energies(const arma::vec &E_guess) const
+{
+    const size_t nst = GSL_MIN(get_n_bound(), static_cast<size_t>(_nst_max));
+    arma::vec E(nst);
+
+    for (unsigned int ist=0; ist < nst; ++ist)
+    {
+        const double v_guess = (ist < E_guess.size()) ? get_v(E_guess(ist)) : 0.0;
+        const double v = find_v(ist, v_guess);
+        const double k = 2.0*v/_l_w;
+        E(ist) = hBar*hBar*k*k/(2.0*_m_w);
+    }
+
+    return E;
+}
+
+/**
+ * \brief Find the bound-state energies for a sweep through a set of wells
+ *
+ * \param[in] l_w     Width of well at each point in the sweep [m]
+ * \param[in] V0      Well depth at each point in the sweep [J]
+ * \param[in] m_w     Effective mass in well [kg]
+ * \param[in] m_b     Effective mass in barriers [kg]
+ * \param[in] nst_max Maximum number of states to find at each point
+ *
+ * \returns A table of energies [J], with one row for each point in the sweep and one
+ *          column for each state.  States that are not bound at a given point are
+ *          set to NaN.
+ *
+ * \details Only the matching equation is solved at each point, and the root for
+ *          each state is seeded from the one found at the previous point.  The sweep
+ *          is therefore much cheaper than running a separate calculation at each
+ *          point, provided that the parameters change smoothly along it.
+ */
+arma::mat SchroedingerSolverFiniteWell::sweep(const arma::vec    &l_w,
+                                              const arma::vec    &V0,
+                                              const double        m_w,
+                                              const double        m_b,
+                                              const unsigned int  nst_max)
+{
+    if(l_w.size() != V0.size())
+    {
+        std::ostringstream oss;
+        oss << "Got " << l_w.size() << " well widths and " << V0.size() << " well depths for sweep.";
+        throw std::length_error(oss.str());
+    }
+
+    const size_t npts = l_w.size();
+    arma::mat E(npts, nst_max);
+    E.fill(NAN);
+
+    arma::vec E_prev; // Energies at previous point in the sweep [J]
+
+    for (unsigned int ipt = 0; ipt < npts; ++ipt)
+    {
+        // Only the matching equations are needed, so the spatial mesh is minimal
+        const SchroedingerSolverFiniteWell se(l_w(ipt), 0, V0(ipt), m_w, m_b, 2, nst_max);
+        E_prev = se.get_energies(E_prev);
+
+        for (unsigned int ist = 0; ist < E_prev.size(); ++ist)
+            E(ipt, ist) = E_prev(ist);
+    }
+
+    return E;
+}
+
+void SchroedingerSolverFiniteWell::calculate()
+{
+    const size_t nst = get_n_bound();
+
     for (unsigned int ist=0; ist < _nst_max && ist < nst; ++ist)
     {
         // deduce parity: false if even parity
         const bool parity_flag = (ist%2 == 1);
 
-        gsl_function F;
-        F.function = &test_matching;
-        F.params   = this;
-        gsl_root_fsolver *solver = gsl_root_fsolver_alloc(gsl_root_fsolver_brent);
-
-        // Normally, the root needs to lie within each pi/2 cell so we
-        // set the limits for the root accordingly. Note the tiny increments
-        // here so that we avoid the asymptote.
-        double vlo = (ist+0.000000001) * pi/2.0;
-        double vhi = (ist+0.999999999) * pi/2.0;
-
-        // If this is the highest state in the well, then we need to
-        // reduce the range so that the energy doesn't go over the
-        // top of the well.
-        if (ist == nst - 1)
-           vhi = u_0_max;
-
-        double v = 0.5 * (vlo+vhi); // Initial estimate of solution
-        gsl_root_fsolver_set(solver, &F, vlo, vhi);
-        int status = 0;
-
-        // Improve the estimate of solution using the Brent algorithm
-        // until we hit a desired level of precision
-        do
-        {
-            status = gsl_root_fsolver_iterate(solver);
-            v = gsl_root_fsolver_root(solver);
-            vlo = gsl_root_fsolver_x_lower(solver);
-            vhi = gsl_root_fsolver_x_upper(solver);
-            status = gsl_root_test_interval(vlo, vhi, 0.001, 0);
-        }while(status == GSL_CONTINUE);
+        // Start from the initial guess, if one was supplied
+        const double v_guess = (ist < _guess.size()) ? get_v(_guess[ist].get_energy()) : 0.0;
+        const double v = find_v(ist, v_guess);
 
         const double k = 2.0*v/_l_w;
         const double E = hBar*hBar*k*k/(2.0*_m_w);
@@ -253,10 +383,8 @@ void SchroedingerSolverFiniteWell::calculate()
         // Don't store the solution if it's below the minimum energy 
         if(!(_E_min_set && gsl_fcmp(E, _E_min, e*1e-12) == -1))
         {
-            _solutions.push_back(Eigenstate(E, _z, psi));
+            _solutions.push_back(Eigenstate(E, _z_grid, psi));
         }
-
-        gsl_root_fsolver_free(solver);
     }
 }
 } // namespace
@@ -35,6 +35,14 @@ public:
 
     double get_lhs(const double v) const;
     double get_rhs(const double v) const;
+
+    arma::vec get_energies(const arma::vec &E_guess = arma::vec()) const;
+
+    static arma::mat sweep(const arma::vec    &l_w,
+                           const arma::vec    &V0,
+                           const double        m_w,
+                           const double        m_b,
+                           const unsigned int  nst_max);
 private:
     double _l_w; ///< Width of well [m]
     double _V0;  ///< Well depth [J]
@@ -42,7 +50,12 @@ private:
     double _m_b; ///< Effective mass in barriers [kg]
 
     void calculate();
-    
+
+    double find_v(const unsigned int ist,
+                  const double       v_guess) const;
+
+    double get_v(const double E) const;
+
     arma::vec get_wavefunction(const double E,
                                const bool   parity_flag) const;
 };
@@ -7,33 +7,98 @@
 
 #include "schroedinger-solver-full.h"
 
+#include <algorithm>
+#include <complex>
+#include <iostream>
 #include <gsl/gsl_math.h>
 #include "constants.h"
-#include "linear-algebra.h"
+#include "maths-helpers.h"
+#include "memory-budget.h"
+#include "profiler.h"
 
 namespace QWWAD
 {
 using namespace constants;
+
+/**
+ * \brief Estimate the peak memory used by the dense solver [bytes]
+ *
+ * \param[in] nz Number of spatial points
+ *
+ * \details The dense 3nz x 3nz matrix is overwritten by LAPACK, which also
+ *          needs the same amount of space for the right eigenvectors.
+ */
+static size_t dense_memory(const size_t nz)
+{
+    return 2 * (3*nz) * (3*nz) * sizeof(double);
+}
+
 /**
  * Build matrix 'A' from general eigenproblem
  * \param[in] nst_max Maximum number of states to find
+ * \param[in] sparse  Use the sparse (shift-invert) eigensolver rather than
+ *                    the dense general eigensolver
  *
  * \details If nst_max=0 (the default), all states will be found
- *          that lie within the range of the input potential profile
+ *          that lie within the range of the input potential profile.
+ *
+ *          If the dense solver would need more than the memory limit (see
+ *          set_memory_limit), the sparse solver is used instead.
  */
-SchroedingerSolverFull::SchroedingerSolverFull(const decltype(_m)     &m,
-                                               const decltype(_alpha) &alpha,
-                                               const decltype(_V)     &V,
-                                               const decltype(_z)     &z,
-                                               const unsigned int      nst_max) :
+SchroedingerSolverFull::SchroedingerSolverFull(const decltype(_m)      &m,
+                                               const decltype(_alpha)  &alpha,
+                                               const decltype(_V)      &V,
+                                               const decltype(_z)      &z,
+                                               const unsigned int       nst_max,
+                                               const decltype(_sparse)  sparse) :
     SchroedingerSolver(V,z,nst_max),
     _m(m),
     _alpha(alpha),
-    _A(arma::mat(3*z.size(), 3*z.size()))
+    _A_sparse(make_matrix(m, alpha, V, z)),
+    _sparse(sparse),
+    _A(),
+    _bloch(false),
+    _k_bloch(0.0)
 {
+    if(!_sparse && !fits_in_memory("dense nonparabolic matrix", dense_memory(z.size())))
+    {
+        std::cerr << "The dense nonparabolic matrix would exceed the memory limit.  "
+                  << "Using the sparse solver instead." << std::endl;
+        _sparse = true;
+    }
+
+    // Only expand the dense matrix if we really need it
+    if(!_sparse)
+        _A = _A_sparse.get_dense();
+}
+
+/**
+ * \brief Find the nonzero diagonals of the linearised cubic eigenvalue problem
+ *
+ * \param[in]  m        Band-edge effective mass at each point [kg]
+ * \param[in]  alpha    Nonparabolicity parameter at each point [1/J]
+ * \param[in]  V        Confining potential at each point [J]
+ * \param[in]  z        Spatial points [m]
+ * \param[out] coupling If given, the structure is treated as one period of a
+ *                      superlattice.  The neighbours of the end points are then
+ *                      taken from the other end of the period, and the elements that
+ *                      couple the two ends are written here.
+ *
+ * \details See J. Cooper et al., APL 2010
+ */
+CubicEVPMatrix SchroedingerSolverFull::make_matrix(const decltype(_m)     &m,
+                                                   const decltype(_alpha) &alpha,
+                                                   const decltype(_V)     &V,
+                                                   const decltype(_z)     &z,
+                                                   PeriodCoupling         *coupling)
+{
+    ScopedTimer timer("hamiltonian assembly");
+
+    check_uniform_mesh(z, "The full nonparabolic Schroedinger solver");
+
     const size_t nz = z.size();
     const double dz = z[1] - z[0];
-    arma::vec B(3*nz*nz);
+    const bool periodic = (coupling != nullptr);
 
     // Declare diagonal views
     arma::vec a_elem(nz-1);
@@ -53,26 +118,33 @@ SchroedingerSolverFull::SchroedingerSolverFull(const decltype(_m)     &m,
         double V_minus;
         double V_plus;
 
-        // Calculate mass midpoints for +1/2 and -1/2 avoiding outside addressing if neccessary
-        if (i==0 or i==nz-1)
+        // Calculate mass midpoints for +1/2 and -1/2 avoiding outside addressing if neccessary.
+        // In a periodic structure, the neighbours of the end points are at the other end
+        if ((i==0 or i==nz-1) and !periodic)
         {
-            m_minus = m_plus = _m[i];
-            alpha_minus = alpha_plus = _alpha[i];
-            V_minus = V_plus = _V[i];
+            m_minus = m_plus = m[i];
+            alpha_minus = alpha_plus = alpha[i];
+            V_minus = V_plus = V[i];
         }
         else{
-            m_minus = (_m[i]   + _m[i-1])/2;
-            m_plus  = (_m[i+1] + _m[i])/2;
-            alpha_minus = (_alpha[i]   + _alpha[i-1])/2;
-            alpha_plus  = (_alpha[i+1] + _alpha[i])/2;
-            V_minus = (_V[i]   + _V[i-1])/2;
-            V_plus  = (_V[i+1] + _V[i])/2;
+            const unsigned int i_prev = (i == 0)    ? nz-1 : i-1;
+            const unsigned int i_next = (i == nz-1) ? 0    : i+1;
+
+            m_minus = (m[i]      + m[i_prev])/2;
+            m_plus  = (m[i_next] + m[i])/2;
+            alpha_minus = (alpha[i]      + alpha[i_prev])/2;
+            alpha_plus  = (alpha[i_next] + alpha[i])/2;
+            V_minus = (V[i]      + V[i_prev])/2;
+            V_plus  = (V[i_next] + V[i])/2;
         }
 
         // Calculate a points
+        const double a = -0.5*hBar_dz_sq*(1-alpha_plus*V_plus)/(m_minus*alpha_plus*alpha_minus);
+
         if(i!=0)
-            a_elem(i-1) = -0.5*hBar_dz_sq*\
-                                       (1-alpha_plus*V_plus)/(m_minus*alpha_plus*alpha_minus);
+            a_elem(i-1) = a;
+        else if(periodic)
+            coupling->A31_upper = a;
 
         // Calculate b points
         b_elem(i) = 0.5*hBar_dz_sq/(alpha_plus*alpha_minus)*
@@ -81,13 +153,20 @@ SchroedingerSolverFull::SchroedingerSolverFull(const decltype(_m)     &m,
                     alpha_plus*alpha_minus*V_plus*V_minus)/(alpha_plus*alpha_minus);
 
         // Calculate c points
+        const double c = -0.5*hBar_dz_sq*(1-alpha_minus*V_minus)/(m_plus*alpha_plus*alpha_minus);
+
         if(i!=nz-1)
-           c_elem(i) = -0.5*hBar_dz_sq*\
-                                       (1-alpha_minus*V_minus)/(m_plus*alpha_plus*alpha_minus);
+            c_elem(i) = c;
+        else if(periodic)
+            coupling->A31_lower = c;
 
         // Calculate d points
+        const double d = -0.5*hBar_dz_sq/(m_minus*alpha_minus);
+
         if(i!=0)
-            d_elem(i-1) = -0.5*hBar_dz_sq/(m_minus*alpha_minus);
+            d_elem(i-1) = d;
+        else if(periodic)
+            coupling->A32 = d;
 
         // Calculate e points
         e_elem(i) = 0.5*hBar_dz_sq*
@@ -99,27 +178,88 @@ SchroedingerSolverFull::SchroedingerSolverFull(const decltype(_m)     &m,
         g_elem(i) = -1/alpha_plus - 1/alpha_minus + V_plus + V[i]+V_minus;
     }
 
-    // Declare submatrices
-    arma::mat A31(nz,nz);
-    A31.diag(-1) = a_elem;
-    A31.diag()   = b_elem;
-    A31.diag(1)  = c_elem;
-
-    // Note that the A32 block is symmetrical so we reuse the d-elements
-    arma::mat A32(nz,nz);
-    A32.diag(-1) = d_elem;
-    A32.diag(0)  = e_elem;
-    A32.diag(1)  = d_elem;
-
-    arma::mat A33(nz,nz);
-    A33.diag() = g_elem;
-
-    // Insert submatrices into full Hamiltonian matrix
-    _A.submat(0,    nz,     nz-1,   2*nz-1).eye(); // A12
-    _A.submat(nz,   2*nz,   2*nz-1, 3*nz-1).eye(); // A23
-    _A.submat(2*nz, 0,      3*nz-1, nz-1)   = A31;
-    _A.submat(2*nz, nz,     3*nz-1, 2*nz-1) = A32;
-    _A.submat(2*nz, 2*nz,   3*nz-1, 3*nz-1) = A33;
+    return CubicEVPMatrix(a_elem, b_elem, c_elem, d_elem, e_elem, g_elem);
+}
+
+/**
+ * \brief Use Bloch-periodic boundaries, with a given superlattice wave vector
+ *
+ * \param[in] k Bloch wave vector [1/m]
+ *
+ * \details The structure is then treated as a single period of a superlattice,
+ *          with \f$\psi(z+L) = \mathrm{e}^{ikL}\psi(z)\f$.  See
+ *          SchroedingerSolver::get_bloch_period.
+ */
+void SchroedingerSolverFull::set_bloch_wavevector(const double k)
+{
+    if(!_bloch || k != _k_bloch)
+    {
+        _bloch   = true;
+        _k_bloch = k;
+        _dirty   = true;
+    }
+}
+
+/**
+ * \brief Find the states of a single period with Bloch-periodic boundaries
+ *
+ * \details The ends of the period are coupled by corner elements in the A31 and A32
+ *          blocks, with a complex phase that depends on the wave vector.  The
+ *          matrix is not Hermitian, so the physical states are picked out as the
+ *          eigenvalues that are real to within rounding error.
+ */
+void SchroedingerSolverFull::calculate_bloch()
+{
+    const size_t nz = _z.size();
+
+    check_memory("dense Bloch nonparabolic matrix", 2 * dense_memory(nz));
+
+    PeriodCoupling coupling;
+    const auto A_periodic = make_matrix(_m, _alpha, _V, _z, &coupling);
+
+    arma::cx_mat A = arma::conv_to<arma::cx_mat>::from(A_periodic.get_dense());
+
+    const auto phase = std::polar(1.0, _k_bloch*get_bloch_period());
+    A(3*nz-1, 0)      += coupling.A31_lower*phase;
+    A(2*nz,   nz-1)   += coupling.A31_upper*std::conj(phase);
+    A(3*nz-1, nz)     += coupling.A32*phase;
+    A(2*nz,   2*nz-1) += coupling.A32*std::conj(phase);
+
+    arma::cx_vec E_all;
+    arma::cx_mat psi_all;
+
+    if(!arma::eig_gen(E_all, psi_all, A))
+        throw std::runtime_error("Could not solve Bloch eigenproblem. Check all input parameters!");
+
+    // Get limits for search
+    const double E_min = _E_min_set ? _E_min : _V.min();
+    const double E_max = _E_max_set ? _E_max : _V.max();
+
+    // Keep the real eigenvalues in the search range, in ascending order
+    std::vector<arma::uword> found;
+
+    for(arma::uword i = 0; i < E_all.size(); ++i)
+    {
+        const double E = E_all(i).real();
+
+        if(std::abs(E_all(i).imag()) < 1e-9*e && E > E_min && (_nst_max > 0 || E < E_max))
+            found.push_back(i);
+    }
+
+    std::sort(found.begin(), found.end(),
+              [&](const arma::uword a, const arma::uword b) {return E_all(a).real() < E_all(b).real();});
+
+    if(_nst_max > 0 && found.size() > _nst_max)
+        found.resize(_nst_max);
+
+    _solutions.clear();
+
+    for(auto i : found)
+    {
+        // We just want the first nz elements of the eigenvector
+        const arma::cx_vec psi = psi_all.col(i).subvec(0, nz-1);
+        _solutions.push_back(Eigenstate(E_all(i).real(), _z_grid, real_bloch_envelope(psi)));
+    }
 }
 
 /**
@@ -127,9 +267,25 @@ SchroedingerSolverFull::SchroedingerSolverFull(const decltype(_m)     &m,
  */
 void SchroedingerSolverFull::calculate()
 {
+    if(_bloch)
+    {
+        calculate_bloch();
+        return;
+    }
+
     // Find solutions, including all the unwanted "padding" in the eigenvector
     // that comes from the cubic EVP.  See J. Cooper et al., APL 2010
-    const auto solutions_tmp = eigen_general(_A, _V.min(), _V.max(), _nst_max);
+    std::vector< EVP_solution<double> > solutions_tmp;
+
+    if(_sparse)
+    {
+        // Only search within the desired range of energies
+        const double E_min = _E_min_set ? _E_min : _V.min();
+        const double E_max = _E_max_set ? _E_max : _V.max();
+        solutions_tmp = eigen_cubic_shift_invert(_A_sparse, E_min, E_max, _nst_max);
+    }
+    else
+        solutions_tmp = eigen_general(_A, _V.min(), _V.max(), _nst_max);
 
     // Now chop off the padding from the eigenvector
     const size_t nst = solutions_tmp.size();
@@ -146,7 +302,7 @@ void SchroedingerSolverFull::calculate()
         const std::vector<double> psi(psi_full.begin(),
                                       psi_full.begin() + nz);
 
-        _solutions.push_back(Eigenstate(E, _z, psi));
+        _solutions.push_back(Eigenstate(E, _z_grid, psi));
     }
 }
 } // namespace
@@ -9,30 +9,63 @@
 #define QWWAD_SCHROEDINGER_SOLVER_FULL_H
 
 #include "schroedinger-solver.h"
+#include "linear-algebra.h"
 
 namespace QWWAD
 {
 /**
  * Schroedinger solver that uses a full generalised matrix
+ *
+ * \details By default, the matrix is stored densely and every eigenvalue is found using
+ *          a general (LAPACK) eigensolver.  Alternatively, the sparse block-tridiagonal
+ *          structure of the matrix can be exploited, and only the states within the
+ *          search range found using a shift-invert Arnoldi iteration.  This is much
+ *          faster, and uses O(nz) memory rather than O(nz^2), for large meshes.
+ *
+ *          The structure can also be treated as a single period of a superlattice, with
+ *          Bloch-periodic boundaries for a given wave vector.  The matrix is then complex,
+ *          and always solved densely.
  */
 class SchroedingerSolverFull : public SchroedingerSolver
 {
 private:
-    arma::vec _m;     ///< Effective mass at each point
-    arma::vec _alpha; ///< Non-parabolicity parameter at each point
-    arma::mat _A;     ///< Hamiltonian matrix
+    arma::vec      _m;        ///< Effective mass at each point
+    arma::vec      _alpha;    ///< Non-parabolicity parameter at each point
+    CubicEVPMatrix _A_sparse; ///< Hamiltonian matrix (sparse storage)
+    bool           _sparse;   ///< True if the sparse eigensolver is used
+    arma::mat      _A;        ///< Hamiltonian matrix (dense storage; only used by dense solver)
+    bool           _bloch;    ///< True if Bloch-periodic boundaries are used
+    double         _k_bloch;  ///< Bloch wave vector [1/m]
+
+    /// Elements of the matrix that couple the two ends of a period
+    struct PeriodCoupling
+    {
+        double A31_lower; ///< Element in the bottom-left corner of A31
+        double A31_upper; ///< Element in the top-right corner of A31
+        double A32;       ///< Element in both corners of A32
+    };
+
+    static CubicEVPMatrix make_matrix(const decltype(_m)     &m,
+                                      const decltype(_alpha) &alpha,
+                                      const decltype(_V)     &V,
+                                      const decltype(_z)     &z,
+                                      PeriodCoupling         *coupling = nullptr);
 
 public:
-    SchroedingerSolverFull(const decltype(_m)     &m,
-                           const decltype(_alpha) &alpha,
-                           const decltype(_V)     &V,
-                           const decltype(_z)     &z,
-                           const unsigned int      nst_max=0);
+    SchroedingerSolverFull(const decltype(_m)      &m,
+                           const decltype(_alpha)  &alpha,
+                           const decltype(_V)      &V,
+                           const decltype(_z)      &z,
+                           const unsigned int       nst_max=0,
+                           const decltype(_sparse)  sparse=false);
+
+    std::string get_name() {return _bloch ? "full-bloch" : (_sparse ? "full-sparse" : "full");}
 
-    std::string get_name() {return "full";}
+    void set_bloch_wavevector(const double k);
 
 private:
     void calculate();
+    void calculate_bloch();
 };
 } // namespace
 #endif
@@ -15,6 +15,88 @@
 namespace QWWAD
 {
 using namespace constants;
+
+/**
+ * \brief Create the wavefunction for a state in an infinite square well
+ *
+ * \param[in] L  Width of quantum well [m]
+ * \param[in] Lb Position of the left-hand edge of the well [m]
+ * \param[in] n  Principal quantum number (starting from 1)
+ */
+InfWellWavefunction::InfWellWavefunction(const double       L,
+                                         const double       Lb,
+                                         const unsigned int n) :
+    _L(L),
+    _Lb(Lb),
+    _n(n)
+{}
+
+/**
+ * \brief Find the wavefunction at a given position [QWWAD3, 2.15]
+ *
+ * \param[in] z Position [m]
+ *
+ * \returns The wavefunction [m^{-0.5}], which is zero outside the well
+ */
+double InfWellWavefunction::operator()(const double z) const
+{
+    if(z > _Lb && z < _Lb + _L)
+        return sqrt(2/_L)*sin(_n*pi*(z-_Lb)/_L);
+
+    return 0;
+}
+
+/**
+ * \brief Check whether another wavefunction is for the same well
+ */
+bool InfWellWavefunction::same_well(const InfWellWavefunction &other) const
+{
+    return gsl_fcmp(_L, other._L, 1e-12) == 0 && gsl_fcmp(_Lb + _L, other._Lb + other._L, 1e-12) == 0;
+}
+
+/**
+ * \brief The states in a single well are orthonormal
+ */
+bool InfWellWavefunction::get_overlap(const AnalyticWavefunction &other,
+                                      double                     &S) const
+{
+    const auto st = dynamic_cast<const InfWellWavefunction *>(&other);
+
+    if(!st || !same_well(*st))
+        return false;
+
+    S = (st->_n == _n) ? 1.0 : 0.0;
+    return true;
+}
+
+/**
+ * \brief Find the position matrix element with another state in the same well
+ *
+ * \details The expectation position is the centre of the well.  Between different
+ *          states, the matrix element is zero if the states have the same parity, or
+ *          \f$-8Lnm/[\pi^2(n^2-m^2)^2]\f$ otherwise.
+ */
+bool InfWellWavefunction::get_position_matrix_element(const AnalyticWavefunction &other,
+                                                      double                     &z_ij) const
+{
+    const auto st = dynamic_cast<const InfWellWavefunction *>(&other);
+
+    if(!st || !same_well(*st))
+        return false;
+
+    const double n = _n;
+    const double m = st->_n;
+
+    if(_n == st->_n)
+        z_ij = _Lb + _L/2;
+    else if((_n + st->_n) % 2 == 0)
+        z_ij = 0;
+    else
+        z_ij = -8*_L*n*m/gsl_pow_2(pi*(n*n - m*m));
+
+    return true;
+}
+
 SchroedingerSolverInfWell::SchroedingerSolverInfWell(const double       me,
                                                      const double       L,
                                                      const size_t       nz,
@@ -50,8 +132,6 @@ void SchroedingerSolverInfWell::make_z_array()
 
 void SchroedingerSolverInfWell::calculate()
 {
-    double nz = _z.size();
-
     // Loop over all required states
     for(unsigned int is=1; is<=_nst_max; is++)
     {
@@ -75,20 +155,11 @@ void SchroedingerSolverInfWell::calculate()
             break;
         }
 
-        arma::vec psi = arma::zeros(nz); // Wavefunction amplitude at each point [m^{-0.5}]
-
-        // Loop over spatial locations and find wavefunction
-        // amplitude at each point (QWWAD3, 2.15)
-        for(unsigned int iz=0; iz<nz; ++iz)
-        {
-            if(_z[iz] > _Lb && _z[iz] < _Lb + _L)
-                psi[iz]=sqrt(2/_L)*sin(is*pi*(_z[iz]-_Lb)/_L); // Wavefunction [m^{-0.5}]
-        }
-
-        // Don't store the solution if it's below the minimum energy
+        // Don't store the solution if it's below the minimum energy.  The
+        // wavefunction is only sampled onto the grid if it is needed.
         if(!(_E_min_set && gsl_fcmp(E, _E_min, e*1e-12) == -1))
         {
-            _solutions.push_back(Eigenstate(E, _z, psi));
+            _solutions.push_back(Eigenstate(E, _z_grid, std::make_shared<InfWellWavefunction>(_L, _Lb, is)));
         }
     }
 }
@@ -106,7 +177,7 @@ void SchroedingerSolverInfWell::set_padding_width(const double Lb)
     _Lb = Lb;
 
     make_z_array(); // Regenerate spatial points
-    calculate();    // Recalculate solutions
+    _dirty = true;  // Recalculate solutions on next request
 }
 } // namespace
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
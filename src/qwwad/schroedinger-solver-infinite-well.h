@@ -11,6 +11,35 @@
 
 namespace QWWAD
 {
+/**
+ * \brief Closed-form wavefunction of a state in an infinite square well
+ *
+ * \details The states in a well of width L, starting at z = Lb, form an orthonormal
+ *          set, and their position matrix elements are known exactly.
+ */
+class InfWellWavefunction : public AnalyticWavefunction
+{
+public:
+    InfWellWavefunction(const double       L,
+                        const double       Lb,
+                        const unsigned int n);
+
+    double operator()(const double z) const;
+
+    bool get_overlap(const AnalyticWavefunction &other,
+                     double                     &S) const;
+
+    bool get_position_matrix_element(const AnalyticWavefunction &other,
+                                     double                     &z_ij) const;
+
+private:
+    double       _L;  ///< Width of quantum well [m]
+    double       _Lb; ///< Position of the left-hand edge of the well [m]
+    unsigned int _n;  ///< Principal quantum number (starting from 1)
+
+    bool same_well(const InfWellWavefunction &other) const;
+};
+
 /**
  * Schroedinger solver for an infinite square well
  */
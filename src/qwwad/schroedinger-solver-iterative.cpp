@@ -0,0 +1,224 @@
+/**
+ *  \file   schroedinger-solver-iterative.cpp
+ *  \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ *  \brief  Implementation of nonparabolic Schroedinger solver using iteration of the mass
+ */
+
+#include "schroedinger-solver-iterative.h"
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <gsl/gsl_math.h>
+
+#include "constants.h"
+#include "parallel.h"
+#include "profiler.h"
+#include "schroedinger-solver-tridiagonal.h"
+
+namespace QWWAD
+{
+using namespace constants;
+
+/// Maximum number of energy updates for each state
+static const unsigned int iter_max = 100;
+
+/**
+ * \brief Create a nonparabolic solver
+ *
+ * \param[in] me      Band-edge effective mass [kg]
+ * \param[in] alpha   Nonparabolicity parameter [1/J]
+ * \param[in] V       Confining potential [J]
+ * \param[in] z       Spatial coordinates [m]
+ * \param[in] nst_max Maximum number of states to find
+ *
+ * \details If nst_max=0 (the default), all states will be found
+ *          that lie within the range of the input potential profile.
+ *          The same finite-volume discretisation is used as in
+ *          SchroedingerSolverTridiag, so the spatial points need not be
+ *          evenly spaced.
+ */
+SchroedingerSolverIterative::SchroedingerSolverIterative(const decltype(_me)    &me,
+                                                         const decltype(_alpha) &alpha,
+                                                         const decltype(_V)     &V,
+                                                         const decltype(_z)     &z,
+                                                         const unsigned int      nst_max) :
+    SchroedingerSolver(V,z,nst_max),
+    _me(me),
+    _alpha(alpha),
+    _h(SchroedingerSolverTridiag::get_cell_widths(z))
+{}
+
+/**
+ * \brief Construct the symmetrised Hamiltonian for a given effective mass profile
+ *
+ * \param[in]  m    Effective mass at each point [kg]
+ * \param[out] diag Diagonal elements of the Hamiltonian [J]
+ * \param[out] sub  Subdiagonal elements of the Hamiltonian [J]
+ *
+ * \details This is the Hamiltonian of a SchroedingerSolverTridiag with the same
+ *          mass profile.
+ */
+void SchroedingerSolverIterative::make_hamiltonian(const arma::vec &m,
+                                                   arma::vec       &diag,
+                                                   arma::vec       &sub) const
+{
+    const SchroedingerSolverTridiag se(m, _V, _z);
+    diag = se.get_diagonal();
+    sub  = se.get_subdiagonal();
+}
+
+/**
+ * \brief Construct the symmetrised Hamiltonian for a given energy
+ *
+ * \param[in]  E    Energy at which to evaluate the effective mass [J]
+ * \param[out] diag Diagonal elements of the Hamiltonian [J]
+ * \param[out] sub  Subdiagonal elements of the Hamiltonian [J]
+ *
+ * \details The effective mass at each point is \f$m(E) = m_e[1 + \alpha(E-V)]\f$, as in
+ *          the nonparabolic shooting solver.
+ */
+void SchroedingerSolverIterative::make_hamiltonian(const double  E,
+                                                   arma::vec    &diag,
+                                                   arma::vec    &sub) const
+{
+    const arma::vec m = _me % (1.0 + _alpha % (E - _V));
+    make_hamiltonian(m, diag, sub);
+}
+
+/**
+ * \brief Count the states that lie below a given energy
+ *
+ * \param[in] E Energy [J]
+ *
+ * \details The effective mass rises with energy, so each eigenvalue of the Hamiltonian
+ *          falls as the energy at which the mass is evaluated rises.  A state therefore
+ *          lies below E if, and only if, the corresponding eigenvalue of the Hamiltonian
+ *          evaluated at E lies below E.
+ *
+ * \returns The number of states
+ */
+unsigned int SchroedingerSolverIterative::count_states(const double E) const
+{
+    arma::vec diag;
+    arma::vec sub;
+    make_hamiltonian(E, diag, sub);
+
+    return count_eigen_tridiag(diag, sub, E);
+}
+
+/**
+ * \brief Find one eigenpair of the Hamiltonian, with the mass fixed at a given energy
+ *
+ * \param[in] ist Index of the state
+ * \param[in] E   Energy at which to evaluate the effective mass [J]
+ *
+ * \returns The eigenpair.  The state is a solution of the nonparabolic equation if its
+ *          eigenvalue is equal to E.
+ */
+EVP_solution<double> SchroedingerSolverIterative::solve_at_energy(const unsigned int ist,
+                                                                  const double       E) const
+{
+    QWWAD_COUNT("iterative-nonparabolic matrix solutions");
+
+    arma::vec diag;
+    arma::vec sub;
+    make_hamiltonian(E, diag, sub);
+
+    return eigen_tridiag_single(diag, sub, ist);
+}
+
+/**
+ * \brief Find a single state of the nonparabolic Schroedinger equation
+ *
+ * \param[in] ist     Index of the state
+ * \param[in] E_guess Initial estimate of the energy [J]
+ *
+ * \details The first update is a successive substitution, in which the eigenvalue is used
+ *          as the next trial energy.  The secant method is then used to find the energy at
+ *          which the eigenvalue equals the trial energy.  This typically converges in a
+ *          handful of steps.
+ *
+ * \returns The eigenpair
+ */
+EVP_solution<double> SchroedingerSolverIterative::find_state(const unsigned int ist,
+                                                             const double       E_guess) const
+{
+    double E_old = E_guess;
+    auto   st    = solve_at_energy(ist, E_old);
+    double f_old = st.get_E() - E_old; // Mismatch between eigenvalue and trial energy
+    double E     = st.get_E();
+
+    for(unsigned int iter = 0; iter < iter_max; ++iter)
+    {
+        st = solve_at_energy(ist, E);
+        const double f = st.get_E() - E;
+
+        // Stop if the mismatch no longer changes, since the secant step is then undefined
+        if(f == f_old)
+            return st;
+
+        const double E_new = E - f*(E - E_old)/(f - f_old);
+
+        if(fabs(E_new - E) < 1e-12*e)
+            return solve_at_energy(ist, E_new);
+
+        E_old = E;
+        f_old = f;
+        E     = E_new;
+    }
+
+    std::ostringstream oss;
+    oss << "Energy of state " << ist << " did not converge after " << iter_max << " iterations";
+    throw std::runtime_error(oss.str());
+}
+
+/**
+ * \brief Find solutions to the nonparabolic Schroedinger equation
+ *
+ * \details The parabolic states are used as the initial estimates, and each state is
+ *          then refined independently.  The states are shared between threads.
+ */
+void SchroedingerSolverIterative::calculate()
+{
+    const size_t nz = _z.size();
+
+    // Get limits for search
+    const double E_min = _E_min_set ? _E_min : _V.min();
+    const double E_max = _E_max_set ? _E_max : _V.max();
+
+    // Find the range of state indices.  The number of states is only used
+    // if the energy limits haven't been specified
+    unsigned int ist_lo = _E_min_set ? count_states(E_min) : 0;
+    unsigned int ist_hi = count_states(E_max);
+
+    if(!_E_min_set && !_E_max_set && _nst_max > 0)
+        ist_hi = GSL_MIN(_nst_max, nz);
+
+    _solutions.clear();
+
+    if(ist_hi <= ist_lo)
+        return;
+
+    // Use the parabolic states as a starting point
+    arma::vec diag;
+    arma::vec sub;
+    make_hamiltonian(_me, diag, sub);
+    const auto guess = eigen_tridiag(diag, sub, 0, 0, ist_hi);
+
+    const unsigned int nst = ist_hi - ist_lo;
+    std::vector< EVP_solution<double> > states(nst, EVP_solution<double>(nz));
+
+    run_in_parallel(nst, 0, [&](const size_t i) {
+        const unsigned int ist = ist_lo + i;
+        states[i] = find_state(ist, guess.at(ist).get_E());
+    });
+
+    for (auto st : states)
+    {
+        const auto E = st.get_E();
+        const arma::vec psi = st.psi_array() / sqrt(_h); // Undo the symmetrising scale factor
+        _solutions.push_back(Eigenstate(E, _z_grid, psi));
+    }
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,61 @@
+/**
+ * \file   schroedinger-solver-iterative.h
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Declarations for nonparabolic Schroedinger solver using iteration of the mass
+ */
+
+#ifndef QWWAD_SCHROEDINGER_SOLVER_ITERATIVE_H
+#define QWWAD_SCHROEDINGER_SOLVER_ITERATIVE_H
+
+#include "schroedinger-solver.h"
+#include "linear-algebra.h"
+
+namespace QWWAD
+{
+/**
+ * \brief Nonparabolic Schroedinger solver, which iterates the energy-dependent mass for each state
+ *
+ * \details The Hamiltonian is tridiagonal for any fixed value of the effective mass.  Each state
+ *          is found by evaluating the mass at a trial energy, finding the corresponding
+ *          eigenvalue of the Hamiltonian and updating the trial energy until the two agree.
+ *          Only an nz x nz matrix is needed, rather than the 3nz x 3nz linearised problem
+ *          used by SchroedingerSolverFull.
+ */
+class SchroedingerSolverIterative : public SchroedingerSolver
+{
+private:
+    arma::vec _me;    ///< Band-edge effective mass [kg]
+    arma::vec _alpha; ///< Nonparabolicity parameter [1/J]
+    arma::vec _h;     ///< Width of the cell represented by each point [m]
+
+public:
+    SchroedingerSolverIterative(const decltype(_me)    &me,
+                                const decltype(_alpha) &alpha,
+                                const decltype(_V)     &V,
+                                const decltype(_z)     &z,
+                                const unsigned int      nst_max=0);
+
+    std::string get_name() {return "iterative-nonparabolic";}
+
+    void make_hamiltonian(const double  E,
+                          arma::vec    &diag,
+                          arma::vec    &sub) const;
+
+    unsigned int count_states(const double E) const;
+
+    EVP_solution<double> solve_at_energy(const unsigned int ist,
+                                         const double       E) const;
+
+private:
+    void calculate();
+
+    void make_hamiltonian(const arma::vec &m,
+                          arma::vec       &diag,
+                          arma::vec       &sub) const;
+
+    EVP_solution<double> find_state(const unsigned int ist,
+                                    const double       E_guess) const;
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
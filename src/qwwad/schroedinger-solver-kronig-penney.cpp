@@ -6,12 +6,16 @@
 
 #include "schroedinger-solver-kronig-penney.h"
 
+#include <algorithm>
 #include <cmath>
+#include <sstream>
+#include <stdexcept>
 #include <gsl/gsl_errno.h>
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_roots.h>
 #include "constants.h"
 #include "maths-helpers.h"
+#include "parallel.h"
 #include <complex>
 #include <armadillo>
 
@@ -207,24 +211,98 @@ double SchroedingerSolverKronigPenney::test_matching(double  energy,
     return match;
 }
 
-void SchroedingerSolverKronigPenney::calculate()
+/**
+ * \brief Find the energy of the next state above a given energy
+ *
+ * \param[in] E_lo    Lower limit for the energy of the state [J]
+ * \param[in] E_guess Approximate energy of the state, e.g., from a nearby point
+ *                    in a parameter sweep [J].  A value that does not lie above
+ *                    E_lo means that no estimate is available.
+ *
+ * \details If an estimate is given, it is first improved by a single Newton step
+ *          on the matching equation.  This tracks a miniband very closely as the
+ *          wave vector changes, since the estimate is then the root at a nearby
+ *          wave vector.  The search range is then grown outwards from the improved
+ *          estimate in small steps until the matching equation changes sign, so
+ *          that the root nearest to it is found and the Newton step can never jump
+ *          to another miniband.  Otherwise, or if no root is found near the
+ *          estimate, the range is grown upwards from E_lo.
+ */
+double SchroedingerSolverKronigPenney::find_E(const double E_lo,
+                                              const double E_guess) const
 {
     gsl_function F;
     F.function  = &test_matching;
-    F.params    = this;
-    auto solver = gsl_root_fsolver_alloc(gsl_root_fsolver_brent);
+    F.params    = const_cast<SchroedingerSolverKronigPenney *>(this);
 
     const auto dx=1e-3*e; // arbitrarily small energy increment---0.1meV
 
-    auto Elo=dx;    // first energy estimate
+    double Elo = E_lo;
+    double Ehi = E_lo;
+    bool   bracketed = false;
 
-    for (unsigned int ist=0; ist < _nst_max; ++ist)
+    if(E_guess > E_lo)
     {
-        // Shift the lower estimate up past the last state we found
-        if(ist > 0)
-            Elo = _solutions[ist-1].get_energy() + dx;
+        const unsigned int nsteps_max = 1000;
+
+        // Take a Newton step from the estimate, using a central-difference
+        // derivative of the matching equation.  The step is only accepted if
+        // it stays within the range that the bracket search would cover
+        const double dE = 1e-3*dx;
+        const double y_guess = GSL_FN_EVAL(&F, E_guess);
+        double E_seed = E_guess;
+
+        if(E_guess - dE > 0)
+        {
+            const double dy_dE  = (GSL_FN_EVAL(&F, E_guess + dE) - GSL_FN_EVAL(&F, E_guess - dE))/(2*dE);
+            const double E_newt = E_guess - y_guess/dy_dE;
+
+            if(gsl_finite(E_newt) && E_newt > E_lo && std::abs(E_newt - E_guess) < nsteps_max*dx)
+                E_seed = E_newt;
+        }
+
+        // Search outwards from the estimate, one step at a time on
+        // each side, until we straddle a root
+        double y_up = (E_seed == E_guess) ? y_guess : GSL_FN_EVAL(&F, E_seed);
+        double y_dn = y_up;
+
+        for(unsigned int istep = 1; istep <= nsteps_max && !bracketed; ++istep)
+        {
+            const double E_up = E_seed + istep*dx;
+            const double y_up_next = GSL_FN_EVAL(&F, E_up);
+
+            if(y_up*y_up_next <= 0)
+            {
+                Elo = E_up - dx;
+                Ehi = E_up;
+                bracketed = true;
+                break;
+            }
+
+            y_up = y_up_next;
+
+            const double E_dn = E_seed - istep*dx;
+
+            if(E_dn > E_lo)
+            {
+                const double y_dn_next = GSL_FN_EVAL(&F, E_dn);
+
+                if(y_dn*y_dn_next <= 0)
+                {
+                    Elo = E_dn;
+                    Ehi = E_dn + dx;
+                    bracketed = true;
+                }
+
+                y_dn = y_dn_next;
+            }
+        }
+    }
 
+    if(!bracketed)
+    {
         // Value for y=f(x) at bottom of search range
+        Elo = E_lo;
         const double y1 = GSL_FN_EVAL(&F,Elo);
 
         // Find the range in which the solution lies by incrementing the
@@ -238,27 +316,146 @@ void SchroedingerSolverKronigPenney::calculate()
         //
         // TODO: Make the cut-off configurable
         double y2 = y1;
-        double Ehi = Elo;
+        Ehi = Elo;
         do
         {
             Ehi+=dx;
             y2=GSL_FN_EVAL(&F, Ehi);
         }while((y1*y2>0)&&(Ehi<100 * _V0));
+    }
 
-        auto E = (Elo + Ehi) / 2.0; // Initial estimate of energy of state
-        gsl_root_fsolver_set(solver, &F, Elo, Ehi);
-        int status = 0;
+    auto solver = gsl_root_fsolver_alloc(gsl_root_fsolver_brent);
+    auto E = (Elo + Ehi) / 2.0; // Initial estimate of energy of state
+    gsl_root_fsolver_set(solver, &F, Elo, Ehi);
+    int status = 0;
 
-        // Improve the estimate of solution using the Brent algorithm
-        // until we hit a desired level of precision
-        do
+    // Improve the estimate of solution using the Brent algorithm
+    // until we hit a desired level of precision
+    do
+    {
+        status = gsl_root_fsolver_iterate(solver);
+        E   = gsl_root_fsolver_root(solver);
+        Elo = gsl_root_fsolver_x_lower(solver);
+        Ehi = gsl_root_fsolver_x_upper(solver);
+        status = gsl_root_test_interval(Elo, Ehi, 1e-9*e, 0.000001);
+    }while(status == GSL_CONTINUE);
+
+    gsl_root_fsolver_free(solver);
+
+    return E;
+}
+
+/**
+ * \brief Find the energies of the states without computing wavefunctions
+ *
+ * \param[in] E_guess Approximate energy of each state [J], e.g., from a nearby point
+ *                    in a parameter sweep.  This may be shorter than the number of
+ *                    states, or empty.
+ *
+ * \returns The energy of each state, up to the maximum number of states [J]
+ */
+arma::vec SchroedingerSolverKronigPenney::get_energies(const arma::vec &E_guess) const
+{
+    const auto dx=1e-3*e; // arbitrarily small energy increment---0.1meV
+    arma::vec E(_nst_max);
+
+    for (unsigned int ist=0; ist < _nst_max; ++ist)
+    {
+        // Shift the lower estimate up past the last state we found
+        const double Elo = (ist > 0) ? E(ist-1) + dx : dx;
+        const double E_guess_ist = (ist < E_guess.size()) ? E_guess(ist) : 0.0;
+        E(ist) = find_E(Elo, E_guess_ist);
+    }
+
+    return E;
+}
+
+/**
+ * \brief Find the energies for a sweep through a set of superlattices
+ *
+ * \param[in] l_w       Width of well at each point in the sweep [m]
+ * \param[in] l_b       Width of barrier at each point in the sweep [m]
+ * \param[in] V0        Barrier potential at each point in the sweep [J]
+ * \param[in] k         Wave vector at each point in the sweep [1/m]
+ * \param[in] m_w       Effective mass in well [kg]
+ * \param[in] m_b       Effective mass in barriers [kg]
+ * \param[in] nst_max   Number of states to find at each point
+ * \param[in] n_threads Number of threads to use (0 = one per CPU core)
+ *
+ * \returns A table of energies [J], with one row for each point in the sweep and one
+ *          column for each state.
+ *
+ * \details Only the matching equation is solved at each point, and the root for each
+ *          state is seeded from the one found at the previous point.  This avoids the
+ *          coarse upward scan through the spectrum that a single calculation needs,
+ *          which dominates the cost when tracing out a dispersion curve.
+ *
+ *          The points are split into contiguous blocks, which are found in parallel.
+ *          Only the first point in each block needs a full search.
+ */
+arma::mat SchroedingerSolverKronigPenney::sweep(const arma::vec    &l_w,
+                                                const arma::vec    &l_b,
+                                                const arma::vec    &V0,
+                                                const arma::vec    &k,
+                                                const double        m_w,
+                                                const double        m_b,
+                                                const unsigned int  nst_max,
+                                                unsigned int        n_threads)
+{
+    const size_t npts = l_w.size();
+
+    if(l_b.size() != npts || V0.size() != npts || k.size() != npts)
+    {
+        std::ostringstream oss;
+        oss << "Got " << npts << " well widths, " << l_b.size() << " barrier widths, "
+            << V0.size() << " barrier potentials and " << k.size() << " wave vectors for sweep.";
+        throw std::length_error(oss.str());
+    }
+
+    n_threads = get_thread_count(n_threads);
+
+    arma::mat E(npts, nst_max);
+
+    if(npts == 0)
+        return E;
+
+    const size_t n_blocks = std::min<size_t>(n_threads, npts);
+
+    run_in_parallel(n_blocks, n_blocks, [&](const size_t iblock) {
+        const size_t ipt_lo = iblock*npts/n_blocks;
+        const size_t ipt_hi = (iblock+1)*npts/n_blocks;
+
+        arma::vec E_prev; // Energies at previous point in the sweep [J]
+
+        for (size_t ipt = ipt_lo; ipt < ipt_hi; ++ipt)
         {
-            status = gsl_root_fsolver_iterate(solver);
-            E   = gsl_root_fsolver_root(solver);
-            Elo = gsl_root_fsolver_x_lower(solver);
-            Ehi = gsl_root_fsolver_x_upper(solver);
-            status = gsl_root_test_interval(Elo, Ehi, 1e-9*e, 0.000001);
-        }while(status == GSL_CONTINUE);
+            // Only the matching equations are needed, so the spatial mesh is minimal
+            const SchroedingerSolverKronigPenney se(l_w(ipt), l_b(ipt), V0(ipt), m_w, m_b, k(ipt), 1, 1, nst_max);
+            E_prev = se.get_energies(E_prev);
+            E.row(ipt) = E_prev.t();
+        }
+    });
+
+    return E;
+}
+
+void SchroedingerSolverKronigPenney::calculate()
+{
+    const auto dx=1e-3*e; // arbitrarily small energy increment---0.1meV
+
+    auto Elo=dx;    // first energy estimate
+    auto E_last=0.0; // Energy of the last state found [J]
+
+    for (unsigned int ist=0; ist < _nst_max; ++ist)
+    {
+        // Shift the lower estimate up past the last state we found
+        if(ist > 0)
+            Elo = E_last + dx;
+
+        // Start from the initial guess, if one was supplied
+        const double E_guess = (ist < _guess.size()) ? _guess[ist].get_energy() : 0.0;
+        const auto E = find_E(Elo, E_guess);
+        E_last = E;
 
         // Stop if we've exceeded the cut-off energy
         if(_E_max_set && gsl_fcmp(E, _E_max, e*1e-12) == 1)
@@ -271,11 +468,9 @@ void SchroedingerSolverKronigPenney::calculate()
         // Don't store the solution if it's below the minimum energy
         if(!(_E_min_set && gsl_fcmp(E, _E_min, e*1e-12) == -1))
         {
-            _solutions.push_back(Eigenstate(E, _z, psi));
+            _solutions.push_back(Eigenstate(E, _z_grid, psi));
         }
     }
-
-    gsl_root_fsolver_free(solver);
 }
 } // namespace
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
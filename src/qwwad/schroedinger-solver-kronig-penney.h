@@ -38,6 +38,17 @@ public:
     double get_lhs(const double v) const;
     double get_rhs() const;
 
+    arma::vec get_energies(const arma::vec &E_guess = arma::vec()) const;
+
+    static arma::mat sweep(const arma::vec    &l_w,
+                           const arma::vec    &l_b,
+                           const arma::vec    &V0,
+                           const arma::vec    &k,
+                           const double        m_w,
+                           const double        m_b,
+                           const unsigned int  nst_max,
+                           unsigned int        n_threads = 1);
+
 private:
     double _l_w; ///< Width of well [m]
     double _l_b; ///< Width of well [m]
@@ -48,6 +59,9 @@ private:
 
     void calculate();
 
+    double find_E(const double E_lo,
+                  const double E_guess) const;
+
     arma::cx_mat get_matching_matrix(const double E) const;
     arma::vec get_wavefunction(const double E) const;
 };
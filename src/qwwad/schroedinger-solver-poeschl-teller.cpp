@@ -7,12 +7,130 @@
 #include "schroedinger-solver-poeschl-teller.h"
 
 #include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <gsl/gsl_math.h>
 #include <gsl/gsl_sf_hyperg.h>
 #include "constants.h"
 
 namespace QWWAD
 {
 using namespace constants;
+
+/**
+ * \brief Create the wavefunction for a bound state in a Poeschl-Teller hole
+ *
+ * \param[in] alpha  Width parameter [1/m]
+ * \param[in] lambda Depth parameter
+ * \param[in] ist    Index of state (starting from zero)
+ *
+ * \details The wavefunction is taken from "Practical Quantum Mechanics", Flugge (1970).
+ *          The solution is a hypergeometric function, whose arguments and scaling
+ *          factor depend on whether the state has odd or even parity.
+ */
+PoeschlTellerWavefunction::PoeschlTellerWavefunction(const double       alpha,
+                                                     const double       lambda,
+                                                     const unsigned int ist) :
+    _alpha(alpha),
+    _lambda(lambda),
+    _ist(ist),
+    _arg1(0),
+    _arg2(0),
+    _arg3(0)
+{
+    const double kappa = _alpha * (_lambda-1-ist);
+
+    // Flugge, 39.24
+    const double a = 0.5 * (_lambda - kappa/_alpha);
+    const double b = 0.5 * (_lambda + kappa/_alpha);
+
+    if(ist % 2) // Odd-parity states (Flugge, 39.10b)
+    {
+        _arg1 = a+0.5;
+        _arg2 = b+0.5;
+        _arg3 = 1.5;
+    }
+    else // Even-parity states (Flugge, 39.10a)
+    {
+        _arg1 = a;
+        _arg2 = b;
+        _arg3 = 0.5;
+    }
+}
+
+/**
+ * \brief Find the (unnormalised) wavefunction at a given position
+ *
+ * \param[in] z Position relative to the centre of the hole [m]
+ */
+double PoeschlTellerWavefunction::operator()(const double z) const
+{
+    const double sinh_alpha_z = sinh(_alpha*z);
+    const double x            = -gsl_pow_2(sinh_alpha_z);
+
+    // Prefactor for hypergeometric function
+    double fact = pow(cosh(_alpha*z), _lambda);
+
+    if(_ist % 2)
+        fact *= sinh_alpha_z;
+
+    if(std::abs(x) < 1)
+        return fact * gsl_sf_hyperg_2F1(_arg1, _arg2, _arg3, x);
+
+    // If the argument is too large, we need to apply a linear
+    // transformation such that |x| < 1
+    if(gsl_fcmp(x/(x-1), 1, 0.0025) == -1)
+        return fact * pow(1-x, -_arg2) * gsl_sf_hyperg_2F1(_arg2, _arg3-_arg1, _arg3, x/(x-1));
+
+    // In case we're *very* close to x = 1, GSL can't cope, so we
+    // need to simplify things further, and just pass a large number
+    // as the argument.
+    // This seems to be OK, but might need a little investigation
+    return fact * pow(1-x, -_arg2) * gsl_sf_hyperg_2F1(_arg2, _arg3-_arg1, _arg3, 0.99);
+}
+
+/**
+ * \brief Check whether another wavefunction is for the same hole
+ */
+bool PoeschlTellerWavefunction::same_hole(const PoeschlTellerWavefunction &other) const
+{
+    return gsl_fcmp(_alpha, other._alpha, 1e-12) == 0 && gsl_fcmp(_lambda, other._lambda, 1e-12) == 0;
+}
+
+/**
+ * \brief The bound states in a single hole are orthonormal
+ */
+bool PoeschlTellerWavefunction::get_overlap(const AnalyticWavefunction &other,
+                                            double                     &S) const
+{
+    const auto st = dynamic_cast<const PoeschlTellerWavefunction *>(&other);
+
+    if(!st || !same_hole(*st))
+        return false;
+
+    S = (st->_ist == _ist) ? 1.0 : 0.0;
+    return true;
+}
+
+/**
+ * \brief Find the position matrix element with another state, using parity
+ *
+ * \details The matrix element vanishes between states of the same parity, which
+ *          includes the expectation position of each state.  There is no simple
+ *          closed form between states of opposite parity.
+ */
+bool PoeschlTellerWavefunction::get_position_matrix_element(const AnalyticWavefunction &other,
+                                                            double                     &z_ij) const
+{
+    const auto st = dynamic_cast<const PoeschlTellerWavefunction *>(&other);
+
+    if(!st || !same_hole(*st) || (_ist + st->_ist) % 2)
+        return false;
+
+    z_ij = 0;
+    return true;
+}
+
 /**
  * \brief Construct a Poeschl-Teller potential solver
  *
@@ -55,78 +173,74 @@ size_t SchroedingerSolverPoeschlTeller::get_n_bound() const
     return ceil(_lambda-1);
 }
 
-void SchroedingerSolverPoeschlTeller::calculate()
+/**
+ * \brief Find the bound-state energies for a sweep through a set of potential holes
+ *
+ * \param[in] alpha   Width parameter at each point in the sweep [1/m]
+ * \param[in] lambda  Depth parameter at each point in the sweep
+ * \param[in] mass    Effective mass [kg]
+ * \param[in] nst_max Maximum number of states to find.  If zero, all bound states are found.
+ *
+ * \returns A table of energies [J], with one row for each point in the sweep and one
+ *          column for each state.  States that are not bound at a given point are
+ *          set to NaN.
+ *
+ * \details The energies are known analytically [QWWAD4, 3.60], so no wavefunctions
+ *          or potential profiles are computed.
+ */
+arma::mat SchroedingerSolverPoeschlTeller::sweep(const arma::vec    &alpha,
+                                                 const arma::vec    &lambda,
+                                                 const double        mass,
+                                                 const unsigned int  nst_max)
 {
-    const size_t nst = get_n_bound();
-    const size_t nz  = _z.size();
+    if(alpha.size() != lambda.size())
+    {
+        std::ostringstream oss;
+        oss << "Got " << alpha.size() << " width parameters and " << lambda.size() << " depth parameters for sweep.";
+        throw std::length_error(oss.str());
+    }
 
-    const arma::vec sinh_alpha_z = sinh(_alpha*_z);
-    const arma::vec _x = -arma::square(sinh_alpha_z);
+    const size_t npts = alpha.size();
 
-    for (unsigned int ist=0; (_nst_max == 0 || ist < _nst_max) && ist < nst; ++ist)
+    // Find the largest number of states that will be needed
+    size_t nst = nst_max;
+
+    if(nst == 0)
     {
-        // Energy is found using [QWWAD4, 3.60]
-        const double kappa = _alpha * (_lambda-1-ist);
-        const double E = -gsl_pow_2(hBar * kappa) / (2.0*_mass);
+        for (unsigned int ipt = 0; ipt < npts; ++ipt)
+            nst = GSL_MAX(nst, static_cast<size_t>(ceil(lambda(ipt)-1)));
+    }
 
-        // Wavefunction is taken from "Practical Quantum Mechanics", Flugge (1970).
-        // The solution is a hypergeometric function, whose arguments and scaling
-        // factor depend on whether the state has odd or even parity.
-        
-        double arg1, arg2, arg3;    // Arguments for hypergeometric function
-        arma::vec fact; // Prefactor for hypergeometric function
+    arma::mat E(npts, nst);
+    E.fill(NAN);
 
-        // Flugge, 39.24
-        const double a = 0.5 * (_lambda - kappa/_alpha);
-        const double b = 0.5 * (_lambda + kappa/_alpha);
+    for (unsigned int ipt = 0; ipt < npts; ++ipt)
+    {
+        const size_t nst_bound = ceil(lambda(ipt)-1);
 
-        if(ist % 2) // Odd-parity states
-        {
-            // From Flugge, 39.10b
-            arg1 = a+0.5;
-            arg2 = b+0.5;
-            arg3 = 1.5;
-            fact = pow(cosh(_alpha*_z),_lambda) % sinh_alpha_z;
-        }
-        else // Even-parity states
+        for (unsigned int ist = 0; ist < nst && ist < nst_bound; ++ist)
         {
-            // From Flugge, 39.10a
-            arg1 = a;
-            arg2 = b;
-            arg3 = 0.5;
-            fact = pow(cosh(_alpha*_z),_lambda);
+            const double kappa = alpha(ipt) * (lambda(ipt)-1-ist);
+            E(ipt, ist) = -gsl_pow_2(hBar * kappa) / (2.0*mass);
         }
+    }
 
-        arma::vec psi = arma::zeros(nz); // Wavefunction amplitude at each point [m^{-0.5}]
+    return E;
+}
 
-        for(unsigned int iz = 0; iz < nz; ++iz)
-        {
-            if(std::abs(_x(iz)) < 1)
-            {
-                psi(iz) = fact(iz) *
-                          gsl_sf_hyperg_2F1(arg1, arg2, arg3, _x(iz));
-            }
-            // If the argument is too large, we need to apply a linear
-            // transformation such that |_x| < 1
-            else if(gsl_fcmp(_x[iz]/(_x[iz]-1), 1, 0.0025) == -1)
-            {
-                psi[iz] = fact[iz] *
-                          pow(1-_x[iz],-arg2) *
-                          gsl_sf_hyperg_2F1(arg2, arg3-arg1, arg3, _x[iz]/(_x[iz]-1));
-            }
-            // In case we're *very* close to _x = 1, GSL can't cope, so we
-            // need to simplify things further, and just pass a large number
-            // as the argument.
-            // This seems to be OK, but might need a little investigation
-            else
-            {
-                psi[iz] = fact[iz] *
-                          pow(1-_x[iz],-arg2) *
-                          gsl_sf_hyperg_2F1(arg2, arg3-arg1, arg3, 0.99);
-            }
-        }
+void SchroedingerSolverPoeschlTeller::calculate()
+{
+    const size_t nst = get_n_bound();
+
+    for (unsigned int ist=0; (_nst_max == 0 || ist < _nst_max) && ist < nst; ++ist)
+    {
+        // Energy is found using [QWWAD4, 3.60]
+        const double kappa = _alpha * (_lambda-1-ist);
+        const double E = -gsl_pow_2(hBar * kappa) / (2.0*_mass);
 
-        _solutions.push_back(Eigenstate(E, _z, psi));
+        // The wavefunction is only sampled onto the grid if it is needed
+        _solutions.push_back(Eigenstate(E, _z_grid,
+                                        std::make_shared<PoeschlTellerWavefunction>(_alpha, _lambda, ist)));
     }
 }
 } // namespace
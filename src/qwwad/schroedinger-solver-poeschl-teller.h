@@ -11,6 +11,39 @@
 
 namespace QWWAD
 {
+/**
+ * \brief Closed-form wavefunction of a bound state in a Poeschl-Teller potential hole
+ *
+ * \details The wavefunction is a hypergeometric function [Flugge, 39].  The states
+ *          in a single hole are orthogonal, and have definite parity about the
+ *          centre of the hole (z = 0).
+ */
+class PoeschlTellerWavefunction : public AnalyticWavefunction
+{
+public:
+    PoeschlTellerWavefunction(const double       alpha,
+                              const double       lambda,
+                              const unsigned int ist);
+
+    double operator()(const double z) const;
+
+    bool get_overlap(const AnalyticWavefunction &other,
+                     double                     &S) const;
+
+    bool get_position_matrix_element(const AnalyticWavefunction &other,
+                                     double                     &z_ij) const;
+
+private:
+    double       _alpha;  ///< Width parameter [1/m]
+    double       _lambda; ///< Depth parameter
+    unsigned int _ist;    ///< Index of state (starting from zero)
+    double       _arg1;   ///< First parameter of hypergeometric function
+    double       _arg2;   ///< Second parameter of hypergeometric function
+    double       _arg3;   ///< Third parameter of hypergeometric function
+
+    bool same_hole(const PoeschlTellerWavefunction &other) const;
+};
+
 /**
  * Schroedinger solver for a Poeschl-Teller potential hole
  */
@@ -26,6 +59,11 @@ public:
 
     std::string get_name() {return "poeschl-teller-potential-hole";}
     size_t get_n_bound() const;
+
+    static arma::mat sweep(const arma::vec    &alpha,
+                           const arma::vec    &lambda,
+                           const double        mass,
+                           const unsigned int  nst_max = 0);
 private:
     double _alpha;  ///< Width parameter [1/m]
     double _lambda; ///< Depth parameter
@@ -0,0 +1,422 @@
+/**
+ * \file   schroedinger-solver-radial.cpp
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \author Paul Harrison <p.harrison@shu.ac.uk>
+ * \brief  Shooting-method solvers in spherical and cylindrical geometry
+ */
+
+#include "schroedinger-solver-radial.h"
+
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_math.h>
+#include <gsl/gsl_roots.h>
+
+#include <sstream>
+#include <stdexcept>
+
+#include "constants.h"
+#include "parallel.h"
+#include "profiler.h"
+
+namespace QWWAD
+{
+using namespace constants;
+
+/**
+ * \brief Set system parameters for solver
+ *
+ * \param[in] me      Band-edge effective mass [kg]
+ * \param[in] alpha   Nonparabolicity parameter [1/J]
+ * \param[in] V       Confining potential [J]
+ * \param[in] r       Radial locations [m].  These must be evenly spaced, starting at r >= 0.
+ * \param[in] dE      Initial energy step for extending search range [J]
+ * \param[in] d       Coefficient of the first-derivative term (2 for a sphere, 1 for a cylinder)
+ * \param[in] lambda  Angular momentum quantum number
+ * \param[in] nst_max Maximum number of states to find
+ */
+SchroedingerSolverRadial::SchroedingerSolverRadial(const decltype(_me)    &me,
+                                                   const decltype(_alpha) &alpha,
+                                                   const decltype(_V)     &V,
+                                                   const decltype(_z)     &r,
+                                                   const double            dE,
+                                                   const unsigned int      d,
+                                                   const unsigned int      lambda,
+                                                   const unsigned int      nst_max) :
+    SchroedingerSolver(V,r,nst_max),
+    _me(me),
+    _alpha(alpha),
+    _dE(dE),
+    _d(d),
+    _lambda(lambda),
+    _L(lambda*(lambda + d - 1.0))
+{
+    if(r.size() < 3 || r[0] < 0 || r[1] <= r[0])
+    {
+        std::ostringstream oss;
+        oss << "Radial solver needs at least 3 increasing, non-negative radii";
+        throw std::invalid_argument(oss.str());
+    }
+}
+
+/**
+ * \brief Create a solver for a spherical quantum dot
+ *
+ * \param[in] me      Band-edge effective mass [kg]
+ * \param[in] alpha   Nonparabolicity parameter [1/J]
+ * \param[in] V       Confining potential [J]
+ * \param[in] r       Radial locations [m]
+ * \param[in] dE      Initial energy step for extending search range [J]
+ * \param[in] l       Orbital angular momentum quantum number
+ * \param[in] nst_max Maximum number of states to find
+ */
+SchroedingerSolverSphericalDot::SchroedingerSolverSphericalDot(const arma::vec    &me,
+                                                               const arma::vec    &alpha,
+                                                               const arma::vec    &V,
+                                                               const arma::vec    &r,
+                                                               const double        dE,
+                                                               const unsigned int  l,
+                                                               const unsigned int  nst_max) :
+    SchroedingerSolverRadial(me, alpha, V, r, dE, 2, l, nst_max)
+{}
+
+/**
+ * \brief Create a solver for a cylindrical quantum wire
+ *
+ * \param[in] me      Band-edge effective mass [kg]
+ * \param[in] alpha   Nonparabolicity parameter [1/J]
+ * \param[in] V       Confining potential [J]
+ * \param[in] r       Radial locations [m]
+ * \param[in] dE      Initial energy step for extending search range [J]
+ * \param[in] m       Angular momentum quantum number
+ * \param[in] nst_max Maximum number of states to find
+ */
+SchroedingerSolverCylindricalWire::SchroedingerSolverCylindricalWire(const arma::vec    &me,
+                                                                     const arma::vec    &alpha,
+                                                                     const arma::vec    &V,
+                                                                     const arma::vec    &r,
+                                                                     const double        dE,
+                                                                     const unsigned int  m,
+                                                                     const unsigned int  nst_max) :
+    SchroedingerSolverRadial(me, alpha, V, r, dE, 1, m, nst_max)
+{}
+
+/**
+ * \brief Widen a range of energies around an estimate, until it contains a given state
+ *
+ * \param[in]     ist     Index of the state (0 for the ground state)
+ * \param[in]     E_guess Estimated energy of the state [J]
+ * \param[in,out] Elo     On input, the lowest permitted energy.  On output, an energy
+ *                        below the state [J]
+ * \param[in,out] Ehi     On input, the highest permitted energy.  On output, an energy
+ *                        above the state [J]
+ *
+ * \details The range starts at +/- dE around the estimate, and its width is doubled on
+ *          each side until the node counts show that it contains the state.  A good
+ *          estimate, e.g., from a previous point in a sweep, therefore gives a much
+ *          narrower range than the whole potential.
+ */
+void SchroedingerSolverRadial::widen_around_guess(const unsigned int  ist,
+                                                  const double        E_guess,
+                                                  double             &Elo,
+                                                  double             &Ehi) const
+{
+    const double E_floor   = Elo;
+    const double E_ceiling = Ehi;
+
+    if(E_guess <= E_floor || E_guess >= E_ceiling)
+        return;
+
+    double step = _dE;
+    Elo = GSL_MAX_DBL(E_guess - step, E_floor);
+
+    while(Elo > E_floor && count_nodes(Elo) > ist)
+    {
+        step *= 2;
+        Elo   = GSL_MAX_DBL(E_guess - step, E_floor);
+    }
+
+    step = _dE;
+    Ehi  = GSL_MIN_DBL(E_guess + step, E_ceiling);
+
+    while(Ehi < E_ceiling && count_nodes(Ehi) <= ist)
+    {
+        step *= 2;
+        Ehi   = GSL_MIN_DBL(E_guess + step, E_ceiling);
+    }
+}
+
+/**
+ * \brief Narrow a range of energies until it contains exactly one state
+ *
+ * \param[in]     ist Index of the state (0 for the ground state)
+ * \param[in,out] Elo Lower limit of the range [J].  On input, this must lie below the state.
+ * \param[in,out] Ehi Upper limit of the range [J].  On input, this must lie above the state.
+ *
+ * \details The range is bisected until the lower limit has exactly ist nodes and the
+ *          upper limit has ist+1 nodes.
+ */
+void SchroedingerSolverRadial::bracket_state(const unsigned int  ist,
+                                             double             &Elo,
+                                             double             &Ehi) const
+{
+    auto nodes_lo = count_nodes(Elo);
+    auto nodes_hi = count_nodes(Ehi);
+
+    for(unsigned int iter = 0;
+        (nodes_lo != ist || nodes_hi != ist+1) && iter < 200;
+        ++iter)
+    {
+        const double E_mid = (Elo + Ehi)/2;
+
+        if(E_mid == Elo || E_mid == Ehi)
+            break;
+
+        const auto nodes_mid = count_nodes(E_mid);
+
+        if(nodes_mid <= ist)
+        {
+            Elo      = E_mid;
+            nodes_lo = nodes_mid;
+        }
+        else
+        {
+            Ehi      = E_mid;
+            nodes_hi = nodes_mid;
+        }
+    }
+}
+
+/**
+ * \brief Find the energy of a single state
+ *
+ * \param[in] ist    Index of the state to find (0 for the ground state)
+ * \param[in] Elo    Energy below the state [J]
+ * \param[in] Ehi    Energy above the state [J]
+ * \param[in] solver Root-finding workspace to use
+ *
+ * \returns The energy of the state [J]
+ */
+double SchroedingerSolverRadial::find_state(const unsigned int  ist,
+                                            double              Elo,
+                                            double              Ehi,
+                                            gsl_root_fsolver   *solver) const
+{
+    Workspace ws = {this, arma::vec(_z.size())};
+
+    gsl_function f;
+    f.function  = &psi_at_inf;
+    f.params    = &ws;
+
+    bracket_state(ist, Elo, Ehi);
+
+    const auto y1 = GSL_FN_EVAL(&f, Elo);
+    const auto y2 = GSL_FN_EVAL(&f, Ehi);
+
+    if(y1*y2 > 0)
+    {
+        std::ostringstream oss;
+        oss << "Could not isolate state " << ist << " between "
+            << Elo*1000/e << " and " << Ehi*1000/e << " meV";
+        throw std::runtime_error(oss.str());
+    }
+
+    QWWAD_COUNT("radial shooting states");
+
+    double E = (Elo + Ehi)/2;
+    gsl_root_fsolver_set(solver, &f, Elo, Ehi);
+    int status = 0;
+
+    do
+    {
+        QWWAD_COUNT("radial shooting Brent iterations");
+
+        status = gsl_root_fsolver_iterate(solver);
+        E   = gsl_root_fsolver_root(solver);
+        Elo = gsl_root_fsolver_x_lower(solver);
+        Ehi = gsl_root_fsolver_x_upper(solver);
+        status = gsl_root_test_interval(Elo, Ehi, 1e-12*e, 0);
+    }while(status == GSL_CONTINUE);
+
+    return E;
+}
+
+/**
+ * \brief Find solution to eigenvalue problem
+ *
+ * \details If an initial guess has been given (see set_initial_guess), the search
+ *          for each state starts from the energy of the corresponding guessed
+ *          state.  If a lower cut-off energy has been set (see set_E_min), the
+ *          search starts there and the requested number of states are the ones
+ *          above it.  The states are shared between threads.
+ */
+void SchroedingerSolverRadial::calculate()
+{
+    // No states can lie below the potential minimum.  If a lower cut-off is set,
+    // the search starts there instead, and the states below it are skipped.
+    double E_floor = _V.min();
+
+    if(_E_min_set && _E_min > E_floor)
+        E_floor = _E_min;
+
+    const unsigned int ist_first = count_nodes(E_floor); // Index of the first state to find
+
+    // Find an upper limit for the search.  If the number of states is specified, this might
+    // need to lie above the top of the potential
+    double E_ceiling = _E_max_set ? _E_max : _V.max();
+
+    if(E_ceiling <= E_floor)
+        E_ceiling = E_floor + _dE;
+
+    if(_nst_max > 0)
+    {
+        double width = GSL_MAX_DBL(E_ceiling - E_floor, _dE);
+
+        for(unsigned int iter = 0; count_nodes(E_ceiling) < ist_first + _nst_max && iter < 100; ++iter)
+        {
+            E_ceiling += width;
+            width     *= 2;
+        }
+    }
+
+    unsigned int nst = count_nodes(E_ceiling) - ist_first;
+
+    if(_nst_max > 0 && _nst_max < nst)
+        nst = _nst_max;
+
+    if(nst == 0)
+        return;
+
+    std::vector<double> E_states(nst);
+
+    run_in_parallel(nst, 0, [&](const size_t ist) {
+        double Elo = E_floor;
+        double Ehi = E_ceiling;
+
+        if(ist < _guess.size())
+            widen_around_guess(ist_first + ist, _guess[ist].get_energy(), Elo, Ehi);
+
+        auto solver = gsl_root_fsolver_alloc(gsl_root_fsolver_brent);
+
+        try
+        {
+            E_states[ist] = find_state(ist_first + ist, Elo, Ehi, solver);
+        }
+        catch(...)
+        {
+            gsl_root_fsolver_free(solver);
+            throw;
+        }
+
+        gsl_root_fsolver_free(solver);
+    });
+
+    for(unsigned int ist=0; ist < nst; ++ist)
+    {
+        const auto E = E_states[ist];
+
+        // Stop if we've exceeded the cut-off energy
+        if(_E_max_set && gsl_fcmp(E, _E_max, e*1e-12) == 1)
+            break;
+
+        arma::vec psi(_z.size());
+        shoot_wavefunction(psi, E);
+
+        _solutions.push_back(Eigenstate(E,_z_grid,psi));
+    }
+}
+
+/**
+ * \brief Find the wavefunction at the outer edge of the system
+ *
+ * \param[in] E      Energy [J]
+ * \param[in] params Pointer to the Workspace of the calling thread
+ *
+ * \returns The wavefunction amplitude at the largest radius
+ */
+double SchroedingerSolverRadial::psi_at_inf(double  E,
+                                            void   *params)
+{
+    const auto ws = reinterpret_cast<Workspace *>(params);
+    return ws->se->shoot_wavefunction(ws->psi, E);
+}
+
+/**
+ * \brief Find the number of states below a given energy
+ *
+ * \param[in] E Energy [J]
+ *
+ * \returns The number of nodes in the wavefunction at energy E
+ */
+unsigned int SchroedingerSolverRadial::count_nodes(const double E) const
+{
+    arma::vec    psi(_z.size());
+    unsigned int n_nodes = 0;
+    shoot_wavefunction(psi, E, n_nodes);
+    return n_nodes;
+}
+
+/**
+ * \brief Compute the wavefunction for a given energy
+ *
+ * \param[out] wf Wavefunction at each point (not normalised)
+ * \param[in]  E  Energy [J]
+ *
+ * \returns The wavefunction amplitude at the largest radius
+ */
+double SchroedingerSolverRadial::shoot_wavefunction(arma::vec    &wf,
+                                                    const double  E) const
+{
+    unsigned int n_nodes = 0;
+    return shoot_wavefunction(wf, E, n_nodes);
+}
+
+/**
+ * \brief Compute the wavefunction for a given energy, and count its nodes
+ *
+ * \param[out] wf      Wavefunction at each point (not normalised)
+ * \param[in]  E       Energy [J]
+ * \param[out] n_nodes Number of nodes in the wavefunction
+ *
+ * \details The central-difference form of the radial equation is [QWWAD3, Eq. 8.54]
+ *          \f[
+ *            \psi_{i+1}\left(1 + \frac{d\delta r}{2r}\right)
+ *              = \left[\frac{2m^*\delta r^2}{\hbar^2}(V-E) + 2 + \frac{L\delta r^2}{r^2}\right]\psi_i
+ *              - \left(1 - \frac{d\delta r}{2r}\right)\psi_{i-1}.
+ *          \f]
+ *          The wavefunction starts as \f$(r/\delta r)^\lambda\f$, which gives the
+ *          boundary condition \f$\psi_0 = \psi_1\f$ for states with no angular
+ *          momentum [QWWAD3, Eq. 8.55].
+ *
+ * \returns The wavefunction amplitude at the largest radius
+ */
+double SchroedingerSolverRadial::shoot_wavefunction(arma::vec    &wf,
+                                                    const double  E,
+                                                    unsigned int &n_nodes) const
+{
+    const size_t nr  = _z.size();
+    const double dr  = _z[1] - _z[0];
+    const double dr2 = dr*dr;
+
+    wf.set_size(nr);
+    wf[0] = pow(_z[0]/dr, _lambda);
+    wf[1] = pow(_z[1]/dr, _lambda);
+
+    n_nodes = 0;
+
+    for(unsigned int i = 1; i < nr-1; ++i)
+    {
+        const double r = _z[i];
+        const double m = _me[i]*(1.0 + _alpha[i]*(E - _V[i])); // Mass at this energy [QWWAD3, 3.76]
+        const double c = _d*dr/(2.0*r);
+
+        wf[i+1] = ((2.0*m*dr2/(hBar*hBar)*(_V[i] - E) + 2.0 + _L*dr2/(r*r))*wf[i]
+                   - (1.0 - c)*wf[i-1]) / (1.0 + c);
+
+        if(wf[i+1]*wf[i] < 0)
+            ++n_nodes;
+    }
+
+    return wf[nr-1];
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,132 @@
+/**
+ * \file   schroedinger-solver-radial.h
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Declarations for shooting-method solvers in spherical and cylindrical geometry
+ */
+
+#ifndef QWWAD_SCHROEDINGER_SOLVER_RADIAL_H
+#define QWWAD_SCHROEDINGER_SOLVER_RADIAL_H
+
+#include "schroedinger-solver.h"
+
+#include <gsl/gsl_roots.h>
+
+namespace QWWAD
+{
+/**
+ * \brief Shooting-method solver for the radial part of a separable 3D problem
+ *
+ * \details The potential depends only on the distance, r, from the centre of a
+ *          spherical dot, or from the axis of a cylindrical wire.  The radial
+ *          wavefunction then satisfies
+ *          \f[
+ *            \frac{d^2\psi}{dr^2} + \frac{d}{r}\frac{d\psi}{dr} - \frac{L}{r^2}\psi
+ *              = \frac{2m^*(E)}{\hbar^2}(V-E)\psi,
+ *          \f]
+ *          where d = 2 and L = l(l+1) for a sphere, or d = 1 and L = m^2 for a
+ *          cylinder.  The wavefunction is started at the origin as \f$r^\lambda\f$,
+ *          where \f$\lambda\f$ is the angular momentum quantum number.
+ *
+ *          As in SchroedingerSolverShooting, each state is isolated by counting
+ *          the nodes of the wavefunction and is then found using the Brent
+ *          algorithm.  The spatial points must be evenly spaced.
+ */
+class SchroedingerSolverRadial : public SchroedingerSolver
+{
+private:
+    arma::vec    _me;     ///< Band-edge effective mass [kg]
+    arma::vec    _alpha;  ///< Nonparabolicity parameter [J^{-1}]
+    double       _dE;     ///< Initial energy step for extending search range [J]
+    unsigned int _d;      ///< Coefficient of the first-derivative term
+    unsigned int _lambda; ///< Angular momentum quantum number
+    double       _L;      ///< Coefficient of the centrifugal term
+
+protected:
+    SchroedingerSolverRadial(const decltype(_me)    &me,
+                             const decltype(_alpha) &alpha,
+                             const decltype(_V)     &V,
+                             const decltype(_z)     &r,
+                             const double            dE,
+                             const unsigned int      d,
+                             const unsigned int      lambda,
+                             const unsigned int      nst_max);
+
+public:
+    /**
+     * \brief Working storage for shooting at trial energies
+     *
+     * \details The solver is only read while shooting, so several threads may
+     *          share one solver, provided that each has its own workspace
+     */
+    struct Workspace
+    {
+        const SchroedingerSolverRadial *se;  ///< Solver whose configuration is used
+        arma::vec                       psi; ///< Wavefunction at the latest trial energy
+    };
+
+    static double psi_at_inf(double  E,
+                             void   *params);
+
+    double shoot_wavefunction(arma::vec    &wf,
+                              const double  E) const;
+
+    double shoot_wavefunction(arma::vec    &wf,
+                              const double  E,
+                              unsigned int &n_nodes) const;
+
+    unsigned int count_nodes(const double E) const;
+
+private:
+    void calculate();
+
+    void widen_around_guess(const unsigned int  ist,
+                            const double        E_guess,
+                            double             &Elo,
+                            double             &Ehi) const;
+
+    void bracket_state(const unsigned int  ist,
+                       double             &Elo,
+                       double             &Ehi) const;
+
+    double find_state(const unsigned int  ist,
+                      double              Elo,
+                      double              Ehi,
+                      gsl_root_fsolver   *solver) const;
+};
+
+/**
+ * \brief Radial solver for a spherically-symmetric quantum dot
+ */
+class SchroedingerSolverSphericalDot : public SchroedingerSolverRadial
+{
+public:
+    SchroedingerSolverSphericalDot(const arma::vec    &me,
+                                   const arma::vec    &alpha,
+                                   const arma::vec    &V,
+                                   const arma::vec    &r,
+                                   const double        dE,
+                                   const unsigned int  l=0,
+                                   const unsigned int  nst_max=0);
+
+    std::string get_name() {return "spherical-dot";}
+};
+
+/**
+ * \brief Radial solver for a cylindrical quantum wire
+ */
+class SchroedingerSolverCylindricalWire : public SchroedingerSolverRadial
+{
+public:
+    SchroedingerSolverCylindricalWire(const arma::vec    &me,
+                                      const arma::vec    &alpha,
+                                      const arma::vec    &V,
+                                      const arma::vec    &r,
+                                      const double        dE,
+                                      const unsigned int  m=0,
+                                      const unsigned int  nst_max=0);
+
+    std::string get_name() {return "cylindrical-wire";}
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -11,12 +11,62 @@
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_roots.h>
 
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
 #include "maths-helpers.h"
+#include "parallel.h"
 #include "constants.h"
+#include "profiler.h"
 
 namespace QWWAD
 {
 using namespace constants;
+
+namespace
+{
+/// Mass policy for a parabolic band, in which the mass does not depend on energy
+struct ParabolicMass
+{
+    static double mass(const double m0, const double /* m1 */, const double /* E */) {return m0;}
+};
+
+/// Mass policy for a nonparabolic band, in which the mass is a linear function of energy
+struct NonparabolicMass
+{
+    static double mass(const double m0, const double m1, const double E) {return m0 + m1*E;}
+};
+
+/// Profile policy for a structure in which the mass varies with position
+struct VariableMassProfile
+{
+    static double ratio(const double m_next, const double m_prev) {return m_next/m_prev;}
+};
+
+/// Profile policy for a structure in which the mass is the same at every point
+struct UniformMassProfile
+{
+    static double ratio(const double /* m_next */, const double /* m_prev */) {return 1.0;}
+};
+
+/**
+ * \brief Weight of a sample in the normalisation integral
+ *
+ * \details These match the rule used by integral()
+ */
+inline double normalisation_weight(const size_t i,
+                                   const size_t nz,
+                                   const double dz)
+{
+    if(nz >= 3 && !GSL_IS_EVEN(nz))
+        return ((i == 0 || i == nz-1) ? 1.0 : (GSL_IS_EVEN(i) ? 2.0 : 4.0)) * dz/3.0;
+    else
+        return ((i == 0 || i == nz-1) ? 0.5 : 1.0) * dz;
+}
+} // namespace
+
 /**
  * \brief Set system parameters for solver
  *
@@ -24,82 +74,263 @@ using namespace constants;
  * \param[in] alpha   Nonparabolicity parameter [1/J]
  * \param[in] V       Band-edge potential [J]
  * \param[in] z       Spatial locations [m]
- * \param[in] dE      Minimum energy separation between states [J]
+ * \param[in] dE      Initial energy step for extending search range [J]
  * \param[in] nst_max Maximum number of states to find
+ * \param[in] numerov Use the fourth-order Numerov method to propagate wavefunctions
+ *                    wherever the effective mass is locally uniform
  */
 SchroedingerSolverShooting::SchroedingerSolverShooting(const decltype(_me)    &me,
                                                        const decltype(_alpha) &alpha,
                                                        const decltype(_V)     &V,
                                                        const decltype(_z)     &z,
                                                        const double            dE,
-                                                       const unsigned int      nst_max) :
+                                                       const unsigned int      nst_max,
+                                                       const bool              numerov) :
     SchroedingerSolver(V,z,nst_max),
     _me(me),
     _alpha(alpha),
-    _dE(dE)
+    _dE(dE),
+    _coeffs(z.size(), N_COEFFS),
+    _weight_0(0.0),
+    _numerov(numerov),
+    _parabolic(true),
+    _mass_constant(true)
 {
+    check_uniform_mesh(z, "The shooting-method Schroedinger solver");
+
+    const size_t nz    = z.size();
+    const double dz    = z(1) - z(0);
+    const double scale = 2*dz*dz/(hBar*hBar);
+
+    // Band-edge mass at each point, split into energy-independent and
+    // energy-dependent parts
+    const arma::vec m0 = me%(1.0 - alpha%V);
+    const arma::vec m1 = me%alpha;
+
+    _weight_0 = normalisation_weight(0, nz, dz);
+
+    for(unsigned int i = 0; i < nz; ++i)
+    {
+        const unsigned int i_prev = (i > 0)    ? i-1 : i;
+        const unsigned int i_next = (i < nz-1) ? i+1 : i;
+
+        // Mass at z(i) -/+ dz/2.  We assume a constant mass beyond each end of the structure
+        const double m_prev_0 = (m0(i_prev) + m0(i))/2.0;
+        const double m_prev_1 = (m1(i_prev) + m1(i))/2.0;
+        const double m_next_0 = (m0(i_next) + m0(i))/2.0;
+        const double m_next_1 = (m1(i_next) + m1(i))/2.0;
+
+        // The Numerov method only applies where the mass doesn't vary, i.e., away from
+        // heterointerfaces.  Check each point and its neighbours
+        const bool mass_uniform = (gsl_fcmp(m0(i_prev), m0(i), 1e-12) == 0 &&
+                                   gsl_fcmp(m0(i_next), m0(i), 1e-12) == 0 &&
+                                   m1(i_prev) == m1(i) && m1(i_next) == m1(i));
+
+        _coeffs(i, COEFF_V)           = V(i);
+        _coeffs(i, COEFF_V_PREV)      = V(i_prev);
+        _coeffs(i, COEFF_V_NEXT)      = V(i_next);
+        _coeffs(i, COEFF_M_PREV_0)    = scale*m_prev_0;
+        _coeffs(i, COEFF_M_PREV_1)    = scale*m_prev_1;
+        _coeffs(i, COEFF_M_NEXT_0)    = scale*m_next_0;
+        _coeffs(i, COEFF_M_NEXT_1)    = scale*m_next_1;
+        _coeffs(i, COEFF_NUMEROV_0)   = scale*m0(i)/12.0;
+        _coeffs(i, COEFF_NUMEROV_1)   = scale*m1(i)/12.0;
+        _coeffs(i, COEFF_WEIGHT)      = (i != nz-1) ? normalisation_weight(i+1, nz, dz) : 0.0;
+        _coeffs(i, COEFF_USE_NUMEROV) = (numerov && mass_uniform) ? 1.0 : 0.0;
+    }
+
+    // Choose the simplest form of the shooting kernel that describes the system
+    for(unsigned int i = 0; i < nz; ++i)
+    {
+        if(m1(i) != 0.0)
+            _parabolic = false;
+
+        if(m0(i) != m0(0) || m1(i) != m1(0))
+            _mass_constant = false;
+    }
 }
 
 /**
- * Find solution to eigenvalue problem
+ * \brief Find an energy range that contains exactly one given state
+ *
+ * \param[in]     ist Index of the state to find (0 for the ground state)
+ * \param[in,out] Elo Lower limit of the range [J].  On input, this must lie below the state.
+ * \param[in,out] Ehi Upper limit of the range [J].  On input, this must lie above the state.
+ *
+ * \details The number of nodes in the wavefunction at a given energy equals the number
+ *          of states below that energy.  The range is therefore split into several
+ *          parts, which are tested together using shoot_multiple, and narrowed until
+ *          the lower limit has exactly ist nodes and the upper limit has ist+1 nodes,
+ *          which guarantees that the range contains state ist and no other state,
+ *          however closely spaced the states are.
  */
-void SchroedingerSolverShooting::calculate()
+void SchroedingerSolverShooting::bracket_state(const unsigned int  ist,
+                                               double             &Elo,
+                                               double             &Ehi) const
 {
-    double Elo=_V.min() + _dE;    // first energy estimate
+    // Number of trial energies to test in each pass through the mesh
+    const unsigned int n_trial = 8;
+
+    arma::vec  E_trial(n_trial);
+    arma::vec  psi_inf(n_trial);
+    arma::uvec n_nodes(n_trial);
+
+    auto nodes_lo = count_nodes(Elo);
+    auto nodes_hi = count_nodes(Ehi);
+
+    for(unsigned int iter = 0;
+        (nodes_lo != ist || nodes_hi != ist+1) && iter < 100;
+        ++iter)
+    {
+        // Split the interval into equal parts and find the node count at each division
+        const double step = (Ehi - Elo)/(n_trial + 1);
+
+        if(Elo + step == Elo || Ehi - step == Ehi)
+            break;
+
+        for(unsigned int k = 0; k < n_trial; ++k)
+            E_trial(k) = Elo + (k+1)*step;
+
+        shoot_multiple(E_trial, psi_inf, n_nodes);
+
+        // Narrow the interval to the part that contains the state
+        for(unsigned int k = 0; k < n_trial; ++k)
+        {
+            if(n_nodes(k) <= ist)
+            {
+                Elo      = E_trial(k);
+                nodes_lo = n_nodes(k);
+            }
+        }
+
+        for(unsigned int k = n_trial; k > 0; --k)
+        {
+            if(n_nodes(k-1) > ist && E_trial(k-1) > Elo)
+            {
+                Ehi      = E_trial(k-1);
+                nodes_hi = n_nodes(k-1);
+            }
+        }
+    }
+}
+
+/**
+ * \brief Find the energy of a single state
+ *
+ * \param[in] ist    Index of the state to find (0 for the ground state)
+ * \param[in] Elo    Energy below the state [J]
+ * \param[in] Ehi    Energy above the state [J]
+ * \param[in] solver Root-finding workspace to use
+ *
+ * \returns The energy of the state [J]
+ *
+ * \details This only reads the solver's configuration, so several states can be
+ *          found at once, provided that each uses its own root-finding workspace
+ */
+double SchroedingerSolverShooting::find_state(const unsigned int  ist,
+                                              double              Elo,
+                                              double              Ehi,
+                                              gsl_root_fsolver   *solver) const
+{
+    Workspace ws = {this, arma::vec(_z.size())};
 
     gsl_function f;
     f.function  = &psi_at_inf;
-    f.params    = this;
-    auto solver = gsl_root_fsolver_alloc(gsl_root_fsolver_brent);
+    f.params    = &ws;
+
+    bracket_state(ist, Elo, Ehi);
+
+    const auto y1 = GSL_FN_EVAL(&f, Elo);
+    const auto y2 = GSL_FN_EVAL(&f, Ehi);
+
+    if(y1*y2 > 0)
+    {
+        std::ostringstream oss;
+        oss << "Could not isolate state " << ist << " between "
+            << Elo*1000/e << " and " << Ehi*1000/e << " meV";
+        throw std::runtime_error(oss.str());
+    }
+
+    QWWAD_COUNT("shooting states");
+
+    double E = (Elo + Ehi)/2;
+    gsl_root_fsolver_set(solver, &f, Elo, Ehi);
+    int status = 0;
+
+    // Improve the estimate of the solution using the Brent algorithm
+    // until we hit a desired level of precision
+    do
+    {
+        QWWAD_COUNT("shooting Brent iterations");
+
+        status = gsl_root_fsolver_iterate(solver);
+        E   = gsl_root_fsolver_root(solver);
+        Elo = gsl_root_fsolver_x_lower(solver);
+        Ehi = gsl_root_fsolver_x_upper(solver);
+        status = gsl_root_test_interval(Elo, Ehi, 1e-12*e, 0);
+    }while(status == GSL_CONTINUE);
+
+    return E;
+}
+
+/**
+ * Find solution to eigenvalue problem
+ *
+ * \details Each state is first isolated by counting the nodes of the wavefunction,
+ *          and is then located precisely using the Brent algorithm.  Since the
+ *          states don't depend on each other, they are shared between threads,
+ *          each of which has its own root-finding workspace.
+ */
+void SchroedingerSolverShooting::calculate()
+{
+    const double E_floor = _V.min(); // No states can lie below the potential minimum
+
+    // Find an upper limit for the search.  If the number of states is specified, this might
+    // need to lie above the top of the potential
+    double E_ceiling = _E_max_set ? _E_max : _V.max();
 
-    for(unsigned int ist=0;
-            (_nst_max > 0  && ist < _nst_max) || // Continue if max. states is specified & not exceeded
-            (_nst_max == 0 && gsl_fcmp(Elo, _V.max(), e/1e12) == -1); // Or if max. states is NOT specified and we're below the max potential
-    ++ist)
+    if(_nst_max > 0)
     {
-        // Shift the lower estimate up past the last state we found
-        if(ist > 0)
+        double width = GSL_MAX_DBL(E_ceiling - E_floor, _dE);
+
+        for(unsigned int iter = 0; count_nodes(E_ceiling) < _nst_max && iter < 100; ++iter)
         {
-            const auto E_last = _solutions[ist-1].get_energy();
-            Elo = E_last + _dE;
+            E_ceiling += width;
+            width     *= 2;
         }
+    }
 
-        // Value for y=f(x) at bottom of search range
-        const auto y1 = GSL_FN_EVAL(&f,Elo);
-
-        // Find the range in which the solution lies by incrementing the
-        // upper limit of the search range until the function changes sign.
-        // Since this coarse search can require many iterations, we keep the
-        // lower limit fixed to minimise the amount of computation at each step.
-        // The Brent algorithm is extremely fast, so it really doesn't matter that
-        // the range we find here is large.
-        //
-        // Note the end stop to prevent infinite loop in absence of solution
-        //
-        // TODO: Make the cut-off configurable
-        double y2 = y1;
-        double Ehi = Elo;
-
-        do
-        {
-            Ehi += _dE;
-            y2=GSL_FN_EVAL(&f, Ehi);
-        }while(y1*y2>0);
+    // The total number of states that we can find
+    unsigned int nst = count_nodes(E_ceiling);
 
-        double E = (Elo + Ehi)/2;
-        gsl_root_fsolver_set(solver, &f, Elo, Ehi);
-        int status = 0;
+    if(_nst_max > 0 && _nst_max < nst)
+        nst = _nst_max;
 
-        // Improve the estimate of the solution using the Brent algorithm
-        // until we hit a desired level of precision
-        do
+    if(nst == 0)
+        return;
+
+    // Find the energy of every state, sharing the states between threads
+    std::vector<double> E_states(nst);
+
+    run_in_parallel(nst, 0, [&](const size_t ist) {
+        auto solver = gsl_root_fsolver_alloc(gsl_root_fsolver_brent);
+
+        try
+        {
+            E_states[ist] = find_state(ist, E_floor, E_ceiling, solver);
+        }
+        catch(...)
         {
-            status = gsl_root_fsolver_iterate(solver);
-            E   = gsl_root_fsolver_root(solver);
-            Elo = gsl_root_fsolver_x_lower(solver);
-            Ehi = gsl_root_fsolver_x_upper(solver);
-            status = gsl_root_test_interval(Elo, Ehi, 1e-12*e, 0);
-        }while(status == GSL_CONTINUE);
+            gsl_root_fsolver_free(solver);
+            throw;
+        }
+
+        gsl_root_fsolver_free(solver);
+    });
+
+    for(unsigned int ist=0; ist < nst; ++ist)
+    {
+        const auto E = E_states[ist];
 
         // Stop if we've exceeded the cut-off energy
         if(_E_max_set && gsl_fcmp(E, _E_max, e*1e-12) == 1)
@@ -110,7 +341,7 @@ void SchroedingerSolverShooting::calculate()
         arma::vec psi(_z.size());
         const auto psi_inf = shoot_wavefunction(psi, E);
 
-        _solutions.push_back(Eigenstate(E,_z,psi));
+        _solutions.push_back(Eigenstate(E,_z_grid,psi));
 
         // Check that wavefunction is tightly bound
         // TODO: Implement a better check
@@ -127,18 +358,165 @@ void SchroedingerSolverShooting::calculate()
  *          to the energy occurs for psi(+infinity)=0.
  *
  * \param[in] E      Energy [J]
- * \param[in] params SchroedingerSolverShooting object for which to solve
+ * \param[in] params Pointer to the Workspace of the calling thread
  *
  * \returns The wavefunction amplitude immediately to the right of the structure
+ *
+ * \details The wavefunction is written to the workspace, so nothing is allocated
+ *          for each shot.
  */
 double SchroedingerSolverShooting::psi_at_inf(double  E,
                                               void   *params)
 {
-    const auto se = reinterpret_cast<SchroedingerSolverShooting *>(params);
-    arma::vec psi = arma::zeros(se->get_z().size());
+    const auto ws = reinterpret_cast<Workspace *>(params);
+    return ws->se->shoot_wavefunction(ws->psi, E);
+}
+
+/**
+ * \brief Find the number of states below a given energy
+ *
+ * \param[in] E Energy [J]
+ *
+ * \returns The number of nodes in the wavefunction at energy E
+ */
+unsigned int SchroedingerSolverShooting::count_nodes(const double E) const
+{
+    arma::vec    psi(_z.size());
+    unsigned int n_nodes = 0;
+    shoot_wavefunction(psi, E, n_nodes);
+    return n_nodes;
+}
+
+/**
+ * \brief Computes wavefunctions for several energies at once
+ *
+ * \param[in]  E       Energies at which to compute wavefunctions [J]
+ * \param[out] psi_inf Normalised wavefunction amplitude immediately to the right of
+ *                     the structure, for each energy
+ * \param[out] n_nodes Number of nodes in the wavefunction for each energy
+ *
+ * \details This gives the same results as calling shoot_wavefunction for each energy
+ *          in turn, but all the energies are propagated through the mesh together.
+ *          The loops over energy are contiguous in memory, so they vectorise, and
+ *          every coefficient of the recurrence that doesn't depend on energy is
+ *          read from the table built by the constructor.
+ *          The wavefunctions themselves are not stored.
+ */
+void SchroedingerSolverShooting::shoot_multiple(const arma::vec  &E,
+                                                arma::vec        &psi_inf,
+                                                arma::uvec       &n_nodes) const
+{
+    if(_parabolic && _mass_constant)
+        shoot_multiple_kernel<ParabolicMass, UniformMassProfile>(E, psi_inf, n_nodes);
+    else if(_parabolic)
+        shoot_multiple_kernel<ParabolicMass, VariableMassProfile>(E, psi_inf, n_nodes);
+    else if(_mass_constant)
+        shoot_multiple_kernel<NonparabolicMass, UniformMassProfile>(E, psi_inf, n_nodes);
+    else
+        shoot_multiple_kernel<NonparabolicMass, VariableMassProfile>(E, psi_inf, n_nodes);
+}
+
+/**
+ * \brief Computes wavefunctions for several energies at once, for a given mass model
+ *
+ * \details See shoot_multiple.  The mass policies are fixed at compile time, so
+ *          the loops over energy contain no tests on the form of the mass.
+ */
+template <class MassModel, class MassProfile>
+void SchroedingerSolverShooting::shoot_multiple_kernel(const arma::vec  &E,
+                                                       arma::vec        &psi_inf,
+                                                       arma::uvec       &n_nodes) const
+{
+    const size_t nz    = _z.size();
+    const size_t n_E   = E.size();
+
+    QWWAD_COUNT_N("shooting wavefunctions", n_E);
+
+    // Boundary conditions (psi[-1] = 0, psi[0] = 1)
+    arma::vec wf_prev = arma::zeros(n_E);
+    arma::vec wf_this = arma::ones(n_E);
+    arma::vec wf_next = arma::ones(n_E);
+    arma::vec PD_int  = _weight_0 * arma::ones(n_E);
+
+    n_nodes.zeros(n_E);
+    psi_inf.set_size(n_E);
+
+    const double *E_ptr  = E.memptr();
+    double       *prev   = wf_prev.memptr();
+    double       *curr   = wf_this.memptr();
+    double       *next   = wf_next.memptr();
+    double       *PD     = PD_int.memptr();
+    arma::uword  *nodes  = n_nodes.memptr();
+
+    // Columns of the coefficient table
+    const double *V_col       = _coeffs.colptr(COEFF_V);
+    const double *V_prev_col  = _coeffs.colptr(COEFF_V_PREV);
+    const double *V_next_col  = _coeffs.colptr(COEFF_V_NEXT);
+    const double *mp0_col     = _coeffs.colptr(COEFF_M_PREV_0);
+    const double *mp1_col     = _coeffs.colptr(COEFF_M_PREV_1);
+    const double *mn0_col     = _coeffs.colptr(COEFF_M_NEXT_0);
+    const double *mn1_col     = _coeffs.colptr(COEFF_M_NEXT_1);
+    const double *c0_col      = _coeffs.colptr(COEFF_NUMEROV_0);
+    const double *c1_col      = _coeffs.colptr(COEFF_NUMEROV_1);
+    const double *w_col       = _coeffs.colptr(COEFF_WEIGHT);
+    const double *numerov_col = _coeffs.colptr(COEFF_USE_NUMEROV);
+
+    for(size_t i = 0; i < nz; ++i)
+    {
+        const double V   = V_col[i];
+        const double w   = w_col[i];
+
+        if(numerov_col[i] != 0.0)
+        {
+            const double c0     = c0_col[i];
+            const double c1     = c1_col[i];
+            const double V_prev = V_prev_col[i];
+            const double V_next = V_next_col[i];
+
+            for(size_t j = 0; j < n_E; ++j)
+            {
+                const double c = MassModel::mass(c0, c1, E_ptr[j]); // The mass is the same at all three points
+                const double f_prev = c*(V_prev - E_ptr[j]);
+                const double f_this = c*(V      - E_ptr[j]);
+                const double f_next = c*(V_next - E_ptr[j]);
 
-    const double psi_inf = se->shoot_wavefunction(psi, E);
-    return psi_inf;
+                next[j] = (2.0*(1.0 + 5.0*f_this)*curr[j] - (1.0 - f_prev)*prev[j])/(1.0 - f_next);
+            }
+        }
+        else
+        {
+            const double mp0 = mp0_col[i];
+            const double mp1 = mp1_col[i];
+            const double mn0 = mn0_col[i];
+            const double mn1 = mn1_col[i];
+
+            for(size_t j = 0; j < n_E; ++j)
+            {
+                const double m_prev = MassModel::mass(mp0, mp1, E_ptr[j]);
+                const double m_next = MassModel::mass(mn0, mn1, E_ptr[j]);
+                const double ratio  = MassProfile::ratio(m_next, m_prev);
+
+                next[j] = (m_next*(V - E_ptr[j]) + 1.0 + ratio)*curr[j] - ratio*prev[j];
+            }
+        }
+
+        for(size_t j = 0; j < n_E; ++j)
+        {
+            if((next[j] < 0 && curr[j] > 0) || (next[j] > 0 && curr[j] < 0))
+                ++nodes[j];
+            else if(next[j] == 0 && i != nz-1)
+                next[j] = curr[j] * std::numeric_limits<double>::min();
+
+            PD[j] += w*next[j]*next[j];
+        }
+
+        std::swap(prev, curr);
+        std::swap(curr, next);
+    }
+
+    // After the final step, "curr" holds the value just beyond the structure
+    for(size_t j = 0; j < n_E; ++j)
+        psi_inf(j) = curr[j]/sqrt(PD[j]);
 }
 
 /**
@@ -146,7 +524,9 @@ double SchroedingerSolverShooting::psi_at_inf(double  E,
  *
  * \details The value of the wavefunction is taken to be zero at the point
  *          immediately to the left of the potential profile. Subsequent
- *          values are computed using QWWAD3, Eq. 3.53.
+ *          values are computed using QWWAD3, Eq. 3.53.  If the Numerov method is
+ *          enabled, a fourth-order step is used instead wherever the mass is
+ *          locally uniform.
  *
  * \param[out] wf      Array to which wavefunction will be written [m^{-1/2}]
  * \param[in]  E       Energy at which to compute wavefunction
@@ -155,54 +535,113 @@ double SchroedingerSolverShooting::psi_at_inf(double  E,
  */
 double SchroedingerSolverShooting::shoot_wavefunction(arma::vec    &wf,
                                                       const double  E) const
+{
+    unsigned int n_nodes = 0;
+    return shoot_wavefunction(wf, E, n_nodes);
+}
+
+/**
+ * \brief Computes wavefunction iteratively, and counts its nodes
+ *
+ * \param[out] wf      Array to which wavefunction will be written [m^{-1/2}]
+ * \param[in]  E       Energy at which to compute wavefunction
+ * \param[out] n_nodes Number of sign changes in the wavefunction, including the point
+ *                     immediately to the right of the structure
+ *
+ * \details The number of nodes equals the number of states that lie below the energy E
+ *
+ * \returns The wavefunction amplitude at the point immediately to the right of the structure
+ */
+double SchroedingerSolverShooting::shoot_wavefunction(arma::vec    &wf,
+                                                      const double  E,
+                                                      unsigned int &n_nodes) const
+{
+    if(_parabolic && _mass_constant)
+        return shoot_wavefunction_kernel<ParabolicMass, UniformMassProfile>(wf, E, n_nodes);
+    else if(_parabolic)
+        return shoot_wavefunction_kernel<ParabolicMass, VariableMassProfile>(wf, E, n_nodes);
+    else if(_mass_constant)
+        return shoot_wavefunction_kernel<NonparabolicMass, UniformMassProfile>(wf, E, n_nodes);
+    else
+        return shoot_wavefunction_kernel<NonparabolicMass, VariableMassProfile>(wf, E, n_nodes);
+}
+
+/**
+ * \brief Computes a wavefunction and counts its nodes, for a given mass model
+ *
+ * \details See shoot_wavefunction.  The mass at each midpoint is found from the
+ *          precomputed coefficients, so nothing is set up for each energy.
+ */
+template <class MassModel, class MassProfile>
+double SchroedingerSolverShooting::shoot_wavefunction_kernel(arma::vec    &wf,
+                                                             const double  E,
+                                                             unsigned int &n_nodes) const
 {
     const size_t nz = _z.size();
     wf.resize(nz);
-    const double dz = _z(1) - _z(0);
 
-    // Recalculate effective mass with non-parabolicity at this energy
-    const arma::vec m = _me%(1.0+_alpha%(E-_V));
+    QWWAD_COUNT("shooting wavefunctions");
+
+    // Columns of the coefficient table
+    const double *V_this  = _coeffs.colptr(COEFF_V);
+    const double *V_prev  = _coeffs.colptr(COEFF_V_PREV);
+    const double *V_next  = _coeffs.colptr(COEFF_V_NEXT);
+    const double *mp0     = _coeffs.colptr(COEFF_M_PREV_0);
+    const double *mp1     = _coeffs.colptr(COEFF_M_PREV_1);
+    const double *mn0     = _coeffs.colptr(COEFF_M_NEXT_0);
+    const double *mn1     = _coeffs.colptr(COEFF_M_NEXT_1);
+    const double *c0      = _coeffs.colptr(COEFF_NUMEROV_0);
+    const double *c1      = _coeffs.colptr(COEFF_NUMEROV_1);
+    const double *w       = _coeffs.colptr(COEFF_WEIGHT);
+    const double *numerov = _coeffs.colptr(COEFF_USE_NUMEROV);
+    double       *psi     = wf.memptr();
 
     // boundary conditions (psi[-1] = psi[n] = 0)
-    wf(0) = 1.0;
+    psi[0] = 1.0;
+    n_nodes = 0;
     double wf_next = 1.0;
+    double PD_integral = _weight_0;
 
     for(unsigned int i=0; i < nz; i++) // last potential not used
     {
-        double wf_prev = 0;
-
-        // Compute m(z + dz/2)
-        double m_prev = 0.0;
-        double m_next = 0.0;
+        const double wf_prev = (i != 0) ? psi[i-1] : 0.0;
 
-        if(i != 0)
+        if(numerov[i] != 0.0)
         {
-            wf_prev = wf(i-1);
-            m_prev = (m(i) + m(i-1))/2.0;
+            // Numerov step for psi'' = f psi, where f = 2m(V-E)/hbar^2.  This is
+            // fourth-order accurate, compared with second-order for the standard step
+            const double c      = MassModel::mass(c0[i], c1[i], E);
+            const double f_prev = c*(V_prev[i]-E);
+            const double f_this = c*(V_this[i]-E);
+            const double f_next = c*(V_next[i]-E);
+
+            wf_next = (2.0*(1.0 + 5.0*f_this)*psi[i] - (1.0 - f_prev)*wf_prev)/(1.0 - f_next);
         }
         else
         {
-            m_prev = m(i);
-        }
+            // Compute m(z - dz/2) and m(z + dz/2)
+            const double m_prev = MassModel::mass(mp0[i], mp1[i], E);
+            const double m_next = MassModel::mass(mn0[i], mn1[i], E);
+            const double ratio  = MassProfile::ratio(m_next, m_prev);
 
-        if(i != nz - 1)
-            m_next = (m(i) + m(i+1))/2.0;
-        else
-            m_next = m(i);
+            wf_next = (m_next*(V_this[i]-E) + 1.0 + ratio)*psi[i] - wf_prev*ratio;
+        }
 
-        wf_next = (2*m_next*dz*dz/hBar/hBar*(_V(i)-E)+
-                1.0 + m_next/m_prev)*wf(i)
-                - wf_prev * m_next/m_prev;
-        wf_prev += 0;
+        // Count a node whenever the wavefunction changes sign
+        if((wf_next < 0 && psi[i] > 0) || (wf_next > 0 && psi[i] < 0))
+            ++n_nodes;
+        else if(wf_next == 0 && i != nz-1)
+            wf_next = psi[i] * std::numeric_limits<double>::min();
 
         // Now copy calculated wave function to array
-        if(i != nz-1) wf(i+1) = wf_next;
+        if(i != nz-1)
+        {
+            psi[i+1] = wf_next;
+            PD_integral += w[i]*wf_next*wf_next;
+        }
     }
 
     // Normalise the stored wave function
-    const arma::vec PD = square(wf);
-    const auto PD_integral = integral(PD, dz);
-
     wf /= sqrt(PD_integral);
     wf_next /= sqrt(PD_integral);
 
@@ -9,6 +9,8 @@
 
 #include "schroedinger-solver.h"
 
+#include <gsl/gsl_roots.h>
+
 namespace QWWAD
 {
 /**
@@ -19,7 +21,42 @@ class SchroedingerSolverShooting : public SchroedingerSolver
 private:
     arma::vec _me;    ///< Band-edge effective mass [kg]
     arma::vec _alpha; ///< Nonparabolicity parameter [J^{-1}]
-    double    _dE;    ///< Minimum energy separation between states [J]
+    double    _dE;    ///< Initial energy step for extending search range [J]
+
+    /**
+     * \brief Columns of the table of shooting coefficients
+     *
+     * \details The effective mass is a linear function of energy, m(E) = m0 + m1 E,
+     *          so everything that a shooting step needs at a mesh point, apart from
+     *          the energy, is computed once for the mesh.  The mass terms are
+     *          pre-multiplied by the constants in the recurrence, so each step is
+     *          a few fused multiply-adds per energy.
+     */
+    enum ShootingCoefficient
+    {
+        COEFF_V = 0,        ///< Potential at the point [J]
+        COEFF_V_PREV,       ///< Potential at the previous point [J]
+        COEFF_V_NEXT,       ///< Potential at the next point [J]
+        COEFF_M_PREV_0,     ///< Energy-independent part of 2 m(z-dz/2) dz^2/hbar^2 [1/J]
+        COEFF_M_PREV_1,     ///< Energy-dependent part of 2 m(z-dz/2) dz^2/hbar^2 [1/J^2]
+        COEFF_M_NEXT_0,     ///< Energy-independent part of 2 m(z+dz/2) dz^2/hbar^2 [1/J]
+        COEFF_M_NEXT_1,     ///< Energy-dependent part of 2 m(z+dz/2) dz^2/hbar^2 [1/J^2]
+        COEFF_NUMEROV_0,    ///< Energy-independent part of m(z) dz^2/(6 hbar^2) [1/J]
+        COEFF_NUMEROV_1,    ///< Energy-dependent part of m(z) dz^2/(6 hbar^2) [1/J^2]
+        COEFF_WEIGHT,       ///< Normalisation weight of the next point (zero at the last point) [m]
+        COEFF_USE_NUMEROV,  ///< 1 if a Numerov step is used at the point, 0 otherwise
+        N_COEFFS
+    };
+
+    arma::mat _coeffs;   ///< Shooting coefficients, with one column for each ShootingCoefficient
+    double    _weight_0; ///< Normalisation weight of the first point [m]
+
+    bool _numerov; ///< Use fourth-order Numerov integration where possible
+
+    // The shooting kernels are specialised for the form of the mass, so that the
+    // common parabolic, uniform-mass case has no tests inside its loops
+    bool _parabolic;     ///< True if the mass is independent of energy at every point
+    bool _mass_constant; ///< True if the mass is the same at every point
 
 public:
     SchroedingerSolverShooting(const decltype(_me)    &me,
@@ -27,20 +64,61 @@ public:
                                const decltype(_V)     &V,
                                const decltype(_z)     &z,
                                const double            dE,
-                               const unsigned int      nst_max=0);
+                               const unsigned int      nst_max=0,
+                               const bool              numerov=false);
 
-    std::string get_name() {return "shooting";}
+    std::string get_name() {return _numerov ? "shooting-numerov" : "shooting";}
 
     std::vector<Eigenstate> get_solutions_chi(const bool convert_to_meV=false);
 
+    /**
+     * \brief Working storage for shooting at trial energies
+     *
+     * \details The solver is only read while shooting, so several threads may
+     *          share one solver, provided that each has its own workspace
+     */
+    struct Workspace
+    {
+        const SchroedingerSolverShooting *se;  ///< Solver whose configuration is used
+        arma::vec                         psi; ///< Wavefunction at the latest trial energy [m^{-1/2}]
+    };
+
     static double psi_at_inf(double  E,
                              void   *params);
 
     double shoot_wavefunction(arma::vec    &wf,
                               const double  E) const;
 
+    double shoot_wavefunction(arma::vec    &wf,
+                              const double  E,
+                              unsigned int &n_nodes) const;
+
+    unsigned int count_nodes(const double E) const;
+
+    void shoot_multiple(const arma::vec  &E,
+                        arma::vec        &psi_inf,
+                        arma::uvec       &n_nodes) const;
+
 private:
     void calculate();
+    void bracket_state(const unsigned int  ist,
+                       double             &Elo,
+                       double             &Ehi) const;
+
+    double find_state(const unsigned int  ist,
+                      double              Elo,
+                      double              Ehi,
+                      gsl_root_fsolver   *solver) const;
+
+    template <class MassModel, class MassProfile>
+    void shoot_multiple_kernel(const arma::vec  &E,
+                               arma::vec        &psi_inf,
+                               arma::uvec       &n_nodes) const;
+
+    template <class MassModel, class MassProfile>
+    double shoot_wavefunction_kernel(arma::vec    &wf,
+                                     const double  E,
+                                     unsigned int &n_nodes) const;
 };
 } // namespace
 #endif
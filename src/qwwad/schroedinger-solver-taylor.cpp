@@ -8,6 +8,7 @@
 #include "schroedinger-solver-taylor.h"
 #include "constants.h"
 #include "linear-algebra.h"
+#include "maths-helpers.h"
 
 namespace QWWAD
 {
@@ -30,9 +31,13 @@ SchroedingerSolverTaylor::SchroedingerSolverTaylor(const decltype(_m)     &me,
                                                    const decltype(_z)     &z,
                                                    const unsigned int           nst_max) :
     SchroedingerSolver(V,z,nst_max),
-    AB(arma::vec(2*z.size())),
-    BB(arma::vec(2*z.size()))
+    _A_diag(arma::zeros(z.size())),
+    _A_sub(arma::zeros(z.size()-1)),
+    _B_diag(arma::zeros(z.size())),
+    _B_sub(arma::zeros(z.size()-1))
 {
+    check_uniform_mesh(z, "The Taylor-expansion Schroedinger solver");
+
     const size_t nz = z.size();
     const double dz = z[1] - z[0];
 
@@ -64,34 +69,46 @@ SchroedingerSolverTaylor::SchroedingerSolverTaylor(const decltype(_m)     &me,
         if(i!=nz-1)
         {
             // Calculate a points
-            AB[2*(i+1)] = -0.5*gsl_pow_2(hBar/dz)*(1+alpha_plus*V_plus)/m_plus;
+            _A_sub[i] = -0.5*gsl_pow_2(hBar/dz)*(1+alpha_plus*V_plus)/m_plus;
 
             // Calculate d points
-            BB[2*(i+1)] = -0.5*gsl_pow_2(hBar/dz)*alpha_plus/m_plus;
+            _B_sub[i] = -0.5*gsl_pow_2(hBar/dz)*alpha_plus/m_plus;
         }
 
         // Calculate b points
-        AB[1+(2*i)] = 0.5*gsl_pow_2(hBar/dz)*((1.0+alpha_plus*V_plus)/m_plus + (1.0+alpha_minus*V_minus)/m_minus) + V[i];
+        _A_diag[i] = 0.5*gsl_pow_2(hBar/dz)*((1.0+alpha_plus*V_plus)/m_plus + (1.0+alpha_minus*V_minus)/m_minus) + V[i];
 
         // Calculate e points
-        BB[1+(2*i)] = 0.5*gsl_pow_2(hBar/dz)*(alpha_plus/m_plus + alpha_minus/m_minus) + 1;
+        _B_diag[i] = 0.5*gsl_pow_2(hBar/dz)*(alpha_plus/m_plus + alpha_minus/m_minus) + 1;
     }
 }
 
 /**
  * Find solutions to Schroedinger's equation for this Hamiltonian
+ *
+ * \details Both the Hamiltonian and overlap matrices are tridiagonal, so only
+ *          the states within the energy window are computed, using O(nz) memory
  */
 void SchroedingerSolverTaylor::calculate()
 {
+    // Get limits for search
+    const double E_min = _E_min_set ? _E_min : _V.min();
+    const double E_max = _E_max_set ? _E_max : _V.max();
+
+    // Set number of states only if energy limits haven't been specified
+    // Note that '0' means that we should find all states in range
+    const unsigned int nst_max = (_E_min_set || _E_max_set) ? 0 : _nst_max;
+
     // Solve eigenvalue problem
-    const auto EVP_solutions = eigen_banded(&AB[0], &BB[0], _V.min(), _V.max(), _V.size(), _nst_max);
+    const auto EVP_solutions = eigen_tridiag_generalised(_A_diag, _A_sub, _B_diag, _B_sub,
+                                                         E_min, E_max, nst_max);
 
     // Now save solutions
     for(auto st : EVP_solutions)
     {
         const auto E   = st.get_E();
         const auto psi = st.psi_array();
-        _solutions.push_back(Eigenstate(E, _z, psi));
+        _solutions.push_back(Eigenstate(E, _z_grid, psi));
     }
 }
 } // namespace
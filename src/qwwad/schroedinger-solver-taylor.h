@@ -20,8 +20,10 @@ class SchroedingerSolverTaylor : public SchroedingerSolver
 private:
     arma::vec _m;     ///< Effective mass at each position
     arma::vec _alpha; ///< Nonparabolicity parameter at each position
-    arma::vec AB; ///< Upper triangle of Hamiltonian matrix
-    arma::vec BB; ///< Lower triangle of Hamiltonian matrix
+    arma::vec _A_diag; ///< Diagonal of Hamiltonian matrix
+    arma::vec _A_sub;  ///< Subdiagonal of Hamiltonian matrix
+    arma::vec _B_diag; ///< Diagonal of overlap matrix
+    arma::vec _B_sub;  ///< Subdiagonal of overlap matrix
 
 public:
     SchroedingerSolverTaylor(const decltype(_m)     &me,
@@ -6,10 +6,13 @@
  */
 
 #include "schroedinger-solver-tridiagonal.h"
+#include <cmath>
+#include <complex>
 #include <gsl/gsl_math.h>
 
 #include "constants.h"
 #include "linear-algebra.h"
+#include "profiler.h"
 
 namespace QWWAD
 {
@@ -20,17 +23,30 @@ using namespace constants;
  *
  * \details If nst_max=0 (the default), all states will be found
  *          that lie within the range of the input potential profile
+ *
+ *          The spatial points need not be evenly spaced.  A finite-volume
+ *          discretisation is used, in which point i represents a cell of width
+ *          \f$h_i = (\delta_{i-1/2} + \delta_{i+1/2})/2\f$, where \f$\delta\f$
+ *          is the separation between neighbouring points.  This gives a
+ *          generalised eigenproblem with a diagonal "mass" matrix, which is
+ *          symmetrised by scaling the unknowns by \f$\sqrt{h_i}\f$.  For a
+ *          uniform mesh, this reduces to the standard three-point stencil.
  */
 SchroedingerSolverTridiag::SchroedingerSolverTridiag(const decltype(_m) &me,
                                                      const decltype(_V) &V,
                                                      const decltype(_z) &z,
                                                      const unsigned int  nst_max) :
     SchroedingerSolver(V,z,nst_max),
+    _m(me),
     diag(arma::zeros(z.size())),
-    sub(arma::zeros(z.size()-1))
+    sub(arma::zeros(z.size()-1)),
+    _h(get_cell_widths(z)),
+    _bloch(false),
+    _k_bloch(0.0)
 {
+    ScopedTimer timer("hamiltonian assembly");
+
     const size_t nz = z.size();
-    const double dz = z[1] - z[0];
 
     for(unsigned int i=0; i<nz; i++){
         double m_minus;
@@ -45,19 +61,138 @@ SchroedingerSolverTridiag::SchroedingerSolverTridiag(const decltype(_m) &me,
             m_plus = (me[i+1] + me[i])/2;
         }
 
-        // Calculate a points
-        if(i!=nz-1) sub[i] = -gsl_pow_2(hBar/dz)/(2*m_plus);
+        // Separation from neighbouring points, mirroring the mesh at the edges
+        const double dz_minus = (i==0)    ? z[1] - z[0]       : z[i] - z[i-1];
+        const double dz_plus  = (i==nz-1) ? z[nz-1] - z[nz-2] : z[i+1] - z[i];
+
+        // Calculate a points (before symmetrisation)
+        if(i!=nz-1) sub[i] = -hBar*hBar/(2*m_plus*dz_plus);
 
         // Calculate b points
-        diag[i] = 0.5*gsl_pow_2(hBar/dz)*(m_plus+m_minus)/(m_plus*m_minus) + V[i];
+        diag[i] = 0.5*hBar*hBar*(1.0/(m_plus*dz_plus) + 1.0/(m_minus*dz_minus))/_h[i] + V[i];
+    }
+
+    // Symmetrise the off-diagonal terms
+    for(unsigned int i=0; i<nz-1; i++)
+        sub[i] /= sqrt(_h[i]*_h[i+1]);
+}
+
+/**
+ * \brief Find the width of the finite-volume cell around each spatial point
+ *
+ * \param[in] z Spatial locations [m]
+ *
+ * \returns The width of each cell [m]
+ *
+ * \details Each cell extends halfway to the neighbouring points.  The mesh is
+ *          mirrored at the edges, so the end cells are as wide as their
+ *          neighbours' spacing.
+ */
+arma::vec SchroedingerSolverTridiag::get_cell_widths(const arma::vec &z)
+{
+    const size_t nz = z.size();
+    arma::vec    h(nz);
+
+    for(unsigned int i=0; i<nz; i++)
+    {
+        const double dz_minus = (i==0)    ? z[1] - z[0]       : z[i] - z[i-1];
+        const double dz_plus  = (i==nz-1) ? z[nz-1] - z[nz-2] : z[i+1] - z[i];
+
+        h[i] = 0.5*(dz_minus + dz_plus);
+    }
+
+    return h;
+}
+
+/**
+ * \brief Use Bloch-periodic boundaries, with a given superlattice wave vector
+ *
+ * \param[in] k Bloch wave vector [1/m]
+ *
+ * \details The structure is then treated as a single period of a superlattice,
+ *          with \f$\psi(z+L) = \mathrm{e}^{ikL}\psi(z)\f$, where the period
+ *          \f$L\f$ is taken to be nz times the spacing between the first two points.
+ *          See SchroedingerSolver::get_bloch_period.
+ */
+void SchroedingerSolverTridiag::set_bloch_wavevector(const double k)
+{
+    if(!_bloch || k != _k_bloch)
+    {
+        _bloch   = true;
+        _k_bloch = k;
+        _dirty   = true;
+    }
+}
+
+/**
+ * \brief Find the states of a single period with Bloch-periodic boundaries
+ *
+ * \details The first and last points are coupled across the boundary of the
+ *          period, with a complex phase that depends on the wave vector.  This is
+ *          the same corner term as in solve_cyclic_matrix, but it makes the
+ *          matrix complex Hermitian rather than tridiagonal, so it is solved
+ *          densely.  Only a single period is needed, so the matrix is small.
+ */
+void SchroedingerSolverTridiag::calculate_bloch()
+{
+    const size_t nz     = _z.size();
+    const double dz     = _z[1] - _z[0];       // Spacing across the boundary of the period
+    const double dz_end = _z[nz-1] - _z[nz-2]; // Spacing used for the mirrored edge
+
+    // Mass midway between the last point and the first point of the next period
+    const double m_wrap = (_m[0] + _m[nz-1])/2;
+    const double t_wrap = -hBar*hBar/(2*m_wrap*dz);
+
+    // Replace the mirrored edges with the periodic neighbours
+    arma::vec diag_bloch(diag);
+    diag_bloch[0]    += 0.5*hBar*hBar*(1.0/(m_wrap*dz) - 1.0/(_m[0]*dz))/_h[0];
+    diag_bloch[nz-1] += 0.5*hBar*hBar*(1.0/(m_wrap*dz) - 1.0/(_m[nz-1]*dz_end))/_h[nz-1];
+
+    arma::cx_mat H(nz, nz, arma::fill::zeros);
+    H.diag()   = arma::conv_to<arma::cx_vec>::from(diag_bloch);
+    H.diag(-1) = arma::conv_to<arma::cx_vec>::from(sub);
+    H.diag(1)  = arma::conv_to<arma::cx_vec>::from(sub);
+
+    const auto phase  = std::polar(1.0, _k_bloch*get_bloch_period());
+    const auto corner = t_wrap/sqrt(_h[0]*_h[nz-1]);
+    H(nz-1, 0) += corner*phase;
+    H(0, nz-1) += corner*std::conj(phase);
+
+    // Get limits for search
+    const double E_min = _E_min_set ? _E_min : _V.min();
+    const double E_max = _E_max_set ? _E_max : _V.max();
+    const bool   limit_nst = !(_E_min_set || _E_max_set) && _nst_max > 0;
+    const unsigned int n_find = limit_nst ? std::min<size_t>(_nst_max, nz) : nz;
+
+    arma::cx_mat Z;
+    const arma::vec E = eigen_hermitian_range(H, 0, n_find-1, Z);
+
+    _solutions.clear();
+
+    for(unsigned int ist = 0; ist < E.size(); ++ist)
+    {
+        if(E[ist] < E_min || (!limit_nst && E[ist] > E_max))
+            continue;
+
+        const arma::cx_vec psi = Z.col(ist) / sqrt(_h); // Undo the symmetrising scale factor
+        _solutions.push_back(Eigenstate(E[ist], _z_grid, real_bloch_envelope(psi)));
     }
 }
 
 /**
  * Find solution to eigenvalue problem
+ *
+ * \details If an initial guess has been given, the guessed states are refined
+ *          rather than solving the full eigenvalue problem
  */
 void SchroedingerSolverTridiag::calculate()
 {
+    if(_bloch)
+    {
+        calculate_bloch();
+        return;
+    }
+
     // Get limits for search
     const double E_min = _E_min_set ? _E_min : _V.min();
     const double E_max = _E_max_set ? _E_max : _V.max();
@@ -66,15 +201,28 @@ void SchroedingerSolverTridiag::calculate()
     // Note that '0' means that we should find all states in range
     const double nst_max = (_E_min_set || _E_max_set) ? 0 : _nst_max;
 
-    const auto EVP_solutions = eigen_tridiag(diag, sub, E_min, E_max, nst_max);
+    std::vector< EVP_solution<double> > EVP_solutions;
+
+    if(_guess.empty())
+        EVP_solutions = eigen_tridiag(diag, sub, E_min, E_max, nst_max);
+    else
+    {
+        std::vector< EVP_solution<double> > EVP_guess;
+
+        for (auto st : _guess)
+            EVP_guess.push_back(EVP_solution<double>(st.get_energy(),
+                                                     st.get_wavefunction_samples() % sqrt(_h)));
+
+        EVP_solutions = eigen_tridiag_refine(diag, sub, EVP_guess, E_min, E_max, nst_max);
+    }
 
     _solutions.clear();
 
     for (auto st : EVP_solutions)
     {
         const auto E   = st.get_E();
-        const auto psi = st.psi_array();
-        _solutions.push_back(Eigenstate(E, _z, psi));
+        const arma::vec psi = st.psi_array() / sqrt(_h); // Undo the symmetrising scale factor
+        _solutions.push_back(Eigenstate(E, _z_grid, psi));
     }
 }
 } // namespace
@@ -15,6 +15,10 @@ namespace QWWAD
 {
 /**
  * Solver for Schroedinger's equation using a tridiagonal Hamiltonian matrix
+ *
+ * \details By default, the wavefunction vanishes beyond each end of the structure.
+ *          Alternatively, the structure can be treated as a single period of a
+ *          superlattice, with Bloch-periodic boundaries for a given wave vector.
  */
 class SchroedingerSolverTridiag : public SchroedingerSolver
 {
@@ -22,15 +26,33 @@ private:
     arma::vec _m;   ///< Effective mass at each point
     arma::vec diag; ///< Diagonal elements of matrix
     arma::vec sub;  ///< Sub-diagonal elements of matrix
+    arma::vec _h;   ///< Width of the cell around each spatial point [m]
+
+    bool      _bloch;   ///< True if Bloch-periodic boundaries are used
+    double    _k_bloch; ///< Bloch wave vector [1/m]
 public:
     SchroedingerSolverTridiag(const decltype(_m) &me,
                               const decltype(_V) &V,
                               const decltype(_z) &z,
                               const unsigned int  nst_max=0);
 
-    std::string get_name() {return "tridiagonal";}
+    std::string get_name() {return _bloch ? "tridiagonal-bloch" : "tridiagonal";}
+
+    void set_bloch_wavevector(const double k);
+
+    /// Return the diagonal of the symmetrised Hamiltonian [J]
+    inline decltype(diag) const & get_diagonal() const {return diag;}
+
+    /// Return the sub-diagonal of the symmetrised Hamiltonian [J]
+    inline decltype(sub) const & get_subdiagonal() const {return sub;}
+
+    /// Return the width of the cell around each spatial point [m]
+    inline decltype(_h) const & get_cell_widths() const {return _h;}
+
+    static arma::vec get_cell_widths(const arma::vec &z);
 private:
     void calculate();
+    void calculate_bloch();
 };
 }
 #endif
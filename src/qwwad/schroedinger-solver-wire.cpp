@@ -0,0 +1,355 @@
+/**
+ * \file   schroedinger-solver-wire.cpp
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Schroedinger solver over the cross-section of a quantum wire
+ */
+
+#include "schroedinger-solver-wire.h"
+
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "constants.h"
+#include "linear-algebra.h"
+#include "profiler.h"
+
+namespace QWWAD
+{
+using namespace constants;
+
+/**
+ * \brief Find the spacing of a uniform mesh
+ *
+ * \param[in] x    Sample locations [m]
+ * \param[in] name Name of the axis, for error messages
+ *
+ * \returns The spacing between samples [m]
+ */
+static double get_uniform_spacing(const arma::vec   &x,
+                                  const std::string &name)
+{
+    if(x.size() < 2)
+    {
+        std::ostringstream oss;
+        oss << "At least two samples are needed in " << name << ".";
+        throw std::invalid_argument(oss.str());
+    }
+
+    const double dx = x(1) - x(0);
+
+    for(arma::uword i = 1; i < x.size(); ++i)
+    {
+        if(std::abs(x(i) - x(i-1) - dx) > 1e-6*std::abs(dx) || dx <= 0)
+        {
+            std::ostringstream oss;
+            oss << "Samples in " << name << " must be evenly spaced and increasing.";
+            throw std::invalid_argument(oss.str());
+        }
+    }
+
+    return dx;
+}
+
+/**
+ * \brief Set up the Hamiltonian for a wire cross-section
+ *
+ * \param[in] y   Sample locations in y [m].  These must be evenly spaced.
+ * \param[in] z   Sample locations in z [m].  These must be evenly spaced.
+ * \param[in] V   Confining potential at each point (ny x nz) [J]
+ * \param[in] m   Effective mass at each point (ny x nz) [kg]
+ * \param[in] nst Number of states to find
+ * \param[in] tol Convergence threshold for the residual of each state [J]
+ *
+ * \details The mass between neighbouring points is the mean of their masses.
+ *          Just outside the mesh, the mass is taken to be that at the edge.
+ */
+SchroedingerSolverWire::SchroedingerSolverWire(const arma::vec    &y,
+                                               const arma::vec    &z,
+                                               const arma::mat    &V,
+                                               const arma::mat    &m,
+                                               const unsigned int  nst,
+                                               const double        tol) :
+    _y(y),
+    _z(z),
+    _V(V),
+    _nst(nst),
+    _tol(tol),
+    _H_diag(y.size()*z.size()),
+    _H_y(y.size()*z.size()),
+    _H_z(y.size()*z.size()),
+    _shift(V.min()),
+    _T_D(),
+    _T_L(),
+    _solved(false),
+    _E(),
+    _psi()
+{
+    const arma::uword ny = y.size();
+    const arma::uword nz = z.size();
+
+    if(V.n_rows != ny || V.n_cols != nz || m.n_rows != ny || m.n_cols != nz)
+    {
+        std::ostringstream oss;
+        oss << "Potential and mass must be " << ny << "x" << nz << " matrices.";
+        throw std::length_error(oss.str());
+    }
+
+    if(nst == 0 || nst >= ny*nz)
+    {
+        std::ostringstream oss;
+        oss << "Cannot find " << nst << " states on a mesh of " << ny*nz << " points.";
+        throw std::domain_error(oss.str());
+    }
+
+    const double dy = get_uniform_spacing(y, "y");
+    const double dz = get_uniform_spacing(z, "z");
+    const double cy = hBar*hBar/(2*dy*dy);
+    const double cz = hBar*hBar/(2*dz*dz);
+
+    for(arma::uword iy = 0; iy < ny; ++iy)
+    {
+        for(arma::uword iz = 0; iz < nz; ++iz)
+        {
+            const arma::uword p = iy*nz + iz;
+
+            // Mass half-way to each neighbour
+            const double m_yp = (iy+1 < ny) ? 0.5*(m(iy,iz) + m(iy+1,iz)) : m(iy,iz);
+            const double m_ym = (iy > 0)    ? 0.5*(m(iy,iz) + m(iy-1,iz)) : m(iy,iz);
+            const double m_zp = (iz+1 < nz) ? 0.5*(m(iy,iz) + m(iy,iz+1)) : m(iy,iz);
+            const double m_zm = (iz > 0)    ? 0.5*(m(iy,iz) + m(iy,iz-1)) : m(iy,iz);
+
+            _H_diag(p) = V(iy,iz) + cy*(1/m_yp + 1/m_ym) + cz*(1/m_zp + 1/m_zm);
+            _H_y(p)    = (iy+1 < ny) ? -cy/m_yp : 0;
+            _H_z(p)    = (iz+1 < nz) ? -cz/m_zp : 0;
+        }
+    }
+
+    // Factorise the Hamiltonian for each line of constant y, shifted by the
+    // lowest potential.  The kinetic operator is positive-definite, so each
+    // line can be factorised stably without pivoting.
+    _T_D.set_size(ny*nz);
+    _T_L.set_size(ny*nz);
+
+    for(arma::uword iy = 0; iy < ny; ++iy)
+    {
+        const arma::uword p0 = iy*nz;
+        arma::vec D;
+        arma::vec L;
+
+        const arma::vec line_diag = _H_diag.subvec(p0, p0+nz-1) - _shift;
+        const arma::vec line_sub  = (nz > 1) ? arma::vec(_H_z.subvec(p0, p0+nz-2)) : arma::vec(1, arma::fill::zeros);
+        factorise_tridiag_LDL_T(line_diag, line_sub, D, L);
+
+        _T_D.subvec(p0, p0+nz-1) = D;
+        _T_L.subvec(p0, p0+nz-1).zeros();
+
+        if(nz > 1)
+            _T_L.subvec(p0, p0+nz-2) = L;
+    }
+}
+
+/**
+ * \brief Apply the Hamiltonian to a set of vectors
+ *
+ * \param[in] X Vectors over the mesh (one per column)
+ *
+ * \returns The product of the Hamiltonian with each column of X [J]
+ */
+arma::cx_mat SchroedingerSolverWire::apply_hamiltonian(const arma::cx_mat &X) const
+{
+    const arma::uword N  = _H_diag.size();
+    const arma::uword nz = _z.size();
+    arma::cx_mat HX(X.n_rows, X.n_cols);
+
+    for(arma::uword i = 0; i < X.n_cols; ++i)
+    {
+        const arma::cx_double *x  = X.colptr(i);
+        arma::cx_double       *hx = HX.colptr(i);
+
+        for(arma::uword p = 0; p < N; ++p)
+            hx[p] = _H_diag(p)*x[p];
+
+        for(arma::uword p = 0; p+1 < N; ++p)
+        {
+            hx[p]   += _H_z(p)*x[p+1];
+            hx[p+1] += _H_z(p)*x[p];
+        }
+
+        for(arma::uword p = 0; p+nz < N; ++p)
+        {
+            hx[p]    += _H_y(p)*x[p+nz];
+            hx[p+nz] += _H_y(p)*x[p];
+        }
+    }
+
+    return HX;
+}
+
+/**
+ * \brief Approximately invert the shifted Hamiltonian for a set of residuals
+ *
+ * \param[in] R Residuals over the mesh (one per column)
+ *
+ * \returns The solution of the (shifted) line-tridiagonal problem for each column
+ *
+ * \details The coupling between lines is neglected, so each line is solved
+ *          independently by forward and back substitution with its LDL^T factors.
+ */
+arma::cx_mat SchroedingerSolverWire::apply_preconditioner(const arma::cx_mat &R) const
+{
+    const arma::uword ny = _y.size();
+    const arma::uword nz = _z.size();
+    arma::cx_mat W(R);
+
+    for(arma::uword i = 0; i < W.n_cols; ++i)
+    {
+        arma::cx_double *w = W.colptr(i);
+
+        for(arma::uword iy = 0; iy < ny; ++iy)
+        {
+            const arma::uword p0 = iy*nz;
+
+            for(arma::uword iz = 1; iz < nz; ++iz)
+                w[p0+iz] -= _T_L(p0+iz-1)*w[p0+iz-1];
+
+            for(arma::uword iz = 0; iz < nz; ++iz)
+                w[p0+iz] /= _T_D(p0+iz);
+
+            for(arma::uword iz = nz-1; iz > 0; --iz)
+                w[p0+iz-1] -= _T_L(p0+iz-1)*w[p0+iz];
+        }
+    }
+
+    return W;
+}
+
+/**
+ * \brief Create a starting guess for the lowest states
+ *
+ * \param[in] m Number of vectors in the guess
+ *
+ * \details The guess uses the lowest modes of a uniform rectangular box covering
+ *          the mesh, with a small random component so that the guess is not
+ *          orthogonal to any of the true states.
+ */
+arma::cx_mat SchroedingerSolverWire::get_initial_guess(const unsigned int m) const
+{
+    const arma::uword ny = _y.size();
+    const arma::uword nz = _z.size();
+    const double      Ly = (ny+1)*(_y(1) - _y(0));
+    const double      Lz = (nz+1)*(_z(1) - _z(0));
+
+    // Find the lowest box modes, ordered by kinetic energy
+    std::vector<std::pair<double, std::pair<unsigned int, unsigned int>>> modes;
+
+    for(unsigned int a = 1; a <= std::min<arma::uword>(m, ny); ++a)
+    {
+        for(unsigned int b = 1; b <= std::min<arma::uword>(m, nz); ++b)
+            modes.push_back(std::make_pair(a*a/(Ly*Ly) + b*b/(Lz*Lz), std::make_pair(a, b)));
+    }
+
+    std::sort(modes.begin(), modes.end());
+
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> noise(-0.05, 0.05);
+    arma::cx_mat X(ny*nz, m);
+
+    for(unsigned int i = 0; i < m; ++i)
+    {
+        const auto a = modes[i].second.first;
+        const auto b = modes[i].second.second;
+
+        for(arma::uword iy = 0; iy < ny; ++iy)
+        {
+            for(arma::uword iz = 0; iz < nz; ++iz)
+            {
+                X(iy*nz + iz, i) = sin(a*pi*(iy+1)/(ny+1)) * sin(b*pi*(iz+1)/(nz+1)) + noise(gen);
+            }
+        }
+    }
+
+    return X;
+}
+
+/**
+ * \brief Find the lowest states
+ *
+ * \details The Hamiltonian is real and symmetric, so the real and imaginary parts
+ *          of each eigenvector from the Hermitian solver are themselves
+ *          eigenvectors.  A final Rayleigh-Ritz step in the space spanned by both
+ *          parts gives real wavefunctions.
+ */
+void SchroedingerSolverWire::calculate()
+{
+    QWWAD_COUNT("SchroedingerSolverWire::calculate");
+
+    const arma::uword N  = _H_diag.size();
+    const double      dy = _y(1) - _y(0);
+    const double      dz = _z(1) - _z(0);
+    const unsigned int m = std::min<arma::uword>(_nst + std::max(4U, _nst/4), N);
+
+    const auto apply_A = [this](const arma::cx_mat &X) {return apply_hamiltonian(X);};
+    const auto apply_T = [this](const arma::cx_mat &R, const arma::vec &) {return apply_preconditioner(R);};
+
+    arma::cx_mat X = get_initial_guess(m);
+    eigen_hermitian_lobpcg(apply_A, apply_T, X, _nst, _tol);
+
+    const arma::mat Q  = arma::orth(arma::mat(arma::join_rows(arma::real(X), arma::imag(X))));
+    const arma::mat HQ = arma::real(apply_hamiltonian(arma::conv_to<arma::cx_mat>::from(Q)));
+
+    arma::mat Q_t_HQ = Q.t()*HQ;
+    arma::vec mu;
+    arma::mat C;
+    arma::eig_sym(mu, C, arma::mat(0.5*(Q_t_HQ + Q_t_HQ.t())));
+
+    _E   = mu.head(_nst);
+    _psi = Q*C.cols(0, _nst-1);
+
+    for(unsigned int ist = 0; ist < _nst; ++ist)
+        _psi.col(ist) /= sqrt(arma::accu(arma::square(_psi.col(ist)))*dy*dz);
+
+    _solved = true;
+}
+
+/**
+ * \brief Get the energy of each state
+ *
+ * \returns The energies in ascending order [J]
+ */
+const arma::vec & SchroedingerSolverWire::get_energies()
+{
+    if(!_solved)
+        calculate();
+
+    return _E;
+}
+
+/**
+ * \brief Get the wavefunction of a state
+ *
+ * \param[in] ist Index of the state (starting from zero)
+ *
+ * \returns The wavefunction at each point (ny x nz) [1/m]
+ */
+arma::mat SchroedingerSolverWire::get_wavefunction(const unsigned int ist)
+{
+    if(!_solved)
+        calculate();
+
+    if(ist >= _nst)
+    {
+        std::ostringstream oss;
+        oss << "Cannot get state " << ist << ". Only " << _nst << " states were found.";
+        throw std::domain_error(oss.str());
+    }
+
+    // Points are stored with z running fastest, so the column reshapes to
+    // (nz x ny) and must be transposed.
+    return arma::reshape(_psi.col(ist), _z.size(), _y.size()).t();
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,80 @@
+/**
+ * \file   schroedinger-solver-wire.h
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ * \brief  Declarations for Schroedinger solver over the cross-section of a quantum wire
+ */
+
+#ifndef QWWAD_SCHROEDINGER_SOLVER_WIRE_H
+#define QWWAD_SCHROEDINGER_SOLVER_WIRE_H
+
+#include <string>
+#include <armadillo>
+
+namespace QWWAD
+{
+/**
+ * \brief Finite-difference Schroedinger solver over the (y,z) cross-section of a wire
+ *
+ * \details The Hamiltonian uses the 5-point stencil for the BenDaniel-Duke kinetic
+ *          operator, with the effective mass averaged between neighbouring points.
+ *          The wavefunction is zero just outside the mesh.  Only the stencil is
+ *          stored, so the memory needed is proportional to the number of points.
+ *
+ *          The lowest states are found using the LOBPCG method.  Each residual is
+ *          preconditioned by solving the tridiagonal problem along its line of
+ *          constant y, which captures the coupling in z exactly and converges far
+ *          faster than a diagonal preconditioner.  The lines are factorised once.
+ *
+ *          Points are indexed with z running fastest, i.e., p = iy*nz + iz.  The
+ *          wavefunctions are returned as (ny x nz) matrices, normalised so that
+ *          the integral of |psi|^2 over the cross-section is 1.
+ */
+class SchroedingerSolverWire
+{
+private:
+    arma::vec    _y;      ///< Sample locations in y [m]
+    arma::vec    _z;      ///< Sample locations in z [m]
+    arma::mat    _V;      ///< Confining potential at each point (ny x nz) [J]
+    unsigned int _nst;    ///< Number of states to find
+    double       _tol;    ///< Convergence threshold for residuals [J]
+
+    arma::vec _H_diag; ///< Diagonal of the Hamiltonian [J]
+    arma::vec _H_y;    ///< Coupling between points p and p+nz [J]
+    arma::vec _H_z;    ///< Coupling between points p and p+1 (zero at the end of each line) [J]
+
+    double    _shift;  ///< Shift that makes each preconditioning line positive-definite [J]
+    arma::vec _T_D;    ///< Diagonal factors of each preconditioning line
+    arma::vec _T_L;    ///< Subdiagonal factors of each preconditioning line
+
+    bool      _solved; ///< True if the states have been found
+    arma::vec _E;      ///< Energy of each state [J]
+    arma::mat _psi;    ///< Wavefunction of each state (one column per state) [1/m]
+
+    void calculate();
+    arma::cx_mat get_initial_guess(const unsigned int m) const;
+
+public:
+    SchroedingerSolverWire(const arma::vec    &y,
+                           const arma::vec    &z,
+                           const arma::mat    &V,
+                           const arma::mat    &m,
+                           const unsigned int  nst,
+                           const double        tol);
+
+    std::string get_name() const {return "wire-2D";}
+
+    arma::cx_mat apply_hamiltonian(const arma::cx_mat &X) const;
+    arma::cx_mat apply_preconditioner(const arma::cx_mat &R) const;
+
+    const arma::vec & get_energies();
+    arma::mat get_wavefunction(const unsigned int ist);
+
+    /// Get the sample locations in y [m]
+    const arma::vec & get_y() const {return _y;}
+
+    /// Get the sample locations in z [m]
+    const arma::vec & get_z() const {return _z;}
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
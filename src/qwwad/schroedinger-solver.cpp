@@ -7,9 +7,11 @@
 
 #include "schroedinger-solver.h"
 
+#include <complex>
 #include <stdexcept>
 #include <sstream>
 #include "constants.h"
+#include "profiler.h"
 
 namespace QWWAD
 {
@@ -20,47 +22,87 @@ using namespace constants;
  *
  * \details The solutions are computed on the first call to this function, but
  *          subsequent calls just recall the values and are hence much faster.
+ *          They are only recomputed if an input to the calculation has changed,
+ *          or the cut-off energies now extend outside the range that was
+ *          originally searched.
  */
 std::vector<Eigenstate> SchroedingerSolver::get_solutions(const bool convert_to_meV)
 {
-    // Only calculate if we haven't done so yet
-    if(_solutions.empty())
+    update_solutions();
+    return filter_solutions(_solutions, convert_to_meV);
+}
+
+/**
+ * \brief Check whether the cached solutions include every state in the current energy range
+ *
+ * \details This is true if the current cut-off energies lie within the cut-offs used
+ *          in the last calculation.  If no cut-off was used, the solver may instead
+ *          have found a fixed number of states, so the cache is only valid if no
+ *          cut-off is used now either.
+ */
+bool SchroedingerSolver::cache_covers_E_range() const
+{
+    const bool E_min_ok = _calc_E_min_set ? (_E_min_set && _E_min >= _calc_E_min) : !_E_min_set;
+    const bool E_max_ok = _calc_E_max_set ? (_E_max_set && _E_max <= _calc_E_max) : !_E_max_set;
+
+    return E_min_ok && E_max_ok;
+}
+
+/**
+ * \brief Recalculate the solutions if the cached values are out of date
+ */
+void SchroedingerSolver::update_solutions()
+{
+    if(_dirty || !cache_covers_E_range())
     {
-        calculate();
+        _solutions.clear();
+        _z_grid = std::make_shared<const arma::vec>(_z);
 
-        // Delete any states that are out of the desired energy range
-        // Ideally, sub-classes should never compute anything outside this
-        // range!
-        for(auto it = _solutions.begin(); it != _solutions.end(); ++it)
         {
-            if (_E_max_set && gsl_fcmp(it->get_energy(), _E_max, e*1e-12) == 1)
-            {
-                _solutions.erase(it);
-            }
-            else if (_E_min_set && gsl_fcmp(it->get_energy(), _E_min, e*1e-12) == -1)
-            {
-                _solutions.erase(it);
-            }
+            ScopedTimer timer("eigen-solve");
+            calculate();
         }
+
+        _calc_E_min     = _E_min;
+        _calc_E_max     = _E_max;
+        _calc_E_min_set = _E_min_set;
+        _calc_E_max_set = _E_max_set;
+        _dirty          = false;
     }
+}
 
-    if(convert_to_meV)
+/**
+ * \brief Select the solutions that lie within the cut-off energies
+ *
+ * \param[in] solutions      The complete set of solutions [J]
+ * \param[in] convert_to_meV Convert the energies to meV if true
+ *
+ * \details Ideally, sub-classes should never compute anything outside the range,
+ *          but the cache may hold states that were found using wider cut-offs.
+ */
+std::vector<Eigenstate>
+SchroedingerSolver::filter_solutions(const std::vector<Eigenstate> &solutions,
+                                     const bool                     convert_to_meV) const
+{
+    std::vector<Eigenstate> result;
+
+    for(auto sol_J : solutions)
     {
-        std::vector<Eigenstate> sol_meV;
+        const auto E = sol_J.get_energy();
 
-        for(auto sol_J : _solutions)
-        {
-            const auto E   = sol_J.get_energy();
-            const auto z   = sol_J.get_position_samples();
-            const auto psi = sol_J.get_wavefunction_samples();
+        if (_E_max_set && gsl_fcmp(E, _E_max, e*1e-12) == 1)
+            continue;
 
-            sol_meV.push_back(Eigenstate(E*1000/e, z, psi));
-        }
+        if (_E_min_set && gsl_fcmp(E, _E_min, e*1e-12) == -1)
+            continue;
 
-        return sol_meV;
+        if(convert_to_meV)
+            result.push_back(sol_J.with_energy(E*1000/e));
+        else
+            result.push_back(sol_J);
     }
-    else
-        return _solutions;
+
+    return result;
 }
 
 /**
@@ -76,14 +118,71 @@ SchroedingerSolver::SchroedingerSolver(const decltype(_V)       &V,
                                        const decltype(_nst_max)  nst_max) :
     _V(V),
     _z(z),
+    _z_grid(std::make_shared<const arma::vec>(_z)),
     _nst_max(nst_max),
     _E_min(0.0),
     _E_max(0.0),
     _E_min_set(false),
     _E_max_set(false),
-    _solutions()
+    _dirty(true),
+    _calc_E_min(0.0),
+    _calc_E_max(0.0),
+    _calc_E_min_set(false),
+    _calc_E_max_set(false),
+    _solutions(),
+    _guess()
 {}
 
+/**
+ * \brief Find the period of the structure, if it is treated as one period of a superlattice
+ *
+ * \returns The period [m]
+ *
+ * \details The point after the last one is taken to be the first point of the next
+ *          period, so the period is nz times the spacing between the first two points
+ *          for a uniform mesh.
+ */
+double SchroedingerSolver::get_bloch_period() const
+{
+    const size_t nz = _z.size();
+    return _z[nz-1] - _z[0] + (_z[1] - _z[0]);
+}
+
+/**
+ * \brief Find a real wavefunction to represent a Bloch state
+ *
+ * \param[in] psi Complex Bloch wavefunction for a single period
+ *
+ * \returns The real part of the wavefunction, after removing the global phase
+ *
+ * \details The global phase is chosen to make the real part as large as possible.
+ *          At the centre and edges of the Brillouin zone, the Bloch states are real
+ *          (apart from a global phase), so nothing is lost.  Elsewhere, they are
+ *          travelling waves, and this gives the standing-wave part of the state.
+ */
+arma::vec SchroedingerSolver::real_bloch_envelope(const arma::cx_vec &psi)
+{
+    const double theta = std::arg(arma::accu(psi % psi))/2;
+    return arma::real(psi * std::polar(1.0, -theta));
+}
+
+/**
+ * \brief Provide approximate solutions to start the calculation from
+ *
+ * \param[in] guess A set of approximate eigenstates (energy in J), e.g., the solutions
+ *                  for a slightly different potential profile in a parameter sweep
+ *
+ * \details Solvers that support warm starts will refine these states rather than
+ *          solving the problem from scratch, and will fall back to a full solution
+ *          if the guess turns out to be unsuitable.  Other solvers ignore the guess.
+ *          Any previously computed solutions are discarded.
+ */
+void SchroedingerSolver::set_initial_guess(const decltype(_guess) &guess)
+{
+    _guess = guess;
+    _dirty = true;
+}
+
 /**
  * \brief Set the lower cut-off energy
  *
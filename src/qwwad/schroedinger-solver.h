@@ -15,7 +15,10 @@ namespace QWWAD
 /**
  * Abstract base class for any Schroedinger-equation solver
  *
- * \todo Cache the solutions and only calculate on first request
+ * \details The solutions are calculated on the first request and cached.
+ *          Derived classes must set _dirty whenever an input to the
+ *          calculation changes, so that the solutions are recalculated the
+ *          next time they are requested.
  */
 class SchroedingerSolver
 {
@@ -24,6 +27,9 @@ protected:
 
     arma::vec    _V;       ///< Confining potential [J]
     arma::vec    _z;       ///< Spatial points [m]
+
+    ///< Copy of the spatial points that is shared by all the solutions
+    std::shared_ptr<const arma::vec> _z_grid;
     unsigned int _nst_max; ///< Maximum number of states to find
 
     // Options for specifying cut-off energy
@@ -32,9 +38,27 @@ protected:
     bool   _E_min_set;    ///< True if lower cut-off energy has been set
     bool   _E_max_set;    ///< True if upper cut-off energy has been set
 
+    bool   _dirty;        ///< True if the cached solutions need to be recalculated
+
+    // Cut-off energies that were used for the cached solutions
+    double _calc_E_min;       ///< Lower cut-off energy used in last calculation [J]
+    double _calc_E_max;       ///< Upper cut-off energy used in last calculation [J]
+    bool   _calc_E_min_set;   ///< True if lower cut-off was set in last calculation
+    bool   _calc_E_max_set;   ///< True if upper cut-off was set in last calculation
+
+    bool cache_covers_E_range() const;
+    void update_solutions();
+    std::vector<Eigenstate> filter_solutions(const std::vector<Eigenstate> &solutions,
+                                             const bool                     convert_to_meV) const;
+
+    static arma::vec real_bloch_envelope(const arma::cx_vec &psi);
+
     ///< Set of solutions to the Schroedinger equation
     std::vector<Eigenstate> _solutions;
 
+    ///< Approximate solutions used as a starting point for the calculation
+    std::vector<Eigenstate> _guess;
+
 public:
     SchroedingerSolver(const decltype(_V)       &V,
                        const decltype(_z)       &z,
@@ -52,12 +76,16 @@ public:
      */
     decltype(_V) get_V() const {return _V;}
 
+    double get_bloch_period() const;
+
     virtual std::string get_name() = 0;
     virtual ~SchroedingerSolver() {};
 
     void set_E_min(const double E_min);
     void set_E_max(const double E_max);
 
+    void set_initial_guess(const decltype(_guess) &guess);
+
     /**
      * \brief Turn off filtering of solutions by energy
      */
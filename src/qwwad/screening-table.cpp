@@ -0,0 +1,109 @@
+/**
+ * \file   screening-table.cpp
+ * \brief  Tabulated polarizability for screening of Coulomb interactions in a 2D system
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include <sstream>
+#include <stdexcept>
+#include "screening-table.h"
+#include "constants.h"
+#include "maths-helpers.h"
+
+namespace QWWAD
+{
+using namespace constants;
+
+/**
+ * \brief returns the screening factor, referred to by Smet as e_sc
+ *
+ * \param[in] sb     The subband
+ * \param[in] q_perp Scattering vector [1/m]
+ * \param[in] T      Temperature of carrier distribution [K]
+ */
+double find_PI(const Subband &sb,
+               const double   q_perp,
+               const double   T)
+{
+    const double m = sb.get_effective_mass();    // Effective mass at band-edge [kg]
+
+    // Now perform the integration, equation 44 of Smet [QWWAD3, 10.238]
+    const double Ek_max = sb.get_Ek_at_k(sb.get_k_max(T));
+    const size_t nE = 101;
+    const double dE = Ek_max/(nE-1);
+
+    arma::vec PI_integrand_dE(nE);
+
+    // Integrate from bottom of subband up to Ek_max (Ef + 5kT)
+    for(unsigned int iE = 0; iE < nE; ++iE)
+    {
+        const double Ek = iE*dE; // Kinetic energy
+        const double ki = sb.get_k_at_Ek(Ek);
+        const double Et = sb.get_E_total_at_k(ki);
+
+        // Find low-temperature polarizability *at this wave-vector*
+        // Equation 43 of Smet, QWWAD3, 10.236
+        double P0 = m/(pi*hBar*hBar);
+
+        if(q_perp>2*ki)
+            P0 -= m/(pi*hBar*hBar)*sqrt(1-4*ki*ki/(q_perp*q_perp));
+
+        const double cosh_term = cosh((Et - sb.get_Ef())/(2*kB*T));
+        PI_integrand_dE[iE] = P0/(4*kB*T*cosh_term*cosh_term);
+    }
+
+    const double result = integral(PI_integrand_dE, dE);
+    return result;
+}
+
+/**
+ * \brief Tabulate the polarizability for a subband
+ *
+ * \param[in] sb    The subband
+ * \param[in] T     Temperature of carrier distribution [K]
+ * \param[in] q_max Largest scattering vector in the table [1/m]
+ * \param[in] nq    Number of samples in the table
+ */
+ScreeningTable::ScreeningTable(const decltype(_sb) &sb,
+                               const decltype(_T)   T,
+                               const double         q_max,
+                               const size_t         nq) :
+    _sb(sb),
+    _T(T),
+    _q(nq),
+    _PI(nq)
+{
+    if(nq < 3)
+    {
+        std::ostringstream oss;
+        oss << "Need at least 3 samples in screening table, but " << nq << " requested.";
+        throw std::length_error(oss.str());
+    }
+
+    const double dq = q_max/(nq-1);
+
+    for(unsigned int iq = 0; iq < nq; ++iq)
+    {
+        _q[iq]  = iq*dq;
+        _PI[iq] = find_PI(_sb, _q[iq], _T);
+    }
+
+    _spline = std::shared_ptr<gsl_spline>(gsl_spline_alloc(gsl_interp_cspline, nq), gsl_spline_free);
+    gsl_spline_init(_spline.get(), _q.memptr(), _PI.memptr(), nq);
+}
+
+/**
+ * \brief Find the polarizability at a given scattering vector [J^{-1}m^{-2}]
+ *
+ * \param[in] q_perp Scattering vector [1/m]
+ */
+double ScreeningTable::get_PI(const double q_perp) const
+{
+    if(q_perp > get_q_max())
+        return find_PI(_sb, q_perp, _T);
+
+    // No accelerator is used, so that the table can be shared between threads
+    return gsl_spline_eval(_spline.get(), q_perp, nullptr);
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
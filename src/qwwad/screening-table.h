@@ -0,0 +1,54 @@
+/**
+ * \file   screening-table.h
+ * \brief  Tabulated polarizability for screening of Coulomb interactions in a 2D system
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_SCREENING_TABLE_H
+#define QWWAD_SCREENING_TABLE_H
+
+#include <memory>
+#include <gsl/gsl_spline.h>
+#include "subband.h"
+
+namespace QWWAD
+{
+double find_PI(const Subband &sb,
+               const double   q_perp,
+               const double   T);
+
+/**
+ * \brief A table of the polarizability for a subband, as a function of scattering vector
+ *
+ * \details The polarizability, \f$\Pi(q)\f$, is an integral over the carrier
+ *          distribution in the subband [QWWAD3, 10.238].  It is found once on a
+ *          uniform grid of scattering vectors, and then interpolated using a cubic
+ *          spline.  Scattering vectors above the end of the table are found
+ *          directly.
+ *
+ *          The table does not change after it is created, so it can be read from
+ *          several threads at once.
+ */
+class ScreeningTable {
+private:
+    Subband   _sb; ///< The subband
+    double    _T;  ///< Temperature of carrier distribution [K]
+    arma::vec _q;  ///< Scattering vector samples [1/m]
+    arma::vec _PI; ///< Polarizability at each sample [J^{-1}m^{-2}]
+
+    std::shared_ptr<gsl_spline> _spline; ///< Spline fit to the table
+
+public:
+    ScreeningTable(const decltype(_sb) &sb,
+                   const decltype(_T)   T,
+                   const double         q_max,
+                   const size_t         nq = 1001);
+
+    double get_PI(const double q_perp) const;
+
+    /// Return the largest scattering vector in the table [1/m]
+    inline double get_q_max() const {return _q[_q.size()-1];}
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
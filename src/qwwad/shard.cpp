@@ -0,0 +1,105 @@
+/**
+ * \file   shard.cpp
+ * \brief  Split a list of independent calculations between separate jobs
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "shard.h"
+#include <sstream>
+#include <stdexcept>
+
+namespace QWWAD
+{
+/**
+ * \brief Create a shard that holds the entire list of items
+ */
+Shard::Shard() :
+    _index(1),
+    _n_shards(1)
+{}
+
+/**
+ * \brief Create a shard from its specification
+ *
+ * \param[in] spec The specification, "i/n", where i is the index of this job, from 1 to n
+ */
+Shard::Shard(const std::string &spec) :
+    _index(0),
+    _n_shards(0)
+{
+    std::istringstream iss(spec);
+    char separator = 0;
+    iss >> _index >> separator >> _n_shards;
+
+    if(iss.fail() || !iss.eof() || separator != '/' || _n_shards == 0 ||
+       _index == 0 || _index > _n_shards)
+    {
+        std::ostringstream oss;
+        oss << "Invalid shard specification: " << spec << ".  Expected i/n, with 1 <= i <= n.";
+        throw std::invalid_argument(oss.str());
+    }
+}
+
+/**
+ * \brief Find the items that belong to this job
+ *
+ * \param[in] n_items Total number of items
+ *
+ * \returns The indices of the items that belong to this job, in ascending order
+ */
+std::vector<size_t> Shard::get_local_items(const size_t n_items) const
+{
+    std::vector<size_t> items;
+
+    for(size_t item = _index - 1; item < n_items; item += _n_shards)
+        items.push_back(item);
+
+    return items;
+}
+
+/**
+ * \brief Find the name of the output file for this job
+ *
+ * \param[in] filename Name of the file for the complete list of items
+ *
+ * \returns The name of the file for this job.  This is unchanged if there is only one job.
+ */
+std::string Shard::get_filename(const std::string &filename) const
+{
+    return get_filename(filename, _index, _n_shards);
+}
+
+/**
+ * \brief Find the name of the output file for a given job
+ *
+ * \param[in] filename Name of the file for the complete list of items
+ * \param[in] index    Index of the job (from 1)
+ * \param[in] n_shards Number of jobs
+ *
+ * \details The job number is inserted before the extension, so "LOe-if.r" from
+ *          job 2 of 4 becomes "LOe-if-shard2of4.r".  The name is unchanged if
+ *          there is only one job.
+ *
+ * \returns The name of the file
+ */
+std::string Shard::get_filename(const std::string  &filename,
+                                const unsigned int  index,
+                                const unsigned int  n_shards)
+{
+    if(n_shards == 1)
+        return filename;
+
+    const auto dot   = filename.find_last_of('.');
+    const auto slash = filename.find_last_of('/');
+    const bool has_extension = (dot != std::string::npos) &&
+                               (slash == std::string::npos || dot > slash);
+
+    const std::string stem      = has_extension ? filename.substr(0, dot) : filename;
+    const std::string extension = has_extension ? filename.substr(dot)    : "";
+
+    std::ostringstream oss;
+    oss << stem << "-shard" << index << "of" << n_shards << extension;
+    return oss.str();
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,97 @@
+/**
+ * \file   shard.h
+ * \brief  Split a list of independent calculations between separate jobs
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_SHARD_H
+#define QWWAD_SHARD_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <armadillo>
+
+namespace QWWAD
+{
+/**
+ * \brief One part of a list of work items, which is shared between several jobs
+ *
+ * \details The part is specified as "i/n", meaning that this is job i of n, where
+ *          i runs from 1 to n.  Job i takes items i-1, i-1+n, i-1+2n, ... of the
+ *          list, so every job gets a similar share and the split depends only on
+ *          the length of the list.  The jobs do not need to communicate, so they
+ *          can be run independently, e.g., by a batch scheduler.
+ *
+ *          Each job writes its own copy of any summary files, which can be
+ *          reassembled in the original order using qwwad_merge_shards.
+ */
+class Shard
+{
+public:
+    Shard();
+    explicit Shard(const std::string &spec);
+
+    /** Return the index of this job (from 1) */
+    unsigned int get_index() const {return _index;}
+
+    /** Return the number of jobs */
+    unsigned int get_n_shards() const {return _n_shards;}
+
+    /** Return true if a given work item belongs to this job */
+    bool owns(const size_t item) const {return item % _n_shards == _index - 1;}
+
+    std::vector<size_t> get_local_items(const size_t n_items) const;
+
+    std::string get_filename(const std::string &filename) const;
+
+    static std::string get_filename(const std::string  &filename,
+                                    const unsigned int  index,
+                                    const unsigned int  n_shards);
+
+    template <class T>
+    arma::Col<T> select(const arma::Col<T> &items) const;
+
+    template <class... T>
+    void select_in_place(arma::Col<T> &...lists) const;
+
+private:
+    unsigned int _index;    ///< Index of this job (from 1)
+    unsigned int _n_shards; ///< Number of jobs
+};
+
+/**
+ * \brief Select the items that belong to this job
+ *
+ * \param[in] items The complete list of items
+ *
+ * \returns The items that belong to this job, in their original order
+ */
+template <class T>
+arma::Col<T> Shard::select(const arma::Col<T> &items) const
+{
+    const auto local = get_local_items(items.size());
+    arma::Col<T> result(local.size());
+
+    for(unsigned int i = 0; i < local.size(); ++i)
+        result[i] = items[local[i]];
+
+    return result;
+}
+
+/**
+ * \brief Keep only the items that belong to this job, in each of several lists
+ *
+ * \param[in,out] lists Lists of the same length, e.g., the initial and final
+ *                      subbands of each transition
+ */
+template <class... T>
+void Shard::select_in_place(arma::Col<T> &...lists) const
+{
+    const int selected[] = {(lists = select(lists), 0)...};
+    (void)selected;
+}
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,327 @@
+/**
+ * \file   state-set.cpp
+ * \brief  A set of eigenstates, stored as a single matrix of samples
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "state-set.h"
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+#include "maths-helpers.h"
+
+namespace QWWAD
+{
+/**
+ * \brief Copy a set of states into a single matrix
+ *
+ * \param[in] states The states, which must all use the same spatial grid
+ */
+StateSet::StateSet(const std::vector<Eigenstate> &states) :
+    _E(states.size()),
+    _z(),
+    _psi(),
+    _w()
+{
+    if(states.empty())
+        throw std::invalid_argument("Cannot create a set without any states.");
+
+    _z   = states[0].get_position_grid();
+    _psi = std::make_shared<const arma::mat>(Eigenstate::get_wavefunction_matrix(states));
+    _w   = states[0].get_quadrature().get_weights();
+
+    for(unsigned int ist = 0; ist < states.size(); ++ist)
+        _E[ist] = states[ist].get_energy();
+}
+
+/**
+ * \brief Create a set of states from a matrix of samples
+ *
+ * \param[in] E   Energy of each state [J]
+ * \param[in] z   Spatial sampling positions [m], shared with other states
+ * \param[in] psi Wavefunctions, with one column per state (need not be normalised)
+ */
+StateSet::StateSet(const arma::vec                        &E,
+                   const std::shared_ptr<const arma::vec> &z,
+                   const arma::mat                        &psi) :
+    _E(E),
+    _z(z),
+    _psi(),
+    _w()
+{
+    if(!_z)
+        throw std::invalid_argument("State set created without a spatial grid.");
+
+    if(psi.n_rows != _z->size() || psi.n_cols != E.size())
+    {
+        std::ostringstream oss;
+        oss << "Got a " << psi.n_rows << "x" << psi.n_cols << " matrix of wavefunctions for "
+            << E.size() << " states on " << _z->size() << " samples.";
+        throw std::length_error(oss.str());
+    }
+
+    _w = get_shared_quadrature(_z)->get_weights();
+
+    arma::mat psi_norm = psi;
+
+    for(unsigned int ist = 0; ist < E.size(); ++ist)
+    {
+        double *col = psi_norm.colptr(ist);
+        double  P   = 0.0;
+
+        for(unsigned int iz = 0; iz < psi_norm.n_rows; ++iz)
+            P += col[iz]*col[iz]*_w[iz];
+
+        const double A = 1.0/sqrt(P);
+
+        for(unsigned int iz = 0; iz < psi_norm.n_rows; ++iz)
+            col[iz] *= A;
+    }
+
+    _psi = std::make_shared<const arma::mat>(psi_norm);
+}
+
+/**
+ * \brief Scale the wavefunctions by the quadrature weights and a sampled function
+ *
+ * \param[in] f Function to multiply by, at each sample
+ *
+ * \returns The weighted wavefunctions, so that \f$\Psi^T\f$ times this matrix
+ *          gives the matrix elements of \f$f\f$ between each pair of states
+ */
+arma::mat StateSet::get_weighted_wavefunctions(const arma::vec &f) const
+{
+    const auto nz  = get_n_samples();
+    const auto nst = size();
+
+    arma::mat Psi_w(nz, nst);
+
+    for(unsigned int ist = 0; ist < nst; ++ist)
+    {
+        const double *psi   = _psi->colptr(ist);
+        double       *psi_w = Psi_w.colptr(ist);
+
+        for(unsigned int iz = 0; iz < nz; ++iz)
+            psi_w[iz] = psi[iz]*_w[iz]*f[iz];
+    }
+
+    return Psi_w;
+}
+
+/**
+ * \brief Get a single state from the set
+ *
+ * \param[in] ist Index of the state
+ *
+ * \details The state shares the samples in the set, and only copies its own
+ *          column the first time that its wavefunction is requested.
+ */
+Eigenstate StateSet::get_state(const size_t ist) const
+{
+    if(ist >= size())
+    {
+        std::ostringstream oss;
+        oss << "Cannot get state " << ist << " from a set of " << size() << " states.";
+        throw std::out_of_range(oss.str());
+    }
+
+    const auto psi = _psi;
+
+    return Eigenstate(_E[ist], _z, [psi, ist]() {return arma::vec(psi->col(ist));});
+}
+
+/**
+ * \brief Get every state in the set as a separate Eigenstate
+ */
+std::vector<Eigenstate> StateSet::to_vector() const
+{
+    std::vector<Eigenstate> states;
+    states.reserve(size());
+
+    for(unsigned int ist = 0; ist < size(); ++ist)
+        states.push_back(get_state(ist));
+
+    return states;
+}
+
+/**
+ * \brief Find the overlap integral between every pair of states
+ *
+ * \returns The matrix \f$S = \Psi^T W \Psi\f$, where \f$W\f$ holds the quadrature weights
+ */
+arma::mat StateSet::get_overlap_matrix() const
+{
+    return _psi->t() * get_weighted_wavefunctions(arma::ones(get_n_samples()));
+}
+
+/**
+ * \brief Find the dipole matrix elements between every pair of states
+ *
+ * \returns A matrix whose (i,j) element is the dipole matrix element between
+ *          states i and j [m].  The diagonal holds the expectation positions.
+ *
+ * \details The overlap matrix \f$S = \Psi^T W \Psi\f$ and the moment matrix
+ *          \f$Z = \Psi^T W z \Psi\f$ are each found using a single matrix product.
+ *          Each off-diagonal element then uses the same pivot position as
+ *          Eigenstate::get_position_matrix_element, \f$z_{ij} = Z_{ij} - z_0 S_{ij}\f$.
+ */
+arma::mat StateSet::get_position_matrix() const
+{
+    const auto nst = size();
+
+    const arma::mat S = get_overlap_matrix();
+    arma::mat       Z = _psi->t() * get_weighted_wavefunctions(*_z);
+
+    for(unsigned int i = 0; i < nst; ++i)
+    {
+        for(unsigned int j = 0; j < nst; ++j)
+        {
+            if(i != j)
+            {
+                const double z0 = 0.5*(Z(i,i) + Z(j,j));
+                Z(i,j) -= z0*S(i,j);
+            }
+        }
+    }
+
+    return Z;
+}
+
+/**
+ * \brief Find the momentum matrix elements between every pair of states
+ *
+ * \returns A matrix whose (i,j) element is \f$\langle i|\frac{d}{dz}|j\rangle\f$ [1/m].
+ *          The momentum matrix element is \f$-i\hbar\f$ times this.
+ *
+ * \details The derivative of every wavefunction is found by central differences,
+ *          and all the integrals are then found using a single matrix product.
+ */
+arma::mat StateSet::get_momentum_matrix() const
+{
+    const auto &z   = *_z;
+    const auto  nz  = z.size();
+    const auto  nst = size();
+
+    if(nz < 3)
+        throw std::runtime_error("Need at least three points to find momentum matrix elements");
+
+    // Weighted derivative of each wavefunction.  The wavefunctions vanish at the
+    // edges of the system, so the end points are left at zero
+    arma::mat dPsi_w(nz, nst, arma::fill::zeros);
+
+    for(unsigned int ist = 0; ist < nst; ++ist)
+    {
+        const double *psi    = _psi->colptr(ist);
+        double       *dpsi_w = dPsi_w.colptr(ist);
+
+        for(unsigned int iz = 1; iz < nz-1; ++iz)
+            dpsi_w[iz] = (psi[iz+1] - psi[iz-1]) * (_w[iz]/(z[iz+1] - z[iz-1]));
+    }
+
+    return _psi->t()*dPsi_w;
+}
+
+/**
+ * \brief Find the position and momentum moments of every state
+ *
+ * \returns A matrix with one row per state.  The columns hold \f$\langle z\rangle\f$ [m],
+ *          \f$\langle z^2\rangle\f$ [m^2], \f$\langle p\rangle/i\hbar\f$ [1/m] and
+ *          \f$\langle p^2\rangle/\hbar^2\f$ [1/m^2] respectively.
+ *
+ * \details The derivatives are found by three-point differences, and all four
+ *          integrals are accumulated together in a single pass over each
+ *          wavefunction.  The wavefunctions vanish at the edges of the system, so
+ *          the end points do not contribute to the momentum moments.
+ */
+arma::mat StateSet::get_moments() const
+{
+    const auto &z   = *_z;
+    const auto  nz  = z.size();
+    const auto  nst = size();
+
+    if(nz < 3)
+        throw std::runtime_error("Need at least three points to find moments of states");
+
+    arma::mat moments(nst, 4);
+
+    for(unsigned int ist = 0; ist < nst; ++ist)
+    {
+        const double *psi = _psi->colptr(ist);
+
+        double ev_z    = 0.0;
+        double ev_zsqr = 0.0;
+        double ev_p    = 0.0;
+        double ev_psqr = 0.0;
+
+        for(unsigned int iz = 0; iz < nz; ++iz)
+        {
+            const double PD_w = psi[iz]*psi[iz]*_w[iz];
+            ev_z    += PD_w*z[iz];
+            ev_zsqr += PD_w*z[iz]*z[iz];
+
+            if(iz > 0 && iz < nz-1)
+            {
+                const double h_lo = z[iz]   - z[iz-1];
+                const double h_hi = z[iz+1] - z[iz];
+
+                const double d_psi_dz   = (psi[iz+1] - psi[iz-1])/(h_lo + h_hi);
+                const double d2_psi_dz2 = 2*((psi[iz+1] - psi[iz])/h_hi - (psi[iz] - psi[iz-1])/h_lo)/(h_lo + h_hi);
+
+                ev_p    -= psi[iz]*d_psi_dz*_w[iz];
+                ev_psqr -= psi[iz]*d2_psi_dz2*_w[iz];
+            }
+        }
+
+        moments(ist, 0) = ev_z;
+        moments(ist, 1) = ev_zsqr;
+        moments(ist, 2) = ev_p;
+        moments(ist, 3) = ev_psqr;
+    }
+
+    return moments;
+}
+
+/**
+ * \brief Find the carrier density due to the populated states
+ *
+ * \param[in] N    Sheet density of carriers in each state [m^{-2}]
+ * \param[in] nper Number of periods crossed by the wavefunctions
+ *
+ * \returns The carrier density at each point in a single period [m^{-3}]
+ *
+ * \details The density over the whole structure is found as the single product
+ *          \f$|\Psi|^2 N\f$, where each column of \f$|\Psi|^2\f$ is the probability
+ *          density of a state [QWWAD4, 3.108].  For a periodic structure, the
+ *          "tails" of the wavefunctions in each period are then summed into the
+ *          first period.  This is done by viewing the density as a matrix with one
+ *          column per period, so nothing is copied or recomputed.
+ */
+arma::vec StateSet::get_carrier_density(const arma::vec &N,
+                                        const size_t     nper) const
+{
+    if(N.size() != size())
+    {
+        std::ostringstream oss;
+        oss << "Got " << N.size() << " populations for " << size() << " states.";
+        throw std::length_error(oss.str());
+    }
+
+    if(nper < 1)
+        throw std::domain_error("Number of periods must be one or more.");
+
+    arma::vec n = square(*_psi) * N;
+
+    if(nper == 1)
+        return n;
+
+    const size_t nz_1per = n.size() / nper; // Number of points in a single period
+
+    // View the density as one column per period, and sum across the periods
+    const arma::mat n_per(n.memptr(), nz_1per, nper, false, true);
+
+    return arma::sum(n_per, 1);
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,78 @@
+/**
+ * \file   state-set.h
+ * \brief  A set of eigenstates, stored as a single matrix of samples
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_STATE_SET_H
+#define QWWAD_STATE_SET_H
+
+#include <memory>
+#include <vector>
+#include <armadillo>
+#include "eigenstate.h"
+
+namespace QWWAD
+{
+/**
+ * \brief A set of eigenstates on a common spatial grid
+ *
+ * \details The wavefunctions are stored as the columns of one contiguous
+ *          matrix, so that operations over every pair of states (overlaps, dipole
+ *          matrix elements, carrier densities) are single matrix products, rather
+ *          than loops over separately-allocated samples.  The samples are shared
+ *          between copies of the set, and with any Eigenstate taken from it.
+ */
+class StateSet
+{
+private:
+    arma::vec                        _E;   ///< Energy of each state [J]
+    std::shared_ptr<const arma::vec> _z;   ///< Spatial sampling positions [m]
+    std::shared_ptr<const arma::mat> _psi; ///< Wavefunctions [m^{-0.5}], with one column per state
+    arma::vec                        _w;   ///< Quadrature weight for each sample [m]
+
+    arma::mat get_weighted_wavefunctions(const arma::vec &f) const;
+
+public:
+    StateSet(const std::vector<Eigenstate> &states);
+
+    StateSet(const arma::vec                        &E,
+             const std::shared_ptr<const arma::vec> &z,
+             const arma::mat                        &psi);
+
+    /// Return the number of states
+    inline size_t size() const {return _E.size();}
+
+    /// Return the number of spatial samples in each wavefunction
+    inline size_t get_n_samples() const {return _z->size();}
+
+    /// Return the energy of each state [J]
+    inline const arma::vec & get_energies() const {return _E;}
+
+    /// Return the spatial sampling positions [m]
+    inline const arma::vec & get_position_samples() const {return *_z;}
+
+    /// Return the spatial grid, so that it can be shared with other states
+    inline std::shared_ptr<const arma::vec> get_position_grid() const {return _z;}
+
+    /// Return the wavefunctions [m^{-0.5}], with one column per state
+    inline const arma::mat & get_wavefunctions() const {return *_psi;}
+
+    Eigenstate get_state(const size_t ist) const;
+
+    std::vector<Eigenstate> to_vector() const;
+
+    arma::mat get_overlap_matrix() const;
+
+    arma::mat get_position_matrix() const;
+
+    arma::mat get_momentum_matrix() const;
+
+    arma::mat get_moments() const;
+
+    arma::vec get_carrier_density(const arma::vec &N,
+                                  const size_t     nper = 1) const;
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,346 @@
+/**
+ * \file   structure-sensitivity.cpp
+ * \brief  First-order sensitivity of eigenstates to the structure of a heterostructure
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "structure-sensitivity.h"
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+#include "constants.h"
+#include "mesh.h"
+#include "schroedinger-solver-tridiagonal.h"
+
+namespace QWWAD
+{
+using namespace constants;
+
+/**
+ * \brief Find the index of the first sample above the top of each layer in a mesh
+ *
+ * \param[in] mesh The mesh
+ */
+static arma::uvec get_layer_top_indices(const Mesh &mesh)
+{
+    const auto iz_top = mesh.get_layer_top_indices();
+    arma::uvec iz_I(iz_top.size());
+
+    for(unsigned int iL = 0; iL < iz_top.size(); ++iL)
+        iz_I[iL] = iz_top[iL];
+
+    return iz_I;
+}
+
+/**
+ * \brief Set up the sensitivity calculation for a set of states
+ *
+ * \param[in] states Eigenstates of the unperturbed structure
+ * \param[in] V      Potential at each sample [J]
+ * \param[in] m      Effective mass at each sample [kg]
+ * \param[in] iz_I   Index of the first sample above the top of each layer, as
+ *                   written to interfaces.r by qwwad_mesh
+ */
+StructureSensitivity::StructureSensitivity(const std::vector<Eigenstate> &states,
+                                           const arma::vec               &V,
+                                           const arma::vec               &m,
+                                           const arma::uvec              &iz_I) :
+    _z(),
+    _h(),
+    _V(V),
+    _m(m),
+    _E(states.size()),
+    _psi(),
+    _iz_I(iz_I)
+{
+    if(states.empty())
+        throw std::invalid_argument("No eigenstates were given.");
+
+    _z = states[0].get_position_samples();
+    const size_t nz = _z.size();
+
+    if(V.size() != nz || m.size() != nz || nz < 2)
+    {
+        std::ostringstream oss;
+        oss << "Cannot make a structure from " << nz << " positions, " << V.size()
+            << " potentials and " << m.size() << " masses.";
+        throw std::length_error(oss.str());
+    }
+
+    _psi.set_size(nz, states.size());
+
+    for(unsigned int ist = 0; ist < states.size(); ++ist)
+    {
+        if(states[ist].get_wavefunction_samples().size() != nz)
+        {
+            std::ostringstream oss;
+            oss << "State " << ist+1 << " has " << states[ist].get_wavefunction_samples().size()
+                << " samples, but the structure has " << nz << ".";
+            throw std::length_error(oss.str());
+        }
+
+        _E[ist]       = states[ist].get_energy();
+        _psi.col(ist) = states[ist].get_wavefunction_samples();
+    }
+
+    for(unsigned int iL = 0; iL < iz_I.size(); ++iL)
+    {
+        if(iz_I[iL] > nz || (iL > 0 && iz_I[iL] < iz_I[iL-1]))
+        {
+            std::ostringstream oss;
+            oss << "Interface index " << iz_I[iL] << " for layer " << iL+1
+                << " is out of order, or outside a structure with " << nz << " samples.";
+            throw std::domain_error(oss.str());
+        }
+    }
+
+    _h = SchroedingerSolverTridiag::get_cell_widths(_z);
+}
+
+/**
+ * \brief Set up the sensitivity calculation, using the layers of a mesh
+ *
+ * \param[in] states Eigenstates of the unperturbed structure
+ * \param[in] V      Potential at each sample [J]
+ * \param[in] m      Effective mass at each sample [kg]
+ * \param[in] mesh   The mesh on which the states were found
+ */
+StructureSensitivity::StructureSensitivity(const std::vector<Eigenstate> &states,
+                                           const arma::vec               &V,
+                                           const arma::vec               &m,
+                                           const Mesh                    &mesh) :
+    StructureSensitivity(states, V, m, get_layer_top_indices(mesh))
+{}
+
+/**
+ * \brief Find the perturbation caused by moving one interface upwards
+ *
+ * \param[in] iI Index of the layer whose top interface is moved
+ * \param[in] F  Applied electric field [V/m]
+ *
+ * \returns The matrix elements of the perturbation between each pair of states [J/m]
+ *
+ * \details When the interface moves up, a thin slice of the upper material is
+ *          replaced by the lower material.  The derivative of the wavefunction is
+ *          discontinuous at the interface, so the perturbation is written in terms
+ *          of the quantities that are continuous across it:
+ *          \f[
+ *            (V_- - V_+)\psi_i\psi_j + \frac{\hbar^2}{2}(m_+ - m_-)D_iD_j,
+ *          \f]
+ *          where \f$D = \frac{1}{m}\frac{d\psi}{dz}\f$ and the subscripts denote
+ *          the materials below and above the interface.  The step in potential is
+ *          that of the band edge alone, so the drop \f$eF\delta z\f$ caused by the
+ *          field between the two samples is removed from it.
+ */
+arma::mat StructureSensitivity::get_interface_perturbation(const unsigned int iI,
+                                                           const double       F) const
+{
+    const size_t nst = _E.size();
+    const auto   ib  = _iz_I[iI]; // First sample above the interface
+
+    // There is no interface at the bottom or top of the structure
+    if(ib == 0 || ib >= _z.size())
+        return arma::zeros(nst, nst);
+
+    const auto   ia     = ib - 1; // Last sample below the interface
+    const double dz     = _z[ib] - _z[ia];
+    const double m_half = 0.5*(_m[ia] + _m[ib]);
+    const double dV     = _V[ia] - _V[ib] - e*F*dz; // Band-edge step [J]
+
+    const arma::mat psi_I = 0.5*(_psi.row(ia) + _psi.row(ib));
+    const arma::mat D_I   = (_psi.row(ib) - _psi.row(ia))/(dz*m_half);
+
+    return dV * (psi_I.t()*psi_I)
+           + 0.5*hBar*hBar*(_m[ib] - _m[ia]) * (D_I.t()*D_I);
+}
+
+/**
+ * \brief Find the perturbation caused by widening each layer
+ *
+ * \param[in] F Applied electric field [V/m].  The potential is taken to be
+ *              \f$V_{\rm b}(z) - eFz\f$, where \f$V_{\rm b}\f$ is the band edge.
+ *
+ * \returns A matrix of perturbation elements [J/m] for each layer
+ *
+ * \details Widening a layer by \f$\delta\f$ moves all the material above its top
+ *          interface, \f$z_I\f$, upwards by the same amount, with the field held
+ *          constant.  Moving the whole potential rigidly would give
+ *          \f[
+ *            W = \sum_{I' \ge I} W_{I'} + eF\int_{z>z_I}\psi_i\psi_j\,dz,
+ *          \f]
+ *          where \f$W_{I'}\f$ is the perturbation from the band-edge step at each
+ *          interface above, and the last term comes from the field's slope.  At
+ *          constant field, however, the new slice of lower material adds a drop of
+ *          \f$eF\delta\f$ across it, so that the layers above are also shifted by
+ *          \f$-eF\delta\f$.  This adds \f$-eF\int_{z>z_I}\psi_i\psi_j\,dz\f$, which
+ *          cancels the term from the field's slope.  Only the band-edge steps are
+ *          left, and the field enters only by being removed from each step.
+ */
+std::vector<arma::mat> StructureSensitivity::get_layer_width_perturbations(const double F) const
+{
+    const size_t           nL  = _iz_I.size();
+    const size_t           nst = _E.size();
+    std::vector<arma::mat> W(nL);
+    arma::mat              W_above(nst, nst, arma::fill::zeros);
+
+    for(size_t iL = nL; iL > 0; --iL)
+    {
+        W_above += get_interface_perturbation(iL-1, F);
+        W[iL-1]  = W_above;
+    }
+
+    return W;
+}
+
+/**
+ * \brief Find the perturbation caused by changing the alloy fraction in a layer
+ *
+ * \param[in] iL    Index of the layer
+ * \param[in] dV_dx Rate of change of potential with alloy fraction at each sample [J]
+ * \param[in] dm_dx Rate of change of effective mass with alloy fraction at each sample [kg]
+ *
+ * \returns The matrix elements of the perturbation between each pair of states
+ *          [J per unit alloy fraction]
+ *
+ * \details This is the exact derivative of the discretised Hamiltonian used by
+ *          SchroedingerSolverTridiag, so the effective mass between two samples
+ *          is their mean.
+ */
+arma::mat StructureSensitivity::get_alloy_perturbation(const unsigned int  iL,
+                                                       const arma::vec    &dV_dx,
+                                                       const arma::vec    &dm_dx) const
+{
+    const size_t nz  = _z.size();
+    const size_t nst = _E.size();
+
+    if(iL >= _iz_I.size())
+    {
+        std::ostringstream oss;
+        oss << "Cannot perturb layer " << iL+1 << " of a structure with " << _iz_I.size()
+            << " layers.";
+        throw std::length_error(oss.str());
+    }
+
+    if(dV_dx.size() != nz || dm_dx.size() != nz)
+    {
+        std::ostringstream oss;
+        oss << "The alloy derivatives have " << dV_dx.size() << " and " << dm_dx.size()
+            << " samples, but the structure has " << nz << ".";
+        throw std::length_error(oss.str());
+    }
+
+    const size_t iz_first = (iL > 0) ? _iz_I[iL-1] : 0;
+    const size_t iz_end   = _iz_I[iL];
+
+    arma::mat W(nst, nst, arma::fill::zeros);
+
+    // Potential term
+    for(size_t iz = iz_first; iz < iz_end; ++iz)
+        W += _h[iz]*dV_dx[iz] * (_psi.row(iz).t()*_psi.row(iz));
+
+    // Kinetic term, for each link between samples that touches the layer
+    const size_t iz_link_first = (iz_first > 0) ? iz_first-1 : 0;
+
+    for(size_t iz = iz_link_first; iz < iz_end && iz+1 < nz; ++iz)
+    {
+        const bool   lower_in_layer = (iz   >= iz_first);
+        const bool   upper_in_layer = (iz+1 <  iz_end);
+        const double dm_half = 0.5*((lower_in_layer ? dm_dx[iz]   : 0.0) +
+                                    (upper_in_layer ? dm_dx[iz+1] : 0.0));
+
+        if(dm_half == 0.0)
+            continue;
+
+        const double    dz     = _z[iz+1] - _z[iz];
+        const double    m_half = 0.5*(_m[iz] + _m[iz+1]);
+        const arma::mat dpsi   = _psi.row(iz+1) - _psi.row(iz); // Change across link, for each state
+
+        W -= 0.5*hBar*hBar*dm_half/(m_half*m_half*dz) * (dpsi.t()*dpsi);
+    }
+
+    return W;
+}
+
+/**
+ * \brief Find the rate of change of each energy
+ *
+ * \param[in] W Matrix of perturbation elements
+ *
+ * \returns The rate of change of each energy, in the units of W
+ */
+arma::vec StructureSensitivity::get_energy_gradient(const arma::mat &W)
+{
+    return W.diag();
+}
+
+/**
+ * \brief Find the coefficients of the first-order wavefunction corrections
+ *
+ * \param[in] W Matrix of perturbation elements
+ *
+ * \returns Matrix C, such that the correction to state n is \f$\sum_m C_{mn}\psi_m\f$
+ *
+ * \details Pairs of states that are degenerate to within rounding error are
+ *          omitted, since they are not mixed at first order by a perturbation
+ *          that it is valid to treat in this way.
+ */
+arma::mat StructureSensitivity::get_correction_coefficients(const arma::mat &W) const
+{
+    const size_t nst = _E.size();
+
+    if(W.n_rows != nst || W.n_cols != nst)
+    {
+        std::ostringstream oss;
+        oss << "The perturbation matrix is " << W.n_rows << "x" << W.n_cols
+            << ", but there are " << nst << " states.";
+        throw std::length_error(oss.str());
+    }
+
+    const double tol = 1e-12*arma::abs(_E).max();
+    arma::mat    C(nst, nst, arma::fill::zeros);
+
+    for(unsigned int n = 0; n < nst; ++n)
+    {
+        for(unsigned int m = 0; m < nst; ++m)
+        {
+            const double dE = _E[n] - _E[m];
+
+            if(m != n && std::abs(dE) > tol)
+                C(m, n) = W(m, n)/dE;
+        }
+    }
+
+    return C;
+}
+
+/**
+ * \brief Find the first-order correction to each wavefunction
+ *
+ * \param[in] W Matrix of perturbation elements
+ *
+ * \returns The rate of change of each wavefunction at each sample, with one
+ *          column for each state [1/sqrt(m) per unit of the parameter]
+ */
+arma::mat StructureSensitivity::get_wavefunction_correction(const arma::mat &W) const
+{
+    return _psi*get_correction_coefficients(W);
+}
+
+/**
+ * \brief Find the rate of change of the dipole matrix element between each pair of states
+ *
+ * \param[in] W Matrix of perturbation elements
+ *
+ * \returns The rate of change of \f$\langle\psi_i|z|\psi_j\rangle\f$ [m per unit of the parameter]
+ */
+arma::mat StructureSensitivity::get_dipole_gradient(const arma::mat &W) const
+{
+    const arma::mat C = get_correction_coefficients(W);
+    const arma::mat Z = _psi.t()*arma::diagmat(_h % _z)*_psi;
+
+    return C.t()*Z + Z*C;
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
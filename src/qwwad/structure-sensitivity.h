@@ -0,0 +1,84 @@
+/**
+ * \file   structure-sensitivity.h
+ * \brief  First-order sensitivity of eigenstates to the structure of a heterostructure
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_STRUCTURE_SENSITIVITY_H
+#define QWWAD_STRUCTURE_SENSITIVITY_H
+
+#include <vector>
+#include <armadillo>
+#include "eigenstate.h"
+
+namespace QWWAD
+{
+class Mesh;
+
+/**
+ * \brief Finds how eigenstates change when the layers of a structure are perturbed
+ *
+ * \details The perturbation of the Hamiltonian for each layer parameter is found
+ *          as a matrix in the basis of the existing eigenstates,
+ *          \f$W_{ij} = \langle\psi_i|\partial H/\partial p|\psi_j\rangle\f$.
+ *          The diagonal gives the change in each energy (the Hellmann-Feynman
+ *          theorem), and the off-diagonal elements give the first-order
+ *          correction to each wavefunction,
+ *          \f[
+ *            \frac{\partial\psi_n}{\partial p} = \sum_{m\ne n}\frac{W_{mn}}{E_n - E_m}\psi_m.
+ *          \f]
+ *          The gradients with respect to every layer are therefore found from a
+ *          single solution of the Schroedinger equation.  The wavefunction
+ *          correction is limited to the states that are supplied, so it is most
+ *          accurate when a few states above those of interest are included.
+ *
+ *          The Hamiltonian is assumed to be \f$-\frac{\hbar^2}{2}\frac{d}{dz}\frac{1}{m}\frac{d}{dz} + V\f$,
+ *          on the same mesh as the eigenstates.
+ */
+class StructureSensitivity
+{
+private:
+    arma::vec  _z;    ///< Spatial location of each sample [m]
+    arma::vec  _h;    ///< Width of the cell around each sample [m]
+    arma::vec  _V;    ///< Potential at each sample [J]
+    arma::vec  _m;    ///< Effective mass at each sample [kg]
+    arma::vec  _E;    ///< Energy of each state [J]
+    arma::mat  _psi;  ///< Wavefunction samples [1/sqrt(m)], with one column for each state
+    arma::uvec _iz_I; ///< Index of the first sample above the top of each layer
+
+    arma::mat get_interface_perturbation(const unsigned int iI,
+                                         const double       F) const;
+    arma::mat get_correction_coefficients(const arma::mat &W) const;
+
+public:
+    StructureSensitivity(const std::vector<Eigenstate> &states,
+                         const arma::vec               &V,
+                         const arma::vec               &m,
+                         const arma::uvec              &iz_I);
+
+    StructureSensitivity(const std::vector<Eigenstate> &states,
+                         const arma::vec               &V,
+                         const arma::vec               &m,
+                         const Mesh                    &mesh);
+
+    /// Return the number of layers in the structure
+    inline size_t get_n_layers() const {return _iz_I.size();}
+
+    /// Return the number of states
+    inline size_t get_n_states() const {return _E.size();}
+
+    std::vector<arma::mat> get_layer_width_perturbations(const double F = 0.0) const;
+
+    arma::mat get_alloy_perturbation(const unsigned int  iL,
+                                     const arma::vec    &dV_dx,
+                                     const arma::vec    &dm_dx) const;
+
+    static arma::vec get_energy_gradient(const arma::mat &W);
+
+    arma::mat get_wavefunction_correction(const arma::mat &W) const;
+
+    arma::mat get_dipole_gradient(const arma::mat &W) const;
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -7,6 +7,7 @@
 #include "subband.h"
 #include "file-io.h"
 #include "maths-helpers.h"
+#include "quadrature.h"
 #include "constants.h"
 #include "fermi.h"
 
@@ -26,6 +27,8 @@ Subband::Subband(const Eigenstate &ground_state,
     _m(m),
     _alpha(0.0),
     _V(0.0),
+    _Ek_scale(hBar*hBar/(2.0*_m)),
+    _b(1.0),
     _dist_known(false),
     _Ef(ground_state.get_energy()),
     _Te(0.0),
@@ -48,6 +51,8 @@ Subband::Subband(const Eigenstate &ground_state,
     _m(m),
     _alpha(alpha),
     _V(V),
+    _Ek_scale(hBar*hBar/(2.0*_m)),
+    _b(1.0 + _alpha*(ground_state.get_energy() - _V)),
     _dist_known(false),
     _Ef(ground_state.get_energy()),
     _Te(0.0),
@@ -73,6 +78,37 @@ void Subband::set_distribution_from_Ef_Te(const double Ef,
     _Te         = Te;
 }
 
+/**
+ * \brief Sets the carrier distribution function in the subband from its population
+ *
+ * \param[in] N  Sheet density of carriers [m^{-2}]
+ * \param[in] Te Carrier temperature [K]
+ *
+ * \details The quasi-Fermi energy is found for a Fermi-Dirac distribution
+ *          containing the given population
+ */
+void Subband::set_distribution_from_N_Te(const double N,
+                                         const double Te)
+{
+    if(Te <= 0.0)
+        throw "Carrier temperature must be positive";
+
+    const auto Ef = find_fermi(get_E_min(), _m, N, Te, _alpha, _V);
+    set_distribution_from_Ef_Te(Ef, Te);
+}
+
+/**
+ * \brief Find the spacing between spatial samples [m]
+ *
+ * \details This is only defined for a uniform mesh
+ */
+double Subband::get_dz() const
+{
+    const auto &z = z_array();
+    check_uniform_mesh(z, "Subband::get_dz");
+    return z[1] - z[0];
+}
+
 /**
  * \brief Find Fermi wave-vector
  *
@@ -91,6 +127,44 @@ double Subband::get_k_fermi() const
     return sqrt(2.0*pi*N);
 }
 
+/**
+ * \brief Read the wave functions for a selection of subbands, in parallel
+ *
+ * \param[in] subbands  The set of subbands
+ * \param[in] indices   Indices of the subbands that are needed (starting from 0).
+ *                      These may be repeated.
+ * \param[in] n_threads Number of threads to use (0 = default)
+ *
+ * \details Subbands that are read from file on demand only load their wave
+ *          functions when they are first used.  This loads every subband that is about to be
+ *          needed at once, rather than one by one, and leaves the rest unread.
+ */
+void Subband::load_wavefunctions(const std::vector<Subband> &subbands,
+                                 const arma::uvec           &indices,
+                                 const unsigned int          n_threads)
+{
+    std::vector<Eigenstate> states;
+    std::vector<bool>       wanted(subbands.size(), false);
+
+    for(auto const isb : indices)
+    {
+        if(isb >= subbands.size())
+        {
+            std::ostringstream oss;
+            oss << "Cannot load subband " << isb+1 << ".  Only " << subbands.size() << " subbands exist.";
+            throw std::invalid_argument(oss.str());
+        }
+
+        if(!wanted[isb])
+        {
+            wanted[isb] = true;
+            states.push_back(subbands[isb].get_ground());
+        }
+    }
+
+    Eigenstate::load_all(states, n_threads);
+}
+
 /**
  * Reads a set of subbands from data files (not including nonparabolic dispersion)
  *
@@ -105,7 +179,8 @@ std::vector<Subband> Subband::read_from_file(const std::string& energy_input_pat
                                              const std::string& wf_input_ext,
                                              const std::string& m_d_filename)
 {
-    // Read ground state data
+    // Read ground state data.  Every wave function is needed to find the
+    // subband masses, so read them all now
     const auto ground_state = Eigenstate::read_from_file(energy_input_path,
                                                          wf_input_prefix,
                                                          wf_input_ext,
@@ -121,6 +196,7 @@ std::vector<Subband> Subband::read_from_file(const std::string& energy_input_pat
     arma::vec z; // m
     arma::vec m_d_z; // kg
     read_table(m_d_filename.c_str(), z, m_d_z);
+    const arma::vec inv_m_d_z = 1.0 / m_d_z; // 1/kg
 
     // Copy subband data to vector
     std::vector<Subband> subbands;
@@ -130,11 +206,10 @@ std::vector<Subband> Subband::read_from_file(const std::string& energy_input_pat
         // Find the expectation-value of in-plane effective mass using QWWAD 4, 12.22
         // TODO: Note that the value used for transitions between a PAIR of subbands
         //       should use the inverse-mass matrix element; not this expectation value
-        const auto z  = ground_state[ist].get_position_samples();
-        const auto dz = z[1] - z[0];
+        const Quadrature &quadrature = ground_state[ist].get_quadrature();
+        const arma::vec  PD = ground_state[ist].get_PD();
 
-        const arma::vec mass_integrand = 1.0 / m_d_z * ground_state[ist].get_PD();
-        const auto mass = 1.0 / integral(mass_integrand, dz);
+        const auto mass = 1.0 / quadrature.integrate(PD, inv_m_d_z);
 
         subbands.push_back(Subband(ground_state[ist], mass));
     }
@@ -149,17 +224,21 @@ std::vector<Subband> Subband::read_from_file(const std::string& energy_input_pat
  * \param[in] wf_input_prefix       Prefix for wavefunction filenames
  * \param[in] wf_input_ext          Extension for wavefunction filenames
  * \param[in] m_d                   Density-of-states effective mass [kg]
+ * \param[in] on_demand             True if each wave function should only be read
+ *                                  when it is first used (see Eigenstate::read_from_file)
  */
 std::vector<Subband> Subband::read_from_file(const std::string& energy_input_path,
                                              const std::string& wf_input_prefix,
                                              const std::string& wf_input_ext,
-                                             const double       m_d)
+                                             const double       m_d,
+                                             const bool         on_demand)
 {
     const auto ground_state = Eigenstate::read_from_file(energy_input_path,
                                                          wf_input_prefix,
                                                          wf_input_ext,
                                                          1000.0/e,
-                                                         true);
+                                                         true,
+                                                         on_demand);
 
     const size_t nst = ground_state.size();
 
@@ -192,7 +271,8 @@ std::vector<Subband> Subband::read_from_file(const std::string& energy_input_pat
                                              const std::string& alpha_filename,
                                              const std::string& potential_filename)
 {
-    // Read ground state data
+    // Read ground state data.  Every wave function is needed to find the
+    // subband parameters, so read them all now
     const auto ground_state = Eigenstate::read_from_file(energy_input_path,
                                                          wf_input_prefix,
                                                          wf_input_ext,
@@ -208,6 +288,7 @@ std::vector<Subband> Subband::read_from_file(const std::string& energy_input_pat
     arma::vec z; // m
     arma::vec m; // kg
     read_table(m_filename.c_str(), z, m);
+    const arma::vec inv_m = 1.0 / m; // 1/kg
 
     // Read non-parabolicity parameter
     arma::vec alpha; // [1/J]
@@ -225,19 +306,15 @@ std::vector<Subband> Subband::read_from_file(const std::string& energy_input_pat
         // Find the expectation-value of in-plane effective mass using QWWAD 4, 12.22
         // TODO: Note that the value used for transitions between a PAIR of subbands
         //       should use the inverse-mass matrix element; not this expectation value
-        const auto z  = ground_state[ist].get_position_samples();
-        const auto dz = z[1] - z[0];
+        const Quadrature &quadrature = ground_state[ist].get_quadrature();
+        const arma::vec  PD = ground_state[ist].get_PD();
 
-        const arma::vec mass_integrand = 1.0 / m % ground_state[ist].get_PD();
-        const auto mass = 1.0 / integral(mass_integrand, dz);
+        const auto mass = 1.0 / quadrature.integrate(PD, inv_m);
 
         // Get "expectation values" for potential and non-parabolicity too
         // TODO: Check whether these make sense!
-        const arma::vec V_integrand = V % ground_state[ist].get_PD();
-        const auto V_exp = integral(V_integrand, dz);
-
-        const arma::vec alpha_integrand = alpha % ground_state[ist].get_PD();
-        const auto alpha_exp = integral(alpha_integrand, dz);
+        const auto V_exp     = quadrature.integrate(PD, V);
+        const auto alpha_exp = quadrature.integrate(PD, alpha);
 
         Subband sb(ground_state[ist],
                    mass,
@@ -259,20 +336,23 @@ std::vector<Subband> Subband::read_from_file(const std::string& energy_input_pat
  * \param[in] m_d                   Density-of-states effective mass [kg]
  * \param[in] alphad                Dispersion nonparabolicity profile [1/J]
  * \param[in] V                     Band edge potential [J]
+ * \param[in] on_demand             True if each wave function should only be read
+ *                                  when it is first used (see Eigenstate::read_from_file)
  */
 std::vector<Subband> Subband::read_from_file(const std::string& energy_input_path,
                                              const std::string& wf_input_prefix,
                                              const std::string& wf_input_ext,
                                              const double       m_d,
                                              const double       alphad,
-                                             const double       V)
+                                             const double       V,
+                                             const bool         on_demand)
 {
-    // Read ground-state data
     const auto ground_state = Eigenstate::read_from_file(energy_input_path,
                                                          wf_input_prefix,
                                                          wf_input_ext,
                                                          1000.0/e,
-                                                         true);
+                                                         true,
+                                                         on_demand);
 
     const size_t nst = ground_state.size();
 
@@ -298,26 +378,31 @@ double Subband::get_Ek_at_k(double k) const
 {
     double Ek;
 
+    // Kinetic energy with a parabolic dispersion
+    const auto Ek_parabolic = _Ek_scale*k*k;
+
     // Check if subband is initialised as being nonparabolic
     if(_alpha == 0.0)
-        Ek = hBar*hBar*k*k/(2.0*_m);
+        Ek = Ek_parabolic;
     else
     {
-        const auto En = get_E_min();
-        const auto b       = 1.0 + _alpha*(En - _V);
-        const auto four_ac = 4.0*_alpha*(-hBar*hBar*k*k)/(2.0*_m);
+        const auto four_ac = -4.0*_alpha*Ek_parabolic;
 
         // Check solveable
-        if(four_ac > b*b)
+        if(four_ac > _b*_b)
         {
             std::ostringstream oss;
             oss << "No real energy solution exists at wavevector k = " << k*1.0e-9 << " nm^{-1}.";
             throw std::domain_error(oss.str());
         }
 
-        const auto root = sqrt(b*b - four_ac);
-        if(root >= b)
-            Ek = (-b + root)/(2.0*_alpha);
+        const auto root = sqrt(_b*_b - four_ac);
+        if(root >= _b)
+        {
+            // This is the positive root of the quadratic, (-b + root)/(2 alpha),
+            // rearranged to avoid cancellation error at small k
+            Ek = 2.0*Ek_parabolic/(_b + root);
+        }
         else
         {
             std::ostringstream oss;
@@ -329,6 +414,53 @@ double Subband::get_Ek_at_k(double k) const
     return Ek;
 }
 
+/**
+ * \brief Find the kinetic energy at a set of wavevectors
+ *
+ * \param[in] k In-plane wave vectors [1/m]
+ *
+ * \return Kinetic energy at each wave vector [J]
+ *
+ * \details This gives the same result as the scalar version, but the whole
+ *          array is found using vector operations, which is much faster on a
+ *          dense k-space grid.
+ */
+arma::vec Subband::get_Ek_at_k(const arma::vec &k) const
+{
+    // Kinetic energy with a parabolic dispersion
+    const arma::vec Ek_parabolic = _Ek_scale*arma::square(k);
+
+    // Check if subband is initialised as being nonparabolic
+    if(_alpha == 0.0)
+        return Ek_parabolic;
+
+    const arma::vec four_ac = -4.0*_alpha*Ek_parabolic;
+
+    // Check solveable
+    const arma::uvec unsolveable = arma::find(four_ac > _b*_b, 1);
+
+    if(!unsolveable.empty())
+    {
+        std::ostringstream oss;
+        oss << "No real energy solution exists at wavevector k = " << k(unsolveable(0))*1.0e-9 << " nm^{-1}.";
+        throw std::domain_error(oss.str());
+    }
+
+    const arma::vec root = arma::sqrt(_b*_b - four_ac);
+    const arma::uvec negative = arma::find(root < _b, 1);
+
+    if(!negative.empty())
+    {
+        std::ostringstream oss;
+        oss << "Negative energy found at wavevector k = " << k(negative(0))*1.0e-9 << " nm^{-1}.";
+        throw std::domain_error(oss.str());
+    }
+
+    // This is the positive root of the quadratic, (-b + root)/(2 alpha),
+    // rearranged to avoid cancellation error at small k
+    return 2.0*Ek_parabolic/(_b + root);
+}
+
 /**
  * Return the wavevector at some energy above subband minima
  *
@@ -346,10 +478,10 @@ double Subband::get_k_at_Ek(const double Ek) const
     }
 
     // Find the energy-dependent effective mass, including nonparabolicity
-    const auto E_total = Ek + get_E_min();
-    const auto m = get_effective_mass(E_total);
+    // i.e., m = m0 [1 + alpha (Ek + E_min - V)]
+    const auto m_ratio = _b + _alpha*Ek;
 
-    const auto k = sqrt(Ek*2.0*m)/hBar;
+    const auto k = sqrt(Ek*m_ratio/_Ek_scale);
     
     return k;
 } 
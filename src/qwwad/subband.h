@@ -21,6 +21,10 @@ private:
     double _alpha;            ///< In-plane nonparabolicity parameter [1/J]
     double _V;                ///< Conduction band edge [J]
 
+    // Constants in the dispersion relation, which are found once on construction
+    double _Ek_scale;         ///< Kinetic energy per k^2 at band edge, hBar^2/(2m) [J m^2]
+    double _b;                ///< Nonparabolic factor at subband edge, 1 + alpha*(E_min - V)
+
     // Carrier distribution parameters
     bool   _dist_known;       ///< True if the carrier distribution is set
     double _Ef;               ///< Quasi-Fermi energy [J]
@@ -39,6 +43,9 @@ public:
     void set_distribution_from_Ef_Te(const double Ef,
                                      const double Te);
 
+    void set_distribution_from_N_Te(const double N,
+                                    const double Te);
+
     inline decltype(_ground_state) get_ground() const {return _ground_state;}
 
     inline auto z_array() const
@@ -47,8 +54,11 @@ public:
         return _ground_state.get_position_samples();
     }
 
-    inline double                      get_dz()     const {return z_array()[1]-z_array()[0];}
-    inline double                      get_length() const {const auto _z = z_array(); return _z[_z.size()-1]-_z[0];}
+    /** Return the quadrature rule for the spatial grid */
+    inline const Quadrature & get_quadrature() const {return _ground_state.get_quadrature();}
+
+    double                             get_dz()     const;
+    inline double                      get_length() const {const auto &z = z_array(); return z[z.size()-1]-z[0];}
 
     /** Find expectation position for the ground state [m] */
     inline double                      get_z_av_0() const {return _ground_state.get_expectation_position();}
@@ -68,6 +78,13 @@ public:
         return _ground_state.get_wavefunction_samples();
     }
 
+    /** Return the probability density for the ground state [m^{-1}] */
+    inline auto PD_array() const
+        -> decltype(_ground_state.get_PD())
+    {
+        return _ground_state.get_PD();
+    }
+
     inline double                      get_condband_edge() const {return _V;}
 
     double                             get_k_fermi() const;
@@ -80,7 +97,8 @@ public:
     static std::vector<Subband> read_from_file(const std::string &energy_input_path,
                                                const std::string &wf_input_prefix,
                                                const std::string &wf_input_ext,
-                                               const double       m);
+                                               const double       m,
+                                               const bool         on_demand = false);
 
     static std::vector<Subband> read_from_file(const std::string &energy_input_path,
                                                const std::string &wf_input_prefix,
@@ -94,9 +112,15 @@ public:
                                                const std::string &wf_input_ext,
                                                const double       m,
                                                const double       alpha,
-                                               const double       V);
+                                               const double       V,
+                                               const bool         on_demand = false);
+
+    static void load_wavefunctions(const std::vector<Subband> &subbands,
+                                   const arma::uvec           &indices,
+                                   const unsigned int          n_threads = 0);
 
     double get_Ek_at_k(const double k) const;
+    arma::vec get_Ek_at_k(const arma::vec &k) const;
     double get_k_at_Ek(const double Ek) const;
     double get_k_max(const double Te) const;
 
@@ -0,0 +1,194 @@
+/**
+ * \file   tetrahedron-dos.cpp
+ * \brief  Density of states from band energies on a grid, using the linear tetrahedron method
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "tetrahedron-dos.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include "kpoint-grid.h"
+#include "parallel.h"
+
+namespace QWWAD
+{
+/**
+ * \brief Split the grid into tetrahedra
+ *
+ * \param[in] grid   The grid of wave vectors
+ * \param[in] E_full Energy of each band at every point in the grid, with one row
+ *                   for each point (e.g., from FCCKPointGrid::unfold)
+ *
+ * \details The primitive reciprocal lattice vectors of an FCC crystal are
+ *          \f$b_1 = (-1,1,1)\f$, \f$b_2 = (1,-1,1)\f$ and \f$b_3 = (1,1,-1)\f$,
+ *          so the shortest diagonal of each cell is \f$b_1 + b_2 + b_3\f$.  Each
+ *          tetrahedron follows a path along the edges of the cell from one end of
+ *          that diagonal to the other.
+ */
+TetrahedronDOS::TetrahedronDOS(const FCCKPointGrid &grid,
+                               const arma::mat     &E_full) :
+    _E(E_full),
+    _tetrahedra()
+{
+    const long n = grid.get_n_divisions();
+
+    if(E_full.n_rows != grid.get_full_points().size())
+    {
+        std::ostringstream oss;
+        oss << "Got energies at " << E_full.n_rows << " wave vectors, but the grid has "
+            << grid.get_full_points().size() << " points.";
+        throw std::length_error(oss.str());
+    }
+
+    // Steps along each axis of the cell, for each of the six paths
+    const long path[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2},
+                             {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+
+    _tetrahedra.reserve(6*n*n*n);
+
+    for(long c1 = 0; c1 < n; ++c1)
+    {
+        for(long c2 = 0; c2 < n; ++c2)
+        {
+            for(long c3 = 0; c3 < n; ++c3)
+            {
+                for(unsigned int ipath = 0; ipath < 6; ++ipath)
+                {
+                    std::array<size_t, 4> corners;
+                    long                  c[3] = {c1, c2, c3};
+
+                    corners[0] = grid.get_full_index(c[0], c[1], c[2]);
+
+                    for(unsigned int istep = 0; istep < 3; ++istep)
+                    {
+                        ++c[path[ipath][istep]];
+                        corners[istep+1] = grid.get_full_index(c[0], c[1], c[2]);
+                    }
+
+                    _tetrahedra.push_back(corners);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * \brief Find the density of states
+ *
+ * \param[in]  E         Energies at which to find the density of states, in
+ *                       ascending order (in the units of the band energies)
+ * \param[out] g         Density of states at each energy
+ * \param[out] N         Number of states below each energy
+ * \param[in]  n_threads Number of threads to use (0 = one per CPU core)
+ *
+ * \details The tetrahedra are split into a fixed set of blocks, which are shared
+ *          between the threads.  The results for the blocks are summed in order,
+ *          so they do not depend on the number of threads.
+ */
+void TetrahedronDOS::get_dos(const arma::vec    &E,
+                             arma::vec          &g,
+                             arma::vec          &N,
+                             const unsigned int  n_threads) const
+{
+    const size_t nE     = E.size();
+    const size_t nbands = _E.n_cols;
+    const size_t n_tet  = _tetrahedra.size();
+    const double w      = 1.0/n_tet; // Fraction of the zone in each tetrahedron
+
+    const size_t n_blocks   = std::max<size_t>(1, std::min<size_t>(64, (n_tet + 255)/256));
+    const size_t block_size = (n_tet + n_blocks - 1)/n_blocks;
+
+    // Density, number of states within each tetrahedron, and number of states in
+    // tetrahedra that lie entirely below each energy (stored as the change from
+    // the previous energy, to avoid touching every energy above each tetrahedron)
+    std::vector<arma::vec> g_block(n_blocks, arma::zeros(nE));
+    std::vector<arma::vec> N_block(n_blocks, arma::zeros(nE));
+    std::vector<arma::vec> dN_block(n_blocks, arma::zeros(nE));
+
+    run_in_parallel(n_blocks, n_threads, [&](const size_t iblock) {
+        const size_t first = iblock*block_size;
+        const size_t last  = std::min(first + block_size, n_tet);
+
+        arma::vec &g_b  = g_block[iblock];
+        arma::vec &N_b  = N_block[iblock];
+        arma::vec &dN_b = dN_block[iblock];
+
+        for(size_t itet = first; itet < last; ++itet)
+        {
+            const auto &corners = _tetrahedra[itet];
+
+            for(unsigned int iband = 0; iband < nbands; ++iband)
+            {
+                double e[4];
+
+                for(unsigned int icorner = 0; icorner < 4; ++icorner)
+                    e[icorner] = _E(corners[icorner], iband);
+
+                std::sort(e, e+4);
+
+                // Energies that fall within the tetrahedron
+                const size_t iE_first = std::lower_bound(E.begin(), E.end(), e[0]) - E.begin();
+                const size_t iE_last  = std::lower_bound(E.begin(), E.end(), e[3]) - E.begin();
+
+                if(iE_last < nE)
+                    dN_b[iE_last] += w;
+
+                const double e21 = e[1] - e[0];
+                const double e31 = e[2] - e[0];
+                const double e41 = e[3] - e[0];
+                const double e32 = e[2] - e[1];
+                const double e42 = e[3] - e[1];
+                const double e43 = e[3] - e[2];
+
+                for(size_t iE = iE_first; iE < iE_last; ++iE)
+                {
+                    const double x = E[iE];
+
+                    if(x < e[1])
+                    {
+                        const double d = x - e[0];
+                        g_b[iE] += w*3*d*d/(e21*e31*e41);
+                        N_b[iE] += w*d*d*d/(e21*e31*e41);
+                    }
+                    else if(x < e[2])
+                    {
+                        const double d = x - e[1];
+                        g_b[iE] += w*(3*e21 + 6*d - 3*(e31 + e42)*d*d/(e32*e42))/(e31*e41);
+                        N_b[iE] += w*(e21*e21 + 3*e21*d + 3*d*d - (e31 + e42)*d*d*d/(e32*e42))/(e31*e41);
+                    }
+                    else
+                    {
+                        const double d = e[3] - x;
+                        g_b[iE] += w*3*d*d/(e41*e42*e43);
+                        N_b[iE] += w*(1 - d*d*d/(e41*e42*e43));
+                    }
+                }
+            }
+        }
+    });
+
+    g = arma::zeros(nE);
+    N = arma::zeros(nE);
+    arma::vec dN = arma::zeros(nE);
+
+    for(unsigned int iblock = 0; iblock < n_blocks; ++iblock)
+    {
+        g  += g_block[iblock];
+        N  += N_block[iblock];
+        dN += dN_block[iblock];
+    }
+
+    // Add the states in the tetrahedra that lie entirely below each energy
+    double N_below = 0.0;
+
+    for(unsigned int iE = 0; iE < nE; ++iE)
+    {
+        N_below += dN[iE];
+        N[iE]   += N_below;
+    }
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
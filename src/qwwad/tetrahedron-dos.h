@@ -0,0 +1,51 @@
+/**
+ * \file   tetrahedron-dos.h
+ * \brief  Density of states from band energies on a grid, using the linear tetrahedron method
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_TETRAHEDRON_DOS_H
+#define QWWAD_TETRAHEDRON_DOS_H
+
+#include <array>
+#include <vector>
+#include <armadillo>
+
+namespace QWWAD
+{
+class FCCKPointGrid;
+
+/**
+ * \brief Finds the density of states from band energies on a uniform grid of
+ *        wave vectors, using the linear tetrahedron method
+ *
+ * \details Each cell of the grid is split into six tetrahedra, which share the
+ *          shortest diagonal of the cell.  The energy of each band is
+ *          interpolated linearly within each tetrahedron, so the contribution of
+ *          each tetrahedron to the density of states has a closed form
+ *          [Bloechl, Jepsen and Andersen, Phys. Rev. B 49, 16223 (1994)].  This
+ *          converges with far fewer wave vectors than a histogram of the energies.
+ *
+ *          The density of states is normalised so that each band holds one state.
+ */
+class TetrahedronDOS
+{
+private:
+    arma::mat                          _E;          ///< Energy of each band at each point in the grid
+    std::vector<std::array<size_t, 4>> _tetrahedra; ///< Index of the corners of each tetrahedron
+
+public:
+    TetrahedronDOS(const FCCKPointGrid &grid,
+                   const arma::mat     &E_full);
+
+    /// Return the number of tetrahedra
+    inline size_t get_n_tetrahedra() const {return _tetrahedra.size();}
+
+    void get_dos(const arma::vec    &E,
+                 arma::vec          &g,
+                 arma::vec          &N,
+                 const unsigned int  n_threads = 0) const;
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,159 @@
+/**
+ * \file   thermal-conductivity.cpp
+ * \brief  Temperature-dependent thermal conductivity of a material
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "thermal-conductivity.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "material.h"
+#include "material-property-numeric.h"
+#include "maths-helpers.h"
+
+namespace QWWAD
+{
+/**
+ * \brief Choose the thermal-conductivity model for a material
+ *
+ * \param[in] mat The material system
+ * \param[in] x   Alloy fraction (if applicable)
+ */
+ThermalConductivity::ThermalConductivity(const Material &mat,
+                                         const double    x) :
+    _model(TABULATED),
+    _x(x),
+    _k(0.0),
+    _k0_1(0.0),
+    _k0_2(0.0),
+    _tau_1(0.0),
+    _tau_2(0.0),
+    _k_T(nullptr),
+    _T_table_min(0.0),
+    _dT_table(0.0),
+    _k_table()
+{
+    if(mat.has_property("thermal-conductivity-vs-alloy"))
+    {
+        _model = ALLOY;
+        _k     = mat.get_property_value("thermal-conductivity-vs-alloy", x);
+    }
+    else if(mat.has_property("thermal-conductivity-0K-1") &&
+            mat.has_property("thermal-conductivity-0K-2") &&
+            mat.has_property("thermal-conductivity-decay-index-1") &&
+            mat.has_property("thermal-conductivity-decay-index-2"))
+    {
+        _model = TWO_POWER;
+        _k0_1  = mat.get_property_value("thermal-conductivity-0K-1");
+        _k0_2  = mat.get_property_value("thermal-conductivity-0K-2");
+        _tau_1 = mat.get_property_value("thermal-conductivity-decay-index-1");
+        _tau_2 = mat.get_property_value("thermal-conductivity-decay-index-2");
+    }
+    else if(mat.has_property("thermal-conductivity-0K") &&
+            mat.has_property("thermal-conductivity-decay-index"))
+    {
+        _model = POWER;
+        _k0_1  = mat.get_property_value("thermal-conductivity-0K");
+        _tau_1 = mat.get_property_value("thermal-conductivity-decay-index");
+    }
+    else if(mat.has_property("thermal-conductivity-high-T") &&
+            mat.has_property("thermal-conductivity-inverse-T"))
+    {
+        _model = INVERSE_T;
+        _k0_1  = mat.get_property_value("thermal-conductivity-high-T");
+        _k0_2  = mat.get_property_value("thermal-conductivity-inverse-T");
+    }
+    else
+        _k_T = mat.get_numeric_property("thermal-conductivity-T");
+}
+
+/**
+ * Find the thermal conductivity [W/m/K]
+ *
+ * \param[in] T Temperature [K]
+ */
+double ThermalConductivity::get_k(const double T) const
+{
+    double k = 0.0;
+
+    switch(_model)
+    {
+        case ALLOY:
+            k = _k;
+            break;
+        case TWO_POWER:
+            k = lin_interp(_k0_1*pow(T,_tau_1), _k0_2*pow(T,_tau_2), _x);
+            break;
+        case POWER:
+            k = _k0_1 * pow(T,_tau_1);
+            break;
+        case INVERSE_T:
+            k = _k0_1 + _k0_2/T;
+            break;
+        case TABULATED:
+            k = _k_T->get_val(T);
+            break;
+    }
+
+    return k;
+}
+
+/**
+ * \brief Precompute the conductivity over a range of temperatures
+ *
+ * \param[in] T_min Lowest temperature in the table [K]
+ * \param[in] T_max Highest temperature in the table [K]
+ * \param[in] n     Number of temperatures in the table
+ *
+ * \details The temperatures are evenly spaced, and get_k_tabulated() uses
+ *          linear interpolation between them.  The conductivity varies smoothly
+ *          with temperature, so the relative error is of order
+ *          \f$(\Delta T/T)^2\f$, which is negligible for the default size of table.
+ */
+void ThermalConductivity::tabulate(const double T_min,
+                                   const double T_max,
+                                   const size_t n)
+{
+    if(T_min <= 0.0 || T_max <= T_min || n < 2)
+        throw std::invalid_argument("Invalid temperature range for thermal-conductivity table.");
+
+    // A temperature-independent conductivity needs no table
+    if(_model == ALLOY)
+        return;
+
+    _T_table_min = T_min;
+    _dT_table    = (T_max - T_min)/(n - 1);
+    _k_table.resize(n);
+
+    for(size_t i = 0; i < n; ++i)
+        _k_table[i] = get_k(T_min + i*_dT_table);
+}
+
+/**
+ * \brief Find the thermal conductivity [W/m/K] using the lookup table
+ *
+ * \param[in] T Temperature [K]
+ *
+ * \details If no table has been made, or the temperature is outside it, the
+ *          conductivity is found directly.
+ */
+double ThermalConductivity::get_k_tabulated(const double T) const
+{
+    if(_k_table.empty())
+        return get_k(T);
+
+    const double s = (T - _T_table_min)/_dT_table;
+
+    if(s < 0.0 || s > _k_table.size() - 1)
+        return get_k(T);
+
+    const size_t i = std::min(static_cast<size_t>(s), _k_table.size() - 2);
+    const double t = s - i; // Fractional position in interval
+
+    return (1.0 - t)*_k_table[i] + t*_k_table[i+1];
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
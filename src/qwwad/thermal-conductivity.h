@@ -0,0 +1,76 @@
+/**
+ * \file   thermal-conductivity.h
+ * \brief  Temperature-dependent thermal conductivity of a material
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_THERMAL_CONDUCTIVITY_H
+#define QWWAD_THERMAL_CONDUCTIVITY_H
+
+#include <cstddef>
+#include <vector>
+
+namespace QWWAD
+{
+class Material;
+class MaterialPropertyNumeric;
+
+/**
+ * \brief Thermal conductivity of the material in a layer
+ *
+ * \details The model is chosen according to which properties the material has,
+ *          and any parameters that do not depend on temperature are found once.
+ *          This means that no properties need to be looked up in the time-stepping
+ *          loop.
+ *
+ *          After tabulate() has been called, get_k_tabulated() interpolates the
+ *          conductivity from a table over the expected range of temperatures,
+ *          which avoids the power laws and property interpolation in the inner
+ *          loops of thermal solvers.  Temperatures outside the table are
+ *          evaluated directly.
+ *
+ * \todo Figure out where all these values come from!
+ * \todo These values only work for a limited range of
+ *       temperatures. Restrict the domain accordingly?
+ */
+class ThermalConductivity
+{
+private:
+    /// Form of the temperature dependence
+    enum Model {
+        ALLOY,      ///< Function of alloy fraction only
+        TWO_POWER,  ///< Interpolation between power laws for two binaries
+        POWER,      ///< Power law
+        INVERSE_T,  ///< Constant plus inverse-temperature term
+        TABULATED   ///< Direct function of temperature
+    };
+
+    Model  _model;
+    double _x;     ///< Alloy fraction
+    double _k;     ///< Conductivity, if independent of temperature [W/m/K]
+    double _k0_1;  ///< Prefactor for first power law or constant term [W/m/K]
+    double _k0_2;  ///< Prefactor for second power law or inverse-T term
+    double _tau_1; ///< Exponent of first power law
+    double _tau_2; ///< Exponent of second power law
+
+    MaterialPropertyNumeric const *_k_T; ///< Tabulated conductivity vs. temperature
+
+    double              _T_table_min; ///< Lowest temperature in the lookup table [K]
+    double              _dT_table;    ///< Temperature step in the lookup table [K]
+    std::vector<double> _k_table;     ///< Conductivity at each temperature in the table [W/m/K]
+
+public:
+    ThermalConductivity(const Material &mat,
+                        const double    x);
+
+    double get_k(const double T) const;
+
+    void tabulate(const double T_min,
+                  const double T_max,
+                  const size_t n = 4096);
+
+    double get_k_tabulated(const double T) const;
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,675 @@
+/**
+ * \file   transfer-matrix.cpp
+ * \brief  Transmission coefficients of one-dimensional potential profiles
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "transfer-matrix.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <sstream>
+#include <stdexcept>
+
+#include "constants.h"
+#include "parallel.h"
+
+namespace QWWAD
+{
+using namespace constants;
+
+/// Number of energies handled together by one thread
+static const size_t block_size = 256;
+
+/**
+ * \brief Find the wave vector in a layer
+ *
+ * \param[in] E Energy [J]
+ * \param[in] V Potential [J]
+ * \param[in] m Effective mass [kg]
+ *
+ * \returns The wave vector [1/m].  This is imaginary if the energy is below the
+ *          potential.  A vanishing wave vector is replaced by a tiny real one so
+ *          that the interface matrices stay finite.
+ */
+static std::complex<double> find_k(const double E,
+                                   const double V,
+                                   const double m)
+{
+    const double k_min = 1.0; // Negligible wave vector [1/m]
+    const auto   k     = std::sqrt(std::complex<double>(2.0*m*(E - V), 0.0))/hBar;
+
+    return (std::abs(k) < k_min) ? std::complex<double>(k_min, 0.0) : k;
+}
+
+/**
+ * \brief Find the wave vector in a layer at a complex energy
+ *
+ * \param[in] E Energy [J]
+ * \param[in] V Potential [J]
+ * \param[in] m Effective mass [kg]
+ *
+ * \returns The wave vector [1/m], on the branch with a positive real part.  For an
+ *          energy just below the real axis, this is an outgoing wave in a lead.
+ */
+static std::complex<double> find_k(const std::complex<double> E,
+                                   const double               V,
+                                   const double               m)
+{
+    const double k_min = 1.0; // Negligible wave vector [1/m]
+    const auto   k     = std::sqrt(2.0*m*(E - V))/hBar;
+
+    return (std::abs(k) < k_min) ? std::complex<double>(k_min, 0.0) : k;
+}
+
+/**
+ * \brief Set up a structure from a list of layers
+ *
+ * \param[in] d Width of each layer [m].  The widths of the first and last layers
+ *              are ignored, because these are semi-infinite leads.
+ * \param[in] V Potential in each layer [J]
+ * \param[in] m Effective mass in each layer [kg]
+ */
+TransferMatrix::TransferMatrix(const std::vector<double> &d,
+                               const std::vector<double> &V,
+                               const std::vector<double> &m) :
+    _d(d),
+    _V(V),
+    _m(m)
+{
+    if(_d.size() != _V.size() || _m.size() != _V.size())
+    {
+        std::ostringstream oss;
+        oss << "Got " << _d.size() << " layer widths, " << _V.size() << " potentials and "
+            << _m.size() << " masses.";
+        throw std::length_error(oss.str());
+    }
+
+    if(_V.size() < 2)
+        throw std::length_error("At least two layers are needed to find a transmission coefficient.");
+
+    for(size_t iL = 0; iL < _V.size(); ++iL)
+    {
+        if(_m[iL] <= 0.0 || (iL > 0 && iL+1 < _V.size() && _d[iL] < 0.0))
+        {
+            std::ostringstream oss;
+            oss << "Layer " << iL << " has width " << _d[iL] << " m and mass " << _m[iL] << " kg.";
+            throw std::domain_error(oss.str());
+        }
+    }
+
+    // The leads have no length
+    _d.front() = 0.0;
+    _d.back()  = 0.0;
+}
+
+/**
+ * \brief Set up a structure from a sampled potential profile
+ *
+ * \param[in] z Spatial location of each sample [m]
+ * \param[in] V Potential at each sample [J]
+ * \param[in] m Effective mass at each sample [kg]
+ *
+ * \details The first and last samples give the leads.  Each of the other samples
+ *          is taken as a layer that extends halfway to its neighbours.
+ *          Neighbouring samples with identical properties are merged into a single
+ *          layer, so that flat parts of the profile cost nothing.
+ */
+TransferMatrix TransferMatrix::from_profile(const arma::vec &z,
+                                            const arma::vec &V,
+                                            const arma::vec &m)
+{
+    const size_t nz = z.size();
+
+    if(V.size() != nz || m.size() != nz || nz < 2)
+    {
+        std::ostringstream oss;
+        oss << "Cannot make a structure from " << nz << " positions, " << V.size()
+            << " potentials and " << m.size() << " masses.";
+        throw std::length_error(oss.str());
+    }
+
+    std::vector<double> d(1, 0.0);
+    std::vector<double> V_layer(1, V(0));
+    std::vector<double> m_layer(1, m(0));
+
+    for(size_t iz = 1; iz+1 < nz; ++iz)
+    {
+        const double dz = (z(iz+1) - z(iz-1))/2;
+
+        if(V(iz) == V_layer.back() && m(iz) == m_layer.back() && d.size() > 1)
+            d.back() += dz;
+        else
+        {
+            d.push_back(dz);
+            V_layer.push_back(V(iz));
+            m_layer.push_back(m(iz));
+        }
+    }
+
+    d.push_back(0.0);
+    V_layer.push_back(V(nz-1));
+    m_layer.push_back(m(nz-1));
+
+    return TransferMatrix(d, V_layer, m_layer);
+}
+
+/**
+ * \brief Find the transmission coefficients for a block of energies
+ *
+ * \param[in]  E     Energies [J]
+ * \param[out] T     Transmission coefficients
+ * \param[out] phase Phase of the transmitted wave [rad].  This is not found if
+ *                   a null pointer is given.
+ * \param[in]  nE    Number of energies
+ *
+ * \details The transfer matrix \f$M\f$ links the amplitudes of the forward and
+ *          backward waves in the left lead to those in the right lead.  For a wave
+ *          incident from the left, the transmission coefficient is then
+ *          \f[
+ *            T = \frac{k_0/m_0}{k_N/m_N} \frac{1}{|M_{11}|^2},
+ *          \f]
+ *          since the determinant of \f$M\f$ is \f$(k_0/m_0)/(k_N/m_N)\f$.  The
+ *          determinant is real and positive, so the phase of the transmitted wave is
+ *          \f$-\arg M_{11}\f$.
+ *          The matrix elements grow exponentially through thick barriers, so each
+ *          matrix is rescaled whenever it becomes large.
+ */
+void TransferMatrix::find_block(const double *E,
+                                double       *T,
+                                double       *phase,
+                                const size_t  nE) const
+{
+    typedef std::complex<double> cx;
+
+    const size_t nL = _V.size();
+    const double big = 1e100; // Size of matrix element at which to rescale
+
+    // Elements of the transfer matrix for each energy
+    std::vector<cx>     M00(nE, 1.0);
+    std::vector<cx>     M01(nE, 0.0);
+    std::vector<cx>     M10(nE, 0.0);
+    std::vector<cx>     M11(nE, 1.0);
+    std::vector<double> log_scale(nE, 0.0); // Logarithm of scaling factor for matrix
+    std::vector<cx>     k_m(nE);            // k/m in the current layer
+
+    for(size_t iE = 0; iE < nE; ++iE)
+        k_m[iE] = find_k(E[iE], _V[0], _m[0])/_m[0];
+
+    for(size_t iL = 0; iL+1 < nL; ++iL)
+    {
+        const double d      = _d[iL];
+        const double m      = _m[iL];
+        const double V_next = _V[iL+1];
+        const double m_next = _m[iL+1];
+
+        for(size_t iE = 0; iE < nE; ++iE)
+        {
+            // Propagate across this layer
+            if(d > 0.0)
+            {
+                const cx shift = std::exp(cx(0.0, 1.0)*k_m[iE]*m*d);
+                M00[iE] *= shift;
+                M01[iE] *= shift;
+                M10[iE] /= shift;
+                M11[iE] /= shift;
+            }
+
+            // Match across the interface into the next layer
+            const cx k_m_next = find_k(E[iE], V_next, m_next)/m_next;
+            const cx r        = k_m[iE]/k_m_next;
+            const cx a        = 0.5*(1.0 + r);
+            const cx b        = 0.5*(1.0 - r);
+
+            const cx M00_new = a*M00[iE] + b*M10[iE];
+            const cx M01_new = a*M01[iE] + b*M11[iE];
+            const cx M10_new = b*M00[iE] + a*M10[iE];
+            const cx M11_new = b*M01[iE] + a*M11[iE];
+
+            M00[iE]  = M00_new;
+            M01[iE]  = M01_new;
+            M10[iE]  = M10_new;
+            M11[iE]  = M11_new;
+            k_m[iE]  = k_m_next;
+
+            if(std::abs(M11_new) > big || std::abs(M10_new) > big)
+            {
+                M00[iE] /= big;
+                M01[iE] /= big;
+                M10[iE] /= big;
+                M11[iE] /= big;
+                log_scale[iE] += log(big);
+            }
+        }
+    }
+
+    for(size_t iE = 0; iE < nE; ++iE)
+    {
+        // There can only be transmission if the wave propagates in both leads
+        if(E[iE] <= _V.front() || E[iE] <= _V.back())
+        {
+            T[iE] = 0.0;
+
+            if(phase)
+                phase[iE] = 0.0;
+        }
+        else
+        {
+            const double k_m_left = std::real(find_k(E[iE], _V.front(), _m.front()))/_m.front();
+            const double k_m_right = std::real(k_m[iE]);
+            T[iE] = k_m_left/k_m_right * exp(-2.0*log_scale[iE])/std::norm(M11[iE]);
+
+            if(phase)
+                phase[iE] = -std::arg(M11[iE]);
+        }
+    }
+}
+
+/**
+ * \brief Find the transmission coefficient at a single energy
+ *
+ * \param[in] E Energy [J]
+ */
+double TransferMatrix::get_transmission(const double E) const
+{
+    double T = 0.0;
+    find_block(&E, &T, nullptr, 1);
+    return T;
+}
+
+/**
+ * \brief Find the transmission coefficient at a set of energies
+ *
+ * \param[in] E         Energies [J]
+ * \param[in] n_threads Number of threads to use (0 = one per CPU core)
+ */
+arma::vec TransferMatrix::get_transmission(const arma::vec    &E,
+                                           const unsigned int  n_threads) const
+{
+    arma::vec phase;
+    return get_transmission(E, n_threads, phase, false);
+}
+
+/**
+ * \brief Find the transmission coefficient and phase at a set of energies
+ *
+ * \param[in]  E          Energies [J]
+ * \param[in]  n_threads  Number of threads to use (0 = one per CPU core)
+ * \param[out] phase      Phase of the transmitted wave at each energy [rad]
+ * \param[in]  find_phase True if the phase is needed
+ */
+arma::vec TransferMatrix::get_transmission(const arma::vec    &E,
+                                           const unsigned int  n_threads,
+                                           arma::vec          &phase,
+                                           const bool          find_phase) const
+{
+    const size_t nE       = E.size();
+    const size_t n_blocks = (nE + block_size - 1)/block_size;
+    arma::vec    T(nE);
+
+    if(find_phase)
+        phase.set_size(nE);
+
+    run_in_parallel(n_blocks, n_threads, [&](const size_t iblock) {
+        const size_t first = iblock*block_size;
+        const size_t n     = std::min(block_size, nE - first);
+        find_block(E.memptr() + first,
+                   T.memptr() + first,
+                   find_phase ? phase.memptr() + first : nullptr,
+                   n);
+    });
+
+    return T;
+}
+
+/**
+ * \brief Wrap an angle into the range [-pi, pi)
+ */
+static double wrap_phase(const double phi)
+{
+    return phi - 2.0*pi*floor((phi + pi)/(2.0*pi));
+}
+
+/**
+ * \brief Find the element of the transfer matrix whose zeros are the resonances
+ *
+ * \param[in] E Complex energy [J]
+ *
+ * \returns The element \f$M_{11}\f$ of the transfer matrix
+ *
+ * \details The transmission coefficient is proportional to \f$1/|M_{11}|^2\f$, so its
+ *          poles are the zeros of \f$M_{11}\f$.  With the wave vectors in the leads
+ *          taken on the outgoing branch, these are the quasi-bound states of the
+ *          structure.  The matrix is not rescaled, so this is only suitable for
+ *          structures in which it stays finite.
+ */
+std::complex<double> TransferMatrix::get_M11(const std::complex<double> E) const
+{
+    typedef std::complex<double> cx;
+
+    cx M00 = 1.0;
+    cx M01 = 0.0;
+    cx M10 = 0.0;
+    cx M11 = 1.0;
+    cx k_m = find_k(E, _V[0], _m[0])/_m[0];
+
+    for(size_t iL = 0; iL+1 < _V.size(); ++iL)
+    {
+        if(_d[iL] > 0.0)
+        {
+            const cx shift = std::exp(cx(0.0, 1.0)*k_m*_m[iL]*_d[iL]);
+            M00 *= shift;
+            M01 *= shift;
+            M10 /= shift;
+            M11 /= shift;
+        }
+
+        const cx k_m_next = find_k(E, _V[iL+1], _m[iL+1])/_m[iL+1];
+        const cx r        = k_m/k_m_next;
+        const cx a        = 0.5*(1.0 + r);
+        const cx b        = 0.5*(1.0 - r);
+
+        const cx M00_new = a*M00 + b*M10;
+        const cx M01_new = a*M01 + b*M11;
+        M10 = b*M00 + a*M10;
+        M11 = b*M01 + a*M11;
+        M00 = M00_new;
+        M01 = M01_new;
+        k_m = k_m_next;
+    }
+
+    return M11;
+}
+
+/**
+ * \brief Refine an estimate of a resonance, using the secant method
+ *
+ * \param[in,out] E  Estimate of the complex energy of the resonance [J]
+ * \param[in]     dE Size of the first step [J]
+ *
+ * \returns True if the search converged
+ */
+bool TransferMatrix::refine_resonance(std::complex<double> &E,
+                                      const double          dE) const
+{
+    typedef std::complex<double> cx;
+
+    const size_t max_iter = 100;
+    const double rel_tol  = 1e-13;
+
+    cx E0 = E;
+    cx E1 = E + cx(0.5*dE, -0.5*dE);
+    cx f0 = get_M11(E0);
+    cx f1 = get_M11(E1);
+
+    for(size_t iter = 0; iter < max_iter; ++iter)
+    {
+        if(!std::isfinite(std::abs(f0)) || !std::isfinite(std::abs(f1)))
+            return false;
+
+        if(f1 == 0.0)
+        {
+            E = E1;
+            return true;
+        }
+
+        const cx df = f1 - f0;
+
+        if(df == 0.0)
+            return false;
+
+        const cx E2 = E1 - f1*(E1 - E0)/df;
+
+        E0 = E1;
+        f0 = f1;
+        E1 = E2;
+        f1 = get_M11(E1);
+
+        if(std::abs(E1 - E0) < rel_tol*std::abs(E1))
+        {
+            E = E1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * \brief Find the quasi-bound states within a range of energy
+ *
+ * \param[in] E_min     Lowest energy [J]
+ * \param[in] E_max     Highest energy [J]
+ * \param[in] n_scan    Number of intervals in the coarse scan of the real axis
+ * \param[in] n_threads Number of threads to use (0 = one per CPU core)
+ *
+ * \returns The resonances, in order of increasing energy
+ *
+ * \details The transmission coefficient and phase are found on a coarse grid, and
+ *          each peak in T, and each interval in which the phase jumps, is used as a
+ *          starting point.  The pole of T nearby is then found in the complex plane
+ *          by the secant method, which gives the energy and width of the
+ *          resonance directly, as \f$E = E_r - i\Gamma/2\f$.  A narrow resonance
+ *          that falls between the points of the scan still makes the phase jump by
+ *          about pi, so it is not missed.
+ */
+std::vector<Resonance> TransferMatrix::find_resonances(const double       E_min,
+                                                       const double       E_max,
+                                                       const size_t       n_scan,
+                                                       const unsigned int n_threads) const
+{
+    if(E_max <= E_min || n_scan < 2)
+    {
+        std::ostringstream oss;
+        oss << "Cannot search for resonances from " << E_min << " to " << E_max << " J with "
+            << n_scan << " intervals.";
+        throw std::domain_error(oss.str());
+    }
+
+    const double    dE = (E_max - E_min)/n_scan;
+    const arma::vec E  = arma::linspace(E_min, E_max, n_scan+1);
+    arma::vec       phase;
+    const arma::vec T  = get_transmission(E, n_threads, phase, true);
+
+    // Starting points for the search
+    std::vector<double> seeds;
+
+    for(size_t i = 0; i < n_scan; ++i)
+    {
+        if(i > 0 && T(i) > T(i-1) && T(i) >= T(i+1))
+            seeds.push_back(E(i));
+
+        if(std::abs(wrap_phase(phase(i+1) - phase(i))) > pi/2)
+            seeds.push_back((E(i) + E(i+1))/2);
+    }
+
+    std::vector< std::complex<double> > poles(seeds.size());
+    std::vector<char>                   converged(seeds.size(), 0);
+
+    run_in_parallel(seeds.size(), n_threads, [&](const size_t iseed) {
+        poles[iseed]     = seeds[iseed];
+        converged[iseed] = refine_resonance(poles[iseed], dE);
+    });
+
+    // Keep each distinct pole that lies in range, below the real axis
+    std::vector<Resonance> resonances;
+
+    for(size_t iseed = 0; iseed < seeds.size(); ++iseed)
+    {
+        const auto &pole = poles[iseed];
+
+        if(!converged[iseed] || pole.real() < E_min || pole.real() > E_max || pole.imag() > 0.0)
+            continue;
+
+        bool duplicate = false;
+
+        for(auto const &res : resonances)
+        {
+            if(std::abs(pole - std::complex<double>(res.E, -res.Gamma/2)) < 1e-6*dE)
+                duplicate = true;
+        }
+
+        if(!duplicate)
+        {
+            Resonance res;
+            res.E     = pole.real();
+            res.Gamma = -2.0*pole.imag();
+            resonances.push_back(res);
+        }
+    }
+
+    std::sort(resonances.begin(), resonances.end(),
+              [](const Resonance &a, const Resonance &b) {return a.E < b.E;});
+
+    return resonances;
+}
+
+/**
+ * \brief Find a transmission spectrum on an energy grid that is refined at resonances
+ *
+ * \param[in] structure The structure
+ * \param[in] E_min     Lowest energy [J]
+ * \param[in] E_max     Highest energy [J]
+ * \param[in] T_tol     Largest allowed error in linear interpolation of T
+ * \param[in] phase_tol Largest allowed change in slope of the transmission phase
+ *                      across an interval [rad]
+ * \param[in] n_initial Number of intervals in the starting uniform grid
+ * \param[in] n_max     Largest number of energies to use
+ * \param[in] n_threads  Number of threads to use (0 = one per CPU core)
+ * \param[in] resonances Known resonances, e.g., from TransferMatrix::find_resonances.
+ *                       Extra points are placed across the width of each one in the
+ *                       starting grid.
+ *
+ * \details Each interval is bisected, and kept if T at the midpoint lies close to
+ *          the straight line between the ends and the phase changes evenly across
+ *          both halves.  Otherwise, both halves are refined again.  The phase of
+ *          the transmitted wave jumps by about pi across a resonance, however
+ *          narrow, so resonances are found even where T itself misses them
+ *          entirely on a coarse grid.  All the new midpoints in a pass are found
+ *          together in one call to the batched solver.
+ */
+TransmissionSpectrum::TransmissionSpectrum(const TransferMatrix         &structure,
+                                           const double                  E_min,
+                                           const double                  E_max,
+                                           const double                  T_tol,
+                                           const double                  phase_tol,
+                                           const size_t                  n_initial,
+                                           const size_t                  n_max,
+                                           const unsigned int            n_threads,
+                                           const std::vector<Resonance> &resonances)
+{
+    if(E_max <= E_min || n_initial < 1)
+    {
+        std::ostringstream oss;
+        oss << "Cannot make an energy grid from " << E_min << " to " << E_max << " J with "
+            << n_initial << " intervals.";
+        throw std::domain_error(oss.str());
+    }
+
+    const double dE_min = (E_max - E_min)*1e-12; // Narrowest interval
+
+    // Start from a uniform grid, with points spread across each known resonance
+    std::vector<double> E_start;
+    const double        offsets[] = {-8, -4, -2, -1, -0.5, 0, 0.5, 1, 2, 4, 8}; // Offsets in half-widths
+
+    for(size_t i = 0; i <= n_initial; ++i)
+        E_start.push_back(E_min + i*(E_max - E_min)/n_initial);
+
+    for(auto const &res : resonances)
+    {
+        for(auto const offset : offsets)
+        {
+            const double E_res = res.E + offset*res.Gamma/2;
+
+            if(E_res > E_min && E_res < E_max)
+                E_start.push_back(E_res);
+        }
+    }
+
+    std::sort(E_start.begin(), E_start.end());
+    E_start.erase(std::unique(E_start.begin(), E_start.end()), E_start.end());
+
+    arma::vec phase;
+    _E = arma::vec(E_start);
+    _T = structure.get_transmission(_E, n_threads, phase, true);
+
+    // Intervals that are still to be checked
+    std::vector<bool> active(_E.size()-1, true);
+
+    while(_E.size() < n_max)
+    {
+        // Find midpoints of all active intervals
+        std::vector<double> E_mid;
+
+        for(size_t i = 0; i < active.size(); ++i)
+        {
+            if(active[i] && _E(i+1) - _E(i) > dE_min)
+                E_mid.push_back((_E(i) + _E(i+1))/2);
+        }
+
+        if(E_mid.empty() || _E.size() + E_mid.size() > n_max)
+            break;
+
+        arma::vec       phase_mid;
+        const arma::vec E_mid_vec(E_mid);
+        const arma::vec T_mid = structure.get_transmission(E_mid_vec, n_threads, phase_mid, true);
+
+        // Merge the midpoints into the grid, and flag the halves that need more work
+        const size_t      n_new = _E.size() + E_mid.size();
+        arma::vec         E_new(n_new);
+        arma::vec         T_new(n_new);
+        arma::vec         phase_new(n_new);
+        std::vector<bool> active_new;
+        size_t            j     = 0; // Index in new grid
+        size_t            i_mid = 0; // Index of next midpoint
+
+        for(size_t i = 0; i < _E.size(); ++i)
+        {
+            E_new(j)     = _E(i);
+            T_new(j)     = _T(i);
+            phase_new(j) = phase(i);
+            ++j;
+
+            if(i+1 == _E.size())
+                break;
+
+            if(active[i] && _E(i+1) - _E(i) > dE_min)
+            {
+                const double T_err = std::abs(T_mid(i_mid) - (_T(i) + _T(i+1))/2);
+                const double dphi1 = wrap_phase(phase_mid(i_mid) - phase(i));
+                const double dphi2 = wrap_phase(phase(i+1) - phase_mid(i_mid));
+                const bool   refine = T_err > T_tol || std::abs(dphi2 - dphi1) > phase_tol;
+
+                E_new(j)     = E_mid[i_mid];
+                T_new(j)     = T_mid(i_mid);
+                phase_new(j) = phase_mid(i_mid);
+                ++j;
+                ++i_mid;
+
+                active_new.push_back(refine);
+                active_new.push_back(refine);
+            }
+            else
+                active_new.push_back(false);
+        }
+
+        _E     = E_new;
+        _T     = T_new;
+        phase  = phase_new;
+        active = active_new;
+    }
+
+    // Trapezium-rule weights for the non-uniform grid
+    const size_t nE = _E.size();
+    _weights = arma::zeros(nE);
+
+    for(size_t i = 0; i+1 < nE; ++i)
+    {
+        const double half_width = (_E(i+1) - _E(i))/2;
+        _weights(i)   += half_width;
+        _weights(i+1) += half_width;
+    }
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
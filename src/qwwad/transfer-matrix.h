@@ -0,0 +1,119 @@
+/**
+ * \file   transfer-matrix.h
+ * \brief  Transmission coefficients of one-dimensional potential profiles
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_TRANSFER_MATRIX_H
+#define QWWAD_TRANSFER_MATRIX_H
+
+#include <complex>
+#include <vector>
+#include <armadillo>
+
+namespace QWWAD
+{
+/// A quasi-bound state, found as a pole of the transmission coefficient
+struct Resonance
+{
+    double E;     ///< Energy of the resonance [J]
+    double Gamma; ///< Full width of the resonance at half maximum [J]
+};
+
+/**
+ * \brief A one-dimensional structure made of layers with constant potential and mass
+ *
+ * \details The first and last layers are semi-infinite leads.  The transmission
+ *          coefficient is found using the transfer-matrix method, with the
+ *          wavefunction and \f$\frac{1}{m}\frac{d\psi}{dz}\f$ continuous at each
+ *          interface.
+ *
+ *          A whole set of energies is found at once.  The structure is swept one
+ *          layer at a time, and the 2x2 matrix for every energy is updated in a
+ *          simple loop over contiguous arrays, which the compiler can vectorise.
+ *          Blocks of energies are shared between threads.
+ */
+class TransferMatrix
+{
+private:
+    std::vector<double> _d; ///< Width of each layer [m]
+    std::vector<double> _V; ///< Potential in each layer [J]
+    std::vector<double> _m; ///< Effective mass in each layer [kg]
+
+    void find_block(const double *E,
+                    double       *T,
+                    double       *phase,
+                    const size_t  nE) const;
+
+    bool refine_resonance(std::complex<double> &E,
+                          const double          dE) const;
+
+public:
+    TransferMatrix(const std::vector<double> &d,
+                   const std::vector<double> &V,
+                   const std::vector<double> &m);
+
+    static TransferMatrix from_profile(const arma::vec &z,
+                                       const arma::vec &V,
+                                       const arma::vec &m);
+
+    double get_transmission(const double E) const;
+
+    arma::vec get_transmission(const arma::vec    &E,
+                               const unsigned int  n_threads = 1) const;
+
+    arma::vec get_transmission(const arma::vec    &E,
+                               const unsigned int  n_threads,
+                               arma::vec          &phase,
+                               const bool          find_phase) const;
+
+    std::complex<double> get_M11(const std::complex<double> E) const;
+
+    std::vector<Resonance> find_resonances(const double       E_min,
+                                           const double       E_max,
+                                           const size_t       n_scan    = 200,
+                                           const unsigned int n_threads = 1) const;
+
+    /// Return the number of layers, including the leads
+    size_t get_n_layers() const {return _V.size();}
+};
+
+/**
+ * \brief A transmission spectrum on an energy grid that is refined around resonances
+ *
+ * \details The grid starts out uniform, with extra points around any known
+ *          resonances, and is bisected wherever T(E) or the phase of the transmitted
+ *          wave are poorly described by straight lines.  Quadrature weights for the
+ *          grid are provided, so that integrals over energy (such as the tunnelling
+ *          current) can be found directly from the spectrum.
+ */
+class TransmissionSpectrum
+{
+private:
+    arma::vec _E;       ///< Energies [J]
+    arma::vec _T;       ///< Transmission coefficient at each energy
+    arma::vec _weights; ///< Quadrature weight for each energy [J]
+
+public:
+    TransmissionSpectrum(const TransferMatrix         &structure,
+                         const double                  E_min,
+                         const double                  E_max,
+                         const double                  T_tol,
+                         const double                  phase_tol,
+                         const size_t                  n_initial,
+                         const size_t                  n_max,
+                         const unsigned int            n_threads  = 1,
+                         const std::vector<Resonance> &resonances = std::vector<Resonance>());
+
+    /// Return the energies [J]
+    decltype(_E) const & get_E() const {return _E;}
+
+    /// Return the transmission coefficient at each energy
+    decltype(_T) const & get_T() const {return _T;}
+
+    /// Return the quadrature weight for each energy [J]
+    decltype(_weights) const & get_weights() const {return _weights;}
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
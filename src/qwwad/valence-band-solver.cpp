@@ -0,0 +1,452 @@
+/**
+ * \file   valence-band-solver.cpp
+ * \brief  Multiband k.p solver for coupled valence-band states
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "valence-band-solver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#include "constants.h"
+#include "linear-algebra.h"
+#include "parallel.h"
+#include "schroedinger-solver-tridiagonal.h"
+
+namespace QWWAD
+{
+using namespace constants;
+
+typedef std::complex<double> cx;
+
+/// Number of operators in the Luttinger-Kohn Hamiltonian (P, Q, R and S)
+static const unsigned int n_operators = 4;
+
+static const double sqrt2  = sqrt(2.0);
+static const double sqrt32 = sqrt(1.5);
+
+/**
+ * \brief Weight of each operator (P, Q, R, S) in each element of the Hamiltonian
+ *
+ * \details This is the matrix given by Chuang, with the operators written in the
+ *          hole picture.  Each operator is Hermitian, so the table is symmetric and
+ *          the 4x4 Hamiltonian is its upper-left corner.
+ */
+static const double band_coefficients[6][6][n_operators] = {
+    {{1, 1, 0, 0},       {0, 0, 0, -1},        {0, 0, 1, 0},      {0, 0, 0, 0},
+     {0, 0, 0, -1/sqrt2}, {0, 0, sqrt2, 0}},
+    {{0, 0, 0, -1},       {1, -1, 0, 0},        {0, 0, 0, 0},      {0, 0, 1, 0},
+     {0, -sqrt2, 0, 0},   {0, 0, 0, sqrt32}},
+    {{0, 0, 1, 0},        {0, 0, 0, 0},         {1, -1, 0, 0},     {0, 0, 0, 1},
+     {0, 0, 0, sqrt32},   {0, sqrt2, 0, 0}},
+    {{0, 0, 0, 0},        {0, 0, 1, 0},         {0, 0, 0, 1},      {1, 1, 0, 0},
+     {0, 0, -sqrt2, 0},   {0, 0, 0, -1/sqrt2}},
+    {{0, 0, 0, -1/sqrt2}, {0, -sqrt2, 0, 0},    {0, 0, 0, sqrt32}, {0, 0, -sqrt2, 0},
+     {1, 0, 0, 0},        {0, 0, 0, 0}},
+    {{0, 0, sqrt2, 0},    {0, 0, 0, sqrt32},    {0, sqrt2, 0, 0},  {0, 0, 0, -1/sqrt2},
+     {0, 0, 0, 0},        {1, 0, 0, 0}}
+};
+
+/**
+ * \brief Set up the solver for a structure
+ *
+ * \param[in] z       Spatial location of each sample [m]
+ * \param[in] V       Hole potential at each sample [J]
+ * \param[in] gamma1  Luttinger parameter gamma1 at each sample
+ * \param[in] gamma2  Luttinger parameter gamma2 at each sample
+ * \param[in] gamma3  Luttinger parameter gamma3 at each sample
+ * \param[in] Delta   Spin-orbit splitting at each sample [J].  This is only used
+ *                    in the 6-band model.
+ * \param[in] n_bands Number of bands to include: 4 (heavy and light holes) or 6
+ *                    (heavy, light and split-off holes)
+ */
+ValenceBandSolver::ValenceBandSolver(const arma::vec    &z,
+                                     const arma::vec    &V,
+                                     const arma::vec    &gamma1,
+                                     const arma::vec    &gamma2,
+                                     const arma::vec    &gamma3,
+                                     const arma::vec    &Delta,
+                                     const unsigned int  n_bands) :
+    _z(z),
+    _h(arma::zeros(z.size())),
+    _V(V),
+    _gamma1(gamma1),
+    _gamma2(gamma2),
+    _gamma3(gamma3),
+    _Delta(Delta),
+    _nb(n_bands)
+{
+    const size_t nz = z.size();
+
+    if(V.size() != nz || gamma1.size() != nz || gamma2.size() != nz || gamma3.size() != nz ||
+       Delta.size() != nz || nz < 3)
+    {
+        std::ostringstream oss;
+        oss << "Cannot make a structure from " << nz << " positions, " << V.size()
+            << " potentials, " << gamma1.size() << ", " << gamma2.size() << " and "
+            << gamma3.size() << " Luttinger parameters, and " << Delta.size()
+            << " spin-orbit splittings.";
+        throw std::length_error(oss.str());
+    }
+
+    if(n_bands != 4 && n_bands != 6)
+    {
+        std::ostringstream oss;
+        oss << "Cannot use a " << n_bands << "-band model.  Only 4 or 6 bands are supported.";
+        throw std::invalid_argument(oss.str());
+    }
+
+    _h = SchroedingerSolverTridiag::get_cell_widths(z);
+}
+
+/**
+ * \brief Find the spatial operators P, Q, R and S for a given in-plane wave vector
+ *
+ * \param[in]  kt       In-plane wave vector [1/m]
+ * \param[out] op_diag  Diagonal of each operator, with one column per operator
+ * \param[out] op_super Superdiagonal of each operator, with one column per operator
+ *
+ * \details The operators are
+ *          \f[
+ *            P = c_0(\gamma_1 k_t^2 + k_z\gamma_1 k_z),\quad
+ *            Q = c_0(\gamma_2 k_t^2 - 2k_z\gamma_2 k_z),
+ *          \f]
+ *          \f[
+ *            R = -\sqrt{3}c_0\bar\gamma k_t^2,\quad
+ *            S = \sqrt{3}c_0 k_t\{\gamma_3, k_z\},
+ *          \f]
+ *          where \f$c_0 = \hbar^2/2m_0\f$ and \f$\bar\gamma = (\gamma_2+\gamma_3)/2\f$.
+ *          Each operator is Hermitian once the unknowns have been scaled by the
+ *          square root of the cell width, so only the superdiagonal is stored.
+ */
+void ValenceBandSolver::find_operators(const double  kt,
+                                       arma::cx_mat &op_diag,
+                                       arma::cx_mat &op_super) const
+{
+    const size_t nz  = _z.size();
+    const double c0  = hBar*hBar/(2.0*me);
+    const double kt2 = kt*kt;
+    const cx     I(0.0, 1.0);
+
+    op_diag.zeros(nz, n_operators);
+    op_super.zeros(nz-1, n_operators);
+
+    for(unsigned int iz = 0; iz < nz; ++iz)
+    {
+        // Separation from neighbouring points, mirroring the mesh at the edges
+        const double dz_minus = (iz==0)    ? _z[1] - _z[0]         : _z[iz] - _z[iz-1];
+        const double dz_plus  = (iz==nz-1) ? _z[nz-1] - _z[nz-2]   : _z[iz+1] - _z[iz];
+
+        // Parameters midway to each neighbour, avoiding outside addressing
+        const bool   edge     = (iz==0 || iz==nz-1);
+        const double g1_minus = edge ? _gamma1[iz] : 0.5*(_gamma1[iz] + _gamma1[iz-1]);
+        const double g1_plus  = edge ? _gamma1[iz] : 0.5*(_gamma1[iz] + _gamma1[iz+1]);
+        const double g2_minus = edge ? _gamma2[iz] : 0.5*(_gamma2[iz] + _gamma2[iz-1]);
+        const double g2_plus  = edge ? _gamma2[iz] : 0.5*(_gamma2[iz] + _gamma2[iz+1]);
+
+        // Diagonal of kz.gamma.kz
+        const double kgk1 = (g1_plus/dz_plus + g1_minus/dz_minus)/_h[iz];
+        const double kgk2 = (g2_plus/dz_plus + g2_minus/dz_minus)/_h[iz];
+
+        op_diag(iz, 0) = c0*(_gamma1[iz]*kt2 + kgk1);
+        op_diag(iz, 1) = c0*(_gamma2[iz]*kt2 - 2.0*kgk2);
+        op_diag(iz, 2) = -sqrt(3.0)*c0*0.5*(_gamma2[iz] + _gamma3[iz])*kt2;
+
+        if(iz != nz-1)
+        {
+            const double scale = 1.0/sqrt(_h[iz]*_h[iz+1]);
+            const double g1    = 0.5*(_gamma1[iz] + _gamma1[iz+1]);
+            const double g2    = 0.5*(_gamma2[iz] + _gamma2[iz+1]);
+            const double g3    = 0.5*(_gamma3[iz] + _gamma3[iz+1]);
+
+            op_super(iz, 0) = -c0*g1*scale/dz_plus;
+            op_super(iz, 1) = 2.0*c0*g2*scale/dz_plus;
+            op_super(iz, 3) = -I*sqrt(3.0)*c0*kt*g3*scale;
+        }
+    }
+}
+
+/**
+ * \brief Find one element of the Hamiltonian
+ *
+ * \param[in] op_diag  Diagonal of each operator
+ * \param[in] op_super Superdiagonal of each operator
+ * \param[in] iz       Index of the row sample
+ * \param[in] jz       Index of the column sample.  This must be within one of iz.
+ * \param[in] ib       Index of the row band
+ * \param[in] jb       Index of the column band
+ */
+cx ValenceBandSolver::get_element(const arma::cx_mat &op_diag,
+                                  const arma::cx_mat &op_super,
+                                  const unsigned int  iz,
+                                  const unsigned int  jz,
+                                  const unsigned int  ib,
+                                  const unsigned int  jb) const
+{
+    cx H_ij = 0.0;
+
+    for(unsigned int iop = 0; iop < n_operators; ++iop)
+    {
+        const double weight = band_coefficients[ib][jb][iop];
+
+        if(weight == 0.0)
+            continue;
+
+        if(iz == jz)
+            H_ij += weight*op_diag(iz, iop);
+        else if(jz == iz+1)
+            H_ij += weight*op_super(iz, iop);
+        else
+            H_ij += weight*std::conj(op_super(jz, iop));
+    }
+
+    if(iz == jz && ib == jb)
+    {
+        H_ij += _V[iz];
+
+        if(ib >= 4)
+            H_ij += _Delta[iz];
+    }
+
+    return H_ij;
+}
+
+/**
+ * \brief Construct the Hamiltonian for a given in-plane wave vector
+ *
+ * \param[in] kt In-plane wave vector [1/m]
+ *
+ * \returns The upper triangle of the Hamiltonian in LAPACK band storage
+ */
+arma::cx_mat ValenceBandSolver::make_hermitian_band(const double kt) const
+{
+    const size_t nz = _z.size();
+    const size_t N  = nz*_nb;
+    const size_t KD = 2*_nb - 1; // Number of superdiagonals
+
+    arma::cx_mat op_diag;
+    arma::cx_mat op_super;
+    find_operators(kt, op_diag, op_super);
+
+    arma::cx_mat AB(KD+1, N, arma::fill::zeros);
+
+    for(unsigned int iz = 0; iz < nz; ++iz)
+    {
+        for(unsigned int jz = iz; jz < std::min<size_t>(iz+2, nz); ++jz)
+        {
+            for(unsigned int ib = 0; ib < _nb; ++ib)
+            {
+                for(unsigned int jb = 0; jb < _nb; ++jb)
+                {
+                    const size_t r = iz*_nb + ib;
+                    const size_t c = jz*_nb + jb;
+
+                    if(r <= c)
+                        AB(KD + r - c, c) = get_element(op_diag, op_super, iz, jz, ib, jb);
+                }
+            }
+        }
+    }
+
+    return AB;
+}
+
+/**
+ * \brief Find the eigenvectors for a set of known eigenvalues
+ *
+ * \param[in] kt In-plane wave vector [1/m]
+ * \param[in] E  Eigenvalues, in ascending order [J]
+ *
+ * \details Inverse iteration is used, with the band LU factorisation of the
+ *          shifted Hamiltonian.  Every state is at least twofold degenerate
+ *          (Kramers degeneracy), so eigenvalues that are indistinguishable are
+ *          handled as a cluster: the shifted matrix is factorised once for the
+ *          cluster, and each vector is orthogonalised against the others in the
+ *          cluster at every iteration.
+ */
+std::vector<ValenceBandState>
+ValenceBandSolver::find_eigenvectors(const double     kt,
+                                     const arma::vec &E) const
+{
+    const size_t nz     = _z.size();
+    const size_t N      = nz*_nb;
+    const size_t KD     = 2*_nb - 1;
+    const size_t n_iter = 4; // Number of inverse iterations for each vector
+
+    std::vector<ValenceBandState> states;
+
+    if(E.empty())
+        return states;
+
+    const arma::cx_mat H = make_hermitian_band(kt);
+
+    // Copy into general band storage, with room for the fill-in from pivoting
+    arma::cx_mat AB(3*KD+1, N, arma::fill::zeros);
+
+    for(size_t c = 0; c < N; ++c)
+    {
+        for(size_t r = (c > KD ? c - KD : 0); r <= c; ++r)
+        {
+            const cx H_rc = H(KD + r - c, c);
+            AB(2*KD + r - c, c) = H_rc;
+
+            if(r != c)
+                AB(2*KD + c - r, r) = std::conj(H_rc);
+        }
+    }
+
+    // Eigenvalues closer than the clustering tolerance are treated as degenerate.
+    // The shift is placed much closer than this to each cluster, but far enough
+    // away for the shifted matrix to be safely non-singular.
+    const double H_norm = arma::abs(H).max();
+    const double tol    = 1e-10*H_norm;
+    const double delta  = 1e-12*H_norm;
+
+    std::mt19937                           rng(5489u);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    CxBandFactorisation                    LU;
+    arma::cx_mat                           X(N, E.size());
+    arma::cx_vec                           x(N);
+
+    size_t ist = 0;
+    while(ist < E.size())
+    {
+        size_t ist_end = ist + 1;
+
+        while(ist_end < E.size() && E[ist_end] - E[ist_end-1] < tol)
+            ++ist_end;
+
+        const double shift = E[ist] - delta;
+        arma::cx_mat AB_shift(AB);
+        AB_shift.row(2*KD) -= shift;
+        LU.factorise(AB_shift, KD, KD);
+
+        for(size_t i = ist; i < ist_end; ++i)
+        {
+            for(size_t n = 0; n < N; ++n)
+                x[n] = cx(dist(rng), dist(rng));
+
+            for(size_t iter = 0; iter < n_iter; ++iter)
+            {
+                LU.solve_in_place(x);
+
+                for(size_t j = ist; j < i; ++j)
+                    x -= arma::cdot(X.col(j), x)*X.col(j);
+
+                x /= arma::norm(x);
+            }
+
+            X.col(i) = x;
+        }
+
+        ist = ist_end;
+    }
+
+    for(size_t i = 0; i < E.size(); ++i)
+    {
+        ValenceBandState state;
+        state.E = E[i];
+        state.psi.set_size(nz, _nb);
+
+        // Undo the symmetrising scale factor
+        for(unsigned int iz = 0; iz < nz; ++iz)
+        {
+            for(unsigned int ib = 0; ib < _nb; ++ib)
+                state.psi(iz, ib) = X(iz*_nb + ib, i)/sqrt(_h[iz]);
+        }
+
+        states.push_back(state);
+    }
+
+    return states;
+}
+
+/**
+ * \brief Find all states within an energy range
+ *
+ * \param[in] kt    In-plane wave vector [1/m]
+ * \param[in] E_min Lowest hole energy to find [J]
+ * \param[in] E_max Highest hole energy to find [J]
+ *
+ * \returns The states, in ascending order of energy
+ */
+std::vector<ValenceBandState> ValenceBandSolver::get_states(const double kt,
+                                                            const double E_min,
+                                                            const double E_max) const
+{
+    if(E_max <= E_min)
+    {
+        std::ostringstream oss;
+        oss << "Cannot search for states between " << E_min << " J and " << E_max << " J.";
+        throw std::domain_error(oss.str());
+    }
+
+    arma::cx_mat H = make_hermitian_band(kt);
+    const arma::vec E = eigen_hermitian_banded_values(H, E_min, E_max);
+    return find_eigenvectors(kt, E);
+}
+
+/**
+ * \brief Find the states with the lowest hole energies
+ *
+ * \param[in] kt       In-plane wave vector [1/m]
+ * \param[in] n_states Number of states to find
+ *
+ * \returns The states, in ascending order of energy
+ */
+std::vector<ValenceBandState> ValenceBandSolver::get_lowest_states(const double       kt,
+                                                                   const unsigned int n_states) const
+{
+    if(n_states == 0)
+        return std::vector<ValenceBandState>();
+
+    arma::cx_mat H = make_hermitian_band(kt);
+    const arma::vec E = eigen_hermitian_banded_range(H, 0, n_states-1);
+    return find_eigenvectors(kt, E);
+}
+
+/**
+ * \brief Find the in-plane dispersion of the lowest states
+ *
+ * \param[in] kt        In-plane wave vectors [1/m]
+ * \param[in] n_states  Number of states to find at each wave vector
+ * \param[in] n_threads Number of threads to use
+ *
+ * \returns The hole energy [J] of each state, with one row for each wave vector
+ *          and one column for each state
+ *
+ * \details Only the eigenvalues are needed, so no eigenvectors are found.  Each
+ *          wave vector is independent, so they are shared between the threads.
+ */
+arma::mat ValenceBandSolver::get_dispersion(const arma::vec    &kt,
+                                            const unsigned int  n_states,
+                                            const unsigned int  n_threads) const
+{
+    const size_t N = _z.size()*_nb;
+
+    if(n_states == 0 || n_states > N)
+    {
+        std::ostringstream oss;
+        oss << "Cannot find " << n_states << " states in a " << _nb << "-band model with "
+            << _z.size() << " spatial samples.";
+        throw std::length_error(oss.str());
+    }
+
+    arma::mat E(kt.size(), n_states);
+
+    run_in_parallel(kt.size(), n_threads, [&](const size_t ik) {
+        arma::cx_mat H = make_hermitian_band(kt[ik]);
+        const arma::vec E_k = eigen_hermitian_banded_range(H, 0, n_states-1);
+
+        for(unsigned int ist = 0; ist < n_states; ++ist)
+            E(ik, ist) = E_k[ist];
+    });
+
+    return E;
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,102 @@
+/**
+ * \file   valence-band-solver.h
+ * \brief  Multiband k.p solver for coupled valence-band states
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_VALENCE_BAND_SOLVER_H
+#define QWWAD_VALENCE_BAND_SOLVER_H
+
+#include <complex>
+#include <vector>
+#include <armadillo>
+
+namespace QWWAD
+{
+/**
+ * \brief A state found by the multiband valence-band solver
+ */
+struct ValenceBandState
+{
+    double       E;   ///< Hole energy [J]
+    arma::cx_mat psi; ///< Envelope function [1/sqrt(m)], with one row for each
+                      ///< spatial sample and one column for each band
+};
+
+/**
+ * \brief Solves the 4x4 or 6x6 Luttinger-Kohn Hamiltonian for a layered structure
+ *
+ * \details The heavy-, light- and (optionally) split-off hole bands are coupled
+ *          through the Luttinger parameters, which may vary with position.  The
+ *          axial approximation is used, so the in-plane wave vector can be taken
+ *          along x without loss of generality.  The bands are ordered as
+ *          HH(+3/2), LH(+1/2), LH(-1/2), HH(-3/2), SO(+1/2), SO(-1/2).
+ *
+ *          The hole picture is used throughout, so that energies increase away from
+ *          the valence-band edge and confined states lie above the bottom of the
+ *          hole potential.
+ *
+ *          The spatial derivatives use the same finite-volume discretisation as
+ *          SchroedingerSolverTridiag, so each band is coupled only to its nearest
+ *          neighbours in space.  With the unknowns ordered by position and then by
+ *          band, the Hamiltonian is a band matrix with half-bandwidth 2*nb-1 for nb
+ *          bands.  Only the band is stored, so the memory and time needed grow
+ *          linearly with the number of spatial samples.
+ */
+class ValenceBandSolver
+{
+private:
+    arma::vec    _z;      ///< Spatial location of each sample [m]
+    arma::vec    _h;      ///< Width of the cell around each sample [m]
+    arma::vec    _V;      ///< Hole potential at each sample [J]
+    arma::vec    _gamma1; ///< Luttinger parameter gamma1 at each sample
+    arma::vec    _gamma2; ///< Luttinger parameter gamma2 at each sample
+    arma::vec    _gamma3; ///< Luttinger parameter gamma3 at each sample
+    arma::vec    _Delta;  ///< Spin-orbit splitting at each sample [J]
+    unsigned int _nb;     ///< Number of bands (4 or 6)
+
+    std::complex<double> get_element(const arma::cx_mat &op_diag,
+                                     const arma::cx_mat &op_super,
+                                     const unsigned int  iz,
+                                     const unsigned int  jz,
+                                     const unsigned int  ib,
+                                     const unsigned int  jb) const;
+
+    void find_operators(const double  kt,
+                        arma::cx_mat &op_diag,
+                        arma::cx_mat &op_super) const;
+
+    arma::cx_mat make_hermitian_band(const double kt) const;
+
+    std::vector<ValenceBandState> find_eigenvectors(const double     kt,
+                                                    const arma::vec &E) const;
+
+public:
+    ValenceBandSolver(const arma::vec    &z,
+                      const arma::vec    &V,
+                      const arma::vec    &gamma1,
+                      const arma::vec    &gamma2,
+                      const arma::vec    &gamma3,
+                      const arma::vec    &Delta,
+                      const unsigned int  n_bands = 6);
+
+    std::vector<ValenceBandState> get_states(const double kt,
+                                             const double E_min,
+                                             const double E_max) const;
+
+    std::vector<ValenceBandState> get_lowest_states(const double       kt,
+                                                    const unsigned int n_states) const;
+
+    arma::mat get_dispersion(const arma::vec    &kt,
+                             const unsigned int  n_states,
+                             const unsigned int  n_threads = 1) const;
+
+    /// Return the number of bands in the model
+    inline unsigned int get_n_bands() const {return _nb;}
+
+    /// Return the spatial location of each sample [m]
+    inline const arma::vec & get_z() const {return _z;}
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
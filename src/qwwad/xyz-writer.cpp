@@ -0,0 +1,233 @@
+/**
+ * \file   xyz-writer.cpp
+ * \brief  Streaming output of atomic positions in XYZ format
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include "xyz-writer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "parallel.h"
+
+namespace QWWAD
+{
+/// Identifier at the start of a binary XYZ file
+static const char xyz_magic[8] = {'Q','W','W','A','D','X','Y','Z'};
+
+/// Version number of the binary XYZ file format
+static const uint32_t xyz_version = 1;
+
+/**
+ * \brief Append a number to a buffer, formatted in the same way as printf("%9.3f")
+ *
+ * \param[in,out] buffer The buffer
+ * \param[in]     v      The number
+ *
+ * \details The digits are found using integer arithmetic, which is much quicker
+ *          than printf.  Numbers that lie very close to a rounding tie, or are too
+ *          large to scale exactly, are passed to snprintf so that the output is
+ *          always identical.
+ */
+static void append_fixed3(std::string  &buffer,
+                          const double  v)
+{
+    const double scaled = v*1000.0;
+
+    if(!std::isfinite(scaled) || std::abs(scaled) > 1e15
+       || std::abs(std::abs(scaled - std::floor(scaled)) - 0.5) < 1e-6)
+    {
+        char str[64];
+        snprintf(str, sizeof(str), "%9.3f", v);
+        buffer += str;
+        return;
+    }
+
+    unsigned long long u = std::llabs(std::llround(scaled));
+
+    // Fill the digits in from the right
+    char  str[32];
+    char *p = str + sizeof(str);
+
+    for(unsigned int idigit = 0; idigit < 3; ++idigit)
+    {
+        *--p = '0' + u%10;
+        u /= 10;
+    }
+
+    *--p = '.';
+
+    do
+    {
+        *--p = '0' + u%10;
+        u /= 10;
+    } while(u > 0);
+
+    if(std::signbit(v))
+        *--p = '-';
+
+    const size_t len = str + sizeof(str) - p;
+
+    if(len < 9)
+        buffer.append(9 - len, ' ');
+
+    buffer.append(p, len);
+}
+
+/**
+ * \brief Open a file and write its header
+ *
+ * \param[in] filename The name of the file
+ * \param[in] n_atoms  The total number of atoms that will be written
+ * \param[in] binary   True if the binary format should be used
+ */
+XYZWriter::XYZWriter(const std::string &filename,
+                     const size_t       n_atoms,
+                     const bool         binary) :
+    _filename(filename),
+    _binary(binary),
+    _stream(filename.c_str(), std::ios::binary)
+{
+    if(!_stream.is_open())
+    {
+        std::ostringstream oss;
+        oss << "Could not open " << filename << " for writing.";
+        throw std::runtime_error(oss.str());
+    }
+
+    if(_binary)
+    {
+        const uint32_t reserved = 0;
+        const uint64_t n = n_atoms;
+        _stream.write(xyz_magic, sizeof(xyz_magic));
+        _stream.write(reinterpret_cast<const char *>(&xyz_version), sizeof(xyz_version));
+        _stream.write(reinterpret_cast<const char *>(&reserved), sizeof(reserved));
+        _stream.write(reinterpret_cast<const char *>(&n), sizeof(n));
+    }
+    else
+    {
+        // Write number of atoms to first line of file, then leave blank line
+        _stream << n_atoms << "\n\n";
+    }
+}
+
+/**
+ * \brief Add an atom to a buffer
+ *
+ * \param[in,out] buffer The buffer
+ * \param[in]     type   The atomic species
+ * \param[in]     x      x coordinate [angstrom]
+ * \param[in]     y      y coordinate [angstrom]
+ * \param[in]     z      z coordinate [angstrom]
+ *
+ * \details This only formats the atom, so it may be called by several
+ *          threads at once, as long as each one uses its own buffer.
+ */
+void XYZWriter::add_atom(std::string &buffer,
+                         const char  *type,
+                         const double x,
+                         const double y,
+                         const double z) const
+{
+    if(_binary)
+    {
+        if(strlen(type) >= type_size)
+        {
+            std::ostringstream oss;
+            oss << "Atomic species name " << type << " is too long for a binary XYZ file.";
+            throw std::length_error(oss.str());
+        }
+
+        char name[type_size] = {};
+        strncpy(name, type, type_size - 1);
+        buffer.append(name, type_size);
+
+        const double r[3] = {x, y, z};
+        buffer.append(reinterpret_cast<const char *>(r), sizeof(r));
+    }
+    else
+    {
+        buffer += type;
+
+        for(auto const r : {x, y, z})
+        {
+            buffer += ' ';
+            append_fixed3(buffer, r);
+        }
+
+        buffer += '\n';
+    }
+}
+
+/**
+ * \brief Write the contents of a buffer to the file
+ */
+void XYZWriter::write(const std::string &buffer)
+{
+    _stream.write(buffer.data(), buffer.size());
+
+    if(!_stream)
+    {
+        std::ostringstream oss;
+        oss << "Could not write atomic positions to " << _filename;
+        throw std::runtime_error(oss.str());
+    }
+}
+
+/**
+ * \brief Generate and write a crystal one slab at a time
+ *
+ * \param[in] n_slabs   Number of slabs
+ * \param[in] n_threads Number of slabs to generate at once (0 = one per CPU core)
+ * \param[in] make_slab Function that adds all the atoms in a given slab to a buffer
+ *
+ * \details A batch of slabs is generated in parallel, and then written in order
+ *          before the next batch is started, so only a few slabs are ever held
+ *          in memory.
+ */
+void XYZWriter::write_slabs(const size_t                                      n_slabs,
+                            const unsigned int                                n_threads,
+                            const std::function<void (size_t, std::string &)> &make_slab)
+{
+    // Keep a few slabs per thread in each batch, so that threads are rarely idle
+    const unsigned int n_cores    = get_thread_count(n_threads);
+    const size_t       batch_size = 4*n_cores;
+    std::vector<std::string> buffers(std::min(batch_size, n_slabs));
+
+    for(size_t first = 0; first < n_slabs; first += batch_size)
+    {
+        const size_t n_batch = std::min(batch_size, n_slabs - first);
+
+        run_in_parallel(n_batch, n_threads, [&](const size_t ibatch) {
+            buffers[ibatch].clear();
+            make_slab(first + ibatch, buffers[ibatch]);
+        });
+
+        for(size_t ibatch = 0; ibatch < n_batch; ++ibatch)
+            write(buffers[ibatch]);
+    }
+}
+
+/**
+ * \brief Check whether a file is a binary XYZ file
+ *
+ * \param[in] filename The name of the file to check
+ */
+bool XYZWriter::is_binary_file(const std::string &filename)
+{
+    std::ifstream stream(filename.c_str(), std::ios::binary);
+    char magic[sizeof(xyz_magic)];
+
+    if(!stream.read(magic, sizeof(magic)))
+        return false;
+
+    return std::equal(magic, magic + sizeof(magic), xyz_magic);
+}
+} // namespace
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
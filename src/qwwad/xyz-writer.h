@@ -0,0 +1,63 @@
+/**
+ * \file   xyz-writer.h
+ * \brief  Streaming output of atomic positions in XYZ format
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#ifndef QWWAD_XYZ_WRITER_H
+#define QWWAD_XYZ_WRITER_H
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+
+namespace QWWAD
+{
+/**
+ * \brief Writes a large set of atomic positions to a file without holding them all
+ *
+ * \details The positions are written either as a standard XYZ text file, or as
+ *          a binary file that holds the same information.  The binary file has an
+ *          8-byte identifier, the format version, a reserved (zero) 32-bit field
+ *          and the number of atoms, followed by one record for each atom.  Each
+ *          record holds the species name, padded with zeros to 12 bytes, and the
+ *          x, y and z coordinates as doubles [angstrom].  All values are stored
+ *          in the native byte order of the machine.
+ *
+ *          Atoms are formatted into a memory buffer, which is then written in a
+ *          single block.  The crystal can be generated in slabs by several threads
+ *          at once, and the slabs are still written in order.
+ */
+class XYZWriter
+{
+public:
+    /// Number of bytes for the species name in each binary record
+    static const size_t type_size = 12;
+
+    XYZWriter(const std::string &filename,
+              const size_t       n_atoms,
+              const bool         binary);
+
+    void add_atom(std::string &buffer,
+                  const char  *type,
+                  const double x,
+                  const double y,
+                  const double z) const;
+
+    void write(const std::string &buffer);
+
+    void write_slabs(const size_t                                      n_slabs,
+                     const unsigned int                                n_threads,
+                     const std::function<void (size_t, std::string &)> &make_slab);
+
+    static bool is_binary_file(const std::string &filename);
+
+private:
+    std::string   _filename; ///< Name of the output file
+    bool          _binary;   ///< True if the file is in binary format
+    std::ofstream _stream;   ///< Output stream
+};
+} // namespace
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
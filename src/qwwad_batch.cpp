@@ -0,0 +1,372 @@
+/**
+ * \file   qwwad_batch.cpp
+ * \brief  Generate the mesh and band edges, and find the states, for a list of structures
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "qwwad/band-edge.h"
+#include "qwwad/constants.h"
+#include "qwwad/file-io.h"
+#include "qwwad/mesh.h"
+#include "qwwad/options.h"
+#include "qwwad/parallel.h"
+#include "qwwad/profiler.h"
+#include "qwwad/schroedinger-solver-shooting.h"
+#include "qwwad/schroedinger-solver-tridiagonal.h"
+
+using namespace QWWAD;
+using namespace constants;
+
+/**
+ * Configure command-line options for the program
+ */
+Options configure_options(int argc, char* argv[])
+{
+    Options opt;
+
+    std::string summary("Generate the mesh and band edges, and find the states, for each structure in a list.");
+
+    opt.add_option<std::string>("manifest,i",    "structures.txt", "File containing the list of structures.  Each line gives the "
+                                                                   "name of a layer file and, optionally, the directory to which "
+                                                                   "its results are written.");
+    opt.add_option<double>     ("dzmax",                      0.1, "Maximum separation between spatial points [angstrom].");
+    opt.add_option<double>     ("dzmaxbulk",                    0, "Maximum separation between spatial points far from interfaces "
+                                                                   "[angstrom]. If larger than --dzmax, a graded mesh is "
+                                                                   "generated.");
+    opt.add_option<size_t>     ("nper,p",                       1, "Number of periods in each structure");
+    opt.add_option<std::string>("material,M",            "gaalas", "Material ID: \"gaalas\" for Ga(1-x)Al(x)As, "
+                                                                   "\"cdmnte\" for Cd(1-x)Mn(x)Te, or "
+                                                                   "\"inalgaas\" for In(1-x-y)Al(x)Ga(y)As");
+    opt.add_option<char>       ("particle",                   'e', "Particle to be used: 'e', 'h' or 'l'");
+    opt.add_option<double>     ("mass",                            "Set a constant effective-mass across each structure "
+                                                                   "(relative to free electron). "
+                                                                   "If not specified, the mass is calculated automatically.");
+    opt.add_option<std::string>("solver",                "matrix", "Method used to solve the Schroedinger equation: \"matrix\", "
+                                                                   "\"shooting\" or \"shooting-nonparabolic\"");
+    opt.add_option<bool>       ("numerov",                         "Use fourth-order Numerov integration in the shooting-method "
+                                                                   "solvers.");
+    opt.add_option<double>     ("dE",                        1e-3, "Initial energy step [meV] used to extend the search range above "
+                                                                   "the potential. This is only used with the shooting-method solvers.");
+    opt.add_option<size_t>     ("nstmax",                       0, "Maximum number of subbands to find in each structure.  The "
+                                                                   "default (0) means that all states are found up to the maximum "
+                                                                   "confining potential.");
+    opt.add_option<std::string>("summaryfile",          "batch.r", "File to which the number of states and the ground-state energy "
+                                                                   "of each structure are written.");
+    opt.add_option<unsigned int>("threads",                     0, "Number of structures to solve at once (0 = one per CPU core)");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, summary);
+
+    return opt;
+}
+
+/**
+ * \brief A structure in the list
+ */
+struct BatchItem
+{
+    std::string layerfile; ///< File from which the layers are read
+    std::string outdir;    ///< Directory to which the results are written
+};
+
+/**
+ * \brief Read the list of structures
+ *
+ * \param[in] fname Name of the manifest file
+ *
+ * \details Blank lines, and anything following a '#', are ignored.  If no
+ *          output directory is given for a structure, the name of the layer
+ *          file is used without its extension, e.g., the results for
+ *          designs/s1.r are written to designs/s1.
+ */
+static std::vector<BatchItem> read_manifest(const std::string &fname)
+{
+    std::ifstream stream(fname.c_str());
+
+    if(!stream.is_open())
+    {
+        std::ostringstream oss;
+        oss << "Could not open manifest file " << fname;
+        throw std::runtime_error(oss.str());
+    }
+
+    std::vector<BatchItem> items;
+    std::string line;
+
+    while(std::getline(stream, line))
+    {
+        const auto comment = line.find('#');
+
+        if(comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream iss(line);
+        BatchItem item;
+
+        if(!(iss >> item.layerfile))
+            continue;
+
+        if(!(iss >> item.outdir))
+        {
+            const auto dot   = item.layerfile.rfind('.');
+            const auto slash = item.layerfile.rfind('/');
+
+            if(dot != std::string::npos && dot != 0 && (slash == std::string::npos || dot > slash+1))
+                item.outdir = item.layerfile.substr(0, dot);
+            else
+                item.outdir = item.layerfile + ".out";
+        }
+
+        items.push_back(item);
+    }
+
+    if(items.empty())
+    {
+        std::ostringstream oss;
+        oss << "No structures listed in " << fname;
+        throw std::runtime_error(oss.str());
+    }
+
+    return items;
+}
+
+/**
+ * \brief Summary of the results for a single structure
+ */
+struct BatchResult
+{
+    BatchResult() :
+        nst(0),
+        E0(0)
+    {}
+
+    size_t      nst;   ///< Number of states found
+    double      E0;    ///< Ground-state energy [meV]
+    std::string error; ///< Reason for failure (empty if the structure was solved)
+};
+
+/**
+ * \brief Run the whole calculation for a single structure
+ *
+ * \param[in] opt  User options
+ * \param[in] item The structure
+ *
+ * \returns A summary of the results
+ *
+ * \details This does the same job as running qwwad_mesh, qwwad_ef_band_edge and
+ *          qwwad_ef_generic in turn, and writes the same files to the output
+ *          directory.  The band-edge potential is used as the confining
+ *          potential, and is also written to v.r.  No intermediate file is read
+ *          back, so each structure is only parsed once.
+ */
+static BatchResult run_structure(const Options   &opt,
+                                 const BatchItem &item)
+{
+    ScopedTraceEvent event("structure");
+
+    // Each structure goes in its own directory, unless the tables are all
+    // held in a project file
+    if(!pipe_output_enabled() && mkdir(item.outdir.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        std::ostringstream oss;
+        oss << "Could not create " << item.outdir;
+        throw std::runtime_error(oss.str());
+    }
+
+    const auto prefix = item.outdir + "/";
+
+    // Generate the mesh
+    std::unique_ptr<Mesh> het(Mesh::create_from_file_auto_nz(item.layerfile,
+                                                             opt.get_option<size_t>("nper"),
+                                                             opt.get_option<double>("dzmax")*1e-10,
+                                                             opt.get_option<double>("dzmaxbulk")*1e-10));
+
+    const auto ncell  = het->get_ncell();
+    const auto nalloy = het->get_n_alloy();
+    const auto z_va   = het->get_z();
+    const arma::vec z(&z_va[0], ncell);
+
+    arma::vec x = arma::zeros(ncell);
+    arma::vec y = arma::zeros(ncell);
+
+    for(unsigned int iz = 0; iz < ncell; ++iz)
+    {
+        const auto &alloy = het->get_x_at_point(iz);
+
+        if(nalloy > 0)
+            x(iz) = alloy[0];
+
+        if(nalloy > 1)
+            y(iz) = alloy[1];
+    }
+
+    write_table((prefix + "interfaces.r").c_str(), het->get_layer_top_indices());
+
+    if(nalloy > 1)
+        write_table((prefix + "x.r").c_str(), z, x, y);
+    else
+        write_table((prefix + "x.r").c_str(), z, x);
+
+    write_table((prefix + "d.r").c_str(), z_va, het->get_n3D_array());
+
+    // Find the band edges
+    const auto particle = opt.get_option<char>("particle");
+    auto       profile  = get_band_edge_profile(opt.get_option<std::string>("material"), particle, x, y);
+
+    if(opt.get_argument_known("mass"))
+    {
+        const auto mass = opt.get_option<double>("mass")*me;
+        profile.m.fill(mass);
+        profile.m_perp.fill(mass);
+    }
+
+    write_table((prefix + "v_b.r").c_str(),    z, profile.V);
+    write_table((prefix + "v.r").c_str(),      z, profile.V);
+    write_table((prefix + "Eg.r").c_str(),     z, profile.Eg);
+    write_table((prefix + "eps_dc.r").c_str(), z, profile.eps_dc);
+    write_table((prefix + "m.r").c_str(),      z, profile.m);
+    write_table((prefix + "m_perp.r").c_str(), z, profile.m_perp);
+    write_table((prefix + "alpha.r").c_str(),  z, profile.alpha);
+
+    // Find the states
+    const auto solver  = opt.get_option<std::string>("solver");
+    const auto nst_max = opt.get_option<size_t>("nstmax");
+    std::unique_ptr<SchroedingerSolver> se;
+
+    if(solver == "matrix")
+        se.reset(new SchroedingerSolverTridiag(profile.m, profile.V, z, nst_max));
+    else if(solver == "shooting" || solver == "shooting-nonparabolic")
+    {
+        const arma::vec alpha = (solver == "shooting") ? arma::zeros(ncell) : profile.alpha;
+        se.reset(new SchroedingerSolverShooting(profile.m,
+                                                alpha,
+                                                profile.V,
+                                                z,
+                                                opt.get_option<double>("dE")*e/1000,
+                                                nst_max,
+                                                opt.get_option<bool>("numerov")));
+    }
+    else
+    {
+        std::ostringstream oss;
+        oss << "Cannot parse solver type: " << solver;
+        throw std::runtime_error(oss.str());
+    }
+
+    const auto solutions = se->get_solutions(true);
+
+    BatchResult result;
+    result.nst = solutions.size();
+
+    if(!solutions.empty())
+    {
+        result.E0 = solutions[0].get_energy()*1000/e;
+
+        Eigenstate::write_to_file(prefix + "E" + particle + ".r",
+                                  prefix + "wf_" + particle,
+                                  ".r",
+                                  solutions,
+                                  true);
+    }
+
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    if(!band_edge_material_known(opt.get_option<std::string>("material")))
+    {
+        std::cerr << "The only materials defined in the database are "
+                     "Ga(1-x)Al(x)As, Cd(1-x)Mn(x)Te and In(1-x-y)Al(x)Ga(y)As" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // The shooting-method solvers need a fixed spatial step
+    const auto solver = opt.get_option<std::string>("solver");
+
+    if(solver != "matrix" && opt.get_option<double>("dzmaxbulk") > opt.get_option<double>("dzmax"))
+    {
+        std::cerr << "The " << solver << " solver only works with a uniform spatial mesh. "
+                     "Use the matrix solver, or remove --dzmaxbulk." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<BatchItem> items;
+
+    try
+    {
+        items = read_manifest(opt.get_option<std::string>("manifest"));
+    }
+    catch(std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<BatchResult> results(items.size());
+    std::mutex               print_mutex; // Lock for the progress messages
+
+    // A failure in one structure doesn't stop the others, so a long batch still
+    // gives results for every structure that can be solved
+    run_in_parallel(items.size(), opt.get_option<unsigned int>("threads"), [&](const size_t iitem) {
+        try
+        {
+            results[iitem] = run_structure(opt, items[iitem]);
+        }
+        catch(std::exception &e)
+        {
+            results[iitem].error = e.what();
+        }
+
+        if(opt.get_verbose())
+        {
+            std::lock_guard<std::mutex> lock(print_mutex);
+
+            if(results[iitem].error.empty())
+                std::cout << items[iitem].layerfile << ": " << results[iitem].nst << " states, ground state at "
+                          << results[iitem].E0 << " meV" << std::endl;
+            else
+                std::cout << items[iitem].layerfile << ": failed" << std::endl;
+        }
+    });
+
+    // Summarise the results, counting structures from 1
+    std::vector<unsigned int> index;
+    std::vector<unsigned int> nst;
+    std::vector<double>       E0;
+    bool                      failed = false;
+
+    for(size_t iitem = 0; iitem < items.size(); ++iitem)
+    {
+        if(!results[iitem].error.empty())
+        {
+            std::cerr << items[iitem].layerfile << ": " << results[iitem].error << std::endl;
+            failed = true;
+            continue;
+        }
+
+        index.push_back(iitem + 1);
+        nst.push_back(results[iitem].nst);
+        E0.push_back(results[iitem].E0);
+    }
+
+    if(!index.empty())
+        write_table(opt.get_option<std::string>("summaryfile").c_str(), index, nst, E0);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
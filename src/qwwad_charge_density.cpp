@@ -117,30 +117,18 @@ int main(int argc, char* argv[])
     const arma::vec z_1per = z.subvec(0, nz_1per-1);
     const auto d_1per = d.subvec(0, nz_1per-1);
 
+    // Sheet density of carriers in each state, including degeneracy [m^{-2}]
+    const arma::vec N = data.pop.head(nst) % arma::conv_to<arma::vec>::from(data.nval.head(nst));
+
     // Find carrier density at each point in a single period
     // by summing the "tails" of wavefunctions in each period.
     // This implements the summation in [QWWAD4, 3.108]
     // [m^{-3}]
-    arma::vec carrier_density_1per = arma::zeros<arma::vec>(nz_1per);
-
-    for(unsigned int iper = 0; iper < nper; iper++)
-    {
-        for(unsigned int ist = 0; ist < nst; ist++)
-        {
-            // Find probability density function for carrier over the entire structure
-            const auto PD     = data.states[ist].get_PD();
-
-            // Grab the part of the PDF that lies in this period
-            const arma::vec PD_per = PD.subvec(iper*nz_1per, (iper+1)*nz_1per-1);
-
-            // Add this into the total carrier density profile
-            carrier_density_1per += data.pop[ist] * data.nval[ist] * PD_per;
-        }
-    }
+    const arma::vec carrier_density_1per = Eigenstate::get_carrier_density(data.states, N, nper);
 
     // Charge density is obtained by subtracting carrier density from doping density
     // [QWWAD4, 3.108]. Note q = -e by default (for electrons). [C m^{-3}]
-    arma::vec rho_1per = e*(d - carrier_density_1per);
+    arma::vec rho_1per = e*(d_1per - carrier_density_1per);
 
     // Invert charge profile if it's a p-type system
     if (opt.get_option<bool>("ptype"))
@@ -7,10 +7,13 @@
 #include <cstdlib>
 #include <cmath>
 #include <iostream>
+#include <limits>
+#include <sstream>
 #include <gsl/gsl_sf_lambert.h>
 #include "qwwad/constants.h"
 #include "qwwad/file-io.h"
 #include "qwwad/options.h"
+#include "qwwad/parallel.h"
 
 using namespace QWWAD;
 using namespace constants;
@@ -25,6 +28,11 @@ Options configure_options(int argc, char* argv[])
     std::string summary("Find the critical thickness of a thin film.");
 
     opt.add_option<double>("substrate", 0.0,     "Substrate alloy fraction [0 to 1]");
+    opt.add_option<std::string>("substratelist", "Comma-separated list of substrate alloy fractions. "
+                                                 "If specified, the critical thickness is found for "
+                                                 "every substrate and the substrate option is ignored.");
+    opt.add_option<size_t>("nx",        100,     "Number of layer alloy fractions, evenly spaced from 0");
+    opt.add_option<unsigned int>("threads", 0,   "Number of threads to use (0 = one per CPU core).");
     opt.add_option<double>("C110",      165.773, "Elastic constant C11 for alloy=0");
     opt.add_option<double>("C111",      128.528, "Elastic constant C11 for alloy=1");
     opt.add_option<double>("C120",       63.924, "Elastic constant C12 for alloy=0");
@@ -37,43 +45,155 @@ Options configure_options(int argc, char* argv[])
     return opt;
 }
 
-int main(int argc,char *argv[])
+/**
+ * \brief Elastic and lattice properties of a binary alloy
+ */
+struct AlloyParameters
 {
-    const auto opt = configure_options(argc, argv);
+    double C11_0; ///< Elastic constant C11 for alloy=0
+    double C11_1; ///< Elastic constant C11 for alloy=1
+    double C12_0; ///< Elastic constant C12 for alloy=0
+    double C12_1; ///< Elastic constant C12 for alloy=1
+    double a_0;   ///< Lattice constant for alloy=0
+    double a_1;   ///< Lattice constant for alloy=1
+};
 
-    const auto xs    = opt.get_option<double>("substrate");
-    const auto C11_0 = opt.get_option<double>("C110");
-    const auto C11_1 = opt.get_option<double>("C111");
-    const auto C12_0 = opt.get_option<double>("C120");
-    const auto C12_1 = opt.get_option<double>("C121");
-    const auto a_0   = opt.get_option<double>("a0");
-    const auto a_1   = opt.get_option<double>("a1");
-
-    const size_t nx = 100;
-
-    std::vector<double> x(nx);  // Array of energies
-    std::vector<double> hc(nx); // Array of critical thickness
+/**
+ * \brief Find the critical thickness for a set of layer compositions on one substrate
+ *
+ * \param[in]  prm Alloy parameters
+ * \param[in]  xs  Substrate alloy fraction
+ * \param[in]  x   Layer alloy fractions, in order
+ * \param[out] hc  Critical thickness for each layer
+ *
+ * \details The critical thickness is the larger root of \f$h = A\ln(Bh)\f$.  The
+ *          first root is found from the lower branch of the Lambert W function.
+ *          Each later root is then found by Newton iteration from the root at the
+ *          previous alloy fraction, which is usually only a few iterations away.
+ *          Unstrained layers have infinite critical thickness, and layers for
+ *          which no root exists are given zero thickness.
+ */
+static void find_critical_thickness(const AlloyParameters     &prm,
+                                    const double               xs,
+                                    const std::vector<double> &x,
+                                    std::vector<double>       &hc)
+{
+    const double a_subst = prm.a_0*(1.0-xs) + prm.a_1*xs;
+    double h_prev = 0.0; // Root at previous alloy fraction, or zero if none
 
-    const double a_subst = a_0*(1.0-xs) + a_1*xs;
+    hc.resize(x.size());
 
-    // Loop over alloy fraction
-    for(unsigned int ix = 0; ix < nx; ++ix)
+    for(unsigned int ix = 0; ix < x.size(); ++ix)
     {
-        x[ix] = ix/100.0;
-        const double C11 = C11_0*(1-x[ix]) + C11_1*x[ix];
-        const double C12 = C12_0*(1-x[ix]) + C12_1*x[ix];
-        const double a = a_0*(1-x[ix]) + a_1*x[ix];
+        const double C11 = prm.C11_0*(1-x[ix]) + prm.C11_1*x[ix];
+        const double C12 = prm.C12_0*(1-x[ix]) + prm.C12_1*x[ix];
+        const double a = prm.a_0*(1-x[ix]) + prm.a_1*x[ix];
         const double b = a/sqrt(2); // Magnitude of Burgers vector
         const double f = fabs(a - a_subst)/a_subst;
         const double nu = 2*C12/C11;
 
+        if(f == 0.0)
+        {
+            hc[ix] = std::numeric_limits<double>::infinity();
+            h_prev = 0.0;
+            continue;
+        }
+
         const double A = b/(2*pi*f) * (1-0.25*nu)/((1+nu)*0.5);
         const double B = exp(1)/b;
 
-        hc[ix] = -A * gsl_sf_lambert_Wm1(-1/(A*B));
+        // The smallest value of h - A ln(Bh) lies at h = A, so there is no
+        // root if it is positive there
+        if(A*B < exp(1))
+        {
+            hc[ix] = 0.0;
+            h_prev = 0.0;
+            continue;
+        }
+
+        double h = 0.0;
+
+        // Newton iteration from the previous root, as long as it lies on the
+        // correct side of the turning point
+        if(h_prev > A)
+        {
+            h = h_prev;
+
+            for(unsigned int iter = 0; iter < 50; ++iter)
+            {
+                const double dh = (h - A*log(B*h))/(1.0 - A/h);
+                h -= dh;
+
+                if(!(h > A))
+                    break;
+
+                if(fabs(dh) < 1e-12*h)
+                    break;
+            }
+        }
+
+        if(!(h > A))
+            h = -A * gsl_sf_lambert_Wm1(-1/(A*B));
+
+        hc[ix] = h;
+        h_prev = h;
     }
+}
 
-    write_table("hc.r", x, hc);
+int main(int argc,char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    AlloyParameters prm;
+    prm.C11_0 = opt.get_option<double>("C110");
+    prm.C11_1 = opt.get_option<double>("C111");
+    prm.C12_0 = opt.get_option<double>("C120");
+    prm.C12_1 = opt.get_option<double>("C121");
+    prm.a_0   = opt.get_option<double>("a0");
+    prm.a_1   = opt.get_option<double>("a1");
+
+    const auto nx = opt.get_option<size_t>("nx");
+
+    // Read the list of substrates
+    std::vector<double> xs;
+
+    if(opt.get_argument_known("substratelist"))
+        xs = opt.get_numeric_list("substratelist");
+    else
+        xs.push_back(opt.get_option<double>("substrate"));
+
+    std::vector<double> x(nx); // Array of alloy fractions
+
+    for(unsigned int ix = 0; ix < nx; ++ix)
+        x[ix] = ix/static_cast<double>(nx);
+
+    // Each substrate is independent, so share them between threads
+    std::vector< std::vector<double> > hc(xs.size()); // Critical thickness
+
+    run_in_parallel(xs.size(), opt.get_option<unsigned int>("threads"), [&](const size_t is) {
+        find_critical_thickness(prm, xs[is], x, hc[is]);
+    });
+
+    if(!opt.get_argument_known("substratelist"))
+        write_table("hc.r", x, hc[0]);
+    else
+    {
+        std::vector<double> xs_table;
+        std::vector<double> x_table;
+        std::vector<double> hc_table;
+
+        for(unsigned int is = 0; is < xs.size(); ++is)
+        {
+            for(unsigned int ix = 0; ix < nx; ++ix)
+            {
+                xs_table.push_back(xs[is]);
+                x_table.push_back(x[ix]);
+                hc_table.push_back(hc[is][ix]);
+            }
+        }
+
+        write_table("hc.r", xs_table, x_table, hc_table);
+    }
 
     return EXIT_SUCCESS;
 }
@@ -6,20 +6,31 @@
  *
  * \details This program generates the atomic positions of a single spiral
  *          along the z-axis of a zinc blende crystal and writes them in 
- *          XYZ format to the file zb.xyz
+ *          XYZ format to the file atoms.xyz
+ *
+ *          The spiral is generated in blocks of cells, which are shared
+ *          between threads and written in order.  A binary version of the
+ *          XYZ format (-b) avoids formatting the coordinates as text.
  */
 
+#include <algorithm>
 #include <cstdio>
 #include <cmath>
 #include <cstdlib>
+#include <string>
 #include "struct.h"
+#include "qwwad/xyz-writer.h"
+
+using namespace QWWAD;
 
 static void write_ap(const double A0,
                      const int    n_z,
                      vector       a,
                      vector       T[],
                      char         anion[],
-                     char         cation[]);
+                     char         cation[],
+                     const bool   binary,
+                     const unsigned int n_threads);
 
 int main(int argc,char *argv[])
 {
@@ -29,6 +40,8 @@ char	cation[12];	/* cation species				*/
 char	anion[12];	/* anion species				*/
 vector	a;		/* lattice vectors 				*/
 vector	T[4];		/* basis vectors				*/
+bool	binary;		/* write binary XYZ file			*/
+unsigned int n_threads;	/* number of threads (0 = one per CPU core)	*/
 
 /* default values	*/
 
@@ -36,6 +49,8 @@ n_z=1;
 A0=5.65;		/* break all the rules and keep in Angstrom	*/
 sprintf(cation,"GA");
 sprintf(anion,"AS");
+binary=false;
+n_threads=0;
 
 while((argc>1)&&(argv[1][0]=='-'))
 {
@@ -53,9 +68,18 @@ while((argc>1)&&(argv[1][0]=='-'))
   case 'z':
            n_z=atoi(argv[2]);
            break;
+  case 'b':
+           binary=true;
+           argv--;
+           argc++;
+           break;
+  case 't':
+           n_threads=atoi(argv[2]);
+           break;
   default :
 	   printf("Usage:  csss [-a anion \033[1mAS\033[0m][-c cation \033[1mGA\033[0m]\n");
 	   printf("             [-z # cells \033[1m1\033[0m][-A lattice constant (\033[1m5.65\033[0mA)]\n");
+	   printf("             [-b write binary XYZ file][-t # threads \033[1m0\033[0m (one per CPU core)]\n");
 	   exit(0);
  }
  argv++;
@@ -71,55 +95,48 @@ T[1].x=+1.0/8;T[1].y=+1.0/8;T[1].z=+1.0/8;
 T[2].x=-1.0/8;T[2].y=+3.0/8;T[2].z=+3.0/8;
 T[3].x=-3.0/8;T[3].y=+1.0/8;T[3].z=+5.0/8;
 
-write_ap(A0,n_z,a,T,anion,cation);
+write_ap(A0,n_z,a,T,anion,cation,binary,n_threads);
 return EXIT_SUCCESS;
 }/* end main */
 
 /**
- * \param A0     lattice constant
- * \param n_z    number of lattice points along z-axis of cell
- * \param a      lattice vectors (a1, a2, a3 plus null vector)
- * \param T      basis vector
- * \param anion  anion species
- * \param cation cation species
+ * \param A0        lattice constant
+ * \param n_z       number of lattice points along z-axis of cell
+ * \param a         lattice vectors (a1, a2, a3 plus null vector)
+ * \param T         basis vector
+ * \param anion     anion species
+ * \param cation    cation species
+ * \param binary    write binary XYZ file
+ * \param n_threads number of blocks to generate at once (0 = one per CPU core)
  */
 static void write_ap(const double A0,
                      const int    n_z,
                      vector       a,
                      vector       T[],
                      char         anion[],
-                     char         cation[])
+                     char         cation[],
+                     const bool   binary,
+                     const unsigned int n_threads)
 {
- int    i_n_z;  /* index to n_z */
- vector t;      /* general vector representing atom within cell  */
- FILE	*Fap;	/* pointer to output file	*/
-
- Fap=fopen("atoms.xyz","w");
-
- /* Write number of atoms to first line of file, then leave blank line	*/
-
- fprintf(Fap,"%i\n\n",4*n_z);
-
- for(i_n_z=0;i_n_z<n_z;i_n_z++)
- {
-  t.x=T[0].x;
-  t.y=T[0].y;
-  t.z=i_n_z*a.z+T[0].z;
-  fprintf(Fap,"%s %9.3f %9.3f %9.3f\n",cation,t.x*A0,t.y*A0,t.z*A0);
-  t.x=T[1].x;
-  t.y=T[1].y;
-  t.z=i_n_z*a.z+T[1].z;
-  fprintf(Fap,"%s %9.3f %9.3f %9.3f\n",anion,t.x*A0,t.y*A0,t.z*A0);
-  t.x=T[2].x;
-  t.y=T[2].y;
-  t.z=i_n_z*a.z+T[2].z;
-  fprintf(Fap,"%s %9.3f %9.3f %9.3f\n",cation,t.x*A0,t.y*A0,t.z*A0);
-  t.x=T[3].x;
-  t.y=T[3].y;
-  t.z=i_n_z*a.z+T[3].z;
-  fprintf(Fap,"%s %9.3f %9.3f %9.3f\n",anion,t.x*A0,t.y*A0,t.z*A0);
- }
-
- fclose(Fap);
+ const int n_block=1024; /* number of cells in each block written at once */
+ const char *species[4]={cation,anion,cation,anion};
+
+ XYZWriter writer("atoms.xyz", (size_t)4*n_z, binary);
+
+ writer.write_slabs((n_z+n_block-1)/n_block, n_threads, [&](const size_t i_block, std::string &buffer) {
+  const int i_n_z_min=i_block*n_block;
+  const int i_n_z_max=std::min(n_z, i_n_z_min+n_block);
+
+  for(int i_n_z=i_n_z_min;i_n_z<i_n_z_max;i_n_z++)
+  {
+   for(int i_T=0;i_T<4;i_T++)
+   {
+    vector t;      /* general vector representing atom within cell  */
+    t.x=T[i_T].x;
+    t.y=T[i_T].y;
+    t.z=i_n_z*a.z+T[i_T].z;
+    writer.add_atom(buffer,species[i_T],t.x*A0,t.y*A0,t.z*A0);
+   }
+  }
+ });
 }
-
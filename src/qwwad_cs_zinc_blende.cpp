@@ -6,11 +6,20 @@
  *
  * \details This program generates the atomic positions of a zinc blende 
  *          crystal and writes them in XYZ format to the file atoms.xyz
+ *
+ *          The crystal is generated in columns of cells along the z-axis,
+ *          which are shared between threads and written in order, so very large
+ *          supercells are never held in memory.  A binary version of the
+ *          XYZ format (-b) avoids formatting the coordinates as text.
  */
 
 #include <cstdio>
 #include <cmath>
 #include <cstdlib>
+#include <string>
+#include "qwwad/xyz-writer.h"
+
+using namespace QWWAD;
 
 typedef struct
 {
@@ -26,7 +35,9 @@ static void write_ap(double A0,
                      vector a[],
                      vector T[],
                      char   anion[],
-                     char   cation[]);
+                     char   cation[],
+                     bool   binary,
+                     unsigned int n_threads);
 
 int main(int argc,char *argv[])
 {
@@ -38,6 +49,8 @@ char	cation[12];	/* cation species				*/
 char	anion[12];	/* anion species				*/
 vector	a[4];		/* lattice vectors (a1, a2, a3 plus null vector)*/
 vector	T[2];		/* basis vector					*/
+bool	binary;		/* write binary XYZ file			*/
+unsigned int n_threads;	/* number of threads (0 = one per CPU core)	*/
 
 /* default values	*/
 
@@ -45,6 +58,8 @@ n_x=1;n_y=1;n_z=1;
 A0=5.65;		/* break all the rules and keep in Angstrom	*/
 sprintf(cation,"GA");
 sprintf(anion,"AS");
+binary=false;
+n_threads=0;
 
 while((argc>1)&&(argv[1][0]=='-'))
 {
@@ -68,10 +83,19 @@ while((argc>1)&&(argv[1][0]=='-'))
   case 'z':
            n_z=atoi(argv[2]);
            break;
+  case 'b':
+           binary=true;
+           argv--;
+           argc++;
+           break;
+  case 't':
+           n_threads=atoi(argv[2]);
+           break;
   default :
 	   printf("Usage:  cszb [-a anion \033[1mGA\033[0m][-c cation \033[1mAS\033[0m]\n");
 	   printf("             [-x # cells along x-axis \033[1m1\033[0m][-y # cells \033[1m1\033[0m][-z # cells \033[1m1\033[0m]\n");
 	   printf("             [-A lattice constant (\033[1m5.65\033[0mA)]\n");
+	   printf("             [-b write binary XYZ file][-t # threads \033[1m0\033[0m (one per CPU core)]\n");
 	   exit(0);
  }
  argv++;
@@ -88,20 +112,22 @@ a[3].x=1.0/2;a[3].y=0;a[3].z=1.0/2;    /* ctor-called a[0]        */
 T[0].x=-1.0/8;T[0].y=-1.0/8;T[0].z=-1.0/8;
 T[1].x=+1.0/8;T[1].y=+1.0/8;T[1].z=+1.0/8;
 
-write_ap(A0,n_x,n_y,n_z,a,T,anion,cation);
+write_ap(A0,n_x,n_y,n_z,a,T,anion,cation,binary,n_threads);
 
 return EXIT_SUCCESS;
 }/* end main */
 
 /**
- * \param A0     lattice constant
- * \param n_x    number of lattice points along x-axis of cell
- * \param n_y    number of lattice points along y-axis of cell
- * \param n_z    number of lattice points along z-axis of cell
- * \param a      lattice vectors (a1, a2, a3 plus null vector)
- * \param T      basis vector
- * \param anion  anion species
- * \param cation cation species
+ * \param A0        lattice constant
+ * \param n_x       number of lattice points along x-axis of cell
+ * \param n_y       number of lattice points along y-axis of cell
+ * \param n_z       number of lattice points along z-axis of cell
+ * \param a         lattice vectors (a1, a2, a3 plus null vector)
+ * \param T         basis vector
+ * \param anion     anion species
+ * \param cation    cation species
+ * \param binary    write binary XYZ file
+ * \param n_threads number of slabs to generate at once (0 = one per CPU core)
  */
 static void write_ap(double A0,
                      int    n_x,
@@ -110,36 +136,31 @@ static void write_ap(double A0,
                      vector a[],
                      vector T[],
                      char   anion[],
-                     char   cation[])
+                     char   cation[],
+                     bool   binary,
+                     unsigned int n_threads)
 {
- int    i_a;    /* index across primitive vectors `a' */
- int    i_n_x;  /* index to n_x */
- int    i_n_y;  /* index to n_y */
- int    i_n_z;  /* index to n_z */
- vector t;      /* general vertor representing atom within cell  */
- FILE	*Fap;	/* pointer to output file	*/
+ XYZWriter writer("atoms.xyz", (size_t)8*n_x*n_y*n_z, binary);
 
- Fap=fopen("atoms.xyz","w");
+ /* Each slab holds a column of cells along z, with a given i_n_x and i_n_y,
+    so that the atoms are written in the same order as a simple loop	*/
+ writer.write_slabs(n_x*n_y, n_threads, [&](const size_t i_slab, std::string &buffer) {
+  const int i_n_x = i_slab/n_y;
+  const int i_n_y = i_slab%n_y;
+  buffer.reserve(8*n_z*48);
 
- /* Write number of atoms to first line of file, then leave blank line	*/
-
- fprintf(Fap,"%i\n\n",8*n_x*n_y*n_z);
-
- for(i_n_x=0;i_n_x<n_x;i_n_x++)
-  for(i_n_y=0;i_n_y<n_y;i_n_y++)
-   for(i_n_z=0;i_n_z<n_z;i_n_z++)
-    for(i_a=0;i_a<=3;i_a++)
+   for(int i_n_z=0;i_n_z<n_z;i_n_z++)
+    for(int i_a=0;i_a<=3;i_a++)
      {
+      vector t;      /* general vector representing atom within cell  */
       t.x=i_n_x+a[i_a].x+T[0].x;
       t.y=i_n_y+a[i_a].y+T[0].y;
       t.z=i_n_z+a[i_a].z+T[0].z;
-      fprintf(Fap,"%s %9.3f %9.3f %9.3f\n",cation,t.x*A0,t.y*A0,t.z*A0);
+      writer.add_atom(buffer,cation,t.x*A0,t.y*A0,t.z*A0);
       t.x=i_n_x+a[i_a].x+T[1].x;
       t.y=i_n_y+a[i_a].y+T[1].y;
       t.z=i_n_z+a[i_a].z+T[1].z;
-      fprintf(Fap,"%s %9.3f %9.3f %9.3f\n",anion,t.x*A0,t.y*A0,t.z*A0);
+      writer.add_atom(buffer,anion,t.x*A0,t.y*A0,t.z*A0);
      }
-
- fclose(Fap);
+ });
 }
-
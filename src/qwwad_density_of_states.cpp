@@ -61,27 +61,25 @@ int main(int argc,char *argv[])
         E = read_E(p); // read in subband minima [J]
 
     std::valarray<double> energy(n+1); // Energies at which dos is calculated [J]
-    std::valarray<double> dos(n+1);    // Density of states [J^{-1}m^{-n}]
+    std::valarray<double> dos;         // Density of states [J^{-1}m^{-n}]
 
     for(unsigned int ie=0;ie<=n;ie++)
-    {
         energy[ie] = ie*1e-3*e; // convert meV-> J
 
-        switch(ndim)
-        {
-            case 1:
-                dos[ie] = calculate_dos_1D(m, energy[ie], E);
-                break;
-            case 2:
-                dos[ie] = calculate_dos_2D(m, energy[ie], E, V, alpha);
-                break;
-            case 3:
-                dos[ie] = calculate_dos_3D(m, energy[ie], V, alpha);
-                break;
-            default:
-                std::cerr << "Only 1, 2 or 3 dimensions are permitted" << std::endl;
-                exit(EXIT_FAILURE);
-        }
+    switch(ndim)
+    {
+        case 1:
+            dos = calculate_dos_1D(m, energy, E);
+            break;
+        case 2:
+            dos = calculate_dos_2D(m, energy, E, V, alpha);
+            break;
+        case 3:
+            dos = calculate_dos_3D(m, energy, V, alpha);
+            break;
+        default:
+            std::cerr << "Only 1, 2 or 3 dimensions are permitted" << std::endl;
+            exit(EXIT_FAILURE);
     }
 
     const std::valarray<double> E_out = 1000.0*energy/e;
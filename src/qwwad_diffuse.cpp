@@ -7,35 +7,80 @@
  * \details Produces the general solution to the diffusion
  *          equation:
  *          \f[
- *            \frac{\partial n}{\partial t} = 
+ *            \frac{\partial n}{\partial t} =
  *                \frac{\partial}{\partial x}
  *                D \frac{\partial n}{\partial x}
  *          \f]
  *
  *          for \f$n=n(x,t)\f$ and \f$D=D(x,t,n)\f$.
  *
+ *          Either an explicit (FTCS) scheme or an implicit theta scheme
+ *          (backward Euler or Crank-Nicolson) can be used.  The implicit schemes
+ *          are stable for any time step.
+ *
+ *          Several diffusant profiles (e.g., different dopants) can be advanced
+ *          together through the same time steps, each with its own model for the
+ *          diffusion coefficient.  Profiles that share a model which does not
+ *          depend on concentration also share a single tridiagonal matrix, which
+ *          is factorised once and solved for all of them at the same time.
+ *
  *  Input files:
- *    x.r           initial (t=0) concentration profile versus z  
+ *    x.r           initial (t=0) concentration profiles versus z
  *
  *  Output files:
- *    X.r           final (diffused) concentration profile 
+ *    X.r           final (diffused) concentration profiles
+ *    X-t.r         concentration profiles at each snapshot time t
  */
 
+#include <algorithm>
 #include <iostream>
 #include <cstdlib>
-#include <valarray>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <vector>
 
 #include <gsl/gsl_math.h>
 
 #include "qwwad/file-io.h"
+#include "qwwad/linear-algebra.h"
 #include "qwwad/options.h"
 
 using namespace QWWAD;
 
-static void diffuse(const std::valarray<double> &z,
-                    std::valarray<double>       &x,
-                    const std::valarray<double> &D,
-                    const double                delta_t);
+/**
+ * \brief Model for the diffusion coefficient
+ *
+ * \details Any part of the coefficient that depends only on position is found
+ *          once, so that no new arrays are needed at each time step.
+ */
+class DiffusionCoefficient
+{
+private:
+    /// Form of the diffusion coefficient
+    enum Mode {
+        CONSTANT,      ///< Constant value
+        CONCENTRATION, ///< Proportional to square of concentration
+        DEPTH,         ///< Gaussian function of depth
+        TIME           ///< Gaussian function of depth, decaying with time
+    };
+
+    Mode      _mode;
+    double    _D0;      ///< Constant diffusion coefficient [m^2/s]
+    arma::vec _D_depth; ///< Depth-dependent distribution [m^2/s]
+
+public:
+    DiffusionCoefficient(const std::string &mode,
+                         const double       D0,
+                         const arma::vec   &z);
+
+    void find(const double *x,
+              const double  t,
+              arma::vec    &D) const;
+
+    /// Return true if the coefficient depends on the concentration
+    bool depends_on_concentration() const {return _mode == CONCENTRATION;}
+};
 
 static void check_stability(const double dt,
                             const double dz,
@@ -52,6 +97,95 @@ static void check_stability(const double dt,
     }
 }
 
+/**
+ * \brief Time-stepping scheme for the diffusion equation
+ *
+ * \details The scheme advances a set of profiles that share the same diffusion
+ *          coefficient, which are stored as the columns of a matrix.  All the
+ *          work arrays are allocated once, so that no memory is allocated while
+ *          stepping.
+ */
+class DiffusionSolver
+{
+private:
+    double               _dz;         ///< Spatial step [m]
+    double               _theta;      ///< Weighting of the new time step (0 = explicit)
+    DiffusionCoefficient _D_model;    ///< Model for the diffusion coefficient
+    double               _picard_tol; ///< Relative tolerance for Picard iteration
+    unsigned int         _picard_max; ///< Maximum number of Picard iterations
+
+    arma::vec            _D;          ///< Diffusion coefficient at start of step [m^2/s]
+    arma::vec            _D_new;      ///< Diffusion coefficient at end of step [m^2/s]
+    arma::mat            _X_new;      ///< Diffusant profiles at end of step
+    arma::mat            _RHS;        ///< Right-hand sides of implicit system
+    arma::mat            _X_solved;   ///< Solutions of implicit system
+    arma::vec            _LHS_sub;    ///< Subdiagonal of implicit system
+    arma::vec            _LHS_diag;   ///< Diagonal of implicit system
+    arma::vec            _LHS_super;  ///< Superdiagonal of implicit system
+    TridiagFactorisation _LHS;        ///< Factorised implicit system
+
+    void step_explicit(arma::mat    &X,
+                       const double  t_new,
+                       const double  delta_t);
+
+    void step_implicit(arma::mat    &X,
+                       const double  t,
+                       const double  delta_t);
+
+public:
+    DiffusionSolver(const double                dz,
+                    const size_t                nz,
+                    const size_t                nspecies,
+                    const double                theta,
+                    const DiffusionCoefficient &D_model,
+                    const double                picard_tol,
+                    const unsigned int          picard_max);
+
+    void step(arma::mat    &X,
+              const double  t,
+              const double  delta_t);
+
+    double get_dt_stable(const arma::mat &X,
+                         const double     t);
+
+    /// Return the order of accuracy of the scheme in time
+    unsigned int get_order() const {return (_theta == 0.5) ? 2 : 1;}
+
+    /// Return true if the scheme is only stable for short time steps
+    bool is_explicit() const {return _theta == 0.0;}
+};
+
+/// A set of diffusant profiles that share the same diffusion coefficient
+struct SpeciesGroup
+{
+    DiffusionSolver     solver;  ///< Time-stepping scheme for the group
+    std::vector<size_t> species; ///< Column of each profile in the combined table
+    arma::mat           X;       ///< Diffusant profiles, with one column for each species
+};
+
+static void read_profiles(const std::string      &fname,
+                          std::vector<double>    &z,
+                          std::vector<arma::vec> &profiles);
+
+static void take_adaptive_step(std::vector<SpeciesGroup> &groups,
+                               double                    &t,
+                               double                    &h,
+                               const double               t_stop,
+                               const double               tol,
+                               std::vector<arma::mat>    &X_full,
+                               std::vector<arma::mat>    &X_half);
+
+static void write_profiles(const std::string               &outfile,
+                           const std::vector<double>       &z,
+                           const std::vector<SpeciesGroup> &groups,
+                           const size_t                     nspecies);
+
+static void write_snapshot(const std::string               &outfile,
+                           const double                     t,
+                           const std::vector<double>       &z,
+                           const std::vector<SpeciesGroup> &groups,
+                           const size_t                     nspecies);
+
 int main(int argc,char *argv[])
 {
     Options opt;
@@ -59,112 +193,685 @@ int main(int argc,char *argv[])
 
     opt.add_option<double>     ("dt,d",          0.01, "Time-step [s]");
     opt.add_option<double>     ("coeff,D",        1.0, "Diffusion coefficient [Angstrom^2/s]");
+    opt.add_option<std::string>("coeffs",          "", "Comma-separated list of diffusion coefficients for each "
+                                                       "profile [Angstrom^2/s].  The --coeff value is used if this "
+                                                       "is empty.");
     opt.add_option<double>     ("time,t",         1.0, "End time for simulation [s]");
-    opt.add_option<std::string>("mode,a",  "constant", "Form of diffusion coefficient");
-    opt.add_option<std::string>("infile",       "x.r", "File from which input profile of diffusant will be read");
+    opt.add_option<std::string>("mode,a",  "constant", "Form of diffusion coefficient.  A comma-separated list sets "
+                                                       "the form for each profile.");
+    opt.add_option<std::string>("infile",       "x.r", "Comma-separated list of files from which input profiles of "
+                                                       "diffusant will be read");
     opt.add_option<std::string>("outfile",      "X.r", "File to which output profile of diffusant will be written");
+    opt.add_option<std::string>("scheme,s", "explicit", "Time-stepping scheme: explicit, implicit or crank-nicolson");
+    opt.add_option<double>     ("picardtol",     1e-8, "Relative tolerance for Picard iteration of a "
+                                                       "concentration-dependent coefficient");
+    opt.add_option<size_t>     ("picardmax",       50, "Maximum number of Picard iterations per time step");
+    opt.add_option<double>     ("tol",            0.0, "Relative local error tolerance for adaptive time steps. "
+                                                       "The --dt option then sets the first step (0 = fixed steps).");
+    opt.add_option<std::string>("snapshots",       "", "Comma-separated list of times [s] at which to write the "
+                                                       "profile");
 
     opt.add_prog_specific_options_and_parse(argc, argv, doc);
 
     const auto t_final = opt.get_option<double>("time");          // [s]
     const auto dt      = opt.get_option<double>("dt");            // [s]
-    const auto D0      = opt.get_option<double>("coeff") * 1e-20; // [m^2/s]
-    const auto mode    = opt.get_option<std::string>("mode");
+    const auto tol     = opt.get_option<double>("tol");
+    const auto outfile = opt.get_option<std::string>("outfile");
+
+    std::vector<double>    z;        // Spatial location [m]
+    std::vector<arma::vec> profiles; // Initial profile of each diffusant species
 
-    std::valarray<double> z; // Spatial location [m]
-    std::valarray<double> x; // Initial diffusant profile
-    read_table(opt.get_option<std::string>("infile").c_str(), z, x);
+    try
+    {
+        for(const auto &infile : opt.get_list("infile"))
+        {
+            std::vector<double>    z_file;
+            std::vector<arma::vec> profiles_file;
+            read_profiles(infile, z_file, profiles_file);
+
+            if(z.empty())
+                z = z_file;
+            else if(z_file.size() != z.size() or
+                    !std::equal(z.begin(), z.end(), z_file.begin(),
+                                [&z](const double a, const double b) {
+                                    return std::abs(a - b) <= 1e-9*std::abs(z.back() - z.front());
+                                }))
+            {
+                std::ostringstream oss;
+                oss << "The spatial points in " << infile << " do not match those in the first input file.";
+                throw std::runtime_error(oss.str());
+            }
+
+            profiles.insert(profiles.end(), profiles_file.begin(), profiles_file.end());
+        }
+    }
+    catch(std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    const size_t nz       = z.size(); // Number of spatial points
+    const size_t nspecies = profiles.size();
+
+    if(nz < 3 or nspecies == 0)
+    {
+        std::cerr << "At least three spatial points and one profile are needed." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    const double dz = z[1] - z[0];
+
+    // Find the model for the diffusion coefficient of each species.  A single
+    // value applies to every species.
+    auto modes = opt.get_list("mode");
+    auto D0s   = std::vector<double>(1, opt.get_option<double>("coeff"));
+
+    const auto coeffs = opt.get_numeric_list("coeffs");
+
+    if(!coeffs.empty())
+        D0s = coeffs;
 
-    const size_t nz = z.size(); // Number of spatial points
+    if(modes.size() == 1)
+        modes.resize(nspecies, modes[0]);
 
-    std::valarray<double> D(nz); // Diffusion coefficient
+    if(D0s.size() == 1)
+        D0s.resize(nspecies, D0s[0]);
 
-    for(double t=dt; t<=t_final; t+=dt)
+    if(modes.size() != nspecies or D0s.size() != nspecies)
     {
-        if (mode == "constant")
+        std::cerr << "Got " << modes.size() << " diffusion modes and " << D0s.size() << " coefficients for "
+                  << nspecies << " profiles." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Weighting of the new time step in the implicit schemes
+    const auto scheme = opt.get_option<std::string>("scheme");
+    double theta = 0.0;
+
+    if(scheme == "implicit")
+        theta = 1.0;
+    else if(scheme == "crank-nicolson")
+        theta = 0.5;
+    else if(scheme != "explicit")
+    {
+        std::cerr << "Time-stepping scheme: " << scheme << " not recognised" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Read the list of snapshot times
+    auto snapshots = opt.get_numeric_list("snapshots");
+
+    std::sort(snapshots.begin(), snapshots.end());
+
+    // Group together the species that can share a matrix.  A coefficient that
+    // depends on concentration is different for every profile.
+    const arma::vec z_vec(z);
+    std::vector<std::vector<size_t>> group_species;
+
+    for(size_t is = 0; is < nspecies; ++is)
+    {
+        bool found = false;
+
+        if(modes[is] != "concentration-dependent")
+        {
+            for(auto &members : group_species)
+            {
+                const auto i0 = members.front();
+
+                if(modes[i0] == modes[is] and D0s[i0] == D0s[is])
+                {
+                    members.push_back(is);
+                    found = true;
+                    break;
+                }
+            }
+        }
+
+        if(!found)
+            group_species.push_back(std::vector<size_t>(1, is));
+    }
+
+    std::vector<SpeciesGroup> groups;
+
+    for(const auto &members : group_species)
+    {
+        const auto                 i0 = members.front();
+        const DiffusionCoefficient D_model(modes[i0], D0s[i0] * 1e-20, z_vec);
+        const DiffusionSolver      solver(dz, nz, members.size(), theta, D_model,
+                                          opt.get_option<double>("picardtol"),
+                                          opt.get_option<size_t>("picardmax"));
+
+        arma::mat X(nz, members.size());
+
+        for(size_t ic = 0; ic < members.size(); ++ic)
+            X.col(ic) = profiles[members[ic]];
+
+        groups.push_back({solver, members, X});
+    }
+
+    if(opt.get_verbose())
+        std::cout << "Advancing " << nspecies << " profiles with " << groups.size()
+                  << " distinct diffusion matrices." << std::endl;
+
+    // Work space for the adaptive time step
+    std::vector<arma::mat> X_full(groups.size());
+    std::vector<arma::mat> X_half(groups.size());
+
+    const double t_eps   = 1e-12*t_final; // Allowance for rounding error in time [s]
+    double       t       = 0.0;           // Time [s]
+    double       h       = dt;            // Length of next adaptive time step [s]
+    size_t       n_steps = 0;             // Number of time steps taken
+    size_t       i_snap  = 0;             // Index of next snapshot
+
+    for(;;)
+    {
+        // Write any snapshots that have been reached
+        while(i_snap < snapshots.size() and snapshots[i_snap] <= t + t_eps)
         {
-            D = D0;	// set constant diffusion coeff.
+            write_snapshot(outfile, snapshots[i_snap], z, groups, nspecies);
+            ++i_snap;
         }
-        else if(mode == "concentration-dependent")
+
+        if(t >= t_final - t_eps)
+            break;
+
+        // Land exactly on the next snapshot or the end of the simulation
+        double t_stop = t_final;
+
+        if(i_snap < snapshots.size())
+            t_stop = std::min(t_stop, snapshots[i_snap]);
+
+        if(tol > 0.0)
+            take_adaptive_step(groups, t, h, t_stop, tol, X_full, X_half);
+        else
+        {
+            const double h_step = std::min(dt, t_stop - t);
+
+            for(auto &group : groups)
+                group.solver.step(group.X, t, h_step);
+
+            t += h_step;
+        }
+
+        ++n_steps;
+    }
+
+    if(i_snap < snapshots.size())
+        std::cerr << "Warning: snapshots after t = " << t_final << " s were not written." << std::endl;
+
+    if(opt.get_verbose())
+        std::cout << "Reached t = " << t << " s in " << n_steps << " steps." << std::endl;
+
+    write_profiles(outfile, z, groups, nspecies);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Set up the model for the diffusion coefficient
+ *
+ * \param[in] mode The name of the model
+ * \param[in] D0   Diffusion coefficient for constant model [m^2/s]
+ * \param[in] z    Spatial location of each point [m]
+ */
+DiffusionCoefficient::DiffusionCoefficient(const std::string &mode,
+                                           const double       D0,
+                                           const arma::vec   &z) :
+    _mode(CONSTANT),
+    _D0(D0)
+{
+    if (mode == "constant")
+        _mode = CONSTANT;
+    else if(mode == "concentration-dependent")
+        _mode = CONCENTRATION;
+    else if(mode == "depth-dependent" or mode == "time-dependent")
+    {
+        _mode = (mode == "depth-dependent") ? DEPTH : TIME;
+
+        // TODO: Make this configurable
+        const double D0    = 10*1e-20;   // Magnitude of distribution [m^2/s]
+        const double z0    = 1800*1e-10; // Centre of diff. coeff. distribution [m]
+        const double sigma = 600*1e-10;  // Width of distribution [m]
+
+        // Find depth-dependent diffusion coefficient
+        // [4.16, QWWAD4]
+        _D_depth = D0*arma::exp(-arma::square((z-z0)/sigma)/2);
+    }
+    else
+    {
+        std::cerr << "Diffusion mode: " << mode << " not recognised" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * \brief Find the diffusion coefficient at each point
+ *
+ * \param[in]  x Diffusant profile, with the same number of points as D.  This
+ *               is only used if the coefficient depends on concentration.
+ * \param[in]  t Time [s]
+ * \param[out] D Diffusion coefficient at each point [m^2/s].  This must already
+ *               be the same size as the profile.
+ */
+void DiffusionCoefficient::find(const double *x,
+                                const double  t,
+                                arma::vec    &D) const
+{
+    switch(_mode)
+    {
+        case CONSTANT:
+            D.fill(_D0); // set constant diffusion coeff.
+            break;
+        case CONCENTRATION:
         {
             // TODO: Make this configurable
             const double k = 1e-20; // Concentration factor [m^2/s]
 
             // Find concentration-dependent diffusion coefficient
             // [4.14, QWWAD4]
-            D = k*x*x;
-        }
-        else if(mode == "depth-dependent")
-        {
-            // TODO: Make this configurable
-            const double D0    = 10*1e-20;   // Magnitude of distribution [m^2/s]
-            const double z0    = 1800*1e-10; // Centre of diff. coeff. distribution [m]
-            const double sigma = 600*1e-10;  // Width of distribution [m]
+            for(unsigned int iz = 0; iz < D.size(); ++iz)
+                D[iz] = k*x[iz]*x[iz];
 
-            // Find depth-dependent diffusion coefficient
-            // [4.16, QWWAD4]
-            D = D0*exp(-pow((z-z0)/sigma, 2)/2);
+            break;
         }
-        else if(mode == "time-dependent")
+        case DEPTH:
+            D = _D_depth;
+            break;
+        case TIME:
         {
             // TODO: Make this configurable
-            const double D0    = 10*1e-20;   // Magnitude of distribution [m^2/s]
-            const double z0    = 1800*1e-10; // Centre of diff. coeff. distribution [m]
-            const double sigma = 600*1e-10;  // Width of distribution [m]
-            const double tau   = 100;        // Decay time-constant for diffusion [s]
+            const double tau = 100; // Decay time-constant for diffusion [s]
 
             // Find time and depth-dependent diffusion coefficient
             // [4.18, QWWAD4]
-            D = D0*exp(-pow((z-z0)/sigma, 2)/2)*exp(-t/tau);
+            const double decay = exp(-t/tau);
+
+            for(unsigned int iz = 0; iz < D.size(); ++iz)
+                D[iz] = _D_depth[iz]*decay;
+
+            break;
         }
-        else
+    }
+}
+
+/**
+ * \brief Set up the time-stepping scheme
+ *
+ * \param[in] dz         Spatial step [m]
+ * \param[in] nz         Number of spatial points
+ * \param[in] nspecies   Number of profiles that are advanced together
+ * \param[in] theta      Weighting of the new time step (0 = explicit,
+ *                       0.5 = Crank-Nicolson, 1 = backward Euler)
+ * \param[in] D_model    Model for the diffusion coefficient.  If this depends
+ *                       on concentration, there must be only one profile.
+ * \param[in] picard_tol Relative tolerance for Picard iteration
+ * \param[in] picard_max Maximum number of Picard iterations
+ */
+DiffusionSolver::DiffusionSolver(const double                dz,
+                                 const size_t                nz,
+                                 const size_t                nspecies,
+                                 const double                theta,
+                                 const DiffusionCoefficient &D_model,
+                                 const double                picard_tol,
+                                 const unsigned int          picard_max) :
+    _dz(dz),
+    _theta(theta),
+    _D_model(D_model),
+    _picard_tol(picard_tol),
+    _picard_max(picard_max),
+    _D(nz),
+    _D_new(nz),
+    _X_new(nz, nspecies),
+    _RHS(arma::zeros(nz, nspecies)),
+    _X_solved(arma::zeros(nz, nspecies)),
+    _LHS_sub(arma::zeros(nz-1)),
+    _LHS_diag(arma::zeros(nz)),
+    _LHS_super(arma::zeros(nz-1))
+{
+    if(nspecies > 1 and D_model.depends_on_concentration())
+    {
+        std::cerr << "A concentration-dependent diffusion coefficient cannot be shared between profiles." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Impose `closed-system' boundary conditions, x[0] = x[1] and
+    // x[nz-1] = x[nz-2]. See section 4.3, QWWAD3
+    _LHS_diag(0)    =  1.0;
+    _LHS_super(0)   = -1.0;
+    _LHS_sub(nz-2)  = -1.0;
+    _LHS_diag(nz-1) =  1.0;
+}
+
+/**
+ * \brief Projects the diffusant profiles a time interval delta_t into the future
+ *
+ * \param[in,out] X       Diffusant profiles, with one column for each species
+ * \param[in]     t       Time at start of step [s]
+ * \param[in]     delta_t Time step [s]
+ */
+void DiffusionSolver::step(arma::mat    &X,
+                           const double  t,
+                           const double  delta_t)
+{
+    if(is_explicit())
+        step_explicit(X, t + delta_t, delta_t);
+    else
+        step_implicit(X, t, delta_t);
+}
+
+/**
+ * \brief Find the longest stable time step
+ *
+ * \param[in] X Diffusant profiles
+ * \param[in] t Time [s]
+ *
+ * \returns The longest stable time step for the explicit scheme [s].  The
+ *          implicit schemes are always stable, so infinity is returned.
+ */
+double DiffusionSolver::get_dt_stable(const arma::mat &X,
+                                      const double     t)
+{
+    if(!is_explicit())
+        return GSL_POSINF;
+
+    _D_model.find(X.colptr(0), t, _D);
+    return _dz*_dz/(2*_D.max());
+}
+
+/**
+ * Projects the diffusant profiles a short time interval delta_t into the future
+ * using the explicit (FTCS) scheme
+ *
+ * \param[in,out] X        diffusant profiles
+ * \param[in]     t_new    time at end of step [s]
+ * \param[in]     delta_t  time step [s]
+ */
+void DiffusionSolver::step_explicit(arma::mat    &X,
+                                    const double  t_new,
+                                    const double  delta_t)
+{
+    const size_t nz = X.n_rows;
+
+    _D_model.find(X.colptr(0), t_new, _D);
+    check_stability(delta_t, _dz, _D.max());
+
+    for(unsigned int ic = 0; ic < X.n_cols; ++ic)
+    {
+        const double *x     = X.colptr(ic);
+        double       *x_new = _X_new.colptr(ic);
+
+        for(unsigned int iz=1; iz<nz-1; ++iz)
         {
-            std::cerr << "Diffusion mode: " << mode << " not recognised" << std::endl;
-            exit(EXIT_FAILURE);
+            x_new[iz]=delta_t*
+                (
+                 (_D[iz+1]-_D[iz-1]) * (x[iz+1]-x[iz-1])/gsl_pow_2(2*_dz)
+                 +_D[iz] * (x[iz+1]-2*x[iz]+x[iz-1])/gsl_pow_2(_dz)
+                )
+                + x[iz];
         }
 
-        diffuse(z, x, D, dt);
+        /* Impose `closed-system' boundary conditions. See section 4.3, QWWAD3 */
+        x_new[0]    = x_new[1];
+        x_new[nz-1] = x_new[nz-2];
     }
 
-    write_table(opt.get_option<std::string>("outfile").c_str(), z, x);
+    X = _X_new; // Copy new profiles
+}
 
-    return EXIT_SUCCESS;
+/**
+ * \brief Projects the diffusant profiles a time interval delta_t into the future
+ *        using an implicit scheme
+ *
+ * \param[in,out] X       Diffusant profiles
+ * \param[in]     t       Time at start of step [s]
+ * \param[in]     delta_t Time step [s]
+ *
+ * \details The equation is written in conservative form, with the diffusion
+ *          coefficient averaged at the midpoint between neighbouring points,
+ *          which gives a diagonally-dominant tridiagonal system.  The matrix
+ *          is factorised once and solved for every profile together.  If the
+ *          coefficient depends on concentration, it is found from the latest
+ *          estimate of the new profile and the system is solved again until the
+ *          profile stops changing.
+ */
+void DiffusionSolver::step_implicit(arma::mat    &X,
+                                    const double  t,
+                                    const double  delta_t)
+{
+    const size_t nz = X.n_rows;
+    const double r  = delta_t/(_dz*_dz);
+
+    // Explicit part of the step, which is found from the old profile
+    _D_model.find(X.colptr(0), t, _D);
+
+    for(unsigned int ic = 0; ic < X.n_cols; ++ic)
+    {
+        const double *x   = X.colptr(ic);
+        double       *RHS = _RHS.colptr(ic);
+
+        for(unsigned int iz=1; iz<nz-1; ++iz)
+        {
+            const double D_plus  = (_D[iz] + _D[iz+1])/2;
+            const double D_minus = (_D[iz] + _D[iz-1])/2;
+
+            RHS[iz] = x[iz] + (1.0 - _theta)*r*(D_plus *(x[iz+1] - x[iz])
+                                               - D_minus*(x[iz] - x[iz-1]));
+        }
+    }
+
+    _X_new = X;
+
+    for(unsigned int iter = 1; iter <= _picard_max; ++iter)
+    {
+        _D_model.find(_X_new.colptr(0), t + delta_t, _D_new);
+
+        for(unsigned int iz=1; iz<nz-1; ++iz)
+        {
+            const double D_plus  = (_D_new[iz] + _D_new[iz+1])/2;
+            const double D_minus = (_D_new[iz] + _D_new[iz-1])/2;
+
+            _LHS_sub(iz-1) = -_theta*r*D_minus;
+            _LHS_diag(iz)  = 1.0 + _theta*r*(D_plus + D_minus);
+            _LHS_super(iz) = -_theta*r*D_plus;
+        }
+
+        // The factorisation and the solution reuse their existing storage
+        _LHS.factorise(_LHS_sub, _LHS_diag, _LHS_super);
+        _X_solved = _RHS;
+        _LHS.solve_in_place(_X_solved);
+
+        // Find the change since the last estimate
+        const double change = arma::abs(_X_solved - _X_new).max();
+        _X_new = _X_solved;
+
+        if(!_D_model.depends_on_concentration() or change <= _picard_tol*arma::abs(_X_new).max())
+        {
+            X = _X_new;
+            return;
+        }
+    }
+
+    std::cerr << "Picard iteration did not converge at t = " << t + delta_t << " s. "
+              << "Try a smaller time step using the --dt option." << std::endl;
+    exit(EXIT_FAILURE);
 }
 
 /**
- * Projects the diffusant profile a short time interval delta_t into the future
+ * \brief Read a table that has any number of diffusant profiles
  *
- * \param[in]     z        spatial profile [m]
- * \param[in,out] x        diffusant profile
- * \param[in]     D        Diffusion coefficient at each point [m^2/s]
- * \param[in]     delta_t  time step [s]
+ * \param[in]  fname    Name of the file
+ * \param[out] z        Spatial location, from the first column [m]
+ * \param[out] profiles The profile in each of the remaining columns
+ *
+ * \details Every line must have the same number of columns.  As in read_table,
+ *          blank lines are skipped, and a table that was received through a pipe
+ *          is read from memory.
  */
-static void diffuse(const std::valarray<double> &z,
-                    std::valarray<double>       &x,
-                    const std::valarray<double> &D,
-                    const double                 delta_t)
+static void read_profiles(const std::string      &fname,
+                          std::vector<double>    &z,
+                          std::vector<arma::vec> &profiles)
+{
+    arma::mat table;
+    read_table(fname, table);
+
+    if(table.n_cols < 2)
+    {
+        std::ostringstream oss;
+        oss << fname << " must have at least two columns.";
+        throw std::runtime_error(oss.str());
+    }
+
+    z = arma::conv_to<std::vector<double>>::from(table.col(0));
+    profiles.clear();
+
+    for(size_t ip = 1; ip < table.n_cols; ++ip)
+        profiles.push_back(table.col(ip));
+}
+
+/**
+ * \brief Take one time step with error control
+ *
+ * \param[in,out] groups Groups of profiles, which are all advanced by one step
+ * \param[in,out] t      Time [s], which is advanced by one step
+ * \param[in,out] h      Trial step length [s], which is updated for the next step
+ * \param[in]     t_stop Time that the step must not pass [s]
+ * \param[in]     tol    Largest local error, relative to the peak of each profile
+ * \param[out]    X_full Work space for the profiles after a single full step
+ * \param[out]    X_half Work space for the profiles after two half steps
+ *
+ * \details The error is estimated by step doubling: the step is taken once at
+ *          full length and again as two half steps.  The step length grows as
+ *          the profiles flatten, and shrinks where any of them changes quickly.
+ *          The explicit scheme is also kept within its stability limit.
+ */
+static void take_adaptive_step(std::vector<SpeciesGroup> &groups,
+                               double                    &t,
+                               double                    &h,
+                               const double               t_stop,
+                               const double               tol,
+                               std::vector<arma::mat>    &X_full,
+                               std::vector<arma::mat>    &X_half)
+{
+    // The local error scales as h^(p+1) for a scheme of order p
+    const double exponent = 1.0/(groups.front().solver.get_order() + 1);
+    const double h_min    = 1e-12*t_stop; // Accept steps this short without checking the error
+    double       h_stable = GSL_POSINF;
+
+    for(auto &group : groups)
+        h_stable = std::min(h_stable, 0.9*group.solver.get_dt_stable(group.X, t));
+
+    for(;;)
+    {
+        const double h_try = std::min(std::min(h, h_stable), t_stop - t);
+
+        // Ratio of the error to the tolerance, for the worst profile
+        double worst = 0.0;
+
+        for(size_t ig = 0; ig < groups.size(); ++ig)
+        {
+            auto &group = groups[ig];
+
+            X_full[ig] = group.X;
+            group.solver.step(X_full[ig], t, h_try);
+
+            X_half[ig] = group.X;
+            group.solver.step(X_half[ig], t,             h_try/2.0);
+            group.solver.step(X_half[ig], t + h_try/2.0, h_try/2.0);
+
+            for(unsigned int ic = 0; ic < group.X.n_cols; ++ic)
+            {
+                const double err     = arma::abs(X_half[ig].col(ic) - X_full[ig].col(ic)).max();
+                const double err_max = tol*arma::abs(X_half[ig].col(ic)).max();
+
+                if(err > 0.0)
+                    worst = std::max(worst, (err_max > 0.0) ? err/err_max : GSL_POSINF);
+            }
+        }
+
+        // Scale the step towards the error tolerance, but do not change it too quickly
+        double factor = (worst > 0.0) ? 0.9*pow(1.0/worst, exponent) : 2.0;
+        factor = std::min(2.0, std::max(0.2, factor));
+
+        if(worst <= 1.0 or h_try <= h_min)
+        {
+            for(size_t ig = 0; ig < groups.size(); ++ig)
+                groups[ig].X = X_half[ig];
+
+            t += h_try;
+
+            // A step that was cut short to land on a snapshot or to stay stable
+            // says nothing about the next step, so the trial length is kept
+            if(h_try >= h)
+                h = h_try*factor;
+            return;
+        }
+
+        h = h_try*factor;
+    }
+}
+
+/**
+ * \brief Write all the diffusant profiles to a single table
+ *
+ * \param[in] outfile  Name of the output file
+ * \param[in] z        Spatial location [m]
+ * \param[in] groups   Groups of profiles
+ * \param[in] nspecies Total number of profiles
+ *
+ * \details The first column is the spatial location, and it is followed by a
+ *          column for each profile in the same order as the input.
+ */
+static void write_profiles(const std::string               &outfile,
+                           const std::vector<double>       &z,
+                           const std::vector<SpeciesGroup> &groups,
+                           const size_t                     nspecies)
 {
-    const double dz = z[1] - z[0];
     const size_t nz = z.size();
+    arma::mat    X(nz, nspecies);
 
-    check_stability(delta_t, dz, D.max());
+    for(const auto &group : groups)
+    {
+        for(size_t ic = 0; ic < group.species.size(); ++ic)
+            X.col(group.species[ic]) = group.X.col(ic);
+    }
 
-    std::valarray<double> x_new(nz); // Modified diffusion profile
+    TableWriter stream(outfile, 12, true);
 
-    for(unsigned int iz=1; iz<nz-1; ++iz)
+    for(size_t iz = 0; iz < nz; ++iz)
     {
-        x_new[iz]=delta_t*
-            (
-             (D[iz+1]-D[iz-1]) * (x[iz+1]-x[iz-1])/gsl_pow_2(2*dz)
-             +D[iz] * (x[iz+1]-2*x[iz]+x[iz-1])/gsl_pow_2(dz)
-            )
-            + x[iz];
+        stream << z[iz];
+
+        for(size_t is = 0; is < nspecies; ++is)
+            stream << '\t' << X(iz, is);
+
+        stream << '\n';
     }
+}
+
+/**
+ * \brief Write the diffusant profiles at a snapshot time
+ *
+ * \param[in] outfile  Name of the final output file.  The snapshot file has the
+ *                     time in seconds inserted before its extension.
+ * \param[in] t        Time [s]
+ * \param[in] z        Spatial location [m]
+ * \param[in] groups   Groups of profiles
+ * \param[in] nspecies Total number of profiles
+ */
+static void write_snapshot(const std::string               &outfile,
+                           const double                     t,
+                           const std::vector<double>       &z,
+                           const std::vector<SpeciesGroup> &groups,
+                           const size_t                     nspecies)
+{
+    const size_t dot  = outfile.find_last_of('.');
+    const auto   stem = outfile.substr(0, dot);
+    const auto   ext  = (dot == std::string::npos) ? std::string() : outfile.substr(dot);
 
-    /* Impose `closed-system' boundary conditions. See section 4.3, QWWAD3 */
-    x_new[0]    = x_new[1];
-    x_new[nz-1] = x_new[nz-2];
+    char t_str[32];
+    snprintf(t_str, sizeof(t_str), "%g", t);
 
-    x = x_new; // Copy new profile
+    write_profiles(stem + "-" + t_str + ext, z, groups, nspecies);
 }
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,137 @@
+/**
+ * \file   qwwad_ef_anticrossing.cpp
+ * \brief  Find anticrossings between states using an adaptive sweep of the applied field
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ *
+ * \details The states are found over a coarse grid of fields, and the grid is
+ *          refined only where the states cannot be matched between neighbouring
+ *          fields, or close to an avoided crossing.  This needs far fewer
+ *          solutions than a uniform grid that resolves the narrowest anticrossing.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "qwwad/anticrossing-sweep.h"
+#include "qwwad/constants.h"
+#include "qwwad/file-io.h"
+#include "qwwad/options.h"
+#include "qwwad/schroedinger-solver-tridiagonal.h"
+
+using namespace QWWAD;
+using namespace constants;
+
+/**
+ * \brief Configure command-line options for the program
+ */
+static Options configure_options(int argc, char* argv[])
+{
+    Options opt;
+
+    std::string doc("Find anticrossings between states, using a sweep of the applied field that is "
+                    "refined automatically around each anticrossing.");
+
+    opt.add_option<std::string> ("potentialfile",  "v_b.r", "Filename from which the band-edge potential profile [J] is read. "
+                                                            "This should not include the applied field.");
+    opt.add_option<std::string> ("massfile",         "m.r", "Filename from which the effective mass profile [kg] is read. "
+                                                            "This is only needed if you are not using constant effective "
+                                                            "mass.");
+    opt.add_option<double>      ("mass",                    "The constant effective mass to use across the entire structure. "
+                                                            "If unspecified, the mass profile will be read from file.");
+    opt.add_option<double>      ("Fmin",                 0, "Lowest applied field [kV/cm].");
+    opt.add_option<double>      ("Fmax",                10, "Highest applied field [kV/cm].");
+    opt.add_option<size_t>      ("nF",                  11, "Number of fields in the initial, uniform sweep.");
+    opt.add_option<size_t>      ("nst,s",                4, "Number of states to track.");
+    opt.add_option<double>      ("overlaptol",        0.95, "Smallest acceptable overlap between the same state at "
+                                                            "neighbouring fields.");
+    opt.add_option<double>      ("Etol",              0.01, "Tolerance in the minimum splitting at each anticrossing [meV].");
+    opt.add_option<double>      ("dFmin",            0.001, "Smallest step between fields [kV/cm].");
+    opt.add_option<size_t>      ("maxpoints",          500, "Largest number of fields at which to find the states.");
+    opt.add_option<unsigned int>("threads",              0, "Number of threads to use (0 = one per CPU core).");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, doc);
+
+    return opt;
+}
+
+int main(int argc, char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    arma::vec z;   // Spatial locations [m]
+    arma::vec V_b; // Band-edge potential profile [J]
+    read_table(opt.get_option<std::string>("potentialfile"), z, V_b);
+
+    const size_t nz = z.size();
+    arma::vec    m  = arma::zeros(nz); // Band-edge effective mass [kg]
+
+    if(opt.get_argument_known("mass"))
+        m += opt.get_option<double>("mass") * me;
+    else
+    {
+        arma::vec z_m;
+        read_table(opt.get_option<std::string>("massfile"), z_m, m);
+    }
+
+    const auto nst = opt.get_option<size_t>("nst");
+
+    // Find the states under an applied field F [V/m].  The electron potential
+    // falls along the structure, as in qwwad_poisson.
+    const arma::vec dz = z - z[0];
+    auto solve = [&](const double F) {
+        const arma::vec V = V_b - e*F*dz;
+        SchroedingerSolverTridiag se(m, V, z, nst);
+        return se.get_solutions();
+    };
+
+    try
+    {
+        AnticrossingSweep sweep(solve, nst);
+        sweep.set_overlap_tolerance(opt.get_option<double>("overlaptol"));
+        sweep.set_energy_tolerance(opt.get_option<double>("Etol") * e/1000);
+        sweep.set_min_step(opt.get_option<double>("dFmin") * 1e5);
+        sweep.set_max_points(opt.get_option<size_t>("maxpoints"));
+
+        const auto anticrossings = sweep.run(opt.get_option<double>("Fmin") * 1e5,
+                                             opt.get_option<double>("Fmax") * 1e5,
+                                             opt.get_option<size_t>("nF"),
+                                             opt.get_option<unsigned int>("threads"));
+
+        // Write the energy of each state at each field
+        TableWriter energies("E-F.r");
+
+        for(const auto &point : sweep.get_points())
+        {
+            energies << point.param/1e5;
+
+            for(unsigned int ist = 0; ist < nst; ++ist)
+                energies << '\t' << point.E[ist]*1000/e;
+
+            energies << '\n';
+        }
+
+        TableWriter anticrossing_stream("anticrossings.r");
+
+        for(const auto &anticrossing : anticrossings)
+        {
+            anticrossing_stream << anticrossing.lower+1       << '\t'
+                                << anticrossing.upper+1       << '\t'
+                                << anticrossing.param/1e5     << '\t'
+                                << anticrossing.dE_min*1000/e << '\n';
+        }
+
+        if(opt.get_verbose())
+        {
+            std::cout << "Found " << anticrossings.size() << " anticrossings using "
+                      << sweep.get_points().size() << " fields." << std::endl;
+        }
+    }
+    catch(std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -6,11 +6,12 @@
  */
 
 #include <iostream>
-#include <valarray>
+#include <vector>
 
 #include "qwwad/wf_options.h"
 #include "qwwad/subband.h"
 #include "qwwad/file-io.h"
+#include "qwwad/parallel.h"
 #include "qwwad/constants.h"
 using namespace QWWAD;
 using namespace constants;
@@ -34,6 +35,7 @@ WfOptions configure_options(int argc, char* argv[])
     opt.add_option<double>     ("mass",           0.067,  "In-plane effective mass (relative to free electron).");
     opt.add_option<double>     ("alpha",          0.0,    "In-plane non-parabolicity parameter [1/eV].");
     opt.add_option<double>     ("vcb",            0.0,    "Conduction band edge [eV].");
+    opt.add_option<unsigned int>("threads",       0,      "Number of subbands to find at once (0 = one per CPU core).");
 
     opt.add_prog_specific_options_and_parse(argc, argv, summary);
 
@@ -55,50 +57,54 @@ int main (int argc, char* argv[])
                                                   opt.get_option<double>("alpha") / e,
                                                   opt.get_option<double>("vcb") * e);
 
-    // Loop over subbands
-    unsigned int ist = 1;
-    for(auto const sb : subbands)
-    {
-        std::valarray<double> k(nk);
-        std::valarray<double> Ek(nk);
+    const auto relative    = opt.get_option<bool>("relative");
+    const auto disp_prefix = opt.get_option<std::string>("disp-prefix");
+    const auto disp_ext    = opt.get_option<std::string>("disp-ext");
+
+    const size_t nsb = subbands.size();
+    std::vector<double> k_max(nsb); // Wavevector at cut-off energy for each subband [1/m]
+
+    // Find the dispersion for several subbands at once.  Each subband is written
+    // to its own file, so the output can be streamed out as soon as it is found
+    run_in_parallel(nsb, opt.get_option<unsigned int>("threads"), [&](const size_t isb) {
+        const auto &sb = subbands[isb];
 
         // Calculate maximum wavevector
-        const auto k_max = sb.get_k_at_Ek(nkbt*kB*Te);
+        k_max[isb] = sb.get_k_at_Ek(nkbt*kB*Te);
 
         // Calculate wavevector spacing
-        const auto dk = k_max/nk;
+        const auto dk = k_max[isb]/nk;
 
-        // Loop over wavevectors and find corresponding energies
-        for(unsigned int ik=0; ik<nk; ik++)
-        {
-            k[ik]  = ik*dk;
-            Ek[ik] = sb.get_Ek_at_k(k[ik]);
-        }
+        // Find the energies at all wavevectors in one pass
+        const arma::vec k  = arma::linspace(0, (nk-1)*dk, nk);
+        arma::vec       Ek = sb.get_Ek_at_k(k);
 
         // If absolute energies are required then offset energies by the energy of the subband
         // minima
-        if(!opt.get_option<bool>("relative"))
+        if(!relative)
             Ek += sb.get_E_min();
 
         Ek /= (1e-3*e); // Rescale to meV
 
-        // If verbose option selected output some information about subband
-        if(opt.get_verbose())
+        // Construct filename and output
+        std::stringstream filename;
+        filename << disp_prefix << isb+1 << disp_ext;
+        write_table(filename.str().c_str(), k, Ek);
+    });
+
+    // If verbose option selected output some information about each subband
+    if(opt.get_verbose())
+    {
+        for(unsigned int isb = 0; isb < nsb; ++isb)
         {
-            std::cout << "Subband " << ist << " at " << sb.get_E_min()/(1e-3*e) << "eV." << std::endl
+            const auto &sb = subbands[isb];
+
+            std::cout << "Subband " << isb+1 << " at " << sb.get_E_min()/(1e-3*e) << "eV." << std::endl
                       << "D.o.s effective mass: " << sb.get_effective_mass() << std::endl
                       << "D.o.s nonparabolicity parameter: " << sb.get_alpha() << std::endl
-                      << "Wavevector at " << nkbt << "*kB*Te: " << k_max << std::endl
+                      << "Wavevector at " << nkbt << "*kB*Te: " << k_max[isb] << std::endl
                       << std::endl;
         }
-
-        // Construct filename and output
-        std::stringstream filename;
-        filename << opt.get_option<std::string>("disp-prefix") << ist << opt.get_option<std::string>("disp-ext");
-        write_table(filename.str().c_str(), k, Ek);
-
-        // Increment state counter
-        ist++;
     }
 
     return EXIT_SUCCESS;
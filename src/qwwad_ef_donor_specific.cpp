@@ -9,13 +9,17 @@
  *          single donor at any position, in any user supplied potential.  
  */
 
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
 #include "qwwad/constants.h"
 #include "qwwad/file-io.h"
 #include "qwwad/options.h"
+#include "qwwad/parallel.h"
 #include "qwwad/donor-energy-minimiser-linear.h"
 #include "qwwad/donor-energy-minimiser-fast.h"
+#include "qwwad/donor-energy-minimiser-parallel.h"
 #include "qwwad/schroedinger-solver-donor-2D.h"
 #include "qwwad/schroedinger-solver-donor-3D.h"
 #include "qwwad/schroedinger-solver-donor-variable.h"
@@ -38,10 +42,21 @@ Options configure_options(int argc, char* argv[])
     opt.add_option<double>     ("lambdastep,t",           1, "Step size for Bohr radius search [Angstrom]");
     opt.add_option<double>     ("lambdastop,u",          -1, "Final value for Bohr radius search [Angstrom]");
     opt.add_option<double>     ("donorposition,r",           "Location of donor ion [Angstrom]");
+    opt.add_option<double>     ("donorpositionstart",     0, "Initial donor location in a sweep [Angstrom]");
+    opt.add_option<double>     ("donorpositionstep",      5, "Step between donor locations in a sweep [Angstrom]");
+    opt.add_option<double>     ("donorpositionstop",         "Final donor location in a sweep [Angstrom].  If this "
+                                                             "is set, the energy is found at each donor location in turn.");
+    opt.add_option<std::string>("donorpositionfile",         "File containing a list of donor locations to sweep [Angstrom]");
+    opt.add_option<std::string>("spinflippotentialfile",     "Second potential profile for a sweep (e.g., the other spin state). "
+                                                             "If this is set, the difference in energy is written to the spin-flip file.");
+    opt.add_option<std::string>("spinflipfile",    "e_sf.r", "Filename to which the spin-flip energy at each donor location is written.");
+    opt.add_option<std::string>("sweepfile",      "e_rd.r", "Filename to which the results of a donor-position sweep are written.");
     opt.add_option<double>     ("zetastart,w",        0.001, "Initial value for symmetry parameter search");
     opt.add_option<double>     ("zetastep,x",          0.01, "Step size for symmetry parameter search");
     opt.add_option<double>     ("zetastop,y",            -1, "Final value for symmetry parameter search");
-    opt.add_option<std::string>("searchmethod",      "fast", "Method to use for locating parameters (\"fast\" or \"linear\")");
+    opt.add_option<std::string>("searchmethod",      "fast", "Method to use for locating parameters (\"fast\", \"linear\" or \"parallel\")");
+    opt.add_option<unsigned int>("threads",               0, "Number of threads to use in a parallel search or donor-position sweep "
+                                                             "(0 = one per CPU core).");
     opt.add_option<std::string>("symmetry",            "2D", "Symmetry of hydrogenic wave function (\"2D\", \"3D\" or \"variable\")");
     opt.add_option<std::string>("totalpotentialfile", "v.r", "Filename from which the total potential is read.");
 
@@ -50,30 +65,264 @@ Options configure_options(int argc, char* argv[])
     return opt;
 }
 
+/**
+ * \brief Create a solver for the chosen symmetry of hydrogenic wave function
+ *
+ * \param[in] opt    User options
+ * \param[in] V      Confining potential [J]
+ * \param[in] z      Spatial locations [m]
+ * \param[in] r_d    Donor location [m]
+ * \param[in] lambda Initial Bohr radius [m]
+ * \param[in] zeta   Initial symmetry parameter
+ */
+static SchroedingerSolverDonor * create_solver(const Options   &opt,
+                                               const arma::vec &V,
+                                               const arma::vec &z,
+                                               const double     r_d,
+                                               const double     lambda,
+                                               const double     zeta)
+{
+    const auto delta_E         = opt.get_option<double>("dE") * 1e-3*e;    // Energy increment [J]
+    const auto epsilon         = opt.get_option<double>("dcpermittivity") * eps0; // Permittivity [F/m]
+    const auto mstar           = opt.get_option<double>("mass") * me;      // Effective mass [kg]
+    const auto symmetry_string = opt.get_option<std::string>("symmetry");
+
+    SchroedingerSolverDonor *se = 0;
+
+    if(symmetry_string == "2D")
+        se = new SchroedingerSolverDonor2D(mstar, V, z, epsilon, r_d, lambda, delta_E);
+    else if(symmetry_string == "3D")
+        se = new SchroedingerSolverDonor3D(mstar, V, z, epsilon, r_d, lambda, delta_E);
+    else if(symmetry_string == "variable")
+        se = new SchroedingerSolverDonorVariable(mstar, V, z, epsilon, r_d, lambda, zeta, delta_E);
+    else
+    {
+        std::cerr << "Unrecognised symmetry type: " << symmetry_string << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return se;
+}
+
+/**
+ * \brief Create a minimiser for the variational parameters
+ *
+ * \param[in] opt          User options
+ * \param[in] se           The solver to minimise
+ * \param[in] lambda_start Initial Bohr radius [m]
+ * \param[in] zeta_start   Initial symmetry parameter
+ * \param[in] n_threads    Number of threads to use in a parallel search
+ */
+static DonorEnergyMinimiser * create_minimiser(const Options           &opt,
+                                               SchroedingerSolverDonor *se,
+                                               const double             lambda_start,
+                                               const double             zeta_start,
+                                               const unsigned int       n_threads)
+{
+    const auto search_method = opt.get_option<std::string>("searchmethod");
+    const auto lambda_step   = opt.get_option<double>("lambdastep") * 1e-10; // Bohr radius increment [m]
+    const auto lambda_stop   = opt.get_option<double>("lambdastop") * 1e-10; // Final Bohr radius [m]
+    const auto zeta_step     = opt.get_option<double>("zetastep");  // Symmetry parameter increment
+    const auto zeta_stop     = opt.get_option<double>("zetastop");  // Final symmetry parameter
+
+    DonorEnergyMinimiser *minimiser = NULL;
+
+    if(search_method == "linear")
+        minimiser = new DonorEnergyMinimiserLinear(se, lambda_start, lambda_step, lambda_stop);
+    else if (search_method == "fast")
+        minimiser = new DonorEnergyMinimiserFast(se, lambda_start, lambda_step, lambda_stop);
+    else if (search_method == "parallel")
+        minimiser = new DonorEnergyMinimiserParallel(se, lambda_start, lambda_step, lambda_stop, n_threads);
+    else
+    {
+        std::cerr << "Unrecognised search type: " << search_method << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    minimiser->set_zeta_params(zeta_start, zeta_step, zeta_stop);
+
+    return minimiser;
+}
+
+/**
+ * \brief Find the ground-state energy of a donor at each of a set of locations
+ *
+ * \param[in]  opt      User options
+ * \param[in]  se_0     Solver for the confining potential, which is copied for each thread
+ * \param[in]  r_d      Donor locations [m]
+ * \param[out] E        Ground-state energy at each location [J]
+ * \param[out] lambda   Bohr radius at each location [m]
+ * \param[out] zeta     Symmetry parameter at each location
+ *
+ * \details The locations are split into contiguous blocks, which are found in
+ *          parallel.  Within each block, the search at each location starts from
+ *          the optimum at the previous location, which is usually very close.
+ *          Only the starting point moves, so the search range given by the user
+ *          still applies to every location.
+ */
+static void sweep_donor_positions(const Options                 &opt,
+                                  const SchroedingerSolverDonor &se_0,
+                                  const arma::vec               &r_d,
+                                  arma::vec                     &E,
+                                  arma::vec                     &lambda,
+                                  arma::vec                     &zeta)
+{
+    const auto search_method = opt.get_option<std::string>("searchmethod");
+    const auto lambda_start  = opt.get_option<double>("lambdastart") * 1e-10; // Initial Bohr radius [m]
+    const auto lambda_step   = opt.get_option<double>("lambdastep")  * 1e-10; // Bohr radius increment [m]
+    const auto zeta_start    = opt.get_option<double>("zetastart"); // Initial symmetry parameter
+    const auto zeta_step     = opt.get_option<double>("zetastep");  // Symmetry parameter increment
+    const bool variable      = (opt.get_option<std::string>("symmetry") == "variable");
+    const auto n_threads     = get_thread_count(opt.get_option<unsigned int>("threads"));
+
+    const size_t n_rd     = r_d.size();
+    const size_t n_blocks = std::min<size_t>(n_threads, n_rd);
+
+    E.set_size(n_rd);
+    lambda.set_size(n_rd);
+    zeta.set_size(n_rd);
+
+    run_in_parallel(n_blocks, n_blocks, [&](const size_t iblock) {
+        const size_t ird_lo = iblock*n_rd/n_blocks;
+        const size_t ird_hi = (iblock+1)*n_rd/n_blocks;
+
+        std::unique_ptr<SchroedingerSolverDonor> se(se_0.clone());
+        double lambda_seed = lambda_start;
+        double zeta_seed   = zeta_start;
+
+        for(size_t ird = ird_lo; ird < ird_hi; ++ird)
+        {
+            se->set_r_d(r_d[ird]);
+
+            // The linear search only moves upwards from its starting point, so
+            // start a couple of steps below the previous optimum.  Only the
+            // simplex search for variable symmetry can start from the optimum
+            // itself.  Other searches use the full range each time.
+            double lambda_0 = lambda_start;
+            double zeta_0   = zeta_start;
+
+            if(ird != ird_lo && search_method == "linear")
+            {
+                lambda_0 = std::max(lambda_start, lambda_seed - 2*lambda_step);
+                zeta_0   = std::max(zeta_start,   zeta_seed   - 2*zeta_step);
+            }
+            else if(ird != ird_lo && search_method == "fast" && variable)
+            {
+                lambda_0 = lambda_seed;
+                zeta_0   = zeta_seed;
+            }
+
+            std::unique_ptr<DonorEnergyMinimiser> minimiser(create_minimiser(opt, se.get(), lambda_0, zeta_0, 1));
+            minimiser->minimise();
+
+            E[ird]      = minimiser->get_E_min();
+            lambda[ird] = se->get_lambda();
+            zeta[ird]   = variable ? dynamic_cast<SchroedingerSolverDonorVariable *>(se.get())->get_zeta() : 0.0;
+
+            lambda_seed = lambda[ird];
+            zeta_seed   = zeta[ird];
+        }
+    });
+}
+
+/**
+ * \brief Find the donor energy at a range of locations, and write the results to file
+ */
+static void run_sweep(const Options   &opt,
+                      const arma::vec &V,
+                      const arma::vec &z)
+{
+    arma::vec r_d; // Donor locations [m]
+
+    if(opt.get_argument_known("donorpositionfile"))
+        read_table(opt.get_option<std::string>("donorpositionfile"), r_d);
+    else
+    {
+        const auto rd_start = opt.get_option<double>("donorpositionstart");
+        const auto rd_step  = opt.get_option<double>("donorpositionstep");
+        const auto rd_stop  = opt.get_option<double>("donorpositionstop");
+
+        if(rd_step <= 0 || rd_stop < rd_start)
+        {
+            std::cerr << "Donor-position sweep must have a positive step, and must stop above its start." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        const size_t n_rd = floor((rd_stop - rd_start)/rd_step + 1e-6) + 1;
+        r_d = arma::linspace(rd_start, rd_start + (n_rd-1)*rd_step, n_rd);
+    }
+
+    if(r_d.empty())
+    {
+        std::cerr << "No donor locations were given for the sweep." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    r_d *= 1e-10;
+
+    const auto lambda_start = opt.get_option<double>("lambdastart") * 1e-10; // Initial Bohr radius [m]
+    const auto zeta_start   = opt.get_option<double>("zetastart"); // Initial symmetry parameter
+
+    arma::vec E;      // Energy at each location [J]
+    arma::vec lambda; // Bohr radius at each location [m]
+    arma::vec zeta;   // Symmetry parameter at each location
+    std::unique_ptr<SchroedingerSolverDonor> se(create_solver(opt, V, z, r_d[0], lambda_start, zeta_start));
+    sweep_donor_positions(opt, *se, r_d, E, lambda, zeta);
+
+    const arma::vec r_d_out = r_d*1e10;
+    write_table(opt.get_option<std::string>("sweepfile"), r_d_out, arma::vec(E*1000/e), arma::vec(lambda*1e10), zeta);
+
+    // Find the energy difference with respect to a second potential, which is
+    // directly usable as the input to qwwad_spin_flip_raman
+    if(opt.get_argument_known("spinflippotentialfile"))
+    {
+        arma::vec z2;
+        arma::vec V2;
+        read_table(opt.get_option<std::string>("spinflippotentialfile"), z2, V2);
+
+        if(z2.size() != z.size())
+        {
+            std::cerr << "Spin-flip potential has " << z2.size() << " points, but the main potential has "
+                      << z.size() << "." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        arma::vec E2;
+        arma::vec lambda2;
+        arma::vec zeta2;
+        std::unique_ptr<SchroedingerSolverDonor> se2(create_solver(opt, V2, z2, r_d[0], lambda_start, zeta_start));
+        sweep_donor_positions(opt, *se2, r_d, E2, lambda2, zeta2);
+
+        write_table(opt.get_option<std::string>("spinflipfile"), r_d_out, arma::vec((E - E2)*1000/e));
+    }
+}
+
 int main(int argc,char *argv[])
 {
     const auto opt = configure_options(argc, argv);
 
-    const auto delta_E = opt.get_option<double>("dE") * 1e-3*e;    // Energy increment [J]
-    const auto epsilon = opt.get_option<double>("dcpermittivity") * eps0; // Permittivity [F/m]
-    const auto mstar   = opt.get_option<double>("mass") * me;      // Effective mass [kg]
+    const auto search_method = opt.get_option<std::string>("searchmethod");
 
-    // Read symmetry and minimiser types
-    const auto symmetry_string = opt.get_option<std::string>("symmetry");
-    const auto search_method   = opt.get_option<std::string>("searchmethod");
+    if(search_method != "linear" && search_method != "fast" && search_method != "parallel")
+    {
+        std::cerr << "Unrecognised search type: " << search_method << std::endl;
+        exit(EXIT_FAILURE);
+    }
 
     const auto lambda_start = opt.get_option<double>("lambdastart") * 1e-10; // Initial Bohr radius [m]
-    const auto lambda_step  = opt.get_option<double>("lambdastep")  * 1e-10; // Bohr radius increment [m]
-    const auto lambda_stop  = opt.get_option<double>("lambdastop")  * 1e-10; // Final Bohr radius [m]
     const auto zeta_start   = opt.get_option<double>("zetastart"); // Initial symmetry parameter
-    const auto zeta_step    = opt.get_option<double>("zetastep");  // Symmetry parameter increment
-    const auto zeta_stop    = opt.get_option<double>("zetastop");  // Final symmetry parameter
 
     arma::vec z; // Spatial location [m]
     arma::vec V; // Confining potential [J]
     const auto totalpotentialfile = opt.get_option<std::string>("totalpotentialfile");
     read_table(totalpotentialfile, z, V);
 
+    if(opt.get_argument_known("donorpositionstop") || opt.get_argument_known("donorpositionfile"))
+    {
+        run_sweep(opt, V, z);
+        return EXIT_SUCCESS;
+    }
+
     // Get donor location [m].  If unspecified, assume it's in the middle
     auto r_d = 0.0;
 
@@ -87,34 +336,11 @@ int main(int argc,char *argv[])
     auto zeta_0   = zeta_start;   // symmetry parameter
 
     // Create an initial estimate of the Schroedinger solution
-    SchroedingerSolverDonor *se = 0;
-
-    if(symmetry_string == "2D")
-        se = new SchroedingerSolverDonor2D(mstar, V, z, epsilon, r_d, lambda_0, delta_E);
-    else if(symmetry_string == "3D")
-        se = new SchroedingerSolverDonor3D(mstar, V, z, epsilon, r_d, lambda_0, delta_E);
-    else if(symmetry_string == "variable")
-        se = new SchroedingerSolverDonorVariable(mstar, V, z, epsilon, r_d, lambda_0, zeta_0, delta_E);
-    else
-    {
-        std::cerr << "Unrecognised symmetry type: " << opt.get_option<std::string>("symmetry") << std::endl;
-        exit(EXIT_FAILURE);
-    }
+    SchroedingerSolverDonor *se = create_solver(opt, V, z, r_d, lambda_0, zeta_0);
 
     // Now, use a minimiser to correct the orbital and find the minimum energy solution
-    DonorEnergyMinimiser *minimiser = NULL;
-
-    if(search_method == "linear")
-        minimiser = new DonorEnergyMinimiserLinear(se, lambda_start, lambda_step, lambda_stop);
-    else if (search_method == "fast")
-        minimiser = new DonorEnergyMinimiserFast(se, lambda_start, lambda_step, lambda_stop);
-    else
-    {
-        std::cerr << "Unrecognised search type: " << search_method << std::endl;
-        exit(EXIT_FAILURE);
-    }
-
-    minimiser->set_zeta_params(zeta_start, zeta_step, zeta_stop);
+    DonorEnergyMinimiser *minimiser = create_minimiser(opt, se, lambda_start, zeta_start,
+                                                       opt.get_option<unsigned int>("threads"));
     minimiser->minimise();
 
     // Read out the solutions now that we've minimised the energy
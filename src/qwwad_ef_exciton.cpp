@@ -7,17 +7,145 @@
 
 //#include <cstdio>
 #include <cstdlib>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <valarray>
+#include <vector>
 
 #include <gsl/gsl_math.h>
+#include <gsl/gsl_multimin.h>
 
 #include "qwwad/constants.h"
 #include "qwwad/file-io.h"
+#include "qwwad/maths-helpers.h"
 #include "qwwad/options.h"
+#include "qwwad/parallel.h"
 
 using namespace QWWAD;
 using namespace constants;
 
+/**
+ * \brief A function of one variable, tabulated on a uniform grid
+ *
+ * \details Values between the samples are found by linear interpolation, so each
+ *          look-up costs the same however expensive the function is.
+ */
+class KernelTable
+{
+private:
+    double              _dx; ///< Spacing between samples
+    std::vector<double> _f;  ///< Function value at each sample
+
+public:
+    KernelTable(const std::function<double (double)> &f,
+                const double                          x_max,
+                const size_t                          n);
+
+    double operator()(const double x) const;
+
+    /** Return the largest argument in the table */
+    double get_x_max() const {return _dx*(_f.size()-1);}
+};
+
+/**
+ * \brief Tabulated forms of the in-plane integrals G(a), J(a) and K(a)
+ *
+ * \details Each of the integrals is a midpoint sum over the dummy variable x,
+ *          which depends on the separation a only through a single scaled
+ *          variable.  For G and J, this is \f$s = a\sqrt{1-\beta^2}/\lambda\f$, and
+ *          for K it is \f$t = a\beta/\lambda\f$.  The sums are therefore found once on
+ *          a fine grid of the scaled variable, rather than once for every
+ *          separation at every trial value of lambda and beta.  The limit of the
+ *          K integral depends on beta, so a separate table is kept for each beta
+ *          and shared between all trial values of lambda.  Only the most recently
+ *          made K tables are kept, so a long search doesn't use unlimited memory.
+ */
+class ExcitonKernels
+{
+private:
+    int         _N_x;     ///< Number of strips in each midpoint sum
+    double      _s_max;   ///< Largest scaled separation needed
+    size_t      _n_table; ///< Number of samples in each table
+    KernelTable _G_table; ///< \f$s^2\int(\ldots)\f$ part of G(a)
+    KernelTable _J_table; ///< Numerically integrated part of J(a)
+
+    /// Maximum number of K tables to keep at once
+    static const size_t _n_K_tables_max = 64;
+
+    /// Numerically integrated part of K(a) for each beta
+    mutable std::map<double, std::shared_ptr<const KernelTable>> _K_tables;
+    mutable std::deque<double> _K_order; ///< Beta values, in the order that their tables were made
+    mutable std::mutex         _K_mutex; ///< Guards the K tables
+
+public:
+    ExcitonKernels(const int    N_x,
+                   const double s_max,
+                   const size_t n_table);
+
+    double G(const double a, const double beta, const double lambda) const;
+    double J(const double a, const double beta, const double lambda) const;
+    double K(const double a, const double beta, const double lambda) const;
+};
+
+/**
+ * \brief Variational search for the binding energy of an exciton
+ *
+ * \details The binding energy at each (lambda, beta) pair is only calculated once,
+ *          and may be requested from several threads at once.  Every new
+ *          calculation is added to the search log.
+ */
+class ExcitonSearch
+{
+private:
+    const std::valarray<double> &_z;       ///< Spatial location [m]
+    const std::valarray<double> &_psi_e;   ///< Electron wave function [m^{-0.5}]
+    const std::valarray<double> &_psi_h;   ///< Hole wave function [m^{-0.5}]
+    const std::valarray<double> &_p;       ///< Probability density of separation [1/m]
+    double                       _epsilon; ///< Permittivity [F/m]
+    double                       _m[2];    ///< Electron and hole masses [kg]
+    double                       _mu_xy;   ///< In-plane reduced mass [kg]
+    const ExcitonKernels        &_kernels; ///< Tabulated in-plane integrals
+    bool                         _output_flag;
+
+    std::map<std::pair<double, double>, double> _Eb_cache; ///< Binding energy at each (lambda, beta) [J]
+    std::mutex _mutex; ///< Guards the cache and search log
+
+public:
+    ExcitonSearch(const std::valarray<double> &z,
+                  const std::valarray<double> &psi_e,
+                  const std::valarray<double> &psi_h,
+                  const std::valarray<double> &p,
+                  const double                 epsilon,
+                  const double                 m[],
+                  const double                 mu_xy,
+                  const ExcitonKernels        &kernels,
+                  const bool                   output_flag);
+
+    // Tables for the search log
+    std::vector<double> lambda_log; ///< Bohr radius [Angstrom]
+    std::vector<double> beta_log;   ///< Symmetry parameter
+    std::vector<double> Eb_log;     ///< Binding energy [meV]
+
+    double get_Eb(const double lambda,
+                  const double beta);
+
+    void find_minimum(double &Eb_min,
+                      double &lambda_0,
+                      double &beta_0) const;
+
+    static double get_Eb_multimin(const gsl_vector *lambda_beta,
+                                  void             *params);
+};
+
+static void search_simplex(ExcitonSearch &search,
+                           const double   lambda_start,
+                           const double   lambda_step,
+                           const double   beta_start,
+                           const double   beta_step);
+
 static bool repeat_beta(const double  beta,
                         double       *beta_0_lambda,
                         const double  Eb,
@@ -39,7 +167,7 @@ static double Eb_1S(const std::valarray<double> z,
                     const double  lambda,
                     const double  m[],
                     const double  mu_xy,
-                    const int     N_x,
+                    const ExcitonKernels &kernels,
                     const bool    output_flag);
 
 std::valarray<double> pP_calc(const std::valarray<double> &z,
@@ -50,20 +178,15 @@ double F(double a,
          double beta,
          double lambda);
 
-double G(double a,
-         double beta,
-         double lambda,
-         int    N_x);
+static double G_integral(double s,
+                         int    N_x);
 
-double J(double a,
-         double beta,
-         double lambda,
-         int    N_x);
+static double J_integral(double s,
+                         int    N_x);
 
-double K(double a,
-         double beta,
-         double lambda,
-         int N_x);
+static double K_integral(double t,
+                         double beta,
+                         int    N_x);
 
 /**
  * \brief Configure command-line options
@@ -85,7 +208,10 @@ Options configure_options(int argc, char* argv[])
     opt.add_option<unsigned int>("electronstate,a",       1,     "Index of electron state");
     opt.add_option<unsigned int>("holestate,b",           1,     "Index of hole state");
     opt.add_option<size_t>      ("nx,N",                100,     "Number of samples for x-integration");
+    opt.add_option<size_t>      ("nkernel",           10000,     "Number of samples in each table of x-integrals");
     opt.add_option<std::string> ("searchlogfile", "searchlog.r", "Filename for search log");
+    opt.add_option<std::string> ("searchmethod",     "linear",   "Method to use for locating parameters (\"linear\", \"fast\" or \"parallel\")");
+    opt.add_option<unsigned int>("threads",               0,     "Number of threads to use in a parallel search (0 = one per CPU core).");
 
     opt.add_prog_specific_options_and_parse(argc, argv, doc);
 
@@ -104,6 +230,8 @@ int main(int argc,char *argv[])
     const auto lambda_step  = opt.get_option<double>("lambdastep")  * 1e-10;   // Bohr radius increment [m]
     const auto lambda_stop  = opt.get_option<double>("lambdastop")  * 1e-10;   // Final Bohr radius [m]
     const auto N_x          = opt.get_option<size_t>("nx");                    // Number of steps for x-integration
+    const auto n_kernel     = opt.get_option<size_t>("nkernel");               // Number of samples in x-integral tables
+    const auto search_method = opt.get_option<std::string>("searchmethod");
 
     const auto e_state = opt.get_option<unsigned int>("electronstate");
     const auto h_state = opt.get_option<unsigned int>("holestate");
@@ -144,6 +272,11 @@ int main(int argc,char *argv[])
     const std::valarray<double> p_Angstrom = p*1e-10;
     write_table("p.r", z, p_Angstrom);
 
+    // The Bohr radius only increases during a linear search, so the largest scaled
+    // separation occurs at the starting value.  Other searches may go lower, in which
+    // case the integrals are found directly.
+    const ExcitonKernels kernels(N_x, z.max()/lambda_start, n_kernel);
+
     if(output_flag)printf("  l/A   beta   Eb/meV  T/meV  V/meV   OS/arb.\n");
 
     double lambda=lambda_start; // Bohr radius
@@ -158,44 +291,87 @@ int main(int argc,char *argv[])
     std::vector<double> beta_log;
     std::vector<double> Eb_log;
 
-    do
+    if(search_method == "fast" || search_method == "parallel")
+    {
+        ExcitonSearch search(z, psi_e, psi_h, p, epsilon, m, mu_xy, kernels, output_flag);
+
+        if(search_method == "parallel")
+        {
+            if(lambda_stop <= lambda_start || beta_stop <= beta_start)
+            {
+                std::cerr << "A parallel search needs final values for lambda and beta, "
+                          << "using --lambdastop and --betastop" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+
+            // Evaluate a coarse grid of parameters on all threads
+            const size_t n_lambda = floor((lambda_stop - lambda_start)/lambda_step + 1e-6) + 1;
+            const size_t n_beta   = floor((beta_stop   - beta_start)  /beta_step   + 1e-6) + 1;
+
+            run_in_parallel(n_lambda*n_beta, opt.get_option<unsigned int>("threads"), [&](const size_t i) {
+                search.get_Eb(lambda_start + (i/n_beta)*lambda_step,
+                              beta_start   + (i%n_beta)*beta_step);
+            });
+
+            // ...and then refine the best of them, using a finer initial simplex
+            search.find_minimum(Eb_min, lambda_0, beta_0);
+            search_simplex(search, lambda_0, lambda_step/2, beta_0, beta_step/2);
+        }
+        else
+            search_simplex(search, lambda_start, lambda_step, beta_start, beta_step);
+
+        search.find_minimum(Eb_min, lambda_0, beta_0);
+        lambda_log = search.lambda_log;
+        beta_log   = search.beta_log;
+        Eb_log     = search.Eb_log;
+    }
+    else if(search_method == "linear")
     {
-        /* Find minimum binding energy for beta variation */
-        double Eb_min_beta = e; /* Start with 1 eV as a huge initial estimate */
-        bool   repeat_flag_beta = true;   /* repeat variational beta loop flag */
-        double beta=beta_start;
-        double beta_0_lambda = beta; /* Value of beta that gives the minimum binding energy */
-
-        /* Loop through beta values and store the minimum binding energy as
-         * Eb_min_beta.  The corresponding beta value is stored as beta_0_lambda */ 
         do
         {
-            // Find exciton binding energy (<0=bound)
-            const auto Eb = Eb_1S(z, psi_e, psi_h, p, beta, epsilon, lambda, m, mu_xy, N_x, output_flag);
+            /* Find minimum binding energy for beta variation */
+            double Eb_min_beta = e; /* Start with 1 eV as a huge initial estimate */
+            bool   repeat_flag_beta = true;   /* repeat variational beta loop flag */
+            double beta=beta_start;
+            double beta_0_lambda = beta; /* Value of beta that gives the minimum binding energy */
 
-            repeat_flag_beta=repeat_beta(beta,&beta_0_lambda,Eb,&Eb_min_beta);
+            /* Loop through beta values and store the minimum binding energy as
+             * Eb_min_beta.  The corresponding beta value is stored as beta_0_lambda */ 
+            do
+            {
+                // Find exciton binding energy (<0=bound)
+                const auto Eb = Eb_1S(z, psi_e, psi_h, p, beta, epsilon, lambda, m, mu_xy, kernels, output_flag);
 
-            // Update search log
-            lambda_log.push_back(lambda*1e10);
-            beta_log.push_back(beta);
-            Eb_log.push_back(Eb_min_beta*1000/e);
+                repeat_flag_beta=repeat_beta(beta,&beta_0_lambda,Eb,&Eb_min_beta);
 
-            beta+=beta_step;
-        }while((repeat_flag_beta&&(beta_stop<0))||(beta<beta_stop));
+                // Update search log
+                lambda_log.push_back(lambda*1e10);
+                beta_log.push_back(beta);
+                Eb_log.push_back(Eb_min_beta*1000/e);
 
-//        fprintf(FEX0l,"%lf %lf\n",lambda/1e-10,Eb_min_beta/(1e-3*e));
-//        fprintf(Fbeta,"%lf %lf\n",lambda/1e-10,beta_0_lambda);
+                beta+=beta_step;
+            }while((repeat_flag_beta&&(beta_stop<0))||(beta<beta_stop));
 
-        repeat_flag_lambda=repeat_lambda(&beta_0,beta_0_lambda,Eb_min_beta,&Eb_min,
-                lambda,&lambda_0);
+//            fprintf(FEX0l,"%lf %lf\n",lambda/1e-10,Eb_min_beta/(1e-3*e));
+//            fprintf(Fbeta,"%lf %lf\n",lambda/1e-10,beta_0_lambda);
 
-        lambda+=lambda_step;   /* increment Bohr radius */
-    }while((repeat_flag_lambda&&(lambda_stop<0))||(lambda<lambda_stop));
+            repeat_flag_lambda=repeat_lambda(&beta_0,beta_0_lambda,Eb_min_beta,&Eb_min,
+                    lambda,&lambda_0);
+
+            lambda+=lambda_step;   /* increment Bohr radius */
+        }while((repeat_flag_lambda&&(lambda_stop<0))||(lambda<lambda_stop));
+    }
+    else
+    {
+        std::cerr << "Unrecognised search type: " << search_method << std::endl;
+        exit(EXIT_FAILURE);
+    }
 
     // Write out final data to file
-    std::ofstream FEX0("EX0.r");
-    FEX0 << Eb_min*1000/e << " " << lambda_0*1e10 << " " << beta_0 << std::endl;
-    FEX0.close();
+    {
+        TableWriter FEX0("EX0.r");
+        FEX0 << Eb_min*1000/e << ' ' << lambda_0*1e10 << ' ' << beta_0 << '\n';
+    }
     
     const auto searchlogfile = opt.get_option<std::string>("searchlogfile");
     write_table(searchlogfile, lambda_log, beta_log, Eb_log);
@@ -220,7 +396,7 @@ static double Eb_1S(const std::valarray<double> z,
                     const double  lambda,
                     const double  m[],
                     const double  mu_xy,
-                    const int     N_x,
+                    const ExcitonKernels &kernels,
                     const bool    output_flag)
 {
     double A  = 0;              /* {\cal A}, see notes!              */
@@ -238,10 +414,12 @@ static double Eb_1S(const std::valarray<double> z,
     // Loop over spatial separations
     for(unsigned int ia=0; ia<nz; ++ia)
     {
-        A  += p[ia] * G(z[ia], beta,lambda,N_x)*dz;
-        B  += p[ia] * G(z[ia], beta,lambda,N_x)*dz;
-        Ct += p[ia] * J(z[ia], beta,lambda,N_x)*dz;
-        Cv += p[ia] * K(z[ia], beta,lambda,N_x)*dz;
+        const double G = kernels.G(z[ia], beta, lambda);
+
+        A  += p[ia] * G*dz;
+        B  += p[ia] * G*dz;
+        Ct += p[ia] * kernels.J(z[ia], beta,lambda)*dz;
+        Cv += p[ia] * kernels.K(z[ia], beta,lambda)*dz;
         D  += p[ia] * F(z[ia], beta,lambda)*dz;
 
         O += psi_e[ia]*psi_h[ia]*dz;
@@ -262,6 +440,153 @@ static double Eb_1S(const std::valarray<double> z,
     return Eb;
 }
 
+ExcitonSearch::ExcitonSearch(const std::valarray<double> &z,
+                             const std::valarray<double> &psi_e,
+                             const std::valarray<double> &psi_h,
+                             const std::valarray<double> &p,
+                             const double                 epsilon,
+                             const double                 m[],
+                             const double                 mu_xy,
+                             const ExcitonKernels        &kernels,
+                             const bool                   output_flag) :
+    _z(z),
+    _psi_e(psi_e),
+    _psi_h(psi_h),
+    _p(p),
+    _epsilon(epsilon),
+    _m{m[0], m[1]},
+    _mu_xy(mu_xy),
+    _kernels(kernels),
+    _output_flag(output_flag),
+    _Eb_cache(),
+    _mutex()
+{}
+
+/**
+ * \brief Find the binding energy for a given Bohr radius and symmetry parameter
+ *
+ * \param[in] lambda Bohr radius [m]
+ * \param[in] beta   Symmetry parameter
+ *
+ * \returns The binding energy [J].  An enormous value is returned if the
+ *          parameters are unphysical, so that minimisers are pushed back into range.
+ */
+double ExcitonSearch::get_Eb(const double lambda,
+                             const double beta)
+{
+    if(lambda <= 0 || beta <= 0 || beta >= 1)
+        return e;
+
+    const auto key = std::make_pair(lambda, beta);
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        const auto cached = _Eb_cache.find(key);
+
+        if(cached != _Eb_cache.end())
+            return cached->second;
+    }
+
+    const double Eb = Eb_1S(_z, _psi_e, _psi_h, _p, beta, _epsilon, lambda, _m, _mu_xy, _kernels, _output_flag);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if(_Eb_cache.insert(std::make_pair(key, Eb)).second)
+    {
+        lambda_log.push_back(lambda*1e10);
+        beta_log.push_back(beta);
+        Eb_log.push_back(Eb*1000/e);
+    }
+
+    return Eb;
+}
+
+/**
+ * \brief Find the lowest binding energy calculated so far
+ *
+ * \param[out] Eb_min   Binding energy [J]
+ * \param[out] lambda_0 Bohr radius [m]
+ * \param[out] beta_0   Symmetry parameter
+ */
+void ExcitonSearch::find_minimum(double &Eb_min,
+                                 double &lambda_0,
+                                 double &beta_0) const
+{
+    Eb_min = e;
+
+    for(const auto &point : _Eb_cache)
+    {
+        if(point.second < Eb_min)
+        {
+            Eb_min   = point.second;
+            lambda_0 = point.first.first;
+            beta_0   = point.first.second;
+        }
+    }
+}
+
+/**
+ * \brief Find the binding energy for the GSL minimiser
+ *
+ * \param[in] lambda_beta Bohr radius [Angstrom] and symmetry parameter
+ * \param[in] params      The search to use
+ *
+ * \details The Bohr radius is given in Angstrom so that both parameters have a
+ *          similar magnitude, which keeps the simplex well-conditioned.
+ */
+double ExcitonSearch::get_Eb_multimin(const gsl_vector *lambda_beta,
+                                      void             *params)
+{
+    auto search = reinterpret_cast<ExcitonSearch *>(params);
+    return search->get_Eb(gsl_vector_get(lambda_beta, 0)*1e-10, gsl_vector_get(lambda_beta, 1));
+}
+
+/**
+ * \brief Minimise the binding energy using a Nelder-Mead simplex search
+ *
+ * \param[in,out] search       The search to add results to
+ * \param[in]     lambda_start Initial Bohr radius [m]
+ * \param[in]     lambda_step  Initial simplex size in Bohr radius [m]
+ * \param[in]     beta_start   Initial symmetry parameter
+ * \param[in]     beta_step    Initial simplex size in symmetry parameter
+ */
+static void search_simplex(ExcitonSearch &search,
+                           const double   lambda_start,
+                           const double   lambda_step,
+                           const double   beta_start,
+                           const double   beta_step)
+{
+    const size_t max_iter = 200; // Maximum number of iterations before giving up
+    int status = 0;              // Error flag for GSL
+    unsigned int iter = 0;       // The number of iterations attempted so far
+
+    gsl_multimin_function f;
+    f.f      = &ExcitonSearch::get_Eb_multimin;
+    f.n      = 2;
+    f.params = &search;
+
+    gsl_vector *lambda_beta = gsl_vector_alloc(2);
+    gsl_vector *step_size   = gsl_vector_alloc(2);
+    gsl_vector_set(lambda_beta, 0, lambda_start*1e10);
+    gsl_vector_set(lambda_beta, 1, beta_start);
+    gsl_vector_set(step_size,   0, lambda_step*1e10);
+    gsl_vector_set(step_size,   1, beta_step);
+
+    gsl_multimin_fminimizer *s = gsl_multimin_fminimizer_alloc(gsl_multimin_fminimizer_nmsimplex2, 2);
+    gsl_multimin_fminimizer_set(s, &f, lambda_beta, step_size);
+
+    do
+    {
+        ++iter;
+        status = gsl_multimin_fminimizer_iterate(s);
+        status = gsl_multimin_test_size(s->size, 1e-4);
+    }while((status == GSL_CONTINUE) && (iter < max_iter));
+
+    gsl_multimin_fminimizer_free(s);
+    gsl_vector_free(lambda_beta);
+    gsl_vector_free(step_size);
+}
+
 /**
  * \brief Repeat beta variational
  */
@@ -322,100 +647,216 @@ double F(double a,
  return(f);
 }
 
-/* This function returns the value of G(a),
-   to overcome the problem of divergence when
-   x=0, the integration is performed using a
-   midpoint sum, the strip width being delta_x */
-double G(double a,
-         double beta,
-         double lambda,
-         int    N_x)
+/**
+ * \brief Tabulate a function on a uniform grid
+ *
+ * \param[in] f     The function to tabulate
+ * \param[in] x_max Largest argument in the table (the smallest is zero)
+ * \param[in] n     Number of samples
+ */
+KernelTable::KernelTable(const std::function<double (double)> &f,
+                         const double                          x_max,
+                         const size_t                          n) :
+    _dx(x_max/(n-1)),
+    _f(n)
+{
+    for(size_t i = 0; i < n; ++i)
+        _f[i] = f(i*_dx);
+}
+
+/**
+ * \brief Find the value of the function by linear interpolation
+ */
+double KernelTable::operator()(const double x) const
 {
- double delta_x;
- double g;
- double x;  /* dummy variable---see notes! */
+    const double i_real = x/_dx;
+    const size_t i      = static_cast<size_t>(i_real);
+
+    if(i >= _f.size() - 1)
+        return _f.back();
+
+    const double frac = i_real - i;
+    return _f[i]*(1-frac) + _f[i+1]*frac;
+}
 
- delta_x=(1.0-0.0)/(float)N_x;
+/**
+ * \brief Tabulate the integrals needed for G(a) and J(a)
+ *
+ * \param[in] N_x     Number of strips in each midpoint sum
+ * \param[in] s_max   Largest scaled separation, \f$a/\lambda\f$, needed
+ * \param[in] n_table Number of samples in each table
+ */
+ExcitonKernels::ExcitonKernels(const int    N_x,
+                               const double s_max,
+                               const size_t n_table) :
+    _N_x(N_x),
+    _s_max(s_max),
+    _n_table(n_table),
+    _G_table([N_x](double s) {return G_integral(s, N_x);}, s_max, n_table),
+    _J_table([N_x](double s) {return J_integral(s, N_x);}, s_max, n_table),
+    _K_tables(),
+    _K_order(),
+    _K_mutex()
+{}
 
- g=0;       /* initialize variable */
+/**
+ * \brief returns the value of G(a)
+ */
+double ExcitonKernels::G(const double a,
+                         const double beta,
+                         const double lambda) const
+{
+    const double s = sqrt(1-gsl_pow_2(beta))*a/lambda;
 
- for(x=delta_x/2;x<1;x+=delta_x)
- {
-  g+=1/(1/x+x)*exp(-sqrt(1-gsl_pow_2(beta))*a*(1/x+x)/lambda)
-     *(1/gsl_pow_2(x)-1)*delta_x;
- }
- g*=2*pi*gsl_pow_2(1-gsl_pow_2(beta))*gsl_pow_2(a)/gsl_pow_2(lambda);
+    if(s > _G_table.get_x_max())
+        return 2*pi*(1-gsl_pow_2(beta))*G_integral(s, _N_x);
 
- return(g);
+    return 2*pi*(1-gsl_pow_2(beta))*_G_table(s);
 }
 
 /**
  * \brief returns the value of J(a)
+ */
+double ExcitonKernels::J(const double a,
+                         const double beta,
+                         const double lambda) const
+{
+    const double s   = sqrt(1-gsl_pow_2(beta))*a/lambda;
+    const double j13 = 2*pi*(s/2-0.25)*exp(-2*s); // J1+J3---see notes!
+    const double j24 = (s > _J_table.get_x_max()) ? J_integral(s, _N_x) : _J_table(s);
+
+    return j13+j24;
+}
+
+/**
+ * \brief returns the value of K(a)
+ */
+double ExcitonKernels::K(const double a,
+                         const double beta,
+                         const double lambda) const
+{
+    const double t = beta*a/lambda;
+
+    std::shared_ptr<const KernelTable> table;
+
+    {
+        std::lock_guard<std::mutex> lock(_K_mutex);
+        auto it = _K_tables.find(beta);
+
+        if(it != _K_tables.end())
+            table = it->second;
+    }
+
+    if(!table)
+    {
+        // Make the table without holding the lock, so that other threads can
+        // still use the existing tables in the meantime
+        const int N_x = _N_x;
+        table = std::make_shared<const KernelTable>([N_x, beta](double t) {return K_integral(t, beta, N_x);},
+                                                    _s_max, _n_table);
+
+        std::lock_guard<std::mutex> lock(_K_mutex);
+        auto result = _K_tables.insert(std::make_pair(beta, table));
+
+        if(result.second)
+        {
+            _K_order.push_back(beta);
+
+            // Forget the oldest table.  Any thread still using it keeps its own
+            // reference, so it is only deleted once that thread has finished.
+            if(_K_order.size() > _n_K_tables_max)
+            {
+                _K_tables.erase(_K_order.front());
+                _K_order.pop_front();
+            }
+        }
+        else
+            table = result.first->second; // Another thread made the same table first
+    }
+
+    // The tabulated integral depends only on t, so the remaining factor of
+    // lambda in K(a) = pi beta a (...) is applied here
+    if(t > table->get_x_max())
+        return lambda*K_integral(t, beta, _N_x);
+
+    return lambda*(*table)(t);
+}
+
+/**
+ * \brief returns the numerically integrated part of G(a)
+ *
+ * \param[in] s   Scaled separation, \f$a\sqrt{1-\beta^2}/\lambda\f$
+ * \param[in] N_x Number of strips in the midpoint sum
  *
- * \details To overcome the problem of divergence when x=0, the integration is performed
- *          using a midpoint sum, the strip width being delta_x
+ * \details To overcome the problem of divergence when x=0, the integration is
+ *          performed using a midpoint sum.  The result must be multiplied by
+ *          \f$2\pi(1-\beta^2)\f$ to give G(a).
  */
-double J(double a,
-         double beta,
-         double lambda,
-         int    N_x)
+static double G_integral(double s,
+                         int    N_x)
 {
- double delta_x;
- double j13;     /* J1+J3---see notes! */
- double j24;     /* J2+J4---see notes! */
- double x;       /* dummy variable---see notes! */
-
- delta_x=(1.0-0.0)/(float)N_x;
-
- j13=2*pi*(sqrt(1-gsl_pow_2(beta))*a/(2*lambda)-0.25)
-     *exp(-2*sqrt(1-gsl_pow_2(beta))*a/lambda);
-
- j24=0;        /* initialize variable */
-
- for(x=delta_x/2;x<1;x+=delta_x)
- {
-  j24+=(
-        -1/(lambda*gsl_pow_2(1/x+x)/4)
-        -sqrt(1-gsl_pow_2(beta))*a/(gsl_pow_2(lambda)*(1/x+x)/2)
-       )
-       *exp(-sqrt(1-gsl_pow_2(beta))*a*(1/x+x)/lambda)
-       *(1/gsl_pow_2(x)-1)*delta_x;
- }
- j24*=2*pi*sqrt(1-gsl_pow_2(beta))*a/2;
-
- return(j13+j24);
+    const double delta_x = 1.0/N_x;
+    double g = 0; // initialize variable
+
+    for(int ix = 0; ix < N_x; ++ix)
+    {
+        const double x = (ix+0.5)*delta_x; // dummy variable---see notes!
+
+        g += 1/(1/x+x)*exp(-s*(1/x+x))*(1/gsl_pow_2(x)-1)*delta_x;
+    }
+
+    return g*gsl_pow_2(s);
 }
 
 /**
- * \brief returns the value of K(a), to overcome the problem of divergence when
- *        x=0, the integration is performed using a midpoint sum, the strip width being delta_x
+ * \brief returns the numerically integrated part of J(a), i.e., J2+J4
+ *
+ * \param[in] s   Scaled separation, \f$a\sqrt{1-\beta^2}/\lambda\f$
+ * \param[in] N_x Number of strips in the midpoint sum
  */
-double K(double a,
-         double beta,
-         double lambda,
-         int N_x)
+static double J_integral(double s,
+                         int    N_x)
 {
- double delta_x;      /* step length of integration */
- double k;    
- double lower_limit;  /* lower limit of integration */
- double upper_limit;  /* upper limit of integration */
- double x;            /* dummy variable---see notes! */
+    const double delta_x = 1.0/N_x;
+    double j24 = 0; // J2+J4---see notes!
 
- upper_limit=(1-sqrt(1-gsl_pow_2(beta)))/beta;
- lower_limit=0;
+    for(int ix = 0; ix < N_x; ++ix)
+    {
+        const double x = (ix+0.5)*delta_x; // dummy variable---see notes!
 
- delta_x=(upper_limit-lower_limit)/(float)N_x;
+        j24 += (-4/gsl_pow_2(1/x+x) - 2*s/(1/x+x))
+               *exp(-s*(1/x+x))
+               *(1/gsl_pow_2(x)-1)*delta_x;
+    }
 
- k=0;
+    return j24*pi*s;
+}
+
+/**
+ * \brief returns the scaled value of K(a)
+ *
+ * \param[in] t    Scaled separation, \f$a\beta/\lambda\f$
+ * \param[in] beta Symmetry parameter, which sets the upper limit of integration
+ * \param[in] N_x  Number of strips in the midpoint sum
+ *
+ * \details The result must be multiplied by \f$\lambda\f$ to give K(a)
+ */
+static double K_integral(double t,
+                         double beta,
+                         int    N_x)
+{
+    const double upper_limit = (1-sqrt(1-gsl_pow_2(beta)))/beta; // upper limit of integration
+    const double delta_x     = upper_limit/N_x;                  // step length of integration
+    double k = 0;
 
- for(x=lower_limit+delta_x/2;x<upper_limit;x+=delta_x)
- {
-  k+=exp(-beta*a*(1/x-x)/lambda)
-     *(1/gsl_pow_2(x)-1)*delta_x;
- }
- k*=2*pi*beta*a/2;
+    for(int ix = 0; ix < N_x; ++ix)
+    {
+        const double x = (ix+0.5)*delta_x; // dummy variable---see notes!
+
+        k += exp(-t*(1/x-x))*(1/gsl_pow_2(x)-1)*delta_x;
+    }
 
- return(k);
+    return k*pi*t;
 }
 
 /**
@@ -428,21 +869,26 @@ std::valarray<double> pP_calc(const std::valarray<double> &z,
     const auto nz = z.size();    // Number of spatial samples  
     const auto dz = z[1] - z[0]; // Separation between spatial samples [m]
 
-    std::valarray<double> p(nz);
+    arma::vec psi_e_sqr(nz);
+    arma::vec psi_h_sqr(nz);
 
-    // Loop over spatial separation
-    for(unsigned int ia=0; ia<nz; ++ia)
+    for(unsigned int iz = 0; iz < nz; ++iz)
     {
-        p[ia] = 0.0;    // initialize probability to zero
-
-        // Loop over hole location and find p(a) [QWWAD4, 6.23]
-        for(unsigned int iz = 0; iz < nz-ia; ++iz)
-        {
-            p[ia] += (psi_e[iz+ia]*psi_e[iz+ia]*psi_h[iz]*psi_h[iz]
-                     +psi_h[iz+ia]*psi_h[iz+ia]*psi_e[iz]*psi_e[iz]) * dz;
-        }
+        psi_e_sqr[iz] = psi_e[iz]*psi_e[iz];
+        psi_h_sqr[iz] = psi_h[iz]*psi_h[iz];
     }
 
+    // Each term in p(a) [QWWAD4, 6.23] is a cross-correlation of the probability
+    // densities, found here as a convolution with one of them reversed.
+    //   Element nz-1+ia is sum_z |psi_e(z+a)|^2 |psi_h(z)|^2
+    //   Element nz-1-ia is sum_z |psi_h(z+a)|^2 |psi_e(z)|^2
+    const auto corr = convolve_fft(psi_e_sqr, arma::vec(arma::reverse(psi_h_sqr)));
+
+    std::valarray<double> p(nz);
+
+    for(unsigned int ia=0; ia<nz; ++ia)
+        p[ia] = (corr[nz-1+ia] + corr[nz-1-ia]) * dz;
+
     return p;
 }
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -12,13 +12,22 @@
  *           all in SI units.
  */
 
-#include <iostream>
+#include <cstdint>
 #include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
 
 #include "qwwad/constants.h"
 #include "qwwad/file-io.h"
+#include "qwwad/hash.h"
 #include "qwwad/linear-algebra.h"
+#include "qwwad/maths-helpers.h"
+#include "qwwad/parallel.h"
+#include "qwwad/profiler.h"
 #include "qwwad/schroedinger-solver-full.h"
+#include "qwwad/schroedinger-solver-iterative.h"
 #include "qwwad/schroedinger-solver-shooting.h"
 #include "qwwad/schroedinger-solver-taylor.h"
 #include "qwwad/schroedinger-solver-tridiagonal.h"
@@ -29,8 +38,6 @@ using namespace constants;
 
 /** 
  * \brief The type of solver to use
- *
- * \todo Add a MATRIX_ITERATIVE_NONPARABOLIC solver based on a block eigenvalue search for non-parabolic bands
  */
 enum SolverType {
     MATRIX_PARABOLIC,  ///< Matrix method (parabolic bands)
@@ -43,6 +50,16 @@ enum SolverType {
      */
     MATRIX_FULL_NONPARABOLIC,
 
+    /**
+     * \brief   Full nonparabolic matrix method, using sparse storage
+     *
+     * \details This solves the same eigenvalue problem as MATRIX_FULL_NONPARABOLIC, but
+     *          exploits the block-tridiagonal structure of the matrix.  Only the states within
+     *          the search range are found, using a shift-invert Arnoldi iteration, so it is
+     *          much faster and uses far less memory for large meshes.
+     */
+    MATRIX_FULL_NONPARABOLIC_SPARSE,
+
     /**
      * \brief	Approximate method for solving nonparabolic Schroedinger equation
      *
@@ -64,6 +81,15 @@ enum SolverType {
      */
     MATRIX_TAYLOR_NONPARABOLIC,
 
+    /**
+     * \brief   Nonparabolic matrix method, iterating the energy-dependent mass for each state
+     *
+     * \details This solves the same equation as MATRIX_FULL_NONPARABOLIC, but only needs the
+     *          tridiagonal Hamiltonian for a fixed effective mass.  Each state converges in a
+     *          few solutions of this matrix, so it is much faster for a small number of states.
+     */
+    MATRIX_ITERATIVE_NONPARABOLIC,
+
     SHOOTING_PARABOLIC,   ///< Shooting method (parabolic dispersion)
     SHOOTING_NONPARABOLIC ///< Shooting-method using nonparabolic dispersion
 };
@@ -73,13 +99,58 @@ enum SolverType {
  */
 class FwfOptions : public WfOptions {
     private:
-        SolverType type; ///< The type of Schroedinger solver to use
+        SolverType type;        ///< The type of Schroedinger solver to use
+        bool       auto_select; ///< Choose the solver automatically
+        char       particle;    ///< Particle ID when several are solved at once (0 otherwise)
 
     public:
         SolverType get_type() const {return type;}
+        void set_type(const SolverType t) {type = t;}
+
+        /// Check whether the solver should be chosen automatically
+        bool get_auto_select() const {return auto_select;}
+
+        /// Set the particle whose files are used, when several are solved at once
+        void set_particle(const char p) {particle = p;}
+
+        /**
+         * \brief Get the name of a file that is specified by an option
+         *
+         * \param[in] name The name of the option
+         *
+         * \details When several particles are solved at once, the particle ID is
+         *          added to the name before the extension, e.g., "v.r" becomes "v_h.r"
+         */
+        std::string get_filename(const std::string &name) const
+        {
+            auto filename = get_option<std::string>(name);
+
+            if(particle)
+            {
+                const auto dot = filename.rfind('.');
+                filename.insert(dot == std::string::npos ? filename.size() : dot,
+                                std::string("_") + particle);
+            }
+
+            return filename;
+        }
+
+        /// Get the name of the energy file, which is E<p>.r when several particles are solved
+        std::string get_energy_filename() const
+        {
+            return particle ? std::string("E") + particle + ".r" : WfOptions::get_energy_filename();
+        }
+
+        /// Get the wavefunction prefix, which is wf_<p> when several particles are solved
+        std::string get_wf_prefix() const
+        {
+            return particle ? std::string("wf_") + particle : WfOptions::get_wf_prefix();
+        }
 
         FwfOptions(int argc, char* argv[]) :
-            type(MATRIX_PARABOLIC)
+            type(MATRIX_PARABOLIC),
+            auto_select(false),
+            particle(0)
         {
             // No default can be set here... we want the confining potential to be used
             // by default rather than a manually-specified number!
@@ -87,7 +158,7 @@ class FwfOptions : public WfOptions {
             add_option<double>     ("Emax",                  "Upper cut-off energy for solutions [meV]");
             add_option<double>     ("mass",                  "The constant effective mass to use across the entire structure. "
                                                              "If unspecified, the mass profile will be read from file.");
-            add_option<double>     ("dE,d",       1e-3,      "Minimum separation (in energy) between states [meV]. "
+            add_option<double>     ("dE,d",       1e-3,      "Initial energy step [meV] used to extend the search range above the potential. "
                                                              "This is only used with the shooting-method solvers.");
             add_option<std::string>("massfile",  "m.r",      "Filename from which effective mass profile is read. "
                                                              "This is only needed if you are not using constant effective "
@@ -103,6 +174,38 @@ class FwfOptions : public WfOptions {
             add_option<std::string>("solver",     "matrix",  "Set the way in which the Schroedinger "
                                                              "equation is solved. See the manual for "
                                                              "a detailed list of the options");
+            add_option<bool>       ("nonparabolic",          "Account for band nonparabolicity when the solver is chosen "
+                                                             "automatically, using --solver auto.");
+            add_option<bool>       ("numerov",               "Use fourth-order Numerov integration in the shooting-method "
+                                                             "solvers.  This allows a coarser mesh to be used for the same "
+                                                             "accuracy.");
+            add_option<bool>       ("warmstart",             "Use the states in the existing output files as a starting "
+                                                             "point for the calculation.  This is much faster when the "
+                                                             "potential has changed only slightly, e.g., in a bias sweep. "
+                                                             "This only works with the matrix solver.");
+            add_option<bool>       ("wfbinary",              "Write all energies and wavefunctions to a single binary file, "
+                                                             "with the name given by --energyfile, instead of separate "
+                                                             "ASCII files.  Programs that read the states detect the "
+                                                             "binary format automatically.");
+            add_option<std::string>("cachedir",              "Directory in which to cache solutions.  If a previous "
+                                                             "calculation used identical inputs, its solutions are "
+                                                             "read from the cache instead of solving the "
+                                                             "Schroedinger equation again.");
+            add_option<bool>       ("richardson",            "Also solve on meshes with two and four times as many points, "
+                                                             "and extrapolate the energies to the continuum limit.");
+            add_option<std::string>("richardsonfile", "Ee-error.r", "Filename to which the error estimate for each "
+                                                             "extrapolated energy is written [meV].");
+            add_option<double>     ("blochk",                "Treat the structure as a single period of a superlattice, and "
+                                                             "find the states with this Bloch wave vector, as a fraction of "
+                                                             "the Brillouin-zone edge.  This only works with the matrix solvers.");
+            add_option<size_t>     ("nk",         0,         "Number of Bloch wave vectors, from the centre to the edge of the "
+                                                             "Brillouin zone, at which to find the minibands of a single "
+                                                             "period.  These are solved in parallel.");
+            add_option<std::string>("minibandfile", "Ek.r",  "Filename to which the miniband energies are written [meV].");
+            add_option<std::string>("particles",             "Solve for several particles at once, on separate threads, "
+                                                             "e.g., \"eh\" for electrons and heavy holes.  The particle ID "
+                                                             "is added to each input filename, e.g., v_h.r, and the "
+                                                             "states are written to Ee.r, Eh.r, wf_e1.r, wf_h1.r etc.");
 
             std::string doc = "Solve the 1D Schroedinger equation numerically with the effective mass/envelope function approximations.";
 
@@ -115,12 +218,18 @@ class FwfOptions : public WfOptions {
                 type = MATRIX_PARABOLIC;
             else if(!strcmp(solver_arg.c_str(), "matrix-full-nonparabolic"))
                 type = MATRIX_FULL_NONPARABOLIC;
+            else if(!strcmp(solver_arg.c_str(), "matrix-full-nonparabolic-sparse"))
+                type = MATRIX_FULL_NONPARABOLIC_SPARSE;
             else if(!strcmp(solver_arg.c_str(), "matrix-taylor-nonparabolic"))
                 type = MATRIX_TAYLOR_NONPARABOLIC;
+            else if(!strcmp(solver_arg.c_str(), "matrix-iterative-nonparabolic"))
+                type = MATRIX_ITERATIVE_NONPARABOLIC;
             else if(!strcmp(solver_arg.c_str(), "shooting"))
                 type = SHOOTING_PARABOLIC;
             else if(!strcmp(solver_arg.c_str(), "shooting-nonparabolic"))
                 type = SHOOTING_NONPARABOLIC;
+            else if(!strcmp(solver_arg.c_str(), "auto"))
+                auto_select = true;
             else
             {
                 std::ostringstream oss;
@@ -141,10 +250,15 @@ class FwfOptions : public WfOptions {
  *            Also dumps WFs to separate (numbered) files:
  *            IE: wf_e1.dat
  *                wf_e2.dat... etc.
+ *
+ *            If the --wfbinary option is used, all the states are instead written
+ *            to a single binary file, with the name of the energy file.
  */
 static void output(const std::vector<Eigenstate> &solutions, 
                    const FwfOptions              &opt)
 {
+    ScopedTimer timer("output");
+
     // Check solutions were found
     if(solutions.empty())
         std::cerr << "No solutions found!" << std::endl;
@@ -159,36 +273,495 @@ static void output(const std::vector<Eigenstate> &solutions,
                 std::cout << ist << "\t" << std::fixed << solutions[ist].get_energy() * 1000/e << " meV" << std::endl;
         }
 
-        Eigenstate::write_to_file(opt.get_energy_filename(),
-                                  opt.get_wf_prefix(),
-                                  opt.get_wf_ext(),
-                                  solutions,
-                                  true);
+        if(opt.get_argument_known("wfbinary"))
+            Eigenstate::write_to_binary_file(opt.get_energy_filename(), solutions);
+        else
+            Eigenstate::write_to_file(opt.get_energy_filename(),
+                                      opt.get_wf_prefix(),
+                                      opt.get_wf_ext(),
+                                      solutions,
+                                      true);
     }
 }
 
-int main(int argc, char *argv[]){
-    const FwfOptions opt(argc, argv);
+/**
+ * \brief Find the name of the cache entry for a given calculation
+ *
+ * \param[in] opt   User options
+ * \param[in] z     Spatial locations [m]
+ * \param[in] V     Potential profile [J]
+ * \param[in] m     Band-edge effective mass profile [kg]
+ * \param[in] alpha Nonparabolicity profile [1/J]
+ *
+ * \returns A prefix for the cached files, within the cache directory
+ *
+ * \details The name is a hash of every input that affects the solutions, so any
+ *          change in the input profiles or solver settings gives a different entry.
+ */
+static std::string get_cache_prefix(const FwfOptions &opt,
+                                    const arma::vec  &z,
+                                    const arma::vec  &V,
+                                    const arma::vec  &m,
+                                    const arma::vec  &alpha)
+{
+    uint64_t hash = hash_offset_basis;
+
+    for(auto profile : {&z, &V, &m, &alpha})
+        hash_bytes(profile->memptr(), profile->n_elem*sizeof(double), hash);
+
+    std::ostringstream settings;
+    settings << std::setprecision(17)
+             << opt.get_option<std::string>("solver") << ";"
+             << opt.get_option<size_t>("nstmax")      << ";"
+             << opt.get_option<double>("dE")          << ";"
+             << opt.get_argument_known("numerov")     << ";"
+             << opt.get_argument_known("richardson")  << ";";
+
+    if(opt.get_argument_known("Emin"))
+        settings << "Emin=" << opt.get_option<double>("Emin") << ";";
+
+    if(opt.get_argument_known("Emax"))
+        settings << "Emax=" << opt.get_option<double>("Emax") << ";";
+
+    if(opt.get_argument_known("blochk"))
+        settings << "blochk=" << opt.get_option<double>("blochk") << ";";
+
+    const auto settings_str = settings.str();
+    hash_bytes(settings_str.data(), settings_str.size(), hash);
+
+    std::ostringstream prefix;
+    prefix << opt.get_option<std::string>("cachedir") << "/"
+           << format_hash(hash) << "-";
+
+    return prefix.str();
+}
+
+/**
+ * \brief Switch a solver to Bloch-periodic boundaries
+ *
+ * \param[in,out] se The solver
+ * \param[in]     k  Bloch wave vector [1/m]
+ */
+static void set_bloch_wavevector(SchroedingerSolver *se,
+                                 const double        k)
+{
+    if(auto se_tridiag = dynamic_cast<SchroedingerSolverTridiag *>(se))
+        se_tridiag->set_bloch_wavevector(k);
+    else if(auto se_full = dynamic_cast<SchroedingerSolverFull *>(se))
+        se_full->set_bloch_wavevector(k);
+    else
+    {
+        std::cerr << "Bloch-periodic boundaries can only be used with the matrix and "
+                  << "matrix-full-nonparabolic solvers." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * \brief Create a Schroedinger solver of the type requested by the user
+ *
+ * \param[in] opt   User options
+ * \param[in] m     Band-edge effective mass profile [kg]
+ * \param[in] alpha Nonparabolicity profile [1/J]
+ * \param[in] V     Potential profile [J]
+ * \param[in] z     Spatial locations [m]
+ *
+ * \returns A new solver.  Remember to delete it after use!
+ */
+static SchroedingerSolver * create_solver(const FwfOptions &opt,
+                                          const arma::vec  &m,
+                                          const arma::vec  &alpha,
+                                          const arma::vec  &V,
+                                          const arma::vec  &z)
+{
+    const auto nst_max = opt.get_option<size_t>("nstmax");
+    SchroedingerSolver *se = NULL; // Solver for Schroedinger equation
+
+    switch(opt.get_type())
+    {
+        case MATRIX_PARABOLIC:
+            se = new SchroedingerSolverTridiag(m,
+                                               V,
+                                               z,
+                                               nst_max);
+            break;
+        case MATRIX_FULL_NONPARABOLIC:
+            se = new SchroedingerSolverFull(m,
+                                            alpha,
+                                            V,
+                                            z,
+                                            nst_max);
+            break;
+        case MATRIX_FULL_NONPARABOLIC_SPARSE:
+            se = new SchroedingerSolverFull(m,
+                                            alpha,
+                                            V,
+                                            z,
+                                            nst_max,
+                                            true);
+            break;
+        case MATRIX_TAYLOR_NONPARABOLIC:
+            se = new SchroedingerSolverTaylor(m,
+                                              alpha,
+                                              V,
+                                              z,
+                                              nst_max);
+            break;
+        case MATRIX_ITERATIVE_NONPARABOLIC:
+            se = new SchroedingerSolverIterative(m,
+                                                 alpha,
+                                                 V,
+                                                 z,
+                                                 nst_max);
+            break;
+        case SHOOTING_PARABOLIC:
+        case SHOOTING_NONPARABOLIC:
+            se = new SchroedingerSolverShooting(m,
+                                                alpha,
+                                                V,
+                                                z,
+                                                opt.get_option<double>("dE") * e/1000,
+                                                nst_max,
+                                                opt.get_argument_known("numerov"));
+    }
+
+    // Set cut-off energies if desired
+    if(opt.get_argument_known("Emax"))
+    {
+        se->set_E_max(opt.get_option<double>("Emax") * e/1000);
+    }
+
+    if(opt.get_argument_known("Emin"))
+    {
+        se->set_E_min(opt.get_option<double>("Emin") * e/1000);
+    }
+
+    if(opt.get_argument_known("blochk"))
+        set_bloch_wavevector(se, opt.get_option<double>("blochk") * pi/se->get_bloch_period());
+
+    return se;
+}
+
+/**
+ * \brief Cost of a solver, used to choose one automatically
+ *
+ * \details For a mesh of \f$n_z\f$ points and \f$n_{st}\f$ states, the run time is
+ *          estimated as \f$t_p n_z + t_s n_z n_{st}/n_t + t_d (c n_z)^3\f$, where
+ *          \f$c n_z\f$ is the size of the solver's matrix.  \f$n_t\f$ is the number of
+ *          threads that share the states, or one if the states are found together.
+ *          With Bloch-periodic boundaries, the complex eigenvalue problem dominates,
+ *          and the time is \f$t_b (c n_z)^3\f$.
+ *
+ *          The coefficients were fitted to single-core timings of the
+ *          SchroedingerSolver cases in qwwad-benchmarks, to within about 25%.
+ */
+struct SolverCost
+{
+    SolverType  type;         ///< The solver
+    const char *name;         ///< Name of the solver, as given to --solver
+    bool        nonparabolic; ///< True if the solver accounts fully for nonparabolicity
+    bool        nonuniform;   ///< True if the solver can use a non-uniform mesh
+    bool        bloch;        ///< True if the solver can use Bloch-periodic boundaries
+    bool        parallel;     ///< True if the states are shared between threads
+    unsigned    order;        ///< Size of the solver's matrix, in units of the mesh size
+    double      t_point;      ///< Time per mesh point [s]
+    double      t_state;      ///< Time per mesh point, per state [s]
+    double      t_dense;      ///< Time per element of the cubed matrix size [s]
+    double      t_bloch;      ///< Time per element of the cubed matrix size, for Bloch boundaries [s]
+};
+
+/// The solvers that may be chosen automatically.  The Taylor solver is excluded,
+/// since it is only approximate
+static const SolverCost solver_costs[] = {
+    {MATRIX_PARABOLIC,                "matrix",                          false, true,  true,  false, 1, 1.9e-7, 4.7e-7, 0,      5.2e-10},
+    {SHOOTING_PARABOLIC,              "shooting",                        false, false, false, true,  1, 3.5e-8, 1.4e-7, 0,      0},
+    {MATRIX_ITERATIVE_NONPARABOLIC,   "matrix-iterative-nonparabolic",   true,  true,  false, true,  1, 0,      3.3e-6, 0,      0},
+    {MATRIX_FULL_NONPARABOLIC_SPARSE, "matrix-full-nonparabolic-sparse", true,  false, true,  false, 3, 8.0e-6, 7.5e-9, 0,      5.9e-9},
+    {MATRIX_FULL_NONPARABOLIC,        "matrix-full-nonparabolic",        true,  false, true,  false, 3, 0,      0,      1.5e-9, 5.9e-9},
+    {SHOOTING_NONPARABOLIC,           "shooting-nonparabolic",           true,  false, false, true,  1, 3.4e-8, 1.4e-7, 0,      0}
+};
+
+/**
+ * \brief Choose the fastest solver that includes the physics requested by the user
+ *
+ * \param[in] opt User options
+ * \param[in] m   Band-edge effective mass profile [kg]
+ * \param[in] V   Potential profile [J]
+ * \param[in] z   Spatial locations [m]
+ *
+ * \details If the number of states isn't given, it is estimated by counting the
+ *          parabolic states between the cut-off energies.  Solvers that need a uniform
+ *          mesh or can't use Bloch-periodic boundaries are skipped where necessary, and
+ *          only the shooting solvers are considered if a trial energy is given.  The
+ *          choice is reported to the user.
+ *
+ * \returns The type of solver
+ */
+static SolverType select_solver(const FwfOptions &opt,
+                                const arma::vec  &m,
+                                const arma::vec  &V,
+                                const arma::vec  &z)
+{
+    const double nz           = z.size();
+    const bool   nonparabolic = opt.get_argument_known("nonparabolic");
+    const bool   bloch        = opt.get_argument_known("blochk") || opt.get_option<size_t>("nk") > 0;
+    const bool   uniform      = is_uniform_mesh(z);
+    const bool   trial        = opt.get_argument_known("tryenergy");
+
+    double nst = opt.get_option<size_t>("nstmax");
+
+    if(nst == 0)
+    {
+        const double E_max = opt.get_argument_known("Emax") ? opt.get_option<double>("Emax") * e/1000
+                                                            : V.max();
+        const SchroedingerSolverIterative se(m, arma::zeros(z.size()), V, z);
+        unsigned int n = se.count_states(E_max);
+
+        if(opt.get_argument_known("Emin"))
+        {
+            const auto n_min = se.count_states(opt.get_option<double>("Emin") * e/1000);
+            n = (n > n_min) ? n - n_min : 0;
+        }
+
+        nst = GSL_MAX(n, 1);
+    }
+
+    const SolverCost *best   = nullptr;
+    double            t_best = 0;
+
+    for(const auto &cost : solver_costs)
+    {
+        const bool shooting = (cost.type == SHOOTING_PARABOLIC || cost.type == SHOOTING_NONPARABOLIC);
+
+        if(cost.nonparabolic != nonparabolic || (bloch && !cost.bloch) ||
+           (!uniform && !cost.nonuniform) || (trial && !shooting))
+            continue;
+
+        const double n_threads = cost.parallel ? GSL_MIN(nst, get_thread_count()) : 1;
+        const double n_matrix  = cost.order*nz;
+
+        const double t = bloch ? cost.t_bloch*gsl_pow_3(n_matrix)
+                               : cost.t_point*nz + cost.t_state*nz*nst/n_threads
+                                 + cost.t_dense*gsl_pow_3(n_matrix);
+
+        if(!best || t < t_best)
+        {
+            best   = &cost;
+            t_best = t;
+        }
+    }
+
+    if(!best)
+    {
+        std::cerr << "None of the " << (nonparabolic ? "nonparabolic" : "parabolic")
+                  << " solvers can be used with these options";
+
+        if(!uniform)
+            std::cerr << " on a non-uniform mesh";
+
+        std::cerr << ".  Choose one using --solver." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::cout << "Using the " << best->name << " solver for " << nst << " states on "
+              << z.size() << " points (estimated time " << t_best << " s)." << std::endl;
 
+    return best->type;
+}
+
+/**
+ * \brief Split every cell of a mesh into equal sub-cells
+ *
+ * \param[in] z Position at the middle of each cell [m]
+ * \param[in] k Number of sub-cells in each cell
+ *
+ * \returns Position at the middle of each sub-cell [m]
+ */
+static arma::vec refine_positions(const arma::vec    &z,
+                                  const unsigned int  k)
+{
+    const size_t nz = z.size();
+    arma::vec z_fine(nz*k);
+
+    for(unsigned int iz = 0; iz < nz; ++iz)
+    {
+        // Cell edges lie halfway between points, with the mesh mirrored at each end
+        const double z_lo = (iz == 0)    ? z[0]    - 0.5*(z[1]    - z[0])    : 0.5*(z[iz-1] + z[iz]);
+        const double z_hi = (iz == nz-1) ? z[nz-1] + 0.5*(z[nz-1] - z[nz-2]) : 0.5*(z[iz]   + z[iz+1]);
+
+        for(unsigned int j = 0; j < k; ++j)
+            z_fine[iz*k + j] = z_lo + (j+0.5)*(z_hi - z_lo)/k;
+    }
+
+    return z_fine;
+}
+
+/**
+ * \brief Copy the value in every cell of a profile into each of its sub-cells
+ *
+ * \details The profile stays piecewise-constant, so abrupt interfaces are kept
+ *          in exactly the same place on every mesh.
+ */
+static arma::vec refine_profile(const arma::vec    &f,
+                                const unsigned int  k)
+{
+    arma::vec f_fine(f.size()*k);
+
+    for(unsigned int iz = 0; iz < f.size(); ++iz)
+        f_fine.subvec(iz*k, iz*k + k - 1).fill(f[iz]);
+
+    return f_fine;
+}
+
+/**
+ * \brief Extrapolate the energies of the states to the continuum limit
+ *
+ * \param[in] opt       User options
+ * \param[in] m         Band-edge effective mass profile [kg]
+ * \param[in] alpha     Nonparabolicity profile [1/J]
+ * \param[in] V         Potential profile [J]
+ * \param[in] z         Spatial locations [m]
+ * \param[in] solutions States found on the input mesh
+ *
+ * \returns The states on the input mesh, with extrapolated energies
+ *
+ * \details The problem is solved again on meshes with 2 and 4 times as many
+ *          points, and the energy of each state is Richardson-extrapolated.  The
+ *          error estimate and observed order of convergence are written to file.
+ *          Only states that are found on every mesh are kept.
+ */
+static std::vector<Eigenstate> extrapolate_solutions(const FwfOptions              &opt,
+                                                     const arma::vec               &m,
+                                                     const arma::vec               &alpha,
+                                                     const arma::vec               &V,
+                                                     const arma::vec               &z,
+                                                     const std::vector<Eigenstate> &solutions)
+{
+    std::vector<std::vector<Eigenstate>> levels(1, solutions);
+
+    for(unsigned int k : {2, 4})
+    {
+        auto se = create_solver(opt,
+                                refine_profile(m, k),
+                                refine_profile(alpha, k),
+                                refine_profile(V, k),
+                                refine_positions(z, k));
+        levels.push_back(se->get_solutions(true));
+        delete se;
+    }
+
+    size_t nst = solutions.size();
+
+    for(const auto &level : levels)
+        nst = std::min(nst, level.size());
+
+    std::vector<Eigenstate> result;
+    arma::vec error(nst);
+    arma::vec order(nst);
+
+    for(unsigned int ist = 0; ist < nst; ++ist)
+    {
+        const double E = richardson_extrapolate(levels[0][ist].get_energy(),
+                                                levels[1][ist].get_energy(),
+                                                levels[2][ist].get_energy(),
+                                                error[ist],
+                                                order[ist]);
+
+        result.push_back(Eigenstate(E, solutions[ist].get_position_grid(),
+                                    solutions[ist].get_wavefunction_samples()));
+    }
+
+    if(opt.get_verbose())
+    {
+        std::cout << "Richardson-extrapolated energies:" << std::endl;
+
+        for(unsigned int ist = 0; ist < nst; ++ist)
+            std::cout << ist << "\t" << std::fixed << result[ist].get_energy()*1000/e << " ± "
+                      << error[ist]*1000/e << " meV (order " << order[ist] << ")" << std::endl;
+    }
+
+    const arma::vec ist_col = arma::linspace(1, nst, nst);
+    const arma::vec error_meV = error*1000/e;
+    write_table(opt.get_filename("richardsonfile"), ist_col, error_meV, order);
+
+    return result;
+}
+
+/**
+ * \brief Find the minibands of a single period of a superlattice
+ *
+ * \param[in] opt   User options
+ * \param[in] m     Band-edge effective mass profile [kg]
+ * \param[in] alpha Nonparabolicity profile [1/J]
+ * \param[in] V     Potential profile [J] for a single period
+ * \param[in] z     Spatial locations [m] for a single period
+ *
+ * \details The states are found for a set of Bloch wave vectors between the centre
+ *          and the edge of the Brillouin zone.  Each wave vector is solved
+ *          independently, so they are shared between threads.  The energy of each
+ *          miniband is written to file as a function of wave vector.
+ */
+static void write_minibands(const FwfOptions &opt,
+                            const arma::vec  &m,
+                            const arma::vec  &alpha,
+                            const arma::vec  &V,
+                            const arma::vec  &z)
+{
+    ScopedTimer timer("minibands");
+
+    const auto nk = opt.get_option<size_t>("nk");
+
+    // Superlattice period [m], as used for the Bloch boundaries in each solver
+    const double L = std::unique_ptr<SchroedingerSolver>(create_solver(opt, m, alpha, V, z))->get_bloch_period();
+    const arma::vec k = (nk > 1) ? arma::linspace(0, pi/L, nk) : arma::zeros(1);
+
+    std::vector< std::vector<Eigenstate> > bands(k.size());
+
+    run_in_parallel(k.size(), 0, [&](const size_t ik) {
+        ScopedTraceEvent event("k-point");
+        std::unique_ptr<SchroedingerSolver> se(create_solver(opt, m, alpha, V, z));
+        set_bloch_wavevector(se.get(), k[ik]);
+        bands[ik] = se->get_solutions(true);
+    });
+
+    // Only write the minibands that were found at every wave vector
+    size_t nst = bands[0].size();
+
+    for(const auto &band : bands)
+        nst = std::min(nst, band.size());
+
+    if(nst == 0)
+        std::cerr << "No minibands found!" << std::endl;
+
+    TableWriter stream(opt.get_filename("minibandfile"));
+
+    for(unsigned int ik = 0; ik < k.size(); ++ik)
+    {
+        stream << k[ik];
+
+        for(unsigned int ist = 0; ist < nst; ++ist)
+            stream << '\t' << bands[ik][ist].get_energy();
+
+        stream << '\n';
+    }
+}
+
+/**
+ * \brief Find and output the states of a single particle
+ *
+ * \param[in,out] opt User options.  The solver type is filled in if it is chosen automatically.
+ */
+static void solve(FwfOptions &opt)
+{
     // Read data from file
     arma::vec z; // Spatial locations [m]
     arma::vec V; // Potential profile [J]
-    read_table(opt.get_option<std::string>("totalpotentialfile").c_str(), z, V);
+    read_table(opt.get_filename("totalpotentialfile").c_str(), z, V);
 
     const size_t nz = z.size();
     const double dz = z[1] - z[0];
 
     arma::vec z_tmp;
-    arma::vec alpha = arma::zeros(nz); // Nonparabolicity parameter [1/J]
-
-    // Read nonparabolicity data from file if needed
-    if(opt.get_type() == MATRIX_TAYLOR_NONPARABOLIC ||
-       opt.get_type() == MATRIX_FULL_NONPARABOLIC   ||
-       opt.get_type() == SHOOTING_NONPARABOLIC)
-    {
-        read_table(opt.get_option<std::string>("alphafile").c_str(), z_tmp, alpha);
-    }
-
     arma::vec m = arma::zeros(nz); // Band-edge effective mass [kg]
 
     // Set a constant effective mass if specified.
@@ -199,7 +772,22 @@ int main(int argc, char *argv[]){
     }
     else
     {
-        read_table(opt.get_option<std::string>("massfile").c_str(), z_tmp, m);
+        read_table(opt.get_filename("massfile").c_str(), z_tmp, m);
+    }
+
+    if(opt.get_auto_select())
+        opt.set_type(select_solver(opt, m, V, z));
+
+    arma::vec alpha = arma::zeros(nz); // Nonparabolicity parameter [1/J]
+
+    // Read nonparabolicity data from file if needed
+    if(opt.get_type() == MATRIX_TAYLOR_NONPARABOLIC ||
+       opt.get_type() == MATRIX_FULL_NONPARABOLIC   ||
+       opt.get_type() == MATRIX_FULL_NONPARABOLIC_SPARSE ||
+       opt.get_type() == MATRIX_ITERATIVE_NONPARABOLIC ||
+       opt.get_type() == SHOOTING_NONPARABOLIC)
+    {
+        read_table(opt.get_filename("alphafile").c_str(), z_tmp, alpha);
     }
 
     // By default, we set the number of states automatically
@@ -211,7 +799,7 @@ int main(int argc, char *argv[]){
     // proceed
     if(gsl_fcmp(V.max(), V.min(), 1e-6*e) == 0 && nst_max == 0 && opt.get_argument_known("Ecutoff"))
     {
-        std::cerr << "Flat potential detected in " << opt.get_option<std::string>("totalpotentialfile")
+        std::cerr << "Flat potential detected in " << opt.get_filename("totalpotentialfile")
                   << ".  You must either specify a cut-off energy using --E-cutoff "
                   << "or a number of states using --nst-max" << std::endl;
         exit(EXIT_FAILURE);
@@ -231,49 +819,42 @@ int main(int argc, char *argv[]){
                     << dz*1e9 << "nm." << std::endl;
     }
 
-    SchroedingerSolver *se = NULL; // Solver for Schroedinger equation
+    // Reuse the solutions from an identical calculation if possible
+    std::string cache_prefix;
 
-    switch(opt.get_type())
+    if(opt.get_argument_known("cachedir") && !opt.get_argument_known("tryenergy"))
     {
-        case MATRIX_PARABOLIC:
-            se = new SchroedingerSolverTridiag(m,
-                                               V,
-                                               z,
-                                               nst_max);
-            break;
-        case MATRIX_FULL_NONPARABOLIC:
-            se = new SchroedingerSolverFull(m,
-                                            alpha,
-                                            V,
-                                            z,
-                                            nst_max);
-            break;
-        case MATRIX_TAYLOR_NONPARABOLIC:
-            se = new SchroedingerSolverTaylor(m,
-                                              alpha,
-                                              V,
-                                              z,
-                                              nst_max);
-            break;
-        case SHOOTING_PARABOLIC:
-        case SHOOTING_NONPARABOLIC:
-            se = new SchroedingerSolverShooting(m,
-                                                alpha,
-                                                V,
-                                                z,
-                                                opt.get_option<double>("dE") * e/1000,
-                                                nst_max);
-    }
+        cache_prefix = get_cache_prefix(opt, z, V, m, alpha);
 
-    // Set cut-off energies if desired
-    if(opt.get_argument_known("Emax"))
-    {
-        se->set_E_max(opt.get_option<double>("Emax") * e/1000);
+        if(std::ifstream(cache_prefix + "E.r").good())
+        {
+            if(opt.get_verbose())
+                std::cout << "Reading solutions from cache: " << cache_prefix << "E.r" << std::endl;
+
+            const auto solutions = Eigenstate::read_from_file(cache_prefix + "E.r",
+                                                              cache_prefix + "wf_",
+                                                              ".r",
+                                                              1.0,
+                                                              true);
+            output(solutions, opt);
+
+            if(opt.get_option<size_t>("nk") > 0)
+                write_minibands(opt, m, alpha, V, z);
+
+            return;
+        }
     }
 
-    if(opt.get_argument_known("Emin"))
+    auto se = create_solver(opt, m, alpha, V, z);
+
+    // Start from the previous set of solutions if desired
+    if(opt.get_argument_known("warmstart"))
     {
-        se->set_E_min(opt.get_option<double>("Emin") * e/1000);
+        se->set_initial_guess(Eigenstate::read_from_file(opt.get_energy_filename(),
+                                                         opt.get_wf_prefix(),
+                                                         opt.get_wf_ext(),
+                                                         1000.0/e,
+                                                         true));
     }
 
     // Output a single trial wavefunction
@@ -294,11 +875,58 @@ int main(int argc, char *argv[]){
     }
     else // Output all wavefunctions
     {
-        const auto solutions = se->get_solutions(true);
+        auto solutions = se->get_solutions(true);
+
+        if(opt.get_argument_known("richardson") && !solutions.empty())
+            solutions = extrapolate_solutions(opt, m, alpha, V, z, solutions);
+
         output(solutions, opt);
+
+        if(opt.get_option<size_t>("nk") > 0)
+            write_minibands(opt, m, alpha, V, z);
+
+        if(!cache_prefix.empty() && !solutions.empty())
+        {
+            Eigenstate::write_to_file(cache_prefix + "E.r",
+                                      cache_prefix + "wf_",
+                                      ".r",
+                                      solutions,
+                                      true);
+        }
     }
 
     delete se;
+}
+
+int main(int argc, char *argv[]){
+    FwfOptions opt(argc, argv);
+
+    if(!opt.get_argument_known("particles"))
+    {
+        solve(opt);
+        return EXIT_SUCCESS;
+    }
+
+    // Solve each particle on its own thread, with its own copy of the options
+    const auto particles = opt.get_option<std::string>("particles");
+    std::vector<FwfOptions> particle_opts(particles.size(), opt);
+
+    for(unsigned int ip = 0; ip < particles.size(); ++ip)
+    {
+        const char p = particles[ip];
+
+        if(p != 'e' && p != 'h' && p != 'l')
+        {
+            std::cerr << "Unknown particle ID: " << p << ".  Use 'e', 'h' or 'l'." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        particle_opts[ip].set_particle(p);
+    }
+
+    run_in_parallel(particles.size(), particles.size(), [&](const size_t ip) {
+        solve(particle_opts[ip]);
+    });
 
     return EXIT_SUCCESS;
 }
@@ -11,6 +11,7 @@
 #include <valarray>
 #include <gsl/gsl_math.h>
 #include "qwwad/constants.h"
+#include "qwwad/file-io.h"
 #include "qwwad/schroedinger-solver-infinite-well.h"
 #include "qwwad/options.h"
 
@@ -37,6 +38,7 @@ Options configure_options(int argc, char* argv[])
     opt.add_option<double>("Emin",               "Lower cut-off energy for solutions [meV]");
     opt.add_option<double>("Emax",               "Upper cut-off energy for solutions [meV]");
     opt.add_option<double>("barrierwidth", 0.00, "Width of barriers [angstrom]");
+    opt.add_option<bool>  ("energiesonly",       "Only write the energies of the states, and not the wave functions.");
 
     opt.add_prog_specific_options_and_parse(argc, argv, doc);
 
@@ -75,6 +77,18 @@ int main(int argc, char *argv[])
     char energy_filename[9];
     sprintf(energy_filename,"E%c.r",p);
 
+    // The wave functions are only sampled if they are written
+    if(opt.get_option<bool>("energiesonly"))
+    {
+        arma::vec E(solutions.size());
+
+        for(unsigned int ist = 0; ist < solutions.size(); ++ist)
+            E[ist] = solutions[ist].get_energy();
+
+        write_table(energy_filename, E, true, 17);
+        return EXIT_SUCCESS;
+    }
+
     char wf_prefix[9];
     sprintf(wf_prefix,"wf_%c",p);
     Eigenstate::write_to_file(energy_filename,
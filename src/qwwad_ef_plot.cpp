@@ -17,6 +17,7 @@
 #include "qwwad/constants.h"
 #include "qwwad/eigenstate.h"
 #include "qwwad/file-io.h"
+#include "qwwad/maths-helpers.h"
 #include "qwwad/wf_options.h"
 
 using namespace QWWAD;
@@ -36,6 +37,9 @@ WfOptions configure_options(int argc, char* argv[])
     opt.add_option<size_t>     ("nstmax",                10,   "Maximum number of states to plot.");
     opt.add_option<std::string>("style",                "pd",  "Style of plot: 'pd' = probability density, 'wf' = wave functions.");
     opt.add_option<bool>       ("scalebynstates",              "Scale the wavefunctions by the number of states");
+    opt.add_option<double>     ("decimatetol",          0.0,   "Largest error in each plotted curve when removing redundant points, "
+                                                               "as a fraction of its full range.  If zero, all points are plotted.");
+    opt.add_option<size_t>     ("maxpoints",              0,   "Maximum number of points in each plotted curve (0 = no limit).");
 
     opt.add_prog_specific_options_and_parse(argc, argv, summary);
 
@@ -79,6 +83,42 @@ static double scaling_factor(const std::vector<Eigenstate> &states,
     return scale;
 }
 
+/**
+ * \brief Write a curve to the plot file, leaving out redundant points
+ *
+ * \param[in] plot_stream The plot file
+ * \param[in] x           Location of each point [angstrom]
+ * \param[in] y           Value at each point [meV]
+ * \param[in] tol         Largest error permitted in the plotted curve, as a fraction
+ *                        of its range
+ * \param[in] max_points  Maximum number of points to plot (0 = no limit)
+ *
+ * \details If the tolerance and point limit are both zero, every point is written.
+ *          The tolerance is relative, as in qwwad_ef_plot_3d.
+ */
+static void write_curve(FILE            *plot_stream,
+                        const arma::vec &x,
+                        const arma::vec &y,
+                        const double     tol,
+                        const size_t     max_points)
+{
+    if(x.size() == 0)
+        return;
+
+    if(tol <= 0 && max_points == 0)
+    {
+        for(unsigned int i = 0; i < x.size(); ++i)
+            fprintf(plot_stream, "%e\t%e\n", x[i], y[i]);
+    }
+    else
+    {
+        const double y_range = y.max() - y.min();
+
+        for(auto const i : decimate_curve(x, y, tol*y_range, max_points))
+            fprintf(plot_stream, "%e\t%e\n", x[i], y[i]);
+    }
+}
+
 /**
  * \brief Outputs scaled plot of probability densities in
  * 	  quantum well system
@@ -104,9 +144,11 @@ static void output_plot(const WfOptions               &opt,
         exit(EXIT_FAILURE);
     }
 
+    const auto tol        = opt.get_option<double>("decimatetol");
+    const auto max_points = opt.get_option<size_t>("maxpoints");
+
     // Output conduction band profile
-    for(unsigned int iz=0; iz < nz; iz++)
-        fprintf(plot_stream, "%e\t%e\n", z[iz]*1e10, V[iz]/(1e-3*e));
+    write_curve(plot_stream, z*1e10, V/(1e-3*e), tol, max_points);
 
     unsigned int nst_plotted=0; // Counter to limit number of plotted states
 
@@ -124,30 +166,42 @@ static void output_plot(const WfOptions               &opt,
 
             double P_left = 0.0; // probability of electron being found on left of a point
 
-            // Plot scaled probability density
+            // Find the part of the wavefunction with appreciable amplitude
+            // TODO: Make this configurable
+            unsigned int iz_first = nz;
+            unsigned int iz_last  = 0;
+
             for(unsigned int iz = 0; iz < nz; iz++)
             {
                 P_left += PD[iz]*dz;
 
-                // Only plot the bits of the wavefunction with appreciable
-                // amplitude
-                // TODO: Make this configurable
                 if(P_left>0.0001 && P_left<0.9999)
                 {
-                    const auto E = st.get_energy();
-
-                    if (style == "wf")
-                    {
-                        double scale_wf = (V.max()-V.min())/((psi.max() - psi.min()) * states.size() * 2);
-                        fprintf(plot_stream, "%e\t%e\n", z[iz]*1e10,
-                                (psi[iz]*scale_wf + E)/(1e-3*e));
-                    }
-                    else
-                        fprintf(plot_stream, "%e\t%e\n", z[iz]*1e10,
-                                (PD[iz]*scale + E)/(1e-3*e));
+                    if(iz_first == nz)
+                        iz_first = iz;
+
+                    iz_last = iz;
                 }
             }
 
+            if(iz_first < nz)
+            {
+                const auto E = st.get_energy();
+                const arma::vec z_plot = z.subvec(iz_first, iz_last)*1e10;
+                arma::vec y_plot;
+
+                // Plot scaled wavefunction or probability density
+                if (style == "wf")
+                {
+                    double scale_wf = (V.max()-V.min())/((psi.max() - psi.min()) * states.size() * 2);
+                    y_plot = (psi.subvec(iz_first, iz_last)*scale_wf + E)/(1e-3*e);
+                }
+                else
+                    y_plot = (PD.subvec(iz_first, iz_last)*scale + E)/(1e-3*e);
+
+                write_curve(plot_stream, z_plot, y_plot, tol, max_points);
+            }
+
             ++nst_plotted;
         }
     }
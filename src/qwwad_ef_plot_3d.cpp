@@ -17,6 +17,7 @@
 #include "qwwad/constants.h"
 #include "qwwad/eigenstate.h"
 #include "qwwad/file-io.h"
+#include "qwwad/maths-helpers.h"
 #include "qwwad/wf_options.h"
 
 using namespace QWWAD;
@@ -36,12 +37,66 @@ WfOptions configure_options(int argc, char* argv[])
     opt.add_option<size_t>     ("nstmax",                10,   "Maximum number of states to plot.");
     opt.add_option<std::string>("style",                "pd",  "Style of plot: 'pd' = probability density, 'wf' = wave functions.");
     opt.add_option<bool>       ("scalebynstates",              "Scale the wavefunctions by the number of states");
+    opt.add_option<double>     ("decimatetol",          0.0,   "Largest error in each plotted curve when removing redundant positions, "
+                                                               "as a fraction of its full range.  If zero, all positions are plotted.");
+    opt.add_option<size_t>     ("maxpoints",              0,   "Maximum number of positions to keep for each curve (0 = no limit).");
 
     opt.add_prog_specific_options_and_parse(argc, argv, summary);
 
     return opt;
 }
 
+/**
+ * \brief Find the positions needed to plot a set of states to within a tolerance
+ *
+ * \param[in] states     The states to plot
+ * \param[in] V          The potential profile [J]
+ * \param[in] z          Spatial locations [m]
+ * \param[in] tol        Largest error in each curve, as a fraction of its range
+ * \param[in] max_points Maximum number of positions to keep for each curve (0 = no limit)
+ *
+ * \returns The indices of the positions to keep, in ascending order
+ *
+ * \details The potential and the probability density of each state are decimated
+ *          separately, and a position is kept if it is needed for any of them.
+ */
+static arma::uvec find_plot_positions(const std::vector<Eigenstate> &states,
+                                      const arma::vec               &V,
+                                      const arma::vec               &z,
+                                      const double                   tol,
+                                      const size_t                   max_points)
+{
+    const auto nz = z.size();
+
+    if(tol <= 0 && max_points == 0)
+        return arma::linspace<arma::uvec>(0, nz-1, nz);
+
+    std::vector<char> keep(nz, 0);
+
+    const double V_range = V.max() - V.min();
+
+    for(auto const iz : decimate_curve(z, V, tol*V_range, max_points))
+        keep[iz] = 1;
+
+    for(auto const &state : states)
+    {
+        const auto PD = state.get_PD();
+
+        for(auto const iz : decimate_curve(z, PD/PD.max(), tol, max_points))
+            keep[iz] = 1;
+    }
+
+    std::vector<arma::uword> indices;
+
+    for(unsigned int iz = 0; iz < nz; ++iz)
+    {
+        if(keep[iz])
+            indices.push_back(iz);
+    }
+
+    return arma::conv_to<arma::uvec>::from(indices);
+}
+
 int main(int argc, char* argv[])
 {
     const auto opt = configure_options(argc, argv);
@@ -105,15 +160,40 @@ int main(int argc, char* argv[])
         plotdata(index_E, iz) = 1.5;
     }
 
-    std::ofstream mapfile("vwf.xyz");
-    mapfile << plotdata;
+    // Only write the positions needed to show each curve accurately
+    const auto tol        = opt.get_option<double>("decimatetol");
+    const auto max_points = opt.get_option<size_t>("maxpoints");
+    const auto iz_plot    = find_plot_positions(states, V, z, tol, max_points);
+
+    // Write the plot data as a whitespace-separated matrix
+    TableWriter mapfile("vwf.xyz");
+
+    for (unsigned int iE = 0; iE < plotdata.n_rows; ++iE)
+    {
+        for (auto const iz : iz_plot)
+            mapfile << ' ' << plotdata(iE, iz);
+
+        mapfile << '\n';
+    }
 
     // Generate MATLAB script to plot datafile
     std::ofstream gpfile("plotfile.m");
     gpfile << "figure;\n"
-           << "imgdata = load('vwf.xyz');\n"
-           << "xscale = linspace(" << z.min()*1e10 << "," << z.max()*1e10 << "," << z.size() << ");\n"
-           << "yscale = linspace(" << E_min*1000/e << "," << E_max*1000/e << "," << nE       << ");\n"
+           << "imgdata = load('vwf.xyz');\n";
+
+    if(iz_plot.size() == z.size())
+        gpfile << "xscale = linspace(" << z.min()*1e10 << "," << z.max()*1e10 << "," << z.size() << ");\n";
+    else
+    {
+        gpfile << "xscale = [";
+
+        for (auto const iz : iz_plot)
+            gpfile << ' ' << z[iz]*1e10;
+
+        gpfile << "];\n";
+    }
+
+    gpfile << "yscale = linspace(" << E_min*1000/e << "," << E_max*1000/e << "," << nE       << ");\n"
            << "colormap hot;\n"
            << "surf(xscale, yscale, imgdata, 'EdgeColor', 'None', 'FaceColor', 'interp');\n"
            << "view(2);\n"
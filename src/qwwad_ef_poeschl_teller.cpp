@@ -9,6 +9,7 @@
 #include <iostream>
 
 #include "qwwad/options.h"
+#include "qwwad/parameter-sweep.h"
 #include "qwwad/constants.h"
 #include "qwwad/file-io.h"
 #include "qwwad/schroedinger-solver-poeschl-teller.h"
@@ -34,6 +35,8 @@ Options configure_options(int argc, char* argv[])
                                                       "that all states will be found up to maximum confining potential.");
     opt.add_option<char>  ("particle,p",       'e',   "ID of particle to be used: 'e', 'h' or 'l', for electrons, "
                                                       "heavy holes or light holes respectively.");
+    add_sweep_options(opt, "'widthparameter' or 'depthparameter'", 0.1);
+    opt.add_option<bool>       ("energiesonly",          "Only write the energies of the states, and not the wave functions.");
 
     opt.add_prog_specific_options_and_parse(argc, argv, doc);
 
@@ -59,20 +62,57 @@ int main(int argc,char *argv[])
         std::cout << "mass   = " << m      << " kg" << std::endl;
     }
 
+    if(opt.get_argument_known("sweep"))
+    {
+        const auto param      = opt.get_option<std::string>("sweep");
+        const auto x          = get_sweep_values(opt);
+        arma::vec  alpha_all  = alpha * arma::ones(x.size());
+        arma::vec  lambda_all = lambda * arma::ones(x.size());
+
+        if(param == "widthparameter")
+            alpha_all = x * 1e10;
+        else if(param == "depthparameter")
+            lambda_all = x;
+        else
+        {
+            std::cerr << "Unrecognised sweep parameter: " << param << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        write_sweep(opt.get_option<std::string>("sweepfile"), x,
+                    SchroedingerSolverPoeschlTeller::sweep(alpha_all, lambda_all, m, nst_max));
+
+        return EXIT_SUCCESS;
+    }
+
     SchroedingerSolverPoeschlTeller se(alpha, lambda, L, m, nz, nst_max);
+    const auto solutions = se.get_solutions(true);
 
     // Dump to file
     char energy_filename[9];
     sprintf(energy_filename,"E%c.r",p);
 
-    char wf_prefix[9];
-    sprintf(wf_prefix,"wf_%c",p);
+    // The wave functions are only sampled if they are written
+    if(opt.get_option<bool>("energiesonly"))
+    {
+        arma::vec E(solutions.size());
+
+        for(unsigned int ist = 0; ist < solutions.size(); ++ist)
+            E[ist] = solutions[ist].get_energy();
 
-    Eigenstate::write_to_file(energy_filename,
-                              wf_prefix,
-                              ".r",
-                              se.get_solutions(true),
-                              true);
+        write_table(energy_filename, E, true, 17);
+    }
+    else
+    {
+        char wf_prefix[9];
+        sprintf(wf_prefix,"wf_%c",p);
+
+        Eigenstate::write_to_file(energy_filename,
+                                  wf_prefix,
+                                  ".r",
+                                  solutions,
+                                  true);
+    }
 
     write_table("v.r", se.get_z(), se.get_V());
     
@@ -0,0 +1,169 @@
+/**
+ * \file   qwwad_ef_sensitivity.cpp
+ * \brief  Find the sensitivity of subband energies and dipoles to the layer structure
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ *
+ * \details The gradients with respect to the width and alloy fraction of every
+ *          layer are found from a single set of eigenstates, using first-order
+ *          perturbation theory.  This replaces the pair of extra solutions per
+ *          layer that a finite-difference gradient would need.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "qwwad/constants.h"
+#include "qwwad/eigenstate.h"
+#include "qwwad/file-io.h"
+#include "qwwad/structure-sensitivity.h"
+#include "qwwad/wf_options.h"
+
+using namespace QWWAD;
+using namespace constants;
+
+/**
+ * Configure command-line options for the program
+ */
+WfOptions configure_options(int argc, char* argv[])
+{
+    WfOptions opt;
+
+    std::string summary("Find the sensitivity of subband energies and dipole matrix elements to "
+                        "the width and alloy fraction of each layer.");
+
+    opt.add_option<std::string>("potentialfile",  "v.r",          "Filename from which the potential profile [J] is read.");
+    opt.add_option<std::string>("massfile",       "m.r",          "Filename from which the effective mass profile [kg] is read. "
+                                                                  "This is only needed if you are not using constant effective "
+                                                                  "mass.");
+    opt.add_option<double>     ("mass",                           "The constant effective mass to use across the entire structure. "
+                                                                  "If unspecified, the mass profile will be read from file.");
+    opt.add_option<std::string>("interfacesfile", "interfaces.r", "Filename from which the interface locations are read.");
+    opt.add_option<double>     ("dVdx",                           "Change in potential per unit alloy fraction [meV].  "
+                                                                  "This depends on the material system, so it must be given "
+                                                                  "(e.g., 836 for electrons in AlGaAs).");
+    opt.add_option<double>     ("dmdx",                           "Change in effective mass per unit alloy fraction (relative "
+                                                                  "to free electron).  This must also be given (e.g., 0.083 "
+                                                                  "for electrons in AlGaAs).");
+    opt.add_option<double>     ("field",                       0, "Electric field that is included in the potential profile "
+                                                                  "[kV/cm].");
+    opt.add_option<size_t>     ("lower",                          "Index of the lower state of a transition (from 1).  If this "
+                                                                  "and --upper are given, the sensitivity of the dipole matrix "
+                                                                  "element is found.");
+    opt.add_option<size_t>     ("upper",                          "Index of the upper state of a transition (from 1).");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, summary);
+
+    if(!opt.get_argument_known("dVdx") || !opt.get_argument_known("dmdx"))
+    {
+        std::cerr << "Both --dVdx and --dmdx must be specified." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return opt;
+}
+
+int main(int argc,char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    const auto states = Eigenstate::read_from_file(opt.get_energy_filename(),
+                                                   opt.get_wf_prefix(),
+                                                   opt.get_wf_ext(),
+                                                   1000.0/e,
+                                                   true);
+
+    arma::vec z; // Spatial locations [m]
+    arma::vec V; // Potential profile [J]
+    read_table(opt.get_option<std::string>("potentialfile"), z, V);
+
+    const size_t nz = z.size();
+    arma::vec    m  = arma::zeros(nz); // Band-edge effective mass [kg]
+
+    if(opt.get_argument_known("mass"))
+        m += opt.get_option<double>("mass") * me;
+    else
+    {
+        arma::vec z_m;
+        read_table(opt.get_option<std::string>("massfile"), z_m, m);
+    }
+
+    arma::uvec iz_I; // Index of the first sample above each layer
+    read_table(opt.get_option<std::string>("interfacesfile"), iz_I);
+
+    const bool find_dipole = opt.get_argument_known("lower") && opt.get_argument_known("upper");
+    size_t     i_lower     = 0;
+    size_t     i_upper     = 0;
+
+    if(find_dipole)
+    {
+        i_lower = opt.get_option<size_t>("lower") - 1;
+        i_upper = opt.get_option<size_t>("upper") - 1;
+
+        if(i_lower >= states.size() || i_upper >= states.size())
+        {
+            std::cerr << "The transition must be between two of the " << states.size()
+                      << " states." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    try
+    {
+        const StructureSensitivity sensitivity(states, V, m, iz_I);
+
+        const size_t    nL    = sensitivity.get_n_layers();
+        const size_t    nst   = sensitivity.get_n_states();
+        const arma::vec dV_dx = arma::ones(nz) * opt.get_option<double>("dVdx") * e/1000;
+        const arma::vec dm_dx = arma::ones(nz) * opt.get_option<double>("dmdx") * me;
+
+        const double    F     = opt.get_option<double>("field")*1e5; // Electric field [V/m]
+
+        const auto W_width = sensitivity.get_layer_width_perturbations(F);
+
+        TableWriter width_stream("dE-dW.r");
+        TableWriter alloy_stream("dE-dx.r");
+        arma::vec   dz_dW(nL); // Sensitivity of dipole to layer width
+        arma::vec   dz_dx(nL); // Sensitivity of dipole to alloy fraction [angstrom]
+
+        for(unsigned int iL = 0; iL < nL; ++iL)
+        {
+            const arma::mat W_alloy = sensitivity.get_alloy_perturbation(iL, dV_dx, dm_dx);
+
+            // Rescale to meV/angstrom and meV per unit alloy fraction for output
+            const arma::vec dE_dW = StructureSensitivity::get_energy_gradient(W_width[iL])*1e-10/(1e-3*e);
+            const arma::vec dE_dx = StructureSensitivity::get_energy_gradient(W_alloy)/(1e-3*e);
+
+            width_stream << iL+1;
+            alloy_stream << iL+1;
+
+            for(unsigned int ist = 0; ist < nst; ++ist)
+            {
+                width_stream << '\t' << dE_dW[ist];
+                alloy_stream << '\t' << dE_dx[ist];
+            }
+
+            width_stream << '\n';
+            alloy_stream << '\n';
+
+            if(find_dipole)
+            {
+                dz_dW[iL] = sensitivity.get_dipole_gradient(W_width[iL])(i_upper, i_lower);
+                dz_dx[iL] = sensitivity.get_dipole_gradient(W_alloy)(i_upper, i_lower)*1e10;
+            }
+        }
+
+        if(find_dipole)
+        {
+            const arma::vec iL_out = arma::linspace(1, nL, nL);
+            write_table("dz-dW.r", iL_out, dz_dW, dz_dx);
+        }
+    }
+    catch(std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
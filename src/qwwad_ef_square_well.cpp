@@ -12,6 +12,7 @@
 #include "qwwad/constants.h"
 #include "qwwad/schroedinger-solver-finite-well.h"
 #include "qwwad/options.h"
+#include "qwwad/parameter-sweep.h"
 #include "qwwad/file-io.h"
 
 using namespace QWWAD;
@@ -47,6 +48,7 @@ Options configure_options(int argc, char* argv[])
     opt.add_option<double>("barrierpotential",  100, "Barrier potential [meV]");
     opt.add_option<double>("Emin",                   "Lower cut-off energy for solutions [meV]");
     opt.add_option<double>("Emax",                   "Upper cut-off energy for solutions [meV]");
+    add_sweep_options(opt, "'wellwidth' or 'barrierpotential'", 1);
 
     opt.add_prog_specific_options_and_parse(argc, argv, summary);
 
@@ -65,6 +67,29 @@ int main(int argc,char *argv[])
     const auto state = opt.get_option<size_t>("nst");
     const auto N     = opt.get_option<size_t>("nz");               // number of spatial steps
 
+    if(opt.get_argument_known("sweep"))
+    {
+        const auto param = opt.get_option<std::string>("sweep");
+        const auto x     = get_sweep_values(opt);
+        arma::vec  l_w   = a * arma::ones(x.size());
+        arma::vec  V0    = V * arma::ones(x.size());
+
+        if(param == "wellwidth")
+            l_w = x * 1e-10;
+        else if(param == "barrierpotential")
+            V0 = x * e/1000;
+        else
+        {
+            std::cerr << "Unrecognised sweep parameter: " << param << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        write_sweep(opt.get_option<std::string>("sweepfile"), x,
+                    SchroedingerSolverFiniteWell::sweep(l_w, V0, m_w, m_b, state));
+
+        return EXIT_SUCCESS;
+    }
+
     SchroedingerSolverFiniteWell se(a, b, V, m_w, m_b, N, state);
 
     // Set cut-off energies if desired
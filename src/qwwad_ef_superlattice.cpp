@@ -8,6 +8,7 @@
 #include <cstdlib>
 #include <valarray>
 #include "qwwad/options.h"
+#include "qwwad/parameter-sweep.h"
 #include "qwwad/constants.h"
 #include "qwwad/file-io.h"
 #include "qwwad/schroedinger-solver-kronig-penney.h"
@@ -36,6 +37,8 @@ Options configure_options(int argc, char* argv[])
     opt.add_option<size_t>("nst,s",              1,  "Number of states to find");
     opt.add_option<double>("barrierpotential", 100,  "Barrier potential [meV]");
     opt.add_option<double>("Ecutoff",                "Cut-off energy for solutions [meV]");
+    add_sweep_options(opt, "'wavevector', 'wellwidth', 'barrierwidth' or 'barrierpotential'", 0.1);
+    opt.add_option<unsigned int>("threads",             0, "Number of threads to use in a parameter sweep (0 = one per CPU core).");
     
     opt.add_prog_specific_options_and_parse(argc, argv, summary);
 
@@ -56,6 +59,39 @@ int main(int argc,char *argv[])
     const auto k    = opt.get_option<double>("wavevector") * pi/(a+b);   // [1/m]
     const auto N    = opt.get_option<size_t>("nz");               // number of spatial steps
 
+    if(opt.get_argument_known("sweep"))
+    {
+        const auto param = opt.get_option<std::string>("sweep");
+        const auto x     = get_sweep_values(opt);
+        arma::vec  l_w   = a * arma::ones(x.size());
+        arma::vec  l_b   = b * arma::ones(x.size());
+        arma::vec  V0    = V * arma::ones(x.size());
+        arma::vec  k_rel = opt.get_option<double>("wavevector") * arma::ones(x.size()); // [pi/L]
+
+        if(param == "wavevector")
+            k_rel = x;
+        else if(param == "wellwidth")
+            l_w = x * 1e-10;
+        else if(param == "barrierwidth")
+            l_b = x * 1e-10;
+        else if(param == "barrierpotential")
+            V0 = x * e/1000;
+        else
+        {
+            std::cerr << "Unrecognised sweep parameter: " << param << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        // Wave vector is relative to the period, which may change along the sweep
+        const arma::vec k_sweep = k_rel * pi / (l_w + l_b);
+
+        write_sweep(opt.get_option<std::string>("sweepfile"), x,
+                    SchroedingerSolverKronigPenney::sweep(l_w, l_b, V0, k_sweep, m_w, m_b, nst,
+                                                          opt.get_option<unsigned int>("threads")));
+
+        return EXIT_SUCCESS;
+    }
+
     SchroedingerSolverKronigPenney se(a, b, V, m_w, m_b, k, N, 4, nst);
 
     // Set cut-off energy if desired
@@ -0,0 +1,169 @@
+/**
+ * \file   qwwad_ef_valence_kp.cpp
+ * \brief  Find coupled valence-band states using a multiband k.p model
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ *
+ * \details The heavy-, light- and split-off hole bands are coupled using the 4x4
+ *          or 6x6 Luttinger-Kohn Hamiltonian.  The Luttinger parameters and the
+ *          spin-orbit splitting at each point are taken from the material library,
+ *          using the alloy profile.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "qwwad/constants.h"
+#include "qwwad/file-io.h"
+#include "qwwad/material.h"
+#include "qwwad/material-library.h"
+#include "qwwad/material-property-numeric.h"
+#include "qwwad/maths-helpers.h"
+#include "qwwad/options.h"
+#include "qwwad/valence-band-solver.h"
+
+using namespace QWWAD;
+using namespace constants;
+
+/**
+ * \brief Configure command-line options for the program
+ */
+static Options configure_options(int argc, char* argv[])
+{
+    Options opt;
+
+    std::string doc("Find coupled heavy-, light- and split-off hole states using a multiband "
+                    "k.p model.");
+
+    opt.add_option<std::string> ("potentialfile",     "v.r", "Filename from which the hole potential profile [J] is read.");
+    opt.add_option<std::string> ("alloyfile",         "x.r", "Filename from which the alloy profile is read.");
+    opt.add_option<std::string> ("material",       "AlGaAs", "Name of the alloy system in the material library.");
+    opt.add_option<std::string> ("materialfile",         "", "Material library file to read. If this is not specified, "
+                                                             "the default material library for the system will be used.");
+    opt.add_option<unsigned int>("nbands",                6, "Number of bands: 4 (heavy and light holes) or 6 (with split-off holes).");
+    opt.add_option<unsigned int>("nst,s",                 4, "Number of states to find.");
+    opt.add_option<double>      ("Emin",                     "Lowest hole energy to find [meV].  If an energy range is given, "
+                                                             "all states in the range are found instead of a fixed number.");
+    opt.add_option<double>      ("Emax",                     "Highest hole energy to find [meV].");
+    opt.add_option<double>      ("kt",                    0, "In-plane wave vector at which to find the states [1/angstrom].");
+    opt.add_option<size_t>      ("nk",                    0, "Number of in-plane wave vectors at which to find the dispersion.  "
+                                                             "If this is zero, the dispersion is not found.");
+    opt.add_option<double>      ("kmax",               0.05, "Largest in-plane wave vector for the dispersion [1/angstrom].");
+    opt.add_option<unsigned int>("threads",               0, "Number of threads to use (0 = one per CPU core).");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, doc);
+
+    return opt;
+}
+
+int main(int argc, char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    arma::vec z; // Spatial locations [m]
+    arma::vec V; // Hole potential profile [J]
+    read_table(opt.get_option<std::string>("potentialfile"), z, V);
+
+    arma::vec z_x; // Spatial locations in alloy file [m]
+    arma::vec x;   // Alloy fraction
+    read_table(opt.get_option<std::string>("alloyfile"), z_x, x);
+
+    const size_t nz = z.size();
+
+    if(x.size() != nz)
+    {
+        std::cerr << "The alloy profile has " << x.size() << " samples, but the potential profile has "
+                  << nz << "." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    const auto nb  = opt.get_option<unsigned int>("nbands");
+    const auto nst = opt.get_option<unsigned int>("nst");
+
+    try
+    {
+        MaterialLibrary lib(opt.get_option<std::string>("materialfile"));
+        const auto mat = lib.get_material(opt.get_option<std::string>("material"));
+
+        const arma::vec gamma1 = mat->get_property_value("luttinger-gamma1", x);
+        const arma::vec gamma2 = mat->get_property_value("luttinger-gamma2", x);
+        const arma::vec gamma3 = mat->get_property_value("luttinger-gamma3", x);
+        const arma::vec Delta  = (nb == 6) ? arma::vec(mat->get_property_value("spin-orbit-splitting", x)*e)
+                                           : arma::vec(arma::zeros(nz));
+
+        const ValenceBandSolver solver(z, V, gamma1, gamma2, gamma3, Delta, nb);
+
+        const double kt = opt.get_option<double>("kt") * 1e10;
+
+        std::vector<ValenceBandState> states;
+
+        if(opt.get_argument_known("Emin") || opt.get_argument_known("Emax"))
+        {
+            const double E_min = opt.get_argument_known("Emin") ? opt.get_option<double>("Emin") * e/1000
+                                                                : V.min();
+            const double E_max = opt.get_argument_known("Emax") ? opt.get_option<double>("Emax") * e/1000
+                                                                : V.max();
+            states = solver.get_states(kt, E_min, E_max);
+        }
+        else
+            states = solver.get_lowest_states(kt, nst);
+
+        // Write the energy of each state, along with its heavy- and light-hole
+        // character
+        TableWriter energies("E_kp.r");
+
+        for(unsigned int ist = 0; ist < states.size(); ++ist)
+        {
+            const arma::mat P = arma::square(arma::abs(states[ist].psi)); // Probability density in each band
+            const arma::vec P_hh = P.col(0) + P.col(3);
+            const arma::vec P_lh = P.col(1) + P.col(2);
+            const arma::vec P_so = (nb == 6) ? arma::vec(P.col(4) + P.col(5)) : arma::vec(arma::zeros(nz));
+
+            const arma::vec P_total = P_hh + P_lh + P_so;
+            const double    total   = integral(P_total, z);
+
+            energies << ist+1                        << '\t'
+                     << states[ist].E*1000/e         << '\t'
+                     << integral(P_hh, z)/total      << '\t'
+                     << integral(P_lh, z)/total      << '\n';
+
+            std::ostringstream wf_filename;
+            wf_filename << "wf_kp" << ist+1 << ".r";
+
+            if(nb == 6)
+                write_table(wf_filename.str(), z, P_hh, P_lh, P_so);
+            else
+                write_table(wf_filename.str(), z, P_hh, P_lh);
+        }
+
+        const auto nk = opt.get_option<size_t>("nk");
+
+        if(nk > 0)
+        {
+            const auto      n_threads = opt.get_option<unsigned int>("threads");
+            const arma::vec k         = arma::linspace(0, opt.get_option<double>("kmax") * 1e10, nk);
+            const arma::mat E_k       = solver.get_dispersion(k, nst, n_threads);
+
+            TableWriter dispersion("E_kp-k.r");
+
+            for(unsigned int ik = 0; ik < nk; ++ik)
+            {
+                dispersion << k[ik]/1e10;
+
+                for(unsigned int ist = 0; ist < nst; ++ist)
+                    dispersion << '\t' << E_k(ik, ist)*1000/e;
+
+                dispersion << '\n';
+            }
+        }
+    }
+    catch(std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
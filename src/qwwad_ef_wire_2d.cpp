@@ -0,0 +1,196 @@
+/**
+ * \file    qwwad_ef_wire_2d.cpp
+ * \brief   Find the eigenstates of a quantum wire with an arbitrary cross-section
+ * \author  Alex Valavanis <a.valavanis@leeds.ac.uk>
+ *
+ * \details The alloy composition over the cross-section is built from a list of
+ *          rectangles, and the potential and effective mass at each point are
+ *          taken from the material library.  The 2D Schroedinger equation is then
+ *          solved on a rectangular finite-difference mesh.
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "qwwad/constants.h"
+#include "qwwad/file-io.h"
+#include "qwwad/material.h"
+#include "qwwad/material-library.h"
+#include "qwwad/material-property-numeric.h"
+#include "qwwad/options.h"
+#include "qwwad/schroedinger-solver-wire.h"
+
+using namespace QWWAD;
+using namespace constants;
+
+/**
+ * \brief Configure command-line options for the program
+ */
+static Options configure_options(int argc, char* argv[])
+{
+    Options opt;
+
+    std::string doc("Find the eigenstates of a quantum wire with an arbitrary cross-section.");
+
+    opt.add_option<std::string> ("crosssectionfile", "cross-section.r", "File listing the rectangles of alloy in the cross-section.");
+    opt.add_option<double>      ("xbackground",             0, "Alloy fraction outside all of the rectangles.");
+    opt.add_option<double>      ("width",                 300, "Width of the simulation region in y [angstrom].");
+    opt.add_option<double>      ("height",                300, "Height of the simulation region in z [angstrom].");
+    opt.add_option<size_t>      ("ny",                     61, "Number of samples in y.");
+    opt.add_option<size_t>      ("nz",                     61, "Number of samples in z.");
+    opt.add_option<size_t>      ("nst,s",                   1, "Number of states to find.");
+    opt.add_option<double>      ("tol",                 1e-3, "Convergence threshold for the residual of each state [meV].");
+    opt.add_option<std::string> ("material",          "AlGaAs", "Name of the alloy system in the material library.");
+    opt.add_option<std::string> ("materialfile",            "", "Material library file to read. If this is not specified, "
+                                                                "the default material library for the system will be used.");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, doc);
+
+    return opt;
+}
+
+/**
+ * \brief Read the alloy composition over the cross-section
+ *
+ * \param[in] opt User options
+ * \param[in] y   Sample locations in y [m]
+ * \param[in] z   Sample locations in z [m]
+ *
+ * \returns The alloy fraction at each point (ny x nz)
+ *
+ * \details Each line of the file contains "y1 y2 z1 z2 x", which sets the alloy
+ *          fraction to x inside the rectangle y1 <= y <= y2, z1 <= z <= z2. The
+ *          limits are in angstrom.  Later rectangles override earlier ones.
+ */
+static arma::mat read_cross_section(const Options   &opt,
+                                    const arma::vec &y,
+                                    const arma::vec &z)
+{
+    const auto filename = opt.get_option<std::string>("crosssectionfile");
+    arma::mat x = opt.get_option<double>("xbackground") * arma::ones(y.size(), z.size());
+
+    std::ifstream stream(filename.c_str());
+
+    if(!stream)
+    {
+        std::cerr << "Cannot open " << filename << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::string line;
+    unsigned int iline = 0;
+
+    while(std::getline(stream, line))
+    {
+        ++iline;
+
+        if(line.find_first_not_of(" \t\r") == std::string::npos || line[line.find_first_not_of(" \t")] == '#')
+            continue;
+
+        std::istringstream iss(line);
+        double y1, y2, z1, z2, x_rect;
+
+        if(!(iss >> y1 >> y2 >> z1 >> z2 >> x_rect))
+        {
+            std::cerr << "Expected 'y1 y2 z1 z2 x' at line " << iline << " of " << filename << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        for(unsigned int iy = 0; iy < y.size(); ++iy)
+        {
+            for(unsigned int iz = 0; iz < z.size(); ++iz)
+            {
+                if(y[iy] >= y1*1e-10 && y[iy] <= y2*1e-10 && z[iz] >= z1*1e-10 && z[iz] <= z2*1e-10)
+                    x(iy,iz) = x_rect;
+            }
+        }
+    }
+
+    return x;
+}
+
+int main(int argc, char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    const auto ny  = opt.get_option<size_t>("ny");
+    const auto nz  = opt.get_option<size_t>("nz");
+    const auto nst = opt.get_option<size_t>("nst");
+
+    const arma::vec y = arma::linspace(0, opt.get_option<double>("width")*1e-10,  ny);
+    const arma::vec z = arma::linspace(0, opt.get_option<double>("height")*1e-10, nz);
+    const arma::mat x = read_cross_section(opt, y, z);
+
+    MaterialLibrary lib(opt.get_option<std::string>("materialfile"));
+    arma::mat V(ny, nz); // Conduction-band edge [J]
+    arma::mat m(ny, nz); // Effective mass [kg]
+
+    try
+    {
+        const auto mat = lib.get_material(opt.get_option<std::string>("material"));
+
+        // Use the band-edge directly where it is tabulated. Otherwise, take a
+        // fixed fraction of the change in bandgap relative to x = 0.
+        const bool   has_Vcb = mat->has_property("Vcb-Gamma");
+        const double Eg0     = has_Vcb ? 0 : mat->get_property_value("bandgap-Gamma", 0.0);
+        const double Qc      = has_Vcb ? 0 : mat->get_property_value("Vcb-Gamma-bandgap-factor", 0.0);
+
+        for(unsigned int iy = 0; iy < ny; ++iy)
+        {
+            for(unsigned int iz = 0; iz < nz; ++iz)
+            {
+                const double Ec = has_Vcb ? mat->get_property_value("Vcb-Gamma", x(iy,iz))
+                                          : Qc*(mat->get_property_value("bandgap-Gamma", x(iy,iz)) - Eg0);
+
+                V(iy,iz) = Ec*e;
+                m(iy,iz) = mat->get_property_value("electron-effective-mass-Gamma", x(iy,iz))*me;
+            }
+        }
+    }
+    catch(std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    try
+    {
+        SchroedingerSolverWire se(y, z, V, m, nst, opt.get_option<double>("tol")*e/1000);
+
+        const arma::vec E = se.get_energies()*1000/e;
+        write_table("Ee.r", E, true, 17);
+
+        // Write each wavefunction as a list of points, with z running fastest
+        arma::vec y_out(ny*nz);
+        arma::vec z_out(ny*nz);
+
+        for(unsigned int iy = 0; iy < ny; ++iy)
+        {
+            for(unsigned int iz = 0; iz < nz; ++iz)
+            {
+                y_out[iy*nz + iz] = y[iy];
+                z_out[iy*nz + iz] = z[iz];
+            }
+        }
+
+        for(unsigned int ist = 0; ist < nst; ++ist)
+        {
+            const arma::mat psi     = se.get_wavefunction(ist);
+            const arma::vec psi_out = arma::vectorise(psi.t());
+
+            std::ostringstream filename;
+            filename << "wf_e" << ist+1 << ".r";
+            write_table(filename.str(), y_out, z_out, psi_out);
+        }
+    }
+    catch(std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
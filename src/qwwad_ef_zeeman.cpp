@@ -8,12 +8,18 @@
 #include <iostream>
 #include <cstdlib>
 #include <cmath>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
 #include <gsl/gsl_math.h>
 #include "struct.h"
 #include "qwwad/constants.h"
 #include "qwwad/file-io.h"
 #include "qwwad/maths-helpers.h"
 #include "qwwad/options.h"
+#include "qwwad/parallel.h"
+#include "qwwad/schroedinger-solver-shooting.h"
 
 using namespace QWWAD;
 using namespace constants;
@@ -62,6 +68,133 @@ static double Seff(const double N0alpha,
     return s;
 }
 
+/**
+ * \brief Alloy-dependent parameters for the Zeeman splitting
+ *
+ * \details A heterostructure only contains a few distinct alloy fractions, so
+ *          the parameters are found once for each of them, rather than at every
+ *          spatial point.
+ */
+struct ZeemanTable
+{
+    arma::vec  T0;    ///< Effective temperature for each alloy fraction [K]
+    arma::vec  A_sat; ///< Saturation value of the A exchange term for each alloy fraction [J]
+    arma::vec  B_sat; ///< Saturation value of the B exchange term for each alloy fraction [J]
+    arma::uvec index; ///< Index of the alloy fraction at each spatial point
+};
+
+/**
+ * \brief Tabulate the Zeeman parameters for each distinct alloy fraction
+ *
+ * \param[in] x       Alloy fraction at each point
+ * \param[in] N0alpha Magnetic parameter [J]
+ * \param[in] N0beta  Magnetic parameter [J]
+ */
+static ZeemanTable make_zeeman_table(const arma::vec &x,
+                                     const double     N0alpha,
+                                     const double     N0beta)
+{
+    std::map<double, unsigned int> alloy_index;
+    ZeemanTable table;
+    table.index.set_size(x.size());
+
+    for(unsigned int iz = 0; iz < x.size(); ++iz)
+    {
+        auto it = alloy_index.find(x[iz]);
+
+        if(it == alloy_index.end())
+            it = alloy_index.insert(std::make_pair(x[iz], static_cast<unsigned int>(alloy_index.size()))).first;
+
+        table.index[iz] = it->second;
+    }
+
+    const auto nx = alloy_index.size();
+    table.T0.set_size(nx);
+    table.A_sat.set_size(nx);
+    table.B_sat.set_size(nx);
+
+    for(auto const &entry : alloy_index)
+    {
+        const double       x_val = entry.first;
+        const unsigned int ix    = entry.second;
+        const double       Sz    = Seff(N0alpha, N0beta, x_val);
+
+        table.T0[ix]    = Teff(x_val);
+        table.A_sat[ix] = x_val*N0alpha*Sz/6;
+        table.B_sat[ix] = x_val*N0beta *Sz/6;
+    }
+
+    return table;
+}
+
+/**
+ * \brief Find the Zeeman potential for a given field and temperature
+ *
+ * \param[in] table  Tabulated alloy-dependent parameters
+ * \param[in] J      Magnetic ion spin
+ * \param[in] MF     Magnetic field along growth axis [T]
+ * \param[in] Tl     Lattice temperature [K]
+ * \param[in] p      Particle ID
+ * \param[in] spinup True for spin-up states
+ *
+ * \returns The Zeeman potential at each point [J]
+ *
+ * \details The field adds +/- 3A, +/- 3B or +/- B depending on spin.  The
+ *          Brillouin function is only found once for each alloy fraction.
+ */
+static arma::vec zeeman_potential(const ZeemanTable &table,
+                                  const double       J,
+                                  const double       MF,
+                                  const double       Tl,
+                                  const char         p,
+                                  const bool         spinup)
+{
+    const auto nx = table.T0.size();
+    arma::vec V_alloy(nx); // Zeeman potential for each alloy fraction [J]
+
+    for(unsigned int ix = 0; ix < nx; ++ix)
+    {
+        const double y = 2*J*mu_b*MF/(kB*(Tl+table.T0[ix]));
+
+        // The Brillouin function vanishes at zero field
+        const double BJ = (y == 0) ? 0 : sf_brillouin(J,y);
+
+        switch(p)
+        {
+            case 'e':
+                V_alloy[ix] = (spinup ? 3 : -3)*table.A_sat[ix]*BJ;
+                break;
+            case 'h':
+                V_alloy[ix] = (spinup ? 3 : -3)*table.B_sat[ix]*BJ;
+                break;
+            case 'l':
+                V_alloy[ix] = table.B_sat[ix]*BJ;
+                break;
+            default:
+                V_alloy[ix] = 0;
+        }
+    }
+
+    return V_alloy.elem(table.index);
+}
+
+/**
+ * \brief Insert the index of a grid point into a filename, before the extension
+ */
+static std::string get_grid_filename(const std::string  &name,
+                                     const unsigned int  iB,
+                                     const unsigned int  iT)
+{
+    const auto dot = name.rfind('.');
+    std::ostringstream oss;
+    oss << name.substr(0, dot) << "-B" << iB+1 << "-T" << iT+1;
+
+    if(dot != std::string::npos)
+        oss << name.substr(dot);
+
+    return oss.str();
+}
+
 /**
  * \brief Configure command-line options for the program
  */
@@ -80,12 +213,173 @@ Options configure_options(int argc, char* argv[])
     opt.add_option<std::string>("bandedgepotentialfile",  "v_b.r", "File containing baseline potential to be added to Zeeman potential");
     opt.add_option<std::string>("totalpotentialfile",       "v.r", "Filename to which the total potential is written.");
     opt.add_option<std::string>("zeemanpotentialfile",    "v_z.r", "Filename to which the Zeeman potential is written.");
+    opt.add_option<std::string>("fields",                          "Comma-separated list of magnetic fields [T].  If this or "
+                                                                   "--temperatures is given, a profile is found for every "
+                                                                   "combination of field and temperature.");
+    opt.add_option<std::string>("temperatures",                    "Comma-separated list of lattice temperatures [K], for a grid "
+                                                                   "of profiles.");
+    opt.add_option<std::string>("gridfile",     "zeeman-grid.r",   "Filename to which the field and temperature at each grid point are written.");
+    opt.add_option<bool>       ("solve",                           "Find the energies in the total potential (or in each profile "
+                                                                   "of the grid), using the shooting method.  The effective mass "
+                                                                   "is read from m.r.");
+    opt.add_option<size_t>     ("nst,s",                        1, "Number of states to find in each profile, with --solve.");
+    opt.add_option<double>     ("dE,d",                       0.1, "Initial energy step for the shooting method, with --solve [meV].");
+    opt.add_option<std::string>("energyfile",  "E-zeeman.r",       "Filename to which the field, temperature and energies [meV] "
+                                                                   "are written, with --solve.");
+    opt.add_option<unsigned int>("threads",                     0, "Number of grid points to solve at once (0 = one per CPU core).");
 
     opt.add_prog_specific_options_and_parse(argc, argv, doc);
 
     return opt;
 };
 
+/**
+ * \brief Read the effective mass profile for finding the states
+ *
+ * \param[in] z Spatial locations in the potential profile [m]
+ *
+ * \returns The band-edge effective mass at each point [kg]
+ */
+static arma::vec read_mass(const arma::vec &z)
+{
+    arma::vec z_tmp;
+    arma::vec m; // Band-edge effective mass [kg]
+    read_table("m.r", z_tmp, m);
+
+    if(m.size() != z.size())
+    {
+        std::cerr << "The mass file m.r must have the same length as the potential." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return m;
+}
+
+/**
+ * \brief Find the energies of the states in a total potential
+ *
+ * \param[in] opt User options
+ * \param[in] m   Band-edge effective mass [kg]
+ * \param[in] V   Total potential [J]
+ * \param[in] z   Spatial locations [m]
+ *
+ * \returns The energy of each state [meV]
+ */
+static arma::vec find_energies(const Options   &opt,
+                               const arma::vec &m,
+                               const arma::vec &V,
+                               const arma::vec &z)
+{
+    const auto nst = opt.get_option<size_t>("nst");
+    const auto dE  = opt.get_option<double>("dE")*e/1000;
+
+    SchroedingerSolverShooting se(m, arma::zeros(z.size()), V, z, dE, nst);
+    const auto solutions = se.get_solutions(true);
+
+    arma::vec E(solutions.size());
+
+    for(unsigned int ist = 0; ist < solutions.size(); ++ist)
+        E[ist] = solutions[ist].get_energy();
+
+    return E;
+}
+
+/**
+ * \brief Write the energies at each field and temperature to the energy file
+ *
+ * \param[in] opt    User options
+ * \param[in] B_grid Magnetic field at each point [T]
+ * \param[in] T_grid Lattice temperature at each point [K]
+ * \param[in] E      Energies of the states at each point [meV]
+ */
+static void write_energies(const Options                &opt,
+                           const arma::vec              &B_grid,
+                           const arma::vec              &T_grid,
+                           const std::vector<arma::vec> &E)
+{
+    TableWriter stream(opt.get_option<std::string>("energyfile"), 17);
+
+    for(unsigned int ipt = 0; ipt < E.size(); ++ipt)
+    {
+        stream << B_grid[ipt] << '\t' << T_grid[ipt];
+
+        for(auto const E_st : E[ipt])
+            stream << '\t' << E_st;
+
+        stream << '\n';
+    }
+}
+
+/**
+ * \brief Find the Zeeman potential over a grid of fields and temperatures
+ *
+ * \param[in] opt   User options
+ * \param[in] table Tabulated alloy-dependent parameters
+ * \param[in] J     Magnetic ion spin
+ * \param[in] z     Spatial locations [m]
+ * \param[in] Vb    Band-edge potential [J]
+ *
+ * \details A pair of potential files is written for each grid point, with the
+ *          grid indices inserted before the extension, e.g., v-B2-T1.r.  If
+ *          requested, the states in each total potential are found as well.
+ */
+static void sweep_grid(const Options     &opt,
+                       const ZeemanTable &table,
+                       const double       J,
+                       const arma::vec   &z,
+                       const arma::vec   &Vb)
+{
+    const auto p      = opt.get_option<char>("particle");
+    const auto spinup = opt.get_option<bool>("spinup");
+
+    auto fields = opt.get_numeric_list("fields");
+    auto temps  = opt.get_numeric_list("temperatures");
+
+    if(fields.empty())
+        fields.push_back(opt.get_option<double>("magneticfield"));
+
+    if(temps.empty())
+        temps.push_back(opt.get_option<double>("Tl"));
+
+    const auto nB   = fields.size();
+    const auto nT   = temps.size();
+    const auto npts = nB*nT;
+
+    const auto totalpotentialfile  = opt.get_option<std::string>("totalpotentialfile");
+    const auto zeemanpotentialfile = opt.get_option<std::string>("zeemanpotentialfile");
+    const auto solve               = opt.get_option<bool>("solve");
+    const arma::vec m              = solve ? read_mass(z) : arma::vec(); // Band-edge effective mass [kg]
+
+    std::vector<arma::vec> E(npts); // Energies at each grid point [meV]
+
+    run_in_parallel(npts, get_thread_count(opt.get_option<unsigned int>("threads")), [&](const size_t ipt) {
+        const unsigned int iB = ipt / nT;
+        const unsigned int iT = ipt % nT;
+
+        const arma::vec V_zeeman = zeeman_potential(table, J, fields[iB], temps[iT], p, spinup);
+        const arma::vec V_total  = Vb + V_zeeman;
+
+        write_table(get_grid_filename(totalpotentialfile,  iB, iT), z, V_total);
+        write_table(get_grid_filename(zeemanpotentialfile, iB, iT), z, V_zeeman);
+
+        if(solve)
+            E[ipt] = find_energies(opt, m, V_total, z);
+    });
+
+    arma::vec B_grid(npts);
+    arma::vec T_grid(npts);
+
+    for(unsigned int ipt = 0; ipt < npts; ++ipt)
+    {
+        B_grid[ipt] = fields[ipt / nT];
+        T_grid[ipt] = temps[ipt % nT];
+    }
+
+    write_table(opt.get_option<std::string>("gridfile"), B_grid, T_grid, true);
+
+    if(solve)
+        write_energies(opt, B_grid, T_grid, E);
+}
 
 int main(int argc,char *argv[])
 {
@@ -114,45 +408,27 @@ int main(int argc,char *argv[])
     const auto bandedgefilename = opt.get_option<std::string>("bandedgepotentialfile");
     read_table(bandedgefilename, z, Vb);
 
-    const auto nz = z.size(); // Number of spatial points
-
     // TODO: Check that alloy file uses same coordinates
     arma::vec z_tmp;
     arma::vec x;     // Alloy fraction at each point
     read_table("x.r", z_tmp, x);
 
-    arma::vec V_zeeman(nz);
-
-    // Add field in the form +/- 3A, +/- 3B or +/- B depending on spin
-    for(unsigned int iz=0; iz<nz; iz++)
+    if(x.size() != z.size())
     {
-        const double T0 = Teff(x[iz]); // Effective temperature
-        const double Sz = Seff(N0alpha,N0beta,x[iz]);
-
-        const double y = 2*J*mu_b*MF/(kB*(Tl+T0));
+        std::cerr << "The alloy file x.r must have the same length as the potential." << std::endl;
+        exit(EXIT_FAILURE);
+    }
 
-        const double A=x[iz]*N0alpha*Sz*sf_brillouin(J,y)/6;
-        const double B=x[iz]*N0beta *Sz*sf_brillouin(J,y)/6;
+    const auto table = make_zeeman_table(x, N0alpha, N0beta);
 
-        // calculate change in potential due to magnetic field
-        switch(p)
-        {
-            case 'e': 
-                if(spinup) V_zeeman[iz] =  3*A;
-                else       V_zeeman[iz] = -3*A;
-                break;
-            case 'h':
-                if(spinup) V_zeeman[iz] =  3*B;
-                else       V_zeeman[iz] = -3*B;
-                break;
-            case 'l': 
-                if(spinup) V_zeeman[iz] = B;
-                else       V_zeeman[iz] = B;
-                break;
-        }
+    if(opt.get_argument_known("fields") || opt.get_argument_known("temperatures"))
+    {
+        sweep_grid(opt, table, J, z, Vb);
+        return EXIT_SUCCESS;
     }
 
-    const arma::vec V_total = Vb + V_zeeman;
+    const arma::vec V_zeeman = zeeman_potential(table, J, MF, Tl, p, spinup);
+    const arma::vec V_total  = Vb + V_zeeman;
 
     // Write data to file
     const auto totalpotentialfile  = opt.get_option<std::string>("totalpotentialfile");
@@ -160,6 +436,12 @@ int main(int argc,char *argv[])
     write_table(totalpotentialfile,  z, V_total);
     write_table(zeemanpotentialfile, z, V_zeeman);
 
+    if(opt.get_option<bool>("solve"))
+    {
+        const std::vector<arma::vec> E(1, find_energies(opt, read_mass(z), V_total, z));
+        write_energies(opt, arma::vec({MF}), arma::vec({Tl}), E);
+    }
+
     return EXIT_SUCCESS;
 }
 // vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -108,11 +108,8 @@ int main(int argc,char *argv[])
         const auto N_total   = opt.get_global_pop();
         const auto Ef_global = find_fermi_global(E, m, N_total, T, alpha, V);
 
-        for(unsigned int i=0; i<nst; ++i)
-        {
-            Ef[i] = Ef_global;
-            N[i]  = find_pop(E[i], Ef[i], m, T, alpha, V);
-        }
+        Ef.fill(Ef_global);
+        N = find_pop(E, Ef_global, m, T, alpha, V);
 
         N /= 1e14; // Rescale to 1e10 cm^{-2}
         write_table("N-out.r", N, true, 17);
@@ -179,14 +176,12 @@ static double calc_dist(const double       Emin,
     if(Emax<Emin) Emax=Emin+10*kB*T;
 
     arma::vec E(nE); // Array of energies for plot
-    arma::vec f(nE); // Occupation probabilities
 
     const auto dE=(Emax-Emin)/(nE-1); // Energy increment for integration
     for(unsigned int i=0; i<nE; i++)
-    {
         E[i] = Emin + i*dE;
-        f[i] = f_FD(Ef, E[i], T);
-    }
+
+    const arma::vec f = f_FD(Ef, E, T); // Occupation probabilities
 
     E/=(1e-3*e); // Convert to meV for output
 
@@ -4,7 +4,14 @@
  * \author   Alex Valavanis <a.valavanis@leeds.ac.uk>
  */
 
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
 #include <glibmm/ustring.h>
 
 #include "qwwad/material.h"
@@ -34,6 +41,13 @@ class MatLibOptions : public Options
                 add_option<bool>       ("text,t",          "Use this flag if the property is a string of text");
                 add_option<bool>       ("show-unit,u",     "Show the unit for the property rather than just its value");
                 add_option<double>     ("variable,x",   0, "Optional input parameter for properties of the form y=f(x)");
+                add_option<std::string>("batch,b",     "", "Read a list of queries from this file (or '-' for standard "
+                                                           "input), and print one result per query.  Each line gives "
+                                                           "a material, a property and, optionally, a value of x.");
+                add_option<size_t>     ("nx",           0, "Number of x values in a table of the property.  If "
+                                                           "non-zero, the property is tabulated from --xmin to --xmax.");
+                add_option<double>     ("xmin",         0, "Smallest x value in a table of the property");
+                add_option<double>     ("xmax",         1, "Largest x value in a table of the property");
 
                 std::string doc = "Queries the value of a property from the material "
                                   "database.";
@@ -46,6 +60,12 @@ class MatLibOptions : public Options
                 exit(EXIT_FAILURE);
             }
 
+            if(!get_option<std::string>("batch").empty() && get_option<size_t>("nx") > 0)
+            {
+                std::cerr << "The --batch and --nx options cannot be used together." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+
             if(get_verbose())
                 print();
         }
@@ -66,6 +86,160 @@ class MatLibOptions : public Options
         }
 };
 
+/**
+ * \brief A single query in a batch
+ */
+struct PropertyQuery
+{
+    std::string material; ///< Name of the material
+    std::string property; ///< Name of the property
+    double      x;        ///< Input parameter for the property
+};
+
+/**
+ * \brief Read a list of queries, one per line
+ *
+ * \param[in] stream The input stream
+ *
+ * \details Blank lines, and lines starting with '#', are skipped.
+ */
+static std::vector<PropertyQuery> read_queries(std::istream &stream)
+{
+    std::vector<PropertyQuery> queries;
+    std::string line;
+    size_t iline = 0;
+
+    while(std::getline(stream, line))
+    {
+        ++iline;
+        std::istringstream iss(line);
+        PropertyQuery query;
+        query.x = 0;
+
+        if(!(iss >> query.material) || query.material[0] == '#')
+            continue;
+
+        if(!(iss >> query.property))
+        {
+            std::ostringstream oss;
+            oss << "No property name given on line " << iline << " of query list.";
+            throw std::runtime_error(oss.str());
+        }
+
+        std::string extra;
+
+        if(iss >> extra)
+        {
+            char *end = NULL;
+            query.x = strtod(extra.c_str(), &end);
+
+            if(*end != '\0' || iss >> extra)
+            {
+                std::ostringstream oss;
+                oss << "Could not read line " << iline << " of query list: " << line;
+                throw std::runtime_error(oss.str());
+            }
+        }
+
+        queries.push_back(query);
+    }
+
+    return queries;
+}
+
+/**
+ * \brief Look up a property, by the names of the material and property
+ */
+static MaterialProperty const * find_property(const MaterialLibrary &lib,
+                                              const std::string     &material_name,
+                                              const std::string     &property_name)
+{
+    const auto mat = lib.get_material(material_name);
+    return mat->get_property(property_name);
+}
+
+/**
+ * \brief Format a numerical value, with its unit if needed
+ */
+static std::string format_value(const MaterialPropertyNumeric &prop,
+                                const double                   value,
+                                const bool                     show_unit)
+{
+    std::ostringstream oss;
+    oss << value;
+
+    if(show_unit)
+        oss << " " << prop.get_unit();
+
+    return oss.str();
+}
+
+/**
+ * \brief Answer a list of queries, and print one result per line in the same order
+ *
+ * \details Queries for the same property of the same material are collected, so
+ *          that the property is only looked up once, and is then evaluated for
+ *          all the x values at once.
+ */
+static void run_batch(const MaterialLibrary            &lib,
+                      const std::vector<PropertyQuery> &queries,
+                      const bool                        show_unit)
+{
+    typedef std::pair<std::string, std::string> query_key;
+    std::map<query_key, std::vector<size_t> > groups;
+
+    for(size_t iq = 0; iq < queries.size(); ++iq)
+        groups[std::make_pair(queries[iq].material, queries[iq].property)].push_back(iq);
+
+    std::vector<std::string> results(queries.size());
+
+    for(const auto &group : groups)
+    {
+        const auto &index = group.second;
+        const auto  prop  = find_property(lib, group.first.first, group.first.second);
+        const auto  text_property = dynamic_cast<MaterialPropertyString const *>(prop);
+
+        if(text_property)
+        {
+            for(auto iq : index)
+                results[iq] = text_property->get_text();
+
+            continue;
+        }
+
+        const auto numeric_property = dynamic_cast<MaterialPropertyNumeric const *>(prop);
+
+        arma::vec x(index.size());
+
+        for(size_t i = 0; i < index.size(); ++i)
+            x[i] = queries[index[i]].x;
+
+        const arma::vec y = numeric_property->get_val(x);
+
+        for(size_t i = 0; i < index.size(); ++i)
+            results[index[i]] = format_value(*numeric_property, y[i], show_unit);
+    }
+
+    for(const auto &result : results)
+        std::cout << result << std::endl;
+}
+
+/**
+ * \brief Print a table of a numerical property over a range of x values
+ */
+static void run_grid(const MaterialPropertyNumeric &prop,
+                     const double                   x_min,
+                     const double                   x_max,
+                     const size_t                   nx,
+                     const bool                     show_unit)
+{
+    const arma::vec x = arma::linspace(x_min, x_max, nx);
+    const arma::vec y = prop.get_val(x);
+
+    for(unsigned int ix = 0; ix < nx; ++ix)
+        std::cout << x[ix] << "\t" << format_value(prop, y[ix], show_unit) << std::endl;
+}
+
 int main(int argc, char* argv[])
 {
     MatLibOptions opt(argc, argv);
@@ -73,6 +247,42 @@ int main(int argc, char* argv[])
 
     MaterialLibrary lib(filename);
 
+    const auto batch_file = opt.get_option<std::string>("batch");
+    const auto show_unit  = opt.get_option<bool>("show-unit");
+
+    if(!batch_file.empty())
+    {
+        try
+        {
+            std::vector<PropertyQuery> queries;
+
+            if(batch_file == "-")
+                queries = read_queries(std::cin);
+            else
+            {
+                std::ifstream stream(batch_file.c_str());
+
+                if(!stream.is_open())
+                {
+                    std::ostringstream oss;
+                    oss << "Could not open " << batch_file;
+                    throw std::runtime_error(oss.str());
+                }
+
+                queries = read_queries(stream);
+            }
+
+            run_batch(lib, queries, show_unit);
+        }
+        catch(std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        return EXIT_SUCCESS;
+    }
+
     const auto material_name = opt.get_option<std::string>("material");
     const auto property_name = opt.get_option<std::string>("property");
 
@@ -80,8 +290,7 @@ int main(int argc, char* argv[])
 
     try
     {
-        const auto mat  = lib.get_material(material_name);
-        prop = mat->get_property(property_name);
+        prop = find_property(lib, material_name, property_name);
     }
     catch(std::exception &e)
     {
@@ -96,14 +305,17 @@ int main(int argc, char* argv[])
     else
     {
         const auto numeric_property = dynamic_cast<MaterialPropertyNumeric const *>(prop);
+        const auto nx = opt.get_option<size_t>("nx");
 
-        const auto x = opt.get_option<double>("variable");
-        std::cout << numeric_property->get_val(x);
-
-        if(opt.get_option<bool>("show-unit"))
-            std::cout << " " << numeric_property->get_unit();
-
-        std::cout << std::endl;
+        if(nx > 0)
+            run_grid(*numeric_property, opt.get_option<double>("xmin"), opt.get_option<double>("xmax"),
+                     nx, show_unit);
+        else
+        {
+            const auto x = opt.get_option<double>("variable");
+            std::cout << format_value(*numeric_property, numeric_property->get_val(x), show_unit)
+                      << std::endl;
+        }
     }
 
     return EXIT_SUCCESS;
@@ -0,0 +1,192 @@
+/**
+ * \file   qwwad_mc_transport.cpp
+ * \brief  Ensemble Monte Carlo simulation of carrier transport through subbands
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ *
+ * \details The LO-phonon emission and absorption rates between every pair of
+ *          subbands are found using the library scattering calculator, and are
+ *          then used to drive an ensemble of carriers until they reach a steady
+ *          state.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "qwwad/constants.h"
+#include "qwwad/ensemble-monte-carlo.h"
+#include "qwwad/file-io.h"
+#include "qwwad/options.h"
+#include "qwwad/scattering-calculator-LO.h"
+#include "qwwad/subband.h"
+
+using namespace QWWAD;
+using namespace constants;
+
+static Options configure_options(int argc, char* argv[])
+{
+    Options opt;
+
+    std::string doc("Find steady-state subband populations and current using ensemble Monte Carlo.");
+
+    opt.add_option<bool>  ("noblocking,b",          "Disable final-state blocking.");
+    opt.add_option<bool>  ("noscreening,S",         "Disable screening.");
+    opt.add_option<double>("latticeconst,A",  5.65, "Lattice constant in growth direction [angstrom]");
+    opt.add_option<double>("ELO,E",          36.0,  "Energy of LO phonon [meV]");
+    opt.add_option<double>("epss,e",         13.18, "Static dielectric constant");
+    opt.add_option<double>("epsinf,f",       10.89, "High-frequency dielectric constant");
+    opt.add_option<double>("mass,m",         0.067, "Band-edge effective mass (relative to free electron)");
+    opt.add_option<char>  ("particle,p",       'e', "ID of particle to be used: 'e', 'h' or 'l', for "
+                                                    "electrons, heavy holes or light holes respectively.");
+    opt.add_option<double>("Te",               300, "Carrier temperature for the rates and the initial distribution [K].");
+    opt.add_option<double>("Tl",               300, "Lattice temperature [K].");
+    opt.add_option<size_t>("nki",              101, "Number of initial wave-vector samples for each rate table.");
+    opt.add_option<size_t>("nKz",              101, "Number of phonon wave-vector samples.");
+    opt.add_option<double>("Kzscale",            0, "Scale of a mapped grid of phonon wave-vectors [1/angstrom].  If zero, "
+                                                    "the samples are evenly spaced.");
+    opt.add_option<size_t>("nsbperiod",          0, "Number of subbands in each period of the structure.  The subbands in "
+                                                    "the input files must cover a whole number of periods.  If zero, the "
+                                                    "structure is not periodic and no current flows.");
+    opt.add_option<double>("Ekmax",            300, "Largest kinetic energy in the Monte Carlo rate tables [meV].");
+    opt.add_option<size_t>("nE",              1000, "Number of kinetic energy samples in the Monte Carlo rate tables.");
+    opt.add_option<size_t>("ncarriers",     100000, "Number of carriers to simulate.");
+    opt.add_option<double>("time",             200, "Length of the simulation [ps].");
+    opt.add_option<double>("warmup",            50, "Time allowed to reach a steady state before results are collected [ps].");
+    opt.add_option<unsigned int>("seed",         1, "Seed for the random-number generator.");
+    opt.add_option<unsigned int>("threads",      0, "Number of threads to use (0 = one per CPU core).");
+    opt.add_option<std::string>("outputfile", "N-mc.r", "Filename to which the subband populations are written.");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, doc);
+
+    return opt;
+}
+
+/**
+ * \brief Find the transitions that are needed to describe one period
+ *
+ * \param[in] nsb        Number of subbands in the input files
+ * \param[in] nsb_period Number of subbands in each period
+ *
+ * \returns Each transition, as a pair of initial and final subband indices
+ *
+ * \details Every transition that starts or ends in the first period is included.
+ *          A transition within a later period is equivalent to one in the first
+ *          period, so it is skipped.
+ */
+static std::vector<EnsembleMonteCarlo::map_key> find_transitions(const size_t nsb,
+                                                                 const size_t nsb_period)
+{
+    std::vector<EnsembleMonteCarlo::map_key> transitions;
+
+    for(unsigned int i = 0; i < nsb; ++i)
+    {
+        for(unsigned int f = 0; f < nsb; ++f)
+        {
+            if(i != f && (i < nsb_period || f < nsb_period))
+                transitions.push_back(std::make_pair(i, f));
+        }
+    }
+
+    return transitions;
+}
+
+int main(int argc, char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    const auto A0          =  opt.get_option<double>("latticeconst") * 1e-10; // Lattice constant [m]
+    const auto Ephonon     =  opt.get_option<double>("ELO") * e/1000;         // Phonon energy [J]
+    const auto epsilon_s   =  opt.get_option<double>("epss") * eps0;          // Static permittivity [F/m]
+    const auto epsilon_inf =  opt.get_option<double>("epsinf") * eps0;        // High-frequency permittivity [F/m]
+    const auto m           =  opt.get_option<double>("mass") * me;            // Band-edge effective mass [kg]
+    const auto p           =  opt.get_option<char>  ("particle");             // Particle ID
+    const auto Te          =  opt.get_option<double>("Te");                   // Carrier temperature [K]
+    const auto Tl          =  opt.get_option<double>("Tl");                   // Lattice temperature [K]
+    const auto n_threads   =  opt.get_option<unsigned int>("threads");        // Number of worker threads
+
+    std::ostringstream E_filename; // Energy filename string
+    E_filename << "E" << p << ".r";
+    std::ostringstream wf_prefix;  // Wavefunction filename prefix
+    wf_prefix << "wf_" << p;
+
+    try
+    {
+        auto subbands = Subband::read_from_file(E_filename.str(),
+                                                wf_prefix.str(),
+                                                ".r",
+                                                m);
+
+        // Read and set carrier distributions within each subband
+        arma::vec  Ef;      // Fermi energies [J]
+        arma::uvec indices; // Subband indices (garbage)
+        read_table("Ef.r", indices, Ef);
+        Ef *= e/1000.0; // Rescale to J
+
+        if(Ef.size() != subbands.size())
+        {
+            std::cerr << "Ef.r lists " << Ef.size() << " Fermi energies, but there are "
+                      << subbands.size() << " subbands." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        for(unsigned int isb = 0; isb < subbands.size(); ++isb)
+            subbands[isb].set_distribution_from_Ef_Te(Ef[isb], Te);
+
+        const auto nsb        = subbands.size();
+        const auto nsb_period = (opt.get_option<size_t>("nsbperiod") == 0) ? nsb : opt.get_option<size_t>("nsbperiod");
+
+        EnsembleMonteCarlo mc(subbands,
+                              nsb_period,
+                              opt.get_option<double>("Ekmax")*e/1000,
+                              opt.get_option<size_t>("nE"));
+
+        // Tabulate the emission and absorption rates for every transition
+        ScatteringCalculatorLO calculator(subbands, A0, Ephonon, epsilon_s, epsilon_inf, m, Te, Tl, true);
+        calculator.enable_screening(!opt.get_option<bool>("noscreening"));
+        calculator.enable_blocking(!opt.get_option<bool>("noblocking"));
+        calculator.set_phonon_samples(opt.get_option<size_t>("nKz"), opt.get_option<double>("Kzscale")*1e10);
+        calculator.set_ki_samples(opt.get_option<size_t>("nki"));
+
+        const auto transitions = find_transitions(nsb, nsb_period);
+
+        for(const bool is_emission : {true, false})
+        {
+            calculator.set_emission(is_emission);
+            const auto tx = calculator.get_transitions(transitions, n_threads);
+
+            for(unsigned int itx = 0; itx < transitions.size(); ++itx)
+            {
+                mc.add_transition(transitions[itx].first, transitions[itx].second, tx[itx],
+                                  is_emission ? Ephonon : -Ephonon);
+            }
+        }
+
+        // Start from the thermal populations in the first period
+        arma::vec N0(nsb_period);
+
+        for(unsigned int isb = 0; isb < nsb_period; ++isb)
+            N0[isb] = subbands[isb].get_total_population();
+
+        const auto results = mc.run(N0, Te,
+                                    opt.get_option<size_t>("ncarriers"),
+                                    opt.get_option<double>("time")*1e-12,
+                                    opt.get_option<double>("warmup")*1e-12,
+                                    n_threads,
+                                    opt.get_option<unsigned int>("seed"));
+
+        write_table(opt.get_option<std::string>("outputfile"), results.N, results.Te, true, 17);
+
+        std::cout << "Current density: " << results.J*1e-4 << " A/cm^2" << std::endl;
+
+        if(opt.get_verbose())
+            std::cout << "Scattering events: " << results.n_events << std::endl;
+    }
+    catch(std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,141 @@
+/**
+ * \file   qwwad_merge_shards.cpp
+ * \brief  Reassemble an output file that was split between several jobs using --shard
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "qwwad/options.h"
+#include "qwwad/shard.h"
+
+using namespace QWWAD;
+
+/**
+ * Configure command-line options for the program
+ */
+Options configure_options(int argc, char* argv[])
+{
+    Options opt;
+
+    std::string summary("Reassemble an output file from a set of jobs that used the --shard option.");
+
+    opt.add_option<std::string> ("file,f",             "Name of the complete output file, e.g., LOe-if.r");
+    opt.add_option<unsigned int>("nshards,n",          "Number of jobs that the work was split between");
+    opt.add_option<size_t>      ("headerlines",     0, "Number of header lines at the start of each file, which are "
+                                                       "only written once.");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, summary);
+
+    return opt;
+}
+
+/**
+ * \brief Read all lines from a file
+ *
+ * \param[in] filename Name of the file
+ *
+ * \returns The lines in the file
+ */
+static std::vector<std::string> read_lines(const std::string &filename)
+{
+    std::ifstream stream(filename.c_str());
+
+    if(!stream.is_open())
+    {
+        std::cerr << "Could not open file: " << filename << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<std::string> lines;
+    std::string line;
+
+    while(std::getline(stream, line))
+        lines.push_back(line);
+
+    return lines;
+}
+
+int main(int argc, char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    if(!opt.get_argument_known("file") || !opt.get_argument_known("nshards"))
+    {
+        std::cerr << "Both --file and --nshards must be specified." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    const auto filename = opt.get_option<std::string>("file");
+    const auto n_shards = opt.get_option<unsigned int>("nshards");
+    const auto n_header = opt.get_option<size_t>("headerlines");
+
+    if(n_shards == 0)
+    {
+        std::cerr << "The number of shards must be positive." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Read every part, and check that the headers agree
+    std::vector< std::vector<std::string> > parts(n_shards);
+    size_t n_rows = 0;
+
+    for(unsigned int ishard = 0; ishard < n_shards; ++ishard)
+    {
+        const auto part_name = Shard::get_filename(filename, ishard+1, n_shards);
+        parts[ishard] = read_lines(part_name);
+
+        if(parts[ishard].size() < n_header)
+        {
+            std::cerr << "File " << part_name << " has fewer than " << n_header << " header lines." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        for(unsigned int iline = 0; iline < n_header; ++iline)
+        {
+            if(parts[ishard][iline] != parts[0][iline])
+            {
+                std::cerr << "Header of " << part_name << " does not match the first part." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        n_rows += parts[ishard].size() - n_header;
+    }
+
+    // Each job took every n-th row of the complete file, so check that the parts
+    // belong together before interleaving them
+    for(unsigned int ishard = 0; ishard < n_shards; ++ishard)
+    {
+        const size_t n_expected = (n_rows + n_shards - 1 - ishard) / n_shards;
+
+        if(parts[ishard].size() - n_header != n_expected)
+        {
+            std::cerr << "File " << Shard::get_filename(filename, ishard+1, n_shards) << " has "
+                      << parts[ishard].size() - n_header << " rows, but " << n_expected
+                      << " were expected.  Check that every job has finished." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    std::ofstream stream(filename.c_str());
+
+    if(!stream.is_open())
+    {
+        std::cerr << "Could not write file: " << filename << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    for(unsigned int iline = 0; iline < n_header; ++iline)
+        stream << parts[0][iline] << std::endl;
+
+    for(size_t irow = 0; irow < n_rows; ++irow)
+        stream << parts[irow % n_shards][n_header + irow / n_shards] << std::endl;
+
+    return EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -15,11 +15,14 @@
  */
 
 #include <iostream>
+#include "qwwad/constants.h"
 #include "qwwad/file-io.h"
 #include "qwwad/mesh.h"
 #include "qwwad/options.h"
+#include "qwwad/schroedinger-solver-tridiagonal.h"
 
 using namespace QWWAD;
+using namespace constants;
 
 /** 
  * \brief Argument values read from the command-line.
@@ -64,15 +67,31 @@ MeshOptions::MeshOptions(int argc, char* argv[])
     std::string description("Generate a mesh of samples of structural data.");
 
     add_option<double>     ("dzmax",               0.1,         "Maximum separation between spatial points.");
+    add_option<double>     ("dzmaxbulk",             0,         "Maximum separation between spatial points far from interfaces "
+                                                                "[angstrom]. If larger than --dzmax, a graded mesh is "
+                                                                "generated.");
     add_option<double>     ("zresmin",                          "Minimum spatial resolution. Overrides the --dz-max option");
     add_option<size_t>     ("nz1per",                0,         "Number of points (per period) within the structure. "
                                                                 "If specified, this overrides the --dzmax and "
                                                                 "--zresmin options");
     add_option<size_t>     ("nper,p",                1,         "Number of periods to output");
+    add_option<bool>       ("adaptive",                         "Refine the mesh where a trial calculation of the lowest "
+                                                                "states shows that it is needed.");
+    add_option<double>     ("trialdV",             836,         "Band offset per unit of the first alloy fraction, used for the "
+                                                                "potential in the adaptive trial calculation [meV].");
+    add_option<double>     ("trialmass",         0.067,         "Effective mass used in the adaptive trial calculation "
+                                                                "[relative to free electron].");
+    add_option<size_t>     ("trialnst",              3,         "Number of states used in the adaptive trial calculation.");
+    add_option<double>     ("Etol",               0.01,         "Largest change in any trial energy at which adaptive "
+                                                                "refinement stops [meV].");
+    add_option<double>     ("dzmin",              0.01,         "Smallest width of cells in adaptive refinement [angstrom].");
+    add_option<size_t>     ("maxrefine",            10,         "Maximum number of adaptive refinement steps.");
     add_option<std::string>("layerfile,i",          "s.r",      "Filename from which to read input data.");
     add_option<std::string>("interfacesfile,f", "interfaces.r", "Filename to which interface locations are written.");
     add_option<std::string>("alloyfile,x",      "x.r",          "Filename to which alloy profile is written.");
     add_option<std::string>("dopingfile,d",     "d.r",          "Filename to which doping profile is written.");
+    add_option<std::string>("layerindexfile",   "",             "Filename to which the index of the layer containing each "
+                                                                "cell is written.  If not specified, no file is written.");
 
     add_prog_specific_options_and_parse(argc, argv, description);
 
@@ -96,9 +115,155 @@ void MeshOptions::print() const
     std::cout << " * Filename for interface locations: " << get_option<std::string>("interfacesfile") << std::endl;
     std::cout << " * Filename for alloy profile:       " << get_option<std::string>("alloyfile")      << std::endl;
     std::cout << " * Filename for doping profile:      " << get_option<std::string>("dopingfile")     << std::endl;
+    std::cout << " * Filename for layer indices:       " << get_option<std::string>("layerindexfile") << std::endl;
     std::cout << std::endl;
 }
 
+/**
+ * \brief Find the energies of the lowest states in a trial potential
+ *
+ * \param[in] opt     User options
+ * \param[in] z       Position of each cell [m]
+ * \param[in] V       Trial potential profile [J]
+ * \param[out] states The states that were found
+ */
+static void solve_trial(const MeshOptions       &opt,
+                        const arma::vec         &z,
+                        const arma::vec         &V,
+                        std::vector<Eigenstate> &states)
+{
+    const arma::vec m = opt.get_option<double>("trialmass") * me * arma::ones(z.size());
+    SchroedingerSolverTridiag se(m, V, z, opt.get_option<size_t>("trialnst"));
+    states = se.get_solutions();
+
+    if(states.empty())
+        throw std::runtime_error("No states found in adaptive trial potential.");
+}
+
+/**
+ * \brief Refine a mesh until the lowest states in a trial potential converge
+ *
+ * \param[in] opt User options
+ * \param[in] het The initial mesh
+ *
+ * \returns The width of each cell in one period of the refined mesh [m]
+ *
+ * \details The trial potential is proportional to the first alloy fraction, and a
+ *          constant effective mass is used, so this is a cheap single-band model
+ *          of the real structure.  At each step, the error in each cell is
+ *          estimated as \f$\Delta z^2 \sum_i |\psi_i''|\,|\psi_i|\f$ for the
+ *          trial states, and the cells with the largest errors are halved.  Cells
+ *          next to an interface, where the potential changes, are always
+ *          refined.  Cell boundaries are never moved, so they stay aligned with
+ *          the layer boundaries.  Refinement stops when no trial energy changes
+ *          by more than --Etol between steps.
+ */
+static arma::vec refine_mesh(const MeshOptions &opt,
+                             const Mesh        &het)
+{
+    const double dz_min = opt.get_option<double>("dzmin")*1e-10;
+    const double E_tol  = opt.get_option<double>("Etol")*1e-3*e;
+    const double dV     = opt.get_option<double>("trialdV")*1e-3*e;
+    const auto   nrefine_max = opt.get_option<size_t>("maxrefine");
+
+    arma::vec dz = het.get_dz_array_1per();
+
+    // Trial potential in each cell [J]
+    const auto &x_1per = het.get_x_array_1per();
+    std::vector<double> V_cell(dz.size());
+
+    for(unsigned int icell = 0; icell < dz.size(); ++icell)
+        V_cell[icell] = (het.get_n_alloy() > 0) ? dV * x_1per[icell][0] : 0.0;
+
+    arma::vec E_prev;
+
+    for(unsigned int irefine = 0; irefine <= nrefine_max; ++irefine)
+    {
+        const size_t    nz = dz.size();
+        const arma::vec z  = arma::cumsum(dz) - 0.5*dz;
+        const arma::vec V(V_cell);
+
+        std::vector<Eigenstate> states;
+        solve_trial(opt, z, V, states);
+
+        arma::vec E(states.size());
+
+        for(unsigned int ist = 0; ist < states.size(); ++ist)
+            E[ist] = states[ist].get_energy();
+
+        if(opt.get_verbose())
+        {
+            std::cout << "Refinement step " << irefine << ": " << nz << " cells; ground-state energy "
+                      << E[0]*1000/e << " meV" << std::endl;
+        }
+
+        // Stop if the energies have converged
+        if(!E_prev.empty() && E_prev.size() == E.size() &&
+           arma::abs(E - E_prev).max() <= E_tol)
+            break;
+
+        E_prev = E;
+
+        if(irefine == nrefine_max)
+        {
+            std::cerr << "Warning: adaptive mesh did not converge after " << nrefine_max
+                      << " refinement steps." << std::endl;
+            break;
+        }
+
+        // Estimate the discretisation error in each cell
+        arma::vec err = arma::zeros(nz);
+
+        for(const auto &st : states)
+        {
+            const auto psi = st.get_wavefunction_samples();
+
+            for(unsigned int iz = 1; iz < nz-1; ++iz)
+            {
+                const double h_m = z[iz]   - z[iz-1];
+                const double h_p = z[iz+1] - z[iz];
+                const double d2psi = 2.0*(h_m*psi[iz+1] - (h_m+h_p)*psi[iz] + h_p*psi[iz-1])
+                                     /(h_m*h_p*(h_m+h_p));
+                err[iz] += dz[iz]*dz[iz]*fabs(d2psi*psi[iz]);
+            }
+        }
+
+        const double err_threshold = 0.25*err.max();
+
+        // Halve each cell that needs refining
+        std::vector<double> dz_new;
+        std::vector<double> V_new;
+        dz_new.reserve(2*nz);
+        V_new.reserve(2*nz);
+
+        for(unsigned int iz = 0; iz < nz; ++iz)
+        {
+            const bool at_interface = (iz > 0    && V_cell[iz] != V_cell[iz-1]) ||
+                                      (iz < nz-1 && V_cell[iz] != V_cell[iz+1]);
+
+            if((err[iz] >= err_threshold || at_interface) && dz[iz] >= 2*dz_min)
+            {
+                dz_new.insert(dz_new.end(), 2, 0.5*dz[iz]);
+                V_new.insert(V_new.end(), 2, V_cell[iz]);
+            }
+            else
+            {
+                dz_new.push_back(dz[iz]);
+                V_new.push_back(V_cell[iz]);
+            }
+        }
+
+        // Stop if no more cells can be split
+        if(dz_new.size() == nz)
+            break;
+
+        dz     = arma::vec(dz_new);
+        V_cell = V_new;
+    }
+
+    return dz;
+}
+
 int main(int argc, char* argv[])
 {
     // Read command-line options
@@ -106,14 +271,25 @@ int main(int argc, char* argv[])
 
     // Create a new Mesh using input data
     const auto nz_1per = opt.get_option<size_t>("nz1per");
-    const auto het = (nz_1per != 0) ?  // Force the number of points per period if specified
+    auto het = (nz_1per != 0) ?  // Force the number of points per period if specified
                      Mesh::create_from_file(opt.get_option<std::string>("layerfile"),
                                                        opt.get_option<size_t>("nz1per"),
                                                        opt.get_option<size_t>("nper"))
                      :
                      Mesh::create_from_file_auto_nz(opt.get_option<std::string>("layerfile"),
                                                                opt.get_option<size_t>("nper"),
-                                                               opt.get_dz_max());
+                                                               opt.get_dz_max(),
+                                                               opt.get_option<double>("dzmaxbulk")*1e-10);
+
+    // Replace the initial mesh with an adaptively refined one if requested
+    if(opt.get_option<bool>("adaptive"))
+    {
+        const auto dz_1per = refine_mesh(opt, *het);
+        delete het;
+        het = Mesh::create_from_file(opt.get_option<std::string>("layerfile"),
+                                     dz_1per,
+                                     opt.get_option<size_t>("nper"));
+    }
 
     if(opt.get_verbose())
     {
@@ -129,25 +305,34 @@ int main(int argc, char* argv[])
     write_table(opt.get_option<std::string>("interfacesfile").c_str(), het->get_layer_top_indices());
 
     // Now output each alloy fraction to file
-    std::ofstream stream(opt.get_option<std::string>("alloyfile").c_str());
+    TableWriter stream(opt.get_option<std::string>("alloyfile"), 20, true);
 
     const auto ncell  = het->get_ncell();
     const auto z      = het->get_z();
     const auto nalloy = het->get_n_alloy();
 
-    const auto alloy = het->get_x_array();
-
+    // Look up the alloy fractions in the stored period, rather than expanding
+    // the whole structure
     for(unsigned int iz = 0; iz < ncell; ++iz)
     {
-        stream << std::setprecision(20) << std::scientific << z[iz] << "\t";
+        stream << z[iz] << '\t';
+
+        const auto &alloy = het->get_x_at_point(iz);
 
         for(unsigned int ialloy = 0; ialloy < nalloy; ++ialloy)
-            stream << std::setprecision(20) << std::scientific << alloy.at(iz)[ialloy] << "\t";
+            stream << alloy[ialloy] << '\t';
 
-        stream << std::endl;
+        stream << '\n';
     }
 
-    write_table(opt.get_option<std::string>("dopingfile").c_str(), het->get_z(), het->get_n3D_array());
+    write_table(opt.get_option<std::string>("dopingfile").c_str(), z, het->get_n3D_array());
+
+    // Label the layer containing each cell
+    const auto layerindexfile = opt.get_option<std::string>("layerindexfile");
+
+    if(!layerindexfile.empty())
+        write_table(layerindexfile.c_str(), z, het->get_layer_indices());
+
     delete het;
 
     return EXIT_SUCCESS;
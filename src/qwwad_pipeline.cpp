@@ -0,0 +1,542 @@
+/**
+ * \file   qwwad_pipeline.cpp
+ * \brief  Run a chain of QWWAD programs, repeating only the steps whose inputs have changed
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fnmatch.h>
+#include <glob.h>
+
+#include "qwwad/hash.h"
+#include "qwwad/options.h"
+#include "qwwad/parallel.h"
+#include "qwwad/process.h"
+
+using namespace QWWAD;
+
+/// A single step in the pipeline
+struct Stage
+{
+    std::string              name;    ///< Name of the stage
+    std::string              command; ///< Shell command that runs the stage
+    std::vector<std::string> inputs;  ///< Input filenames (may include wildcards)
+    std::vector<std::string> outputs; ///< Output filenames (may include wildcards)
+    std::vector<std::string> after;   ///< Stages that must run first, regardless of files
+    std::set<size_t>         deps;    ///< Indices of the stages that this one depends on
+};
+
+/**
+ * Configure command-line options for the program
+ */
+Options configure_options(int argc, char* argv[])
+{
+    Options opt;
+
+    std::string summary("Run a chain of programs, repeating only the steps whose inputs have changed.");
+
+    opt.add_option<std::string>("pipelinefile", "pipeline.ini", "File that lists the stages of the pipeline");
+    opt.add_option<std::string>("statefile",  ".qwwad-pipeline", "File in which the state of each stage is stored");
+    opt.add_option<std::string>("target",                        "Comma-separated list of stages to bring up to date, "
+                                                                 "along with the stages that they depend on.  "
+                                                                 "If unspecified, all stages are used.");
+    opt.add_option<unsigned int>("threads",                    0, "Number of stages to run at once (0 = one per CPU core)");
+    opt.add_option<bool>        ("force",                         "Run every stage, even if it is up to date");
+    opt.add_option<bool>        ("dryrun",                        "List the stages that would be run, but don't run them");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, summary);
+
+    return opt;
+}
+
+/**
+ * \brief Remove whitespace from both ends of a string
+ */
+static std::string trim(const std::string &str)
+{
+    const auto first = str.find_first_not_of(" \t\r");
+
+    if(first == std::string::npos)
+        return "";
+
+    const auto last = str.find_last_not_of(" \t\r");
+    return str.substr(first, last - first + 1);
+}
+
+/**
+ * \brief Read the list of stages from a pipeline file
+ *
+ * \param[in] filename The name of the pipeline file
+ *
+ * \details Each stage starts with its name in square brackets, followed by
+ *          lines of the form "key = value".  The keys are "command", "inputs",
+ *          "outputs" and "after".  Text after a '#' is ignored.
+ */
+static std::vector<Stage> read_stages(const std::string &filename)
+{
+    std::ifstream stream(filename.c_str());
+
+    if(!stream)
+    {
+        std::ostringstream oss;
+        oss << "Could not read pipeline file " << filename;
+        throw std::runtime_error(oss.str());
+    }
+
+    std::vector<Stage> stages;
+    std::string line;
+    size_t iline = 0;
+
+    while(std::getline(stream, line))
+    {
+        ++iline;
+        line = trim(line.substr(0, line.find('#')));
+
+        if(line.empty())
+            continue;
+
+        if(line[0] == '[' && line[line.size()-1] == ']')
+        {
+            Stage stage;
+            stage.name = trim(line.substr(1, line.size()-2));
+
+            for(auto const &s : stages)
+            {
+                if(s.name == stage.name)
+                {
+                    std::ostringstream oss;
+                    oss << "Stage " << stage.name << " is defined twice in " << filename;
+                    throw std::runtime_error(oss.str());
+                }
+            }
+
+            stages.push_back(stage);
+            continue;
+        }
+
+        const auto equals = line.find('=');
+
+        if(equals == std::string::npos || stages.empty())
+        {
+            std::ostringstream oss;
+            oss << "Could not understand line " << iline << " of " << filename;
+            throw std::runtime_error(oss.str());
+        }
+
+        const auto key   = trim(line.substr(0, equals));
+        const auto value = trim(line.substr(equals + 1));
+        auto &stage = stages.back();
+
+        if(key == "command")
+            stage.command = value;
+        else if(key == "inputs")
+            stage.inputs = split_list(value, ", \t");
+        else if(key == "outputs")
+            stage.outputs = split_list(value, ", \t");
+        else if(key == "after")
+            stage.after = split_list(value, ", \t");
+        else
+        {
+            std::ostringstream oss;
+            oss << "Unknown key \"" << key << "\" on line " << iline << " of " << filename;
+            throw std::runtime_error(oss.str());
+        }
+    }
+
+    for(auto const &stage : stages)
+    {
+        if(stage.command.empty())
+        {
+            std::ostringstream oss;
+            oss << "No command was given for stage " << stage.name;
+            throw std::runtime_error(oss.str());
+        }
+    }
+
+    return stages;
+}
+
+/**
+ * \brief Check whether a stage output could provide a stage input
+ *
+ * \details Either name may contain wildcards, e.g., an input of "wf_e*.r" is
+ *          provided by an output of "wf_e1.r", and vice-versa.
+ */
+static bool files_match(const std::string &output,
+                        const std::string &input)
+{
+    return output == input
+        || fnmatch(input.c_str(),  output.c_str(), 0) == 0
+        || fnmatch(output.c_str(), input.c_str(),  0) == 0;
+}
+
+/**
+ * \brief Find the stages that each stage depends on
+ *
+ * \details A stage depends on any stage that writes one of its input files,
+ *          and on any stage named in its "after" list.
+ */
+static void find_dependencies(std::vector<Stage> &stages)
+{
+    for(auto &stage : stages)
+    {
+        for(size_t j = 0; j < stages.size(); ++j)
+        {
+            auto const &other = stages[j];
+
+            if(&other == &stage)
+                continue;
+
+            for(auto const &input : stage.inputs)
+            {
+                for(auto const &output : other.outputs)
+                {
+                    if(files_match(output, input))
+                        stage.deps.insert(j);
+                }
+            }
+        }
+
+        for(auto const &name : stage.after)
+        {
+            auto const it = std::find_if(stages.begin(), stages.end(),
+                                         [&](const Stage &s) {return s.name == name;});
+
+            if(it == stages.end())
+            {
+                std::ostringstream oss;
+                oss << "Stage " << stage.name << " must run after unknown stage " << name;
+                throw std::runtime_error(oss.str());
+            }
+
+            stage.deps.insert(it - stages.begin());
+        }
+    }
+}
+
+/**
+ * \brief Find the stages that need to be considered for a set of targets
+ *
+ * \param[in] stages  All the stages in the pipeline
+ * \param[in] targets The names of the wanted stages (empty = all stages)
+ *
+ * \returns A flag for each stage, which is true if the stage is wanted
+ */
+static std::vector<bool> find_wanted(const std::vector<Stage>       &stages,
+                                     const std::vector<std::string> &targets)
+{
+    std::vector<bool> wanted(stages.size(), targets.empty());
+    std::vector<size_t> todo;
+
+    for(auto const &name : targets)
+    {
+        auto const it = std::find_if(stages.begin(), stages.end(),
+                                     [&](const Stage &s) {return s.name == name;});
+
+        if(it == stages.end())
+        {
+            std::ostringstream oss;
+            oss << "Unknown target stage " << name;
+            throw std::runtime_error(oss.str());
+        }
+
+        todo.push_back(it - stages.begin());
+    }
+
+    while(!todo.empty())
+    {
+        const auto i = todo.back();
+        todo.pop_back();
+
+        if(!wanted[i])
+        {
+            wanted[i] = true;
+            todo.insert(todo.end(), stages[i].deps.begin(), stages[i].deps.end());
+        }
+    }
+
+    return wanted;
+}
+
+/**
+ * \brief Find the files that match a filename, which may contain wildcards
+ *
+ * \returns The matching files, in alphabetical order.  A name without
+ *          wildcards is returned unchanged, whether or not the file exists.
+ */
+static std::vector<std::string> expand_files(const std::string &pattern)
+{
+    std::vector<std::string> files;
+    glob_t matches;
+
+    if(glob(pattern.c_str(), GLOB_NOCHECK, nullptr, &matches) == 0)
+    {
+        for(size_t i = 0; i < matches.gl_pathc; ++i)
+            files.push_back(matches.gl_pathv[i]);
+    }
+
+    globfree(&matches);
+    return files;
+}
+
+/**
+ * \brief Check whether a file exists
+ */
+static bool file_exists(const std::string &filename)
+{
+    std::ifstream stream(filename.c_str());
+    return stream.good();
+}
+
+/**
+ * \brief Find the hash of a stage's command and the contents of its input files
+ *
+ * \details The name of each input file is included in the hash, so that adding
+ *          or removing a file that matches a wildcard changes the hash.
+ */
+static std::string stage_hash(const Stage &stage)
+{
+    uint64_t hash = hash_offset_basis;
+    hash_bytes(stage.command.data(), stage.command.size() + 1, hash);
+
+    for(auto const &pattern : stage.inputs)
+    {
+        for(auto const &filename : expand_files(pattern))
+        {
+            std::ifstream stream(filename.c_str(), std::ios::binary);
+
+            if(!stream)
+            {
+                std::ostringstream oss;
+                oss << "Input file " << filename << " for stage " << stage.name << " does not exist.";
+                throw std::runtime_error(oss.str());
+            }
+
+            hash_bytes(filename.data(), filename.size() + 1, hash);
+
+            char buffer[65536];
+
+            while(stream.read(buffer, sizeof(buffer)) || stream.gcount() > 0)
+                hash_bytes(buffer, stream.gcount(), hash);
+        }
+    }
+
+    return format_hash(hash);
+}
+
+/**
+ * \brief Check that all of a stage's output files exist
+ */
+static bool outputs_exist(const Stage &stage)
+{
+    for(auto const &pattern : stage.outputs)
+    {
+        for(auto const &filename : expand_files(pattern))
+        {
+            if(!file_exists(filename))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * \brief Read the hash of each stage from the last time it was run
+ */
+static std::map<std::string, std::string> read_state(const std::string &filename)
+{
+    std::map<std::string, std::string> state;
+    std::ifstream stream(filename.c_str());
+    std::string name;
+    std::string hash;
+
+    while(stream >> name >> hash)
+        state[name] = hash;
+
+    return state;
+}
+
+/**
+ * \brief Write the hash of each stage that has been run successfully
+ */
+static void write_state(const std::string                        &filename,
+                        const std::map<std::string, std::string> &state)
+{
+    std::ofstream stream(filename.c_str());
+
+    for(auto const &entry : state)
+        stream << entry.first << " " << entry.second << "\n";
+
+    if(!stream)
+    {
+        std::ostringstream oss;
+        oss << "Could not write " << filename;
+        throw std::runtime_error(oss.str());
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    const auto statefile = opt.get_option<std::string>("statefile");
+    const auto n_threads = opt.get_option<unsigned int>("threads");
+    const auto force     = opt.get_option<bool>("force");
+    const auto dryrun    = opt.get_option<bool>("dryrun");
+    const auto verbose   = opt.get_verbose();
+
+    const auto targets = opt.get_list("target");
+
+    try
+    {
+        auto stages = read_stages(opt.get_option<std::string>("pipelinefile"));
+        find_dependencies(stages);
+
+        const auto n_stages = stages.size();
+        const auto wanted   = find_wanted(stages, targets);
+        auto       state    = read_state(statefile);
+
+        std::vector<bool> done(n_stages, false); // Stage has been handled
+        std::vector<bool> ran(n_stages, false);  // Stage was run (or would be, in a dry run)
+        bool failed = false;
+
+        // Run the stages in waves.  Each wave contains all the stages whose
+        // dependencies have been handled, and these are run in parallel.
+        while(!failed)
+        {
+            std::vector<size_t> wave;
+
+            for(size_t i = 0; i < n_stages; ++i)
+            {
+                if(wanted[i] && !done[i]
+                   && std::all_of(stages[i].deps.begin(), stages[i].deps.end(),
+                                  [&](const size_t j) {return done[j] || !wanted[j];}))
+                    wave.push_back(i);
+            }
+
+            if(wave.empty())
+                break;
+
+            // In a dry run, a stage must be run if any of its dependencies
+            // would have been run, since its inputs could then change.
+            std::vector<std::string> hashes(wave.size());
+            std::vector<bool>        needed(wave.size());
+
+            for(size_t iw = 0; iw < wave.size(); ++iw)
+            {
+                auto const &stage = stages[wave[iw]];
+                const bool upstream_ran = std::any_of(stage.deps.begin(), stage.deps.end(),
+                                                      [&](const size_t j) {return ran[j];});
+
+                if(dryrun && upstream_ran)
+                    needed[iw] = true;
+                else
+                {
+                    hashes[iw] = stage_hash(stage);
+                    auto const it = state.find(stage.name);
+                    needed[iw] = force || it == state.end() || it->second != hashes[iw]
+                                 || !outputs_exist(stage);
+                }
+            }
+
+            std::vector<int> status(wave.size(), EXIT_SUCCESS);
+
+            // Share the cores between the stages that run at once
+            const unsigned int n_running = std::min<size_t>(get_thread_count(n_threads),
+                                                            std::count(needed.begin(), needed.end(), true));
+            const auto child_env = get_child_thread_environment(n_running);
+
+            run_in_parallel(wave.size(), n_threads, [&](const size_t iw) {
+                auto const &stage = stages[wave[iw]];
+
+                if(!needed[iw])
+                {
+                    if(verbose)
+                        std::cout << stage.name << " is up to date." << std::endl;
+                }
+                else if(dryrun)
+                    std::cout << stage.name << ": " << stage.command << std::endl;
+                else
+                {
+                    std::cout << "Running " << stage.name << ": " << stage.command << std::endl;
+
+                    std::vector<std::string> args;
+                    args.push_back("/bin/sh");
+                    args.push_back("-c");
+                    args.push_back(stage.command);
+
+                    status[iw] = run_process(args, "", stage.name + ".log", child_env);
+                }
+            });
+
+            for(size_t iw = 0; iw < wave.size(); ++iw)
+            {
+                const auto i = wave[iw];
+                auto const &stage = stages[i];
+                done[i] = true;
+                ran[i]  = needed[iw];
+
+                if(!needed[iw] || dryrun)
+                    continue;
+
+                if(status[iw] != EXIT_SUCCESS)
+                {
+                    std::cerr << "Stage " << stage.name << " failed.  See " << stage.name
+                              << ".log for details." << std::endl;
+                    state.erase(stage.name);
+                    failed = true;
+                }
+                else if(!outputs_exist(stage))
+                {
+                    std::cerr << "Stage " << stage.name << " did not write all of its output files."
+                              << std::endl;
+                    state.erase(stage.name);
+                    failed = true;
+                }
+                else
+                    state[stage.name] = hashes[iw];
+            }
+
+            // Save the state after each wave, so that an interrupted pipeline
+            // can carry on from where it stopped
+            if(!dryrun)
+                write_state(statefile, state);
+        }
+
+        if(!failed && std::find(done.begin(), done.end(), false) != done.end())
+        {
+            for(size_t i = 0; i < n_stages; ++i)
+            {
+                if(wanted[i] && !done[i])
+                {
+                    std::cerr << "Stage " << stages[i].name
+                              << " is part of a dependency loop." << std::endl;
+                    failed = true;
+                }
+            }
+        }
+
+        if(failed)
+            exit(EXIT_FAILURE);
+    }
+    catch(std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
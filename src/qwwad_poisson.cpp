@@ -88,8 +88,8 @@ int main(int argc, char* argv[])
         }
     }
 
-    const auto dz     = z(1) - z(0); // Size of cells in sampling mesh [m] 
-    const auto length = dz * nz;     // Total length of structure [m]
+    const auto dz     = z(1) - z(0); // Size of first cell in sampling mesh [m]
+    const auto length = (z(nz-1) - z(0)) + 0.5*(dz + z(nz-1) - z(nz-2)); // Total length of structure [m]
 
     double field  = 0.0; // Applied electric field [V/m]
     double V_drop = 0.0; // Potential drop across the structure [J]
@@ -107,7 +107,7 @@ int main(int argc, char* argv[])
     if(opt.get_option<bool>("mixed"))
     {
         // Solve the Poisson equation with zero field at the edges first
-        PoissonSolver poisson(_eps, dz, MIXED);
+        PoissonSolver poisson(_eps, z, MIXED);
         phi = poisson.solve(rho);
 
         // Only fix the voltage across the structure if an applied field is specified.
@@ -123,8 +123,7 @@ int main(int argc, char* argv[])
             V_drop -= phi(nz-1);
 
             // Now solve the Laplace equation to find the contribution due to applied bias.
-            PoissonSolver laplace(_eps, dz, DIRICHLET);
-            phi += laplace.solve_laplace(V_drop);
+            phi += poisson.solve_laplace(V_drop);
         }
     }
     else
@@ -134,11 +133,11 @@ int main(int argc, char* argv[])
         // If a bias is specified, then pin the potential at each end
         if(opt.get_argument_known("field"))
         {
-            poisson = new PoissonSolver(_eps, dz, DIRICHLET);
+            poisson = new PoissonSolver(_eps, z, DIRICHLET);
         }
         else
         {
-            poisson = new PoissonSolver(_eps, dz, ZERO_FIELD);
+            poisson = new PoissonSolver(_eps, z, ZERO_FIELD);
         }
 
         phi = poisson->solve(rho, V_drop);
@@ -174,7 +173,7 @@ int main(int argc, char* argv[])
 
     for(unsigned int iz = 1; iz < nz-1; ++iz)
     {
-        F(iz) = (phi(iz+1) - phi(iz-1))/(2*dz)/e;
+        F(iz) = (phi(iz+1) - phi(iz-1))/(z(iz+1) - z(iz-1))/e;
     }
 
     write_table("field.r", z, F);
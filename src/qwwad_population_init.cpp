@@ -13,8 +13,10 @@
 #include <cstdlib>
 #include <cmath>
 #include <string>
+#include <sstream>
 #include <fstream>
 #include <iostream>
+#include <vector>
 #include "qwwad/constants.h"
 #include "qwwad/maths-helpers.h"
 #include "qwwad/file-io.h"
@@ -56,6 +58,12 @@ DensityinputOptions::DensityinputOptions(int argc, char* argv[]) :
     add_option<size_t>     ("nval",                1,  "Split population between a number of equivalent valleys");
     add_option<std::string>("type",           "even",  "Type of carrier distribution across states. Permitted "
                                                        "options are: fermi, ground or even");
+    add_option<std::string>("densities",               "Comma-separated list of sheet densities [m^{-2}].  If this or "
+                                                       "--temperatures is given, a thermal distribution is found for "
+                                                       "every combination of density and temperature.");
+    add_option<std::string>("temperatures",            "Comma-separated list of carrier temperatures [K], for a "
+                                                       "batch of thermal distributions.");
+    add_option<std::string>("batchfile",   "N-batch.r", "Filename to which the batch of distributions is written.");
 
     add_prog_specific_options_and_parse(argc, argv, doc);
 
@@ -87,6 +95,67 @@ DensityinputOptions::DensityinputOptions(int argc, char* argv[]) :
     }
 }
 
+/**
+ * \brief Find thermal distributions for every combination of density and temperature
+ *
+ * \param[in] opt  User options
+ * \param[in] E    Energies of subband minima [J]
+ * \param[in] n2D  Sheet doping, used if no densities are listed [m^{-2}]
+ *
+ * \details Each row of the output table contains the sheet density [m^{-2}],
+ *          temperature [K], Fermi energy [meV] and then the population of each
+ *          subband [m^{-2}].
+ */
+static void find_batch(const DensityinputOptions &opt,
+                       const arma::vec           &E,
+                       const double               n2D)
+{
+    const auto nval = opt.get_option<size_t>("nval");
+    const auto md   = opt.get_option<double>("mass") * me; // Density-of-states mass [kg]
+
+    arma::vec N_list  = arma::vec(opt.get_numeric_list("densities"));
+    arma::vec Te_list = arma::vec(opt.get_numeric_list("temperatures"));
+
+    if(N_list.empty())
+        N_list = n2D * arma::ones(1);
+
+    if(Te_list.empty())
+        Te_list = opt.get_option<double>("Te") * arma::ones(1);
+
+    const auto nN     = N_list.size();
+    const auto nT     = Te_list.size();
+    const auto ncases = nN*nT;
+
+    // Sweep through densities for each temperature, so that each search starts
+    // close to the previous result
+    arma::vec N(ncases);
+    arma::vec Te(ncases);
+
+    for(unsigned int iT = 0; iT < nT; ++iT)
+    {
+        for(unsigned int iN = 0; iN < nN; ++iN)
+        {
+            N[iT*nN + iN]  = N_list[iN];
+            Te[iT*nN + iN] = Te_list[iT];
+        }
+    }
+
+    arma::vec E_F;
+    const arma::mat pop = find_pop_global_batch(E, md, N, Te, E_F) / nval;
+
+    TableWriter stream(opt.get_option<std::string>("batchfile"), 17);
+
+    for(unsigned int i = 0; i < ncases; ++i)
+    {
+        stream << N[i] << '\t' << Te[i] << '\t' << E_F[i]*1000/e;
+
+        for(unsigned int ist = 0; ist < E.size(); ++ist)
+            stream << '\t' << pop(i, ist);
+
+        stream << '\n';
+    }
+}
+
 int main(int argc, char *argv[])
 {
     DensityinputOptions opt(argc, argv);
@@ -109,6 +178,18 @@ int main(int argc, char *argv[])
     const size_t nst = E.size();    // Number of subbands
     arma::vec pop(nst); // Population of each subband
 
+    if(opt.get_argument_known("densities") || opt.get_argument_known("temperatures"))
+    {
+        if(opt.get_dist_type() != DIST_FERMI)
+        {
+            std::cerr << "A batch of distributions can only be found with --type fermi" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        find_batch(opt, E, n2D);
+        return EXIT_SUCCESS;
+    }
+
     // Generate distribution depending on the user-specified type
     switch(opt.get_dist_type())
     {
@@ -122,7 +203,7 @@ int main(int argc, char *argv[])
         case DIST_FERMI:
             {
                 const auto _md = opt.get_option<double>("mass") * me; // Density-of-states mass [kg]
-                const auto T   = opt.get_option<double>("temperature");
+                const auto T   = opt.get_option<double>("Te");
 
                 // Fermi energy for entire system [J]
                 double Ef = find_fermi_global(E, _md, n2D, T);
@@ -130,8 +211,7 @@ int main(int argc, char *argv[])
                 if(opt.get_verbose())
                     std::cout << "Fermi energy = " << Ef << " J (" << Ef *1000/e << " meV)." << std::endl;
 
-                for(unsigned int i=0; i<nst; i++)
-                    pop[i] = find_pop(E[i], Ef, _md, T) / nval;
+                pop = find_pop(E, Ef, _md, T) / nval;
             }
             break;
 
@@ -0,0 +1,110 @@
+/**
+ * \file   qwwad_pp_band_interpolation.cpp
+ * \brief  Interpolate pseudopotential band energies from a coarse grid onto any set of wave vectors
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ *
+ * \details The band energies are read from the Ek?.r files written by
+ *          qwwad_pp_large_basis, for the wave vectors generated by
+ *          qwwad_reciprocal_kgrid_fcc.  A Fourier series through these energies
+ *          is then evaluated along a path, so that a finely-sampled dispersion
+ *          curve needs no further diagonalisation.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <valarray>
+#include <vector>
+#include "qwwad/band-interpolator.h"
+#include "qwwad/file-io.h"
+#include "qwwad/kpoint-grid.h"
+#include "qwwad/options.h"
+#include "qwwad/pplb-functions.h"
+
+using namespace QWWAD;
+
+/**
+ * \brief Configure command-line options for the program
+ */
+static Options configure_options(int argc, char* argv[])
+{
+    Options opt;
+
+    std::string doc("Interpolate pseudopotential band energies from a uniform grid of wave vectors "
+                    "onto a path through the Brillouin zone.");
+
+    opt.add_option<unsigned int>("ndivisions,n",      8, "Number of divisions of the wave-vector grid along each "
+                                                         "reciprocal lattice vector, as used in "
+                                                         "qwwad_reciprocal_kgrid_fcc.");
+    opt.add_option<bool>        ("full",                 "The energies were found at every point in the grid, rather "
+                                                         "than only at the irreducible points.");
+    opt.add_option<std::string> ("kpathfile", "kpath.r", "Filename from which the wave vectors on the path are read "
+                                                         "[2pi/A0].");
+    opt.add_option<double>      ("degeneracytol",  0.05, "Bands that come within this energy of each other are "
+                                                         "interpolated together, so that crossings are smooth [eV].");
+    opt.add_option<unsigned int>("threads",           0, "Number of threads to use (0 = one per CPU core).");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, doc);
+
+    return opt;
+}
+
+int main(int argc, char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    try
+    {
+        const FCCKPointGrid grid(opt.get_option<unsigned int>("ndivisions"));
+
+        const arma::mat E_full = opt.get_option<bool>("full")
+                                 ? read_band_energies(grid.get_full_points().size())
+                                 : grid.unfold(read_band_energies(grid.get_irreducible_points().size()));
+
+        const BandInterpolator interpolator(grid, E_full, opt.get_option<double>("degeneracytol"));
+
+        // Read the path
+        std::valarray<double> kx;
+        std::valarray<double> ky;
+        std::valarray<double> kz;
+        read_table(opt.get_option<std::string>("kpathfile").c_str(), kx, ky, kz);
+
+        std::vector<arma::vec> k(kx.size(), arma::vec(3));
+
+        for(unsigned int ik = 0; ik < kx.size(); ++ik)
+        {
+            k[ik][0] = kx[ik];
+            k[ik][1] = ky[ik];
+            k[ik][2] = kz[ik];
+        }
+
+        const arma::mat E_k = interpolator.get_energies(k, opt.get_option<unsigned int>("threads"));
+
+        // Write the dispersion in the same form as qwwad_pp_dispersion
+        TableWriter stream("Ek.r");
+
+        for(unsigned int ik = 0; ik < k.size(); ++ik)
+        {
+            stream << arma::norm(k[ik]);
+
+            for(unsigned int ib = 0; ib < E_k.n_cols; ++ib)
+                stream << '\t' << E_k(ik, ib);
+
+            stream << '\n';
+        }
+
+        if(opt.get_verbose())
+        {
+            std::cout << "Interpolated " << interpolator.get_n_bands() << " bands using "
+                      << interpolator.get_n_lattice_vectors() << " lattice vectors." << std::endl;
+        }
+    }
+    catch(std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -7,6 +7,12 @@
    from the eigenvectors generated by pplb.c.  Written only for the 
    zone center (k=0) at present.
 
+   Where the reciprocal lattice vectors are integer multiples of 2pi/A0
+   (as for any cubic lattice), each wave function is found over the
+   whole grid at once with an inverse FFT, and the bands are shared
+   between threads.  Otherwise, the plane-wave sum is evaluated
+   directly at each point.
+
    Input files:
                a_nk.r       expansion coefficients of eigenvectors
                   G.r       reciprocal lattice vectors
@@ -24,14 +30,34 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <complex>
+#include <vector>
+#include <gsl/gsl_fft_complex.h>
 #include <gsl/gsl_math.h>
 #include "qwwad/maths-helpers.h"
 #include "qwwad/constants.h"
+#include "qwwad/parallel.h"
 #include "qwwad/ppff.h"
 
+using namespace QWWAD;
+
 static arma::cx_vec read_ank(const int  N,
                              int       *Nn);
 
+static bool get_integer_rlv(const std::vector<arma::vec>  &G,
+                            const double                   A0,
+                            std::vector<std::vector<long>> &g);
+
+static std::vector<double> find_cd_fft(const arma::cx_vec                   &ank,
+                                       const int                             Nn,
+                                       const int                             n_min,
+                                       const int                             n_max,
+                                       const std::vector<std::vector<long>> &g,
+                                       const int                             n_xyz,
+                                       const arma::vec                      &r_min,
+                                       const size_t                          n_r[3],
+                                       const unsigned int                    n_threads);
+
 int main(int argc,char *argv[])
 {
 std::complex<double> psi;    	/* the wave function psi_nk(r)			*/
@@ -54,11 +80,12 @@ int	Nn;		/* number of bands in eigenvector file		*/
 int	n_min;          /* lowest band in summation			*/
 int	n_max;		/* highest band in summation		 	*/
 int	n_xyz;          /* number of points per lattice constant        */
+unsigned int n_threads; /* number of threads (0 = one per CPU core)     */
 FILE	*Fcd;           /* pointer to charge density file, cd.r         */
 FILE	*Fcdx;          /* pointer to x coordinates file, cdx.r         */
 FILE	*Fcdy;          /* pointer to y coordinates file, cdy.r         */
 FILE	*Fcdz;		/* pointer to z coordinates file, cdz.r         */
-arma::vec r;		/* position                                     */
+arma::vec r(3);		/* position                                     */
 
 /* default values	*/
 
@@ -72,6 +99,7 @@ y_min=0;
 y_max=0;
 z_min=0;
 z_max=1;
+n_threads=0;
 
 while((argc>1)&&(argv[1][0]=='-'))
 {
@@ -107,6 +135,9 @@ while((argc>1)&&(argv[1][0]=='-'))
   case 'Z':
 	   z_max=atof(argv[2]);
 	   break;
+  case 't':
+	   n_threads=atoi(argv[2]);
+	   break;
   default :
 	   printf("Usage: ppcd [-x # (\033[1m0\033[0mA0)][-X # (\033[1m0\033[0mA0)]     minimum and maximum\n");
 	   printf("            [-y # (\033[1m0\033[0mA0)][-Y # (\033[1m0\033[0mA0)]     extent of charge\n");
@@ -114,6 +145,7 @@ while((argc>1)&&(argv[1][0]=='-'))
 	   printf("            [-N # points per A0 \033[1m20\033[0m]\n");
 	   printf("            [-n # lowest band \033[1m1\033[0m][-m highest band \033[1m4\033[0m], lowest band in ank file=1\n");
 	   printf("            [-A Lattice constant (\033[1m5.65\033[0mAngstrom)]\n");
+	   printf("            [-t # threads \033[1m0\033[0m (one per CPU core)]\n");
 	   exit(0);
  }
  argv++;
@@ -137,37 +169,62 @@ if((n_max-n_min+1)>Nn)
 	exit(EXIT_FAILURE);
 }
 
-/* Open file for charge density */
+/* Number of points along each axis of the cuboid */
+size_t n_r[3];
+n_r[0] = floor((x_max-x_min)*n_xyz) + 1;
+n_r[1] = floor((y_max-y_min)*n_xyz) + 1;
+n_r[2] = floor((z_max-z_min)*n_xyz) + 1;
 
-Fcd=fopen("cd.r","w");
+std::vector<std::vector<long>> g; /* G vectors in units of 2pi/A0 */
+std::vector<double> cd;           /* charge density at each point, with z fastest */
 
-for(ix=0;ix<=(x_max-x_min)*n_xyz;ix++)		/* index along x-axis */
+if(get_integer_rlv(G, A0, g))
+{
+ arma::vec r_min(3);
+ r_min(0) = x_min;
+ r_min(1) = y_min;
+ r_min(2) = z_min;
+ cd = find_cd_fft(ank, Nn, n_min, n_max, g, n_xyz, r_min, n_r, n_threads);
+}
+else
 {
- r(0) = (x_min+(float)ix/(float)n_xyz)*A0;
- for(iy=0;iy<=(y_max-y_min)*n_xyz;iy++)		/* index along y-axis */
+ cd.resize(n_r[0]*n_r[1]*n_r[2]);
+
+ for(ix=0;ix<(int)n_r[0];ix++)			/* index along x-axis */
  {
-  r(1) =(y_min+(float)iy/(float)n_xyz)*A0;
-  for(iz=0;iz<=(z_max-z_min)*n_xyz;iz++)	/* index along z-axis */
+  r(0) = (x_min+(float)ix/(float)n_xyz)*A0;
+  for(iy=0;iy<(int)n_r[1];iy++)			/* index along y-axis */
   {
-   r(2) =(z_min+(float)iz/(float)n_xyz)*A0;
-   psi_sqr=0;
-   for(in=n_min;in<=n_max;in++)			/* sum over bands */
+   r(1) =(y_min+(float)iy/(float)n_xyz)*A0;
+   for(iz=0;iz<(int)n_r[2];iz++)		/* index along z-axis */
    {
-    /* Calculate psi_nk(r)	*/
-    psi=0;
-    for(iG=0;iG<N;iG++)				/* sum over G */
+    r(2) =(z_min+(float)iz/(float)n_xyz)*A0;
+    psi_sqr=0;
+    for(in=n_min;in<=n_max;in++)		/* sum over bands */
     {
-     Gdotr = dot(G[iG], r);
-     psi += ank[iG*Nn+in] * exp(std::complex<double>(0.0, Gdotr));
+     /* Calculate psi_nk(r)	*/
+     psi=0;
+     for(iG=0;iG<N;iG++)			/* sum over G */
+     {
+      Gdotr = dot(G[iG], r);
+      psi += ank[iG*Nn+in] * exp(std::complex<double>(0.0, Gdotr));
+     }
+     const double psi_abs = abs(psi);
+     psi_sqr += psi_abs*psi_abs / Omega;
     }
-    const double psi_abs = abs(psi);
-    psi_sqr += psi_abs*psi_abs / Omega;
+    cd[(ix*n_r[1] + iy)*n_r[2] + iz] = psi_sqr;
    }
-   fprintf(Fcd,"%le\n",psi_sqr);
   }
  }
 }
 
+/* Write charge density to file */
+
+Fcd=fopen("cd.r","w");
+
+for(auto const cd_r : cd)
+ fprintf(Fcd,"%le\n",cd_r);
+
 fclose(Fcd);	/* Close charge density file	*/
 
 /* now regenerate positions r for writing to file */
@@ -200,6 +257,184 @@ return EXIT_SUCCESS;
 
 /******************************************************************************/
 
+/**
+ * \brief Express the reciprocal lattice vectors as integer multiples of 2pi/A0
+ *
+ * \param[in]  G  Reciprocal lattice vectors [1/m]
+ * \param[in]  A0 Lattice constant [m]
+ * \param[out] g  Components of each vector in units of 2pi/A0
+ *
+ * \returns False if any component is not an integer, in which case the FFT
+ *          cannot be used
+ */
+static bool get_integer_rlv(const std::vector<arma::vec>  &G,
+                            const double                   A0,
+                            std::vector<std::vector<long>> &g)
+{
+    g.assign(G.size(), std::vector<long>(3));
+
+    for(unsigned int iG = 0; iG < G.size(); ++iG)
+    {
+        for(unsigned int c = 0; c < 3; ++c)
+        {
+            const double g_real = G[iG](c)*A0/(2.0*M_PI);
+            g[iG][c] = lround(g_real);
+
+            if(fabs(g_real - g[iG][c]) > 1e-6)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * \brief Find the charge density on the cuboid using inverse FFTs
+ *
+ * \param[in] ank       Eigenvector coefficients, with index [iG*Nn + in]
+ * \param[in] Nn        Number of bands in eigenvector file
+ * \param[in] n_min     Lowest band in summation
+ * \param[in] n_max     Highest band in summation
+ * \param[in] g         Reciprocal lattice vectors in units of 2pi/A0
+ * \param[in] n_xyz     Number of points per lattice constant
+ * \param[in] r_min     Corner of the cuboid in units of A0
+ * \param[in] n_r       Number of points along each axis of the cuboid
+ * \param[in] n_threads Number of bands to find at once (0 = one per CPU core)
+ *
+ * \returns The charge density at each point in the cuboid, with z fastest
+ *
+ * \details At the points r = r_min + (ix,iy,iz)A0/n_xyz, the wave function is
+ *          \f[
+ *            \psi(\mathbf{r}) = \sum_\mathbf{G} a(\mathbf{G})
+ *                e^{2\pi i\mathbf{g}\cdot\mathbf{r}_\mathrm{min}}
+ *                e^{2\pi i(g_x i_x + g_y i_y + g_z i_z)/n_{xyz}},
+ *          \f]
+ *          which is an inverse DFT of length n_xyz along each axis, once each
+ *          coefficient has been added into the slot given by its g vector
+ *          modulo n_xyz.  This is exact, and the density repeats with period
+ *          n_xyz along each axis, so only one period is found and copied out
+ *          over the cuboid.  The transform is skipped along any axis of the
+ *          cuboid that has only a single point, so a 2D slice only needs
+ *          2D transforms.
+ */
+static std::vector<double> find_cd_fft(const arma::cx_vec                   &ank,
+                                       const int                             Nn,
+                                       const int                             n_min,
+                                       const int                             n_max,
+                                       const std::vector<std::vector<long>> &g,
+                                       const int                             n_xyz,
+                                       const arma::vec                      &r_min,
+                                       const size_t                          n_r[3],
+                                       const unsigned int                    n_threads)
+{
+    // Size of the FFT grid along each axis
+    size_t L[3];
+
+    for(unsigned int c = 0; c < 3; ++c)
+        L[c] = (n_r[c] == 1) ? 1 : n_xyz;
+
+    const size_t stride[3] = {L[1]*L[2], L[2], 1}; // z fastest
+    const size_t n_grid    = L[0]*L[1]*L[2];
+
+    // Find the slot for each G vector in the grid, and its phase at the corner
+    // of the cuboid
+    const size_t N = g.size();
+    std::vector<size_t> i_grid(N);
+    std::vector<std::complex<double>> phase(N);
+
+    for(unsigned int iG = 0; iG < N; ++iG)
+    {
+        i_grid[iG]     = 0;
+        double g_dot_r = 0.0;
+
+        for(unsigned int c = 0; c < 3; ++c)
+        {
+            const long L_c = L[c];
+            i_grid[iG] += (((g[iG][c] % L_c) + L_c) % L_c) * stride[c];
+            g_dot_r    += g[iG][c] * r_min(c);
+        }
+
+        phase[iG] = exp(std::complex<double>(0.0, 2.0*M_PI*g_dot_r));
+    }
+
+    std::vector<gsl_fft_complex_wavetable *> wavetable(3, NULL);
+
+    for(unsigned int c = 0; c < 3; ++c)
+    {
+        if(L[c] > 1)
+            wavetable[c] = gsl_fft_complex_wavetable_alloc(L[c]);
+    }
+
+    // Density for each band, over one period of the grid
+    const int n_bands = n_max - n_min + 1;
+    std::vector<std::vector<double>> cd_band(n_bands);
+
+    run_in_parallel(n_bands, n_threads, [&](const size_t iband) {
+        const int in = n_min + iband;
+        std::vector<std::complex<double>> psi(n_grid, 0.0);
+
+        for(unsigned int iG = 0; iG < N; ++iG)
+            psi[i_grid[iG]] += ank[iG*Nn+in] * phase[iG];
+
+        // std::complex<double> is layout-compatible with GSL's packed complex arrays
+        auto packed = reinterpret_cast<double *>(psi.data());
+
+        for(unsigned int c = 0; c < 3; ++c)
+        {
+            if(L[c] == 1)
+                continue;
+
+            gsl_fft_complex_workspace *workspace = gsl_fft_complex_workspace_alloc(L[c]);
+
+            // Indices of the other two axes
+            const unsigned int a = (c+1)%3;
+            const unsigned int b = (c+2)%3;
+
+            for(size_t ib = 0; ib < L[b]; ++ib)
+            {
+                for(size_t ia = 0; ia < L[a]; ++ia)
+                {
+                    double *start = packed + 2*(ia*stride[a] + ib*stride[b]);
+                    gsl_fft_complex_backward(start, stride[c], L[c], wavetable[c], workspace);
+                }
+            }
+
+            gsl_fft_complex_workspace_free(workspace);
+        }
+
+        cd_band[iband].resize(n_grid);
+
+        for(size_t i = 0; i < n_grid; ++i)
+            cd_band[iband][i] = std::norm(psi[i]);
+    });
+
+    for(unsigned int c = 0; c < 3; ++c)
+    {
+        if(wavetable[c])
+            gsl_fft_complex_wavetable_free(wavetable[c]);
+    }
+
+    // Sum over bands, and copy the period out over the whole cuboid
+    std::vector<double> cd(n_r[0]*n_r[1]*n_r[2], 0.0);
+
+    for(size_t ix = 0; ix < n_r[0]; ++ix)
+    {
+        for(size_t iy = 0; iy < n_r[1]; ++iy)
+        {
+            for(size_t iz = 0; iz < n_r[2]; ++iz)
+            {
+                const size_t i = (ix%L[0])*stride[0] + (iy%L[1])*stride[1] + (iz%L[2])*stride[2];
+                double &cd_r = cd[(ix*n_r[1] + iy)*n_r[2] + iz];
+
+                for(int iband = 0; iband < n_bands; ++iband)
+                    cd_r += cd_band[iband][i];
+            }
+        }
+    }
+
+    return cd;
+}
+
 
 
 /**
@@ -0,0 +1,96 @@
+/**
+ * \file   qwwad_pp_density_of_states.cpp
+ * \brief  Bulk density of states from pseudopotential band energies, using the tetrahedron method
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ *
+ * \details The band energies are read from the Ek?.r files written by
+ *          qwwad_pp_large_basis, for the wave vectors generated by
+ *          qwwad_reciprocal_kgrid_fcc.  The linear tetrahedron method gives a
+ *          smooth density of states from a much coarser grid than a histogram.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include "qwwad/file-io.h"
+#include "qwwad/kpoint-grid.h"
+#include "qwwad/options.h"
+#include "qwwad/pplb-functions.h"
+#include "qwwad/tetrahedron-dos.h"
+
+using namespace QWWAD;
+
+/**
+ * \brief Configure command-line options for the program
+ */
+static Options configure_options(int argc, char* argv[])
+{
+    Options opt;
+
+    std::string doc("Find the bulk density of states from pseudopotential band energies, using the "
+                    "linear tetrahedron method.");
+
+    opt.add_option<unsigned int>("ndivisions,n",    8, "Number of divisions of the wave-vector grid along each "
+                                                       "reciprocal lattice vector, as used in "
+                                                       "qwwad_reciprocal_kgrid_fcc.");
+    opt.add_option<bool>        ("full",               "The energies were found at every point in the grid, rather "
+                                                       "than only at the irreducible points.");
+    opt.add_option<double>      ("Emin",               "Lowest energy at which to find the density of states [eV]. "
+                                                       "By default, the lowest band energy is used.");
+    opt.add_option<double>      ("Emax",               "Highest energy at which to find the density of states [eV]. "
+                                                       "By default, the highest band energy is used.");
+    opt.add_option<size_t>      ("nE",           1000, "Number of energies at which to find the density of states.");
+    opt.add_option<unsigned int>("threads",         0, "Number of threads to use (0 = one per CPU core).");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, doc);
+
+    return opt;
+}
+
+int main(int argc, char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    try
+    {
+        const FCCKPointGrid grid(opt.get_option<unsigned int>("ndivisions"));
+
+        const arma::mat E_full = opt.get_option<bool>("full")
+                                 ? read_band_energies(grid.get_full_points().size())
+                                 : grid.unfold(read_band_energies(grid.get_irreducible_points().size()));
+
+        const double E_min = opt.get_argument_known("Emin") ? opt.get_option<double>("Emin") : E_full.min();
+        const double E_max = opt.get_argument_known("Emax") ? opt.get_option<double>("Emax") : E_full.max();
+
+        if(E_max <= E_min)
+        {
+            std::cerr << "The highest energy must be above the lowest energy." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        const arma::vec      E = arma::linspace(E_min, E_max, opt.get_option<size_t>("nE"));
+        const TetrahedronDOS tetrahedra(grid, E_full);
+
+        arma::vec g; // Density of states per band [1/eV]
+        arma::vec N; // Number of states per band below each energy
+        tetrahedra.get_dos(E, g, N, opt.get_option<unsigned int>("threads"));
+
+        // Each band holds two states (one for each spin) in each primitive cell
+        const arma::vec g_cell = 2*g;
+        const arma::vec N_cell = 2*N;
+        write_table("dos-pp.r", E, g_cell, N_cell);
+
+        if(opt.get_verbose())
+        {
+            std::cout << "Found the density of states using " << tetrahedra.get_n_tetrahedra()
+                      << " tetrahedra." << std::endl;
+        }
+    }
+    catch(std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -9,7 +9,13 @@
  *          in the file atoms.xyz (XYZ format file).
  *
  *          Note this code is written for clarity of understanding and not
- *          solely computational speed.  
+ *          solely computational speed.  The only concessions are that the
+ *          wave vectors are shared between a pool of threads (and between
+ *          MPI processes, in an MPI build), since they are independent of
+ *          each other, that very large bases can be handled using a
+ *          matrix-free Hamiltonian (--matrixfree), and that the eigenvectors
+ *          at one point on a path can be used as the starting point at the
+ *          next (--kpath).
  *
  *          Input files:
  *		atoms.xyz	atomic species and positions
@@ -19,17 +25,24 @@
  *          Output files:
  *		ank.r		eigenvectors	
  *		Ek?.r		eigenenergies for each k
+ *		(optional)	a single binary file of all eigenenergies and
+ *				eigenvectors (--binaryfile)
  */
 
 #if HAVE_CONFIG_H
 # include <config.h>
 #endif
 
+#include <algorithm>
 #include <complex>
 #include <valarray>
 #include <cstdio>
 #include <cstdlib>
 #include <cmath>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <gsl/gsl_math.h>
 
 #include <armadillo>
@@ -37,10 +50,14 @@
 #include "struct.h"
 #include "maths.h"
 #include "qwwad/constants.h"
+#include "qwwad/distributed.h"
 #include "qwwad/linear-algebra.h"
+#include "qwwad/memory-budget.h"
 #include "qwwad/options.h"
+#include "qwwad/parallel.h"
 #include "qwwad/ppff.h"
 #include "qwwad/file-io.h"
+#include "qwwad/plane-wave-hamiltonian.h"
 #include "qwwad/pplb-functions.h"
 
 using namespace QWWAD;
@@ -56,6 +73,23 @@ Options configure_options(int argc, char* argv[])
     opt.add_option<size_t>("nmin,n",            4, "Lowest output band index (VB = 4, CB = 5)");
     opt.add_option<size_t>("nmax,m",            5, "Highest output band index (VB = 4, CB = 5)");
     opt.add_option<bool>  ("printev,w",            "Print eigenvectors to file");
+    opt.add_option<std::string>("binaryfile",      "Also write the eigenvalues and eigenvectors at all wave vectors "
+                                                   "to a single binary file, which can be read much faster by "
+                                                   "qwwad_pp_superlattice");
+    opt.add_option<unsigned int>("threads",     0, "Number of wave vectors to find at once (0 = one per CPU core)");
+    opt.add_option<bool>  ("matrixfree",           "Apply the Hamiltonian using FFTs rather than storing it, and find "
+                                                   "the lowest bands iteratively.  This allows much larger bases, "
+                                                   "but the reciprocal lattice vectors must lie on a regular grid.");
+    opt.add_option<double>("tolerance",      1e-6, "Convergence threshold for the residual of each band in "
+                                                   "matrix-free or path mode [eV]");
+    opt.add_option<bool>  ("kpath",                "The wave vectors form a continuous path.  The eigenvectors at "
+                                                   "each wave vector are used as the starting point for an "
+                                                   "iterative solution at the next one, so only the bands up to "
+                                                   "nmax are found.");
+    opt.add_option<size_t>("restartinterval",  10, "In path mode, solve from scratch at every nth wave vector");
+    opt.add_option<bool>  ("mixedprecision",       "Diagonalise the dense Hamiltonian in single precision, and then "
+                                                   "refine the eigenpairs in double precision until the residual "
+                                                   "is below the tolerance");
 
     opt.add_prog_specific_options_and_parse(argc, argv, doc);
 
@@ -64,12 +98,14 @@ Options configure_options(int argc, char* argv[])
 
 int main(int argc,char *argv[])
 {
+    DistributedSession session(argc, argv);
     const auto opt = configure_options(argc, argv);
 
     const auto A0    = opt.get_option<double>("latticeconst") * 1e-10; // Lattice constant [m]
     const auto n_min = opt.get_option<size_t>("nmin")-1;               // Lowest output band
     const auto n_max = opt.get_option<size_t>("nmax")-1;               // Highest output band
     const auto ev    = opt.get_option<bool>  ("printev");              // Print eigenvectors?
+    const auto binary = opt.get_argument_known("binaryfile");          // Write binary file?
 
     // Read desired wave vector points from file
     std::valarray<double> kx;
@@ -97,64 +133,286 @@ int main(int argc,char *argv[])
 
     const auto m_per_au = 4.0*pi*eps0*hBar*hBar/(e*e*me); // Unit conversion factor, m/a.u
 
-    // Compute crystal potential matrix. Note that this is independent of wave-vector
-    // so we only need to do this once.
-    arma::cx_mat V_GG(N,N);
+    auto       matrix_free = opt.get_option<bool>("matrixfree");
+    const auto tol         = opt.get_option<double>("tolerance") * e; // Residual threshold [J]
+
+    // Estimate the peak memory use before anything large is allocated.  Each
+    // thread holds its own copy of the dense Hamiltonian (and a single-precision
+    // copy in mixed-precision mode), while the matrix-free solver only holds a
+    // block of trial vectors and the FFT grid.
+    const size_t n_bands     = n_max - n_min + 1;
+    const size_t n_threads   = std::min<size_t>(get_thread_count(opt.get_option<unsigned int>("threads")),
+                                                std::max<size_t>(nk, 1));
+    const size_t cx_size     = sizeof(std::complex<double>);
+    const size_t saved_bytes = binary ? nk*N*n_bands*cx_size : 0; // Results kept for the binary file
+    const size_t single_bytes = opt.get_option<bool>("mixedprecision") ? n_threads*N*N*cx_size/2 : 0;
+    const size_t dense_bytes = (1 + n_threads)*N*N*cx_size + n_threads*N*(n_bands + 64)*cx_size
+                               + single_bytes + saved_bytes;
+    const size_t matrix_free_bytes = n_threads*4*N*(n_max + 1)*cx_size + 8*N*cx_size + saved_bytes;
+
+    if(!matrix_free && !fits_in_memory("dense plane-wave Hamiltonian", dense_bytes))
+    {
+        std::cerr << "The dense Hamiltonian would exceed the memory limit.  "
+                  << "Using the matrix-free solver instead." << std::endl;
+        matrix_free = true;
+    }
 
-    for(unsigned int i=0;i<N;i++)        /* index down rows */
+    if(matrix_free)
     {
-        // Fill in the upper triangle of the matrix
-        for(unsigned int j=i;j<N;j++)
+        try
         {
-            const auto q = G[i] - G[j];
-            V_GG(i,j) = V(A0,m_per_au,atoms,q);
-
-            // Fill in the lower triangle by taking the Hermitian transpose of the elements
-            V_GG(j,i) = conj(V_GG(i,j));
+            check_memory("matrix-free plane-wave Hamiltonian", matrix_free_bytes);
+        }
+        catch(std::exception &ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            exit(EXIT_FAILURE);
         }
     }
 
-    /* Add diagonal elements to matrix H_GG' */
-    for(unsigned int ik = 0; ik < nk; ++ik)
+    // Each form factor is only evaluated once for each shell of G-G' vectors
+    FormFactorTable ff(A0, m_per_au);
+
+    // Compute crystal potential matrix. Note that this is independent of wave-vector
+    // so we only need to do this once.  In matrix-free mode, the potential is
+    // transformed onto a real-space grid instead, and the matrix is never stored.
+    arma::cx_mat V_GG;
+    std::unique_ptr<PlaneWaveHamiltonian> H_pw;
+
+    if(matrix_free)
     {
-        if(opt.get_verbose())
-            std::cout << "Calculating energy at k = " << std::endl
-                << k[ik] << " (" << ik + 1 << "/" << nk << ")" << std::endl;
+        H_pw.reset(new PlaneWaveHamiltonian(G, [&](const arma::vec &q) {
+            return V(ff,atoms,q);
+        }));
 
-        // Construct the complete Hamiltonian matrix now, using crystal potential and
-        // kinetic energy on the diagonals
-        auto H_GG = V_GG;
+        if(opt.get_verbose())
+            std::cout << "Using matrix-free Hamiltonian with " << N << " plane waves and "
+                      << H_pw->get_grid_size() << " FFT grid points" << std::endl;
+    }
+    else
+    {
+        V_GG.set_size(N,N);
 
-        for(unsigned int i=0;i<N;i++)
+        for(unsigned int i=0;i<N;i++)        /* index down rows */
         {
-            // kinetic energy component of H_GG [QWWAD3, 15.77]
-            arma::vec G_plus_k = G[i] + k[ik];
-            const double G_plus_k_sq = dot(G_plus_k, G_plus_k);
-            std::complex<double> T_GG=hBar*hBar/(2*me) * G_plus_k_sq;
-            H_GG(i,i) += T_GG;
+            // Fill in the upper triangle of the matrix
+            for(unsigned int j=i;j<N;j++)
+            {
+                const auto q = G[i] - G[j];
+                V_GG(i,j) = V(ff,atoms,q);
+
+                // Fill in the lower triangle by taking the Hermitian transpose of the elements
+                V_GG(j,i) = conj(V_GG(i,j));
+            }
         }
+    }
+
+    // The wave vectors are independent, so share them between processes, and then
+    // between threads within each process.  Each thread takes its own copy of the
+    // crystal potential matrix and only adds the kinetic energy to the diagonal.
+    //
+    // In path mode, each thread takes a contiguous section of the path instead,
+    // and works along it so that each solution can start from the previous one.
+    std::mutex log_mutex; // Prevents log messages from different threads mixing
+
+    const auto kpath            = opt.get_option<bool>("kpath");
+    const auto restart_interval = std::max<size_t>(opt.get_option<size_t>("restartinterval"), 1);
+    const auto n_found          = n_max + 1; // Number of bands found in path mode
+    const auto mixed            = opt.get_option<bool>("mixedprecision");
+    double     residual_max     = 0.0; // Largest residual after mixed-precision refinement [J]
+
+    // Block size for the iterative solver in path mode, including guard vectors
+    const size_t n_block = std::min<size_t>(N, n_found + std::max<size_t>(4, n_found/4));
 
-        // Find the eigenvalues & eigenvectors of the Hamiltonian matrix
-        arma::vec E(N); // Energy eigenvalues
-        arma::cx_mat ank(N,N); // coefficients of eigenvectors
-        arma::eig_sym(E, ank, H_GG);
+    // Results at each wave vector, kept for the binary file
+    std::vector<arma::vec>    E_all_k(binary ? nk : 0);
+    std::vector<arma::cx_mat> ank_all_k(binary ? nk : 0);
 
-        /* Output eigenvalues in a separate file for each k point */
-        char	filenameE[9];	/* character string for Energy output filename	*/
-        sprintf(filenameE,"Ek%i.r",ik);
-        FILE *FEk=fopen(filenameE,"w");
+    const auto local_k = session.get_local_items(nk);
 
-        for(auto iE=n_min; iE<=n_max; iE++)
-            fprintf(FEk,"%10.6f\n",E(iE)/e);
+    // Number of sections of the path that are solved independently
+    const size_t n_sections = kpath ? std::min<size_t>(n_threads, std::max<size_t>(local_k.size(), 1))
+                                    : local_k.size();
+    const size_t section_size = kpath ? (local_k.size() + n_sections - 1)/n_sections : 1;
 
-        fclose(FEk);
+    run_in_parallel(n_sections, opt.get_option<unsigned int>("threads"), [&](const size_t isection) {
+        const size_t first = isection*section_size;
+        const size_t last  = std::min(first + section_size, local_k.size());
 
-        /* Output eigenvectors */
+        arma::cx_mat X;      // Eigenvectors at the previous wave vector on the path
+        arma::cx_mat guards; // Guard vectors for the iterative solver in path mode
 
-        if(ev){
-            write_ank(ank,ik,N,n_min,n_max);
+        for(size_t ilocal = first; ilocal < last; ++ilocal)
+        {
+            const auto ik = local_k[ilocal];
+
+            if(opt.get_verbose())
+            {
+                std::lock_guard<std::mutex> lock(log_mutex);
+                std::cout << "Calculating energy at k = " << std::endl
+                    << k[ik] << " (" << ik + 1 << "/" << nk << ")" << std::endl;
+            }
+
+            arma::vec E; // Energy eigenvalues for output bands
+            arma::cx_mat ank; // coefficients of eigenvectors for output bands
+
+            // In path mode, solve from scratch at the start of each section and at
+            // regular intervals along it, so that errors cannot build up
+            const bool restart = !kpath || X.is_empty() || (ilocal - first) % restart_interval == 0;
+
+            if(matrix_free)
+            {
+                // Find all the bands up to the highest output band iteratively
+                arma::vec E_all;
+                bool      refined = false;
+
+                if(!restart)
+                {
+                    try
+                    {
+                        E_all   = H_pw->refine_lowest_states(k[ik], n_found, tol, X);
+                        refined = true;
+                    }
+                    catch(std::exception &ex)
+                    {
+                        std::lock_guard<std::mutex> lock(log_mutex);
+                        std::cerr << ex.what() << "  Solving from scratch at k-point "
+                                  << ik + 1 << "." << std::endl;
+                    }
+                }
+
+                if(!refined)
+                    E_all = H_pw->get_lowest_states(k[ik], n_found, tol, X);
+
+                E = E_all.subvec(n_min, n_max);
+
+                if(ev || binary)
+                    ank = X.cols(n_min, n_max);
+
+                if(!kpath)
+                    X.reset();
+            }
+            else
+            {
+                // Construct the complete Hamiltonian matrix now, using crystal potential and
+                // kinetic energy on the diagonals
+                arma::cx_mat H_GG = V_GG;
+
+                for(unsigned int i=0;i<N;i++)
+                {
+                    // kinetic energy component of H_GG [QWWAD3, 15.77]
+                    arma::vec G_plus_k = G[i] + k[ik];
+                    const double G_plus_k_sq = dot(G_plus_k, G_plus_k);
+                    std::complex<double> T_GG=hBar*hBar/(2*me) * G_plus_k_sq;
+                    H_GG(i,i) += T_GG;
+                }
+
+                if(kpath)
+                {
+                    // Start from the eigenvectors at the previous wave vector, along with
+                    // the guard vectors from the last full solution
+                    bool refined = false;
+
+                    if(!restart)
+                    {
+                        try
+                        {
+                            const auto apply_H = [&H_GG](const arma::cx_mat &Y) {
+                                return arma::cx_mat(H_GG*Y);
+                            };
+
+                            const arma::vec H_diag = arma::real(H_GG.diag());
+
+                            arma::cx_mat Y = guards.is_empty() ? X : arma::cx_mat(arma::join_rows(X, guards));
+                            const arma::vec E_all = eigen_hermitian_lobpcg(apply_H, H_diag, Y, n_found, tol);
+                            E       = E_all.subvec(n_min, n_max);
+                            X       = Y;
+                            refined = true;
+                        }
+                        catch(std::exception &ex)
+                        {
+                            std::lock_guard<std::mutex> lock(log_mutex);
+                            std::cerr << ex.what() << "  Using a full diagonalisation at k-point "
+                                      << ik + 1 << "." << std::endl;
+                        }
+                    }
+
+                    if(!refined)
+                    {
+                        // Find the guard vectors as well as the wanted bands
+                        arma::cx_mat Z;
+                        const arma::vec E_all = eigen_hermitian_range(H_GG, 0, n_block-1, Z);
+                        E = E_all.subvec(n_min, n_max);
+                        X = Z.cols(0, n_max);
+
+                        if(n_block > n_found)
+                            guards = Z.cols(n_found, n_block-1);
+                    }
+
+                    if(ev || binary)
+                        ank = X.cols(n_min, n_max);
+                }
+                else if(mixed)
+                {
+                    // The eigenvectors are always found, since they are needed for
+                    // the refinement
+                    double residual = 0.0;
+                    E = eigen_hermitian_range_mixed(H_GG, n_min, n_max, tol, ank, residual);
+
+                    std::lock_guard<std::mutex> lock(log_mutex);
+                    residual_max = std::max(residual_max, residual);
+
+                    if(opt.get_verbose())
+                        std::cout << "Largest residual after refinement: " << residual/e << " eV" << std::endl;
+                }
+                // Find the eigenvalues & eigenvectors of the Hamiltonian matrix.
+                // Only the output bands are found, and the eigenvectors are only
+                // needed if they are to be printed.
+                else if(ev || binary)
+                    E = eigen_hermitian_range(H_GG, n_min, n_max, ank);
+                else
+                    E = eigen_hermitian_range(H_GG, n_min, n_max);
+            }
+
+            /* Output eigenvalues in a separate file for each k point */
+            std::ostringstream filenameE; // Energy output filename
+            filenameE << "Ek" << ik << ".r";
+            TableWriter FEk(filenameE.str());
+
+            // Every line has the same width, since qwwad_pp_dispersion seeks
+            // straight to the first band it needs
+            for(unsigned int iE=0; iE<E.size(); iE++)
+            {
+                char line[32];
+                snprintf(line, sizeof(line), "%10.6f\n", E(iE)/e);
+                FEk << line;
+            }
+
+            /* Output eigenvectors */
+
+            if(ev){
+                write_ank(ank,ik,N,0,n_max-n_min);
+            }
+
+            if(binary)
+            {
+                E_all_k[ik]   = E;
+                ank_all_k[ik] = ank;
+            }
         }
-    }/* end while*/
+    });
+
+    if(mixed && !matrix_free && !kpath)
+    {
+        std::cout << "Mixed-precision eigenvalues are within " << residual_max/e
+                  << " eV of the double-precision values" << std::endl;
+    }
+
+    if(binary)
+        session.gather(E_all_k, ank_all_k);
+
+    if(binary && session.is_root())
+        BulkStatesFile::write(opt.get_option<std::string>("binaryfile"), E_all_k, ank_all_k);
 
     return EXIT_SUCCESS;
 }/* end main */
@@ -15,6 +15,7 @@
  *                 G.r       sorted reciprocal lattice vectors
  */
 
+#include<algorithm>
 #include<cmath>
 #include<cstdio>
 #include<cstdlib>
@@ -25,11 +26,9 @@ static vector * read_rlv(int *N);
 
 int main()
 {
-int	i;		/* index					*/
 int	iG;		/* index over G vectors				*/
 int	N;		/* number of reciprocal lattice vectors		*/
 vector	*G;		/* reciprocal lattice vectors			*/
-vector	Gt;		/* temporary storage of G			*/
 FILE	*FG;		/* file pointer to wavefunction file		*/
 
 G=read_rlv(&N);
@@ -40,19 +39,9 @@ if(system("cp G.r G.r~") != EXIT_SUCCESS)
     exit(EXIT_FAILURE);
 }
 
-/* Need to repeat N times, to allow G[0] to propogate to G[N] */
-for(i=0;i<N;i++)    
-{
- for(iG=0;iG<N-1;iG++)                    
- {
-  if(vmod(*(G+iG))>vmod(*(G+iG+1)))
-  {
-   Gt=*(G+iG+1);
-   *(G+iG+1)=*(G+iG);
-   *(G+iG)=Gt;
-  }
- }
-}
+/* Sort into ascending magnitude, keeping the original order of vectors
+   with equal magnitude */
+std::stable_sort(G, G+N, [](const vector &a, const vector &b) {return vmod(a) < vmod(b);});
 
 FG=fopen("G.r","w");
 
@@ -10,11 +10,15 @@
    in the file atoms.xyz (XYZ format file).
  
    Note this code is written for clarity of understanding and not
-   solely computational speed.  
+   solely computational speed.  The exception is the construction of H',
+   which is written as a set of matrix products over the bulk eigenvectors
+   and shared between threads, since it dominates the run time.
 
    Input files:
 		ank?.r		bulk eigenvectors a_nk(G)
 		Ek?.r		bulk eigenvalues E_nk, for each k
+				(or, with -b, a single binary file of both,
+				written by qwwad_pp_large_basis --binaryfile)
 		atoms.xyz	atomic species and positions of the
 				unperturbed lattice
 		atomsp.xyz	atomic species and positions of the 
@@ -24,18 +28,34 @@
 
    Output files:
    		Exi.r		superlattice eigenvalues E_xi
+
+   With -K, k.r lists the set of kxi points for each of several
+   superlattice wave vectors in turn (e.g., from qwwad_superlattice_k -N),
+   and the bulk states are read for all of them.  The potential matrix for
+   each distinct kxi'-kxi is shared between the superlattice wave vectors,
+   which are then diagonalised in parallel.  Exi.r then holds one line for
+   each superlattice wave vector, giving a miniband dispersion in one run.
 */
 
+#include <algorithm>
 #include <cstdio>
 #include <cmath>
 #include <cstdlib>
 #include <complex>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 #include "struct.h"
 #include "maths.h"
 #include "qwwad/constants.h"
 #include "qwwad/file-io.h"
 #include "qwwad/linear-algebra.h"
+#include "qwwad/memory-budget.h"
+#include "qwwad/parallel.h"
 #include "qwwad/ppff.h"
+#include "qwwad/pplb-functions.h"
 
 using namespace QWWAD;
 using namespace constants;
@@ -43,8 +63,7 @@ using namespace constants;
 static std::complex<double> i1(0,1);
 
 static std::complex<double>
-V(double           A0,
-  double           m_per_au,
+V(FormFactorTable         &ff,
   std::vector<atom> const &atoms,
   std::vector<atom> const &atomsp,
   arma::vec const &g);
@@ -76,7 +95,7 @@ static void clean_Hdash(arma::cx_mat &Hdash);
 
 int main(int argc,char *argv[])
 {
-double	*Enk;		/* bulk energy eigenvalues			*/
+double	*Enk=NULL;	/* bulk energy eigenvalues, read from text	*/
 char	filename[12];	/* character string for Energy output filename	*/
 
 /* default values	*/
@@ -87,6 +106,9 @@ size_t n_min=0;     // Lowest output band
 size_t n_max=3;     // Highest output band
 bool o=false; // if set, output the Fourier Transform VF(g)
 char p='h'; // Particle ID
+unsigned int n_threads=0; // Number of threads (0 = one per CPU core)
+size_t n_sl=1; // Number of superlattice wave vectors
+std::string bulk_filename; // Binary file of bulk states (empty => use text files)
 double m_per_au=4*pi*eps0*gsl_pow_2(hBar/e)/me; // Conversion factor, m/a.u.
 
 while((argc>1)&&(argv[1][0]=='-'))
@@ -110,6 +132,23 @@ while((argc>1)&&(argv[1][0]=='-'))
  	   argv--;
 	   argc++;
            break;
+  case 't':
+           n_threads=atoi(argv[2]);
+           break;
+  case 'b':
+           bulk_filename=argv[2];
+           break;
+  case 'K':
+           n_sl=atoi(argv[2]);
+           if(n_sl==0)
+           {
+               fprintf(stderr, "Error: at least one superlattice wave vector is needed\n");
+               exit(EXIT_FAILURE);
+           }
+           break;
+  case 'M':
+           set_memory_limit(atof(argv[2])*1024*1024);	/* convert MiB->bytes	*/
+           break;
   case 'p':
            p=*argv[2];
            switch(p)
@@ -125,6 +164,10 @@ while((argc>1)&&(argv[1][0]=='-'))
 	   printf("Usage:  ppsl [-A lattice constant (\033[1m5.65\033[0mA)][-f (\033[1m0\033[0mkV/cm)]\n");
 	   printf("             [-n # lowest band \033[1m1\033[0m][-m highest band \033[1m4\033[0m], output eigenvalues\n");
 	   printf("             [-o output field FT][-p particle (e or \033[1mh\033[0m)]\n");
+	   printf("             [-t # threads \033[1m0\033[0m (one per CPU core)]\n");
+	   printf("             [-b binary file of bulk states]\n");
+	   printf("             [-K # superlattice wave vectors \033[1m1\033[0m]\n");
+	   printf("             [-M memory limit \033[1m0\033[0mMiB (no limit)]\n");
 	   exit(0);
  }
  argv++;
@@ -139,85 +182,236 @@ auto const atomsp=read_atoms(filename);	/* read in perturbation	*/
 
 auto const G = read_rlv(A0); // read in reciprocal lattice vectors
 auto const N = G.size(); // number of reciprocal lattice vectors
-auto const Nn=read_ank0(N); /* reads a single ank.r file just to 
-		        	   deduce the number of bands Nn	*/
-
 auto const kxi = read_kxi(A0); // read in set of kxi points
-auto const Nkxi = kxi.size();  // Number of k-points
 
-auto const ank=read_ank(N,Nn,Nkxi);/* read in bulk eigenvectors		*/
-Enk=read_Enk(Nn,Nkxi);	/* read in bulk eigenvalues		*/
+// The kxi points are listed in turn for each superlattice wave vector
+if(kxi.size() % n_sl != 0)
+{
+    fprintf(stderr, "Error: there are %zu wave vectors in k.r, which cannot be shared between "
+            "%zu superlattice wave vectors\n", kxi.size(), n_sl);
+    exit(EXIT_FAILURE);
+}
+
+auto const Nkxi = kxi.size()/n_sl; // Number of k-points for each superlattice wave vector
+
+int Nn;                                 /* number of bulk bands			*/
+const std::complex<double> *ank=NULL;   /* bulk eigenvectors			*/
+const double *E_bulk=NULL;              /* bulk eigenvalues			*/
+std::unique_ptr<BulkStatesFile> bulk_file;
+std::valarray<std::complex<double>> ank_text;
+
+if(!bulk_filename.empty())
+{
+    // Use the bulk states directly from the (memory-mapped) binary file
+    try
+    {
+        bulk_file.reset(new BulkStatesFile(bulk_filename));
+    }
+    catch(std::exception &ex)
+    {
+        fprintf(stderr, "Error: %s\n", ex.what());
+        exit(EXIT_FAILURE);
+    }
+
+    if(bulk_file->get_nG() != N || bulk_file->get_nk() != n_sl*Nkxi)
+    {
+        fprintf(stderr, "Error: %s holds %zu wave vectors with %zu coefficients each, "
+                "but there are %zu wave vectors in k.r and %zu in G.r\n",
+                bulk_filename.c_str(), bulk_file->get_nk(), bulk_file->get_nG(), n_sl*Nkxi, N);
+        exit(EXIT_FAILURE);
+    }
+
+    Nn=bulk_file->get_nbands();
+    ank=bulk_file->get_ank();
+    E_bulk=bulk_file->get_energies();
+}
+else
+{
+    Nn=read_ank0(N); /* reads a single ank.r file just to 
+		        deduce the number of bands Nn	*/
+
+    ank_text=read_ank(N,Nn,n_sl*Nkxi);/* read in bulk eigenvectors	*/
+    ank=&ank_text[0];
+    Enk=read_Enk(Nn,n_sl*Nkxi);	/* read in bulk eigenvalues		*/
+    E_bulk=Enk;
+}
 
 /* Output the  Fourier Transform of the electric field	*/
 
 if(o) write_VF(A0,F,q,atoms);
 
-arma::cx_mat Hdash(Nn*Nkxi, Nn*Nkxi);
+// List the pairs of kxi points for each block in the upper triangle of H'.
+// The lower triangle follows from the Hermiticity of H'.
+//
+// The sums over G and G' for a block depend only on the difference between
+// its pair of bulk wave vectors, kxi'-kxi.  Where the sets of kxi for the
+// superlattice wave vectors are shifted copies of each other, as from
+// qwwad_superlattice_k, these differences are the same for every superlattice
+// wave vector, so each distinct difference is only treated once.  The
+// tolerance allows for k.r being written to six decimal places.
+std::vector<std::pair<unsigned int, unsigned int>> blocks;
+
+for(unsigned int ikxidash=0; ikxidash<Nkxi; ikxidash++)
+{
+    for(unsigned int ikxi=ikxidash; ikxi<Nkxi; ikxi++)
+        blocks.push_back(std::make_pair(ikxidash, ikxi));
+}
 
-/* Create H' matrix elements	*/
-for(unsigned int i=0;i<Nn*Nkxi;i++)	/* index down rows, recall order of Hdash is Nn*Nkxi */
+const size_t n_blocks = blocks.size();
+std::vector<arma::vec> dkxi;                      // Distinct values of kxi'-kxi
+std::vector<size_t>    block_dkxi(n_sl*n_blocks); // Index of kxi'-kxi for each block
+const double           dkxi_tol = 1e-5*2*pi/A0;   // Tolerance for equal kxi'-kxi
+
+for(unsigned int isl=0; isl<n_sl; isl++)
 {
-    // TODO: Just fill in the upper triangle 
-    for(unsigned int j=0; j<N;j++)
+    for(unsigned int iblock=0; iblock<n_blocks; iblock++)
     {
-        /* Deduce the indices of of the bulk eigenvectors for each H' element	*/
-        auto const ikxidash=i/Nn;
-        auto const ikxi=j/Nn;
+        auto const d = kxi[isl*Nkxi+blocks[iblock].first] - kxi[isl*Nkxi+blocks[iblock].second];
 
-        auto const indash=i%Nn;
-        auto const in=j%Nn;
+        size_t id=0;
+        while(id<dkxi.size() && arma::norm(dkxi[id]-d) > dkxi_tol)
+            id++;
 
-        /* Initialise the matrix element before the sum and add energy
-           eigenvalues as specified by delta functions 	*/
-        if((indash==in)&&(ikxidash==ikxi))
-            Hdash(i, j) = Enk[ikxi*Nn+in];
-        else
-            Hdash(i, j) = 0;
+        if(id==dkxi.size())
+            dkxi.push_back(d);
+
+        block_dkxi[isl*n_blocks+iblock]=id;
+    }
+}
+
+// Superlattice wave vectors are solved in batches, one per thread, so that
+// only one H' per thread is held in memory at once
+const size_t n_batch = std::min<size_t>(n_sl, get_thread_count(n_threads));
+
+// Stop straight away if H' would not fit in memory.  As well as H' itself,
+// the bulk eigenvectors are copied, the potential matrix is stored for each
+// distinct kxi'-kxi, each thread needs some space for matrix products and the
+// eigensolver needs some workspace.
+{
+    const size_t cx_size   = sizeof(std::complex<double>);
+    const size_t nH        = static_cast<size_t>(Nn)*Nkxi;
+    const size_t n_workers = std::min<size_t>(get_thread_count(n_threads), n_batch*n_blocks);
+
+    try
+    {
+        check_memory("superlattice Hamiltonian",
+                     (n_batch*(nH*nH + 65*nH) + n_sl*Nkxi*N*Nn + dkxi.size()*N*N
+                      + n_workers*2*N*Nn)*cx_size);
+    }
+    catch(std::exception &ex)
+    {
+        fprintf(stderr, "Error: %s\n", ex.what());
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Copy the bulk eigenvectors at each kxi into an N x Nn matrix, so that the
+// sums over G and G' can be done as matrix products
+std::vector<arma::cx_mat> A(n_sl*Nkxi, arma::cx_mat(N, Nn));
+
+for(unsigned int ikxi=0; ikxi<n_sl*Nkxi; ikxi++)
+{
+    for(unsigned int iG=0; iG<N; iG++)
+    {
+        for(int in=0; in<Nn; in++)
+            A[ikxi](iG, in) = ank[ikxi*N*Nn+iG*Nn+in];
+    }
+}
+
+/* Find the potential matrix M(G',G) = V(g) + VF(g), with g = G'-G+kxi'-kxi,
+   for each distinct kxi'-kxi.  The potential is therefore found once for
+   each pair of G vectors, rather than for every matrix element of H' */
+std::vector<arma::cx_mat> M(dkxi.size());
+
+run_in_parallel(dkxi.size(), n_threads, [&](const size_t id) {
+    M[id].set_size(N, N);
+
+    // Each form factor is only evaluated once for each shell of g vectors
+    FormFactorTable ff(A0, m_per_au);
+
+    for(unsigned int iG=0; iG<N; iG++)			/* sum over G	*/
+    {
+        for(unsigned int iGdash=0; iGdash<N; iGdash++)	/* sum over G'	*/
+        {
+            // Calculate appropriate g vector [QWWAD4, 16.38]
+            auto const g = G[iGdash] - G[iG] + dkxi[id];
+            M[id](iGdash, iG) = V(ff,atoms,atomsp,g) + VF(A0,F,q,atoms,g);
+        }
+    }
+});
+
+std::vector<arma::vec> Exi(n_sl); // Superlattice eigenvalues at each wave vector
+
+for(unsigned int isl_first=0; isl_first<n_sl; isl_first+=n_batch)
+{
+    const size_t n_this_batch = std::min<size_t>(n_batch, n_sl-isl_first);
+
+    std::vector<arma::cx_mat> Hdash(n_this_batch, arma::cx_mat(Nn*Nkxi, Nn*Nkxi));
 
-        for(unsigned int iGdash=0;iGdash<N;iGdash++)	/* sum over G'	*/
+    /* Create H' matrix elements.  Each Nn x Nn block, for a pair of bulk
+       wave vectors kxi' and kxi, is given by [QWWAD4, 16.38]
+
+         H'(kxi',kxi) = A(kxi')^dagger M(kxi',kxi) A(kxi) + E_nk delta(kxi',kxi)
+
+       so the double sum over G and G' is a pair of matrix products. */
+    run_in_parallel(n_this_batch*n_blocks, n_threads, [&](const size_t i) {
+        auto const ib       = i/n_blocks;
+        auto const isl      = isl_first + ib;
+        auto const iblock   = i%n_blocks;
+        auto const ikxidash = blocks[iblock].first;
+        auto const ikxi     = blocks[iblock].second;
+
+        arma::cx_mat H_block = A[isl*Nkxi+ikxidash].t()
+                               * M[block_dkxi[isl*n_blocks+iblock]]
+                               * A[isl*Nkxi+ikxi];
+
+        /* Add energy eigenvalues as specified by delta functions */
+        if(ikxidash == ikxi)
         {
-            for(unsigned int iG=0;iG<N;iG++)			/* sum over G	*/
-            {
-                // Calculate appropriate g vector [QWWAD4, 16.38]
-                auto g = G[iGdash] - G[iG] + kxi[ikxidash] - kxi[ikxi];
-
-                // Add on potential term
-                Hdash(i, j) +=
-                    (
-                     ( conj(   ank[ikxidash*N*Nn+iGdash*Nn+indash]   )
-
-                       *
-
-                       ank[ikxi*N*Nn+iG*Nn+in]
-                     )
-                     *
-                     (
-                      V(A0,m_per_au,atoms,atomsp,g) +
-                      VF(A0,F,q,atoms,g)
-                     )
-                    );
-            } /* end iG */
-        } /* end iGdash */
-    } /* end j */
-} /* end i */
-
-// Clean up matrix H'
-clean_Hdash(Hdash);
-
-// Energy eigenvalues
-arma::vec Exi(Nn*Nkxi);
-
-// coefficients of eigenvectors
-arma::cx_mat Ank(Nn*Nkxi, Nn*Nkxi);
-
-// Find eigenvalue solutions
-arma::eig_sym(Exi, Ank, Hdash);
-
-/* Output eigenvalues in a separate file for each k point */
+            for(int in=0; in<Nn; in++)
+                H_block(in, in) += E_bulk[(isl*Nkxi+ikxi)*Nn+in];
+        }
+
+        Hdash[ib].submat(ikxidash*Nn, ikxi*Nn, (ikxidash+1)*Nn-1, (ikxi+1)*Nn-1) = H_block;
+
+        if(ikxidash != ikxi)
+            Hdash[ib].submat(ikxi*Nn, ikxidash*Nn, (ikxi+1)*Nn-1, (ikxidash+1)*Nn-1) = H_block.t();
+    });
+
+    // The superlattice wave vectors are independent, so are diagonalised
+    // together
+    run_in_parallel(n_this_batch, n_threads, [&](const size_t ib) {
+        // Clean up matrix H'
+        clean_Hdash(Hdash[ib]);
+
+        // Find the energy eigenvalues for the output bands only
+        Exi[isl_first+ib] = eigen_hermitian_range(Hdash[ib], n_min, n_max);
+    });
+}
+
+/* Output eigenvalues.  For a single superlattice wave vector, these are
+   listed in a column.  Otherwise, each line holds the index of the
+   superlattice wave vector, followed by its eigenvalues */
 auto FExi=fopen("Exi.r","w");
-for(unsigned int iE=n_min;iE<=n_max;iE++) {
-    fprintf(FExi,"%10.6f\n", Exi(iE)/e);
+
+if(n_sl == 1)
+{
+    for(unsigned int iE=0;iE<Exi[0].size();iE++) {
+        fprintf(FExi,"%10.6f\n", Exi[0](iE)/e);
+    }
+}
+else
+{
+    for(unsigned int isl=0;isl<n_sl;isl++) {
+        fprintf(FExi,"%u", isl);
+
+        for(unsigned int iE=0;iE<Exi[isl].size();iE++)
+            fprintf(FExi,"\t%10.6f", Exi[isl](iE)/e);
+
+        fprintf(FExi,"\n");
+    }
 }
+
 fclose(FExi);
 
 free(Enk);
@@ -425,15 +619,13 @@ static std::vector<arma::vec> read_kxi(double  A0)
 /**
  * \brief Potential component of Hdash
  *
- * \param A0	   Lattice constant
- * \param m_per_au conversion factor from SI to a.u.
+ * \param ff       table of form factors
  * \param atoms    atomic definitions
  * \param atomsp   atomic definitions
  * \param g        the vector, g=G'-G+kxi'-kxi
  */
 static std::complex<double>
-V(double           A0,
-  double           m_per_au,
+V(FormFactorTable         &ff,
   std::vector<atom> const &atoms,
   std::vector<atom> const &atomsp,
   arma::vec const &g)
@@ -452,8 +644,8 @@ V(double           A0,
      auto const g_dot_g = arma::dot(g,g);
      auto const g_dot_t = arma::dot(g,t);
 
-     vf=Vf(A0, m_per_au,   g_dot_g, atoms[ia].type);
-     vfdash=Vf(A0,m_per_au,g_dot_g, atomsp[ia].type);
+     vf=ff.get(g_dot_g, atoms[ia].type);
+     vfdash=ff.get(g_dot_g, atomsp[ia].type);
      v += exp(-i1*g_dot_t)*(vfdash-vf);
  }
 
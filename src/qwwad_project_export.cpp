@@ -0,0 +1,138 @@
+/**
+ * \file   qwwad_project_export.cpp
+ * \brief  Write the tables in a project file to separate data files
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "qwwad/file-io.h"
+#include "qwwad/options.h"
+
+using namespace QWWAD;
+
+/**
+ * Configure command-line options for the program
+ */
+Options configure_options(int argc, char* argv[])
+{
+    Options opt;
+
+    std::string summary("Write the tables in a project file (see --project) to separate data files.");
+
+    opt.add_option<std::string>("tables",           "Comma-separated list of tables to export, e.g., v.r,Ee.r.  If this "
+                                                    "is not given, every table is exported.");
+    opt.add_option<std::string>("outputdir",   ".", "Directory to which the files are written.");
+    opt.add_option<bool>       ("list,l",           "List the tables in the project, without exporting them.");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, summary);
+
+    return opt;
+}
+
+/**
+ * \brief Find the names of the tables to export
+ *
+ * \param[in] opt User options
+ *
+ * \returns The names of the tables
+ */
+static std::vector<std::string> get_table_names(const Options &opt)
+{
+    if(!opt.get_argument_known("tables"))
+        return list_piped_tables();
+
+    return opt.get_list("tables");
+}
+
+/**
+ * \brief Write a table to a data file
+ *
+ * \param[in] table    The table
+ * \param[in] filename Name of the file
+ *
+ * \details Text tables are written exactly as they were stored.  Numeric tables
+ *          are written with one row per line, with each value given to full
+ *          precision, so that they are read back unchanged.
+ */
+static void export_table(const PipedTable  &table,
+                         const std::string &filename)
+{
+    std::ofstream stream(filename.c_str(), std::ios::binary);
+
+    if(!stream.is_open())
+    {
+        std::cerr << "Could not create " << filename << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if(!table.numeric)
+        stream << table.text;
+    else
+    {
+        const double *value = table.values.data();
+        char          text[32];
+
+        for(auto const row_length : table.row_lengths)
+        {
+            for(uint32_t icol = 0; icol < row_length; ++icol)
+            {
+                snprintf(text, sizeof(text), "%.17g", *value++);
+                stream << (icol > 0 ? "\t" : "") << text;
+            }
+
+            stream << '\n';
+        }
+    }
+
+    if(!stream)
+    {
+        std::cerr << "Could not write to " << filename << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    if(!opt.get_argument_known("project"))
+    {
+        std::cerr << "The project file must be given using --project." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    const auto names = get_table_names(opt);
+
+    for(auto const &name : names)
+    {
+        const auto table = find_piped_table(name);
+
+        if(!table)
+        {
+            std::cerr << "No table called " << name << " in the project." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        if(opt.get_option<bool>("list"))
+        {
+            if(table->numeric)
+                std::cout << name << "\t" << table->row_lengths.size() << " rows" << std::endl;
+            else
+                std::cout << name << "\t" << std::count(table->text.begin(), table->text.end(), '\n')
+                          << " lines of text" << std::endl;
+        }
+        else
+            export_table(*table, opt.get_option<std::string>("outputdir") + "/" + name);
+    }
+
+    return EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
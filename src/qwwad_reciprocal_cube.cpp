@@ -26,21 +26,28 @@ Paul Harrison, Modifications 1998	               */
  
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "qwwad/constants.h"
+#include "qwwad/ppff.h"
+
+using namespace QWWAD::constants;
 
 int main(int argc, char *argv[])
 {
-double	beta_1;		/* coefficients of the reciprocal lattice vectors */
-double	beta_2;		/*  b_1, b_2 and b_3 constituting the general     */
-double	beta_3;		/*  reciprocal lattice vector G                   */
 int	n_x;		/* number fcc cells along x-axis of large basis   */
 int	n_y;		/* number fcc cells along y-axis of large basis   */
 int	n_z;		/* number fcc cells along z-axis of large basis   */
-int	G_max;		/* maximum value of |G|, e.g. [400]=>|G|=4        */
-FILE	*FG;
+double	G_max;		/* maximum value of |G|, e.g. [400]=>|G|=4        */
+double	E_cut;		/* kinetic energy cut-off [J] (0 => use G_max)    */
+double	A0;		/* lattice constant [m]                           */
 
 /* default values	*/
 
 G_max=4;
+E_cut=0;
+A0=5.65e-10;
 n_x=1;n_y=1;n_z=1;
 
 while((argc>1)&&(argv[1][0]=='-'))
@@ -50,6 +57,12 @@ while((argc>1)&&(argv[1][0]=='-'))
   case 'g':
 	   G_max=atoi(argv[2]);;
 	   break;
+  case 'E':
+	   E_cut=atof(argv[2])*e;
+	   break;
+  case 'A':
+	   A0=atof(argv[2])*1e-10;
+	   break;
   case 'x':
 	   n_x=atoi(argv[2]);
            break;
@@ -61,6 +74,8 @@ while((argc>1)&&(argv[1][0]=='-'))
            break;
   default :
 	   printf("Usage: rlv-sc [-g maximum value of |G| \033[1m4\033[0m]\n");
+	   printf("              [-E kinetic energy cut-off (eV), overrides -g]\n");
+	   printf("              [-A lattice constant (\033[1m5.65\033[0mA), for use with -E]\n");
 	   printf("              [-x # fcc cells along x-axis \033[1m1\033[0m][-y # \033[1m1\033[0m][-z # \033[1m1\033[0m]\n");
            break;
  }
@@ -70,15 +85,60 @@ while((argc>1)&&(argv[1][0]=='-'))
  argc--;
 }
 
-FG=fopen("G.r","w");
+/* Convert the energy cut-off, hbar^2 G^2/(2m0), into units of 2pi/A0	*/
+if(E_cut > 0)
+ G_max=sqrt(2*me*E_cut)/hBar/(2*pi/A0);
+
+/* Each vector is G=(m_x/n_x, m_y/n_y, m_z/n_z) in units of 2*pi/A0, for
+   integers m.  Multiplying |G|^2<=G_max^2 through by (n_x*n_y*n_z)^2 gives
+   an exact test in integers, and only the m within the sphere are visited.
+   The vectors are then sorted into shells of equal |G|.			*/
+const long a_x = (long)(n_y*n_z)*(n_y*n_z);
+const long a_y = (long)(n_x*n_z)*(n_x*n_z);
+const long a_z = (long)(n_x*n_y)*(n_x*n_y);
+const long R   = floor(G_max*G_max*a_x*n_x*n_x + 1e-9);
+
+/* Largest integer whose square does not exceed n		*/
+auto isqrt = [](const long n) {
+    long r = floor(sqrt((double)n));
+    while(r*r > n) r--;
+    while((r+1)*(r+1) <= n) r++;
+    return r;
+};
+
+std::vector<std::vector<long>> m;
+
+const long m_x_max = isqrt(R/a_x);
+
+for(long m_x=-m_x_max;m_x<=m_x_max;m_x++)
+{
+ const long R_x     = R - a_x*m_x*m_x;
+ const long m_y_max = isqrt(R_x/a_y);
+
+ for(long m_y=-m_y_max;m_y<=m_y_max;m_y++)
+ {
+  const long R_y     = R_x - a_y*m_y*m_y;
+  const long m_z_max = isqrt(R_y/a_z);
+
+  for(long m_z=-m_z_max;m_z<=m_z_max;m_z++)
+   m.push_back({m_x, m_y, m_z, a_x*m_x*m_x + a_y*m_y*m_y + a_z*m_z*m_z});
+ }
+}
+
+/* Sort into shells of ascending |G|, keeping the order within each shell	*/
+std::stable_sort(m.begin(), m.end(),
+                 [](const std::vector<long> &a, const std::vector<long> &b) {return a[3] < b[3];});
+
+std::vector<arma::vec> G(m.size(), arma::vec(3));
+
+for(unsigned int iG=0;iG<m.size();iG++)
+{
+ G[iG](0)=m[iG][0]/(double)n_x;
+ G[iG](1)=m[iG][1]/(double)n_y;
+ G[iG](2)=m[iG][2]/(double)n_z;
+}
+
+write_rlv(G, "%20.17lf %20.17lf %20.17lf");
 
-for(beta_1=-G_max;beta_1<=G_max;beta_1+=1/(double)n_x)
- for(beta_2=-G_max;beta_2<=G_max;beta_2+=1/(double)n_y)
-  for(beta_3=-G_max;beta_3<=G_max;beta_3+=1/(double)n_z)
-  {
-   if(beta_1*beta_1+beta_2*beta_2+beta_3*beta_3<=(double)(G_max*G_max))
-    fprintf(FG,"%20.17lf %20.17lf %20.17lf\n",beta_1,beta_2,beta_3);
-  }
-fclose(FG);
 return EXIT_SUCCESS;
 }
@@ -21,26 +21,29 @@ then
 where i, j and k are the cartesian basis vectors.
 */
  
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cmath>
+#include <vector>
 #include "struct.h"
 #include "maths.h"
+#include "qwwad/constants.h"
+#include "qwwad/ppff.h"
+
+using namespace QWWAD::constants;
 
 int main(int argc, char *argv[])
 {
-int beta_1;          /* coefficients of the reciprocal lattice vectors */
-int beta_2;          /*  b_1, b_2 and b_3 constituting the general     */
-int beta_3;          /*  reciprocal lattice vector G                   */
-float gamma_1;
-float gamma_2;
-float gamma_3;
 double G_max;           /* maximum value of |G|, e.g. [400]=>|G|=4        */
-FILE *FG;
+double E_cut;           /* kinetic energy cut-off [J] (0 => use G_max)    */
+double A0;              /* lattice constant [m]                           */
 
 /* default values	*/
 
 G_max=4;
+E_cut=0;
+A0=5.65e-10;
 
 while((argc>1)&&(argv[1][0]=='-'))
 {
@@ -49,8 +52,16 @@ while((argc>1)&&(argv[1][0]=='-'))
   case 'g':
 	   G_max=atof(argv[2]);
            break;
+  case 'E':
+	   E_cut=atof(argv[2])*e;
+           break;
+  case 'A':
+	   A0=atof(argv[2])*1e-10;
+           break;
   default :
            printf("Usage:  rlv-fcc [-g maximum value of |G|]\n");
+           printf("                [-E kinetic energy cut-off (eV), overrides -g]\n");
+           printf("                [-A lattice constant (\033[1m5.65\033[0mA), for use with -E]\n");
            break;
  }
  argv++;
@@ -59,23 +70,60 @@ while((argc>1)&&(argv[1][0]=='-'))
  argc--;
 }
 
+/* Convert the energy cut-off, hbar^2 G^2/(2m0), into units of 2pi/A0	*/
+if(E_cut > 0)
+ G_max=sqrt(2*me*E_cut)/hBar/(2*pi/A0);
+
+/* The vectors G=2*pi/A0*(gamma_1,gamma_2,gamma_3) are those for which the
+   gamma are integers that are either all odd or all even.  Only those within
+   the sphere |G|<=G_max are visited, and they are then sorted into shells of
+   equal |G|.  The test is done in integers, so it is exact.		*/
+const long G_max_sq = floor(G_max*G_max + 1e-9);
 
+/* Largest integer whose square does not exceed n		*/
+auto isqrt = [](const long n) {
+    long r = floor(sqrt((double)n));
+    while(r*r > n) r--;
+    while((r+1)*(r+1) <= n) r++;
+    return (int)r;
+};
 
+const int gamma_max = isqrt(G_max_sq);
+
+std::vector<std::vector<int>> gamma;
+
+for(int gamma_1=-gamma_max;gamma_1<=gamma_max;gamma_1++)
+{
+ const int gamma_2_max=isqrt(G_max_sq-gamma_1*gamma_1);
 
+ for(int gamma_2=-gamma_2_max;gamma_2<=gamma_2_max;gamma_2++)
+ {
+  /* gamma_2 must have the same parity as gamma_1	*/
+  if((gamma_1-gamma_2)%2 != 0) continue;
 
-FG=fopen("G.r","w");
+  const int gamma_3_max=isqrt(G_max_sq-gamma_1*gamma_1-gamma_2*gamma_2);
 
-for(beta_1=-G_max;beta_1<=G_max;beta_1++)
- for(beta_2=-G_max;beta_2<=G_max;beta_2++)
-  for(beta_3=-G_max;beta_3<=G_max;beta_3++)
+  for(int gamma_3=-gamma_3_max;gamma_3<=gamma_3_max;gamma_3++)
   {
-   gamma_1=(float)(beta_1-beta_2+beta_3);
-   gamma_2=(float)(beta_1+beta_2-beta_3);
-   gamma_3=(float)(-beta_1+beta_2+beta_3);
-   if(round(gamma_1*gamma_1+gamma_2*gamma_2+gamma_3*gamma_3)<=G_max*G_max)
-    fprintf(FG,"%f %f %f\n",gamma_1,gamma_2,gamma_3);
+   if((gamma_1-gamma_3)%2 == 0)
+    gamma.push_back({gamma_1, gamma_2, gamma_3});
   }
-fclose(FG);
+ }
+}
+
+/* Sort into shells of ascending |G|, keeping the order within each shell	*/
+std::stable_sort(gamma.begin(), gamma.end(),
+                 [](const std::vector<int> &a, const std::vector<int> &b) {
+                     return a[0]*a[0]+a[1]*a[1]+a[2]*a[2] < b[0]*b[0]+b[1]*b[1]+b[2]*b[2];
+                 });
+
+std::vector<arma::vec> G(gamma.size(), arma::vec(3));
+
+for(unsigned int iG=0;iG<gamma.size();iG++)
+ for(unsigned int c=0;c<3;c++)
+  G[iG](c)=gamma[iG][c];
+
+write_rlv(G, "%f %f %f");
 
 return EXIT_SUCCESS;
 }
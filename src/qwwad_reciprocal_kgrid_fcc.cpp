@@ -0,0 +1,115 @@
+/**
+ * \file   qwwad_reciprocal_kgrid_fcc.cpp
+ * \brief  Irreducible wave vectors in a uniform grid over the Brillouin zone of an FCC crystal
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ *
+ * \details A Gamma-centred grid over the whole Brillouin zone is reduced to its
+ *          irreducible points using the cubic symmetry of a zinc-blende crystal.
+ *          These are written to k.r, ready for qwwad_pp_large_basis, along with the
+ *          weight of each point.  The energies that are found can then be unfolded
+ *          back onto the full grid.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include "qwwad/file-io.h"
+#include "qwwad/kpoint-grid.h"
+#include "qwwad/options.h"
+#include "qwwad/pplb-functions.h"
+
+using namespace QWWAD;
+
+/**
+ * \brief Configure command-line options for the program
+ */
+static Options configure_options(int argc, char* argv[])
+{
+    Options opt;
+
+    std::string doc("Generate the irreducible wave vectors in a uniform grid over the Brillouin zone "
+                    "of a face-centred cubic crystal.");
+
+    opt.add_option<unsigned int>("ndivisions,n", 8, "Number of divisions of the grid along each reciprocal "
+                                                    "lattice vector.");
+    opt.add_option<bool>        ("full",            "Write every point in the grid to k.r, rather than only "
+                                                    "the irreducible points.");
+    opt.add_option<bool>        ("unfold",          "Read the energies at each irreducible point from Ek?.r, "
+                                                    "as written by qwwad_pp_large_basis, and copy them onto "
+                                                    "every point in the grid.");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, doc);
+
+    return opt;
+}
+
+int main(int argc, char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    try
+    {
+        const FCCKPointGrid grid(opt.get_option<unsigned int>("ndivisions"));
+
+        const auto &k_full = grid.get_full_points();
+        const auto &k_irr  = grid.get_irreducible_points();
+        const auto  nk_irr = k_irr.size();
+
+        if(opt.get_option<bool>("unfold"))
+        {
+            const arma::mat E_full = grid.unfold(read_band_energies(nk_irr));
+            TableWriter     stream("Ek-full.r");
+
+            for(unsigned int ik = 0; ik < k_full.size(); ++ik)
+            {
+                stream << k_full[ik][0] << '\t' << k_full[ik][1] << '\t' << k_full[ik][2];
+
+                for(unsigned int iE = 0; iE < E_full.n_cols; ++iE)
+                    stream << '\t' << E_full(ik, iE);
+
+                stream << '\n';
+            }
+
+            return EXIT_SUCCESS;
+        }
+
+        const auto &k_out = opt.get_option<bool>("full") ? k_full : k_irr;
+        TableWriter k_stream("k.r");
+
+        for(const auto &k : k_out)
+            k_stream << k[0] << '\t' << k[1] << '\t' << k[2] << '\n';
+
+        // The weights and the map onto the full grid are only needed for the
+        // irreducible points
+        if(!opt.get_option<bool>("full"))
+        {
+            const arma::vec &w = grid.get_weights();
+            TableWriter      w_stream("kweights.r");
+
+            for(unsigned int ik = 0; ik < nk_irr; ++ik)
+                w_stream << ik << '\t' << w[ik] << '\n';
+
+            const arma::uvec &i_irr = grid.get_irreducible_indices();
+            TableWriter       map_stream("kmap.r");
+
+            for(unsigned int ik = 0; ik < k_full.size(); ++ik)
+            {
+                map_stream << k_full[ik][0] << '\t' << k_full[ik][1] << '\t' << k_full[ik][2] << '\t'
+                           << static_cast<unsigned int>(i_irr[ik]) << '\n';
+            }
+        }
+
+        if(opt.get_verbose())
+        {
+            std::cout << "Reduced " << k_full.size() << " wave vectors to " << nk_irr
+                      << " irreducible points." << std::endl;
+        }
+    }
+    catch(std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
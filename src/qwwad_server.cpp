@@ -0,0 +1,867 @@
+/**
+ * \file   qwwad_server.cpp
+ * \brief  Answer repeated calculation requests over a local socket
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <glibmm/ustring.h>
+
+#include "qwwad/constants.h"
+#include "qwwad/material.h"
+#include "qwwad/material-library.h"
+#include "qwwad/material-property-numeric.h"
+#include "qwwad/material-property-string.h"
+#include "qwwad/options.h"
+#include "qwwad/scattering-calculator-LO.h"
+#include "qwwad/schroedinger-solver-tridiagonal.h"
+#include "qwwad/subband.h"
+
+using namespace QWWAD;
+using namespace constants;
+
+/**
+ * Configure command-line options for the program
+ */
+Options configure_options(int argc, char* argv[])
+{
+    Options opt;
+
+    std::string summary("Answer repeated calculation requests over a local socket.");
+
+    opt.add_option<std::string>("socket",    "qwwad.sock", "Name of the socket on which to listen for requests");
+    opt.add_option<std::string>("filename",            "", "Material library file to read. If this is not specified, "
+                                                           "the default material library for the system will be used.");
+    opt.add_option<unsigned int>("threads",             0, "Number of threads to use for each request (0 = one per CPU core)");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, summary);
+
+    return opt;
+}
+
+/**
+ * \brief A value read from a JSON request
+ */
+struct JsonValue
+{
+    enum Type
+    {
+        NUL,
+        BOOLEAN,
+        NUMBER,
+        STRING,
+        ARRAY,
+        OBJECT
+    };
+
+    JsonValue() :
+        type(NUL),
+        boolean(false),
+        number(0)
+    {}
+
+    Type                             type;    ///< Type of the value
+    bool                             boolean; ///< Value, if a boolean
+    double                           number;  ///< Value, if a number
+    std::string                      str;     ///< Value, if a string
+    std::vector<JsonValue>           items;   ///< Items, if an array
+    std::map<std::string, JsonValue> members; ///< Members, if an object
+};
+
+/**
+ * \brief A simple parser for JSON text
+ *
+ * \details This handles all of JSON, except for "\u" escape codes in strings.
+ */
+class JsonParser
+{
+public:
+    explicit JsonParser(const std::string &text) :
+        _text(text),
+        _pos(0)
+    {}
+
+    /**
+     * \brief Parse the whole text as a single value
+     */
+    JsonValue parse()
+    {
+        auto value = parse_value();
+        skip_space();
+
+        if(_pos != _text.size())
+            fail("unexpected text after the end of the request");
+
+        return value;
+    }
+
+private:
+    void fail(const char *message) const
+    {
+        std::ostringstream oss;
+        oss << "Invalid JSON at character " << _pos + 1 << ": " << message;
+        throw std::runtime_error(oss.str());
+    }
+
+    void skip_space()
+    {
+        while(_pos < _text.size() && strchr(" \t\r\n", _text[_pos]))
+            ++_pos;
+    }
+
+    /// Move past a character, which must be next in the text
+    void expect(const char c)
+    {
+        skip_space();
+
+        if(_pos >= _text.size() || _text[_pos] != c)
+        {
+            std::string message("expected '");
+            message += c;
+            message += "'";
+            fail(message.c_str());
+        }
+
+        ++_pos;
+    }
+
+    /// Move past a character if it is next in the text
+    bool accept(const char c)
+    {
+        skip_space();
+
+        if(_pos < _text.size() && _text[_pos] == c)
+        {
+            ++_pos;
+            return true;
+        }
+
+        return false;
+    }
+
+    /// Move past a word (e.g., "true") if it is next in the text
+    bool accept_word(const char *word)
+    {
+        const size_t n = strlen(word);
+
+        if(_text.compare(_pos, n, word) == 0)
+        {
+            _pos += n;
+            return true;
+        }
+
+        return false;
+    }
+
+    std::string parse_string()
+    {
+        expect('"');
+        std::string str;
+
+        while(_pos < _text.size() && _text[_pos] != '"')
+        {
+            char c = _text[_pos++];
+
+            if(c == '\\')
+            {
+                if(_pos >= _text.size())
+                    break;
+
+                c = _text[_pos++];
+
+                switch(c)
+                {
+                    case 'n': c = '\n'; break;
+                    case 't': c = '\t'; break;
+                    case 'r': c = '\r'; break;
+                    case 'b': c = '\b'; break;
+                    case 'f': c = '\f'; break;
+                    case '"': case '\\': case '/': break;
+                    default:
+                        fail("unsupported escape code in string");
+                }
+            }
+
+            str += c;
+        }
+
+        expect('"');
+        return str;
+    }
+
+    JsonValue parse_value()
+    {
+        JsonValue value;
+        skip_space();
+
+        if(_pos >= _text.size())
+            fail("unexpected end of request");
+
+        const char c = _text[_pos];
+
+        if(c == '{')
+        {
+            value.type = JsonValue::OBJECT;
+            ++_pos;
+
+            if(!accept('}'))
+            {
+                do
+                {
+                    skip_space();
+                    const auto key = parse_string();
+                    expect(':');
+                    value.members[key] = parse_value();
+                } while(accept(','));
+
+                expect('}');
+            }
+        }
+        else if(c == '[')
+        {
+            value.type = JsonValue::ARRAY;
+            ++_pos;
+
+            if(!accept(']'))
+            {
+                do
+                {
+                    value.items.push_back(parse_value());
+                } while(accept(','));
+
+                expect(']');
+            }
+        }
+        else if(c == '"')
+        {
+            value.type = JsonValue::STRING;
+            value.str  = parse_string();
+        }
+        else if(accept_word("true") || accept_word("false"))
+        {
+            value.type    = JsonValue::BOOLEAN;
+            value.boolean = (c == 't');
+        }
+        else if(accept_word("null"))
+            value.type = JsonValue::NUL;
+        else
+        {
+            const char *start = _text.c_str() + _pos;
+            char       *end   = nullptr;
+
+            value.type   = JsonValue::NUMBER;
+            value.number = strtod(start, &end);
+
+            if(end == start)
+                fail("expected a value");
+
+            _pos += end - start;
+        }
+
+        return value;
+    }
+
+    const std::string &_text; ///< The text being parsed
+    size_t             _pos;  ///< Position of the next character to read
+};
+
+/**
+ * \brief Find a member of a request
+ *
+ * \returns The member, or null if it is not given
+ */
+static const JsonValue * find_member(const JsonValue   &request,
+                                     const std::string &name)
+{
+    auto const it = request.members.find(name);
+    return (it == request.members.end() || it->second.type == JsonValue::NUL) ? nullptr : &it->second;
+}
+
+/**
+ * \brief Find a member of a request, which must be given
+ */
+static const JsonValue & get_member(const JsonValue   &request,
+                                    const std::string &name)
+{
+    const auto member = find_member(request, name);
+
+    if(!member)
+    {
+        std::ostringstream oss;
+        oss << "Request does not give \"" << name << "\"";
+        throw std::runtime_error(oss.str());
+    }
+
+    return *member;
+}
+
+/**
+ * \brief Read a number from a request
+ */
+static double get_number(const JsonValue   &request,
+                         const std::string &name)
+{
+    auto const &member = get_member(request, name);
+
+    if(member.type != JsonValue::NUMBER)
+    {
+        std::ostringstream oss;
+        oss << "\"" << name << "\" must be a number";
+        throw std::runtime_error(oss.str());
+    }
+
+    return member.number;
+}
+
+/**
+ * \brief Read a number from a request, or use a default value if it is not given
+ */
+static double get_number(const JsonValue   &request,
+                         const std::string &name,
+                         const double       default_value)
+{
+    return find_member(request, name) ? get_number(request, name) : default_value;
+}
+
+/**
+ * \brief Read a boolean from a request, or use a default value if it is not given
+ */
+static bool get_boolean(const JsonValue   &request,
+                        const std::string &name,
+                        const bool         default_value)
+{
+    const auto member = find_member(request, name);
+
+    if(!member)
+        return default_value;
+
+    if(member->type != JsonValue::BOOLEAN)
+    {
+        std::ostringstream oss;
+        oss << "\"" << name << "\" must be true or false";
+        throw std::runtime_error(oss.str());
+    }
+
+    return member->boolean;
+}
+
+/**
+ * \brief Read a string from a request
+ */
+static std::string get_string(const JsonValue   &request,
+                              const std::string &name)
+{
+    auto const &member = get_member(request, name);
+
+    if(member.type != JsonValue::STRING)
+    {
+        std::ostringstream oss;
+        oss << "\"" << name << "\" must be a string";
+        throw std::runtime_error(oss.str());
+    }
+
+    return member.str;
+}
+
+/**
+ * \brief Convert a JSON array of numbers into a vector
+ */
+static arma::vec to_vector(const JsonValue   &value,
+                           const std::string &name)
+{
+    if(value.type != JsonValue::ARRAY)
+    {
+        std::ostringstream oss;
+        oss << "\"" << name << "\" must be an array of numbers";
+        throw std::runtime_error(oss.str());
+    }
+
+    arma::vec vec(value.items.size());
+
+    for(size_t i = 0; i < value.items.size(); ++i)
+    {
+        if(value.items[i].type != JsonValue::NUMBER)
+        {
+            std::ostringstream oss;
+            oss << "\"" << name << "\" must be an array of numbers";
+            throw std::runtime_error(oss.str());
+        }
+
+        vec[i] = value.items[i].number;
+    }
+
+    return vec;
+}
+
+/**
+ * \brief Read an array of numbers from a request
+ */
+static arma::vec get_vector(const JsonValue   &request,
+                            const std::string &name)
+{
+    return to_vector(get_member(request, name), name);
+}
+
+/**
+ * \brief Read an array of arrays of numbers from a request
+ */
+static std::vector<arma::vec> get_vectors(const JsonValue   &request,
+                                          const std::string &name)
+{
+    auto const &member = get_member(request, name);
+
+    if(member.type != JsonValue::ARRAY)
+    {
+        std::ostringstream oss;
+        oss << "\"" << name << "\" must be an array of arrays";
+        throw std::runtime_error(oss.str());
+    }
+
+    std::vector<arma::vec> vecs;
+
+    for(auto const &item : member.items)
+        vecs.push_back(to_vector(item, name));
+
+    return vecs;
+}
+
+/**
+ * \brief Write a string to a stream as a quoted JSON string
+ */
+static void write_json_string(std::ostream      &stream,
+                              const std::string &str)
+{
+    stream << '"';
+
+    for(auto const c : str)
+    {
+        if(c == '"' || c == '\\')
+            stream << '\\' << c;
+        else if(c == '\n')
+            stream << "\\n";
+        else
+            stream << c;
+    }
+
+    stream << '"';
+}
+
+/**
+ * \brief Write a number to a stream in JSON format
+ *
+ * \details JSON has no representation of infinity or NaN, so these are
+ *          written as null.
+ */
+static void write_json_number(std::ostream &stream,
+                              const double  val)
+{
+    if(std::isfinite(val))
+        stream << val;
+    else
+        stream << "null";
+}
+
+/**
+ * \brief Write an array of numbers to a stream in JSON format
+ */
+static void write_json_array(std::ostream    &stream,
+                             const arma::vec &vec)
+{
+    stream << "[";
+
+    for(size_t i = 0; i < vec.size(); ++i)
+    {
+        stream << (i > 0 ? "," : "");
+        write_json_number(stream, vec[i]);
+    }
+
+    stream << "]";
+}
+
+/**
+ * \brief Look up a property from the material library
+ *
+ * \details The request gives the "material" and "property" names, and an
+ *          optional "x" value for properties of the form y=f(x).  The response
+ *          gives the "value" and "unit" of a numerical property, or the
+ *          "text" of a text property.
+ */
+static void handle_material(const JsonValue &request,
+                            MaterialLibrary &lib,
+                            std::ostream    &response)
+{
+    const auto material_name = get_string(request, "material");
+    const auto property_name = get_string(request, "property");
+
+    const auto mat  = lib.get_material(material_name);
+    const auto prop = mat->get_property(property_name);
+
+    const auto text_property = dynamic_cast<MaterialPropertyString const *>(prop);
+
+    if(text_property)
+    {
+        response << "\"text\":";
+        write_json_string(response, text_property->get_text());
+    }
+    else
+    {
+        const auto numeric_property = dynamic_cast<MaterialPropertyNumeric const *>(prop);
+
+        if(!numeric_property)
+        {
+            std::ostringstream oss;
+            oss << "Property " << property_name << " in material " << material_name
+                << " is neither numeric nor text";
+            throw std::runtime_error(oss.str());
+        }
+
+        response << "\"value\":";
+        write_json_number(response, numeric_property->get_val(get_number(request, "x", 0)));
+        response << ",\"unit\":";
+        write_json_string(response, numeric_property->get_unit());
+    }
+}
+
+/**
+ * \brief Find the bound states in a potential profile
+ *
+ * \details The request gives the spatial positions "z" [m] and the potential
+ *          "V" [J], as in the v.r file.  The effective mass is given either as
+ *          a profile "m" [kg], or as a constant "mass" (relative to a free
+ *          electron).  "nst" optionally sets the maximum number of states.
+ *          The response gives the energies "E" [meV] and, unless
+ *          "wavefunctions" is false, the wavefunctions "psi" [m^{-1/2}].
+ */
+static void handle_solve(const JsonValue &request,
+                         std::ostream    &response)
+{
+    const auto z = get_vector(request, "z");
+    const auto V = get_vector(request, "V");
+
+    arma::vec m;
+
+    if(find_member(request, "m"))
+        m = get_vector(request, "m");
+    else
+        m = arma::ones(z.size()) * get_number(request, "mass") * me;
+
+    if(V.size() != z.size() || m.size() != z.size() || z.size() < 3)
+        throw std::runtime_error("\"z\", \"V\" and \"m\" must have the same size, with at least 3 points");
+
+    const auto nst = static_cast<unsigned int>(get_number(request, "nst", 0));
+
+    SchroedingerSolverTridiag solver(m, V, z, nst);
+    const auto solutions = solver.get_solutions(true);
+
+    arma::vec E(solutions.size());
+
+    for(size_t ist = 0; ist < solutions.size(); ++ist)
+        E[ist] = solutions[ist].get_energy()*1000/e;
+
+    response << "\"E\":";
+    write_json_array(response, E);
+
+    if(get_boolean(request, "wavefunctions", true))
+    {
+        response << ",\"psi\":[";
+
+        for(size_t ist = 0; ist < solutions.size(); ++ist)
+        {
+            response << (ist > 0 ? "," : "");
+            write_json_array(response, solutions[ist].get_wavefunction_samples());
+        }
+
+        response << "]";
+    }
+}
+
+/**
+ * \brief Find the mean LO-phonon scattering rates between a set of states
+ *
+ * \details The request gives the subband minima "E" [meV], the spatial
+ *          positions "z" [m] and the wavefunctions "psi" [m^{-1/2}], as
+ *          written by qwwad_ef_generic, and the quasi-Fermi energy "Ef" [meV]
+ *          for each subband.  "transitions" is an array of [initial, final]
+ *          subband indices, counted from 1 as in the rrp.r file.  The other
+ *          parameters are as for qwwad_sr_lo_phonon, and take the same default
+ *          values.  The response gives the mean "emission" and "absorption"
+ *          rates [1/s] for each transition.
+ */
+static void handle_lo(const JsonValue    &request,
+                      const unsigned int  n_threads,
+                      std::ostream       &response)
+{
+    const auto E   = get_vector(request, "E") * e/1000;
+    const auto Ef  = get_vector(request, "Ef") * e/1000;
+    const auto z   = get_vector(request, "z");
+    const auto psi = get_vectors(request, "psi");
+
+    if(psi.size() != E.size() || Ef.size() != E.size())
+        throw std::runtime_error("\"E\", \"Ef\" and \"psi\" must have the same number of states");
+
+    const auto A0          = get_number(request, "latticeconst", 5.65) * 1e-10;
+    const auto Ephonon     = get_number(request, "ELO", 36.0) * e/1000;
+    const auto epsilon_s   = get_number(request, "epss", 13.18) * eps0;
+    const auto epsilon_inf = get_number(request, "epsinf", 10.89) * eps0;
+    const auto m           = get_number(request, "mass", 0.067) * me;
+    const auto Te          = get_number(request, "Te", 300);
+    const auto Tl          = get_number(request, "Tl", 300);
+
+    const auto z_grid = std::make_shared<const arma::vec>(z);
+    std::vector<Subband> subbands;
+
+    for(size_t ist = 0; ist < E.size(); ++ist)
+    {
+        if(psi[ist].size() != z.size())
+            throw std::runtime_error("Each wavefunction in \"psi\" must have the same size as \"z\"");
+
+        subbands.push_back(Subband(Eigenstate(E[ist], z_grid, psi[ist]), m));
+        subbands.back().set_distribution_from_Ef_Te(Ef[ist], Te);
+    }
+
+    std::vector<ScatteringCalculatorLO::map_key> transitions;
+
+    for(auto const &tx : get_vectors(request, "transitions"))
+    {
+        if(tx.size() != 2 || tx[0] < 1 || tx[1] < 1 || tx[0] > E.size() || tx[1] > E.size())
+            throw std::runtime_error("Each item in \"transitions\" must be a pair of subband indices");
+
+        transitions.push_back(std::make_pair(tx[0] - 1, tx[1] - 1));
+    }
+
+    ScatteringCalculatorLO calculator(subbands, A0, Ephonon, epsilon_s, epsilon_inf, m, Te, Tl, true);
+    calculator.enable_screening(get_boolean(request, "screening", true));
+    calculator.enable_blocking(get_boolean(request, "blocking", true));
+    calculator.set_phonon_samples(get_number(request, "nKz", 101), get_number(request, "Kzscale", 0)*1e10);
+    calculator.set_ki_samples(get_number(request, "nki", 101));
+
+    for(const bool is_emission : {true, false})
+    {
+        calculator.set_emission(is_emission);
+        const auto tx_all = calculator.get_transitions(transitions, n_threads);
+
+        arma::vec Wbar(tx_all.size());
+
+        for(size_t itx = 0; itx < tx_all.size(); ++itx)
+            Wbar[itx] = tx_all[itx].get_average_rate();
+
+        response << (is_emission ? "\"emission\":" : ",\"absorption\":");
+        write_json_array(response, Wbar);
+    }
+}
+
+/**
+ * \brief Answer a single request
+ *
+ * \param[in]  line     The request, as a JSON object on a single line
+ * \param[out] shutdown Set to true if the server should stop
+ *
+ * \returns The response, as a JSON object on a single line
+ */
+static std::string handle_request(const std::string  &line,
+                                  MaterialLibrary    &lib,
+                                  const unsigned int  n_threads,
+                                  bool               &shutdown)
+{
+    std::ostringstream response;
+    response.precision(std::numeric_limits<double>::max_digits10);
+
+    try
+    {
+        const auto request = JsonParser(line).parse();
+
+        if(request.type != JsonValue::OBJECT)
+            throw std::runtime_error("Request must be a JSON object");
+
+        const auto cmd = get_string(request, "cmd");
+
+        response << "{";
+
+        if(cmd == "material")
+            handle_material(request, lib, response);
+        else if(cmd == "solve")
+            handle_solve(request, response);
+        else if(cmd == "lo")
+            handle_lo(request, n_threads, response);
+        else if(cmd == "shutdown")
+        {
+            response << "\"status\":\"stopping\"";
+            shutdown = true;
+        }
+        else
+        {
+            std::ostringstream oss;
+            oss << "Unknown command: " << cmd;
+            throw std::runtime_error(oss.str());
+        }
+
+        response << "}";
+    }
+    catch(std::exception &e)
+    {
+        response.str("");
+        response << "{\"error\":";
+        write_json_string(response, e.what());
+        response << "}";
+    }
+
+    return response.str();
+}
+
+/**
+ * \brief Send a complete block of text to a client
+ *
+ * \returns False if the client has disconnected
+ */
+static bool send_all(const int fd, const std::string &text)
+{
+    size_t nsent = 0;
+
+    while(nsent < text.size())
+    {
+        const auto result = send(fd, text.data() + nsent, text.size() - nsent, MSG_NOSIGNAL);
+
+        if(result < 0 && errno == EINTR)
+            continue;
+
+        if(result <= 0)
+            return false;
+
+        nsent += result;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Answer all the requests from a single client, until it disconnects
+ *
+ * \returns True if the client asked the server to stop
+ */
+static bool serve_client(const int           fd,
+                         MaterialLibrary    &lib,
+                         const unsigned int  n_threads,
+                         const bool          verbose)
+{
+    std::string pending;
+    char buffer[65536];
+    bool shutdown = false;
+
+    while(!shutdown)
+    {
+        const auto nread = recv(fd, buffer, sizeof(buffer), 0);
+
+        if(nread < 0 && errno == EINTR)
+            continue;
+
+        if(nread <= 0)
+            break;
+
+        pending.append(buffer, nread);
+
+        // Answer each complete line
+        size_t line_end;
+
+        while(!shutdown && (line_end = pending.find('\n')) != std::string::npos)
+        {
+            const auto line = pending.substr(0, line_end);
+            pending.erase(0, line_end + 1);
+
+            if(line.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+
+            const auto response = handle_request(line, lib, n_threads, shutdown);
+
+            if(verbose)
+                std::cout << "Request: " << line.substr(0, 80) << std::endl;
+
+            if(!send_all(fd, response + "\n"))
+                return shutdown;
+        }
+    }
+
+    return shutdown;
+}
+
+int main(int argc, char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    const auto socket_name = opt.get_option<std::string>("socket");
+    const auto n_threads   = opt.get_option<unsigned int>("threads");
+    const auto verbose     = opt.get_verbose();
+
+    // Load the material library once, so that it is ready for every request
+    MaterialLibrary lib(opt.get_option<std::string>("filename"));
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if(socket_name.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << "Socket name " << socket_name << " is too long." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    strncpy(address.sun_path, socket_name.c_str(), sizeof(address.sun_path) - 1);
+
+    const int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    // Remove any socket left over from an earlier server
+    unlink(socket_name.c_str());
+
+    if(server_fd < 0
+       || bind(server_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0
+       || listen(server_fd, 8) != 0)
+    {
+        std::cerr << "Could not listen on socket " << socket_name << ": " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if(verbose)
+        std::cout << "Listening on " << socket_name << std::endl;
+
+    bool shutdown = false;
+
+    // Clients are served one at a time.  Each request can still use all the
+    // CPU cores, through the thread pool in the calculators.
+    while(!shutdown)
+    {
+        const int client_fd = accept(server_fd, nullptr, nullptr);
+
+        if(client_fd < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            std::cerr << "Could not accept connection: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        shutdown = serve_client(client_fd, lib, n_threads, verbose);
+        close(client_fd);
+    }
+
+    close(server_fd);
+    unlink(socket_name.c_str());
+
+    return EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,543 @@
+/**
+ * \file   qwwad_sp_selfconsistent.cpp
+ * \brief  Solve the Schroedinger and Poisson equations self-consistently
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ *
+ * \details This replaces a shell loop around qwwad_ef_generic, qwwad_population_init,
+ *          qwwad_charge_density and qwwad_poisson.  All the data is kept in memory
+ *          between iterations, and only the final solution is written to file.
+ *
+ *          A range of applied fields can also be swept.  Each bias point then
+ *          starts from the solution at the previous points, so it needs only a
+ *          few iterations.  The progress of a long run can be saved to a checkpoint
+ *          file, so that it can be resumed if it is stopped.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "qwwad/checkpoint.h"
+#include "qwwad/constants.h"
+#include "qwwad/file-io.h"
+#include "qwwad/schroedinger-poisson-solver.h"
+#include "qwwad/wf_options.h"
+
+using namespace QWWAD;
+using namespace constants;
+
+/**
+ * \brief Configure command-line options for the program
+ */
+static WfOptions configure_options(int argc, char* argv[])
+{
+    WfOptions opt;
+
+    std::string doc("Find the eigenstates and potential of a doped heterostructure self-consistently.");
+
+    opt.add_option<std::string>("bandedgepotentialfile", "v_b.r",    "File from which band-edge potential is read [J].");
+    opt.add_option<std::string>("dcpermittivityfile",    "eps_dc.r", "File from which dc permittivity is read [F/m].");
+    opt.add_option<std::string>("dopingfile",            "d.r",      "File from which volume doping profile is read [m^{-3}].");
+    opt.add_option<std::string>("massfile",              "m.r",      "File from which effective mass profile is read [kg].");
+    opt.add_option<double>     ("mass",                              "The constant effective mass to use across the entire structure. "
+                                                                     "If unspecified, the mass profile will be read from file.");
+    opt.add_option<std::string>("populationfile",                    "File from which to read fixed subband populations [m^{-2}]. "
+                                                                     "If unspecified, a thermal distribution is used.");
+    opt.add_option<double>     ("Te",                    100,        "Temperature of carrier distribution [K].");
+    opt.add_option<double>     ("dosmass",               0.067,      "In-plane effective mass for thermal distribution "
+                                                                     "(relative to free electron).");
+    opt.add_option<size_t>     ("nstmax",                0,          "Maximum number of subbands to find (0 = all in the potential).");
+    opt.add_option<double>     ("field,E",                           "Applied electric field [kV/cm].  If unspecified, there is zero "
+                                                                     "field at each end of the structure.");
+    opt.add_option<double>     ("fieldstop",                         "Last applied field in a bias sweep [kV/cm].  The sweep starts from "
+                                                                     "the --field value (or zero).  If unspecified, only one field is solved.");
+    opt.add_option<double>     ("fieldstep",             1.0,        "First step in field during a bias sweep [kV/cm].");
+    opt.add_option<double>     ("fieldstepmax",          0,          "Largest step in field during a bias sweep [kV/cm] "
+                                                                     "(0 = the --fieldstep value).");
+    opt.add_option<size_t>     ("targetiter",            5,          "Number of iterations per bias point for which the step in field "
+                                                                     "is left unchanged.");
+    opt.add_option<std::string>("sweepfile",             "sweep.r",  "Filename to which the result at each bias point is written.");
+    opt.add_option<std::string>("checkpoint",                        "File to which the state of the run is saved at regular intervals. "
+                                                                     "If unspecified, no checkpoints are written.");
+    opt.add_option<size_t>     ("checkpointinterval",    10,         "Number of iterations between checkpoints while a point is under way.");
+    opt.add_option<bool>       ("resume",                            "Carry on from the checkpoint file, skipping any bias points that "
+                                                                     "are already done.");
+    opt.add_option<double>     ("tolerance",             1e-3,       "Largest change in potential at convergence [meV].");
+    opt.add_option<size_t>     ("maxiter",               100,        "Maximum number of iterations.");
+    opt.add_option<size_t>     ("mixingdepth",           5,          "Number of previous iterations used in Anderson mixing "
+                                                                     "(0 = linear mixing).");
+    opt.add_option<double>     ("mixingfactor",          0.3,        "Fraction of the residual potential added at each iteration.");
+    opt.add_option<bool>       ("predictorcorrector",                "Use the predictor-corrector scheme, in which a nonlinear Poisson "
+                                                                     "equation is solved at each iteration, instead of potential mixing.");
+    opt.add_option<std::string>("poissonpotentialfile",  "v_p.r",    "Filename to which the Poisson potential is written.");
+    opt.add_option<std::string>("totalpotentialfile",    "v.r",      "Filename to which the total potential is written.");
+    opt.add_option<std::string>("outputpopulationfile",  "N.r",      "Filename to which the subband populations are written.");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, doc);
+
+    return opt;
+}
+
+/// Identifier at the start of a checkpoint file
+static const char checkpoint_magic[8] = {'Q','W','W','A','D','S','P','C'};
+
+/// Version number of the checkpoint file format
+static const uint32_t checkpoint_version = 2;
+
+/**
+ * \brief Progress through a bias sweep
+ */
+struct SweepProgress
+{
+    SweepProgress() :
+        F(0.0), F_prev(0.0), dF(0.0), n_points(0), n_total(0)
+    {}
+
+    double    F;        ///< Field at the last solution [kV/cm]
+    double    F_prev;   ///< Field at the solution before that [kV/cm]
+    double    dF;       ///< Length of the next step in field [kV/cm]
+    uint64_t  n_points; ///< Number of bias points solved
+    uint64_t  n_total;  ///< Total number of iterations at the points solved
+    arma::vec V;        ///< Potential at F [J]
+    arma::vec V_prev;   ///< Potential at F_prev [J]
+    std::vector<std::vector<double>> rows; ///< Result at each bias point
+};
+
+/**
+ * \brief State of a self-consistent run, which can be saved and resumed
+ *
+ * \details A checkpoint file has an 8-byte identifier and a format version,
+ *          followed by the size of the structure, the progress through the bias
+ *          sweep (if any), and the state of the iteration at the point that is
+ *          under way (if any), all in the native byte order.
+ */
+class SPCheckpoint
+{
+public:
+    SPCheckpoint() :
+        nz(0), sweep(false), F_start(0.0), F_stop(0.0), in_progress(false), F_current(0.0)
+    {}
+
+    uint64_t      nz;          ///< Number of spatial points
+    bool          sweep;       ///< True if the run is a bias sweep
+    double        F_start;     ///< First field in the sweep [kV/cm]
+    double        F_stop;      ///< Last field in the sweep [kV/cm]
+    SweepProgress progress;    ///< Progress through the sweep
+    bool          in_progress; ///< True if the iteration at a point is under way
+    double        F_current;   ///< Field at the point that is under way [kV/cm]
+    std::string   sp_state;    ///< State of the iteration at that point
+
+    std::string serialise() const;
+
+    void write(const std::string &filename) const;
+
+    static SPCheckpoint read(const std::string &filename);
+};
+
+/**
+ * \brief Convert the checkpoint to its binary file format
+ */
+std::string SPCheckpoint::serialise() const
+{
+    std::string buffer = start_checkpoint(checkpoint_magic, checkpoint_version);
+    append_checkpoint_value<uint64_t>(buffer, nz);
+    append_checkpoint_value<uint8_t>(buffer, sweep);
+
+    if(sweep)
+    {
+        append_checkpoint_value(buffer, F_start);
+        append_checkpoint_value(buffer, F_stop);
+        append_checkpoint_value(buffer, progress.F);
+        append_checkpoint_value(buffer, progress.F_prev);
+        append_checkpoint_value(buffer, progress.dF);
+        append_checkpoint_value(buffer, progress.n_points);
+        append_checkpoint_value(buffer, progress.n_total);
+        append_checkpoint_table(buffer, progress.V.memptr(),      progress.V.size());
+        append_checkpoint_table(buffer, progress.V_prev.memptr(), progress.V_prev.size());
+        append_checkpoint_value<uint64_t>(buffer, progress.rows.size());
+
+        for(const auto &row : progress.rows)
+            append_checkpoint_table(buffer, row.data(), row.size());
+    }
+
+    append_checkpoint_value<uint8_t>(buffer, in_progress);
+
+    if(in_progress)
+    {
+        append_checkpoint_value(buffer, F_current);
+        append_checkpoint_string(buffer, sp_state);
+    }
+
+    return buffer;
+}
+
+/**
+ * \brief Write the checkpoint to file
+ *
+ * \details A failure is reported, but does not stop the run.
+ */
+void SPCheckpoint::write(const std::string &filename) const
+{
+    if(!write_checkpoint_file(filename, serialise()))
+        std::cerr << "Warning: could not write checkpoint to " << filename << std::endl;
+}
+
+/**
+ * \brief Read a checkpoint file
+ *
+ * \param[in] filename The name of the file
+ */
+SPCheckpoint SPCheckpoint::read(const std::string &filename)
+{
+    std::ifstream stream(filename.c_str(), std::ios::binary);
+    check_checkpoint_header(stream, filename, checkpoint_magic, checkpoint_version, "a Schroedinger-Poisson");
+
+    SPCheckpoint chk;
+    chk.nz    = read_checkpoint_value<uint64_t>(stream);
+    chk.sweep = read_checkpoint_value<uint8_t>(stream) != 0;
+
+    if(chk.sweep)
+    {
+        chk.F_start           = read_checkpoint_value<double>(stream);
+        chk.F_stop            = read_checkpoint_value<double>(stream);
+        chk.progress.F        = read_checkpoint_value<double>(stream);
+        chk.progress.F_prev   = read_checkpoint_value<double>(stream);
+        chk.progress.dF       = read_checkpoint_value<double>(stream);
+        chk.progress.n_points = read_checkpoint_value<uint64_t>(stream);
+        chk.progress.n_total  = read_checkpoint_value<uint64_t>(stream);
+        chk.progress.V        = arma::vec(read_checkpoint_table(stream));
+        chk.progress.V_prev   = arma::vec(read_checkpoint_table(stream));
+
+        const auto n_rows = read_checkpoint_value<uint64_t>(stream);
+
+        for(uint64_t irow = 0; irow < n_rows and stream; ++irow)
+            chk.progress.rows.push_back(read_checkpoint_table(stream));
+    }
+
+    chk.in_progress = read_checkpoint_value<uint8_t>(stream) != 0;
+
+    if(chk.in_progress)
+    {
+        chk.F_current = read_checkpoint_value<double>(stream);
+        chk.sp_state  = read_checkpoint_string(stream);
+    }
+
+    if(!stream or chk.progress.rows.size() != chk.progress.n_points)
+    {
+        std::ostringstream oss;
+        oss << "Checkpoint file " << filename << " is incomplete";
+        throw std::runtime_error(oss.str());
+    }
+
+    return chk;
+}
+
+/**
+ * \brief Carry on from the iteration that is under way in a checkpoint
+ *
+ * \param[in]     chk The checkpoint
+ * \param[in,out] sp  The solver
+ */
+static void resume_iteration(const SPCheckpoint        &chk,
+                             SchroedingerPoissonSolver &sp)
+{
+    std::istringstream stream(chk.sp_state);
+    sp.read_state(stream);
+}
+
+/**
+ * \brief Solve the structure at a sequence of applied fields
+ *
+ * \param[in]     opt User options
+ * \param[in]     nz  Number of spatial points
+ * \param[in,out] sp  The solver, which holds the solution at the last field on return
+ *
+ * \details Each point starts from the states at the previous point, and from a
+ *          potential that is extrapolated linearly from the last two points.  The
+ *          step in field grows when a point converges in fewer than --targetiter
+ *          iterations, and shrinks when it needs more.  If a point fails to
+ *          converge, the step is halved and the point is tried again from the last
+ *          solution.
+ *
+ *          If a checkpoint file is given, it is rewritten after each point, and
+ *          every --checkpointinterval iterations while a point is under way.  A
+ *          resumed sweep skips the points that are already done, and carries on
+ *          with the point that was under way from its best iterate.
+ *
+ *          The field, the number of iterations and the energy of each state are
+ *          written to the sweep file at each point.
+ */
+static void run_sweep(const WfOptions           &opt,
+                      const size_t               nz,
+                      SchroedingerPoissonSolver &sp)
+{
+    const double F_start  = opt.get_argument_known("field") ? opt.get_option<double>("field") : 0.0; // [kV/cm]
+    const double F_stop   = opt.get_option<double>("fieldstop");  // [kV/cm]
+    const double dF_first = std::abs(opt.get_option<double>("fieldstep")); // [kV/cm]
+    const auto   n_target = opt.get_option<size_t>("targetiter");
+    double       dF_max   = std::abs(opt.get_option<double>("fieldstepmax")); // [kV/cm]
+
+    if(dF_first == 0.0)
+        throw std::domain_error("The step in field must be nonzero.");
+
+    if(n_target == 0)
+        throw std::domain_error("The target number of iterations must be nonzero.");
+
+    if(dF_max == 0.0)
+        dF_max = dF_first;
+
+    const double kVcm_to_Vm = 1000 * 100.0;
+    const double direction  = (F_stop >= F_start) ? 1.0 : -1.0;
+    const double dF_min     = std::min(dF_first, dF_max)/1024; // Smallest step before giving up [kV/cm]
+
+    const bool checkpointing   = opt.get_argument_known("checkpoint");
+    const auto checkpoint_file = checkpointing ? opt.get_option<std::string>("checkpoint") : std::string();
+
+    SPCheckpoint chk;
+    chk.nz          = nz;
+    chk.sweep       = true;
+    chk.F_start     = F_start;
+    chk.F_stop      = F_stop;
+    chk.progress.F  = F_start;
+    chk.progress.dF = std::min(dF_first, dF_max);
+
+    if(opt.get_option<bool>("resume"))
+    {
+        chk = SPCheckpoint::read(checkpoint_file);
+
+        if(!chk.sweep or chk.nz != nz or chk.F_start != F_start or chk.F_stop != F_stop)
+        {
+            std::ostringstream oss;
+            oss << "Checkpoint " << checkpoint_file << " does not match this sweep.";
+            throw std::runtime_error(oss.str());
+        }
+
+        if(chk.progress.n_points > 0)
+            sp.set_initial_potential(chk.progress.V);
+    }
+
+    auto &progress = chk.progress;
+    double F_next  = F_start; // Field at the point that is under way [kV/cm]
+
+    if(checkpointing)
+    {
+        sp.set_checkpoint_callback(opt.get_option<size_t>("checkpointinterval"), [&]() {
+            chk.in_progress = true;
+            chk.F_current   = F_next;
+            chk.sp_state.clear();
+            sp.append_state(chk.sp_state);
+            chk.write(checkpoint_file);
+        });
+    }
+
+    for(;;)
+    {
+        if(progress.n_points > 0)
+        {
+            if(direction*(F_stop - progress.F) <= 1e-9*dF_max)
+                break;
+
+            F_next = progress.F + direction*std::min(progress.dF, direction*(F_stop - progress.F));
+        }
+
+        const SchroedingerPoissonSolver sp_last = sp;
+
+        if(chk.in_progress)
+        {
+            F_next = chk.F_current;
+            resume_iteration(chk, sp);
+            chk.in_progress = false;
+        }
+        else if(progress.n_points > 1)
+        {
+            // Extrapolate the potential from the last two points
+            sp.set_initial_potential(progress.V + (F_next - progress.F)/(progress.F - progress.F_prev)
+                                                  * (progress.V - progress.V_prev));
+        }
+
+        sp.set_field(F_next * kVcm_to_Vm);
+
+        try
+        {
+            sp.solve();
+        }
+        catch(std::runtime_error &ex)
+        {
+            if(progress.n_points == 0)
+                throw;
+
+            sp           = sp_last;
+            progress.dF /= 2;
+
+            if(progress.dF < dF_min)
+            {
+                std::ostringstream oss;
+                oss << "Bias sweep failed at " << F_next << " kV/cm: " << ex.what();
+                throw std::runtime_error(oss.str());
+            }
+
+            continue;
+        }
+
+        const auto n_iter = sp.get_iterations();
+
+        std::vector<double> row = {F_next, static_cast<double>(n_iter)};
+
+        for(const auto &state : sp.get_states())
+            row.push_back(state.get_energy()*1000/e);
+
+        progress.rows.push_back(row);
+        progress.V_prev = progress.V;
+        progress.V      = sp.get_V();
+        progress.F_prev = progress.F;
+        progress.F      = F_next;
+        progress.n_total += n_iter;
+
+        // Scale the step towards the target number of iterations
+        if(progress.n_points++ > 0)
+        {
+            const double factor = std::min(2.0, std::max(0.5, static_cast<double>(n_target)/n_iter));
+            progress.dF = std::min(dF_max, progress.dF*factor);
+        }
+
+        if(checkpointing)
+            chk.write(checkpoint_file);
+    }
+
+    // If the whole sweep was already done, find the states at the last point again
+    if(sp.get_states().empty())
+    {
+        sp.set_field(progress.F * kVcm_to_Vm);
+        sp.solve();
+    }
+
+    TableWriter stream(opt.get_option<std::string>("sweepfile"));
+
+    for(const auto &row : progress.rows)
+    {
+        stream << row[0] << '\t' << static_cast<size_t>(row[1]);
+
+        for(size_t i = 2; i < row.size(); ++i)
+            stream << '\t' << row[i];
+
+        stream << '\n';
+    }
+
+    if(opt.get_verbose())
+        std::cout << "Solved " << progress.n_points << " bias points in " << progress.n_total
+                  << " iterations." << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    arma::vec z;     // Spatial locations [m]
+    arma::vec V;     // Band-edge potential [J]
+    arma::vec eps;   // Permittivity [F/m]
+    arma::vec d;     // Doping [m^{-3}]
+    arma::vec z_tmp;
+    read_table(opt.get_option<std::string>("bandedgepotentialfile"), z, V);
+    read_table(opt.get_option<std::string>("dcpermittivityfile"), z_tmp, eps);
+    read_table(opt.get_option<std::string>("dopingfile"), z_tmp, d);
+
+    arma::vec m = arma::zeros(z.size()); // Band-edge effective mass [kg]
+
+    if(opt.get_argument_known("mass"))
+        m += opt.get_option<double>("mass") * me;
+    else
+        read_table(opt.get_option<std::string>("massfile"), z_tmp, m);
+
+    SchroedingerPoissonSolver sp(z, m, V, eps, d, opt.get_option<size_t>("nstmax"));
+
+    const bool sweep = opt.get_argument_known("fieldstop");
+
+    if(opt.get_argument_known("field") and !sweep)
+        sp.set_field(opt.get_option<double>("field") * 1000 * 100.0);
+
+    if(opt.get_argument_known("populationfile"))
+    {
+        arma::vec pop;
+        read_table(opt.get_option<std::string>("populationfile"), pop);
+        sp.set_populations(pop);
+    }
+    else
+        sp.set_thermal_distribution(opt.get_option<double>("Te"),
+                                    opt.get_option<double>("dosmass") * me);
+
+    sp.set_tolerance(opt.get_option<double>("tolerance") * e/1000);
+    sp.set_max_iterations(opt.get_option<size_t>("maxiter"));
+    sp.set_mixing(opt.get_option<size_t>("mixingdepth"),
+                  opt.get_option<double>("mixingfactor"));
+    sp.enable_predictor_corrector(opt.get_option<bool>("predictorcorrector"));
+
+    try
+    {
+        if(opt.get_option<bool>("resume") and !opt.get_argument_known("checkpoint"))
+            throw std::invalid_argument("A checkpoint file must be given with --resume.");
+
+        if(sweep)
+            run_sweep(opt, z.size(), sp);
+        else
+        {
+            SPCheckpoint chk;
+            chk.nz = z.size();
+
+            if(opt.get_argument_known("checkpoint"))
+            {
+                const auto checkpoint_file = opt.get_option<std::string>("checkpoint");
+
+                if(opt.get_option<bool>("resume"))
+                {
+                    chk = SPCheckpoint::read(checkpoint_file);
+
+                    if(chk.sweep or chk.nz != z.size() or !chk.in_progress)
+                    {
+                        std::ostringstream oss;
+                        oss << "Checkpoint " << checkpoint_file << " does not match this run.";
+                        throw std::runtime_error(oss.str());
+                    }
+
+                    resume_iteration(chk, sp);
+                }
+
+                sp.set_checkpoint_callback(opt.get_option<size_t>("checkpointinterval"), [&]() {
+                    chk.in_progress = true;
+                    chk.sp_state.clear();
+                    sp.append_state(chk.sp_state);
+                    chk.write(checkpoint_file);
+                });
+            }
+
+            sp.solve();
+        }
+    }
+    catch(std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if(opt.get_verbose() and !sweep)
+        std::cout << "Converged in " << sp.get_iterations() << " iterations." << std::endl;
+
+    Eigenstate::write_to_file(opt.get_energy_filename(),
+                              opt.get_wf_prefix(),
+                              opt.get_wf_ext(),
+                              sp.get_states(),
+                              true);
+
+    write_table(opt.get_option<std::string>("poissonpotentialfile"), z, sp.get_phi());
+    write_table(opt.get_option<std::string>("totalpotentialfile"),   z, sp.get_V());
+    write_table(opt.get_option<std::string>("outputpopulationfile"), sp.get_populations());
+
+    return EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
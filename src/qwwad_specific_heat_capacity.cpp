@@ -34,6 +34,7 @@ Options configure_options(int argc, char* argv[])
     opt.add_option<double>     ("Tstep",              1, "Step in temperature [K]");
     opt.add_option<std::string>("filename",       "c.r", "File in which to save specific heat capacity data");
     opt.add_option<bool>       ("approx"               , "Use quick low/high temperature appriximation");
+    opt.add_option<bool>       ("tabulated"            , "Use precomputed table of the exact Debye function");
 
     opt.add_prog_specific_options_and_parse(argc, argv, summary);
 
@@ -51,6 +52,7 @@ int main(int argc,char *argv[])
     const auto M      = opt.get_option<double>("molarmass"); // Molar mass [kg/mol]
     const auto natoms = opt.get_option<size_t>("natoms");    // Number of atoms in molecular unit
     const auto approx = opt.get_option<bool>  ("approx");
+    const auto table  = opt.get_option<bool>  ("tabulated");
 
     const auto nT = 1 + (Tmax-Tmin)/dT;
 
@@ -66,6 +68,8 @@ int main(int argc,char *argv[])
 
         if(approx)
             cp[iT] = dm.get_cp_approx(T[iT]);
+        else if(table)
+            cp[iT] = dm.get_cp_tabulated(T[iT]);
         else
             cp[iT] = dm.get_cp(T[iT]);
     }
@@ -14,6 +14,7 @@
 #include "maths.h"
 #include "qwwad/constants.h"
 #include "qwwad/file-io.h"
+#include "qwwad/maths-helpers.h"
 #include "qwwad/options.h"
 
 using namespace QWWAD;
@@ -32,6 +33,10 @@ Options configure_options(int argc, char* argv[])
     opt.add_option<double>     ("wavenumbermin,s",         0, "Minimum wavenumber for spectrum [cm^{-1}].");
     opt.add_option<double>     ("wavenumbermax,u",       100, "Maximum wavenumber for spectrum [cm^{-1}].");
     opt.add_option<double>     ("wavenumberstep,t",        1, "Step in wavenumber for spectrum [cm^{-1}].");
+    opt.add_option<bool>       ("fft",                        "Bin the spin-flip energies on the spectral grid and broaden "
+                                                              "them using an FFT convolution.  This is much faster for "
+                                                              "large tables, and accurate as long as the wavenumber step "
+                                                              "is well below the linewidth.");
     opt.add_option<std::string>("spinflipfile",     "e_sf.r", "Table of spin-flip energies vs donor position.");
     opt.add_option<std::string>("spectrumfile",        "I.r", "Filename for output spectrum.");
 
@@ -40,6 +45,63 @@ Options configure_options(int argc, char* argv[])
     return opt;
 };
 
+/**
+ * \brief Find a spectrum of Gaussian lines by binning and FFT convolution
+ *
+ * \param[in] E_line Energy of each line [cm^{-1}]
+ * \param[in] E_min  Energy of first spectral sample [cm^{-1}]
+ * \param[in] dE     Spacing between spectral samples [cm^{-1}]
+ * \param[in] nE     Number of spectral samples
+ * \param[in] sigma  Standard deviation of each line [cm^{-1}]
+ *
+ * \details Each line is shared between the two nearest samples of a grid that
+ *          extends 8 standard deviations beyond each end of the spectrum, so
+ *          that the tails of lines outside the range are kept.  The binned lines
+ *          are then convolved with the Gaussian lineshape.  The cost is
+ *          O(N_lines + n log n), rather than O(N_lines nE) for a direct sum.
+ */
+static std::vector<double> broaden_fft(const std::valarray<double> &E_line,
+                                       const double                 E_min,
+                                       const double                 dE,
+                                       const size_t                 nE,
+                                       const double                 sigma)
+{
+    const size_t K  = static_cast<size_t>(ceil(8.0*sigma/dE)); // Half-width of lineshape [samples]
+    const size_t nB = nE + 2*K;                                // Number of bins
+    const double E_B0 = E_min - K*dE;                          // Energy of first bin
+
+    arma::vec bins(nB, arma::fill::zeros);
+
+    for(unsigned int i = 0; i < E_line.size(); ++i)
+    {
+        const double x = (E_line[i] - E_B0)/dE;
+
+        // Lines beyond the extended grid make no significant contribution
+        if(x >= 0.0 && x < nB-1)
+        {
+            const auto   j    = static_cast<unsigned int>(x);
+            const double frac = x - j;
+            bins[j]   += 1.0 - frac;
+            bins[j+1] += frac;
+        }
+    }
+
+    arma::vec lineshape(2*K+1);
+
+    for(unsigned int k = 0; k < 2*K+1; ++k)
+        lineshape[k] = gsl_ran_gaussian_pdf((static_cast<double>(k) - K)*dE, sigma);
+
+    // Spectral sample j lies at bin j+K, and the lineshape is centred at
+    // sample K, so it appears at element j+2K of the convolution
+    const arma::vec conv = convolve_fft(bins, lineshape);
+    std::vector<double> intensity(nE);
+
+    for(unsigned int j = 0; j < nE; ++j)
+        intensity[j] = conv[j+2*K];
+
+    return intensity;
+}
+
 int main(int argc, char *argv[])
 {
     const auto opt = configure_options(argc, argv);
@@ -66,15 +128,25 @@ int main(int argc, char *argv[])
     std::vector<double> E_plot;
     std::vector<double> intensity_plot; // intensity of Raman signal at Ei
 
-    for(auto E=E_min; E < E_max; E += E_step) // Spectral energy
+    if(opt.get_option<bool>("fft"))
+    {
+        for(auto E=E_min; E < E_max; E += E_step) // Spectral energy
+            E_plot.push_back(E_min + E_plot.size()*E_step);
+
+        intensity_plot = broaden_fft(E_sf, E_min, E_step, E_plot.size(), sigma);
+    }
+    else
     {
-        auto intensity=0.0;
+        for(auto E=E_min; E < E_max; E += E_step) // Spectral energy
+        {
+            auto intensity=0.0;
 
-        for(unsigned int i_i=0;i_i<N_rd;i_i++)
-            intensity += gsl_ran_gaussian_pdf(E-E_sf[i_i], sigma);
+            for(unsigned int i_i=0;i_i<N_rd;i_i++)
+                intensity += gsl_ran_gaussian_pdf(E-E_sf[i_i], sigma);
 
-        E_plot.push_back(E);
-        intensity_plot.push_back(intensity);
+            E_plot.push_back(E);
+            intensity_plot.push_back(intensity);
+        }
     }
 
     const auto spectrumfile = opt.get_option<std::string>("spectrumfile");
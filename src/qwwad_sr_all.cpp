@@ -0,0 +1,591 @@
+/**
+ * \file   qwwad_sr_all.cpp
+ * \brief  Scattering rates for several mechanisms in a single run
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ *
+ * \details The subbands, carrier distributions and list of wanted transitions
+ *          are read once, and then shared between the scattering calculators for
+ *          each of the selected mechanisms.  The output files are the same as
+ *          those written by the program for each individual mechanism.
+ */
+
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include "qwwad/constants.h"
+#include "qwwad/file-io.h"
+#include "qwwad/options.h"
+#include "qwwad/shard.h"
+#include "qwwad/carrier-carrier-gpu.h"
+#include "qwwad/scattering-calculator-acoustic.h"
+#include "qwwad/scattering-calculator-alloy.h"
+#include "qwwad/scattering-calculator-carrier-carrier.h"
+#include "qwwad/scattering-calculator-IFR.h"
+#include "qwwad/scattering-calculator-impurity.h"
+#include "qwwad/scattering-calculator-LO.h"
+#include "qwwad/subband.h"
+
+using namespace QWWAD;
+using namespace constants;
+
+/// Initial and final subband indices for a transition (indexed from 0)
+typedef std::pair<unsigned int, unsigned int> map_key;
+
+static Options configure_options(int argc, char* argv[])
+{
+    Options opt;
+
+    std::string doc("Find the scattering rates for several mechanisms at once.");
+
+    opt.add_option<std::string>("mechanisms", "LO,imp,ifr,ado",
+                                "Comma-separated list of mechanisms to include.  Any of 'LO' (LO phonon), "
+                                "'AC' (acoustic phonon), 'imp' (ionised impurity), 'ifr' (interface roughness), "
+                                "'ado' (alloy disorder) and 'cc' (carrier-carrier).  Carrier-carrier transitions "
+                                "are read from rr.r, and all others from rrp.r.");
+    opt.add_option<bool>  ("noblocking,b",          "Disable final-state blocking.");
+    opt.add_option<bool>  ("noscreening,S",         "Disable screening.");
+    opt.add_option<double>("latticeconst,A",  5.65, "Lattice constant in growth direction [angstrom]");
+    opt.add_option<double>("ELO,E",          36.0,  "Energy of LO phonon [meV]");
+    opt.add_option<double>("EAC",             2.0,  "Energy of acoustic phonon [meV]");
+    opt.add_option<double>("vs",           5117.0,  "Speed of sound, for acoustic phonons [m/s]");
+    opt.add_option<double>("density",      5317.5,  "Mass density, for acoustic phonons [kg/m^3]");
+    opt.add_option<double>("Da",              7.0,  "Acoustic deformation potential [eV]");
+    opt.add_option<double>("epss,e",         13.18, "Static dielectric constant");
+    opt.add_option<double>("epsinf,f",       10.89, "High-frequency dielectric constant");
+    opt.add_option<double>("delta",              3, "Interface roughness height [angstrom]");
+    opt.add_option<double>("lambda",            50, "Interface roughness correlation length [angstrom]");
+    opt.add_option<double>("Vad",              600, "Alloy disorder potential [meV]");
+    opt.add_option<double>("cellfraction",       4, "Fraction of unit cell occupied by each alloy scatterer");
+    opt.add_option<double>("mass,m",         0.067, "Band-edge effective mass (relative to free electron)");
+    opt.add_option<char>  ("particle,p",       'e', "ID of particle to be used: 'e', 'h' or 'l', for "
+                                                    "electrons, heavy holes or light holes respectively.");
+    opt.add_option<double>("Te",               300, "Carrier temperature [K].");
+    opt.add_option<double>("Tl",               300, "Lattice temperature [K].");
+    opt.add_option<double>("Ecutoff",               "Cut-off energy for carrier distribution [meV]. If not specified, then 5kT above band-edge. "
+                                                    "This is not used for LO-phonon scattering.");
+    opt.add_option<size_t>("nki",              101, "Number of initial wave-vector samples.");
+    opt.add_option<size_t>("nKz",              101, "Number of phonon wave-vector samples.");
+    opt.add_option<size_t>("nKxy",            1001, "Number of in-plane phonon wave-vector samples in the "
+                                                    "acoustic-phonon lookup table.");
+    opt.add_option<double>("Kzscale",            0, "Scale of a mapped grid of phonon wave-vectors [1/angstrom].  The samples "
+                                                    "are denser below this value, so far fewer are needed.  Something close "
+                                                    "to 1/(well width) works well.  If zero, the samples are evenly spaced.");
+    opt.add_option<size_t>("nq",               101, "Number of strips in scattering vector integration");
+    opt.add_option<size_t>("ntheta",           101, "Number of strips in theta angle integration");
+    opt.add_option<size_t>("nkj",              101, "Number of initial wave-vector samples for second carrier, "
+                                                    "for carrier-carrier scattering");
+    opt.add_option<size_t>("nalpha",           101, "Number of strips in alpha angle integration, for "
+                                                    "carrier-carrier scattering");
+    opt.add_option<double>("qtol",                  "Tolerance for an adaptive grid of carrier-carrier scattering "
+                                                    "vectors, relative to the largest form factor.  If not "
+                                                    "specified, nq uniform samples are used.");
+    opt.add_option<bool>  ("qmc",                   "Integrate carrier-carrier rates using randomised quasi-Monte "
+                                                    "Carlo sampling.  The nkj, nalpha and ntheta options are then "
+                                                    "ignored.");
+    opt.add_option<double>("tolerance",       1e-3, "Target relative error for quasi-Monte Carlo integration");
+    opt.add_option<size_t>("maxpoints",    1048576, "Maximum number of quasi-Monte Carlo samples for each initial "
+                                                    "wave-vector");
+    opt.add_option<bool>  ("nogpu",                 "Always find carrier-carrier integrals on the CPU, even in "
+                                                    "builds with GPU support.");
+    opt.add_option<double>("avgtol",                "Find average rates by adaptive integration over ki, to this relative tolerance. "
+                                                    "If not specified, the table of --nki samples is used.  The tables of "
+                                                    "rate vs. energy are only written when the table is used.");
+    opt.add_option<unsigned int>("threads",      0, "Number of threads to use (0 = one per CPU core).");
+    opt.add_option<std::string>("ffcachedir",       "Directory in which to save LO-phonon form-factor tables.  "
+                                                    "Tables saved by a previous run for the same wavefunctions "
+                                                    "and phonon wave-vectors are reused.");
+    opt.add_shard_option();
+
+    opt.add_prog_specific_options_and_parse(argc, argv, doc);
+
+    return opt;
+}
+
+/**
+ * \brief Split a comma-separated list of mechanism names
+ */
+static std::set<std::string> parse_mechanisms(const std::string &list)
+{
+    const std::set<std::string> known = {"LO", "AC", "imp", "ifr", "ado", "cc"};
+    std::set<std::string> mechanisms;
+
+    std::istringstream iss(list);
+    std::string name;
+
+    while(std::getline(iss, name, ','))
+    {
+        if(name.empty())
+            continue;
+
+        if(known.count(name) == 0)
+        {
+            std::cerr << "Unknown scattering mechanism: '" << name << "'" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        mechanisms.insert(name);
+    }
+
+    return mechanisms;
+}
+
+/**
+ * \brief Write the rate tables and the average rates for one mechanism
+ *
+ * \param[in] opt         Command-line options
+ * \param[in] shard       This job's part of the list of transitions
+ * \param[in] prefix      Prefix for each output file
+ * \param[in] avg_file    Name of file for average rates
+ * \param[in] transitions Subband indices for each transition
+ * \param[in] calculator  The calculator for this mechanism
+ *
+ * \details The rate tables are named <prefix><i><f>.r, where i and f are
+ *          indexed from 1.  If a tolerance was given, the average rates are
+ *          found by adaptive integration, and the rate tables are not found.
+ */
+template <class Calculator>
+static void write_rates(const Options              &opt,
+                        const Shard                &shard,
+                        const std::string          &prefix,
+                        const std::string          &avg_file,
+                        const std::vector<map_key> &transitions,
+                        Calculator                 &calculator)
+{
+    TableWriter Favg(shard.get_filename(avg_file), 17, true); // output file for weighted means
+
+    for(unsigned int itx = 0; itx < transitions.size(); ++itx)
+    {
+        const auto i = transitions[itx].first  + 1;
+        const auto f = transitions[itx].second + 1;
+
+        if(opt.get_argument_known("avgtol"))
+        {
+            Favg << i << ' ' << f << ' '
+                 << calculator.get_average_rate(i-1, f-1, opt.get_option<double>("avgtol")) << '\n';
+            continue;
+        }
+
+        const auto tx   = calculator.get_transition(i-1, f-1);
+        const auto Wif  = tx.get_rate_table();
+        auto       Ei_t = tx.get_Ei_total_table(); // Total energy of initial state [J]
+        Ei_t *= 1000.0/e; // Rescale to meV
+
+        std::ostringstream filename;
+        filename << prefix << i << f << ".r";
+        write_table(filename.str(), Ei_t, Wif);
+
+        Favg << i << ' ' << f << ' ' << tx.get_average_rate() << '\n';
+    }
+}
+
+/**
+ * \brief Find LO-phonon emission and absorption rates
+ *
+ * \details The output matches qwwad_sr_lo_phonon, in which the rate tables
+ *          are labelled by subband indices counted from 0.
+ */
+static void find_rates_LO(const Options              &opt,
+                          const Shard                &shard,
+                          const std::vector<Subband> &subbands,
+                          const std::vector<map_key> &transitions,
+                          const arma::uvec           &i_indices,
+                          const arma::uvec           &f_indices)
+{
+    const auto A0          =  opt.get_option<double>("latticeconst") * 1e-10; // Lattice constant [m]
+    const auto Ephonon     =  opt.get_option<double>("ELO") * e/1000;         // Phonon energy [J]
+    const auto epsilon_s   =  opt.get_option<double>("epss")   * eps0;        // Static permittivity [F/m]
+    const auto epsilon_inf =  opt.get_option<double>("epsinf") * eps0;        // High-frequency permittivity [F/m]
+    const auto m           =  opt.get_option<double>("mass")*me;              // Band-edge effective mass [kg]
+    const auto Te          =  opt.get_option<double>("Te");                   // Carrier temperature [K]
+    const auto Tl          =  opt.get_option<double>("Tl");                   // Lattice temperature [K]
+    const auto b_flag      = !opt.get_option<bool>  ("noblocking");           // Include final-state blocking by default
+    const auto S_flag      = !opt.get_option<bool>  ("noscreening");          // Include screening by default
+    const auto nki         =  opt.get_option<size_t>("nki");                  // number of ki calculations
+    const auto nKz         =  opt.get_option<size_t>("nKz");                  // number of Kz calculations
+    const auto n_threads   =  opt.get_option<unsigned int>("threads");        // number of worker threads
+
+    // The same form-factor tables are used for emission and absorption
+    ScatteringCalculatorLO calculator(subbands, A0, Ephonon, epsilon_s, epsilon_inf, m, Te, Tl, true);
+    calculator.enable_screening(S_flag);
+    calculator.enable_blocking(b_flag);
+    calculator.set_phonon_samples(nKz, opt.get_option<double>("Kzscale")*1e10);
+    calculator.set_ki_samples(nki);
+
+    if(opt.get_argument_known("ffcachedir"))
+        calculator.set_ff_cache_dir(opt.get_option<std::string>("ffcachedir"));
+
+    const auto ntx = transitions.size();
+    arma::vec Wabar(ntx);
+    arma::vec Webar(ntx);
+
+    // The rate tables are only found if the averages are found from them
+    if(opt.get_argument_known("avgtol"))
+    {
+        const auto avgtol = opt.get_option<double>("avgtol");
+        calculator.make_ff_tables(transitions, n_threads);
+
+        for(const bool is_emission : {true, false})
+        {
+            calculator.set_emission(is_emission);
+            auto &Wbar = is_emission ? Webar : Wabar;
+
+            for(unsigned int itx = 0; itx < ntx; ++itx)
+                Wbar[itx] = calculator.get_average_rate(transitions[itx].first,
+                                                        transitions[itx].second,
+                                                        avgtol);
+        }
+    }
+    else
+    {
+        calculator.set_emission(true);
+        const auto tx_em_all = calculator.get_transitions(transitions, n_threads);
+
+        calculator.set_emission(false);
+        const auto tx_ab_all = calculator.get_transitions(transitions, n_threads);
+
+        for(unsigned int itx = 0; itx < ntx; ++itx)
+        {
+            const auto i = transitions[itx].first;
+            const auto f = transitions[itx].second;
+
+            Webar[itx] = tx_em_all[itx].get_average_rate();
+            Wabar[itx] = tx_ab_all[itx].get_average_rate();
+
+            auto Ei_em = tx_em_all[itx].get_Ei_total_table(); // Initial TOTAL energies [J]
+            auto Ei_ab = tx_ab_all[itx].get_Ei_total_table(); // Initial TOTAL energies [J]
+            Ei_em *= 1000.0/e; // Rescale to meV
+            Ei_ab *= 1000.0/e; // Rescale to meV
+
+            std::ostringstream filename_em; // emission
+            filename_em << "LOe" << i << f << ".r";
+            std::ostringstream filename_ab; // absorption
+            filename_ab << "LOa" << i << f << ".r";
+            write_table(filename_em.str(), Ei_em, tx_em_all[itx].get_rate_table());
+            write_table(filename_ab.str(), Ei_ab, tx_ab_all[itx].get_rate_table());
+        }
+    }
+
+    write_table(shard.get_filename("LOa-if.r"), i_indices, f_indices, Wabar);
+    write_table(shard.get_filename("LOe-if.r"), i_indices, f_indices, Webar);
+}
+
+/**
+ * \brief Find acoustic-phonon emission and absorption rates
+ *
+ * \details The output matches qwwad_sr_acoustic_phonon.
+ */
+static void find_rates_AC(const Options              &opt,
+                          const Shard                &shard,
+                          const std::vector<Subband> &subbands,
+                          const arma::uvec           &i_indices,
+                          const arma::uvec           &f_indices)
+{
+    const auto A0      = opt.get_option<double>("latticeconst") * 1e-10; // Lattice constant [m]
+    const auto Ephonon = opt.get_option<double>("EAC")*e/1000;           // Acoustic phonon energy [J]
+    const auto Da      = opt.get_option<double>("Da")*e;                 // Acoustic deformation potential [J]
+    const auto rho     = opt.get_option<double>("density");              // Mass density [kg/m^3]
+    const auto Vs      = opt.get_option<double>("vs");                   // Speed of sound [m/s]
+    const auto m       = opt.get_option<double>("mass")*me;              // Band-edge effective mass [kg]
+    const auto Te      = opt.get_option<double>("Te");                   // Carrier temperature [K]
+    const auto Tl      = opt.get_option<double>("Tl");                   // Lattice temperature [K]
+
+    ScatteringCalculatorAcoustic calculator(subbands, A0, Ephonon, Da, rho, Vs, m, Te, Tl);
+    calculator.enable_blocking(!opt.get_option<bool>("noblocking"));
+    calculator.set_ki_samples(opt.get_option<size_t>("nki"));
+    calculator.set_phonon_samples(opt.get_option<size_t>("nKz"));
+    calculator.set_theta_samples(opt.get_option<size_t>("ntheta"));
+    calculator.set_alpha_samples(opt.get_option<size_t>("nKxy"));
+
+    if(opt.get_argument_known("Ecutoff"))
+        calculator.set_Ecutoff(opt.get_option<double>("Ecutoff")*e/1000);
+
+    if(opt.get_argument_known("ffcachedir"))
+        calculator.set_ff_cache_dir(opt.get_option<std::string>("ffcachedir"));
+
+    const auto ntx = i_indices.size();
+    arma::vec Wabar(ntx);
+    arma::vec Webar(ntx);
+
+    for(unsigned int itx = 0; itx < ntx; ++itx)
+    {
+        const auto i = i_indices[itx];
+        const auto f = f_indices[itx];
+
+        const auto rates = calculator.get_rates(i-1, f-1, opt.get_option<unsigned int>("threads"));
+        const arma::vec Ei_t = rates.Ei_total/(1e-3*e); // Total energy of initial state [meV]
+
+        std::ostringstream filename_a; // absorption
+        filename_a << "ACa" << i << f << ".r";
+        write_table(filename_a.str(), Ei_t, rates.Wa, false, 17);
+
+        std::ostringstream filename_e; // emission
+        filename_e << "ACe" << i << f << ".r";
+        write_table(filename_e.str(), Ei_t, rates.We, false, 17);
+
+        Wabar[itx] = rates.Wabar;
+        Webar[itx] = rates.Webar;
+    }
+
+    write_table(shard.get_filename("ACa-if.r"), i_indices, f_indices, Wabar);
+    write_table(shard.get_filename("ACe-if.r"), i_indices, f_indices, Webar);
+}
+
+/**
+ * \brief Find carrier-carrier scattering rates
+ *
+ * \param[in] opt      Command-line options
+ * \param[in] shard    This job's part of the list of transitions
+ * \param[in] subbands The energy subbands in the system
+ * \param[in] cc_list  Subband indices i, j, f and g for each transition (from 1)
+ *
+ * \details The output matches qwwad_sr_carrier_carrier.  The static permittivity
+ *          and the carrier temperature are used for the Coulomb interaction.
+ */
+static void find_rates_cc(const Options                 &opt,
+                          const Shard                   &shard,
+                          const std::vector<Subband>    &subbands,
+                          const std::vector<arma::uvec> &cc_list)
+{
+    const auto epsilon  = opt.get_option<double>("epss")*eps0; // Low frequency dielectric constant [F/m]
+    const auto m        = opt.get_option<double>("mass")*me;   // Band-edge effective mass [kg]
+    const auto Te       = opt.get_option<double>("Te");        // Carrier temperature [K]
+    const auto qmc_flag = opt.get_option<bool>("qmc");         // Use quasi-Monte Carlo integration
+
+    ScatteringCalculatorCarrierCarrier calculator(subbands, epsilon, m, Te);
+    calculator.enable_screening(!opt.get_option<bool>("noscreening"));
+    calculator.set_ki_samples(opt.get_option<size_t>("nki"));
+    calculator.set_kj_samples(opt.get_option<size_t>("nkj"));
+    calculator.set_q_samples(opt.get_option<size_t>("nq"));
+    calculator.set_theta_samples(opt.get_option<size_t>("ntheta"));
+    calculator.set_alpha_samples(opt.get_option<size_t>("nalpha"));
+    calculator.enable_gpu(!opt.get_option<bool>("nogpu") && !qmc_flag && carrier_carrier_gpu_available());
+
+    if(opt.get_argument_known("qtol"))
+        calculator.set_q_tolerance(opt.get_option<double>("qtol"));
+
+    if(opt.get_argument_known("Ecutoff"))
+        calculator.set_Ecutoff(opt.get_option<double>("Ecutoff")*e/1000);
+
+    if(qmc_flag)
+        calculator.enable_qmc(opt.get_option<double>("tolerance"), opt.get_option<size_t>("maxpoints"));
+
+    TableWriter FccABCD(shard.get_filename("ccABCD.r"), 17, true); // output file for weighted means
+
+    for(unsigned int itx = 0; itx < cc_list[0].size(); ++itx)
+    {
+        const auto i = cc_list[0][itx];
+        const auto j = cc_list[1][itx];
+        const auto f = cc_list[2][itx];
+        const auto g = cc_list[3][itx];
+
+        const auto rates = calculator.get_rates(i-1, j-1, f-1, g-1, opt.get_option<unsigned int>("threads"));
+        const arma::vec Ei_t = rates.Ei_total * 1000/e; // Total energy of initial state [meV]
+
+        std::ostringstream filename;
+        filename << "cc" << i << j << f << g << ".r";
+        write_table(filename.str(), Ei_t, rates.W);
+
+        if(qmc_flag)
+        {
+            std::ostringstream error_filename;
+            error_filename << "cc" << i << j << f << g << "-error.r";
+            write_table(error_filename.str(), Ei_t, rates.W_error);
+        }
+
+        FccABCD << i << ' ' << j << ' ' << f << ' ' << g << ' ' << rates.Wbar << '\n';
+    }
+}
+
+/**
+ * \brief Find ionised-impurity scattering rates
+ */
+static void find_rates_impurity(const Options              &opt,
+                                const Shard                &shard,
+                                const std::vector<Subband> &subbands,
+                                const std::vector<map_key> &transitions)
+{
+    // Read doping profile
+    arma::vec z_d; // Spatial location
+    arma::vec d;   // Volume doping [m^{-3}]
+    read_table("d.r", z_d, d);
+
+    const auto epsilon = opt.get_option<double>("epss")*eps0; // Low frequency dielectric constant [F/m]
+    const auto m       = opt.get_option<double>("mass")*me;   // Band-edge effective mass [kg]
+    const auto Te      = opt.get_option<double>("Te");        // Carrier temperature [K]
+
+    ScatteringCalculatorImpurity calculator(subbands, d, epsilon, m, Te);
+    calculator.enable_screening(!opt.get_option<bool>("noscreening"));
+    calculator.enable_blocking(!opt.get_option<bool>("noblocking"));
+    calculator.set_ki_samples(opt.get_option<size_t>("nki"));
+    calculator.set_q_samples(opt.get_option<size_t>("nq"));
+    calculator.set_theta_samples(opt.get_option<size_t>("ntheta"));
+
+    if(opt.get_argument_known("Ecutoff"))
+        calculator.set_Ecutoff(opt.get_option<double>("Ecutoff")*e/1000);
+
+    write_rates(opt, shard, "imp", "imp-avg.dat", transitions, calculator);
+}
+
+/**
+ * \brief Find interface-roughness scattering rates
+ */
+static void find_rates_IFR(const Options              &opt,
+                           const Shard                &shard,
+                           const std::vector<Subband> &subbands,
+                           const std::vector<map_key> &transitions)
+{
+    // Read potential profile
+    arma::vec z;
+    arma::vec V;
+    read_table("v.r", z, V);
+
+    // Read interface locations
+    arma::uvec iz_I;
+    read_table("interfaces.r", iz_I);
+
+    const auto m  = opt.get_option<double>("mass")*me; // Band-edge effective mass [kg]
+    const auto Te = opt.get_option<double>("Te");      // Carrier temperature [K]
+
+    ScatteringCalculatorIFR calculator(subbands, V, iz_I, m, Te);
+    calculator.set_roughness_height(opt.get_option<double>("delta")*1e-10);
+    calculator.set_correlation_length(opt.get_option<double>("lambda")*1e-10);
+    calculator.enable_blocking(!opt.get_option<bool>("noblocking"));
+    calculator.set_ki_samples(opt.get_option<size_t>("nki"));
+
+    if(opt.get_argument_known("Ecutoff"))
+        calculator.set_Ecutoff(opt.get_option<double>("Ecutoff")*e/1000);
+
+    write_rates(opt, shard, "ifr", "ifr-avg.dat", transitions, calculator);
+}
+
+/**
+ * \brief Find alloy-disorder scattering rates
+ */
+static void find_rates_alloy(const Options              &opt,
+                             const Shard                &shard,
+                             const std::vector<Subband> &subbands,
+                             const std::vector<map_key> &transitions)
+{
+    // Read alloy profile
+    arma::vec z;
+    arma::vec x;
+    read_table("x.r", z, x);
+
+    const auto m     = opt.get_option<double>("mass")*me;                 // Band-edge effective mass [kg]
+    const auto Te    = opt.get_option<double>("Te");                      // Carrier temperature [K]
+    const auto alatt = opt.get_option<double>("latticeconst") * 1e-10; // Lattice constant [m]
+    const auto Ncell = opt.get_option<double>("cellfraction");         // Fraction of cell occupied by each scatterer
+
+    ScatteringCalculatorAlloy calculator(subbands, x, m, Te);
+    calculator.set_alloy_potential(opt.get_option<double>("Vad")*e/1000);
+    calculator.set_scatterer_volume(alatt*alatt*alatt/Ncell);
+    calculator.enable_blocking(!opt.get_option<bool>("noblocking"));
+    calculator.set_ki_samples(opt.get_option<size_t>("nki"));
+
+    if(opt.get_argument_known("Ecutoff"))
+        calculator.set_Ecutoff(opt.get_option<double>("Ecutoff")*e/1000);
+
+    write_rates(opt, shard, "ado", "ado-avg.dat", transitions, calculator);
+}
+
+int main(int argc,char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    const auto mechanisms = parse_mechanisms(opt.get_option<std::string>("mechanisms"));
+    const auto m          = opt.get_option<double>("mass")*me; // Band-edge effective mass [kg]
+    const auto p          = opt.get_option<char>  ("particle"); // Particle ID
+    const auto Te         = opt.get_option<double>("Te");       // Carrier temperature [K]
+
+    std::ostringstream E_filename; // Energy filename string
+    E_filename << "E" << p << ".r";
+    std::ostringstream wf_prefix;  // Wavefunction filename prefix
+    wf_prefix << "wf_" << p;
+
+    // Read data for all subbands from file.  The wave functions are only read
+    // for the subbands in the wanted transitions
+    auto subbands = Subband::read_from_file(E_filename.str(),
+                                            wf_prefix.str(),
+                                            ".r",
+                                            m,
+                                            true);
+
+    // Read and set carrier distributions within each subband
+    arma::vec  Ef;      // Fermi energies [J]
+    arma::uvec indices; // Subband indices (garbage)
+    read_table("Ef.r", indices, Ef);
+    Ef *= e/1000.0; // Rescale to J
+
+    for(unsigned int isb = 0; isb < subbands.size(); ++isb)
+        subbands[isb].set_distribution_from_Ef_Te(Ef[isb], Te);
+
+    const auto shard = opt.get_shard();
+
+    // Read list of wanted transitions.  Carrier-carrier scattering has its own
+    // list, and the other list is only needed for the remaining mechanisms
+    const bool need_cc  = mechanisms.count("cc") > 0;
+    const bool need_rrp = mechanisms.size() > (need_cc ? 1U : 0U);
+
+    arma::uvec i_indices;
+    arma::uvec f_indices;
+
+    if(need_rrp)
+    {
+        read_table("rrp.r", i_indices, f_indices);
+
+        // Only keep the transitions for this job
+        shard.select_in_place(i_indices, f_indices);
+    }
+
+    std::vector<arma::uvec> cc_list(4); // Subband indices i, j, f, g for each carrier-carrier transition
+
+    if(need_cc)
+    {
+        read_table("rr.r", cc_list[0], cc_list[1], cc_list[2], cc_list[3]);
+        shard.select_in_place(cc_list[0], cc_list[1], cc_list[2], cc_list[3]);
+    }
+
+    // Only read the wave functions of the subbands in these transitions
+    const arma::uvec wanted = arma::join_cols(arma::join_cols(i_indices, f_indices),
+                                              arma::join_cols(arma::join_cols(cc_list[0], cc_list[1]),
+                                                              arma::join_cols(cc_list[2], cc_list[3])));
+    Subband::load_wavefunctions(subbands, wanted - 1, opt.get_option<unsigned int>("threads"));
+
+    // Get subband indices.  Note that the -1 is needed because the
+    // input file indexes subbands from 1 upward
+    std::vector<map_key> transitions;
+
+    for(unsigned int itx = 0; itx < i_indices.size(); ++itx)
+        transitions.push_back(std::make_pair(i_indices[itx] - 1, f_indices[itx] - 1));
+
+    if(opt.get_argument_known("Ecutoff"))
+    {
+        const auto Ecutoff = opt.get_option<double>("Ecutoff")*e/1000;
+
+        for(const auto &idx : transitions)
+            warn_Ecutoff_extended(subbands, idx.first, idx.second, Ecutoff);
+    }
+
+    if(mechanisms.count("LO"))
+        find_rates_LO(opt, shard, subbands, transitions, i_indices, f_indices);
+
+    if(mechanisms.count("AC"))
+        find_rates_AC(opt, shard, subbands, i_indices, f_indices);
+
+    if(mechanisms.count("imp"))
+        find_rates_impurity(opt, shard, subbands, transitions);
+
+    if(mechanisms.count("ifr"))
+        find_rates_IFR(opt, shard, subbands, transitions);
+
+    if(mechanisms.count("ado"))
+        find_rates_alloy(opt, shard, subbands, transitions);
+
+    if(need_cc)
+        find_rates_cc(opt, shard, subbands, cc_list);
+
+    return EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -13,8 +13,11 @@
 #include "qwwad/constants.h"
 #include "qwwad/scattering-calculator-LO.h"
 #include "qwwad/file-io.h"
+#include "qwwad/rate-table.h"
 #include "qwwad/subband.h"
 #include "qwwad/options.h"
+#include "qwwad/shard.h"
+#include "qwwad/profiler.h"
 
 using namespace QWWAD;
 using namespace constants;
@@ -24,6 +27,61 @@ void ff_output(const arma::vec &Kz,
                unsigned int     i,
                unsigned int     f);
 
+/**
+ * \brief Write tables of average emission and absorption rates vs. carrier temperature
+ *
+ * \details The carrier temperature is swept from --Te to --Temax, keeping the
+ *          lattice temperature fixed.  The same form-factor tables are used at
+ *          every temperature.
+ */
+static void write_rates_vs_Te(const Options                                      &opt,
+                              const Shard                                        &shard,
+                              ScatteringCalculatorLO                             &calculator,
+                              const std::vector<ScatteringCalculatorLO::map_key> &transitions,
+                              const unsigned int                                  n_threads)
+{
+    const auto Tl  = opt.get_option<double>("Tl");
+    const auto nTe = opt.get_option<size_t>("nTe");
+    const arma::vec Te = arma::linspace(opt.get_option<double>("Te"),
+                                        opt.get_option<double>("Temax"),
+                                        nTe);
+    const auto ntx = transitions.size();
+    arma::mat Webar(ntx, nTe);
+    arma::mat Wabar(ntx, nTe);
+
+    calculator.make_ff_tables(transitions, n_threads);
+
+    for(unsigned int iT = 0; iT < nTe; ++iT)
+    {
+        calculator.set_temperature(Te[iT], Tl);
+
+        // Only the average rates are needed, so skip the tables if using adaptive integration
+        for(const bool is_emission : {true, false})
+        {
+            calculator.set_emission(is_emission);
+            auto &Wbar = is_emission ? Webar : Wabar;
+
+            if(opt.get_argument_known("avgtol"))
+            {
+                for(unsigned int itx = 0; itx < ntx; ++itx)
+                    Wbar(itx, iT) = calculator.get_average_rate(transitions[itx].first,
+                                                                transitions[itx].second,
+                                                                opt.get_option<double>("avgtol"));
+            }
+            else
+            {
+                const auto tx = calculator.get_transitions(transitions, n_threads);
+
+                for(unsigned int itx = 0; itx < ntx; ++itx)
+                    Wbar(itx, iT) = tx[itx].get_average_rate();
+            }
+        }
+    }
+
+    RateTable(Te, transitions, Webar).write_to_file(shard.get_filename("LOe-if-Te.r"));
+    RateTable(Te, transitions, Wabar).write_to_file(shard.get_filename("LOa-if-Te.r"));
+}
+
 static Options configure_options(int argc, char* argv[])
 {
     Options opt;
@@ -42,8 +100,24 @@ static Options configure_options(int argc, char* argv[])
                                                     "electrons, heavy holes or light holes respectively.");
     opt.add_option<double>("Te",               300, "Carrier temperature [K].");
     opt.add_option<double>("Tl",               300, "Lattice temperature [K].");
+    opt.add_option<double>("Temax",                 "Find average rates on a grid of carrier temperatures from --Te "
+                                                    "up to this value [K], and write them to LOe-if-Te.r and "
+                                                    "LOa-if-Te.r.");
+    opt.add_option<size_t>("nTe",               51, "Number of carrier temperature samples in the grid.");
     opt.add_option<size_t>("nki",              101, "Number of initial wave-vector samples.");
     opt.add_option<size_t>("nKz",              101, "Number of phonon wave-vector samples.");
+    opt.add_option<double>("Kzscale",            0, "Scale of a mapped grid of phonon wave-vectors [1/angstrom].  The samples "
+                                                    "are denser below this value, so far fewer are needed.  Something close "
+                                                    "to 1/(well width) works well.  If zero, the samples are evenly spaced.");
+    opt.add_option<double>("avgtol",                "Find average rates by adaptive integration over ki, to this relative tolerance. "
+                                                    "If not specified, the table of --nki samples is used.  The tables of "
+                                                    "rate vs. energy (LOe<i><f>.r and LOa<i><f>.r) are only written when "
+                                                    "the table is used.");
+    opt.add_option<unsigned int>("threads",      0, "Number of threads to use (0 = one per CPU core).");
+    opt.add_option<std::string>("ffcachedir",      "Directory in which to save form-factor tables.  Tables "
+                                                    "saved by a previous run for the same wavefunctions and "
+                                                    "phonon wave-vectors are reused.");
+    opt.add_shard_option();
 
     opt.add_prog_specific_options_and_parse(argc, argv, doc);
 
@@ -67,17 +141,20 @@ int main(int argc,char *argv[])
     const auto S_flag      = !opt.get_option<bool>  ("noscreening");          // Include screening by default
     const auto nki         =  opt.get_option<size_t>("nki");                  // number of ki calculations
     const auto nKz         =  opt.get_option<size_t>("nKz");                  // number of Kz calculations
+    const auto n_threads   =  opt.get_option<unsigned int>("threads");        // number of worker threads
 
     std::ostringstream E_filename; // Energy filename string
     E_filename << "E" << p << ".r";
     std::ostringstream wf_prefix;  // Wavefunction filename prefix
     wf_prefix << "wf_" << p;
 
-    // Read data for all subbands from file
+    // Read data for all subbands from file.  The wave functions are only read
+    // for the subbands in the wanted transitions
     auto subbands = Subband::read_from_file(E_filename.str(),
                                             wf_prefix.str(),
                                             ".r",
-                                            m);
+                                            m,
+                                            true);
 
     // Read and set carrier distributions within each subband
     arma::vec  Ef;      // Fermi energies [J]
@@ -88,68 +165,124 @@ int main(int argc,char *argv[])
     for(unsigned int isb = 0; isb < subbands.size(); ++isb)
         subbands[isb].set_distribution_from_Ef_Te(Ef[isb], Te);
 
-    // Initialise scattering calculators and set parameters
-    ScatteringCalculatorLO em_calculator(subbands, A0, Ephonon, epsilon_s, epsilon_inf, m, Te, Tl, true);
-    ScatteringCalculatorLO ab_calculator(subbands, A0, Ephonon, epsilon_s, epsilon_inf, m, Te, Tl, false);
-    em_calculator.enable_screening(S_flag);
-    ab_calculator.enable_screening(S_flag);
-    em_calculator.enable_blocking(b_flag);
-    ab_calculator.enable_blocking(b_flag);
-    em_calculator.set_phonon_samples(nKz);
-    ab_calculator.set_phonon_samples(nKz);
-    em_calculator.set_ki_samples(nki);
-    ab_calculator.set_ki_samples(nki);
+    // Initialise scattering calculator and set parameters.  The same
+    // form-factor tables are used for emission and absorption.
+    ScatteringCalculatorLO calculator(subbands, A0, Ephonon, epsilon_s, epsilon_inf, m, Te, Tl, true);
+    calculator.enable_screening(S_flag);
+    calculator.enable_blocking(b_flag);
+    calculator.set_phonon_samples(nKz, opt.get_option<double>("Kzscale")*1e10);
+    calculator.set_ki_samples(nki);
+
+    if(opt.get_argument_known("ffcachedir"))
+        calculator.set_ff_cache_dir(opt.get_option<std::string>("ffcachedir"));
 
     // Read list of wanted transitions
     arma::uvec i_indices;
     arma::uvec f_indices;
 
     read_table("rrp.r", i_indices, f_indices);
+
+    // Only keep the transitions for this job
+    const auto shard = opt.get_shard();
+    shard.select_in_place(i_indices, f_indices);
+
+    // Only read the wave functions of the subbands in these transitions
+    Subband::load_wavefunctions(subbands, arma::join_cols(i_indices, f_indices) - 1, n_threads);
     const size_t ntx = i_indices.size();
 
+    // Get subband indices.  Note that the -1 is needed because the
+    // input file indexes subbands from 1 upward
+    std::vector<ScatteringCalculatorLO::map_key> transitions;
+
+    for(unsigned int itx = 0; itx < ntx; ++itx)
+        transitions.push_back(std::make_pair(i_indices[itx] - 1, f_indices[itx] - 1));
+
     arma::vec Wabar(ntx);
     arma::vec Webar(ntx);
 
-    // Loop over all desired transitions
-    for(unsigned int itx = 0; itx < i_indices.size(); ++itx)
+    // The rate tables are only needed if the averages are found from them.
+    // Otherwise, adaptive integration only samples the rates it needs.
+    const bool use_avgtol = opt.get_argument_known("avgtol");
+    std::vector<IntersubbandTransition> tx_em_all;
+    std::vector<IntersubbandTransition> tx_ab_all;
+
+    if(use_avgtol)
     {
-        // Get subband indices.  Note that the -1 is needed because the
-        // input file indexes subbands from 1 upward
-        unsigned int i = i_indices[itx] - 1;
-        unsigned int f = f_indices[itx] - 1;
+        const auto avgtol = opt.get_option<double>("avgtol");
+        calculator.make_ff_tables(transitions, n_threads);
 
-        // Output form-factors if desired
-        if(ff_flag)
+        for(const bool is_emission : {true, false})
         {
-            const auto Kz     = em_calculator.get_Kz_table();
-            const auto Gifsqr = em_calculator.get_ff_table(i,f);
-            ff_output(Kz, Gifsqr, i,f);
+            calculator.set_emission(is_emission);
+            auto &Wbar = is_emission ? Webar : Wabar;
+
+            for(unsigned int itx = 0; itx < ntx; ++itx)
+                Wbar[itx] = calculator.get_average_rate(transitions[itx].first,
+                                                        transitions[itx].second,
+                                                        avgtol);
         }
+    }
+    else
+    {
+        // Find the scattering tables for every transition in one go, so that
+        // the work can be shared between threads
+        calculator.set_emission(true);
+        tx_em_all = calculator.get_transitions(transitions, n_threads);
+
+        calculator.set_emission(false);
+        tx_ab_all = calculator.get_transitions(transitions, n_threads);
+
+        for(unsigned int itx = 0; itx < ntx; ++itx)
+        {
+            Webar[itx] = tx_em_all[itx].get_average_rate();
+            Wabar[itx] = tx_ab_all[itx].get_average_rate();
+        }
+    }
+
+    {
+        ScopedTimer timer("output");
+
+        // Loop over all desired transitions
+        for(unsigned int itx = 0; itx < ntx; ++itx)
+        {
+            const auto i = transitions[itx].first;
+            const auto f = transitions[itx].second;
+
+            // Output form-factors if desired
+            if(ff_flag)
+            {
+                const auto Kz     = calculator.get_Kz_table();
+                const auto Gifsqr = calculator.get_ff_table(i,f);
+                ff_output(Kz, Gifsqr, i,f);
+            }
+
+            if(use_avgtol)
+                continue;
+
+            const auto &tx_em = tx_em_all[itx];
+            const auto &tx_ab = tx_ab_all[itx];
+            const auto Weif   = tx_em.get_rate_table(); // Emission scattering rate at this wave-vector [1/s]
+            const auto Waif   = tx_ab.get_rate_table(); // Absorption scattering rate at this wave-vector [1/s]
+            auto Ei_em  = tx_em.get_Ei_total_table();  // Initial TOTAL energies [J]
+            auto Ei_ab  = tx_ab.get_Ei_total_table();  // Initial TOTAL energies [J]
+            Ei_em *= 1000.0/e; // Rescale to meV
+            Ei_ab *= 1000.0/e; // Rescale to meV
+
+            // output scattering rates versus TOTAL carrier energy
+            char	filename_em[9];
+            sprintf(filename_em, "LOe%i%i.r",i,f);	/* emission	*/
+            char	filename_ab[9];
+            sprintf(filename_ab,"LOa%i%i.r",i,f);	/* absorption	*/
+            write_table(filename_em, Ei_em, Weif);
+            write_table(filename_ab, Ei_ab, Waif);
+        } /* end while over states */
+
+        write_table(shard.get_filename("LOa-if.r"), i_indices, f_indices, Wabar);
+        write_table(shard.get_filename("LOe-if.r"), i_indices, f_indices, Webar);
+    }
 
-        const auto tx_em  = em_calculator.get_transition(i, f);
-        const auto tx_ab  = ab_calculator.get_transition(i, f);
-        const auto Weif   = tx_em.get_rate_table(); // Emission scattering rate at this wave-vector [1/s]
-        const auto Waif   = tx_ab.get_rate_table(); // Absorption scattering rate at this wave-vector [1/s]
-        auto Ei_em  = tx_em.get_Ei_total_table();  // Initial TOTAL energies [J]
-        auto Ei_ab  = tx_ab.get_Ei_total_table();  // Initial TOTAL energies [J]
-        Ei_em *= 1000.0/e; // Rescale to meV
-        Ei_ab *= 1000.0/e; // Rescale to meV
-
-        // output scattering rates versus TOTAL carrier energy
-        char	filename_em[9];
-        sprintf(filename_em, "LOe%i%i.r",i,f);	/* emission	*/
-        char	filename_ab[9];
-        sprintf(filename_ab,"LOa%i%i.r",i,f);	/* absorption	*/
-        write_table(filename_em, Ei_em, Weif);
-        write_table(filename_ab, Ei_ab, Waif);
-
-        // Average rates over entire subband
-        Wabar[itx] = tx_ab.get_average_rate();
-        Webar[itx] = tx_em.get_average_rate();
-    } /* end while over states */
-
-    write_table("LOa-if.r", i_indices, f_indices, Wabar);
-    write_table("LOe-if.r", i_indices, f_indices, Webar);
+    if(opt.get_argument_known("Temax"))
+        write_rates_vs_Te(opt, shard, calculator, transitions, n_threads);
 
     return EXIT_SUCCESS;
 }
@@ -10,6 +10,10 @@
    of (pi/(n_z*A0), all information for which is read in from the
    command line
 
+   With -N, the sets of k-vectors for several points across the minizone
+   are written in turn, stepping evenly from the given point to the edge
+   of the minizone, for use with qwwad_pp_superlattice -K
+
    Paul Harrison, October 1998		                         */
 
 #include <stdio.h>
@@ -25,12 +29,16 @@ float	g;		/* superlattice reciprocal lattice vector	*/
 float	k;		/* the electron wave vector within the SL BZ	*/
 int	i_kxi;		/* index over kxi				*/
 int	n_z;		/* number of lattice points along z-axis of cell*/
+int	n_k;		/* number of points in the minizone		*/
+int	i_k;		/* index over points in the minizone		*/
+float	k0;		/* the current point in the minizone		*/
 FILE	*Fk;		/* pointer to output file			*/
 
 /* default values	*/
 
 k=0;
 n_z=1;
+n_k=1;
 
 while((argc>1)&&(argv[1][0]=='-'))
 {
@@ -42,8 +50,13 @@ while((argc>1)&&(argv[1][0]=='-'))
   case 'z':
            n_z=atoi(argv[2]);
            break;
+  case 'N':
+           n_k=atoi(argv[2]);
+           if(n_k<1){fprintf(stderr,"Error: at least one minizone k-point is needed\n");exit(EXIT_FAILURE);}
+           break;
   default :
 	   printf("Usage:  slk  [-k minizone k-point (\033[1m0\033[0m 2*pi/(n_zA0))][-z # cells \033[1m1\033[0m]\n");
+	   printf("             [-N # minizone k-points \033[1m1\033[0m]\n");
 	   exit(0);
  }
  argv++;
@@ -65,10 +78,17 @@ g=1/((float)n_z);
 
 Fk=fopen("k.r","w");
 
-for(i_kxi=0;i_kxi<2*n_z;i_kxi++)
+for(i_k=0;i_k<n_k;i_k++)
 {
- kxi=k+(float)(-n_z+i_kxi)*g;
- fprintf(Fk,"0.0 0.0 %f\n",kxi);
+ /* Step evenly from k to the edge of the minizone, g/2	*/
+ k0=k;
+ if(n_k>1) k0+=(g/2-k)*(float)i_k/(float)(n_k-1);
+
+ for(i_kxi=0;i_kxi<2*n_z;i_kxi++)
+ {
+  kxi=k0+(float)(-n_z+i_kxi)*g;
+  fprintf(Fk,"0.0 0.0 %f\n",kxi);
+ }
 }
 
 fclose(Fk);
@@ -0,0 +1,508 @@
+/**
+ * \file   qwwad_sweep.cpp
+ * \brief  Run a QWWAD program for each value of a parameter, and collect the results
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "qwwad/checkpoint.h"
+#include "qwwad/options.h"
+#include "qwwad/parallel.h"
+#include "qwwad/process.h"
+#include "qwwad/profiler.h"
+
+using namespace QWWAD;
+
+/**
+ * Configure command-line options for the program
+ */
+Options configure_options(int argc, char* argv[])
+{
+    Options opt;
+
+    std::string summary("Run a program for each value of a parameter, and collect the results in a single table.");
+
+    opt.add_option<std::string>("program",               "Name of the program to run, e.g., qwwad_sr_interface_roughness");
+    opt.add_option<std::string>("parameter",             "Long name of the option to sweep, e.g., lambda");
+    opt.add_option<std::string>("values",                "Comma-separated list of parameter values.  If unspecified, "
+                                                         "the values are set by --start, --stop and --step.");
+    opt.add_option<double>     ("start",              0, "First parameter value");
+    opt.add_option<double>     ("stop",               0, "Last parameter value");
+    opt.add_option<double>     ("step",               1, "Step between parameter values");
+    opt.add_option<std::string>("args",              "", "Other arguments to pass to the program at every point");
+    opt.add_option<std::string>("resultfile",            "Name of the output file from the program that holds the result");
+    opt.add_option<size_t>     ("row",                0, "Line of the result file to collect (1 = first line, 0 = all lines)");
+    opt.add_option<std::string>("sweepfile", "sweep.r",  "Filename to which the collected results are written");
+    opt.add_option<unsigned int>("threads",           0, "Number of points to run at once (0 = one per CPU core)");
+    opt.add_option<bool>       ("keep",                  "Keep the working directory for each point");
+    opt.add_option<std::string>("checkpoint",            "File to which the completed points are saved.  If unspecified, "
+                                                         "no checkpoints are written.");
+    opt.add_option<bool>       ("resume",                "Carry on from the checkpoint file, skipping the points that are "
+                                                         "already done");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, summary);
+
+    return opt;
+}
+
+/**
+ * \brief Find the list of parameter values
+ *
+ * \param[in] opt User options
+ *
+ * \returns The values, formatted as they will be given to the program
+ */
+static std::vector<std::string> get_values(const Options &opt)
+{
+    std::vector<std::string> values;
+
+    if(opt.get_argument_known("values"))
+        values = opt.get_list("values");
+    else
+    {
+        const auto start = opt.get_option<double>("start");
+        const auto stop  = opt.get_option<double>("stop");
+        const auto step  = opt.get_option<double>("step");
+
+        if(step == 0 || (stop - start)/step < 0)
+        {
+            std::cerr << "Parameter step must be nonzero, and in the direction from start to stop." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        // Allow a little rounding error so that the stop value is included
+        const auto n = static_cast<size_t>(std::floor((stop - start)/step + 1e-9)) + 1;
+
+        for(size_t i = 0; i < n; ++i)
+        {
+            std::ostringstream oss;
+            oss << start + step*i;
+            values.push_back(oss.str());
+        }
+    }
+
+    if(values.empty())
+    {
+        std::cerr << "No parameter values were given." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return values;
+}
+
+/**
+ * \brief Split a string into whitespace-separated words
+ */
+static std::vector<std::string> split_words(const std::string &str)
+{
+    std::istringstream iss(str);
+    std::vector<std::string> words;
+    std::string word;
+
+    while(iss >> word)
+        words.push_back(word);
+
+    return words;
+}
+
+/**
+ * \brief Copy every regular file in a directory into another directory
+ *
+ * \param[in] src_dir  The directory that holds the input files
+ * \param[in] dest_dir The working directory for a single point
+ *
+ * \details The files are copied rather than linked, so that a program that
+ *          rewrites one of its input files cannot affect the other points.
+ */
+static void copy_inputs(const std::string &src_dir,
+                        const std::string &dest_dir)
+{
+    DIR *dir = opendir(src_dir.c_str());
+
+    if(!dir)
+    {
+        std::ostringstream oss;
+        oss << "Could not read directory " << src_dir;
+        throw std::runtime_error(oss.str());
+    }
+
+    while(const auto entry = readdir(dir))
+    {
+        const std::string name(entry->d_name);
+        const std::string src = src_dir + "/" + name;
+        struct stat info;
+
+        if(stat(src.c_str(), &info) == 0 && S_ISREG(info.st_mode))
+        {
+            const std::string dest = dest_dir + "/" + name;
+            std::ifstream in(src.c_str(), std::ios::binary);
+            std::ofstream out(dest.c_str(), std::ios::binary);
+
+            if(!(out << in.rdbuf()) && info.st_size > 0)
+            {
+                closedir(dir);
+                std::ostringstream oss;
+                oss << "Could not copy " << src << " to " << dest;
+                throw std::runtime_error(oss.str());
+            }
+        }
+    }
+
+    closedir(dir);
+}
+
+/**
+ * \brief Delete a working directory and all the files in it
+ */
+static void remove_directory(const std::string &path)
+{
+    DIR *dir = opendir(path.c_str());
+
+    if(!dir)
+        return;
+
+    while(const auto entry = readdir(dir))
+    {
+        const std::string name(entry->d_name);
+
+        if(name != "." && name != "..")
+            unlink((path + "/" + name).c_str());
+    }
+
+    closedir(dir);
+    rmdir(path.c_str());
+}
+
+/**
+ * \brief Read the wanted lines from a result file
+ *
+ * \param[in] filename The name of the file
+ * \param[in] row      The line to read (1 = first line, 0 = all non-blank lines)
+ */
+static std::vector<std::string> read_result(const std::string &filename,
+                                            const size_t       row)
+{
+    std::ifstream stream(filename.c_str());
+
+    if(!stream)
+    {
+        std::ostringstream oss;
+        oss << "Could not read result file " << filename;
+        throw std::runtime_error(oss.str());
+    }
+
+    std::vector<std::string> lines;
+    std::string line;
+    size_t iline = 0;
+
+    while(std::getline(stream, line))
+    {
+        ++iline;
+
+        if(row == 0)
+        {
+            if(line.find_first_not_of(" \t\r") != std::string::npos)
+                lines.push_back(line);
+        }
+        else if(iline == row)
+        {
+            lines.push_back(line);
+            break;
+        }
+    }
+
+    if(row > 0 && lines.empty())
+    {
+        std::ostringstream oss;
+        oss << "Result file " << filename << " has fewer than " << row << " lines.";
+        throw std::runtime_error(oss.str());
+    }
+
+    return lines;
+}
+
+/// Identifier at the start of a checkpoint file
+static const char checkpoint_magic[8] = {'Q','W','W','A','D','S','W','P'};
+
+/// Version number of the checkpoint file format
+static const uint32_t checkpoint_version = 1;
+
+/**
+ * \brief Convert the results of the completed points to the checkpoint file format
+ *
+ * \param[in] command The program, parameter and any other arguments, which identify the sweep
+ * \param[in] values  The parameter value at each point
+ * \param[in] done    Flag for each point that is complete
+ * \param[in] results The lines of the result file at each point
+ *
+ * \details A checkpoint file has an 8-byte identifier and a format version,
+ *          followed by the command and the number of points.  Each point then has
+ *          its parameter value, a flag that shows whether it is complete and the
+ *          lines of its result file.  Each string is stored as a 64-bit length
+ *          and its characters.
+ */
+static std::string serialise_checkpoint(const std::vector<std::string>              &command,
+                                        const std::vector<std::string>              &values,
+                                        const std::vector<uint8_t>                  &done,
+                                        const std::vector<std::vector<std::string>> &results)
+{
+    std::string buffer = start_checkpoint(checkpoint_magic, checkpoint_version);
+    append_checkpoint_value<uint64_t>(buffer, command.size());
+
+    for(const auto &word : command)
+        append_checkpoint_string(buffer, word);
+
+    append_checkpoint_value<uint64_t>(buffer, values.size());
+
+    for(size_t ipoint = 0; ipoint < values.size(); ++ipoint)
+    {
+        append_checkpoint_string(buffer, values[ipoint]);
+        append_checkpoint_value<uint8_t>(buffer, done[ipoint]);
+
+        const auto &lines = done[ipoint] ? results[ipoint] : std::vector<std::string>();
+        append_checkpoint_value<uint64_t>(buffer, lines.size());
+
+        for(const auto &line : lines)
+            append_checkpoint_string(buffer, line);
+    }
+
+    return buffer;
+}
+
+/**
+ * \brief Read the completed points from a checkpoint file
+ *
+ * \param[in]  filename Name of the checkpoint file
+ * \param[in]  command  The program, parameter and any other arguments for this sweep
+ * \param[in]  values   The parameter value at each point in this sweep
+ * \param[out] done     Flag for each point that is complete
+ * \param[out] results  The lines of the result file at each completed point
+ *
+ * \details The checkpoint must be from a sweep with the same command and values.
+ */
+static void read_checkpoint(const std::string                     &filename,
+                            const std::vector<std::string>        &command,
+                            const std::vector<std::string>        &values,
+                            std::vector<uint8_t>                  &done,
+                            std::vector<std::vector<std::string>> &results)
+{
+    std::ifstream stream(filename.c_str(), std::ios::binary);
+    check_checkpoint_header(stream, filename, checkpoint_magic, checkpoint_version, "a sweep");
+
+    std::vector<std::string> command_file(read_checkpoint_value<uint64_t>(stream));
+
+    for(auto &word : command_file)
+        word = read_checkpoint_string(stream);
+
+    const auto n_points = read_checkpoint_value<uint64_t>(stream);
+    bool       match    = stream and command_file == command and n_points == values.size();
+
+    for(size_t ipoint = 0; ipoint < n_points and match; ++ipoint)
+    {
+        match = (read_checkpoint_string(stream) == values[ipoint]);
+
+        done[ipoint] = read_checkpoint_value<uint8_t>(stream);
+        results[ipoint].resize(read_checkpoint_value<uint64_t>(stream));
+
+        for(auto &line : results[ipoint])
+            line = read_checkpoint_string(stream);
+
+        match = match and stream;
+    }
+
+    if(!match)
+    {
+        std::ostringstream oss;
+        oss << "Checkpoint " << filename << " does not match this sweep.";
+        throw std::runtime_error(oss.str());
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    if(!opt.get_argument_known("program") || !opt.get_argument_known("parameter")
+       || !opt.get_argument_known("resultfile"))
+    {
+        std::cerr << "The program, parameter and result file must be specified." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    const auto program    = opt.get_option<std::string>("program");
+    const auto parameter  = opt.get_option<std::string>("parameter");
+    const auto resultfile = opt.get_option<std::string>("resultfile");
+    const auto row        = opt.get_option<size_t>("row");
+    const auto extra_args = split_words(opt.get_option<std::string>("args"));
+    const auto keep       = opt.get_option<bool>("keep");
+    const auto values     = get_values(opt);
+    const auto n_points   = values.size();
+    const auto resume     = opt.get_option<bool>("resume");
+
+    const bool checkpointing   = opt.get_argument_known("checkpoint");
+    const auto checkpoint_file = checkpointing ? opt.get_option<std::string>("checkpoint") : std::string();
+
+    if(resume && !checkpointing)
+    {
+        std::cerr << "A checkpoint file must be given with --resume." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // The whole command identifies the sweep in a checkpoint
+    std::vector<std::string> command;
+    command.push_back(program);
+    command.push_back(parameter);
+    command.insert(command.end(), extra_args.begin(), extra_args.end());
+    command.push_back(resultfile);
+
+    char cwd[4096];
+
+    if(!getcwd(cwd, sizeof(cwd)))
+    {
+        std::cerr << "Could not find the current directory." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector< std::vector<std::string> > results(n_points);
+    std::vector<uint8_t>                    done(n_points, 0); // Flag for each completed point
+
+    if(resume)
+    {
+        try
+        {
+            read_checkpoint(checkpoint_file, command, values, done, results);
+        }
+        catch(std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    std::vector<size_t> pending; // Points that are still to be run
+
+    for(size_t ipoint = 0; ipoint < n_points; ++ipoint)
+    {
+        if(!done[ipoint])
+            pending.push_back(ipoint);
+    }
+
+    if(opt.get_verbose() && resume)
+        std::cout << "Resuming sweep with " << n_points - pending.size() << " of " << n_points
+                  << " points already done." << std::endl;
+
+    // All the working directories go in a single new directory.  A resumed sweep
+    // may reuse the directory left over from the run that was stopped.
+    const std::string base_dir = std::string(cwd) + "/qwwad-sweep";
+    rmdir(base_dir.c_str());
+
+    if(mkdir(base_dir.c_str(), 0755) != 0 && !(resume && errno == EEXIST))
+    {
+        std::cerr << "Could not create " << base_dir << ".  Remove it if it is left over from "
+                  << "an earlier sweep." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::mutex checkpoint_mutex; // Lock for the completion flags and the checkpoint file
+
+    try
+    {
+        // Share the cores between the points that run at once
+        const unsigned int n_running = std::min<size_t>(get_thread_count(opt.get_option<unsigned int>("threads")),
+                                                        pending.size());
+        const auto child_env = get_child_thread_environment(n_running);
+
+        run_in_parallel(pending.size(), opt.get_option<unsigned int>("threads"), [&](const size_t ipending) {
+            ScopedTraceEvent event("sweep point");
+            const auto ipoint = pending[ipending];
+
+            std::ostringstream dir_oss;
+            dir_oss << base_dir << "/" << ipoint + 1;
+            const auto workdir = dir_oss.str();
+
+            // Clear out anything left by a run that was stopped
+            if(resume)
+                remove_directory(workdir);
+
+            if(mkdir(workdir.c_str(), 0755) != 0)
+            {
+                std::ostringstream oss;
+                oss << "Could not create " << workdir;
+                throw std::runtime_error(oss.str());
+            }
+
+            copy_inputs(cwd, workdir);
+
+            std::vector<std::string> args;
+            args.push_back(program);
+            args.push_back("--" + parameter);
+            args.push_back(values[ipoint]);
+            args.insert(args.end(), extra_args.begin(), extra_args.end());
+
+            if(run_process(args, workdir, "sweep.log", child_env) != EXIT_SUCCESS)
+            {
+                std::ostringstream oss;
+                oss << program << " failed in " << workdir << ".  See " << workdir
+                    << "/sweep.log for details.";
+                throw std::runtime_error(oss.str());
+            }
+            results[ipoint] = read_result(workdir + "/" + resultfile, row);
+
+            if(checkpointing)
+            {
+                std::lock_guard<std::mutex> lock(checkpoint_mutex);
+                done[ipoint] = 1;
+
+                if(!write_checkpoint_file(checkpoint_file, serialise_checkpoint(command, values, done, results)))
+                    std::cerr << "Warning: could not write checkpoint to " << checkpoint_file << std::endl;
+            }
+
+            if(opt.get_verbose())
+                std::cout << parameter << " = " << values[ipoint] << " done." << std::endl;
+
+            if(!keep)
+                remove_directory(workdir);
+        });
+    }
+    catch(std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if(!keep)
+        rmdir(base_dir.c_str());
+
+    std::ofstream stream(opt.get_option<std::string>("sweepfile").c_str());
+
+    for(size_t ipoint = 0; ipoint < n_points; ++ipoint)
+    {
+        for(auto const &line : results[ipoint])
+            stream << values[ipoint] << "\t" << line << "\n";
+    }
+
+    if(!stream)
+    {
+        std::cerr << "Could not write " << opt.get_option<std::string>("sweepfile") << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -2,9 +2,14 @@
 # include "config.h"
 #endif
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <gsl/gsl_math.h>
 #include "qwwad/options.h"
 #include "qwwad/material.h"
@@ -14,70 +19,14 @@
 #include "qwwad/maths-helpers.h"
 #include "qwwad/file-io.h"
 #include "qwwad/linear-algebra.h"
+#include "qwwad/anderson-mixer.h"
+#include "qwwad/checkpoint.h"
+#include "qwwad/parallel.h"
+#include "qwwad/thermal-conductivity.h"
 #include <glibmm/ustring.h>
 
 using namespace QWWAD;
 
-/**
- * Find the thermal conductivity of a material [W/m/K]
- *
- * \param[in] mat The material system
- * \param[in] x   Alloy fraction (if applicable)
- * \param[in] T   Temperature [K]
- *
- * \todo Figure out where all these values come from!
- * \todo These values only work for a limited range of
- *       temperatures. Restrict the domain accordingly?
- */
-static double thermal_cond(const Material &mat,
-                           const double    x,
-                           const double    T)
-{
-    double k = 0.0;
-
-    try
-    {
-        k = mat.get_property_value("thermal-conductivity-vs-alloy", x);
-    }
-    catch(std::exception &e)
-    {
-        try
-        {
-            double k0_1  = mat.get_property_value("thermal-conductivity-0K-1");
-            double k0_2  = mat.get_property_value("thermal-conductivity-0K-2");
-            double tau_1 = mat.get_property_value("thermal-conductivity-decay-index-1");
-            double tau_2 = mat.get_property_value("thermal-conductivity-decay-index-2");
-            double k_1 = k0_1*pow(T,tau_1);
-            double k_2 = k0_2*pow(T,tau_2);
-            k = lin_interp(k_1,k_2, x);
-        }
-        catch(std::exception &e)
-        {
-            try
-            {
-                const double k0  = mat.get_property_value("thermal-conductivity-0K");
-                const double tau = mat.get_property_value("thermal-conductivity-decay-index");
-                k = k0 * pow(T,tau);
-            }
-            catch(std::exception &e)
-            {
-                try
-                {
-                    const double k_hi    = mat.get_property_value("thermal-conductivity-high-T");
-                    const double k_decay = mat.get_property_value("thermal-conductivity-inverse-T");
-                    k = k_hi + k_decay/T;
-                }
-                catch(std::exception &e)
-                {
-                    k = mat.get_property_value("thermal-conductivity-T", T);
-                }
-            }
-        }
-    }
-
-    return k;
-}
-
 class Thermal1DOptions: public Options
 {
     double dc; // Duty cycle
@@ -111,7 +60,23 @@ Thermal1DOptions::Thermal1DOptions(int argc, char *argv[]) :
     add_option<double>     ("dc,d",                       2, "Duty cycle for pulse train [%]");
     add_option<double>     ("frequency,f",               10, "Pulse repetition rate [kHz]");
     add_option<double>     ("power,P",                17.65, "Pulse power [W]");
-    add_option<size_t>     ("nrep",                       1, "Number of pulse periods to simulate");
+    add_option<size_t>     ("nrep",                       1, "Number of pulse periods to simulate "
+                                                             "(maximum number if --periodic-tol is set)");
+    add_option<double>     ("refactor-dT",              0.0, "Temperature drift [K] before Crank-Nicolson "
+                                                             "matrices are rebuilt (0 = every step)");
+    add_option<double>     ("adaptive-tol",             0.0, "Local error tolerance [K] for adaptive time "
+                                                             "steps (0 = fixed steps)");
+    add_option<double>     ("periodic-tol",             0.0, "Stop once the temperature changes by less than "
+                                                             "this over a period [K] (0 = run all periods)");
+    add_option<size_t>     ("mixingdepth",                5, "Number of previous periods used in Anderson "
+                                                             "acceleration of the periodic steady state");
+    add_option<std::string>("checkpoint", "thermal-checkpoint.bin", "Checkpoint file");
+    add_option<size_t>     ("checkpoint-interval",        0, "Number of periods between checkpoints "
+                                                             "(0 = no checkpoints)");
+    add_option<bool>       ("restart",                       "Resume from the checkpoint file");
+    add_option<std::string>("conditions",                    "File of conditions to simulate together, with "
+                                                             "the power [W], duty cycle [%] and pulse "
+                                                             "repetition rate [kHz] on each line");
 
     add_prog_specific_options_and_parse(argc,argv,doc);
 
@@ -166,6 +131,15 @@ Thermal1DOptions::Thermal1DOptions(int argc, char *argv[]) :
         throw std::domain_error(oss.str());
     }
 
+    if(get_option<double>("refactor-dT") < 0.0)
+        throw std::domain_error("Temperature drift tolerance must not be negative.");
+
+    if(get_option<double>("adaptive-tol") < 0.0)
+        throw std::domain_error("Adaptive time-step tolerance must not be negative.");
+
+    if(get_option<double>("periodic-tol") < 0.0)
+        throw std::domain_error("Periodic steady-state tolerance must not be negative.");
+
     if(get_verbose()) print();
 }
 
@@ -179,7 +153,10 @@ void Thermal1DOptions::print() const
               << "Period length         = " << 1e6/f                        << " microsecond" << std::endl
               << "Number of periods     = " << get_option<size_t>("nrep")                     << std::endl
               << "Spatial resolution    = " << get_option<double>("dy")*1e6 << " micron"      << std::endl
-              << "Ridge area            = " << get_option<double>("area")   << " mm^2"        << std::endl;
+              << "Ridge area            = " << get_option<double>("area")   << " mm^2"        << std::endl
+              << "Rebuild tolerance     = " << get_option<double>("refactor-dT") << " K"         << std::endl
+              << "Adaptive tolerance    = " << get_option<double>("adaptive-tol") << " K"        << std::endl
+              << "Periodic tolerance    = " << get_option<double>("periodic-tol") << " K"        << std::endl;
 }
 
 class Thermal1DData {
@@ -221,16 +198,153 @@ Thermal1DData::Thermal1DData(const Thermal1DOptions &opt,
 static double calctave(const arma::vec &g,
                        const arma::vec &T);
 
-static arma::vec calctemp(double dt,
-                          arma::vec        &Told,
-                          arma::vec  const &q_old,
-                          arma::vec  const &q_new,
-                          arma::uvec const &iLayer,
-                          const std::vector<Material> &mat,
-                          const arma::vec   &x,
-                          const std::vector<DebyeModel> &dm_layer,
-                          const arma::vec   &rho_layer,
-                          Thermal1DOptions& opt);
+/**
+ * \brief Crank-Nicolson time-stepping scheme for the heat equation
+ *
+ * \details The coefficient matrices depend on the thermal conductivity and heat
+ *          capacity at each point, which are expensive to find.  If a tolerance is
+ *          set, the matrices and the factorisation of the left-hand side are kept
+ *          until the temperature anywhere in the structure has drifted by more than
+ *          the tolerance since they were last built.  Otherwise, they are rebuilt
+ *          at every time step.
+ *
+ *          The material coefficients are stored per unit time, so the time step
+ *          can be changed from one step to the next.  The LHS is then refactorised,
+ *          but the material properties are not looked up again.
+ */
+class CrankNicolsonStepper
+{
+private:
+    double                                  _dy;        ///< Spatial step [m]
+    double                                  _tol;       ///< Temperature drift before rebuild [K]
+    arma::uvec                       const &_iLayer;    ///< Index of layer containing each point
+    std::vector<ThermalConductivity> const &_k_layer;   ///< Thermal conductivity in each layer
+    std::vector<DebyeModel>          const &_dm_layer;  ///< Heat capacity model in each layer
+    arma::vec                        const &_rho_layer; ///< Density of each layer [kg/m^3]
+
+    arma::vec            _c_sub;   ///< Subdiagonal coupling per unit time [1/s]
+    arma::vec            _c_super; ///< Superdiagonal coupling per unit time [1/s]
+    arma::vec            _s;       ///< Heating coefficient per unit time [m^3.K/J]
+    arma::vec            _T_ref;   ///< Temperature profile used to find the coefficients [K]
+    size_t               _n_build; ///< Number of times the coefficients have been found
+
+    double               _dt;      ///< Time step for the stored matrices [s]
+    arma::vec            _B_sub;   ///< Subdiagonal of RHS matrix
+    arma::vec            _B_diag;  ///< Diagonal of RHS matrix
+    arma::vec            _B_super; ///< Superdiagonal of RHS matrix
+    TridiagFactorisation _LHS;     ///< Factorised LHS matrix
+    arma::vec            _q;       ///< Heating vector for the latest step [K]
+
+    void build(const arma::vec &T);
+    void set_dt(const double dt);
+
+public:
+    CrankNicolsonStepper(const double                            dy,
+                         const double                            tol,
+                         const arma::uvec                       &iLayer,
+                         const std::vector<ThermalConductivity> &k_layer,
+                         const std::vector<DebyeModel>          &dm_layer,
+                         const arma::vec                        &rho_layer);
+
+    arma::vec step(const arma::vec &Told,
+                   const arma::vec &q_old,
+                   const arma::vec &q_new,
+                   const double     dt);
+
+    /// Return the number of times that the material coefficients have been found
+    size_t get_n_build() const {return _n_build;}
+};
+
+static void take_adaptive_step(CrankNicolsonStepper &stepper,
+                               arma::vec            &T,
+                               double               &t,
+                               double               &h,
+                               const double          tol,
+                               const arma::vec      &g,
+                               const double          time_period,
+                               const double          pw);
+
+/**
+ * \brief State of a thermal simulation at the end of a pulse period
+ *
+ * \details This holds everything needed to carry on the simulation from the next
+ *          period: the temperature profiles, the state of the adaptive solver and
+ *          the statistics of all the periods so far.
+ *
+ *          A checkpoint file has an 8-byte identifier and a format version,
+ *          followed by the scalar values and then each table as a 64-bit length
+ *          and its entries as doubles, all in the native byte order.
+ */
+class ThermalCheckpoint
+{
+public:
+    uint64_t  n_per_done;   ///< Number of periods completed
+    uint64_t  nt_per;       ///< Number of time samples per period
+    double    t_adapt;      ///< Time reached by the adaptive solver [s]
+    double    t_adapt_prev; ///< Time at the previous adaptive step [s]
+    double    h_adapt;      ///< Trial length of the next adaptive step [s]
+    uint64_t  n_adapt;      ///< Number of accepted adaptive steps
+    arma::vec Told;         ///< Temperature profile at the last fixed step [K]
+    arma::vec T;            ///< Temperature profile at the last sample [K]
+    arma::vec T_adapt;      ///< Temperature profile at t_adapt [K]
+    arma::vec T_adapt_prev; ///< Temperature profile at t_adapt_prev [K]
+    arma::vec T_y_max;      ///< Temperature profile at the hottest sample [K]
+    arma::vec t;            ///< Sample times in completed periods [s]
+    arma::vec T_avg;        ///< Average AR temperature at each sample [K]
+    arma::vec t_mid;        ///< Time at middle of each completed pulse [s]
+    arma::vec T_mid;        ///< Average AR temperature at middle of each pulse [K]
+    arma::vec t_max;        ///< Time of peak temperature in each period [s]
+    arma::vec T_max;        ///< Peak AR temperature in each period [K]
+    arma::vec t_min;        ///< Time of minimum temperature in each period [s]
+    arma::vec T_min;        ///< Minimum AR temperature in each period [K]
+    arma::vec t_period;     ///< Sample times in the last period [microsecond]
+    arma::vec T_period;     ///< Average AR temperature in the last period [K]
+    std::vector<double> t_rise; ///< Sample times on the rising edge [microsecond]
+    std::vector<double> T_rise; ///< Temperature on the rising edge [K]
+    std::vector<double> t_fall; ///< Sample times on the falling edge [microsecond]
+    std::vector<double> T_fall; ///< Temperature on the falling edge [K]
+
+    std::string serialise() const;
+
+    static ThermalCheckpoint read(const std::string &filename);
+};
+
+/**
+ * \brief Writes checkpoint files without blocking the simulation
+ *
+ * \details Each checkpoint is written by a background thread, so the simulation
+ *          only waits if the previous checkpoint has not yet been written.
+ */
+class ThermalCheckpointWriter
+{
+private:
+    std::string _filename; ///< Name of the checkpoint file
+    std::thread _thread;   ///< Thread writing the latest checkpoint
+
+    static void write_file(const std::string filename,
+                           const std::string buffer);
+
+public:
+    ThermalCheckpointWriter(const std::string &filename) :
+        _filename(filename)
+    {}
+
+    ~ThermalCheckpointWriter() {wait();}
+
+    void write(const ThermalCheckpoint &checkpoint);
+
+    /// Wait until the latest checkpoint has been written
+    void wait() {if(_thread.joinable()) _thread.join();}
+};
+
+static int run_conditions(const Thermal1DOptions                 &opt,
+                          const arma::vec                        &y,
+                          const arma::vec                        &g_unit,
+                          const double                            dy,
+                          const arma::uvec                       &iLayer,
+                          const std::vector<ThermalConductivity> &k_layer,
+                          const std::vector<DebyeModel>          &dm_layer,
+                          const arma::vec                        &rho_layer);
 
 int main(int argc, char *argv[])
 {
@@ -273,6 +387,7 @@ int main(int argc, char *argv[])
     unsigned int iy=1;
 
     std::vector<DebyeModel> dm_layer;
+    std::vector<ThermalConductivity> k_layer;
     const size_t nL = data.d.size();
     arma::vec rho_layer = arma::zeros(nL);
 
@@ -312,6 +427,12 @@ int main(int argc, char *argv[])
         }
 
         dm_layer.push_back(DebyeModel(T_D, M, natoms));
+        k_layer.push_back(ThermalConductivity(data.mat_layer[iL], data.x[iL]));
+
+        // Nothing is cooled below the heat sink, and the table extends far above
+        // any temperature that the device would survive
+        k_layer.back().tabulate(opt.get_option<double>("Tsink"),
+                                opt.get_option<double>("Tsink") + 1000.0);
     }
 
     const auto _Tsink = opt.get_option<double>("Tsink");
@@ -324,18 +445,26 @@ int main(int argc, char *argv[])
     arma::vec Told = arma::zeros(ny);
     Told.fill(_Tsink);
 
-    std::ofstream FT("struct.dat");
-
-    for(unsigned int iy=0; iy<ny; iy++)
     {
-        auto const iL = iLayer(iy); // Look up layer containing this point
-        auto const mat = data.mat_layer[iL]; // Get the material in the layer
+        TableWriter FT("struct.dat");
 
-        // Now save the material to file
-        FT << iy*dy*1e6 << "\t" << mat.get_description() << std::endl;
+        for(unsigned int iy=0; iy<ny; iy++)
+        {
+            auto const iL = iLayer(iy); // Look up layer containing this point
+            auto const &mat = data.mat_layer[iL]; // Get the material in the layer
+
+            // Now save the material to file
+            FT << iy*dy*1e6 << '\t' << mat.get_description() << '\n';
+        }
     }
 
-    FT.close();
+    // Simulate a table of conditions together if requested.  The power density
+    // profile is scaled to the power in each condition.
+    if(opt.get_argument_known("conditions"))
+    {
+        return run_conditions(opt, y, arma::vec(g/opt.get_option<double>("power")), dy,
+                              iLayer, k_layer, dm_layer, rho_layer);
+    }
 
     // TODO: The Crank-Nicolson method allows quite large timesteps to be 
     // used... however, it's only going to give a sane result if the 
@@ -384,12 +513,97 @@ int main(int argc, char *argv[])
     std::vector<double> _t_fall;
     std::vector<double> _T_fall;
 
-    for(unsigned int iper=0; iper<_n_rep; iper++)
+    CrankNicolsonStepper stepper(dy, opt.get_option<double>("refactor-dT"),
+                                 iLayer, k_layer, dm_layer, rho_layer);
+
+    // State of the adaptive solver.  This runs ahead of the output time grid,
+    // and the profile at each output time is interpolated from the last two steps.
+    const auto adaptive_tol = opt.get_option<double>("adaptive-tol");
+    double     t_adapt      = 0.0;    // Time reached by the adaptive solver [s]
+    double     t_adapt_prev = 0.0;    // Time at the previous adaptive step [s]
+    double     h_adapt      = dt;     // Trial length of the next adaptive step [s]
+    size_t     n_adapt      = 0;      // Number of accepted adaptive steps
+    arma::vec  T_adapt      = Told;   // Temperature profile at t_adapt [K]
+    arma::vec  T_adapt_prev = Told;   // Temperature profile at t_adapt_prev [K]
+
+    // The periodic steady state is a fixed point of the map from the temperature
+    // profile at the start of a period to the profile at the end.  Anderson
+    // acceleration of this map converges in far fewer periods than simply
+    // running the pulse train.
+    const auto    periodic_tol = opt.get_option<double>("periodic-tol");
+    AndersonMixer mixer(opt.get_option<size_t>("mixingdepth"));
+    size_t        n_per_run    = _n_rep; // Number of periods actually simulated
+
+    // Carry on from a previous run if requested
+    size_t iper_first = 0;
+
+    if(opt.get_option<bool>("restart"))
+    {
+        const auto fname = opt.get_option<std::string>("checkpoint");
+        const auto chk   = ThermalCheckpoint::read(fname);
+
+        if(chk.nt_per != nt_per or chk.Told.size() != ny or chk.n_per_done > _n_rep)
+        {
+            std::cerr << "Checkpoint " << fname << " does not match this simulation." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        iper_first   = chk.n_per_done;
+        t_adapt      = chk.t_adapt;
+        t_adapt_prev = chk.t_adapt_prev;
+        h_adapt      = chk.h_adapt;
+        n_adapt      = chk.n_adapt;
+        Told         = chk.Told;
+        T            = chk.T;
+        T_adapt      = chk.T_adapt;
+        T_adapt_prev = chk.T_adapt_prev;
+        T_y_max      = chk.T_y_max;
+        t_period     = chk.t_period;
+        T_period     = chk.T_period;
+        _t_rise      = chk.t_rise;
+        _T_rise      = chk.T_rise;
+        _t_fall      = chk.t_fall;
+        _T_fall      = chk.T_fall;
+
+        for(size_t i = 0; i < chk.t.size(); ++i)
+        {
+            t(i)     = chk.t(i);
+            T_avg(i) = chk.T_avg(i);
+        }
+
+        for(size_t i = 0; i < iper_first; ++i)
+        {
+            t_mid(i) = chk.t_mid(i);
+            T_mid(i) = chk.T_mid(i);
+            t_max(i) = chk.t_max(i);
+            T_max(i) = chk.T_max(i);
+            t_min(i) = chk.t_min(i);
+            T_min(i) = chk.T_min(i);
+        }
+
+        if(opt.get_verbose())
+            printf("Restarting from %s after %zu periods.\n", fname.c_str(), iper_first);
+    }
+
+    const auto checkpoint_interval = opt.get_option<size_t>("checkpoint-interval");
+    ThermalCheckpointWriter checkpoint_writer(opt.get_option<std::string>("checkpoint"));
+
+    for(unsigned int iper=iper_first; iper<_n_rep; iper++)
     {
         double t_start = time_period*iper; // Time at start of period [s]
         t_min[iper] = t_start;
         t_max[iper] = t_start;
 
+        // Temperature profile at the start of this period
+        const arma::vec T_start = (adaptive_tol > 0.0) ? T_adapt : Told;
+
+        // Only the edges of the final pulse are kept.  When iterating towards a
+        // periodic steady state, we don't know in advance which pulse is final.
+        _t_rise.clear();
+        _T_rise.clear();
+        _t_fall.clear();
+        _T_fall.clear();
+
         // Step through time...
         for(unsigned int it=0; it < nt_per; it++)
         {
@@ -397,23 +611,47 @@ int main(int argc, char *argv[])
             const unsigned int it_total = it + nt_per*iper;
             t[it_total] = t_start+dt*it;
 
-            // Heating term at this time-step and at the last
-            // timestep
-            arma::vec q_old = arma::zeros(ny);
-            arma::vec q_now = arma::zeros(ny);
-
-            // If this time-step is within the pulse, then
-            // "switch on" the electrical power
-            if (dt*it <= pw)
-                q_now = g;
-
-            // Likewise for the previous time-step
-            if (it > 0 and dt*(it-1) <= pw)
-                q_old = g;
+            if(adaptive_tol > 0.0)
+            {
+                // Run the adaptive solver on past this sample time, and then
+                // interpolate the profile back onto it
+                while(t_adapt < t[it_total])
+                {
+                    t_adapt_prev = t_adapt;
+                    T_adapt_prev = T_adapt;
+                    take_adaptive_step(stepper, T_adapt, t_adapt, h_adapt, adaptive_tol,
+                                       g, time_period, pw);
+                    ++n_adapt;
+                }
 
-            // Calculate the spatial temperature profile at this 
-            // timestep
-            T = calctemp(dt, Told, q_old, q_now, iLayer, data.mat_layer, data.x, dm_layer, rho_layer, opt);
+                if(t_adapt > t_adapt_prev)
+                {
+                    const double w = (t[it_total] - t_adapt_prev)/(t_adapt - t_adapt_prev);
+                    T = (1.0 - w)*T_adapt_prev + w*T_adapt;
+                }
+                else
+                    T = T_adapt;
+            }
+            else
+            {
+                // Heating term at this time-step and at the last
+                // timestep
+                arma::vec q_old = arma::zeros(ny);
+                arma::vec q_now = arma::zeros(ny);
+
+                // If this time-step is within the pulse, then
+                // "switch on" the electrical power
+                if (dt*it <= pw)
+                    q_now = g;
+
+                // Likewise for the previous time-step
+                if (it > 0 and dt*(it-1) <= pw)
+                    q_old = g;
+
+                // Calculate the spatial temperature profile at this 
+                // timestep
+                T = stepper.step(Told, q_old, q_now, dt);
+            }
 
             // Find spatial average of T_AR
             T_avg(it_total) = calctave(g, T);
@@ -446,23 +684,20 @@ int main(int argc, char *argv[])
                 t_min(iper) = t(it_total);
             }
 
-            // Record rising and falling edges if this is the last pulse
-            if(iper == _n_rep-1)
+            // Record rising and falling edges (only the last pulse is kept)
+            if(fmod(t(it_total), time_period) <= pw) // if during pulse
             {
-                if(fmod(t(it_total), time_period) <= pw) // if during pulse
-                {
-                    _t_rise.push_back(t(it_total)*1e6);
-                    _T_rise.push_back(T_avg(it_total));
-                }
-                else
-                {
-                    _t_fall.push_back(t(it_total)*1e6);
-                    _T_fall.push_back(T_avg(it_total));
-                }
-
-                t_period(it) = t(it_total)*1e6;
-                T_period(it) = T_avg(it_total);
+                _t_rise.push_back(t(it_total)*1e6);
+                _T_rise.push_back(T_avg(it_total));
+            }
+            else
+            {
+                _t_fall.push_back(t(it_total)*1e6);
+                _T_fall.push_back(T_avg(it_total));
             }
+
+            t_period(it) = t(it_total)*1e6;
+            T_period(it) = T_avg(it_total);
         }// end time loop
 
         // Print progress to screen
@@ -473,8 +708,104 @@ int main(int argc, char *argv[])
                    T_max(iper),
                    t_max(iper)*1e6);
         }
+
+        if(periodic_tol > 0.0)
+        {
+            // Find the temperature profile at the end of the period
+            arma::vec T_end = Told;
+
+            if(adaptive_tol > 0.0)
+            {
+                while(t_adapt < t_start + time_period*(1.0 - 1e-12))
+                {
+                    take_adaptive_step(stepper, T_adapt, t_adapt, h_adapt, adaptive_tol,
+                                       g, time_period, pw);
+                    ++n_adapt;
+                }
+
+                T_end = T_adapt;
+            }
+
+            const double change = arma::abs(T_end - T_start).max();
+
+            if(opt.get_verbose())
+                printf("Period=%u change in temperature profile = %.3e K\n", iper+1, change);
+
+            if(change < periodic_tol)
+            {
+                n_per_run = iper+1;
+                break;
+            }
+
+            // Start the next period from the accelerated estimate of the steady state
+            const arma::vec T_next = mixer.mix(T_start, T_end);
+            Told         = T_next;
+            T_adapt      = T_next;
+            T_adapt_prev = T_next;
+            t_adapt_prev = t_adapt;
+        }
+
+        if(checkpoint_interval > 0 and (iper+1) % checkpoint_interval == 0)
+        {
+            const size_t nt_done = nt_per*(iper+1);
+
+            ThermalCheckpoint chk;
+            chk.n_per_done   = iper+1;
+            chk.nt_per       = nt_per;
+            chk.t_adapt      = t_adapt;
+            chk.t_adapt_prev = t_adapt_prev;
+            chk.h_adapt      = h_adapt;
+            chk.n_adapt      = n_adapt;
+            chk.Told         = Told;
+            chk.T            = T;
+            chk.T_adapt      = T_adapt;
+            chk.T_adapt_prev = T_adapt_prev;
+            chk.T_y_max      = T_y_max;
+            chk.t            = t.head(nt_done);
+            chk.T_avg        = T_avg.head(nt_done);
+            chk.t_mid        = t_mid.head(iper+1);
+            chk.T_mid        = T_mid.head(iper+1);
+            chk.t_max        = t_max.head(iper+1);
+            chk.T_max        = T_max.head(iper+1);
+            chk.t_min        = t_min.head(iper+1);
+            chk.T_min        = T_min.head(iper+1);
+            chk.t_period     = t_period;
+            chk.T_period     = T_period;
+            chk.t_rise       = _t_rise;
+            chk.T_rise       = _T_rise;
+            chk.t_fall       = _t_fall;
+            chk.T_fall       = _T_fall;
+            checkpoint_writer.write(chk);
+        }
     }// end period loop
 
+    checkpoint_writer.wait();
+
+    if(n_per_run < _n_rep)
+    {
+        if(opt.get_verbose())
+            printf("Reached periodic steady state after %zu periods.\n", n_per_run);
+
+        t.resize(nt_per*n_per_run);
+        T_avg.resize(nt_per*n_per_run);
+        t_mid.resize(n_per_run);
+        T_mid.resize(n_per_run);
+        t_max.resize(n_per_run);
+        T_max.resize(n_per_run);
+        t_min.resize(n_per_run);
+        T_min.resize(n_per_run);
+    }
+    else if(periodic_tol > 0.0)
+        std::cerr << "Warning: periodic steady state was not reached within "
+                  << _n_rep << " periods." << std::endl;
+
+    if(opt.get_verbose())
+    {
+        const size_t n_steps = (adaptive_tol > 0.0) ? n_adapt : nt_per*n_per_run;
+        printf("Crank-Nicolson matrices were built %zu times in %zu steps.\n",
+               stepper.get_n_build(), n_steps);
+    }
+
     write_table("T_t.dat",    arma::vec(1e6*t), T_avg);
     write_table("T-mid_t.dat",arma::vec(1e6*t_mid), T_mid);
     write_table("Tmax_t.dat", arma::vec(1e6*t_max), T_max);
@@ -488,108 +819,511 @@ int main(int argc, char *argv[])
     return EXIT_SUCCESS;
 }
 
-// Calculate the spatial temperature profile across the device at the
-// next time step in the sequence.
-static arma::vec calctemp(double dt,
-                          arma::vec  &Told,
-                          arma::vec  const &q_old,
-                          arma::vec  const &q_new,
-                          arma::uvec const &iLayer,
-                          const std::vector<Material> &mat_layer,
-                          const arma::vec &x,
-                          const std::vector<DebyeModel> &dm_layer,
-                          const arma::vec &rho_layer,
-                          Thermal1DOptions& opt)
+/**
+ * \brief Set up the time-stepping scheme
+ *
+ * \param[in] dy        Spatial step [m]
+ * \param[in] tol       Largest temperature drift [K] before the matrices are rebuilt.
+ *                      If this is zero, they are rebuilt at every step.
+ * \param[in] iLayer    Index of layer containing each point
+ * \param[in] k_layer   Thermal conductivity in each layer
+ * \param[in] dm_layer  Heat capacity model in each layer
+ * \param[in] rho_layer Density of each layer [kg/m^3]
+ */
+CrankNicolsonStepper::CrankNicolsonStepper(const double                            dy,
+                                           const double                            tol,
+                                           const arma::uvec                       &iLayer,
+                                           const std::vector<ThermalConductivity> &k_layer,
+                                           const std::vector<DebyeModel>          &dm_layer,
+                                           const arma::vec                        &rho_layer) :
+    _dy(dy),
+    _tol(tol),
+    _iLayer(iLayer),
+    _k_layer(k_layer),
+    _dm_layer(dm_layer),
+    _rho_layer(rho_layer),
+    _n_build(0),
+    _dt(0.0),
+    _q()
+{}
+
+/**
+ * \brief Find the material coefficients of the Crank-Nicolson scheme
+ *
+ * \param[in] T Temperature profile at which material properties are found [K]
+ */
+void CrankNicolsonStepper::build(const arma::vec &T)
 {
-    const auto ny = iLayer.size();
-    const auto dy = opt.get_option<double>("dy");
-    const auto dy_sq = dy*dy;
+    const auto ny = _iLayer.size();
+    const auto dy_sq = _dy*_dy;
 
     // Note that the bottom of the device is not calculated.  We leave it
     // set to the heatsink temperature (Dirichlet boundary)
-    arma::vec LHS_diag      = arma::ones(ny);
-    arma::vec LHS_subdiag   = arma::zeros(ny-1);
-    arma::vec LHS_superdiag = arma::zeros(ny-1);
-
-    // Material parameter matrix for RHS of Crank-Nicolson solver
-    arma::vec B_diag      = arma::ones(ny);
-    arma::vec B_superdiag = arma::zeros(ny-1);
-    arma::vec B_subdiag   = arma::zeros(ny-1);
+    _c_sub   = arma::zeros(ny-1);
+    _c_super = arma::zeros(ny-1);
+    _s       = arma::zeros(ny);
 
     // Indices of layers containing the current, previous and next points
-    auto iL_prev = iLayer(0);
-    auto iL_this = iLayer(1);
-    auto iL_next = iLayer(2);
+    auto iL_prev = _iLayer(0);
+    auto iL_this = _iLayer(1);
+    auto iL_next = _iLayer(2);
 
-    double k_prev = thermal_cond(mat_layer[iL_prev], x(iL_prev), Told(0));
-    double k_this = thermal_cond(mat_layer[iL_this], x(iL_this), Told(1));
-    double k_next = thermal_cond(mat_layer[iL_next], x(iL_next), Told(2));
+    double k_prev = _k_layer[iL_prev].get_k_tabulated(T(0));
+    double k_this = _k_layer[iL_this].get_k_tabulated(T(1));
+    double k_next = _k_layer[iL_next].get_k_tabulated(T(2));
 
     double rho_cp = 0;
 
-    arma::vec q = arma::zeros(ny); // heating vector for RHS of Crank-Nicolson solver
-
     for(unsigned int iy=1; iy<ny-1; iy++)
     {
-        iL_this = iLayer(iy); // Update the current layer index
-        iL_next = iLayer(iy+1);
+        iL_this = _iLayer(iy); // Update the current layer index
+        iL_next = _iLayer(iy+1);
 
         // Product of density and spec. heat cap [J/(m^3.K)]
-        const auto _cp = dm_layer[iL_this].get_cp(Told(iy));
-        rho_cp = rho_layer(iL_this) * _cp;
+        const auto _cp = _dm_layer[iL_this].get_cp_tabulated(T(iy));
+        rho_cp = _rho_layer(iL_this) * _cp;
 
         // Find interface values of the thermal conductivity using
         // Eq. 3.25 in Craig's thesis.
         const auto kn=(2*k_this*k_next)/(k_this+k_next);
         const auto ks=(2*k_this*k_prev)/(k_this+k_prev);
-        const auto r = dt/(2.0*rho_cp);
-        const auto alpha = r*ks/dy_sq;
-        const auto gamma = r*kn/dy_sq;
-
-        B_subdiag(iy-1) = alpha;
-        B_superdiag(iy) = gamma;
-        B_diag(iy)      = 1.0 - (alpha+gamma);
+        const auto s = 1.0/(2.0*rho_cp);
 
-        LHS_subdiag(iy-1) = -alpha;
-        LHS_superdiag(iy) = -gamma;
-        LHS_diag(iy)      = 1.0 + (alpha+gamma);
-
-        q(iy) = r*(q_old(iy)+q_new(iy));
+        _c_sub(iy-1) = s*ks/dy_sq;
+        _c_super(iy) = s*kn/dy_sq;
+        _s(iy)       = s;
 
         k_prev = k_this;
         k_this = k_next;
-        k_next = thermal_cond(mat_layer[iL_next], x(iL_next), Told(iy+1));
+        k_next = _k_layer[iL_next].get_k_tabulated(T(iy+1));
     }
 
     // At last point, use Neumann boundary, i.e. dT/dy=0, which gives
     // T[n] = T[n-2] in the finite-difference approximation
     double kns=(2*k_next*k_this)/(k_next+k_this);
-    const double rho = rho_layer(iLayer(ny-1));
-    rho_cp = rho * dm_layer[iLayer(ny-1)].get_cp(Told(ny-1));
-    double r = dt/(2.0*rho_cp);
-    double alpha_gamma = r*kns/dy_sq;
-    B_subdiag(ny-2) = 2.0*alpha_gamma;
-    B_diag(ny-1)    = 1.0 - 2.0*alpha_gamma;
+    const double rho = _rho_layer(_iLayer(ny-1));
+    rho_cp = rho * _dm_layer[_iLayer(ny-1)].get_cp_tabulated(T(ny-1));
+    const double s = 1.0/(2.0*rho_cp);
+    _c_sub(ny-2) = 2.0*s*kns/dy_sq;
+    _s(ny-1)     = s;
+
+    _T_ref = T;
+    ++_n_build;
+    _dt = 0.0; // Force the matrices to be rebuilt
+}
+
+/**
+ * \brief Build the Crank-Nicolson matrices for a time step and factorise the LHS
+ *
+ * \param[in] dt Time step [s]
+ */
+void CrankNicolsonStepper::set_dt(const double dt)
+{
+    const auto ny = _s.size();
+
+    _B_sub   = dt*_c_sub;
+    _B_super = dt*_c_super;
+    _B_diag  = arma::ones(ny);
+
+    for(unsigned int iy=1; iy<ny-1; iy++)
+        _B_diag(iy) = 1.0 - (_B_sub(iy-1) + _B_super(iy));
+
+    _B_diag(ny-1) = 1.0 - _B_sub(ny-2);
+
+    // The LHS has the same couplings as the RHS, but with the opposite sign
+    const arma::vec LHS_diag = 2.0 - _B_diag;
+    _LHS.factorise(arma::vec(-_B_sub), LHS_diag, arma::vec(-_B_super));
+    _dt = dt;
+}
 
-    LHS_subdiag(ny-2) = -2.0*alpha_gamma;
-    LHS_diag(ny-1) = 1.0 + 2.0*alpha_gamma;
+/**
+ * \brief Calculate the spatial temperature profile across the device at the
+ *        next time step in the sequence.
+ *
+ * \param[in] Told  Temperature profile at the last time step [K]
+ * \param[in] q_old Power density at the last time step [W/m^3]
+ * \param[in] q_new Power density at this time step [W/m^3]
+ * \param[in] dt    Time step [s]
+ *
+ * \returns The temperature profile at this time step [K]
+ */
+arma::vec CrankNicolsonStepper::step(const arma::vec &Told,
+                                     const arma::vec &q_old,
+                                     const arma::vec &q_new,
+                                     const double     dt)
+{
+    if(_n_build == 0 || _tol <= 0.0 || arma::abs(Told - _T_ref).max() > _tol)
+        build(Told);
+
+    if(dt != _dt)
+        set_dt(dt);
 
-    q(ny-1) = r*(q_old(ny-1)+q_new(ny-1));
+    // heating vector for RHS of Crank-Nicolson solver.  This is kept between
+    // steps so that its storage is reused
+    _q = dt*_s % (q_old + q_new);
 
     // Perform matrix multiplication to get the RHS vector of the
     // Crank-Nicolson solver
-    auto RHS = multiply_vec_tridiag(B_subdiag,
-                                    B_diag,
-                                    B_superdiag,
-                                    Told,
-                                    q);
-
-    auto T = solve_tridiag(LHS_subdiag,
-                           LHS_diag,
-                           LHS_superdiag,
-                           RHS);
-
-    return T;
+    arma::vec RHS(Told.size());
+    multiply_vec_tridiag(_B_sub,
+                         _B_diag,
+                         _B_super,
+                         Told,
+                         _q,
+                         RHS);
+
+    // Solve the Crank-Nicolson system directly in the RHS storage
+    _LHS.solve_in_place(RHS);
+
+    return RHS;
+}
+
+/**
+ * \brief Take one time step with error control
+ *
+ * \param[in,out] stepper     The Crank-Nicolson scheme
+ * \param[in,out] T           Temperature profile [K], which is advanced by one step
+ * \param[in,out] t           Time [s], which is advanced by one step
+ * \param[in,out] h           Trial step length [s], which is updated for the next step
+ * \param[in]     tol         Largest local error in temperature [K]
+ * \param[in]     g           Power density profile during the pulse [W/m^3]
+ * \param[in]     time_period Length of a pulse period [s]
+ * \param[in]     pw          Pulse width [s]
+ *
+ * \details The error is estimated by step doubling: the step is taken once at
+ *          full length and again as two half steps.  Crank-Nicolson is second-order
+ *          accurate, so the local error scales as the cube of the step length.
+ *          Steps are shortened so that they never cross the edge of a pulse, which
+ *          means that the heating is constant across every step.
+ */
+static void take_adaptive_step(CrankNicolsonStepper &stepper,
+                               arma::vec            &T,
+                               double               &t,
+                               double               &h,
+                               const double          tol,
+                               const arma::vec      &g,
+                               const double          time_period,
+                               const double          pw)
+{
+    // Find the next pulse edge
+    const double eps     = 1e-12*time_period;
+    const double t_start = floor((t + eps)/time_period)*time_period;
+    const double t_edge  = (t + eps < t_start + pw) ? t_start + pw : t_start + time_period;
+
+    const double h_min = 1e-9*time_period; // Accept steps this short without checking the error
+    const arma::vec q_off = arma::zeros(T.size());
+
+    for(;;)
+    {
+        const double h_try = std::min(h, t_edge - t);
+        const bool   on    = fmod(t + h_try/2.0, time_period) <= pw;
+        const auto  &q     = on ? g : q_off;
+
+        const arma::vec T_full = stepper.step(T,      q, q, h_try);
+        const arma::vec T_half = stepper.step(T,      q, q, h_try/2.0);
+        const arma::vec T_two  = stepper.step(T_half, q, q, h_try/2.0);
+
+        const double err = arma::abs(T_two - T_full).max();
+
+        // Scale the step towards the error tolerance, but do not change it too quickly
+        double factor = (err > 0.0) ? 0.9*cbrt(tol/err) : 2.0;
+        factor = std::min(2.0, std::max(0.2, factor));
+
+        if(err <= tol or h_try <= h_min)
+        {
+            T  = T_two;
+            t += h_try;
+            h  = h_try*factor;
+            return;
+        }
+
+        h = h_try*factor;
+    }
+}
+
+/// Identifier at the start of a checkpoint file
+static const char checkpoint_magic[8] = {'Q','W','W','A','D','T','H','C'};
+
+/// Version number of the checkpoint file format
+static const uint32_t checkpoint_version = 1;
+
+/**
+ * \brief Convert the checkpoint to its binary file format
+ */
+std::string ThermalCheckpoint::serialise() const
+{
+    std::string buffer = start_checkpoint(checkpoint_magic, checkpoint_version);
+    append_checkpoint_value(buffer, n_per_done);
+    append_checkpoint_value(buffer, nt_per);
+    append_checkpoint_value(buffer, t_adapt);
+    append_checkpoint_value(buffer, t_adapt_prev);
+    append_checkpoint_value(buffer, h_adapt);
+    append_checkpoint_value(buffer, n_adapt);
+
+    for(auto const *v : {&Told, &T, &T_adapt, &T_adapt_prev, &T_y_max,
+                         &t, &T_avg, &t_mid, &T_mid, &t_max, &T_max, &t_min, &T_min,
+                         &t_period, &T_period})
+        append_checkpoint_table(buffer, v->memptr(), v->size());
+
+    for(auto const *v : {&t_rise, &T_rise, &t_fall, &T_fall})
+        append_checkpoint_table(buffer, v->data(), v->size());
+
+    return buffer;
+}
+
+/**
+ * \brief Read a checkpoint file
+ *
+ * \param[in] filename The name of the file
+ */
+ThermalCheckpoint ThermalCheckpoint::read(const std::string &filename)
+{
+    std::ifstream stream(filename.c_str(), std::ios::binary);
+    check_checkpoint_header(stream, filename, checkpoint_magic, checkpoint_version, "a thermal");
+
+    ThermalCheckpoint chk;
+    chk.n_per_done   = read_checkpoint_value<uint64_t>(stream);
+    chk.nt_per       = read_checkpoint_value<uint64_t>(stream);
+    chk.t_adapt      = read_checkpoint_value<double>(stream);
+    chk.t_adapt_prev = read_checkpoint_value<double>(stream);
+    chk.h_adapt      = read_checkpoint_value<double>(stream);
+    chk.n_adapt      = read_checkpoint_value<uint64_t>(stream);
+
+    for(auto *v : {&chk.Told, &chk.T, &chk.T_adapt, &chk.T_adapt_prev, &chk.T_y_max,
+                   &chk.t, &chk.T_avg, &chk.t_mid, &chk.T_mid, &chk.t_max, &chk.T_max,
+                   &chk.t_min, &chk.T_min, &chk.t_period, &chk.T_period})
+        *v = arma::vec(read_checkpoint_table(stream));
+
+    for(auto *v : {&chk.t_rise, &chk.T_rise, &chk.t_fall, &chk.T_fall})
+        *v = read_checkpoint_table(stream);
+
+    // Check that the file is complete, and that the tables cover every completed period
+    if(!stream or chk.t.size() != chk.n_per_done*chk.nt_per or chk.T_avg.size() != chk.t.size()
+       or chk.T_max.size() != chk.n_per_done)
+    {
+        std::ostringstream oss;
+        oss << "Checkpoint file " << filename << " is incomplete";
+        throw std::runtime_error(oss.str());
+    }
+
+    return chk;
+}
+
+/**
+ * \brief Start writing a checkpoint in the background
+ *
+ * \param[in] checkpoint The state of the simulation
+ *
+ * \details The checkpoint is copied into a memory buffer first, so the caller
+ *          can carry on changing its own data straight away.
+ */
+void ThermalCheckpointWriter::write(const ThermalCheckpoint &checkpoint)
+{
+    std::string buffer = checkpoint.serialise();
+    wait();
+    _thread = std::thread(&ThermalCheckpointWriter::write_file, _filename, std::move(buffer));
+}
+
+/**
+ * \brief Write a buffer to the checkpoint file
+ *
+ * \details This runs in a background thread, so failures are reported but do not
+ *          stop the simulation.
+ */
+void ThermalCheckpointWriter::write_file(const std::string filename,
+                                         const std::string buffer)
+{
+    if(!write_checkpoint_file(filename, buffer))
+        std::cerr << "Warning: could not write checkpoint to " << filename << std::endl;
+}
+
+/**
+ * \brief Simulate pulse trains for a table of operating conditions
+ *
+ * \param[in] opt       User options
+ * \param[in] y         Spatial coordinates [m]
+ * \param[in] g_unit    Power density profile for 1 W of electrical power [1/m^3]
+ * \param[in] dy        Spatial step [m]
+ * \param[in] iLayer    Index of layer containing each point
+ * \param[in] k_layer   Thermal conductivity in each layer
+ * \param[in] dm_layer  Heat capacity model in each layer
+ * \param[in] rho_layer Density of each layer [kg/m^3]
+ *
+ * \returns The exit status of the program
+ *
+ * \details The structure and material models are shared by all the conditions,
+ *          but each has its own Crank-Nicolson scheme, since the coefficients
+ *          depend on its temperature profile.  Each period is divided into the
+ *          same number of time steps for every condition, and the conditions
+ *          are advanced together one period at a time, shared between
+ *          threads.  A condition drops out of the batch once it has reached its
+ *          periodic steady state.
+ *
+ *          The outputs are the same as for a single condition, with the index
+ *          of the condition added to the name of each file.  A summary of the
+ *          final period of every condition is written to Tmax_conditions.dat.
+ */
+static int run_conditions(const Thermal1DOptions                 &opt,
+                          const arma::vec                        &y,
+                          const arma::vec                        &g_unit,
+                          const double                            dy,
+                          const arma::uvec                       &iLayer,
+                          const std::vector<ThermalConductivity> &k_layer,
+                          const std::vector<DebyeModel>          &dm_layer,
+                          const arma::vec                        &rho_layer)
+{
+    if(opt.get_option<double>("adaptive-tol") > 0.0 or opt.get_option<bool>("restart")
+       or opt.get_option<size_t>("checkpoint-interval") > 0)
+    {
+        std::cerr << "Adaptive time steps and checkpoints cannot be used with --conditions." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<double> power; // Power in each condition [W]
+    std::vector<double> dc;    // Duty cycle in each condition [%]
+    std::vector<double> f_rep; // Pulse repetition rate in each condition [kHz]
+    const auto fname = opt.get_option<std::string>("conditions");
+    read_table(fname.c_str(), power, dc, f_rep);
+
+    const size_t n_cond = power.size();
+
+    if(n_cond == 0)
+    {
+        std::cerr << "Could not read any conditions from " << fname << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    for(unsigned int ic = 0; ic < n_cond; ++ic)
+    {
+        if(power[ic] <= 0.0 or dc[ic] <= 0.0 or dc[ic] >= 100.0 or f_rep[ic] <= 0.0)
+        {
+            std::cerr << "Condition " << ic << " in " << fname << " is invalid." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    const auto   ny           = y.size();
+    const auto   Tsink        = opt.get_option<double>("Tsink");
+    const auto   n_rep        = opt.get_option<size_t>("nrep");
+    const auto   periodic_tol = opt.get_option<double>("periodic-tol");
+    const size_t nt_per       = 1000; // Number of time steps in each period, as for a single condition
+
+    // State of each condition
+    std::vector<CrankNicolsonStepper> stepper;
+    std::vector<AndersonMixer>        mixer;
+    std::vector<arma::vec>            T(n_cond, arma::vec(ny));
+    std::vector<arma::vec>            T_y_max(n_cond, arma::vec(ny));
+    std::vector<arma::vec>            t(n_cond, arma::zeros(nt_per*n_rep));
+    std::vector<arma::vec>            T_avg(n_cond, arma::zeros(nt_per*n_rep));
+    std::vector<arma::vec>            t_max(n_cond, arma::zeros(n_rep));
+    std::vector<arma::vec>            T_max(n_cond, arma::zeros(n_rep));
+    std::vector<arma::vec>            T_min(n_cond, arma::zeros(n_rep));
+    std::vector<arma::vec>            t_period(n_cond, arma::zeros(nt_per));
+    std::vector<arma::vec>            T_period(n_cond, arma::zeros(nt_per));
+    std::vector<size_t>               n_per_run(n_cond, n_rep);
+
+    for(unsigned int ic = 0; ic < n_cond; ++ic)
+    {
+        stepper.push_back(CrankNicolsonStepper(dy, opt.get_option<double>("refactor-dT"),
+                                               iLayer, k_layer, dm_layer, rho_layer));
+        mixer.push_back(AndersonMixer(opt.get_option<size_t>("mixingdepth")));
+        T[ic].fill(Tsink);
+    }
+
+    for(unsigned int iper = 0; iper < n_rep; iper++)
+    {
+        std::vector<arma::vec> T_start(T);
+
+        run_in_parallel(n_cond, 0, [&](const size_t ic) {
+            if(n_per_run[ic] <= iper)
+                return;
+
+            const double    time_period = 1.0/(f_rep[ic]*1e3);
+            const double    dt          = time_period/nt_per;
+            const double    pw          = dc[ic]*0.01*time_period;
+            const arma::vec g           = power[ic]*g_unit;
+            const arma::vec q_off       = arma::zeros(ny);
+
+            T_max[ic](iper) = 0.0;
+            T_min[ic](iper) = 1e9;
+
+            for(unsigned int it = 0; it < nt_per; it++)
+            {
+                const unsigned int it_total = it + nt_per*iper;
+                t[ic](it_total) = time_period*iper + dt*it;
+
+                const arma::vec &q_now = (dt*it <= pw) ? g : q_off;
+                const arma::vec &q_old = (it > 0 and dt*(it-1) <= pw) ? g : q_off;
+
+                T[ic] = stepper[ic].step(T[ic], q_old, q_now, dt);
+                T_avg[ic](it_total) = calctave(g, T[ic]);
+
+                if(T_avg[ic](it_total) > T_max[ic](iper))
+                {
+                    T_max[ic](iper) = T_avg[ic](it_total);
+                    t_max[ic](iper) = t[ic](it_total);
+                    T_y_max[ic]     = T[ic];
+                }
+
+                T_min[ic](iper) = std::min(T_min[ic](iper), T_avg[ic](it_total));
+
+                t_period[ic](it) = t[ic](it_total)*1e6;
+                T_period[ic](it) = T_avg[ic](it_total);
+            }
+        });
+
+        for(unsigned int ic = 0; ic < n_cond; ++ic)
+        {
+            if(n_per_run[ic] <= iper)
+                continue;
+
+            if(opt.get_verbose())
+            {
+                printf("Condition=%u Period=%u Tmax= %.4f K at t=%.2f microseconds\n",
+                       ic, iper+1, T_max[ic](iper), t_max[ic](iper)*1e6);
+            }
+
+            if(periodic_tol > 0.0)
+            {
+                const double change = arma::abs(T[ic] - T_start[ic]).max();
+
+                if(change < periodic_tol)
+                    n_per_run[ic] = iper+1;
+                else
+                    T[ic] = mixer[ic].mix(T_start[ic], T[ic]); // Accelerate towards steady state
+            }
+        }
+    }
+
+    TableWriter summary("Tmax_conditions.dat");
+
+    for(unsigned int ic = 0; ic < n_cond; ++ic)
+    {
+        const size_t n_per = n_per_run[ic];
+
+        if(n_per == n_rep and periodic_tol > 0.0)
+            std::cerr << "Warning: periodic steady state was not reached within "
+                      << n_rep << " periods for condition " << ic << "." << std::endl;
+
+        t[ic].resize(nt_per*n_per);
+        T_avg[ic].resize(nt_per*n_per);
+        t_max[ic].resize(n_per);
+        T_max[ic].resize(n_per);
+
+        std::ostringstream suffix;
+        suffix << "-" << ic << ".dat";
+
+        write_table("T_t"        + suffix.str(), arma::vec(1e6*t[ic]), T_avg[ic]);
+        write_table("Tmax_t"     + suffix.str(), arma::vec(1e6*t_max[ic]), T_max[ic]);
+        write_table("T-period_t" + suffix.str(), t_period[ic], T_period[ic]);
+        write_table("T_y"        + suffix.str(), y, T[ic]);
+        write_table("T_y_max"    + suffix.str(), y, T_y_max[ic]);
+
+        summary << power[ic] << '\t' << dc[ic] << '\t' << f_rep[ic] << '\t'
+                << T_max[ic](n_per-1) << '\t' << T_min[ic](n_per-1) << '\t' << n_per << '\n';
+    }
+
+    return EXIT_SUCCESS;
 }
 
 /**
@@ -0,0 +1,654 @@
+/**
+ * \file   qwwad_thermal_2d.cpp
+ * \brief  Temperature over the cross-section of a laser ridge, during a pulse train
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ *
+ * \details The layers are read from the same file as qwwad_thermal_1d, starting
+ *          from the heat sink.  Layers from the first ridge layer upwards are
+ *          etched to the width of the ridge, and the layers below span the whole
+ *          of the simulated width.  Only half of the cross-section is simulated,
+ *          since it is symmetric about the centre of the ridge.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "qwwad/anderson-mixer.h"
+#include "qwwad/debye.h"
+#include "qwwad/file-io.h"
+#include "qwwad/material.h"
+#include "qwwad/material-library.h"
+#include "qwwad/material-property-numeric.h"
+#include "qwwad/options.h"
+#include "qwwad/parallel.h"
+#include "qwwad/thermal-conductivity.h"
+
+using namespace QWWAD;
+
+/**
+ * \brief Configure command-line options for the program
+ */
+static Options configure_options(int argc, char* argv[])
+{
+    Options opt;
+
+    std::string doc("Calculate the temperature over the cross-section of a laser ridge during a "
+                    "pulse train.");
+
+    opt.add_option<size_t>      ("active,a",                   2, "Index of active-region layer");
+    opt.add_option<size_t>      ("ridgelayer",                 2, "Index of the lowest layer that is etched "
+                                                                  "to the width of the ridge");
+    opt.add_option<double>      ("area",                   0.119, "QCL ridge area [mm^2]");
+    opt.add_option<double>      ("ridgewidth",               150, "Width of the ridge [micron]");
+    opt.add_option<double>      ("width",                    600, "Total width of the simulated cross-section "
+                                                                  "[micron]");
+    opt.add_option<std::string> ("infile",  "thermal_layers.dat", "Waveguide layers data file");
+    opt.add_option<double>      ("Tsink,T",                 80.0, "Heatsink temperature [K]");
+    opt.add_option<double>      ("dy,y",                 1.00e-7, "Spatial resolution in growth direction [m]");
+    opt.add_option<double>      ("dx,x",                 1.00e-6, "Spatial resolution across the ridge [m]");
+    opt.add_option<double>      ("dc,d",                       2, "Duty cycle for pulse train [%]");
+    opt.add_option<double>      ("frequency,f",               10, "Pulse repetition rate [kHz]");
+    opt.add_option<double>      ("power,P",                17.65, "Pulse power [W]");
+    opt.add_option<size_t>      ("nrep",                       1, "Number of pulse periods to simulate "
+                                                                  "(maximum number if --periodic-tol is set)");
+    opt.add_option<double>      ("refactor-dT",              0.0, "Temperature drift [K] before the material "
+                                                                  "coefficients are found again (0 = every step)");
+    opt.add_option<double>      ("periodic-tol",             0.0, "Stop once the temperature changes by less than "
+                                                                  "this over a period [K] (0 = run all periods)");
+    opt.add_option<size_t>      ("mixingdepth",                5, "Number of previous periods used in Anderson "
+                                                                  "acceleration of the periodic steady state");
+    opt.add_option<unsigned int>("threads",                    0, "Number of threads to use (0 = one per CPU core).");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, doc);
+
+    return opt;
+}
+
+/**
+ * \brief Alternating-direction implicit scheme for the heat equation over a cross-section
+ *
+ * \details Each time step is split into two halves.  In the first, the heat flow
+ *          across the ridge (x) is implicit and the flow in the growth direction
+ *          (y) is explicit, and in the second the roles are swapped
+ *          (Peaceman-Rachford).  Each half-step is then a set of independent
+ *          tridiagonal equations, one along each line of the mesh, which are
+ *          shared between threads.  The scheme is second-order accurate and
+ *          unconditionally stable, like the Crank-Nicolson scheme in
+ *          qwwad_thermal_1d.
+ *
+ *          Points are indexed with x running fastest, i.e., p = iy*nx + ix.
+ *          The conductivity between neighbouring points is their harmonic mean.
+ *          The points in the bottom row are held at the heat-sink temperature,
+ *          and no heat flows through the other edges or into the etched
+ *          regions beside the ridge.  The points in the etched regions keep
+ *          their temperature.
+ *
+ *          The coefficients depend on the temperature, through the
+ *          conductivity and heat capacity.  If a tolerance is set, they are kept
+ *          until the temperature anywhere has drifted by more than the
+ *          tolerance since they were last found.
+ */
+class ADIStepper
+{
+private:
+    size_t       _nx;        ///< Number of points across the ridge
+    size_t       _ny;        ///< Number of points in the growth direction
+    double       _dx;        ///< Spatial step across the ridge [m]
+    double       _dy;        ///< Spatial step in the growth direction [m]
+    double       _tol;       ///< Temperature drift before the coefficients are found again [K]
+    unsigned int _n_threads; ///< Number of threads to use
+
+    std::vector<int>                 const &_iLayer;    ///< Layer at each point (-1 if etched)
+    std::vector<ThermalConductivity> const &_k_layer;   ///< Thermal conductivity in each layer
+    std::vector<DebyeModel>          const &_dm_layer;  ///< Heat capacity model in each layer
+    arma::vec                        const &_rho_layer; ///< Density of each layer [kg/m^3]
+
+    arma::vec _w_x;     ///< Coupling between points p and p+1, per unit time [1/s]
+    arma::vec _w_x_rev; ///< Coupling between points p+1 and p, per unit time [1/s]
+    arma::vec _w_y;     ///< Coupling between points p and p+nx, per unit time [1/s]
+    arma::vec _w_y_rev; ///< Coupling between points p+nx and p, per unit time [1/s]
+    arma::vec _s;       ///< Heating coefficient per unit time [m^3.K/J]
+    arma::vec _T_ref;   ///< Temperature at which the coefficients were found [K]
+    size_t    _n_build; ///< Number of times the coefficients have been found
+
+    /// Return true if a point has a fixed temperature
+    bool is_fixed(const size_t p) const {return p < _nx || _iLayer[p] < 0;}
+
+    void build(const arma::vec &T);
+    void solve_line(const arma::vec &T_explicit,
+                    const arma::vec &q,
+                    const double     dt,
+                    const size_t     first,
+                    const size_t     stride,
+                    const size_t     n,
+                    const bool       x_implicit,
+                    arma::vec       &T_new) const;
+
+public:
+    ADIStepper(const size_t                            nx,
+               const size_t                            ny,
+               const double                            dx,
+               const double                            dy,
+               const double                            tol,
+               const unsigned int                      n_threads,
+               const std::vector<int>                 &iLayer,
+               const std::vector<ThermalConductivity> &k_layer,
+               const std::vector<DebyeModel>          &dm_layer,
+               const arma::vec                        &rho_layer);
+
+    arma::vec step(const arma::vec &T_old,
+                   const arma::vec &q_old,
+                   const arma::vec &q_new,
+                   const double     dt);
+
+    /// Return the number of times that the material coefficients have been found
+    size_t get_n_build() const {return _n_build;}
+};
+
+/**
+ * \brief Set up the time-stepping scheme
+ *
+ * \param[in] nx        Number of points across the ridge
+ * \param[in] ny        Number of points in the growth direction
+ * \param[in] dx        Spatial step across the ridge [m]
+ * \param[in] dy        Spatial step in the growth direction [m]
+ * \param[in] tol       Largest temperature drift [K] before the coefficients are
+ *                      found again.  If this is zero, they are found at every step.
+ * \param[in] n_threads Number of threads to use (0 = one per CPU core)
+ * \param[in] iLayer    Index of layer containing each point (-1 if etched)
+ * \param[in] k_layer   Thermal conductivity in each layer
+ * \param[in] dm_layer  Heat capacity model in each layer
+ * \param[in] rho_layer Density of each layer [kg/m^3]
+ */
+ADIStepper::ADIStepper(const size_t                            nx,
+                       const size_t                            ny,
+                       const double                            dx,
+                       const double                            dy,
+                       const double                            tol,
+                       const unsigned int                      n_threads,
+                       const std::vector<int>                 &iLayer,
+                       const std::vector<ThermalConductivity> &k_layer,
+                       const std::vector<DebyeModel>          &dm_layer,
+                       const arma::vec                        &rho_layer) :
+    _nx(nx),
+    _ny(ny),
+    _dx(dx),
+    _dy(dy),
+    _tol(tol),
+    _n_threads(n_threads),
+    _iLayer(iLayer),
+    _k_layer(k_layer),
+    _dm_layer(dm_layer),
+    _rho_layer(rho_layer),
+    _n_build(0)
+{}
+
+/**
+ * \brief Find the coefficients of the scheme
+ *
+ * \param[in] T Temperature at which material properties are found [K]
+ */
+void ADIStepper::build(const arma::vec &T)
+{
+    const size_t n = _nx*_ny;
+
+    arma::vec k = arma::zeros(n); // Conductivity at each point [W/m/K]
+    _s       = arma::zeros(n);
+    _w_x     = arma::zeros(n);
+    _w_x_rev = arma::zeros(n);
+    _w_y     = arma::zeros(n);
+    _w_y_rev = arma::zeros(n);
+
+    // Find the conductivity and heat capacity at each point
+    run_in_parallel(_ny, _n_threads, [&](const size_t iy) {
+        for(size_t p = iy*_nx; p < (iy+1)*_nx; ++p)
+        {
+            const int iL = _iLayer[p];
+
+            if(iL >= 0)
+            {
+                k(p)  = _k_layer[iL].get_k_tabulated(T(p));
+                _s(p) = 1.0/(_rho_layer(iL) * _dm_layer[iL].get_cp_tabulated(T(p)));
+            }
+        }
+    });
+
+    // Couplings through each face.  The harmonic mean vanishes next to an
+    // etched point, so no heat flows into it.
+    run_in_parallel(_ny, _n_threads, [&](const size_t iy) {
+        for(size_t p = iy*_nx; p < (iy+1)*_nx; ++p)
+        {
+            if(p+1 < (iy+1)*_nx && k(p) + k(p+1) > 0)
+            {
+                const double k_face = 2*k(p)*k(p+1)/(k(p) + k(p+1));
+                _w_x(p)     = _s(p)   * k_face/(_dx*_dx);
+                _w_x_rev(p) = _s(p+1) * k_face/(_dx*_dx);
+            }
+
+            if(iy+1 < _ny && k(p) + k(p+_nx) > 0)
+            {
+                const double k_face = 2*k(p)*k(p+_nx)/(k(p) + k(p+_nx));
+                _w_y(p)     = _s(p)     * k_face/(_dy*_dy);
+                _w_y_rev(p) = _s(p+_nx) * k_face/(_dy*_dy);
+            }
+        }
+    });
+
+    _T_ref = T;
+    ++_n_build;
+}
+
+/**
+ * \brief Solve the tridiagonal equations along one line of the mesh
+ *
+ * \param[in]  T_explicit Temperature used for the explicit direction [K]
+ * \param[in]  q          Mean power density over the half-step [W/m^3]
+ * \param[in]  dt         Length of the whole time step [s]
+ * \param[in]  first      Index of the first point on the line
+ * \param[in]  stride     Distance between neighbouring points on the line
+ * \param[in]  n          Number of points on the line
+ * \param[in]  x_implicit True if the line runs across the ridge
+ * \param[out] T_new      Temperature at the end of the half-step [K].  Only the
+ *                        points on the line are written.
+ */
+void ADIStepper::solve_line(const arma::vec &T_explicit,
+                            const arma::vec &q,
+                            const double     dt,
+                            const size_t     first,
+                            const size_t     stride,
+                            const size_t     n,
+                            const bool       x_implicit,
+                            arma::vec       &T_new) const
+{
+    const double h = dt/2;
+
+    // Couplings in the implicit and explicit directions
+    const arma::vec &w_i     = x_implicit ? _w_x     : _w_y;
+    const arma::vec &w_i_rev = x_implicit ? _w_x_rev : _w_y_rev;
+    const arma::vec &w_e     = x_implicit ? _w_y     : _w_x;
+    const arma::vec &w_e_rev = x_implicit ? _w_y_rev : _w_x_rev;
+    const size_t     stride_e = x_implicit ? _nx : 1;
+
+    std::vector<double> c(n); // Modified superdiagonal
+    std::vector<double> d(n); // Modified right-hand side
+
+    // Forward sweep of the Thomas algorithm.  The matrix is diagonally dominant,
+    // so no pivoting is needed.
+    for(size_t i = 0; i < n; ++i)
+    {
+        const size_t p = first + i*stride;
+
+        double a   = 0.0; // Subdiagonal
+        double b   = 1.0; // Diagonal
+        double c_i = 0.0; // Superdiagonal
+        double rhs = T_explicit(p);
+
+        if(!is_fixed(p))
+        {
+            // Implicit direction
+            if(i > 0)   {a   = -h*w_i_rev(p-stride); b += h*w_i_rev(p-stride);}
+            if(i+1 < n) {c_i = -h*w_i(p);            b += h*w_i(p);}
+
+            // Explicit direction
+            const bool has_prev = x_implicit ? (p >= _nx)          : (p % _nx > 0);
+            const bool has_next = x_implicit ? (p + _nx < _nx*_ny) : ((p+1) % _nx > 0);
+
+            if(has_prev) rhs += h*w_e_rev(p-stride_e)*(T_explicit(p-stride_e) - T_explicit(p));
+            if(has_next) rhs += h*w_e(p)*(T_explicit(p+stride_e) - T_explicit(p));
+
+            rhs += h*_s(p)*q(p);
+        }
+
+        if(i == 0)
+        {
+            c[i] = c_i/b;
+            d[i] = rhs/b;
+        }
+        else
+        {
+            const double m = b - a*c[i-1];
+            c[i] = c_i/m;
+            d[i] = (rhs - a*d[i-1])/m;
+        }
+    }
+
+    // Back substitution
+    T_new(first + (n-1)*stride) = d[n-1];
+
+    for(size_t i = n-1; i > 0; --i)
+    {
+        d[i-1] -= c[i-1]*d[i];
+        T_new(first + (i-1)*stride) = d[i-1];
+    }
+}
+
+/**
+ * \brief Take one time step
+ *
+ * \param[in] T_old Temperature at the start of the step [K]
+ * \param[in] q_old Power density at the start of the step [W/m^3]
+ * \param[in] q_new Power density at the end of the step [W/m^3]
+ * \param[in] dt    Length of the step [s]
+ *
+ * \returns The temperature at the end of the step [K]
+ */
+arma::vec ADIStepper::step(const arma::vec &T_old,
+                           const arma::vec &q_old,
+                           const arma::vec &q_new,
+                           const double     dt)
+{
+    if(_n_build == 0 or _tol <= 0.0 or arma::abs(T_old - _T_ref).max() > _tol)
+        build(T_old);
+
+    const arma::vec q = 0.5*(q_old + q_new);
+
+    // Implicit across the ridge, with one line for each row
+    arma::vec T_half(T_old.size());
+
+    run_in_parallel(_ny, _n_threads, [&](const size_t iy) {
+        solve_line(T_old, q, dt, iy*_nx, 1, _nx, true, T_half);
+    });
+
+    // Implicit in the growth direction, with one line for each column
+    arma::vec T_new(T_old.size());
+
+    run_in_parallel(_nx, _n_threads, [&](const size_t ix) {
+        solve_line(T_half, q, dt, ix, _nx, _ny, false, T_new);
+    });
+
+    return T_new;
+}
+
+/**
+ * \brief Find the average temperature of the heated points
+ *
+ * \param[in] g Power density at each point [W/m^3]
+ * \param[in] T Temperature at each point [K]
+ */
+static double calctave(const arma::vec &g,
+                       const arma::vec &T)
+{
+    double       T_sum = 0.0;
+    unsigned int n_AR  = 0;
+
+    for(unsigned int p = 0; p < T.size(); ++p)
+    {
+        if(g(p) > 0.0)
+        {
+            T_sum += T(p);
+            ++n_AR;
+        }
+    }
+
+    return T_sum/n_AR;
+}
+
+/**
+ * \brief Write the temperature at each point that is not etched
+ *
+ * \param[in] filename Name of the output file
+ * \param[in] nx       Number of points across the ridge
+ * \param[in] dx       Spatial step across the ridge [m]
+ * \param[in] dy       Spatial step in the growth direction [m]
+ * \param[in] iLayer   Index of layer containing each point (-1 if etched)
+ * \param[in] T        Temperature at each point [K]
+ */
+static void write_map(const std::string      &filename,
+                      const size_t            nx,
+                      const double            dx,
+                      const double            dy,
+                      const std::vector<int> &iLayer,
+                      const arma::vec        &T)
+{
+    TableWriter stream(filename);
+
+    for(size_t p = 0; p < T.size(); ++p)
+    {
+        if(iLayer[p] >= 0)
+            stream << ((p % nx) + 0.5)*dx*1e6 << '\t' << ((p / nx) + 0.5)*dy*1e6 << '\t' << T(p) << '\n';
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    try
+    {
+        MaterialLibrary material_library("");
+
+        const auto Tsink     = opt.get_option<double>("Tsink");
+        const auto dx        = opt.get_option<double>("dx");
+        const auto dy        = opt.get_option<double>("dy");
+        const auto dc        = opt.get_option<double>("dc") * 0.01;
+        const auto f_rep     = opt.get_option<double>("frequency") * 1.0e3;
+        const auto power     = opt.get_option<double>("power");
+        const auto area      = opt.get_option<double>("area") * 1e-6;       // [m^2]
+        const auto w_ridge   = opt.get_option<double>("ridgewidth") * 1e-6; // [m]
+        const auto width     = opt.get_option<double>("width") * 1e-6;      // [m]
+        const auto iAR       = opt.get_option<size_t>("active");
+        const auto iL_ridge  = opt.get_option<size_t>("ridgelayer");
+        const auto n_threads = opt.get_option<unsigned int>("threads");
+
+        if(Tsink <= 0.0)
+            throw std::domain_error("Heatsink temperature must be positive.");
+
+        if(dx <= 0.0 or dy <= 0.0)
+            throw std::domain_error("Spatial resolution must be positive.");
+
+        if(dc <= 0.0 or dc >= 1.0)
+            throw std::domain_error("Duty cycle must be between 0 and 100%.");
+
+        if(f_rep <= 0.0 or power <= 0.0 or area <= 0.0)
+            throw std::domain_error("Pulse repetition rate, power and ridge area must be positive.");
+
+        if(w_ridge <= 0.0 or width < w_ridge)
+            throw std::domain_error("Ridge width must be positive, and no more than the total width.");
+
+        if(iL_ridge > iAR)
+            throw std::domain_error("The active region must lie within the ridge.");
+
+        // Read the layers, starting from the heat sink
+        arma::vec d;                       // Layer thickness [m]
+        arma::vec x;                       // Alloy composition in each layer
+        arma::vec doping;                  // Unused doping data
+        std::vector<std::string> mat_name; // Material name in each layer
+        const auto infile = opt.get_option<std::string>("infile");
+        read_table(infile, d, x, doping, mat_name);
+        d *= 1e-6; // Rescale thickness to metres
+
+        const size_t nL = d.size();
+
+        if(iAR >= nL)
+        {
+            std::ostringstream oss;
+            oss << "Active region layer " << iAR << " is not in " << infile << ".";
+            throw std::domain_error(oss.str());
+        }
+
+        std::vector<DebyeModel>          dm_layer;
+        std::vector<ThermalConductivity> k_layer;
+        arma::vec                        rho_layer(nL);
+
+        for(unsigned int iL = 0; iL < nL; ++iL)
+        {
+            const auto mat    = material_library.get_material(mat_name[iL]);
+            const auto T_D    = mat->get_property_value("debye-temperature", x[iL]);
+            const auto M      = mat->get_property_value("molar-mass", x[iL]);
+            const auto natoms = mat->get_property_value("natoms");
+            rho_layer(iL) = mat->get_property_value("density", x[iL]);
+
+            dm_layer.push_back(DebyeModel(T_D, M, natoms));
+            k_layer.push_back(ThermalConductivity(*mat, x[iL]));
+
+            // As in qwwad_thermal_1d, tabulate from the heat-sink temperature to
+            // far above any temperature that the device would survive
+            k_layer.back().tabulate(Tsink, Tsink + 1000.0);
+        }
+
+        // Half of the cross-section, from the centre of the ridge outwards
+        const size_t nx = ceil(width/(2*dx));
+        const size_t ny = ceil(arma::sum(d)/dy);
+
+        if(opt.get_verbose())
+            std::cout << "nx = " << nx << ", ny = " << ny << std::endl;
+
+        // Power density in the active region [W/m^3]
+        const double power_density = power/(d[iAR]*area);
+        const double pw            = dc/f_rep; // Pulse width [s]
+
+        std::vector<int> iLayer(nx*ny, -1);
+        arma::vec        g = arma::zeros(nx*ny); // Power density [W/m^3]
+
+        for(size_t iy = 0; iy < ny; ++iy)
+        {
+            // Find the layer containing the centre of this row
+            const double y_mid = (iy + 0.5)*dy;
+            size_t       iL    = 0;
+            double       y_top = d[0];
+
+            while(iL+1 < nL && y_mid > y_top)
+                y_top += d[++iL];
+
+            for(size_t ix = 0; ix < nx; ++ix)
+            {
+                const double x_mid = (ix + 0.5)*dx;
+
+                if(iL < iL_ridge || x_mid < w_ridge/2)
+                {
+                    iLayer[iy*nx + ix] = iL;
+
+                    if(iL == iAR)
+                        g(iy*nx + ix) = power_density;
+                }
+            }
+        }
+
+        if(arma::accu(g) == 0.0)
+            throw std::domain_error("The active region does not contain any points.");
+
+        // As in qwwad_thermal_1d, use steps no longer than a thousandth of a period
+        const double dt_max      = 1.0/(1000*f_rep);
+        const double time_period = 1.0/f_rep;
+        const size_t nt_per      = ceil(time_period/dt_max);
+        const double dt          = time_period/nt_per;
+        const size_t n_rep       = opt.get_option<size_t>("nrep");
+
+        if(opt.get_verbose())
+        {
+            printf("Power density = %5.2e W/m3.\n", power_density);
+            printf("Pulse width = %5.1f ns.\n", pw*1e9);
+            printf("dt=%.4f ns.\n", dt*1e9);
+        }
+
+        ADIStepper stepper(nx, ny, dx, dy, opt.get_option<double>("refactor-dT"), n_threads,
+                           iLayer, k_layer, dm_layer, rho_layer);
+
+        const auto    periodic_tol = opt.get_option<double>("periodic-tol");
+        AndersonMixer mixer(opt.get_option<size_t>("mixingdepth"));
+        size_t        n_per_run    = n_rep;
+
+        arma::vec T(nx*ny);
+        T.fill(Tsink);
+
+        arma::vec T_max_map = T;                   // Temperature at the hottest sample
+        arma::vec t         = arma::zeros(nt_per*n_rep);
+        arma::vec T_avg     = arma::zeros(nt_per*n_rep);
+        arma::vec t_max     = arma::zeros(n_rep); // Time of peak temperature in each period
+        arma::vec T_max     = arma::zeros(n_rep); // Peak AR temperature in each period
+        arma::vec t_period  = arma::zeros(nt_per);
+        arma::vec T_period  = arma::zeros(nt_per);
+        const arma::vec q_off = arma::zeros(nx*ny);
+
+        for(size_t iper = 0; iper < n_rep; ++iper)
+        {
+            const double    t_start = time_period*iper;
+            const arma::vec T_start = T;
+
+            for(size_t it = 0; it < nt_per; ++it)
+            {
+                const size_t it_total = it + nt_per*iper;
+                t(it_total) = t_start + dt*it;
+
+                // The power is on at this sample and the previous one within the pulse
+                const arma::vec &q_now = (dt*it <= pw) ? g : q_off;
+                const arma::vec &q_old = (it > 0 and dt*(it-1) <= pw) ? g : q_off;
+
+                T = stepper.step(T, q_old, q_now, dt);
+
+                T_avg(it_total) = calctave(g, T);
+
+                if(T_avg(it_total) > T_max(iper))
+                {
+                    T_max(iper) = T_avg(it_total);
+                    t_max(iper) = t(it_total);
+                    T_max_map   = T;
+                }
+
+                t_period(it) = t(it_total)*1e6;
+                T_period(it) = T_avg(it_total);
+            }
+
+            if(opt.get_verbose())
+            {
+                printf("Period=%zu Tmax= %.4f K at t=%.2f microseconds\n",
+                       iper+1, T_max(iper), t_max(iper)*1e6);
+            }
+
+            if(periodic_tol > 0.0)
+            {
+                const double change = arma::abs(T - T_start).max();
+
+                if(opt.get_verbose())
+                    printf("Period=%zu change in temperature profile = %.3e K\n", iper+1, change);
+
+                if(change < periodic_tol)
+                {
+                    n_per_run = iper+1;
+                    break;
+                }
+
+                // Start the next period from the accelerated estimate of the steady state
+                T = mixer.mix(T_start, T);
+            }
+        }
+
+        if(n_per_run < n_rep)
+        {
+            if(opt.get_verbose())
+                printf("Reached periodic steady state after %zu periods.\n", n_per_run);
+
+            t.resize(nt_per*n_per_run);
+            T_avg.resize(nt_per*n_per_run);
+            t_max.resize(n_per_run);
+            T_max.resize(n_per_run);
+        }
+        else if(periodic_tol > 0.0)
+            std::cerr << "Warning: periodic steady state was not reached within "
+                      << n_rep << " periods." << std::endl;
+
+        if(opt.get_verbose())
+        {
+            printf("Material coefficients were found %zu times in %zu steps.\n",
+                   stepper.get_n_build(), nt_per*n_per_run);
+        }
+
+        write_table("T_t.dat",        arma::vec(1e6*t), T_avg);
+        write_table("Tmax_t.dat",     arma::vec(1e6*t_max), T_max);
+        write_table("T-period_t.dat", t_period, T_period);
+        write_map("T_xy.dat",     nx, dx, dy, iLayer, T);
+        write_map("T_xy_max.dat", nx, dx, dy, iLayer, T_max_map);
+    }
+    catch(std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -2,8 +2,11 @@
 # include "config.h"
 #endif
 
+#include <cmath>
 #include <iostream>
+#include <sstream>
 #include <valarray>
+#include <vector>
 #include "qwwad/options.h"
 #include "qwwad/file-io.h"
 #include "qwwad/lapack-declarations.h"
@@ -45,6 +48,12 @@ class ThermalRCOptions: public Options
 
     std::string get_infile() const {return vm["infile"].as<std::string>();}
 
+    /// Return true if the exact exponential propagator should be used
+    bool get_exact() const {return vm["exact"].as<bool>();}
+
+    /// Return true if the periodic steady state should be found directly
+    bool get_steady_state() const {return vm["steady-state"].as<bool>();}
+
     void print() const {}
 };
 
@@ -81,6 +90,22 @@ ThermalRCOptions::ThermalRCOptions(int argc, char *argv[]) :
 
 	("capacitance,C", po::value<double>()->default_value(1e-6),
 	 "set thermal capacitance [J/K]")
+
+        ("exact", po::bool_switch()->default_value(false),
+         "advance the temperature using the exact exponential response of the "
+         "RC circuit, rather than the backward-Euler scheme")
+
+        ("steady-state", po::bool_switch()->default_value(false),
+         "find the periodic steady-state temperatures directly, without "
+         "simulating the pulse train")
+
+        ("dclist", po::value<std::string>()->default_value(""),
+         "comma-separated list of duty cycles [%] for a batch steady-state "
+         "calculation.  If unspecified, the single duty cycle is used.")
+
+        ("flist", po::value<std::string>()->default_value(""),
+         "comma-separated list of pulse repetition rates [kHz] for a batch "
+         "steady-state calculation.  If unspecified, the single rate is used.")
         ;
 
     std::string doc = "Calculate temperature variation in active region over time";
@@ -159,11 +184,150 @@ ThermalRCOptions::ThermalRCOptions(int argc, char *argv[]) :
     }
 }
 
+/**
+ * \brief Exact response of a lumped thermal RC circuit to a train of square pulses
+ *
+ * \details The rise in temperature above the heatsink obeys
+ *          \f$C\frac{d\Delta T}{dt} + \frac{\Delta T}{R} = q\f$.  With constant
+ *          heating over an interval \f$t\f$, the exact solution is
+ *          \f$\Delta T(t) = \Delta T(0)e^{-t/\tau} + qR(1 - e^{-t/\tau})\f$, where
+ *          \f$\tau = RC\f$.  A whole pulse, or a whole period, is therefore a
+ *          single step.
+ */
+class RCPulseTrain
+{
+private:
+    double _R;   ///< Thermal resistance [K/W]
+    double _tau; ///< Thermal time constant [s]
+    double _q;   ///< Power dissipation during a pulse [W]
+    double _pw;  ///< Pulse width [s]
+    double _P;   ///< Period [s]
+
+public:
+    /**
+     * \param[in] R     Thermal resistance [K/W]
+     * \param[in] C     Thermal capacitance [J/K]
+     * \param[in] q     Power dissipation during a pulse [W]
+     * \param[in] dc    Duty cycle (0 to 1)
+     * \param[in] f_rep Pulse repetition rate [Hz]
+     */
+    RCPulseTrain(const double R,
+                 const double C,
+                 const double q,
+                 const double dc,
+                 const double f_rep) :
+        _R(R),
+        _tau(R*C),
+        _q(q),
+        _pw(dc/f_rep),
+        _P(1.0/f_rep)
+    {}
+
+    /**
+     * \brief Advance the temperature rise over an interval with constant heating
+     *
+     * \param[in] dT Temperature rise at start of interval [K]
+     * \param[in] q  Power dissipation [W]
+     * \param[in] t  Length of interval [s]
+     */
+    double propagate(const double dT,
+                     const double q,
+                     const double t) const
+    {
+        const double decay = exp(-t/_tau);
+        return dT*decay + q*_R*(1.0 - decay);
+    }
+
+    /// Return the temperature rise at the end of a pulse [K]
+    double get_pulse_end(const double dT_start) const {return propagate(dT_start, _q, _pw);}
+
+    /// Return the temperature rise in the middle of a pulse [K]
+    double get_pulse_mid(const double dT_start) const {return propagate(dT_start, _q, _pw/2);}
+
+    /// Return the temperature rise at the end of a whole period [K]
+    double get_period_end(const double dT_start) const
+    {
+        return propagate(get_pulse_end(dT_start), 0.0, _P - _pw);
+    }
+
+    /**
+     * \brief Return the temperature rise at the start of each period in the
+     *        periodic steady state [K]
+     *
+     * \details This is the fixed point of the map from one period to the next.
+     */
+    double get_steady_state_start() const
+    {
+        const double decay_on  = exp(-_pw/_tau);
+        const double decay_off = exp(-(_P - _pw)/_tau);
+        return _q*_R*(1.0 - decay_on)*decay_off/(1.0 - decay_on*decay_off);
+    }
+
+    /// Return the mean temperature rise over a period in the steady state [K]
+    double get_steady_state_mean() const {return _q*_R*_pw/_P;}
+};
+
+/**
+ * \brief Find the periodic steady state for every combination of duty cycle and frequency
+ *
+ * \param[in] opt User options
+ *
+ * \details One row is written to T-steady.dat for each combination, with the
+ *          duty cycle [%], repetition rate [kHz], and the temperature [K] at the
+ *          start, middle and end of the pulse and averaged over the period.
+ */
+static void find_steady_states(const ThermalRCOptions &opt)
+{
+    std::vector<double> dc_list = opt.get_numeric_list("dclist", 0.01);
+    std::vector<double> f_list  = opt.get_numeric_list("flist",  1e3);
+
+    if(dc_list.empty())
+        dc_list.push_back(opt.get_duty_cycle());
+
+    if(f_list.empty())
+        f_list.push_back(opt.get_f_rep());
+
+    const double T_sink = opt.get_heatsink_temperature();
+    TableWriter  stream("T-steady.dat");
+
+    for(auto const dc : dc_list)
+    {
+        if(dc <= 0.0 or dc >= 1.0)
+        {
+            std::ostringstream oss;
+            oss << "Specified duty cycle, " << dc << ", is invalid.";
+            throw std::domain_error(oss.str());
+        }
+
+        for(auto const f : f_list)
+        {
+            if(f <= 0)
+                throw std::domain_error ("Pulse repetition rate must be positive.");
+
+            const RCPulseTrain train(opt.get_R(), opt.get_C(), opt.get_power(), dc, f);
+            const double dT_start = train.get_steady_state_start();
+
+            stream << dc*100                                  << "\t"
+                   << f*1e-3                                  << "\t"
+                   << T_sink + dT_start                       << "\t"
+                   << T_sink + train.get_pulse_mid(dT_start)  << "\t"
+                   << T_sink + train.get_pulse_end(dT_start)  << "\t"
+                   << T_sink + train.get_steady_state_mean()  << '\n';
+        }
+    }
+}
+
 int main(int argc, char *argv[])
 {
     // Grab user preferences
     ThermalRCOptions opt(argc, argv);
 
+    if(opt.get_steady_state())
+    {
+        find_steady_states(opt);
+        return EXIT_SUCCESS;
+    }
+
     double dt_max=1.0/(1000*opt.get_f_rep());
     double pw = opt.get_duty_cycle()/opt.get_f_rep();
     
@@ -215,6 +379,41 @@ int main(int argc, char *argv[])
 
     size_t nt=_t.size();
 
+    const RCPulseTrain train(R, C, opt.get_power(), opt.get_duty_cycle(), _f_rep);
+    std::valarray<double> t(&_t[0], nt);
+    std::valarray<double> q(&_q[0], nt);
+
+    if(opt.get_exact())
+    {
+        // Each sample holds its power for the preceding time-step, as in the
+        // backward-Euler scheme, but the exponential decay is exact
+        std::valarray<double> T(nt);
+        double dT = 0.0;
+
+        for(unsigned int it = 0; it < nt; ++it)
+        {
+            dT    = train.propagate(dT, _q[it], dt);
+            T[it] = dT + opt.get_heatsink_temperature();
+        }
+
+        write_table("T-t.dat", std::valarray<double>(1e6*t), T);
+
+        // Step through whole periods to find the temperature exactly at the
+        // middle of each pulse
+        double dT_start = 0.0;
+
+        for(unsigned int irep = 0; irep < _n_rep; irep++)
+        {
+            t_mid[irep] = t_period*irep + pw/2;
+            T_mid[irep] = train.get_pulse_mid(dT_start) + opt.get_heatsink_temperature();
+            dT_start    = train.get_period_end(dT_start);
+        }
+
+        write_table("T-mid_t.dat", t_mid, T_mid);
+        write_table("q-t.dat",     t, q);
+        return EXIT_SUCCESS;
+    }
+
     std::valarray<double> DL(nt-1); // Lower subdiagonal
     std::valarray<double> D(nt);    // Diagonal
     std::valarray<double> DU(nt-1); // Upper subdiagonal
@@ -238,8 +437,6 @@ int main(int argc, char *argv[])
     int NRHS = 1;
     dgtsv_(&N, &NRHS, &DL[0], &D[0], &DU[0], &B[0], &N, &INFO);
 
-    std::valarray<double> t(&_t[0], nt);
-    std::valarray<double> q(&_q[0], nt);
     std::valarray<double> T = B + opt.get_heatsink_temperature();
 
     write_table("T-t.dat", std::valarray<double>(1e6*t), T);
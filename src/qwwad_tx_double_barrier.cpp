@@ -15,7 +15,6 @@
 #include <cstdlib>
 #include <cmath>
 #include <iostream>
-#include <valarray>
 #include "qwwad/double-barrier.h"
 #include "qwwad/constants.h"
 #include "qwwad/file-io.h"
@@ -40,6 +39,14 @@ Options configure_options(int argc, char* argv[])
     opt.add_option<double>("barriermass,n",         0.067, "Effective mass in barrier (relative to that of a free electron).");
     opt.add_option<double>("barrierpotential",        100, "Barrier potential [meV]");
     opt.add_option<double>("dE,d",                   0.01, "Energy step [meV]");
+    opt.add_option<std::string>("potentialfile",           "Read an arbitrary potential profile [J] (e.g., v_b.r from "
+                                                           "qwwad_ef_band_edge) instead of using the double-barrier "
+                                                           "geometry.");
+    opt.add_option<std::string>("massfile",                "Read the effective mass profile [kg] for --potentialfile "
+                                                           "(e.g., m.r). Otherwise, the well mass is used throughout.");
+    opt.add_option<bool>("resonances",                     "Find the energy and width of each resonance, by searching "
+                                                           "for the poles of the transmission coefficient.");
+    opt.add_option<unsigned int>("threads",             0, "Number of threads to use (0 = one per CPU core).");
 
     opt.add_prog_specific_options_and_parse(argc, argv, summary);
 
@@ -58,21 +65,54 @@ int main(int argc,char *argv[])
     const auto m_b = opt.get_option<double>("barriermass") * me;            // [kg]
     const auto V   = opt.get_option<double>("barrierpotential") * e / 1000; // [J]
 
-    const size_t nE = floor(V/dE); // Number of points in plot
+    // Set up either a double barrier, or the profile from the input file
+    TransferMatrix structure = make_double_barrier(m_w, m_b, V, L1, L2, L3);
+    double E_max = V; // Stop at top of barrier
 
-    std::valarray<double> E(nE); // Array of energies
-    std::valarray<double> T(nE); // Array of transmission coefficients
-
-    // Loop over energy (stop at top of barrier)
-    for(unsigned int iE = 0; iE < nE; ++iE)
+    if(opt.get_argument_known("potentialfile"))
     {
-        E[iE] = iE*dE;
-        T[iE] = get_transmission_coefficient(E[iE], m_w, m_b, V, L1, L2, L3);
+        arma::vec z;
+        arma::vec V_profile;
+        read_table(opt.get_option<std::string>("potentialfile"), z, V_profile);
+
+        arma::vec m_profile = m_w*arma::ones(z.size());
+
+        if(opt.get_argument_known("massfile"))
+        {
+            arma::vec z_m;
+            read_table(opt.get_option<std::string>("massfile"), z_m, m_profile);
+        }
+
+        structure = TransferMatrix::from_profile(z, V_profile, m_profile);
+        E_max     = V_profile.max();
     }
 
+    const size_t nE = floor(E_max/dE); // Number of points in plot
+
+    const arma::vec E = arma::linspace(0, (nE-1)*dE, nE); // Array of energies
+    const auto      n_threads = opt.get_option<unsigned int>("threads");
+    const arma::vec T         = structure.get_transmission(E, n_threads);
+
     // Rescale to meV for output
-    E/=(1e-3*e);
-    write_table("T.r", E, T);
+    write_table("T.r", arma::vec(E/(1e-3*e)), T);
+
+    if(opt.get_option<bool>("resonances"))
+    {
+        const auto   resonances = structure.find_resonances(0, E_max, 200, n_threads);
+        const size_t nres       = resonances.size();
+        arma::vec    E_res(nres);    // Energy of resonance [meV]
+        arma::vec    Gamma(nres);    // Width of resonance [meV]
+        arma::vec    lifetime(nres); // Lifetime of quasi-bound state [ps]
+
+        for(unsigned int ires = 0; ires < nres; ++ires)
+        {
+            E_res(ires)    = resonances[ires].E/(1e-3*e);
+            Gamma(ires)    = resonances[ires].Gamma/(1e-3*e);
+            lifetime(ires) = hBar/resonances[ires].Gamma*1e12;
+        }
+
+        write_table("Eres.r", E_res, Gamma, lifetime);
+    }
 
     return EXIT_SUCCESS;
 }
@@ -6,7 +6,8 @@
  *
  * \details This code reads in the transmission coefficient T(E) for a 
  *          double barrier and uses a very simple model to calculate 
- *          an I-V curve.
+ *          an I-V curve.  Optionally, T(E) is recomputed under the tilted
+ *          potential at each bias.
  */
 
 #include <cstdio>
@@ -21,6 +22,7 @@
 #include "qwwad/fermi.h"
 #include "qwwad/file-io.h"
 #include "qwwad/options.h"
+#include "qwwad/parallel.h"
 
 using namespace QWWAD;
 using namespace constants;
@@ -45,17 +47,130 @@ Options configure_options(int argc, char* argv[])
     opt.add_option<double>("barrierpotential",      100, "Barrier potential [meV]");
     opt.add_option<double>("Te",                    300, "Temperature of carrier distribution [K]");
     opt.add_option<double>("dE,d",                 0.01, "Energy step [meV]");
+    opt.add_option<double>("adaptive-tol",            0, "Largest allowed interpolation error in the "
+                                                         "transmission coefficient on an adaptive "
+                                                         "energy grid (0 = use a uniform grid).");
+    opt.add_option<double>("phasetol",              0.1, "Largest allowed change in slope of the "
+                                                         "transmission phase across an interval on an "
+                                                         "adaptive energy grid [rad].");
+    opt.add_option<size_t>("nEinitial",              64, "Number of intervals in the starting "
+                                                         "adaptive energy grid.");
+    opt.add_option<size_t>("nEmax",              100000, "Largest number of points in the adaptive "
+                                                         "energy grid.");
+    opt.add_option<bool>  ("seedresonances",             "Find the resonances of the structure first, and "
+                                                         "place extra points across each of them in the "
+                                                         "starting adaptive energy grid.");
+    opt.add_option<size_t>("nF",                    100, "Number of bias points.");
+    opt.add_option<double>("dF",                      1, "Step in electric field between bias points [kV/cm].");
+    opt.add_option<bool>  ("biased",                     "Recompute the transmission coefficient under the "
+                                                         "tilted potential at each bias.  Otherwise, the "
+                                                         "zero-bias spectrum is used throughout.");
+    opt.add_option<double>("slicewidth",              1, "Largest width of each constant-potential slice "
+                                                         "used to model the tilted potential [angstrom].");
+    opt.add_option<unsigned int>("threads",           0, "Number of threads to use (0 = one per CPU core).");
 
     opt.add_prog_specific_options_and_parse(argc, argv, summary);
 
     return opt;
 }
 
+/**
+ * \brief Find the transmission spectrum of a structure
+ *
+ * \param[in]  structure The structure
+ * \param[in]  opt       Command-line options
+ * \param[in]  E_max     Upper limit of energy grid [J]
+ * \param[in]  n_threads Number of threads to use (0 = one per CPU core)
+ * \param[out] E         Energy of each point [J]
+ * \param[out] Tx        Transmission coefficient at each energy
+ * \param[out] w         Weight of each energy in the current integral [J]
+ */
+static void find_spectrum(const TransferMatrix &structure,
+                          const Options        &opt,
+                          const double          E_max,
+                          const unsigned int    n_threads,
+                          arma::vec            &E,
+                          arma::vec            &Tx,
+                          arma::vec            &w)
+{
+    const auto tol = opt.get_option<double>("adaptive-tol");
+
+    if(tol > 0)
+    {
+        const auto n_initial = opt.get_option<size_t>("nEinitial");
+
+        std::vector<Resonance> resonances;
+
+        if(opt.get_option<bool>("seedresonances"))
+            resonances = structure.find_resonances(0, E_max, n_initial, n_threads);
+
+        const TransmissionSpectrum spectrum(structure, 0, E_max, tol,
+                                            opt.get_option<double>("phasetol"),
+                                            n_initial,
+                                            opt.get_option<size_t>("nEmax"),
+                                            n_threads,
+                                            resonances);
+        E  = spectrum.get_E();
+        Tx = spectrum.get_T();
+        w  = spectrum.get_weights();
+    }
+    else
+    {
+        const auto   dE = opt.get_option<double>("dE") * 1e-3 * e; // [J]
+        const size_t nE = floor(E_max/dE); // Number of points in table of energies
+        E  = arma::linspace(0, (nE-1)*dE, nE);
+        Tx = structure.get_transmission(E, n_threads);
+        w  = dE*arma::ones(nE);
+    }
+}
+
+/**
+ * \brief Find the current for a given transmission spectrum
+ *
+ * \param[in] E      Energy of each point [J]
+ * \param[in] Tx     Transmission coefficient at each energy
+ * \param[in] w      Weight of each energy in the current integral [J]
+ * \param[in] m_w    Effective mass in the emitter [kg]
+ * \param[in] Ef     Fermi energy, relative to the emitter band edge [J]
+ * \param[in] DeltaE Field-induced shift in the emitter band edge [J]
+ * \param[in] Te     Temperature of carrier distribution [K]
+ *
+ * \return Current [a.u.]
+ *
+ * \details The occupation of each state is found first, using the batched
+ *          density-of-states and Fermi kernels, and the weighted sum is then taken
+ *          in a single pass over contiguous arrays.
+ */
+static double find_current(const arma::vec &E,
+                           const arma::vec &Tx,
+                           const arma::vec &w,
+                           const double     m_w,
+                           const double     Ef,
+                           const double     DeltaE,
+                           const double     Te)
+{
+    const size_t nE = E.size();
+
+    // Only carriers with E > DeltaE contribute, and the density of states is
+    // zero below the shifted band edge
+    const std::valarray<double> E_va(E.memptr(), nE);
+    const std::valarray<double> rho     = calculate_dos_3D(m_w, E_va, DeltaE); // Bulk density of states
+    const arma::vec             f       = f_FD(Ef + DeltaE, E, Te);            // Fermi function
+    const double               *T_ptr   = Tx.memptr();
+    const double               *w_ptr   = w.memptr();
+    const double               *f_ptr   = f.memptr();
+    double                      current = 0.0;
+
+    for(size_t iE = 0; iE < nE; ++iE)
+        current += T_ptr[iE]*f_ptr[iE]*rho[iE]*w_ptr[iE];
+
+    return current;
+}
+
 int main(int argc,char *argv[])
 {
     const auto opt = configure_options(argc, argv);
 
-    const auto dE  = opt.get_option<double>("dE") * 1e-3 * e;               // [J]
     const auto L1  = opt.get_option<double>("leftbarrierwidth") * 1e-10;    // [m]
     const auto L2  = opt.get_option<double>("wellwidth") * 1e-10;           // [m]
     const auto L3  = opt.get_option<double>("rightbarrierwidth") * 1e-10;   // [m]
@@ -63,45 +178,55 @@ int main(int argc,char *argv[])
     const auto m_b = opt.get_option<double>("barriermass") * me;            // [kg]
     const auto Vb  = opt.get_option<double>("barrierpotential") * e / 1000; // [J]
     const auto Te  = opt.get_option<double>("Te");                          // [K]
+    const auto nF  = opt.get_option<size_t>("nF");                          // Number of field points
+    const auto dF  = opt.get_option<double>("dF") * 1e5;                    // [V/m]
+    const auto dz  = opt.get_option<double>("slicewidth") * 1e-10;          // [m]
+    const bool biased    = opt.get_option<bool>("biased");
+    const auto n_threads = opt.get_option<unsigned int>("threads");
 
-    const size_t nE = floor(Vb/dE); // Number of points in table of energies
     const double Ef=2*1e-3*e;      // Just set fixed Fermi energy to represent some fixed density
 
-    std::valarray<double> Tx(nE); // Transmission coefficient
-    std::valarray<double> E(nE);  // Energy [J]
-
-    // Compute transmission coefficient at each energy
-    for(unsigned int iE = 0; iE < nE; ++iE)
+    if(dz <= 0)
     {
-        E[iE] = iE*dE;
-        Tx[iE] = get_transmission_coefficient(E[iE], m_w, m_b, Vb, L1, L2, L3);
+        std::cerr << "Slice width must be positive." << std::endl;
+        exit(EXIT_FAILURE);
     }
 
+    // Compute transmission coefficient at each energy, along with the weight
+    // of each energy in the current integral
+    arma::vec E;  // Energy [J]
+    arma::vec Tx; // Transmission coefficient
+    arma::vec w;  // Quadrature weight [J]
+    find_spectrum(make_double_barrier(m_w, m_b, Vb, L1, L2, L3), opt, Vb, n_threads, E, Tx, w);
+
     write_table("T.r", E, Tx);
 
-    const size_t nF = 100; // Number of field points
     std::valarray<double> V(nF); // Voltage drop across structure [V]
     std::valarray<double> current(nF);
 
-    // Loop over field
-    for(unsigned int iF=0; iF<nF; ++iF)
-    {
-        const double F = iF*1e+5;            // Electric field [Vm^{-1}]
+    // Each bias point is independent, so share them between threads.  When the
+    // spectrum is recomputed at each bias, each thread finds its whole spectrum
+    // serially.
+    run_in_parallel(nF, n_threads, [&](const size_t iF) {
+        const double F = iF*dF;              // Electric field [Vm^{-1}]
         const double DeltaE=e*F*(L1+0.5*L2); // Field induced shift in band energy
         V[iF] = F*(L1+L2+L3);
 
-        current[iF] = 0; // Initialise current for integration
-        for(unsigned int iE=0; iE<nE; ++iE)
+        if(biased)
         {
-            if(E[iE] > DeltaE)	/* only add contribution to current if E>DeltaE	*/
-            {
-                const double rho   = calculate_dos_3D(m_w, E[iE] - DeltaE); // Bulk density of states
-                const double _f_FD = f_FD(Ef + DeltaE, E[iE], Te); // Fermi function
-
-                current[iF] += Tx[iE]*_f_FD*rho*dE;
-            }
+            arma::vec E_F;
+            arma::vec Tx_F;
+            arma::vec w_F;
+
+            // Only carriers above the shifted emitter band edge contribute, so
+            // the grid must reach the same height above it as at zero bias
+            find_spectrum(make_biased_double_barrier(m_w, m_b, Vb, L1, L2, L3, F, dz),
+                          opt, DeltaE + Vb, 1, E_F, Tx_F, w_F);
+            current[iF] = find_current(E_F, Tx_F, w_F, m_w, Ef, DeltaE, Te);
         }
-    }
+        else
+            current[iF] = find_current(E, Tx, w, m_w, Ef, DeltaE, Te);
+    });
 
     write_table("IV.r", V, current);
 
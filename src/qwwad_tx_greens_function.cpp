@@ -0,0 +1,138 @@
+/**
+ * \file   qwwad_tx_greens_function.cpp
+ * \brief  Calculate transmission coefficient and local density of states for any potential profile
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ *
+ * \details The recursive Green's function method is used, on the same mesh as the
+ *          tridiagonal Schroedinger solver, so that thick multi-barrier structures
+ *          can be handled without the instability of the transfer-matrix method.
+ */
+
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+#include "qwwad/constants.h"
+#include "qwwad/file-io.h"
+#include "qwwad/options.h"
+#include "qwwad/recursive-greens-function.h"
+
+using namespace QWWAD;
+using namespace constants;
+
+/**
+ * Configure command-line options for the program
+ */
+Options configure_options(int argc, char* argv[])
+{
+    Options opt;
+
+    std::string summary("Find the transmission coefficient and local density of states through "
+                        "an arbitrary potential profile.");
+
+    opt.add_option<std::string>("potentialfile", "v.r", "Filename from which the potential profile [J] is read.");
+    opt.add_option<std::string>("massfile",      "m.r", "Filename from which the effective mass profile [kg] is read. "
+                                                        "This is only needed if you are not using constant effective "
+                                                        "mass.");
+    opt.add_option<double>     ("mass",                 "The constant effective mass to use across the entire structure. "
+                                                        "If unspecified, the mass profile will be read from file.");
+    opt.add_option<double>     ("Emin",                 "Lowest energy [meV].  By default, the lower of the two lead "
+                                                        "potentials is used.");
+    opt.add_option<double>     ("Emax",                 "Highest energy [meV].  By default, the highest point in the "
+                                                        "potential profile is used.");
+    opt.add_option<double>     ("dE,d",            0.1, "Energy step [meV]");
+    opt.add_option<double>     ("broadening",      0.0, "Broadening of the energy levels [meV].  This is needed to see "
+                                                        "bound states in the local density of states.");
+    opt.add_option<bool>       ("ldos",                 "Write the local density of states to file.");
+    opt.add_option<unsigned int>("threads",          0, "Number of threads to use (0 = one per CPU core).");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, summary);
+
+    return opt;
+}
+
+int main(int argc,char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    arma::vec z; // Spatial locations [m]
+    arma::vec V; // Potential profile [J]
+    read_table(opt.get_option<std::string>("potentialfile"), z, V);
+
+    const size_t nz = z.size();
+    arma::vec    m  = arma::zeros(nz); // Band-edge effective mass [kg]
+
+    if(opt.get_argument_known("mass"))
+        m += opt.get_option<double>("mass") * me;
+    else
+    {
+        arma::vec z_m;
+        read_table(opt.get_option<std::string>("massfile"), z_m, m);
+
+        if(m.size() != nz)
+        {
+            std::cerr << "The mass profile has " << m.size() << " samples, but the potential profile has "
+                      << nz << "." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    try
+    {
+        RecursiveGreensFunction structure(z, V, m);
+        structure.set_broadening(opt.get_option<double>("broadening") * e/1000);
+
+        const double E_min = opt.get_argument_known("Emin") ? opt.get_option<double>("Emin") * e/1000
+                                                            : std::min(V[0], V[nz-1]);
+        const double E_max = opt.get_argument_known("Emax") ? opt.get_option<double>("Emax") * e/1000
+                                                            : V.max();
+        const double dE    = opt.get_option<double>("dE") * e/1000;
+
+        if(E_max <= E_min || dE <= 0)
+        {
+            std::cerr << "The energy range must be positive, with a positive step." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        const size_t    nE = floor((E_max - E_min)/dE) + 1;
+        const arma::vec E  = E_min + arma::linspace(0, (nE-1)*dE, nE);
+
+        const auto n_threads = opt.get_option<unsigned int>("threads");
+
+        // Rescale energies to meV for output
+        const arma::vec E_meV = E/(1e-3*e);
+
+        if(opt.get_option<bool>("ldos"))
+        {
+            arma::mat ldos; // Local density of states [1/(J m)]
+            const arma::vec T = structure.get_transmission(E, n_threads, ldos);
+            write_table("T.r", E_meV, T);
+
+            // List the whole map, with one row per position and energy
+            arma::vec z_out(nz*nE);
+            arma::vec E_out(nz*nE);
+
+            for(unsigned int iE = 0; iE < nE; ++iE)
+            {
+                z_out.subvec(iE*nz, (iE+1)*nz-1) = z;
+                E_out.subvec(iE*nz, (iE+1)*nz-1).fill(E_meV[iE]);
+            }
+
+            // Rescale to 1/(meV m) for output
+            const arma::vec ldos_out = arma::vectorise(ldos)*(1e-3*e);
+            write_table("ldos.r", z_out, E_out, ldos_out);
+        }
+        else
+        {
+            const arma::vec T = structure.get_transmission(E, n_threads);
+            write_table("T.r", E_meV, T);
+        }
+    }
+    catch(std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
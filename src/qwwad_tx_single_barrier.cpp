@@ -7,11 +7,10 @@
 
 #include <iostream>
 #include <cstdlib>
-#include <valarray>
-#include <gsl/gsl_math.h>
 #include "qwwad/constants.h"
 #include "qwwad/file-io.h"
 #include "qwwad/options.h"
+#include "qwwad/transfer-matrix.h"
 
 using namespace QWWAD;
 using namespace constants;
@@ -30,6 +29,7 @@ Options configure_options(int argc, char* argv[])
                                                       "This is assumed to be constant throughout the whole system.");
     opt.add_option<double>("barrierpotential",  100,  "Barrier potential [meV]");
     opt.add_option<double>("dE,d",              0.1,  "Energy step [meV]");
+    opt.add_option<unsigned int>("threads",       0,  "Number of threads to use (0 = one per CPU core).");
 
     opt.add_prog_specific_options_and_parse(argc, argv, summary);
 
@@ -48,34 +48,17 @@ int main(int argc,char *argv[])
     const double E_cutoff = V * 10; // Cut-off energy for plot
     const size_t nE = floor(E_cutoff/dE); // Number of points in plot
 
-    std::valarray<double> E(nE); // Array of energies
-    std::valarray<double> T(nE); // Array of transmission coefficients
+    const arma::vec E = arma::linspace(0, (nE-1)*dE, nE); // Array of energies
 
-    for(unsigned int iE = 0; iE < nE; ++iE)
-    {
-        E[iE] = iE*dE; // Find energy
-        const double k=sqrt(2*m*E[iE])/hBar; // Wave-vector in `well' material
-
-        if(gsl_fcmp(E[iE], V, dE/1000) == -1) // If E < V
-        {
-            const double K = sqrt(2*m*(V-E[iE]))/hBar; // Decay constant in barrier
-            T[iE] = 1.0/(1.0 + gsl_pow_2((k*k+K*K)/(2*k*K) * sinh(K*L))); // [QWWAD4, 2.199]
-        }
-        else if(gsl_fcmp(E[iE], V, dE/1000) == 0) // If E = V
-        {
-            // Use analytical solution, which is obtained from L'Hopital's rule
-            T[iE] = 4.0/(4.0 + k*k*L*L);
-        }
-        else // if E > V
-        {
-            const double kdash = sqrt(2*m*(E[iE]-V))/hBar; // Wave-vector above barrier
-            T[iE] = 1/(1+gsl_pow_2((k*k-kdash*kdash)/(2*k*kdash) * sin(kdash*L))); // [QWWAD4, 2.201]
-        }
-    }
+    // Find the transmission coefficients using the transfer-matrix method.
+    // For a single barrier, this gives the same result as [QWWAD4, 2.199] and [QWWAD4, 2.201]
+    const TransferMatrix barrier({0.0, L, 0.0},
+                                 {0.0, V, 0.0},
+                                 {m,   m, m});
+    const arma::vec T = barrier.get_transmission(E, opt.get_option<unsigned int>("threads"));
 
     // Rescale to meV for output
-    E/=(1e-3*e);
-    write_table("T.r", E, T);
+    write_table("T.r", arma::vec(E/(1e-3*e)), T);
 
     return EXIT_SUCCESS;
 }
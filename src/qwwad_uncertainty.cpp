@@ -11,12 +11,11 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <iostream>
 #include <gsl/gsl_math.h>
 #include "qwwad/eigenstate.h"
-#include "qwwad/file-io.h"
 #include "qwwad/wf_options.h"
 #include "qwwad/constants.h"
-#include "qwwad/maths-helpers.h"
 
 using namespace QWWAD;
 using namespace constants;
@@ -31,6 +30,8 @@ WfOptions configure_options(int argc, char* argv[])
     std::string summary("Compute the uncertainty relation for a given state.");
 
     opt.add_option<size_t>("state",  1, "Number of state to analyse.");
+    opt.add_option<bool>  ("allstates", "Write a table of the uncertainty relation for every state, "
+                                        "rather than analysing a single state.");
 
     opt.add_prog_specific_options_and_parse(argc, argv, summary);
 
@@ -49,38 +50,36 @@ int main(int argc, char *argv[])
                                                        1000.0/e,
                                                        true);
 
-    // TODO: read z-coordinates in from the ground state
-    // There should probably be an option in the State class for this
-    arma::vec z;
-    arma::vec _psi;
-    read_table("wf_e1.r", z, _psi);
-    const size_t nz = z.size();
-    const double dz = z[1] - z[0];
+    // Moments of every state, found in a single pass
+    const auto moments = Eigenstate::get_moments(all_states);
 
-    const auto psi = all_states.at(state-1).get_wavefunction_samples();
-
-    arma::vec d_psi_dz   = arma::zeros(nz);   // Derivative of wavefunction
-    arma::vec d2_psi_dz2 = arma::zeros(nz); // 2nd Derivative of wavefunction
-
-    // Note that we can take the end points as zero, since this is
-    // guaranteed for any valid wavefunction
-    for(unsigned int i=1;i<nz-1;i++)
+    if(opt.get_option<bool>("allstates"))
     {
-        d_psi_dz[i]   = (psi(i+1) - psi(i-1))/(2*dz);
-        d2_psi_dz2[i] = (psi(i+1) - 2*psi(i) + psi(i-1))/(dz*dz);
-    }
+        printf("# state\t<z> [m]\t<z^2> [m^2]\tDelta_z [m]\t<p^2>/sqr(hbar) [m^-2]\tDelta_p/hbar [m^-1]\tDelta_z*Delta_p [hbar]\n");
 
-    const arma::vec ev_z_integrand_dz = square(psi)%z;
-    const auto ev_z = integral(ev_z_integrand_dz, dz);       // Expectation position [m]
+        for(unsigned int ist = 0; ist < all_states.size(); ++ist)
+        {
+            const double Delta_z = sqrt(moments(ist,1) - gsl_pow_2(moments(ist,0)));
+            const double Delta_p = sqrt(moments(ist,3) - gsl_pow_2(moments(ist,2)));
 
-    const arma::vec ev_zsqr_integrand_dz = square(psi%z);
-    const auto ev_zsqr = integral(ev_zsqr_integrand_dz, dz); // Expectation for z*z [m^2]
+            printf("%u\t%20.17le\t%20.17le\t%20.17le\t%20.17le\t%20.17le\t%20.17le\n",
+                   ist+1, moments(ist,0), moments(ist,1), Delta_z, moments(ist,3), Delta_p, Delta_z*Delta_p);
+        }
 
-    const arma::vec ev_p_integrand_dz = -psi%d_psi_dz;
-    const double ev_p    = integral(ev_p_integrand_dz, dz);   // Expectation momentum [relative to i hBar]
+        return EXIT_SUCCESS;
+    }
+
+    if(state < 1 || state > all_states.size())
+    {
+        std::cerr << "State " << state << " is out of range.  Only " << all_states.size()
+                  << " states were found." << std::endl;
+        exit(EXIT_FAILURE);
+    }
 
-    const arma::vec ev_psqr_integrand_dz = -psi%d2_psi_dz2;
-    const double ev_psqr = integral(ev_psqr_integrand_dz, dz); // Expectation for p*p [relative to hBar^2]
+    const auto ev_z    = moments(state-1, 0); // Expectation position [m]
+    const auto ev_zsqr = moments(state-1, 1); // Expectation for z*z [m^2]
+    const auto ev_p    = moments(state-1, 2); // Expectation momentum [relative to i hBar]
+    const auto ev_psqr = moments(state-1, 3); // Expectation for p*p [relative to hBar^2]
 
     // Find uncertainty in position and momentum
     const double Delta_z=sqrt(ev_zsqr-gsl_pow_2(ev_z));
@@ -0,0 +1,133 @@
+/**
+ * \file   qwwad_wavepacket.cpp
+ * \brief  Propagate a Gaussian wavepacket through a potential profile
+ * \author Alex Valavanis <a.valavanis@leeds.ac.uk>
+ *
+ * \details The time-dependent Schroedinger equation is solved using the
+ *          Crank-Nicolson method.  Only a few observables are written at each
+ *          output time, rather than the whole wavefunction, so long simulations
+ *          on fine meshes do not produce huge files.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+#include "qwwad/constants.h"
+#include "qwwad/crank-nicolson-propagator.h"
+#include "qwwad/file-io.h"
+#include "qwwad/options.h"
+
+using namespace QWWAD;
+using namespace constants;
+
+/**
+ * Configure command-line options for the program
+ */
+Options configure_options(int argc, char* argv[])
+{
+    Options opt;
+
+    std::string summary("Propagate a Gaussian wavepacket through a potential profile.");
+
+    opt.add_option<std::string>("potentialfile",  "v.r", "Filename from which the potential profile [J] is read.");
+    opt.add_option<std::string>("massfile",       "m.r", "Filename from which the effective mass profile [kg] is read. "
+                                                         "This is only needed if you are not using constant effective "
+                                                         "mass.");
+    opt.add_option<double>     ("mass",                  "The constant effective mass to use across the entire structure. "
+                                                         "If unspecified, the mass profile will be read from file.");
+    opt.add_option<double>     ("energy,E",         10,  "Mean kinetic energy of the wavepacket at its starting point [meV].");
+    opt.add_option<double>     ("z0",                    "Starting position of the centre of the wavepacket [angstrom].  By "
+                                                         "default, it starts a quarter of the way across the structure.");
+    opt.add_option<double>     ("sigma",           100,  "Standard deviation of the starting probability density [angstrom].");
+    opt.add_option<double>     ("dt",               1.0, "Time step [fs].");
+    opt.add_option<size_t>     ("nsteps",          1000, "Number of time steps.");
+    opt.add_option<size_t>     ("outputinterval",    10, "Number of time steps between each line of output.");
+    opt.add_option<double>     ("absorberwidth",    200, "Width of the absorbing region at each end of the structure [angstrom].");
+    opt.add_option<double>     ("absorberstrength", 100, "Largest value of the absorbing potential [meV].");
+    opt.add_option<double>     ("zdetector",             "Position beyond which the particle is counted as transmitted [angstrom].  "
+                                                         "By default, the middle of the structure is used.");
+    opt.add_option<std::string>("outputfile", "wavepacket.r", "Filename to which the observables are written.");
+
+    opt.add_prog_specific_options_and_parse(argc, argv, summary);
+
+    return opt;
+}
+
+int main(int argc,char *argv[])
+{
+    const auto opt = configure_options(argc, argv);
+
+    arma::vec z; // Spatial locations [m]
+    arma::vec V; // Potential profile [J]
+    read_table(opt.get_option<std::string>("potentialfile"), z, V);
+
+    const size_t nz = z.size();
+    arma::vec    m  = arma::zeros(nz); // Band-edge effective mass [kg]
+
+    if(opt.get_argument_known("mass"))
+        m += opt.get_option<double>("mass") * me;
+    else
+    {
+        arma::vec z_m;
+        read_table(opt.get_option<std::string>("massfile"), z_m, m);
+
+        if(m.size() != nz)
+        {
+            std::cerr << "The mass profile has " << m.size() << " samples, but the potential profile has "
+                      << nz << "." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    const auto dt       = opt.get_option<double>("dt") * 1e-15;    // Time step [s]
+    const auto sigma    = opt.get_option<double>("sigma") * 1e-10; // Width of wavepacket [m]
+    const auto nsteps   = opt.get_option<size_t>("nsteps");
+    const auto interval = std::max<size_t>(opt.get_option<size_t>("outputinterval"), 1);
+
+    // Starting point of wavepacket, and position of detector [m]
+    const auto z0    = opt.get_argument_known("z0") ? opt.get_option<double>("z0") * 1e-10
+                                                    : z[0] + 0.25*(z[nz-1] - z[0]);
+    const auto z_det = opt.get_argument_known("zdetector") ? opt.get_option<double>("zdetector") * 1e-10
+                                                           : z[0] + 0.5*(z[nz-1] - z[0]);
+
+    try
+    {
+        CrankNicolsonPropagator propagator(z, V, m, dt,
+                                           opt.get_option<double>("absorberwidth") * 1e-10,
+                                           opt.get_option<double>("absorberstrength") * e/1000);
+
+        // Find the mean wave vector from the kinetic energy at the starting point
+        const size_t iz0 = std::min<size_t>(std::lower_bound(z.begin(), z.end(), z0) - z.begin(), nz-1);
+        const double Ek  = opt.get_option<double>("energy") * e/1000;
+        const double k0  = sqrt(2.0*m[iz0]*Ek)/hBar;
+
+        propagator.set_gaussian_wavepacket(z0, sigma, k0);
+
+        TableWriter stream(opt.get_option<std::string>("outputfile"));
+        size_t      nsteps_done = 0;
+
+        while(true)
+        {
+            stream << propagator.get_time()*1e15                << '\t'
+                   << propagator.get_mean_position()*1e10       << '\t'
+                   << propagator.get_norm()                     << '\t'
+                   << propagator.get_probability_beyond(z_det)  << '\n';
+
+            if(nsteps_done >= nsteps)
+                break;
+
+            const size_t n = std::min(interval, nsteps - nsteps_done);
+            propagator.step(n);
+            nsteps_done += n;
+        }
+    }
+    catch(std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return EXIT_SUCCESS;
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,89 @@
+#include <cmath>
+#include <gtest/gtest.h>
+#include "qwwad/constants.h"
+#include "qwwad/schroedinger-solver-donor-3D.h"
+#include "qwwad/schroedinger-solver-donor-variable.h"
+
+using namespace QWWAD;
+using namespace constants;
+
+/**
+ * \brief A donor at the centre of a GaAs/AlGaAs quantum well
+ */
+class DonorSolverTest : public ::testing::Test
+{
+protected:
+    arma::vec    z;      ///< Spatial locations [m]
+    arma::vec    V;      ///< Potential profile [J]
+    const double m      = 0.067*me;
+    const double eps    = 13.18*eps0;
+    const double lambda = 100e-10;
+    const double dE     = 1e-3*e;
+    double       r_d    = 0.0;
+
+    void SetUp()
+    {
+        const double L_well    = 100e-10;
+        const double L_barrier = 200e-10;
+        const size_t nz        = 501;
+
+        z   = arma::linspace(0, L_well + 2*L_barrier, nz);
+        V   = arma::zeros(nz);
+        r_d = L_barrier + L_well/2;
+
+        for(unsigned int iz = 0; iz < nz; ++iz)
+        {
+            if(z[iz] < L_barrier || z[iz] > L_barrier + L_well)
+                V[iz] = 0.1*e;
+        }
+    }
+
+    /**
+     * \brief Check that the wavefunction is the envelope times the hydrogenic factor
+     *
+     * \param[in] se   The solver
+     * \param[in] zeta Symmetry parameter of the hydrogenic factor
+     */
+    void expect_hydrogenic_product(SchroedingerSolverDonor &se,
+                                   const double             zeta)
+    {
+        const auto solutions     = se.get_solutions();
+        const auto solutions_chi = se.get_solutions_chi();
+
+        ASSERT_EQ(1U, solutions.size());
+        ASSERT_EQ(solutions_chi.size(), solutions.size());
+
+        for(unsigned int ist = 0; ist < solutions.size(); ++ist)
+        {
+            EXPECT_DOUBLE_EQ(solutions_chi[ist].get_energy(), solutions[ist].get_energy());
+
+            const auto &psi = solutions[ist].get_wavefunction_samples();
+            const auto &chi = solutions_chi[ist].get_wavefunction_samples();
+            ASSERT_EQ(z.size(), psi.size());
+
+            for(unsigned int iz = 0; iz < z.size(); ++iz)
+            {
+                const double psi_expected = chi[iz]*exp(-zeta*fabs(z[iz] - r_d)/lambda);
+                EXPECT_NEAR(psi_expected, psi[iz], 1e-12*arma::abs(chi).max());
+            }
+        }
+    }
+};
+
+TEST_F(DonorSolverTest, donor3DIsEnvelopeTimesHydrogenic)
+{
+    SchroedingerSolverDonor3D se(m, V, z, eps, r_d, lambda, dE);
+    expect_hydrogenic_product(se, 1.0);
+}
+
+TEST_F(DonorSolverTest, donorVariableUsesSymmetryParameter)
+{
+    const double zeta = 0.6;
+    SchroedingerSolverDonorVariable se(m, V, z, eps, r_d, lambda, zeta, dE);
+    expect_hydrogenic_product(se, zeta);
+
+    // Changing the symmetry must give a new solution, rather than a stale state
+    se.set_zeta(0.9);
+    expect_hydrogenic_product(se, 0.9);
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,85 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <gtest/gtest.h>
+#include "qwwad/checkpoint.h"
+
+using namespace QWWAD;
+
+static const char     magic[8] = {'Q', 'W', 'T', 'E', 'S', 'T', '0', '1'};
+static const uint32_t version  = 3;
+
+/**
+ * \brief Write a checkpoint with one of each kind of field
+ */
+static void write_test_checkpoint(const std::string         &filename,
+                                  const std::vector<double> &table)
+{
+    auto buffer = start_checkpoint(magic, version);
+    append_checkpoint_value<int32_t>(buffer, -42);
+    append_checkpoint_value<double>(buffer, 1.25e-19);
+    append_checkpoint_table(buffer, table.data(), table.size());
+    append_checkpoint_string(buffer, "v.r");
+    append_checkpoint_string(buffer, "");
+
+    ASSERT_TRUE(write_checkpoint_file(filename, buffer));
+}
+
+TEST(Checkpoint, roundTrip)
+{
+    const std::string         filename = "checkpoint-test.bin";
+    const std::vector<double> table    = {0.0, -1.5, 3.0e8, 1e-300};
+
+    write_test_checkpoint(filename, table);
+
+    std::ifstream stream(filename.c_str(), std::ios::binary);
+    check_checkpoint_header(stream, filename, magic, version, "a test");
+
+    EXPECT_EQ(-42, read_checkpoint_value<int32_t>(stream));
+    EXPECT_EQ(1.25e-19, read_checkpoint_value<double>(stream));
+    EXPECT_EQ(table, read_checkpoint_table(stream));
+    EXPECT_EQ("v.r", read_checkpoint_string(stream));
+    EXPECT_EQ("", read_checkpoint_string(stream));
+    EXPECT_TRUE(static_cast<bool>(stream));
+
+    // The temporary file must have been renamed
+    std::ifstream tmp_stream((filename + ".tmp").c_str());
+    EXPECT_FALSE(tmp_stream.good());
+
+    std::remove(filename.c_str());
+}
+
+TEST(Checkpoint, rejectsWrongVersionOrType)
+{
+    const std::string filename = "checkpoint-test-header.bin";
+    write_test_checkpoint(filename, std::vector<double>(3, 1.0));
+
+    std::ifstream wrong_version(filename.c_str(), std::ios::binary);
+    EXPECT_THROW(check_checkpoint_header(wrong_version, filename, magic, version+1, "a test"),
+                 std::runtime_error);
+
+    const char    other_magic[8] = {'Q', 'W', 'T', 'E', 'S', 'T', '0', '2'};
+    std::ifstream wrong_type(filename.c_str(), std::ios::binary);
+    EXPECT_THROW(check_checkpoint_header(wrong_type, filename, other_magic, version, "a test"),
+                 std::runtime_error);
+
+    std::ifstream missing("checkpoint-test-missing.bin", std::ios::binary);
+    EXPECT_THROW(check_checkpoint_header(missing, "checkpoint-test-missing.bin", magic, version, "a test"),
+                 std::runtime_error);
+
+    std::remove(filename.c_str());
+}
+
+TEST(Checkpoint, truncatedTableIsEmpty)
+{
+    const std::vector<double> table(100, 2.0);
+    std::string buffer;
+    append_checkpoint_table(buffer, table.data(), table.size());
+    buffer.resize(buffer.size() - sizeof(double));
+
+    std::istringstream stream(buffer);
+    EXPECT_TRUE(read_checkpoint_table(stream).empty());
+    EXPECT_FALSE(static_cast<bool>(stream));
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,96 @@
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "qwwad/file-io.h"
+
+using namespace QWWAD;
+
+/**
+ * \brief Write a two-column table, and check that it is read back unchanged
+ *
+ * \param[in] fname Name of the file, whose suffix selects the compression
+ * \param[in] nrows Number of rows in the table
+ *
+ * \details The values are written with enough digits to be reproduced exactly.
+ *          A large table is split into several blocks when it is decompressed, so
+ *          this also checks that no lines are lost or broken between blocks.
+ */
+static void check_round_trip(const std::string &fname,
+                             const size_t       nrows)
+{
+    std::vector<double> x(nrows);
+    std::vector<double> y(nrows);
+
+    {
+        TableWriter stream(fname, 17, true);
+
+        for(size_t i = 0; i < nrows; ++i)
+        {
+            x[i] = i*1e-3;
+            y[i] = 1.0/(i + 3.0);
+            stream << x[i] << '\t' << y[i] << '\n';
+        }
+    }
+
+    std::vector<double> x_read;
+    std::vector<double> y_read;
+    read_table(fname, x_read, y_read);
+
+    EXPECT_EQ(x, x_read);
+    EXPECT_EQ(y, y_read);
+
+    arma::mat table;
+    read_table(fname, table);
+
+    ASSERT_EQ(nrows, table.n_rows);
+    ASSERT_EQ(2U, table.n_cols);
+    EXPECT_EQ(y.back(), table(nrows-1, 1));
+
+    std::remove(fname.c_str());
+}
+
+TEST(CompressedTable, uncompressedRoundTrip)
+{
+    check_round_trip("table-test.r", 1000);
+}
+
+#if HAVE_ZLIB
+TEST(CompressedTable, gzipRoundTrip)
+{
+    check_round_trip("table-test.r.gz", 10);
+    check_round_trip("table-test-large.r.gz", 300000);
+}
+
+TEST(CompressedTable, gzipRecognisedWithoutSuffix)
+{
+    {
+        TableWriter stream("table-test-renamed.r.gz");
+        stream << 1 << '\t' << 2.5 << '\n' << 2 << '\t' << -3.5 << '\n';
+    }
+
+    std::rename("table-test-renamed.r.gz", "table-test-renamed.r");
+
+    std::vector<int>    i;
+    std::vector<double> v;
+    read_table("table-test-renamed.r", i, v);
+
+    EXPECT_EQ(std::vector<int>({1, 2}), i);
+    EXPECT_EQ(std::vector<double>({2.5, -3.5}), v);
+
+    std::remove("table-test-renamed.r");
+}
+#endif
+
+#if HAVE_ZSTD
+TEST(CompressedTable, zstdRoundTrip)
+{
+    check_round_trip("table-test.r.zst", 10);
+    check_round_trip("table-test-large.r.zst", 300000);
+}
+#endif
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
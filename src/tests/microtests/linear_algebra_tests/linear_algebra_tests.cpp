@@ -0,0 +1,143 @@
+#include <cmath>
+#include <gtest/gtest.h>
+#include "qwwad/linear-algebra.h"
+
+using namespace QWWAD;
+
+/**
+ * \brief A small, non-symmetric tridiagonal matrix and its dense equivalent
+ */
+class TridiagTest : public ::testing::Test
+{
+protected:
+    arma::vec M_sub;
+    arma::vec M_diag;
+    arma::vec M_super;
+    arma::mat M;
+
+    void SetUp()
+    {
+        M_sub   = {1.0, -2.0, 0.5, 3.0};
+        M_diag  = {4.0, 5.0, -6.0, 7.0, 8.0};
+        M_super = {-1.0, 2.0, 1.5, -0.25};
+
+        M = arma::zeros(5, 5);
+        M.diag()   = M_diag;
+        M.diag(-1) = M_sub;
+        M.diag(1)  = M_super;
+    }
+};
+
+TEST_F(TridiagTest, multiplyVecTridiagMatchesDense)
+{
+    const arma::vec x = {1.0, 2.0, -3.0, 0.5, 4.0};
+    const arma::vec c = {0.1, -0.2, 0.3, -0.4, 0.5};
+
+    const arma::vec y_expected = M*x + c;
+    const arma::vec y          = multiply_vec_tridiag(M_sub, M_diag, M_super, x, c);
+
+    // The old implementation returned x unchanged, so check that it really has moved
+    ASSERT_EQ(y_expected.size(), y.size());
+    EXPECT_GT(arma::norm(y - x), 1.0);
+
+    for(unsigned int i = 0; i < y.size(); ++i)
+        EXPECT_NEAR(y_expected[i], y[i], 1e-12);
+}
+
+TEST_F(TridiagTest, multiplyVecTridiagInPlace)
+{
+    const arma::vec x = {1.0, 2.0, -3.0, 0.5, 4.0};
+    arma::vec       c = {0.1, -0.2, 0.3, -0.4, 0.5};
+
+    const arma::vec y_expected = M*x + c;
+
+    // The result may be written over the vector that is added
+    multiply_vec_tridiag(M_sub, M_diag, M_super, x, c, c);
+
+    for(unsigned int i = 0; i < c.size(); ++i)
+        EXPECT_NEAR(y_expected[i], c[i], 1e-12);
+}
+
+TEST_F(TridiagTest, solveTridiagInPlace)
+{
+    const arma::vec b = {1.0, -1.0, 2.0, 0.0, 3.0};
+
+    const arma::vec x_expected = arma::solve(M, b);
+    const arma::vec x          = solve_tridiag(M_sub, M_diag, M_super, b);
+
+    TridiagFactorisation work;
+    arma::vec            x_in_place(b);
+    solve_tridiag(M_sub, M_diag, M_super, x_in_place, work);
+
+    for(unsigned int i = 0; i < b.size(); ++i)
+    {
+        EXPECT_NEAR(x_expected[i], x[i],          1e-12);
+        EXPECT_NEAR(x_expected[i], x_in_place[i], 1e-12);
+    }
+}
+
+TEST(CountEigenTridiag, countsEigenvaluesBelowValue)
+{
+    // Second-difference matrix, with eigenvalues 2 - 2cos(k*pi/(N+1))
+    const unsigned int N    = 20;
+    const arma::vec    diag = 2.0*arma::ones(N);
+    const arma::vec    sub  = -arma::ones(N-1);
+
+    for(unsigned int k = 1; k <= N; ++k)
+    {
+        const double E = 2.0 - 2.0*cos(k*M_PI/(N+1));
+        EXPECT_EQ(k-1, count_eigen_tridiag(diag, sub, E - 1e-9));
+        EXPECT_EQ(k,   count_eigen_tridiag(diag, sub, E + 1e-9));
+    }
+}
+
+/**
+ * \brief Check that the shift-invert solver finds every state in a window
+ *
+ * \param[in] E_unit Unit of energy in which the eigenvalues are given
+ *
+ * \details With only A31 nonzero, each point gives one real eigenvalue, the cube root
+ *          of A31.  The window holds more of these than the initial 40-dimensional
+ *          Krylov subspace, so several shifts are needed to find them all.
+ */
+static void expect_all_cubic_states_found(const double E_unit)
+{
+    const unsigned int nz   = 100;
+    const unsigned int nst  = 60;
+    const double       dE   = 0.01*E_unit;
+    const arma::vec    E_in = E_unit + dE*arma::regspace(0, nz-1);
+
+    const CubicEVPMatrix A(arma::zeros(nz-1), arma::pow(E_in, 3), arma::zeros(nz-1),
+                           arma::zeros(nz-1), arma::zeros(nz),    arma::zeros(nz));
+
+    const double VL = E_in[0]     - dE/2;
+    const double VU = E_in[nst-1] + dE/2;
+
+    const auto solutions = eigen_cubic_shift_invert(A, VL, VU, 0);
+    ASSERT_EQ(nst, solutions.size());
+
+    for(unsigned int ist = 0; ist < nst; ++ist)
+    {
+        EXPECT_NEAR(E_in[ist], solutions[ist].get_E(), 1e-10*E_unit);
+        EXPECT_EQ(3*nz, solutions[ist].psi_array().size());
+    }
+
+    // The limit on the number of states must still give the lowest ones
+    const auto lowest = eigen_cubic_shift_invert(A, VL, VU, 50);
+    ASSERT_EQ(50U, lowest.size());
+
+    for(unsigned int ist = 0; ist < lowest.size(); ++ist)
+        EXPECT_NEAR(E_in[ist], lowest[ist].get_E(), 1e-10*E_unit);
+}
+
+TEST(EigenCubicShiftInvert, findsMoreStatesThanSubspaceSize)
+{
+    expect_all_cubic_states_found(1.0);
+}
+
+TEST(EigenCubicShiftInvert, findsStatesInJoules)
+{
+    // A31 is then of order 1e-60, so the solver must rescale the problem
+    expect_all_cubic_states_found(1e-20);
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
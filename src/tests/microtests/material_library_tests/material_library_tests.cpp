@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "qwwad/material.h"
+#include "qwwad/material-library.h"
+#include "qwwad/material-property-numeric.h"
+
+using namespace QWWAD;
+
+TEST(MaterialLibrary, concurrentLookup)
+{
+    const MaterialLibrary lib(QWWAD_TEST_MATERIAL_LIBRARY);
+
+    const std::vector<const char *> names     = {"GaAs", "AlAs", "AlGaAs", "InGaAs", "SiGe"};
+    const unsigned int              n_threads = 8;
+    const unsigned int              n_lookups = 200;
+
+    // Each thread looks up every material many times, starting at a different
+    // material so that the first loads of each material are likely to collide
+    std::vector< std::vector<Material const *> > found(n_threads,
+                                                       std::vector<Material const *>(names.size()));
+    std::vector<double> a0_GaAs(n_threads);
+    std::vector<double> a0_AlAs(n_threads);
+    std::vector<std::thread> threads;
+
+    for(unsigned int ithread = 0; ithread < n_threads; ++ithread)
+    {
+        threads.push_back(std::thread([&, ithread]() {
+            for(unsigned int ilookup = 0; ilookup < n_lookups; ++ilookup)
+            {
+                const auto imat = (ithread + ilookup) % names.size();
+                found[ithread][imat] = lib.get_material(names[imat]);
+            }
+
+            a0_GaAs[ithread] = lib.get_material("GaAs")->get_property_value("lattice-constant");
+            a0_AlAs[ithread] = lib.get_material("AlAs")->get_property_value("lattice-constant");
+        }));
+    }
+
+    for(auto &thread : threads)
+        thread.join();
+
+    // Every thread must see the same object for each material, and the same data
+    for(unsigned int ithread = 0; ithread < n_threads; ++ithread)
+    {
+        for(unsigned int imat = 0; imat < names.size(); ++imat)
+        {
+            ASSERT_NE(nullptr, found[ithread][imat]);
+            EXPECT_EQ(found[0][imat], found[ithread][imat]);
+            EXPECT_EQ(names[imat], found[ithread][imat]->get_name());
+        }
+
+        EXPECT_DOUBLE_EQ(5.65325, a0_GaAs[ithread]);
+        EXPECT_DOUBLE_EQ(5.6611,  a0_AlAs[ithread]);
+    }
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
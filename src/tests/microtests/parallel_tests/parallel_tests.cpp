@@ -0,0 +1,96 @@
+#include <cmath>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <vector>
+#include "qwwad/parallel.h"
+
+using namespace QWWAD;
+
+/**
+ * \brief A badly-conditioned set of terms, with a known exact sum
+ *
+ * \details Each large term is followed later by its negative, so the exact sum
+ *          is that of the small terms alone.  A plain running sum loses most of
+ *          the small terms, and its result depends on the order of addition.
+ */
+class ParallelSumTest : public ::testing::Test
+{
+protected:
+    std::vector<double> terms;
+    double              exact_sum;
+
+    void SetUp()
+    {
+        const size_t n_pairs = 200000;
+        terms.resize(4*n_pairs);
+        exact_sum = 0.0;
+
+        for(size_t i = 0; i < n_pairs; ++i)
+        {
+            const double big   = 1e16*(1.0 + 1e-3*(i % 97));
+            const double small = 1.0 / (1 + i % 13);
+
+            terms[2*i]               = big;
+            terms[2*i + 1]           = small;
+            terms[2*n_pairs + 2*i]   = -big;
+            terms[2*n_pairs + 2*i+1] = small;
+            exact_sum += 2*small;
+        }
+    }
+
+    double sum_with_threads(const unsigned int n_threads) const
+    {
+        return parallel_sum(terms.size(), n_threads, [&](const size_t i) {return terms[i];});
+    }
+};
+
+/// Compare two doubles bit-for-bit, so that the test does not allow any rounding
+static bool bitwise_equal(const double a, const double b)
+{
+    return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+TEST_F(ParallelSumTest, identicalForAnyThreadCount)
+{
+    const double sum_1 = sum_with_threads(1);
+
+    for(const unsigned int n_threads : {2U, 3U, 4U, 7U, 8U, 16U})
+    {
+        const double sum_n = sum_with_threads(n_threads);
+        EXPECT_TRUE(bitwise_equal(sum_1, sum_n))
+            << n_threads << " threads gave " << sum_n << " rather than " << sum_1;
+    }
+}
+
+TEST_F(ParallelSumTest, compensatedSumIsAccurate)
+{
+    const double naive_sum = std::accumulate(terms.begin(), terms.end(), 0.0);
+    const double sum       = sum_with_threads(4);
+
+    // The plain sum has lost the small terms, which shows that the test is hard
+    ASSERT_GT(std::abs(naive_sum - exact_sum), 1e-3*exact_sum);
+    EXPECT_NEAR(exact_sum, sum, 1e-9*exact_sum);
+}
+
+TEST(CompensatedSum, recoversSmallTerms)
+{
+    CompensatedSum sum;
+    sum.add(1.0);
+
+    for(unsigned int i = 0; i < 1000000; ++i)
+        sum.add(1e-16);
+
+    EXPECT_DOUBLE_EQ(1.0 + 1e-10, sum.value());
+}
+
+TEST(ParallelSum, emptyAndPartialBlocks)
+{
+    auto one = [](const size_t) {return 1.0;};
+
+    EXPECT_EQ(0.0, parallel_sum(0, 4, one));
+    EXPECT_EQ(1.0, parallel_sum(1, 4, one));
+    EXPECT_EQ(double(parallel_reduce_block_size + 1),
+              parallel_sum(parallel_reduce_block_size + 1, 4, one));
+}
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :